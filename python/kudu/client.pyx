@@ -21,18 +21,20 @@
 from libcpp.string cimport string
 from libcpp cimport bool as c_bool
 from libcpp.map cimport map
+from libcpp.vector cimport vector
 
 cimport cpython
 from cython.operator cimport dereference as deref
 
 from libkudu_client cimport *
-from kudu.compat import tobytes, frombytes, dict_iter
+from kudu.compat import tobytes, frombytes, dict_iter, np
 from kudu.schema cimport Schema, ColumnSchema, ColumnSpec, KuduValue, KuduType
 from kudu.errors cimport check_status
 from kudu.util import to_unixtime_micros, from_unixtime_micros, \
     from_hybridtime, to_unscaled_decimal, from_unscaled_decimal
 from errors import KuduException
 
+from collections import OrderedDict
 import six
 
 # Replica selection enums
@@ -71,6 +73,19 @@ cdef dict _type_names = {
     KUDU_DECIMAL : "KUDU_DECIMAL"
 }
 
+# The NumPy types of the columns read in bulk by RowBatch.as_arrays(). The
+# columns of other types are read into object arrays.
+cdef dict _numpy_types = {
+    KUDU_BOOL : 'bool',
+    KUDU_INT8 : 'int8',
+    KUDU_INT16 : 'int16',
+    KUDU_INT32 : 'int32',
+    KUDU_INT64 : 'int64',
+    KUDU_FLOAT : 'float32',
+    KUDU_DOUBLE : 'float64',
+    KUDU_UNIXTIME_MICROS : 'datetime64[us]'
+}
+
 # Range Partition Bound Type enums
 EXCLUSIVE_BOUND = PartitionType_Exclusive
 INCLUSIVE_BOUND = PartitionType_Inclusive
@@ -1134,6 +1149,65 @@ cdef dict _flush_modes = {
 }
 
 
+cdef Status _set_fixed_length_column(vector[KuduWriteOperation*]& ops,
+                                     int i, DataType t, const uint8_t* values,
+                                     const uint8_t* nulls) nogil:
+    # Sets column 'i' of the rows of 'ops' from the contiguous cells
+    # 'values', or to NULL where 'nulls' is set.
+    cdef:
+        size_t j
+        KuduPartialRow* row
+        Status s
+
+    for j in range(ops.size()):
+        row = ops[j].mutable_row()
+        if nulls[j]:
+            s = row.SetNull(i)
+        elif t == KUDU_BOOL:
+            s = row.SetBool(i, (<const c_bool*> values)[j])
+        elif t == KUDU_INT8:
+            s = row.SetInt8(i, (<const int8_t*> values)[j])
+        elif t == KUDU_INT16:
+            s = row.SetInt16(i, (<const int16_t*> values)[j])
+        elif t == KUDU_INT32:
+            s = row.SetInt32(i, (<const int32_t*> values)[j])
+        elif t == KUDU_INT64:
+            s = row.SetInt64(i, (<const int64_t*> values)[j])
+        elif t == KUDU_FLOAT:
+            s = row.SetFloat(i, (<const float*> values)[j])
+        elif t == KUDU_DOUBLE:
+            s = row.SetDouble(i, (<const double*> values)[j])
+        else:
+            s = row.SetUnixTimeMicros(i, (<const int64_t*> values)[j])
+        if not s.ok():
+            return s
+    return Status_OK()
+
+
+cdef _null_mask(arr):
+    # Returns the mask of the NULL values of 'arr': its masked values, its
+    # None values if it holds objects, and its NaT values if it holds times.
+    mask = np.ma.getmaskarray(arr)
+    data = np.ma.getdata(arr)
+    if data.dtype == object:
+        mask = mask | np.array([v is None for v in data], dtype=np.bool_)
+    elif data.dtype.kind == 'M':
+        mask = mask | np.isnat(data)
+    return mask
+
+
+cdef KuduWriteOperation* _new_write_op(Table table, op_type) except NULL:
+    if op_type == 'insert':
+        return table.ptr().NewInsert()
+    elif op_type == 'upsert':
+        return table.ptr().NewUpsert()
+    elif op_type == 'update':
+        return table.ptr().NewUpdate()
+    elif op_type == 'delete':
+        return table.ptr().NewDelete()
+    raise ValueError('Invalid write operation type: {0}'.format(op_type))
+
+
 cdef class Session:
     """
     Wrapper for a client KuduSession to build up write operations to interact
@@ -1193,6 +1267,130 @@ cdef class Session:
         """
         return op.add_to_session(self)
 
+    def apply_arrays(self, Table table, arrays, op_type='insert'):
+        """
+        Apply one write operation per row of the given columns, which is much
+        cheaper than applying an operation per row with apply().
+
+        The cells of BOOL, integer, floating point and UNIXTIME_MICROS columns
+        are set without holding the GIL, and the operations are handed to the
+        session at once, which partitions them in bulk. UNIXTIME_MICROS
+        columns may hold datetime64 values, integers of microseconds since
+        the Unix epoch, or any value accepted by apply(). Masked values,
+        None and NaT are written as NULL. The columns of the table which
+        aren't given are left unset.
+
+        Requires NumPy.
+
+        Parameters
+        ----------
+        table : Table
+        arrays : dict
+          Maps column names to array-like columns of the same length.
+        op_type : {'insert', 'upsert', 'update', 'delete'}, default 'insert'
+
+        Examples
+        --------
+        session.apply_arrays(table, {'key': np.arange(1000),
+                                     'value': np.ones(1000)})
+        session.flush()
+        """
+        cdef:
+            Schema schema = table.schema
+            vector[KuduWriteOperation*] ops
+            KuduWriteOperation* op
+            size_t j
+            int i
+            int n = -1
+            DataType t
+            uint8_t[::1] values
+            uint8_t[::1] nulls
+            PartialRow row
+            Status s
+
+        if np is None:
+            raise ImportError('NumPy is required to apply columns of arrays')
+
+        columns = []
+        for name, arr in dict_iter(arrays):
+            arr = np.ma.asarray(arr)
+            if n == -1:
+                n = len(arr)
+            elif len(arr) != n:
+                raise ValueError('Columns of different lengths: {0} has {1} '
+                                 'values, not {2}'.format(name, len(arr), n))
+            columns.append((schema.get_loc(name), arr))
+        if n <= 0:
+            return
+
+        try:
+            for j in range(n):
+                ops.push_back(_new_write_op(table, op_type))
+
+            for i, arr in columns:
+                t = schema.loc_type(i)
+                mask = _null_mask(arr)
+                data = np.ma.getdata(arr)
+                if t == KUDU_UNIXTIME_MICROS:
+                    if data.dtype.kind == 'M':
+                        data = np.where(mask, np.datetime64(0, 'us'), data)
+                        data = data.astype('datetime64[us]').view(np.int64)
+                    elif data.dtype.kind not in 'iu':
+                        data = np.array([0 if m else to_unixtime_micros(v)
+                                         for v, m in zip(data, mask)],
+                                        dtype=np.int64)
+                    dtype = np.dtype(np.int64)
+                elif t in _numpy_types:
+                    dtype = np.dtype(_numpy_types[t])
+                else:
+                    # STRING, BINARY and DECIMAL cells need Python objects
+                    # to be converted, so they're set one by one.
+                    row = PartialRow(schema)
+                    row._own = 0
+                    for j in range(ops.size()):
+                        row.row = ops[j].mutable_row()
+                        row.set_loc(i, None if mask[j] else data[j])
+                    continue
+
+                values_buf = np.ascontiguousarray(
+                    np.where(mask, np.zeros(1, dtype=dtype), data).astype(dtype))
+                values = values_buf.view(np.uint8)
+                nulls_buf = np.ascontiguousarray(mask, dtype=np.uint8)
+                nulls = nulls_buf
+                with nogil:
+                    s = _set_fixed_length_column(ops, i, t, &values[0], &nulls[0])
+                check_status(s)
+        except:
+            for j in range(ops.size()):
+                op = ops[j]
+                del op
+            raise
+
+        # The session takes the ownership of the operations, even if some
+        # of them fail.
+        with nogil:
+            s = self.s.get().ApplyBatch(ops)
+        check_status(s)
+
+    def apply_dataframe(self, Table table, frame, op_type='insert'):
+        """
+        Apply one write operation per row of a pandas DataFrame, whose
+        columns are named after the columns of the table. NaN, None and NaT
+        values are written as NULL. See apply_arrays.
+
+        Parameters
+        ----------
+        table : Table
+        frame : pandas.DataFrame
+        op_type : {'insert', 'upsert', 'update', 'delete'}, default 'insert'
+        """
+        arrays = OrderedDict()
+        for name in frame.columns:
+            column = frame[name]
+            arrays[name] = np.ma.masked_array(column.values,
+                                              mask=column.isnull().values)
+        self.apply_arrays(table, arrays, op_type)
+
     def flush(self):
         """
         Flush pending operations
@@ -1392,6 +1590,110 @@ cdef class RowBatch:
             tuples.append(self.get_row(i).as_tuple())
         return tuples
 
+    def as_arrays(self):
+        """
+        Return RowBatch as a dict of NumPy arrays, keyed by the names of the
+        columns of the projection, in projection order.
+
+        The columns are copied in bulk by the C++ client, which doesn't hold
+        the GIL while doing so. BOOL, integer and floating point columns are
+        read into arrays of the matching NumPy types, UNIXTIME_MICROS columns
+        into datetime64[us] arrays of UTC times, and STRING, BINARY and
+        DECIMAL columns into object arrays. Nullable columns are read into
+        numpy.ma.MaskedArray instances, whose mask is set for NULL values.
+
+        Requires NumPy.
+
+        Returns
+        -------
+        arrays : OrderedDict
+        """
+        if np is None:
+            raise ImportError('NumPy is required to read columns into arrays')
+
+        cdef:
+            const KuduSchema* schema = self.batch.projection_schema()
+            size_t i
+
+        result = OrderedDict()
+        for i in range(schema.num_columns()):
+            result[frombytes(schema.Column(i).name())] = self._column_array(i)
+        return result
+
+    cdef _column_array(self, int i):
+        cdef:
+            const KuduSchema* schema = self.batch.projection_schema()
+            DataType t = schema.Column(i).type()
+            c_bool nullable = schema.Column(i).is_nullable()
+            int n = self.batch.NumRows()
+            int j
+            size_t values_size
+            uint8_t[::1] values
+            uint8_t[::1] bitmap
+            uint8_t[::1] mask
+            uint32_t[::1] offsets
+            uint8_t* bitmap_ptr = NULL
+            string data
+            const char* data_ptr
+            Row row
+            Status s
+
+        # The buffers hold at least one element, so that they can be
+        # addressed even if the batch is empty.
+        if nullable:
+            bitmap_buf = np.empty(max((n + 7) // 8, 1), dtype=np.uint8)
+            bitmap = bitmap_buf
+            bitmap_ptr = &bitmap[0]
+
+        if t in _numpy_types:
+            dtype = np.dtype(_numpy_types[t])
+            values_size = max(n, 1) * dtype.itemsize
+            values_buf = np.empty(values_size, dtype=np.uint8)
+            values = values_buf
+            with nogil:
+                s = self.batch.CopyFixedLengthColumn(i, &values[0], values_size,
+                                                     bitmap_ptr)
+            check_status(s)
+            arr = values_buf.view(dtype)[:n]
+        elif t == KUDU_STRING or t == KUDU_BINARY:
+            offsets_buf = np.empty(n + 1, dtype=np.uint32)
+            offsets = offsets_buf
+            with nogil:
+                s = self.batch.CopyVariableLengthColumn(i, &offsets[0],
+                                                        (n + 1) * sizeof(uint32_t),
+                                                        &data, bitmap_ptr)
+            check_status(s)
+            arr = np.empty(n, dtype=object)
+            data_ptr = data.c_str()
+            for j in range(n):
+                if nullable and not (bitmap[j >> 3] >> (j & 7)) & 1:
+                    continue
+                val = cpython.PyBytes_FromStringAndSize(data_ptr + offsets[j],
+                                                        offsets[j + 1] - offsets[j])
+                arr[j] = frombytes(val) if t == KUDU_STRING else val
+        else:
+            # DECIMAL cells are as wide as 16 bytes, which no NumPy type
+            # holds, so they're read row by row.
+            arr = np.empty(n, dtype=object)
+            mask_buf = np.zeros(n, dtype=np.bool_)
+            for j in range(n):
+                row = self.get_row(j)
+                if row.is_null(i):
+                    mask_buf[j] = True
+                else:
+                    arr[j] = row.get_slot(i)
+            return np.ma.masked_array(arr, mask=mask_buf) if nullable else arr
+
+        if not nullable:
+            return arr
+
+        mask_buf = np.empty(max(n, 1), dtype=np.uint8)
+        mask = mask_buf
+        with nogil:
+            for j in range(n):
+                mask[j] = 1 - ((bitmap[j >> 3] >> (j & 7)) & 1)
+        return np.ma.masked_array(arr, mask=mask_buf[:n].view(np.bool_))
+
     cdef Row get_row(self, i):
         # TODO: boundscheck
 
@@ -1765,6 +2067,66 @@ cdef class Scanner:
     def read_next_batch_tuples(self):
         return self.next_batch().as_tuples()
 
+    def read_all_arrays(self):
+        """
+        Read all the rows of the scan into NumPy arrays, one per column of
+        the projection. See RowBatch.as_arrays for the types of the arrays.
+
+        Requires NumPy.
+
+        Returns
+        -------
+        arrays : OrderedDict
+        """
+        cdef:
+            KuduSchema schema
+            size_t i
+            list batches = []
+
+        if np is None:
+            raise ImportError('NumPy is required to read columns into arrays')
+
+        self.ensure_open()
+
+        while self.has_more_rows():
+            batches.append(self.next_batch().as_arrays())
+
+        result = OrderedDict()
+        if not batches:
+            schema = self.scanner.GetProjectionSchema()
+            for i in range(schema.num_columns()):
+                arr = np.empty(0, dtype=_numpy_types.get(schema.Column(i).type(),
+                                                         object))
+                if schema.Column(i).is_nullable():
+                    arr = np.ma.masked_array(arr, mask=np.zeros(0, dtype=np.bool_))
+                result[frombytes(schema.Column(i).name())] = arr
+            return result
+
+        for name, arr in batches[0].items():
+            arrays = [batch[name] for batch in batches]
+            if isinstance(arr, np.ma.MaskedArray):
+                result[name] = np.ma.concatenate(arrays)
+            else:
+                result[name] = np.concatenate(arrays)
+        return result
+
+    def to_pandas(self):
+        """
+        Read all the rows of the scan into a pandas DataFrame, with the
+        columns of the projection. The columns are read in bulk, as with
+        read_all_arrays; NULL values become NaN or None.
+
+        Requires NumPy and pandas.
+
+        Returns
+        -------
+        frame : pandas.DataFrame
+        """
+        import pandas as pd
+
+        arrays = self.read_all_arrays()
+        return pd.DataFrame(arrays, columns=list(arrays))
+
     cpdef RowBatch next_batch(self):
         """
         Retrieve the next batch of rows from the scanner.
@@ -128,6 +128,8 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         EncodingType_PLAIN " kudu::client::KuduColumnStorageAttributes::PLAIN_ENCODING"
         EncodingType_PREFIX " kudu::client::KuduColumnStorageAttributes::PREFIX_ENCODING"
         EncodingType_BIT_SHUFFLE " kudu::client::KuduColumnStorageAttributes::BIT_SHUFFLE"
+        EncodingType_DELTA_BITPACK " kudu::client::KuduColumnStorageAttributes::DELTA_BITPACK"
+        EncodingType_FLOAT_XOR " kudu::client::KuduColumnStorageAttributes::FLOAT_XOR"
         EncodingType_RLE " kudu::client::KuduColumnStorageAttributes::RLE"
         EncodingType_DICT " kudu::client::KuduColumnStorageAttributes::DICT_ENCODING"
 
@@ -137,6 +139,7 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         CompressionType_SNAPPY " kudu::client::KuduColumnStorageAttributes::SNAPPY"
         CompressionType_LZ4 " kudu::client::KuduColumnStorageAttributes::LZ4"
         CompressionType_ZLIB " kudu::client::KuduColumnStorageAttributes::ZLIB"
+        CompressionType_ZSTD " kudu::client::KuduColumnStorageAttributes::ZSTD"
 
     cdef struct KuduColumnStorageAttributes:
         KuduColumnStorageAttributes()
@@ -218,6 +221,12 @@ cdef extern from "kudu/client/scan_batch.h" namespace "kudu::client" nogil:
         KuduRowPtr Row(int idx) const;
         const KuduSchema* projection_schema() const;
 
+        Status CopyFixedLengthColumn(int idx, void* values, size_t values_size,
+                                     uint8_t* non_null_bitmap) const;
+        Status CopyVariableLengthColumn(int idx, uint32_t* offsets,
+                                        size_t offsets_size, string* data,
+                                        uint8_t* non_null_bitmap) const;
+
     cdef cppclass KuduRowPtr " kudu::client::KuduScanBatch::RowPtr":
         c_bool IsNull(Slice& col_name)
         c_bool IsNull(int col_idx)
@@ -629,6 +638,7 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
         Status Apply(KuduUpsert* write_op)
         Status Apply(KuduUpdate* write_op)
         Status Apply(KuduDelete* write_op)
+        Status ApplyBatch(const vector[KuduWriteOperation*]& write_ops)
 
         # This is thread-safe
         Status Flush()
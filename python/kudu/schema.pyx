@@ -56,6 +56,7 @@ COMPRESSION_NONE = CompressionType_NONE
 COMPRESSION_SNAPPY = CompressionType_SNAPPY
 COMPRESSION_LZ4 = CompressionType_LZ4
 COMPRESSION_ZLIB = CompressionType_ZLIB
+COMPRESSION_ZSTD = CompressionType_ZSTD
 
 cdef dict _compression_types = {
     'default': COMPRESSION_DEFAULT,
@@ -63,6 +64,7 @@ cdef dict _compression_types = {
     'snappy': COMPRESSION_SNAPPY,
     'lz4': COMPRESSION_LZ4,
     'zlib': COMPRESSION_ZLIB,
+    'zstd': COMPRESSION_ZSTD,
 }
 
 cdef dict _compression_type_to_name = _reverse_dict(_compression_types)
@@ -75,6 +77,8 @@ ENCODING_PREFIX = EncodingType_PREFIX
 ENCODING_BIT_SHUFFLE = EncodingType_BIT_SHUFFLE
 ENCODING_RLE = EncodingType_RLE
 ENCODING_DICT = EncodingType_DICT
+ENCODING_DELTA_BITPACK = EncodingType_DELTA_BITPACK
+ENCODING_FLOAT_XOR = EncodingType_FLOAT_XOR
 
 cdef dict _encoding_types = {
     'auto': ENCODING_AUTO,
@@ -83,6 +87,8 @@ cdef dict _encoding_types = {
     'bitshuffle': ENCODING_BIT_SHUFFLE,
     'rle': ENCODING_RLE,
     'dict': ENCODING_DICT,
+    'delta_bitpack': ENCODING_DELTA_BITPACK,
+    'float_xor': ENCODING_FLOAT_XOR,
 }
 
 cdef dict _encoding_type_to_name = _reverse_dict(_encoding_types)
@@ -318,7 +324,8 @@ cdef class ColumnSpec:
         Parameters
         ----------
         encoding : string or int
-          One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict'}
+          One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict',
+          'delta_bitpack', 'float_xor'}
           Or see kudu.ENCODING_* constants
 
         Returns
@@ -487,7 +494,8 @@ cdef class SchemaBuilder:
           One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
           Or see kudu.COMPRESSION_* constants
         encoding : string or int
-          One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict'}
+          One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict',
+          'delta_bitpack', 'float_xor'}
           Or see kudu.ENCODING_* constants
         primary_key : boolean, default False
           Use this column as the table primary key
@@ -16,7 +16,7 @@
 # specific language governing permissions and limitations
 # under the License.
 
-from kudu.compat import unittest, long
+from kudu.compat import unittest, long, np
 from kudu.tests.common import KuduTestBase
 from kudu.client import Partitioning
 import kudu
@@ -206,6 +206,41 @@ class TestClient(KuduTestBase, unittest.TestCase):
         scanner = table.scanner().open()
         assert len(scanner.read_all_tuples()) == 0
 
+    @unittest.skipIf(np is None, 'NumPy is not installed')
+    def test_apply_arrays(self):
+        nrows = 100
+        table = self.client.table(self.ex_table)
+        session = self.client.new_session()
+        times = np.arange(nrows, dtype=np.int64).astype('datetime64[s]')
+        session.apply_arrays(table, {
+            'key': np.arange(nrows, dtype=np.int32),
+            'int_val': np.ma.masked_array(np.arange(nrows) * 2,
+                                          mask=np.arange(nrows) % 2 == 1),
+            'string_val': ['hello_%d' % i if i % 3 else None
+                           for i in range(nrows)],
+            'unixtime_micros_val': times
+        })
+        session.flush()
+
+        scanner = table.scanner().open()
+        rows = dict((t[0], t) for t in scanner.read_all_tuples())
+        self.assertEqual(len(rows), nrows)
+        for i in range(nrows):
+            self.assertEqual(rows[i], (
+                i,
+                None if i % 2 else i * 2,
+                'hello_%d' % i if i % 3 else None,
+                datetime.datetime(1970, 1, 1, 0, 0, i).replace(tzinfo=utc)))
+
+        # Columns of different lengths are rejected.
+        self.assertRaises(ValueError, session.apply_arrays, table,
+                          {'key': [1, 2], 'int_val': [1]})
+
+        session.apply_arrays(table, {'key': np.arange(nrows)}, 'delete')
+        session.flush()
+        scanner = table.scanner().open()
+        self.assertEqual(len(scanner.read_all_tuples()), 0)
+
     def test_failed_write_op(self):
         # Insert row
         table = self.client.table(self.ex_table)
@@ -18,7 +18,7 @@
 
 from __future__ import division
 
-from kudu.compat import unittest
+from kudu.compat import unittest, np
 from kudu.tests.util import TestScanBase
 from kudu.tests.common import KuduTestBase, TimeoutError
 import kudu
@@ -168,6 +168,62 @@ class TestScanner(TestScanBase):
 
         self.assertEqual(sorted(tuples), self.tuples[10:90])
 
+    @unittest.skipIf(np is None, 'NumPy is not installed')
+    def test_read_all_arrays(self):
+        tuples = sorted(self.table.scanner()
+                        .set_fault_tolerant().open().read_all_tuples())
+        arrays = self.table.scanner() \
+            .set_fault_tolerant().open().read_all_arrays()
+
+        self.assertEqual(list(arrays),
+                         ['key', 'int_val', 'string_val', 'unixtime_micros_val'])
+        self.assertEqual(arrays['key'].dtype, np.int32)
+        self.assertFalse(isinstance(arrays['key'], np.ma.MaskedArray))
+        self.assertTrue(isinstance(arrays['int_val'], np.ma.MaskedArray))
+        self.assertEqual(arrays['unixtime_micros_val'].dtype,
+                         np.dtype('datetime64[us]'))
+
+        # NULL values are masked, and compared as None.
+        order = np.argsort(arrays['key'])
+        columns = []
+        for arr in arrays.values():
+            arr = arr[order]
+            columns.append([None if masked else value for value, masked in
+                            zip(np.ma.getdata(arr), np.ma.getmaskarray(arr))])
+        self.assertEqual(len(columns[0]), len(tuples))
+        for i, tup in enumerate(tuples):
+            self.assertEqual(columns[0][i], tup[0])
+            self.assertEqual(columns[1][i], tup[1])
+            self.assertEqual(columns[2][i], tup[2])
+            self.assertEqual(columns[3][i].astype(datetime.datetime),
+                             tup[3].replace(tzinfo=None))
+
+        # A scan yielding no row has empty arrays of the same types.
+        scanner = self.table.scanner()
+        scanner.add_predicate(self.table['key'] < 0)
+        arrays = scanner.open().read_all_arrays()
+        self.assertEqual(len(arrays['key']), 0)
+        self.assertEqual(arrays['key'].dtype, np.int32)
+        self.assertTrue(isinstance(arrays['string_val'], np.ma.MaskedArray))
+
+    @unittest.skipIf(np is None, 'NumPy is not installed')
+    def test_read_all_arrays_all_types(self):
+        arrays = self.type_table.scanner() \
+            .set_fault_tolerant().open().read_all_arrays()
+        order = np.argsort(arrays['key'])
+        for name, arr in arrays.items():
+            self.assertFalse(np.ma.getmaskarray(arr).any())
+        self.assertEqual(arrays['bool_val'].dtype, np.bool_)
+        self.assertEqual(arrays['int8_val'].dtype, np.int8)
+        self.assertEqual(arrays['float_val'].dtype, np.float32)
+        for i, row in enumerate(self.type_test_rows):
+            self.assertEqual(arrays['decimal_val'][order][i], row[2])
+            self.assertEqual(arrays['string_val'][order][i], row[3])
+            self.assertEqual(arrays['bool_val'][order][i], row[4])
+            self.assertEqual(arrays['double_val'][order][i], row[5])
+            self.assertEqual(arrays['int8_val'][order][i], row[6])
+            self.assertEqual(arrays['binary_val'][order][i], row[7])
+
     def test_unixtime_micros(self):
         """
         Test setting and getting unixtime_micros fields
@@ -0,0 +1,436 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Benchmark comparing the CFile encodings and compression codecs on sample
+// data: the column is written with every encoding supported by its type and
+// every codec, then read back, and the size of the resulting CFile, the
+// encode and decode throughput, and the throughput of evaluating a range
+// predicate selecting about half of the values are reported.
+//
+// The sample data is read from a text file with one value per line, or from
+// a field of a CSV file with --csv_column. "NULL" stands for a null value, and
+// string values may be quoted with C-style escapes, which makes it possible to
+// use the output of 'kudu fs dump cfile' as is. For example:
+//
+//   kudu fs dump cfile <block_id> --noprint_meta > /tmp/values
+//   cfile-bench --input_file=/tmp/values --type=string
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/stringpiece.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/string_case.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_string(input_file, "",
+              "Text file with the sample values, one per line.");
+DEFINE_int32(csv_column, -1,
+             "If not negative, the lines of --input_file are comma-separated, "
+             "and the values are those of the field at this 0-based index.");
+DEFINE_string(type, "int32",
+              "Type of the values: bool, int8, int16, int32, int64, "
+              "unixtime_micros, float, double, string or binary.");
+DEFINE_string(fs_root, "/tmp/cfile-bench",
+              "Directory in which to write the CFiles. It must not exist, and "
+              "it's deleted once done.");
+DEFINE_int32(num_iterations, 3,
+             "Number of times to decode every CFile and evaluate the predicate "
+             "on it. The best throughput is reported.");
+
+using kudu::cfile::CFileIterator;
+using kudu::cfile::CFileReader;
+using kudu::cfile::CFileWriter;
+using kudu::cfile::ReaderOptions;
+using kudu::cfile::TypeEncodingInfo;
+using kudu::cfile::WriterOptions;
+using kudu::fs::ReadableBlock;
+using kudu::fs::WritableBlock;
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+const size_t kBatchSize = 1024;
+
+const EncodingType kEncodings[] = {
+  PLAIN_ENCODING, PREFIX_ENCODING, RLE, DICT_ENCODING, BIT_SHUFFLE,
+  DELTA_BITPACK, FLOAT_XOR,
+};
+
+const CompressionType kCompressions[] = {
+  NO_COMPRESSION, SNAPPY, LZ4, ZLIB, ZSTD,
+};
+
+// The sample values of a column, in the in-memory format of their type.
+struct Column {
+  explicit Column(const TypeInfo* type) : type(type) {}
+
+  // The raw size of the values, ie the size of the cells of the non-null
+  // values, plus the size of the data of the strings.
+  size_t raw_size() const {
+    size_t size = (num_values - num_nulls) * type->size();
+    for (const auto& s : strings) {
+      size += s.size();
+    }
+    return size;
+  }
+
+  const TypeInfo* const type;
+  size_t num_values = 0;
+  size_t num_nulls = 0;
+  faststring cells;
+  faststring null_bitmap;
+  // The data of the string values, pointed to by the Slices in 'cells'.
+  std::deque<string> strings;
+};
+
+Status ParseValue(const string& str, Column* col, uint8_t* cell) {
+  const Status bad_value = Status::InvalidArgument(
+      Substitute("invalid $0 value", col->type->name()), str);
+  switch (col->type->physical_type()) {
+    case BOOL: {
+      if (str != "true" && str != "false") return bad_value;
+      const bool v = str == "true";
+      memcpy(cell, &v, sizeof(v));
+      break;
+    }
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64: {
+      int64_t v;
+      if (!safe_strto64(str, &v)) return bad_value;
+      const int bits = col->type->size() * 8;
+      if (bits < 64 && (v < -(1LL << (bits - 1)) || v >= (1LL << (bits - 1)))) {
+        return bad_value;
+      }
+      // Keep the low-order bytes, assuming a little-endian machine.
+      memcpy(cell, &v, col->type->size());
+      break;
+    }
+    case FLOAT: {
+      float v;
+      if (!safe_strtof(str, &v)) return bad_value;
+      memcpy(cell, &v, sizeof(v));
+      break;
+    }
+    case DOUBLE: {
+      double v;
+      if (!safe_strtod(str, &v)) return bad_value;
+      memcpy(cell, &v, sizeof(v));
+      break;
+    }
+    case BINARY: {
+      string v = str;
+      if (str.size() >= 2 && str.front() == '"' && str.back() == '"') {
+        string error;
+        if (!CUnescape(StringPiece(str).substr(1, str.size() - 2), &v, &error)) {
+          return bad_value.CloneAndAppend(error);
+        }
+      }
+      col->strings.emplace_back(std::move(v));
+      const Slice s(col->strings.back());
+      memcpy(cell, &s, sizeof(s));
+      break;
+    }
+    default:
+      return Status::NotSupported("unsupported type", col->type->name());
+  }
+  return Status::OK();
+}
+
+Status LoadColumn(Column* col) {
+  faststring buf;
+  RETURN_NOT_OK_PREPEND(ReadFileToString(Env::Default(), FLAGS_input_file, &buf),
+                        "unable to read the input file");
+  vector<string> lines = strings::Split(buf.ToString(), "\n", strings::SkipEmpty());
+  col->cells.resize(lines.size() * col->type->size());
+  col->null_bitmap.resize(BitmapSize(lines.size()));
+  for (const string& line : lines) {
+    string value = line;
+    if (FLAGS_csv_column >= 0) {
+      vector<string> fields = strings::Split(line, ",");
+      if (FLAGS_csv_column >= fields.size()) {
+        return Status::InvalidArgument(
+            Substitute("line $0 has no field $1", col->num_values + 1, FLAGS_csv_column));
+      }
+      value = fields[FLAGS_csv_column];
+    }
+    StripWhiteSpace(&value);
+    const size_t idx = col->num_values++;
+    const bool is_null = value == "NULL";
+    BitmapChange(col->null_bitmap.data(), idx, !is_null);
+    if (is_null) {
+      col->num_nulls++;
+      continue;
+    }
+    RETURN_NOT_OK(ParseValue(value, col, col->cells.data() + idx * col->type->size()));
+  }
+  if (col->num_values == col->num_nulls) {
+    return Status::InvalidArgument("no non-null values in the input file");
+  }
+  return Status::OK();
+}
+
+// Returns a predicate on 'col_schema' selecting the values between the first
+// and third quartiles of the non-null values of 'col', whose bounds are
+// copied to 'lower' and 'upper'.
+ColumnPredicate MakePredicate(const Column& col, const ColumnSchema& col_schema,
+                              faststring* lower, faststring* upper) {
+  vector<const void*> values;
+  for (size_t i = 0; i < col.num_values; i++) {
+    if (BitmapTest(col.null_bitmap.data(), i)) {
+      values.push_back(col.cells.data() + i * col.type->size());
+    }
+  }
+  std::sort(values.begin(), values.end(), [&](const void* a, const void* b) {
+      return col.type->Compare(a, b) < 0;
+    });
+  lower->assign_copy(static_cast<const uint8_t*>(values[values.size() / 4]),
+                     col.type->size());
+  upper->assign_copy(static_cast<const uint8_t*>(values[values.size() * 3 / 4]),
+                     col.type->size());
+  return ColumnPredicate::Range(col_schema, lower->data(), upper->data());
+}
+
+double MBPerSec(size_t bytes, double secs) {
+  return bytes / secs / (1024 * 1024);
+}
+
+class CFileBench {
+ public:
+  CFileBench(const Column& col, FsManager* fs_manager)
+      : col_(col),
+        fs_manager_(fs_manager),
+        col_schema_("col", col.type->type(), col.num_nulls > 0),
+        pred_(MakePredicate(col_, col_schema_, &lower_, &upper_)) {
+  }
+
+  Status Run() {
+    cout << Substitute("$0 $1 values ($2 nulls), $3 bytes raw", col_.num_values,
+                       col_.type->name(), col_.num_nulls, col_.raw_size()) << endl
+         << "Predicate: " << pred_.ToString() << endl << endl;
+    cout << StringPrintf("%-16s %-16s %12s %8s %14s %14s %14s\n",
+                         "encoding", "compression", "size (bytes)", "ratio",
+                         "encode (MB/s)", "decode (MB/s)", "predicate (MB/s)");
+    for (EncodingType encoding : kEncodings) {
+      const TypeEncodingInfo* info;
+      if (!TypeEncodingInfo::Get(col_.type, encoding, &info).ok()) {
+        continue;
+      }
+      for (CompressionType compression : kCompressions) {
+        RETURN_NOT_OK_PREPEND(RunOne(encoding, compression),
+                              Substitute("$0 $1", EncodingType_Name(encoding),
+                                         CompressionType_Name(compression)));
+      }
+    }
+    return Status::OK();
+  }
+
+ private:
+  Status RunOne(EncodingType encoding, CompressionType compression) {
+    // Write the values in batches, like flushes and compactions do.
+    unique_ptr<WritableBlock> sink;
+    RETURN_NOT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    const BlockId block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.storage_attributes.encoding = encoding;
+    opts.storage_attributes.compression = compression;
+    CFileWriter writer(opts, col_.type, col_schema_.is_nullable(), std::move(sink));
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(writer.Start());
+    for (size_t i = 0; i < col_.num_values; i += kBatchSize) {
+      const size_t n = std::min(kBatchSize, col_.num_values - i);
+      const uint8_t* cells = col_.cells.data() + i * col_.type->size();
+      if (col_schema_.is_nullable()) {
+        // The bitmap must start at a byte boundary, which batches of
+        // kBatchSize values do.
+        RETURN_NOT_OK(writer.AppendNullableEntries(col_.null_bitmap.data() + i / 8, cells, n));
+      } else {
+        RETURN_NOT_OK(writer.AppendEntries(cells, n));
+      }
+    }
+    RETURN_NOT_OK(writer.Finish());
+    sw.stop();
+    const double encode_secs = sw.elapsed().wall_seconds();
+    const size_t file_size = writer.written_size();
+
+    double decode_secs = 0;
+    double predicate_secs = 0;
+    for (int i = 0; i < FLAGS_num_iterations; i++) {
+      double secs;
+      RETURN_NOT_OK(ReadAll(block_id, nullptr, &secs));
+      decode_secs = i == 0 ? secs : std::min(decode_secs, secs);
+      RETURN_NOT_OK(ReadAll(block_id, &pred_, &secs));
+      predicate_secs = i == 0 ? secs : std::min(predicate_secs, secs);
+    }
+    RETURN_NOT_OK(fs_manager_->DeleteBlock(block_id));
+
+    const size_t raw_size = col_.raw_size();
+    cout << StringPrintf("%-16s %-16s %12zu %8.2f %14.1f %14.1f %14.1f\n",
+                         EncodingType_Name(encoding).c_str(),
+                         CompressionType_Name(compression).c_str(),
+                         file_size,
+                         static_cast<double>(raw_size) / file_size,
+                         MBPerSec(raw_size, encode_secs),
+                         MBPerSec(raw_size, decode_secs),
+                         MBPerSec(raw_size, predicate_secs));
+    return Status::OK();
+  }
+
+  // Reads all the values of the CFile 'block_id', evaluating 'pred' on them
+  // if not null, and returns the time it took in 'secs'.
+  Status ReadAll(const BlockId& block_id, const ColumnPredicate* pred, double* secs) {
+    unique_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    // Don't cache the blocks, so as to decompress them every time.
+    RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::DONT_CACHE_BLOCK));
+
+    Arena arena(32 * 1024);
+    faststring cells(kBatchSize * col_.type->size());
+    uint8_t nulls[BitmapSize(kBatchSize)];
+    SelectionVector sel(kBatchSize);
+    size_t num_selected = 0;
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(iter->SeekToOrdinal(0));
+    while (iter->HasNext()) {
+      size_t n = kBatchSize;
+      RETURN_NOT_OK(iter->PrepareBatch(&n));
+      ColumnBlock cb(col_.type, col_schema_.is_nullable() ? nulls : nullptr,
+                     cells.data(), n, &arena);
+      sel.Resize(n);
+      sel.SetAllTrue();
+      ColumnMaterializationContext ctx(0, pred, &cb, &sel);
+      RETURN_NOT_OK(iter->Scan(&ctx));
+      if (pred) {
+        if (ctx.DecoderEvalNotSupported()) {
+          pred->Evaluate(cb, &sel);
+        }
+        num_selected += sel.CountSelected();
+      }
+      RETURN_NOT_OK(iter->FinishBatch());
+      arena.Reset();
+    }
+    sw.stop();
+    *secs = sw.elapsed().wall_seconds();
+    VLOG(1) << "Selected " << num_selected << " values";
+    return Status::OK();
+  }
+
+  const Column& col_;
+  FsManager* const fs_manager_;
+  const ColumnSchema col_schema_;
+  faststring lower_;
+  faststring upper_;
+  ColumnPredicate pred_;
+};
+
+Status RunBenchmark() {
+  if (FLAGS_input_file.empty()) {
+    return Status::InvalidArgument("--input_file is required");
+  }
+  DataType type;
+  string type_name;
+  ToUpperCase(FLAGS_type, &type_name);
+  if (!DataType_Parse(type_name, &type)) {
+    return Status::InvalidArgument("unknown type", FLAGS_type);
+  }
+  Column col(GetTypeInfo(type));
+  RETURN_NOT_OK(LoadColumn(&col));
+
+  Env* env = Env::Default();
+  if (env->FileExists(FLAGS_fs_root)) {
+    return Status::AlreadyPresent("--fs_root already exists", FLAGS_fs_root);
+  }
+  FsManager fs_manager(env, FLAGS_fs_root);
+  RETURN_NOT_OK(fs_manager.CreateInitialFileSystemLayout());
+  Status s = fs_manager.Open();
+  if (s.ok()) {
+    s = CFileBench(col, &fs_manager).Run();
+  }
+  WARN_NOT_OK(env->DeleteRecursively(FLAGS_fs_root), "Could not delete --fs_root");
+  return s;
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = 1;
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::Status s = kudu::RunBenchmark();
+  if (!s.ok()) {
+    LOG(ERROR) << s.ToString();
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,477 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Runs a fixed suite of benchmarks against an external mini cluster, meant to
+// be run continuously to catch performance regressions:
+//
+//  - insert_throughput: rows/s inserted by --num_inserters concurrent clients.
+//  - scan_throughput: rows/s of a full scan of the table.
+//  - update_latency_p50/p99: latency of single-row updates written one at a
+//    time.
+//  - bootstrap_time: time taken by a restarted tablet server to bootstrap all
+//    of its tablets.
+//  - tablet_copy_time: time taken to copy a tablet to a new tablet server.
+//
+// The results are optionally written as JSON to --results_file, and compared
+// against a previous results file given with --baseline_file, in which case
+// the benchmark exits with a non-zero code if any result regressed by more
+// than --regression_threshold_pct. For example:
+//
+//   cluster_bench --results_file=/tmp/baseline.json
+//   <apply some change and rebuild>
+//   cluster_bench --baseline_file=/tmp/baseline.json
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <rapidjson/document.h>
+
+#include "kudu/client/client.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/schema.h"
+#include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_op.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/cluster_itest_util.h"
+#include "kudu/mini-cluster/external_mini_cluster.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonreader.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_string(cluster_root, "/tmp/cluster-bench",
+              "Directory in which the mini cluster stores its data. It must "
+              "not exist, and is deleted once the benchmark is done");
+DEFINE_int32(num_tablet_servers, 4,
+             "Number of tablet servers of the mini cluster. At least 4 are "
+             "needed to measure tablet copies");
+DEFINE_int32(num_tablets, 8, "Number of hash partitions of the table");
+DEFINE_int64(num_rows, 1000000, "Number of rows to insert");
+DEFINE_int32(num_inserters, 4, "Number of concurrent inserting clients");
+DEFINE_int32(num_updates, 2000, "Number of updates whose latency is measured");
+DEFINE_string(results_file, "",
+              "If set, path of the file to which the results are written as JSON");
+DEFINE_string(baseline_file, "",
+              "If set, path of a results file written by a previous run to "
+              "compare the results against");
+DEFINE_double(regression_threshold_pct, 10,
+              "Percentage by which a result may be worse than its baseline "
+              "before it's considered a regression");
+
+using kudu::client::KuduClient;
+using kudu::client::KuduColumnSchema;
+using kudu::client::KuduError;
+using kudu::client::KuduInsert;
+using kudu::client::KuduScanBatch;
+using kudu::client::KuduScanner;
+using kudu::client::KuduSchema;
+using kudu::client::KuduSchemaBuilder;
+using kudu::client::KuduSession;
+using kudu::client::KuduTable;
+using kudu::client::KuduTableCreator;
+using kudu::client::KuduUpdate;
+using kudu::client::sp::shared_ptr;
+using kudu::cluster::ExternalMiniCluster;
+using kudu::cluster::ExternalMiniClusterOptions;
+using kudu::itest::TServerDetails;
+using kudu::itest::TabletServerMap;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+const char* const kTableName = "cluster_bench";
+const MonoDelta kTimeout = MonoDelta::FromSeconds(120);
+
+struct BenchmarkResult {
+  string name;
+  double value;
+  string unit;
+  bool higher_is_better;
+};
+
+// Returns the first error of 'session', or 's' if there's none.
+Status FirstError(KuduSession* session, const Status& s) {
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  session->GetPendingErrors(&errors, nullptr);
+  if (!errors.empty()) {
+    return errors[0]->status();
+  }
+  return s;
+}
+
+class ClusterBenchmark {
+ public:
+  ClusterBenchmark() = default;
+
+  ~ClusterBenchmark() {
+    STLDeleteValues(&ts_map_);
+    if (cluster_) {
+      cluster_->Shutdown();
+      WARN_NOT_OK(Env::Default()->DeleteRecursively(FLAGS_cluster_root),
+                  "could not delete the cluster root");
+    }
+  }
+
+  Status Run(vector<BenchmarkResult>* results) {
+    RETURN_NOT_OK(SetUp());
+    RETURN_NOT_OK(MeasureInserts(results));
+    RETURN_NOT_OK(MeasureScans(results));
+    RETURN_NOT_OK(MeasureUpdates(results));
+    RETURN_NOT_OK(MeasureBootstrap(results));
+    return MeasureTabletCopy(results);
+  }
+
+ private:
+  Status SetUp() {
+    if (Env::Default()->FileExists(FLAGS_cluster_root)) {
+      return Status::AlreadyPresent("cluster root already exists", FLAGS_cluster_root);
+    }
+    ExternalMiniClusterOptions opts;
+    opts.cluster_root = FLAGS_cluster_root;
+    opts.num_tablet_servers = FLAGS_num_tablet_servers;
+    cluster_.reset(new ExternalMiniCluster(std::move(opts)));
+    RETURN_NOT_OK(cluster_->Start());
+    RETURN_NOT_OK(itest::CreateTabletServerMap(cluster_->master_proxy(),
+                                               cluster_->messenger(),
+                                               &ts_map_));
+    RETURN_NOT_OK(cluster_->CreateClient(nullptr, &client_));
+
+    KuduSchema schema;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+    b.AddColumn("int_val")->Type(KuduColumnSchema::INT32)->NotNull();
+    b.AddColumn("string_val")->Type(KuduColumnSchema::STRING)->NotNull();
+    RETURN_NOT_OK(b.Build(&schema));
+    unique_ptr<KuduTableCreator> creator(client_->NewTableCreator());
+    RETURN_NOT_OK(creator->table_name(kTableName)
+                  .schema(&schema)
+                  .add_hash_partitions({ "key" }, FLAGS_num_tablets)
+                  .num_replicas(3)
+                  .Create());
+    return client_->OpenTable(kTableName, &table_);
+  }
+
+  Status InsertRange(int64_t start_key, int64_t end_key) {
+    shared_ptr<KuduSession> session(client_->NewSession());
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+    RETURN_NOT_OK(session->SetTimeoutMillis(kTimeout.ToMilliseconds()));
+    for (int64_t key = start_key; key < end_key; key++) {
+      unique_ptr<KuduInsert> insert(table_->NewInsert());
+      KuduPartialRow* row = insert->mutable_row();
+      RETURN_NOT_OK(row->SetInt64(0, key));
+      RETURN_NOT_OK(row->SetInt32(1, static_cast<int32_t>(key)));
+      RETURN_NOT_OK(row->SetStringCopy(2, StringPrintf("row %016ld", key)));
+      RETURN_NOT_OK(session->Apply(insert.release()));
+    }
+    return FirstError(session.get(), session->Flush());
+  }
+
+  Status MeasureInserts(vector<BenchmarkResult>* results) {
+    LOG(INFO) << "Inserting " << FLAGS_num_rows << " rows";
+    const int num_threads = FLAGS_num_inserters;
+    vector<Status> statuses(num_threads);
+    vector<std::thread> threads;
+    Stopwatch sw;
+    sw.start();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i]() {
+          statuses[i] = InsertRange(FLAGS_num_rows * i / num_threads,
+                                    FLAGS_num_rows * (i + 1) / num_threads);
+        });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    sw.stop();
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK_PREPEND(s, "could not insert rows");
+    }
+    results->push_back({ "insert_throughput", FLAGS_num_rows / sw.elapsed().wall_seconds(),
+                         "rows/s", true });
+    return Status::OK();
+  }
+
+  Status MeasureScans(vector<BenchmarkResult>* results) {
+    LOG(INFO) << "Scanning the table";
+    KuduScanner scanner(table_.get());
+    RETURN_NOT_OK(scanner.SetTimeoutMillis(kTimeout.ToMilliseconds()));
+    RETURN_NOT_OK(scanner.SetProjectedColumnNames({ "key", "int_val", "string_val" }));
+    int64_t num_rows = 0;
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(scanner.Open());
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      RETURN_NOT_OK(scanner.NextBatch(&batch));
+      num_rows += batch.NumRows();
+    }
+    sw.stop();
+    if (num_rows != FLAGS_num_rows) {
+      return Status::Corruption(Substitute("scanned $0 rows but expected $1",
+                                           num_rows, FLAGS_num_rows));
+    }
+    results->push_back({ "scan_throughput", num_rows / sw.elapsed().wall_seconds(),
+                         "rows/s", true });
+    return Status::OK();
+  }
+
+  Status MeasureUpdates(vector<BenchmarkResult>* results) {
+    LOG(INFO) << "Updating " << FLAGS_num_updates << " rows";
+    shared_ptr<KuduSession> session(client_->NewSession());
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+    RETURN_NOT_OK(session->SetTimeoutMillis(kTimeout.ToMilliseconds()));
+    HdrHistogram hist(kTimeout.ToMicroseconds(), 2);
+    Random random(0);
+    for (int i = 0; i < FLAGS_num_updates; i++) {
+      unique_ptr<KuduUpdate> update(table_->NewUpdate());
+      KuduPartialRow* row = update->mutable_row();
+      RETURN_NOT_OK(row->SetInt64(0, random.Uniform64(FLAGS_num_rows)));
+      RETURN_NOT_OK(row->SetInt32(1, i));
+      MonoTime start = MonoTime::Now();
+      Status s = session->Apply(update.release());
+      if (!s.ok()) {
+        return FirstError(session.get(), s);
+      }
+      hist.Increment(std::min((MonoTime::Now() - start).ToMicroseconds(),
+                              kTimeout.ToMicroseconds()));
+    }
+    results->push_back({ "update_latency_p50", static_cast<double>(hist.ValueAtPercentile(50)),
+                         "us", false });
+    results->push_back({ "update_latency_p99", static_cast<double>(hist.ValueAtPercentile(99)),
+                         "us", false });
+    return Status::OK();
+  }
+
+  Status MeasureBootstrap(vector<BenchmarkResult>* results) {
+    auto* ets = cluster_->tablet_server(0);
+    TServerDetails* ts = FindOrDie(ts_map_, ets->uuid());
+    vector<string> tablet_ids;
+    RETURN_NOT_OK(itest::ListRunningTabletIds(ts, kTimeout, &tablet_ids));
+    LOG(INFO) << "Restarting a tablet server with " << tablet_ids.size() << " tablets";
+
+    ets->Shutdown();
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(ets->Restart());
+    RETURN_NOT_OK(itest::WaitForNumTabletsOnTS(ts, tablet_ids.size(), kTimeout,
+                                               nullptr, tablet::RUNNING));
+    sw.stop();
+    results->push_back({ "bootstrap_time", sw.elapsed().wall_seconds(), "s", false });
+    return Status::OK();
+  }
+
+  Status MeasureTabletCopy(vector<BenchmarkResult>* results) {
+    // Find a tablet and a tablet server which doesn't host a replica of it.
+    std::unordered_map<string, vector<string>> tablets_by_ts;
+    for (const auto& e : ts_map_) {
+      RETURN_NOT_OK(itest::ListRunningTabletIds(e.second, kTimeout, &tablets_by_ts[e.first]));
+    }
+    string tablet_id;
+    TServerDetails* dest = nullptr;
+    for (const auto& e : tablets_by_ts) {
+      for (const string& id : e.second) {
+        for (const auto& other : tablets_by_ts) {
+          if (std::find(other.second.begin(), other.second.end(), id) == other.second.end()) {
+            tablet_id = id;
+            dest = FindOrDie(ts_map_, other.first);
+            break;
+          }
+        }
+        if (dest) break;
+      }
+      if (dest) break;
+    }
+    if (!dest) {
+      return Status::IllegalState(
+          "every tablet server hosts every tablet: more tablet servers are needed "
+          "to measure tablet copies");
+    }
+    LOG(INFO) << "Copying tablet " << tablet_id << " to " << dest->uuid();
+
+    TServerDetails* leader;
+    RETURN_NOT_OK(itest::FindTabletLeader(ts_map_, tablet_id, kTimeout, &leader));
+    consensus::ConsensusStatePB cstate;
+    RETURN_NOT_OK(itest::GetConsensusState(leader, tablet_id, kTimeout,
+                                           consensus::EXCLUDE_HEALTH_REPORT, &cstate));
+    HostPort leader_hp;
+    RETURN_NOT_OK(HostPortFromPB(leader->registration.rpc_addresses(0), &leader_hp));
+
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(itest::StartTabletCopy(dest, tablet_id, leader->uuid(), leader_hp,
+                                         cstate.current_term(), kTimeout));
+    RETURN_NOT_OK(itest::WaitUntilTabletRunning(dest, tablet_id, kTimeout));
+    sw.stop();
+    results->push_back({ "tablet_copy_time", sw.elapsed().wall_seconds(), "s", false });
+    return Status::OK();
+  }
+
+  unique_ptr<ExternalMiniCluster> cluster_;
+  TabletServerMap ts_map_;
+  shared_ptr<KuduClient> client_;
+  shared_ptr<KuduTable> table_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClusterBenchmark);
+};
+
+Status WriteResults(const vector<BenchmarkResult>& results, const string& path) {
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::PRETTY);
+  jw.StartObject();
+  jw.String("results");
+  jw.StartArray();
+  for (const auto& r : results) {
+    jw.StartObject();
+    jw.String("name");
+    jw.String(r.name);
+    jw.String("value");
+    jw.Double(r.value);
+    jw.String("unit");
+    jw.String(r.unit);
+    jw.String("higher_is_better");
+    jw.Bool(r.higher_is_better);
+    jw.EndObject();
+  }
+  jw.EndArray();
+  jw.EndObject();
+  return WriteStringToFile(Env::Default(), out.str(), path);
+}
+
+Status ReadBaseline(const string& path, std::unordered_map<string, double>* baseline) {
+  faststring contents;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), path, &contents));
+  JsonReader r(contents.ToString());
+  RETURN_NOT_OK(r.Init());
+  vector<const rapidjson::Value*> results;
+  RETURN_NOT_OK(r.ExtractObjectArray(r.root(), "results", &results));
+  for (const auto* result : results) {
+    string name;
+    double value;
+    RETURN_NOT_OK(r.ExtractString(result, "name", &name));
+    RETURN_NOT_OK(r.ExtractDouble(result, "value", &value));
+    (*baseline)[name] = value;
+  }
+  return Status::OK();
+}
+
+// Prints how 'results' compare to the baseline, and returns the number of
+// results which regressed.
+int CompareToBaseline(const vector<BenchmarkResult>& results,
+                      const std::unordered_map<string, double>& baseline) {
+  int num_regressions = 0;
+  std::cout << StringPrintf("%-20s %14s %14s %9s\n", "name", "baseline", "value", "change");
+  for (const auto& r : results) {
+    const double* base = FindOrNull(baseline, r.name);
+    if (!base || *base == 0) {
+      std::cout << StringPrintf("%-20s %14s %14.2f %9s\n", r.name.c_str(), "-", r.value, "-");
+      continue;
+    }
+    const double change_pct = (r.value - *base) / *base * 100;
+    const double worse_pct = r.higher_is_better ? -change_pct : change_pct;
+    const bool regressed = worse_pct > FLAGS_regression_threshold_pct;
+    num_regressions += regressed;
+    std::cout << StringPrintf("%-20s %14.2f %14.2f %+8.1f%%%s\n",
+                              r.name.c_str(), *base, r.value, change_pct,
+                              regressed ? "  REGRESSION" : "");
+  }
+  return num_regressions;
+}
+
+} // anonymous namespace
+
+Status RunClusterBenchmark(int* num_regressions) {
+  // Read the baseline first so that a bad path doesn't waste a whole run.
+  std::unordered_map<string, double> baseline;
+  if (!FLAGS_baseline_file.empty()) {
+    RETURN_NOT_OK_PREPEND(ReadBaseline(FLAGS_baseline_file, &baseline),
+                          "could not read the baseline");
+  }
+
+  vector<BenchmarkResult> results;
+  {
+    ClusterBenchmark bench;
+    RETURN_NOT_OK(bench.Run(&results));
+  }
+  for (const auto& r : results) {
+    std::cout << StringPrintf("%-20s %14.2f %s\n", r.name.c_str(), r.value, r.unit.c_str());
+  }
+  if (!FLAGS_results_file.empty()) {
+    RETURN_NOT_OK_PREPEND(WriteResults(results, FLAGS_results_file),
+                          "could not write the results");
+  }
+  *num_regressions = 0;
+  if (!FLAGS_baseline_file.empty()) {
+    std::cout << std::endl;
+    *num_regressions = CompareToBaseline(results, baseline);
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = 1;
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  int num_regressions;
+  kudu::Status s = kudu::RunClusterBenchmark(&num_regressions);
+  if (!s.ok()) {
+    LOG(ERROR) << s.ToString();
+    return 1;
+  }
+  if (num_regressions > 0) {
+    LOG(ERROR) << num_regressions << " result(s) regressed by more than "
+               << FLAGS_regression_threshold_pct << "%";
+    return 2;
+  }
+  return 0;
+}
@@ -32,6 +32,7 @@
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
+#include "kudu/common/column_predicate_kernels.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/rowblock.h"
@@ -204,6 +205,7 @@ Status BinaryDictBlockBuilder::GetLastKey(void* key_void) const {
 BinaryDictBlockDecoder::BinaryDictBlockDecoder(Slice slice, CFileIterator* iter)
     : data_(slice),
       parsed_(false),
+      zero_copy_(iter->zero_copy_strings()),
       dict_decoder_(iter->GetDictDecoder()),
       parent_cfile_iter_(iter) {
 }
@@ -230,7 +232,7 @@ Status BinaryDictBlockDecoder::ParseHeader() {
     if (mode_ != kPlainBinaryMode) {
       return Status::Corruption("Unrecognized Dictionary encoded data block header");
     }
-    data_decoder_.reset(new BinaryPlainBlockDecoder(content));
+    data_decoder_.reset(new BinaryPlainBlockDecoder(content, zero_copy_));
   }
 
   RETURN_NOT_OK(data_decoder_->ParseHeader());
@@ -302,6 +304,24 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
   d_bptr->CopyNextValuesToArray(n, codeword_buf_.data());
   Slice* out = reinterpret_cast<Slice*>(dst->data());
   Arena* out_arena = dst->arena();
+
+  if (predicate_kernels::GetKernelArch() != predicate_kernels::KernelArch::SCALAR) {
+    // Evaluate all of the codewords up front, then only copy out the strings
+    // of the rows that are still selected.
+    const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
+    predicate_kernels::EvaluateDictionaryCodes(codewords, *n, codewords_matching_pred->bitmap(),
+                                               sel->mutable_bitmap(), sel->row_offset());
+    size_t i = 0;
+    while (i < *n) {
+      i += sel->CountRun(i, *n - i, false);
+      size_t run_end = i + sel->CountRun(i, *n - i, true);
+      for (; i < run_end; i++) {
+        OutputString(dict_decoder_->string_at_index(codewords[i]), &out[i], out_arena);
+      }
+    }
+    return Status::OK();
+  }
+
   for (size_t i = 0; i < *n; i++, out++) {
     // Check with the SelectionVectorView to see whether the data has already
     // been cleared, in which case we can skip evaluation.
@@ -311,7 +331,7 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
     if (BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
       // Row is included in predicate, copy data to block.
-      CHECK(out_arena->RelocateSlice(dict_decoder_->string_at_index(codeword), out));
+      OutputString(dict_decoder_->string_at_index(codeword), out, out_arena);
     } else {
       // Mark that the row will not be returned.
       sel->ClearBit(i);
@@ -339,12 +359,45 @@ Status BinaryDictBlockDecoder::CopyNextDecodeStrings(size_t* n, ColumnDataView*
   for (int i = 0; i < *n; i++) {
     uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
     Slice elem = dict_decoder_->string_at_index(codeword);
-    CHECK(out_arena->RelocateSlice(elem, out));
+    OutputString(elem, out, out_arena);
     out++;
   }
   return Status::OK();
 }
 
+Status BinaryDictBlockDecoder::CopySelectedValues(size_t* n,
+                                                  const SelectionVectorView& sel,
+                                                  ColumnDataView* dst) {
+  if (mode_ == kPlainBinaryMode) {
+    return data_decoder_->CopySelectedValues(n, sel, dst);
+  }
+  DCHECK(parsed_);
+  DCHECK_LE(*n, dst->nrows());
+  DCHECK_EQ(dst->stride(), sizeof(Slice));
+
+  // Copying the codewords is cheap: only the strings of the selected rows are
+  // copied into the destination arena.
+  codeword_buf_.resize((*n)*sizeof(uint32_t));
+  BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
+  RETURN_NOT_OK(d_bptr->CopyNextValuesToArray(n, codeword_buf_.data()));
+  const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
+  Slice* out = reinterpret_cast<Slice*>(dst->data());
+  Arena* out_arena = dst->arena();
+
+  size_t i = 0;
+  while (i < *n) {
+    size_t skip_end = i + sel.CountRun(i, *n - i, false);
+    for (; i < skip_end; i++) {
+      out[i] = Slice();
+    }
+    size_t run_end = i + sel.CountRun(i, *n - i, true);
+    for (; i < run_end; i++) {
+      OutputString(dict_decoder_->string_at_index(codewords[i]), &out[i], out_arena);
+    }
+  }
+  return Status::OK();
+}
+
 Status BinaryDictBlockDecoder::CopyNextValues(size_t* n, ColumnDataView* dst) {
   if (mode_ == kCodeWordMode) {
     return CopyNextDecodeStrings(n, dst);
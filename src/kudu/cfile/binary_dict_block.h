@@ -150,6 +150,9 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
                          ColumnMaterializationContext* ctx,
                          SelectionVectorView* sel,
                          ColumnDataView* dst) override;
+  Status CopySelectedValues(size_t* n,
+                            const SelectionVectorView& sel,
+                            ColumnDataView* dst) override;
 
   virtual bool HasNext() const OVERRIDE {
     return data_decoder_->HasNext();
@@ -172,9 +175,22 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
  private:
   Status CopyNextDecodeStrings(size_t* n, ColumnDataView* dst);
 
+  // Sets '*out' to the dictionary string 'elem', copying it into 'arena'
+  // unless the parent iterator hands out zero-copy strings.
+  void OutputString(const Slice& elem, Slice* out, Arena* arena) const {
+    if (zero_copy_) {
+      *out = elem;
+    } else {
+      CHECK(arena->RelocateSlice(elem, out));
+    }
+  }
+
   Slice data_;
   bool parsed_;
 
+  // See CFileIterator::zero_copy_strings().
+  const bool zero_copy_;
+
   // Dictionary block decoder
   BinaryPlainBlockDecoder* dict_decoder_;
 
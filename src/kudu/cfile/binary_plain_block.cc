@@ -158,8 +158,9 @@ Status BinaryPlainBlockBuilder::GetLastKey(void *key_void) const {
 // Decoding
 ////////////////////////////////////////////////////////////
 
-BinaryPlainBlockDecoder::BinaryPlainBlockDecoder(Slice slice)
+BinaryPlainBlockDecoder::BinaryPlainBlockDecoder(Slice slice, bool zero_copy)
     : data_(slice),
+      zero_copy_(zero_copy),
       parsed_(false),
       num_elems_(0),
       ordinal_pos_base_(0),
@@ -308,7 +309,7 @@ Status BinaryPlainBlockDecoder::HandleBatch(size_t* n, ColumnDataView* dst, Cell
 
 Status BinaryPlainBlockDecoder::CopyNextValues(size_t* n, ColumnDataView* dst) {
   return HandleBatch(n, dst, [&](size_t i, Slice elem, Slice* out, Arena* out_arena) {
-    CHECK(out_arena->RelocateSlice(elem, out));
+    OutputString(elem, out, out_arena);
   });
 }
 
@@ -321,7 +322,7 @@ Status BinaryPlainBlockDecoder::CopyNextAndEval(size_t* n,
     if (!sel->TestBit(i)) {
       return;
     } else if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void*>(&elem))) {
-      CHECK(out_arena->RelocateSlice(elem, out));
+      OutputString(elem, out, out_arena);
     } else {
       sel->ClearBit(i);
     }
@@ -42,6 +42,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/gutil/port.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -106,7 +107,11 @@ class BinaryPlainBlockBuilder final : public BlockBuilder {
 
 class BinaryPlainBlockDecoder final : public BlockDecoder {
  public:
-  explicit BinaryPlainBlockDecoder(Slice slice);
+  // If 'zero_copy' is true, the decoded cells point into 'slice' rather than
+  // into the destination arena, and the caller must keep the memory of
+  // 'slice' alive for as long as the cells are used (see
+  // Arena::RetainReference()).
+  explicit BinaryPlainBlockDecoder(Slice slice, bool zero_copy = false);
 
   virtual Status ParseHeader() OVERRIDE;
   virtual void SeekToPositionInBlock(uint pos) OVERRIDE;
@@ -155,6 +160,16 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
   template <typename CellHandler>
   Status HandleBatch(size_t* n, ColumnDataView* dst, CellHandler c);
 
+  // Sets '*out' to the string 'elem', copying it into 'arena' unless the
+  // decoder is zero-copy.
+  void OutputString(const Slice& elem, Slice* out, Arena* arena) const {
+    if (zero_copy_) {
+      *out = elem;
+    } else {
+      CHECK(arena->RelocateSlice(elem, out));
+    }
+  }
+
   // Return the offset within 'data_' where the string value with index 'idx'
   // can be found.
   uint32_t offset(int idx) const {
@@ -165,6 +180,7 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
   }
 
   Slice data_;
+  const bool zero_copy_;
   bool parsed_;
 
   // A buffer for an array of 32-bit integers for the offsets of the underlying
@@ -66,6 +66,27 @@ static const uint8_t *DecodeEntryLengths(
   return ptr;
 }
 
+// Compares 'val' to 'target', given that their first 'offset' bytes are
+// already known to be equal. Sets '*match_len' to the length of the prefix
+// the two have in common.
+static int CompareFromOffset(const Slice &val, const Slice &target,
+                             size_t offset, size_t *match_len) {
+  size_t min_len = std::min(val.size(), target.size());
+  DCHECK_LE(offset, min_len);
+  size_t i = offset;
+  while (i < min_len && val[i] == target[i]) {
+    i++;
+  }
+  *match_len = i;
+  if (i < min_len) {
+    return val[i] < target[i] ? -1 : 1;
+  }
+  if (val.size() == target.size()) {
+    return 0;
+  }
+  return val.size() < target.size() ? -1 : 1;
+}
+
 ////////////////////////////////////////////////////////////
 // StringPrefixBlockBuilder encoding
 ////////////////////////////////////////////////////////////
@@ -377,24 +398,32 @@ Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
     }
   }
 
-  // Linear search (within restart block) for first key >= target
+  // Linear search (within restart block) for first key >= target.
+  //
+  // Rather than comparing each reconstructed value against 'target' from
+  // its first byte, track how long a prefix the current value shares with
+  // 'target'. An entry that keeps more of the previous value than that
+  // compares to 'target' just like the previous value did, and any other
+  // entry only needs comparing from its shared length onwards.
   SeekToRestartPoint(left);
-
-  while (true) {
+  size_t match_len;
+  int cmp = CompareFromOffset(Slice(cur_val_), target, 0, &match_len);
+  while (cmp < 0) {
 #ifndef NDEBUG
     VLOG(3) << "loop iter:\n"
             << "cur_idx = " << cur_idx_ << "\n"
             << "target  =" << KUDU_REDACT(target.ToDebugString()) << "\n"
             << "cur_val_=" << KUDU_REDACT(Slice(cur_val_).ToDebugString());
 #endif
-    int cmp = Slice(cur_val_).compare(target);
-    if (cmp >= 0) {
-      *exact_match = (cmp == 0);
-      return Status::OK();
-    }
-    RETURN_NOT_OK(ParseNextValue());
+    uint32_t shared;
+    RETURN_NOT_OK(ParseNextValue(&shared));
     cur_idx_++;
+    if (shared <= match_len) {
+      cmp = CompareFromOffset(Slice(cur_val_), target, shared, &match_len);
+    }
   }
+  *exact_match = (cmp == 0);
+  return Status::OK();
 }
 
 Status BinaryPrefixBlockDecoder::CopyNextValues(size_t *n, ColumnDataView *dst) {
@@ -412,38 +441,68 @@ Status BinaryPrefixBlockDecoder::CopyNextValues(size_t *n, ColumnDataView *dst)
     return Status::OK();
   }
 
-  size_t i = 0;
   size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
 
-  // Grab the first row, which we've cached from the last call or seek.
-  const uint8_t *out_data = out_arena->AddSlice(cur_val_);
-  if (PREDICT_FALSE(out_data == nullptr)) {
+  // The batch is decoded in two passes over the entry headers. The first
+  // validates each entry and sums the bytes the batch needs, so that the
+  // second can reconstruct every value into one arena allocation. An entry
+  // that adds nothing to the value before it is a prefix of that value, and
+  // its slice simply points into the earlier one.
+  size_t total_size = cur_val_.size();
+  uint32_t prev_len = cur_val_.size();
+  const uint8_t *ptr = next_ptr_;
+  for (size_t i = 1; i < max_fetch; i++) {
+    if (PREDICT_FALSE(ptr == reinterpret_cast<const uint8_t *>(restarts_))) {
+      return Status::NotFound("Trying to parse past end of array");
+    }
+    uint32_t shared, non_shared;
+    const uint8_t *val_delta = DecodeEntryLengths(ptr, &shared, &non_shared);
+    if (PREDICT_FALSE(val_delta == nullptr || shared > prev_len)) {
+      return Status::Corruption(
+        StringPrintf("Could not decode value length data at idx %d",
+                     static_cast<int>(cur_idx_ + i)));
+    }
+    if (non_shared > 0) {
+      total_size += shared + non_shared;
+    }
+    prev_len = shared + non_shared;
+    ptr = val_delta + non_shared;
+  }
+
+  uint8_t *buf = reinterpret_cast<uint8_t *>(out_arena->AllocateBytes(total_size));
+  if (PREDICT_FALSE(buf == nullptr && total_size > 0)) {
     return Status::IOError(
       "Out of memory",
       StringPrintf("Failed to allocate %d bytes in output arena",
-                   static_cast<int>(cur_val_.size())));
+                   static_cast<int>(total_size)));
   }
 
-  // Put a slice to it in the output array
-  Slice prev_val(out_data, cur_val_.size());
+  // Grab the first row, which we've cached from the last call or seek.
+  strings::memcpy_inlined(buf, cur_val_.data(), cur_val_.size());
+  Slice prev_val(buf, cur_val_.size());
+  buf += cur_val_.size();
   *out++ = prev_val;
-  i++;
-  cur_idx_++;
-
-  #ifndef NDEBUG
-  cur_val_.assign_copy("INVALID");
-  #endif
 
   // Now iterate pulling more rows from the block, decoding relative
-  // to the previous value.
-
-  for (; i < max_fetch; i++) {
-    Slice copied;
-    RETURN_NOT_OK(ParseNextIntoArena(prev_val, dst->arena(), &copied));
-    *out++  = copied;
-    prev_val = copied;
-    cur_idx_++;
+  // to the previous value. The entries were validated above.
+  for (size_t i = 1; i < max_fetch; i++) {
+    uint32_t shared, non_shared;
+    const uint8_t *val_delta = DecodeEntryLengths(next_ptr_, &shared, &non_shared);
+    DCHECK(val_delta != nullptr);
+    Slice val;
+    if (non_shared == 0) {
+      val = Slice(prev_val.data(), shared);
+    } else {
+      strings::memcpy_inlined(buf, prev_val.data(), shared);
+      strings::memcpy_inlined(buf + shared, val_delta, non_shared);
+      val = Slice(buf, shared + non_shared);
+      buf += shared + non_shared;
+    }
+    *out++ = val;
+    prev_val = val;
+    next_ptr_ = val_delta + non_shared;
   }
+  cur_idx_ += max_fetch;
 
   // Fetch the next value to be returned, using the last value we fetched
   // for the delta.
@@ -454,7 +513,7 @@ Status BinaryPrefixBlockDecoder::CopyNextValues(size_t *n, ColumnDataView *dst)
     next_ptr_ = nullptr;
   }
 
-  *n = i;
+  *n = max_fetch;
   return Status::OK();
 }
 
@@ -484,7 +543,16 @@ Status BinaryPrefixBlockDecoder::SkipForward(int n) {
     return Status::OK();
   }
 
-  // Probably a faster way to implement this using restarts,
+  // If the target lies past the next restart point, jump straight to the
+  // last restart point at or before it rather than decoding every entry
+  // in between.
+  uint32_t target_idx = cur_idx_ + n;
+  uint32_t target_restart = target_idx / restart_interval_;
+  if (target_restart > cur_idx_ / restart_interval_) {
+    SeekToRestartPoint(target_restart);
+    n = target_idx - cur_idx_;
+  }
+
   for (int i = 0; i < n; i++) {
     RETURN_NOT_OK(ParseNextValue());
     cur_idx_++;
@@ -502,34 +570,12 @@ Status BinaryPrefixBlockDecoder::CheckNextPtr() {
   return Status::OK();
 }
 
-inline Status BinaryPrefixBlockDecoder::ParseNextIntoArena(Slice prev_val,
-                                                           Arena *dst,
-                                                           Slice *copied) {
-  RETURN_NOT_OK(CheckNextPtr());
-  uint32_t shared, non_shared;
-  const uint8_t *val_delta = DecodeEntryLengths(next_ptr_, &shared, &non_shared);
-  if (val_delta == nullptr) {
-    return Status::Corruption(
-      StringPrintf("Could not decode value length data at idx %d",
-                   cur_idx_));
-  }
-
-  DCHECK_LE(shared, prev_val.size())
-    << "Spcified longer shared amount than previous key length";
-
-  uint8_t *buf = reinterpret_cast<uint8_t *>(dst->AllocateBytes(non_shared + shared));
-  strings::memcpy_inlined(buf, prev_val.data(), shared);
-  strings::memcpy_inlined(buf + shared, val_delta, non_shared);
-
-  *copied = Slice(buf, non_shared + shared);
-  next_ptr_ = val_delta + non_shared;
-  return Status::OK();
-}
-
 // Parses the data pointed to by next_ptr_ and stores it in cur_val_
 // Advances next_ptr_ to point to the following values.
 // Does not modify cur_idx_
-inline Status BinaryPrefixBlockDecoder::ParseNextValue() {
+// If 'shared_len' is non-NULL, sets it to the number of bytes the new value
+// kept from the previous one.
+inline Status BinaryPrefixBlockDecoder::ParseNextValue(uint32_t *shared_len) {
   RETURN_NOT_OK(CheckNextPtr());
 
   uint32_t shared, non_shared;
@@ -551,6 +597,9 @@ inline Status BinaryPrefixBlockDecoder::ParseNextValue() {
   DCHECK_EQ(cur_val_.size(), shared + non_shared);
 
   next_ptr_ = val_delta + non_shared;
+  if (shared_len != nullptr) {
+    *shared_len = shared;
+  }
   return Status::OK();
 }
 
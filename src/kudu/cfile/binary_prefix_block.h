@@ -34,7 +34,6 @@
 
 namespace kudu {
 
-class Arena;
 class ColumnDataView;
 
 namespace cfile {
@@ -129,8 +128,7 @@ class BinaryPrefixBlockDecoder final : public BlockDecoder {
  private:
   Status SkipForward(int n);
   Status CheckNextPtr();
-  Status ParseNextValue();
-  Status ParseNextIntoArena(Slice prev_val, Arena *dst, Slice *copied);
+  Status ParseNextValue(uint32_t *shared_len = nullptr);
 
   const uint8_t *DecodeEntryLengths(const uint8_t *ptr,
                            uint32_t *shared,
@@ -0,0 +1,158 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/bitmapfile.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/roaring_bitmap.h"
+#include "kudu/util/slice.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace cfile {
+
+using fs::BlockCreationTransaction;
+using fs::WritableBlock;
+
+namespace {
+
+// The CFile metadata entry identifying bitmap files.
+const char* const kBitmapFileMetaEntryName = "bitmap_file";
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// Writer
+////////////////////////////////////////////////////////////
+
+BitmapFileWriter::BitmapFileWriter(unique_ptr<WritableBlock> block) {
+  WriterOptions opts;
+  // The file is only ever looked up by value.
+  opts.write_validx = true;
+  opts.write_posidx = false;
+  opts.storage_attributes.encoding = PREFIX_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  writer_.reset(new CFileWriter(std::move(opts), GetTypeInfo(BINARY), false, std::move(block)));
+}
+
+BitmapFileWriter::~BitmapFileWriter() {
+}
+
+Status BitmapFileWriter::Start() {
+  writer_->AddMetadataPair(kBitmapFileMetaEntryName, "1");
+  return writer_->Start();
+}
+
+Status BitmapFileWriter::AppendBitmap(const Slice& encoded_value, const RoaringBitmap& rows) {
+  entry_.clear();
+  entry_.append(encoded_value.data(), encoded_value.size());
+  rows.Serialize(&entry_);
+  Slice entry(entry_);
+  return writer_->AppendEntries(&entry, 1);
+}
+
+Status BitmapFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
+  return writer_->FinishAndReleaseBlock(transaction);
+}
+
+size_t BitmapFileWriter::written_size() const {
+  return writer_->written_size();
+}
+
+////////////////////////////////////////////////////////////
+// Reader
+////////////////////////////////////////////////////////////
+
+BitmapFileReader::BitmapFileReader(CFileReader* reader)
+    : reader_(reader) {
+}
+
+bool BitmapFileReader::IsBitmapFile(const CFileReader& reader) {
+  string unused;
+  return reader.GetMetadataEntry(kBitmapFileMetaEntryName, &unused);
+}
+
+Status BitmapFileReader::UnionBitmap(const Slice& encoded_value, RoaringBitmap* rows) const {
+  rowid_t num_values;
+  RETURN_NOT_OK(reader_->CountRows(&num_values));
+  if (num_values == 0) {
+    return Status::OK();
+  }
+
+  CFileIterator* iter_ptr;
+  RETURN_NOT_OK(reader_->NewIterator(&iter_ptr, CFileReader::CACHE_BLOCK));
+  unique_ptr<CFileIterator> iter(iter_ptr);
+
+  // The entries are the "keys" of the file. The seek key takes ownership of
+  // its own copy of the value.
+  faststring key_buf;
+  key_buf.append(encoded_value.data(), encoded_value.size());
+  vector<const void*> raw_keys = { &encoded_value };
+  EncodedKey key(&key_buf, &raw_keys, 1);
+  bool exact;
+  Status s = iter->SeekAtOrAfter(key, &exact);
+  if (s.IsNotFound()) {
+    // Every value sorts before 'encoded_value'.
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+
+  // Since no encoded value is a prefix of another, only the entry of
+  // 'encoded_value' itself can start with it.
+  Arena arena(1024);
+  Slice entry;
+  ColumnBlock block(GetTypeInfo(BINARY), nullptr, &entry, 1, &arena);
+  SelectionVector sel(1);
+  ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+  ctx.SetDecoderEvalNotSupported();
+  size_t n = 1;
+  RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+  if (n != 1 || !entry.starts_with(encoded_value)) {
+    return Status::OK();
+  }
+
+  entry.remove_prefix(encoded_value.size());
+  RoaringBitmap bitmap;
+  RETURN_NOT_OK_PREPEND(bitmap.Deserialize(&entry), reader_->ToString());
+  if (!entry.empty()) {
+    return Status::Corruption("trailing data after bitmap", reader_->ToString());
+  }
+  rows->UnionWith(bitmap);
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RoaringBitmap;
+class Slice;
+
+namespace fs {
+class BlockCreationTransaction;
+class WritableBlock;
+}
+
+namespace cfile {
+
+class CFileReader;
+class CFileWriter;
+
+// A bitmap file maps each distinct value of a column to the compressed bitmap
+// of the ordinals of the rows holding it. It suits columns with few distinct
+// values, for which the bitmaps of several values or columns can be combined
+// without reading the column data.
+//
+// It is stored as a BINARY CFile with a value index. Each entry is a value,
+// encoded such that no value is a prefix of another, followed by its
+// serialized RoaringBitmap. The values are appended in ascending order.
+class BitmapFileWriter {
+ public:
+  explicit BitmapFileWriter(std::unique_ptr<fs::WritableBlock> block);
+  ~BitmapFileWriter();
+
+  Status Start();
+
+  // Appends the bitmap of the rows holding the value whose prefix-free
+  // encoding is 'encoded_value'. Values must be appended in ascending order.
+  Status AppendBitmap(const Slice& encoded_value, const RoaringBitmap& rows);
+
+  // Close the bitmap file's CFile, finalizing the underlying block and
+  // releasing it to 'transaction'.
+  Status FinishAndReleaseBlock(fs::BlockCreationTransaction* transaction);
+
+  // Estimate the amount of data already written to this file.
+  size_t written_size() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BitmapFileWriter);
+
+  std::unique_ptr<CFileWriter> writer_;
+
+  // Scratch buffer for the entry being appended.
+  faststring entry_;
+};
+
+// Reads the bitmaps of a bitmap file through an initialized CFileReader,
+// which must outlive it. Safe for concurrent use, as long as the underlying
+// reader is.
+class BitmapFileReader {
+ public:
+  explicit BitmapFileReader(CFileReader* reader);
+
+  // Returns true if the CFile read by 'reader', which must be initialized,
+  // was written by a BitmapFileWriter.
+  static bool IsBitmapFile(const CFileReader& reader);
+
+  // Unions into 'rows' the bitmap of the value whose prefix-free encoding is
+  // 'encoded_value', if the file holds it.
+  Status UnionBitmap(const Slice& encoded_value, RoaringBitmap* rows) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BitmapFileReader);
+
+  CFileReader* const reader_;
+};
+
+} // namespace cfile
+} // namespace kudu
@@ -18,14 +18,34 @@
 #include <cstring>
 #include <memory>
 #include <ostream>
+#include <string>
+#include <vector>
 
+#include <gflags/gflags.h>
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/block_cache.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(block_cache_ssd_admit_all);
+DECLARE_double(block_cache_metadata_capacity_ratio);
+DECLARE_int64(block_cache_ssd_capacity_mb);
+DECLARE_string(block_cache_ssd_path);
+
+METRIC_DECLARE_counter(block_cache_data_misses);
+METRIC_DECLARE_counter(block_cache_index_hits);
+METRIC_DECLARE_counter(block_cache_index_misses);
+METRIC_DECLARE_counter(block_cache_ssd_hits);
+METRIC_DECLARE_entity(server);
 
 namespace kudu {
 namespace cfile {
@@ -77,6 +97,111 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+// Inserts a block of 'size' bytes at 'offset' of file 1234.
+static void InsertBlock(BlockCache* cache, uint64_t offset, size_t size,
+                        BlockCache::BlockType type) {
+  BlockCache::PendingEntry entry = cache->Allocate(
+      BlockCache::CacheKey(BlockCache::FileId(1234), offset), size, type);
+  ASSERT_TRUE(entry.valid());
+  memset(entry.val_ptr(), 0, size);
+  BlockCacheHandle handle;
+  cache->Insert(&entry, &handle);
+}
+
+static bool LookupBlock(BlockCache* cache, uint64_t offset, BlockCache::BlockType type) {
+  BlockCacheHandle handle;
+  return cache->Lookup(BlockCache::CacheKey(BlockCache::FileId(1234), offset),
+                       Cache::EXPECT_IN_CACHE, &handle, type);
+}
+
+// Test that data blocks can't evict the blocks in the reserved metadata pool.
+TEST(TestBlockCache, TestMetadataCapacity) {
+  if (BlockCache::GetConfiguredCacheTypeOrDie() != DRAM_CACHE) {
+    LOG(INFO) << "Skipping test: the metadata pool requires the DRAM block cache";
+    return;
+  }
+  google::FlagSaver saver;
+  FLAGS_block_cache_metadata_capacity_ratio = 0.25;
+  const size_t kCapacity = 16 * 1024 * 1024;
+  const size_t kBlockSize = 64 * 1024;
+  BlockCache cache(kCapacity);
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  cache.StartInstrumentation(entity);
+
+  NO_FATALS(InsertBlock(&cache, 0, kBlockSize, BlockCache::INDEX_BLOCK));
+  // Churn through twice the capacity of data blocks.
+  const int kNumDataBlocks = 2 * kCapacity / kBlockSize;
+  for (int i = 1; i <= kNumDataBlocks; i++) {
+    NO_FATALS(InsertBlock(&cache, i * kBlockSize, kBlockSize, BlockCache::DATA_BLOCK));
+  }
+  ASSERT_TRUE(LookupBlock(&cache, 0, BlockCache::INDEX_BLOCK));
+  ASSERT_FALSE(LookupBlock(&cache, kBlockSize, BlockCache::DATA_BLOCK));
+  ASSERT_TRUE(LookupBlock(&cache, kNumDataBlocks * kBlockSize, BlockCache::DATA_BLOCK));
+  ASSERT_FALSE(LookupBlock(&cache, 1, BlockCache::INDEX_BLOCK));
+
+  ASSERT_EQ(1, METRIC_block_cache_index_hits.Instantiate(entity)->value());
+  ASSERT_EQ(1, METRIC_block_cache_index_misses.Instantiate(entity)->value());
+  ASSERT_EQ(1, METRIC_block_cache_data_misses.Instantiate(entity)->value());
+}
+
+// Test that the tracked blocks are those still in the cache.
+TEST(TestBlockCache, TestTrackedBlocks) {
+  const size_t kCapacity = 16 * 1024 * 1024;
+  const size_t kBlockSize = 64 * 1024;
+  BlockCache cache(kCapacity);
+  cache.StartTrackingBlocks();
+
+  const int kNumBlocks = 2 * kCapacity / kBlockSize;
+  for (int i = kNumBlocks - 1; i >= 0; i--) {
+    NO_FATALS(InsertBlock(&cache, i * kBlockSize, kBlockSize, BlockCache::DATA_BLOCK));
+    cache.RecordBlockRead(BlockCache::CacheKey(BlockCache::FileId(1234), i * kBlockSize),
+                          kBlockSize / 2, BlockCache::DATA_BLOCK);
+  }
+  std::vector<BlockCache::TrackedBlock> blocks;
+  cache.GetTrackedBlocks(&blocks);
+  ASSERT_GT(blocks.size(), 0);
+  ASSERT_LT(blocks.size(), kNumBlocks);
+  for (int i = 0; i < blocks.size(); i++) {
+    SCOPED_TRACE(i);
+    uint64_t offset = blocks[i].key.offset_;
+    if (i > 0) {
+      ASSERT_LT(blocks[i - 1].key.offset_, offset);
+    }
+    ASSERT_EQ(kBlockSize / 2, blocks[i].disk_size);
+    ASSERT_TRUE(LookupBlock(&cache, offset, BlockCache::DATA_BLOCK));
+  }
+}
+
+// Test that the blocks evicted from memory are found in the SSD tier.
+TEST(TestBlockCache, TestSsdTier) {
+  if (BlockCache::GetConfiguredCacheTypeOrDie() != DRAM_CACHE) {
+    LOG(INFO) << "Skipping test: the SSD tier requires the DRAM block cache";
+    return;
+  }
+  google::FlagSaver saver;
+  FLAGS_block_cache_ssd_path = JoinPathSegments(GetTestDataDirectory(), "ssd_cache");
+  FLAGS_block_cache_ssd_capacity_mb = 64;
+  FLAGS_block_cache_ssd_admit_all = true;
+  const size_t kCapacity = 16 * 1024 * 1024;
+  const size_t kBlockSize = 64 * 1024;
+  BlockCache cache(kCapacity);
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  cache.StartInstrumentation(entity);
+
+  const int kNumBlocks = 2 * kCapacity / kBlockSize;
+  for (int i = 0; i < kNumBlocks; i++) {
+    NO_FATALS(InsertBlock(&cache, i * kBlockSize, kBlockSize, BlockCache::DATA_BLOCK));
+  }
+  // The evicted block is written in the background, then promoted back to
+  // memory by the lookup.
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_TRUE(LookupBlock(&cache, 0, BlockCache::DATA_BLOCK));
+    });
+  ASSERT_EQ(1, METRIC_block_cache_ssd_hits.Instantiate(entity)->value());
+  ASSERT_FALSE(LookupBlock(&cache, 1, BlockCache::DATA_BLOCK));
+}
 
 } // namespace cfile
 } // namespace kudu
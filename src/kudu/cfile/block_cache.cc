@@ -15,10 +15,16 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -26,9 +32,16 @@
 #include "kudu/cfile/block_cache.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/cache_metrics.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/ssd_cache.h"
+#include "kudu/util/status.h"
 #include "kudu/util/string_case.h"
 
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
@@ -41,6 +54,57 @@ DEFINE_string(block_cache_type, "DRAM",
               "in a memory-mapped file using the NVML library.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which policy the block cache uses to choose the blocks to evict. "
+              "Valid choices are 'LRU', 'TINYLFU' or 'CLOCK'. 'TINYLFU' only "
+              "caches a new block in place of blocks which have been read less "
+              "often, so that large scans don't evict frequently read index and "
+              "bloom blocks. 'CLOCK' approximates LRU, but concurrent lookups "
+              "don't contend on a lock. 'TINYLFU' and 'CLOCK' are only supported "
+              "by the DRAM block cache.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+DEFINE_double(block_cache_metadata_capacity_ratio, 0,
+              "Fraction of the block cache capacity which is reserved for index, "
+              "bloom filter and dictionary blocks. These blocks are small and read "
+              "by every lookup, so keeping them apart from data blocks prevents "
+              "large scans from evicting them. If 0, all blocks share the same "
+              "capacity. Only supported by the DRAM block cache.");
+TAG_FLAG(block_cache_metadata_capacity_ratio, experimental);
+
+static bool ValidateMetadataCapacityRatio(const char* flagname, double value) {
+  if (value < 0 || value >= 1) {
+    LOG(ERROR) << flagname << " must be at least 0 and less than 1, value "
+               << value << " is invalid";
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(block_cache_metadata_capacity_ratio, &ValidateMetadataCapacityRatio);
+
+DEFINE_string(block_cache_ssd_path, "",
+              "Path of a file, preferably on a local SSD, in which to keep the blocks "
+              "evicted from the block cache. Blocks found there are read back into "
+              "memory, and the file's content survives restarts. If empty, evicted "
+              "blocks are dropped. Only supported by the DRAM block cache.");
+TAG_FLAG(block_cache_ssd_path, experimental);
+
+DEFINE_int64(block_cache_ssd_capacity_mb, 10240,
+             "Size of the file set by --block_cache_ssd_path, in MB. Changing it "
+             "discards the file's content.");
+TAG_FLAG(block_cache_ssd_capacity_mb, experimental);
+
+DEFINE_bool(block_cache_ssd_admit_all, false,
+            "Whether all the blocks evicted from the block cache are written to "
+            "the file set by --block_cache_ssd_path. By default, a block is only "
+            "written the second time it's evicted within a short window, so that "
+            "blocks read once by large scans don't wear out the SSD.");
+TAG_FLAG(block_cache_ssd_admit_all, experimental);
+
+using std::pair;
+using std::string;
+using std::vector;
+
 template <class T> class scoped_refptr;
 
 namespace kudu {
@@ -51,13 +115,41 @@ namespace cfile {
 
 namespace {
 
-Cache* CreateCache(int64_t capacity) {
+Cache* CreateCache(int64_t capacity, const string& id) {
   CacheType t = BlockCache::GetConfiguredCacheTypeOrDie();
-  return NewLRUCache(t, capacity, "block_cache");
+  CacheEvictionPolicy policy = BlockCache::GetConfiguredEvictionPolicyOrDie();
+  return NewCache(t, policy, capacity, id);
 }
 
 } // anonymous namespace
 
+class BlockCache::EvictionHandler : public Cache::EvictionCallback {
+ public:
+  explicit EvictionHandler(BlockCache* cache)
+      : cache_(cache) {
+  }
+
+  void EvictedEntry(Slice key, Slice value) override {
+    cache_->EntryEvicted(key, value);
+  }
+
+ private:
+  BlockCache* cache_;
+};
+
+struct BlockCache::BlockTracker {
+  BlockTracker() : enabled(false) {}
+
+  AtomicBool enabled;
+
+  // Protects 'blocks'.
+  mutable simple_spinlock lock;
+
+  // The disk size and type of the tracked blocks, keyed by their file id
+  // and offset.
+  std::map<pair<uint64_t, uint64_t>, pair<uint32_t, BlockType>> blocks;
+};
+
 CacheType BlockCache::GetConfiguredCacheTypeOrDie() {
     ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
   if (FLAGS_block_cache_type == "NVM") {
@@ -72,37 +164,197 @@ CacheType BlockCache::GetConfiguredCacheTypeOrDie() {
   __builtin_unreachable();
 }
 
+CacheEvictionPolicy BlockCache::GetConfiguredEvictionPolicyOrDie() {
+  ToUpperCase(FLAGS_block_cache_eviction_policy, &FLAGS_block_cache_eviction_policy);
+  if (FLAGS_block_cache_eviction_policy == "LRU") {
+    return CacheEvictionPolicy::LRU;
+  }
+  CacheEvictionPolicy policy;
+  if (FLAGS_block_cache_eviction_policy == "TINYLFU") {
+    policy = CacheEvictionPolicy::SLRU_TINYLFU;
+  } else if (FLAGS_block_cache_eviction_policy == "CLOCK") {
+    policy = CacheEvictionPolicy::CLOCK;
+  } else {
+    LOG(FATAL) << "Unknown block cache eviction policy: '"
+               << FLAGS_block_cache_eviction_policy
+               << "' (expected 'LRU', 'TINYLFU' or 'CLOCK')";
+    __builtin_unreachable();
+  }
+  if (GetConfiguredCacheTypeOrDie() != DRAM_CACHE) {
+    LOG(FATAL) << "The '" << FLAGS_block_cache_eviction_policy
+               << "' block cache eviction policy requires the 'DRAM' block cache type";
+  }
+  return policy;
+}
+
 BlockCache::BlockCache()
   : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
 }
 
 BlockCache::BlockCache(size_t capacity)
-  : cache_(CreateCache(capacity)) {
+    : tracker_(new BlockTracker()),
+      eviction_handler_(new EvictionHandler(this)) {
+  size_t metadata_capacity =
+      static_cast<size_t>(capacity * FLAGS_block_cache_metadata_capacity_ratio);
+  if (metadata_capacity > 0) {
+    if (GetConfiguredCacheTypeOrDie() != DRAM_CACHE) {
+      LOG(FATAL) << "Reserving block cache capacity for metadata blocks requires "
+                 << "the 'DRAM' block cache type";
+    }
+    metadata_cache_.reset(CreateCache(metadata_capacity, "block_cache_metadata"));
+  }
+  cache_.reset(CreateCache(capacity - metadata_capacity, "block_cache"));
+
+  if (!FLAGS_block_cache_ssd_path.empty()) {
+    if (GetConfiguredCacheTypeOrDie() != DRAM_CACHE) {
+      LOG(FATAL) << "The SSD block cache requires the 'DRAM' block cache type";
+    }
+    SsdCache::Options opts;
+    opts.capacity_bytes = FLAGS_block_cache_ssd_capacity_mb * 1024 * 1024;
+    opts.region_size_bytes = std::min(opts.region_size_bytes, opts.capacity_bytes / 16);
+    opts.admit_all = FLAGS_block_cache_ssd_admit_all;
+    Status s = SsdCache::Open(Env::Default(), FLAGS_block_cache_ssd_path, opts, &ssd_cache_);
+    if (!s.ok()) {
+      // The SSD tier only makes the cache bigger: run without it.
+      LOG(WARNING) << "Could not open the SSD block cache, continuing without it: "
+                   << s.ToString();
+    }
+  }
+}
+
+void BlockCache::IncrementTypeMetrics(BlockType type, bool hit) {
+  BlockCacheTypeMetrics* m = type_metrics_.get();
+  switch (type) {
+    case DATA_BLOCK:
+      (hit ? m->data_hits : m->data_misses)->Increment();
+      break;
+    case INDEX_BLOCK:
+      (hit ? m->index_hits : m->index_misses)->Increment();
+      break;
+    case BLOOM_BLOCK:
+      (hit ? m->bloom_hits : m->bloom_misses)->Increment();
+      break;
+    case DICTIONARY_BLOCK:
+      (hit ? m->dictionary_hits : m->dictionary_misses)->Increment();
+      break;
+  }
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size) {
+BlockCache::~BlockCache() {
+}
+
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size,
+                                              BlockType type) {
+  Cache* cache = cache_for(type);
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
-  return PendingEntry(cache_.get(), cache_->Allocate(key_slice, block_size));
+  return PendingEntry(cache, cache->Allocate(key_slice, block_size));
 }
 
 bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-                        BlockCacheHandle *handle) {
-  Cache::Handle *h = cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
-                                          sizeof(key)), behavior);
+                        BlockCacheHandle *handle, BlockType type) {
+  Cache* cache = cache_for(type);
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  Cache::Handle *h = cache->Lookup(key_slice, behavior);
+  if (h == nullptr && ssd_cache_) {
+    h = PromoteFromSsd(cache, key_slice);
+  }
   if (h != nullptr) {
-    handle->SetHandle(cache_.get(), h);
+    handle->SetHandle(cache, h);
+  }
+  if (type_metrics_) {
+    IncrementTypeMetrics(type, h != nullptr);
   }
   return h != nullptr;
 }
 
+Cache::Handle* BlockCache::PromoteFromSsd(Cache* cache, const Slice& key) {
+  PendingEntry entry;
+  Status s = ssd_cache_->Lookup(key, [&](size_t size) -> uint8_t* {
+      entry = PendingEntry(cache, cache->Allocate(key, size));
+      return entry.valid() ? entry.val_ptr() : nullptr;
+    });
+  if (!s.ok()) {
+    return nullptr;
+  }
+  Cache::Handle* h = cache->Insert(entry.handle_, eviction_callback());
+  entry.handle_ = nullptr;
+  return h;
+}
+
+Cache::EvictionCallback* BlockCache::eviction_callback() const {
+  if (ssd_cache_ || tracker_->enabled.Load()) {
+    return eviction_handler_.get();
+  }
+  return nullptr;
+}
+
+void BlockCache::EntryEvicted(const Slice& key, const Slice& value) {
+  if (ssd_cache_) {
+    ssd_cache_->Put(key, value);
+  }
+  if (tracker_->enabled.Load() && key.size() == sizeof(CacheKey)) {
+    CacheKey k(FileId(), 0);
+    memcpy(&k, key.data(), sizeof(k));
+    // The key's fields are packed, so they can't be bound to references.
+    uint64_t file_id = k.file_id_;
+    uint64_t offset = k.offset_;
+    pair<uint64_t, uint64_t> id(file_id, offset);
+    std::lock_guard<simple_spinlock> l(tracker_->lock);
+    tracker_->blocks.erase(id);
+  }
+}
+
+void BlockCache::StartTrackingBlocks() {
+  tracker_->enabled.Store(true);
+}
+
+void BlockCache::RecordBlockRead(const CacheKey& key, uint32_t disk_size, BlockType type) {
+  if (!tracker_->enabled.Load()) {
+    return;
+  }
+  uint64_t file_id = key.file_id_;
+  uint64_t offset = key.offset_;
+  pair<uint64_t, uint64_t> id(file_id, offset);
+  std::lock_guard<simple_spinlock> l(tracker_->lock);
+  tracker_->blocks[id] = std::make_pair(disk_size, type);
+}
+
+void BlockCache::GetTrackedBlocks(vector<TrackedBlock>* blocks) const {
+  blocks->clear();
+  std::lock_guard<simple_spinlock> l(tracker_->lock);
+  blocks->reserve(tracker_->blocks.size());
+  for (const auto& e : tracker_->blocks) {
+    CacheKey key(FileId(e.first.first), e.first.second);
+    blocks->push_back({ key, e.second.first, e.second.second });
+  }
+}
+
 void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+  Cache::Handle *h = entry->cache_->Insert(entry->handle_, eviction_callback());
   entry->handle_ = nullptr;
-  inserted->SetHandle(cache_.get(), h);
+  inserted->SetHandle(entry->cache_, h);
 }
 
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
+  // Both caches share the same metrics, so the overall metrics cover all the
+  // blocks regardless of their pool.
   cache_->SetMetrics(metric_entity);
+  if (metadata_cache_) {
+    metadata_cache_->SetMetrics(metric_entity);
+  }
+  if (ssd_cache_) {
+    ssd_cache_->SetMetrics(metric_entity);
+  }
+  type_metrics_.reset(new BlockCacheTypeMetrics(metric_entity));
+  decompression_metrics_.reset(new BlockCacheDecompressionMetrics(metric_entity));
+}
+
+void BlockCache::RecordDecompression(size_t uncompressed_bytes, int64_t micros) {
+  if (decompression_metrics_) {
+    decompression_metrics_->decompressions->Increment();
+    decompression_metrics_->decompressed_bytes->IncrementBy(uncompressed_bytes);
+    decompression_metrics_->decompression_time_us->IncrementBy(micros);
+  }
 }
 
 } // namespace cfile
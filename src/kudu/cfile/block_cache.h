@@ -19,7 +19,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -33,12 +35,17 @@
 #include "kudu/util/slice.h"
 
 DECLARE_string(block_cache_type);
+DECLARE_string(block_cache_eviction_policy);
+DECLARE_double(block_cache_metadata_capacity_ratio);
 
 template <class T> class scoped_refptr;
 
 namespace kudu {
 
 class MetricEntity;
+class SsdCache;
+struct BlockCacheDecompressionMetrics;
+struct BlockCacheTypeMetrics;
 
 namespace cfile {
 
@@ -46,12 +53,34 @@ class BlockCacheHandle;
 
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
+//
+// If --block_cache_metadata_capacity_ratio is set, a part of the capacity is
+// reserved for index, bloom and dictionary blocks, which are kept in a
+// separate cache so that scans can't evict them.
+//
+// If --block_cache_ssd_path is set, the blocks evicted from memory are kept
+// in a second tier on local SSD (see SsdCache), and promoted back to memory
+// when they're looked up again.
 class BlockCache {
  public:
+  // The type of a cached block, which determines its pool and the per-type
+  // metrics it is counted in.
+  enum BlockType {
+    DATA_BLOCK,
+    // B-tree index blocks and other file metadata, such as zone maps.
+    INDEX_BLOCK,
+    BLOOM_BLOCK,
+    DICTIONARY_BLOCK,
+  };
+
   // Parse the gflag which configures the block cache. FATALs if the flag is
   // invalid.
   static CacheType GetConfiguredCacheTypeOrDie();
 
+  // Parse the gflag which configures the block cache's eviction policy.
+  // FATALs if the flag is invalid.
+  static CacheEvictionPolicy GetConfiguredEvictionPolicyOrDie();
+
   // BlockId refers to the unique identifier for a Kudu block, that is, for an
   // entire CFile. This is different than the block cache's notion of a block,
   // which is just a portion of a CFile.
@@ -122,6 +151,7 @@ class BlockCache {
   }
 
   explicit BlockCache(size_t capacity);
+  ~BlockCache();
 
   // Lookup the given block in the cache.
   //
@@ -129,9 +159,10 @@ class BlockCache {
   // This object's destructor will release the cache entry so it may be freed again.
   // Alternatively,  handle->Release() may be used to explicitly release it.
   //
-  // Returns true to indicate that the entry was found, false otherwise.
+  // Returns true to indicate that the entry was found, false otherwise. An
+  // entry found in the SSD tier is inserted back into memory.
   bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-              BlockCacheHandle* handle);
+              BlockCacheHandle* handle, BlockType type = DATA_BLOCK);
 
   // Pass a metric entity to the cache to start recording metrics.
   // This should be called before the block cache starts serving blocks.
@@ -157,20 +188,83 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the cache. 'type' must match
+  // the type used to look the block up.
+  PendingEntry Allocate(const CacheKey& key, size_t block_size,
+                        BlockType type = DATA_BLOCK);
 
   // Insert the given block into the cache. 'inserted' is set to refer to the
   // entry in the cache.
   void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
 
+  // A block read from a CFile into the cache, as recorded by RecordBlockRead().
+  struct TrackedBlock {
+    CacheKey key;
+    // The size of the block in its file, as found in its BlockPointer.
+    uint32_t disk_size;
+    BlockType type;
+  };
+
+  // Starts keeping track of the blocks read into the cache, until they're
+  // evicted. This allows saving the set of cached blocks and reading them
+  // back after a restart.
+  void StartTrackingBlocks();
+
+  // Records that the block at 'key', which takes 'disk_size' bytes in its
+  // file, was just inserted into the cache. Does nothing unless
+  // StartTrackingBlocks() was called.
+  void RecordBlockRead(const CacheKey& key, uint32_t disk_size, BlockType type);
+
+  // Returns the tracked blocks which are still cached, sorted by file and
+  // offset.
+  void GetTrackedBlocks(std::vector<TrackedBlock>* blocks) const;
+
+  // Records that a compressed block found in the cache was decompressed into
+  // 'uncompressed_bytes' bytes, which took 'micros' microseconds.
+  void RecordDecompression(size_t uncompressed_bytes, int64_t micros);
+
  private:
   friend class Singleton<BlockCache>;
+  class EvictionHandler;
+  struct BlockTracker;
+
   BlockCache();
 
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
+  void IncrementTypeMetrics(BlockType type, bool hit);
+
+  // Returns the cache holding blocks of type 'type'.
+  Cache* cache_for(BlockType type) const {
+    return (type != DATA_BLOCK && metadata_cache_) ? metadata_cache_.get() : cache_.get();
+  }
+
+  // Looks up 'key' in the SSD tier, and inserts the block into 'cache' if
+  // it's found. Returns the handle of the inserted entry, or null.
+  Cache::Handle* PromoteFromSsd(Cache* cache, const Slice& key);
+
+  // Called when the entry for 'key' is evicted from memory.
+  void EntryEvicted(const Slice& key, const Slice& value);
+
+  // Returns the callback to pass when inserting an entry, or null if there's
+  // nothing to do on eviction.
+  Cache::EvictionCallback* eviction_callback() const;
+
+  // The SSD tier, or null if there's none, the tracked blocks, and the
+  // callback which keeps both up to date with the evictions. These are
+  // declared before the in-memory caches so that they outlive them.
+  std::unique_ptr<SsdCache> ssd_cache_;
+  std::unique_ptr<BlockTracker> tracker_;
+  std::unique_ptr<EvictionHandler> eviction_handler_;
+
   gscoped_ptr<Cache> cache_;
+
+  // The cache reserved for blocks other than data blocks, or null if there's
+  // no reserved capacity.
+  gscoped_ptr<Cache> metadata_cache_;
+
+  std::unique_ptr<BlockCacheTypeMetrics> type_metrics_;
+  std::unique_ptr<BlockCacheDecompressionMetrics> decompression_metrics_;
 };
 
 // Scoped reference to a block from the block cache.
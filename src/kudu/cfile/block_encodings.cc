@@ -0,0 +1,68 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_encodings.h"
+
+#include <cstring>
+
+#include "kudu/common/columnblock.h"
+
+namespace kudu {
+namespace cfile {
+
+const size_t BlockDecoder::kMinSkippedRun;
+
+Status BlockDecoder::CopySelectedRuns(size_t* n,
+                                      const SelectionVectorView& sel,
+                                      ColumnDataView* dst,
+                                      size_t min_skipped_run) {
+  DCHECK_GT(min_skipped_run, 0);
+  const size_t nrows = std::min<size_t>(*n, Count() - GetCurrentIndex());
+  const size_t stride = dst->stride();
+  ColumnDataView view(*dst);
+
+  size_t copy_start = 0;
+  size_t pos = 0;
+  while (pos < nrows) {
+    size_t run_start = pos + sel.CountRun(pos, nrows - pos, true);
+    size_t run_end = run_start + sel.CountRun(run_start, nrows - run_start, false);
+    if (run_end < nrows && run_end - run_start < min_skipped_run) {
+      pos = run_end;
+      continue;
+    }
+
+    size_t to_copy = run_start - copy_start;
+    if (to_copy > 0) {
+      size_t copied = to_copy;
+      RETURN_NOT_OK(CopyNextValues(&copied, &view));
+      DCHECK_EQ(to_copy, copied);
+      view.Advance(to_copy);
+    }
+    size_t to_skip = run_end - run_start;
+    if (to_skip > 0) {
+      SeekToPositionInBlock(GetCurrentIndex() + to_skip);
+      memset(view.data(), 0, stride * to_skip);
+      view.Advance(to_skip);
+    }
+    copy_start = pos = run_end;
+  }
+  *n = nrows;
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -171,6 +171,21 @@ class BlockDecoder {
     return Status::OK();
   }
 
+  // Fetch the next values from the block into 'dst', but only decode the
+  // rows which are selected in 'sel'. The cells of the other rows are zeroed.
+  // Neither 'sel' nor 'dst' is advanced.
+  //
+  // Modifies *n to contain the number of rows the decoder moved forward by,
+  // whether or not they were selected.
+  //
+  // The default implementation seeks over long runs of deselected rows and
+  // decodes the others, which suits decoders whose seeks are costly.
+  virtual Status CopySelectedValues(size_t* n,
+                                    const SelectionVectorView& sel,
+                                    ColumnDataView* dst) {
+    return CopySelectedRuns(n, sel, dst, kMinSkippedRun);
+  }
+
   // Return true if there are more values remaining to be iterated.
   // (i.e that the next call to CopyNextValues will return at least 1
   // element)
@@ -190,6 +205,22 @@ class BlockDecoder {
   virtual rowid_t GetFirstRowId() const = 0;
 
   virtual ~BlockDecoder() {}
+
+ protected:
+  // Deselected runs shorter than this are decoded along with the selected rows
+  // around them by default: seeking the decoder costs more than decoding a few
+  // cells.
+  static const size_t kMinSkippedRun = 32;
+
+  // Implements CopySelectedValues() with CopyNextValues() for the selected
+  // rows and SeekToPositionInBlock() over the runs of at least
+  // 'min_skipped_run' deselected rows. Decoders which can seek in constant
+  // time pass 1.
+  Status CopySelectedRuns(size_t* n,
+                          const SelectionVectorView& sel,
+                          ColumnDataView* dst,
+                          size_t min_skipped_run);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(BlockDecoder);
 };
@@ -18,16 +18,21 @@
 #ifndef KUDU_CFILE_BLOCK_HANDLE_H
 #define KUDU_CFILE_BLOCK_HANDLE_H
 
+#include <memory>
+#include <utility>
+
 #include "kudu/cfile/block_cache.h"
 
 namespace kudu {
 
+class FileMapping;
+
 namespace cfile {
 
 // When blocks are read, they are sometimes resident in the block cache, and sometimes skip the
 // block cache. In the case that they came from the cache, we just need to dereference them when
 // they stop being used. In the case that they didn't come from cache, we need to actually free
-// the underlying data.
+// the underlying data. Blocks read from a mapping of their file keep the mapping alive instead.
 class BlockHandle {
  public:
   static BlockHandle WithOwnedData(const Slice& data) {
@@ -38,6 +43,13 @@ class BlockHandle {
     return BlockHandle(handle);
   }
 
+  static BlockHandle WithMappedData(std::shared_ptr<FileMapping> mapping, const Slice& data) {
+    BlockHandle handle;
+    handle.mapping_ = std::move(mapping);
+    handle.data_ = data;
+    return handle;
+  }
+
   // Constructor to use to Pass to.
   BlockHandle()
     : is_data_owner_(false) { }
@@ -56,7 +68,7 @@ class BlockHandle {
   }
 
   Slice data() const {
-    if (is_data_owner_) {
+    if (is_data_owner_ || mapping_) {
       return data_;
     } else {
       return dblk_data_.data();
@@ -65,6 +77,7 @@ class BlockHandle {
 
  private:
   BlockCacheHandle dblk_data_;
+  std::shared_ptr<FileMapping> mapping_;
   Slice data_;
   bool is_data_owner_;
 
@@ -85,6 +98,9 @@ class BlockHandle {
     if (is_data_owner_) {
       data_ = other->data_;
       other->is_data_owner_ = false;
+    } else if (other->mapping_) {
+      data_ = other->data_;
+      mapping_ = std::move(other->mapping_);
     } else {
       dblk_data_.swap(&other->dblk_data_);
     }
@@ -95,6 +111,7 @@ class BlockHandle {
       delete [] data_.data();
       is_data_owner_ = false;
     }
+    mapping_.reset();
     data_ = "";
   }
 
@@ -15,12 +15,15 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <ostream>
 #include <utility>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -31,12 +34,18 @@
 #include "kudu/fs/fs-test-util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/endian.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(bloomfile_split_block_format);
+
 using std::shared_ptr;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace cfile {
@@ -86,6 +95,14 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+// Files written in the classic format, as by older versions, remain readable.
+TEST_F(BloomFileTest, TestWriteAndReadClassicFormat) {
+  FLAGS_bloomfile_split_block_format = false;
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
@@ -107,6 +124,50 @@ TEST_F(BloomFileTest, Benchmark) {
 }
 #endif
 
+// Check that probing a sorted batch of keys gives the same results as
+// probing them one at a time.
+TEST_F(BloomFileTest, TestCheckKeysPresent) {
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+
+  // Both the inserted keys and the ones in between them, in order.
+  const int kNumProbes = FLAGS_n_keys << kKeyShift;
+  vector<uint64_t> keys(kNumProbes);
+  vector<BloomKeyProbe> probes(kNumProbes);
+  vector<const BloomKeyProbe*> probe_ptrs(kNumProbes);
+  for (int i = 0; i < kNumProbes; i++) {
+    keys[i] = BigEndian::FromHost64(i);
+    probes[i] = BloomKeyProbe(Slice(reinterpret_cast<uint8_t*>(&keys[i]), sizeof(keys[i])));
+    probe_ptrs[i] = &probes[i];
+  }
+
+  unique_ptr<bool[]> present_one_by_one(new bool[kNumProbes]);
+  LOG_TIMING(INFO, Substitute("probing $0 keys one at a time", kNumProbes)) {
+    for (int i = 0; i < kNumProbes; i++) {
+      ASSERT_OK_FAST(bfr_->CheckKeyPresent(probes[i], &present_one_by_one[i]));
+    }
+  }
+  unique_ptr<bool[]> present_batch(new bool[kNumProbes]);
+  LOG_TIMING(INFO, Substitute("probing $0 keys in a batch", kNumProbes)) {
+    ASSERT_OK(bfr_->CheckKeysPresent(probe_ptrs.data(), kNumProbes, present_batch.get()));
+  }
+  for (int i = 0; i < kNumProbes; i++) {
+    ASSERT_EQ(present_one_by_one[i], present_batch[i]) << "key " << i;
+    if (i % (1 << kKeyShift) == 0) {
+      ASSERT_TRUE(present_batch[i]) << "key " << i;
+    }
+  }
+
+  // Probing sub-batches in a row reuses the state of the previous one.
+  for (int start = 0; start < kNumProbes; start += 1000) {
+    int n = std::min(1000, kNumProbes - start);
+    ASSERT_OK(bfr_->CheckKeysPresent(&probe_ptrs[start], n, &present_batch[start]));
+  }
+  for (int i = 0; i < kNumProbes; i++) {
+    ASSERT_EQ(present_one_by_one[i], present_batch[i]) << "key " << i;
+  }
+}
+
 TEST_F(BloomFileTest, TestLazyInit) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
 
@@ -21,9 +21,10 @@
 #include <utility>
 #include <vector>
 
-#include <gflags/gflags_declare.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/bloomfile.h"
@@ -40,6 +41,7 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
@@ -48,6 +50,13 @@
 
 DECLARE_bool(cfile_lazy_open);
 
+DEFINE_bool(bloomfile_split_block_format, true,
+            "Whether to write the blocks of bloom files as split-block bloom "
+            "filters, which check a key by reading a single cache line, rather "
+            "than as classic bloom filters. Versions which don't support them "
+            "ignore split-block filters, treating every key as possibly present.");
+TAG_FLAG(bloomfile_split_block_format, advanced);
+
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -96,7 +105,8 @@ using BloomCacheTLC = ThreadLocalCache<uint64_t, BloomCacheItem>;
 
 BloomFileWriter::BloomFileWriter(unique_ptr<WritableBlock> block,
                                  const BloomFilterSizing &sizing)
-  : bloom_builder_(sizing) {
+  : bloom_builder_(sizing, FLAGS_bloomfile_split_block_format ?
+                   BloomFilterFormat::SPLIT_BLOCK : BloomFilterFormat::CLASSIC) {
   cfile::WriterOptions opts;
   opts.write_posidx = false;
   opts.write_validx = true;
@@ -167,7 +177,12 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
 
   // Encode the header.
   BloomBlockHeaderPB hdr;
-  hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  if (bloom_builder_.format() == BloomFilterFormat::SPLIT_BLOCK) {
+    hdr.set_num_hash_functions(0);
+    hdr.set_format(BloomBlockHeaderPB::SPLIT_BLOCK);
+  } else {
+    hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, hdr.ByteSize());
   pb_util::AppendToString(hdr, &hdr_str);
@@ -278,12 +293,25 @@ Status BloomFileReader::ParseBlockHeader(const Slice &block,
   }
 
   data.remove_prefix(header_len);
+  if (hdr->format() == BloomBlockHeaderPB::SPLIT_BLOCK &&
+      (data.empty() || data.size() % BloomFilter::kSplitBlockBucketBytes != 0)) {
+    return Status::Corruption(
+      StringPrintf("Split-block bloom filter of %ld bytes isn't made of whole buckets",
+                   data.size()));
+  }
   *bloom_data = data;
   return Status::OK();
 }
 
 Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
                                         bool *maybe_present) {
+  const BloomKeyProbe* probes[] = { &probe };
+  return CheckKeysPresent(probes, 1, maybe_present);
+}
+
+Status BloomFileReader::CheckKeysPresent(const BloomKeyProbe* const* probes,
+                                         int num_probes,
+                                         bool* maybe_present) {
   DCHECK(init_once_.init_succeeded());
 
   // Since we frequently will access the same BloomFile many times in a row
@@ -301,38 +329,65 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   DCHECK_EQ(reader_.get(), bci->index_iter.cfile_reader())
       << "Cached index reader does not match expected instance";
 
+  // The probes are sorted, so the ones which fall into the same bloom block
+  // follow each other. They're checked together once the run ends: the
+  // bitmap words of all of them are prefetched first, so that their cache
+  // misses overlap.
+  int run_start = 0;
+  const auto& CheckRun = [&](int run_end) {
+    const BloomFilter& bloom = bci->cur_bloom;
+    for (int i = run_start; i < run_end; i++) {
+      bloom.PrefetchKey(*probes[i]);
+    }
+    for (int i = run_start; i < run_end; i++) {
+      maybe_present[i] = bloom.MayContainKey(*probes[i]);
+    }
+  };
+
   IndexTreeIterator* index_iter = &bci->index_iter;
-  Status s = index_iter->SeekAtOrBefore(probe.key());
-  if (PREDICT_FALSE(s.IsNotFound())) {
-    // Seek to before the first entry in the file.
-    *maybe_present = false;
-    return Status::OK();
-  }
-  RETURN_NOT_OK(s);
-
-  // Successfully found the pointer to the bloom block.
-  BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
-
-  // If the previous lookup from this bloom on this thread seeked to a different
-  // block in the BloomFile, we need to read the correct block and re-hydrate the
-  // BloomFilter instance.
-  if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
-    BlockHandle dblk_data;
-    RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK, &dblk_data));
-
-    // Parse the header in the block.
-    BloomBlockHeaderPB hdr;
-    Slice bloom_data;
-    RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
-
-    // Save the data back into our threadlocal cache.
-    bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions());
-    bci->cur_block_pointer = bblk_ptr;
-    bci->cur_block_handle = std::move(dblk_data);
+  for (int i = 0; i < num_probes; i++) {
+    DCHECK(i == 0 || probes[i - 1]->key().compare(probes[i]->key()) <= 0)
+        << "Probes must be sorted by key";
+    Status s = index_iter->SeekAtOrBefore(probes[i]->key());
+    if (PREDICT_FALSE(s.IsNotFound())) {
+      // Seek to before the first entry in the file.
+      CheckRun(i);
+      run_start = i + 1;
+      maybe_present[i] = false;
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    // Successfully found the pointer to the bloom block.
+    BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
+
+    // If the previous lookup from this bloom on this thread seeked to a different
+    // block in the BloomFile, we need to read the correct block and re-hydrate the
+    // BloomFilter instance.
+    if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
+      CheckRun(i);
+      run_start = i;
+
+      BlockHandle dblk_data;
+      RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK, &dblk_data,
+                                       BlockCache::BLOOM_BLOCK));
+
+      // Parse the header in the block.
+      BloomBlockHeaderPB hdr;
+      Slice bloom_data;
+      RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
+
+      // Save the data back into our threadlocal cache.
+      bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions(),
+                                   hdr.format() == BloomBlockHeaderPB::SPLIT_BLOCK ?
+                                   BloomFilterFormat::SPLIT_BLOCK : BloomFilterFormat::CLASSIC);
+      bci->cur_block_pointer = bblk_ptr;
+      bci->cur_block_handle = std::move(dblk_data);
+    }
   }
 
-  // Actually check the bloom filter.
-  *maybe_present = bci->cur_bloom.MayContainKey(probe);
+  // Actually check the bloom filter for the last run.
+  CheckRun(num_probes);
   return Status::OK();
 }
 
@@ -115,6 +115,16 @@ class BloomFileReader {
   Status CheckKeyPresent(const BloomKeyProbe &probe,
                          bool* maybe_present);
 
+  // Same as CheckKeyPresent(), for each of the 'num_probes' probes in
+  // 'probes', setting the results into 'maybe_present[i]'. The probes which
+  // fall into the same bloom block are checked together, which is cheaper
+  // than checking them one at a time.
+  //
+  // The probes must be sorted by key.
+  Status CheckKeysPresent(const BloomKeyProbe* const* probes,
+                          int num_probes,
+                          bool* maybe_present);
+
   // Can be called before Init().
   uint64_t FileSize() const {
     return reader_->file_size();
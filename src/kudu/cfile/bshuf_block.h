@@ -330,6 +330,13 @@ class BShufBlockDecoder final : public BlockDecoder {
     return CopyNextValuesToArray(n, dst->data());
   }
 
+  // Seeking is free, so only the selected rows are copied.
+  Status CopySelectedValues(size_t* n,
+                            const SelectionVectorView& sel,
+                            ColumnDataView* dst) OVERRIDE {
+    return CopySelectedRuns(n, sel, dst, 1);
+  }
+
   // Copy the codewords to a temporary buffer.
   // This API provides a more convenient way for the dictionary decoder to copy out
   // integer codewords and then look up the strings. If we use the CopyNextValuesToArray()
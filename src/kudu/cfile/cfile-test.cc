@@ -39,9 +39,11 @@
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/column_stats.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -77,6 +79,10 @@
 
 DECLARE_bool(cfile_write_checksums);
 DECLARE_bool(cfile_verify_checksums);
+DECLARE_bool(cfile_cache_compressed_blocks);
+DECLARE_bool(cfile_mmap_uncompressed_blocks);
+DECLARE_int32(cfile_readahead_max_blocks);
+DECLARE_bool(cfile_zero_copy_strings);
 
 #if defined(__linux__)
 DECLARE_string(nvm_cache_path);
@@ -311,6 +317,65 @@ class TestCFile : public CFileTestBase {
     ASSERT_EQ(num_entries, count);
   }
 
+  // Scans a file with a sparse selection vector, letting the iterator skip over
+  // the deselected rows, and checks that the selected rows are intact.
+  template<class DataGeneratorType>
+  void TestSkipUnselectedRows(DataGeneratorType* generator, EncodingType encoding) {
+    const int kNumRows = 10000;
+    const int kBatchSize = 1000;
+    BlockId block_id;
+    WriteTestFile(generator, encoding, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToOrdinal(0));
+
+    // Regenerate the expected values for the whole file.
+    generator->Reset();
+    generator->Build(kNumRows);
+
+    ScopedColumnBlock<DataGeneratorType::kDataType> cb(kBatchSize);
+    SelectionVector sel(kBatchSize);
+    for (int offset = 0; offset < kNumRows; offset += kBatchSize) {
+      size_t n = kBatchSize;
+      ASSERT_OK(iter->PrepareBatch(&n));
+      ASSERT_EQ(kBatchSize, n);
+
+      // Leave both short gaps, which are decoded anyway, and long ones, which
+      // are skipped. The last batch selects nothing at all.
+      sel.SetAllFalse();
+      if (offset + kBatchSize < kNumRows) {
+        for (int i = 0; i < kBatchSize; i++) {
+          int row = offset + i;
+          if (row % 97 == 0 || row % 97 == 5 || (row >= 4000 && row < 4100)) {
+            sel.SetRowSelected(i);
+          }
+        }
+      }
+      ColumnMaterializationContext ctx(0, nullptr, &cb, &sel);
+      ctx.SetSkipUnselectedRows();
+      ASSERT_OK(iter->Scan(&ctx));
+      ASSERT_OK(iter->FinishBatch());
+
+      for (int i = 0; i < kBatchSize; i++) {
+        if (!sel.IsRowSelected(i)) {
+          continue;
+        }
+        int row = offset + i;
+        if (generator->TestValueShouldBeNull(row)) {
+          ASSERT_TRUE(cb.is_null(i)) << "row " << row;
+        } else {
+          ASSERT_FALSE(cb.is_null(i)) << "row " << row;
+          ASSERT_EQ((*generator)[row], cb[i]) << "row " << row;
+        }
+      }
+    }
+  }
+
   void TestReadWriteStrings(EncodingType encoding) {
     TestReadWriteStrings(encoding, [](size_t val) {
         return StringPrintf("hello %04zd", val);
@@ -721,6 +786,44 @@ TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsDictEncoding) {
   TestReadWriteStrings(DICT_ENCODING);
 }
 
+// Test that zero-copy string cells point into the blocks, which the arena
+// keeps pinned even once the iterator and the reader are gone.
+TEST_P(TestCFileBothCacheTypes, TestZeroCopyStrings) {
+  FLAGS_cfile_zero_copy_strings = true;
+  for (EncodingType encoding : { PLAIN_ENCODING, DICT_ENCODING }) {
+    SCOPED_TRACE(encoding);
+    const int kNumRows = 10000;
+    BlockId block_id;
+    StringDataGenerator<false> generator("hello %04zd");
+    WriteTestFile(&generator, encoding, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToFirst());
+    ASSERT_TRUE(iter->zero_copy_strings());
+
+    ScopedColumnBlock<STRING> cb(kNumRows);
+    SelectionVector sel(kNumRows);
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+    size_t footprint = cb.arena()->memory_footprint();
+    size_t n = kNumRows;
+    ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+    ASSERT_EQ(kNumRows, n);
+    // None of the strings were copied into the arena.
+    ASSERT_EQ(footprint, cb.arena()->memory_footprint());
+
+    iter.reset();
+    reader.reset();
+    for (int i = 0; i < kNumRows; i++) {
+      ASSERT_EQ(StringPrintf("hello %04d", i), cb[i].ToString());
+    }
+  }
+}
+
 // Regression test for properly handling cells that are larger
 // than the index block and/or data block size.
 //
@@ -853,6 +956,65 @@ TEST_P(TestCFileBothCacheTypes, TestChecksumFlags) {
   }
 }
 
+// Test reading compressed files whose blocks are cached compressed, so that
+// both misses and hits decompress them.
+TEST_P(TestCFileBothCacheTypes, TestCacheCompressedBlocks) {
+  FLAGS_cfile_cache_compressed_blocks = true;
+  TestReadWriteRawBlocks(NO_COMPRESSION, 1000);
+  TestReadWriteRawBlocks(LZ4, 1000);
+  TestReadWriteRawBlocks(ZLIB, 1000);
+
+  UInt32DataGenerator<true> generator;
+  TestNullTypes(&generator, BIT_SHUFFLE, LZ4);
+  StringDataGenerator<true> str_gen("hello %zu");
+  TestNullTypes(&str_gen, DICT_ENCODING, SNAPPY);
+}
+
+// Test reading files whose uncompressed blocks are served from a mapping of
+// the file rather than from the block cache.
+TEST_P(TestCFileBothCacheTypes, TestMmapUncompressedBlocks) {
+  FLAGS_cfile_mmap_uncompressed_blocks = true;
+  TestReadWriteRawBlocks(NO_COMPRESSION, 1000);
+  TestReadWriteRawBlocks(LZ4, 1000);
+
+  UInt32DataGenerator<true> generator;
+  TestNullTypes(&generator, BIT_SHUFFLE, NO_COMPRESSION);
+  TestNullTypes(&generator, BIT_SHUFFLE, LZ4);
+  StringDataGenerator<true> str_gen("hello %zu");
+  TestNullTypes(&str_gen, DICT_ENCODING, NO_COMPRESSION);
+
+  // Mapped blocks bypass the block cache, and remain readable once the
+  // reader is gone.
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+  BlockId block_id;
+  StringDataGenerator<false> str_gen2("hello %04d");
+  WriteTestFile(&str_gen2, PLAIN_ENCODING, NO_COMPRESSION, 1000, SMALL_BLOCKSIZE, &block_id);
+  BlockHandle first;
+  string first_data;
+  for (int i = 0; i < 2; i++) {
+    unique_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+    gscoped_ptr<IndexTreeIterator> iter(
+        IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(iter->GetCurrentBlockPointer(), CFileReader::CACHE_BLOCK, &bh));
+    if (i == 0) {
+      first_data = bh.data().ToString();
+      first = std::move(bh);
+    } else {
+      ASSERT_EQ(first_data, bh.data().ToString());
+    }
+  }
+  ASSERT_EQ(first_data, first.data().ToString());
+  ASSERT_EQ(0, down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value());
+}
+
 TEST_P(TestCFileBothCacheTypes, TestDataCorruption) {
   FLAGS_cfile_write_checksums = true;
   FLAGS_cfile_verify_checksums = true;
@@ -986,6 +1148,126 @@ TEST_P(TestCFileBothCacheTypes, TestLazyInit) {
   ASSERT_EQ(bytes_read_after_init, bytes_read);
 }
 
+TEST_P(TestCFileBothCacheTypes, TestZoneMaps) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  // The generator writes the value 'row * 10' for each row.
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE | WRITE_ZONE_MAPS, &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_zone_maps());
+  ASSERT_EQ(kNumRows, reader->footer().file_zone_map().num_values());
+  ASSERT_EQ(0, reader->footer().file_zone_map().null_count());
+
+  ColumnSchema col("c", UINT32);
+  uint32_t lower = 5000;
+  uint32_t upper = 5010;
+  uint32_t missing = kNumRows * 10;
+  ColumnPredicate range = ColumnPredicate::Range(col, &lower, &upper);
+  ColumnPredicate eq_missing = ColumnPredicate::Equality(col, &missing);
+  ColumnPredicate is_null = ColumnPredicate::IsNull(ColumnSchema("c", UINT32, true));
+  ColumnPredicate is_not_null = ColumnPredicate::IsNotNull(col);
+
+  bool may_match;
+  // Row 500 holds the only matching value, so blocks far from it are pruned.
+  ASSERT_OK(reader->ZoneMapsMayMatch(range, 0, 100, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(reader->ZoneMapsMayMatch(range, 9000, 1000, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(reader->ZoneMapsMayMatch(range, 400, 200, &may_match));
+  ASSERT_TRUE(may_match);
+  ASSERT_OK(reader->ZoneMapsMayMatch(range, 0, kNumRows, &may_match));
+  ASSERT_TRUE(may_match);
+
+  // Values outside of the file's range are pruned by the file-wide zone map.
+  ASSERT_OK(reader->ZoneMapsMayMatch(eq_missing, 0, kNumRows, &may_match));
+  ASSERT_FALSE(may_match);
+
+  ASSERT_OK(reader->ZoneMapsMayMatch(is_null, 0, kNumRows, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(reader->ZoneMapsMayMatch(is_not_null, 0, kNumRows, &may_match));
+  ASSERT_TRUE(may_match);
+
+  // Files written without zone maps never rule anything out.
+  generator.Reset();
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE, &block_id);
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_zone_maps());
+  ASSERT_OK(reader->ZoneMapsMayMatch(eq_missing, 0, kNumRows, &may_match));
+  ASSERT_TRUE(may_match);
+}
+
+TEST_P(TestCFileBothCacheTypes, TestColumnStats) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE | WRITE_ZONE_MAPS, &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_column_stats());
+
+  // The counts and bounds are those of the file's zone map.
+  ColumnStatsPB stats;
+  ASSERT_OK(reader->ReadColumnStats(&stats));
+  const ZoneMapPB& zone_map = reader->footer().file_zone_map();
+  ASSERT_EQ(kNumRows, stats.num_values());
+  ASSERT_EQ(0, stats.null_count());
+  ASSERT_EQ(zone_map.min_value(), stats.min_value());
+  ASSERT_EQ(zone_map.max_value(), stats.max_value());
+
+  // Every value is distinct.
+  ASSERT_NEAR(kNumRows, EstimateDistinctValues(stats), kNumRows / 10);
+  ASSERT_GT(stats.histogram_bounds_size(), 0);
+  ASSERT_GE(stats.histogram_bounds(0), stats.min_value());
+  ASSERT_LE(stats.histogram_bounds(stats.histogram_bounds_size() - 1), stats.max_value());
+
+  // Files written without zone maps have no statistics either.
+  generator.Reset();
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE, &block_id);
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_column_stats());
+  Status s = reader->ReadColumnStats(&stats);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRowsInts) {
+  UInt32DataGenerator<false> generator;
+  NO_FATALS(TestSkipUnselectedRows(&generator, BIT_SHUFFLE));
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRowsNullableInts) {
+  UInt32DataGenerator<true> generator;
+  NO_FATALS(TestSkipUnselectedRows(&generator, RLE));
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRowsRleInts) {
+  UInt32DataGenerator<false> generator;
+  NO_FATALS(TestSkipUnselectedRows(&generator, RLE));
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRowsDictStrings) {
+  StringDataGenerator<true> generator("hello %zu");
+  NO_FATALS(TestSkipUnselectedRows(&generator, DICT_ENCODING));
+}
+
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRowsPrefixStrings) {
+  StringDataGenerator<false> generator("hello %zu");
+  NO_FATALS(TestSkipUnselectedRows(&generator, PREFIX_ENCODING));
+}
+
 // Tests that the block cache keys used by CFileReaders are stable. That is,
 // different reader instances operating on the same block should use the same
 // block cache keys.
@@ -1029,6 +1311,87 @@ TEST_P(TestCFileBothCacheTypes, TestCacheKeysAreStable) {
   }
 }
 
+// Tests that prefetched blocks are served from the block cache.
+TEST_P(TestCFileBothCacheTypes, TestPrefetchBlocks) {
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, SMALL_BLOCKSIZE, &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  size_t bytes_read = 0;
+  unique_ptr<ReadableBlock> count_block(
+      new CountingReadableBlock(std::move(block), &bytes_read));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(count_block), ReaderOptions(), &reader));
+
+  // Prefetch every other data block, then all of them.
+  vector<BlockPointer> even_ptrs;
+  vector<BlockPointer> all_ptrs;
+  gscoped_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+  do {
+    if (all_ptrs.size() % 2 == 0) {
+      even_ptrs.push_back(iter->GetCurrentBlockPointer());
+    }
+    all_ptrs.push_back(iter->GetCurrentBlockPointer());
+  } while (iter->Next().ok());
+  ASSERT_GT(all_ptrs.size(), 2);
+
+  ASSERT_OK(reader->PrefetchBlocks(even_ptrs));
+  ASSERT_OK(reader->PrefetchBlocks(all_ptrs));
+
+  // Reading the blocks now does no IO.
+  bytes_read = 0;
+  for (const auto& ptr : all_ptrs) {
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(ptr, CFileReader::CACHE_BLOCK, &bh));
+    ASSERT_EQ(ptr.size() - (reader->has_checksums() ? kChecksumSize : 0), bh.data().size());
+  }
+  ASSERT_EQ(0, bytes_read);
+}
+
+// Tests that a scan which reads ahead reads the same data, and no more of it,
+// than one which doesn't.
+TEST_P(TestCFileBothCacheTypes, TestReadahead) {
+  const int kNumRows = 100000;
+  size_t bytes_read[2];
+  for (int readahead = 0; readahead < 2; readahead++) {
+    FLAGS_cfile_readahead_max_blocks = readahead ? 4 : 0;
+    BlockId block_id;
+    UInt32DataGenerator<false> generator;
+    WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE,
+                  &block_id);
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    bytes_read[readahead] = 0;
+    unique_ptr<ReadableBlock> count_block(
+        new CountingReadableBlock(std::move(block), &bytes_read[readahead]));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(count_block), ReaderOptions(), &reader));
+
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToOrdinal(0));
+    ScopedColumnBlock<UINT32> cb(1000);
+    SelectionVector sel(cb.nrows());
+    ColumnMaterializationContext ctx(0, nullptr, &cb, &sel);
+    ctx.SetDecoderEvalNotSupported();
+    uint32_t row = 0;
+    while (iter->HasNext()) {
+      size_t n = cb.nrows();
+      ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+      for (size_t i = 0; i < n; i++, row++) {
+        ASSERT_EQ(row * 10, cb[i]);
+      }
+    }
+    ASSERT_EQ(kNumRows, row);
+  }
+  ASSERT_EQ(bytes_read[0], bytes_read[1]);
+}
+
 #if defined(__linux__)
 // Inject failures in nvm allocation and ensure that we can still read a file.
 TEST_P(TestCFileBothCacheTypes, TestNvmAllocationFailure) {
@@ -1043,7 +1406,7 @@ class TestCFileDifferentCodecs : public TestCFile,
 };
 
 INSTANTIATE_TEST_CASE_P(Codecs, TestCFileDifferentCodecs,
-                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB));
+                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB, ZSTD));
 
 // Read/write a file with uncompressible data (random int32s)
 TEST_P(TestCFileDifferentCodecs, TestUncompressible) {
@@ -36,6 +36,7 @@
 #include "kudu/cfile/cfile_writer.h" // for kMagicString
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
@@ -47,8 +48,10 @@
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/move.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/cache.h"
@@ -56,16 +59,19 @@
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
@@ -76,6 +82,40 @@ DEFINE_bool(cfile_verify_checksums, true,
             "Verify the checksum for each block on read if one exists");
 TAG_FLAG(cfile_verify_checksums, evolving);
 
+DEFINE_int32(cfile_readahead_max_blocks, 8,
+             "Maximum number of data blocks which a sequential scan of a CFile "
+             "prefetches into the block cache ahead of the block being read. "
+             "The read-ahead window starts small and grows whenever the scan "
+             "catches up with it. 0 disables read-ahead.");
+TAG_FLAG(cfile_readahead_max_blocks, experimental);
+TAG_FLAG(cfile_readahead_max_blocks, runtime);
+
+DEFINE_bool(cfile_cache_compressed_blocks, false,
+            "Whether to keep the blocks of compressed CFiles compressed in the block "
+            "cache, decompressing them on every cache hit. This fits several times "
+            "more blocks in the same cache capacity at the cost of CPU.");
+TAG_FLAG(cfile_cache_compressed_blocks, experimental);
+
+DEFINE_int32(cfile_readahead_threads, 8,
+             "Number of threads which prefetch CFile blocks for sequential scans.");
+TAG_FLAG(cfile_readahead_threads, experimental);
+
+DEFINE_bool(cfile_zero_copy_strings, false,
+            "Whether scans of plain and dictionary encoded string columns "
+            "return cells pointing into the pinned CFile blocks, rather than "
+            "copying each string into the scan's arena. The blocks remain "
+            "pinned in the block cache until the scan moves on to its next "
+            "batch.");
+TAG_FLAG(cfile_zero_copy_strings, experimental);
+
+DEFINE_bool(cfile_mmap_uncompressed_blocks, false,
+            "Whether the blocks of uncompressed CFiles are read from a memory "
+            "mapping of the file rather than copied into the block cache. This "
+            "saves CPU on fast storage, but the mapped pages are only cached by "
+            "the page cache, block checksums are verified on every read, and "
+            "a disk error while reading from a mapping crashes the process.");
+TAG_FLAG(cfile_mmap_uncompressed_blocks, experimental);
+
 using kudu::fs::ReadableBlock;
 using kudu::pb_util::SecureDebugString;
 using std::string;
@@ -181,6 +221,14 @@ Status CFileReader::InitOnce() {
                                       footer_->encoding(),
                                       &type_encoding_info_));
 
+  if (FLAGS_cfile_mmap_uncompressed_blocks && codec_ == nullptr) {
+    Status s = block_->Map(&mapping_);
+    if (!s.ok() && !s.IsNotSupported()) {
+      LOG(WARNING) << Substitute("unable to map CFile $0, reading it instead: $1",
+                                 block_id().ToString(), s.ToString());
+    }
+  }
+
   VLOG(2) << "Initialized CFile reader. "
           << "Header: " << SecureDebugString(*header_)
           << " Footer: " << SecureDebugString(*footer_)
@@ -312,10 +360,107 @@ Status CFileReader::ReadAndParseFooter() {
   return Status::OK();
 }
 
+bool CFileReader::caches_compressed_blocks() const {
+  return codec_ != nullptr && FLAGS_cfile_cache_compressed_blocks;
+}
+
 bool CFileReader::has_checksums() const {
   return footer_->incompatible_features() & IncompatibleFeatures::CHECKSUM;
 }
 
+bool CFileReader::has_zone_maps() const {
+  return (footer_->compatible_features() & CompatibleFeatures::ZONE_MAPS) &&
+      footer_->has_zone_maps_block_ptr();
+}
+
+Status CFileReader::ReadZoneMapsOnce() {
+  BlockHandle handle;
+  BlockPointer ptr(footer().zone_maps_block_ptr());
+  RETURN_NOT_OK(ReadBlock(ptr, CACHE_BLOCK, &handle, BlockCache::INDEX_BLOCK));
+  gscoped_ptr<ZoneMapBlockPB> zone_maps(new ZoneMapBlockPB());
+  if (!zone_maps->ParseFromArray(handle.data().data(), handle.data().size())) {
+    return Status::Corruption(Substitute("unable to parse zone maps of CFile block $0 at $1",
+                                         block_id().ToString(), ptr.ToString()));
+  }
+  zone_maps_ = std::move(zone_maps);
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
+Status CFileReader::ZoneMapsMayMatch(const ColumnPredicate& pred,
+                                     rowid_t first_row,
+                                     size_t num_rows,
+                                     bool* may_match) {
+  *may_match = true;
+  RETURN_NOT_OK(Init());
+  if (!has_zone_maps() || num_rows == 0) {
+    return Status::OK();
+  }
+  if (!ZoneMapMayMatch(pred, footer().file_zone_map())) {
+    *may_match = false;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(zone_maps_once_.Init(&CFileReader::ReadZoneMapsOnce, this));
+
+  // Find the first block containing 'first_row', then check every block
+  // overlapping the requested range until one may match.
+  const auto& entries = zone_maps_->zone_maps();
+  auto it = std::upper_bound(entries.begin(), entries.end(), first_row,
+                             [](rowid_t row, const ZoneMapPB& zm) {
+                               return row < zm.first_ordinal();
+                             });
+  if (it == entries.begin()) {
+    return Status::OK();
+  }
+  const int64_t end_row = static_cast<int64_t>(first_row) + num_rows;
+  int64_t covered_end_row = first_row;
+  for (--it; it != entries.end() && it->first_ordinal() < end_row; ++it) {
+    if (ZoneMapMayMatch(pred, *it)) {
+      return Status::OK();
+    }
+    covered_end_row = it->first_ordinal() + it->num_values();
+  }
+  // Only rule out the range if the zone maps covered all of it.
+  *may_match = covered_end_row < end_row;
+  return Status::OK();
+}
+
+Status CFileReader::GetBlockZoneMaps(const ZoneMapBlockPB** zone_maps) {
+  RETURN_NOT_OK(Init());
+  DCHECK(has_zone_maps());
+  RETURN_NOT_OK(zone_maps_once_.Init(&CFileReader::ReadZoneMapsOnce, this));
+  *zone_maps = zone_maps_.get();
+  return Status::OK();
+}
+
+bool CFileReader::has_column_stats() const {
+  return has_zone_maps() &&
+      (footer_->compatible_features() & CompatibleFeatures::COLUMN_STATS) &&
+      footer_->has_column_stats_block_ptr();
+}
+
+Status CFileReader::ReadColumnStats(ColumnStatsPB* stats) {
+  RETURN_NOT_OK(Init());
+  if (!has_column_stats()) {
+    return Status::NotFound("no column stats in CFile", block_id().ToString());
+  }
+  BlockHandle handle;
+  BlockPointer ptr(footer().column_stats_block_ptr());
+  RETURN_NOT_OK(ReadBlock(ptr, DONT_CACHE_BLOCK, &handle, BlockCache::INDEX_BLOCK));
+  if (!stats->ParseFromArray(handle.data().data(), handle.data().size())) {
+    return Status::Corruption(Substitute("unable to parse column stats of CFile block $0 at $1",
+                                         block_id().ToString(), ptr.ToString()));
+  }
+  const ZoneMapPB& zone_map = footer().file_zone_map();
+  stats->set_num_values(zone_map.num_values());
+  stats->set_null_count(zone_map.null_count());
+  if (zone_map.has_min_value()) {
+    stats->set_min_value(zone_map.min_value());
+    stats->set_max_value(zone_map.max_value());
+  }
+  return Status::OK();
+}
+
 Status CFileReader::VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const {
   uint32_t expected_checksum = DecodeFixed32(checksum.data());
   uint32_t checksum_value = 0;
@@ -330,8 +475,6 @@ Status CFileReader::VerifyChecksum(ArrayView<const Slice> data, const Slice& che
   return Status::OK();
 }
 
-namespace {
-
 // ScratchMemory acts as a holder for the destination buffer for a block read.
 // The buffer itself could either be allocated on the heap or be the value of
 // a pending block cache entry.
@@ -359,9 +502,10 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key,
+                            BlockCache::BlockType type, int size) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, size, type);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -415,23 +559,29 @@ class ScratchMemory {
   int size_;
   DISALLOW_COPY_AND_ASSIGN(ScratchMemory);
 };
-} // anonymous namespace
 
 Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                              BlockHandle *ret) const {
+                              BlockHandle *ret, BlockCache::BlockType block_type) const {
   DCHECK(init_once_.init_succeeded());
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
     "bad offset " << ptr.ToString() << " in file of size "
                   << file_size_;
+  if (mapping_) {
+    return ReadMappedBlock(ptr, ret);
+  }
+
   BlockCacheHandle bc_handle;
   Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
       Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
   BlockCache* cache = BlockCache::GetSingleton();
   BlockCache::CacheKey key(block_->id(), ptr.offset());
-  if (cache->Lookup(key, cache_behavior, &bc_handle)) {
+  if (cache->Lookup(key, cache_behavior, &bc_handle, block_type)) {
     TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
+    if (caches_compressed_blocks()) {
+      return DecompressCachedBlock(ptr, bc_handle.data(), ret);
+    }
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
     // Cache hit
     return Status::OK();
@@ -446,6 +596,25 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
   TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
 
+  ScratchMemory scratch;
+  uint32_t data_size;
+  RETURN_NOT_OK(AllocateBlockScratch(ptr, cache_control, block_type, &scratch, &data_size));
+  Slice block(scratch.get(), data_size);
+  uint8_t checksum_scratch[kChecksumSize];
+  Slice checksum(checksum_scratch, kChecksumSize);
+
+  // Read the data and checksum if needed.
+  Slice results_backing[] = { block, checksum };
+  bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
+  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
+  RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
+                        Substitute("failed to read CFile block $0 at $1",
+                                   block_id().ToString(), ptr.ToString()));
+  return FinishReadBlock(ptr, cache_control, block_type, &scratch, data_size, checksum, ret);
+}
+
+Status CFileReader::ReadMappedBlock(const BlockPointer& ptr, BlockHandle* ret) const {
+  TRACE_COUNTER_INCREMENT("cfile_mapped_reads", 1);
   uint32_t data_size = ptr.size();
   if (has_checksums()) {
     if (PREDICT_FALSE(kChecksumSize > data_size)) {
@@ -454,28 +623,125 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     }
     data_size -= kChecksumSize;
   }
+  Slice block(mapping_->data().data() + ptr.offset(), data_size);
 
-  ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, data_size);
+  if (has_checksums() && FLAGS_cfile_verify_checksums) {
+    Slice checksum(block.data() + data_size, kChecksumSize);
+    RETURN_NOT_OK_PREPEND(VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum),
+                          Substitute("checksum error on CFile block $0 at $1",
+                                     block_id().ToString(), ptr.ToString()));
+  }
+  *ret = BlockHandle::WithMappedData(mapping_, block);
+  return Status::OK();
+}
+
+Status CFileReader::PrefetchBlocks(const vector<BlockPointer>& ptrs) const {
+  DCHECK(init_once_.init_succeeded());
+  TRACE_EVENT1("io", "CFileReader::PrefetchBlocks", "cfile", ToString());
+  if (mapping_) {
+    // Blocks are read from the mapping, so there's no cache to fill.
+    return Status::OK();
+  }
+  BlockCache* cache = BlockCache::GetSingleton();
+
+  size_t i = 0;
+  while (i < ptrs.size()) {
+    // Gather the next run of adjacent blocks which are missing from the cache.
+    // The checksums lie between the blocks' data, so they're always read.
+    vector<unique_ptr<ScratchMemory>> scratches;
+    vector<uint32_t> data_sizes;
+    vector<Slice> slices;
+    faststring checksums;
+    size_t run_start = i;
+    for (; i < ptrs.size(); i++) {
+      const BlockPointer& ptr = ptrs[i];
+      if (PREDICT_FALSE(ptr.offset() == 0 || ptr.offset() + ptr.size() >= file_size_)) {
+        return Status::Corruption("bad block pointer", ptr.ToString());
+      }
+      if (i > run_start &&
+          ptrs[i - 1].offset() + ptrs[i - 1].size() != ptr.offset()) {
+        break;
+      }
+      BlockCacheHandle bc_handle;
+      if (cache->Lookup(BlockCache::CacheKey(block_->id(), ptr.offset()),
+                        Cache::NO_EXPECT_IN_CACHE, &bc_handle)) {
+        if (i == run_start) {
+          run_start++;
+          continue;
+        }
+        break;
+      }
+      unique_ptr<ScratchMemory> scratch(new ScratchMemory());
+      uint32_t data_size;
+      RETURN_NOT_OK(AllocateBlockScratch(ptr, CACHE_BLOCK, BlockCache::DATA_BLOCK,
+                                         scratch.get(), &data_size));
+      slices.emplace_back(scratch->get(), data_size);
+      if (has_checksums()) {
+        // Placeholder; pointed at 'checksums' once it's no longer resized.
+        slices.emplace_back();
+      }
+      scratches.emplace_back(std::move(scratch));
+      data_sizes.push_back(data_size);
+    }
+    if (scratches.empty()) {
+      continue;
+    }
+    if (has_checksums()) {
+      checksums.resize(scratches.size() * kChecksumSize);
+      for (size_t j = 0; j < scratches.size(); j++) {
+        slices[2 * j + 1] = Slice(&checksums[j * kChecksumSize], kChecksumSize);
+      }
+    }
+
+    TRACE_COUNTER_INCREMENT("cfile_prefetched_blocks", scratches.size());
+    const BlockPointer& first = ptrs[run_start];
+    RETURN_NOT_OK_PREPEND(block_->ReadV(first.offset(), ArrayView<Slice>(slices)),
+                          Substitute("failed to prefetch CFile blocks $0 at $1",
+                                     block_id().ToString(), first.ToString()));
+    for (size_t j = 0; j < scratches.size(); j++) {
+      BlockHandle unused;
+      Slice checksum = has_checksums() ? slices[2 * j + 1] : Slice();
+      RETURN_NOT_OK(FinishReadBlock(ptrs[run_start + j], CACHE_BLOCK, BlockCache::DATA_BLOCK,
+                                    scratches[j].get(), data_sizes[j], checksum, &unused));
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileReader::AllocateBlockScratch(const BlockPointer& ptr, CacheControl cache_control,
+                                         BlockCache::BlockType block_type,
+                                         ScratchMemory* scratch, uint32_t* data_size) const {
+  *data_size = ptr.size();
+  if (has_checksums()) {
+    if (PREDICT_FALSE(kChecksumSize > *data_size)) {
+      return Status::Corruption("invalid data size for block pointer",
+                                ptr.ToString());
+    }
+    *data_size -= kChecksumSize;
+  }
+
+  // If we plan to cache the data as it is read (i.e. it is uncompressed, or
+  // compressed blocks are cached as-is), then we should allocate our scratch
+  // memory directly from the cache. This avoids an extra memory copy in the
+  // case of an NVM cache.
+  if ((codec_ == nullptr || caches_compressed_blocks()) && cache_control == CACHE_BLOCK) {
+    scratch->TryAllocateFromCache(BlockCache::GetSingleton(),
+                                  BlockCache::CacheKey(block_->id(), ptr.offset()),
+                                  block_type, *data_size);
   } else {
-    scratch.AllocateFromHeap(data_size);
+    scratch->AllocateFromHeap(*data_size);
   }
-  uint8_t* buf = scratch.get();
-  Slice block(buf, data_size);
-  uint8_t checksum_scratch[kChecksumSize];
-  Slice checksum(checksum_scratch, kChecksumSize);
+  return Status::OK();
+}
 
-  // Read the data and checksum if needed.
-  Slice results_backing[] = { block, checksum };
-  bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
-  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
-  RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
-                        Substitute("failed to read CFile block $0 at $1",
-                                   block_id().ToString(), ptr.ToString()));
+Status CFileReader::FinishReadBlock(const BlockPointer& ptr, CacheControl cache_control,
+                                    BlockCache::BlockType block_type,
+                                    ScratchMemory* scratch, uint32_t data_size,
+                                    const Slice& checksum, BlockHandle* ret) const {
+  BlockCache* cache = BlockCache::GetSingleton();
+  BlockCache::CacheKey key(block_->id(), ptr.offset());
+  uint8_t* buf = scratch->get();
+  Slice block(buf, data_size);
 
   if (has_checksums() && FLAGS_cfile_verify_checksums) {
     RETURN_NOT_OK_PREPEND(VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum),
@@ -483,6 +749,16 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
                                      block_id().ToString(), ptr.ToString()));
   }
 
+  if (caches_compressed_blocks() && cache_control == CACHE_BLOCK &&
+      scratch->IsFromCache()) {
+    // Cache the block as it was read, and return a decompressed copy.
+    BlockCacheHandle bc_handle;
+    cache->Insert(scratch->mutable_pending_entry(), &bc_handle);
+    cache->RecordBlockRead(key, ptr.size(), block_type);
+    ignore_result(scratch->release());
+    return DecompressCachedBlock(ptr, bc_handle.data(), ret);
+  }
+
   // Decompress the block
   if (codec_ != nullptr) {
     // Init the decompressor and get the size required for the uncompressed buffer.
@@ -499,8 +775,8 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // If we plan to put the uncompressed block in the cache, we should
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
     ScratchMemory decompressed_scratch;
-    if (cache_control == CACHE_BLOCK) {
-      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
+    if (cache_control == CACHE_BLOCK && !caches_compressed_blocks()) {
+      decompressed_scratch.TryAllocateFromCache(cache, key, block_type, uncompressed_size);
     } else {
       decompressed_scratch.AllocateFromHeap(uncompressed_size);
     }
@@ -514,7 +790,7 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // Now that we've decompressed, we don't need to keep holding onto the original
     // scratch buffer. Instead, we have to start holding onto our decompression
     // output buffer.
-    scratch.Swap(&decompressed_scratch);
+    scratch->Swap(&decompressed_scratch);
 
     // Set the result block to our decompressed data.
     block = Slice(buf, uncompressed_size);
@@ -523,15 +799,17 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // and just return a Slice into an mmapped region (or in-memory region).
     // But, this is hard to program against in terms of cache management, etc,
     // so we memcpy into our scratch buffer if necessary.
-    block.relocate(scratch.get());
+    block.relocate(scratch->get());
   }
 
   // It's possible that one of the TryAllocateFromCache() calls above
   // failed, in which case we don't insert it into the cache regardless
   // of what the user requested. The scratch memory includes both the
   // generated key and the data read from disk.
-  if (cache_control == CACHE_BLOCK && scratch.IsFromCache()) {
-    cache->Insert(scratch.mutable_pending_entry(), &bc_handle);
+  if (cache_control == CACHE_BLOCK && scratch->IsFromCache()) {
+    BlockCacheHandle bc_handle;
+    cache->Insert(scratch->mutable_pending_entry(), &bc_handle);
+    cache->RecordBlockRead(key, ptr.size(), block_type);
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
   } else {
     // We get here by either not intending to cache the block or
@@ -539,17 +817,38 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // Since we allocate memory to include the key for the cache entry
     // we must reset the block.
     DCHECK_EQ(block.data(), buf);
-    DCHECK(!scratch.IsFromCache());
-    *ret = BlockHandle::WithOwnedData(scratch.as_slice());
+    DCHECK(!scratch->IsFromCache());
+    *ret = BlockHandle::WithOwnedData(scratch->as_slice());
   }
 
   // The cache or the BlockHandle now has ownership over the memory, so release
   // the scoped pointer.
-  ignore_result(scratch.release());
+  ignore_result(scratch->release());
 
   return Status::OK();
 }
 
+Status CFileReader::DecompressCachedBlock(const BlockPointer& ptr, const Slice& compressed,
+                                          BlockHandle* ret) const {
+  MonoTime start = MonoTime::Now();
+  CompressedBlockDecoder uncompressor(codec_, cfile_version_, compressed);
+  RETURN_NOT_OK_PREPEND(uncompressor.Init(),
+                        Substitute("unable to validate compressed CFile block $0 at $1",
+                                   block_id().ToString(), ptr.ToString()));
+  ScratchMemory decompressed;
+  decompressed.AllocateFromHeap(uncompressor.uncompressed_size());
+  RETURN_NOT_OK_PREPEND(uncompressor.UncompressIntoBuffer(decompressed.get()),
+                        Substitute("unable to uncompress CFile block $0 at $1",
+                                   block_id().ToString(), ptr.ToString()));
+  *ret = BlockHandle::WithOwnedData(decompressed.as_slice());
+  ignore_result(decompressed.release());
+
+  int64_t micros = (MonoTime::Now() - start).ToMicroseconds();
+  TRACE_COUNTER_INCREMENT("cfile_cache_decompress_us", micros);
+  BlockCache::GetSingleton()->RecordDecompression(uncompressor.uncompressed_size(), micros);
+  return Status::OK();
+}
+
 Status CFileReader::CountRows(rowid_t *count) const {
   *count = footer().num_values();
   return Status::OK();
@@ -590,6 +889,9 @@ size_t CFileReader::memory_footprint() const {
   if (footer_) {
     size += footer_->SpaceUsed();
   }
+  if (zone_maps_) {
+    size += zone_maps_->SpaceUsed();
+  }
   return size;
 }
 
@@ -654,6 +956,32 @@ Status DefaultColumnValueIterator::FinishBatch() {
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
+namespace {
+
+// The number of blocks in the first read-ahead window of a scan.
+const int kMinReadaheadBlocks = 2;
+
+// Holds the thread pool on which all CFileIterators prefetch blocks.
+class ReadaheadPool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<ReadaheadPool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<ReadaheadPool>;
+
+  ReadaheadPool() {
+    CHECK_OK(ThreadPoolBuilder("cfile-readahead")
+             .set_max_threads(FLAGS_cfile_readahead_threads)
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
+
+} // anonymous namespace
+
 CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control)
   : reader_(reader),
@@ -661,10 +989,18 @@ CFileIterator::CFileIterator(CFileReader* reader,
     prepared_(false),
     cache_control_(cache_control),
     last_prepare_idx_(-1),
-    last_prepare_count_(-1) {
+    last_prepare_count_(-1),
+    zero_copy_strings_(false),
+    readahead_exhausted_(false),
+    readahead_depth_(0),
+    readahead_trigger_offset_(0),
+    readahead_windows_in_flight_(0) {
 }
 
 CFileIterator::~CFileIterator() {
+  if (readahead_token_) {
+    readahead_token_->Shutdown();
+  }
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -848,6 +1184,14 @@ Status CFileIterator::PrepareForNewSeek() {
   // If it's already initialized, this is a no-op.
   RETURN_NOT_OK(reader_->Init());
 
+  zero_copy_strings_ = FLAGS_cfile_zero_copy_strings &&
+      reader_->type_info()->physical_type() == BINARY;
+
+  // Start reading ahead afresh from wherever the scan continues.
+  readahead_iter_.reset();
+  readahead_exhausted_ = false;
+  readahead_trigger_offset_ = 0;
+
   // Create the index tree iterators if we haven't already done so.
   if (!posidx_iter_ && reader_->footer().has_posidx_info()) {
     BlockPointer bp(reader_->footer().posidx_info().root_block());
@@ -864,10 +1208,13 @@ Status CFileIterator::PrepareForNewSeek() {
     BlockPointer bp(reader_->footer().dict_block_ptr());
 
     // Cache the dictionary for performance
-    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK, &dict_block_handle_),
+    BlockHandle dict_block;
+    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK, &dict_block,
+                                             BlockCache::DICTIONARY_BLOCK),
                           "couldn't read dictionary block");
+    dict_block_handle_ = std::make_shared<BlockHandle>(std::move(dict_block));
 
-    dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_.data()));
+    dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_->data()));
     RETURN_NOT_OK_PREPEND(dict_decoder_->ParseHeader(),
                           Substitute("couldn't parse dictionary block header in block $0 ($1)",
                                      reader_->block_id().ToString(),
@@ -914,10 +1261,12 @@ Status DecodeNullInfo(Slice *data_block, uint32_t *num_rows_in_block, Slice *nul
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
   prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
-  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_, &prep_block->dblk_data_));
+  BlockHandle dblk_data;
+  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_, &dblk_data));
+  prep_block->dblk_data_ = std::make_shared<BlockHandle>(std::move(dblk_data));
 
   uint32_t num_rows_in_block = 0;
-  Slice data_block = prep_block->dblk_data_.data();
+  Slice data_block = prep_block->dblk_data_->data();
   if (reader_->is_nullable()) {
     RETURN_NOT_OK(DecodeNullInfo(&data_block, &num_rows_in_block, &(prep_block->rle_bitmap)));
     prep_block->rle_decoder_ = RleDecoder<bool>(prep_block->rle_bitmap.data(),
@@ -952,6 +1301,67 @@ Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
   return Status::OK();
 }
 
+void CFileIterator::MaybeReadAhead(const BlockPointer& cur) {
+  const int max_depth = FLAGS_cfile_readahead_max_blocks;
+  if (max_depth <= 0 || cache_control_ != CFileReader::CACHE_BLOCK ||
+      seeked_ != posidx_iter_.get() || readahead_exhausted_) {
+    return;
+  }
+  if (!readahead_iter_) {
+    // Start reading ahead from the current block.
+    readahead_iter_.reset(IndexTreeIterator::Create(reader_, reader_->posidx_root()));
+    Status s = readahead_iter_->SeekAtOrBefore(seeked_->GetCurrentKey());
+    if (!s.ok()) {
+      readahead_exhausted_ = true;
+      return;
+    }
+    readahead_depth_ = std::min(kMinReadaheadBlocks, max_depth);
+    readahead_trigger_offset_ = cur.offset();
+  }
+  if (cur.offset() < readahead_trigger_offset_) {
+    return;
+  }
+  if (readahead_windows_in_flight_.load() > 0) {
+    // The scan caught up with the read-ahead. Wait for it rather than read
+    // the same blocks again, and read further ahead from now on.
+    readahead_token_->Wait();
+    readahead_depth_ = std::min(readahead_depth_ * 2, max_depth);
+  }
+
+  vector<BlockPointer> ptrs;
+  while (ptrs.size() < static_cast<size_t>(readahead_depth_)) {
+    if (!readahead_iter_->Next().ok()) {
+      readahead_exhausted_ = true;
+      break;
+    }
+    ptrs.push_back(readahead_iter_->GetCurrentBlockPointer());
+  }
+  if (ptrs.empty()) {
+    return;
+  }
+  readahead_trigger_offset_ = ptrs.front().offset();
+
+  if (!readahead_token_) {
+    readahead_token_ = ReadaheadPool::Get()->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  }
+  readahead_windows_in_flight_++;
+  const CFileReader* reader = reader_;
+  std::atomic<int>* in_flight = &readahead_windows_in_flight_;
+  Status s = readahead_token_->SubmitFunc([reader, ptrs, in_flight]() {
+    Status s = reader->PrefetchBlocks(ptrs);
+    if (!s.ok()) {
+      // The scan reads the blocks itself, and reports any errors then.
+      KLOG_EVERY_N_SECS(WARNING, 1) << "Unable to prefetch blocks of CFile "
+                                    << reader->ToString() << ": " << s.ToString();
+    }
+    (*in_flight)--;
+  });
+  if (!s.ok()) {
+    readahead_windows_in_flight_--;
+    readahead_exhausted_ = true;
+  }
+}
+
 Status CFileIterator::QueueCurrentDataBlock(const IndexTreeIterator &idx_iter) {
   pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
     prepared_block_pool_.Construct());
@@ -986,6 +1396,7 @@ Status CFileIterator::PrepareBatch(size_t *n) {
     } else if (!s.ok()) {
       return s;
     }
+    MaybeReadAhead(seeked_->GetCurrentBlockPointer());
     RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
   }
 
@@ -1074,7 +1485,9 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   if (dict_decoder_ && ctx->DecoderEvalNotDisabled() && !codewords_matching_pred_) {
     size_t nwords = dict_decoder_->Count();
     if (nwords > 0) {
-      codewords_matching_pred_.reset(new SelectionVector(nwords));
+      // Round up to whole 32-bit words so that the bitmap can be probed with
+      // gathers (see predicate_kernels::EvaluateDictionaryCodes()).
+      codewords_matching_pred_.reset(new SelectionVector(KUDU_ALIGN_UP(nwords, 32)));
       codewords_matching_pred_->SetAllFalse();
       for (size_t i = 0; i < nwords; i++) {
         Slice cur_string = dict_decoder_->string_at_index(i);
@@ -1084,7 +1497,16 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
       }
     }
   }
+  // The cells of zero-copy strings point into the blocks, which must remain
+  // pinned for as long as the destination arena holds the cells.
+  Arena* arena = ctx->block()->arena();
+  if (zero_copy_strings_ && dict_block_handle_) {
+    arena->RetainReference(dict_block_handle_);
+  }
   for (PreparedBlock *pb : prepared_blocks_) {
+    if (zero_copy_strings_) {
+      arena->RetainReference(pb->dblk_data_);
+    }
     if (pb->needs_rewind_) {
       // Seek back to the saved position.
       SeekToPositionInBlock(pb, pb->rewind_idx_);
@@ -1115,7 +1537,7 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
                                                      &remaining_sel,
                                                      &remaining_dst));
           } else {
-            RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
+            RETURN_NOT_OK(CopyNextValues(pb, ctx, remaining_sel, &this_batch, &remaining_dst));
           }
           DCHECK_EQ(nblock, this_batch);
           pb->needs_rewind_ = true;
@@ -1146,7 +1568,7 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
       if (ctx->DecoderEvalNotDisabled()) {
         RETURN_NOT_OK(pb->dblk_->CopyNextAndEval(&this_batch, ctx, &remaining_sel, &remaining_dst));
       } else {
-        RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
+        RETURN_NOT_OK(CopyNextValues(pb, ctx, remaining_sel, &this_batch, &remaining_dst));
       }
       pb->needs_rewind_ = true;
       DCHECK_LE(this_batch, rem);
@@ -1176,6 +1598,17 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   return Status::OK();
 }
 
+Status CFileIterator::CopyNextValues(PreparedBlock* pb,
+                                     ColumnMaterializationContext* ctx,
+                                     const SelectionVectorView& sel,
+                                     size_t* n,
+                                     ColumnDataView* dst) {
+  if (!ctx->SkipUnselectedRows()) {
+    return pb->dblk_->CopyNextValues(n, dst);
+  }
+  return pb->dblk_->CopySelectedValues(n, sel, dst);
+}
+
 Status CFileIterator::CopyNextValues(size_t* n, ColumnMaterializationContext* ctx) {
   RETURN_NOT_OK(PrepareBatch(n));
   RETURN_NOT_OK(Scan(ctx));
@@ -18,6 +18,7 @@
 #ifndef KUDU_CFILE_CFILE_READER_H
 #define KUDU_CFILE_CFILE_READER_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -26,6 +27,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
@@ -48,10 +50,16 @@
 
 namespace kudu {
 
+class ColumnDataView;
 class ColumnMaterializationContext;
+class ColumnPredicate;
+class ColumnStatsPB;
 class CompressionCodec;
 class EncodedKey;
+class FileMapping;
 class SelectionVector;
+class SelectionVectorView;
+class ThreadPoolToken;
 class TypeInfo;
 
 template <typename T> class ArrayView;
@@ -61,6 +69,7 @@ namespace cfile {
 class BinaryPlainBlockDecoder;
 class CFileIterator;
 class IndexTreeIterator;
+class ScratchMemory;
 class TypeEncodingInfo;
 struct ReaderOptions;
 
@@ -106,8 +115,16 @@ class CFileReader {
 
   // TODO: make this private? should only be used
   // by the iterator and index tree readers, I think.
+  //
+  // 'block_type' determines the block cache pool and metrics of the block.
   Status ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                   BlockHandle *ret) const;
+                   BlockHandle *ret,
+                   BlockCache::BlockType block_type = BlockCache::DATA_BLOCK) const;
+
+  // Reads those blocks of 'ptrs' which are not already in the block cache
+  // and inserts them into it. Each run of blocks which are adjacent in the
+  // file is read with a single vectored read. 'ptrs' must be sorted by offset.
+  Status PrefetchBlocks(const std::vector<BlockPointer>& ptrs) const;
 
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
@@ -180,6 +197,32 @@ class CFileReader {
   // Returns true if the file has checksums on the header, footer, and data blocks.
   bool has_checksums() const;
 
+  // Returns true if the file has min/max/null-count zone maps for its data blocks.
+  bool has_zone_maps() const;
+
+  // Sets '*may_match' to false if the file's zone maps prove that none of the
+  // 'num_rows' values starting at ordinal 'first_row' satisfy 'pred', or to
+  // true otherwise (including when the file has no zone maps).
+  //
+  // The zone map block is read and cached on first use. Thread-safe.
+  Status ZoneMapsMayMatch(const ColumnPredicate& pred,
+                          rowid_t first_row,
+                          size_t num_rows,
+                          bool* may_match);
+
+  // Sets '*zone_maps' to the zone maps of the file's data blocks, in ordinal
+  // order. The file must have zone maps. The zone map block is read and
+  // cached on first use. Thread-safe.
+  Status GetBlockZoneMaps(const ZoneMapBlockPB** zone_maps);
+
+  // Returns true if the file has an NDV sketch and a histogram of its values.
+  bool has_column_stats() const;
+
+  // Reads the statistics of the file's values into 'stats', with the counts
+  // and bounds of its zone map. Returns Status::NotFound if the file has no
+  // statistics. The block holding them isn't cached.
+  Status ReadColumnStats(ColumnStatsPB* stats);
+
   // Can be called before Init().
   std::string ToString() const { return block_->id().ToString(); }
 
@@ -197,6 +240,36 @@ class CFileReader {
   Status ReadAndParseFooter();
   Status VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const;
 
+  // Allocates 'scratch' to hold the data of the block at 'ptr', excluding its
+  // checksum, and sets '*data_size' to the size of that data.
+  Status AllocateBlockScratch(const BlockPointer& ptr, CacheControl cache_control,
+                              BlockCache::BlockType block_type,
+                              ScratchMemory* scratch, uint32_t* data_size) const;
+
+  // Verifies and decompresses the data of the block at 'ptr' which has been
+  // read into 'scratch', and transfers it to the block cache (if requested
+  // and possible) and to '*ret'. 'checksum' is only used if checksums are
+  // to be verified.
+  Status FinishReadBlock(const BlockPointer& ptr, CacheControl cache_control,
+                         BlockCache::BlockType block_type,
+                         ScratchMemory* scratch, uint32_t data_size,
+                         const Slice& checksum, BlockHandle* ret) const;
+
+  // Whether the blocks of this file are kept compressed in the block cache.
+  bool caches_compressed_blocks() const;
+
+  // Points '*ret' at the data of the block at 'ptr' within 'mapping_',
+  // verifying its checksum if needed.
+  Status ReadMappedBlock(const BlockPointer& ptr, BlockHandle* ret) const;
+
+  // Decompresses 'compressed', the cached data of the block at 'ptr', into a
+  // new block owned by '*ret'.
+  Status DecompressCachedBlock(const BlockPointer& ptr, const Slice& compressed,
+                               BlockHandle* ret) const;
+
+  // Callback used in 'zone_maps_once_' to read and parse the zone map block.
+  Status ReadZoneMapsOnce();
+
   // Returns the memory usage of the object including the object itself.
   size_t memory_footprint() const;
 
@@ -216,6 +289,14 @@ class CFileReader {
 
   KuduOnceDynamic init_once_;
 
+  // A mapping of the whole file, set by InitOnce() if blocks are to be read
+  // from it rather than through the block cache.
+  std::shared_ptr<FileMapping> mapping_;
+
+  // Per-block zone maps, loaded lazily by ZoneMapsMayMatch().
+  gscoped_ptr<ZoneMapBlockPB> zone_maps_;
+  KuduOnceDynamic zone_maps_once_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
@@ -390,6 +471,14 @@ class CFileIterator : public ColumnIterator {
   // BinaryDictBlockDecoder.
   BinaryPlainBlockDecoder* GetDictDecoder() { return dict_decoder_.get(); }
 
+  // Whether the decoders of this iterator's blocks set the cells of BINARY
+  // columns to point into the data and dictionary blocks, rather than
+  // copying the strings into the destination arena. If so, Scan() retains
+  // the blocks in the arena, so that they remain pinned until it's reset.
+  //
+  // Only valid once the iterator is seeked.
+  bool zero_copy_strings() const { return zero_copy_strings_; }
+
   // If the column is dictionary-coded and a predicate on the column exists,
   // returns the set of codewords that pass the predicate. Since a vocabulary
   // is shared among the multiple BinaryDictBlockDecoders in a single cfile,
@@ -402,7 +491,8 @@ class CFileIterator : public ColumnIterator {
 
   struct PreparedBlock {
     BlockPointer dblk_ptr_;
-    BlockHandle dblk_data_;
+    // Shared so that arenas may retain the block (see zero_copy_strings()).
+    std::shared_ptr<BlockHandle> dblk_data_;
     gscoped_ptr<BlockDecoder> dblk_;
 
     // The rowid of the first row in this block.
@@ -443,6 +533,18 @@ class CFileIterator : public ColumnIterator {
   // Seek the given PreparedBlock to the given index within it.
   void SeekToPositionInBlock(PreparedBlock *pb, uint32_t idx_in_block);
 
+  // Copies up to '*n' values from the data block of 'pb' into 'dst', setting
+  // '*n' to the number of values consumed from the block.
+  //
+  // If 'ctx' allows it, only the rows which are selected in 'sel' are decoded
+  // (see BlockDecoder::CopySelectedValues()), and the cells of the others are
+  // zeroed. Does not advance 'sel' or 'dst'.
+  Status CopyNextValues(PreparedBlock* pb,
+                        ColumnMaterializationContext* ctx,
+                        const SelectionVectorView& sel,
+                        size_t* n,
+                        ColumnDataView* dst);
+
   // Read the data block currently pointed to by idx_iter_
   // into the given PreparedBlock structure.
   //
@@ -458,6 +560,13 @@ class CFileIterator : public ColumnIterator {
   // seek-related state.
   Status PrepareForNewSeek();
 
+  // Called when a sequential scan of the positional index moves on to the
+  // data block at 'cur'. Once the scan reaches the first block of the
+  // previous read-ahead window, waits for that window and prefetches the
+  // following one into the block cache in the background. The window grows
+  // whenever the scan has to wait for it.
+  void MaybeReadAhead(const BlockPointer& cur);
+
   CFileReader* reader_;
 
   gscoped_ptr<IndexTreeIterator> posidx_iter_;
@@ -465,7 +574,7 @@ class CFileIterator : public ColumnIterator {
 
   // Decoder for the dictionary block.
   gscoped_ptr<BinaryPlainBlockDecoder> dict_decoder_;
-  BlockHandle dict_block_handle_;
+  std::shared_ptr<BlockHandle> dict_block_handle_;
 
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
@@ -496,10 +605,27 @@ class CFileIterator : public ColumnIterator {
   // Otherwise, 0.
   uint32_t last_prepare_count_;
 
+  // See zero_copy_strings().
+  bool zero_copy_strings_;
+
   IteratorStats io_stats_;
 
   // a temporary buffer for encoding
   faststring tmp_buf_;
+
+  // Read-ahead state, reset on every seek. 'readahead_iter_' points at the
+  // last block which has been submitted for prefetching.
+  std::unique_ptr<ThreadPoolToken> readahead_token_;
+  gscoped_ptr<IndexTreeIterator> readahead_iter_;
+  bool readahead_exhausted_;
+  int readahead_depth_;
+
+  // The offset of the first block of the most recent window, at which the
+  // next window is issued.
+  uint64_t readahead_trigger_offset_;
+
+  // The number of windows submitted but not yet prefetched.
+  std::atomic<int> readahead_windows_in_flight_;
 };
 
 } // namespace cfile
@@ -44,8 +44,10 @@ static const int kBufSize = 1024*1024;
 WriterOptions::WriterOptions()
   : index_block_size(32*1024),
     block_restart_interval(16),
+    index_block_restart_interval(-1),
     write_posidx(false),
     write_validx(false),
+    write_zone_maps(false),
     optimize_index_keys(true),
     validx_key_encoder(boost::none) {
 }
@@ -45,7 +45,21 @@ enum IncompatibleFeatures {
   // Write a crc32 checksum at the end of each cfile block
   CHECKSUM = 1 << 0,
 
-  SUPPORTED = NONE | CHECKSUM
+  // Prefix-compress the keys of index blocks
+  PREFIX_COMPRESSED_INDEX = 1 << 1,
+
+  SUPPORTED = NONE | CHECKSUM | PREFIX_COMPRESSED_INDEX
+};
+
+// Used to set the CFileFooterPB bitset tracking compatible features
+enum CompatibleFeatures {
+  NO_COMPATIBLE_FEATURES = 0,
+
+  // Write min/max/null-count zone maps for each data block
+  ZONE_MAPS = 1 << 0,
+
+  // Write an NDV sketch and a histogram of the file's values
+  COLUMN_STATS = 1 << 1
 };
 
 typedef std::function<void(const void*, faststring*)> ValidxKeyEncoder;
@@ -65,12 +79,23 @@ struct WriterOptions {
   // Default: 16
   int block_restart_interval;
 
+  // Number of keys between restart points of prefix-compressed index blocks.
+  // If 0, index keys are stored whole.
+  //
+  // Default: -1, i.e. --cfile_index_block_restart_interval.
+  int index_block_restart_interval;
+
   // Whether the file needs a positional index.
   bool write_posidx;
 
   // Whether the file needs a value index
   bool write_validx;
 
+  // Whether to write per-block zone maps (min/max/null count) which readers
+  // may use to skip blocks that cannot match a predicate. Ignored for types
+  // which cannot be key-encoded (e.g. floating point).
+  bool write_zone_maps;
+
   // Whether to optimize index keys by storing shortest separating prefixes
   // instead of entire keys.
   bool optimize_index_keys;
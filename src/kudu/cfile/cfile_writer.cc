@@ -31,8 +31,10 @@
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/column_stats.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/schema.h"
@@ -60,6 +62,26 @@ DEFINE_bool(cfile_write_checksums, true,
             "Write CRC32 checksums for each block");
 TAG_FLAG(cfile_write_checksums, evolving);
 
+DEFINE_bool(cfile_write_zone_maps, true,
+            "Write per-block min/max/null-count zone maps for cfiles whose writers "
+            "request them. Zone maps let scans skip blocks which cannot match a "
+            "predicate.");
+TAG_FLAG(cfile_write_zone_maps, evolving);
+TAG_FLAG(cfile_write_zone_maps, runtime);
+
+DEFINE_bool(cfile_write_column_stats, true,
+            "Write an NDV sketch and an equi-depth histogram of the values of "
+            "cfiles which have zone maps, for query planners.");
+TAG_FLAG(cfile_write_column_stats, evolving);
+TAG_FLAG(cfile_write_column_stats, runtime);
+
+DEFINE_int32(cfile_index_block_restart_interval, 16,
+             "Number of keys between restart points of the index blocks of "
+             "cfiles, whose other keys are stored as suffixes of their "
+             "predecessors. Set to 0 to store whole keys, which older "
+             "readers require.");
+TAG_FLAG(cfile_index_block_restart_interval, evolving);
+
 using google::protobuf::RepeatedPtrField;
 using kudu::fs::BlockCreationTransaction;
 using kudu::fs::BlockManager;
@@ -127,6 +149,10 @@ CFileWriter::CFileWriter(WriterOptions options,
     options_.storage_attributes.cfile_block_size = kMinBlockSize;
   }
 
+  if (options_.index_block_restart_interval < 0) {
+    options_.index_block_restart_interval = FLAGS_cfile_index_block_restart_interval;
+  }
+
   if (options_.write_posidx) {
     posidx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
@@ -141,6 +167,15 @@ CFileWriter::CFileWriter(WriterOptions options,
 
     validx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
+
+  if (options_.write_zone_maps && FLAGS_cfile_write_zone_maps &&
+      IsTypeAllowableInKey(typeinfo_)) {
+    zone_map_builder_.reset(new ZoneMapBuilder(typeinfo_));
+    zone_maps_.reset(new ZoneMapBlockPB());
+    if (FLAGS_cfile_write_column_stats) {
+      column_stats_builder_.reset(new ColumnStatsBuilder(typeinfo_));
+    }
+  }
 }
 
 CFileWriter::~CFileWriter() {
@@ -153,7 +188,9 @@ Status CFileWriter::Start() {
 
   if (compression_ != NO_COMPRESSION) {
     const CompressionCodec* codec;
-    RETURN_NOT_OK(GetCompressionCodec(compression_, &codec));
+    RETURN_NOT_OK(GetCompressionCodec(compression_,
+                                      options_.storage_attributes.compression_level,
+                                      &codec));
     block_compressor_ .reset(new CompressedBlockBuilder(codec));
   }
 
@@ -219,6 +256,10 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
   if (FLAGS_cfile_write_checksums) {
     incompatible_features |= IncompatibleFeatures::CHECKSUM;
   }
+  if (options_.index_block_restart_interval > 0 &&
+      (posidx_builder_ != nullptr || validx_builder_ != nullptr)) {
+    incompatible_features |= IncompatibleFeatures::PREFIX_COMPRESSED_INDEX;
+  }
 
   // Start preparing the footer.
   CFileFooterPB footer;
@@ -229,6 +270,30 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
   footer.set_compression(compression_);
   footer.set_incompatible_features(incompatible_features);
 
+  if (zone_map_builder_ != nullptr) {
+    faststring zone_maps_str;
+    pb_util::SerializeToString(*zone_maps_, &zone_maps_str);
+    BlockPointer zone_maps_ptr;
+    RETURN_NOT_OK_PREPEND(AddBlock({ Slice(zone_maps_str) }, &zone_maps_ptr, "zone maps"),
+                          "Couldn't write zone maps");
+    zone_maps_ptr.CopyToPB(footer.mutable_zone_maps_block_ptr());
+    zone_map_builder_->FinishFile(footer.mutable_file_zone_map());
+    footer.set_compatible_features(CompatibleFeatures::ZONE_MAPS);
+  }
+
+  if (column_stats_builder_ != nullptr) {
+    ColumnStatsPB stats;
+    column_stats_builder_->Finish(&stats);
+    faststring stats_str;
+    pb_util::SerializeToString(stats, &stats_str);
+    BlockPointer stats_ptr;
+    RETURN_NOT_OK_PREPEND(AddBlock({ Slice(stats_str) }, &stats_ptr, "column stats"),
+                          "Couldn't write column stats");
+    stats_ptr.CopyToPB(footer.mutable_column_stats_block_ptr());
+    footer.set_compatible_features(footer.compatible_features() |
+                                   CompatibleFeatures::COLUMN_STATS);
+  }
+
   // Write out any pending positional index blocks.
   if (options_.write_posidx) {
     BTreeInfoPB posidx_info;
@@ -311,6 +376,12 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
 
+    if (zone_map_builder_ != nullptr) {
+      zone_map_builder_->AddValues(ptr, n);
+    }
+    if (column_stats_builder_ != nullptr) {
+      column_stats_builder_->AddValues(ptr, n);
+    }
     ptr += typeinfo_->size() * n;
     rem -= n;
     value_count_ += n;
@@ -342,6 +413,12 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
         DCHECK_GE(n, 0);
 
         null_bitmap_builder_->AddRun(true, n);
+        if (zone_map_builder_ != nullptr) {
+          zone_map_builder_->AddValues(ptr, n);
+        }
+        if (column_stats_builder_ != nullptr) {
+          column_stats_builder_->AddValues(ptr, n);
+        }
         ptr += n * typeinfo_->size();
         value_count_ += n;
         rem -= n;
@@ -353,6 +430,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       } while (rem > 0);
     } else {
       null_bitmap_builder_->AddRun(false, nblock);
+      if (zone_map_builder_ != nullptr) {
+        zone_map_builder_->AddNulls(nblock);
+      }
       ptr += nblock * typeinfo_->size();
       value_count_ += nblock;
     }
@@ -408,6 +488,10 @@ Status CFileWriter::FinishCurDataBlock() {
     null_bitmap_builder_->Reset();
   }
 
+  if (zone_map_builder_ != nullptr) {
+    zone_map_builder_->FinishBlock(first_elem_ord, zone_maps_->add_zone_maps());
+  }
+
   if (validx_builder_ != nullptr) {
     RETURN_NOT_OK(data_block_->GetLastKey(key_tmp_space));
     (*options_.validx_key_encoder)(key_tmp_space, &last_key_);
@@ -459,6 +543,59 @@ Status CFileWriter::AppendRawBlock(const vector<Slice>& data_slices,
   return s;
 }
 
+Status CFileWriter::AppendEncodedDataBlock(const Slice& data,
+                                           size_t num_values,
+                                           const ZoneMapPB* zone_map) {
+  CHECK_EQ(state_, kWriterWriting);
+  CHECK(validx_builder_ == nullptr) << "encoded blocks can't be value-indexed";
+  const int ordinal_offset = TypeEncodingInfo::FirstOrdinalOffset(
+      typeinfo_, type_encoding_info_->encoding_type());
+  if (ordinal_offset < 0) {
+    return Status::NotSupported("can't copy data blocks of encoding",
+                                EncodingType_Name(type_encoding_info_->encoding_type()));
+  }
+  if (num_values == 0) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(FinishCurDataBlock());
+
+  // The encoded values of nullable blocks follow their null bitmap.
+  size_t values_offset = 0;
+  if (is_nullable_) {
+    Slice rest(data);
+    uint32_t num_elems;
+    uint32_t bitmap_size;
+    if (!GetVarint32(&rest, &num_elems) || !GetVarint32(&rest, &bitmap_size) ||
+        num_elems != num_values || rest.size() < bitmap_size) {
+      return Status::Corruption("bad null header in encoded data block");
+    }
+    values_offset = data.size() - rest.size() + bitmap_size;
+  }
+  if (data.size() < values_offset + ordinal_offset + sizeof(uint32_t)) {
+    return Status::Corruption("encoded data block too short");
+  }
+
+  const rowid_t first_elem_ord = value_count_;
+  faststring block;
+  block.assign_copy(data.data(), data.size());
+  InlineEncodeFixed32(block.data() + values_offset + ordinal_offset, first_elem_ord);
+  RETURN_NOT_OK(AppendRawBlock({ Slice(block) }, first_elem_ord, nullptr, Slice(),
+                               "encoded data block"));
+  value_count_ += num_values;
+
+  if (zone_map_builder_ != nullptr) {
+    if (zone_map == nullptr) {
+      zone_map_builder_.reset();
+      zone_maps_.reset();
+    } else {
+      zone_map_builder_->AddFinishedBlock(*zone_map, first_elem_ord,
+                                          zone_maps_->add_zone_maps());
+    }
+  }
+  column_stats_builder_.reset();
+  return Status::OK();
+}
+
 Status CFileWriter::AddBlock(const vector<Slice> &data_slices,
                              BlockPointer *block_ptr,
                              const char *name_for_log) {
@@ -55,10 +55,14 @@ namespace cfile {
 
 class BlockBuilder;
 class BlockPointer;
+class ColumnStatsBuilder;
 class CompressedBlockBuilder;
 class FileMetadataPairPB;
 class IndexTreeBuilder;
 class TypeEncodingInfo;
+class ZoneMapBlockPB;
+class ZoneMapBuilder;
+class ZoneMapPB;
 
 // Magic used in header/footer
 extern const char kMagicStringV1[];
@@ -158,6 +162,18 @@ class CFileWriter {
                         const Slice &validx_prev,
                         const char *name_for_log);
 
+  // Append 'data', a decompressed data block of another CFile holding
+  // 'num_values' values, without decoding it. The other file must have the
+  // same type, nullability and encoding as this one, and the encoding must
+  // have a rewritable first ordinal (see TypeEncodingInfo::FirstOrdinalOffset).
+  // This file must not be writing a value index.
+  //
+  // 'zone_map' is the zone map of the block, if the other file has one. If it
+  // doesn't, this file is written without zone maps. Files with copied blocks
+  // are written without column statistics.
+  Status AppendEncodedDataBlock(const Slice& data,
+                                size_t num_values,
+                                const ZoneMapPB* zone_map);
 
   // Return the amount of data written so far to this CFile.
   // More data may be written by Finish(), but this is an approximation.
@@ -169,8 +185,8 @@ class CFileWriter {
   }
 
   // Return the number of values written to the file.
-  // This includes NULL cells, but does not include any "raw" blocks
-  // appended.
+  // This includes NULL cells and the values of encoded data blocks, but does
+  // not include any "raw" blocks appended.
   int written_value_count() const {
     return value_count_;
   }
@@ -239,6 +255,15 @@ class CFileWriter {
   gscoped_ptr<NullBitmapBuilder> null_bitmap_builder_;
   gscoped_ptr<CompressedBlockBuilder> block_compressor_;
 
+  // Only set if the writer is writing zone maps. 'zone_maps_' holds the zone
+  // map of each data block written so far.
+  gscoped_ptr<ZoneMapBuilder> zone_map_builder_;
+  gscoped_ptr<ZoneMapBlockPB> zone_maps_;
+
+  // Only set if the writer is writing column statistics, which requires
+  // zone maps.
+  gscoped_ptr<ColumnStatsBuilder> column_stats_builder_;
+
   enum State {
     kWriterInitialized,
     kWriterWriting,
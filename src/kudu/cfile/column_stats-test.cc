@@ -0,0 +1,122 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/column_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/types.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace cfile {
+
+class ColumnStatsTest : public KuduTest {
+ protected:
+  // Returns the statistics of the values 'first', 'first + step', ... up to
+  // 'num_values' of them, with 'num_nulls' NULLs.
+  static ColumnStatsPB BuildStats(int32_t first, int32_t step, int num_values, int num_nulls) {
+    vector<int32_t> values;
+    for (int i = 0; i < num_values; i++) {
+      values.push_back(first + i * step);
+    }
+    const TypeInfo* type = GetTypeInfo(INT32);
+    ColumnStatsBuilder builder(type);
+    builder.AddValues(reinterpret_cast<const uint8_t*>(values.data()), values.size());
+
+    ColumnStatsPB stats;
+    builder.Finish(&stats);
+    // The counts and bounds are filled in from zone maps by readers.
+    stats.set_num_values(num_values + num_nulls);
+    stats.set_null_count(num_nulls);
+    if (num_values > 0) {
+      stats.set_min_value(Encode(values.front()));
+      stats.set_max_value(Encode(values.back()));
+    }
+    return stats;
+  }
+
+  static string Encode(int32_t value) {
+    faststring buf;
+    GetKeyEncoder<faststring>(GetTypeInfo(INT32)).ResetAndEncode(&value, &buf);
+    return buf.ToString();
+  }
+};
+
+TEST_F(ColumnStatsTest, TestDistinctValues) {
+  ASSERT_EQ(0, EstimateDistinctValues(BuildStats(0, 1, 0, 10)));
+  ASSERT_EQ(1, EstimateDistinctValues(BuildStats(7, 0, 1000, 0)));
+  ASSERT_NEAR(100, EstimateDistinctValues(BuildStats(0, 1, 100, 0)), 5);
+  ASSERT_NEAR(1000000, EstimateDistinctValues(BuildStats(0, 1, 1000000, 0)), 100000);
+  ASSERT_EQ(-1, EstimateDistinctValues(ColumnStatsPB()));
+}
+
+TEST_F(ColumnStatsTest, TestHistogram) {
+  const int kNumValues = 100000;
+  ColumnStatsPB stats = BuildStats(0, 1, kNumValues, 0);
+  ASSERT_GT(stats.histogram_bounds_size(), 1);
+  // The buckets hold about the same number of values. The bounds are those
+  // of a sample, so they're only checked to be within a couple of buckets.
+  const int kBucketSize = kNumValues / stats.histogram_bounds_size();
+  for (int i = 0; i < stats.histogram_bounds_size(); i++) {
+    ASSERT_GE(stats.histogram_bounds(i), Encode((i - 1) * kBucketSize));
+    ASSERT_LE(stats.histogram_bounds(i), Encode((i + 3) * kBucketSize));
+  }
+}
+
+TEST_F(ColumnStatsTest, TestMerge) {
+  // Two disjoint ranges, the second holding three times as many values, and
+  // a range overlapping the first one.
+  ColumnStatsPB merged;
+  MergeColumnStats(BuildStats(0, 1, 10000, 10), &merged);
+  MergeColumnStats(BuildStats(100000, 1, 30000, 20), &merged);
+  MergeColumnStats(BuildStats(5000, 1, 10000, 0), &merged);
+
+  ASSERT_EQ(50030, merged.num_values());
+  ASSERT_EQ(30, merged.null_count());
+  ASSERT_EQ(Encode(0), merged.min_value());
+  ASSERT_EQ(Encode(129999), merged.max_value());
+  ASSERT_NEAR(45000, EstimateDistinctValues(merged), 4500);
+
+  // About 20000 of the 50000 values are in the first range, so that about
+  // 40% of the bounds are in it.
+  int num_bounds_in_first_range = 0;
+  for (const string& bound : merged.histogram_bounds()) {
+    num_bounds_in_first_range += bound < Encode(100000);
+  }
+  ASSERT_NEAR(0.4 * merged.histogram_bounds_size(), num_bounds_in_first_range, 3);
+
+  // Sketches of different sizes can't be combined.
+  ColumnStatsPB other = BuildStats(0, 1, 100, 0);
+  other.set_hll_precision(4);
+  other.set_hll_registers(string(16, '\0'));
+  MergeColumnStats(other, &merged);
+  ASSERT_EQ(-1, EstimateDistinctValues(merged));
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/column_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/types.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/slice.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+// 2^11 registers, for a standard error of about 2.3% in the NDV estimates.
+constexpr int kHllPrecision = 11;
+constexpr int kHllNumRegisters = 1 << kHllPrecision;
+
+// The number of values sampled for the histogram, and its number of buckets.
+constexpr int kSampleSize = 1024;
+constexpr int kHistogramBuckets = 32;
+
+// Skips are capped so that they can't overflow the count of values.
+constexpr double kMaxSkip = 1e18;
+
+// Returns a uniformly distributed number in (0, 1].
+double RandomFraction(Random* rng) {
+  return 1 - rng->NextDoubleFraction();
+}
+
+} // anonymous namespace
+
+ColumnStatsBuilder::ColumnStatsBuilder(const TypeInfo* typeinfo)
+    : typeinfo_(typeinfo),
+      key_encoder_(&GetKeyEncoder<faststring>(typeinfo)),
+      hll_registers_(kHllNumRegisters),
+      num_values_(0),
+      next_sampled_value_(kSampleSize - 1),
+      sample_weight_(1),
+      // A fixed seed, so that rewriting the same values yields the same file.
+      rng_(0) {
+  DCHECK(IsTypeAllowableInKey(typeinfo));
+}
+
+void ColumnStatsBuilder::AddValues(const uint8_t* cells, size_t count) {
+  const size_t cell_size = typeinfo_->size();
+  const bool is_binary = typeinfo_->physical_type() == BINARY;
+  for (size_t i = 0; i < count; i++, cells += cell_size) {
+    uint64_t hash;
+    if (is_binary) {
+      const Slice* s = reinterpret_cast<const Slice*>(cells);
+      hash = HashUtil::MurmurHash2_64(s->data(), s->size(), 0);
+    } else {
+      hash = HashUtil::MurmurHash2_64(cells, cell_size, 0);
+    }
+    // The register is picked by the top bits of the hash, and records the
+    // longest run of leading zeros seen in the remaining bits.
+    const uint64_t rest = hash << kHllPrecision;
+    const uint8_t rank = rest == 0 ? 64 - kHllPrecision + 1 : __builtin_clzll(rest) + 1;
+    uint8_t* reg = &hll_registers_[hash >> (64 - kHllPrecision)];
+    *reg = std::max(*reg, rank);
+
+    if (num_values_ < kSampleSize) {
+      key_encoder_->ResetAndEncode(cells, &tmp_buf_);
+      sample_.emplace_back(tmp_buf_.ToString());
+      if (num_values_ == kSampleSize - 1) {
+        SkipSampledValues();
+      }
+    } else if (num_values_ == next_sampled_value_) {
+      key_encoder_->ResetAndEncode(cells, &tmp_buf_);
+      sample_[rng_.Uniform(kSampleSize)] = tmp_buf_.ToString();
+      SkipSampledValues();
+    }
+    num_values_++;
+  }
+}
+
+void ColumnStatsBuilder::SkipSampledValues() {
+  sample_weight_ *= std::exp(std::log(RandomFraction(&rng_)) / kSampleSize);
+  double skip = std::floor(std::log(RandomFraction(&rng_)) / std::log1p(-sample_weight_));
+  if (!(skip < kMaxSkip)) {
+    skip = kMaxSkip;
+  }
+  next_sampled_value_ += static_cast<int64_t>(skip) + 1;
+}
+
+void ColumnStatsBuilder::Finish(ColumnStatsPB* stats) {
+  stats->set_hll_precision(kHllPrecision);
+  stats->set_hll_registers(hll_registers_.data(), hll_registers_.size());
+
+  stats->clear_histogram_bounds();
+  std::sort(sample_.begin(), sample_.end(), [](const string& a, const string& b) {
+    return Slice(a).compare(Slice(b)) < 0;
+  });
+  const size_t num_buckets = std::min<size_t>(kHistogramBuckets, sample_.size());
+  for (size_t b = 1; b <= num_buckets; b++) {
+    stats->add_histogram_bounds(sample_[b * sample_.size() / num_buckets - 1]);
+  }
+}
+
+void MergeColumnStats(const ColumnStatsPB& src, ColumnStatsPB* dst) {
+  if (!dst->has_num_values()) {
+    *dst = src;
+    return;
+  }
+
+  // Rebuild the histogram from the bounds of both, each bound standing for
+  // the values of its bucket.
+  vector<pair<string, double>> bounds;
+  double total_weight = 0;
+  for (const ColumnStatsPB* stats : { &src, static_cast<const ColumnStatsPB*>(dst) }) {
+    if (stats->histogram_bounds_size() == 0) {
+      continue;
+    }
+    const double weight = static_cast<double>(stats->num_values() - stats->null_count()) /
+                          stats->histogram_bounds_size();
+    for (const string& bound : stats->histogram_bounds()) {
+      bounds.emplace_back(bound, weight);
+      total_weight += weight;
+    }
+  }
+  const int num_buckets = std::max(src.histogram_bounds_size(), dst->histogram_bounds_size());
+  dst->clear_histogram_bounds();
+  if (total_weight > 0) {
+    std::sort(bounds.begin(), bounds.end(),
+              [](const pair<string, double>& a, const pair<string, double>& b) {
+                return Slice(a.first).compare(Slice(b.first)) < 0;
+              });
+    double cumulative_weight = 0;
+    int bucket = 1;
+    for (const auto& bound : bounds) {
+      cumulative_weight += bound.second;
+      // Leave some slack for rounding errors, so that the last bucket isn't
+      // missed.
+      while (bucket <= num_buckets &&
+             cumulative_weight >= total_weight * bucket / num_buckets * (1 - 1e-9)) {
+        dst->add_histogram_bounds(bound.first);
+        bucket++;
+      }
+    }
+  }
+
+  dst->set_num_values(dst->num_values() + src.num_values());
+  dst->set_null_count(dst->null_count() + src.null_count());
+  if (src.has_min_value() &&
+      (!dst->has_min_value() || Slice(src.min_value()).compare(Slice(dst->min_value())) < 0)) {
+    dst->set_min_value(src.min_value());
+  }
+  if (src.has_max_value() &&
+      (!dst->has_max_value() || Slice(src.max_value()).compare(Slice(dst->max_value())) > 0)) {
+    dst->set_max_value(src.max_value());
+  }
+
+  // Sketches are merged by taking the largest value of each register.
+  if (src.has_hll_registers() && dst->has_hll_registers() &&
+      src.hll_precision() == dst->hll_precision() &&
+      src.hll_registers().size() == dst->hll_registers().size()) {
+    string* registers = dst->mutable_hll_registers();
+    for (int i = 0; i < registers->size(); i++) {
+      (*registers)[i] = std::max<uint8_t>((*registers)[i], src.hll_registers()[i]);
+    }
+  } else {
+    dst->clear_hll_precision();
+    dst->clear_hll_registers();
+  }
+}
+
+int64_t EstimateDistinctValues(const ColumnStatsPB& stats) {
+  if (!stats.has_hll_registers() || stats.hll_registers().empty()) {
+    return -1;
+  }
+  const double m = stats.hll_registers().size();
+  double sum = 0;
+  int num_zeros = 0;
+  for (char c : stats.hll_registers()) {
+    const uint8_t reg = c;
+    sum += std::ldexp(1.0, -reg);
+    num_zeros += reg == 0;
+  }
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  // Small cardinalities are better estimated by linear counting.
+  if (estimate <= 2.5 * m && num_zeros > 0) {
+    estimate = m * std::log(m / num_zeros);
+  }
+  return std::llround(estimate);
+}
+
+} // namespace cfile
+} // namespace kudu
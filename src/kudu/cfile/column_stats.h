@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/random.h"
+
+namespace kudu {
+
+class ColumnStatsPB;
+class TypeInfo;
+
+template <typename Buffer>
+class KeyEncoder;
+
+namespace cfile {
+
+// Accumulates the HyperLogLog sketch and the equi-depth histogram of the
+// non-NULL values of a CFile while it is being written. The counts and
+// bounds of the values are left to the file's zone map.
+//
+// Values are hashed into the sketch as they're stored. The histogram is
+// built from a reservoir sample of the values, so that only the sampled
+// values are key-encoded and kept.
+class ColumnStatsBuilder {
+ public:
+  explicit ColumnStatsBuilder(const TypeInfo* typeinfo);
+
+  // Add 'count' non-NULL cells, laid out contiguously starting at 'cells'.
+  void AddValues(const uint8_t* cells, size_t count);
+
+  // Fill in the sketch and the histogram of 'stats' with every value added.
+  void Finish(ColumnStatsPB* stats);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ColumnStatsBuilder);
+
+  // Skips the values which won't replace a sampled value, following
+  // Algorithm L of "Reservoir-Sampling Algorithms of Time Complexity
+  // O(n(1 + log(N/n)))" (Li, 1994).
+  void SkipSampledValues();
+
+  const TypeInfo* typeinfo_;
+  const KeyEncoder<faststring>* key_encoder_;
+
+  std::vector<uint8_t> hll_registers_;
+
+  // The key-encoded values of the reservoir, the number of values added so
+  // far, and the number of the next value to be sampled.
+  std::vector<std::string> sample_;
+  int64_t num_values_;
+  int64_t next_sampled_value_;
+  double sample_weight_;
+  Random rng_;
+
+  faststring tmp_buf_;
+};
+
+// Merges the statistics 'src' into 'dst', as if their values were those of
+// a single file. The histogram of 'dst' is rebuilt from the bounds of both,
+// weighted by their numbers of values.
+void MergeColumnStats(const ColumnStatsPB& src, ColumnStatsPB* dst);
+
+// Returns the number of distinct non-NULL values estimated by the sketch of
+// 'stats', or -1 if it has no sketch.
+int64_t EstimateDistinctValues(const ColumnStatsPB& stats);
+
+} // namespace cfile
+} // namespace kudu
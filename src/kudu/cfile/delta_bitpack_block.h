@@ -0,0 +1,417 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Delta encoding with bit-packing for integer types, intended for columns
+// whose values grow slowly and steadily, such as timestamps and sequence
+// numbers. The layout is similar to the one of FastPFor's binary packing.
+#ifndef KUDU_CFILE_DELTA_BITPACK_BLOCK_H
+#define KUDU_CFILE_DELTA_BITPACK_BLOCK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bit-stream-utils.h"
+#include "kudu/util/bit-stream-utils.inline.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// The number of deltas which are packed with the same bit width.
+static const int kDeltaBitPackMiniBlockSize = 128;
+
+// DeltaBitPackBlockBuilder stores the differences between consecutive
+// values, bit-packed in fixed-size miniblocks.
+//
+// The block format is as follows:
+//
+// 1. Header: (12 bytes total)
+//
+//    <first_ordinal> [32-bit]
+//      The ordinal offset of the first element in the block.
+//
+//    <num_elements> [32-bit]
+//      The number of elements encoded in the block.
+//
+//    <encoded_size> [32-bit]
+//      The size of the block, including this header.
+//
+// 2. First value [sizeof(type)]
+//
+//    The first element of the block, stored as is. Omitted if the block
+//    is empty.
+//
+// 3. Miniblocks
+//
+//    The (num_elements - 1) deltas between consecutive elements, split into
+//    miniblocks of kDeltaBitPackMiniBlockSize deltas. Each miniblock is:
+//
+//    <min_delta> [sizeof(type)]
+//      The smallest delta of the miniblock, as a signed integer.
+//
+//    <bit_width> [8-bit]
+//      The number of bits of each packed delta.
+//
+//    <packed_deltas> [16 * bit_width bytes]
+//      (delta - min_delta) for each delta of the miniblock, packed using
+//      bit_width bits each. The last miniblock is padded with zeros so that
+//      every miniblock holds kDeltaBitPackMiniBlockSize deltas.
+//
+// The deltas are computed with the wrap-around arithmetic of the unsigned
+// type of the same size, so any sequence of values round-trips, but only
+// those with a narrow range of deltas are encoded compactly. A strictly
+// increasing sequence with a constant step takes a single byte per
+// miniblock after the first value.
+//
+//   NOTE: all on-disk ints are encoded little-endian
+//
+template<DataType Type>
+class DeltaBitPackBlockBuilder final : public BlockBuilder {
+ public:
+  explicit DeltaBitPackBlockBuilder(const WriterOptions* options)
+    : count_(0),
+      options_(options) {
+    Reset();
+  }
+
+  void Reset() OVERRIDE {
+    auto block_size = options_->storage_attributes.cfile_block_size;
+    count_ = 0;
+    data_.clear();
+    data_.reserve(block_size);
+    buffer_.clear();
+    finished_ = false;
+    rem_elem_capacity_ = block_size / size_of_type;
+  }
+
+  bool IsBlockFull() const override {
+    return rem_elem_capacity_ == 0;
+  }
+
+  int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    DCHECK(!finished_);
+    int to_add = std::min<int>(rem_elem_capacity_, count);
+    data_.append(vals_void, to_add * size_of_type);
+    count_ += to_add;
+    rem_elem_capacity_ -= to_add;
+    return to_add;
+  }
+
+  size_t Count() const OVERRIDE {
+    return count_;
+  }
+
+  Status GetFirstKey(void* key) const OVERRIDE {
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[0], size_of_type);
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const OVERRIDE {
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[(count_ - 1) * size_of_type], size_of_type);
+    return Status::OK();
+  }
+
+  Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    BitWriter writer(&buffer_);
+    writer.PutAligned<uint32_t>(ordinal_pos, 4);
+    writer.PutAligned<uint32_t>(count_, 4);
+    // The encoded size is filled in once the miniblocks are written.
+    writer.PutAligned<uint32_t>(0, 4);
+
+    if (count_ > 0) {
+      writer.PutAligned<UnsignedType>(cell(0), size_of_type);
+    }
+    for (uint32_t start = 1; start < count_; start += kDeltaBitPackMiniBlockSize) {
+      uint32_t end = std::min<uint32_t>(start + kDeltaBitPackMiniBlockSize, count_);
+      AppendMiniBlock(start, end, &writer);
+    }
+    writer.Flush(/* align */ true);
+
+    InlineEncodeFixed32(&buffer_[8], buffer_.size());
+    finished_ = true;
+    return Slice(buffer_);
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  typedef typename std::make_signed<CppType>::type SignedType;
+
+  UnsignedType cell(int idx) const {
+    UnsignedType ret;
+    memcpy(&ret, &data_[idx * size_of_type], size_of_type);
+    return ret;
+  }
+
+  UnsignedType delta(int idx) const {
+    return static_cast<UnsignedType>(cell(idx) - cell(idx - 1));
+  }
+
+  // Append the miniblock holding the deltas which lead to the elements
+  // [start, end).
+  void AppendMiniBlock(uint32_t start, uint32_t end, BitWriter* writer) {
+    SignedType min_delta = static_cast<SignedType>(delta(start));
+    for (uint32_t i = start + 1; i < end; i++) {
+      min_delta = std::min(min_delta, static_cast<SignedType>(delta(i)));
+    }
+    UnsignedType max_offset = 0;
+    for (uint32_t i = start; i < end; i++) {
+      max_offset = std::max(max_offset, static_cast<UnsignedType>(
+          delta(i) - static_cast<UnsignedType>(min_delta)));
+    }
+    uint8_t bit_width = max_offset == 0 ? 0 : Bits::Log2Floor64(max_offset) + 1;
+
+    writer->PutAligned<UnsignedType>(static_cast<UnsignedType>(min_delta), size_of_type);
+    writer->PutAligned<uint8_t>(bit_width, 1);
+    if (bit_width == 0) {
+      return;
+    }
+    for (uint32_t i = start; i < end; i++) {
+      writer->PutValue(static_cast<UnsignedType>(
+          delta(i) - static_cast<UnsignedType>(min_delta)), bit_width);
+    }
+    for (uint32_t i = end; i < start + kDeltaBitPackMiniBlockSize; i++) {
+      writer->PutValue(0, bit_width);
+    }
+  }
+
+  // Length of a header.
+  static const size_t kHeaderSize = sizeof(uint32_t) * 3;
+  enum {
+    size_of_type = TypeTraits<Type>::size
+  };
+
+  faststring data_;
+  faststring buffer_;
+  uint32_t count_;
+  int rem_elem_capacity_;
+  bool finished_;
+  const WriterOptions* options_;
+};
+
+template<DataType Type>
+class DeltaBitPackBlockDecoder final : public BlockDecoder {
+ public:
+  explicit DeltaBitPackBlockDecoder(Slice slice)
+      : data_(slice),
+        parsed_(false),
+        ordinal_pos_base_(0),
+        num_elems_(0),
+        cur_idx_(0) {
+  }
+
+  Status ParseHeader() OVERRIDE {
+    CHECK(!parsed_);
+    if (data_.size() < kHeaderSize) {
+      return Status::Corruption(
+        strings::Substitute("not enough bytes for header: delta bitpack block header "
+          "size ($0) less than expected header length ($1)",
+          data_.size(), kHeaderSize));
+    }
+
+    ordinal_pos_base_ = DecodeFixed32(&data_[0]);
+    num_elems_        = DecodeFixed32(&data_[4]);
+    uint32_t encoded_size = DecodeFixed32(&data_[8]);
+    if (encoded_size != data_.size()) {
+      return Status::Corruption("Size Information unmatched");
+    }
+
+    RETURN_NOT_OK(Expand());
+
+    parsed_ = true;
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) OVERRIDE {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    if (PREDICT_FALSE(num_elems_ == 0)) {
+      DCHECK_EQ(0, pos);
+      return;
+    }
+
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  Status SeekAtOrAfterValue(const void* value_void, bool* exact) OVERRIDE {
+    CppType target = *reinterpret_cast<const CppType*>(value_void);
+    int32_t left = 0;
+    int32_t right = num_elems_;
+    while (left != right) {
+      uint32_t mid = (left + right) / 2;
+      CppType mid_key = value(mid);
+      if (mid_key == target) {
+        cur_idx_ = mid;
+        *exact = true;
+        return Status::OK();
+      } else if (mid_key > target) {
+        right = mid;
+      } else {
+        left = mid + 1;
+      }
+    }
+
+    *exact = false;
+    cur_idx_ = left;
+    if (cur_idx_ == num_elems_) {
+      return Status::NotFound("after last key in block");
+    }
+    return Status::OK();
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    DCHECK(parsed_);
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    memcpy(dst->data(), &decoded_[cur_idx_ * size_of_type], max_fetch * size_of_type);
+
+    *n = max_fetch;
+    cur_idx_ += max_fetch;
+
+    return Status::OK();
+  }
+
+  size_t GetCurrentIndex() const OVERRIDE {
+    DCHECK(parsed_) << "must parse header first";
+    return cur_idx_;
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return ordinal_pos_base_;
+  }
+
+  size_t Count() const OVERRIDE {
+    return num_elems_;
+  }
+
+  bool HasNext() const OVERRIDE {
+    return (num_elems_ - cur_idx_) > 0;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+
+  CppType value(int idx) const {
+    CppType ret;
+    memcpy(&ret, &decoded_[idx * size_of_type], size_of_type);
+    return ret;
+  }
+
+  // Decode all of the elements of the block into 'decoded_', so that
+  // seeking to an ordinal or a value doesn't need to replay the deltas.
+  Status Expand() {
+    decoded_.resize(num_elems_ * size_of_type);
+    if (num_elems_ == 0) {
+      return Status::OK();
+    }
+    BitReader reader(&data_[kHeaderSize], data_.size() - kHeaderSize);
+    UnsignedType* out = reinterpret_cast<UnsignedType*>(decoded_.data());
+    UnsignedType cur;
+    if (PREDICT_FALSE(!reader.GetAligned<UnsignedType>(size_of_type, &cur))) {
+      return Status::Corruption("missing first value in delta bitpack block");
+    }
+    out[0] = cur;
+    for (uint32_t start = 1; start < num_elems_; start += kDeltaBitPackMiniBlockSize) {
+      uint32_t end = std::min<uint32_t>(start + kDeltaBitPackMiniBlockSize, num_elems_);
+      UnsignedType min_delta;
+      uint8_t bit_width;
+      if (PREDICT_FALSE(!reader.GetAligned<UnsignedType>(size_of_type, &min_delta) ||
+                        !reader.GetAligned<uint8_t>(1, &bit_width))) {
+        return Status::Corruption(strings::Substitute(
+            "missing miniblock header for element $0 in delta bitpack block", start));
+      }
+      if (PREDICT_FALSE(bit_width > size_of_type * 8)) {
+        return Status::Corruption(strings::Substitute(
+            "invalid bit width $0 for $1-byte elements", bit_width, size_of_type));
+      }
+      if (bit_width == 0) {
+        for (uint32_t i = start; i < end; i++) {
+          cur = static_cast<UnsignedType>(cur + min_delta);
+          out[i] = cur;
+        }
+        continue;
+      }
+      for (uint32_t i = start; i < end; i++) {
+        uint64_t offset;
+        if (PREDICT_FALSE(!reader.GetValue(bit_width, &offset))) {
+          return Status::Corruption(strings::Substitute(
+              "missing delta for element $0 in delta bitpack block", i));
+        }
+        cur = static_cast<UnsignedType>(cur + min_delta + offset);
+        out[i] = cur;
+      }
+      // Skip over the padding of the last miniblock.
+      for (uint32_t i = end; i < start + kDeltaBitPackMiniBlockSize; i++) {
+        uint64_t padding;
+        if (PREDICT_FALSE(!reader.GetValue(bit_width, &padding))) {
+          return Status::Corruption("truncated miniblock in delta bitpack block");
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  // Length of a header.
+  static const size_t kHeaderSize = sizeof(uint32_t) * 3;
+  enum {
+    size_of_type = TypeTraits<Type>::size
+  };
+
+  Slice data_;
+  bool parsed_;
+
+  rowid_t ordinal_pos_base_;
+  uint32_t num_elems_;
+
+  size_t cur_idx_;
+  faststring decoded_;
+};
+
+} // namespace cfile
+} // namespace kudu
+#endif
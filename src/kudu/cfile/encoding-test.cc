@@ -37,11 +37,14 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/delta_bitpack_block.h"
+#include "kudu/cfile/float_xor_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -753,6 +756,117 @@ TEST_F(TestEncoding, TestBShufDoubleBlockEncoder) {
                                     BShufBlockDecoder<DOUBLE> >(doubles.get(), kSize);
 }
 
+// Test that monotonically increasing timestamps, as found in time series keys,
+// are stored in a fraction of their plain size.
+TEST_F(TestEncoding, TestDeltaBitPackTimestamps) {
+  const uint32_t kSize = 10000;
+
+  gscoped_ptr<int64_t[]> ints(new int64_t[kSize]);
+  int64_t ts = 1500000000000000L;
+  for (int i = 0; i < kSize; i++) {
+    ts += 1000000 + random() % 1000;
+    ints.get()[i] = ts;
+  }
+
+  TestEncodeDecodeTemplateBlockEncoder<INT64, DeltaBitPackBlockBuilder<INT64>,
+      DeltaBitPackBlockDecoder<INT64> >(ints.get(), kSize);
+
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  DeltaBitPackBlockBuilder<INT64> dbb(opts.get());
+  dbb.Add(reinterpret_cast<const uint8_t *>(ints.get()), kSize);
+  Slice s = dbb.Finish(0);
+  LOG(INFO) << "Delta bitpack encoded size for 10k timestamps: " << s.size();
+  ASSERT_LT(s.size(), kSize * sizeof(int64_t) / 4);
+
+  // A constant step is stored with no packed bits at all.
+  for (int i = 0; i < kSize; i++) {
+    ints.get()[i] = i * 10;
+  }
+  dbb.Reset();
+  dbb.Add(reinterpret_cast<const uint8_t *>(ints.get()), kSize);
+  s = dbb.Finish(0);
+  ASSERT_LT(s.size(), 1000);
+}
+
+TEST_F(TestEncoding, TestDeltaBitPackEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode<DeltaBitPackBlockBuilder<INT32>, DeltaBitPackBlockDecoder<INT32>>();
+}
+
+// Test for the float XOR block, for FLOAT and DOUBLE
+TEST_F(TestEncoding, TestFloatXorFloatBlockEncoder) {
+  const uint32_t kSize = 10000;
+
+  gscoped_ptr<float[]> floats(new float[kSize]);
+  for (int i = 0; i < kSize; i++) {
+    floats.get()[i] = random() + static_cast<float>(random())/INT_MAX;
+  }
+
+  TestEncodeDecodeTemplateBlockEncoder<FLOAT, FloatXorBlockBuilder<FLOAT>,
+                                    FloatXorBlockDecoder<FLOAT> >(floats.get(), kSize);
+}
+
+TEST_F(TestEncoding, TestFloatXorDoubleBlockEncoder) {
+  const uint32_t kSize = 10000;
+
+  gscoped_ptr<double[]> doubles(new double[kSize]);
+  for (int i = 0; i < kSize; i++) {
+    doubles.get()[i] = random() + static_cast<double>(random())/INT_MAX;
+  }
+
+  TestEncodeDecodeTemplateBlockEncoder<DOUBLE, FloatXorBlockBuilder<DOUBLE>,
+                                    FloatXorBlockDecoder<DOUBLE> >(doubles.get(), kSize);
+}
+
+// Test that slowly varying metrics are stored in a fraction of their plain
+// size, and that seeking by value works on sorted values.
+TEST_F(TestEncoding, TestFloatXorSlowlyVaryingDoubles) {
+  const uint32_t kSize = 10000;
+
+  gscoped_ptr<double[]> doubles(new double[kSize]);
+  for (int i = 0; i < kSize; i++) {
+    // A slowly increasing gauge, sampled with a precision of 1/16.
+    doubles.get()[i] = 1000 + (i / 10) * 0.0625;
+  }
+  TestEncodeDecodeTemplateBlockEncoder<DOUBLE, FloatXorBlockBuilder<DOUBLE>,
+                                    FloatXorBlockDecoder<DOUBLE> >(doubles.get(), kSize);
+
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  FloatXorBlockBuilder<DOUBLE> fbb(opts.get());
+  fbb.Add(reinterpret_cast<const uint8_t *>(doubles.get()), kSize);
+  Slice s = fbb.Finish(0);
+  LOG(INFO) << "Float XOR encoded size for 10k doubles: " << s.size();
+  ASSERT_LT(s.size(), kSize * sizeof(double) / 2);
+
+  FloatXorBlockDecoder<DOUBLE> fbd(s);
+  ASSERT_OK(fbd.ParseHeader());
+  for (int i = 0; i < 100; i++) {
+    int idx = random() % kSize;
+    double target = doubles.get()[idx];
+    bool exact;
+    ASSERT_OK(fbd.SeekAtOrAfterValue(&target, &exact));
+    ASSERT_TRUE(exact);
+    // The first of the equal values is found.
+    ASSERT_EQ(idx - idx % 10, fbd.GetCurrentIndex());
+
+    target += 0.03125;
+    Status st = fbd.SeekAtOrAfterValue(&target, &exact);
+    if (idx >= kSize - 10) {
+      ASSERT_TRUE(st.IsNotFound());
+      continue;
+    }
+    ASSERT_OK(st);
+    ASSERT_FALSE(exact);
+    ASSERT_EQ(idx - idx % 10 + 10, fbd.GetCurrentIndex());
+    double got;
+    CopyOne<DOUBLE>(&fbd, &got);
+    ASSERT_EQ(doubles.get()[idx] + 0.0625, got);
+  }
+}
+
+TEST_F(TestEncoding, TestFloatXorEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode<FloatXorBlockBuilder<DOUBLE>, FloatXorBlockDecoder<DOUBLE>>();
+}
+
 TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   unique_ptr<WriterOptions> opts(NewWriterOptions());
   RleIntBlockBuilder<UINT32> ibb(opts.get());
@@ -804,6 +918,50 @@ TEST_F(TestEncoding, TestBinaryPlainBlockBuilderSeekByValueLargeBlock) {
   TestStringSeekByValueLargeBlock<BinaryPlainBlockBuilder, BinaryPlainBlockDecoder>();
 }
 
+// Test batch decoding and seeking of prefix-encoded values which repeat or
+// truncate the value before them, and so share their bytes in the output.
+TEST_F(TestEncoding, TestBinaryPrefixBlockRepeatedValues) {
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  BinaryPrefixBlockBuilder sbb(opts.get());
+  const uint kCount = 100;
+  // Each value appears three times: 'key 00', 'key 00', 'key 00', 'key 01', ...
+  const auto& GenTestString = [](int i) {
+    return StringPrintf("key %02d", i / 3);
+  };
+  Slice s = CreateBinaryBlock(&sbb, kCount, GenTestString);
+  BinaryPrefixBlockDecoder sbd(s);
+  ASSERT_OK(sbd.ParseHeader());
+
+  // Skip across several restart points and decode the rest in one batch.
+  sbd.SeekToPositionInBlock(40);
+  ScopedColumnBlock<STRING> cb(kCount);
+  ColumnDataView cdv(&cb);
+  size_t n = kCount;
+  ASSERT_OK(sbd.CopyNextValues(&n, &cdv));
+  ASSERT_EQ(kCount - 40, n);
+  for (uint i = 0; i < n; i++) {
+    ASSERT_EQ(GenTestString(i + 40), cb[i].ToString()) << "failed at " << i;
+  }
+  ASSERT_FALSE(sbd.HasNext());
+
+  // Seeking lands on the first of a run of equal values.
+  Slice q = "key 20";
+  bool exact;
+  ASSERT_OK(sbd.SeekAtOrAfterValue(&q, &exact));
+  ASSERT_TRUE(exact);
+  ASSERT_EQ(60, sbd.GetCurrentIndex());
+
+  q = "key 20x";
+  ASSERT_OK(sbd.SeekAtOrAfterValue(&q, &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(63, sbd.GetCurrentIndex());
+
+  q = "key 2";
+  ASSERT_OK(sbd.SeekAtOrAfterValue(&q, &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(60, sbd.GetCurrentIndex());
+}
+
 // Test round-trip encode/decode of a binary block.
 TEST_F(TestEncoding, TestBinaryPrefixBlockBuilderRoundTrip) {
   TestBinaryBlockRoundTrip<BinaryPrefixBlockBuilder, BinaryPrefixBlockDecoder>();
@@ -859,7 +1017,16 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+
+struct DeltaBitPackTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef DeltaBitPackBlockBuilder<type> encoder_type;
+    typedef DeltaBitPackBlockDecoder<type> decoder_type;
+  };
+};
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       DeltaBitPackTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
@@ -882,6 +1049,61 @@ class IntEncodingTest : public TestEncoding {
     }
   }
 
+  // Decodes a block of runs of repeated values with a sparse selection vector,
+  // and checks that the selected rows are intact and the others zeroed.
+  template <DataType IntType>
+  void DoCopySelectedValuesTest() {
+    typedef typename TestTraits::template Classes<IntType>::encoder_type encoder_type;
+    typedef typename TestTraits::template Classes<IntType>::decoder_type decoder_type;
+    typedef typename TypeTraits<IntType>::cpp_type CppType;
+    const int kNumRows = 10000;
+
+    vector<CppType> to_insert;
+    while (to_insert.size() < kNumRows) {
+      CppType val = random() % 100 + 1;
+      int run = std::min<int>(random() % 100 + 1, kNumRows - to_insert.size());
+      to_insert.insert(to_insert.end(), run, val);
+    }
+    gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+    encoder_type ibb(opts.get());
+    ASSERT_EQ(kNumRows, ibb.Add(reinterpret_cast<const uint8_t *>(&to_insert[0]), kNumRows));
+    Slice s = ibb.Finish(0);
+    decoder_type ibd(s);
+    ASSERT_OK(ibd.ParseHeader());
+
+    // Alternate runs of selected and deselected rows, of both short lengths,
+    // which may be decoded anyway, and long ones.
+    SelectionVector sel(kNumRows);
+    sel.SetAllFalse();
+    for (int i = 0; i < kNumRows;) {
+      int run = random() % 2 == 0 ? random() % 5 + 1 : random() % 500 + 1;
+      if (random() % 3 == 0) {
+        for (int j = i; j < std::min(i + run, kNumRows); j++) {
+          sel.SetRowSelected(j);
+        }
+      }
+      i += run;
+    }
+
+    vector<CppType> decoded(kNumRows, 1);
+    ColumnBlock dst_block(GetTypeInfo(IntType), nullptr, &decoded[0], kNumRows, &arena_);
+    SelectionVectorView sel_view(&sel);
+    size_t dec_count = 0;
+    while (ibd.HasNext()) {
+      size_t n = random() % 1000 + 1;
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK(ibd.CopySelectedValues(&n, sel_view, &dst_data));
+      ASSERT_GT(n, 0);
+      dec_count += n;
+      ASSERT_EQ(dec_count, ibd.GetCurrentIndex());
+      sel_view.Advance(n);
+    }
+    ASSERT_EQ(kNumRows, dec_count);
+    for (int i = 0; i < kNumRows; i++) {
+      ASSERT_EQ(sel.IsRowSelected(i) ? to_insert[i] : 0, decoded[i]) << "row " << i;
+    }
+  }
+
   template <DataType IntType>
   void DoIntRoundTripTest() {
     typedef typename TestTraits::template Classes<IntType>::encoder_type encoder_type;
@@ -933,6 +1155,13 @@ TYPED_TEST(IntEncodingTest, TestRoundTrip) {
   // this->template DoIntRoundTripTest<INT128>();
 }
 
+TYPED_TEST(IntEncodingTest, TestCopySelectedValues) {
+  this->template DoCopySelectedValuesTest<UINT8>();
+  this->template DoCopySelectedValuesTest<INT16>();
+  this->template DoCopySelectedValuesTest<UINT32>();
+  this->template DoCopySelectedValuesTest<INT64>();
+}
+
 #ifdef NDEBUG
 TYPED_TEST(IntEncodingTest, IntSeekBenchmark) {
   this->template DoIntSeekTest<INT32>(32768, 10000, false);
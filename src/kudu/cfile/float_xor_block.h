@@ -0,0 +1,491 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// XOR-based encoding for floating point types, as described in the paper
+// "Gorilla: A Fast, Scalable, In-Memory Time Series Database". Slowly
+// varying values share their sign, exponent and high mantissa bits with
+// the previous value, so only the few bits which differ are stored.
+#ifndef KUDU_CFILE_FLOAT_XOR_BLOCK_H
+#define KUDU_CFILE_FLOAT_XOR_BLOCK_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bit-stream-utils.h"
+#include "kudu/util/bit-stream-utils.inline.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// The number of values between two points from which decoding can start.
+static const int kFloatXorRestartInterval = 128;
+
+// Traits of the bit representation of the floating point types.
+template<DataType Type>
+struct FloatXorTraits;
+
+template<>
+struct FloatXorTraits<FLOAT> {
+  typedef uint32_t BitsType;
+  // The number of bits used for the leading zero count and the length of
+  // the meaningful bits.
+  static const int kFieldBits = 5;
+};
+
+template<>
+struct FloatXorTraits<DOUBLE> {
+  typedef uint64_t BitsType;
+  static const int kFieldBits = 6;
+};
+
+// FloatXorBlockBuilder stores each value as the XOR of its bits with the
+// bits of the previous value.
+//
+// The block format is as follows:
+//
+// 1. Header: (16 bytes total)
+//
+//    <first_ordinal> [32-bit]
+//      The ordinal offset of the first element in the block.
+//
+//    <num_elements> [32-bit]
+//      The number of elements encoded in the block.
+//
+//    <encoded_size> [32-bit]
+//      The size of the block, including this header.
+//
+//    <restarts_offset> [32-bit]
+//      The offset of the restart array from the start of the block.
+//
+// 2. Element data
+//
+//    Every kFloatXorRestartInterval-th element (a restart point) is stored
+//    as is, starting on a byte boundary. Each other element is stored as
+//    the XOR 'x' of its bits with the bits of the previous element:
+//
+//      '0'
+//        if 'x' is zero, i.e. the element is equal to the previous one.
+//      '10' <meaningful bits>
+//        if the meaningful bits of 'x' fit within the window of leading and
+//        trailing zeros of the previous non-zero XOR since the restart point.
+//      '11' <leading zeros> <meaningful length - 1> <meaningful bits>
+//        otherwise. Both fields are 5 bits wide for FLOAT and 6 bits wide for
+//        DOUBLE, and the meaningful bits become the new window.
+//
+// 3. Restart array
+//
+//    The offset of each restart point from the start of the block [32-bit].
+//    It lets the decoder seek to an ordinal without decoding the elements of
+//    the previous intervals.
+//
+//   NOTE: all on-disk ints are encoded little-endian
+//
+template<DataType Type>
+class FloatXorBlockBuilder final : public BlockBuilder {
+ public:
+  explicit FloatXorBlockBuilder(const WriterOptions* options)
+    : count_(0),
+      options_(options) {
+    Reset();
+  }
+
+  void Reset() OVERRIDE {
+    auto block_size = options_->storage_attributes.cfile_block_size;
+    count_ = 0;
+    data_.clear();
+    data_.reserve(block_size);
+    buffer_.clear();
+    finished_ = false;
+    rem_elem_capacity_ = block_size / size_of_type;
+  }
+
+  bool IsBlockFull() const override {
+    return rem_elem_capacity_ == 0;
+  }
+
+  int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    DCHECK(!finished_);
+    int to_add = std::min<int>(rem_elem_capacity_, count);
+    data_.append(vals_void, to_add * size_of_type);
+    count_ += to_add;
+    rem_elem_capacity_ -= to_add;
+    return to_add;
+  }
+
+  size_t Count() const OVERRIDE {
+    return count_;
+  }
+
+  Status GetFirstKey(void* key) const OVERRIDE {
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[0], size_of_type);
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const OVERRIDE {
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[(count_ - 1) * size_of_type], size_of_type);
+    return Status::OK();
+  }
+
+  Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    BitWriter writer(&buffer_);
+    writer.PutAligned<uint32_t>(ordinal_pos, 4);
+    writer.PutAligned<uint32_t>(count_, 4);
+    // The encoded size and restarts offset are filled in at the end.
+    writer.PutAligned<uint32_t>(0, 4);
+    writer.PutAligned<uint32_t>(0, 4);
+
+    std::vector<uint32_t> restarts;
+    BitsType prev = 0;
+    int window_leading = 0;
+    int window_length = 0;
+    for (uint32_t i = 0; i < count_; i++) {
+      BitsType bits = cell(i);
+      if (i % kFloatXorRestartInterval == 0) {
+        restarts.push_back(writer.bytes_written());
+        writer.PutAligned<BitsType>(bits, size_of_type);
+        window_length = 0;
+        prev = bits;
+        continue;
+      }
+      uint64_t x = bits ^ prev;
+      prev = bits;
+      if (x == 0) {
+        writer.PutValue(0, 1);
+        continue;
+      }
+      writer.PutValue(1, 1);
+      int leading = kBits - 1 - Bits::Log2FloorNonZero64(x);
+      int trailing = Bits::FindLSBSetNonZero64(x);
+      if (window_length > 0 &&
+          leading >= window_leading &&
+          trailing >= kBits - window_leading - window_length) {
+        writer.PutValue(0, 1);
+        writer.PutValue(x >> (kBits - window_leading - window_length), window_length);
+        continue;
+      }
+      window_leading = leading;
+      window_length = kBits - leading - trailing;
+      writer.PutValue(1, 1);
+      writer.PutValue(window_leading, kFieldBits);
+      writer.PutValue(window_length - 1, kFieldBits);
+      writer.PutValue(x >> trailing, window_length);
+    }
+
+    uint32_t restarts_offset = writer.bytes_written();
+    for (uint32_t restart : restarts) {
+      writer.PutAligned<uint32_t>(restart, 4);
+    }
+    writer.Flush(/* align */ true);
+
+    InlineEncodeFixed32(&buffer_[8], buffer_.size());
+    InlineEncodeFixed32(&buffer_[12], restarts_offset);
+    finished_ = true;
+    return Slice(buffer_);
+  }
+
+ private:
+  typedef typename FloatXorTraits<Type>::BitsType BitsType;
+
+  BitsType cell(int idx) const {
+    BitsType ret;
+    memcpy(&ret, &data_[idx * size_of_type], size_of_type);
+    return ret;
+  }
+
+  enum {
+    size_of_type = TypeTraits<Type>::size,
+    kBits = size_of_type * 8,
+    kFieldBits = FloatXorTraits<Type>::kFieldBits
+  };
+
+  faststring data_;
+  faststring buffer_;
+  uint32_t count_;
+  int rem_elem_capacity_;
+  bool finished_;
+  const WriterOptions* options_;
+};
+
+// Unlike the bitshuffle decoder, FloatXorBlockDecoder doesn't expand the
+// block up front: CopyNextValues() decodes straight into the destination
+// column block, and seeks replay at most a restart interval.
+template<DataType Type>
+class FloatXorBlockDecoder final : public BlockDecoder {
+ public:
+  explicit FloatXorBlockDecoder(Slice slice)
+      : data_(slice),
+        parsed_(false),
+        ordinal_pos_base_(0),
+        num_elems_(0),
+        restarts_offset_(0),
+        cur_idx_(0),
+        prev_(0),
+        window_leading_(0),
+        window_length_(0) {
+  }
+
+  Status ParseHeader() OVERRIDE {
+    CHECK(!parsed_);
+    if (data_.size() < kHeaderSize) {
+      return Status::Corruption(
+        strings::Substitute("not enough bytes for header: float XOR block header "
+          "size ($0) less than expected header length ($1)",
+          data_.size(), kHeaderSize));
+    }
+
+    ordinal_pos_base_ = DecodeFixed32(&data_[0]);
+    num_elems_        = DecodeFixed32(&data_[4]);
+    uint32_t encoded_size = DecodeFixed32(&data_[8]);
+    if (encoded_size != data_.size()) {
+      return Status::Corruption("Size Information unmatched");
+    }
+    restarts_offset_  = DecodeFixed32(&data_[12]);
+    uint32_t num_restarts = (num_elems_ + kFloatXorRestartInterval - 1) / kFloatXorRestartInterval;
+    if (restarts_offset_ < kHeaderSize ||
+        restarts_offset_ + num_restarts * sizeof(uint32_t) != data_.size()) {
+      return Status::Corruption(strings::Substitute(
+          "invalid restart array offset $0 for $1 elements in a $2-byte block",
+          restarts_offset_, num_elems_, data_.size()));
+    }
+    for (uint32_t i = 0; i < num_restarts; i++) {
+      if (restart_offset(i) < kHeaderSize ||
+          restart_offset(i) + size_of_type > restarts_offset_) {
+        return Status::Corruption(strings::Substitute("invalid offset for restart point $0", i));
+      }
+    }
+
+    parsed_ = true;
+    SeekToRestart(0);
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) OVERRIDE {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    if (PREDICT_FALSE(num_elems_ == 0)) {
+      DCHECK_EQ(0, pos);
+      return;
+    }
+
+    DCHECK_LE(pos, num_elems_);
+    if (pos < cur_idx_ ||
+        pos / kFloatXorRestartInterval != cur_idx_ / kFloatXorRestartInterval) {
+      SeekToRestart(pos / kFloatXorRestartInterval);
+    }
+    BitsType ignored;
+    while (cur_idx_ < pos) {
+      // The restart array was validated when parsing the header, so this can
+      // only fail on a corrupted interval, which CopyNextValues() reports.
+      if (PREDICT_FALSE(!DecodeNext(&ignored))) {
+        cur_idx_ = pos;
+        return;
+      }
+    }
+  }
+
+  Status SeekAtOrAfterValue(const void* value_void, bool* exact) OVERRIDE {
+    CppType target = *reinterpret_cast<const CppType*>(value_void);
+    // Find the last restart point whose value is lower than or equal to the
+    // target, if any, and scan forward from there.
+    int32_t left = 0;
+    int32_t right = (num_elems_ + kFloatXorRestartInterval - 1) / kFloatXorRestartInterval;
+    while (left != right) {
+      uint32_t mid = (left + right) / 2;
+      if (restart_value(mid) > target) {
+        right = mid;
+      } else {
+        left = mid + 1;
+      }
+    }
+    SeekToRestart(left > 0 ? left - 1 : 0);
+
+    while (cur_idx_ < num_elems_) {
+      uint32_t idx = cur_idx_;
+      BitsType bits;
+      if (PREDICT_FALSE(!DecodeNext(&bits))) {
+        return Status::Corruption(
+            strings::Substitute("truncated float XOR block at element $0", idx));
+      }
+      CppType value;
+      memcpy(&value, &bits, size_of_type);
+      if (value >= target) {
+        *exact = value == target;
+        SeekToPositionInBlock(idx);
+        return Status::OK();
+      }
+    }
+    *exact = false;
+    return Status::NotFound("after last key in block");
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    DCHECK(parsed_);
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    uint8_t* out = dst->data();
+    for (size_t i = 0; i < max_fetch; i++) {
+      BitsType bits;
+      if (PREDICT_FALSE(!DecodeNext(&bits))) {
+        return Status::Corruption(
+            strings::Substitute("truncated float XOR block at element $0", cur_idx_));
+      }
+      memcpy(out, &bits, size_of_type);
+      out += size_of_type;
+    }
+
+    *n = max_fetch;
+    return Status::OK();
+  }
+
+  size_t GetCurrentIndex() const OVERRIDE {
+    DCHECK(parsed_) << "must parse header first";
+    return cur_idx_;
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return ordinal_pos_base_;
+  }
+
+  size_t Count() const OVERRIDE {
+    return num_elems_;
+  }
+
+  bool HasNext() const OVERRIDE {
+    return (num_elems_ - cur_idx_) > 0;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename FloatXorTraits<Type>::BitsType BitsType;
+
+  uint32_t restart_offset(uint32_t restart) const {
+    return DecodeFixed32(&data_[restarts_offset_ + restart * sizeof(uint32_t)]);
+  }
+
+  CppType restart_value(uint32_t restart) const {
+    CppType ret;
+    memcpy(&ret, &data_[restart_offset(restart)], size_of_type);
+    return ret;
+  }
+
+  void SeekToRestart(uint32_t restart) {
+    cur_idx_ = restart * kFloatXorRestartInterval;
+    if (cur_idx_ >= num_elems_) {
+      cur_idx_ = num_elems_;
+      return;
+    }
+    uint32_t offset = restart_offset(restart);
+    reader_ = BitReader(&data_[offset], restarts_offset_ - offset);
+  }
+
+  // Decode the element at 'cur_idx_' and advance to the next one.
+  // Returns false if the element data is truncated or invalid.
+  bool DecodeNext(BitsType* out) {
+    if (cur_idx_ % kFloatXorRestartInterval == 0) {
+      if (PREDICT_FALSE(!reader_.GetAligned<BitsType>(size_of_type, &prev_))) {
+        return false;
+      }
+      window_leading_ = 0;
+      window_length_ = kBits;
+    } else {
+      uint64_t control;
+      if (PREDICT_FALSE(!reader_.GetValue(1, &control))) {
+        return false;
+      }
+      if (control != 0) {
+        if (PREDICT_FALSE(!reader_.GetValue(1, &control))) {
+          return false;
+        }
+        if (control != 0) {
+          uint64_t leading;
+          uint64_t length;
+          if (PREDICT_FALSE(!reader_.GetValue(kFieldBits, &leading) ||
+                            !reader_.GetValue(kFieldBits, &length) ||
+                            leading + length + 1 > kBits)) {
+            return false;
+          }
+          window_leading_ = leading;
+          window_length_ = length + 1;
+        }
+        uint64_t meaningful;
+        if (PREDICT_FALSE(!reader_.GetValue(window_length_, &meaningful))) {
+          return false;
+        }
+        prev_ ^= meaningful << (kBits - window_leading_ - window_length_);
+      }
+    }
+    *out = prev_;
+    cur_idx_++;
+    return true;
+  }
+
+  // Length of a header.
+  static const size_t kHeaderSize = sizeof(uint32_t) * 4;
+  enum {
+    size_of_type = TypeTraits<Type>::size,
+    kBits = size_of_type * 8,
+    kFieldBits = FloatXorTraits<Type>::kFieldBits
+  };
+
+  Slice data_;
+  bool parsed_;
+
+  rowid_t ordinal_pos_base_;
+  uint32_t num_elems_;
+  uint32_t restarts_offset_;
+
+  // The decoding state of the element at 'cur_idx_'.
+  uint32_t cur_idx_;
+  BitReader reader_;
+  BitsType prev_;
+  int window_leading_;
+  int window_length_;
+};
+
+} // namespace cfile
+} // namespace kudu
+#endif
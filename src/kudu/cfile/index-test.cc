@@ -30,6 +30,7 @@
 #include "kudu/common/key_encoder.h"
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/slice.h"
@@ -336,6 +337,63 @@ TEST(TestIndexBlock, TestIterator) {
   ASSERT_TRUE(iter->HasNext());
 }
 
+// Test that prefix-compressed index blocks are smaller than those with whole
+// keys, and are seeked and iterated the same way.
+TEST(TestIndexBlock, TestPrefixCompressedKeys) {
+  const int kNumEntries = 1000;
+  const auto key_for = [](int i) {
+    return strings::Substitute("some-long-composite-key-prefix/$0", 100000 + i * 10);
+  };
+  WriterOptions whole_opts;
+  whole_opts.index_block_restart_interval = 0;
+  IndexBlockBuilder whole_idx(&whole_opts, true);
+  WriterOptions opts;
+  opts.index_block_restart_interval = 16;
+  IndexBlockBuilder idx(&opts, true);
+  for (int i = 0; i < kNumEntries; i++) {
+    whole_idx.Add(key_for(i), BlockPointer(100000 + i, 64 * 1024));
+    idx.Add(key_for(i), BlockPointer(100000 + i, 64 * 1024));
+  }
+  ASSERT_EQ(kNumEntries, static_cast<int>(idx.count()));
+  Slice first_key;
+  ASSERT_OK(idx.GetFirstKey(&first_key));
+  ASSERT_EQ(key_for(0), first_key);
+
+  size_t est_size = idx.EstimateEncodedSize();
+  Slice s = idx.Finish();
+  EXPECT_LT(s.size(), est_size);
+  EXPECT_LT(s.size(), whole_idx.Finish().size() / 2);
+
+  IndexBlockReader reader;
+  ASSERT_OK(reader.Parse(s));
+  ASSERT_EQ(kNumEntries, static_cast<int>(reader.Count()));
+  gscoped_ptr<IndexBlockIterator> iter(reader.NewIterator());
+
+  // Seek to every key, and in between keys.
+  ASSERT_TRUE(iter->SeekAtOrBefore("some-long").IsNotFound());
+  for (int i = 0; i < kNumEntries; i++) {
+    ASSERT_OK(iter->SeekAtOrBefore(key_for(i)));
+    ASSERT_EQ(key_for(i), iter->GetCurrentKey());
+    ASSERT_EQ(100000 + i, static_cast<int>(iter->GetCurrentBlockPointer().offset()));
+
+    ASSERT_OK(iter->SeekAtOrBefore(key_for(i) + "5"));
+    ASSERT_EQ(key_for(i), iter->GetCurrentKey());
+    ASSERT_EQ(100000 + i, static_cast<int>(iter->GetCurrentBlockPointer().offset()));
+  }
+
+  // Iterate from an entry in the middle of a restart interval.
+  ASSERT_OK(iter->SeekToIndex(37));
+  for (int i = 37; i < kNumEntries; i++) {
+    ASSERT_EQ(key_for(i), iter->GetCurrentKey());
+    ASSERT_EQ(100000 + i, static_cast<int>(iter->GetCurrentBlockPointer().offset()));
+    ASSERT_EQ(i + 1 < kNumEntries, iter->HasNext());
+    if (iter->HasNext()) {
+      ASSERT_OK(iter->Next());
+    }
+  }
+  ASSERT_TRUE(iter->Next().IsNotFound());
+}
+
 TEST(TestIndexKeys, TestGetSeparatingKey) {
   // Test example cases
   Slice left = "";
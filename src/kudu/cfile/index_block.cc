@@ -17,12 +17,14 @@
 
 #include "kudu/cfile/index_block.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <ostream>
 #include <string>
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile_util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/coding-inl.h"
@@ -61,7 +63,9 @@ IndexBlockBuilder::IndexBlockBuilder(
   bool is_leaf)
   : options_(options),
     finished_(false),
-    is_leaf_(is_leaf) {
+    is_leaf_(is_leaf),
+    restart_interval_(std::max(0, options->index_block_restart_interval)),
+    num_entries_(0) {
 }
 
 
@@ -71,9 +75,22 @@ void IndexBlockBuilder::Add(const Slice &keyptr,
     "Must Reset() after Finish() before more Add()";
 
   size_t entry_offset = buffer_.size();
-  SliceEncode(keyptr, &buffer_);
+  if (restart_interval_ == 0) {
+    SliceEncode(keyptr, &buffer_);
+    entry_offsets_.push_back(entry_offset);
+  } else {
+    size_t shared = 0;
+    if (num_entries_ % restart_interval_ == 0) {
+      entry_offsets_.push_back(entry_offset);
+    } else {
+      shared = CommonPrefixLength(Slice(last_key_), keyptr);
+    }
+    InlinePutVarint32(&buffer_, shared);
+    SliceEncode(Slice(keyptr.data() + shared, keyptr.size() - shared), &buffer_);
+    last_key_.assign_copy(keyptr.data(), keyptr.size());
+  }
   ptr.EncodeTo(&buffer_);
-  entry_offsets_.push_back(entry_offset);
+  num_entries_++;
 }
 
 Slice IndexBlockBuilder::Finish() {
@@ -84,9 +101,12 @@ Slice IndexBlockBuilder::Finish() {
   }
 
   IndexBlockTrailerPB trailer;
-  trailer.set_num_entries(entry_offsets_.size());
+  trailer.set_num_entries(num_entries_);
   trailer.set_type(
     is_leaf_ ? IndexBlockTrailerPB::LEAF : IndexBlockTrailerPB::INTERNAL);
+  if (restart_interval_ > 0) {
+    trailer.set_restart_interval(restart_interval_);
+  }
   AppendPBToString(trailer, &buffer_);
 
   InlinePutFixed32(&buffer_, trailer.GetCachedSize());
@@ -105,7 +125,18 @@ Status IndexBlockBuilder::GetFirstKey(Slice *key) const {
     return Status::NotFound("no keys in builder");
   }
 
-  bool success = nullptr != SliceDecode(buffer_.data(),buffer_.data() + buffer_.size(),key);
+  const uint8_t *ptr = buffer_.data();
+  const uint8_t *limit = buffer_.data() + buffer_.size();
+  if (restart_interval_ > 0) {
+    // The first entry is a restart point, which shares no prefix.
+    uint32_t shared;
+    ptr = GetVarint32Ptr(ptr, limit, &shared);
+    if (ptr == nullptr) {
+      return Status::Corruption("Unable to decode first key");
+    }
+  }
+
+  bool success = nullptr != SliceDecode(ptr, limit, key);
 
   if (success) {
     return Status::OK();
@@ -131,7 +162,9 @@ size_t IndexBlockBuilder::EstimateEncodedSize() const {
 // Construct a reader.
 // After construtoin, call
 IndexBlockReader::IndexBlockReader()
-  : parsed_(false) {
+  : parsed_(false),
+    restart_interval_(0),
+    num_offsets_(0) {
 }
 
 void IndexBlockReader::Reset() {
@@ -169,8 +202,18 @@ Status IndexBlockReader::Parse(const Slice &data) {
       trailer_.InitializationErrorString());
   }
 
-  key_offsets_ = trailer_ptr - sizeof(uint32_t) * trailer_.num_entries();
-  CHECK(trailer_ptr >= data_.data());
+  restart_interval_ = trailer_.restart_interval();
+  if (trailer_.num_entries() < 0 || restart_interval_ < 0) {
+    return Status::Corruption("invalid index block trailer",
+                              pb_util::SecureShortDebugString(trailer_));
+  }
+  num_offsets_ = restart_interval_ == 0 ?
+      trailer_.num_entries() :
+      (trailer_.num_entries() + restart_interval_ - 1) / restart_interval_;
+  if (sizeof(uint32_t) * num_offsets_ > static_cast<size_t>(trailer_ptr - data_.data())) {
+    return Status::Corruption("index block too small for its entries");
+  }
+  key_offsets_ = trailer_ptr - sizeof(uint32_t) * num_offsets_;
 
   VLOG(2) << "Parsed index trailer: " << pb_util::SecureDebugString(trailer_);
 
@@ -196,6 +239,15 @@ int IndexBlockReader::CompareKey(int idx_in_block,
                                  const Slice &search_key) const {
   const uint8_t *key_ptr, *limit;
   GetKeyPointer(idx_in_block, &key_ptr, &limit);
+  if (restart_interval_ > 0) {
+    // Restart points share no prefix: skip the length of the shared prefix.
+    uint32_t shared;
+    key_ptr = GetVarint32Ptr(key_ptr, limit, &shared);
+    if (PREDICT_FALSE(key_ptr == nullptr)) {
+      LOG(WARNING)<< "Invalid data in block!";
+      return 0;
+    }
+  }
   Slice this_slice;
   if (PREDICT_FALSE(SliceDecode(key_ptr, limit, &this_slice) == nullptr)) {
     LOG(WARNING)<< "Invalid data in block!";
@@ -224,17 +276,48 @@ Status IndexBlockReader::ReadEntry(size_t idx, Slice *key, BlockPointer *block_p
   return block_ptr->DecodeFrom(ptr, data_.data() + data_.size());
 }
 
+const uint8_t *IndexBlockReader::DecodePrefixEntry(const uint8_t *ptr, faststring *key,
+                                                   BlockPointer *block_ptr) const {
+  // The entries end where the offsets begin.
+  const uint8_t *limit = key_offsets_;
+  uint32_t shared;
+  ptr = GetVarint32Ptr(ptr, limit, &shared);
+  if (ptr == nullptr || shared > key->size()) {
+    return nullptr;
+  }
+  Slice suffix;
+  ptr = SliceDecode(ptr, limit, &suffix);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  key->resize(shared);
+  key->append(suffix.data(), suffix.size());
+
+  uint64_t offset;
+  uint32_t size;
+  ptr = GetVarint64Ptr(ptr, limit, &offset);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  ptr = GetVarint32Ptr(ptr, limit, &size);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  *block_ptr = BlockPointer(offset, size);
+  return ptr;
+}
+
 void IndexBlockReader::GetKeyPointer(int idx_in_block, const uint8_t **ptr,
                                      const uint8_t **limit) const {
   size_t offset_in_block = DecodeFixed32(
     &key_offsets_[idx_in_block * sizeof(uint32_t)]);
   *ptr = data_.data() + offset_in_block;
 
-  int next_idx = idx_in_block + 1;
+  size_t next_idx = idx_in_block + 1;
 
-  if (PREDICT_FALSE(next_idx >= trailer_.num_entries())) {
-    DCHECK(next_idx == Count()) << "Bad index: " << idx_in_block
-                                << " Count: " << Count();
+  if (PREDICT_FALSE(next_idx >= num_offsets_)) {
+    DCHECK(next_idx == num_offsets_) << "Bad index: " << idx_in_block
+                                     << " Count: " << num_offsets_;
     // last key in block: limit is the beginning of the offsets array
     *limit = key_offsets_;
   } else {
@@ -248,21 +331,30 @@ void IndexBlockReader::GetKeyPointer(int idx_in_block, const uint8_t **ptr,
 void IndexBlockBuilder::Reset() {
   buffer_.clear();
   entry_offsets_.clear();
+  num_entries_ = 0;
+  last_key_.clear();
   finished_ = false;
 }
 
 IndexBlockIterator::IndexBlockIterator(const IndexBlockReader *reader)
   : reader_(reader),
     cur_idx_(-1),
-    seeked_(false) {
+    seeked_(false),
+    cur_key_buf_(0),
+    next_entry_(nullptr) {
 }
 
 void IndexBlockIterator::Reset() {
   seeked_ = false;
   cur_idx_ = -1;
+  next_entry_ = nullptr;
 }
 
 Status IndexBlockIterator::SeekAtOrBefore(const Slice &search_key) {
+  if (reader_->restart_interval_ > 0) {
+    return SeekAtOrBeforePrefixCompressed(search_key);
+  }
+
   size_t left = 0;
   size_t right = reader_->Count() - 1;
   while (left < right) {
@@ -291,11 +383,74 @@ Status IndexBlockIterator::SeekAtOrBefore(const Slice &search_key) {
   return SeekToIndex(left);
 }
 
+Status IndexBlockIterator::SeekAtOrBeforePrefixCompressed(const Slice &search_key) {
+  size_t left = 0;
+  size_t right = reader_->num_offsets_ - 1;
+  while (left < right) {
+    size_t mid = (left + right + 1) / 2;
+    if (reader_->CompareKey(mid, search_key) <= 0) {
+      left = mid;
+    } else {
+      right = mid - 1;
+    }
+  }
+  if (reader_->CompareKey(left, search_key) > 0) {
+    return Status::NotFound("key not present");
+  }
+  RETURN_NOT_OK(SeekToIndex(left * reader_->restart_interval_));
+
+  // Decode the following entries into the other buffer until one is past the
+  // key. The next restart point, if any, is past it.
+  seeked_ = false;
+  BlockPointer next_ptr;
+  while (HasNext()) {
+    faststring *next_key = &key_bufs_[1 - cur_key_buf_];
+    next_key->assign_copy(key_bufs_[cur_key_buf_].data(), key_bufs_[cur_key_buf_].size());
+    const uint8_t *after = reader_->DecodePrefixEntry(next_entry_, next_key, &next_ptr);
+    if (PREDICT_FALSE(after == nullptr)) {
+      return Status::Corruption("Invalid key in index");
+    }
+    if (Slice(*next_key).compare(search_key) > 0) {
+      break;
+    }
+    cur_key_buf_ = 1 - cur_key_buf_;
+    cur_ptr_ = next_ptr;
+    cur_idx_++;
+    next_entry_ = after;
+  }
+  cur_key_ = Slice(key_bufs_[cur_key_buf_]);
+  seeked_ = true;
+  return Status::OK();
+}
+
 Status IndexBlockIterator::SeekToIndex(size_t idx) {
   cur_idx_ = idx;
-  Status s = reader_->ReadEntry(idx, &cur_key_, &cur_ptr_);
-  seeked_ = s.ok();
-  return s;
+  if (reader_->restart_interval_ == 0) {
+    Status s = reader_->ReadEntry(idx, &cur_key_, &cur_ptr_);
+    seeked_ = s.ok();
+    return s;
+  }
+
+  seeked_ = false;
+  if (idx >= reader_->Count()) {
+    return Status::NotFound("Invalid index");
+  }
+  // Decode forward from the restart point at or before the entry.
+  const size_t restart = idx / reader_->restart_interval_;
+  const uint8_t *ptr, *limit;
+  reader_->GetKeyPointer(restart, &ptr, &limit);
+  faststring *key = &key_bufs_[cur_key_buf_];
+  key->clear();
+  for (size_t i = restart * reader_->restart_interval_; i <= idx; i++) {
+    ptr = reader_->DecodePrefixEntry(ptr, key, &cur_ptr_);
+    if (PREDICT_FALSE(ptr == nullptr)) {
+      return Status::Corruption("Invalid key in index");
+    }
+  }
+  cur_key_ = Slice(*key);
+  next_entry_ = ptr;
+  seeked_ = true;
+  return Status::OK();
 }
 
 bool IndexBlockIterator::HasNext() const {
@@ -303,7 +458,20 @@ bool IndexBlockIterator::HasNext() const {
 }
 
 Status IndexBlockIterator::Next() {
-  return SeekToIndex(cur_idx_ + 1);
+  if (reader_->restart_interval_ == 0 || !seeked_ || !HasNext()) {
+    return SeekToIndex(cur_idx_ + 1);
+  }
+  // Prefix-compressed entries are decoded in place from the current one.
+  faststring *key = &key_bufs_[cur_key_buf_];
+  const uint8_t *after = reader_->DecodePrefixEntry(next_entry_, key, &cur_ptr_);
+  if (PREDICT_FALSE(after == nullptr)) {
+    seeked_ = false;
+    return Status::Corruption("Invalid key in index");
+  }
+  cur_idx_++;
+  cur_key_ = Slice(*key);
+  next_entry_ = after;
+  return Status::OK();
 }
 
 const BlockPointer &IndexBlockIterator::GetCurrentBlockPointer() const {
@@ -41,6 +41,12 @@ struct WriterOptions;
 // This works like the rest of the builders in the cfile package.
 // After repeatedly calling Add(), call Finish() to encode it
 // into a Slice, then you may Reset to re-use buffers.
+//
+// If the options' index_block_restart_interval is positive, keys are
+// prefix-compressed: each key is stored as the length of the prefix it
+// shares with the previous key, followed by the rest of the key. Every
+// index_block_restart_interval-th key is a restart point, stored whole, and
+// only the offsets of restart points are stored, for seeks to binary search.
 class IndexBlockBuilder {
  public:
   explicit IndexBlockBuilder(const WriterOptions *options,
@@ -63,7 +69,7 @@ class IndexBlockBuilder {
   // Return the number of entries already added to this index
   // block.
   size_t count() const {
-    return entry_offsets_.size();
+    return num_entries_;
   }
 
   // Return an estimate of the post-encoding size of this
@@ -89,8 +95,19 @@ class IndexBlockBuilder {
   // Is this a leaf block?
   bool is_leaf_;
 
+  // The number of entries between restart points, or 0 if keys are stored
+  // whole.
+  const int restart_interval_;
+
   faststring buffer_;
+
+  // The offsets of every entry, or of the restart points if keys are
+  // prefix-compressed.
   std::vector<uint32_t> entry_offsets_;
+  size_t num_entries_;
+
+  // The last key added, if keys are prefix-compressed.
+  faststring last_key_;
 };
 
 class IndexBlockReader {
@@ -117,12 +134,21 @@ class IndexBlockReader {
  private:
   friend class IndexBlockIterator;
 
+  // Compare the key at the given offset index with 'search_key'. If keys
+  // are prefix-compressed, the offsets are those of the restart points.
   int CompareKey(int idx_in_block, const Slice &search_key) const;
 
   Status ReadEntry(size_t idx, Slice *key, BlockPointer *block_ptr) const;
 
-  // Set *ptr to the beginning of the index data for the given index
-  // entry.
+  // Decodes the prefix-compressed entry at 'ptr', replacing 'key', which
+  // must hold the key of the previous entry unless 'ptr' is a restart point,
+  // with the entry's key. Returns a pointer past the entry, or nullptr if it
+  // is corrupt.
+  const uint8_t *DecodePrefixEntry(const uint8_t *ptr, faststring *key,
+                                   BlockPointer *block_ptr) const;
+
+  // Set *ptr to the beginning of the index data for the given offset
+  // index.
   // Set *limit to the 'limit' pointer for that entry (i.e a pointer
   // beyond which the data no longer is part of that entry).
   //   - *limit can be used to prevent overrunning in the case of a
@@ -136,6 +162,11 @@ class IndexBlockReader {
   const uint8_t *key_offsets_;
   bool parsed_;
 
+  // The restart interval of the block, 0 if its keys aren't
+  // prefix-compressed, and the number of offsets before its trailer.
+  int restart_interval_;
+  size_t num_offsets_;
+
   DISALLOW_COPY_AND_ASSIGN(IndexBlockReader);
 };
 
@@ -170,12 +201,24 @@ class IndexBlockIterator {
   const Slice GetCurrentKey() const;
 
  private:
+  // Seeks within a block of prefix-compressed keys, by binary searching its
+  // restart points and scanning forward from the last one at or before
+  // 'search_key'.
+  Status SeekAtOrBeforePrefixCompressed(const Slice &search_key);
+
   const IndexBlockReader *reader_;
   size_t cur_idx_;
   Slice cur_key_;
   BlockPointer cur_ptr_;
   bool seeked_;
 
+  // If the keys are prefix-compressed, 'cur_key_' points into one of these
+  // buffers, at index 'cur_key_buf_', and 'next_entry_' to the entry after
+  // the current one.
+  faststring key_bufs_[2];
+  int cur_key_buf_;
+  const uint8_t *next_entry_;
+
   DISALLOW_COPY_AND_ASSIGN(IndexBlockIterator);
 };
 
@@ -153,13 +153,21 @@ class PlainBitMapBlockDecoder final : public BlockDecoder {
       return;
     }
 
-    DCHECK_LT(pos, num_elems_);
+    // Seeking past the last element is valid, as for the other decoders.
+    DCHECK_LE(pos, num_elems_);
 
     reader_.SeekToBit(pos);
 
     cur_idx_ = pos;
   }
 
+  // Seeking is free, so only the selected rows are copied.
+  virtual Status CopySelectedValues(size_t* n,
+                                    const SelectionVectorView& sel,
+                                    ColumnDataView* dst) OVERRIDE {
+    return CopySelectedRuns(n, sel, dst, 1);
+  }
+
   // TODO : Support BOOL keys
   virtual Status SeekAtOrAfterValue(const void *value,
                                     bool *exact_match) OVERRIDE {
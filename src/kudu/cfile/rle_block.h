@@ -19,6 +19,7 @@
 #define KUDU_CFILE_RLE_BLOCK_H
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 
 #include "kudu/gutil/port.h"
@@ -104,6 +105,37 @@ class RleBitMapBlockBuilder final : public BlockBuilder {
   size_t count_;
 };
 
+// Copy the next 'nrows' values of 'decoder' into 'out', decoding only the
+// rows which are selected in 'sel'. Each selected row costs no more than its
+// RLE run, and runs of deselected rows are skipped. The cells of deselected
+// rows are zeroed.
+template<typename T>
+inline Status CopySelectedRleValues(RleDecoder<T>* decoder,
+                                    size_t nrows,
+                                    const SelectionVectorView& sel,
+                                    T* out) {
+  size_t pos = 0;
+  while (pos < nrows) {
+    size_t to_skip = sel.CountRun(pos, nrows - pos, false);
+    if (to_skip > 0) {
+      decoder->Skip(to_skip);
+      memset(out + pos, 0, to_skip * sizeof(T));
+      pos += to_skip;
+    }
+    size_t end = pos + sel.CountRun(pos, nrows - pos, true);
+    while (pos < end) {
+      T val;
+      size_t run = decoder->GetNextRun(&val, end - pos);
+      if (PREDICT_FALSE(run == 0)) {
+        return Status::Corruption("unexpected end of RLE data block");
+      }
+      std::fill(out + pos, out + pos + run, val);
+      pos += run;
+    }
+  }
+  return Status::OK();
+}
+
 //
 // RLE decoder for bool datatype
 //
@@ -192,6 +224,20 @@ class RleBitMapBlockDecoder final : public BlockDecoder {
     return Status::OK();
   }
 
+  virtual Status CopySelectedValues(size_t* n,
+                                    const SelectionVectorView& sel,
+                                    ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_EQ(dst->stride(), sizeof(bool));
+
+    size_t bits_to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    RETURN_NOT_OK(CopySelectedRleValues(&rle_decoder_, bits_to_fetch, sel,
+                                        reinterpret_cast<bool*>(dst->data())));
+    cur_idx_ += bits_to_fetch;
+    *n = bits_to_fetch;
+    return Status::OK();
+  }
+
   virtual Status SeekAtOrAfterValue(const void *value,
                                     bool *exact_match) OVERRIDE {
     return Status::NotSupported("BOOL keys are not supported!");
@@ -420,6 +466,20 @@ class RleIntBlockDecoder final : public BlockDecoder {
     return Status::OK();
   }
 
+  virtual Status CopySelectedValues(size_t* n,
+                                    const SelectionVectorView& sel,
+                                    ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    RETURN_NOT_OK(CopySelectedRleValues(&rle_decoder_, to_fetch, sel,
+                                        reinterpret_cast<CppType*>(dst->data())));
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
   virtual bool HasNext() const OVERRIDE {
     return cur_idx_ < num_elems_;
   }
@@ -22,6 +22,9 @@
 #include <utility>
 
 #include "kudu/cfile/bshuf_block.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/delta_bitpack_block.h"
+#include "kudu/cfile/float_xor_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
@@ -87,6 +90,40 @@ struct DataTypeEncodingTraits<Type, BIT_SHUFFLE> {
   }
 };
 
+// Generic, fallback, partial specialization that should work for all
+// integer types.
+template<DataType Type>
+struct DataTypeEncodingTraits<Type, DELTA_BITPACK> {
+
+  static Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) {
+    *bb = new DeltaBitPackBlockBuilder<Type>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
+                                   CFileIterator *iter) {
+    *bd = new DeltaBitPackBlockDecoder<Type>(slice);
+    return Status::OK();
+  }
+};
+
+// Generic, fallback, partial specialization that should work for all
+// floating point types.
+template<DataType Type>
+struct DataTypeEncodingTraits<Type, FLOAT_XOR> {
+
+  static Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) {
+    *bb = new FloatXorBlockBuilder<Type>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
+                                   CFileIterator *iter) {
+    *bd = new FloatXorBlockDecoder<Type>(slice);
+    return Status::OK();
+  }
+};
+
 // Template specialization for plain encoded string as they require a
 // specific encoder/decoder.
 template<>
@@ -99,7 +136,7 @@ struct DataTypeEncodingTraits<BINARY, PLAIN_ENCODING> {
 
   static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
                                    CFileIterator *iter) {
-    *bd = new BinaryPlainBlockDecoder(slice);
+    *bd = new BinaryPlainBlockDecoder(slice, iter->zero_copy_strings());
     return Status::OK();
   }
 };
@@ -243,31 +280,41 @@ class TypeEncodingResolver {
     AddMapping<UINT8, BIT_SHUFFLE>();
     AddMapping<UINT8, PLAIN_ENCODING>();
     AddMapping<UINT8, RLE>();
+    AddMapping<UINT8, DELTA_BITPACK>();
     AddMapping<INT8, BIT_SHUFFLE>();
     AddMapping<INT8, PLAIN_ENCODING>();
     AddMapping<INT8, RLE>();
+    AddMapping<INT8, DELTA_BITPACK>();
     AddMapping<UINT16, BIT_SHUFFLE>();
     AddMapping<UINT16, PLAIN_ENCODING>();
     AddMapping<UINT16, RLE>();
+    AddMapping<UINT16, DELTA_BITPACK>();
     AddMapping<INT16, BIT_SHUFFLE>();
     AddMapping<INT16, PLAIN_ENCODING>();
     AddMapping<INT16, RLE>();
+    AddMapping<INT16, DELTA_BITPACK>();
     AddMapping<UINT32, BIT_SHUFFLE>();
     AddMapping<UINT32, RLE>();
+    AddMapping<UINT32, DELTA_BITPACK>();
     AddMapping<UINT32, PLAIN_ENCODING>();
     AddMapping<INT32, BIT_SHUFFLE>();
     AddMapping<INT32, PLAIN_ENCODING>();
     AddMapping<INT32, RLE>();
+    AddMapping<INT32, DELTA_BITPACK>();
     AddMapping<UINT64, BIT_SHUFFLE>();
     AddMapping<UINT64, PLAIN_ENCODING>();
     AddMapping<UINT64, RLE>();
+    AddMapping<UINT64, DELTA_BITPACK>();
     AddMapping<INT64, BIT_SHUFFLE>();
     AddMapping<INT64, PLAIN_ENCODING>();
     AddMapping<INT64, RLE>();
+    AddMapping<INT64, DELTA_BITPACK>();
     AddMapping<FLOAT, BIT_SHUFFLE>();
     AddMapping<FLOAT, PLAIN_ENCODING>();
+    AddMapping<FLOAT, FLOAT_XOR>();
     AddMapping<DOUBLE, BIT_SHUFFLE>();
     AddMapping<DOUBLE, PLAIN_ENCODING>();
+    AddMapping<DOUBLE, FLOAT_XOR>();
     AddMapping<BINARY, DICT_ENCODING>();
     AddMapping<BINARY, PLAIN_ENCODING>();
     AddMapping<BINARY, PREFIX_ENCODING>();
@@ -311,6 +358,23 @@ const EncodingType TypeEncodingInfo::GetDefaultEncoding(const TypeInfo* typeinfo
   return Singleton<TypeEncodingResolver>::get()->GetDefaultEncoding(typeinfo->physical_type());
 }
 
+int TypeEncodingInfo::FirstOrdinalOffset(const TypeInfo* typeinfo, EncodingType encoding) {
+  switch (encoding) {
+    case BIT_SHUFFLE:
+    case DELTA_BITPACK:
+    case FLOAT_XOR:
+      return 0;
+    case RLE:
+      return 4;
+    case PLAIN_ENCODING:
+      // Plain binary blocks lead with the ordinal, other plain blocks with
+      // the count of values.
+      return typeinfo->physical_type() == BINARY ? 0 : 4;
+    default:
+      return -1;
+  }
+}
+
 }  // namespace cfile
 }  // namespace kudu
 
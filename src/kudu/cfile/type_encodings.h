@@ -41,6 +41,13 @@ class TypeEncodingInfo {
 
   static const EncodingType GetDefaultEncoding(const TypeInfo* typeinfo);
 
+  // Returns the offset, within the data blocks of 'typeinfo' values encoded
+  // with 'encoding', of the ordinal of the block's first value, stored as a
+  // little-endian fixed32. Returns -1 if the blocks of the encoding can't be
+  // moved to another position by rewriting that ordinal alone, e.g. because
+  // they refer to a file-wide dictionary.
+  static int FirstOrdinalOffset(const TypeInfo* typeinfo, EncodingType encoding);
+
   EncodingType encoding_type() const { return encoding_type_; }
 
   Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) const;
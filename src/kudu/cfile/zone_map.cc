@@ -0,0 +1,208 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/zone_map.h"
+
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+namespace cfile {
+
+ZoneMapBuilder::ZoneMapBuilder(const TypeInfo* typeinfo)
+    : typeinfo_(typeinfo),
+      key_encoder_(&GetKeyEncoder<faststring>(typeinfo)),
+      block_num_values_(0),
+      block_null_count_(0),
+      block_has_min_max_(false),
+      file_num_values_(0),
+      file_null_count_(0),
+      file_has_min_max_(false) {
+  DCHECK(IsTypeAllowableInKey(typeinfo));
+}
+
+void ZoneMapBuilder::AddValues(const uint8_t* cells, size_t count) {
+  const size_t cell_size = typeinfo_->size();
+  for (size_t i = 0; i < count; i++, cells += cell_size) {
+    key_encoder_->ResetAndEncode(cells, &tmp_buf_);
+    Slice encoded(tmp_buf_);
+    if (!block_has_min_max_) {
+      block_min_.assign_copy(encoded.data(), encoded.size());
+      block_max_.assign_copy(encoded.data(), encoded.size());
+      block_has_min_max_ = true;
+      continue;
+    }
+    if (encoded.compare(Slice(block_min_)) < 0) {
+      block_min_.assign_copy(encoded.data(), encoded.size());
+    } else if (encoded.compare(Slice(block_max_)) > 0) {
+      block_max_.assign_copy(encoded.data(), encoded.size());
+    }
+  }
+  block_num_values_ += count;
+}
+
+void ZoneMapBuilder::AddNulls(size_t count) {
+  block_num_values_ += count;
+  block_null_count_ += count;
+}
+
+void ZoneMapBuilder::FinishBlock(rowid_t first_ordinal, ZoneMapPB* zone_map) {
+  zone_map->set_first_ordinal(first_ordinal);
+  zone_map->set_num_values(block_num_values_);
+  zone_map->set_null_count(block_null_count_);
+  if (block_has_min_max_) {
+    zone_map->set_min_value(block_min_.data(), block_min_.size());
+    zone_map->set_max_value(block_max_.data(), block_max_.size());
+
+    if (!file_has_min_max_ || Slice(block_min_).compare(Slice(file_min_)) < 0) {
+      file_min_.assign_copy(block_min_.data(), block_min_.size());
+    }
+    if (!file_has_min_max_ || Slice(block_max_).compare(Slice(file_max_)) > 0) {
+      file_max_.assign_copy(block_max_.data(), block_max_.size());
+    }
+    file_has_min_max_ = true;
+  }
+  file_num_values_ += block_num_values_;
+  file_null_count_ += block_null_count_;
+
+  block_num_values_ = 0;
+  block_null_count_ = 0;
+  block_has_min_max_ = false;
+}
+
+void ZoneMapBuilder::AddFinishedBlock(const ZoneMapPB& block_zone_map,
+                                      rowid_t first_ordinal,
+                                      ZoneMapPB* zone_map) {
+  DCHECK_EQ(0, block_num_values_);
+  *zone_map = block_zone_map;
+  zone_map->set_first_ordinal(first_ordinal);
+  if (block_zone_map.has_min_value() && block_zone_map.has_max_value()) {
+    Slice min(block_zone_map.min_value());
+    Slice max(block_zone_map.max_value());
+    if (!file_has_min_max_ || min.compare(Slice(file_min_)) < 0) {
+      file_min_.assign_copy(min.data(), min.size());
+    }
+    if (!file_has_min_max_ || max.compare(Slice(file_max_)) > 0) {
+      file_max_.assign_copy(max.data(), max.size());
+    }
+    file_has_min_max_ = true;
+  }
+  file_num_values_ += block_zone_map.num_values();
+  file_null_count_ += block_zone_map.null_count();
+}
+
+void ZoneMapBuilder::FinishFile(ZoneMapPB* zone_map) const {
+  zone_map->set_first_ordinal(0);
+  zone_map->set_num_values(file_num_values_);
+  zone_map->set_null_count(file_null_count_);
+  if (file_has_min_max_) {
+    zone_map->set_min_value(file_min_.data(), file_min_.size());
+    zone_map->set_max_value(file_max_.data(), file_max_.size());
+  }
+}
+
+namespace {
+
+// Returns true if 'value' falls within the zone map's [min, max] range.
+bool ValueInRange(const KeyEncoder<faststring>& encoder,
+                  const void* value,
+                  const Slice& min,
+                  const Slice& max,
+                  faststring* buf) {
+  encoder.ResetAndEncode(value, buf);
+  Slice encoded(*buf);
+  return encoded.compare(min) >= 0 && encoded.compare(max) <= 0;
+}
+
+} // anonymous namespace
+
+bool ZoneMapMayMatch(const ColumnPredicate& pred, const ZoneMapPB& zone_map) {
+  if (!zone_map.has_num_values()) {
+    return true;
+  }
+  const int64_t num_non_null = zone_map.num_values() - zone_map.null_count();
+
+  switch (pred.predicate_type()) {
+    case PredicateType::None:
+      return false;
+    case PredicateType::IsNull:
+      return zone_map.null_count() > 0;
+    case PredicateType::IsNotNull:
+      return num_non_null > 0;
+    default:
+      break;
+  }
+
+  // The remaining predicate types only match non-NULL values.
+  if (num_non_null == 0) {
+    return false;
+  }
+  if (!zone_map.has_min_value() || !zone_map.has_max_value()) {
+    return true;
+  }
+  const TypeInfo* type_info = pred.column().type_info();
+  if (!IsTypeAllowableInKey(type_info)) {
+    return true;
+  }
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info);
+  Slice min(zone_map.min_value());
+  Slice max(zone_map.max_value());
+  faststring buf;
+
+  switch (pred.predicate_type()) {
+    case PredicateType::Equality:
+      return ValueInRange(encoder, pred.raw_lower(), min, max, &buf);
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter: {
+      // The lower bound is inclusive, the upper bound exclusive. The Bloom
+      // filters themselves say nothing about the range of matching values.
+      if (pred.raw_lower() != nullptr) {
+        encoder.ResetAndEncode(pred.raw_lower(), &buf);
+        if (max.compare(Slice(buf)) < 0) {
+          return false;
+        }
+      }
+      if (pred.raw_upper() != nullptr) {
+        encoder.ResetAndEncode(pred.raw_upper(), &buf);
+        if (min.compare(Slice(buf)) >= 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case PredicateType::InList:
+      for (const void* value : pred.raw_values()) {
+        if (ValueInRange(encoder, value, min, max, &buf)) {
+          return true;
+        }
+      }
+      return false;
+    default:
+      return true;
+  }
+}
+
+} // namespace cfile
+} // namespace kudu
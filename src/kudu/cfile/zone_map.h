@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CFILE_ZONE_MAP_H
+#define KUDU_CFILE_ZONE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+
+namespace kudu {
+
+class ColumnPredicate;
+class TypeInfo;
+
+template <typename Buffer>
+class KeyEncoder;
+
+namespace cfile {
+
+class ZoneMapPB;
+
+// Accumulates the zone map (min, max and null count) for a data block while
+// it is being written, and the zone map for the whole file across blocks.
+//
+// Min and max values are stored encoded with the type's key encoder, so that
+// readers can compare them against predicate bounds using memcmp.
+class ZoneMapBuilder {
+ public:
+  explicit ZoneMapBuilder(const TypeInfo* typeinfo);
+
+  // Add 'count' non-NULL cells, laid out contiguously starting at 'cells'.
+  void AddValues(const uint8_t* cells, size_t count);
+
+  // Add 'count' NULL cells.
+  void AddNulls(size_t count);
+
+  // Fill in 'zone_map' for all values added since the last call, whose first
+  // value has ordinal 'first_ordinal'. The block's statistics are folded into
+  // the file-wide zone map and then reset.
+  void FinishBlock(rowid_t first_ordinal, ZoneMapPB* zone_map);
+
+  // Fill in 'zone_map' with 'block_zone_map', the zone map of a block copied
+  // from another file, whose first value now has ordinal 'first_ordinal'. The
+  // block's statistics are folded into the file-wide zone map. No values may
+  // have been added since the last finished block.
+  void AddFinishedBlock(const ZoneMapPB& block_zone_map,
+                        rowid_t first_ordinal,
+                        ZoneMapPB* zone_map);
+
+  // Fill in 'zone_map' with the statistics of every block finished so far.
+  void FinishFile(ZoneMapPB* zone_map) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZoneMapBuilder);
+
+  const TypeInfo* typeinfo_;
+  const KeyEncoder<faststring>* key_encoder_;
+
+  // Statistics for the current block.
+  int64_t block_num_values_;
+  int64_t block_null_count_;
+  bool block_has_min_max_;
+  faststring block_min_;
+  faststring block_max_;
+
+  // Statistics for the file, over every finished block.
+  int64_t file_num_values_;
+  int64_t file_null_count_;
+  bool file_has_min_max_;
+  faststring file_min_;
+  faststring file_max_;
+
+  faststring tmp_buf_;
+};
+
+// Returns false if the values summarized by 'zone_map' definitely do not
+// satisfy 'pred'. Returns true if they might (e.g. if the zone map or the
+// predicate carries too little information to tell).
+bool ZoneMapMayMatch(const ColumnPredicate& pred, const ZoneMapPB& zone_map);
+
+} // namespace cfile
+} // namespace kudu
+
+#endif
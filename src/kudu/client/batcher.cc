@@ -25,9 +25,11 @@
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/client/callbacks.h"
@@ -38,6 +40,7 @@
 #include "kudu/client/schema.h"
 #include "kudu/client/session-internal.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_flow_control.h"
 #include "kudu/client/write_op-internal.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
@@ -59,10 +62,27 @@
 #include "kudu/rpc/rpc.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/rpc/transfer.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
+
+DEFINE_bool(client_write_rows_in_sidecars, false,
+            "Whether write requests send their encoded rows in RPC sidecars, which "
+            "the tablet servers decode in place rather than from a parsed copy. "
+            "Requires tablet servers which support it: writes to older ones fail.");
+TAG_FLAG(client_write_rows_in_sidecars, experimental);
+
+DEFINE_bool(client_coalesce_writes, true,
+            "Whether the writes of a flush to tablets led by the same tablet server "
+            "are sent to it in a single MultiTabletWrite RPC, rather than in a Write "
+            "RPC per tablet. Retries of the writes are always sent on their own.");
+TAG_FLAG(client_coalesce_writes, advanced);
+TAG_FLAG(client_coalesce_writes, runtime);
 
 using std::pair;
 using std::set;
@@ -70,6 +90,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -94,7 +115,13 @@ using rpc::RetriableRpc;
 using rpc::RetriableRpcStatus;
 using rpc::Rpc;
 using rpc::RpcController;
+using rpc::RpcSidecar;
 using rpc::ServerPicker;
+using rpc::TransferLimits;
+using tserver::MultiTabletWriteRequestPB;
+using tserver::MultiTabletWriteResponsePB;
+using tserver::TabletServerErrorPB;
+using tserver::TabletServerFeatures;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
 using tserver::WriteResponsePB_PerRowErrorPB;
@@ -210,6 +237,8 @@ struct InFlightOp {
   }
 };
 
+class MultiTabletWriteRpc;
+
 // A Write RPC which is in-flight to a tablet. Initially, the RPC is sent
 // to the leader replica, but it may be retried with another replica if the
 // leader fails.
@@ -237,6 +266,23 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   const WriteResponsePB& resp() const { return resp_; }
   const string& tablet_id() const { return tablet_id_; }
 
+  // Whether the first attempt of this RPC may be sent in a MultiTabletWrite RPC.
+  // The sidecars of the writes of a MultiTabletWrite RPC would have to share
+  // the few sidecars of the call, so writes with rows in sidecars are not.
+  bool can_send_in_multi_tablet_write() const { return !rows_in_sidecars_; }
+
+  // Has the first attempt of this RPC sent as part of 'multi_write', if it is
+  // to be sent to the server of 'multi_write'. Must be called before SendRpc().
+  void set_multi_tablet_write(shared_ptr<MultiTabletWriteRpc> multi_write) {
+    multi_write_ = std::move(multi_write);
+  }
+
+  // Has this RPC hold 'slot' of the window of its tablet server until it
+  // completes. Must be called before SendRpc().
+  void set_flow_control_slot(shared_ptr<WriteFlowControl::Slot> slot) {
+    flow_control_slot_ = std::move(slot);
+  }
+
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
   RetriableRpcStatus AnalyzeResponse(const Status& rpc_cb_status) override;
@@ -244,6 +290,11 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   bool GetNewAuthnTokenAndRetry() override;
 
  private:
+  friend class MultiTabletWriteRpc;
+
+  // Sends the current attempt in a Write RPC to 'replica'.
+  void SendWrite(RemoteTabletServer* replica, const ResponseCallback& callback);
+
   // Pointer back to the batcher. Processes the write response when it
   // completes, regardless of success or failure.
   scoped_refptr<Batcher> batcher_;
@@ -254,6 +305,78 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  // If true, the encoded rows are kept in 'rows_data_' and 'indirect_data_'
+  // rather than in the request, and sent in sidecars by every attempt.
+  bool rows_in_sidecars_;
+  string rows_data_;
+  string indirect_data_;
+
+  // If set, the first attempt of this RPC is sent in this MultiTabletWrite
+  // RPC along with the writes to other tablets led by the same server.
+  shared_ptr<MultiTabletWriteRpc> multi_write_;
+
+  // Set once the response to an attempt sent in a MultiTabletWrite RPC is in
+  // 'resp_', along with the status of that attempt. AnalyzeResponse() uses it
+  // rather than the status of the controller, which wasn't used.
+  bool multi_write_done_;
+  Status multi_write_status_;
+
+  // If set, the slot of the tablet server's write window taken by this RPC.
+  shared_ptr<WriteFlowControl::Slot> flow_control_slot_;
+};
+
+// Sends the first attempts of several WriteRpcs, to tablets led by the same
+// tablet server, in a single MultiTabletWrite RPC. Each write gets its own
+// response, as if it was sent in a Write RPC. Retries are sent on their own.
+//
+// The RPC is sent once each of its writes was either added, right before its
+// first attempt would have been sent to the server, or removed, if that attempt
+// went to another server or failed before being sent.
+class MultiTabletWriteRpc : public std::enable_shared_from_this<MultiTabletWriteRpc> {
+ public:
+  MultiTabletWriteRpc(RemoteTabletServer* server, int num_writes, const MonoTime& deadline)
+      : server_(server),
+        deadline_(deadline),
+        num_pending_(num_writes) {
+  }
+
+  RemoteTabletServer* server() const { return server_; }
+
+  // Adds the current attempt of 'rpc', to be completed by 'callback'.
+  void AddWrite(WriteRpc* rpc, const ResponseCallback& callback);
+
+  // Removes one of the writes this RPC was created for.
+  void RemoveWrite();
+
+ private:
+  struct Write {
+    WriteRpc* rpc;
+    ResponseCallback callback;
+  };
+
+  // Marks one of the writes as added or removed, sending the RPC if it was
+  // the last one.
+  void WriteReady(std::unique_lock<simple_spinlock> l);
+
+  // Sends the added writes.
+  void Send();
+
+  // Hands the responses of the writes back to their WriteRpcs.
+  void ProcessResponse();
+
+  RemoteTabletServer* const server_;
+  const MonoTime deadline_;
+
+  simple_spinlock lock_;
+  int num_pending_;
+  vector<Write> writes_;
+
+  MultiTabletWriteRequestPB req_;
+  MultiTabletWriteResponsePB resp_;
+  RpcController controller_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiTabletWriteRpc);
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -267,7 +390,9 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
+      tablet_id_(tablet_id),
+      rows_in_sidecars_(false),
+      multi_write_done_(false) {
   const Schema* schema = table()->schema().schema_;
 
   req_.set_tablet_id(tablet_id_);
@@ -318,6 +443,16 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     VLOG(4) << ++ctr << ". Encoded row " << op->ToString();
   }
 
+  if (FLAGS_client_write_rows_in_sidecars &&
+      requested->rows().size() + requested->indirect_data().size() <=
+      TransferLimits::kMaxTotalSidecarBytes) {
+    rows_in_sidecars_ = true;
+    rows_data_.swap(*requested->mutable_rows());
+    indirect_data_.swap(*requested->mutable_indirect_data());
+    requested->clear_rows();
+    requested->clear_indirect_data();
+  }
+
   if (VLOG_IS_ON(3)) {
     VLOG(3) << "Created batch for " << tablet_id << ":\n" << SecureShortDebugString(req_);
   }
@@ -333,7 +468,33 @@ string WriteRpc::ToString() const {
 }
 
 void WriteRpc::Try(RemoteTabletServer* replica, const ResponseCallback& callback) {
+  if (multi_write_) {
+    // Only the first attempt may be sent along with the writes to other tablets.
+    shared_ptr<MultiTabletWriteRpc> multi_write = std::move(multi_write_);
+    if (multi_write->server() == replica) {
+      VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString()
+              << " along with the writes to other tablets";
+      multi_write->AddWrite(this, callback);
+      return;
+    }
+    multi_write->RemoveWrite();
+  }
+  SendWrite(replica, callback);
+}
+
+void WriteRpc::SendWrite(RemoteTabletServer* replica, const ResponseCallback& callback) {
   VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString();
+  if (rows_in_sidecars_) {
+    // The sidecars of the previous attempt, if any, were handed to its call.
+    RpcController* controller = mutable_retrier()->mutable_controller();
+    RowOperationsPB* row_ops = req_.mutable_row_operations();
+    int idx;
+    CHECK_OK(controller->AddOutboundSidecar(RpcSidecar::FromSlice(Slice(rows_data_)), &idx));
+    row_ops->set_rows_sidecar(idx);
+    CHECK_OK(controller->AddOutboundSidecar(RpcSidecar::FromSlice(Slice(indirect_data_)), &idx));
+    row_ops->set_indirect_data_sidecar(idx);
+    controller->RequireServerFeature(TabletServerFeatures::ROW_OPERATIONS_SIDECARS);
+  }
   replica->proxy()->WriteAsync(req_, &resp_,
                                mutable_retrier()->mutable_controller(),
                                callback);
@@ -355,10 +516,22 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
   RetriableRpcStatus result;
   result.status = rpc_cb_status;
 
+  if (PREDICT_FALSE(multi_write_ && !rpc_cb_status.ok())) {
+    // Looking up the leader failed, so the first attempt won't be sent along
+    // with the writes to other tablets.
+    multi_write_->RemoveWrite();
+    multi_write_.reset();
+  }
+
   // If we didn't fail on tablet lookup/proxy initialization, check if we failed actually performing
   // the write.
   if (rpc_cb_status.ok()) {
-    result.status = mutable_retrier()->controller().status();
+    if (multi_write_done_) {
+      multi_write_done_ = false;
+      result.status = multi_write_status_;
+    } else {
+      result.status = mutable_retrier()->controller().status();
+    }
   }
 
   // Check for specific RPC errors.
@@ -367,6 +540,9 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
     if (err && err->has_code() &&
         (err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY ||
          err->code() == ErrorStatusPB::ERROR_UNAVAILABLE)) {
+      if (flow_control_slot_ && err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY) {
+        flow_control_slot_->MarkServerBusy();
+      }
       result.result = RetriableRpcStatus::SERVICE_UNAVAILABLE;
       return result;
     }
@@ -453,15 +629,117 @@ bool WriteRpc::GetNewAuthnTokenAndRetry() {
   return true;
 }
 
+void MultiTabletWriteRpc::AddWrite(WriteRpc* rpc, const ResponseCallback& callback) {
+  std::unique_lock<simple_spinlock> l(lock_);
+  writes_.push_back({ rpc, callback });
+  WriteReady(std::move(l));
+}
+
+void MultiTabletWriteRpc::RemoveWrite() {
+  WriteReady(std::unique_lock<simple_spinlock>(lock_));
+}
+
+void MultiTabletWriteRpc::WriteReady(std::unique_lock<simple_spinlock> l) {
+  DCHECK_GT(num_pending_, 0);
+  if (--num_pending_ > 0) {
+    return;
+  }
+  l.unlock();
+  Send();
+}
+
+void MultiTabletWriteRpc::Send() {
+  if (writes_.empty()) {
+    return;
+  }
+  if (writes_.size() == 1) {
+    // The other writes went elsewhere: no need to wrap this one.
+    writes_[0].rpc->SendWrite(server_, writes_[0].callback);
+    return;
+  }
+  VLOG(2) << "Writing " << writes_.size() << " batches to " << server_->ToString()
+          << " in a single RPC";
+  req_.mutable_writes()->Reserve(writes_.size());
+  for (const auto& write : writes_) {
+    auto* tablet_write = req_.add_writes();
+    // The request is handed back to the WriteRpc along with the response.
+    tablet_write->mutable_request()->Swap(&write.rpc->req_);
+    *tablet_write->mutable_request_id() = write.rpc->retrier().controller().request_id();
+  }
+  controller_.set_deadline(deadline_);
+  shared_ptr<MultiTabletWriteRpc> s_this = shared_from_this();
+  server_->proxy()->MultiTabletWriteAsync(req_, &resp_, &controller_,
+                                          [s_this]() { s_this->ProcessResponse(); });
+}
+
+void MultiTabletWriteRpc::ProcessResponse() {
+  const int num_writes = writes_.size();
+  Status s = controller_.status();
+  bool server_busy = false;
+  if (PREDICT_FALSE(!s.ok())) {
+    const ErrorStatusPB* err = controller_.error_response();
+    server_busy = err && err->has_code() && err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY;
+    if (err && err->has_code() && err->code() == ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      if (server_->supports_multi_tablet_write()) {
+        LOG(INFO) << server_->ToString() << " doesn't support multi-tablet writes, "
+                  << "sending writes to it one tablet at a time";
+      }
+      server_->set_multi_tablet_write_unsupported();
+    }
+    if (controller_.negotiation_failed() && !s.IsTimedOut()) {
+      s = Status::NetworkError(s.ToString());
+    } else if (!s.IsNetworkError() && !s.IsTimedOut()) {
+      // Have each write retried in a Write RPC of its own, which handles the
+      // error the way it should be for that write.
+      s = Status::ServiceUnavailable("MultiTabletWrite RPC failed", s.ToString());
+    }
+  } else if (PREDICT_FALSE(resp_.responses_size() != num_writes)) {
+    s = Status::ServiceUnavailable(Substitute(
+        "expected $0 responses to MultiTabletWrite RPC, got $1",
+        num_writes, resp_.responses_size()));
+  }
+
+  for (int i = 0; i < num_writes; i++) {
+    // The callback may destroy the WriteRpc.
+    WriteRpc* rpc = writes_[i].rpc;
+    rpc->req_.Swap(req_.mutable_writes(i)->mutable_request());
+    Status write_status = s;
+    bool write_server_busy = server_busy;
+    if (s.ok()) {
+      rpc->resp_.Swap(resp_.mutable_responses(i));
+      // Errors which fail a Write RPC with ERROR_SERVER_TOO_BUSY, so that it's
+      // retried, come in the response of each write instead.
+      if (rpc->resp_.has_error() &&
+          (rpc->resp_.error().code() == TabletServerErrorPB::UNKNOWN_ERROR ||
+           rpc->resp_.error().code() == TabletServerErrorPB::THROTTLED)) {
+        Status error = StatusFromPB(rpc->resp_.error().status());
+        if (error.IsServiceUnavailable()) {
+          write_status = error;
+          write_server_busy = true;
+          rpc->resp_.Clear();
+        }
+      }
+    }
+    if (write_server_busy && rpc->flow_control_slot_) {
+      rpc->flow_control_slot_->MarkServerBusy();
+    }
+    rpc->multi_write_done_ = true;
+    rpc->multi_write_status_ = write_status;
+    writes_[i].callback();
+  }
+}
+
 Batcher::Batcher(KuduClient* client,
                  scoped_refptr<ErrorCollector> error_collector,
                  sp::weak_ptr<KuduSession> session,
-                 kudu::client::KuduSession::ExternalConsistencyMode consistency_mode)
+                 kudu::client::KuduSession::ExternalConsistencyMode consistency_mode,
+                 scoped_refptr<WriteFlowControl> flow_control)
   : state_(kGatheringOps),
     client_(client),
     weak_session_(std::move(session)),
     consistency_mode_(consistency_mode),
     error_collector_(std::move(error_collector)),
+    flow_control_(std::move(flow_control)),
     had_errors_(false),
     flush_callback_(nullptr),
     next_op_sequence_number_(0),
@@ -610,10 +888,94 @@ Status Batcher::Add(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
-void Batcher::AddInFlightOp(InFlightOp* op) {
-  DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
+Status Batcher::Add(const vector<KuduWriteOperation*>& write_ops) {
+  // Encode all the partition keys up front, so that nothing is added
+  // to the batcher if any of the operations is malformed.
+  vector<string> partition_keys(write_ops.size());
+  for (size_t i = 0; i < write_ops.size(); ++i) {
+    const KuduWriteOperation* write_op = write_ops[i];
+    RETURN_NOT_OK(write_op->table_->partition_schema().EncodeKey(
+        write_op->row(), &partition_keys[i]));
+  }
+
+  vector<InFlightOp*> ops;
+  ops.reserve(write_ops.size());
+  int64_t buffer_bytes = 0;
+  for (KuduWriteOperation* write_op : write_ops) {
+    InFlightOp* op = new InFlightOp();
+    op->write_op.reset(write_op);
+    op->state = InFlightOp::kLookingUpTablet;
+    buffer_bytes += write_op->SizeInBuffer();
+    ops.push_back(op);
+  }
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (InFlightOp* op : ops) {
+      AddInFlightOpUnlocked(op);
+    }
+  }
+
+  // Resolve the tablet of each op. Runs of ops falling into the range of the
+  // same tablet reuse its cache entry, and ops whose tablet is cached skip
+  // the asynchronous lookup and its callback altogether.
+  MonoTime deadline = ComputeDeadlineUnlocked();
+  const KuduTable* cached_table = nullptr;
+  scoped_refptr<RemoteTablet> cached_tablet;
+  vector<InFlightOp*> resolved_ops;
+  resolved_ops.reserve(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    InFlightOp* op = ops[i];
+    const KuduTable* table = op->write_op->table();
+    const string& partition_key = partition_keys[i];
+    bool cached = cached_tablet && cached_table == table &&
+        partition_key >= cached_tablet->partition().partition_key_start() &&
+        (cached_tablet->partition().partition_key_end().empty() ||
+         partition_key < cached_tablet->partition().partition_key_end());
+    if (!cached) {
+      cached_table = table;
+      cached_tablet.reset();
+      cached = client_->data_->meta_cache_->LookupCachedTabletByKey(
+          table, partition_key, &cached_tablet);
+    }
+    if (cached) {
+      op->tablet = cached_tablet;
+      resolved_ops.push_back(op);
+      continue;
+    }
+    VLOG(3) << "Looking up tablet for " << op->ToString();
+    base::RefCountInc(&outstanding_lookups_);
+    client_->data_->meta_cache_->LookupTabletByKey(
+        table,
+        std::move(partition_keys[i]),
+        deadline,
+        &op->tablet,
+        Bind(&Batcher::TabletLookupFinished, this, op));
+  }
+
+  if (!resolved_ops.empty()) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (InFlightOp* op : resolved_ops) {
+      if (IsAbortedUnlocked()) {
+        MarkInFlightOpFailedUnlocked(op, Status::Aborted("Batch aborted"));
+      } else {
+        BufferToTabletUnlocked(op);
+      }
+    }
+  }
 
+  buffer_bytes_used_.IncrementBy(buffer_bytes);
+
+  return Status::OK();
+}
+
+void Batcher::AddInFlightOp(InFlightOp* op) {
   std::lock_guard<simple_spinlock> l(lock_);
+  AddInFlightOpUnlocked(op);
+}
+
+void Batcher::AddInFlightOpUnlocked(InFlightOp* op) {
+  DCHECK(lock_.is_locked());
+  DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
   CHECK_EQ(state_, kGatheringOps);
   InsertOrDie(&ops_, op);
   op->sequence_number_ = next_op_sequence_number_++;
@@ -681,38 +1043,41 @@ void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
     return;
   }
 
-  {
-    std::lock_guard<simple_spinlock> l2(op->lock_);
-    CHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
-    CHECK(op->tablet != NULL);
+  BufferToTabletUnlocked(op);
 
-    op->state = InFlightOp::kBufferedToTabletServer;
+  l.unlock();
 
-    vector<InFlightOp*>& to_ts = per_tablet_ops_[op->tablet.get()];
-    to_ts.push_back(op);
+  FlushBuffersIfReady();
+}
 
-    // "Reverse bubble sort" the operation into the right spot in the tablet server's
-    // buffer, based on the sequence numbers of the ops.
-    //
-    // There is a rare race (KUDU-743) where two operations in the same batch can get
-    // their order inverted with respect to the order that the user originally performed
-    // the operations. This loop re-sequences them back into the correct order. In
-    // the common case, it will break on the first iteration, so we expect the loop to be
-    // constant time, with worst case O(n). This is usually much better than something
-    // like a priority queue which would have O(lg n) in every case and a more complex
-    // code path.
-    for (int i = to_ts.size() - 1; i > 0; --i) {
-      if (to_ts[i]->sequence_number_ < to_ts[i - 1]->sequence_number_) {
-        std::swap(to_ts[i], to_ts[i - 1]);
-      } else {
-        break;
-      }
-    }
-  }
+void Batcher::BufferToTabletUnlocked(InFlightOp* op) {
+  DCHECK(lock_.is_locked());
+  std::lock_guard<simple_spinlock> l2(op->lock_);
+  CHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
+  CHECK(op->tablet != NULL);
 
-  l.unlock();
+  op->state = InFlightOp::kBufferedToTabletServer;
 
-  FlushBuffersIfReady();
+  vector<InFlightOp*>& to_ts = per_tablet_ops_[op->tablet.get()];
+  to_ts.push_back(op);
+
+  // "Reverse bubble sort" the operation into the right spot in the tablet server's
+  // buffer, based on the sequence numbers of the ops.
+  //
+  // There is a rare race (KUDU-743) where two operations in the same batch can get
+  // their order inverted with respect to the order that the user originally performed
+  // the operations. This loop re-sequences them back into the correct order. In
+  // the common case, it will break on the first iteration, so we expect the loop to be
+  // constant time, with worst case O(n). This is usually much better than something
+  // like a priority queue which would have O(lg n) in every case and a more complex
+  // code path.
+  for (int i = to_ts.size() - 1; i > 0; --i) {
+    if (to_ts[i]->sequence_number_ < to_ts[i - 1]->sequence_number_) {
+      std::swap(to_ts[i], to_ts[i - 1]);
+    } else {
+      break;
+    }
+  }
 }
 
 void Batcher::FlushBuffersIfReady() {
@@ -738,22 +1103,90 @@ void Batcher::FlushBuffersIfReady() {
     ops_copy.swap(per_tablet_ops_);
   }
 
-  // Now flush the ops for each tablet.
+  // Now flush the ops for each tablet. The writes to tablets whose leaders
+  // are known to be on the same server are sent to it together.
+  vector<WriteRpc*> rpcs;
+  vector<RemoteTabletServer*> leaders;
+  rpcs.reserve(ops_copy.size());
+  leaders.reserve(ops_copy.size());
+  unordered_map<RemoteTabletServer*, vector<WriteRpc*>> rpcs_by_leader;
+  const bool coalesce_writes = FLAGS_client_coalesce_writes;
   for (const OpsMap::value_type& e : ops_copy) {
     RemoteTablet* tablet = e.first;
     const vector<InFlightOp*>& ops = e.second;
 
     VLOG(3) << "FlushBuffersIfReady: already in flushing state, immediately flushing to "
             << tablet->tablet_id();
-    FlushBuffer(tablet, ops);
+    WriteRpc* rpc = CreateWriteRpc(tablet, ops);
+    RemoteTabletServer* leader = tablet->LeaderTServer();
+    rpcs.push_back(rpc);
+    leaders.push_back(leader);
+    if (coalesce_writes && rpc->can_send_in_multi_tablet_write()) {
+      if (leader && leader->supports_multi_tablet_write()) {
+        rpcs_by_leader[leader].push_back(rpc);
+      }
+    }
+  }
+  unordered_set<WriteRpc*> coalesced_rpcs;
+  for (const auto& e : rpcs_by_leader) {
+    const vector<WriteRpc*>& leader_rpcs = e.second;
+    if (leader_rpcs.size() < 2) {
+      continue;
+    }
+    auto multi_write = std::make_shared<MultiTabletWriteRpc>(e.first, leader_rpcs.size(),
+                                                             deadline_);
+    for (WriteRpc* rpc : leader_rpcs) {
+      rpc->set_multi_tablet_write(multi_write);
+      coalesced_rpcs.insert(rpc);
+    }
+  }
+  if (!flow_control_) {
+    for (WriteRpc* rpc : rpcs) {
+      rpc->SendRpc();
+    }
+    return;
+  }
+
+  // Send the RPCs through the write windows of their leaders. The RPCs
+  // coalesced into a MultiTabletWrite RPC are sent as a single unit, since
+  // the MultiTabletWrite RPC waits for all of them.
+  for (size_t i = 0; i < rpcs.size(); i++) {
+    WriteRpc* rpc = rpcs[i];
+    if (!leaders[i]) {
+      rpc->SendRpc();
+      continue;
+    }
+    if (ContainsKey(coalesced_rpcs, rpc)) {
+      continue;
+    }
+    flow_control_->Send(leaders[i]->permanent_uuid(),
+                        [rpc](const shared_ptr<WriteFlowControl::Slot>& slot) {
+                          rpc->set_flow_control_slot(slot);
+                          rpc->SendRpc();
+                        });
+  }
+  for (const auto& e : rpcs_by_leader) {
+    const vector<WriteRpc*>& leader_rpcs = e.second;
+    if (leader_rpcs.size() < 2) {
+      continue;
+    }
+    flow_control_->Send(e.first->permanent_uuid(),
+                        [leader_rpcs](const shared_ptr<WriteFlowControl::Slot>& slot) {
+                          for (WriteRpc* rpc : leader_rpcs) {
+                            rpc->set_flow_control_slot(slot);
+                          }
+                          for (WriteRpc* rpc : leader_rpcs) {
+                            rpc->SendRpc();
+                          }
+                        });
   }
 }
 
-void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
+WriteRpc* Batcher::CreateWriteRpc(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
   CHECK(!ops.empty());
 
-  // Create and send an RPC that aggregates the ops. The RPC is freed when
-  // its callback completes.
+  // Create an RPC that aggregates the ops. The RPC is freed when its callback
+  // completes.
   //
   // The RPC object takes ownership of the ops.
 
@@ -764,15 +1197,14 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
                                 client_->data_->meta_cache_,
                                 ops[0]->write_op->table(),
                                 tablet));
-  WriteRpc* rpc = new WriteRpc(this,
-                               server_picker,
-                               client_->data_->request_tracker_,
-                               ops,
-                               deadline_,
-                               client_->data_->messenger_,
-                               tablet->tablet_id(),
-                               client_->data_->GetLatestObservedTimestamp());
-  rpc->SendRpc();
+  return new WriteRpc(this,
+                      server_picker,
+                      client_->data_->request_tracker_,
+                      ops,
+                      deadline_,
+                      client_->data_->messenger_,
+                      tablet->tablet_id(),
+                      client_->data_->GetLatestObservedTimestamp());
 }
 
 void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
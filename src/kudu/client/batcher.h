@@ -46,6 +46,7 @@ struct InFlightOp;
 
 class ErrorCollector;
 class RemoteTablet;
+class WriteFlowControl;
 class WriteRpc;
 
 // A Batcher is the class responsible for collecting row operations, routing them to the
@@ -69,7 +70,8 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   Batcher(KuduClient* client,
           scoped_refptr<ErrorCollector> error_collector,
           client::sp::weak_ptr<KuduSession> session,
-          kudu::client::KuduSession::ExternalConsistencyMode consistency_mode);
+          kudu::client::KuduSession::ExternalConsistencyMode consistency_mode,
+          scoped_refptr<WriteFlowControl> flow_control = nullptr);
 
   // Abort the current batch. Any writes that were buffered and not yet sent are
   // discarded. Those that were sent may still be delivered.  If there is a pending Flush
@@ -88,6 +90,15 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // NOTE: If this returns not-OK, does not take ownership of 'write_op'.
   Status Add(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  // Add a sequence of operations to the batch, in order. Compared with adding
+  // them one by one, the batcher lock is taken once for the whole sequence and
+  // the tablet lookup is shared by consecutive operations which fall into the
+  // same cached tablet.
+  //
+  // NOTE: If this returns not-OK, none of the operations have been added and
+  // the ownership of 'write_ops' is not taken.
+  Status Add(const std::vector<KuduWriteOperation*>& write_ops) WARN_UNUSED_RESULT;
+
   // Return true if any operations are still pending. An operation is no longer considered
   // pending once it has either errored or succeeded.  Operations are considering pending
   // as soon as they are added, even if Flush has not been called.
@@ -137,6 +148,11 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
   // Add an op to the in-flight set and increment the ref-count.
   void AddInFlightOp(InFlightOp* op);
+  void AddInFlightOpUnlocked(InFlightOp* op);
+
+  // Move an op whose tablet is known into the buffer of that tablet, keeping
+  // the buffer ordered by sequence number. Must be called with lock_ held.
+  void BufferToTabletUnlocked(InFlightOp* op);
 
   void RemoveInFlightOp(InFlightOp* op);
 
@@ -156,7 +172,7 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
   void CheckForFinishedFlush();
   void FlushBuffersIfReady();
-  void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
+  WriteRpc* CreateWriteRpc(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
 
   // Cleans up an RPC response, scooping out any errors and passing them up
   // to the batcher.
@@ -189,6 +205,9 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // Errors are reported into this error collector.
   scoped_refptr<ErrorCollector> error_collector_;
 
+  // If set, limits the write RPCs in flight to each tablet server.
+  scoped_refptr<WriteFlowControl> flow_control_;
+
   // The time when the very first operation was added into the batcher.
   MonoTime first_op_time_;
 
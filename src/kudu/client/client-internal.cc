@@ -34,6 +34,7 @@
 
 #include "kudu/client/master_rpc.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/scanner-internal.h"
 #include "kudu/client/schema.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/schema.h"
@@ -60,6 +61,7 @@
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/thread_restrictions.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/rpc/connection.h"
 
 using std::pair;
@@ -342,7 +344,10 @@ Status KuduClient::Data::SyncLeaderMasterRpc(
     vector<uint32_t> required_feature_flags);
 
 KuduClient::Data::Data()
-    : latest_observed_timestamp_(KuduClient::kNoTimestamp) {
+    : scanner_keep_alive_batcher_(new internal::ScannerKeepAliveBatcher()),
+      next_lookup_master_idx_(0),
+      latest_observed_timestamp_(KuduClient::kNoTimestamp),
+      latest_observed_catalog_version_(0) {
 }
 
 KuduClient::Data::~Data() {
@@ -353,6 +358,7 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  async_scan_pool_.reset();
   dns_resolver_.reset();
 }
 
@@ -374,7 +380,8 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
       break;
     }
     case CLOSEST_REPLICA:
-    case FIRST_REPLICA: {
+    case FIRST_REPLICA:
+    case LOWEST_LATENCY: {
       rt->GetRemoteTabletServers(candidates);
       // Filter out all the blacklisted candidates.
       vector<RemoteTabletServer*> filtered;
@@ -401,6 +408,30 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
         if (ret == nullptr && !filtered.empty()) {
           ret = filtered[rand() % filtered.size()];
         }
+      } else if (selection == LOWEST_LATENCY) {
+        // Choose the replica with the lowest estimated latency, preferring
+        // a local one, then a random one, among those equally fast.
+        vector<RemoteTabletServer*> fastest;
+        double min_latency_us = 0;
+        for (RemoteTabletServer* rts : filtered) {
+          const double latency_us = rts->EstimatedScanLatencyUs();
+          if (fastest.empty() || latency_us < min_latency_us) {
+            fastest.clear();
+            min_latency_us = latency_us;
+          }
+          if (latency_us == min_latency_us) {
+            fastest.push_back(rts);
+          }
+        }
+        for (RemoteTabletServer* rts : fastest) {
+          if (IsTabletServerLocal(*rts)) {
+            ret = rts;
+            break;
+          }
+        }
+        if (ret == nullptr && !fastest.empty()) {
+          ret = fastest[rand() % fastest.size()];
+        }
       }
       break;
     }
@@ -477,6 +508,11 @@ Status KuduClient::Data::IsCreateTableInProgress(
           &MasterServiceProxy::IsCreateTableDone,
           {})));
   *create_in_progress = !resp.done();
+  if (*create_in_progress && resp.has_num_tablets()) {
+    VLOG(1) << Substitute("Table $0: $1 of $2 tablets created",
+                          SecureShortDebugString(req.table()),
+                          resp.num_running_tablets(), resp.num_tablets());
+  }
   return Status::OK();
 }
 
@@ -690,6 +726,18 @@ void KuduClient::Data::ConnectedToClusterCb(
       leader_master_hostport_ = HostPort(leader_hostname, leader_addr.port());
       master_proxy_.reset(new MasterServiceProxy(messenger_, leader_addr, leader_hostname));
       master_proxy_->set_user_credentials(user_credentials_);
+
+      lookup_master_proxies_.clear();
+      for (const auto& addr_and_name : master_addrs_with_names_) {
+        if (addr_and_name.first == leader_addr) {
+          lookup_master_proxies_.push_back(master_proxy_);
+          continue;
+        }
+        shared_ptr<MasterServiceProxy> proxy(new MasterServiceProxy(
+            messenger_, addr_and_name.first, addr_and_name.second));
+        proxy->set_user_credentials(user_credentials_);
+        lookup_master_proxies_.emplace_back(std::move(proxy));
+      }
     }
   }
 
@@ -744,6 +792,7 @@ void KuduClient::Data::ConnectToClusterAsync(KuduClient* client,
   // same result. Instead, simply piggy-back onto the existing request by adding
   // our the callback to leader_master_callbacks_{any_creds,primary_creds}_.
   std::unique_lock<simple_spinlock> l(leader_master_lock_);
+  master_addrs_with_names_ = master_addrs_with_names;
 
   // Optimize sending out a new request in the presence of already existing
   // requests to the leader master. Depending on the credentials policy for the
@@ -813,6 +862,15 @@ shared_ptr<master::MasterServiceProxy> KuduClient::Data::master_proxy() const {
   return master_proxy_;
 }
 
+shared_ptr<master::MasterServiceProxy> KuduClient::Data::lookup_master_proxy() const {
+  std::lock_guard<simple_spinlock> l(leader_master_lock_);
+  if (lookup_master_proxies_.empty()) {
+    return master_proxy_;
+  }
+  const uint32_t idx = next_lookup_master_idx_.Increment() - 1;
+  return lookup_master_proxies_[idx % lookup_master_proxies_.size()];
+}
+
 uint64_t KuduClient::Data::GetLatestObservedTimestamp() const {
   return latest_observed_timestamp_.Load();
 }
@@ -821,5 +879,13 @@ void KuduClient::Data::UpdateLatestObservedTimestamp(uint64_t timestamp) {
   latest_observed_timestamp_.StoreMax(timestamp);
 }
 
+int64_t KuduClient::Data::GetLatestObservedCatalogVersion() const {
+  return latest_observed_catalog_version_.Load();
+}
+
+void KuduClient::Data::UpdateLatestObservedCatalogVersion(int64_t catalog_version) {
+  latest_observed_catalog_version_.StoreMax(catalog_version);
+}
+
 } // namespace client
 } // namespace kudu
@@ -38,6 +38,7 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
+#include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 
@@ -50,7 +51,7 @@ namespace kudu {
 
 class DnsResolver;
 class PartitionSchema;
-class Sockaddr;
+class ThreadPool;
 
 namespace master {
 class AlterTableRequestPB;
@@ -76,6 +77,7 @@ class ConnectToClusterRpc;
 class MetaCache;
 class RemoteTablet;
 class RemoteTabletServer;
+class ScannerKeepAliveBatcher;
 } // namespace internal
 
 class KuduClient::Data {
@@ -189,12 +191,24 @@ class KuduClient::Data {
 
   std::shared_ptr<master::MasterServiceProxy> master_proxy() const;
 
+  // Returns a proxy to one of the masters, leader or follower, to spread
+  // tablet location lookups across them. The masters are taken in turn.
+  // Returns the leader master proxy if the masters are not known yet.
+  std::shared_ptr<master::MasterServiceProxy> lookup_master_proxy() const;
+
   HostPort leader_master_hostport() const;
 
   uint64_t GetLatestObservedTimestamp() const;
 
   void UpdateLatestObservedTimestamp(uint64_t timestamp);
 
+  // The highest catalog version of the tablet locations served to this
+  // client by the masters. A follower master whose copy of the catalog is
+  // older doesn't serve this client's lookups.
+  int64_t GetLatestObservedCatalogVersion() const;
+
+  void UpdateLatestObservedCatalogVersion(int64_t catalog_version);
+
   // Retry 'func' until either:
   //
   // 1) Methods succeeds on a leader master.
@@ -238,8 +252,15 @@ class KuduClient::Data {
 
   std::shared_ptr<rpc::Messenger> messenger_;
   gscoped_ptr<DnsResolver> dns_resolver_;
+
+  // Runs the work of KuduScanner::NextBatchAsync() which follows the arrival
+  // of a response, and the work which may block, such as opening a tablet.
+  gscoped_ptr<ThreadPool> async_scan_pool_;
   scoped_refptr<internal::MetaCache> meta_cache_;
 
+  // Coalesces the keepalives of this client's scanners.
+  gscoped_ptr<internal::ScannerKeepAliveBatcher> scanner_keep_alive_batcher_;
+
   // Set of hostnames and IPs on the local host.
   // This is initialized at client startup.
   std::unordered_set<std::string> local_host_names_;
@@ -257,6 +278,14 @@ class KuduClient::Data {
   // Proxy to the leader master.
   std::shared_ptr<master::MasterServiceProxy> master_proxy_;
 
+  // The resolved addresses of the masters, and proxies to all of them for
+  // tablet location lookups. Set along with 'master_proxy_'.
+  std::vector<std::pair<Sockaddr, std::string>> master_addrs_with_names_;
+  std::vector<std::shared_ptr<master::MasterServiceProxy>> lookup_master_proxies_;
+
+  // The master to send the next lookup to: see lookup_master_proxy().
+  mutable AtomicInt<uint32_t> next_lookup_master_idx_;
+
   // Ref-counted RPC instance: since 'ConnectToClusterAsync' call
   // is asynchronous, we need to hold a reference in this class
   // itself, as to avoid a "use-after-free" scenario.
@@ -266,7 +295,8 @@ class KuduClient::Data {
   std::vector<StatusCallback> leader_master_callbacks_primary_creds_;
 
   // Protects 'leader_master_rpc_{any,primary}_creds_',
-  // 'leader_master_hostport_', and 'master_proxy_'.
+  // 'leader_master_hostport_', 'master_proxy_', 'master_addrs_with_names_',
+  // and 'lookup_master_proxies_'.
   //
   // See: KuduClient::Data::ConnectToClusterAsync for a more
   // in-depth explanation of why this is needed and how it works.
@@ -274,6 +304,8 @@ class KuduClient::Data {
 
   AtomicInt<uint64_t> latest_observed_timestamp_;
 
+  AtomicInt<int64_t> latest_observed_catalog_version_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
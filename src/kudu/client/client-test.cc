@@ -95,6 +95,7 @@
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"  // IWYU pragma: keep
 #include "kudu/util/metrics.h"
@@ -110,10 +111,12 @@
 #include "kudu/util/thread_restrictions.h"
 
 DECLARE_bool(allow_unsafe_replication_factor);
+DECLARE_bool(client_write_rows_in_sidecars);
 DECLARE_bool(fail_dns_resolution);
 DECLARE_bool(log_inject_latency);
 DECLARE_bool(master_support_connect_to_master_rpc);
 DECLARE_bool(rpc_trace_negotiation);
+DECLARE_int32(client_scan_latency_half_life_ms);
 DECLARE_int32(heartbeat_interval_ms);
 DECLARE_int32(leader_failure_exp_backoff_max_delta_ms);
 DECLARE_int32(log_inject_latency_ms_mean);
@@ -129,6 +132,10 @@ DECLARE_int32(table_locations_ttl_ms);
 DECLARE_string(superuser_acl);
 DECLARE_string(user_acl);
 DEFINE_int32(test_scan_num_rows, 1000, "Number of rows to insert and scan");
+DEFINE_int32(meta_cache_lookup_perf_threads, 8,
+             "Maximum number of threads looking up tablets in TestMetaCacheLookupPerf");
+DEFINE_int32(meta_cache_lookups_per_thread, 100000,
+             "Number of lookups per thread in TestMetaCacheLookupPerf");
 
 METRIC_DECLARE_counter(rpcs_queue_overflow);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetMasterRegistration);
@@ -409,6 +416,10 @@ class ClientTest : public KuduTest {
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_miss_bytes"));
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_hit_bytes"));
       ASSERT_GT(metrics["cfile_cache_miss_bytes"] + metrics["cfile_cache_hit_bytes"], 0);
+      // The iterator stats of the scan are reported as well.
+      ASSERT_GT(metrics["cells_read"], 0);
+      ASSERT_GT(metrics["bytes_read"], 0);
+      ASSERT_GT(metrics["blocks_read"], 0);
     }
   }
 
@@ -1021,6 +1032,34 @@ TEST_F(ClientTest, TestScanEmptyTable) {
   ASSERT_FALSE(scanner.HasMoreRows());
 }
 
+TEST_F(ClientTest, TestGet) {
+  NO_FATALS(InsertTestRows(client_table_.get(), 20));
+
+  unique_ptr<KuduPartialRow> key(client_table_->schema().NewRow());
+  KuduScanBatch batch;
+  for (int32_t k : { 5, 15 }) {
+    ASSERT_OK(key->SetInt32("key", k));
+    ASSERT_OK(client_table_->Get(*key, { "int_val", "key" }, &batch));
+    ASSERT_EQ(1, batch.NumRows());
+    int32_t val;
+    ASSERT_OK(batch.Row(0).GetInt32(0, &val));
+    ASSERT_EQ(k * 2, val);
+    ASSERT_OK(batch.Row(0).GetInt32(1, &val));
+    ASSERT_EQ(k, val);
+  }
+
+  // A missing row yields an empty batch.
+  ASSERT_OK(key->SetInt32("key", 1000));
+  ASSERT_OK(client_table_->Get(*key, { "key" }, &batch));
+  ASSERT_EQ(0, batch.NumRows());
+
+  Status s = client_table_->Get(*key, { "missing" }, &batch);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+  unique_ptr<KuduPartialRow> unset_key(client_table_->schema().NewRow());
+  s = client_table_->Get(*unset_key, { "key" }, &batch);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 // Test scanning with an empty projection. This should yield an empty
 // row block with the proper number of rows filled in. Impala issues
 // scans like this in order to implement COUNT(*).
@@ -1044,6 +1083,157 @@ TEST_F(ClientTest, TestScanEmptyProjection) {
   }
 }
 
+// Test scanning with the COLUMNAR_LAYOUT row format flag.
+TEST_F(ClientTest, TestScanColumnarLayout) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val", "string_val" }));
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT));
+  ASSERT_TRUE(scanner.SetRowFormatFlags(
+      KuduScanner::COLUMNAR_LAYOUT |
+      KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES).IsInvalidArgument());
+  ASSERT_OK(scanner.Open());
+
+  KuduScanBatch batch;
+  uint64_t count = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    if (batch.NumRows() == 0) {
+      continue;
+    }
+    Slice keys, int_vals, offsets, strings, non_nulls;
+    ASSERT_OK(batch.GetFixedLengthColumn(0, &keys));
+    ASSERT_OK(batch.GetFixedLengthColumn(1, &int_vals));
+    ASSERT_OK(batch.GetVariableLengthColumn(2, &offsets, &strings));
+    ASSERT_OK(batch.GetNonNullBitmapForColumn(2, &non_nulls));
+    ASSERT_TRUE(batch.GetFixedLengthColumn(2, &keys).IsInvalidArgument());
+    ASSERT_EQ(batch.NumRows() * sizeof(int32_t), keys.size());
+    ASSERT_EQ((batch.NumRows() + 1) * sizeof(uint32_t), offsets.size());
+
+    const int32_t* key_cells = reinterpret_cast<const int32_t*>(keys.data());
+    const int32_t* int_cells = reinterpret_cast<const int32_t*>(int_vals.data());
+    const uint32_t* string_offsets = reinterpret_cast<const uint32_t*>(offsets.data());
+    for (int i = 0; i < batch.NumRows(); i++) {
+      ASSERT_EQ(key_cells[i] * 2, int_cells[i]);
+      ASSERT_TRUE(BitmapTest(non_nulls.data(), i));
+      Slice s(strings.data() + string_offsets[i], string_offsets[i + 1] - string_offsets[i]);
+      ASSERT_EQ(StringPrintf("hello %d", key_cells[i]), s.ToString());
+    }
+    count += batch.NumRows();
+  }
+  ASSERT_EQ(FLAGS_test_scan_num_rows, count);
+}
+
+// Test copying whole columns of scan batches, in both the row-wise and the
+// columnar layout.
+TEST_F(ClientTest, TestScanCopyColumns) {
+  const int kNumRows = 1000;
+  {
+    // Every third row has a NULL string.
+    shared_ptr<KuduSession> session = client_->NewSession();
+    ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+    for (int i = 0; i < kNumRows; i++) {
+      unique_ptr<KuduInsert> insert(BuildTestRow(client_table_.get(), i));
+      if (i % 3 == 0) {
+        ASSERT_OK(insert->mutable_row()->SetNull("string_val"));
+      }
+      ASSERT_OK(session->Apply(insert.release()));
+    }
+    FlushSessionOrDie(session);
+  }
+
+  for (uint64_t flags : { KuduScanner::NO_FLAGS, KuduScanner::COLUMNAR_LAYOUT }) {
+    SCOPED_TRACE(flags);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val", "string_val" }));
+    ASSERT_OK(scanner.SetRowFormatFlags(flags));
+    ASSERT_OK(scanner.SetBatchSizeBytes(8 * 1024));
+    ASSERT_OK(scanner.Open());
+
+    KuduScanBatch batch;
+    int count = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      const int n = batch.NumRows();
+      vector<int32_t> keys(n);
+      vector<int32_t> int_vals(n);
+      vector<uint32_t> offsets(n + 1);
+      vector<uint8_t> key_non_nulls(BitmapSize(n) + 1);
+      vector<uint8_t> string_non_nulls(BitmapSize(n) + 1);
+      string strings;
+      ASSERT_OK(batch.CopyFixedLengthColumn(0, keys.data(), n * sizeof(int32_t),
+                                            key_non_nulls.data()));
+      ASSERT_OK(batch.CopyFixedLengthColumn(1, int_vals.data(), n * sizeof(int32_t), nullptr));
+      ASSERT_OK(batch.CopyVariableLengthColumn(2, offsets.data(), offsets.size() * sizeof(uint32_t),
+                                               &strings, string_non_nulls.data()));
+      ASSERT_TRUE(batch.CopyFixedLengthColumn(2, keys.data(), n * sizeof(int32_t),
+                                              nullptr).IsInvalidArgument());
+      if (n > 0) {
+        ASSERT_TRUE(batch.CopyFixedLengthColumn(0, keys.data(), n * sizeof(int32_t) - 1,
+                                                nullptr).IsInvalidArgument());
+      }
+      for (int i = 0; i < n; i++) {
+        ASSERT_EQ(keys[i] * 2, int_vals[i]);
+        ASSERT_TRUE(BitmapTest(key_non_nulls.data(), i));
+        Slice s(strings.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        if (keys[i] % 3 == 0) {
+          ASSERT_FALSE(BitmapTest(string_non_nulls.data(), i));
+          ASSERT_EQ(0, s.size());
+        } else {
+          ASSERT_TRUE(BitmapTest(string_non_nulls.data(), i));
+          ASSERT_EQ(StringPrintf("hello %d", keys[i]), s.ToString());
+        }
+      }
+      count += n;
+    }
+    ASSERT_EQ(kNumRows, count);
+  }
+}
+
+// Drive several scans concurrently from a single thread with NextBatchAsync().
+TEST_F(ClientTest, TestScanNextBatchAsync) {
+  const int kNumRows = 1000;
+  const int kNumScanners = 4;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+
+  vector<unique_ptr<KuduScanner>> scanners;
+  for (int i = 0; i < kNumScanners; i++) {
+    scanners.emplace_back(new KuduScanner(client_table_.get()));
+    ASSERT_OK(scanners.back()->SetBatchSizeBytes(1024));
+    // Every other scanner has a prefetch in flight already.
+    ASSERT_OK(scanners.back()->SetPrefetching(i % 2 == 0));
+    ASSERT_OK(scanners.back()->Open());
+  }
+
+  vector<KuduScanBatch> batches(kNumScanners);
+  vector<Synchronizer> syncs(kNumScanners);
+  vector<int> counts(kNumScanners, 0);
+  bool more_rows = true;
+  while (more_rows) {
+    vector<unique_ptr<KuduStatusMemberCallback<Synchronizer>>> cbs;
+    vector<int> active;
+    for (int i = 0; i < kNumScanners; i++) {
+      if (!scanners[i]->HasMoreRows()) {
+        continue;
+      }
+      syncs[i].Reset();
+      cbs.emplace_back(new KuduStatusMemberCallback<Synchronizer>(
+          &syncs[i], &Synchronizer::StatusCB));
+      scanners[i]->NextBatchAsync(&batches[i], cbs.back().get());
+      active.push_back(i);
+    }
+    for (int i : active) {
+      ASSERT_OK(syncs[i].Wait());
+      counts[i] += batches[i].NumRows();
+    }
+    more_rows = !active.empty();
+  }
+  for (int i = 0; i < kNumScanners; i++) {
+    EXPECT_EQ(kNumRows, counts[i]);
+  }
+}
+
 TEST_F(ClientTest, TestProjectInvalidColumn) {
   KuduScanner scanner(client_table_.get());
   Status s = scanner.SetProjectedColumns({ "column-doesnt-exist" });
@@ -1192,6 +1382,101 @@ TEST_F(ClientTest, TestScanCloseProxy) {
   }
 }
 
+TEST_F(ClientTest, TestScanWithPrefetching) {
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("TestScanWithPrefetching", 1, GenerateSplitRows(),
+                                      {}, &table));
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(table.get(), FLAGS_test_scan_num_rows));
+
+  // Scan in many small batches, each of which should be prefetched.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetPrefetching(true));
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetProjectedColumns({ "key" }));
+    ASSERT_OK(scanner.Open());
+    Status s = scanner.SetPrefetching(false);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+    set<int32_t> keys;
+    int num_prefetched = 0;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (const KuduScanBatch::RowPtr& row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_TRUE(keys.insert(key).second) << "duplicate key " << key;
+      }
+      if (scanner.data_->prefetch_in_flight_) {
+        num_prefetched++;
+      }
+    }
+    ASSERT_EQ(FLAGS_test_scan_num_rows, keys.size());
+    ASSERT_GT(num_prefetched, 0);
+  }
+
+  // Close a scanner while a batch is being prefetched.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetPrefetching(true));
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    do {
+      ASSERT_TRUE(scanner.HasMoreRows());
+      ASSERT_OK(scanner.NextBatch(&batch));
+    } while (!scanner.data_->prefetch_in_flight_);
+    scanner.Close();
+    ASSERT_FALSE(scanner.data_->prefetch_in_flight_);
+  }
+}
+
+TEST_F(ClientTest, TestParallelScan) {
+  NO_FATALS(InsertTestRows(client_table_.get(), FLAGS_test_scan_num_rows));
+
+  KuduScanTokenBuilder builder(client_table_.get());
+  ASSERT_OK(builder.SetProjectedColumnNames({ "key" }));
+  ASSERT_OK(builder.SetBatchSizeBytes(100));
+
+  {
+    KuduParallelScanner scanner(&builder);
+    Status s = scanner.SetMaxConcurrency(0);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    ASSERT_OK(scanner.SetMaxConcurrency(3));
+    ASSERT_OK(scanner.SetMaxConcurrencyPerServer(1));
+    ASSERT_OK(scanner.SetMaxBufferedBatches(2));
+    ASSERT_OK(scanner.Open());
+    s = scanner.SetMaxConcurrency(1);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+    // Every row is returned exactly once.
+    set<int32_t> keys;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (const KuduScanBatch::RowPtr& row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_TRUE(keys.insert(key).second) << "duplicate key " << key;
+      }
+    }
+    ASSERT_EQ(FLAGS_test_scan_num_rows, keys.size());
+  }
+
+  // Close a scanner in the middle of the scan.
+  {
+    KuduParallelScanner scanner(&builder);
+    ASSERT_OK(scanner.SetMaxBufferedBatches(1));
+    ASSERT_OK(scanner.Open());
+    ASSERT_TRUE(scanner.HasMoreRows());
+    KuduScanBatch batch;
+    ASSERT_OK(scanner.NextBatch(&batch));
+    ASSERT_GT(batch.NumRows(), 0);
+    scanner.Close();
+  }
+}
+
 // Check that the client scanner does not redact rows.
 TEST_F(ClientTest, TestRowPtrNoRedaction) {
   google::SetCommandLineOption("redact", "log");
@@ -1808,6 +2093,55 @@ TEST_F(ClientTest, TestMetaCacheExpiry) {
   ASSERT_FALSE(entry.stale());
 }
 
+// Measures the throughput of cached tablet lookups with increasing numbers of
+// concurrent threads.
+TEST_F(ClientTest, TestMetaCacheLookupPerf) {
+  auto& meta_cache = client_->data_->meta_cache_;
+
+  // Prime the cache with every tablet of the table, collecting their keys.
+  vector<string> partition_keys;
+  string partition_key;
+  do {
+    scoped_refptr<internal::RemoteTablet> rt = MetaCacheLookup(client_table_.get(),
+                                                               partition_key);
+    ASSERT_TRUE(rt);
+    partition_keys.push_back(partition_key);
+    partition_key = rt->partition().partition_key_end();
+  } while (!partition_key.empty());
+  ASSERT_GT(partition_keys.size(), 1);
+
+  for (int num_threads = 1;
+       num_threads <= FLAGS_meta_cache_lookup_perf_threads;
+       num_threads *= 2) {
+    std::atomic<int64_t> num_failed(0);
+    vector<thread> threads;
+    Stopwatch sw;
+    sw.start();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        internal::MetaCacheEntry entry;
+        for (int i = 0; i < FLAGS_meta_cache_lookups_per_thread; i++) {
+          const string& key = partition_keys[(t + i) % partition_keys.size()];
+          if (!meta_cache->LookupTabletByKeyFastPath(client_table_.get(), key, &entry)) {
+            num_failed++;
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    sw.stop();
+    ASSERT_EQ(0, num_failed.load());
+    const int64_t num_lookups =
+        static_cast<int64_t>(num_threads) * FLAGS_meta_cache_lookups_per_thread;
+    LOG(INFO) << Substitute("$0 threads: $1 lookups/sec ($2 per thread)",
+                            num_threads,
+                            num_lookups / sw.elapsed().wall_seconds(),
+                            num_lookups / sw.elapsed().wall_seconds() / num_threads);
+  }
+}
+
 TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("blacklist",
@@ -1885,6 +2219,71 @@ TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   }
 }
 
+// Test that LOWEST_LATENCY replica selection follows the scan latency
+// recorded for the tablet servers.
+TEST_F(ClientTest, TestGetTabletServerLowestLatency) {
+  // Don't let the estimates decay over the course of the test.
+  FLAGS_client_scan_latency_half_life_ms = 0;
+
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("lowest_latency",
+                                      3,
+                                      GenerateSplitRows(),
+                                      {},
+                                      &table));
+  NO_FATALS(InsertTestRows(table.get(), 100, 0));
+
+  scoped_refptr<internal::RemoteTablet> rt;
+  vector<internal::RemoteTabletServer*> tservers;
+  while (true) {
+    rt = MetaCacheLookup(table.get(), "");
+    ASSERT_TRUE(rt.get() != nullptr);
+    rt->GetRemoteTabletServers(&tservers);
+    if (tservers.size() == 3) {
+      break;
+    }
+    rt->MarkStale();
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+
+  const auto select = [&]() -> internal::RemoteTabletServer* {
+    internal::RemoteTabletServer* rts = nullptr;
+    vector<internal::RemoteTabletServer*> candidates;
+    CHECK_OK(client_->data_->GetTabletServer(client_.get(), rt,
+                                             KuduClient::LOWEST_LATENCY,
+                                             set<string>(), &candidates, &rts));
+    return rts;
+  };
+
+  // Scanning with LOWEST_LATENCY works and records the latency of the
+  // servers, including the time the scans spent queued on them.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetSelection(KuduClient::LOWEST_LATENCY));
+    ASSERT_OK(scanner.SetBatchSizeBytes(1));
+    vector<string> rows;
+    ASSERT_OK(ScanToStrings(&scanner, &rows));
+    ASSERT_EQ(100, rows.size());
+    ASSERT_TRUE(ContainsKey(scanner.GetResourceMetrics().Get(), "queue_duration_nanos"));
+  }
+
+  // Record enough samples for the estimates to converge, whatever the
+  // latency of the scan above.
+  const MonoDelta kNoQueueTime = MonoDelta::FromNanoseconds(0);
+  for (int i = 0; i < 20; i++) {
+    tservers[0]->RecordScanLatency(MonoDelta::FromSeconds(10), kNoQueueTime);
+    tservers[1]->RecordScanLatency(MonoDelta::FromSeconds(1), kNoQueueTime);
+    tservers[2]->RecordScanLatency(MonoDelta::FromSeconds(5), kNoQueueTime);
+  }
+  ASSERT_EQ(tservers[1], select());
+
+  // A server slowing down, or queueing the scans, loses its preference.
+  for (int i = 0; i < 20; i++) {
+    tservers[1]->RecordScanLatency(MonoDelta::FromSeconds(1), MonoDelta::FromSeconds(10));
+  }
+  ASSERT_EQ(tservers[2], select());
+}
+
 TEST_F(ClientTest, TestScanWithEncodedRangePredicate) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("split-table",
@@ -2177,6 +2576,16 @@ static unique_ptr<KuduError> GetSingleErrorFromSession(KuduSession* session) {
 
 // Simplest case of inserting through the client API: a single row
 // with manual batching.
+TEST_F(ClientTest, TestWriteRowsInSidecars) {
+  FLAGS_client_write_rows_in_sidecars = true;
+  NO_FATALS(InsertTestRows(client_table_.get(), 1000));
+  ASSERT_EQ(1000, CountRowsFromClient(client_table_.get()));
+  NO_FATALS(UpdateTestRows(client_table_.get(), 0, 500));
+  vector<string> rows;
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
+  ASSERT_EQ(1000, rows.size());
+}
+
 TEST_F(ClientTest, TestInsertSingleRowManualBatch) {
   shared_ptr<KuduSession> session = client_->NewSession();
   ASSERT_FALSE(session->HasPendingOperations());
@@ -2210,6 +2619,66 @@ TEST_F(ClientTest, TestInsertSingleRowManualBatch) {
   FlushSessionOrDie(session);
 }
 
+// Test applying many operations at once, across several tablets and with
+// a malformed operation in the middle of the batch.
+TEST_F(ClientTest, TestApplyBatch) {
+  static const int kTabletsNum = 4;
+  static const int kRowsPerTablet = 100;
+
+  shared_ptr<KuduTable> table;
+  {
+    vector<unique_ptr<KuduPartialRow>> rows;
+    for (int i = 1; i < kTabletsNum; ++i) {
+      unique_ptr<KuduPartialRow> row(schema_.NewRow());
+      ASSERT_OK(row->SetInt32(0, i * kRowsPerTablet));
+      rows.emplace_back(std::move(row));
+    }
+    ASSERT_NO_FATAL_FAILURE(CreateTable("TestApplyBatch", 1,
+                                        std::move(rows), {}, &table));
+  }
+
+  for (auto mode : { KuduSession::MANUAL_FLUSH,
+                     KuduSession::AUTO_FLUSH_BACKGROUND,
+                     KuduSession::AUTO_FLUSH_SYNC }) {
+    SCOPED_TRACE(mode);
+    shared_ptr<KuduSession> session = client_->NewSession();
+    ASSERT_OK(session->SetFlushMode(mode));
+    session->SetTimeoutMillis(10000);
+
+    vector<KuduWriteOperation*> ops;
+    for (int i = 0; i < kTabletsNum * kRowsPerTablet; ++i) {
+      ops.push_back(BuildTestRow(table.get(), i).release());
+    }
+    // An operation without a key is reported, but does not prevent
+    // the rest of the batch from being applied.
+    unique_ptr<KuduInsert> bad_insert(table->NewInsert());
+    ASSERT_OK(bad_insert->mutable_row()->SetInt32("int_val", 54321));
+    KuduInsert* bad_op = bad_insert.release();
+    ops.insert(ops.begin() + kRowsPerTablet + 1, bad_op);
+
+    Status s = session->ApplyBatch(ops);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+    unique_ptr<KuduError> error = GetSingleErrorFromSession(session.get());
+    ASSERT_EQ(bad_op, &error->failed_op());
+    ASSERT_OK(session->Flush());
+
+    ASSERT_EQ(kTabletsNum * kRowsPerTablet, CountRowsFromClient(table.get()));
+    vector<string> rows;
+    ScanTableToStrings(table.get(), &rows);
+    ASSERT_EQ(R"((int32 key=0, int32 int_val=0, string string_val="hello 0", )"
+              R"(int32 non_null_with_default=0))", rows.front());
+
+    // Delete the rows so the next flush mode starts from an empty table.
+    ops.clear();
+    for (int i = 0; i < kTabletsNum * kRowsPerTablet; ++i) {
+      ops.push_back(DeleteTestRow(table.get(), i).release());
+    }
+    ASSERT_OK(session->ApplyBatch(ops));
+    ASSERT_OK(session->Flush());
+    ASSERT_EQ(0, CountRowsFromClient(table.get()));
+  }
+}
+
 TEST_F(ClientTest, TestInsertAutoFlushSync) {
   shared_ptr<KuduSession> session = client_->NewSession();
   ASSERT_FALSE(session->HasPendingOperations());
@@ -2438,7 +2907,7 @@ TEST_F(ClientTest, TestMultipleMultiRowManualBatches) {
 
   // Verify the data looks right.
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   std::sort(rows.begin(), rows.end());
   ASSERT_EQ(kNumRowsPerTablet, rows.size());
   ASSERT_EQ(R"((int32 key=0, int32 int_val=0, string string_val="hello world", )"
@@ -2472,7 +2941,7 @@ TEST_F(ClientTest, TestBatchWithPartialError) {
 
   // Verify that the other row was successfully inserted
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(2, rows.size());
   std::sort(rows.begin(), rows.end());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=1, string string_val="original row", )"
@@ -2540,7 +3009,7 @@ void ClientTest::DoApplyWithoutFlushTest(int sleep_micros) {
 
   // Should have no rows.
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 }
 
@@ -2989,7 +3458,7 @@ TEST_F(ClientTest, TestAutoFlushBackgroundDropSession) {
   // should notice that and do not perform flush, so no data is supposed
   // to appear in the table.
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   EXPECT_TRUE(rows.empty());
 }
 
@@ -3276,7 +3745,7 @@ TEST_F(ClientTest, TestMutationsWork) {
   ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 2));
   FlushSessionOrDie(session);
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(1, rows.size());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=2, string string_val="original row", )"
             "int32 non_null_with_default=12345)", rows[0]);
@@ -3284,7 +3753,7 @@ TEST_F(ClientTest, TestMutationsWork) {
 
   ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 1));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 }
 
@@ -3296,7 +3765,7 @@ TEST_F(ClientTest, TestMutateDeletedRow) {
   FlushSessionOrDie(session);
   ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 1));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 
   // Attempt update deleted row
@@ -3308,7 +3777,7 @@ TEST_F(ClientTest, TestMutateDeletedRow) {
   unique_ptr<KuduError> error = GetSingleErrorFromSession(session.get());
   ASSERT_EQ(error->failed_op().ToString(),
             "UPDATE int32 key=1, int32 int_val=2");
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 
   // Attempt delete deleted row
@@ -3320,7 +3789,7 @@ TEST_F(ClientTest, TestMutateDeletedRow) {
   error = GetSingleErrorFromSession(session.get());
   ASSERT_EQ(error->failed_op().ToString(),
             "DELETE int32 key=1");
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 }
 
@@ -3338,7 +3807,7 @@ TEST_F(ClientTest, TestMutateNonexistentRow) {
   unique_ptr<KuduError> error = GetSingleErrorFromSession(session.get());
   ASSERT_EQ(error->failed_op().ToString(),
             "UPDATE int32 key=1, int32 int_val=2");
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 
   // Attempt delete nonexistent row
@@ -3350,7 +3819,7 @@ TEST_F(ClientTest, TestMutateNonexistentRow) {
   error = GetSingleErrorFromSession(session.get());
   ASSERT_EQ(error->failed_op().ToString(),
             "DELETE int32 key=1");
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 }
 
@@ -3741,7 +4210,7 @@ TEST_F(ClientTest, TestDeleteTable) {
   // Insert a few rows, and scan them back. This is to populate the MetaCache.
   NO_FATALS(InsertTestRows(client_.get(), client_table_.get(), 10));
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(10, rows.size());
 
   // Remove the table
@@ -4048,7 +4517,7 @@ TEST_F(ClientTest, TestSeveralRowMutatesPerBatch) {
   ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 2));
   FlushSessionOrDie(session);
   vector<string> rows;
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(1, rows.size());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=2, string string_val="", )"
             "int32 non_null_with_default=12345)", rows[0]);
@@ -4060,7 +4529,7 @@ TEST_F(ClientTest, TestSeveralRowMutatesPerBatch) {
   ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 2, 1, ""));
   ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 2));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(1, rows.size());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=2, string string_val="", )"
             "int32 non_null_with_default=12345)", rows[0]);
@@ -4071,14 +4540,14 @@ TEST_F(ClientTest, TestSeveralRowMutatesPerBatch) {
   ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 1));
   ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 1));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(0, rows.size());
 
   // Test delete/insert (insert a row first)
   LOG(INFO) << "Inserting row for delete/insert test, key " << 1 << ".";
   ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 1, 1, ""));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(1, rows.size());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=1, string string_val="", )"
             "int32 non_null_with_default=12345)", rows[0]);
@@ -4087,7 +4556,7 @@ TEST_F(ClientTest, TestSeveralRowMutatesPerBatch) {
   ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 1));
   ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 1, 2, ""));
   FlushSessionOrDie(session);
-  ScanTableToStrings(client_table_.get(), &rows);
+  NO_FATALS(ScanTableToStrings(client_table_.get(), &rows));
   ASSERT_EQ(1, rows.size());
   ASSERT_EQ(R"((int32 key=1, int32 int_val=2, string string_val="", )"
             "int32 non_null_with_default=12345)", rows[0]);
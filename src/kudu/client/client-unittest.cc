@@ -18,11 +18,14 @@
 // Tests for the client which are true unit tests and don't require a cluster, etc.
 
 #include <cstddef>
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
 #include "kudu/client/client.h"
@@ -30,14 +33,22 @@
 #include "kudu/client/error_collector.h"
 #include "kudu/client/schema.h"
 #include "kudu/client/value.h"
+#include "kudu/client/write_flow_control.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_double(client_write_window_latency_factor);
+DECLARE_int32(client_write_window_initial);
+DECLARE_int32(client_write_window_max);
+
+using std::deque;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 using kudu::client::internal::ErrorCollector;
+using kudu::client::internal::WriteFlowControl;
 
 namespace kudu {
 namespace client {
@@ -272,5 +283,62 @@ TEST(ClientUnitTest, TestKuduSchemaToString) {
   EXPECT_EQ(schema_str_2, s2.ToString());
 }
 
+TEST(ClientUnitTest, TestWriteFlowControl) {
+  FLAGS_client_write_window_initial = 2;
+  FLAGS_client_write_window_max = 3;
+  FLAGS_client_write_window_latency_factor = 0;
+  const string kServer = "ts";
+
+  scoped_refptr<WriteFlowControl> flow_control(new WriteFlowControl());
+  const ResourceMetrics& metrics = flow_control->metrics();
+  deque<shared_ptr<WriteFlowControl::Slot>> slots;
+  const auto send = [&](const shared_ptr<WriteFlowControl::Slot>& slot) {
+    slots.push_back(slot);
+  };
+  const auto complete_first = [&]() {
+    shared_ptr<WriteFlowControl::Slot> slot = std::move(slots.front());
+    slots.pop_front();
+    slot.reset();
+  };
+
+  // Two units fit into the initial window, the third one waits.
+  for (int i = 0; i < 3; i++) {
+    flow_control->Send(kServer, send);
+  }
+  ASSERT_EQ(2, slots.size());
+  ASSERT_EQ(1, metrics.GetMetric(WriteFlowControl::kWritesDeferredMetric));
+
+  // Completing a unit lets the waiting one in, and the window grows
+  // additively up to its maximum.
+  complete_first();
+  ASSERT_EQ(2, slots.size());
+  while (!slots.empty()) {
+    complete_first();
+  }
+  ASSERT_EQ(3, flow_control->GetWindowForTests(kServer));
+
+  // Rejections by a busy server halve the window, once for all the units
+  // which were in flight at the time.
+  for (int i = 0; i < 3; i++) {
+    flow_control->Send(kServer, send);
+  }
+  ASSERT_EQ(3, slots.size());
+  slots[0]->MarkServerBusy();
+  slots[1]->MarkServerBusy();
+  complete_first();
+  complete_first();
+  ASSERT_EQ(1, flow_control->GetWindowForTests(kServer));
+  ASSERT_EQ(2, metrics.GetMetric(WriteFlowControl::kServerBusyMetric));
+  ASSERT_EQ(1, metrics.GetMetric(WriteFlowControl::kWindowDecreasesMetric));
+
+  // With the window down to one, units are sent one at a time.
+  flow_control->Send(kServer, send);
+  ASSERT_EQ(1, slots.size());
+  complete_first();
+  ASSERT_EQ(1, slots.size());
+  complete_first();
+  ASSERT_TRUE(slots.empty());
+}
+
 } // namespace client
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/client/client.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <ostream>
@@ -27,6 +28,7 @@
 
 #include <boost/bind.hpp>
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/client/callbacks.h"
@@ -36,6 +38,7 @@
 #include "kudu/client/error-internal.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner-internal.h"
 #include "kudu/client/partitioner-internal.h"
 #include "kudu/client/replica-internal.h"
 #include "kudu/client/row_result.h"
@@ -51,6 +54,7 @@
 #include "kudu/client/tablet-internal.h"
 #include "kudu/client/tablet_server-internal.h"
 #include "kudu/client/value.h"
+#include "kudu/client/write_flow_control.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
@@ -85,7 +89,10 @@
 #include "kudu/security/token.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/init.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/logging_callback.h"
@@ -94,6 +101,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/version_info.h"
 
 using kudu::master::AlterTableRequestPB;
@@ -120,13 +128,23 @@ using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
 using kudu::rpc::UserCredentials;
+using kudu::tserver::GetRequestPB;
+using kudu::tserver::GetResponsePB;
 using kudu::tserver::ScanResponsePB;
+using kudu::tserver::TabletServerErrorPB;
+using kudu::tserver::TabletServerFeatures;
 using std::set;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_int32(client_async_scan_threads, 4,
+             "Maximum number of threads a client uses to process the batches "
+             "fetched by KuduScanner::NextBatchAsync() and to open the tablets "
+             "it moves on to. No thread is held while a request is in flight.");
+TAG_FLAG(client_async_scan_threads, advanced);
+
 MAKE_ENUM_LIMITS(kudu::client::KuduSession::FlushMode,
                  kudu::client::KuduSession::AUTO_FLUSH_SYNC,
                  kudu::client::KuduSession::MANUAL_FLUSH);
@@ -350,6 +368,10 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
 
   c->data_->meta_cache_.reset(new MetaCache(c.get(), data_->replica_visibility_));
   c->data_->dns_resolver_.reset(new DnsResolver);
+  RETURN_NOT_OK(ThreadPoolBuilder("client-async-scan")
+                .set_min_threads(0)
+                .set_max_threads(std::max(1, FLAGS_client_async_scan_threads))
+                .Build(&c->data_->async_scan_pool_));
 
   // Init local host names used for locality decisions.
   RETURN_NOT_OK_PREPEND(c->data_->InitLocalHostNames(),
@@ -701,6 +723,11 @@ KuduTableCreator& KuduTableCreator::num_replicas(int num_replicas) {
   return *this;
 }
 
+KuduTableCreator& KuduTableCreator::num_read_replicas(int num_read_replicas) {
+  data_->num_read_replicas_ = num_read_replicas;
+  return *this;
+}
+
 KuduTableCreator& KuduTableCreator::timeout(const MonoDelta& timeout) {
   data_->timeout_ = timeout;
   return *this;
@@ -732,6 +759,9 @@ Status KuduTableCreator::Create() {
   if (data_->num_replicas_ != boost::none) {
     req.set_num_replicas(data_->num_replicas_.get());
   }
+  if (data_->num_read_replicas_ != boost::none) {
+    req.set_num_read_replicas(data_->num_read_replicas_.get());
+  }
   RETURN_NOT_OK_PREPEND(SchemaToPB(*data_->schema_->schema_, req.mutable_schema(),
                                    SCHEMA_PB_WITHOUT_WRITE_DEFAULT),
                         "Invalid schema");
@@ -877,6 +907,24 @@ KuduPredicate* KuduTable::NewInListPredicate(const Slice& col_name,
   });
 }
 
+KuduPredicate* KuduTable::NewInBloomFilterPredicate(const Slice& col_name,
+                                                    vector<KuduBloomFilter*>* bloom_filters) {
+  // We always take ownership of the filters; this ensures cleanup if the
+  // predicate is invalid.
+  SCOPED_CLEANUP({
+    STLDeleteElements(bloom_filters);
+  });
+  return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
+    vector<InBloomFilterPredicateData::SerializedFilter> filters;
+    filters.reserve(bloom_filters->size());
+    for (const KuduBloomFilter* bloom_filter : *bloom_filters) {
+      const BloomFilterBuilder& builder = bloom_filter->data_->builder;
+      filters.emplace_back(builder.slice().ToString(), builder.n_hashes());
+    }
+    return new KuduPredicate(new InBloomFilterPredicateData(col_schema, std::move(filters)));
+  });
+}
+
 KuduPredicate* KuduTable::NewIsNotNullPredicate(const Slice& col_name) {
   return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
     return new KuduPredicate(new IsNotNullPredicateData(col_schema));
@@ -889,6 +937,99 @@ KuduPredicate* KuduTable::NewIsNullPredicate(const Slice& col_name) {
   });
 }
 
+Status KuduTable::Get(const KuduPartialRow& key,
+                      const vector<string>& col_names,
+                      KuduScanBatch* batch) {
+  batch->data_->Clear();
+  if (!key.IsKeySet()) {
+    return Status::InvalidArgument("all primary key columns must be set", key.ToString());
+  }
+  const Schema& schema = *data_->schema_.schema_;
+  vector<ColumnSchema> cols;
+  cols.reserve(col_names.size());
+  for (const string& col_name : col_names) {
+    int idx = schema.find_column(col_name);
+    if (idx == Schema::kColumnNotFound) {
+      return Status::NotFound(Substitute(
+          "Column: \"$0\" was not found in the table schema.", col_name));
+    }
+    cols.push_back(schema.column(idx));
+  }
+  unique_ptr<Schema> projection(new Schema());
+  RETURN_NOT_OK(projection->Reset(cols, 0));
+
+  string partition_key;
+  RETURN_NOT_OK(data_->partition_schema_.EncodeKey(key, &partition_key));
+  GetRequestPB req;
+  req.add_encoded_primary_keys(key.ToEncodedRowKeyOrDie());
+  RETURN_NOT_OK(SchemaToColumnPBs(*projection, req.mutable_projected_columns(),
+                                  SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+
+  KuduClient* client = data_->client_.get();
+  const MonoTime deadline = MonoTime::Now() + client->default_rpc_timeout();
+  set<string> blacklist;
+  GetResponsePB resp;
+  RpcController controller;
+  for (int attempt = 1;; attempt++) {
+    scoped_refptr<internal::RemoteTablet> remote;
+    Synchronizer sync;
+    client->data_->meta_cache_->LookupTabletByKey(this, partition_key, deadline, &remote,
+                                                  sync.AsStatusCallback());
+    RETURN_NOT_OK(sync.Wait());
+    req.set_tablet_id(remote->tablet_id());
+
+    internal::RemoteTabletServer* ts;
+    vector<internal::RemoteTabletServer*> candidates;
+    Status s = client->data_->GetTabletServer(client, remote, KuduClient::LEADER_ONLY,
+                                              blacklist, &candidates, &ts);
+    if (s.ok()) {
+      resp.Clear();
+      controller.Reset();
+      controller.set_deadline(deadline);
+      controller.RequireServerFeature(TabletServerFeatures::POINT_LOOKUPS);
+      s = ts->proxy()->Get(req, &resp, &controller);
+      if (s.ok()) {
+        if (!resp.has_error()) {
+          break;
+        }
+        s = StatusFromPB(resp.error().status());
+        if (resp.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND &&
+            resp.error().code() != TabletServerErrorPB::TABLET_NOT_RUNNING) {
+          return s;
+        }
+      } else if (!s.IsNetworkError() && !s.IsServiceUnavailable()) {
+        return s;
+      }
+      // Try another replica, refreshing the tablet's locations if need be.
+      remote->MarkReplicaFailed(ts, s);
+      blacklist.insert(ts->permanent_uuid());
+    } else if (s.IsServiceUnavailable()) {
+      // Every candidate is blacklisted, or the tablet has no known leader:
+      // cycle through them all again once an election may have completed.
+      blacklist.clear();
+    } else {
+      return s;
+    }
+    if (MonoTime::Now() >= deadline) {
+      return Status::TimedOut("point lookup timed out", s.ToString());
+    }
+    SleepFor(MonoDelta::FromMilliseconds(std::min(attempt * 100, 1000)));
+  }
+
+  if (resp.has_propagated_timestamp()) {
+    client->data_->UpdateLatestObservedTimestamp(resp.propagated_timestamp());
+  }
+  KuduScanBatch::Data* batch_data = batch->data_;
+  batch_data->owned_projection_ = std::move(projection);
+  batch_data->owned_client_projection_.reset(new KuduSchema(*batch_data->owned_projection_));
+  return batch_data->Reset(&controller,
+                           batch_data->owned_projection_.get(),
+                           batch_data->owned_client_projection_.get(),
+                           KuduScanner::NO_FLAGS,
+                           make_gscoped_ptr(resp.release_data()),
+                           gscoped_ptr<ColumnarRowBlockPB>());
+}
+
 ////////////////////////////////////////////////////////////
 // Error
 ////////////////////////////////////////////////////////////
@@ -998,6 +1139,21 @@ Status KuduSession::Apply(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::ApplyBatch(const vector<KuduWriteOperation*>& write_ops) {
+  if (data_->flush_mode_ == AUTO_FLUSH_SYNC) {
+    // Every operation is flushed inline: batching would not help.
+    Status first_error;
+    for (KuduWriteOperation* write_op : write_ops) {
+      Status s = Apply(write_op);
+      if (!s.ok() && first_error.ok()) {
+        first_error = s;
+      }
+    }
+    return first_error;
+  }
+  return data_->ApplyWriteOps(write_ops);
+}
+
 int KuduSession::CountBufferedOperations() const {
   return data_->CountBufferedOperations();
 }
@@ -1010,6 +1166,10 @@ int KuduSession::CountPendingErrors() const {
   return data_->error_collector_->CountErrors();
 }
 
+const ResourceMetrics& KuduSession::GetWriteResourceMetrics() const {
+  return data_->write_flow_control_->metrics();
+}
+
 void KuduSession::GetPendingErrors(vector<KuduError*>* errors, bool* overflowed) {
   data_->error_collector_->GetErrors(errors, overflowed);
 }
@@ -1212,6 +1372,14 @@ Status KuduScanner::SetBatchSizeBytes(uint32_t batch_size) {
   return data_->mutable_configuration()->SetBatchSizeBytes(batch_size);
 }
 
+Status KuduScanner::SetPrefetching(bool prefetching) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetching must be set before Open()");
+  }
+  data_->mutable_configuration()->SetPrefetching(prefetching);
+  return Status::OK();
+}
+
 Status KuduScanner::SetReadMode(ReadMode read_mode) {
   if (data_->open_) {
     return Status::IllegalState("Read mode must be set before Open()");
@@ -1321,6 +1489,7 @@ Status KuduScanner::SetRowFormatFlags(uint64_t flags) {
   switch (flags) {
     case NO_FLAGS:
     case PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case COLUMNAR_LAYOUT:
       break;
     default:
       return Status::InvalidArgument(Substitute("Invalid row format flags: $0", flags));
@@ -1412,6 +1581,9 @@ void KuduScanner::Close() {
 
   VLOG(2) << "Ending " << data_->DebugString();
 
+  // The prefetched batch, if any, won't be consumed.
+  data_->CancelPrefetch();
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
@@ -1453,10 +1625,6 @@ Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
-  // TODO: do some double-buffering here -- when we return this batch
-  // we should already have fired off the RPC for the next batch, but
-  // need to do some swapping of the response objects around to avoid
-  // stomping on the memory the user is looking at.
   CHECK(data_->open_);
   CHECK(data_->proxy_);
 
@@ -1470,11 +1638,15 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
-    return batch->data_->Reset(&data_->controller_,
-                               data_->configuration().projection(),
-                               data_->configuration().client_projection(),
-                               data_->configuration().row_format_flags(),
-                               make_gscoped_ptr(data_->last_response_.release_data()));
+    RETURN_NOT_OK(batch->data_->Reset(
+        &data_->controller_,
+        data_->configuration().projection(),
+        data_->configuration().client_projection(),
+        data_->configuration().row_format_flags(),
+        make_gscoped_ptr(data_->last_response_.release_data()),
+        make_gscoped_ptr(data_->last_response_.release_columnar_data())));
+    data_->MaybeStartPrefetch();
+    return Status::OK();
   }
 
   if (data_->last_response_.has_more_results()) {
@@ -1482,11 +1654,20 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     VLOG(2) << "Continuing " << data_->DebugString();
 
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+
+    // If the request was prefetched, its response is handled as if it had
+    // just been sent; any retries are sent synchronously.
+    bool prefetched = data_->prefetch_in_flight_;
+    if (!prefetched) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
       bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      ScanRpcStatus result = prefetched ?
+          data_->FinishPrefetch(batch_deadline) :
+          data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      prefetched = false;
 
       // Success case.
       if (result.result == ScanRpcStatus::OK) {
@@ -1494,11 +1675,15 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
           data_->last_primary_key_ = data_->last_response_.last_primary_key();
         }
         data_->scan_attempts_ = 0;
-        return batch->data_->Reset(&data_->controller_,
-                                   data_->configuration().projection(),
-                                   data_->configuration().client_projection(),
-                                   data_->configuration().row_format_flags(),
-                                   make_gscoped_ptr(data_->last_response_.release_data()));
+        RETURN_NOT_OK(batch->data_->Reset(
+            &data_->controller_,
+            data_->configuration().projection(),
+            data_->configuration().client_projection(),
+            data_->configuration().row_format_flags(),
+            make_gscoped_ptr(data_->last_response_.release_data()),
+            make_gscoped_ptr(data_->last_response_.release_columnar_data())));
+        data_->MaybeStartPrefetch();
+        return Status::OK();
       }
 
       data_->scan_attempts_++;
@@ -1544,6 +1729,40 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
   }
 }
 
+void KuduScanner::NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb) {
+  CHECK(data_->open_);
+  CHECK(data_->proxy_);
+
+  if (data_->short_circuit_ || data_->data_in_open_ ||
+      (!data_->last_response_.has_more_results() && !data_->MoreTablets())) {
+    // The batch is at hand: NextBatch() won't block.
+    cb->Run(NextBatch(batch));
+    return;
+  }
+
+  // NextBatch() runs on the client's pool, where it may block if the request
+  // has to be retried or the next tablet has to be opened, without holding
+  // up the reactor thread.
+  auto run_next_batch = [this, batch, cb]() {
+    Status s = data_->table_->client()->data_->async_scan_pool_->SubmitFunc(
+        [this, batch, cb]() { cb->Run(NextBatch(batch)); });
+    if (PREDICT_FALSE(!s.ok())) {
+      cb->Run(s);
+    }
+  };
+  if (!data_->last_response_.has_more_results()) {
+    run_next_batch();
+    return;
+  }
+
+  // The request for the next batch of the current tablet is sent as a
+  // prefetch whose response NextBatch() consumes without waiting.
+  if (!data_->prefetch_in_flight_) {
+    data_->StartPrefetch();
+  }
+  data_->RunWhenPrefetchDone(std::move(run_next_batch));
+}
+
 Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   CHECK(data_->open_);
   internal::RemoteTabletServer* rts = data_->ts_;
@@ -1646,6 +1865,16 @@ Status KuduScanTokenBuilder::SetTimeoutMillis(int millis) {
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::IncludeTableMetadata(bool include_metadata) {
+  data_->IncludeTableMetadata(include_metadata);
+  return Status::OK();
+}
+
+Status KuduScanTokenBuilder::IncludeTabletMetadata(bool include_metadata) {
+  data_->IncludeTabletMetadata(include_metadata);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::AddConjunctPredicate(KuduPredicate* pred) {
   return data_->mutable_configuration()->AddConjunctPredicate(pred);
 }
@@ -1666,6 +1895,75 @@ Status KuduScanTokenBuilder::Build(vector<KuduScanToken*>* tokens) {
   return data_->Build(tokens);
 }
 
+////////////////////////////////////////////////////////////
+// KuduParallelScanner
+////////////////////////////////////////////////////////////
+
+KuduParallelScanner::KuduParallelScanner(KuduScanTokenBuilder* builder)
+    : data_(new KuduParallelScanner::Data(builder)) {
+}
+
+KuduParallelScanner::~KuduParallelScanner() {
+  Close();
+  delete data_;
+}
+
+Status KuduParallelScanner::SetMaxConcurrency(int max_concurrency) {
+  if (max_concurrency <= 0) {
+    return Status::InvalidArgument("Maximum concurrency must be greater than 0");
+  }
+  if (data_->open_) {
+    return Status::IllegalState("Maximum concurrency must be set before Open()");
+  }
+  data_->max_concurrency_ = max_concurrency;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::SetMaxConcurrencyPerServer(int max_concurrency) {
+  if (max_concurrency < 0) {
+    return Status::InvalidArgument("Maximum concurrency per server must not be negative");
+  }
+  if (data_->open_) {
+    return Status::IllegalState("Maximum concurrency per server must be set before Open()");
+  }
+  data_->max_concurrency_per_server_ = max_concurrency;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::SetMaxBufferedBatches(int max_buffered_batches) {
+  if (max_buffered_batches <= 0) {
+    return Status::InvalidArgument("Maximum buffered batches must be greater than 0");
+  }
+  if (data_->open_) {
+    return Status::IllegalState("Maximum buffered batches must be set before Open()");
+  }
+  data_->max_buffered_batches_ = max_buffered_batches;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::Open() {
+  return data_->Open();
+}
+
+void KuduParallelScanner::Close() {
+  data_->Close();
+}
+
+bool KuduParallelScanner::HasMoreRows() const {
+  return data_->HasMoreRows();
+}
+
+Status KuduParallelScanner::NextBatch(KuduScanBatch* batch) {
+  unique_ptr<KuduScanBatch> next;
+  RETURN_NOT_OK(data_->NextBatch(&next));
+  if (next) {
+    std::swap(batch->data_, next->data_);
+  } else {
+    batch->data_->Clear();
+  }
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduReplica
 ////////////////////////////////////////////////////////////
@@ -430,7 +430,13 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
     CLOSEST_REPLICA,  ///< Select the closest replica to the client,
                       ///< or a random one if all replicas are equidistant.
 
-    FIRST_REPLICA     ///< Select the first replica in the list.
+    FIRST_REPLICA,    ///< Select the first replica in the list.
+
+    LOWEST_LATENCY    ///< Select the replica whose tablet server has served
+                      ///< scans of this client with the lowest latency
+                      ///< recently, accounting for the time the scans spent
+                      ///< queued on the server. Servers which haven't served
+                      ///< scans recently are tried first.
   };
 
   /// @return @c true iff client is configured to talk to multiple
@@ -802,6 +808,20 @@ class KUDU_EXPORT KuduTableCreator {
   /// @return Reference to the modified table creator.
   KuduTableCreator& num_replicas(int n_replicas);
 
+  /// Set the number of read replicas of each tablet of the table.
+  ///
+  /// Read replicas are kept in addition to the replicas set by num_replicas().
+  /// They don't vote, so writes don't wait for them, and they serve scans
+  /// which pick them with the CLOSEST_REPLICA selection, e.g. in a remote
+  /// datacenter. Scans of a read replica may lag behind the latest writes;
+  /// a READ_AT_SNAPSHOT scan at a timestamp a little in the past bounds the
+  /// staleness without waiting for the replica to catch up.
+  ///
+  /// @param [in] n_read_replicas
+  ///   Number of read replicas to set. Defaults to 0.
+  /// @return Reference to the modified table creator.
+  KuduTableCreator& num_read_replicas(int n_read_replicas);
+
   /// Set the timeout for the table creation operation.
   ///
   /// This includes any waiting after the create has been submitted
@@ -965,6 +985,30 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   KuduPredicate* NewInListPredicate(const Slice& col_name,
                                     std::vector<KuduValue*>* values);
 
+  /// Create a new IN Bloom filter predicate which can be used for scanners on
+  /// this table.
+  ///
+  /// A row is filtered from the scan if the value of the column is not
+  /// present in every one of the filters. Since Bloom filters have false
+  /// positives, the scan may return rows whose values were never inserted
+  /// into the filters; callers must be prepared to filter those out.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column to which the predicate applies.
+  /// @param [in] bloom_filters
+  ///   The filters which the column will be probed against. See
+  ///   KuduBloomFilter::Insert() for how values must be encoded.
+  /// @return Raw pointer to an IN Bloom filter predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   The returned predicate takes ownership of the filters vector and its
+  ///   elements; the filters' contents are copied into the predicate, so
+  ///   later insertions are not reflected. In the case of an error (e.g. an
+  ///   invalid column name), a non-NULL value is still returned. The error
+  ///   will be returned when attempting to add this predicate to a
+  ///   KuduScanner.
+  KuduPredicate* NewInBloomFilterPredicate(const Slice& col_name,
+                                           std::vector<KuduBloomFilter*>* bloom_filters);
+
   /// Create a new IS NOT NULL predicate which can be used for scanners on this
   /// table.
   ///
@@ -989,6 +1033,27 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   ///   to add this predicate to a KuduScanner.
   KuduPredicate* NewIsNullPredicate(const Slice& col_name);
 
+  /// Look up the row with the given primary key.
+  ///
+  /// The latest version of the row is read from the leader replica of the
+  /// tablet holding it. Unlike a scan bounded to the key, no scanner is
+  /// opened on the tablet server, and only the rowsets which may hold the
+  /// key are read, which makes this suitable for serving key-value style
+  /// lookups.
+  ///
+  /// @param [in] key
+  ///   A row with all of the primary key columns set. Other columns are
+  ///   ignored.
+  /// @param [in] col_names
+  ///   Names of the columns to return, in order.
+  /// @param [out] batch
+  ///   Receives the row if it exists, or is left empty otherwise. The row
+  ///   remains valid until the batch is reused or destroyed.
+  /// @return Operation result status.
+  Status Get(const KuduPartialRow& key,
+             const std::vector<std::string>& col_names,
+             KuduScanBatch* batch) WARN_UNUSED_RESULT;
+
   /// @return The KuduClient object associated with the table. The caller
   ///   should not free the returned pointer.
   KuduClient* client() const;
@@ -1001,6 +1066,7 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
 
   friend class KuduClient;
   friend class KuduPartitioner;
+  friend class KuduScanToken;
 
   KuduTable(const sp::shared_ptr<KuduClient>& client,
             const std::string& name,
@@ -1532,6 +1598,24 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status Apply(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  /// Apply a batch of write operations.
+  ///
+  /// This is equivalent to calling Apply() on each of the operations in
+  /// order, but cheaper per operation when many rows are written at once:
+  /// the operations are added to the mutation buffer in chunks, and
+  /// consecutive operations destined for the same tablet share a single
+  /// tablet location lookup.
+  ///
+  /// All the operations are applied even if some of them fail; as with
+  /// Apply(), the failed operations are stored in the session's error
+  /// collector.
+  ///
+  /// @param [in] write_ops
+  ///   Operations to apply. This method transfers the ownership of all
+  ///   the operations to the KuduSession.
+  /// @return Status of the first failed operation, or OK if none failed.
+  Status ApplyBatch(const std::vector<KuduWriteOperation*>& write_ops) WARN_UNUSED_RESULT;
+
   /// Flush any pending writes.
   ///
   /// This method initiates flushing of the current batch of buffered
@@ -1666,6 +1750,23 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Total count of errors accumulated during the session.
   int CountPendingErrors() const;
 
+  /// Get the metrics of the flow control of writes sent by the session.
+  ///
+  /// In @c AUTO_FLUSH_BACKGROUND mode, the session limits the number of
+  /// write RPCs in flight to each tablet server. The limit adapts to the load
+  /// of the server: it grows while writes complete promptly and is halved
+  /// when the server rejects writes as too busy or their latency rises
+  /// sharply. The metrics include:
+  ///   @li @c write_rpcs_deferred: the number of times writes were held back
+  ///     because the limit of their tablet server was reached
+  ///   @li @c write_server_busy_responses: the number of writes rejected
+  ///     by an overloaded tablet server
+  ///   @li @c write_window_decreases: the number of times the limit of
+  ///     a tablet server was decreased
+  ///
+  /// @return Cumulative write flow control metrics of the session.
+  const ResourceMetrics& GetWriteResourceMetrics() const;
+
   /// Get information on errors from previous session activity.
   ///
   /// The information on errors are reset upon calling this method.
@@ -1956,6 +2057,27 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status NextBatch(KuduScanBatch* batch);
 
+  /// Fetch the next batch of results for this scanner asynchronously.
+  ///
+  /// The request for the batch is sent without blocking the calling thread,
+  /// and no thread is held while it is in flight, so that many scans may be
+  /// driven concurrently by a few application threads. Once the batch is
+  /// ready, it is placed into @c batch and the callback is invoked with the
+  /// status NextBatch() would have returned. The callback runs either
+  /// inline, if the batch is already available, or on a thread of a pool
+  /// shared by all the scanners of the client; it should not block for long.
+  ///
+  /// @warning The scanner must not be used, closed or destroyed until the
+  ///   callback has been invoked.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result. It must remain valid until the callback
+  ///   is invoked.
+  /// @param [in] cb
+  ///   Callback to report on the outcome of the operation. It must remain
+  ///   valid until it is invoked.
+  void NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb);
+
   /// Get the KuduTabletServer that is currently handling the scan.
   ///
   /// More concretely, this is the server that handled the most recent
@@ -1977,6 +2099,19 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetBatchSizeBytes(uint32_t batch_size);
 
+  /// Enable or disable prefetching of batches.
+  ///
+  /// With prefetching enabled, the request for the next batch is sent as soon
+  /// as a batch is returned by NextBatch(), so that the next batch is fetched
+  /// while the application is processing the current one. At most one batch
+  /// is prefetched, so this may double the memory used by the scanner.
+  /// Prefetching is disabled by default.
+  ///
+  /// @param [in] prefetching
+  ///   Whether to prefetch batches.
+  /// @return Operation result status.
+  Status SetPrefetching(bool prefetching);
+
   /// Set the replica selection policy while scanning.
   ///
   /// @param [in] selection
@@ -2063,6 +2198,14 @@ class KUDU_EXPORT KuduScanner {
   ///   data for further decoding. Using KuduScanBatch::Row() might yield incorrect/corrupt
   ///   results and might even cause the client to crash.
   static const uint64_t PAD_UNIXTIME_MICROS_TO_16_BYTES = 1 << 0;
+  /// Makes the server return the data of each batch in columnar layout,
+  /// avoiding transposing it into rows on the server and back into columns
+  /// on the client.
+  /// @note If this flag is enabled, the user _must_ use the columnar accessors
+  ///   of KuduScanBatch (e.g. KuduScanBatch::GetFixedLengthColumn()) to obtain
+  ///   the data. KuduScanBatch::Row() may not be used. This flag may not be
+  ///   combined with other flags.
+  static const uint64_t COLUMNAR_LAYOUT = 1 << 1;
   /// Optionally set row format modifier flags.
   ///
   /// If flags is RowFormatFlags::NO_FLAGS, then no modifications will be made to the row
@@ -2274,6 +2417,27 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Whether to include the table metadata (ID, schema and partition schema)
+  /// in the scan tokens. A scanner built from a token with the metadata does
+  /// not contact the master to open the table, but it doesn't notice if the
+  /// schema of the table was altered since the token was built either, and
+  /// the scan fails if the projected columns changed. Disabled by default.
+  ///
+  /// @param [in] include_metadata
+  ///   @c true to include the table metadata in the tokens.
+  /// @return Operation result status.
+  Status IncludeTableMetadata(bool include_metadata) WARN_UNUSED_RESULT;
+
+  /// Whether to include the replica locations of the tablet in the scan
+  /// tokens. A scanner built from a token with the locations does not
+  /// contact the master to locate the tablet, as long as the locations
+  /// haven't expired. Disabled by default.
+  ///
+  /// @param [in] include_metadata
+  ///   @c true to include the tablet locations in the tokens.
+  /// @return Operation result status.
+  Status IncludeTabletMetadata(bool include_metadata) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -2293,6 +2457,103 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   DISALLOW_COPY_AND_ASSIGN(KuduScanTokenBuilder);
 };
 
+/// @brief Scans the tablets of a table in parallel.
+///
+/// The scan is described by a KuduScanTokenBuilder: the parallel scanner
+/// builds the scan tokens and scans the tablets with a pool of threads,
+/// returning the batches of all tablets as a single stream, in no particular
+/// order.
+///
+/// Here is an example of how to use it:
+/// @code
+///   KuduScanTokenBuilder builder(table);
+///   builder.SetProjectedColumnNames({ "key", "value" });
+///   KuduParallelScanner scanner(&builder);
+///   scanner.SetMaxConcurrency(8);
+///   scanner.Open();
+///   KuduScanBatch batch;
+///   while (scanner.HasMoreRows()) {
+///     scanner.NextBatch(&batch);
+///     ... // Process the batch.
+///   }
+/// @endcode
+///
+/// @note This class is not thread-safe.
+class KUDU_EXPORT KuduParallelScanner {
+ public:
+  /// Construct an instance of the class.
+  ///
+  /// @param [in] builder
+  ///   The builder of the tokens for the scan. The builder must remain valid
+  ///   until Open() returns, and the table it scans for the lifetime of the
+  ///   parallel scanner.
+  explicit KuduParallelScanner(KuduScanTokenBuilder* builder);
+
+  /// Close the scanner, if it's open, and release its resources.
+  ~KuduParallelScanner();
+
+  /// Set the maximum number of tablets scanned at the same time.
+  ///
+  /// @param [in] max_concurrency
+  ///   The number of scanning threads. Must be greater than 0. Default is 4.
+  /// @return Operation result status.
+  Status SetMaxConcurrency(int max_concurrency) WARN_UNUSED_RESULT;
+
+  /// Set the maximum number of tablets scanned at the same time whose leader
+  /// replicas are hosted by the same tablet server.
+  ///
+  /// @param [in] max_concurrency
+  ///   The limit, or 0 for no limit other than SetMaxConcurrency().
+  ///   Default is 0.
+  /// @return Operation result status.
+  Status SetMaxConcurrencyPerServer(int max_concurrency) WARN_UNUSED_RESULT;
+
+  /// Set the maximum number of batches which have been received from the
+  /// tablet servers but not yet returned by NextBatch(). When reached, the
+  /// scanning threads wait for the application to catch up.
+  ///
+  /// @param [in] max_buffered_batches
+  ///   The limit. Must be greater than 0. Default is twice the maximum
+  ///   concurrency.
+  /// @return Operation result status.
+  Status SetMaxBufferedBatches(int max_buffered_batches) WARN_UNUSED_RESULT;
+
+  /// Begin scanning.
+  ///
+  /// @return Operation result status.
+  Status Open() WARN_UNUSED_RESULT;
+
+  /// Close the scanner, stopping the scanning threads.
+  ///
+  /// Closing the scanner releases resources on the servers. This call waits
+  /// for the RPCs that the scanning threads have in flight to complete.
+  void Close();
+
+  /// Check if there may be rows to be fetched from this scanner.
+  ///
+  /// @return @c true if there may be rows to be fetched from this scanner.
+  ///   As with KuduScanner, the next batch may turn out to be empty.
+  bool HasMoreRows() const;
+
+  /// Fetch the next batch of results from any of the tablets.
+  ///
+  /// Blocks until a batch is available or the scan is done.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result.
+  /// @return Operation result status. A failure to scan any of the tablets
+  ///   fails the whole scan.
+  Status NextBatch(KuduScanBatch* batch) WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduParallelScanner);
+};
+
 /// @brief Builder for Partitioner instances.
 class KUDU_EXPORT KuduPartitionerBuilder {
  public:
@@ -18,7 +18,9 @@
 #include "kudu/client/meta_cache.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <set>
@@ -27,6 +29,7 @@
 #include <utility>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/repeated_field.h> // IWYU pragma: keep
 
@@ -49,13 +52,43 @@
 #include "kudu/rpc/rpc.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 
+DEFINE_bool(client_use_unix_domain_sockets, false,
+            "Whether to connect to tablet servers on the local host through the "
+            "UNIX domain socket they advertise, if any, rather than over TCP.");
+TAG_FLAG(client_use_unix_domain_sockets, experimental);
+
+DEFINE_int32(client_scan_latency_half_life_ms, 30000,
+             "Half-life of the scan latency estimated for a tablet server "
+             "while it serves no scans. Lets the LOWEST_LATENCY replica "
+             "selection probe servers again once they may have recovered.");
+TAG_FLAG(client_scan_latency_half_life_ms, advanced);
+
+DEFINE_bool(client_lookup_tablets_from_master_followers, false,
+            "Whether to spread tablet location lookups across all the masters, "
+            "letting the follower masters serve them from their copy of the "
+            "catalog. A lookup falls back to the leader master if a follower "
+            "fails it or lags behind the catalog versions the client has seen. "
+            "Locations served by a follower may not reflect the most recent "
+            "DDL operations yet.");
+TAG_FLAG(client_lookup_tablets_from_master_followers, experimental);
+
+DEFINE_bool(client_prewarm_tserver_connections, false,
+            "Whether to connect to every tablet server as soon as it shows up in "
+            "the locations of a tablet, rather than when the first request is "
+            "sent to it. Negotiating the connections ahead of time takes that "
+            "cost off the latency of the first requests, at the expense of "
+            "connecting to replicas which may never be sent any request.");
+TAG_FLAG(client_prewarm_tserver_connections, experimental);
+
 using std::map;
 using std::set;
 using std::shared_ptr;
@@ -81,6 +114,9 @@ using rpc::CredentialsPolicy;
 using rpc::Messenger;
 using rpc::Rpc;
 using rpc::ErrorStatusPB;
+using rpc::RpcController;
+using tserver::PingRequestPB;
+using tserver::PingResponsePB;
 using tserver::TabletServerServiceProxy;
 
 namespace client {
@@ -88,7 +124,10 @@ namespace client {
 namespace internal {
 
 RemoteTabletServer::RemoteTabletServer(const master::TSInfoPB& pb)
-  : uuid_(pb.permanent_uuid()) {
+  : uuid_(pb.permanent_uuid()),
+    supports_multi_tablet_write_(true),
+    supports_multi_scanner_keep_alive_(true),
+    scan_latency_ewma_us_(0) {
 
   Update(pb);
 }
@@ -125,6 +164,7 @@ void RemoteTabletServer::DnsResolutionFinished(const HostPort& hp,
 
 void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb) {
   HostPort hp;
+  string unix_domain_socket_path;
   {
     std::unique_lock<simple_spinlock> l(lock_);
 
@@ -139,6 +179,25 @@ void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb)
     // TODO: if the TS advertises multiple host/ports, pick the right one
     // based on some kind of policy. For now just use the first always.
     hp = rpc_hostports_[0];
+    unix_domain_socket_path = unix_domain_socket_path_;
+  }
+
+  if (FLAGS_client_use_unix_domain_sockets && !unix_domain_socket_path.empty() &&
+      client->data_->IsTabletServerLocal(*this)) {
+    Sockaddr addr;
+    Status s = addr.ParseUnixDomainPath(unix_domain_socket_path);
+    if (s.ok()) {
+      {
+        std::lock_guard<simple_spinlock> l(lock_);
+        proxy_.reset(new TabletServerServiceProxy(client->data_->messenger_, addr, hp.host()));
+        proxy_->set_user_credentials(client->data_->user_credentials_);
+      }
+      cb.Run(Status::OK());
+      return;
+    }
+    KLOG_EVERY_N_SECS(WARNING, 60) << "TS " << uuid_ << " advertised an invalid UNIX "
+                                   << "domain socket, connecting to it over TCP: "
+                                   << s.ToString();
   }
 
   auto addrs = new vector<Sockaddr>();
@@ -147,6 +206,33 @@ void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb)
                     Unretained(this), hp, addrs, client, cb));
 }
 
+void RemoteTabletServer::PrewarmConnection(KuduClient* client) {
+  InitProxy(client, Bind(&RemoteTabletServer::PrewarmConnectionCb,
+                         Unretained(this), client));
+}
+
+void RemoteTabletServer::PrewarmConnectionCb(KuduClient* client, const Status& status) {
+  if (!status.ok()) {
+    VLOG(1) << "Unable to pre-warm the connection to TS " << uuid_ << ": "
+            << status.ToString();
+    return;
+  }
+  // The ping itself is of no interest: sending it just makes the messenger
+  // negotiate the connection which later requests to this server reuse.
+  struct PingState {
+    PingRequestPB req;
+    PingResponsePB resp;
+    RpcController controller;
+  };
+  auto state = std::make_shared<PingState>();
+  state->controller.set_timeout(client->default_rpc_timeout());
+  const string uuid = uuid_;
+  proxy()->PingAsync(state->req, &state->resp, &state->controller, [state, uuid]() {
+    VLOG(1) << "Pre-warmed the connection to TS " << uuid << ": "
+            << state->controller.status().ToString();
+  });
+}
+
 void RemoteTabletServer::Update(const master::TSInfoPB& pb) {
   CHECK_EQ(pb.permanent_uuid(), uuid_);
 
@@ -156,12 +242,86 @@ void RemoteTabletServer::Update(const master::TSInfoPB& pb) {
   for (const HostPortPB& hostport_pb : pb.rpc_addresses()) {
     rpc_hostports_.emplace_back(hostport_pb.host(), hostport_pb.port());
   }
+  unix_domain_socket_path_ = pb.unix_domain_socket_path();
+}
+
+void RemoteTabletServer::ToPB(TSInfoPB* pb) const {
+  pb->Clear();
+  pb->set_permanent_uuid(uuid_);
+  std::lock_guard<simple_spinlock> l(lock_);
+  for (const HostPort& hp : rpc_hostports_) {
+    HostPortPB* hostport_pb = pb->add_rpc_addresses();
+    hostport_pb->set_host(hp.host());
+    hostport_pb->set_port(hp.port());
+  }
+  if (!unix_domain_socket_path_.empty()) {
+    pb->set_unix_domain_socket_path(unix_domain_socket_path_);
+  }
 }
 
 const string& RemoteTabletServer::permanent_uuid() const {
   return uuid_;
 }
 
+bool RemoteTabletServer::supports_multi_tablet_write() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return supports_multi_tablet_write_;
+}
+
+void RemoteTabletServer::set_multi_tablet_write_unsupported() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  supports_multi_tablet_write_ = false;
+}
+
+bool RemoteTabletServer::supports_multi_scanner_keep_alive() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return supports_multi_scanner_keep_alive_;
+}
+
+void RemoteTabletServer::set_multi_scanner_keep_alive_unsupported() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  supports_multi_scanner_keep_alive_ = false;
+}
+
+namespace {
+// Weight of the latest sample in the scan latency of a tablet server.
+const double kScanLatencyEwmaWeight = 0.25;
+
+// Decays 'latency_us', last updated at 'update_time', by the time since then.
+double DecayScanLatency(double latency_us, const MonoTime& update_time, const MonoTime& now) {
+  if (!update_time.Initialized() || FLAGS_client_scan_latency_half_life_ms <= 0) {
+    return latency_us;
+  }
+  double half_lives = (now - update_time).ToMilliseconds() /
+                      static_cast<double>(FLAGS_client_scan_latency_half_life_ms);
+  return latency_us * std::pow(0.5, half_lives);
+}
+} // anonymous namespace
+
+void RemoteTabletServer::RecordScanLatency(const MonoDelta& latency,
+                                           const MonoDelta& queue_time) {
+  // Time queued on the server is counted twice: it is the part of the latency
+  // which grows with the load of the server, and the best predictor of how
+  // long the next RPC would wait.
+  const double sample_us = latency.ToMicroseconds() + queue_time.ToMicroseconds();
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (!scan_latency_update_time_.Initialized()) {
+    scan_latency_ewma_us_ = sample_us;
+  } else {
+    scan_latency_ewma_us_ =
+        kScanLatencyEwmaWeight * sample_us +
+        (1 - kScanLatencyEwmaWeight) *
+        DecayScanLatency(scan_latency_ewma_us_, scan_latency_update_time_, now);
+  }
+  scan_latency_update_time_ = now;
+}
+
+double RemoteTabletServer::EstimatedScanLatencyUs() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return DecayScanLatency(scan_latency_ewma_us_, scan_latency_update_time_, MonoTime::Now());
+}
+
 shared_ptr<TabletServerServiceProxy> RemoteTabletServer::proxy() const {
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK(proxy_);
@@ -516,7 +676,7 @@ MetaCache::~MetaCache() {
 }
 
 void MetaCache::UpdateTabletServer(const TSInfoPB& pb) {
-  DCHECK(lock_.is_write_locked());
+  DCHECK(lock_.is_locked());
   RemoteTabletServer* ts = FindPtrOrNull(ts_cache_, pb.permanent_uuid());
   if (ts) {
     ts->Update(pb);
@@ -524,7 +684,11 @@ void MetaCache::UpdateTabletServer(const TSInfoPB& pb) {
   }
 
   VLOG(1) << "Client caching new TabletServer " << pb.permanent_uuid();
-  InsertOrDie(&ts_cache_, pb.permanent_uuid(), new RemoteTabletServer(pb));
+  ts = new RemoteTabletServer(pb);
+  InsertOrDie(&ts_cache_, pb.permanent_uuid(), ts);
+  if (FLAGS_client_prewarm_tserver_connections) {
+    ts->PrewarmConnection(client_);
+  }
 }
 
 // A (table, partition_key) --> tablet lookup. May be in-flight to a master, or
@@ -562,6 +726,10 @@ class LookupRpc : public Rpc {
     return table_->client()->data_->master_proxy();
   }
 
+  // Retries the lookup against the leader master after a follower master
+  // could not serve it.
+  void RetryOnLeaderMaster();
+
   void ResetMasterLeaderAndRetry(CredentialsPolicy creds_policy);
 
   void NewLeaderMasterDeterminedCb(const Status& status);
@@ -609,6 +777,9 @@ class LookupRpc : public Rpc {
   // non-voter tablet replicas, if any, appear in the lookup result in addition
   // to 'regular' voter replicas.
   const ReplicaController::Visibility replica_visibility_;
+
+  // Whether the lookup may be served by a follower master.
+  bool allow_follower_;
 };
 
 LookupRpc::LookupRpc(scoped_refptr<MetaCache> meta_cache,
@@ -629,7 +800,9 @@ LookupRpc::LookupRpc(scoped_refptr<MetaCache> meta_cache,
       has_permit_(false),
       max_returned_locations_(max_returned_locations),
       is_exact_lookup_(is_exact_lookup),
-      replica_visibility_(replica_visibility) {
+      replica_visibility_(replica_visibility),
+      allow_follower_(FLAGS_client_lookup_tablets_from_master_followers &&
+                      table->client()->IsMultiMaster()) {
   DCHECK(deadline.Initialized());
 }
 
@@ -683,6 +856,19 @@ void LookupRpc::SendRpc() {
   if (replica_visibility_ == ReplicaController::Visibility::ALL) {
     req_.set_replica_type_filter(master::ANY_REPLICA);
   }
+  // A follower may serve the lookup only if its copy of the catalog is at
+  // least as recent as the locations this client has already seen.
+  shared_ptr<MasterServiceProxy> proxy;
+  if (allow_follower_) {
+    proxy = table_->client()->data_->lookup_master_proxy();
+    req_.set_allow_follower(true);
+    req_.set_min_catalog_version(
+        table_->client()->data_->GetLatestObservedCatalogVersion());
+  } else {
+    proxy = master_proxy();
+    req_.clear_allow_follower();
+    req_.clear_min_catalog_version();
+  }
 
   // The end partition key is left unset intentionally so that we'll prefetch
   // some additional tablets.
@@ -697,9 +883,9 @@ void LookupRpc::SendRpc() {
   mutable_retrier()->mutable_controller()->set_deadline(
       std::min(rpc_deadline, retrier().deadline()));
 
-  master_proxy()->GetTableLocationsAsync(req_, &resp_,
-                                         mutable_retrier()->mutable_controller(),
-                                         boost::bind(&LookupRpc::SendRpcCb, this, Status::OK()));
+  proxy->GetTableLocationsAsync(req_, &resp_,
+                                mutable_retrier()->mutable_controller(),
+                                boost::bind(&LookupRpc::SendRpcCb, this, Status::OK()));
 }
 
 string LookupRpc::ToString() const {
@@ -719,6 +905,13 @@ void LookupRpc::ResetMasterLeaderAndRetry(CredentialsPolicy creds_policy) {
       creds_policy);
 }
 
+void LookupRpc::RetryOnLeaderMaster() {
+  allow_follower_ = false;
+  resp_.Clear();
+  mutable_retrier()->mutable_controller()->Reset();
+  SendRpc();
+}
+
 void LookupRpc::NewLeaderMasterDeterminedCb(const Status& status) {
   if (status.ok()) {
     mutable_retrier()->mutable_controller()->Reset();
@@ -744,6 +937,18 @@ void LookupRpc::SendRpcCb(const Status& status) {
     return;
   }
 
+  // A follower master, or the leader master it was taken for, could not
+  // serve the lookup: leave it to the leader master, unless the operation
+  // deadline has already expired.
+  if (allow_follower_ && (!new_status.ok() || resp_.has_error()) &&
+      MonoTime::Now() < retrier().deadline()) {
+    VLOG(1) << ToString() << ": retrying on the leader master after "
+            << (new_status.ok() ? StatusFromPB(resp_.error().status()) : new_status).ToString();
+    RetryOnLeaderMaster();
+    ignore_result(delete_me.release());
+    return;
+  }
+
   // Check for specific application response errors.
   if (new_status.ok() && resp_.has_error()) {
     if (resp_.error().code() == master::MasterErrorPB::NOT_THE_LEADER ||
@@ -805,6 +1010,9 @@ void LookupRpc::SendRpcCb(const Status& status) {
   }
 
   if (new_status.ok()) {
+    if (resp_.has_catalog_version()) {
+      table_->client()->data_->UpdateLatestObservedCatalogVersion(resp_.catalog_version());
+    }
     MetaCacheEntry entry;
     new_status = meta_cache_->ProcessLookupResponse(*this, &entry, max_returned_locations_);
     if (entry.is_non_covered_range()) {
@@ -820,6 +1028,79 @@ void LookupRpc::SendRpcCb(const Status& status) {
   user_cb_.Run(new_status);
 }
 
+void MetaCache::ProcessTabletLocationsUnlocked(const KuduTable* table,
+                                               const TabletLocationsPB& tablet,
+                                               const MonoTime& expiration_time,
+                                               TabletMap* tablets_by_key) {
+  DCHECK(lock_.is_locked());
+  const auto& tablet_lower_bound = tablet.partition().partition_key_start();
+  const auto& tablet_upper_bound = tablet.partition().partition_key_end();
+
+  // If we already know about the tablet, then we only need to refresh it's
+  // replica locations and the entry TTL. If the tablet is unknown, then we
+  // need to create a new RemoteTablet for it.
+
+  // First, update the tserver cache, needed for the Refresh calls below.
+  for (const TabletLocationsPB_ReplicaPB& replicas : tablet.replicas()) {
+    UpdateTabletServer(replicas.ts_info());
+  }
+
+  string tablet_id = tablet.tablet_id();
+  scoped_refptr<RemoteTablet> remote = FindPtrOrNull(tablets_by_id_, tablet_id);
+  if (remote.get() != nullptr) {
+    // Partition should not have changed.
+    DCHECK_EQ(tablet_lower_bound, remote->partition().partition_key_start());
+    DCHECK_EQ(tablet_upper_bound, remote->partition().partition_key_end());
+
+    VLOG(3) << "Refreshing tablet " << tablet_id << ": "
+            << pb_util::SecureShortDebugString(tablet);
+    remote->Refresh(ts_cache_, tablet.replicas());
+
+    // Update the entry TTL, or recreate the entry if it was evicted while
+    // the tablet was still known by its ID.
+    MetaCacheEntry* entry = FindOrNull(*tablets_by_key, tablet_lower_bound);
+    if (entry && !entry->is_non_covered_range() &&
+        entry->upper_bound_partition_key() == tablet_upper_bound) {
+      entry->refresh_expiration_time(expiration_time);
+      return;
+    }
+  } else {
+    Partition partition;
+    Partition::FromPB(tablet.partition(), &partition);
+    remote = new RemoteTablet(tablet_id, partition);
+    remote->Refresh(ts_cache_, tablet.replicas());
+    InsertOrDie(&tablets_by_id_, tablet_id, remote);
+  }
+
+  // Clear any existing entries which overlap with the discovered tablet.
+  tablets_by_key->erase(tablets_by_key->lower_bound(tablet_lower_bound),
+                        tablet_upper_bound.empty() ? tablets_by_key->end() :
+                          tablets_by_key->lower_bound(tablet_upper_bound));
+
+  MetaCacheEntry entry(expiration_time, remote);
+  VLOG(3) << "Caching '" << table->name() << "' entry " << entry.DebugString(table);
+  InsertOrDie(tablets_by_key, tablet_lower_bound, entry);
+}
+
+void MetaCache::AddTabletLocations(const KuduTable* table,
+                                   const TabletLocationsPB& tablet,
+                                   const MonoTime& expiration_time) {
+  std::lock_guard<percpu_rwlock> l(lock_);
+  TabletMap& tablets_by_key = LookupOrInsert(&tablets_by_table_and_key_,
+                                             table->id(), TabletMap());
+  ProcessTabletLocationsUnlocked(table, tablet, expiration_time, &tablets_by_key);
+}
+
+MonoTime MetaCache::GetTabletExpirationTime(const KuduTable* table,
+                                            const string& partition_key) {
+  MetaCacheEntry entry;
+  if (!LookupTabletByKeyFastPath(table, partition_key, &entry) ||
+      entry.is_non_covered_range()) {
+    return MonoTime();
+  }
+  return entry.expiration_time();
+}
+
 Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
                                         MetaCacheEntry* cache_entry,
                                         int max_returned_locations) {
@@ -829,7 +1110,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
   MonoTime expiration_time = MonoTime::Now() +
       MonoDelta::FromMilliseconds(rpc.resp().ttl_millis());
 
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   TabletMap& tablets_by_key = LookupOrInsert(&tablets_by_table_and_key_,
                                              rpc.table_id(), TabletMap());
 
@@ -897,50 +1178,8 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
       }
       last_upper_bound = tablet_upper_bound;
 
-      // Now process the tablet itself (such as B, D, or E). If we already know
-      // about the tablet, then we only need to refresh it's replica locations
-      // and the entry TTL. If the tablet is unknown, then we need to create a
-      // new RemoteTablet for it.
-
-      // First, update the tserver cache, needed for the Refresh calls below.
-      for (const TabletLocationsPB_ReplicaPB& replicas : tablet.replicas()) {
-        UpdateTabletServer(replicas.ts_info());
-      }
-
-      string tablet_id = tablet.tablet_id();
-      scoped_refptr<RemoteTablet> remote = FindPtrOrNull(tablets_by_id_, tablet_id);
-      if (remote.get() != nullptr) {
-        // Partition should not have changed.
-        DCHECK_EQ(tablet_lower_bound, remote->partition().partition_key_start());
-        DCHECK_EQ(tablet_upper_bound, remote->partition().partition_key_end());
-
-        VLOG(3) << "Refreshing tablet " << tablet_id << ": "
-                << pb_util::SecureShortDebugString(tablet);
-        remote->Refresh(ts_cache_, tablet.replicas());
-
-        // Update the entry TTL.
-        auto& entry = FindOrDie(tablets_by_key, tablet_lower_bound);
-        DCHECK(!entry.is_non_covered_range() &&
-               entry.upper_bound_partition_key() == tablet_upper_bound);
-        entry.refresh_expiration_time(expiration_time);
-        continue;
-      }
-
-      // Clear any existing entries which overlap with the discovered tablet.
-      tablets_by_key.erase(tablets_by_key.lower_bound(tablet_lower_bound),
-                           tablet_upper_bound.empty() ? tablets_by_key.end() :
-                             tablets_by_key.lower_bound(tablet_upper_bound));
-
-      Partition partition;
-      Partition::FromPB(tablet.partition(), &partition);
-      remote = new RemoteTablet(tablet_id, partition);
-      remote->Refresh(ts_cache_, tablet.replicas());
-
-      MetaCacheEntry entry(expiration_time, remote);
-      VLOG(3) << "Caching '" << rpc.table_name() << "' entry " << entry.DebugString(rpc.table());
-
-      InsertOrDie(&tablets_by_id_, tablet_id, remote);
-      InsertOrDie(&tablets_by_key, tablet_lower_bound, entry);
+      // Now process the tablet itself (such as B, D, or E).
+      ProcessTabletLocationsUnlocked(rpc.table(), tablet, expiration_time, &tablets_by_key);
     }
 
     if (!last_upper_bound.empty() && tablet_locations.size() < max_returned_locations) {
@@ -970,7 +1209,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
 bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
                                           const string& partition_key,
                                           MetaCacheEntry* entry) {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
   if (PREDICT_FALSE(!tablets)) {
     // No cache available for this table.
@@ -998,7 +1237,7 @@ bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
 
 void MetaCache::ClearNonCoveredRangeEntries(const std::string& table_id) {
   VLOG(3) << "Clearing non-covered range entries of table " << table_id;
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
 
   TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table_id);
   if (PREDICT_FALSE(!tablets)) {
@@ -1017,7 +1256,7 @@ void MetaCache::ClearNonCoveredRangeEntries(const std::string& table_id) {
 
 void MetaCache::ClearCache() {
   VLOG(3) << "Clearing cache";
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   STLDeleteValues(&ts_cache_);
   tablets_by_id_.clear();
   tablets_by_table_and_key_.clear();
@@ -1040,6 +1279,19 @@ void MetaCache::LookupTabletByKey(const KuduTable* table,
   rpc->SendRpc();
 }
 
+bool MetaCache::LookupCachedTabletByKey(const KuduTable* table,
+                                        const string& partition_key,
+                                        scoped_refptr<RemoteTablet>* remote_tablet) {
+  MetaCacheEntry entry;
+  if (!LookupTabletByKeyFastPath(table, partition_key, &entry) ||
+      entry.is_non_covered_range() ||
+      !entry.tablet()->HasLeader()) {
+    return false;
+  }
+  *remote_tablet = entry.tablet();
+  return true;
+}
+
 void MetaCache::LookupTabletByKeyOrNext(const KuduTable* table,
                                         string partition_key,
                                         const MonoTime& deadline,
@@ -1061,7 +1313,7 @@ void MetaCache::LookupTabletByKeyOrNext(const KuduTable* table,
 void MetaCache::MarkTSFailed(RemoteTabletServer* ts,
                              const Status& status) {
   LOG(INFO) << "Marking tablet server " << ts->ToString() << " as failed.";
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   Status ts_status = status.CloneAndPrepend("TS failed");
 
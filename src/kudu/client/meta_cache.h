@@ -52,6 +52,7 @@ class TabletServerServiceProxy;
 } // namespace tserver
 
 namespace master {
+class TabletLocationsPB;
 class TabletLocationsPB_ReplicaPB;
 class TSInfoPB;
 } // namespace master
@@ -90,6 +91,11 @@ class RemoteTabletServer {
   // If there is an active proxy, does nothing.
   void InitProxy(KuduClient* client, const StatusCallback& cb);
 
+  // Initializes the RPC proxy to this tablet server and pings it in the
+  // background, so that the connection to it is negotiated before the first
+  // request needs it. Failures are only logged.
+  void PrewarmConnection(KuduClient* client);
+
   // Update information from the given pb.
   // Requires that 'pb''s UUID matches this server.
   void Update(const master::TSInfoPB& pb);
@@ -102,9 +108,29 @@ class RemoteTabletServer {
 
   void GetHostPorts(std::vector<HostPort>* host_ports) const;
 
+  // Fills 'pb' with the information Update() takes from it.
+  void ToPB(master::TSInfoPB* pb) const;
+
   // Returns the remote server's uuid.
   const std::string& permanent_uuid() const;
 
+  // Whether the server may be sent MultiTabletWrite RPCs. Assumed until it
+  // responds that it doesn't know the method.
+  bool supports_multi_tablet_write() const;
+  void set_multi_tablet_write_unsupported();
+
+  // Likewise, whether the server may be sent MultiScannerKeepAlive RPCs.
+  bool supports_multi_scanner_keep_alive() const;
+  void set_multi_scanner_keep_alive_unsupported();
+
+  // Feeds the latency of a scan RPC served by this server, and the part of it
+  // the RPC spent queued on the server, into the latency estimate of the server.
+  void RecordScanLatency(const MonoDelta& latency, const MonoDelta& queue_time);
+
+  // Returns the estimated latency of the next scan RPC served by this server,
+  // in microseconds, or 0 if it hasn't served scans recently.
+  double EstimatedScanLatencyUs() const;
+
  private:
   // Internal callback for DNS resolution.
   void DnsResolutionFinished(const HostPort& hp,
@@ -113,11 +139,23 @@ class RemoteTabletServer {
                              const StatusCallback& user_callback,
                              const Status &result_status);
 
+  // Internal callback for PrewarmConnection().
+  void PrewarmConnectionCb(KuduClient* client, const Status& status);
+
   mutable simple_spinlock lock_;
   const std::string uuid_;
 
   std::vector<HostPort> rpc_hostports_;
+  // If not empty, the UNIX domain socket the server accepts connections on.
+  std::string unix_domain_socket_path_;
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
+  bool supports_multi_tablet_write_;
+  bool supports_multi_scanner_keep_alive_;
+
+  // Exponentially weighted moving average of the scan latency of the server,
+  // and the time of its last update.
+  double scan_latency_ewma_us_;
+  MonoTime scan_latency_update_time_;
 
   DISALLOW_COPY_AND_ASSIGN(RemoteTabletServer);
 };
@@ -322,6 +360,10 @@ class MetaCacheEntry {
     }
   }
 
+  MonoTime expiration_time() const {
+    return expiration_time_;
+  }
+
   void refresh_expiration_time(MonoTime expiration_time) {
     DCHECK(Initialized());
     DCHECK(expiration_time.Initialized());
@@ -388,6 +430,14 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                          scoped_refptr<RemoteTablet>* remote_tablet,
                          const StatusCallback& callback);
 
+  // Look up which tablet hosts the given partition key for a table, only
+  // consulting the cache. Returns true and sets 'remote_tablet' if a fresh
+  // entry for a tablet with a non-failed LEADER is cached; otherwise the
+  // caller should fall back to LookupTabletByKey().
+  bool LookupCachedTabletByKey(const KuduTable* table,
+                               const std::string& partition_key,
+                               scoped_refptr<RemoteTablet>* remote_tablet);
+
   // Look up which tablet hosts the given partition key, or the next tablet if
   // the key falls in a non-covered range partition.
   void LookupTabletByKeyOrNext(const KuduTable* table,
@@ -397,6 +447,18 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                                const StatusCallback& callback,
                                int max_returned_locations = kFetchTabletsPerPointLookup);
 
+  // Caches the given locations of a tablet of a table, obtained out of band,
+  // e.g. from a scan token, until 'expiration_time'.
+  void AddTabletLocations(const KuduTable* table,
+                          const master::TabletLocationsPB& tablet,
+                          const MonoTime& expiration_time);
+
+  // Returns the time at which the cached locations of the tablet hosting the
+  // given partition key of a table expire, or an uninitialized MonoTime if
+  // they aren't cached.
+  MonoTime GetTabletExpirationTime(const KuduTable* table,
+                                   const std::string& partition_key);
+
   // Clears the non-covered range entries from a table's meta cache.
   void ClearNonCoveredRangeEntries(const std::string& table_id);
 
@@ -419,6 +481,7 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
 
   FRIEND_TEST(client::ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(client::ClientTest, TestMetaCacheExpiry);
+  FRIEND_TEST(client::ClientTest, TestMetaCacheLookupPerf);
 
   // Called on the slow LookupTablet path when the master responds. Populates
   // the tablet caches and returns a reference to the first one.
@@ -442,7 +505,11 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
 
   KuduClient* client_;
 
-  rw_spinlock lock_;
+  // Lookups of cached tablets take this lock in shared mode on every write
+  // and scan of a busy client, so readers on different CPUs take different
+  // locks, and don't contend on a single cache line. Updates are rare, and
+  // take all of the locks.
+  percpu_rwlock lock_;
 
   // Cache of Tablet Server locations: TS UUID -> RemoteTabletServer*.
   //
@@ -458,6 +525,15 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // Protected by lock_.
   typedef std::map<std::string, MetaCacheEntry> TabletMap;
 
+  // Caches the given locations of a tablet in 'tablets_by_key', the cache of
+  // its table, replacing any overlapping entries.
+  //
+  // NOTE: Must be called with lock_ held.
+  void ProcessTabletLocationsUnlocked(const KuduTable* table,
+                                      const master::TabletLocationsPB& tablet,
+                                      const MonoTime& expiration_time,
+                                      TabletMap* tablets_by_key);
+
   // Cache of tablets and non-covered ranges, keyed by table id.
   //
   // Protected by lock_.
@@ -0,0 +1,212 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/parallel_scanner-internal.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+
+KuduParallelScanner::Data::Data(KuduScanTokenBuilder* builder)
+    : builder_(DCHECK_NOTNULL(builder)),
+      max_concurrency_(4),
+      max_concurrency_per_server_(0),
+      max_buffered_batches_(0),
+      open_(false),
+      cond_(&lock_),
+      num_running_threads_(0),
+      status_returned_(false),
+      closing_(false) {
+}
+
+KuduParallelScanner::Data::~Data() {
+  Close();
+}
+
+Status KuduParallelScanner::Data::Open() {
+  CHECK(!open_ && scans_.empty()) << "Scanner already opened";
+
+  vector<KuduScanToken*> tokens;
+  RETURN_NOT_OK(builder_->Build(&tokens));
+  for (KuduScanToken* token : tokens) {
+    unique_ptr<TabletScan> scan(new TabletScan);
+    scan->token.reset(token);
+    scans_.emplace_back(std::move(scan));
+  }
+  for (const auto& scan : scans_) {
+    const vector<const KuduReplica*>& replicas = scan->token->tablet().replicas();
+    for (const KuduReplica* replica : replicas) {
+      if (replica->is_leader()) {
+        scan->server_uuid = replica->ts().uuid();
+        break;
+      }
+    }
+    if (scan->server_uuid.empty() && !replicas.empty()) {
+      scan->server_uuid = replicas[0]->ts().uuid();
+    }
+    pending_.push_back(scan.get());
+  }
+
+  const int num_threads = std::min<int>(max_concurrency_, scans_.size());
+  num_running_threads_ = num_threads;
+  open_ = true;
+  for (int i = 0; i < num_threads; i++) {
+    scoped_refptr<Thread> thread;
+    Status s = Thread::Create("client", Substitute("parallel-scan-$0", i),
+                              &KuduParallelScanner::Data::ScanThread, this, &thread);
+    if (!s.ok()) {
+      {
+        MutexLock l(lock_);
+        num_running_threads_ -= num_threads - i;
+      }
+      Close();
+      return s;
+    }
+    threads_.emplace_back(std::move(thread));
+  }
+  return Status::OK();
+}
+
+void KuduParallelScanner::Data::Close() {
+  if (!open_) {
+    return;
+  }
+  {
+    MutexLock l(lock_);
+    closing_ = true;
+    cond_.Broadcast();
+  }
+  for (const auto& thread : threads_) {
+    thread->Join();
+  }
+  threads_.clear();
+  batches_.clear();
+  open_ = false;
+}
+
+bool KuduParallelScanner::Data::HasMoreRows() const {
+  CHECK(open_);
+  MutexLock l(lock_);
+  if (!status_.ok()) {
+    return !status_returned_;
+  }
+  return !batches_.empty() || num_running_threads_ > 0;
+}
+
+Status KuduParallelScanner::Data::NextBatch(unique_ptr<KuduScanBatch>* batch) {
+  CHECK(open_);
+  MutexLock l(lock_);
+  while (batches_.empty() && status_.ok() && num_running_threads_ > 0) {
+    cond_.Wait();
+  }
+  if (!status_.ok()) {
+    status_returned_ = true;
+    return status_;
+  }
+  if (batches_.empty()) {
+    batch->reset();
+    return Status::OK();
+  }
+  *batch = std::move(batches_.front());
+  batches_.pop_front();
+  cond_.Broadcast();
+  return Status::OK();
+}
+
+void KuduParallelScanner::Data::ScanThread() {
+  while (TabletScan* scan = NextTabletScan()) {
+    Status s = ScanTablet(scan);
+    if (scan->scanner) {
+      // Release the server-side scanner if the scan was cut short.
+      scan->scanner->Close();
+    }
+    MutexLock l(lock_);
+    int* num_scans = FindOrNull(scans_by_server_, scan->server_uuid);
+    DCHECK(num_scans);
+    if (--*num_scans == 0) {
+      scans_by_server_.erase(scan->server_uuid);
+    }
+    if (!s.ok() && status_.ok()) {
+      status_ = s.CloneAndPrepend(Substitute("scan of tablet $0 failed",
+                                             scan->token->tablet().id()));
+    }
+    cond_.Broadcast();
+  }
+  MutexLock l(lock_);
+  num_running_threads_--;
+  cond_.Broadcast();
+}
+
+KuduParallelScanner::Data::TabletScan* KuduParallelScanner::Data::NextTabletScan() {
+  MutexLock l(lock_);
+  while (!closing_ && status_.ok() && !pending_.empty()) {
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+      TabletScan* scan = *it;
+      int& num_scans = scans_by_server_[scan->server_uuid];
+      if (max_concurrency_per_server_ == 0 || num_scans < max_concurrency_per_server_) {
+        num_scans++;
+        pending_.erase(it);
+        return scan;
+      }
+    }
+    cond_.Wait();
+  }
+  return nullptr;
+}
+
+Status KuduParallelScanner::Data::ScanTablet(TabletScan* scan) {
+  KuduScanner* scanner;
+  RETURN_NOT_OK(scan->token->IntoKuduScanner(&scanner));
+  scan->scanner.reset(scanner);
+  RETURN_NOT_OK(scanner->Open());
+
+  const size_t max_buffered_batches = max_buffered_batches_ > 0 ?
+      max_buffered_batches_ : 2 * max_concurrency_;
+  while (scanner->HasMoreRows()) {
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch);
+    RETURN_NOT_OK(scanner->NextBatch(batch.get()));
+    if (batch->NumRows() == 0) {
+      continue;
+    }
+    MutexLock l(lock_);
+    while (!closing_ && status_.ok() && batches_.size() >= max_buffered_batches) {
+      cond_.Wait();
+    }
+    if (closing_ || !status_.ok()) {
+      return Status::OK();
+    }
+    batches_.emplace_back(std::move(batch));
+    cond_.Broadcast();
+  }
+  return Status::OK();
+}
+
+} // namespace client
+} // namespace kudu
@@ -0,0 +1,126 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace client {
+
+// Scans the tablets of a table with a pool of threads. Each thread scans one
+// tablet at a time to completion, queuing its batches for NextBatch().
+//
+// Batches refer to the projection of the scanner they came from, so the
+// scanners of all tablets are kept until this object is destroyed.
+class KuduParallelScanner::Data {
+ public:
+  explicit Data(KuduScanTokenBuilder* builder);
+  ~Data();
+
+  // Builds the scan tokens and starts the scanning threads.
+  Status Open();
+
+  // Stops the scanning threads and drops the queued batches.
+  void Close();
+
+  bool HasMoreRows() const;
+
+  // Waits for the next batch, setting 'batch' to it. 'batch' is reset if all
+  // tablets were scanned without yielding another batch.
+  Status NextBatch(std::unique_ptr<KuduScanBatch>* batch);
+
+  KuduScanTokenBuilder* const builder_;
+
+  int max_concurrency_;
+  int max_concurrency_per_server_;
+
+  // If 0, twice 'max_concurrency_'.
+  int max_buffered_batches_;
+
+  bool open_;
+
+ private:
+  struct TabletScan {
+    std::unique_ptr<KuduScanToken> token;
+
+    // The UUID of the server that the scan is attributed to when enforcing
+    // 'max_concurrency_per_server_': that of the tablet's leader, if known.
+    std::string server_uuid;
+
+    // Set when the scan starts.
+    std::unique_ptr<KuduScanner> scanner;
+  };
+
+  // Scans tablets until none are left, the scan fails, or the scanner is
+  // closed.
+  void ScanThread();
+
+  // Returns the next tablet to scan, waiting for one whose server is below its
+  // concurrency limit. Returns null if the thread should exit.
+  TabletScan* NextTabletScan();
+
+  // Scans 'scan' to completion, queuing its batches.
+  Status ScanTablet(TabletScan* scan);
+
+  std::vector<std::unique_ptr<TabletScan>> scans_;
+  std::vector<scoped_refptr<Thread>> threads_;
+
+  // Protects the members below. 'cond_' is broadcast whenever any of them
+  // changes.
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // The tablets left to scan, in token order.
+  std::list<TabletScan*> pending_;
+
+  // The number of tablets being scanned, by server UUID.
+  std::unordered_map<std::string, int> scans_by_server_;
+
+  // The batches waiting to be returned by NextBatch().
+  std::deque<std::unique_ptr<KuduScanBatch>> batches_;
+
+  int num_running_threads_;
+
+  // The first error encountered by any of the threads, and whether it was
+  // returned by NextBatch(), which ends the scan.
+  Status status_;
+  bool status_returned_;
+
+  bool closing_;
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
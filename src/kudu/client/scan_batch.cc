@@ -18,6 +18,7 @@
 #include "kudu/client/scan_batch.h"
 
 #include <cstring>
+#include <limits>
 #include <string>
 
 #include <glog/logging.h>
@@ -69,6 +70,211 @@ Slice KuduScanBatch::indirect_data() const {
   return data_->indirect_data_;
 }
 
+Status KuduScanBatch::GetFixedLengthColumn(int idx, Slice* data) const {
+  const Data::ColumnarColumn* col;
+  RETURN_NOT_OK(data_->GetColumnarColumn(idx, &col));
+  if (PREDICT_FALSE(data_->projection_->column(idx).type_info()->physical_type() == BINARY)) {
+    return Status::InvalidArgument("column is of variable-length type",
+                                   data_->projection_->column(idx).name());
+  }
+  *data = col->data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const {
+  const Data::ColumnarColumn* col;
+  RETURN_NOT_OK(data_->GetColumnarColumn(idx, &col));
+  if (PREDICT_FALSE(data_->projection_->column(idx).type_info()->physical_type() != BINARY)) {
+    return Status::InvalidArgument("column is of fixed-length type",
+                                   data_->projection_->column(idx).name());
+  }
+  *offsets = col->data;
+  *data = col->varlen_data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetNonNullBitmapForColumn(int idx, Slice* data) const {
+  const Data::ColumnarColumn* col;
+  RETURN_NOT_OK(data_->GetColumnarColumn(idx, &col));
+  *data = col->non_null_bitmap;
+  return Status::OK();
+}
+
+namespace {
+
+// Copies the 'Size'-byte cells at 'offset' of the 'num_rows' rows of
+// 'row_size' bytes at 'rows' into the contiguous array 'dst'. The fixed
+// size lets the compiler turn each copy into a single load and store.
+template<size_t Size>
+void GatherCells(const uint8_t* rows, size_t row_size, size_t offset, int num_rows,
+                 uint8_t* dst) {
+  const uint8_t* src = rows + offset;
+  for (int i = 0; i < num_rows; i++, src += row_size, dst += Size) {
+    memcpy(dst, src, Size);
+  }
+}
+
+void GatherCells(size_t size, const uint8_t* rows, size_t row_size, size_t offset,
+                 int num_rows, uint8_t* dst) {
+  switch (size) {
+    case 1: GatherCells<1>(rows, row_size, offset, num_rows, dst); break;
+    case 2: GatherCells<2>(rows, row_size, offset, num_rows, dst); break;
+    case 4: GatherCells<4>(rows, row_size, offset, num_rows, dst); break;
+    case 8: GatherCells<8>(rows, row_size, offset, num_rows, dst); break;
+    case 16: GatherCells<16>(rows, row_size, offset, num_rows, dst); break;
+    default: {
+      const uint8_t* src = rows + offset;
+      for (int i = 0; i < num_rows; i++, src += row_size, dst += size) {
+        memcpy(dst, src, size);
+      }
+      break;
+    }
+  }
+}
+
+} // anonymous namespace
+
+Status KuduScanBatch::Data::CheckColumnForCopy(int idx, bool variable_length) const {
+  if (PREDICT_FALSE(idx < 0 || idx >= projection_->num_columns())) {
+    return Status::InvalidArgument(Substitute("invalid column index: $0", idx));
+  }
+  const ColumnSchema& col = projection_->column(idx);
+  const bool is_binary = col.type_info()->physical_type() == BINARY;
+  if (PREDICT_FALSE(is_binary != variable_length)) {
+    return Status::InvalidArgument(
+        is_binary ? "column is of variable-length type" : "column is of fixed-length type",
+        col.name());
+  }
+  if (PREDICT_FALSE((row_format_flags_ & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) &&
+                    !(row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT))) {
+    return Status::IllegalState("padded row data must be accessed through direct_data()");
+  }
+  return Status::OK();
+}
+
+void KuduScanBatch::Data::CopyRowwiseNonNullBitmap(int idx, uint8_t* non_null_bitmap) const {
+  const int n_rows = num_rows();
+  if (!projection_->column(idx).is_nullable()) {
+    BitmapChangeBits(non_null_bitmap, 0, n_rows, true);
+    return;
+  }
+  const uint8_t* row_nulls = direct_data_.data() + projection_->byte_size();
+  for (int i = 0; i < n_rows; i++, row_nulls += projected_row_size_) {
+    BitmapChange(non_null_bitmap, i, !BitmapTest(row_nulls, idx));
+  }
+}
+
+Status KuduScanBatch::CopyFixedLengthColumn(int idx, void* values, size_t values_size,
+                                            uint8_t* non_null_bitmap) const {
+  RETURN_NOT_OK(data_->CheckColumnForCopy(idx, false));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  const size_t cell_size = col.type_info()->size();
+  const int n_rows = data_->num_rows();
+  if (PREDICT_FALSE(values_size < n_rows * cell_size)) {
+    return Status::InvalidArgument(Substitute(
+        "buffer of $0 bytes too small for $1 cells of $2 bytes", values_size, n_rows, cell_size));
+  }
+  if (n_rows == 0) {
+    return Status::OK();
+  }
+  uint8_t* dst = static_cast<uint8_t*>(values);
+
+  if (data_->row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT) {
+    const Data::ColumnarColumn* c;
+    RETURN_NOT_OK(data_->GetColumnarColumn(idx, &c));
+    memcpy(dst, c->data.data(), n_rows * cell_size);
+    if (non_null_bitmap) {
+      if (col.is_nullable()) {
+        memcpy(non_null_bitmap, c->non_null_bitmap.data(), BitmapSize(n_rows));
+      } else {
+        BitmapChangeBits(non_null_bitmap, 0, n_rows, true);
+      }
+    }
+    return Status::OK();
+  }
+
+  const uint8_t* rows = data_->direct_data_.data();
+  const size_t row_size = data_->projected_row_size_;
+  GatherCells(cell_size, rows, row_size, data_->projection_->column_offset(idx), n_rows, dst);
+  if (col.is_nullable()) {
+    // Zero the cells of NULL values, as in the columnar layout.
+    const uint8_t* row_nulls = rows + data_->projection_->byte_size();
+    for (int i = 0; i < n_rows; i++, row_nulls += row_size) {
+      if (BitmapTest(row_nulls, idx)) {
+        memset(dst + i * cell_size, 0, cell_size);
+      }
+    }
+  }
+  if (non_null_bitmap) {
+    data_->CopyRowwiseNonNullBitmap(idx, non_null_bitmap);
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::CopyVariableLengthColumn(int idx, uint32_t* offsets, size_t offsets_size,
+                                               string* data, uint8_t* non_null_bitmap) const {
+  RETURN_NOT_OK(data_->CheckColumnForCopy(idx, true));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  const int n_rows = data_->num_rows();
+  if (PREDICT_FALSE(offsets_size < (n_rows + 1) * sizeof(uint32_t))) {
+    return Status::InvalidArgument(Substitute(
+        "buffer of $0 bytes too small for $1 offsets", offsets_size, n_rows + 1));
+  }
+  data->clear();
+  offsets[0] = 0;
+  if (n_rows == 0) {
+    return Status::OK();
+  }
+
+  if (data_->row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT) {
+    const Data::ColumnarColumn* c;
+    RETURN_NOT_OK(data_->GetColumnarColumn(idx, &c));
+    memcpy(offsets, c->data.data(), (n_rows + 1) * sizeof(uint32_t));
+    data->assign(reinterpret_cast<const char*>(c->varlen_data.data()), c->varlen_data.size());
+    if (non_null_bitmap) {
+      if (col.is_nullable()) {
+        memcpy(non_null_bitmap, c->non_null_bitmap.data(), BitmapSize(n_rows));
+      } else {
+        BitmapChangeBits(non_null_bitmap, 0, n_rows, true);
+      }
+    }
+    return Status::OK();
+  }
+
+  // Size the output up front, so the values are copied without reallocation.
+  const uint8_t* rows = data_->direct_data_.data();
+  const size_t row_size = data_->projected_row_size_;
+  const size_t col_offset = data_->projection_->column_offset(idx);
+  const uint8_t* row_nulls = rows + data_->projection_->byte_size();
+  const bool nullable = col.is_nullable();
+  size_t total_size = 0;
+  for (int i = 0; i < n_rows; i++) {
+    const uint8_t* row = rows + i * row_size;
+    if (nullable && BitmapTest(row_nulls + i * row_size, idx)) {
+      offsets[i + 1] = total_size;
+      continue;
+    }
+    total_size += reinterpret_cast<const Slice*>(row + col_offset)->size();
+    offsets[i + 1] = total_size;
+  }
+  if (PREDICT_FALSE(total_size > std::numeric_limits<uint32_t>::max())) {
+    return Status::InvalidArgument("column data too large for 32-bit offsets", col.name());
+  }
+  data->resize(total_size);
+  char* dst = total_size > 0 ? &(*data)[0] : nullptr;
+  for (int i = 0; i < n_rows; i++) {
+    const size_t size = offsets[i + 1] - offsets[i];
+    if (size > 0) {
+      const Slice* cell = reinterpret_cast<const Slice*>(rows + i * row_size + col_offset);
+      memcpy(dst + offsets[i], cell->data(), size);
+    }
+  }
+  if (non_null_bitmap) {
+    data_->CopyRowwiseNonNullBitmap(idx, non_null_bitmap);
+  }
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduScanBatch::RowPtr
 ////////////////////////////////////////////////////////////
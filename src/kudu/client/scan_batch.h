@@ -144,11 +144,98 @@ class KUDU_EXPORT KuduScanBatch {
   ///
   /// @return a Slice that points to the raw indirect row data.
   Slice indirect_data() const;
+
+  /// Get the data of a fixed-length column of a batch returned in columnar
+  /// layout. See KuduScanner::COLUMNAR_LAYOUT.
+  ///
+  /// The data holds NumRows() contiguous cells in native little-endian
+  /// format. The cells of NULL values are zeroed.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   The column data. Empty if NumRows() is zero.
+  /// @return Operation result status.
+  Status GetFixedLengthColumn(int idx, Slice* data) const;
+
+  /// Get the data of a variable-length (STRING or BINARY) column of a batch
+  /// returned in columnar layout. See KuduScanner::COLUMNAR_LAYOUT.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] offsets
+  ///   NumRows() + 1 uint32_t offsets into 'data'. The value of row 'i' lies
+  ///   between offsets 'i' and 'i + 1'. Empty if NumRows() is zero.
+  /// @param [out] data
+  ///   The concatenated values of the column.
+  /// @return Operation result status.
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+
+  /// Get the non-null bitmap of a nullable column of a batch returned in
+  /// columnar layout. See KuduScanner::COLUMNAR_LAYOUT.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   A bitmap in which bit 'i' is set if row 'i' is non-NULL. Empty if the
+  ///   column is not nullable or NumRows() is zero.
+  /// @return Operation result status.
+  Status GetNonNullBitmapForColumn(int idx, Slice* data) const;
+  ///@}
+
+  /// @name Bulk column access
+  ///
+  /// These methods copy a whole column of the batch into buffers provided
+  /// by the caller, in a layout compatible with Apache Arrow arrays. They
+  /// work on batches in both the row-wise and the columnar layout, and are
+  /// much cheaper than reading the column row by row through RowPtr: the
+  /// cells are copied with memcpy() for columnar batches, and with a tight
+  /// fixed-size copy loop for row-wise ones.
+  ///
+  /// The non-NULL bitmaps have bit 'i' set if row 'i' is non-NULL, with
+  /// the bits of each byte ordered from the least significant one.
+  ///
+  ///@{
+  /// Copy a fixed-length column of the batch.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] values
+  ///   Array receiving NumRows() cells in native little-endian format, e.g.
+  ///   int32_t for an INT32 column. The cells of NULL values are zeroed.
+  /// @param [in] values_size
+  ///   The size of @c values in bytes.
+  /// @param [out] non_null_bitmap
+  ///   If not NULL, receives the non-NULL bitmap of the column, of
+  ///   (NumRows() + 7) / 8 bytes. All bits are set for a non-nullable column.
+  /// @return Operation result status.
+  Status CopyFixedLengthColumn(int idx, void* values, size_t values_size,
+                               uint8_t* non_null_bitmap) const;
+
+  /// Copy a variable-length (STRING or BINARY) column of the batch.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] offsets
+  ///   Array receiving NumRows() + 1 offsets into @c data. The value of
+  ///   row 'i' lies between offsets 'i' and 'i + 1'; it is empty if NULL.
+  /// @param [in] offsets_size
+  ///   The size of @c offsets in bytes.
+  /// @param [out] data
+  ///   Receives the concatenated values of the column.
+  /// @param [out] non_null_bitmap
+  ///   If not NULL, receives the non-NULL bitmap of the column, as with
+  ///   CopyFixedLengthColumn().
+  /// @return Operation result status.
+  Status CopyVariableLengthColumn(int idx, uint32_t* offsets, size_t offsets_size,
+                                  std::string* data, uint8_t* non_null_bitmap) const;
   ///@}
 
  private:
   class KUDU_NO_EXPORT Data;
+  friend class KuduParallelScanner;
   friend class KuduScanner;
+  friend class KuduTable;
   friend class tools::ReplicaDumper;
 
   Data* data_;
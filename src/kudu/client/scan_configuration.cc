@@ -48,6 +48,7 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       client_projection_(*table->schema().schema_),
       has_batch_size_bytes_(false),
       batch_size_bytes_(0),
+      prefetching_(false),
       selection_(KuduClient::CLOSEST_REPLICA),
       read_mode_(KuduScanner::READ_LATEST),
       is_fault_tolerant_(false),
@@ -155,6 +156,10 @@ Status ScanConfiguration::SetBatchSizeBytes(uint32_t batch_size) {
   return Status::OK();
 }
 
+void ScanConfiguration::SetPrefetching(bool prefetching) {
+  prefetching_ = prefetching;
+}
+
 Status ScanConfiguration::SetSelection(KuduClient::ReplicaSelection selection) {
   selection_ = selection;
   return Status::OK();
@@ -76,6 +76,8 @@ class ScanConfiguration {
 
   Status SetBatchSizeBytes(uint32_t batch_size);
 
+  void SetPrefetching(bool prefetching);
+
   Status SetSelection(KuduClient::ReplicaSelection selection) WARN_UNUSED_RESULT;
 
   Status SetReadMode(KuduScanner::ReadMode read_mode) WARN_UNUSED_RESULT;
@@ -131,6 +133,10 @@ class ScanConfiguration {
     return batch_size_bytes_;
   }
 
+  bool prefetching() const {
+    return prefetching_;
+  }
+
   KuduClient::ReplicaSelection selection() const {
     return selection_;
   }
@@ -193,6 +199,8 @@ class ScanConfiguration {
   bool has_batch_size_bytes_;
   uint32_t batch_size_bytes_;
 
+  bool prefetching_;
+
   KuduClient::ReplicaSelection selection_;
 
   KuduScanner::ReadMode read_mode_;
@@ -17,6 +17,8 @@
 #ifndef KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 #define KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 
+#include <cstddef>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -24,7 +26,9 @@
 #include "kudu/client/value-internal.h"
 #include "kudu/client/value.h"
 #include "kudu/common/scan_spec.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
@@ -117,6 +121,43 @@ class InListPredicateData : public KuduPredicate::Data {
   std::vector<KuduValue*> vals_;
 };
 
+class KuduBloomFilter::Data {
+ public:
+  explicit Data(const BloomFilterSizing& sizing)
+      : builder(sizing) {
+  }
+
+  BloomFilterBuilder builder;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+// A predicate for selecting values which may be present in a set of Bloom
+// filters.
+class InBloomFilterPredicateData : public KuduPredicate::Data {
+ public:
+  // Each filter is its bitmap and number of hashes.
+  typedef std::pair<std::string, size_t> SerializedFilter;
+
+  InBloomFilterPredicateData(ColumnSchema col, std::vector<SerializedFilter> bloom_filters)
+      : col_(std::move(col)),
+        bloom_filters_(std::move(bloom_filters)) {
+  }
+
+  Status AddToScanSpec(ScanSpec* spec, Arena* arena) override;
+
+  InBloomFilterPredicateData* Clone() const override {
+    return new InBloomFilterPredicateData(col_, bloom_filters_);
+  }
+
+ private:
+  friend class KuduScanner;
+
+  ColumnSchema col_;
+  std::vector<SerializedFilter> bloom_filters_;
+};
+
 // A predicate for selecting non-null values.
 class IsNotNullPredicateData : public KuduPredicate::Data {
  public:
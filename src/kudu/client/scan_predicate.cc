@@ -32,6 +32,8 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 using boost::optional;
@@ -148,5 +150,47 @@ Status InListPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
   return Status::OK();
 }
 
+Status InBloomFilterPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
+  if (bloom_filters_.empty()) {
+    return Status::InvalidArgument(
+        Substitute("no Bloom filters in predicate on column $0", col_.name()));
+  }
+  // The filters point into bloom_filters_, which lives as long as the
+  // scanner's configuration.
+  vector<BloomFilter> filters;
+  filters.reserve(bloom_filters_.size());
+  for (const SerializedFilter& filter : bloom_filters_) {
+    filters.emplace_back(Slice(filter.first), filter.second);
+  }
+  spec->AddPredicate(ColumnPredicate::InBloomFilter(col_, &filters, nullptr, nullptr));
+  return Status::OK();
+}
+
+KuduBloomFilter::KuduBloomFilter(Data* d)
+    : data_(d) {
+}
+
+KuduBloomFilter::~KuduBloomFilter() {
+  delete data_;
+}
+
+Status KuduBloomFilter::Create(size_t expected_count, double fp_rate,
+                               KuduBloomFilter** bloom_filter) {
+  if (expected_count == 0) {
+    return Status::InvalidArgument("Bloom filter expected count must be positive");
+  }
+  if (!(fp_rate > 0 && fp_rate < 1)) {
+    return Status::InvalidArgument(
+        Substitute("Bloom filter false positive rate must be in (0, 1): $0", fp_rate));
+  }
+  *bloom_filter = new KuduBloomFilter(
+      new Data(BloomFilterSizing::ByCountAndFPRate(expected_count, fp_rate)));
+  return Status::OK();
+}
+
+void KuduBloomFilter::Insert(const Slice& value) {
+  data_->builder.AddKey(BloomKeyProbe(value));
+}
+
 } // namespace client
 } // namespace kudu
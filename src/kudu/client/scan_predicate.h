@@ -17,6 +17,8 @@
 #ifndef KUDU_CLIENT_SCAN_PREDICATE_H
 #define KUDU_CLIENT_SCAN_PREDICATE_H
 
+#include <cstddef>
+
 #ifdef KUDU_HEADERS_NO_STUBS
 #include "kudu/gutil/macros.h"
 #else
@@ -24,6 +26,8 @@
 #endif
 
 #include "kudu/util/kudu_export.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 namespace client {
@@ -55,6 +59,7 @@ class KUDU_EXPORT KuduPredicate {
  private:
   friend class ComparisonPredicateData;
   friend class ErrorPredicateData;
+  friend class InBloomFilterPredicateData;
   friend class InListPredicateData;
   friend class IsNotNullPredicateData;
   friend class IsNullPredicateData;
@@ -67,6 +72,48 @@ class KUDU_EXPORT KuduPredicate {
   DISALLOW_COPY_AND_ASSIGN(KuduPredicate);
 };
 
+/// @brief A Bloom filter over column values, for use with
+///   KuduTable::NewInBloomFilterPredicate().
+///
+/// A query engine can build a filter from the join keys of one side of a
+/// join and push it to the scan of the other side, which is much cheaper to
+/// send and evaluate than an IN list of the same keys.
+class KUDU_EXPORT KuduBloomFilter {
+ public:
+  /// Create a new, empty, Bloom filter.
+  ///
+  /// @param [in] expected_count
+  ///   The number of values the filter is sized for.
+  /// @param [in] fp_rate
+  ///   The false positive rate for @c expected_count values, in (0, 1).
+  /// @param [out] bloom_filter
+  ///   The new filter. The caller owns the result.
+  /// @return Operation result status.
+  static Status Create(size_t expected_count, double fp_rate,
+                       KuduBloomFilter** bloom_filter);
+
+  ~KuduBloomFilter();
+
+  /// Add a value to the filter.
+  ///
+  /// @param [in] value
+  ///   The value's data. For STRING and BINARY columns this is the raw value;
+  ///   for other columns it is the little-endian representation of the value
+  ///   with the column type's width (e.g. 8 bytes for INT64 and
+  ///   UNIXTIME_MICROS, 4 bytes for FLOAT).
+  void Insert(const Slice& value);
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  friend class KuduTable;
+
+  explicit KuduBloomFilter(Data* d);
+
+  Data* data_;
+  DISALLOW_COPY_AND_ASSIGN(KuduBloomFilter);
+};
+
 } // namespace client
 } // namespace kudu
 #endif // KUDU_CLIENT_SCAN_PREDICATE_H
@@ -17,6 +17,7 @@
 
 #include "kudu/client/scan_token-internal.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -48,6 +49,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -102,9 +104,35 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
   }
 
   sp::shared_ptr<KuduTable> table;
-  RETURN_NOT_OK(client->OpenTable(message.table_name(), &table));
+  if (message.has_table_metadata()) {
+    RETURN_NOT_OK(TableFromMetadataPB(client, message.table_metadata(), &table));
+  } else {
+    RETURN_NOT_OK(client->OpenTable(message.table_name(), &table));
+  }
   Schema* schema = table->schema().schema_;
 
+  if (message.has_tablet_metadata()) {
+    const TabletMetadataPB& metadata = message.tablet_metadata();
+    master::TabletLocationsPB locations;
+    locations.set_tablet_id(metadata.tablet_id());
+    *locations.mutable_partition() = metadata.partition();
+    for (const TabletMetadataPB::ReplicaPB& replica : metadata.replicas()) {
+      master::TabletLocationsPB_ReplicaPB* replica_pb = locations.add_replicas();
+      master::TSInfoPB* ts_info = replica_pb->mutable_ts_info();
+      ts_info->set_permanent_uuid(replica.ts_uuid());
+      *ts_info->mutable_rpc_addresses() = replica.ts_rpc_addresses();
+      if (replica.has_ts_unix_domain_socket_path()) {
+        ts_info->set_unix_domain_socket_path(replica.ts_unix_domain_socket_path());
+      }
+      replica_pb->set_role(replica.is_leader() ? consensus::RaftPeerPB::LEADER :
+                           replica.is_voter() ? consensus::RaftPeerPB::FOLLOWER :
+                                                consensus::RaftPeerPB::LEARNER);
+    }
+    client->data_->meta_cache_->AddTabletLocations(
+        table.get(), locations,
+        MonoTime::Now() + MonoDelta::FromMilliseconds(metadata.ttl_millis()));
+  }
+
   unique_ptr<KuduScanner> scan_builder(new KuduScanner(table.get()));
 
   vector<int> column_indexes;
@@ -203,8 +231,29 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
   return Status::OK();
 }
 
+Status KuduScanToken::Data::TableFromMetadataPB(KuduClient* client,
+                                                const TableMetadataPB& metadata,
+                                                sp::shared_ptr<KuduTable>* table) {
+  unique_ptr<Schema> schema(new Schema());
+  RETURN_NOT_OK(SchemaFromPB(metadata.schema(), schema.get()));
+  PartitionSchema partition_schema;
+  RETURN_NOT_OK(PartitionSchema::FromPB(metadata.partition_schema(), *schema,
+                                        &partition_schema));
+  KuduSchema client_schema;
+  client_schema.schema_ = schema.release();
+  table->reset(new KuduTable(client->shared_from_this(),
+                             metadata.table_name(),
+                             metadata.table_id(),
+                             metadata.num_replicas(),
+                             client_schema,
+                             partition_schema));
+  return Status::OK();
+}
+
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      include_table_metadata_(false),
+      include_tablet_metadata_(false) {
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
@@ -275,6 +324,15 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
     pb.set_batch_size_bytes(configuration_.batch_size_bytes());
   }
 
+  if (include_table_metadata_) {
+    TableMetadataPB* table_pb = pb.mutable_table_metadata();
+    table_pb->set_table_id(table->id());
+    table_pb->set_table_name(table->name());
+    table_pb->set_num_replicas(table->num_replicas());
+    RETURN_NOT_OK(SchemaToPB(*table->schema().schema_, table_pb->mutable_schema()));
+    table->partition_schema().ToPB(table_pb->mutable_partition_schema());
+  }
+
   MonoTime deadline = MonoTime::Now() + client->default_admin_operation_timeout();
 
   PartitionPruner pruner;
@@ -345,6 +403,31 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
         tablet->partition().partition_key_start());
     message.set_upper_bound_partition_key(
         tablet->partition().partition_key_end());
+
+    // The locations are only included while they are cached: they expire on
+    // the deserializing side no later than they would have here.
+    MonoTime expiration_time = client->data_->meta_cache_->GetTabletExpirationTime(
+        table, tablet->partition().partition_key_start());
+    if (include_tablet_metadata_ && expiration_time.Initialized()) {
+      TabletMetadataPB* tablet_pb = message.mutable_tablet_metadata();
+      tablet_pb->set_tablet_id(tablet->tablet_id());
+      tablet->partition().ToPB(tablet_pb->mutable_partition());
+      for (const auto& r : replicas) {
+        master::TSInfoPB ts_info;
+        r.ts->ToPB(&ts_info);
+        TabletMetadataPB::ReplicaPB* replica_pb = tablet_pb->add_replicas();
+        replica_pb->set_ts_uuid(ts_info.permanent_uuid());
+        replica_pb->mutable_ts_rpc_addresses()->Swap(ts_info.mutable_rpc_addresses());
+        if (ts_info.has_unix_domain_socket_path()) {
+          replica_pb->set_ts_unix_domain_socket_path(ts_info.unix_domain_socket_path());
+        }
+        replica_pb->set_is_leader(r.role == consensus::RaftPeerPB::LEADER);
+        replica_pb->set_is_voter(r.role == consensus::RaftPeerPB::LEADER ||
+                                 r.role == consensus::RaftPeerPB::FOLLOWER);
+      }
+      tablet_pb->set_ttl_millis(
+          std::max<int64_t>(0, (expiration_time - MonoTime::Now()).ToMilliseconds()));
+    }
     unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
     client_scan_token->data_ =
         new KuduScanToken::Data(table,
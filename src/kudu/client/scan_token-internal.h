@@ -24,6 +24,7 @@
 #include "kudu/client/client.h"
 #include "kudu/client/client.pb.h"
 #include "kudu/client/scan_configuration.h"
+#include "kudu/client/shared_ptr.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -52,6 +53,11 @@ class KuduScanToken::Data {
                               const ScanTokenPB& message,
                               KuduScanner** scanner);
 
+  // Builds the table to scan out of the metadata embedded in a token.
+  static Status TableFromMetadataPB(KuduClient* client,
+                                    const TableMetadataPB& metadata,
+                                    sp::shared_ptr<KuduTable>* table);
+
   const KuduTable* table_;
   const ScanTokenPB message_;
   const std::unique_ptr<KuduTablet> tablet_;
@@ -72,8 +78,18 @@ class KuduScanTokenBuilder::Data {
     return &configuration_;
   }
 
+  void IncludeTableMetadata(bool include_metadata) {
+    include_table_metadata_ = include_metadata;
+  }
+
+  void IncludeTabletMetadata(bool include_metadata) {
+    include_tablet_metadata_ = include_metadata;
+  }
+
  private:
   ScanConfiguration configuration_;
+  bool include_table_metadata_;
+  bool include_tablet_metadata_;
 };
 
 } // namespace client
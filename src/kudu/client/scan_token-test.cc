@@ -41,15 +41,21 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/master/master.h"
+#include "kudu/master/mini_master.h"
 #include "kudu/mini-cluster/internal_mini_cluster.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableLocations);
+METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableSchema);
+
 namespace kudu {
 namespace client {
 
@@ -136,6 +142,16 @@ class ScanTokenTest : public KuduTest {
     ASSERT_EQ(tokens.size(), tablet_ids.size());
   }
 
+  // Return the number of RPCs serviced by the master to open tables and look
+  // up tablets.
+  int64_t CountMasterTableRPCs() const {
+    auto ent = cluster_->mini_master()->master()->metric_entity();
+    return METRIC_handler_latency_kudu_master_MasterService_GetTableLocations
+               .Instantiate(ent)->TotalCount() +
+           METRIC_handler_latency_kudu_master_MasterService_GetTableSchema
+               .Instantiate(ent)->TotalCount();
+  }
+
   shared_ptr<KuduClient> client_;
   gscoped_ptr<InternalMiniCluster> cluster_;
 };
@@ -529,6 +545,50 @@ INSTANTIATE_TEST_CASE_P(Params, TimestampPropagationParamTest,
 
 // Tests the results of creating scan tokens, altering the columns being
 // scanned, and then executing the scan tokens.
+// Scan tokens which embed the table metadata and the tablet locations are
+// turned into scanners without contacting the master.
+TEST_F(ScanTokenTest, TestScanTokensWithMetadata) {
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .add_hash_partitions({ "col" }, 4)
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  for (int i = 0; i < 100; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  KuduScanTokenBuilder builder(table.get());
+  ASSERT_OK(builder.IncludeTableMetadata(true));
+  ASSERT_OK(builder.IncludeTabletMetadata(true));
+  ASSERT_OK(builder.Build(&tokens));
+  ASSERT_EQ(4, tokens.size());
+  NO_FATALS(VerifyTabletInfo(tokens));
+
+  int64_t master_rpcs = CountMasterTableRPCs();
+  ASSERT_EQ(100, CountRows(tokens));
+  ASSERT_EQ(master_rpcs, CountMasterTableRPCs());
+}
+
 TEST_F(ScanTokenTest, TestConcurrentAlterTable) {
   const char* kTableName = "scan-token-alter";
   // Create schema
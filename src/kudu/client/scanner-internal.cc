@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -72,10 +73,15 @@ KuduScanner::Data::Data(KuduTable* table)
     data_in_open_(false),
     short_circuit_(false),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
-    scan_attempts_(0) {
+    scan_attempts_(0),
+    prefetch_in_flight_(false),
+    prefetch_cond_(&prefetch_lock_),
+    prefetch_done_(false) {
 }
 
 KuduScanner::Data::~Data() {
+  // The callback of a prefetched request refers to this object.
+  CancelPrefetch();
 }
 
 Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
@@ -283,29 +289,123 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
     rpc_deadline = overall_deadline;
   }
 
-  controller_.Reset();
-  controller_.set_deadline(rpc_deadline);
-  if (!configuration_.spec().predicates().empty()) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
-  }
-  if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
-    controller_.RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
-  }
+  PrepareController(rpc_deadline, &controller_);
+  const MonoTime start_time = MonoTime::Now();
   ScanRpcStatus scan_status = AnalyzeResponse(
       proxy_->Scan(next_req_,
                    &last_response_,
                    &controller_),
       rpc_deadline, overall_deadline);
+  if (scan_status.result == ScanRpcStatus::OK) {
+    MonoDelta queue_time = MonoDelta::FromNanoseconds(
+        last_response_.resource_metrics().queue_duration_nanos());
+    ts_->RecordScanLatency(MonoTime::Now() - start_time, queue_time);
+    UpdateResourceMetrics();
+  } else if (scan_status.result == ScanRpcStatus::RPC_DEADLINE_EXCEEDED) {
+    // The server took at least that long, and LOWEST_LATENCY replica
+    // selection should steer away from it.
+    ts_->RecordScanLatency(MonoTime::Now() - start_time, MonoDelta::FromNanoseconds(0));
+  }
+  return scan_status;
+}
+
+void KuduScanner::Data::PrepareController(const MonoTime& rpc_deadline,
+                                          RpcController* controller) const {
+  controller->Reset();
+  controller->set_deadline(rpc_deadline);
+  if (!configuration_.spec().predicates().empty()) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+  }
+  if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
+    controller->RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+  }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_LAYOUT) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE);
+  }
+}
+
+void KuduScanner::Data::MaybeStartPrefetch() {
+  DCHECK(!prefetch_in_flight_);
+  if (!configuration_.prefetching() || !last_response_.has_more_results()) {
+    return;
+  }
+  StartPrefetch();
+}
+
+void KuduScanner::Data::StartPrefetch() {
+  DCHECK(!prefetch_in_flight_);
+  DCHECK(last_response_.has_more_results());
+  PrepareRequest(KuduScanner::Data::CONTINUE);
+  prefetch_rpc_deadline_ = MonoTime::Now() + configuration_.timeout();
+  PrepareController(prefetch_rpc_deadline_, &prefetch_controller_);
+  {
+    MutexLock l(prefetch_lock_);
+    prefetch_done_ = false;
+  }
+  prefetch_in_flight_ = true;
+  proxy_->ScanAsync(next_req_, &prefetch_response_, &prefetch_controller_,
+                    [this]() {
+                      std::function<void()> cb;
+                      {
+                        MutexLock l(prefetch_lock_);
+                        prefetch_done_ = true;
+                        prefetch_cond_.Broadcast();
+                        cb.swap(prefetch_done_cb_);
+                      }
+                      if (cb) {
+                        cb();
+                      }
+                    });
+}
+
+void KuduScanner::Data::RunWhenPrefetchDone(std::function<void()> cb) {
+  DCHECK(prefetch_in_flight_);
+  {
+    MutexLock l(prefetch_lock_);
+    if (!prefetch_done_) {
+      DCHECK(!prefetch_done_cb_);
+      prefetch_done_cb_ = std::move(cb);
+      return;
+    }
+  }
+  cb();
+}
+
+ScanRpcStatus KuduScanner::Data::FinishPrefetch(const MonoTime& overall_deadline) {
+  DCHECK(prefetch_in_flight_);
+  {
+    MutexLock l(prefetch_lock_);
+    while (!prefetch_done_) {
+      prefetch_cond_.Wait();
+    }
+  }
+  prefetch_in_flight_ = false;
+  controller_.Swap(&prefetch_controller_);
+  last_response_.Swap(&prefetch_response_);
+  ScanRpcStatus scan_status = AnalyzeResponse(
+      controller_.status(), overall_deadline, prefetch_rpc_deadline_);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
   }
   return scan_status;
 }
 
+void KuduScanner::Data::CancelPrefetch() {
+  if (!prefetch_in_flight_) {
+    return;
+  }
+  prefetch_controller_.Cancel();
+  MutexLock l(prefetch_lock_);
+  while (!prefetch_done_) {
+    prefetch_cond_.Wait();
+  }
+  prefetch_in_flight_ = false;
+}
+
 Status KuduScanner::Data::OpenTablet(const string& partition_key,
                                      const MonoTime& deadline,
                                      set<string>* blacklist) {
-
+  DCHECK(!prefetch_in_flight_);
   PrepareRequest(KuduScanner::Data::NEW);
   next_req_.clear_scanner_id();
   NewScanRequestPB* scan = next_req_.mutable_new_scan_request();
@@ -511,16 +611,8 @@ Status KuduScanner::Data::KeepAlive() {
     return Status::OK();
   }
 
-  RpcController controller;
-  controller.set_timeout(configuration_.timeout());
-  tserver::ScannerKeepAliveRequestPB request;
-  request.set_scanner_id(next_req_.scanner_id());
-  tserver::ScannerKeepAliveResponsePB response;
-  RETURN_NOT_OK(proxy_->ScannerKeepAlive(request, &response, &controller));
-  if (response.has_error()) {
-    return StatusFromPB(response.error().status());
-  }
-  return Status::OK();
+  return table_->client()->data_->scanner_keep_alive_batcher_->KeepAlive(
+      ts_, next_req_.scanner_id(), configuration_.timeout());
 }
 
 bool KuduScanner::Data::MoreTablets() const {
@@ -568,13 +660,24 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
                                   const Schema* projection,
                                   const KuduSchema* client_projection,
                                   uint64_t row_format_flags,
-                                  gscoped_ptr<RowwiseRowBlockPB> resp_data) {
+                                  gscoped_ptr<RowwiseRowBlockPB> resp_data,
+                                  gscoped_ptr<ColumnarRowBlockPB> columnar_resp_data) {
   CHECK(controller->finished());
   controller_.Swap(controller);
   projection_ = projection;
   projected_row_size_ = CalculateProjectedRowSize(*projection_);
   client_projection_ = client_projection;
   row_format_flags_ = row_format_flags;
+  if (row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT) {
+    if (!columnar_resp_data) {
+      // No new data; just clear out the old stuff.
+      columnar_resp_data_.Clear();
+      columnar_columns_.clear();
+      return Status::OK();
+    }
+    columnar_resp_data_.Swap(columnar_resp_data.get());
+    return ResetColumnar();
+  }
   if (!resp_data) {
     // No new data; just clear out the old stuff.
     resp_data_.Clear();
@@ -613,6 +716,87 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
                                  pad_unixtime_micros_to_16_bytes);
 }
 
+Status KuduScanBatch::Data::ResetColumnar() {
+  const int64_t num_rows = columnar_resp_data_.num_rows();
+  columnar_columns_.clear();
+  columnar_columns_.resize(projection_->num_columns());
+  if (columnar_resp_data_.columns_size() == 0 && num_rows == 0) {
+    // The server sends no columns for an empty batch.
+    return Status::OK();
+  }
+  if (PREDICT_FALSE(columnar_resp_data_.columns_size() != projection_->num_columns())) {
+    return Status::Corruption(Substitute(
+        "Server sent invalid response: expected $0 columns, got $1",
+        projection_->num_columns(), columnar_resp_data_.columns_size()));
+  }
+
+  auto get_sidecar = [&](int idx, const string& col_name, const char* what, Slice* dst) {
+    Status s = controller_.GetInboundSidecar(idx, dst);
+    if (!s.ok()) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: $0 sidecar index for column $1 corrupt",
+          what, col_name), s.ToString());
+    }
+    return Status::OK();
+  };
+
+  for (int i = 0; i < projection_->num_columns(); i++) {
+    const ColumnSchema& col = projection_->column(i);
+    const ColumnarRowBlockPB::Column& col_pb = columnar_resp_data_.columns(i);
+    ColumnarColumn* dst = &columnar_columns_[i];
+
+    if (PREDICT_FALSE(!col_pb.has_data_sidecar())) {
+      return Status::Corruption("Server sent invalid response: no data for column",
+                                col.name());
+    }
+    RETURN_NOT_OK(get_sidecar(col_pb.data_sidecar(), col.name(), "data", &dst->data));
+
+    size_t expected_data_size;
+    if (col.type_info()->physical_type() == BINARY) {
+      if (PREDICT_FALSE(!col_pb.has_varlen_data_sidecar())) {
+        return Status::Corruption("Server sent invalid response: no varlen data for column",
+                                  col.name());
+      }
+      RETURN_NOT_OK(get_sidecar(col_pb.varlen_data_sidecar(), col.name(), "varlen data",
+                                &dst->varlen_data));
+      expected_data_size = (num_rows + 1) * sizeof(uint32_t);
+    } else {
+      expected_data_size = num_rows * col.type_info()->size();
+    }
+    if (PREDICT_FALSE(dst->data.size() != expected_data_size)) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: column $0 has $1 bytes of data, expected $2",
+          col.name(), dst->data.size(), expected_data_size));
+    }
+
+    if (col.is_nullable()) {
+      if (PREDICT_FALSE(!col_pb.has_non_null_bitmap_sidecar())) {
+        return Status::Corruption("Server sent invalid response: no null bitmap for column",
+                                  col.name());
+      }
+      RETURN_NOT_OK(get_sidecar(col_pb.non_null_bitmap_sidecar(), col.name(), "null bitmap",
+                                &dst->non_null_bitmap));
+      if (PREDICT_FALSE(dst->non_null_bitmap.size() != BitmapSize(num_rows))) {
+        return Status::Corruption(Substitute(
+            "Server sent invalid response: column $0 has a null bitmap of $1 bytes, "
+            "expected $2", col.name(), dst->non_null_bitmap.size(), BitmapSize(num_rows)));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::GetColumnarColumn(int idx, const ColumnarColumn** col) const {
+  if (PREDICT_FALSE(!(row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT))) {
+    return Status::IllegalState("batch was not requested in columnar layout");
+  }
+  if (PREDICT_FALSE(idx < 0 || idx >= static_cast<int>(columnar_columns_.size()))) {
+    return Status::InvalidArgument(Substitute("invalid column index: $0", idx));
+  }
+  *col = &columnar_columns_[idx];
+  return Status::OK();
+}
+
 void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
   DCHECK_EQ(row_format_flags_, KuduScanner::NO_FLAGS) << "Cannot extract rows. "
       << "Row format modifier flags were selected: " << row_format_flags_;
@@ -642,8 +826,111 @@ void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
 
 void KuduScanBatch::Data::Clear() {
   resp_data_.Clear();
+  columnar_resp_data_.Clear();
+  columnar_columns_.clear();
   controller_.Reset();
 }
 
+namespace internal {
+
+ScannerKeepAliveBatcher::ScannerKeepAliveBatcher()
+    : cond_(&lock_) {
+}
+
+Status ScannerKeepAliveBatcher::KeepAlive(RemoteTabletServer* ts,
+                                          const string& scanner_id,
+                                          const MonoDelta& timeout) {
+  Request request = { scanner_id, timeout, Status::OK(), false };
+  MutexLock l(lock_);
+  ServerState* server = &servers_[ts];
+  server->pending.push_back(&request);
+  while (!request.done) {
+    if (server->rpc_in_flight) {
+      cond_.Wait();
+      continue;
+    }
+    // Nothing is in flight to the server: send everything queued for it,
+    // including the keepalives of the callers waiting on the previous RPC.
+    vector<Request*> batch;
+    batch.swap(server->pending);
+    server->rpc_in_flight = true;
+    l.Unlock();
+    Send(ts, batch);
+    l.Lock();
+    server->rpc_in_flight = false;
+    for (Request* r : batch) {
+      r->done = true;
+    }
+    cond_.Broadcast();
+  }
+  return request.status;
+}
+
+void ScannerKeepAliveBatcher::Send(RemoteTabletServer* ts, const vector<Request*>& requests) {
+  if (requests.size() == 1 || !ts->supports_multi_scanner_keep_alive()) {
+    for (Request* r : requests) {
+      SendOne(ts, r);
+    }
+    return;
+  }
+
+  tserver::MultiScannerKeepAliveRequestPB req;
+  MonoDelta timeout;
+  for (const Request* r : requests) {
+    req.add_scanner_ids(r->scanner_id);
+    if (!timeout.Initialized() || r->timeout > timeout) {
+      timeout = r->timeout;
+    }
+  }
+  tserver::MultiScannerKeepAliveResponsePB resp;
+  RpcController controller;
+  controller.set_timeout(timeout);
+  Status s = ts->proxy()->MultiScannerKeepAlive(req, &resp, &controller);
+  if (!s.ok()) {
+    const rpc::ErrorStatusPB* err = controller.error_response();
+    if (err && err->has_code() && err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      LOG(INFO) << ts->ToString() << " doesn't support multi-scanner keepalives, "
+                << "sending them to it one scanner at a time";
+      ts->set_multi_scanner_keep_alive_unsupported();
+      for (Request* r : requests) {
+        SendOne(ts, r);
+      }
+      return;
+    }
+    for (Request* r : requests) {
+      r->status = s;
+    }
+    return;
+  }
+  if (PREDICT_FALSE(resp.responses_size() != static_cast<int>(requests.size()))) {
+    s = Status::Corruption(Substitute(
+        "MultiScannerKeepAlive response from $0 has $1 entries, expected $2",
+        ts->ToString(), resp.responses_size(), requests.size()));
+    for (Request* r : requests) {
+      r->status = s;
+    }
+    return;
+  }
+  for (int i = 0; i < resp.responses_size(); i++) {
+    if (resp.responses(i).has_error()) {
+      requests[i]->status = StatusFromPB(resp.responses(i).error().status());
+    }
+  }
+}
+
+void ScannerKeepAliveBatcher::SendOne(RemoteTabletServer* ts, Request* request) {
+  RpcController controller;
+  controller.set_timeout(request->timeout);
+  tserver::ScannerKeepAliveRequestPB req;
+  req.set_scanner_id(request->scanner_id);
+  tserver::ScannerKeepAliveResponsePB resp;
+  request->status = ts->proxy()->ScannerKeepAlive(req, &resp, &controller);
+  if (request->status.ok() && resp.has_error()) {
+    request->status = StatusFromPB(resp.error().status());
+  }
+}
+
+} // namespace internal
+
 } // namespace client
 } // namespace kudu
@@ -19,10 +19,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glog/logging.h>
@@ -44,13 +46,14 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
-class MonoTime;
-
 namespace tserver {
 class TabletServerServiceProxy;
 }
@@ -60,6 +63,52 @@ namespace client {
 namespace internal {
 class RemoteTablet;
 class RemoteTabletServer;
+
+// Coalesces the keepalives that concurrently open scanners of a client send
+// to the same tablet server. While a keepalive RPC to a server is in flight,
+// keepalives for other scanners on that server are queued, and the next
+// caller to find the server idle sends all of them in a single
+// MultiScannerKeepAlive RPC. Servers which don't know that RPC are sent one
+// ScannerKeepAlive RPC per scanner, as before.
+//
+// This class is thread-safe.
+class ScannerKeepAliveBatcher {
+ public:
+  ScannerKeepAliveBatcher();
+
+  // Keeps the scanner 'scanner_id' on 'ts' alive. Blocks until the server
+  // has responded to the keepalive, or the RPC carrying it timed out.
+  Status KeepAlive(RemoteTabletServer* ts,
+                   const std::string& scanner_id,
+                   const MonoDelta& timeout);
+
+ private:
+  struct Request {
+    std::string scanner_id;
+    MonoDelta timeout;
+    Status status;
+    bool done;
+  };
+
+  struct ServerState {
+    // Keepalives waiting for the RPC in flight to 'ts' to complete.
+    std::vector<Request*> pending;
+    bool rpc_in_flight = false;
+  };
+
+  // Sends 'requests' to 'ts', setting the status of each of them.
+  static void Send(RemoteTabletServer* ts, const std::vector<Request*>& requests);
+  static void SendOne(RemoteTabletServer* ts, Request* request);
+
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // Protected by 'lock_'.
+  std::unordered_map<RemoteTabletServer*, ServerState> servers_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScannerKeepAliveBatcher);
+};
+
 } // namespace internal
 
 // The result of KuduScanner::Data::AnalyzeResponse.
@@ -183,6 +232,35 @@ class KuduScanner::Data {
   // Modifies fields in 'next_req_' in preparation for a new request.
   void PrepareRequest(RequestType state);
 
+  // If prefetching is enabled and the current tablet has more results, sends
+  // the request for the next batch right away, so that it is in flight while
+  // the application processes the batch it was just handed.
+  //
+  // At most one request is prefetched, so the data buffered on behalf of the
+  // scanner is bounded by one extra batch.
+  void MaybeStartPrefetch();
+
+  // Sends the request for the next batch of the current tablet, which must
+  // have more results, regardless of whether prefetching is enabled.
+  void StartPrefetch();
+
+  // Runs 'cb' once the prefetched request completes: either inline, if it
+  // already has, or on the reactor thread which handles its response.
+  //
+  // Must only be called if 'prefetch_in_flight_' is true.
+  void RunWhenPrefetchDone(std::function<void()> cb);
+
+  // Waits for the prefetched request to complete and moves its response into
+  // 'last_response_' and 'controller_', as if it had been sent by
+  // SendScanRpc() with the given 'overall_deadline'.
+  //
+  // Must only be called if 'prefetch_in_flight_' is true.
+  ScanRpcStatus FinishPrefetch(const MonoTime& overall_deadline);
+
+  // Cancels the prefetched request, if any, and waits for it to complete,
+  // discarding its response.
+  void CancelPrefetch();
+
   // Update 'last_error_' if need be. Should be invoked whenever a
   // non-fatal (i.e. retriable) scan error is encountered.
   void UpdateLastError(const Status& error);
@@ -235,6 +313,24 @@ class KuduScanner::Data {
   // Number of attempts since the last successful scan.
   int scan_attempts_;
 
+  // Whether a request prefetched by MaybeStartPrefetch() is outstanding, i.e.
+  // it was sent but its response hasn't been consumed yet.
+  bool prefetch_in_flight_;
+
+  // The response, controller and RPC deadline of the prefetched request.
+  tserver::ScanResponsePB prefetch_response_;
+  rpc::RpcController prefetch_controller_;
+  MonoTime prefetch_rpc_deadline_;
+
+  // Signaled by the callback of the prefetched request when it completes.
+  Mutex prefetch_lock_;
+  ConditionVariable prefetch_cond_;
+  bool prefetch_done_; // Protected by 'prefetch_lock_'.
+
+  // Run once the prefetched request completes, if set.
+  // Protected by 'prefetch_lock_'.
+  std::function<void()> prefetch_done_cb_;
+
   // The deprecated "NextBatch(vector<KuduRowResult>*) API requires some local
   // storage for the actual row data. If that API is used, this member keeps the
   // actual storage for the batch that is returned.
@@ -280,6 +376,10 @@ class KuduScanner::Data {
 
   void UpdateResourceMetrics();
 
+  // Resets 'controller' for a scan RPC with the given deadline, requiring the
+  // server features that the scan configuration depends on.
+  void PrepareController(const MonoTime& rpc_deadline, rpc::RpcController* controller) const;
+
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
 
@@ -292,12 +392,38 @@ class KuduScanBatch::Data {
                const Schema* projection,
                const KuduSchema* client_projection,
                uint64_t row_format_flags,
-               gscoped_ptr<RowwiseRowBlockPB> resp_data);
+               gscoped_ptr<RowwiseRowBlockPB> resp_data,
+               gscoped_ptr<ColumnarRowBlockPB> columnar_resp_data);
 
   int num_rows() const {
+    if (row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT) {
+      return columnar_resp_data_.num_rows();
+    }
     return resp_data_.num_rows();
   }
 
+  // The sidecar data of a single column of a columnar batch. Slices for
+  // sidecars which are not applicable to the column are empty.
+  struct ColumnarColumn {
+    Slice data;
+    Slice varlen_data;
+    Slice non_null_bitmap;
+  };
+
+  // Returns the column at index 'idx' of the projection in '*col', or a bad
+  // Status if the batch was not requested in columnar layout or 'idx' is out
+  // of range.
+  Status GetColumnarColumn(int idx, const ColumnarColumn** col) const;
+
+  // Returns a bad Status if column 'idx' of the projection can't be copied
+  // by KuduScanBatch::CopyFixedLengthColumn() or, if 'variable_length',
+  // by KuduScanBatch::CopyVariableLengthColumn().
+  Status CheckColumnForCopy(int idx, bool variable_length) const;
+
+  // Fills 'non_null_bitmap' with the non-NULL bits of column 'idx' of a
+  // batch in the row-wise layout.
+  void CopyRowwiseNonNullBitmap(int idx, uint8_t* non_null_bitmap) const;
+
   KuduRowResult row(int idx) {
     DCHECK_EQ(row_format_flags_, KuduScanner::NO_FLAGS)
         << "Cannot decode individual rows. Row format flags were set: "
@@ -315,6 +441,9 @@ class KuduScanBatch::Data {
   // Returns the size of a row for the given projection 'proj'.
   static size_t CalculateProjectedRowSize(const Schema& proj);
 
+  // Fetches and validates the column sidecars of 'columnar_resp_data_'.
+  Status ResetColumnar();
+
   // The RPC controller for the RPC which returned this batch.
   // Holding on to the controller ensures we hold on to the indirect data
   // which contains the rows.
@@ -327,11 +456,21 @@ class KuduScanBatch::Data {
   // by the members above.
   Slice direct_data_, indirect_data_;
 
+  // The PB which describes the column sidecars of a batch in columnar layout,
+  // and the slices into those sidecars, in projection order.
+  ColumnarRowBlockPB columnar_resp_data_;
+  std::vector<ColumnarColumn> columnar_columns_;
+
   // The projection being scanned.
   const Schema* projection_;
   // The KuduSchema version of 'projection_'
   const KuduSchema* client_projection_;
 
+  // The projections of a batch returned by KuduTable::Get(), which has no
+  // scanner to own them.
+  std::unique_ptr<Schema> owned_projection_;
+  std::unique_ptr<KuduSchema> owned_client_projection_;
+
   // The row format flags that were passed to the KuduScanner.
   // See: KuduScanner::SetRowFormatFlags()
   uint64_t row_format_flags_;
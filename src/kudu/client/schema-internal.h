@@ -65,6 +65,12 @@ class KuduColumnSpec::Data {
         scale(-1),
         has_encoding(false),
         has_compression(false),
+        has_compression_level(false),
+        compression_level(0),
+        has_indexed(false),
+        indexed(false),
+        has_ttl_seconds(false),
+        ttl_seconds(0),
         has_block_size(false),
         has_nullable(false),
         primary_key(false),
@@ -95,6 +101,15 @@ class KuduColumnSpec::Data {
   bool has_compression;
   KuduColumnStorageAttributes::CompressionType compression;
 
+  bool has_compression_level;
+  int32_t compression_level;
+
+  bool has_indexed;
+  bool indexed;
+
+  bool has_ttl_seconds;
+  int64_t ttl_seconds;
+
   bool has_block_size;
   int32_t block_size;
 
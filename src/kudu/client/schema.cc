@@ -71,6 +71,8 @@ kudu::EncodingType ToInternalEncodingType(KuduColumnStorageAttributes::EncodingT
     case KuduColumnStorageAttributes::GROUP_VARINT: return kudu::GROUP_VARINT;
     case KuduColumnStorageAttributes::RLE: return kudu::RLE;
     case KuduColumnStorageAttributes::BIT_SHUFFLE: return kudu::BIT_SHUFFLE;
+    case KuduColumnStorageAttributes::DELTA_BITPACK: return kudu::DELTA_BITPACK;
+    case KuduColumnStorageAttributes::FLOAT_XOR: return kudu::FLOAT_XOR;
     default: LOG(FATAL) << "Unexpected encoding type: " << type;
   }
 }
@@ -84,6 +86,8 @@ KuduColumnStorageAttributes::EncodingType FromInternalEncodingType(kudu::Encodin
     case kudu::GROUP_VARINT: return KuduColumnStorageAttributes::GROUP_VARINT;
     case kudu::RLE: return KuduColumnStorageAttributes::RLE;
     case kudu::BIT_SHUFFLE: return KuduColumnStorageAttributes::BIT_SHUFFLE;
+    case kudu::DELTA_BITPACK: return KuduColumnStorageAttributes::DELTA_BITPACK;
+    case kudu::FLOAT_XOR: return KuduColumnStorageAttributes::FLOAT_XOR;
     default: LOG(FATAL) << "Unexpected internal encoding type: " << type;
   }
 }
@@ -95,6 +99,7 @@ kudu::CompressionType ToInternalCompressionType(KuduColumnStorageAttributes::Com
     case KuduColumnStorageAttributes::SNAPPY: return kudu::SNAPPY;
     case KuduColumnStorageAttributes::LZ4: return kudu::LZ4;
     case KuduColumnStorageAttributes::ZLIB: return kudu::ZLIB;
+    case KuduColumnStorageAttributes::ZSTD: return kudu::ZSTD;
     default: LOG(FATAL) << "Unexpected compression type" << type;
   }
 }
@@ -107,6 +112,7 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     case kudu::SNAPPY: return KuduColumnStorageAttributes::SNAPPY;
     case kudu::LZ4: return KuduColumnStorageAttributes::LZ4;
     case kudu::ZLIB: return KuduColumnStorageAttributes::ZLIB;
+    case kudu::ZSTD: return KuduColumnStorageAttributes::ZSTD;
     default: LOG(FATAL) << "Unexpected internal compression type: " << type;
   }
 }
@@ -238,6 +244,24 @@ KuduColumnSpec* KuduColumnSpec::Encoding(
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::CompressionLevel(int32_t level) {
+  data_->has_compression_level = true;
+  data_->compression_level = level;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::Indexed(bool indexed) {
+  data_->has_indexed = true;
+  data_->indexed = indexed;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::TtlSeconds(int64_t ttl_seconds) {
+  data_->has_ttl_seconds = true;
+  data_->ttl_seconds = ttl_seconds;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::BlockSize(int32_t block_size) {
   data_->has_block_size = true;
   data_->block_size = block_size;
@@ -371,6 +395,22 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
                           default_val,
                           KuduColumnStorageAttributes(encoding, compression, block_size),
                           type_attrs);
+  // KuduColumnStorageAttributes can't hold the level, the index or the TTL
+  // without changing the ABI of the client library, so they're set on the
+  // column directly.
+  if (data_->has_compression_level || data_->has_indexed || data_->has_ttl_seconds) {
+    ColumnSchemaDelta delta(data_->name);
+    if (data_->has_compression_level) {
+      delta.compression_level = data_->compression_level;
+    }
+    if (data_->has_indexed) {
+      delta.indexed = data_->indexed;
+    }
+    if (data_->has_ttl_seconds) {
+      delta.ttl_seconds = data_->ttl_seconds;
+    }
+    RETURN_NOT_OK(col->col_->ApplyDelta(delta));
+  }
 
   return Status::OK();
 }
@@ -416,6 +456,18 @@ Status KuduColumnSpec::ToColumnSchemaDelta(ColumnSchemaDelta* col_delta) const {
     col_delta->cfile_block_size = boost::optional<int32_t>(data_->block_size);
   }
 
+  if (data_->has_compression_level) {
+    col_delta->compression_level = boost::optional<int32_t>(data_->compression_level);
+  }
+
+  if (data_->has_indexed) {
+    col_delta->indexed = boost::optional<bool>(data_->indexed);
+  }
+
+  if (data_->has_ttl_seconds) {
+    col_delta->ttl_seconds = boost::optional<int64_t>(data_->ttl_seconds);
+  }
+
   return Status::OK();
 }
 
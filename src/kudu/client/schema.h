@@ -114,6 +114,8 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     RLE = 4,
     DICT_ENCODING = 5,
     BIT_SHUFFLE = 6,
+    DELTA_BITPACK = 7,
+    FLOAT_XOR = 8,
 
     /// @deprecated GROUP_VARINT is not supported for valid types, and
     /// will fall back to another encoding on the server side.
@@ -127,6 +129,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -291,6 +294,46 @@ class KUDU_EXPORT KuduColumnSpec {
   /// @return Pointer to the modified object.
   KuduColumnSpec* Compression(KuduColumnStorageAttributes::CompressionType compression);
 
+  /// Set the compression level for the column.
+  ///
+  /// Only the ZLIB (levels 1 to 9) and ZSTD (levels 1 to 22) compression types
+  /// support levels: higher levels compress better but more slowly. The level
+  /// is ignored for other compression types.
+  ///
+  /// @param [in] level
+  ///   The compression level to use. 0 means the default level of the
+  ///   compression type.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* CompressionLevel(int32_t level);
+
+  /// Set whether the column has a secondary index.
+  ///
+  /// The rowsets flushed for an indexed column store a secondary index of its
+  /// values, which lets scans with equality or IN-list predicates on the column
+  /// read only the matching rows instead of scanning the whole column. Indexes
+  /// take up extra space and slow down flushes and compactions. Only columns
+  /// of types which are allowed in primary keys can be indexed.
+  ///
+  /// @note Changing this in an alter only affects rowsets flushed afterwards.
+  ///
+  /// @param [in] indexed
+  ///   Whether the column is indexed.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* Indexed(bool indexed);
+
+  /// Set the time-to-live of the rows, based on the value of this column.
+  ///
+  /// The rows whose value of the column is more than @c ttl_seconds older
+  /// than the current time of the tablet servers are expired: scans don't
+  /// return them, and flushes and compactions drop them from disk. Only a
+  /// column of type UNIXTIME_MICROS may have a TTL, and at most one column
+  /// of a table.
+  ///
+  /// @param [in] ttl_seconds
+  ///   The time-to-live of the rows, in seconds. 0 disables expiry.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* TtlSeconds(int64_t ttl_seconds);
+
   /// Set the preferred encoding for the column.
   ///
   /// @note Not all encodings are supported for all column types.
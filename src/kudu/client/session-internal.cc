@@ -17,9 +17,11 @@
 
 #include "kudu/client/session-internal.h"
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
 #include <boost/function.hpp>
@@ -29,6 +31,7 @@
 #include "kudu/client/callbacks.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/shared_ptr.h" // IWYU pragma: keep
+#include "kudu/client/write_flow_control.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/gutil/port.h"
@@ -37,6 +40,7 @@
 #include "kudu/util/logging.h"
 
 using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 
@@ -46,6 +50,7 @@ namespace client {
 
 using internal::Batcher;
 using internal::ErrorCollector;
+using internal::WriteFlowControl;
 
 using sp::shared_ptr;
 using sp::weak_ptr;
@@ -56,6 +61,7 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
     : client_(std::move(client)),
       messenger_(std::move(messenger)),
       error_collector_(new ErrorCollector()),
+      write_flow_control_(new WriteFlowControl()),
       external_consistency_mode_(CLIENT_PROPAGATED),
       flush_interval_(MonoDelta::FromMilliseconds(1000)),
       flush_task_active_(false),
@@ -331,6 +337,51 @@ MonoDelta KuduSession::Data::FlushCurrentBatcher(const MonoDelta& max_age) {
 // batcher (success path) or in the error collector (failure path). Otherwise
 // it would be a memory leak.
 Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
+  RETURN_NOT_OK(ValidateWriteOp(write_op));
+  return AddWriteOps({ write_op }, Batcher::GetOperationSizeInBuffer(write_op));
+}
+
+// Same as ApplyWriteOp(), the ownership of all the specified operations is
+// taken. The valid operations are added to the current batcher in chunks,
+// each taking only a fraction of the buffer space, so the flushes in
+// AUTO_FLUSH_BACKGROUND mode happen at about the same points as if the
+// operations were applied one by one.
+Status KuduSession::Data::ApplyWriteOps(const vector<KuduWriteOperation*>& write_ops) {
+  const int64_t max_chunk_size = std::max<int64_t>(buffer_bytes_limit_ / 4, 1);
+  Status first_error;
+  vector<KuduWriteOperation*> chunk;
+  int64_t chunk_size = 0;
+  const auto add_chunk = [&]() {
+    if (chunk.empty()) {
+      return;
+    }
+    Status s = AddWriteOps(chunk, chunk_size);
+    if (!s.ok() && first_error.ok()) {
+      first_error = s;
+    }
+    chunk.clear();
+    chunk_size = 0;
+  };
+  for (KuduWriteOperation* write_op : write_ops) {
+    Status s = ValidateWriteOp(write_op);
+    if (PREDICT_FALSE(!s.ok())) {
+      if (first_error.ok()) {
+        first_error = s;
+      }
+      continue;
+    }
+    const int64_t required_size = Batcher::GetOperationSizeInBuffer(write_op);
+    if (!chunk.empty() && chunk_size + required_size > max_chunk_size) {
+      add_chunk();
+    }
+    chunk.push_back(write_op);
+    chunk_size += required_size;
+  }
+  add_chunk();
+  return first_error;
+}
+
+Status KuduSession::Data::ValidateWriteOp(KuduWriteOperation* write_op) {
   if (PREDICT_FALSE(!write_op)) {
     return Status::InvalidArgument("NULL operation");
   }
@@ -339,10 +390,23 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     error_collector_->AddError(unique_ptr<KuduError>(new KuduError(write_op, status)));
     return status;
   }
+  return Status::OK();
+}
 
-  // Get 'wire size' of the write operation.
-  const int64_t required_size = Batcher::GetOperationSizeInBuffer(write_op);
+Status KuduSession::Data::AddWriteOpsOneByOne(const vector<KuduWriteOperation*>& write_ops) {
+  Status first_error;
+  for (KuduWriteOperation* write_op : write_ops) {
+    Status s = AddWriteOps({ write_op }, Batcher::GetOperationSizeInBuffer(write_op));
+    if (!s.ok() && first_error.ok()) {
+      first_error = s;
+    }
+  }
+  return first_error;
+}
 
+Status KuduSession::Data::AddWriteOps(const vector<KuduWriteOperation*>& write_ops,
+                                      int64_t required_size) {
+  DCHECK(!write_ops.empty());
   const size_t max_size = buffer_bytes_limit_;
   // Thread-safety note: the flush_mode_ is accessed from the background
   // time-based flush task for reading. Practically, it would be possible
@@ -358,11 +422,14 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
   // verify that the single operation can fit into an empty buffer
   // given the restriction on the buffer size.
   if (PREDICT_FALSE(required_size > max_size)) {
+    if (write_ops.size() > 1) {
+      return AddWriteOpsOneByOne(write_ops);
+    }
     Status s = Status::Incomplete(strings::Substitute(
           "buffer size limit is too small to fit operation: "
           "required $0, size limit $1",
           required_size, max_size));
-    error_collector_->AddError(unique_ptr<KuduError>(new KuduError(write_op, s)));
+    error_collector_->AddError(unique_ptr<KuduError>(new KuduError(write_ops[0], s)));
     return s;
   }
 
@@ -394,7 +461,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     }
   }
   {
-    std::lock_guard<Mutex> l(mutex_);
+    std::unique_lock<Mutex> l(mutex_);
     if (flush_mode == AUTO_FLUSH_BACKGROUND) {
       // In AUTO_FLUSH_BACKGROUND mode Apply() blocks if total would-be-used
       // buffer space is over the limit. Once amount of buffered data drops
@@ -403,12 +470,17 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
         condition_.Wait();
       }
     } else if (PREDICT_FALSE(buffer_bytes_used_ + required_size > max_size)) {
+      if (write_ops.size() > 1) {
+        // Let the operations which still fit into the buffer in.
+        l.unlock();
+        return AddWriteOpsOneByOne(write_ops);
+      }
       Status s = Status::Incomplete(strings::Substitute(
           "not enough mutation buffer space remaining for operation: "
           "required additional $0 when $1 of $2 already used",
           required_size, buffer_bytes_used_, max_size));
       error_collector_->AddError(
-          unique_ptr<KuduError>(new KuduError(write_op, s)));
+          unique_ptr<KuduError>(new KuduError(write_ops[0], s)));
       return s;
     }
 
@@ -427,17 +499,25 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       // no thread-safety is advertised for the kudu::KuduSession interface.
       scoped_refptr<Batcher> batcher(
           new Batcher(client_.get(), error_collector_, session_,
-                      external_consistency_mode_));
+                      external_consistency_mode_,
+                      flush_mode == AUTO_FLUSH_BACKGROUND ? write_flow_control_
+                                                           : scoped_refptr<WriteFlowControl>()));
       if (timeout_.Initialized()) {
         batcher->SetTimeout(timeout_);
       }
       batcher.swap(batcher_);
       ++batchers_num_;
     }
-    Status op_add_status = batcher_->Add(write_op);
+    Status op_add_status = write_ops.size() == 1 ? batcher_->Add(write_ops[0])
+                                                 : batcher_->Add(write_ops);
     if (PREDICT_FALSE(!op_add_status.ok())) {
+      if (write_ops.size() > 1) {
+        // Nothing has been added: report the malformed operations one by one.
+        l.unlock();
+        return AddWriteOpsOneByOne(write_ops);
+      }
       error_collector_->AddError(
-          unique_ptr<KuduError>(new KuduError(write_op, op_add_status)));
+          unique_ptr<KuduError>(new KuduError(write_ops[0], op_add_status)));
       return op_add_status;
     }
     // Finally, update the buffer space usage.
@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -27,6 +28,7 @@
 #include "kudu/client/client.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_flow_control.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
@@ -133,6 +135,23 @@ class KuduSession::Data {
   // Apply a write operation, i.e. push it through the batcher chain.
   Status ApplyWriteOp(KuduWriteOperation* write_op);
 
+  // Apply a sequence of write operations, in order. Returns the first error,
+  // if any; the operations which failed are reported to the error collector.
+  Status ApplyWriteOps(const std::vector<KuduWriteOperation*>& write_ops);
+
+  // Check that 'write_op' is not NULL and has its key set. A malformed
+  // operation is reported to the error collector.
+  Status ValidateWriteOp(KuduWriteOperation* write_op);
+
+  // Add the validated 'write_ops', 'required_size' bytes in buffer in total,
+  // to the current batcher as a unit, waiting for buffer space or flushing
+  // according to the flush mode.
+  Status AddWriteOps(const std::vector<KuduWriteOperation*>& write_ops,
+                     int64_t required_size);
+
+  // Add each of the validated 'write_ops' with AddWriteOps() separately.
+  Status AddWriteOpsOneByOne(const std::vector<KuduWriteOperation*>& write_ops);
+
   // Check and start the time-based flush task in background, if necessary.
   void TimeBasedFlushInit();
 
@@ -178,6 +197,10 @@ class KuduSession::Data {
   // Buffer for errors.
   scoped_refptr<internal::ErrorCollector> error_collector_;
 
+  // Limits the write RPCs in flight to each tablet server in
+  // AUTO_FLUSH_BACKGROUND mode, adapting to the load of the servers.
+  scoped_refptr<internal::WriteFlowControl> write_flow_control_;
+
   kudu::client::KuduSession::ExternalConsistencyMode external_consistency_mode_;
 
   // Timeout for the next batch.
@@ -104,6 +104,9 @@ Status KuduTableAlterer::Data::ToRequest(AlterTableRequestPB* req) {
             !s.spec->data_->remove_default &&
             !s.spec->data_->has_encoding &&
             !s.spec->data_->has_compression &&
+            !s.spec->data_->has_compression_level &&
+            !s.spec->data_->has_indexed &&
+            !s.spec->data_->has_ttl_seconds &&
             !s.spec->data_->has_block_size) {
           return Status::InvalidArgument("no alter operation specified",
                                          s.spec->data_->name);
@@ -116,6 +119,9 @@ Status KuduTableAlterer::Data::ToRequest(AlterTableRequestPB* req) {
             !s.spec->data_->remove_default &&
             !s.spec->data_->has_encoding &&
             !s.spec->data_->has_compression &&
+            !s.spec->data_->has_compression_level &&
+            !s.spec->data_->has_indexed &&
+            !s.spec->data_->has_ttl_seconds &&
             !s.spec->data_->has_block_size) {
           pb_step->set_type(AlterTableRequestPB::RENAME_COLUMN);
           pb_step->mutable_rename_column()->set_old_name(s.spec->data_->name);
@@ -61,6 +61,8 @@ class KuduTableCreator::Data {
 
   boost::optional<int> num_replicas_;
 
+  boost::optional<int> num_read_replicas_;
+
   MonoDelta timeout_;
 
   bool wait_;
@@ -0,0 +1,168 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/write_flow_control.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(client_write_window_initial, 8,
+             "Initial number of write RPCs a session in AUTO_FLUSH_BACKGROUND "
+             "mode may have in flight to a tablet server. The number adapts "
+             "to the observed latency and rejections of the server.");
+TAG_FLAG(client_write_window_initial, advanced);
+
+DEFINE_int32(client_write_window_max, 64,
+             "Maximum number of write RPCs a session in AUTO_FLUSH_BACKGROUND "
+             "mode may have in flight to a tablet server.");
+TAG_FLAG(client_write_window_max, advanced);
+
+DEFINE_double(client_write_window_latency_factor, 8.0,
+              "A write RPC whose latency exceeds the lowest latency observed "
+              "for its tablet server by this factor decreases the number of "
+              "write RPCs allowed in flight to the server, as a rejection by "
+              "a busy server does. Set to 0 to only react to rejections.");
+TAG_FLAG(client_write_window_latency_factor, advanced);
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace client {
+namespace internal {
+
+const char* const WriteFlowControl::kWritesDeferredMetric = "write_rpcs_deferred";
+const char* const WriteFlowControl::kServerBusyMetric = "write_server_busy_responses";
+const char* const WriteFlowControl::kWindowDecreasesMetric = "write_window_decreases";
+
+WriteFlowControl::Slot::Slot(scoped_refptr<WriteFlowControl> flow_control,
+                             string server_uuid,
+                             int64_t seq_no)
+    : flow_control_(std::move(flow_control)),
+      server_uuid_(std::move(server_uuid)),
+      seq_no_(seq_no),
+      start_time_(MonoTime::Now()),
+      server_busy_(false) {
+}
+
+WriteFlowControl::Slot::~Slot() {
+  flow_control_->Release(server_uuid_, seq_no_, server_busy_.load(),
+                         MonoTime::Now() - start_time_);
+}
+
+void WriteFlowControl::Slot::MarkServerBusy() {
+  flow_control_->metrics_.Increment(kServerBusyMetric, 1);
+  server_busy_ = true;
+}
+
+WriteFlowControl::ServerState::ServerState()
+    : window(std::max(1, FLAGS_client_write_window_initial)),
+      in_flight(0),
+      next_seq_no(0),
+      min_seq_no_to_decrease(0) {
+}
+
+WriteFlowControl::WriteFlowControl() {
+}
+
+WriteFlowControl::~WriteFlowControl() {
+  for (const auto& e : servers_) {
+    DCHECK_EQ(0, e.second.in_flight);
+    DCHECK(e.second.pending.empty());
+  }
+}
+
+void WriteFlowControl::Send(const string& server_uuid, SendFunction send) {
+  shared_ptr<Slot> slot;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    ServerState* server = &servers_[server_uuid];
+    if (server->in_flight >= static_cast<int>(server->window)) {
+      VLOG(2) << "Deferring writes to " << server_uuid << ": " << server->in_flight
+              << " in flight, window " << server->window;
+      server->pending.emplace_back(std::move(send));
+      metrics_.Increment(kWritesDeferredMetric, 1);
+      return;
+    }
+    server->in_flight++;
+    slot.reset(new Slot(this, server_uuid, server->next_seq_no++));
+  }
+  send(slot);
+}
+
+int WriteFlowControl::GetWindowForTests(const string& server_uuid) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  const ServerState* server = FindOrNull(servers_, server_uuid);
+  return server ? static_cast<int>(server->window) : FLAGS_client_write_window_initial;
+}
+
+void WriteFlowControl::Release(const string& server_uuid, int64_t seq_no,
+                               bool server_busy, const MonoDelta& latency) {
+  vector<std::pair<SendFunction, shared_ptr<Slot>>> to_send;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    ServerState* server = FindOrNull(servers_, server_uuid);
+    DCHECK(server);
+    server->in_flight--;
+
+    bool congested = server_busy;
+    if (!server->min_latency.Initialized() || latency < server->min_latency) {
+      server->min_latency = latency;
+    } else if (FLAGS_client_write_window_latency_factor > 0 &&
+               latency.ToSeconds() > server->min_latency.ToSeconds() *
+                                     FLAGS_client_write_window_latency_factor) {
+      congested = true;
+    }
+
+    if (!congested) {
+      const double max_window = std::max(1, FLAGS_client_write_window_max);
+      server->window = std::min(max_window, server->window + 1.0 / server->window);
+    } else if (seq_no >= server->min_seq_no_to_decrease) {
+      // Decrease the window at most once per window's worth of writes:
+      // the units in flight at the time were sent under the old window.
+      server->window = std::max(1.0, server->window / 2);
+      server->min_seq_no_to_decrease = server->next_seq_no;
+      metrics_.Increment(kWindowDecreasesMetric, 1);
+      VLOG(1) << "Decreased write window of " << server_uuid << " to " << server->window
+              << (server_busy ? ": server busy" : ": latency " + latency.ToString());
+    }
+
+    while (!server->pending.empty() &&
+           server->in_flight < static_cast<int>(server->window)) {
+      server->in_flight++;
+      shared_ptr<Slot> slot(new Slot(this, server_uuid, server->next_seq_no++));
+      to_send.emplace_back(std::move(server->pending.front()), std::move(slot));
+      server->pending.pop_front();
+    }
+  }
+  for (auto& e : to_send) {
+    e.first(e.second);
+  }
+}
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/client/resource_metrics.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace client {
+namespace internal {
+
+// Limits the number of write RPCs a session has in flight to each tablet
+// server, so that an overloaded server is not hammered with more writes
+// and retries than it can absorb.
+//
+// The limit of each server is a window adjusted AIMD-style: it grows by one
+// per window's worth of writes which complete without a sign of overload, and
+// is halved when a write is rejected by a busy server (ERROR_SERVER_TOO_BUSY,
+// memory pressure or throttling) or when its latency rises well above the
+// lowest latency observed for that server. The writes which don't fit into
+// the window are queued, and the buffer space they hold makes Apply() block,
+// which propagates the backpressure up to the application.
+class WriteFlowControl : public RefCountedThreadSafe<WriteFlowControl> {
+ public:
+  // Held by the write RPCs sent as a unit to a tablet server. The unit leaves
+  // the server's window once the last of its RPCs drops its reference.
+  class Slot {
+   public:
+    ~Slot();
+
+    // Record that the server rejected a write because it is overloaded.
+    void MarkServerBusy();
+
+   private:
+    friend class WriteFlowControl;
+
+    Slot(scoped_refptr<WriteFlowControl> flow_control,
+         std::string server_uuid,
+         int64_t seq_no);
+
+    const scoped_refptr<WriteFlowControl> flow_control_;
+    const std::string server_uuid_;
+
+    // The sequence number of the unit among the units sent to the server.
+    const int64_t seq_no_;
+
+    const MonoTime start_time_;
+    std::atomic<bool> server_busy_;
+
+    DISALLOW_COPY_AND_ASSIGN(Slot);
+  };
+
+  typedef std::function<void(const std::shared_ptr<Slot>&)> SendFunction;
+
+  // Names of the metrics maintained in metrics().
+  static const char* const kWritesDeferredMetric;
+  static const char* const kServerBusyMetric;
+  static const char* const kWindowDecreasesMetric;
+
+  WriteFlowControl();
+
+  // Runs 'send' with a new slot once the unit of writes it sends fits into
+  // the window of the server with the given UUID: either inline or, if the
+  // window is full, when a unit in flight to the server completes.
+  void Send(const std::string& server_uuid, SendFunction send);
+
+  // Returns the current window of the server with the given UUID.
+  int GetWindowForTests(const std::string& server_uuid) const;
+
+  const ResourceMetrics& metrics() const { return metrics_; }
+
+ private:
+  friend class RefCountedThreadSafe<WriteFlowControl>;
+
+  struct ServerState {
+    ServerState();
+
+    // The number of units which may be in flight to the server. Kept
+    // fractional so that the additive increase can be spread over a window.
+    double window;
+
+    // The number of units in flight to the server.
+    int in_flight;
+
+    // The sequence number of the next unit sent to the server.
+    int64_t next_seq_no;
+
+    // Units sent before this sequence number were in flight when the window
+    // was last decreased: their congestion signals don't decrease it again.
+    int64_t min_seq_no_to_decrease;
+
+    // The lowest latency of the units completed so far.
+    MonoDelta min_latency;
+
+    // The units waiting for room in the window.
+    std::deque<SendFunction> pending;
+  };
+
+  ~WriteFlowControl();
+
+  // Called when the unit with the given sequence number completes.
+  void Release(const std::string& server_uuid, int64_t seq_no,
+               bool server_busy, const MonoDelta& latency);
+
+  mutable simple_spinlock lock_;
+  std::unordered_map<std::string, ServerState> servers_;
+
+  ResourceMetrics metrics_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteFlowControl);
+};
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -44,6 +45,7 @@
 
 
 DECLARE_bool(inject_unsync_time_errors);
+DECLARE_string(ptp_device);
 DECLARE_string(time_source);
 
 using std::string;
@@ -305,6 +307,37 @@ TEST_F(HybridClockTest, TestClockDoesntGoBackwardsWithUpdates) {
   }
 }
 
+// Concurrent readers of the clock should never be issued the same timestamp,
+// and every reader should see its timestamps increase.
+TEST_F(HybridClockTest, TestConcurrentNowIssuesUniqueTimestamps) {
+  const int kNumThreads = 4;
+  const int kNumReadsPerThread = 100000;
+  vector<vector<uint64_t>> timestamps(kNumThreads);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&, i]() {
+        auto& values = timestamps[i];
+        values.reserve(kNumReadsPerThread);
+        for (int j = 0; j < kNumReadsPerThread; j++) {
+          values.push_back(clock_->Now().value());
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  vector<uint64_t> all;
+  for (const auto& values : timestamps) {
+    for (int j = 1; j < values.size(); j++) {
+      ASSERT_LT(values[j - 1], values[j]);
+    }
+    all.insert(all.end(), values.begin(), values.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
 TEST_F(HybridClockTest, TestGetPhysicalComponentDifference) {
   Timestamp now1 = HybridClock::TimestampFromMicrosecondsAndLogicalValue(100, 100);
   SleepFor(MonoDelta::FromMilliseconds(1));
@@ -351,6 +384,17 @@ TEST_F(HybridClockTest, TestRideOverNtpInterruption) {
 }
 
 #ifndef __APPLE__
+// The 'ptp' time source requires a PTP hardware clock to read from.
+TEST(PtpHybridClockTest, TestInitFailsWithoutDevice) {
+  google::FlagSaver saver;
+  FLAGS_time_source = "ptp";
+  FLAGS_ptp_device = "/dev/nonexistent-ptp-device";
+  scoped_refptr<HybridClock> clock(new HybridClock);
+  Status s = clock->Init();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "/dev/nonexistent-ptp-device");
+}
+
 TEST_F(HybridClockTest, TestNtpDiagnostics) {
   vector<string> log;
   clock_->time_service()->DumpDiagnostics(&log);
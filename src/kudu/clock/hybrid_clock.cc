@@ -28,6 +28,7 @@
 
 #include "kudu/clock/mock_ntp.h"
 #include "kudu/clock/system_ntp.h"
+#include "kudu/clock/system_ptp.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/macros.h"
@@ -60,15 +61,17 @@ TAG_FLAG(use_hybrid_clock, hidden);
 
 DEFINE_string(time_source, "system",
               "The clock source that HybridClock should use. Must be one of "
-              "'system' or 'mock' (for tests only)");
+              "'system', 'ptp' (a PTP hardware clock, see --ptp_device and "
+              "--ptp_max_error_usec; Linux only) or 'mock' (for tests only)");
 TAG_FLAG(time_source, experimental);
 DEFINE_validator(time_source, [](const char* /* flag_name */, const string& value) {
     if (boost::iequals(value, "system") ||
+        boost::iequals(value, "ptp") ||
         boost::iequals(value, "mock")) {
       return true;
     }
     LOG(ERROR) << "unknown value for 'time_source': '" << value << "'"
-               << " (expected one of 'system' or 'mock')";
+               << " (expected one of 'system', 'ptp' or 'mock')";
     return false;
   });
 
@@ -122,6 +125,12 @@ Status HybridClock::Init() {
     time_service_.reset(new clock::SystemNtp());
 #else
     time_service_.reset(new clock::SystemUnsyncTime());
+#endif
+  } else if (boost::iequals(FLAGS_time_source, "ptp")) {
+#ifndef __APPLE__
+    time_service_.reset(new clock::SystemPtp());
+#else
+    return Status::NotSupported("PTP hardware clocks are only supported on Linux");
 #endif
   } else {
     return Status::InvalidArgument("invalid NTP source", FLAGS_time_source);
@@ -136,8 +145,6 @@ Status HybridClock::Init() {
 Timestamp HybridClock::Now() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return now;
 }
@@ -145,11 +152,7 @@ Timestamp HybridClock::Now() {
 Timestamp HybridClock::NowLatest() {
   Timestamp now;
   uint64_t error;
-
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   uint64_t now_latest = GetPhysicalValueMicros(now) + error;
   uint64_t now_logical = GetLogicalValue(now);
@@ -174,11 +177,18 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
   // If the physical time from the system clock is higher than our last-returned
-  // time, we should use the physical timestamp.
-  uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
-  if (PREDICT_TRUE(candidate_phys_timestamp > next_timestamp_)) {
-    next_timestamp_ = candidate_phys_timestamp;
-    *timestamp = Timestamp(next_timestamp_++);
+  // time, we should use the physical timestamp. Otherwise, we return the next
+  // timestamp and increment its logical value. Retry if another thread issued
+  // a timestamp in the meantime.
+  const uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
+  uint64_t next_timestamp = next_timestamp_.load();
+  uint64_t timestamp_value;
+  do {
+    timestamp_value = std::max(candidate_phys_timestamp, next_timestamp);
+  } while (!next_timestamp_.compare_exchange_weak(next_timestamp, timestamp_value + 1));
+  *timestamp = Timestamp(timestamp_value);
+
+  if (PREDICT_TRUE(timestamp_value == candidate_phys_timestamp)) {
     *max_error_usec = error_usec;
     if (PREDICT_FALSE(VLOG_IS_ON(2))) {
       VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
@@ -206,8 +216,7 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   // This broadens the error interval for both cases but always returns
   // a correct error interval.
 
-  *max_error_usec = (next_timestamp_ >> kBitsToShift) - (now_usec - error_usec);
-  *timestamp = Timestamp(next_timestamp_++);
+  *max_error_usec = (timestamp_value >> kBitsToShift) - (now_usec - error_usec);
   if (PREDICT_FALSE(VLOG_IS_ON(2))) {
     VLOG(2) << "Current clock is lower than the last one. Returning last read and incrementing"
         " logical values. Clock: " + Stringify(*timestamp) << " Error: " << *max_error_usec;
@@ -215,7 +224,6 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
 }
 
 Status HybridClock::Update(const Timestamp& to_update) {
-  std::lock_guard<simple_spinlock> lock(lock_);
   Timestamp now;
   uint64_t error_ignored;
   NowWithError(&now, &error_ignored);
@@ -237,8 +245,12 @@ Status HybridClock::Update(const Timestamp& to_update) {
   }
 
   // Our next timestamp must be higher than the one that we are updating
-  // from.
-  next_timestamp_ = to_update.value() + 1;
+  // from. Other threads may have moved it even higher in the meantime, in
+  // which case there's nothing to do.
+  uint64_t next_timestamp = next_timestamp_.load();
+  while (next_timestamp <= to_update.value() &&
+         !next_timestamp_.compare_exchange_weak(next_timestamp, to_update.value() + 1)) {
+  }
   return Status::OK();
 }
 
@@ -260,10 +272,7 @@ Status HybridClock::WaitUntilAfter(const Timestamp& then,
   TRACE_EVENT0("clock", "HybridClock::WaitUntilAfter");
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   // "unshift" the timestamps so that we can measure actual time
   uint64_t now_usec = GetPhysicalValueMicros(now);
@@ -304,10 +313,7 @@ Status HybridClock::WaitUntilAfterLocally(const Timestamp& then,
   while (true) {
     Timestamp now;
     uint64_t error;
-    {
-      std::lock_guard<simple_spinlock> lock(lock_);
-      NowWithError(&now, &error);
-    }
+    NowWithError(&now, &error);
     if (now > then) {
       return Status::OK();
     }
@@ -325,11 +331,7 @@ bool HybridClock::IsAfter(Timestamp t) {
   uint64_t error_usec;
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
-  Timestamp now;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    now = Timestamp(std::max(next_timestamp_, now_usec << kBitsToShift));
-  }
+  Timestamp now(std::max(next_timestamp_.load(), now_usec << kBitsToShift));
   return t.value() < now.value();
 }
 
@@ -371,9 +373,13 @@ Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec)
     MonoTime read_time_max_likelihood = read_time_before +
         MonoDelta::FromMicroseconds(read_time_error_us);
 
-    std::unique_lock<simple_spinlock> l(last_clock_read_lock_);
-    if (!last_clock_read_time_.Initialized() ||
-        last_clock_read_time_ < read_time_max_likelihood) {
+    //
+    // If another thread is recording its own reading, skip recording this one:
+    // the other one is just as recent.
+    std::unique_lock<simple_spinlock> l(last_clock_read_lock_, std::try_to_lock);
+    if (l.owns_lock() &&
+        (!last_clock_read_time_.Initialized() ||
+         last_clock_read_time_ < read_time_max_likelihood)) {
       last_clock_read_time_ = read_time_max_likelihood;
       last_clock_read_physical_ = *now_usec;
       last_clock_read_error_ = *error_usec + read_time_error_us;
@@ -419,8 +425,6 @@ uint64_t HybridClock::NowForMetrics() {
 uint64_t HybridClock::ErrorForMetrics() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return error;
 }
@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -124,6 +125,9 @@ class HybridClock : public Clock {
   // error in micros. This may fail if the clock is unsynchronized or synchronized
   // but the error is too high and, since we can't do anything about it,
   // LOG(FATAL)'s in that case.
+  //
+  // Lock-free: concurrent callers are issued distinct timestamps with a
+  // compare-and-swap on 'next_timestamp_'.
   void NowWithError(Timestamp* timestamp, uint64_t* max_error_usec);
 
   virtual std::string Stringify(Timestamp timestamp) OVERRIDE;
@@ -179,14 +183,14 @@ class HybridClock : public Clock {
   // service.
   std::unique_ptr<clock::TimeService> time_service_;
 
-  mutable simple_spinlock lock_;
-
   // The next timestamp to be generated from this clock, assuming that
   // the physical clock hasn't advanced beyond the value stored here.
-  uint64_t next_timestamp_;
+  std::atomic<uint64_t> next_timestamp_;
 
   // The last valid clock reading we got from the time source, along
-  // with the monotime that we took that reading.
+  // with the monotime that we took that reading. Only used to extrapolate
+  // the time when the time source fails, so concurrent readers skip updating
+  // it rather than wait for one another.
   mutable simple_spinlock last_clock_read_lock_;
   MonoTime last_clock_read_time_;
   uint64_t last_clock_read_physical_;
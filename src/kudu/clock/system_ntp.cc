@@ -20,23 +20,37 @@
 #include <sys/time.h>
 #include <sys/timex.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <ostream>
 #include <string>
 #include <vector>
 
-#include <gflags/gflags_declare.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/util/errno.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/subprocess.h"
 
+DEFINE_int32(ntp_error_refresh_interval_ms, 100,
+             "How often the clock error bound is read from the kernel, in "
+             "milliseconds. In between, the time is read on its own and the "
+             "last error bound is extrapolated with the maximum clock skew. "
+             "A loss of clock synchronization may go unnoticed for up to this "
+             "long. 0 reads the error bound along with every clock reading.");
+TAG_FLAG(ntp_error_refresh_interval_ms, advanced);
+TAG_FLAG(ntp_error_refresh_interval_ms, experimental);
+TAG_FLAG(ntp_error_refresh_interval_ms, runtime);
+
 DECLARE_bool(inject_unsync_time_errors);
 
 using std::string;
@@ -51,6 +65,11 @@ const uint64_t SystemNtp::kMicrosPerSec = 1000000;
 
 namespace {
 
+// The number of bits of SystemNtp::cached_error_ holding the error bound,
+// which allows for error bounds of up to ~4 seconds to be cached.
+const int kCachedErrorBits = 22;
+const uint64_t kCachedErrorMask = (1ULL << kCachedErrorBits) - 1;
+
 // Returns the current time/max error and checks if the clock is synchronized.
 Status CallAdjTime(timex* tx) {
   // Set mode to 0 to query the current time.
@@ -150,6 +169,21 @@ Status SystemNtp::Init() {
 
 Status SystemNtp::WalltimeWithError(uint64_t *now_usec,
                                     uint64_t *error_usec) {
+  const uint64_t refresh_interval_ms = std::max(FLAGS_ntp_error_refresh_interval_ms, 0);
+  if (refresh_interval_ms > 0 && PREDICT_TRUE(!FLAGS_inject_unsync_time_errors)) {
+    const uint64_t now = GetCurrentTimeMicros();
+    const uint64_t cached = cached_error_.load(std::memory_order_acquire);
+    const uint64_t valid_until_ms = cached >> kCachedErrorBits;
+    const uint64_t now_ms = now / 1000;
+    // Don't trust the cached error bound if the clock went backwards since it
+    // was cached.
+    if (now_ms < valid_until_ms && now_ms + refresh_interval_ms >= valid_until_ms) {
+      *now_usec = now;
+      *error_usec = cached & kCachedErrorMask;
+      return Status::OK();
+    }
+  }
+
   // Read the time. This will return an error if the clock is not synchronized.
   timex tx;
   RETURN_NOT_OK(CallAdjTime(&tx));
@@ -161,6 +195,18 @@ Status SystemNtp::WalltimeWithError(uint64_t *now_usec,
 
   *now_usec = tx.time.tv_sec * kMicrosPerSec + tx.time.tv_usec;
   *error_usec = tx.maxerror;
+
+  if (refresh_interval_ms > 0) {
+    // Cache the error bound as of the end of the refresh interval, which is
+    // the current one plus the maximum skew over the interval.
+    const uint64_t error_at_refresh = *error_usec +
+        (refresh_interval_ms * 1000 * skew_ppm_ + kMicrosPerSec - 1) / kMicrosPerSec;
+    if (error_at_refresh <= kCachedErrorMask) {
+      const uint64_t valid_until_ms = *now_usec / 1000 + refresh_interval_ms;
+      cached_error_.store((valid_until_ms << kCachedErrorBits) | error_at_refresh,
+                          std::memory_order_release);
+    }
+  }
   return Status::OK();
 }
 
@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -33,6 +34,11 @@ namespace clock {
 //
 // This implementation relies on the ntpd service running on the local host
 // to keep the kernel's timekeeping up to date and in sync.
+//
+// Since 'ntp_adjtime' is a full system call, the error bound it reports is
+// cached for --ntp_error_refresh_interval_ms, during which the time is read
+// with the much cheaper clock_gettime(CLOCK_REALTIME) and the cached error
+// bound, grown by the maximum skew over the interval, is returned along with it.
 class SystemNtp : public TimeService {
  public:
   SystemNtp() = default;
@@ -59,6 +65,12 @@ class SystemNtp : public TimeService {
   // The skew rate in PPM reported by the kernel.
   uint64_t skew_ppm_ = 0;
 
+  // The cached error bound in its low kCachedErrorBits bits, and the time
+  // until which it's valid in milliseconds since the epoch in the remaining
+  // high bits, so that both can be read and updated atomically. 0 if nothing
+  // is cached.
+  std::atomic<uint64_t> cached_error_{0};
+
   DISALLOW_COPY_AND_ASSIGN(SystemNtp);
 };
 
@@ -0,0 +1,165 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/clock/system_ptp.h"
+
+#include <fcntl.h>
+#include <sys/timex.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/os-util.h"
+#include "kudu/util/status.h"
+
+DEFINE_string(ptp_device, "/dev/ptp0",
+              "The PTP hardware clock device read by the 'ptp' time source.");
+TAG_FLAG(ptp_device, experimental);
+
+DEFINE_int32(ptp_max_error_usec, 100,
+             "The maximum error of the PTP hardware clock read by the 'ptp' "
+             "time source, in microseconds. This must be at least the accuracy "
+             "with which the PTP deployment keeps the clocks of all the "
+             "servers of the cluster synchronized with true time.");
+TAG_FLAG(ptp_max_error_usec, experimental);
+TAG_FLAG(ptp_max_error_usec, runtime);
+
+DEFINE_int32(ptp_utc_offset_sec, -1,
+             "The number of seconds to subtract from the time of the PTP "
+             "hardware clock read by the 'ptp' time source to obtain UTC. "
+             "PTP hardware clocks usually keep TAI, which is ahead of UTC by "
+             "the number of leap seconds. If -1, the TAI offset of the kernel "
+             "is used, which must then be set, e.g. by phc2sys or the NTP "
+             "daemon. Set to 0 if the clock keeps UTC.");
+TAG_FLAG(ptp_utc_offset_sec, experimental);
+
+DECLARE_bool(inject_unsync_time_errors);
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace clock {
+
+namespace {
+
+// The clock id of the dynamic POSIX clock of an opened character device, as
+// defined by the kernel's clock id encoding for file descriptors.
+clockid_t FdToClockId(int fd) {
+  return static_cast<clockid_t>((~static_cast<unsigned int>(fd) << 3) | 3);
+}
+
+} // anonymous namespace
+
+SystemPtp::~SystemPtp() {
+  if (fd_ >= 0) {
+    int err;
+    RETRY_ON_EINTR(err, close(fd_));
+  }
+}
+
+Status SystemPtp::Init() {
+  RETRY_ON_EINTR(fd_, open(FLAGS_ptp_device.c_str(), O_RDONLY));
+  if (fd_ < 0) {
+    int err = errno;
+    return Status::IOError(Substitute("unable to open PTP hardware clock $0",
+                                      FLAGS_ptp_device), ErrnoToString(err), err);
+  }
+  clock_id_ = FdToClockId(fd_);
+
+  if (FLAGS_ptp_utc_offset_sec >= 0) {
+    utc_offset_sec_ = FLAGS_ptp_utc_offset_sec;
+  } else {
+    timex tx;
+    tx.modes = 0;
+    if (ntp_adjtime(&tx) == -1) {
+      int err = errno;
+      return Status::IOError("unable to read the TAI offset of the kernel",
+                             ErrnoToString(err), err);
+    }
+    if (tx.tai <= 0) {
+      return Status::IllegalState(
+          "the TAI offset of the kernel is not set: set --ptp_utc_offset_sec "
+          "to the offset of the PTP hardware clock from UTC");
+    }
+    utc_offset_sec_ = tx.tai;
+  }
+
+  uint64_t now_usec;
+  RETURN_NOT_OK(ReadClock(&now_usec));
+  const int64_t offset_from_system_usec =
+      static_cast<int64_t>(now_usec) - GetCurrentTimeMicros();
+  LOG(INFO) << "PTP hardware clock " << FLAGS_ptp_device << " initialized."
+            << " UTC offset: " << utc_offset_sec_ << "s"
+            << " Offset from the system clock: " << offset_from_system_usec << "us"
+            << " Max error: " << FLAGS_ptp_max_error_usec << "us";
+  return Status::OK();
+}
+
+Status SystemPtp::ReadClock(uint64_t* now_usec) const {
+  timespec ts;
+  if (PREDICT_FALSE(clock_gettime(clock_id_, &ts) != 0)) {
+    int err = errno;
+    return Status::ServiceUnavailable(Substitute("unable to read PTP hardware clock $0",
+                                                 FLAGS_ptp_device), ErrnoToString(err), err);
+  }
+  *now_usec = (ts.tv_sec - utc_offset_sec_) * 1000000ULL + ts.tv_nsec / 1000;
+  return Status::OK();
+}
+
+Status SystemPtp::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
+  if (PREDICT_FALSE(FLAGS_inject_unsync_time_errors)) {
+    return Status::ServiceUnavailable("Error reading clock. Clock considered unsynchronized");
+  }
+  // Reading a PHC is a system call which may take a few microseconds, and the
+  // time may have been read at any point during it.
+  const int64_t read_start_usec = GetMonoTimeMicros();
+  RETURN_NOT_OK(ReadClock(now_usec));
+  const int64_t read_usec = GetMonoTimeMicros() - read_start_usec;
+  *error_usec = FLAGS_ptp_max_error_usec + read_usec;
+  return Status::OK();
+}
+
+void SystemPtp::DumpDiagnostics(vector<string>* log) const {
+  LOG_STRING(ERROR, log) << "Dumping PTP diagnostics";
+  uint64_t now_usec;
+  Status s = ReadClock(&now_usec);
+  if (!s.ok()) {
+    LOG_STRING(ERROR, log) << s.ToString();
+    return;
+  }
+  LOG_STRING(ERROR, log) << "PTP hardware clock " << FLAGS_ptp_device
+                         << ": " << now_usec << "us (UTC offset: "
+                         << utc_offset_sec_ << "s), system clock: "
+                         << GetCurrentTimeMicros() << "us";
+}
+
+} // namespace clock
+} // namespace kudu
@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "kudu/clock/time_service.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace clock {
+
+// TimeService implementation which reads the time from a PTP hardware clock
+// (PHC), such as the one of a network card synchronized by ptp4l.
+//
+// PTP keeps the clocks of a cluster within a few microseconds of each other,
+// much closer than NTP, but the kernel doesn't track an error bound for PHCs.
+// Instead, the error bound is configured with --ptp_max_error_usec to the
+// accuracy guaranteed by the PTP deployment, and the time taken to read the
+// clock is added to it.
+class SystemPtp : public TimeService {
+ public:
+  SystemPtp() = default;
+  virtual ~SystemPtp();
+
+  // Opens the PHC device specified by --ptp_device and checks that it can be
+  // read.
+  virtual Status Init() override;
+
+  virtual Status WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) override;
+
+  virtual int64_t skew_ppm() const override {
+    // Same as the default maximum frequency error of the kernel's clocks.
+    return 500;
+  }
+
+  virtual void DumpDiagnostics(std::vector<std::string>* log) const override;
+
+ private:
+  // Reads the PHC and returns its time in UTC, in microseconds since the
+  // epoch.
+  Status ReadClock(uint64_t* now_usec) const;
+
+  // The file descriptor of the opened PHC device, or -1.
+  int fd_ = -1;
+
+  // The dynamic clock id of the PHC.
+  clockid_t clock_id_;
+
+  // The offset to subtract from the time of the PHC to obtain UTC, in seconds.
+  int64_t utc_offset_sec_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SystemPtp);
+};
+
+} // namespace clock
+} // namespace kudu
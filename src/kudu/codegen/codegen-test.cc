@@ -30,7 +30,10 @@
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
@@ -60,6 +63,9 @@ typedef RowProjector NoCodegenRP;
 typedef codegen::RowProjector CodegenRP;
 
 using codegen::CompilationManager;
+using codegen::PredicateEvaluator;
+using codegen::PredicateEvaluatorFunctions;
+using codegen::PredicateShape;
 
 class CodegenTest : public KuduTest {
  public:
@@ -425,4 +431,107 @@ TEST_F(CodegenTest, TestCodeCache) {
   }
 }
 
+TEST_F(CodegenTest, TestPrecompileRowProjector) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+
+  // Concurrent precompilations of the same projector compile it once, after
+  // which the first request for it hits the cache.
+  for (int i = 0; i < 10; i++) {
+    cm->PrecompileRowProjector(base_, base_);
+  }
+  cm->Wait();
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &base_, &projector));
+}
+
+// Compares the selection of rows by a codegenned predicate evaluator to the
+// selection by the predicates evaluated one at a time.
+TEST_F(CodegenTest, TestPredicateEvaluator) {
+  // Use a number of rows which isn't a multiple of the selection bytes.
+  const int kNumRows = 101;
+  Arena arena(1024);
+  RowBlock block(base_, kNumRows, &arena);
+  for (int i = 0; i < kNumRows; i++) {
+    uint64_t key = i;
+    int32_t val = static_cast<int32_t>(random_.Uniform(20)) - 10;
+    int32_t nullable_val = random_.Uniform(5);
+    Slice str("str");
+    block.column_block(kKeyCol).SetCellValue(i, &key);
+    block.column_block(kI32Col).SetCellValue(i, &val);
+    ColumnBlock i32_null_val = block.column_block(kI32NullValCol);
+    i32_null_val.SetCellValue(i, &nullable_val);
+    i32_null_val.SetCellIsNull(i, random_.OneIn(3));
+    ColumnBlock str_null_val = block.column_block(kStrNullValCol);
+    str_null_val.SetCellValue(i, &str);
+    str_null_val.SetCellIsNull(i, random_.OneIn(4));
+  }
+
+  const uint64_t key_lower = 30;
+  const int32_t val_lower = -3;
+  const int32_t val_upper = 4;
+  const int32_t nullable_val = 2;
+  const vector<ColumnPredicate> predicates = {
+    ColumnPredicate::Range(base_.column(kKeyCol), &key_lower, nullptr),
+    ColumnPredicate::Range(base_.column(kI32Col), &val_lower, &val_upper),
+    ColumnPredicate::Equality(base_.column(kI32NullValCol), &nullable_val),
+    ColumnPredicate::IsNotNull(base_.column(kStrNullValCol)),
+  };
+
+  vector<PredicateShape> shapes;
+  ASSERT_OK(PredicateEvaluatorFunctions::GetShapes(predicates, &shapes));
+  scoped_refptr<PredicateEvaluatorFunctions> functions;
+  ASSERT_OK(generator_.CompilePredicateEvaluator(shapes, &functions));
+  PredicateEvaluator evaluator(&base_, predicates, functions);
+  ASSERT_OK(evaluator.Init());
+
+  // Some rows are unselected up front, e.g. because they were deleted.
+  SelectionVector* sel = block.selection_vector();
+  sel->SetAllTrue();
+  for (int i = 0; i < kNumRows; i += 7) {
+    sel->SetRowUnselected(i);
+  }
+  SelectionVector expected(kNumRows);
+  expected.SetAllTrue();
+  for (int i = 0; i < kNumRows; i += 7) {
+    expected.SetRowUnselected(i);
+  }
+  for (const auto& pred : predicates) {
+    pred.Evaluate(block.column_block(base_.find_column(pred.column().name())), &expected);
+  }
+
+  evaluator.Evaluate(&block);
+  ASSERT_GT(expected.CountSelected(), 0);
+  for (int i = 0; i < kNumRows; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(expected.IsRowSelected(i), sel->IsRowSelected(i));
+  }
+}
+
+TEST_F(CodegenTest, TestPredicateEvaluatorRequests) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+
+  // Predicates over strings aren't supported, and are left to the caller.
+  const Slice str_lower("a");
+  gscoped_ptr<PredicateEvaluator> evaluator;
+  vector<ColumnPredicate> predicates = {
+    ColumnPredicate::Range(base_.column(kStrCol), &str_lower, nullptr),
+  };
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&base_, predicates, &evaluator));
+  cm->Wait();
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&base_, predicates, &evaluator));
+
+  // The first request for supported predicates only enqueues the compilation,
+  // after which predicates of the same shape but different bounds hit the cache.
+  const int32_t lower1 = 1;
+  const int32_t lower2 = 2;
+  predicates = { ColumnPredicate::Range(base_.column(kI32Col), &lower1, nullptr) };
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&base_, predicates, &evaluator));
+  cm->Wait();
+  predicates = { ColumnPredicate::Range(base_.column(kI32Col), &lower2, nullptr) };
+  ASSERT_TRUE(cm->RequestPredicateEvaluator(&base_, predicates, &evaluator));
+  ASSERT_EQ(1, evaluator->predicates().size());
+}
+
 } // namespace kudu
@@ -19,8 +19,11 @@
 
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -28,13 +31,16 @@
 #include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
@@ -46,6 +52,8 @@
 #include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
+using std::string;
+using std::vector;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
             "generation request took.");
@@ -122,6 +130,47 @@ class CompilationTask : public Runnable {
   DISALLOW_COPY_AND_ASSIGN(CompilationTask);
 };
 
+// A PredicateCompilationTask generates the code evaluating predicates of
+// the given shapes and stores it in the cache when run.
+class PredicateCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  PredicateCompilationTask(vector<PredicateShape> shapes, CodeCache* cache,
+                           CodeGenerator* generator)
+    : shapes_(std::move(shapes)),
+      cache_(cache),
+      generator_(generator) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(), "Failed compilation of predicate evaluator");
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(PredicateEvaluatorFunctions::EncodeKey(shapes_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<PredicateEvaluatorFunctions> functions;
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating predicate evaluator") {
+      RETURN_NOT_OK(generator_->CompilePredicateEvaluator(shapes_, &functions));
+    }
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  const vector<PredicateShape> shapes_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateCompilationTask);
+};
+
 } // anonymous namespace
 
 CompilationManager::CompilationManager()
@@ -172,6 +221,38 @@ Status CompilationManager::StartInstrumentation(const scoped_refptr<MetricEntity
   return Status::OK();
 }
 
+bool CompilationManager::SubmitCompilation(const string& key, shared_ptr<Runnable> task) {
+  {
+    std::lock_guard<simple_spinlock> l(pending_lock_);
+    if (!InsertIfNotPresent(&pending_keys_, key)) {
+      return true;
+    }
+  }
+  Status s = pool_->SubmitFunc([this, key, task]() {
+      task->Run();
+      std::lock_guard<simple_spinlock> l(pending_lock_);
+      pending_keys_.erase(key);
+    });
+  if (!s.ok()) {
+    WARN_NOT_OK(s, "Code generation request failed");
+    std::lock_guard<simple_spinlock> l(pending_lock_);
+    pending_keys_.erase(key);
+    return false;
+  }
+  return true;
+}
+
+void CompilationManager::PrecompileRowProjector(const Schema& base_schema,
+                                                const Schema& projection) {
+  faststring key;
+  Status s = RowProjectorFunctions::EncodeKey(base_schema, projection, &key);
+  WARN_NOT_OK(s, "RowProjector precompilation request failed");
+  if (!s.ok() || cache_.Lookup(key)) return;
+  shared_ptr<Runnable> task(
+    new CompilationTask(base_schema, projection, &cache_, &generator_));
+  SubmitCompilation(key.ToString(), std::move(task));
+}
+
 bool CompilationManager::RequestRowProjector(const Schema* base_schema,
                                              const Schema* projection,
                                              gscoped_ptr<RowProjector>* out) {
@@ -188,8 +269,7 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   if (!cached) {
     shared_ptr<Runnable> task(
       new CompilationTask(*base_schema, *projection, &cache_, &generator_));
-    WARN_NOT_OK(pool_->Submit(task),
-                "RowProjector compilation request failed");
+    SubmitCompilation(key.ToString(), std::move(task));
     return false;
   }
 
@@ -199,5 +279,41 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+bool CompilationManager::RequestPredicateEvaluator(const Schema* schema,
+                                                   const vector<ColumnPredicate>& predicates,
+                                                   gscoped_ptr<PredicateEvaluator>* out) {
+  vector<PredicateShape> shapes;
+  if (predicates.empty() ||
+      !PredicateEvaluatorFunctions::GetShapes(predicates, &shapes).ok()) {
+    return false;
+  }
+  faststring key;
+  Status s = PredicateEvaluatorFunctions::EncodeKey(shapes, &key);
+  WARN_NOT_OK(s, "PredicateEvaluator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<PredicateEvaluatorFunctions> cached(
+    down_cast<PredicateEvaluatorFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new PredicateCompilationTask(std::move(shapes), &cache_, &generator_));
+    SubmitCompilation(key.ToString(), std::move(task));
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  gscoped_ptr<PredicateEvaluator> evaluator(
+      new PredicateEvaluator(schema, predicates, cached));
+  s = evaluator->Init();
+  WARN_NOT_OK(s, "PredicateEvaluator initialization failed");
+  if (!s.ok()) return false;
+  out->reset(evaluator.release());
+  return true;
+}
+
 } // namespace codegen
 } // namespace kudu
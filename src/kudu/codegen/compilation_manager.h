@@ -19,6 +19,10 @@
 #define KUDU_CODEGEN_COMPILATION_MANAGER_H
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
@@ -27,16 +31,20 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class ColumnPredicate;
 class MetricEntity;
+class Runnable;
 class Schema;
 class ThreadPool;
 
 namespace codegen {
 
+class PredicateEvaluator;
 class RowProjector;
 
 // The compilation manager is a top-level class which manages the actual
@@ -78,6 +86,22 @@ class CompilationManager {
                            const Schema* projection,
                            gscoped_ptr<RowProjector>* out);
 
+  // Enqueues a compilation task for the row projector of the parameter
+  // schemas unless it's already cached or being compiled, so that later
+  // requests for it hit the cache. Doesn't wait for the compilation.
+  void PrecompileRowProjector(const Schema& base_schema, const Schema& projection);
+
+  // If a codegenned evaluator for predicates of the same shapes (see
+  // codegen::PredicateShape) is ready, then an evaluator of 'predicates' over
+  // row blocks of 'schema' is written to 'out' and true is returned.
+  // Otherwise, this enqueues a compilation task for the predicates' shapes
+  // and returns false, in which case the predicates should be evaluated
+  // without codegen. False is also returned if the predicates aren't
+  // supported by codegen. Does not write to 'out' if false is returned.
+  bool RequestPredicateEvaluator(const Schema* schema,
+                                 const std::vector<ColumnPredicate>& predicates,
+                                 gscoped_ptr<PredicateEvaluator>* out);
+
   // Waits for all asynchronous compilation tasks to finish.
   void Wait();
 
@@ -93,10 +117,20 @@ class CompilationManager {
 
   static void Shutdown();
 
+  // Submits 'task' generating the code for 'key' to the thread pool, unless
+  // a task for the same key is already pending. Returns false upon failure.
+  bool SubmitCompilation(const std::string& key, std::shared_ptr<Runnable> task);
+
   CodeGenerator generator_;
   CodeCache cache_;
   gscoped_ptr<ThreadPool> pool_;
 
+  // The keys of the code being compiled or queued for compilation, so that
+  // concurrent misses for the same code, e.g. of the many tablets sharing a
+  // schema after a restart, compile it only once.
+  simple_spinlock pending_lock_;
+  std::unordered_set<std::string> pending_keys_;
+
   AtomicInt<int64_t> hit_counter_;
   AtomicInt<int64_t> query_counter_;
 
@@ -0,0 +1,399 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/codegen/predicate_evaluator.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/ADT/ilist_iterator.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/faststring.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::IntegerType;
+using llvm::LLVMContext;
+using llvm::PHINode;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns whether values of 'type' are compared as integers by the
+// generated code, writing the width of the values in bits and whether
+// they're signed to 'bits' and 'is_signed'.
+bool GetIntegerType(DataType type, int* bits, bool* is_signed) {
+  switch (type) {
+    case INT8:   *bits = 8;  *is_signed = true;  return true;
+    case INT16:  *bits = 16; *is_signed = true;  return true;
+    case INT32:  *bits = 32; *is_signed = true;  return true;
+    case INT64:  *bits = 64; *is_signed = true;  return true;
+    case UINT8:  *bits = 8;  *is_signed = false; return true;
+    case UINT16: *bits = 16; *is_signed = false; return true;
+    case UINT32: *bits = 32; *is_signed = false; return true;
+    case UINT64: *bits = 64; *is_signed = false; return true;
+    default: return false;
+  }
+}
+
+// Generates a function evaluating a conjunction of predicates of the form:
+// void(i8** cells, i8** null_bitmaps, i8** bounds, i64 nrows, i8* sel)
+// See PredicateEvaluatorFunctions::EvaluateFunction.
+//
+// Uses CHECKs to make sure the shapes are supported. Use
+// PredicateEvaluatorFunctions::GetShapes() to return an error status instead.
+Function* MakeEvaluation(const string& name,
+                         ModuleBuilder* mbuilder,
+                         const vector<PredicateShape>& shapes) {
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  Type* i8_ptr = Type::getInt8PtrTy(context);
+  Type* i8_ptr_ptr = PointerType::getUnqual(i8_ptr);
+  vector<Type*> argtypes = { i8_ptr_ptr, i8_ptr_ptr, i8_ptr_ptr,
+                             Type::getInt64Ty(context), i8_ptr };
+  FunctionType* fty = FunctionType::get(Type::getVoidTy(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  Function::arg_iterator it = f->arg_begin();
+  Argument* cells = &*it++;
+  Argument* null_bitmaps = &*it++;
+  Argument* bounds = &*it++;
+  Argument* nrows = &*it++;
+  Argument* sel = &*it++;
+  DCHECK(it == f->arg_end());
+  cells->setName("cells");
+  null_bitmaps->setName("null_bitmaps");
+  bounds->setName("bounds");
+  nrows->setName("nrows");
+  sel->setName("sel");
+
+  // Evaluation function in IR (note: values in angle brackets are constants
+  // whose values are determined right now, at JIT time):
+  //
+  // entry:
+  //   <for each predicate i>
+  //     %col_i = bitcast (load (getelementptr %cells, i)) to <type>*
+  //     %bitmap_i = load (getelementptr %null_bitmaps, i)    ; if nullable
+  //     %lower_i = load (bitcast (load (getelementptr %bounds, 2i)) to <type>*)
+  //     %upper_i = load (bitcast (load (getelementptr %bounds, 2i + 1)) to <type>*)
+  //   br %check
+  // check:
+  //   %row = phi [0, %entry], [%next_row, %body]
+  //   br (%row >= %nrows), %exit, %body
+  // body:
+  //   %pass = true
+  //   <for each predicate i>
+  //     %non_null_i = bit %row of %bitmap_i is set            ; if nullable
+  //     %cell_i = load (getelementptr %col_i, %row)
+  //     %pass = and %pass, <result of comparing %cell_i to the bounds>
+  //   clear bit %row of %sel unless %pass
+  //   %next_row = add %row, 1
+  //   br %check
+  // exit:
+  //   ret void
+  //
+  // The body has no branches, so the loop is a good candidate for LLVM to
+  // unroll.
+  BasicBlock* entry = BasicBlock::Create(context, "entry", f);
+  BasicBlock* check = BasicBlock::Create(context, "check", f);
+  BasicBlock* body = BasicBlock::Create(context, "body", f);
+  BasicBlock* exit = BasicBlock::Create(context, "exit", f);
+
+  builder->SetInsertPoint(entry);
+  vector<Value*> cols(shapes.size());
+  vector<Value*> bitmaps(shapes.size());
+  vector<Value*> lowers(shapes.size());
+  vector<Value*> uppers(shapes.size());
+  for (int i = 0; i < shapes.size(); i++) {
+    const PredicateShape& shape = shapes[i];
+    if (shape.nullable) {
+      bitmaps[i] = builder->CreateLoad(builder->CreateConstGEP1_64(null_bitmaps, i));
+      bitmaps[i]->setName(StrCat("bitmap_", i));
+    }
+    if (shape.predicate_type != PredicateType::Equality &&
+        shape.predicate_type != PredicateType::Range) {
+      continue;
+    }
+    int bits;
+    bool is_signed;
+    CHECK(GetIntegerType(shape.physical_type, &bits, &is_signed));
+    Type* val_ptr = PointerType::getUnqual(IntegerType::get(context, bits));
+    cols[i] = builder->CreateBitCast(
+        builder->CreateLoad(builder->CreateConstGEP1_64(cells, i)), val_ptr);
+    cols[i]->setName(StrCat("col_", i));
+    if (shape.has_lower) {
+      lowers[i] = builder->CreateLoad(builder->CreateBitCast(
+          builder->CreateLoad(builder->CreateConstGEP1_64(bounds, 2 * i)), val_ptr));
+      lowers[i]->setName(StrCat("lower_", i));
+    }
+    if (shape.has_upper) {
+      uppers[i] = builder->CreateLoad(builder->CreateBitCast(
+          builder->CreateLoad(builder->CreateConstGEP1_64(bounds, 2 * i + 1)), val_ptr));
+      uppers[i]->setName(StrCat("upper_", i));
+    }
+  }
+  builder->CreateBr(check);
+
+  builder->SetInsertPoint(check);
+  PHINode* row = builder->CreatePHI(Type::getInt64Ty(context), 2, "row");
+  row->addIncoming(builder->getInt64(0), entry);
+  builder->CreateCondBr(builder->CreateICmpUGE(row, nrows), exit, body);
+
+  builder->SetInsertPoint(body);
+  Value* byte_idx = builder->CreateLShr(row, 3, "byte_idx");
+  Value* mask = builder->CreateShl(
+      builder->getInt8(1),
+      builder->CreateTrunc(builder->CreateAnd(row, 7), Type::getInt8Ty(context)),
+      "mask");
+  Value* pass = builder->getInt1(true);
+  for (int i = 0; i < shapes.size(); i++) {
+    const PredicateShape& shape = shapes[i];
+    Value* non_null = builder->getInt1(true);
+    if (shape.nullable) {
+      Value* bitmap_byte = builder->CreateLoad(builder->CreateGEP(bitmaps[i], byte_idx));
+      non_null = builder->CreateICmpNE(builder->CreateAnd(bitmap_byte, mask),
+                                       builder->getInt8(0));
+      non_null->setName(StrCat("non_null_", i));
+    }
+
+    Value* result = nullptr;
+    switch (shape.predicate_type) {
+      case PredicateType::IsNotNull:
+        result = non_null;
+        break;
+      case PredicateType::IsNull:
+        result = builder->CreateNot(non_null);
+        break;
+      case PredicateType::Equality: {
+        Value* cell = builder->CreateLoad(builder->CreateGEP(cols[i], row));
+        result = builder->CreateAnd(non_null, builder->CreateICmpEQ(cell, lowers[i]));
+        break;
+      }
+      case PredicateType::Range: {
+        int bits;
+        bool is_signed;
+        CHECK(GetIntegerType(shape.physical_type, &bits, &is_signed));
+        Value* cell = builder->CreateLoad(builder->CreateGEP(cols[i], row));
+        result = non_null;
+        if (shape.has_lower) {
+          result = builder->CreateAnd(result, is_signed ?
+                                      builder->CreateICmpSGE(cell, lowers[i]) :
+                                      builder->CreateICmpUGE(cell, lowers[i]));
+        }
+        if (shape.has_upper) {
+          result = builder->CreateAnd(result, is_signed ?
+                                      builder->CreateICmpSLT(cell, uppers[i]) :
+                                      builder->CreateICmpULT(cell, uppers[i]));
+        }
+        break;
+      }
+      default:
+        LOG(FATAL) << "unsupported predicate type";
+    }
+    result->setName(StrCat("result_", i));
+    pass = builder->CreateAnd(pass, result);
+  }
+
+  // Clear the row's selection bit if it failed any of the predicates.
+  Value* sel_byte_ptr = builder->CreateGEP(sel, byte_idx);
+  Value* sel_byte = builder->CreateLoad(sel_byte_ptr);
+  Value* clear_mask = builder->CreateSelect(pass, builder->getInt8(0), mask);
+  builder->CreateStore(builder->CreateAnd(sel_byte, builder->CreateNot(clear_mask)),
+                       sel_byte_ptr);
+  Value* next_row = builder->CreateAdd(row, builder->getInt64(1), "next_row");
+  row->addIncoming(next_row, body);
+  builder->CreateBr(check);
+
+  builder->SetInsertPoint(exit);
+  builder->CreateRetVoid();
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping predicate evaluation:";
+    f->dump();
+  }
+
+  return f;
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+PredicateEvaluatorFunctions::PredicateEvaluatorFunctions(vector<PredicateShape> shapes,
+                                                         EvaluateFunction evaluate_f,
+                                                         unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    shapes_(std::move(shapes)),
+    evaluate_f_(evaluate_f) {
+  CHECK(evaluate_f != nullptr)
+    << "Promise to compile evaluation function not fulfilled by ModuleBuilder";
+}
+
+Status PredicateEvaluatorFunctions::Create(const vector<PredicateShape>& shapes,
+                                           scoped_refptr<PredicateEvaluatorFunctions>* out,
+                                           llvm::TargetMachine** tm) {
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* evaluate = MakeEvaluation("EvaluatePredicates", &builder, shapes);
+  EvaluateFunction evaluate_f;
+  builder.AddJITPromise(evaluate, &evaluate_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new PredicateEvaluatorFunctions(shapes, evaluate_f, std::move(owner)));
+  return Status::OK();
+}
+
+Status PredicateEvaluatorFunctions::GetShapes(const vector<ColumnPredicate>& predicates,
+                                              vector<PredicateShape>* shapes) {
+  shapes->clear();
+  for (const auto& pred : predicates) {
+    PredicateShape shape;
+    shape.physical_type = pred.column().type_info()->physical_type();
+    shape.nullable = pred.column().is_nullable();
+    shape.predicate_type = pred.predicate_type();
+    shape.has_lower = pred.raw_lower() != nullptr;
+    shape.has_upper = pred.raw_upper() != nullptr;
+    int bits;
+    bool is_signed;
+    switch (shape.predicate_type) {
+      case PredicateType::IsNotNull:
+      case PredicateType::IsNull:
+        break;
+      case PredicateType::Equality:
+      case PredicateType::Range:
+        if (!GetIntegerType(shape.physical_type, &bits, &is_signed)) {
+          return Status::NotSupported("unsupported column type", pred.ToString());
+        }
+        break;
+      default:
+        return Status::NotSupported("unsupported predicate type", pred.ToString());
+    }
+    shapes->push_back(shape);
+  }
+  return Status::OK();
+}
+
+// Generates a key for the predicate shapes. The key is unique according to
+// the criteria defined in the CodeCache class' block comment. The shapes are
+// encoded in sequence as follows:
+//
+// (1 byte) unique type identifier for PredicateEvaluatorFunctions
+// (8 bytes) number, as unsigned long, of predicates
+// (11 bytes each) predicate shapes, in order
+//   4 bytes for the physical column type
+//   1 byte for nullability
+//   4 bytes for the predicate type
+//   1 byte each for whether there are lower and upper bounds
+Status PredicateEvaluatorFunctions::EncodeKey(const vector<PredicateShape>& shapes,
+                                              faststring* out) {
+  AddNext(out, JITWrapper::PREDICATE_EVALUATOR);
+  AddNext(out, shapes.size());
+  for (const auto& shape : shapes) {
+    AddNext(out, shape.physical_type);
+    AddNext(out, shape.nullable);
+    AddNext(out, shape.predicate_type);
+    AddNext(out, shape.has_lower);
+    AddNext(out, shape.has_upper);
+  }
+  return Status::OK();
+}
+
+PredicateEvaluator::PredicateEvaluator(
+    const Schema* schema,
+    vector<ColumnPredicate> predicates,
+    const scoped_refptr<PredicateEvaluatorFunctions>& functions)
+  : schema_(schema),
+    predicates_(std::move(predicates)),
+    functions_(functions) {
+}
+
+Status PredicateEvaluator::Init() {
+  DCHECK_EQ(predicates_.size(), functions_->shapes().size());
+  col_idxs_.clear();
+  bounds_.clear();
+  for (const auto& pred : predicates_) {
+    int col_idx = schema_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("Unknown column in predicate", pred.ToString());
+    }
+    col_idxs_.push_back(col_idx);
+    bounds_.push_back(pred.raw_lower());
+    bounds_.push_back(pred.raw_upper());
+  }
+  cells_.resize(predicates_.size());
+  null_bitmaps_.resize(predicates_.size());
+  return Status::OK();
+}
+
+void PredicateEvaluator::Evaluate(RowBlock* block) {
+  DCHECK_SCHEMA_EQ(*schema_, block->schema());
+  for (int i = 0; i < col_idxs_.size(); i++) {
+    ColumnBlock col = block->column_block(col_idxs_[i]);
+    cells_[i] = col.data();
+    null_bitmaps_[i] = col.null_bitmap();
+  }
+  functions_->evaluate()(cells_.data(), null_bitmaps_.data(), bounds_.data(),
+                         block->nrows(), block->selection_vector()->mutable_bitmap());
+}
+
+} // namespace codegen
+} // namespace kudu
@@ -0,0 +1,145 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+#define KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class RowBlock;
+class Schema;
+class faststring;
+
+namespace codegen {
+
+// The properties of a column predicate which determine the code evaluating
+// it. Predicates of the same shape share their code; the bounds are passed
+// to the code when it runs.
+struct PredicateShape {
+  DataType physical_type;
+  bool nullable;
+  PredicateType predicate_type;
+  bool has_lower;
+  bool has_upper;
+};
+
+// The JITWrapper for codegen::PredicateEvaluator functions. Contains the
+// compiled function evaluating a conjunction of predicates over a row block,
+// as well as the shapes of the predicates used to generate it.
+class PredicateEvaluatorFunctions : public JITWrapper {
+ public:
+  // Compiles the evaluation function for the conjunction of predicates of
+  // the given shapes, which must all be supported (see GetShapes()).
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  static Status Create(const std::vector<PredicateShape>& shapes,
+                       scoped_refptr<PredicateEvaluatorFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  // Fills in 'shapes' with the shapes of 'predicates'. Returns NotSupported
+  // if any of the predicates can't be code-generated: only equality and
+  // range predicates over integer columns, and null checks over columns of
+  // any type, are supported.
+  static Status GetShapes(const std::vector<ColumnPredicate>& predicates,
+                          std::vector<PredicateShape>* shapes);
+
+  // Clears the selection bits of the rows among the first 'nrows' rows which
+  // fail any of the predicates. For the i-th predicate, 'cells[i]' and
+  // 'null_bitmaps[i]' are the column's data and null bitmap, and
+  // 'bounds[2 * i]' and 'bounds[2 * i + 1]' its lower and upper bounds.
+  typedef void(*EvaluateFunction)(const uint8_t* const* cells,
+                                  const uint8_t* const* null_bitmaps,
+                                  const void* const* bounds,
+                                  uint64_t nrows,
+                                  uint8_t* sel_bitmap);
+  EvaluateFunction evaluate() const { return evaluate_f_; }
+
+  const std::vector<PredicateShape>& shapes() const { return shapes_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(shapes_, out);
+  }
+
+  static Status EncodeKey(const std::vector<PredicateShape>& shapes,
+                          faststring* out);
+
+ private:
+  PredicateEvaluatorFunctions(std::vector<PredicateShape> shapes,
+                              EvaluateFunction evaluate_f,
+                              std::unique_ptr<JITCodeOwner> owner);
+
+  const std::vector<PredicateShape> shapes_;
+  const EvaluateFunction evaluate_f_;
+};
+
+// Evaluates a conjunction of column predicates over row blocks with a single
+// fused pass of code-generated, schema-specialized code, as opposed to
+// evaluating the predicates one at a time with ColumnPredicate::Evaluate().
+class PredicateEvaluator {
+ public:
+  // Requires that the schema and the values referenced by the predicates
+  // remain valid for the lifetime of this object, and that the predicates
+  // are of the shapes used to create 'functions'.
+  PredicateEvaluator(const Schema* schema,
+                     std::vector<ColumnPredicate> predicates,
+                     const scoped_refptr<PredicateEvaluatorFunctions>& functions);
+
+  // Returns InvalidArgument if a predicate's column isn't in the schema.
+  Status Init();
+
+  // Clears the selection bits of the rows of 'block' which fail any of the
+  // predicates. 'block' must be of the schema passed to the constructor.
+  void Evaluate(RowBlock* block);
+
+  const std::vector<ColumnPredicate>& predicates() const { return predicates_; }
+
+ private:
+  const Schema* const schema_;
+  const std::vector<ColumnPredicate> predicates_;
+  scoped_refptr<PredicateEvaluatorFunctions> functions_;
+
+  // The indexes in 'schema_' of the predicates' columns.
+  std::vector<int> col_idxs_;
+
+  // The arguments passed to the evaluation function.
+  std::vector<const uint8_t*> cells_;
+  std::vector<const uint8_t*> null_bitmaps_;
+  std::vector<const void*> bounds_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateEvaluator);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
@@ -38,7 +38,8 @@ class ColumnMaterializationContext {
       pred_(pred),
       block_(block),
       sel_(sel),
-      decoder_eval_status_(kNotSet) {
+      decoder_eval_status_(kNotSet),
+      skip_unselected_rows_(false) {
       if (!pred_ || !sel || !block) {
         decoder_eval_status_ = kDecoderEvalNotSupported;
       }
@@ -79,6 +80,24 @@ class ColumnMaterializationContext {
     return pred_ && pred_->predicate_type() == PredicateType::IsNull;
   }
 
+  // Checked during materialization to determine whether rows that are already
+  // deselected in sel() may be skipped rather than decoded (on true). The
+  // cells of skipped rows are zeroed and their null bits are unspecified.
+  bool SkipUnselectedRows() const {
+    return skip_unselected_rows_;
+  }
+
+  // Allows the column to be materialized only for the rows selected in sel().
+  // Only valid for columns without a predicate: a predicate evaluated after
+  // materialization may still look at every cell of the block.
+  //
+  // Set by the MaterializingIterator once all predicates have been evaluated,
+  // so that the remaining columns cost only as much as the surviving rows.
+  void SetSkipUnselectedRows() {
+    DCHECK(pred_ == nullptr && sel_ != nullptr);
+    skip_unselected_rows_ = true;
+  }
+
   // A context should not switch from supporting decoder-level eval to not
   // supporting it, or vice versa.
   //
@@ -138,6 +157,8 @@ class ColumnMaterializationContext {
   SelectionVector* const sel_;
 
   DecoderEvalStatus decoder_eval_status_;
+
+  bool skip_unselected_rows_;
 };
 
 } // namespace kudu
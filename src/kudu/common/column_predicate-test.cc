@@ -19,26 +19,39 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/column_predicate_kernels.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/alignment.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/int128.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/random.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::vector;
 
 namespace kudu {
 
+using predicate_kernels::KernelArch;
+
 class TestColumnPredicate : public KuduTest {
  public:
 
@@ -1081,6 +1094,132 @@ TEST_F(TestColumnPredicate, TestInList) {
   }
 }
 
+TEST_F(TestColumnPredicate, TestInBloomFilter) {
+  ColumnSchema column("c", INT32, true);
+  auto key = [] (const int32_t& v) {
+    return Slice(reinterpret_cast<const uint8_t*>(&v), sizeof(v));
+  };
+
+  // Build one filter containing the even values in [0, 100), and another
+  // containing the multiples of four.
+  BloomFilterBuilder evens_builder(BloomFilterSizing::ByCountAndFPRate(50, 0.01));
+  BloomFilterBuilder fours_builder(BloomFilterSizing::ByCountAndFPRate(25, 0.01));
+  for (int32_t i = 0; i < 100; i += 2) {
+    evens_builder.AddKey(BloomKeyProbe(key(i)));
+    if (i % 4 == 0) {
+      fours_builder.AddKey(BloomKeyProbe(key(i)));
+    }
+  }
+  BloomFilter evens(evens_builder.slice(), evens_builder.n_hashes());
+  BloomFilter fours(fours_builder.slice(), fours_builder.n_hashes());
+  auto new_pred = [&] (vector<BloomFilter> filters, const void* lower, const void* upper) {
+    return ColumnPredicate::InBloomFilter(column, &filters, lower, upper);
+  };
+
+  // Find a value which is not in the even filter.
+  int32_t miss = 1;
+  while (evens.MayContainKey(BloomKeyProbe(key(miss)))) {
+    miss += 2;
+  }
+
+  const int kNumRows = 200;
+  vector<int32_t> cells(kNumRows);
+  vector<uint8_t> null_bitmap(BitmapSize(kNumRows));
+  for (int32_t i = 0; i < kNumRows; i++) {
+    cells[i] = i;
+    // Make every tenth row NULL.
+    BitmapChange(null_bitmap.data(), i, i % 10 != 0);
+  }
+  ColumnBlock block(GetTypeInfo(INT32), null_bitmap.data(), cells.data(), kNumRows, nullptr);
+
+  { // Evaluating the predicate selects every value in the filter and rejects NULLs.
+    ColumnPredicate pred = new_pred({ evens }, nullptr, nullptr);
+    ASSERT_EQ(PredicateType::InBloomFilter, pred.predicate_type());
+    SelectionVector sel(kNumRows);
+    sel.SetAllTrue();
+    pred.Evaluate(block, &sel);
+    for (int32_t i = 0; i < kNumRows; i++) {
+      bool may_contain = evens.MayContainKey(BloomKeyProbe(key(i)));
+      ASSERT_EQ(i % 10 != 0 && may_contain, sel.IsRowSelected(i)) << i;
+      if (i < 100 && i % 2 == 0) {
+        ASSERT_TRUE(may_contain) << i;
+      }
+    }
+    ASSERT_FALSE(sel.IsRowSelected(miss));
+  }
+
+  { // The bounds are applied along with the filters.
+    int32_t lower = 20;
+    int32_t upper = 30;
+    ColumnPredicate pred = new_pred({ evens, fours }, &lower, &upper);
+    SelectionVector sel(kNumRows);
+    sel.SetAllTrue();
+    pred.Evaluate(block, &sel);
+    for (int32_t i = 0; i < kNumRows; i++) {
+      if (i >= 20 && i < 30 && i % 4 == 0 && i % 10 != 0) {
+        ASSERT_TRUE(sel.IsRowSelected(i)) << i;
+      } else if (i < 20 || i >= 30 || i % 10 == 0) {
+        ASSERT_FALSE(sel.IsRowSelected(i)) << i;
+      }
+    }
+  }
+
+  { // Simplification of the bounds.
+    int32_t ten = 10;
+    int32_t eleven = 11;
+    ASSERT_EQ(PredicateType::None, new_pred({ evens }, &eleven, &ten).predicate_type());
+    ASSERT_EQ(ColumnPredicate::Equality(column, &ten), new_pred({ evens }, &ten, &eleven));
+    int32_t after_miss = miss + 1;
+    ASSERT_EQ(PredicateType::None, new_pred({ evens }, &miss, &after_miss).predicate_type());
+  }
+
+  int32_t four = 4;
+  int32_t six = 6;
+  int32_t ten = 10;
+  int32_t twenty = 20;
+
+  // Merges with other predicate types.
+  TestMerge(new_pred({ evens }, nullptr, nullptr),
+            ColumnPredicate::Equality(column, &four),
+            ColumnPredicate::Equality(column, &four),
+            PredicateType::Equality);
+  TestMerge(new_pred({ evens }, nullptr, nullptr),
+            ColumnPredicate::Equality(column, &miss),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+  {
+    vector<const void*> values = { &four, &six, &miss };
+    vector<const void*> expected_values = { &four, &six };
+    TestMerge(new_pred({ evens }, nullptr, nullptr),
+              ColumnPredicate::InList(column, &values),
+              ColumnPredicate::InList(column, &expected_values),
+              PredicateType::InList);
+  }
+  TestMerge(new_pred({ evens }, nullptr, &twenty),
+            ColumnPredicate::Range(column, &ten, nullptr),
+            new_pred({ evens }, &ten, &twenty),
+            PredicateType::InBloomFilter);
+  TestMerge(new_pred({ evens }, nullptr, nullptr),
+            ColumnPredicate::IsNotNull(column),
+            new_pred({ evens }, nullptr, nullptr),
+            PredicateType::InBloomFilter);
+  TestMerge(new_pred({ evens }, nullptr, nullptr),
+            ColumnPredicate::IsNull(column),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+  TestMerge(new_pred({ evens }, nullptr, nullptr),
+            ColumnPredicate::None(column),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+
+  { // Merging two Bloom filter predicates requires values to pass both.
+    ColumnPredicate pred = new_pred({ evens }, &ten, nullptr);
+    pred.Merge(new_pred({ fours }, nullptr, &twenty));
+    ASSERT_EQ(new_pred({ evens, fours }, &ten, &twenty), pred);
+    ASSERT_EQ(2, pred.bloom_filters().size());
+  }
+}
+
 // Test that column predicate comparison works correctly: ordered by predicate
 // type first, then size of the column type.
 TEST_F(TestColumnPredicate, TestSelectivity) {
@@ -1154,6 +1293,202 @@ TEST_F(TestColumnPredicate, TestSelectivity) {
             0);
 }
 
+namespace {
+
+const KernelArch kKernelArches[] = {
+  KernelArch::SCALAR,
+  KernelArch::DEFAULT,
+  KernelArch::SSE4_2,
+  KernelArch::AVX2,
+};
+
+// Restores the automatically selected predicate kernels on destruction.
+class ScopedKernelArch {
+ public:
+  ScopedKernelArch() : saved_(predicate_kernels::GetKernelArch()) {}
+  ~ScopedKernelArch() {
+    predicate_kernels::SetKernelArchForTests(saved_);
+  }
+ private:
+  const KernelArch saved_;
+};
+
+// Evaluates 'pred' over 'block' with every supported kernel architecture,
+// starting from a random selection vector, and checks each result against
+// evaluating the predicate cell by cell.
+void CheckKernelsAgainstCells(const ColumnPredicate& pred,
+                              const ColumnBlock& block,
+                              Random* rng) {
+  SCOPED_TRACE(pred.ToString());
+  SelectionVector initial(block.nrows());
+  for (size_t i = 0; i < block.nrows(); i++) {
+    BitmapChange(initial.mutable_bitmap(), i, !rng->OneIn(4));
+  }
+  vector<bool> expected(block.nrows());
+  for (size_t i = 0; i < block.nrows(); i++) {
+    expected[i] = initial.IsRowSelected(i) &&
+                  !(block.is_nullable() && block.is_null(i)) &&
+                  pred.EvaluateCell(block.type_info()->physical_type(), block.cell_ptr(i));
+  }
+
+  ScopedKernelArch restore_arch;
+  for (KernelArch arch : kKernelArches) {
+    if (!predicate_kernels::IsKernelArchSupported(arch)) continue;
+    SCOPED_TRACE(predicate_kernels::KernelArchToString(arch));
+    predicate_kernels::SetKernelArchForTests(arch);
+    SelectionVector sel(block.nrows());
+    memcpy(sel.mutable_bitmap(), initial.bitmap(), BitmapSize(block.nrows()));
+    pred.Evaluate(block, &sel);
+    for (size_t i = 0; i < block.nrows(); i++) {
+      ASSERT_EQ(expected[i], sel.IsRowSelected(i)) << "row " << i;
+    }
+  }
+}
+
+template <DataType Type>
+void TestKernelsForType(Random* rng) {
+  typedef typename DataTypeTraits<Type>::cpp_type T;
+  // Use row counts which exercise partial bytes and multiple chunks.
+  for (size_t nrows : { 1, 7, 64, 1000, 2055 }) {
+    for (bool nullable : { false, true }) {
+      vector<T> cells(nrows);
+      for (T& cell : cells) {
+        cell = static_cast<T>(rng->Uniform(100));
+      }
+      if (std::is_floating_point<T>::value && nrows > 3) {
+        cells[3] = NAN;
+      }
+      vector<uint8_t> null_bitmap(BitmapSize(nrows));
+      for (size_t i = 0; i < nrows; i++) {
+        BitmapChange(null_bitmap.data(), i, !rng->OneIn(5));
+      }
+      ColumnBlock block(GetTypeInfo(Type), nullable ? null_bitmap.data() : nullptr,
+                        cells.data(), nrows, nullptr);
+      ColumnSchema column("c", Type, nullable);
+
+      T lower = 20;
+      T upper = 70;
+      T value = cells[0];
+      NO_FATALS(CheckKernelsAgainstCells(ColumnPredicate::Range(column, &lower, &upper),
+                                         block, rng));
+      NO_FATALS(CheckKernelsAgainstCells(ColumnPredicate::Range(column, &lower, nullptr),
+                                         block, rng));
+      NO_FATALS(CheckKernelsAgainstCells(ColumnPredicate::Range(column, nullptr, &upper),
+                                         block, rng));
+      NO_FATALS(CheckKernelsAgainstCells(ColumnPredicate::Equality(column, &value),
+                                         block, rng));
+    }
+  }
+}
+
+} // anonymous namespace
+
+// Test that every predicate kernel architecture produces the same selection
+// as the cell-by-cell evaluation.
+TEST_F(TestColumnPredicate, TestEvaluateKernels) {
+  Random rng(SeedRandom());
+  NO_FATALS(TestKernelsForType<INT8>(&rng));
+  NO_FATALS(TestKernelsForType<INT16>(&rng));
+  NO_FATALS(TestKernelsForType<INT32>(&rng));
+  NO_FATALS(TestKernelsForType<INT64>(&rng));
+  NO_FATALS(TestKernelsForType<UINT8>(&rng));
+  NO_FATALS(TestKernelsForType<UINT16>(&rng));
+  NO_FATALS(TestKernelsForType<UINT32>(&rng));
+  NO_FATALS(TestKernelsForType<UINT64>(&rng));
+  NO_FATALS(TestKernelsForType<FLOAT>(&rng));
+  NO_FATALS(TestKernelsForType<DOUBLE>(&rng));
+}
+
+// Checks the dictionary code kernels against looking up each code, at
+// selection vector offsets which aren't byte-aligned.
+TEST_F(TestColumnPredicate, TestEvaluateDictionaryCodeKernels) {
+  Random rng(SeedRandom());
+  ScopedKernelArch restore_arch;
+  for (size_t nwords : { 1, 31, 300 }) {
+    vector<uint8_t> code_bitmap(KUDU_ALIGN_UP(nwords, 32) / 8);
+    for (size_t i = 0; i < nwords; i++) {
+      BitmapChange(code_bitmap.data(), i, rng.OneIn(3));
+    }
+    for (size_t n : { 1, 7, 64, 1000, 2055 }) {
+      vector<uint32_t> codes(n);
+      for (uint32_t& code : codes) {
+        code = rng.Uniform(nwords);
+      }
+      for (size_t offset : { 0, 3, 8, 13 }) {
+        SCOPED_TRACE(strings::Substitute("$0 words, $1 codes, offset $2", nwords, n, offset));
+        SelectionVector initial(n + offset);
+        for (size_t i = 0; i < n + offset; i++) {
+          BitmapChange(initial.mutable_bitmap(), i, !rng.OneIn(4));
+        }
+        for (KernelArch arch : kKernelArches) {
+          if (arch == KernelArch::SCALAR ||
+              !predicate_kernels::IsKernelArchSupported(arch)) {
+            continue;
+          }
+          SCOPED_TRACE(predicate_kernels::KernelArchToString(arch));
+          predicate_kernels::SetKernelArchForTests(arch);
+          SelectionVector sel(n + offset);
+          memcpy(sel.mutable_bitmap(), initial.bitmap(), BitmapSize(n + offset));
+          predicate_kernels::EvaluateDictionaryCodes(codes.data(), n, code_bitmap.data(),
+                                                     sel.mutable_bitmap(), offset);
+          for (size_t i = 0; i < n + offset; i++) {
+            bool expected = initial.IsRowSelected(i) &&
+                (i < offset || BitmapTest(code_bitmap.data(), codes[i - offset]));
+            ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i;
+          }
+        }
+      }
+    }
+  }
+}
+
+// Compares the time taken to evaluate range predicates with each kernel
+// architecture.
+TEST_F(TestColumnPredicate, TestEvaluateKernelsPerformance) {
+  const size_t kNumRows = 1024;
+  const int kNumIters = AllowSlowTests() ? 100000 : 1000;
+  Random rng(SeedRandom());
+
+  vector<int64_t> int_cells(kNumRows);
+  vector<double> double_cells(kNumRows);
+  for (size_t i = 0; i < kNumRows; i++) {
+    int_cells[i] = rng.Uniform(100);
+    double_cells[i] = rng.Uniform(100);
+  }
+  ColumnBlock int_block(GetTypeInfo(INT64), nullptr, int_cells.data(), kNumRows, nullptr);
+  ColumnBlock double_block(GetTypeInfo(DOUBLE), nullptr, double_cells.data(), kNumRows, nullptr);
+  int64_t int_lower = 10;
+  int64_t int_upper = 60;
+  double double_lower = 10;
+  double double_upper = 60;
+  ColumnPredicate int_pred = ColumnPredicate::Range(ColumnSchema("i", INT64),
+                                                    &int_lower, &int_upper);
+  ColumnPredicate double_pred = ColumnPredicate::Range(ColumnSchema("d", DOUBLE),
+                                                       &double_lower, &double_upper);
+
+  ScopedKernelArch restore_arch;
+  SelectionVector sel(kNumRows);
+  for (KernelArch arch : kKernelArches) {
+    if (!predicate_kernels::IsKernelArchSupported(arch)) continue;
+    predicate_kernels::SetKernelArchForTests(arch);
+    const char* arch_name = predicate_kernels::KernelArchToString(arch);
+    LOG_TIMING(INFO, strings::Substitute("$0 iterations of INT64 range ($1)",
+                                         kNumIters, arch_name)) {
+      for (int i = 0; i < kNumIters; i++) {
+        sel.SetAllTrue();
+        int_pred.Evaluate(int_block, &sel);
+      }
+    }
+    LOG_TIMING(INFO, strings::Substitute("$0 iterations of DOUBLE range ($1)",
+                                         kNumIters, arch_name)) {
+      for (int i = 0; i < kNumIters; i++) {
+        sel.SetAllTrue();
+        double_pred.Evaluate(double_block, &sel);
+      }
+    }
+  }
+}
+
 TEST_F(TestColumnPredicate, TestRedaction) {
   ASSERT_NE("", gflags::SetCommandLineOption("redact", "log"));
   ColumnSchema column_i32("a", INT32, true);
@@ -19,9 +19,13 @@
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 
 #include <boost/optional/optional.hpp>
 
+#include "kudu/common/column_predicate_kernels.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
@@ -59,6 +63,18 @@ ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
   values_.swap(*values);
 }
 
+ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
+                                 ColumnSchema column,
+                                 vector<BloomFilter>* bloom_filters,
+                                 const void* lower,
+                                 const void* upper)
+    : predicate_type_(predicate_type),
+      column_(move(column)),
+      lower_(lower),
+      upper_(upper) {
+  bloom_filters_.swap(*bloom_filters);
+}
+
 ColumnPredicate ColumnPredicate::Equality(ColumnSchema column, const void* value) {
   CHECK(value != nullptr);
   return ColumnPredicate(PredicateType::Equality, move(column), value, nullptr);
@@ -157,6 +173,17 @@ ColumnPredicate ColumnPredicate::IsNull(ColumnSchema column) {
          None(move(column));
 }
 
+ColumnPredicate ColumnPredicate::InBloomFilter(ColumnSchema column,
+                                               vector<BloomFilter>* bloom_filters,
+                                               const void* lower,
+                                               const void* upper) {
+  CHECK(bloom_filters != nullptr);
+  CHECK(!bloom_filters->empty());
+  ColumnPredicate pred(PredicateType::InBloomFilter, move(column), bloom_filters, lower, upper);
+  pred.Simplify();
+  return pred;
+}
+
 ColumnPredicate ColumnPredicate::None(ColumnSchema column) {
   return ColumnPredicate(PredicateType::None, move(column), nullptr, nullptr);
 }
@@ -165,6 +192,7 @@ void ColumnPredicate::SetToNone() {
   predicate_type_ = PredicateType::None;
   lower_ = nullptr;
   upper_ = nullptr;
+  bloom_filters_.clear();
 }
 
 // TODO: For decimal columns, use column_.type_attributes().precision
@@ -229,6 +257,25 @@ void ColumnPredicate::Simplify() {
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      if (lower_ != nullptr && upper_ != nullptr) {
+        if (type_info->Compare(lower_, upper_) >= 0) {
+          // If the range bounds are empty then no results can be returned.
+          SetToNone();
+        } else if (type_info->AreConsecutive(lower_, upper_)) {
+          // If the bounds only admit a single value, then this is either an
+          // equality predicate on that value or it matches nothing.
+          if (CheckValueInBloomFilter(lower_)) {
+            predicate_type_ = PredicateType::Equality;
+            upper_ = nullptr;
+            bloom_filters_.clear();
+          } else {
+            SetToNone();
+          }
+        }
+      }
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -257,6 +304,10 @@ void ColumnPredicate::Merge(const ColumnPredicate& other) {
       MergeIntoInList(other);
       return;
     };
+    case PredicateType::InBloomFilter: {
+      MergeIntoInBloomFilter(other);
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -323,6 +374,10 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
       Simplify();
       return;
     };
+    case PredicateType::InBloomFilter: {
+      MergeWithInBloomFilter(other);
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -360,6 +415,13 @@ void ColumnPredicate::MergeIntoEquality(const ColumnPredicate& other) {
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      // The equality value needs to pass the Bloom filters.
+      if (!other.CheckValueInBloomFilter(lower_)) {
+        SetToNone();
+      }
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -378,6 +440,7 @@ void ColumnPredicate::MergeIntoIsNotNull(const ColumnPredicate &other) {
       lower_ = other.lower_;
       upper_ = other.upper_;
       values_ = other.values_;
+      bloom_filters_ = other.bloom_filters_;
       return;
     }
   }
@@ -499,10 +562,90 @@ void ColumnPredicate::MergeIntoInList(const ColumnPredicate &other) {
       Simplify();
       return;
     };
+    case PredicateType::InBloomFilter: {
+      // Only values which pass the Bloom filters should be retained.
+      values_.erase(std::remove_if(values_.begin(), values_.end(),
+                                   [&other] (const void* v) {
+                                     return !other.CheckValueInBloomFilter(v);
+                                   }), values_.end());
+      Simplify();
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
 
+void ColumnPredicate::MergeIntoInBloomFilter(const ColumnPredicate& other) {
+  CHECK(predicate_type_ == PredicateType::InBloomFilter);
+  DCHECK(!bloom_filters_.empty());
+
+  switch (other.predicate_type()) {
+    case PredicateType::None: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::InBloomFilter:
+      // The value must pass the filters of both predicates.
+      bloom_filters_.insert(bloom_filters_.end(),
+                            other.bloom_filters_.begin(),
+                            other.bloom_filters_.end());
+      FALLTHROUGH_INTENDED;
+    case PredicateType::Range: {
+      // Set the lower bound to the larger of the two.
+      if (other.lower_ != nullptr &&
+          (lower_ == nullptr || column_.type_info()->Compare(lower_, other.lower_) < 0)) {
+        lower_ = other.lower_;
+      }
+
+      // Set the upper bound to the smaller of the two.
+      if (other.upper_ != nullptr &&
+          (upper_ == nullptr || column_.type_info()->Compare(upper_, other.upper_) > 0)) {
+        upper_ = other.upper_;
+      }
+
+      Simplify();
+      return;
+    };
+    case PredicateType::Equality: {
+      if (CheckValueInBloomFilter(other.lower_)) {
+        predicate_type_ = PredicateType::Equality;
+        lower_ = other.lower_;
+        upper_ = nullptr;
+        bloom_filters_.clear();
+      } else {
+        SetToNone();
+      }
+      return;
+    };
+    case PredicateType::IsNotNull: return;
+    case PredicateType::IsNull: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::InList: {
+      // The IN list is exact, so it is more selective than the filters:
+      // convert this predicate to the list of values which pass them.
+      values_.clear();
+      std::copy_if(other.values_.begin(), other.values_.end(), std::back_inserter(values_),
+                   [this] (const void* v) { return this->CheckValueInBloomFilter(v); });
+      predicate_type_ = PredicateType::InList;
+      lower_ = nullptr;
+      upper_ = nullptr;
+      bloom_filters_.clear();
+      Simplify();
+      return;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::MergeWithInBloomFilter(const ColumnPredicate& other) {
+  CHECK(other.predicate_type_ == PredicateType::InBloomFilter);
+  ColumnPredicate merged(other);
+  merged.MergeIntoInBloomFilter(*this);
+  *this = std::move(merged);
+}
+
 namespace {
 template <typename P>
 void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
@@ -524,6 +667,72 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
     }
   }
 }
+
+// Clears the selection bits of the NULL cells in 'block'.
+void ClearNullRows(const ColumnBlock& block, SelectionVector* sel) {
+  DCHECK(block.is_nullable());
+  const uint8_t* null_bitmap = block.null_bitmap();
+  uint8_t* sel_bitmap = sel->mutable_bitmap();
+  const size_t full_bytes = block.nrows() / 8;
+  for (size_t i = 0; i < full_bytes; i++) {
+    sel_bitmap[i] &= null_bitmap[i];
+  }
+  const size_t tail_bits = block.nrows() % 8;
+  if (tail_bits > 0) {
+    // Leave the bits past the end of the block alone.
+    const uint8_t tail_mask = (1 << tail_bits) - 1;
+    sel_bitmap[full_bytes] &= null_bitmap[full_bytes] | ~tail_mask;
+  }
+}
+
+// Evaluates a range or equality predicate over 'block' with the branch-free
+// kernels in column_predicate_kernels.h. Returns false, leaving 'sel'
+// untouched, if the kernels are disabled.
+template <DataType PhysicalType>
+typename std::enable_if<
+    predicate_kernels::HasKernel<typename DataTypeTraits<PhysicalType>::cpp_type>::value,
+    bool>::type
+EvaluateWithKernel(PredicateType predicate_type,
+                   const void* lower,
+                   const void* upper,
+                   const ColumnBlock& block,
+                   SelectionVector* sel) {
+  typedef typename DataTypeTraits<PhysicalType>::cpp_type T;
+  if (predicate_kernels::GetKernelArch() == predicate_kernels::KernelArch::SCALAR) {
+    return false;
+  }
+  const T* cells = reinterpret_cast<const T*>(block.data());
+  if (predicate_type == PredicateType::Equality) {
+    predicate_kernels::EvaluateEquality<T>(cells, block.nrows(),
+                                           *static_cast<const T*>(lower),
+                                           sel->mutable_bitmap());
+  } else {
+    DCHECK(predicate_type == PredicateType::Range);
+    predicate_kernels::EvaluateRange<T>(cells, block.nrows(),
+                                        static_cast<const T*>(lower),
+                                        static_cast<const T*>(upper),
+                                        sel->mutable_bitmap());
+  }
+  // The cells of NULL rows hold arbitrary data, so the kernels may have
+  // selected them.
+  if (block.is_nullable()) {
+    ClearNullRows(block, sel);
+  }
+  return true;
+}
+
+template <DataType PhysicalType>
+typename std::enable_if<
+    !predicate_kernels::HasKernel<typename DataTypeTraits<PhysicalType>::cpp_type>::value,
+    bool>::type
+EvaluateWithKernel(PredicateType /*predicate_type*/,
+                   const void* /*lower*/,
+                   const void* /*upper*/,
+                   const ColumnBlock& /*block*/,
+                   SelectionVector* /*sel*/) {
+  return false;
+}
+
 } // anonymous namespace
 
 template <DataType PhysicalType>
@@ -531,6 +740,9 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
                                               SelectionVector* sel) const {
   switch (predicate_type()) {
     case PredicateType::Range: {
+      if (EvaluateWithKernel<PhysicalType>(predicate_type_, lower_, upper_, block, sel)) {
+        return;
+      }
       if (lower_ == nullptr) {
         ApplyPredicate(block, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0;
@@ -548,6 +760,9 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     };
     case PredicateType::Equality: {
+      if (EvaluateWithKernel<PhysicalType>(predicate_type_, lower_, upper_, block, sel)) {
+        return;
+      }
       ApplyPredicate(block, sel, [this] (const void* cell) {
         return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) == 0;
       });
@@ -587,6 +802,12 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       });
       return;
     };
+    case PredicateType::InBloomFilter: {
+      ApplyPredicate(block, sel, [this] (const void* cell) {
+        return this->EvaluateCellInBloomFilter<PhysicalType>(cell);
+      });
+      return;
+    };
     case PredicateType::None: LOG(FATAL) << "NONE predicate evaluation";
   }
   LOG(FATAL) << "unknown predicate type";
@@ -666,6 +887,17 @@ string ColumnPredicate::ToString() const {
       ss.append(")");
       return ss;
     };
+    case PredicateType::InBloomFilter: {
+      string ss = strings::Substitute("$0 IN BLOOM FILTER ($1 filters)",
+                                      column_.name(), bloom_filters_.size());
+      if (lower_ != nullptr) {
+        ss.append(strings::Substitute(" AND $0 >= $1", column_.name(), column_.Stringify(lower_)));
+      }
+      if (upper_ != nullptr) {
+        ss.append(strings::Substitute(" AND $0 < $1", column_.name(), column_.Stringify(upper_)));
+      }
+      return ss;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -675,16 +907,17 @@ bool ColumnPredicate::operator==(const ColumnPredicate& other) const {
   if (predicate_type_ != other.predicate_type_) {
     return false;
   }
+  auto bounds_equal = [&] () {
+    return (lower_ == other.lower_ ||
+            (lower_ != nullptr && other.lower_ != nullptr &&
+             column_.type_info()->Compare(lower_, other.lower_) == 0)) &&
+           (upper_ == other.upper_ ||
+            (upper_ != nullptr && other.upper_ != nullptr &&
+             column_.type_info()->Compare(upper_, other.upper_) == 0));
+  };
   switch (predicate_type_) {
     case PredicateType::Equality: return column_.type_info()->Compare(lower_, other.lower_) == 0;
-    case PredicateType::Range: {
-      return (lower_ == other.lower_ ||
-              (lower_ != nullptr && other.lower_ != nullptr &&
-               column_.type_info()->Compare(lower_, other.lower_) == 0)) &&
-             (upper_ == other.upper_ ||
-              (upper_ != nullptr && other.upper_ != nullptr &&
-               column_.type_info()->Compare(upper_, other.upper_) == 0));
-    };
+    case PredicateType::Range: return bounds_equal();
     case PredicateType::InList: {
       if (values_.size() != other.values_.size()) return false;
       for (int i = 0; i < values_.size(); i++) {
@@ -692,6 +925,16 @@ bool ColumnPredicate::operator==(const ColumnPredicate& other) const {
       }
       return true;
     };
+    case PredicateType::InBloomFilter: {
+      if (bloom_filters_.size() != other.bloom_filters_.size()) return false;
+      for (int i = 0; i < bloom_filters_.size(); i++) {
+        if (bloom_filters_[i].n_hashes() != other.bloom_filters_[i].n_hashes() ||
+            bloom_filters_[i].slice() != other.bloom_filters_[i].slice()) {
+          return false;
+        }
+      }
+      return bounds_equal();
+    };
     case PredicateType::None:
     case PredicateType::IsNotNull:
     case PredicateType::IsNull: return true;
@@ -705,6 +948,21 @@ bool ColumnPredicate::CheckValueInRange(const void* value) const {
           (upper_ == nullptr || column_.type_info()->Compare(upper_, value) > 0));
 }
 
+bool ColumnPredicate::CheckValueInBloomFilter(const void* value) const {
+  CHECK(predicate_type_ == PredicateType::InBloomFilter);
+  if ((lower_ != nullptr && column_.type_info()->Compare(lower_, value) > 0) ||
+      (upper_ != nullptr && column_.type_info()->Compare(upper_, value) <= 0)) {
+    return false;
+  }
+  BloomKeyProbe probe(BloomFilterKey(column_, value));
+  for (const BloomFilter& bloom_filter : bloom_filters_) {
+    if (!bloom_filter.MayContainKey(probe)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool ColumnPredicate::CheckValueInList(const void* value) const {
   return std::binary_search(values_.begin(), values_.end(), value,
                             [this](const void* lhs, const void* rhs) {
@@ -720,8 +978,9 @@ int SelectivityRank(const ColumnPredicate& predicate) {
     case PredicateType::IsNull: rank = 1; break;
     case PredicateType::Equality: rank = 2; break;
     case PredicateType::InList: rank = 3; break;
-    case PredicateType::Range: rank = 4; break;
-    case PredicateType::IsNotNull: rank = 5; break;
+    case PredicateType::InBloomFilter: rank = 4; break;
+    case PredicateType::Range: rank = 5; break;
+    case PredicateType::IsNotNull: rank = 6; break;
     default: LOG(FATAL) << "unknown predicate type";
   }
   return rank * (kLargestTypeSize + 1) + predicate.column().type_info()->size();
@@ -28,6 +28,8 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 
@@ -56,6 +58,12 @@ enum class PredicateType {
   // A predicate which evaluates to true if the column value is present in
   // a value list.
   InList,
+
+  // A predicate which evaluates to true if the column value may be present
+  // in every one of a set of Bloom filters, and falls within an optional
+  // range. False positives are possible, so this predicate may match values
+  // which were never added to the filters.
+  InBloomFilter,
 };
 
 // A predicate which can be evaluated over a block of column values.
@@ -130,9 +138,33 @@ class ColumnPredicate {
   // The InList will be simplified into an Equality, Range or None if possible.
   static ColumnPredicate InList(ColumnSchema column, std::vector<const void*>* values);
 
+  // Creates a new IN <BLOOM FILTER> predicate for the column, which matches
+  // values which may be contained in every filter in 'bloom_filters' and
+  // which fall within the range ['lower', 'upper'). Either or both bounds may
+  // be nullptr.
+  //
+  // Values are probed using the key returned by BloomFilterKey().
+  //
+  // The filters' data and the bounds are not copied, and must outlive the
+  // returned predicate. 'bloom_filters' must not be empty.
+  static ColumnPredicate InBloomFilter(ColumnSchema column,
+                                       std::vector<BloomFilter>* bloom_filters,
+                                       const void* lower,
+                                       const void* upper);
+
   // Creates a new predicate which matches no values.
   static ColumnPredicate None(ColumnSchema column);
 
+  // Returns the key with which a cell of 'column' is probed in the filters of
+  // an InBloomFilter predicate: the value's data for BINARY-based types, and
+  // its little-endian in-memory representation for other types.
+  static Slice BloomFilterKey(const ColumnSchema& column, const void* cell) {
+    if (column.type_info()->physical_type() == BINARY) {
+      return *static_cast<const Slice*>(cell);
+    }
+    return Slice(static_cast<const uint8_t*>(cell), column.type_info()->size());
+  }
+
   // Returns the type of this predicate.
   PredicateType predicate_type() const {
     return predicate_type_;
@@ -196,6 +228,9 @@ class ColumnPredicate {
                                     return DataTypeTraits<PhysicalType>::Compare(lhs, rhs) < 0;
                                   });
       };
+      case PredicateType::InBloomFilter: {
+        return EvaluateCellInBloomFilter<PhysicalType>(cell);
+      };
     }
     LOG(FATAL) << "unknown predicate type";
   }
@@ -212,13 +247,13 @@ class ColumnPredicate {
   // Predicates over different columns are not equal.
   bool operator==(const ColumnPredicate& other) const;
 
-  // Returns the raw lower bound value if this is a range predicate, or the
-  // equality value if this is an equality predicate.
+  // Returns the raw lower bound value if this is a range or Bloom filter
+  // predicate, or the equality value if this is an equality predicate.
   const void* raw_lower() const {
     return lower_;
   }
 
-  // Returns the raw upper bound if this is a range predicate.
+  // Returns the raw upper bound if this is a range or Bloom filter predicate.
   const void* raw_upper() const {
     return upper_;
   }
@@ -234,6 +269,11 @@ class ColumnPredicate {
     return values_;
   }
 
+  // Returns the Bloom filters if this is an InBloomFilter predicate.
+  const std::vector<BloomFilter>& bloom_filters() const {
+    return bloom_filters_;
+  }
+
  private:
 
   friend class TestColumnPredicate;
@@ -249,6 +289,13 @@ class ColumnPredicate {
                   ColumnSchema column,
                   std::vector<const void*>* values);
 
+  // Creates a new InBloomFilter column predicate.
+  ColumnPredicate(PredicateType predicate_type,
+                  ColumnSchema column,
+                  std::vector<BloomFilter>* bloom_filters,
+                  const void* lower,
+                  const void* upper);
+
   // Transition to a None predicate type.
   void SetToNone();
 
@@ -276,6 +323,34 @@ class ColumnPredicate {
   // Merge another predicate into this InList predicate.
   void MergeIntoInList(const ColumnPredicate& other);
 
+  // Merge another predicate into this InBloomFilter predicate.
+  void MergeIntoInBloomFilter(const ColumnPredicate& other);
+
+  // Replace this predicate with the intersection of this predicate and
+  // 'other', an InBloomFilter predicate.
+  void MergeWithInBloomFilter(const ColumnPredicate& other);
+
+  // For an InBloomFilter type predicate, this helper function checks
+  // whether a given value falls in the range and may be in every filter.
+  bool CheckValueInBloomFilter(const void* value) const;
+
+  template <DataType PhysicalType>
+  bool EvaluateCellInBloomFilter(const void* cell) const {
+    if (lower_ != nullptr && DataTypeTraits<PhysicalType>::Compare(cell, lower_) < 0) {
+      return false;
+    }
+    if (upper_ != nullptr && DataTypeTraits<PhysicalType>::Compare(cell, upper_) >= 0) {
+      return false;
+    }
+    BloomKeyProbe probe(BloomFilterKey(column_, cell));
+    for (const BloomFilter& bloom_filter : bloom_filters_) {
+      if (!bloom_filter.MayContainKey(probe)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   // For a Range type predicate, this helper function checks
   // whether a given value is in the range.
   bool CheckValueInRange(const void* value) const;
@@ -290,15 +365,20 @@ class ColumnPredicate {
   // The data type of the column. TypeInfo instances have a static lifetime.
   ColumnSchema column_;
 
-  // The inclusive lower bound value if this is a Range predicate, or the
-  // equality value if this is an Equality predicate.
+  // The inclusive lower bound value if this is a Range or InBloomFilter
+  // predicate, or the equality value if this is an Equality predicate.
   const void* lower_;
 
-  // The exclusive upper bound value if this is a Range predicate.
+  // The exclusive upper bound value if this is a Range or InBloomFilter
+  // predicate.
   const void* upper_;
 
   // The list of values to check column against if this is an InList predicate.
   std::vector<const void*> values_;
+
+  // The filters to probe column values against if this is an InBloomFilter
+  // predicate.
+  std::vector<BloomFilter> bloom_filters_;
 };
 
 // Compares predicates according to selectivity. Predicates that match fewer
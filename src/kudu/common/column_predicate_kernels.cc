@@ -0,0 +1,352 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_predicate_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && !defined(__APPLE__)
+#include <immintrin.h>
+#endif
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/cpu.h"
+#include "kudu/gutil/port.h"
+
+using base::CPU;
+
+namespace kudu {
+namespace predicate_kernels {
+
+namespace {
+
+KernelArch g_kernel_arch = KernelArch::SCALAR;
+
+// The number of rows whose match bytes are computed before being packed into
+// the selection bitmap. Must be a multiple of 8.
+constexpr size_t kChunkRows = 1024;
+
+enum class Op {
+  LOWER,
+  UPPER,
+  BOTH,
+  EQUAL,
+};
+
+// Sets out[i] to 1 if cells[i] matches, and to 0 otherwise.
+//
+// The comparisons mirror DataTypeTraits<>::Compare() (and therefore treat
+// NaN the same way), but are combined with non-short-circuiting operators so
+// that the loop has no branches and the compiler can vectorize it for the
+// instruction set of whichever function it is inlined into.
+template <typename T, Op OP>
+ATTRIBUTE_ALWAYS_INLINE inline
+void ComputeMatches(const T* __restrict__ cells, size_t n, T a, T b,
+                    uint8_t* __restrict__ out) {
+  for (size_t i = 0; i < n; i++) {
+    const T v = cells[i];
+    bool match;
+    switch (OP) {
+      case Op::LOWER: match = !(v < a); break;
+      case Op::UPPER: match = v < b; break;
+      case Op::BOTH: match = !(v < a) & (v < b); break;
+      case Op::EQUAL: match = !(v < a) & !(a < v); break;
+    }
+    out[i] = match;
+  }
+}
+
+// ANDs the 'n' match bytes in 'matches' into 'bitmap', eight at a time.
+ATTRIBUTE_ALWAYS_INLINE inline
+void PackAndMatches(const uint8_t* matches, size_t n, uint8_t* bitmap) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t bytes;
+    memcpy(&bytes, matches + i, sizeof(bytes));
+    // Each byte is 0 or 1: the multiplication gathers the low bit of byte j
+    // into bit (56 + j) of the product.
+    bitmap[i / 8] &= static_cast<uint8_t>((bytes * 0x0102040810204080ULL) >> 56);
+  }
+  for (; i < n; i++) {
+    if (!matches[i]) {
+      bitmap[i / 8] &= ~(1 << (i % 8));
+    }
+  }
+}
+
+template <typename T, Op OP>
+ATTRIBUTE_ALWAYS_INLINE inline
+void EvaluateChunked(const T* cells, size_t nrows, T a, T b, uint8_t* sel_bitmap) {
+  uint8_t matches[kChunkRows];
+  for (size_t offset = 0; offset < nrows; offset += kChunkRows) {
+    size_t n = std::min(kChunkRows, nrows - offset);
+    ComputeMatches<T, OP>(cells + offset, n, a, b, matches);
+    PackAndMatches(matches, n, sel_bitmap + offset / 8);
+  }
+}
+
+#if defined(__x86_64__) && !defined(__APPLE__)
+template <typename T, Op OP>
+__attribute__((target("avx2")))
+void EvaluateAvx2(const T* cells, size_t nrows, T a, T b, uint8_t* sel_bitmap) {
+  EvaluateChunked<T, OP>(cells, nrows, a, b, sel_bitmap);
+}
+
+template <typename T, Op OP>
+__attribute__((target("sse4.2")))
+void EvaluateSse42(const T* cells, size_t nrows, T a, T b, uint8_t* sel_bitmap) {
+  EvaluateChunked<T, OP>(cells, nrows, a, b, sel_bitmap);
+}
+#endif
+
+template <typename T, Op OP>
+void EvaluateDefault(const T* cells, size_t nrows, T a, T b, uint8_t* sel_bitmap) {
+  EvaluateChunked<T, OP>(cells, nrows, a, b, sel_bitmap);
+}
+
+template <typename T, Op OP>
+void Dispatch(const T* cells, size_t nrows, T a, T b, uint8_t* sel_bitmap) {
+  switch (g_kernel_arch) {
+#if defined(__x86_64__) && !defined(__APPLE__)
+    case KernelArch::AVX2:
+      EvaluateAvx2<T, OP>(cells, nrows, a, b, sel_bitmap);
+      return;
+    case KernelArch::SSE4_2:
+      EvaluateSse42<T, OP>(cells, nrows, a, b, sel_bitmap);
+      return;
+#endif
+    case KernelArch::DEFAULT:
+      EvaluateDefault<T, OP>(cells, nrows, a, b, sel_bitmap);
+      return;
+    default:
+      break;
+  }
+  LOG(FATAL) << "no predicate kernel for architecture "
+             << KernelArchToString(g_kernel_arch);
+}
+
+// Sets bit j of 'masks[i / 8]' if the code 'codes[i + j]' is set in
+// 'code_bitmap', for the first 'n' codes. Bits beyond 'n' in the last mask are
+// set.
+ATTRIBUTE_ALWAYS_INLINE inline
+void ComputeCodeMasks(const uint32_t* __restrict__ codes, size_t n,
+                      const uint8_t* __restrict__ code_bitmap,
+                      uint8_t* __restrict__ masks) {
+  for (size_t i = 0; i < n; i += 8) {
+    const size_t nbits = std::min<size_t>(8, n - i);
+    uint8_t m = 0;
+    for (size_t j = 0; j < nbits; j++) {
+      const uint32_t c = codes[i + j];
+      m |= ((code_bitmap[c >> 3] >> (c & 7)) & 1) << j;
+    }
+    if (nbits < 8) {
+      m |= static_cast<uint8_t>(0xff << nbits);
+    }
+    masks[i / 8] = m;
+  }
+}
+
+// ANDs the 'n' bits of 'masks' into 'bitmap', starting at bit 'offset'. Bits
+// beyond 'n' in the last mask must be set.
+ATTRIBUTE_ALWAYS_INLINE inline
+void AndMasks(const uint8_t* masks, size_t n, uint8_t* bitmap, size_t offset) {
+  uint8_t* dst = bitmap + offset / 8;
+  const size_t shift = offset % 8;
+  if (shift == 0) {
+    for (size_t i = 0; i < (n + 7) / 8; i++) {
+      dst[i] &= masks[i];
+    }
+    return;
+  }
+  for (size_t i = 0; i < (n + 7) / 8; i++) {
+    // Each mask straddles two bytes of the bitmap. Only touch the second one
+    // if one of its bits is being cleared, as it may be past the end.
+    const unsigned clear = static_cast<unsigned>(static_cast<uint8_t>(~masks[i])) << shift;
+    dst[i] &= ~static_cast<uint8_t>(clear);
+    if (clear >> 8) {
+      dst[i + 1] &= ~static_cast<uint8_t>(clear >> 8);
+    }
+  }
+}
+
+ATTRIBUTE_ALWAYS_INLINE inline
+void EvaluateCodesChunked(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                          uint8_t* sel_bitmap, size_t sel_offset,
+                          void (*compute)(const uint32_t*, size_t, const uint8_t*, uint8_t*)) {
+  uint8_t masks[kChunkRows / 8];
+  for (size_t offset = 0; offset < n; offset += kChunkRows) {
+    const size_t nrows = std::min(kChunkRows, n - offset);
+    compute(codes + offset, nrows, code_bitmap, masks);
+    AndMasks(masks, nrows, sel_bitmap, sel_offset + offset);
+  }
+}
+
+#if defined(__x86_64__) && !defined(__APPLE__)
+// Looks up eight codes at a time with a gather of the 32-bit words of
+// 'code_bitmap' holding them.
+__attribute__((target("avx2")))
+void ComputeCodeMasksAvx2(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                          uint8_t* masks) {
+  const int* words = reinterpret_cast<const int*>(code_bitmap);
+  const __m256i low_bits = _mm256_set1_epi32(31);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i));
+    const __m256i w = _mm256_i32gather_epi32(words, _mm256_srli_epi32(c, 5), 4);
+    // Move the bit for each code to the sign bit of its lane.
+    const __m256i bit = _mm256_sllv_epi32(
+        _mm256_srlv_epi32(w, _mm256_and_si256(c, low_bits)), low_bits);
+    masks[i / 8] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(bit)));
+  }
+  if (i < n) {
+    ComputeCodeMasks(codes + i, n - i, code_bitmap, masks + i / 8);
+  }
+}
+
+__attribute__((target("avx2")))
+void EvaluateCodesAvx2(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                       uint8_t* sel_bitmap, size_t sel_offset) {
+  EvaluateCodesChunked(codes, n, code_bitmap, sel_bitmap, sel_offset, &ComputeCodeMasksAvx2);
+}
+#endif
+
+void ComputeCodeMasksDefault(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                             uint8_t* masks) {
+  ComputeCodeMasks(codes, n, code_bitmap, masks);
+}
+
+void EvaluateCodesDefault(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                          uint8_t* sel_bitmap, size_t sel_offset) {
+  EvaluateCodesChunked(codes, n, code_bitmap, sel_bitmap, sel_offset,
+                       &ComputeCodeMasksDefault);
+}
+
+// When this translation unit is initialized, figure out the current CPU and
+// select the kernels for this architecture, so that the hot path doesn't
+// need an expensive 'cpuid' call.
+__attribute__((constructor))
+void SelectPredicateKernels() {
+#if defined(__x86_64__) && !defined(__APPLE__)
+  CPU cpu;
+  if (cpu.has_avx2()) {
+    g_kernel_arch = KernelArch::AVX2;
+  } else if (cpu.has_sse42()) {
+    g_kernel_arch = KernelArch::SSE4_2;
+  } else {
+    g_kernel_arch = KernelArch::DEFAULT;
+  }
+#else
+  g_kernel_arch = KernelArch::DEFAULT;
+#endif
+}
+
+} // anonymous namespace
+
+KernelArch GetKernelArch() {
+  return g_kernel_arch;
+}
+
+void SetKernelArchForTests(KernelArch arch) {
+  CHECK(IsKernelArchSupported(arch)) << KernelArchToString(arch);
+  g_kernel_arch = arch;
+}
+
+bool IsKernelArchSupported(KernelArch arch) {
+  switch (arch) {
+    case KernelArch::SCALAR:
+    case KernelArch::DEFAULT:
+      return true;
+#if defined(__x86_64__) && !defined(__APPLE__)
+    case KernelArch::SSE4_2:
+      return CPU().has_sse42();
+    case KernelArch::AVX2:
+      return CPU().has_avx2();
+#endif
+    default:
+      return false;
+  }
+}
+
+const char* KernelArchToString(KernelArch arch) {
+  switch (arch) {
+    case KernelArch::SCALAR: return "scalar";
+    case KernelArch::DEFAULT: return "default";
+    case KernelArch::SSE4_2: return "sse4.2";
+    case KernelArch::AVX2: return "avx2";
+  }
+  return "unknown";
+}
+
+template <typename T>
+void EvaluateRange(const T* cells, size_t nrows, const T* lower, const T* upper,
+                   uint8_t* sel_bitmap) {
+  DCHECK(lower != nullptr || upper != nullptr);
+  if (upper == nullptr) {
+    Dispatch<T, Op::LOWER>(cells, nrows, *lower, T(), sel_bitmap);
+  } else if (lower == nullptr) {
+    Dispatch<T, Op::UPPER>(cells, nrows, T(), *upper, sel_bitmap);
+  } else {
+    Dispatch<T, Op::BOTH>(cells, nrows, *lower, *upper, sel_bitmap);
+  }
+}
+
+template <typename T>
+void EvaluateEquality(const T* cells, size_t nrows, T value, uint8_t* sel_bitmap) {
+  Dispatch<T, Op::EQUAL>(cells, nrows, value, value, sel_bitmap);
+}
+
+void EvaluateDictionaryCodes(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                             uint8_t* sel_bitmap, size_t sel_offset) {
+  switch (g_kernel_arch) {
+#if defined(__x86_64__) && !defined(__APPLE__)
+    case KernelArch::AVX2:
+      EvaluateCodesAvx2(codes, n, code_bitmap, sel_bitmap, sel_offset);
+      return;
+#endif
+    // Without gathers, a scalar lookup is as good as it gets.
+    case KernelArch::SSE4_2:
+    case KernelArch::DEFAULT:
+      EvaluateCodesDefault(codes, n, code_bitmap, sel_bitmap, sel_offset);
+      return;
+    default:
+      break;
+  }
+  LOG(FATAL) << "no dictionary kernel for architecture "
+             << KernelArchToString(g_kernel_arch);
+}
+
+#define INSTANTIATE_KERNELS(T) \
+  template void EvaluateRange<T>(const T*, size_t, const T*, const T*, uint8_t*); \
+  template void EvaluateEquality<T>(const T*, size_t, T, uint8_t*)
+
+INSTANTIATE_KERNELS(int8_t);
+INSTANTIATE_KERNELS(int16_t);
+INSTANTIATE_KERNELS(int32_t);
+INSTANTIATE_KERNELS(int64_t);
+INSTANTIATE_KERNELS(uint8_t);
+INSTANTIATE_KERNELS(uint16_t);
+INSTANTIATE_KERNELS(uint32_t);
+INSTANTIATE_KERNELS(uint64_t);
+INSTANTIATE_KERNELS(float);
+INSTANTIATE_KERNELS(double);
+
+#undef INSTANTIATE_KERNELS
+
+} // namespace predicate_kernels
+} // namespace kudu
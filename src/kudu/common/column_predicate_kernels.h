@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Branch-free kernels which evaluate range and equality predicates over a
+// contiguous array of fixed-width cells, and predicates over dictionary codes.
+//
+// The kernels are compiled once per supported instruction set (AVX2, SSE4.2
+// and the build's baseline) and the best one for the running CPU is selected
+// when the library is loaded, in the same way as the bitshuffle wrappers.
+namespace kudu {
+namespace predicate_kernels {
+
+// The instruction set used by the kernels.
+enum class KernelArch {
+  // The kernels are disabled; callers should fall back to evaluating the
+  // predicate cell by cell.
+  SCALAR,
+  DEFAULT,
+  SSE4_2,
+  AVX2,
+};
+
+// Whether there are kernels for cells of type 'T'.
+template <typename T>
+struct HasKernel : std::integral_constant<bool,
+    std::is_arithmetic<T>::value &&
+    !std::is_same<T, bool>::value &&
+    sizeof(T) <= sizeof(int64_t)> {
+};
+
+// Returns the instruction set selected for the running CPU.
+KernelArch GetKernelArch();
+
+// Overrides the instruction set used by the kernels. 'arch' must be
+// supported by the running CPU. Not thread-safe: only for use in tests and
+// benchmarks.
+void SetKernelArchForTests(KernelArch arch);
+
+// Returns true if 'arch' is supported by the running CPU.
+bool IsKernelArchSupported(KernelArch arch);
+
+const char* KernelArchToString(KernelArch arch);
+
+// Clears the bit in 'sel_bitmap' for every cell among the first 'nrows'
+// which does not satisfy 'lower' <= cell < 'upper'. Either bound (but not
+// both) may be null, in which case it is unbounded. Bits at or beyond
+// 'nrows' are left untouched.
+//
+// Must not be called if GetKernelArch() is SCALAR.
+template <typename T>
+void EvaluateRange(const T* cells, size_t nrows, const T* lower, const T* upper,
+                   uint8_t* sel_bitmap);
+
+// Clears the bit in 'sel_bitmap' for every cell among the first 'nrows'
+// which is not equal to 'value'. Bits at or beyond 'nrows' are left
+// untouched.
+//
+// Must not be called if GetKernelArch() is SCALAR.
+template <typename T>
+void EvaluateEquality(const T* cells, size_t nrows, T value, uint8_t* sel_bitmap);
+
+// Clears bit ('sel_offset' + i) in 'sel_bitmap' for every i among the first
+// 'n' such that bit 'codes[i]' is not set in 'code_bitmap'. Used to evaluate
+// a predicate over dictionary-encoded cells once the predicate has been
+// evaluated against each word of the dictionary.
+//
+// 'code_bitmap' must be readable in whole 32-bit words up to and including
+// the one holding its highest code. Other bits of 'sel_bitmap' are left
+// untouched.
+//
+// Must not be called if GetKernelArch() is SCALAR.
+void EvaluateDictionaryCodes(const uint32_t* codes, size_t n, const uint8_t* code_bitmap,
+                             uint8_t* sel_bitmap, size_t sel_offset);
+
+} // namespace predicate_kernels
+} // namespace kudu
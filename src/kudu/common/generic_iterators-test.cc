@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <glog/stl_logging.h>
@@ -32,6 +33,7 @@
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/column_materialization_context.h"
@@ -40,12 +42,15 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(num_lists, 3, "Number of lists to merge");
 DEFINE_int32(num_rows, 1000, "Number of entries per list");
@@ -55,6 +60,7 @@ using std::make_shared;
 using std::shared_ptr;
 using std::string;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 
@@ -247,6 +253,127 @@ TEST(TestMergeIterator, TestMergePredicate2) {
   TestMerge(predicate);
 }
 
+// Test that sub-iterators whose key bounds fall outside of the scan's key
+// range are not merged, while those with overlapping or unknown bounds are.
+TEST(TestMergeIterator, TestDropNonOverlappingIters) {
+  EncodedKeyBuilder builder(&kIntSchema);
+  auto encode = [&](const uint32_t* val) {
+    builder.Reset();
+    builder.AddColumnKey(val);
+    return gscoped_ptr<EncodedKey>(builder.BuildEncodedKey());
+  };
+  const uint32_t kLower = 10;
+  const uint32_t kUpper = 20;
+  gscoped_ptr<EncodedKey> lower_key = encode(&kLower);
+  gscoped_ptr<EncodedKey> upper_key = encode(&kUpper);
+  ScanSpec spec;
+  spec.SetLowerBoundKey(lower_key.get());
+  spec.SetExclusiveUpperBoundKey(upper_key.get());
+
+  auto make_iter = [&](vector<uint32_t> ints, bool with_bounds) {
+    uint32_t min = ints.front();
+    uint32_t max = ints.back();
+    IterWithBounds iter(make_shared<MaterializingIterator>(
+        make_shared<VectorIterator>(std::move(ints))));
+    if (with_bounds) {
+      iter.encoded_bounds = std::make_pair(encode(&min)->encoded_key().ToString(),
+                                           encode(&max)->encoded_key().ToString());
+    }
+    return iter;
+  };
+  vector<IterWithBounds> to_merge;
+  to_merge.emplace_back(make_iter({ 1, 2, 3 }, true));     // Entirely below.
+  to_merge.emplace_back(make_iter({ 5, 10 }, true));       // Touches the lower bound.
+  to_merge.emplace_back(make_iter({ 15, 16 }, true));      // Entirely within.
+  to_merge.emplace_back(make_iter({ 20, 25 }, true));      // At the exclusive upper bound.
+  to_merge.emplace_back(make_iter({ 5, 12, 22 }, false));  // Unknown bounds.
+
+  MergeIterator merger(kIntSchema, std::move(to_merge));
+  ASSERT_OK(merger.Init(&spec));
+  vector<uint32_t> results;
+  RowBlock dst(kIntSchema, 100, nullptr);
+  while (merger.HasNext()) {
+    ASSERT_OK(merger.NextBlock(&dst));
+    for (int i = 0; i < dst.nrows(); i++) {
+      results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  ASSERT_EQ(vector<uint32_t>({ 5, 5, 10, 12, 15, 16, 22 }), results);
+  ASSERT_EQ("Merge(5 iters)", merger.ToString());
+}
+
+void TestParallelUnion(const TestIntRangePredicate* predicate) {
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("scan").set_max_threads(4).Build(&pool));
+
+  vector<shared_ptr<RowwiseIterator>> to_union;
+  vector<uint32_t> expected;
+  for (int i = 0; i < FLAGS_num_lists; i++) {
+    vector<uint32_t> ints;
+    for (int j = 0; j < FLAGS_num_rows; j++) {
+      uint32_t entry = rand() % 1000;
+      ints.push_back(entry);
+      if (!predicate || (entry >= predicate->lower_ && entry < predicate->upper_)) {
+        expected.push_back(entry);
+      }
+    }
+    shared_ptr<VectorIterator> it(new VectorIterator(std::move(ints)));
+    it->set_block_size(10);
+    to_union.emplace_back(new MaterializingIterator(it));
+  }
+  std::sort(expected.begin(), expected.end());
+
+  ScanSpec spec;
+  if (predicate) {
+    spec.AddPredicate(predicate->pred_);
+  }
+  ParallelUnionIterator iter(std::move(to_union), pool.get(), 3);
+  ASSERT_OK(iter.Init(&spec));
+  ASSERT_EQ(0, spec.predicates().size()) << "Iterator should have pushed down predicate";
+  ASSERT_EQ(Substitute("ParallelUnion($0 groups)", std::min(3, FLAGS_num_lists)),
+            iter.ToString());
+
+  // Use blocks smaller than the sub-iterators' so that batches are returned
+  // over several calls.
+  vector<uint32_t> results;
+  RowBlock dst(kIntSchema, 7, nullptr);
+  while (iter.HasNext()) {
+    ASSERT_OK(iter.NextBlock(&dst));
+    for (int i = 0; i < dst.nrows(); i++) {
+      ASSERT_TRUE(dst.selection_vector()->IsRowSelected(i));
+      results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  std::sort(results.begin(), results.end());
+  ASSERT_EQ(expected, results);
+}
+
+TEST(TestParallelUnionIterator, TestUnion) {
+  TestParallelUnion(nullptr);
+}
+
+TEST(TestParallelUnionIterator, TestUnionPredicate) {
+  TestIntRangePredicate predicate(100, 200);
+  TestParallelUnion(&predicate);
+}
+
+// Test that destroying the iterator partway through a scan stops its tasks.
+TEST(TestParallelUnionIterator, TestDestroyMidScan) {
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("scan").set_max_threads(4).Build(&pool));
+  vector<shared_ptr<RowwiseIterator>> to_union;
+  for (int i = 0; i < 8; i++) {
+    shared_ptr<VectorIterator> it(new VectorIterator(vector<uint32_t>(1000, i)));
+    it->set_block_size(10);
+    to_union.emplace_back(new MaterializingIterator(it));
+  }
+  ParallelUnionIterator iter(std::move(to_union), pool.get(), 4);
+  ASSERT_OK(iter.Init(nullptr));
+  RowBlock dst(kIntSchema, 10, nullptr);
+  ASSERT_OK(iter.NextBlock(&dst));
+  ASSERT_EQ(10, dst.nrows());
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
@@ -418,4 +545,47 @@ TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluationOrder) {
   }
 }
 
+// Test that TopNIterator yields the best rows of its base iterator in order,
+// and publishes the worst of them as the bound of the scan.
+TEST(TestTopNIterator, TestTopN) {
+  const int kNumRows = 1000;
+  const int kLimit = 10;
+  // A permutation of [0, kNumRows).
+  vector<uint32_t> ints;
+  for (int i = 0; i < kNumRows; i++) {
+    ints.push_back((i * 7919) % kNumRows);
+  }
+
+  for (bool descending : { false, true }) {
+    SCOPED_TRACE(descending);
+    shared_ptr<VectorIterator> colwise(new VectorIterator(ints));
+    colwise->set_block_size(64);
+    TopNIterator iter(make_shared<MaterializingIterator>(colwise), 0, descending, kLimit);
+    ScanSpec spec;
+    ASSERT_OK(iter.Init(&spec));
+    ASSERT_TRUE(spec.top_n_bound());
+
+    Arena arena(1024);
+    RowBlock dst(kIntSchema, 100, &arena);
+    vector<uint32_t> results;
+    while (iter.HasNext()) {
+      ASSERT_OK(iter.NextBlock(&dst));
+      for (size_t i = 0; i < dst.nrows(); i++) {
+        ASSERT_TRUE(dst.selection_vector()->IsRowSelected(i));
+        results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+      }
+    }
+    vector<uint32_t> expected;
+    for (int i = 0; i < kLimit; i++) {
+      expected.push_back(descending ? kNumRows - 1 - i : i);
+    }
+    ASSERT_EQ(expected, results);
+
+    boost::optional<ColumnPredicate> bound = spec.top_n_bound()->GetPredicate(&arena);
+    ASSERT_TRUE(bound);
+    const void* bound_value = descending ? bound->raw_lower() : bound->raw_upper();
+    ASSERT_EQ(expected.back(), *reinterpret_cast<const uint32_t*>(bound_value));
+  }
+}
+
 } // namespace kudu
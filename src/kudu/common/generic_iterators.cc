@@ -18,7 +18,9 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <mutex>
@@ -32,16 +34,22 @@
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
 
 using std::get;
 using std::move;
@@ -60,6 +68,16 @@ DEFINE_bool(materializing_iterator_decoder_eval, true,
             "Should MaterializingIterator do decoder-level evaluation");
 TAG_FLAG(materializing_iterator_decoder_eval, hidden);
 TAG_FLAG(materializing_iterator_decoder_eval, runtime);
+DEFINE_bool(materializing_iterator_late_materialization, true,
+            "Should MaterializingIterator materialize columns without predicates "
+            "only for the rows which passed all predicates");
+TAG_FLAG(materializing_iterator_late_materialization, hidden);
+TAG_FLAG(materializing_iterator_late_materialization, runtime);
+DEFINE_bool(merge_use_normalized_key_prefixes, true,
+            "Whether merges of sorted rows compare fixed-size prefixes of the "
+            "encoded primary keys of the rows with memcmp() before falling back "
+            "to comparing the rows column by column");
+TAG_FLAG(merge_use_normalized_key_prefixes, advanced);
 
 namespace kudu {
 namespace {
@@ -72,6 +90,15 @@ void AddIterStats(const RowwiseIterator& iter,
     (*stats)[i] += iter_stats[i];
   }
 }
+
+vector<IterWithBounds> WrapWithoutBounds(vector<shared_ptr<RowwiseIterator>> iters) {
+  vector<IterWithBounds> ret;
+  ret.reserve(iters.size());
+  for (auto& iter : iters) {
+    ret.emplace_back(std::move(iter));
+  }
+  return ret;
+}
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////
@@ -86,20 +113,29 @@ static const int kMergeRowBuffer = 1000;
 // such that all returned rows are valid.
 class MergeIterState {
  public:
-  explicit MergeIterState(shared_ptr<RowwiseIterator> iter) :
+  MergeIterState(shared_ptr<RowwiseIterator> iter, bool use_key_prefix) :
       iter_(std::move(iter)),
       arena_(1024),
       read_block_(iter_->schema(), kMergeRowBuffer, &arena_),
       next_row_idx_(0),
       num_advanced_(0),
-      num_valid_(0)
+      num_valid_(0),
+      use_key_prefix_(use_key_prefix)
   {}
 
-  const RowBlockRow& next_row() {
+  const RowBlockRow& next_row() const {
     DCHECK_LT(num_advanced_, num_valid_);
     return next_row_;
   }
 
+  // The normalized key prefix of next_row(). Only valid if the state was
+  // constructed with 'use_key_prefix'.
+  const key_util::NormalizedKeyPrefix& next_key_prefix() const {
+    DCHECK(use_key_prefix_);
+    DCHECK_LT(num_advanced_, num_valid_);
+    return next_key_prefix_;
+  }
+
   Status Advance() {
     num_advanced_++;
     if (IsBlockExhausted()) {
@@ -110,7 +146,7 @@ class MergeIterState {
       SelectionVector *selection = read_block_.selection_vector();
       for (++next_row_idx_; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
         if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
+          SeekToRow(next_row_idx_);
           break;
         }
       }
@@ -143,7 +179,7 @@ class MergeIterState {
       // Seek next_row_ to the first selected row.
       for (next_row_idx_ = 0; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
         if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
+          SeekToRow(next_row_idx_);
           return Status::OK();
         }
       }
@@ -165,6 +201,14 @@ class MergeIterState {
     return iter_;
   }
 
+  // Points next_row_ at the row of read_block_ at 'row_idx'.
+  void SeekToRow(size_t row_idx) {
+    next_row_.Reset(&read_block_, row_idx);
+    if (use_key_prefix_) {
+      key_util::EncodeKeyPrefix(next_row_, &key_buf_, &next_key_prefix_);
+    }
+  }
+
   shared_ptr<RowwiseIterator> iter_;
   Arena arena_;
   RowBlock read_block_;
@@ -176,17 +220,30 @@ class MergeIterState {
   size_t num_advanced_;
   // Number of valid (selected) rows in the current RowBlock.
   size_t num_valid_;
+
+  // Whether the normalized key prefix of next_row_ is maintained.
+  const bool use_key_prefix_;
+  key_util::NormalizedKeyPrefix next_key_prefix_;
+  // Scratch space for encoding the key prefixes.
+  faststring key_buf_;
 };
 
 
 MergeIterator::MergeIterator(
     const Schema& schema,
     vector<shared_ptr<RowwiseIterator>> iters)
+    : MergeIterator(schema, WrapWithoutBounds(std::move(iters))) {
+}
+
+MergeIterator::MergeIterator(
+    const Schema& schema,
+    vector<IterWithBounds> iters)
     : schema_(schema),
       initted_(false),
       orig_iters_(std::move(iters)),
       finished_iter_stats_by_col_(schema_.num_columns()),
-      num_orig_iters_(orig_iters_.size()) {
+      num_orig_iters_(orig_iters_.size()),
+      use_key_prefixes_(FLAGS_merge_use_normalized_key_prefixes) {
   CHECK_GT(orig_iters_.size(), 0);
   CHECK_GT(schema.num_key_columns(), 0);
 }
@@ -197,6 +254,9 @@ Status MergeIterator::Init(ScanSpec *spec) {
   CHECK(!initted_);
   // TODO: check that schemas match up!
 
+  if (spec != nullptr) {
+    DropNonOverlappingIters(*spec);
+  }
   RETURN_NOT_OK(InitSubIterators(spec));
 
   for (unique_ptr<MergeIterState> &state : iters_) {
@@ -212,10 +272,69 @@ Status MergeIterator::Init(ScanSpec *spec) {
       }),
       iters_.end());
 
+  heap_.reserve(iters_.size());
+  for (const unique_ptr<MergeIterState>& state : iters_) {
+    heap_.push_back(state.get());
+  }
+  std::make_heap(heap_.begin(), heap_.end(),
+                 [this](const MergeIterState* a, const MergeIterState* b) {
+                   return HeapGreater(a, b);
+                 });
+
   initted_ = true;
   return Status::OK();
 }
 
+void MergeIterator::DropNonOverlappingIters(const ScanSpec& spec) {
+  const EncodedKey* lower_bound = spec.lower_bound_key();
+  const EncodedKey* upper_bound = spec.exclusive_upper_bound_key();
+  if (lower_bound == nullptr && upper_bound == nullptr) {
+    return;
+  }
+  orig_iters_.erase(
+      remove_if(orig_iters_.begin(), orig_iters_.end(),
+                [&] (const IterWithBounds& iter) {
+                  if (!iter.encoded_bounds) {
+                    return false;
+                  }
+                  const Slice min_key(iter.encoded_bounds->first);
+                  const Slice max_key(iter.encoded_bounds->second);
+                  if (lower_bound != nullptr &&
+                      max_key.compare(lower_bound->encoded_key()) < 0) {
+                    return true;
+                  }
+                  if (upper_bound != nullptr &&
+                      upper_bound->encoded_key().compare(min_key) <= 0) {
+                    return true;
+                  }
+                  return false;
+                }),
+      orig_iters_.end());
+  VLOG(1) << "Merging " << orig_iters_.size() << " of " << num_orig_iters_
+          << " sub-iterators overlapping the scan's key range";
+}
+
+bool MergeIterator::HeapGreater(const MergeIterState* a, const MergeIterState* b) const {
+  if (use_key_prefixes_) {
+    int prefix_comp = a->next_key_prefix().Compare(b->next_key_prefix());
+    if (prefix_comp != 0) {
+      return prefix_comp > 0;
+    }
+  }
+  return schema_.Compare(a->next_row(), b->next_row()) > 0;
+}
+
+void MergeIterator::RemoveExhaustedIter(MergeIterState* state) {
+  std::lock_guard<rw_spinlock> l(iters_lock_);
+  AddIterStats(*state->iter(), &finished_iter_stats_by_col_);
+  auto it = std::find_if(iters_.begin(), iters_.end(),
+                         [state](const unique_ptr<MergeIterState>& s) {
+                           return s.get() == state;
+                         });
+  DCHECK(it != iters_.end());
+  iters_.erase(it);
+}
+
 bool MergeIterator::HasNext() const {
   CHECK(initted_);
   return !iters_.empty();
@@ -223,10 +342,11 @@ bool MergeIterator::HasNext() const {
 
 Status MergeIterator::InitSubIterators(ScanSpec *spec) {
   // Initialize all the sub iterators.
-  for (shared_ptr<RowwiseIterator> &iter : orig_iters_) {
+  for (IterWithBounds& i : orig_iters_) {
     ScanSpec *spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
-    RETURN_NOT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&iter, spec_copy));
-    iters_.push_back(unique_ptr<MergeIterState>(new MergeIterState(std::move(iter))));
+    RETURN_NOT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&i.iter, spec_copy));
+    iters_.push_back(unique_ptr<MergeIterState>(
+        new MergeIterState(std::move(i.iter), use_key_prefixes_)));
   }
   orig_iters_.clear();
 
@@ -270,36 +390,29 @@ Status MergeIterator::MaterializeBlock(RowBlock *dst) {
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
+  const auto heap_greater = [this](const MergeIterState* a, const MergeIterState* b) {
+    return HeapGreater(a, b);
+  };
   for (size_t dst_row_idx = 0; dst_row_idx < dst->nrows(); dst_row_idx++) {
-    RowBlockRow dst_row = dst->row(dst_row_idx);
-
-    // Find the sub-iterator which is currently smallest
-    MergeIterState *smallest = nullptr;
-    ssize_t smallest_idx = -1;
-
-    // Typically the number of iters_ is not that large, so using a priority
-    // queue is not worth it
-    for (size_t i = 0; i < iters_.size(); i++) {
-      unique_ptr<MergeIterState> &state = iters_[i];
+    // If no iterators had any row left, then we're done iterating.
+    if (PREDICT_FALSE(heap_.empty())) break;
 
-      if (smallest == nullptr ||
-          schema_.Compare(state->next_row(), smallest->next_row()) < 0) {
-        smallest = state.get();
-        smallest_idx = i;
-      }
-    }
+    RowBlockRow dst_row = dst->row(dst_row_idx);
 
-    // If no iterators had any row left, then we're done iterating.
-    if (PREDICT_FALSE(smallest == nullptr)) break;
+    // Move the sub-iterator which is currently smallest to the back of the heap.
+    std::pop_heap(heap_.begin(), heap_.end(), heap_greater);
+    MergeIterState* smallest = heap_.back();
 
-    // Otherwise, copy the row from the smallest one, and advance it
+    // Copy the row from the smallest one, and advance it
     RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
     RETURN_NOT_OK(smallest->Advance());
 
     if (smallest->IsFullyExhausted()) {
-      std::lock_guard<rw_spinlock> l(iters_lock_);
-      AddIterStats(*smallest->iter(), &finished_iter_stats_by_col_);
-      iters_.erase(iters_.begin() + smallest_idx);
+      heap_.pop_back();
+      RemoveExhaustedIter(smallest);
+    } else {
+      // Its next row has changed; sift it back into place.
+      std::push_heap(heap_.begin(), heap_.end(), heap_greater);
     }
   }
 
@@ -442,6 +555,237 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
   }
 }
 
+////////////////////////////////////////////////////////////
+// Parallel union iterator
+////////////////////////////////////////////////////////////
+
+struct ParallelUnionIterator::Batch {
+  Batch(const Schema& schema, size_t nrows)
+      : arena(32 * 1024),
+        block(schema, nrows, &arena),
+        next_row(0) {
+  }
+
+  Arena arena;
+  RowBlock block;
+
+  // The index of the next row of 'block' to return.
+  size_t next_row;
+};
+
+ParallelUnionIterator::ParallelUnionIterator(vector<shared_ptr<RowwiseIterator>> iters,
+                                             ThreadPool* pool,
+                                             int parallelism)
+    : pool_(CHECK_NOTNULL(pool)),
+      parallelism_(parallelism),
+      iters_(std::move(iters)),
+      initted_(false),
+      max_batches_(0),
+      cond_(&lock_),
+      batch_rows_(0),
+      num_running_(0),
+      stopping_(false) {
+  CHECK_GT(iters_.size(), 0);
+  CHECK_GT(parallelism_, 0);
+}
+
+ParallelUnionIterator::~ParallelUnionIterator() {
+  {
+    MutexLock l(lock_);
+    stopping_ = true;
+  }
+  if (token_) {
+    token_->Shutdown();
+  }
+}
+
+Status ParallelUnionIterator::Init(ScanSpec *spec) {
+  CHECK(!initted_);
+
+  const size_t num_groups = std::min<size_t>(parallelism_, iters_.size());
+  vector<vector<shared_ptr<RowwiseIterator>>> group_iters(num_groups);
+  for (size_t i = 0; i < iters_.size(); i++) {
+    group_iters[i % num_groups].emplace_back(std::move(iters_[i]));
+  }
+  iters_.clear();
+
+  // Each group is a UnionIterator, which evaluates all of the predicates in
+  // its own copy of the spec.
+  for (auto& iters : group_iters) {
+    unique_ptr<Group> group(new Group);
+    group->iter = std::make_shared<UnionIterator>(std::move(iters));
+    ScanSpec* spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
+    RETURN_NOT_OK(group->iter->Init(spec_copy));
+    group->running = false;
+    group->exhausted = !group->iter->HasNext();
+    groups_.emplace_back(std::move(group));
+  }
+  if (spec != nullptr) {
+    spec->RemovePredicates();
+  }
+
+  schema_.reset(new Schema(groups_.front()->iter->schema()));
+  for (const auto& group : groups_) {
+    if (!group->iter->schema().Equals(*schema_)) {
+      return Status::InvalidArgument(
+          strings::Substitute("Schemas do not match: $0 vs $1",
+                     schema_->ToString(), group->iter->schema().ToString()));
+    }
+  }
+
+  // Keep every group busy, with as many batches again waiting to be returned.
+  max_batches_ = 2 * groups_.size();
+  token_ = pool_->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  initted_ = true;
+  return Status::OK();
+}
+
+bool ParallelUnionIterator::HasNext() const {
+  CHECK(initted_);
+  MutexLock l(lock_);
+  if (!ready_.empty()) {
+    return true;
+  }
+  for (const auto& group : groups_) {
+    if (!group->exhausted) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParallelUnionIterator::ScheduleUnlocked() {
+  lock_.AssertAcquired();
+  for (const auto& group : groups_) {
+    if (stopping_ || !status_.ok() || ready_.size() + num_running_ >= max_batches_) {
+      return;
+    }
+    if (group->running || group->exhausted) {
+      continue;
+    }
+    Group* g = group.get();
+    Status s = token_->SubmitFunc([this, g]() { this->RunGroup(g); });
+    if (!s.ok()) {
+      status_ = s.CloneAndPrepend("unable to schedule parallel scan");
+      return;
+    }
+    group->running = true;
+    num_running_++;
+  }
+}
+
+void ParallelUnionIterator::RunGroup(Group* group) {
+  while (true) {
+    unique_ptr<Batch> batch;
+    {
+      MutexLock l(lock_);
+      DCHECK(group->running);
+      group->exhausted = !group->iter->HasNext();
+      if (stopping_ || !status_.ok() || group->exhausted || ready_.size() >= max_batches_) {
+        group->running = false;
+        num_running_--;
+        cond_.Broadcast();
+        return;
+      }
+      if (free_.empty()) {
+        batch.reset(new Batch(*schema_, batch_rows_));
+      } else {
+        batch = std::move(free_.back());
+        free_.pop_back();
+      }
+    }
+
+    // Scan without holding the lock, so that the other groups and the
+    // consumer can make progress.
+    batch->arena.Reset();
+    batch->next_row = 0;
+    Status s = group->iter->NextBlock(&batch->block);
+
+    MutexLock l(lock_);
+    if (!s.ok()) {
+      if (status_.ok()) {
+        status_ = s;
+      }
+    } else if (batch->block.selection_vector()->AnySelected()) {
+      ready_.emplace_back(std::move(batch));
+      cond_.Broadcast();
+      continue;
+    }
+    free_.emplace_back(std::move(batch));
+  }
+}
+
+Status ParallelUnionIterator::NextBlock(RowBlock* dst) {
+  CHECK(initted_);
+  unique_ptr<Batch> batch;
+  {
+    MutexLock l(lock_);
+    if (batch_rows_ == 0) {
+      batch_rows_ = dst->row_capacity();
+    }
+    ScheduleUnlocked();
+    while (ready_.empty() && status_.ok() &&
+           std::any_of(groups_.begin(), groups_.end(),
+                       [](const unique_ptr<Group>& g) { return !g->exhausted; })) {
+      cond_.Wait();
+    }
+    RETURN_NOT_OK(status_);
+    if (ready_.empty()) {
+      // The remaining groups had no selected rows.
+      dst->Resize(0);
+      return Status::OK();
+    }
+    batch = std::move(ready_.front());
+    ready_.pop_front();
+  }
+
+  Status s = CopyRows(batch.get(), dst);
+
+  MutexLock l(lock_);
+  size_t next_selected;
+  if (s.ok() && BitmapFindFirstSet(batch->block.selection_vector()->bitmap(), batch->next_row,
+                                   batch->block.nrows(), &next_selected)) {
+    // 'dst' filled up before the batch was done; return the rest next time.
+    ready_.emplace_front(std::move(batch));
+  } else {
+    free_.emplace_back(std::move(batch));
+  }
+  ScheduleUnlocked();
+  return s;
+}
+
+Status ParallelUnionIterator::CopyRows(Batch* batch, RowBlock* dst) {
+  const RowBlock& src = batch->block;
+  const SelectionVector* sel = src.selection_vector();
+  dst->Resize(dst->row_capacity());
+  size_t n = 0;
+  size_t i = batch->next_row;
+  for (; i < src.nrows() && n < dst->nrows(); i++) {
+    if (!sel->IsRowSelected(i)) {
+      continue;
+    }
+    RowBlockRow dst_row = dst->row(n++);
+    RETURN_NOT_OK(CopyRow(src.row(i), &dst_row, dst->arena()));
+  }
+  batch->next_row = i;
+  dst->Resize(n);
+  dst->selection_vector()->SetAllTrue();
+  return Status::OK();
+}
+
+string ParallelUnionIterator::ToString() const {
+  return strings::Substitute("ParallelUnion($0 groups)", groups_.size());
+}
+
+void ParallelUnionIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  CHECK(initted_);
+  stats->clear();
+  stats->resize(schema_->num_columns());
+  for (const auto& group : groups_) {
+    AddIterStats(*group->iter, stats);
+  }
+}
+
 ////////////////////////////////////////////////////////////
 // Materializing iterator
 ////////////////////////////////////////////////////////////
@@ -449,7 +793,8 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
 MaterializingIterator::MaterializingIterator(shared_ptr<ColumnwiseIterator> iter)
     : iter_(move(iter)),
       disallow_pushdown_for_tests_(!FLAGS_materializing_iterator_do_pushdown),
-      disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval) {
+      disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval),
+      disallow_late_materialization_(!FLAGS_materializing_iterator_late_materialization) {
 }
 
 Status MaterializingIterator::Init(ScanSpec *spec) {
@@ -524,6 +869,12 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   // been deleted.
   RETURN_NOT_OK(iter_->InitializeSelectionVector(dst->selection_vector()));
 
+  // If every row in the block has been deleted, there's nothing to read.
+  if (!disallow_late_materialization_ && !dst->selection_vector()->AnySelected()) {
+    DVLOG(1) << "0/" << dst->nrows() << " rows live";
+    return Status::OK();
+  }
+
   for (const auto& col_pred : col_idx_predicates_) {
     // Materialize the column itself into the row block.
     ColumnBlock dst_col(dst->column_block(get<0>(col_pred)));
@@ -556,6 +907,11 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
                                      nullptr,
                                      &dst_col,
                                      dst->selection_vector());
+    // All predicates have been evaluated, so only the surviving rows are
+    // needed from here on.
+    if (!disallow_late_materialization_) {
+      ctx.SetSkipUnselectedRows();
+    }
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
   }
 
@@ -645,4 +1001,170 @@ string PredicateEvaluatingIterator::ToString() const {
   return strings::Substitute("PredicateEvaluating($0)", base_iter_->ToString());
 }
 
+////////////////////////////////////////////////////////////
+// TopNIterator
+////////////////////////////////////////////////////////////
+
+TopNIterator::TopNIterator(shared_ptr<RowwiseIterator> base_iter,
+                           size_t col_idx,
+                           bool descending,
+                           size_t limit)
+    : base_iter_(move(base_iter)),
+      col_idx_(col_idx),
+      descending_(descending),
+      limit_(limit),
+      row_size_(ContiguousRowHelper::row_size(base_iter_->schema())),
+      bound_(std::make_shared<TopNBound>(base_iter_->schema().column(col_idx), descending)),
+      arena_(new Arena(32 * 1024)),
+      num_evicted_(0),
+      sorted_(false),
+      next_row_(0) {
+  DCHECK_LT(col_idx, base_iter_->schema().num_columns());
+}
+
+TopNIterator::~TopNIterator() {
+}
+
+Status TopNIterator::Init(ScanSpec* spec) {
+  if (spec != nullptr) {
+    spec->set_top_n_bound(bound_);
+  }
+  return base_iter_->Init(spec);
+}
+
+bool TopNIterator::HasNext() const {
+  return !sorted_ || next_row_ < rows_.size();
+}
+
+bool TopNIterator::CellComesBefore(const void* lhs, const void* rhs) const {
+  if (lhs == nullptr || rhs == nullptr) {
+    return lhs != nullptr && rhs == nullptr;
+  }
+  int cmp = schema().column(col_idx_).Compare(lhs, rhs);
+  return descending_ ? cmp > 0 : cmp < 0;
+}
+
+const void* TopNIterator::HeapCell(const uint8_t* row) const {
+  return ConstContiguousRow(&schema(), row).nullable_cell_ptr(col_idx_);
+}
+
+Status TopNIterator::CopyBlockRow(size_t row_idx, uint8_t** row) {
+  const Schema& s = schema();
+  uint8_t* data = reinterpret_cast<uint8_t*>(
+      arena_->AllocateBytesAligned(row_size_, alignof(std::max_align_t)));
+  ContiguousRowHelper::InitNullsBitmap(s, data, ContiguousRowHelper::null_bitmap_size(s));
+  ContiguousRow dst(&s, data);
+  RETURN_NOT_OK(CopyRow(block_->row(row_idx), &dst, arena_.get()));
+  *row = data;
+  return Status::OK();
+}
+
+Status TopNIterator::AddRows() {
+  if (limit_ == 0) {
+    return Status::OK();
+  }
+  auto row_comes_before = [&](const uint8_t* lhs, const uint8_t* rhs) {
+    return CellComesBefore(HeapCell(lhs), HeapCell(rhs));
+  };
+  const ColumnBlock col = block_->column_block(col_idx_);
+  const SelectionVector* sel = block_->selection_vector();
+  bool heap_changed = false;
+  for (size_t i = 0; i < block_->nrows(); i++) {
+    if (!sel->IsRowSelected(i)) {
+      continue;
+    }
+    if (rows_.size() < limit_) {
+      uint8_t* row;
+      RETURN_NOT_OK(CopyBlockRow(i, &row));
+      rows_.push_back(row);
+      std::push_heap(rows_.begin(), rows_.end(), row_comes_before);
+      heap_changed = true;
+      continue;
+    }
+    const void* cell = col.is_null(i) ? nullptr : col.cell_ptr(i);
+    if (!CellComesBefore(cell, HeapCell(rows_.front()))) {
+      continue;
+    }
+    std::pop_heap(rows_.begin(), rows_.end(), row_comes_before);
+    RETURN_NOT_OK(CopyBlockRow(i, &rows_.back()));
+    std::push_heap(rows_.begin(), rows_.end(), row_comes_before);
+    num_evicted_++;
+    heap_changed = true;
+  }
+
+  // Bound the memory held by evicted rows to about that of the heap.
+  if (num_evicted_ > limit_) {
+    RETURN_NOT_OK(CompactArena());
+  }
+
+  if (heap_changed && rows_.size() == limit_) {
+    const void* worst = HeapCell(rows_.front());
+    // Any non-NULL row beats a NULL, so there's nothing to skip until the
+    // heap is full of non-NULL rows.
+    if (worst != nullptr) {
+      bound_->Set(worst);
+    }
+  }
+  return Status::OK();
+}
+
+Status TopNIterator::CompactArena() {
+  unique_ptr<Arena> arena(new Arena(32 * 1024));
+  for (uint8_t*& row : rows_) {
+    uint8_t* data = reinterpret_cast<uint8_t*>(
+        arena->AllocateBytesAligned(row_size_, alignof(std::max_align_t)));
+    memcpy(data, row, row_size_);
+    ContiguousRow copy(&schema(), data);
+    RETURN_NOT_OK(RelocateIndirectDataToArena(&copy, arena.get()));
+    row = data;
+  }
+  arena_ = move(arena);
+  num_evicted_ = 0;
+  return Status::OK();
+}
+
+Status TopNIterator::NextBlock(RowBlock* dst) {
+  if (!sorted_ && base_iter_->HasNext()) {
+    if (!block_) {
+      block_arena_.reset(new Arena(32 * 1024));
+      block_.reset(new RowBlock(schema(), dst->row_capacity(), block_arena_.get()));
+    }
+    block_arena_->Reset();
+    RETURN_NOT_OK(base_iter_->NextBlock(block_.get()));
+    RETURN_NOT_OK(AddRows());
+    if (base_iter_->HasNext()) {
+      dst->Resize(0);
+      return Status::OK();
+    }
+  }
+
+  if (!sorted_) {
+    std::sort_heap(rows_.begin(), rows_.end(), [&](const uint8_t* lhs, const uint8_t* rhs) {
+      return CellComesBefore(HeapCell(lhs), HeapCell(rhs));
+    });
+    sorted_ = true;
+    block_.reset();
+    block_arena_.reset();
+  }
+
+  const size_t nrows = std::min(dst->row_capacity(), rows_.size() - next_row_);
+  dst->Resize(nrows);
+  dst->selection_vector()->SetAllTrue();
+  for (size_t i = 0; i < nrows; i++) {
+    RowBlockRow dst_row = dst->row(i);
+    RETURN_NOT_OK(CopyRow(ConstContiguousRow(&schema(), rows_[next_row_ + i]),
+                          &dst_row, dst->arena()));
+  }
+  next_row_ += nrows;
+  return Status::OK();
+}
+
+string TopNIterator::ToString() const {
+  return strings::Substitute("TopN($0 $1 limit $2, $3)",
+                             schema().column(col_idx_).name(),
+                             descending_ ? "DESC" : "ASC",
+                             limit_,
+                             base_iter_->ToString());
+}
+
 } // namespace kudu
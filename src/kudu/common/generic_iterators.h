@@ -26,6 +26,7 @@
 #include <utility>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
@@ -35,18 +36,43 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class Arena;
 class MergeIterState;
 class RowBlock;
+class ThreadPool;
+class ThreadPoolToken;
+
+// A sub-iterator to be merged by a MergeIterator, along with the bounds of
+// the keys it may yield, if they are known.
+struct IterWithBounds {
+  IterWithBounds() = default;
+  explicit IterWithBounds(std::shared_ptr<RowwiseIterator> i)
+      : iter(std::move(i)) {
+  }
+
+  std::shared_ptr<RowwiseIterator> iter;
+
+  // The inclusive lower and upper bounds of the encoded keys that may be
+  // yielded by 'iter'. Unset if the bounds are not known (e.g. for a
+  // MemRowSet).
+  boost::optional<std::pair<std::string, std::string>> encoded_bounds;
+};
 
 // An iterator which merges the results of other iterators, comparing
 // based on keys.
+//
+// The sub-iterators are kept in a min-heap keyed on their next row, so
+// producing each output row costs O(log N) comparisons for N sub-iterators.
 class MergeIterator : public RowwiseIterator {
  public:
   // TODO: clarify whether schema is just the projection, or must include the merge
@@ -54,6 +80,11 @@ class MergeIterator : public RowwiseIterator {
   // a subset of the columns in 'iters'.
   MergeIterator(const Schema& schema,
                 std::vector<std::shared_ptr<RowwiseIterator>> iters);
+
+  // Like the above, but with known key bounds for some or all of the
+  // sub-iterators. Sub-iterators whose bounds do not overlap the key range
+  // of the ScanSpec passed to Init() are dropped without being initialized.
+  MergeIterator(const Schema& schema, std::vector<IterWithBounds> iters);
   virtual ~MergeIterator();
 
   // The passed-in iterators should be already initialized.
@@ -74,19 +105,37 @@ class MergeIterator : public RowwiseIterator {
   Status MaterializeBlock(RowBlock* dst);
   Status InitSubIterators(ScanSpec *spec);
 
+  // Removes from 'orig_iters_' any sub-iterators whose known key bounds fall
+  // entirely outside of the key range specified by 'spec'.
+  void DropNonOverlappingIters(const ScanSpec& spec);
+
+  // Comparator for the heap of sub-iterators. Returns true if the next row
+  // of 'a' is greater than that of 'b', so that std::push_heap() and friends
+  // produce a min-heap.
+  bool HeapGreater(const MergeIterState* a, const MergeIterState* b) const;
+
+  // Removes the exhausted sub-iterator 'state' from 'iters_', accumulating
+  // its statistics into 'finished_iter_stats_by_col_'.
+  void RemoveExhaustedIter(MergeIterState* state);
+
   const Schema schema_;
 
   bool initted_;
 
   // Holds the subiterators until Init is called, at which point this is cleared.
   // This is required because we can't create a MergeIterState of an uninitialized iterator.
-  std::vector<std::shared_ptr<RowwiseIterator>> orig_iters_;
+  std::vector<IterWithBounds> orig_iters_;
 
   // See UnionIterator::iters_lock_ for details on locking. This follows the same
   // pattern.
   mutable rw_spinlock iters_lock_;
   std::vector<std::unique_ptr<MergeIterState>> iters_;
 
+  // The non-exhausted sub-iterators in 'iters_', arranged as a min-heap
+  // ordered by each sub-iterator's next row. Not protected by 'iters_lock_'
+  // since it is only accessed by the thread calling NextBlock().
+  std::vector<MergeIterState*> heap_;
+
   // Statistics (keyed by projection column index) accumulated so far by any
   // fully-consumed sub-iterators.
   std::vector<IteratorStats> finished_iter_stats_by_col_;
@@ -94,6 +143,10 @@ class MergeIterator : public RowwiseIterator {
   // The number of iterators, used by ToString().
   const int num_orig_iters_;
 
+  // Whether the merge compares the normalized key prefixes of the rows
+  // before comparing the rows themselves.
+  const bool use_key_prefixes_;
+
   // When the underlying iterators are initialized, each needs its own
   // copy of the scan spec in order to do its own pushdown calculations, etc.
   // The copies are allocated from this pool so they can be automatically freed
@@ -168,6 +221,109 @@ class UnionIterator : public RowwiseIterator {
   ObjectPool<ScanSpec> scan_spec_copies_;
 };
 
+// An iterator which unions the results of other iterators, like UnionIterator,
+// but scans them concurrently. The sub-iterators are split round-robin into at
+// most 'parallelism' groups, and each group is scanned on a thread pool into a
+// bounded queue of row blocks, ahead of the calls to NextBlock().
+//
+// Only the selected rows of each buffered block are returned, compacted into
+// the caller's block. As with UnionIterator, the order of the results is
+// unspecified.
+class ParallelUnionIterator : public RowwiseIterator {
+ public:
+  // Construct a parallel union iterator of the given iterators, whose tasks run
+  // on 'pool'. 'pool' must outlive this iterator.
+  //
+  // The same requirements as for UnionIterator apply to 'iters'.
+  ParallelUnionIterator(std::vector<std::shared_ptr<RowwiseIterator>> iters,
+                        ThreadPool* pool,
+                        int parallelism);
+
+  // Stops scanning, waiting for any in-flight tasks to finish.
+  ~ParallelUnionIterator();
+
+  Status Init(ScanSpec *spec) OVERRIDE;
+
+  bool HasNext() const OVERRIDE;
+
+  std::string ToString() const OVERRIDE;
+
+  const Schema &schema() const OVERRIDE {
+    CHECK(initted_);
+    return *CHECK_NOTNULL(schema_.get());
+  }
+
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
+
+  virtual Status NextBlock(RowBlock* dst) OVERRIDE;
+
+ private:
+  struct Batch;
+
+  struct Group {
+    std::shared_ptr<RowwiseIterator> iter;
+
+    // Whether a task is scanning this group. Protected by 'lock_'.
+    bool running;
+
+    // Whether the group has no more rows. Protected by 'lock_'.
+    bool exhausted;
+  };
+
+  // Submits a task for each idle group which has more rows, as long as there
+  // is room in the queue.
+  void ScheduleUnlocked();
+
+  // Scans 'group' into the queue until it is exhausted or the queue is full.
+  void RunGroup(Group* group);
+
+  // Copies the selected rows of 'batch', starting at its next row, into 'dst'
+  // until either is full.
+  Status CopyRows(Batch* batch, RowBlock* dst);
+
+  ThreadPool* const pool_;
+  const int parallelism_;
+
+  // The sub-iterators, until they are split into groups by Init().
+  std::vector<std::shared_ptr<RowwiseIterator>> iters_;
+
+  gscoped_ptr<Schema> schema_;
+  bool initted_;
+
+  // The groups being scanned. Immutable after Init().
+  std::vector<std::unique_ptr<Group>> groups_;
+
+  std::unique_ptr<ThreadPoolToken> token_;
+
+  // The maximum number of batches which may be scanned ahead.
+  size_t max_batches_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // The number of rows in each batch, taken from the first block passed to
+  // NextBlock(). Protected by 'lock_'.
+  size_t batch_rows_;
+
+  // The batches which have been scanned, and those which may be reused.
+  // Protected by 'lock_'.
+  std::deque<std::unique_ptr<Batch>> ready_;
+  std::vector<std::unique_ptr<Batch>> free_;
+
+  // The number of groups with a task in flight. Protected by 'lock_'.
+  int num_running_;
+
+  // Set when the iterator is destroyed. Protected by 'lock_'.
+  bool stopping_;
+
+  // The first error returned by a group. Protected by 'lock_'.
+  Status status_;
+
+  ObjectPool<ScanSpec> scan_spec_copies_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelUnionIterator);
+};
+
 // An iterator which wraps a ColumnwiseIterator, materializing it into full rows.
 //
 // Column predicates are pushed down into this iterator. While materializing a
@@ -213,6 +369,7 @@ class MaterializingIterator : public RowwiseIterator {
   // Set only by test code to disallow pushdown.
   bool disallow_pushdown_for_tests_;
   bool disallow_decoder_eval_;
+  bool disallow_late_materialization_;
 };
 
 // An iterator which wraps another iterator and evaluates any predicates that the
@@ -265,5 +422,87 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
   std::vector<ColumnPredicate> col_predicates_;
 };
 
+// An iterator which yields the 'limit' rows of its base iterator with the
+// lowest values of a column, or the highest if 'descending', in that order.
+// NULLs sort last either way, and ties are broken arbitrarily.
+//
+// The best rows are kept in a bounded heap, so that at most 'limit' rows
+// are held at once. Each call to NextBlock() reads a single block of the
+// base iterator and yields no rows until the base iterator is exhausted, so
+// that callers may still respond within their deadlines. Whenever the heap
+// is full, its worst row is published as the TopNBound of the scan spec, so
+// that the iterators reading the base data may skip the rows which can't
+// enter the heap.
+class TopNIterator : public RowwiseIterator {
+ public:
+  // 'col_idx' is the index of the ordering column in the schema of
+  // 'base_iter'.
+  TopNIterator(std::shared_ptr<RowwiseIterator> base_iter,
+               size_t col_idx,
+               bool descending,
+               size_t limit);
+  ~TopNIterator();
+
+  // Sets the bound of 'spec', if any, and initializes the base iterator
+  // with it.
+  Status Init(ScanSpec* spec) override;
+
+  bool HasNext() const override;
+
+  Status NextBlock(RowBlock* dst) override;
+
+  std::string ToString() const override;
+
+  const Schema& schema() const override {
+    return base_iter_->schema();
+  }
+
+  void GetIteratorStats(std::vector<IteratorStats>* stats) const override {
+    base_iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TopNIterator);
+
+  // Returns true if a row whose ordering cell is 'lhs' comes before a row
+  // whose ordering cell is 'rhs'. NULL cells are passed as nullptr.
+  bool CellComesBefore(const void* lhs, const void* rhs) const;
+
+  // Returns the ordering cell of the heap row 'row', or nullptr if NULL.
+  const void* HeapCell(const uint8_t* row) const;
+
+  // Adds the selected rows of 'block_' which beat the worst row of the heap
+  // to the heap, evicting the rows they displace.
+  Status AddRows();
+
+  // Copies the row 'row_idx' of 'block_' into 'arena_'.
+  Status CopyBlockRow(size_t row_idx, uint8_t** row);
+
+  // Copies the rows of the heap into a fresh arena, dropping the evicted
+  // rows.
+  Status CompactArena();
+
+  std::shared_ptr<RowwiseIterator> base_iter_;
+  const size_t col_idx_;
+  const bool descending_;
+  const size_t limit_;
+  const size_t row_size_;
+  const std::shared_ptr<TopNBound> bound_;
+
+  // The block the base iterator is read into, allocated on first use.
+  std::unique_ptr<Arena> block_arena_;
+  std::unique_ptr<RowBlock> block_;
+
+  // The best rows read so far, as a max-heap with the worst row on top,
+  // until the base iterator is exhausted. Then they're sorted, and yielded
+  // from 'next_row_' on. The rows live in 'arena_', along with the evicted
+  // rows until the arena is compacted.
+  std::vector<uint8_t*> rows_;
+  std::unique_ptr<Arena> arena_;
+  size_t num_evicted_;
+  bool sorted_;
+  size_t next_row_;
+};
+
 } // namespace kudu
 #endif
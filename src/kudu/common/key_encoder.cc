@@ -22,14 +22,13 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/util/faststring.h"
 
 using std::unique_ptr;
 using std::vector;
 
 namespace kudu {
 
-class faststring;
-
 // A resolver for Encoders
 template <typename Buffer>
 class EncoderResolver {
@@ -84,6 +83,41 @@ const bool IsTypeAllowableInKey(const TypeInfo* typeinfo) {
       typeinfo->physical_type());
 }
 
+bool EncodeIntegerKeyColumn(const TypeInfo* typeinfo, const void* cells, size_t n,
+                            size_t dst_stride, uint8_t* dst) {
+  switch (typeinfo->physical_type()) {
+    case UINT8:
+      KeyEncoderTraits<UINT8, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case INT8:
+      KeyEncoderTraits<INT8, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case UINT16:
+      KeyEncoderTraits<UINT16, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case INT16:
+      KeyEncoderTraits<INT16, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case UINT32:
+      KeyEncoderTraits<UINT32, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case INT32:
+      KeyEncoderTraits<INT32, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case UINT64:
+      KeyEncoderTraits<UINT64, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case INT64:
+      KeyEncoderTraits<INT64, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    case INT128:
+      KeyEncoderTraits<INT128, faststring>::EncodeArray(cells, n, dst_stride, dst);
+      return true;
+    default:
+      return false;
+  }
+}
+
 //------------------------------------------------------------
 //// Template instantiations: We instantiate all possible templates to avoid linker issues.
 //// see: https://isocpp.org/wiki/faq/templates#separate-template-fn-defn-from-decl
@@ -79,12 +79,7 @@ struct KeyEncoderTraits<Type,
     return 0;
   }
 
- public:
-  static void Encode(cpp_type key, Buffer* dst) {
-    Encode(&key, dst);
-  }
-
-  static void Encode(const void* key_ptr, Buffer* dst) {
+  static unsigned_cpp_type EncodeToUnsigned(const void* key_ptr) {
     unsigned_cpp_type key_unsigned;
     memcpy(&key_unsigned, key_ptr, sizeof(key_unsigned));
 
@@ -92,10 +87,30 @@ struct KeyEncoderTraits<Type,
     if (MathLimits<cpp_type>::kIsSigned) {
       key_unsigned ^= static_cast<unsigned_cpp_type>(1) << (sizeof(key_unsigned) * CHAR_BIT - 1);
     }
-    key_unsigned = SwapEndian(key_unsigned);
+    return SwapEndian(key_unsigned);
+  }
+
+ public:
+  static void Encode(cpp_type key, Buffer* dst) {
+    Encode(&key, dst);
+  }
+
+  static void Encode(const void* key_ptr, Buffer* dst) {
+    unsigned_cpp_type key_unsigned = EncodeToUnsigned(key_ptr);
     dst->append(reinterpret_cast<const char*>(&key_unsigned), sizeof(key_unsigned));
   }
 
+  // Encodes the 'n' contiguous keys at 'keys' into 'dst', writing each
+  // encoded key 'dst_stride' bytes after the previous one. The loop is
+  // simple enough for the compiler to vectorize the byte swaps.
+  static void EncodeArray(const void* keys, size_t n, size_t dst_stride, uint8_t* dst) {
+    const uint8_t* src = static_cast<const uint8_t*>(keys);
+    for (size_t i = 0; i < n; i++) {
+      unsigned_cpp_type key_unsigned = EncodeToUnsigned(src + i * sizeof(cpp_type));
+      memcpy(dst + i * dst_stride, &key_unsigned, sizeof(key_unsigned));
+    }
+  }
+
   static void EncodeWithSeparators(const void* key, bool is_last, Buffer* dst) {
     Encode(key, dst);
   }
@@ -177,8 +192,6 @@ struct KeyEncoderTraits<BINARY, Buffer> {
         dstp -= 8 - rem;
         srcp -= 8 - rem;
         if (!SSEEncodeChunk<8>(&srcp, &dstp)) {
-          // TODO: optimize for the case where the input slice has '\0'
-          // bytes. (e.g. move the pointer to the first zero byte.)
           dstp += 8 - rem;
           srcp += 8 - rem;
           goto slow_path;
@@ -288,7 +301,28 @@ struct KeyEncoderTraits<BINARY, Buffer> {
   }
 
   // Non-SSE loop which encodes 'len' bytes from 'srcp' into 'dst'.
+  //
+  // Longer inputs are copied in runs delimited by the '\0' bytes, which are
+  // found with memchr(), so that a single '\0' byte doesn't force the rest of
+  // a long string through the byte-at-a-time loop.
   static void EncodeChunkLoop(const uint8_t** srcp, uint8_t** dstp, int len) {
+    static const int kMinLenForRuns = 16;
+    if (len >= kMinLenForRuns) {
+      const uint8_t* end = *srcp + len;
+      while (*srcp < end) {
+        const uint8_t* zero = static_cast<const uint8_t*>(memchr(*srcp, '\0', end - *srcp));
+        const uint8_t* run_end = zero ? zero : end;
+        memcpy(*dstp, *srcp, run_end - *srcp);
+        *dstp += run_end - *srcp;
+        *srcp = run_end;
+        if (zero) {
+          *(*dstp)++ = 0;
+          *(*dstp)++ = 1;
+          (*srcp)++;
+        }
+      }
+      return;
+    }
     while (len--) {
       if (PREDICT_FALSE(**srcp == '\0')) {
         *(*dstp)++ = 0;
@@ -366,6 +400,13 @@ extern const KeyEncoder<Buffer>& GetKeyEncoder(const TypeInfo* typeinfo);
 
 extern const bool IsTypeAllowableInKey(const TypeInfo* typeinfo);
 
+// Encodes the 'n' contiguous cells at 'cells', which are of the integer type
+// 'typeinfo', into 'dst' as key components, writing each encoded cell
+// 'dst_stride' bytes after the previous one. Returns false without encoding
+// anything if 'typeinfo' isn't an integer type allowed in keys.
+extern bool EncodeIntegerKeyColumn(const TypeInfo* typeinfo, const void* cells, size_t n,
+                                   size_t dst_stride, uint8_t* dst);
+
 } // namespace kudu
 
 #endif
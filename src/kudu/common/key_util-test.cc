@@ -20,21 +20,28 @@
 #include <cstdint>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/int128.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/test_macros.h"
 
+using std::string;
+using std::vector;
+
 namespace kudu {
 
 class KeyUtilTest : public KuduTest {
@@ -227,4 +234,103 @@ TEST_F(KeyUtilTest, TestTryDecrementCell) {
   }
 }
 
+// Checks that key_util::EncodeKeys() encodes the keys of the rows of 'block'
+// the same way as Schema::EncodeComparableKey().
+static void CheckEncodeKeys(const RowBlock& block) {
+  faststring buf;
+  vector<Slice> keys;
+  key_util::EncodeKeys(block, &buf, &keys);
+  ASSERT_EQ(block.nrows(), keys.size());
+  faststring expected;
+  for (size_t i = 0; i < block.nrows(); i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(block.schema().EncodeComparableKey(block.row(i), &expected), keys[i]);
+  }
+}
+
+TEST_F(KeyUtilTest, TestEncodeIntegerKeys) {
+  Schema schema({ ColumnSchema("k1", INT8),
+                  ColumnSchema("k2", INT64),
+                  ColumnSchema("k3", UINT32),
+                  ColumnSchema("k4", INT128),
+                  ColumnSchema("other_col", STRING, true) },
+                4);
+  const int kNumRows = 100;
+  RowBlock block(schema, kNumRows, &arena_);
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int8_t*>(row.mutable_cell_ptr(0)) = i - 50;
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) = -1000000007LL * i;
+    *reinterpret_cast<uint32_t*>(row.mutable_cell_ptr(2)) = i * 65537;
+    *reinterpret_cast<int128_t*>(row.mutable_cell_ptr(3)) = static_cast<int128_t>(i) << 70;
+  }
+  NO_FATALS(CheckEncodeKeys(block));
+}
+
+TEST_F(KeyUtilTest, TestEncodeCompositeStringKeys) {
+  Schema schema({ ColumnSchema("k1", STRING),
+                  ColumnSchema("k2", INT32),
+                  ColumnSchema("k3", BINARY),
+                  ColumnSchema("other_col", INT32, true) },
+                3);
+  // Include strings with '\0' bytes at various positions, and strings long
+  // enough to take the vectorized paths of the encoder.
+  const vector<string> kStrings = {
+    "", string("\0", 1), "a", string("a\0b", 3),
+    string(40, 'x'), string(40, 'x') + string("\0\0", 2) + string(30, 'y'),
+    string(17, '\0'),
+  };
+  const int kNumRows = kStrings.size() * kStrings.size();
+  RowBlock block(schema, kNumRows, &arena_);
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(0)) = Slice(kStrings[i / kStrings.size()]);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(1)) = i;
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(2)) = Slice(kStrings[i % kStrings.size()]);
+  }
+  NO_FATALS(CheckEncodeKeys(block));
+}
+
+// Checks that whenever the normalized key prefixes of two rows differ, they
+// order the rows the same way as Schema::Compare().
+TEST_F(KeyUtilTest, TestNormalizedKeyPrefixOrdering) {
+  Schema schema({ ColumnSchema("k1", INT32),
+                  ColumnSchema("k2", STRING),
+                  ColumnSchema("k3", INT64) },
+                3);
+  const vector<string> kStrings = {
+    "", string("\0", 1), "a", string("a\0", 2), string("a\0b", 3),
+    string(11, 'x'), string(12, 'x'), string(30, 'x') + "a", string(30, 'x') + "b",
+  };
+  const vector<int64_t> kInts = { -1, 0, 1 };
+  const int kNumRows = kInts.size() * kStrings.size() * kInts.size();
+  RowBlock block(schema, kNumRows, &arena_);
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = kInts[i % kInts.size()];
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) =
+        Slice(kStrings[(i / kInts.size()) % kStrings.size()]);
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) =
+        kInts[i / (kInts.size() * kStrings.size())];
+  }
+
+  faststring buf;
+  vector<key_util::NormalizedKeyPrefix> prefixes(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    key_util::EncodeKeyPrefix(block.row(i), &buf, &prefixes[i]);
+  }
+  for (int i = 0; i < kNumRows; i++) {
+    for (int j = 0; j < kNumRows; j++) {
+      SCOPED_TRACE(strings::Substitute("rows $0 and $1", i, j));
+      int row_comp = schema.Compare(block.row(i), block.row(j));
+      int prefix_comp = prefixes[i].Compare(prefixes[j]);
+      if (row_comp == 0) {
+        ASSERT_EQ(0, prefix_comp);
+      } else if (prefix_comp != 0) {
+        ASSERT_EQ(row_comp < 0, prefix_comp < 0);
+      }
+    }
+  }
+}
+
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/common/key_util.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iterator>
@@ -34,11 +35,13 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 
@@ -232,6 +235,7 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
         pushed_predicates++;
         break;
       case PredicateType::Range:
+      case PredicateType::InBloomFilter:
         if (predicate->raw_upper() != nullptr) {
           memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_upper(), size);
           pushed_predicates++;
@@ -298,6 +302,7 @@ int PushLowerBoundKeyPredicates(ColIdxIter first,
 
     switch (predicate->predicate_type()) {
       case PredicateType::Range:
+      case PredicateType::InBloomFilter:
         if (predicate->raw_lower() == nullptr) {
           break_loop = true;
           break;
@@ -447,5 +452,80 @@ void EncodeKey(const vector<int32_t>& col_idxs, const ContiguousRow& row, string
   }
 }
 
+void EncodeKeys(const RowBlock& block, faststring* buf, vector<Slice>* keys) {
+  const Schema& schema = block.schema();
+  const size_t num_key_cols = schema.num_key_columns();
+  const size_t nrows = block.nrows();
+  buf->clear();
+  keys->clear();
+  keys->reserve(nrows);
+
+  bool fixed_size = true;
+  for (size_t i = 0; i < num_key_cols; i++) {
+    DCHECK(!schema.column(i).is_nullable());
+    if (schema.column(i).type_info()->physical_type() == BINARY) {
+      fixed_size = false;
+      break;
+    }
+  }
+
+  // Integer keys have a fixed size, so the keys are laid out back to back and
+  // filled in a column at a time.
+  if (fixed_size) {
+    const size_t key_size = schema.key_byte_size();
+    buf->resize(nrows * key_size);
+    size_t offset = 0;
+    for (size_t i = 0; i < num_key_cols; i++) {
+      const TypeInfo* ti = schema.column(i).type_info();
+      CHECK(EncodeIntegerKeyColumn(ti, block.column_data_base_ptr(i), nrows, key_size,
+                                   buf->data() + offset));
+      offset += ti->size();
+    }
+    DCHECK_EQ(key_size, offset);
+    for (size_t r = 0; r < nrows; r++) {
+      keys->emplace_back(buf->data() + r * key_size, key_size);
+    }
+    return;
+  }
+
+  vector<const KeyEncoder<faststring>*> encoders(num_key_cols);
+  vector<size_t> cell_sizes(num_key_cols);
+  for (size_t i = 0; i < num_key_cols; i++) {
+    const TypeInfo* ti = schema.column(i).type_info();
+    encoders[i] = &GetKeyEncoder<faststring>(ti);
+    cell_sizes[i] = ti->size();
+  }
+
+  // The buffer may be reallocated while appending, so the keys are only
+  // pointed into it once all of them are encoded.
+  vector<size_t> ends(nrows);
+  for (size_t r = 0; r < nrows; r++) {
+    for (size_t i = 0; i < num_key_cols; i++) {
+      const uint8_t* cell = block.column_data_base_ptr(i) + r * cell_sizes[i];
+      encoders[i]->Encode(cell, i + 1 == num_key_cols, buf);
+    }
+    ends[r] = buf->size();
+  }
+  size_t start = 0;
+  for (size_t r = 0; r < nrows; r++) {
+    keys->emplace_back(buf->data() + start, ends[r] - start);
+    start = ends[r];
+  }
+}
+
+void EncodeKeyPrefix(const RowBlockRow& row, faststring* buf, NormalizedKeyPrefix* prefix) {
+  const Schema* schema = row.schema();
+  const size_t num_key_cols = schema->num_key_columns();
+  buf->clear();
+  for (size_t i = 0; i < num_key_cols && buf->size() < NormalizedKeyPrefix::kSize; i++) {
+    DCHECK(!schema->column(i).is_nullable());
+    GetKeyEncoder<faststring>(schema->column(i).type_info()).Encode(
+        row.cell_ptr(i), i + 1 == num_key_cols, buf);
+  }
+  const size_t len = std::min<size_t>(buf->size(), NormalizedKeyPrefix::kSize);
+  memcpy(prefix->data, buf->data(), len);
+  memset(prefix->data + len, 0, NormalizedKeyPrefix::kSize - len);
+}
+
 } // namespace key_util
 } // namespace kudu
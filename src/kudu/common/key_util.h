@@ -20,6 +20,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -32,6 +33,10 @@ class Arena;
 class ColumnPredicate;
 class ColumnSchema;
 class ContiguousRow;
+class RowBlock;
+class RowBlockRow;
+class Slice;
+class faststring;
 
 namespace key_util {
 
@@ -107,5 +112,34 @@ void EncodeKey(const std::vector<int32_t>& col_idxs,
                const ContiguousRow& row,
                std::string* buffer);
 
+// Encodes the primary keys of all the rows of 'block' into 'buf', and sets
+// 'keys' to the encoded keys, which point into 'buf'. The result is the same
+// as encoding each row with Schema::EncodeComparableKey(), but the key
+// encoders are only resolved once per column, and keys made up of integer
+// columns only are encoded a column at a time.
+void EncodeKeys(const RowBlock& block, faststring* buf, std::vector<Slice>* keys);
+
+// A fixed-size prefix of the encoded primary key of a row, padded with
+// zeros. Since encoded keys are memcmpable, two rows whose prefixes differ
+// compare the same way as their prefixes do, so that most comparisons of rows
+// during merges don't have to go through the per-column comparators. Rows
+// with equal prefixes must be compared in full.
+struct NormalizedKeyPrefix {
+  static const int kSize = 16;
+
+  // Returns a negative, zero, or positive value depending on whether this
+  // prefix is less than, equal to, or greater than 'other'.
+  int Compare(const NormalizedKeyPrefix& other) const {
+    return memcmp(data, other.data, kSize);
+  }
+
+  uint8_t data[kSize];
+};
+
+// Fills 'prefix' with the normalized key prefix of 'row', using 'buf' as
+// scratch space. Only as many key columns are encoded as needed to fill the
+// prefix.
+void EncodeKeyPrefix(const RowBlockRow& row, faststring* buf, NormalizedKeyPrefix* prefix);
+
 } // namespace key_util
 } // namespace kudu
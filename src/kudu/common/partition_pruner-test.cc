@@ -736,7 +736,7 @@ TEST_F(PartitionPrunerTest, TestInListHashPruning) {
 
   // a in [0, 1];
   a_values = { &zero, &one };
-  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 18, 2);
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 18, 1);
 
   // a in [0, 1, 8];
   a_values = { &zero, &one, &eight };
@@ -744,18 +744,18 @@ TEST_F(PartitionPrunerTest, TestInListHashPruning) {
 
   // b in [0, 1]
   b_values = { &zero, &one };
-  Check({ ColumnPredicate::InList(schema.column(1), &b_values) }, 18, 6);
+  Check({ ColumnPredicate::InList(schema.column(1), &b_values) }, 18, 3);
 
   // c in [0, 1]
   c_values = { &zero, &one };
-  Check({ ColumnPredicate::InList(schema.column(2), &c_values) }, 18, 18);
+  Check({ ColumnPredicate::InList(schema.column(2), &c_values) }, 18, 9);
 
   // b in [0, 1], c in [0, 1]
   b_values = { &zero, &one };
   c_values = { &zero, &one };
   Check({ ColumnPredicate::InList(schema.column(1), &b_values),
           ColumnPredicate::InList(schema.column(2), &c_values) },
-        12, 12);
+        12, 6);
 
   //a in [0, 1], b in [0, 1], c in [0, 1]
   a_values = { &zero, &one };
@@ -764,7 +764,7 @@ TEST_F(PartitionPrunerTest, TestInListHashPruning) {
   Check({ ColumnPredicate::InList(schema.column(0), &a_values),
           ColumnPredicate::InList(schema.column(1), &b_values),
           ColumnPredicate::InList(schema.column(2), &c_values) },
-        8, 8);
+        8, 4);
 }
 
 TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
@@ -824,7 +824,7 @@ TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
 
   // a in [0, 1];
   a_values = { &zero, &one };
-  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 6, 2);
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 6, 1);
 
   // a in [0, 1, 8];
   a_values = { &zero, &one, &eight };
@@ -859,7 +859,7 @@ TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
   c_values = { &zero, &one };
   Check({ ColumnPredicate::Equality(schema.column(1), &one),
           ColumnPredicate::InList(schema.column(2), &c_values) },
-        6, 6);
+        6, 3);
 
   //a in [0, 1], b in [0, 1], c in [0, 1]
   a_values = { &zero, &one };
@@ -868,7 +868,86 @@ TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
   Check({ ColumnPredicate::InList(schema.column(0), &a_values),
           ColumnPredicate::InList(schema.column(1), &b_values),
           ColumnPredicate::InList(schema.column(2), &c_values) },
-        6, 2);
+        6, 1);
+}
+
+TEST_F(PartitionPrunerTest, TestInListRangePruning) {
+  // CREATE TABLE t
+  // (a INT8, b INT8)
+  // PRIMARY KEY (a, b)
+  // DISTRIBUTE BY RANGE(a)
+  //               HASH(b) INTO 2 BUCKETS;
+  // SPLIT ROWS [(0), (10), (20)];
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", INT8) },
+                { ColumnId(0), ColumnId(1) },
+                2);
+
+  PartitionSchema partition_schema;
+  auto pb = PartitionSchemaPB();
+  pb.mutable_range_schema()->add_columns()->set_name("a");
+  auto hash = pb.add_hash_bucket_schemas();
+  hash->add_columns()->set_name("b");
+  hash->set_num_buckets(2);
+  ASSERT_OK(PartitionSchema::FromPB(pb, schema, &partition_schema));
+
+  vector<KuduPartialRow> splits;
+  for (int8_t split : { 0, 10, 20 }) {
+    splits.emplace_back(&schema);
+    ASSERT_OK(splits.back().SetInt8("a", split));
+  }
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions(splits, {}, schema, &partitions));
+  ASSERT_EQ(8, partitions.size());
+
+  // Applies the specified predicates to a scan and checks that the expected
+  // number of partitions are pruned.
+  auto Check = [&] (const vector<ColumnPredicate>& predicates,
+                    size_t remaining_tablets,
+                    size_t pruner_ranges) {
+    ScanSpec spec;
+
+    for (const auto& pred : predicates) {
+      spec.AddPredicate(pred);
+    }
+
+    CheckPrunedPartitions(schema, partition_schema, partitions, spec,
+                          remaining_tablets, pruner_ranges);
+  };
+
+  int8_t neg_five = -5;
+  int8_t zero = 0;
+  int8_t one = 1;
+  int8_t five = 5;
+  int8_t ten = 10;
+  int8_t fifteen = 15;
+  int8_t twenty = 20;
+  int8_t thirty = 30;
+
+  vector<const void*> a_values;
+
+  // a = 5
+  Check({ ColumnPredicate::Equality(schema.column(0), &five) }, 2, 2);
+
+  // a in [-5, 15]
+  // The range partition [0, 10) lies between the values, and is pruned.
+  a_values = { &neg_five, &fifteen };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 4, 4);
+
+  // a in [1, 5]
+  a_values = { &one, &five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 2, 4);
+
+  // a in [1, 5]
+  // b = 0
+  a_values = { &one, &five };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values),
+          ColumnPredicate::Equality(schema.column(1), &zero) },
+        1, 2);
+
+  // a in [0, 10, 20, 30]
+  a_values = { &zero, &ten, &twenty, &thirty };
+  Check({ ColumnPredicate::InList(schema.column(0), &a_values) }, 6, 8);
 }
 
 TEST_F(PartitionPrunerTest, TestPruning) {
@@ -64,6 +64,41 @@ using std::vector;
 namespace kudu {
 namespace {
 
+// The maximum number of combinations of equality and in-list predicate values
+// which are hashed to prune a hash component. Beyond that, the component is
+// not pruned.
+const size_t kMaxHashedValueCombinations = 1 << 20;
+
+// The maximum number of range keys which the combinations of equality and
+// in-list predicate values on the range columns are split into.
+const size_t kMaxRangeKeys = 1024;
+
+// Appends the values of an equality or in-list predicate to 'values'.
+void GetPredicateValues(const ColumnPredicate& predicate, vector<const void*>* values) {
+  if (predicate.predicate_type() == PredicateType::Equality) {
+    values->push_back(predicate.raw_lower());
+  } else {
+    CHECK(predicate.predicate_type() == PredicateType::InList);
+    values->insert(values->end(),
+                   predicate.raw_values().begin(),
+                   predicate.raw_values().end());
+  }
+}
+
+// Advances 'idxs' to the next combination of one value per column, in
+// lexicographic order, where column i has 'values[i].size()' values. Returns
+// the index of the leftmost column whose value changed, or -1 once all the
+// combinations have been visited.
+int NextCombination(const vector<vector<const void*>>& values, vector<size_t>* idxs) {
+  for (int i = static_cast<int>(idxs->size()) - 1; i >= 0; i--) {
+    if (++(*idxs)[i] < values[i].size()) {
+      return i;
+    }
+    (*idxs)[i] = 0;
+  }
+  return -1;
+}
+
 // Returns true if the partition schema's range columns are a prefix of the
 // primary key columns.
 bool AreRangeColumnsPrefixOfPrimaryKey(const Schema& schema,
@@ -181,6 +216,67 @@ void EncodeRangeKeysFromPredicates(const Schema& schema,
     key_util::EncodeKey(col_idxs, row, range_key_end);
   }
 }
+
+// If all the range columns are constrained by equality or in-list predicates,
+// at least one of which is an in-list, encodes the range key of each
+// combination of their values into 'range_keys' in ascending order. The scan
+// then only needs the range partitions which contain one of the keys, rather
+// than all those between the smallest and the largest key.
+//
+// Returns false if the range columns aren't constrained that way, or if their
+// values have too many combinations.
+bool EncodeRangeKeysFromInListPredicates(const Schema& schema,
+                                         const unordered_map<string, ColumnPredicate>& predicates,
+                                         const vector<ColumnId>& range_columns,
+                                         vector<string>* range_keys) {
+  vector<int32_t> col_idxs;
+  vector<vector<const void*>> values;
+  bool has_in_list = false;
+  size_t num_keys = 1;
+  for (ColumnId column : range_columns) {
+    int32_t col_idx = schema.find_column_by_id(column);
+    CHECK(col_idx != Schema::kColumnNotFound);
+    CHECK(col_idx < schema.num_key_columns());
+    const ColumnPredicate* predicate = FindOrNull(predicates, schema.column(col_idx).name());
+    if (predicate == nullptr ||
+        (predicate->predicate_type() != PredicateType::Equality &&
+         predicate->predicate_type() != PredicateType::InList)) {
+      return false;
+    }
+    has_in_list |= predicate->predicate_type() == PredicateType::InList;
+    col_idxs.push_back(col_idx);
+    values.emplace_back();
+    GetPredicateValues(*predicate, &values.back());
+    num_keys *= values.back().size();
+    if (num_keys > kMaxRangeKeys) {
+      return false;
+    }
+  }
+  if (!has_in_list) {
+    return false;
+  }
+
+  Arena arena(std::max<size_t>(Arena::kMinimumChunkSize, schema.key_byte_size()));
+  uint8_t* buf = static_cast<uint8_t*>(CHECK_NOTNULL(arena.AllocateBytes(schema.key_byte_size())));
+  ContiguousRow row(&schema, buf);
+
+  // The in-list values are sorted, and the key encoding preserves their
+  // order, so the keys are produced in ascending order.
+  range_keys->reserve(num_keys);
+  vector<size_t> idxs(col_idxs.size(), 0);
+  do {
+    for (size_t i = 0; i < col_idxs.size(); i++) {
+      memcpy(row.mutable_cell_ptr(col_idxs[i]),
+             values[i][idxs[i]],
+             schema.column(col_idxs[i]).type_info()->size());
+    }
+    string key;
+    key_util::EncodeKey(col_idxs, row, &key);
+    range_keys->emplace_back(move(key));
+  } while (NextCombination(values, &idxs) >= 0);
+  DCHECK(std::is_sorted(range_keys->begin(), range_keys->end()));
+  return true;
+}
 } // anonymous namespace
 
 vector<bool> PartitionPruner::PruneHashComponent(
@@ -188,40 +284,45 @@ vector<bool> PartitionPruner::PruneHashComponent(
     const PartitionSchema::HashBucketSchema& hash_bucket_schema,
     const Schema& schema,
     const ScanSpec& scan_spec) {
-  vector<bool> hash_bucket_bitset(hash_bucket_schema.num_buckets, false);
-  vector<string> encoded_strings(1, "");
-  for (size_t col_offset = 0; col_offset < hash_bucket_schema.column_ids.size(); ++col_offset) {
-    vector<string> new_encoded_strings;
+  const size_t num_columns = hash_bucket_schema.column_ids.size();
+  vector<vector<const void*>> values(num_columns);
+  vector<const KeyEncoder<string>*> encoders(num_columns);
+  size_t num_combinations = 1;
+  for (size_t col_offset = 0; col_offset < num_columns; ++col_offset) {
     const ColumnSchema& column = schema.column_by_id(hash_bucket_schema.column_ids[col_offset]);
-    const ColumnPredicate& predicate = FindOrDie(scan_spec.predicates(), column.name());
-    const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
+    GetPredicateValues(FindOrDie(scan_spec.predicates(), column.name()), &values[col_offset]);
+    encoders[col_offset] = &GetKeyEncoder<string>(column.type_info());
+    num_combinations *= values[col_offset].size();
+    if (num_combinations > kMaxHashedValueCombinations) {
+      return vector<bool>(hash_bucket_schema.num_buckets, true);
+    }
+  }
 
-    vector<const void*> predicate_values;
-    if (predicate.predicate_type() == PredicateType::Equality) {
-      predicate_values.push_back(predicate.raw_lower());
-    } else {
-      CHECK(predicate.predicate_type() == PredicateType::InList);
-      predicate_values.insert(predicate_values.end(),
-                              predicate.raw_values().begin(),
-                              predicate.raw_values().end());
+  // Visit the combinations of the values one at a time rather than
+  // materializing them all, reusing the encoding of the columns whose values
+  // didn't change, and stop once every bucket has been hit.
+  vector<bool> hash_bucket_bitset(hash_bucket_schema.num_buckets, false);
+  int num_buckets_hit = 0;
+  vector<size_t> idxs(num_columns, 0);
+  // encoded_prefixes[i] is the encoding of the values of columns [0, i).
+  vector<string> encoded_prefixes(num_columns + 1);
+  int first_changed = 0;
+  do {
+    for (size_t col_offset = first_changed; col_offset < num_columns; ++col_offset) {
+      encoded_prefixes[col_offset + 1] = encoded_prefixes[col_offset];
+      encoders[col_offset]->Encode(values[col_offset][idxs[col_offset]],
+                                   col_offset + 1 == num_columns,
+                                   &encoded_prefixes[col_offset + 1]);
     }
-    // For each of the encoded string, replicate it by the number of values in
-    // equality and in-list predicate.
-    for (const string& encoded_string : encoded_strings) {
-      for (const void* predicate_value : predicate_values) {
-        string new_encoded_string = encoded_string;
-        encoder.Encode(predicate_value,
-                       col_offset + 1 == hash_bucket_schema.column_ids.size(),
-                       &new_encoded_string);
-        new_encoded_strings.emplace_back(new_encoded_string);
+    uint32_t hash = partition_schema.BucketForEncodedColumns(encoded_prefixes.back(),
+                                                             hash_bucket_schema);
+    if (!hash_bucket_bitset[hash]) {
+      hash_bucket_bitset[hash] = true;
+      if (++num_buckets_hit == hash_bucket_schema.num_buckets) {
+        break;
       }
     }
-    encoded_strings.swap(new_encoded_strings);
-  }
-  for (const string& encoded_string : encoded_strings) {
-    uint32_t hash = partition_schema.BucketForEncodedColumns(encoded_string, hash_bucket_schema);
-    hash_bucket_bitset[hash] = true;
-  }
+  } while ((first_changed = NextCombination(values, &idxs)) >= 0);
   return hash_bucket_bitset;
 }
 
@@ -299,11 +400,18 @@ void PartitionPruner::Init(const Schema& schema,
   //    algorithm to give up on pruning if the number of ranges exceeds a limit.
   //    Until this becomes a problem in practice, we'll continue always pruning,
   //    since it is precisely these highly-hash-partitioned tables which get the
-  //    most benefit from pruning.
+  //    most benefit from pruning. Adjacent ranges, such as those of consecutive
+  //    buckets of the final constrained component, are coalesced.
+  //
+  // 4) If the range columns are all constrained by equality or in-list
+  //    predicates, the range component is split into one point range per
+  //    combination of their values, which multiplies the number of ranges.
 
   // Step 1: Build the range portion of the partition key.
   string range_lower_bound;
   string range_upper_bound;
+  vector<string> range_keys;
+  bool has_range_keys = false;
   const vector<ColumnId>& range_columns = partition_schema.range_schema_.column_ids;
   if (!range_columns.empty()) {
     if (AreRangeColumnsPrefixOfPrimaryKey(schema, range_columns)) {
@@ -319,6 +427,28 @@ void PartitionPruner::Init(const Schema& schema,
                                     &range_lower_bound,
                                     &range_upper_bound);
     }
+    has_range_keys = EncodeRangeKeysFromInListPredicates(schema,
+                                                         scan_spec.predicates(),
+                                                         range_columns,
+                                                         &range_keys);
+  }
+
+  // The bounds of the range portion: either the range bounds, or a point range
+  // for each of the range keys within them. The exclusive upper bound of a
+  // point range is the smallest key greater than the range key.
+  vector<tuple<string, string>> range_bounds;
+  if (has_range_keys) {
+    for (string& key : range_keys) {
+      if ((!range_lower_bound.empty() && key < range_lower_bound) ||
+          (!range_upper_bound.empty() && key >= range_upper_bound)) {
+        continue;
+      }
+      string upper = key;
+      upper.push_back('\0');
+      range_bounds.emplace_back(move(key), move(upper));
+    }
+  } else {
+    range_bounds.emplace_back(range_lower_bound, range_upper_bound);
   }
 
   // Step 2: Create the hash bucket portion of the partition key.
@@ -352,7 +482,7 @@ void PartitionPruner::Init(const Schema& schema,
 
   // The index of the final constrained component in the partition key.
   int constrained_index;
-  if (!range_lower_bound.empty() || !range_upper_bound.empty()) {
+  if (has_range_keys || !range_lower_bound.empty() || !range_upper_bound.empty()) {
     // The range component is constrained.
     constrained_index = partition_schema.hash_bucket_schemas_.size();
   } else {
@@ -379,7 +509,8 @@ void PartitionPruner::Init(const Schema& schema,
     // bucket, and the range upper bound is empty. In this case we need to
     // increment the bucket on the upper bound to convert from inclusive to
     // exclusive.
-    bool is_last = hash_idx + 1 == constrained_index && range_upper_bound.empty();
+    bool is_last = hash_idx + 1 == constrained_index &&
+                   !has_range_keys && range_upper_bound.empty();
 
     vector<tuple<string, string>> new_partition_key_ranges;
     for (const auto& partition_key_range : partition_key_ranges) {
@@ -399,10 +530,21 @@ void PartitionPruner::Init(const Schema& schema,
     partition_key_ranges.swap(new_partition_key_ranges);
   }
 
-  // Step 3: append the (possibly empty) range bounds to the partition key ranges.
-  for (auto& range : partition_key_ranges) {
-    get<0>(range).append(range_lower_bound);
-    get<1>(range).append(range_upper_bound);
+  // Step 3: append the (possibly empty) range bounds to the partition key
+  // ranges, coalescing the adjacent ones.
+  vector<tuple<string, string>> hash_key_ranges;
+  hash_key_ranges.swap(partition_key_ranges);
+  for (const auto& hash_range : hash_key_ranges) {
+    for (const auto& range_bound : range_bounds) {
+      string lower = get<0>(hash_range) + get<0>(range_bound);
+      string upper = get<1>(hash_range) + get<1>(range_bound);
+      if (!partition_key_ranges.empty() && get<1>(partition_key_ranges.back()) == lower &&
+          !lower.empty()) {
+        get<1>(partition_key_ranges.back()) = move(upper);
+      } else {
+        partition_key_ranges.emplace_back(move(lower), move(upper));
+      }
+    }
   }
 
   // Step 4: remove all partition key ranges past the scan spec's upper bound partition key.
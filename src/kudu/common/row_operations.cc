@@ -147,13 +147,22 @@ RowOperationsPBDecoder::RowOperationsPBDecoder(const RowOperationsPB* pb,
                                                const Schema* client_schema,
                                                const Schema* tablet_schema,
                                                Arena* dst_arena)
-  : pb_(pb),
+  : RowOperationsPBDecoder(Slice(pb->rows()), Slice(pb->indirect_data()),
+                           client_schema, tablet_schema, dst_arena) {
+}
+
+RowOperationsPBDecoder::RowOperationsPBDecoder(Slice rows,
+                                               Slice indirect_data,
+                                               const Schema* client_schema,
+                                               const Schema* tablet_schema,
+                                               Arena* dst_arena)
+  : indirect_data_(indirect_data),
     client_schema_(client_schema),
     tablet_schema_(tablet_schema),
     dst_arena_(dst_arena),
     bm_size_(BitmapSize(client_schema_->num_columns())),
     tablet_row_size_(ContiguousRowHelper::row_size(*tablet_schema_)),
-    src_(pb->rows().data(), pb->rows().size()) {
+    src_(rows) {
 }
 
 RowOperationsPBDecoder::~RowOperationsPBDecoder() {
@@ -204,11 +213,11 @@ Status RowOperationsPBDecoder::GetColumnSlice(const ColumnSchema& col, Slice* sl
     size_t offset_in_indirect = reinterpret_cast<uintptr_t>(ptr_slice->data());
     bool overflowed = false;
     size_t max_offset = AddWithOverflowCheck(offset_in_indirect, ptr_slice->size(), &overflowed);
-    if (PREDICT_FALSE(overflowed || max_offset > pb_->indirect_data().size())) {
+    if (PREDICT_FALSE(overflowed || max_offset > indirect_data_.size())) {
       return Status::Corruption("Bad indirect slice");
     }
 
-    *slice = Slice(&pb_->indirect_data()[offset_in_indirect], ptr_slice->size());
+    *slice = Slice(indirect_data_.data() + offset_in_indirect, ptr_slice->size());
   } else {
     *slice = Slice(src_.data(), size);
   }
@@ -79,6 +79,15 @@ class RowOperationsPBDecoder {
                          const Schema* client_schema,
                          const Schema* tablet_schema,
                          Arena* dst_arena);
+
+  // Same as above, but decodes the encoded 'rows' and 'indirect_data' of a
+  // RowOperationsPB which were received separately, e.g. in RPC sidecars.
+  // The decoded operations refer to 'indirect_data', which must outlive them.
+  RowOperationsPBDecoder(Slice rows,
+                         Slice indirect_data,
+                         const Schema* client_schema,
+                         const Schema* tablet_schema,
+                         Arena* dst_arena);
   ~RowOperationsPBDecoder();
 
   Status DecodeOperations(std::vector<DecodedRowOperation>* ops);
@@ -106,7 +115,7 @@ class RowOperationsPBDecoder {
   Status DecodeSplitRow(const ClientServerMapping& mapping,
                         DecodedRowOperation* op);
 
-  const RowOperationsPB* const pb_;
+  const Slice indirect_data_;
   const Schema* const client_schema_;
   const Schema* const tablet_schema_;
   Arena* const dst_arena_;
@@ -154,6 +154,21 @@ class SelectionVectorView {
     DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
     BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_, nrows, false);
   }
+  // The underlying selection bitmap, and the index of the bit which
+  // corresponds to row 0 of the view.
+  uint8_t* mutable_bitmap() { return sel_vec_->mutable_bitmap(); }
+  size_t row_offset() const { return row_offset_; }
+  // Returns the number of consecutive rows starting at 'row_idx' whose bit
+  // is equal to 'value', looking at no more than 'max_rows' rows.
+  size_t CountRun(size_t row_idx, size_t max_rows, bool value) const {
+    DCHECK_LE(row_idx + max_rows, sel_vec_->nrows() - row_offset_);
+    size_t start = row_offset_ + row_idx;
+    size_t end;
+    if (!BitmapFindFirst(sel_vec_->bitmap(), start, start + max_rows, !value, &end)) {
+      return max_rows;
+    }
+    return end - start;
+  }
  private:
   SelectionVector* sel_vec_;
   size_t row_offset_;
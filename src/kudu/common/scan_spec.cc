@@ -18,8 +18,11 @@
 #include "kudu/common/scan_spec.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -37,8 +40,12 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 using std::any_of;
 using std::max;
@@ -107,6 +114,62 @@ void ScanSpec::SetExclusiveUpperBoundPartitionKey(const Slice& partition_key) {
   }
 }
 
+ScanSample::ScanSample(double fraction, uint64_t seed)
+    : fraction_(fraction),
+      seed_(seed) {
+  DCHECK(fraction > 0 && fraction <= 1) << fraction;
+}
+
+bool ScanSample::Includes(const Slice& unit_id) const {
+  if (!enabled()) {
+    return true;
+  }
+  // Map the hash of the unit onto [0, 1), with 53 bits of precision.
+  const uint64_t hash = HashUtil::MurmurHash2_64(unit_id.data(), unit_id.size(), seed_);
+  return static_cast<double>(hash >> 11) / (1ULL << 53) < fraction_;
+}
+
+TopNBound::TopNBound(ColumnSchema column, bool descending)
+    : column_(move(column)),
+      descending_(descending),
+      has_value_(false) {
+}
+
+void TopNBound::Set(const void* cell) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  cell_.assign(reinterpret_cast<const char*>(cell), column_.type_info()->size());
+  if (column_.type_info()->physical_type() == BINARY) {
+    const Slice* s = reinterpret_cast<const Slice*>(cell);
+    binary_data_.assign(reinterpret_cast<const char*>(s->data()), s->size());
+  }
+  has_value_ = true;
+}
+
+boost::optional<ColumnPredicate> TopNBound::GetPredicate(Arena* arena) const {
+  void* value = arena->AllocateBytesAligned(column_.type_info()->size(),
+                                             alignof(std::max_align_t));
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!has_value_) {
+      return boost::none;
+    }
+    memcpy(value, cell_.data(), cell_.size());
+    if (column_.type_info()->physical_type() == BINARY) {
+      Slice* s = reinterpret_cast<Slice*>(value);
+      uint8_t* data = reinterpret_cast<uint8_t*>(arena->AllocateBytes(binary_data_.size()));
+      memcpy(data, binary_data_.data(), binary_data_.size());
+      *s = Slice(data, binary_data_.size());
+    }
+  }
+  // Rows equal to the bound can't displace it, so they're left out of
+  // ascending orders. Range predicates have no exclusive lower bound, so
+  // they're let through for descending orders.
+  if (descending_) {
+    return ColumnPredicate::Range(column_, value, nullptr);
+  }
+  return ColumnPredicate::Range(column_, nullptr, value);
+}
+
 string ScanSpec::ToString(const Schema& schema) const {
   vector<string> preds;
 
@@ -124,7 +187,11 @@ string ScanSpec::ToString(const Schema& schema) const {
     }
   }
 
-  return JoinStrings(preds, " AND ");
+  string ret = JoinStrings(preds, " AND ");
+  if (sample_.enabled()) {
+    ret += strings::Substitute("$0SAMPLE $1%", ret.empty() ? "" : " ", sample_.fraction() * 100);
+  }
+  return ret;
 }
 
 void ScanSpec::OptimizeScan(const Schema& schema,
@@ -180,9 +247,10 @@ void ScanSpec::PushPredicatesIntoPrimaryKeyBounds(const Schema& schema,
       } else if (type == PredicateType::Range) {
         RemovePredicate(column);
         break;
-      } else if (type == PredicateType::InList) {
-        // InList predicates should not be removed as the full constraints imposed by an InList
-        // cannot be translated into only a single set of lower and upper bound primary keys
+      } else if (type == PredicateType::InList || type == PredicateType::InBloomFilter) {
+        // InList and InBloomFilter predicates should not be removed as the full constraints
+        // they impose cannot be translated into only a single set of lower and upper bound
+        // primary keys
         break;
       } else {
         LOG(FATAL) << "Can not remove unknown predicate type";
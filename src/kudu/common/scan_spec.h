@@ -17,10 +17,17 @@
 #ifndef KUDU_COMMON_SCAN_SPEC_H
 #define KUDU_COMMON_SCAN_SPEC_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+
+#include <boost/optional/optional.hpp>
 
 #include "kudu/common/column_predicate.h" // IWYU pragma: keep
+#include "kudu/common/schema.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/slice.h"
 
 namespace kudu {
@@ -28,7 +35,79 @@ namespace kudu {
 class AutoReleasePool;
 class Arena;
 class EncodedKey;
-class Schema;
+
+// A random sample of about a given fraction of the rows of a scan. Rather
+// than rows, the sample is made of units of data, such as the batches of rows
+// read from the same CFile blocks, so that the units left out needn't be
+// read at all. Samples with the same seed pick the same units.
+class ScanSample {
+ public:
+  // A sample of all the rows.
+  ScanSample()
+    : fraction_(1),
+      seed_(0) {
+  }
+
+  // 'fraction' must be in (0, 1].
+  ScanSample(double fraction, uint64_t seed);
+
+  // Returns true if the sample includes the unit of data identified by
+  // 'unit_id'. Each unit is included independently, with a probability of
+  // fraction().
+  bool Includes(const Slice& unit_id) const;
+
+  // Returns true if the sample leaves out some of the rows.
+  bool enabled() const {
+    return fraction_ < 1;
+  }
+
+  double fraction() const {
+    return fraction_;
+  }
+
+ private:
+  double fraction_;
+  uint64_t seed_;
+};
+
+// The bound past which rows of a top-N scan can't be among the N rows it
+// returns, which tightens as rows are read. Rows are ordered by the value of
+// a column, NULLs last, so the bound is the value of the N-th row read so
+// far. Iterators may skip the rows which can't beat it without reading them.
+//
+// Thread-safe: the bound may be read by the iterators of a parallel scan
+// while it is raised.
+class TopNBound {
+ public:
+  TopNBound(ColumnSchema column, bool descending);
+
+  const ColumnSchema& column() const {
+    return column_;
+  }
+
+  bool descending() const {
+    return descending_;
+  }
+
+  // Sets the bound to 'cell', a non-NULL cell of the column which is at
+  // least as good as the current bound.
+  void Set(const void* cell);
+
+  // Returns the predicate satisfied by every row which may still be among
+  // the top N, with its value copied into 'arena', or boost::none if there's
+  // no bound yet.
+  boost::optional<ColumnPredicate> GetPredicate(Arena* arena) const;
+
+ private:
+  const ColumnSchema column_;
+  const bool descending_;
+
+  mutable simple_spinlock lock_;
+  // The cell of the bound, and the data of binary cells, if it was set.
+  bool has_value_;
+  std::string cell_;
+  std::string binary_data_;
+};
 
 class ScanSpec {
  public:
@@ -119,6 +198,25 @@ class ScanSpec {
     cache_blocks_ = cache_blocks;
   }
 
+  // The sample of the rows read by the scan. Iterators copy it on Init().
+  const ScanSample& sample() const {
+    return sample_;
+  }
+
+  void set_sample(const ScanSample& sample) {
+    sample_ = sample;
+  }
+
+  // The bound of the top-N scan this spec is for, if any. Iterators keep a
+  // reference to it on Init().
+  const std::shared_ptr<TopNBound>& top_n_bound() const {
+    return top_n_bound_;
+  }
+
+  void set_top_n_bound(std::shared_ptr<TopNBound> bound) {
+    top_n_bound_ = std::move(bound);
+  }
+
   std::string ToString(const Schema& s) const;
 
  private:
@@ -149,6 +247,8 @@ class ScanSpec {
   std::string lower_bound_partition_key_;
   std::string exclusive_upper_bound_partition_key_;
   bool cache_blocks_;
+  ScanSample sample_;
+  std::shared_ptr<TopNBound> top_n_bound_;
 };
 
 } // namespace kudu
@@ -70,10 +70,14 @@ string ColumnTypeAttributes::ToStringForType(DataType type) const {
 }
 
 string ColumnStorageAttributes::ToString() const {
-  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2",
+  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2, "
+                             "compression_level=$3, indexed=$4, ttl_seconds=$5",
                              EncodingType_Name(encoding),
                              CompressionType_Name(compression),
-                             cfile_block_size);
+                             cfile_block_size,
+                             compression_level,
+                             indexed,
+                             ttl_seconds);
 }
 
 Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
@@ -110,6 +114,15 @@ Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
   if (col_delta.cfile_block_size) {
     attributes_.cfile_block_size = *col_delta.cfile_block_size;
   }
+  if (col_delta.compression_level) {
+    attributes_.compression_level = *col_delta.compression_level;
+  }
+  if (col_delta.indexed) {
+    attributes_.indexed = *col_delta.indexed;
+  }
+  if (col_delta.ttl_seconds) {
+    attributes_.ttl_seconds = *col_delta.ttl_seconds;
+  }
   return Status::OK();
 }
 
@@ -125,13 +125,19 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      compression_level(0),
+      indexed(false),
+      ttl_seconds(0) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      compression_level(0),
+      indexed(false),
+      ttl_seconds(0) {
   }
 
   std::string ToString() const;
@@ -142,6 +148,18 @@ struct ColumnStorageAttributes {
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // The compression level, for codecs which support levels. If 0, uses the
+  // codec's default level.
+  int32_t compression_level;
+
+  // Whether each rowset flushed for the column has a secondary index mapping
+  // its values to the ordinals of its rows.
+  bool indexed;
+
+  // If positive, the rows whose value of the column, a UNIXTIME_MICROS, is
+  // older than this many seconds are expired.
+  int64_t ttl_seconds;
 };
 
 // A struct representing changes to a ColumnSchema.
@@ -173,6 +191,9 @@ public:
   boost::optional<EncodingType> encoding;
   boost::optional<CompressionType> compression;
   boost::optional<int32_t> cfile_block_size;
+  boost::optional<int32_t> compression_level;
+  boost::optional<bool> indexed;
+  boost::optional<int64_t> ttl_seconds;
 };
 
 // The schema for a given column.
@@ -543,6 +564,17 @@ class Schema {
     return cols_;
   }
 
+  // Return the index of the column with a row TTL, or kColumnNotFound if
+  // no column has one.
+  int find_ttl_column() const {
+    for (int i = 0; i < cols_.size(); i++) {
+      if (cols_[i].attributes().ttl_seconds > 0) {
+        return i;
+      }
+    }
+    return kColumnNotFound;
+  }
+
   // Return the column index corresponding to the given column,
   // or kColumnNotFound if the column is not in this schema.
   int find_column(const StringPiece col_name) const {
@@ -32,6 +32,7 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/memory/arena.h"
@@ -240,6 +241,64 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPB) {
   }
 }
 
+// Serialize blocks in columnar layout, with some rows unselected and some
+// NULLs, and ensure each column holds the expected selected cells.
+TEST_F(WireProtocolTest, TestSerializeRowBlockColumnar) {
+  Arena arena(1024);
+  RowBlock block(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&block);
+  // Deselect the even rows and set column 'col3' of every third row to NULL.
+  for (int i = 0; i < block.nrows(); i++) {
+    if (i % 2 == 0) {
+      block.selection_vector()->SetRowUnselected(i);
+    }
+    if (i % 3 == 0) {
+      block.row(i).cell(2).set_null(true);
+    }
+  }
+
+  // Project only 'col1' and 'col3'; serialize the block twice to exercise
+  // appending to an existing batch.
+  Schema proj_schema({ ColumnSchema("col1", STRING),
+                       ColumnSchema("col3", UINT32, true /* nullable */) },
+                     0);
+  ColumnarSerializedBatch batch;
+  SerializeRowBlockColumnar(block, &proj_schema, &batch);
+  SerializeRowBlockColumnar(block, &proj_schema, &batch);
+  ASSERT_EQ(10, batch.num_rows);
+  ASSERT_EQ(2, batch.columns.size());
+
+  // 'col1' is a non-nullable string: offsets plus varlen data.
+  const auto& col1 = batch.columns[0];
+  ASSERT_TRUE(col1.varlen_data);
+  ASSERT_FALSE(col1.non_null_bitmap);
+  ASSERT_EQ((batch.num_rows + 1) * sizeof(uint32_t), col1.data->size());
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(col1.data->data());
+  const string kCol1Val = "hello world col1";
+  ASSERT_EQ(kCol1Val.size() * batch.num_rows, col1.varlen_data->size());
+  for (int i = 0; i < batch.num_rows; i++) {
+    ASSERT_EQ(kCol1Val.size() * i, offsets[i]);
+    Slice cell(col1.varlen_data->data() + offsets[i], offsets[i + 1] - offsets[i]);
+    ASSERT_EQ(kCol1Val, cell.ToString());
+  }
+
+  // 'col3' is a nullable fixed-length column: cells plus a non-null bitmap.
+  const auto& col3 = batch.columns[1];
+  ASSERT_FALSE(col3.varlen_data);
+  ASSERT_TRUE(col3.non_null_bitmap);
+  ASSERT_EQ(batch.num_rows * sizeof(uint32_t), col3.data->size());
+  ASSERT_EQ(BitmapSize(batch.num_rows), col3.non_null_bitmap->size());
+  const uint32_t* vals = reinterpret_cast<const uint32_t*>(col3.data->data());
+  for (int i = 0; i < batch.num_rows; i++) {
+    // Row 'i' in the batch is the odd source row 2 * (i % 5) + 1.
+    uint32_t src_row = 2 * (i % 5) + 1;
+    bool expect_null = src_row % 3 == 0;
+    SCOPED_TRACE(i);
+    ASSERT_EQ(!expect_null, BitmapTest(col3.non_null_bitmap->data(), i));
+    ASSERT_EQ(expect_null ? 0 : src_row, vals[i]);
+  }
+}
+
 // Create a block of rows in columnar layout and ensure that it can be
 // converted to and from protobuf.
 TEST_F(WireProtocolTest, TestColumnarRowBlockToPBWithPadding) {
@@ -499,4 +558,46 @@ TEST_F(WireProtocolTest, TestColumnPredicateInList) {
     ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
   }
 }
+
+TEST_F(WireProtocolTest, TestColumnPredicateInBloomFilter) {
+  ColumnSchema col1("col1", INT32);
+  vector<ColumnSchema> cols = { col1 };
+  Schema schema(cols, 1);
+  Arena arena(1024);
+  boost::optional<ColumnPredicate> predicate;
+
+  BloomFilterBuilder builder(BloomFilterSizing::ByCountAndFPRate(10, 0.01));
+  for (int32_t i = 0; i < 10; i++) {
+    builder.AddKey(BloomKeyProbe(Slice(reinterpret_cast<const uint8_t*>(&i), sizeof(i))));
+  }
+
+  { // col1 IN BLOOM FILTER AND col1 >= 2
+    int32_t two = 2;
+    vector<BloomFilter> filters { BloomFilter(builder.slice(), builder.n_hashes()) };
+    ColumnPredicate cp = ColumnPredicate::InBloomFilter(col1, &filters, &two, nullptr);
+    ColumnPredicatePB pb;
+    ASSERT_NO_FATAL_FAILURE(ColumnPredicateToPB(cp, &pb));
+
+    ASSERT_OK(ColumnPredicateFromPB(schema, &arena, pb, &predicate));
+    ASSERT_EQ(PredicateType::InBloomFilter, predicate->predicate_type());
+    ASSERT_EQ(cp, *predicate);
+    // The filter must have been copied out of the protobuf.
+    ASSERT_NE(pb.in_bloom_filter().bloom_filters(0).bloom_data().data(),
+              reinterpret_cast<const char*>(predicate->bloom_filters()[0].slice().data()));
+  }
+
+  { // No filters.
+    ColumnPredicatePB pb;
+    pb.set_column("col1");
+    pb.mutable_in_bloom_filter();
+    ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
+  }
+
+  { // An empty filter.
+    ColumnPredicatePB pb;
+    pb.set_column("col1");
+    pb.mutable_in_bloom_filter()->add_bloom_filters()->set_nhash(3);
+    ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
+  }
+}
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/common/wire_protocol.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <ostream>
@@ -40,6 +41,7 @@
 #include "kudu/gutil/strings/fastmem.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
@@ -223,6 +225,13 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
     pb->set_encoding(col_schema.attributes().encoding);
     pb->set_compression(col_schema.attributes().compression);
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
+    pb->set_compression_level(col_schema.attributes().compression_level);
+    if (col_schema.attributes().indexed) {
+      pb->set_indexed(true);
+    }
+    if (col_schema.attributes().ttl_seconds > 0) {
+      pb->set_ttl_seconds(col_schema.attributes().ttl_seconds);
+    }
   }
   if (col_schema.has_read_default()) {
     if (col_schema.type_info()->physical_type() == BINARY) {
@@ -288,6 +297,15 @@ ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb) {
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
+  if (pb.has_compression_level()) {
+    attributes.compression_level = pb.compression_level();
+  }
+  if (pb.has_indexed()) {
+    attributes.indexed = pb.indexed();
+  }
+  if (pb.has_ttl_seconds()) {
+    attributes.ttl_seconds = pb.ttl_seconds();
+  }
   return ColumnSchema(pb.name(), pb.type(), pb.is_nullable(),
                       read_default_ptr, write_default_ptr,
                       attributes, type_attributes);
@@ -315,6 +333,15 @@ void ColumnSchemaDeltaToPB(const ColumnSchemaDelta& col_delta, ColumnSchemaDelta
   if (col_delta.cfile_block_size) {
     pb->set_block_size(*col_delta.cfile_block_size);
   }
+  if (col_delta.compression_level) {
+    pb->set_compression_level(*col_delta.compression_level);
+  }
+  if (col_delta.indexed) {
+    pb->set_indexed(*col_delta.indexed);
+  }
+  if (col_delta.ttl_seconds) {
+    pb->set_ttl_seconds(*col_delta.ttl_seconds);
+  }
 }
 
 ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
@@ -337,6 +364,15 @@ ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
   if (pb.has_block_size()) {
     col_delta.cfile_block_size = boost::optional<int32_t>(pb.block_size());
   }
+  if (pb.has_compression_level()) {
+    col_delta.compression_level = boost::optional<int32_t>(pb.compression_level());
+  }
+  if (pb.has_indexed()) {
+    col_delta.indexed = boost::optional<bool>(pb.indexed());
+  }
+  if (pb.has_ttl_seconds()) {
+    col_delta.ttl_seconds = boost::optional<int64_t>(pb.ttl_seconds());
+  }
   return col_delta;
 }
 
@@ -480,6 +516,25 @@ void ColumnPredicateToPB(const ColumnPredicate& predicate,
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      auto* bloom_pred = pb->mutable_in_bloom_filter();
+      for (const BloomFilter& bloom_filter : predicate.bloom_filters()) {
+        auto* filter_pb = bloom_pred->add_bloom_filters();
+        filter_pb->set_bloom_data(bloom_filter.slice().ToString());
+        filter_pb->set_nhash(bloom_filter.n_hashes());
+      }
+      if (predicate.raw_lower() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_lower(),
+                               bloom_pred->mutable_lower());
+      }
+      if (predicate.raw_upper() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_upper(),
+                               bloom_pred->mutable_upper());
+      }
+      return;
+    };
     case PredicateType::None: LOG(FATAL) << "None predicate may not be converted to protobuf";
   }
   LOG(FATAL) << "unknown predicate type";
@@ -549,6 +604,36 @@ Status ColumnPredicateFromPB(const Schema& schema,
         *predicate = ColumnPredicate::IsNull(col);
         break;
       }
+    case ColumnPredicatePB::kInBloomFilter: {
+      const auto& bloom_pred = pb.in_bloom_filter();
+      if (bloom_pred.bloom_filters_size() == 0) {
+        return Status::InvalidArgument("Invalid Bloom filter predicate on column: no filters",
+                                       col.name());
+      }
+      vector<BloomFilter> bloom_filters;
+      for (const auto& filter_pb : bloom_pred.bloom_filters()) {
+        if (filter_pb.bloom_data().empty() || filter_pb.nhash() == 0) {
+          return Status::InvalidArgument("Invalid Bloom filter predicate on column: empty filter",
+                                         col.name());
+        }
+        // Copy the filter out of the protobuf so that it lives as long as
+        // the other predicate data.
+        size_t size = filter_pb.bloom_data().size();
+        uint8_t* data_copy = static_cast<uint8_t*>(arena->AllocateBytes(size));
+        memcpy(data_copy, filter_pb.bloom_data().data(), size);
+        bloom_filters.emplace_back(Slice(data_copy, size), filter_pb.nhash());
+      }
+      const void* lower = nullptr;
+      const void* upper = nullptr;
+      if (bloom_pred.has_lower()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, bloom_pred.lower(), arena, &lower));
+      }
+      if (bloom_pred.has_upper()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, bloom_pred.upper(), arena, &upper));
+      }
+      *predicate = ColumnPredicate::InBloomFilter(col, &bloom_filters, lower, upper);
+      break;
+    };
     default: return Status::InvalidArgument("Unknown predicate type for column", col.name());
   }
   return Status::OK();
@@ -726,6 +811,29 @@ void AppendRowToString<RowBlockRow>(const RowBlockRow& row, string* buf) {
   CHECK_OK(CopyRow(row, &copied_row, reinterpret_cast<Arena*>(NULL)));
 }
 
+// Returns the total size of the strings in the selected, non-null cells of
+// the BINARY column 'col_idx' of 'block'.
+static size_t SelectedVarlenDataSize(const RowBlock& block, int col_idx) {
+  ColumnBlock column_block = block.column_block(col_idx);
+  const SelectionVector* sel = block.selection_vector();
+  size_t total = 0;
+  for (size_t row_idx = 0; row_idx < block.nrows(); row_idx++) {
+    if (sel->IsRowSelected(row_idx) &&
+        !(column_block.is_nullable() && column_block.is_null(row_idx))) {
+      total += reinterpret_cast<const Slice*>(column_block.cell_ptr(row_idx))->size();
+    }
+  }
+  return total;
+}
+
+// Makes room in 'buf' for 'count' more bytes at once, so that the strings
+// gathered into it aren't copied again as it grows.
+static void ReserveAdditional(faststring* buf, size_t count) {
+  if (buf->size() + count > buf->capacity()) {
+    buf->reserve(std::max(buf->size() + count, buf->capacity() * 3 / 2));
+  }
+}
+
 // Copy a column worth of data from the given RowBlock into the output
 // protobuf.
 //
@@ -835,6 +943,18 @@ void SerializeRowBlock(const RowBlock& block,
     memset(base, 0, additional_size);
   }
 
+  // The strings are gathered straight from the cells, which may point into
+  // pinned CFile blocks (see --cfile_zero_copy_strings), into the buffer
+  // sent as the indirect data sidecar.
+  size_t indirect_size = 0;
+  for (int p_schema_idx = 0; p_schema_idx < projection_schema->num_columns(); p_schema_idx++) {
+    const ColumnSchema& col = projection_schema->column(p_schema_idx);
+    if (col.type_info()->physical_type() == BINARY) {
+      indirect_size += SelectedVarlenDataSize(block, tablet_schema.find_column(col.name()));
+    }
+  }
+  ReserveAdditional(indirect_data, indirect_size);
+
   size_t t_schema_idx = 0;
   size_t padding_so_far = 0;
   for (int p_schema_idx = 0; p_schema_idx < projection_schema->num_columns(); p_schema_idx++) {
@@ -873,4 +993,111 @@ void SerializeRowBlock(const RowBlock& block,
   rowblock_pb->set_num_rows(rowblock_pb->num_rows() + num_rows);
 }
 
+// Append a column worth of data from the given RowBlock to 'dst' in columnar
+// layout.
+//
+// IS_NULLABLE and IS_VARLEN are template parameters for the same reason as in
+// CopyColumn() above.
+//
+// 'dst_row_base' is the number of rows previously serialized into 'dst'.
+template<bool IS_NULLABLE, bool IS_VARLEN>
+static void CopyColumnToColumnar(const RowBlock& block, int col_idx, size_t dst_row_base,
+                                 size_t num_selected, ColumnarSerializedBatch::Column* dst) {
+  ColumnBlock column_block = block.column_block(col_idx);
+  const size_t src_cell_size = column_block.stride();
+  const size_t dst_cell_size = IS_VARLEN ? sizeof(uint32_t) : src_cell_size;
+
+  size_t old_size = dst->data->size();
+  dst->data->resize(old_size + num_selected * dst_cell_size);
+  uint8_t* dst_cell = dst->data->data() + old_size;
+
+  uint8_t* non_null_bitmap = nullptr;
+  if (IS_NULLABLE) {
+    size_t old_bitmap_size = dst->non_null_bitmap->size();
+    size_t new_bitmap_size = BitmapSize(dst_row_base + num_selected);
+    dst->non_null_bitmap->resize(new_bitmap_size);
+    non_null_bitmap = dst->non_null_bitmap->data();
+    memset(non_null_bitmap + old_bitmap_size, 0, new_bitmap_size - old_bitmap_size);
+  }
+  if (IS_VARLEN) {
+    ReserveAdditional(dst->varlen_data.get(), SelectedVarlenDataSize(block, col_idx));
+  }
+
+  const SelectionVector* sel = block.selection_vector();
+  size_t dst_row_idx = dst_row_base;
+  for (size_t row_idx = 0; row_idx < block.nrows(); row_idx++) {
+    if (!sel->IsRowSelected(row_idx)) {
+      continue;
+    }
+    bool is_null = IS_NULLABLE && column_block.is_null(row_idx);
+    if (IS_NULLABLE && !is_null) {
+      BitmapSet(non_null_bitmap, dst_row_idx);
+    }
+    if (IS_VARLEN) {
+      if (!is_null) {
+        const Slice* slice = reinterpret_cast<const Slice*>(column_block.cell_ptr(row_idx));
+        dst->varlen_data->append(slice->data(), slice->size());
+      }
+      uint32_t end_offset = dst->varlen_data->size();
+      memcpy(dst_cell, &end_offset, sizeof(end_offset));
+    } else if (is_null) {
+      memset(dst_cell, 0, dst_cell_size);
+    } else {
+      strings::memcpy_inlined(dst_cell, column_block.cell_ptr(row_idx), dst_cell_size);
+    }
+    dst_cell += dst_cell_size;
+    dst_row_idx++;
+  }
+}
+
+void SerializeRowBlockColumnar(const RowBlock& block,
+                               const Schema* projection_schema,
+                               ColumnarSerializedBatch* batch) {
+  DCHECK_GT(block.nrows(), 0);
+  const Schema& tablet_schema = block.schema();
+
+  if (projection_schema == nullptr) {
+    projection_schema = &tablet_schema;
+  }
+
+  if (batch->columns.empty()) {
+    batch->columns.resize(projection_schema->num_columns());
+    for (int i = 0; i < projection_schema->num_columns(); i++) {
+      const ColumnSchema& col = projection_schema->column(i);
+      ColumnarSerializedBatch::Column* dst = &batch->columns[i];
+      dst->data.reset(new faststring());
+      if (col.type_info()->physical_type() == BINARY) {
+        // Variable-length columns start with the offset of the first row.
+        dst->varlen_data.reset(new faststring());
+        uint32_t zero = 0;
+        dst->data->append(&zero, sizeof(zero));
+      }
+      if (col.is_nullable()) {
+        dst->non_null_bitmap.reset(new faststring());
+      }
+    }
+  }
+  DCHECK_EQ(batch->columns.size(), projection_schema->num_columns());
+
+  size_t num_selected = block.selection_vector()->CountSelected();
+  for (int p_schema_idx = 0; p_schema_idx < projection_schema->num_columns(); p_schema_idx++) {
+    const ColumnSchema& col = projection_schema->column(p_schema_idx);
+    int t_schema_idx = tablet_schema.find_column(col.name());
+    DCHECK_NE(t_schema_idx, -1);
+    ColumnarSerializedBatch::Column* dst = &batch->columns[p_schema_idx];
+
+    bool is_varlen = col.type_info()->physical_type() == BINARY;
+    if (col.is_nullable() && is_varlen) {
+      CopyColumnToColumnar<true, true>(block, t_schema_idx, batch->num_rows, num_selected, dst);
+    } else if (col.is_nullable() && !is_varlen) {
+      CopyColumnToColumnar<true, false>(block, t_schema_idx, batch->num_rows, num_selected, dst);
+    } else if (!col.is_nullable() && is_varlen) {
+      CopyColumnToColumnar<false, true>(block, t_schema_idx, batch->num_rows, num_selected, dst);
+    } else {
+      CopyColumnToColumnar<false, false>(block, t_schema_idx, batch->num_rows, num_selected, dst);
+    }
+  }
+  batch->num_rows += num_selected;
+}
+
 } // namespace kudu
@@ -20,8 +20,10 @@
 #define KUDU_COMMON_WIRE_PROTOCOL_H
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "kudu/util/faststring.h"
 #include "kudu/util/status.h"
 
 namespace boost {
@@ -40,7 +42,6 @@ namespace kudu {
 class Arena;
 class ColumnPredicate;
 class ColumnSchema;
-class faststring;
 class HostPort;
 class RowBlock;
 class Schema;
@@ -154,6 +155,42 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
                        faststring* data_buf, faststring* indirect_data,
                        bool pad_unixtime_micros_to_16_bytes = false);
 
+// A batch of rows serialized in columnar layout, to be sent to the client
+// as the sidecars of a ColumnarRowBlockPB. See wire_protocol.proto for the
+// format of each column.
+struct ColumnarSerializedBatch {
+  struct Column {
+    // Fixed-length cells, or offsets into 'varlen_data' for variable-length
+    // columns.
+    std::unique_ptr<faststring> data;
+
+    // Only set for variable-length columns.
+    std::unique_ptr<faststring> varlen_data;
+
+    // Only set for nullable columns.
+    std::unique_ptr<faststring> non_null_bitmap;
+  };
+
+  // The serialized columns, in projection order. Empty until the first
+  // block is serialized.
+  std::vector<Column> columns;
+
+  // The total number of rows serialized so far.
+  int64_t num_rows = 0;
+};
+
+// Like SerializeRowBlock(), but appends the selected rows of 'block' to 'batch'
+// in columnar layout.
+//
+// If 'projection_schema' is not NULL, then only columns specified in
+// 'projection_schema' will be serialized. All blocks serialized into the same
+// batch must use the same projection.
+//
+// Requires that block.nrows() > 0
+void SerializeRowBlockColumnar(const RowBlock& block,
+                               const Schema* projection_schema,
+                               ColumnarSerializedBatch* batch);
+
 // Rewrites the data pointed-to by row data slice 'row_data_slice' by replacing
 // relative indirect data pointers with absolute ones in 'indirect_data_slice'.
 // At the time of this writing, this rewriting is only done for STRING types.
@@ -20,8 +20,10 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -33,18 +35,23 @@
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(log_force_fsync_all);
+
 namespace kudu {
 namespace consensus {
 
 using std::string;
+using std::thread;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 const char* kTabletId = "test-consensus-metadata";
 const int64_t kInitialTerm = 3;
@@ -174,6 +181,44 @@ TEST_F(ConsensusMetadataTest, TestFlush) {
   }
 }
 
+// Check that concurrent synced flushes of the metadata of many tablets, whose
+// directory syncs are coalesced, all make it to disk.
+TEST_F(ConsensusMetadataTest, TestConcurrentSyncedFlushes) {
+  FLAGS_log_force_fsync_all = true;
+  const int kNumTablets = 16;
+  const int kNumFlushes = 10;
+  vector<scoped_refptr<ConsensusMetadata>> cmetas(kNumTablets);
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_OK(ConsensusMetadata::Create(&fs_manager_, Substitute("tablet-$0", i),
+                                        fs_manager_.uuid(), config_, kInitialTerm,
+                                        ConsensusMetadataCreateMode::FLUSH_ON_CREATE,
+                                        &cmetas[i]));
+  }
+
+  vector<thread> threads;
+  vector<Status> statuses(kNumTablets);
+  for (int i = 0; i < kNumTablets; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 1; j <= kNumFlushes && statuses[i].ok(); j++) {
+        cmetas[i]->set_current_term(kInitialTerm + j);
+        statuses[i] = cmetas[i]->Flush();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_OK(statuses[i]);
+    scoped_refptr<ConsensusMetadata> cmeta_read;
+    ASSERT_OK(ConsensusMetadata::Load(&fs_manager_, Substitute("tablet-$0", i),
+                                      fs_manager_.uuid(), &cmeta_read));
+    NO_FATALS(AssertValuesEqual(cmeta_read, kInvalidOpIdIndex, fs_manager_.uuid(),
+                                kInitialTerm + kNumFlushes));
+  }
+}
+
 // Builds a distributed configuration of voters with the given uuids.
 RaftConfigPB BuildConfig(const vector<string>& uuids) {
   RaftConfigPB config;
@@ -16,6 +16,8 @@
 // under the License.
 #include "kudu/consensus/consensus_meta.h"
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <utility>
@@ -28,13 +30,17 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
@@ -45,13 +51,97 @@ DEFINE_double(fault_crash_before_cmeta_flush, 0.0,
               "consensus metadata. (For testing only!)");
 TAG_FLAG(fault_crash_before_cmeta_flush, unsafe);
 
+DEFINE_bool(cmeta_coalesce_dir_syncs, true,
+            "Whether the fsync()s of the consensus metadata directory done by "
+            "concurrent flushes of the consensus metadata of different tablets "
+            "are coalesced, so that a single fsync() makes the files renamed "
+            "before it started durable. The files themselves are always "
+            "fsynced one by one.");
+TAG_FLAG(cmeta_coalesce_dir_syncs, advanced);
+TAG_FLAG(cmeta_coalesce_dir_syncs, runtime);
+
 namespace kudu {
 namespace consensus {
 
 using std::lock_guard;
 using std::string;
+using std::unique_ptr;
 using strings::Substitute;
 
+namespace {
+
+// Group commit of the fsync()s of a directory. After a flood of elections,
+// such as when a server restarts, hundreds of tablets flush their consensus
+// metadata at once. Each flush renames a new file into the same directory,
+// and the renames are only durable once the directory is synced.
+//
+// A caller whose rename completed before a sync of the directory started is
+// covered by that sync, so it only waits for it rather than issuing its own.
+// A single sync is in flight at any time; callers arriving meanwhile are all
+// covered by the next one, which is issued by one of them.
+class DirSyncCoalescer {
+ public:
+  DirSyncCoalescer()
+      : cond_(&lock_),
+        num_requested_(0),
+        num_synced_(0),
+        sync_in_flight_(false) {
+  }
+
+  // Makes the entries renamed in 'dir' before this call durable.
+  Status SyncDir(Env* env, const string& dir) {
+    MutexLock l(lock_);
+    const int64_t ticket = ++num_requested_;
+    while (sync_in_flight_) {
+      cond_.Wait();
+    }
+    if (num_synced_ >= ticket) {
+      // A sync started after this caller's rename completed.
+      return Status::OK();
+    }
+    sync_in_flight_ = true;
+    const int64_t covered = num_requested_;
+    l.Unlock();
+    Status s = env->SyncDir(dir);
+    l.Lock();
+    sync_in_flight_ = false;
+    // On failure, the callers waiting for this sync issue their own.
+    if (s.ok()) {
+      num_synced_ = covered;
+    }
+    cond_.Broadcast();
+    return s;
+  }
+
+  // Returns the coalescer of 'dir'. The coalescers are never destroyed.
+  static DirSyncCoalescer* ForDir(const string& dir) {
+    static Mutex map_lock;
+    static auto* coalescers = new std::map<string, unique_ptr<DirSyncCoalescer>>();
+    MutexLock l(map_lock);
+    unique_ptr<DirSyncCoalescer>* coalescer = FindOrNull(*coalescers, dir);
+    if (coalescer) {
+      return coalescer->get();
+    }
+    auto* result = new DirSyncCoalescer();
+    EmplaceOrDie(coalescers, dir, unique_ptr<DirSyncCoalescer>(result));
+    return result;
+  }
+
+ private:
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // The number of callers so far, and the number of them covered by the
+  // last successful sync.
+  int64_t num_requested_;
+  int64_t num_synced_;
+  bool sync_in_flight_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirSyncCoalescer);
+};
+
+} // anonymous namespace
+
 int64_t ConsensusMetadata::current_term() const {
   DFAKE_SCOPED_RECURSIVE_LOCK(fake_lock_);
   DCHECK(pb_.has_current_term());
@@ -233,17 +323,27 @@ Status ConsensusMetadata::Flush(FlushMode flush_mode) {
                           "Unable to fsync consensus parent dir " + parent_dir);
   }
 
+  // We use FLAGS_log_force_fsync_all here because the consensus metadata is
+  // essentially an extension of the primary durability mechanism of the
+  // consensus subsystem: the WAL. Using the same flag ensures that the WAL
+  // and the consensus metadata get the same durability guarantees.
+  pb_util::SyncMode sync_mode = pb_util::NO_SYNC;
+  if (FLAGS_log_force_fsync_all) {
+    sync_mode = FLAGS_cmeta_coalesce_dir_syncs ? pb_util::SYNC_FILE_ONLY : pb_util::SYNC;
+  }
   string meta_file_path = fs_manager_->GetConsensusMetadataPath(tablet_id_);
   RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(
       fs_manager_->env(), meta_file_path, pb_,
       flush_mode == OVERWRITE ? pb_util::OVERWRITE : pb_util::NO_OVERWRITE,
-      // We use FLAGS_log_force_fsync_all here because the consensus metadata is
-      // essentially an extension of the primary durability mechanism of the
-      // consensus subsystem: the WAL. Using the same flag ensures that the WAL
-      // and the consensus metadata get the same durability guarantees.
-      FLAGS_log_force_fsync_all ? pb_util::SYNC : pb_util::NO_SYNC),
+      sync_mode),
           Substitute("Unable to write consensus meta file for tablet $0 to path $1",
                      tablet_id_, meta_file_path));
+  // The new term and vote must be durable before this returns, since they
+  // may be acted upon right after.
+  if (sync_mode == pb_util::SYNC_FILE_ONLY) {
+    RETURN_NOT_OK_PREPEND(DirSyncCoalescer::ForDir(dir)->SyncDir(fs_manager_->env(), dir),
+                          "Unable to fsync consensus metadata dir " + dir);
+  }
   RETURN_NOT_OK(UpdateOnDiskSize());
   return Status::OK();
 }
@@ -21,6 +21,7 @@
 #include <type_traits>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -54,6 +55,9 @@
 #include "kudu/util/test_util.h"
 #include "kudu/util/threadpool.h"
 
+DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
+
 METRIC_DECLARE_entity(tablet);
 
 namespace kudu {
@@ -202,6 +206,40 @@ TEST_F(ConsensusPeersTest, TestRemotePeer) {
   CheckLastRemoteEntry(proxy, 2, 20);
 }
 
+// Tests that a peer with several requests in flight replicates every op, in
+// order, when each request only carries a single op.
+TEST_F(ConsensusPeersTest, TestPipelinedRemotePeer) {
+  FLAGS_consensus_max_batch_size_bytes = 1;
+  FLAGS_consensus_max_inflight_requests_per_peer = 4;
+  message_queue_->SetLeaderMode(kMinimumOpIdIndex,
+                                kMinimumTerm,
+                                BuildRaftConfigPBForTests(3));
+
+  // Requests to the test proxy must be sent one at a time, so this peer
+  // builds them on a serial token.
+  unique_ptr<ThreadPoolToken> serial_token =
+      raft_pool_->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  RaftPeerPB peer_pb = FakeRaftPeerPB(kFollowerUuid);
+  auto proxy = new NoOpTestPeerProxy(raft_pool_.get(), peer_pb);
+  shared_ptr<Peer> peer;
+  ASSERT_OK(Peer::NewRemotePeer(std::move(peer_pb),
+                                kTabletId,
+                                kLeaderUuid,
+                                message_queue_.get(),
+                                serial_token.get(),
+                                gscoped_ptr<PeerProxy>(proxy),
+                                messenger_,
+                                &peer));
+
+  AppendReplicateMessagesToQueue(message_queue_.get(), clock_, 1, 20);
+  peer->SignalRequest();
+  WaitForCommitIndex(20);
+  ASSERT_OPID_EQ(MakeOpId(2, 20), proxy->last_received());
+
+  peer->Close();
+  serial_token->Wait();
+}
+
 TEST_F(ConsensusPeersTest, TestRemotePeers) {
   message_queue_->SetLeaderMode(kMinimumOpIdIndex,
                                 kMinimumTerm,
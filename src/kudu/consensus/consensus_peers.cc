@@ -24,11 +24,13 @@
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/wire_protocol.h"
@@ -43,12 +45,18 @@
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/fault_injection.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -84,6 +92,36 @@ DEFINE_bool(enable_tablet_copy, true,
             "replica. For testing purposes only.");
 TAG_FLAG(enable_tablet_copy, unsafe);
 
+DEFINE_int32(consensus_max_inflight_requests_per_peer, 1,
+             "Maximum number of UpdateConsensus requests a leader keeps in flight "
+             "to each follower. With more than one, the leader sends the next "
+             "batch of ops to a follower without waiting for the response to the "
+             "previous one, which raises the replication throughput of a single "
+             "tablet over links with a high round-trip time.");
+TAG_FLAG(consensus_max_inflight_requests_per_peer, advanced);
+TAG_FLAG(consensus_max_inflight_requests_per_peer, experimental);
+TAG_FLAG(consensus_max_inflight_requests_per_peer, runtime);
+
+DEFINE_bool(raft_batch_heartbeats, true,
+            "Whether leaders batch the heartbeats of idle tablets to the same "
+            "server into a single MultiRaftUpdateConsensus RPC. Requests which "
+            "carry ops or commit index updates are always sent on their own.");
+TAG_FLAG(raft_batch_heartbeats, advanced);
+TAG_FLAG(raft_batch_heartbeats, runtime);
+
+DEFINE_int32(raft_heartbeat_batch_window_ms, 50,
+             "Maximum time a heartbeat is held back to be batched with the "
+             "heartbeats of other tablets to the same server. Only relevant "
+             "with --raft_batch_heartbeats.");
+TAG_FLAG(raft_heartbeat_batch_window_ms, advanced);
+
+DEFINE_int32(raft_heartbeat_batch_max_size, 256,
+             "Maximum number of heartbeats sent in a single MultiRaftUpdateConsensus "
+             "RPC. A batch is sent right away once it reaches this size. Only "
+             "relevant with --raft_batch_heartbeats.");
+TAG_FLAG(raft_heartbeat_batch_max_size, advanced);
+
+DECLARE_bool(consensus_encode_ops_once);
 DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::pb_util::SecureShortDebugString;
@@ -93,6 +131,7 @@ using kudu::rpc::RpcController;
 using kudu::tserver::TabletServerErrorPB;
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using std::weak_ptr;
 using strings::Substitute;
@@ -167,9 +206,10 @@ Status Peer::SignalRequest(bool even_if_queue_empty) {
     return Status::IllegalState("Peer was closed.");
   }
 
-  // Only allow one request at a time. No sense waking up the
-  // raft thread pool if the task will just abort anyway.
-  if (request_pending_) {
+  // Only allow a limited number of requests at a time. No sense waking up
+  // the raft thread pool if the task will just abort anyway.
+  if (tablet_copy_pending_ ||
+      num_inflight_updates_ >= FLAGS_consensus_max_inflight_requests_per_peer) {
     return Status::OK();
   }
 
@@ -190,8 +230,9 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // Only allow one request at a time.
-  if (request_pending_) {
+  // Only allow a limited number of requests at a time.
+  if (tablet_copy_pending_ ||
+      num_inflight_updates_ >= FLAGS_consensus_max_inflight_requests_per_peer) {
     return;
   }
 
@@ -217,30 +258,45 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // The peer has no pending request nor is sending: send the request.
+  // A request pipelined behind others still in flight is only worth sending
+  // if it carries something new: the requests in flight already serve as
+  // heartbeats.
+  const bool pipelined = num_inflight_updates_ > 0;
+  if (pipelined) {
+    even_if_queue_empty = false;
+  }
+
+  // The peer has room for another request: build it.
+  shared_ptr<UpdateRpc> rpc = std::make_shared<UpdateRpc>();
+  ConsensusRequestPB& request = rpc->request;
   bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  int64_t commit_index_before = last_request_committed_index_;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request,
+                                    &rpc->replicate_msg_refs, &needs_tablet_copy,
+                                    pipelined ? pipelined_next_index_ : 0);
+  int64_t commit_index_after = request.has_committed_index() ?
+      request.committed_index() : kMinimumOpIdIndex;
 
   if (PREDICT_FALSE(!s.ok())) {
     VLOG_WITH_PREFIX_UNLOCKED(1) << s.ToString();
     return;
   }
+  last_request_committed_index_ = commit_index_after;
 
   if (PREDICT_FALSE(needs_tablet_copy)) {
+    // Let the requests in flight complete before starting a tablet copy.
+    if (pipelined) {
+      return;
+    }
     Status s = PrepareTabletCopyRequest();
     if (s.ok()) {
-      controller_.Reset();
-      request_pending_ = true;
+      tc_controller_.Reset();
+      tablet_copy_pending_ = true;
       l.unlock();
       // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
       // that this object outlives the RPC.
       shared_ptr<Peer> s_this = shared_from_this();
-      proxy_->StartTabletCopy(&tc_request_, &tc_response_, &controller_,
+      proxy_->StartTabletCopy(&tc_request_, &tc_response_, &tc_controller_,
                               [s_this]() {
                                 s_this->ProcessTabletCopyResponse();
                               });
@@ -251,11 +307,11 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  request.set_tablet_id(tablet_id_);
+  request.set_caller_uuid(leader_uuid_);
+  request.set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = request.ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
   // message, if not just return.
   if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
@@ -271,58 +327,85 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(request_);
-  controller_.Reset();
-
-  request_pending_ = true;
+      << SecureShortDebugString(request);
+
+  const bool has_ops = request.ops_size() > 0;
+  if (has_ops) {
+    rpc->last_op_index = request.ops(request.ops_size() - 1).id().index();
+    pipelined_next_index_ = rpc->last_op_index + 1;
+    if (FLAGS_consensus_encode_ops_once) {
+      WARN_NOT_OK(MoveOpsToSidecar(rpc.get()),
+                  "Unable to send ops in a sidecar, sending them in the request");
+    }
+  }
+  num_inflight_updates_++;
+  // If this request carried ops and there is room for another one, try to
+  // pipeline the next batch behind it right away.
+  bool send_more = has_ops &&
+      num_inflight_updates_ < FLAGS_consensus_max_inflight_requests_per_peer;
   l.unlock();
   // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
   // that this object outlives the RPC.
   shared_ptr<Peer> s_this = shared_from_this();
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      [s_this]() {
-                        s_this->ProcessResponse();
-                      });
+  rpc->send_time = MonoTime::Now();
+  if (!req_has_ops && proxy_->SupportsBatchedHeartbeats()) {
+    rpc->batched = true;
+    proxy_->HeartbeatAsync(&request, &rpc->response,
+                           [s_this, rpc](const Status& s) {
+                             rpc->batch_status = s;
+                             s_this->ProcessResponse(rpc);
+                           });
+  } else {
+    proxy_->UpdateAsync(&request, &rpc->response, &rpc->controller,
+                        [s_this, rpc]() {
+                          s_this->ProcessResponse(rpc);
+                        });
+  }
+  if (send_more) {
+    WARN_NOT_OK(SignalRequest(false), "Unable to pipeline the next request");
+  }
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(const shared_ptr<UpdateRpc>& rpc) {
   // Note: This method runs on the reactor thread.
   std::unique_lock<simple_spinlock> lock(peer_lock_);
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
+  CHECK_GT(num_inflight_updates_, 0);
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
+  const ConsensusResponsePB& response = rpc->response;
+
   // Process RpcController errors.
-  const auto controller_status = controller_.status();
+  const auto controller_status = rpc->batched ? rpc->batch_status : rpc->controller.status();
   if (!controller_status.ok()) {
     auto ps = controller_status.IsRemoteError() ?
         PeerStatus::REMOTE_ERROR : PeerStatus::RPC_LAYER_ERROR;
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, controller_status);
-    ProcessResponseError(controller_status);
+    ProcessResponseError(*rpc, controller_status);
     return;
   }
 
   // Process CANNOT_PREPARE.
   // TODO(todd): there is no integration test coverage of this code path. Likely a bug in
   // this path is responsible for KUDU-1779.
-  if (response_.status().has_error() &&
-      response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
-    Status response_status = StatusFromPB(response_.status().error().status());
+  if (response.status().has_error() &&
+      response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
+    Status response_status = StatusFromPB(response.status().error().status());
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), PeerStatus::CANNOT_PREPARE,
                              response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(*rpc, response_status);
     return;
   }
 
   // Process tserver-level errors.
-  if (response_.has_error()) {
-    Status response_status = StatusFromPB(response_.error().status());
+  if (response.has_error()) {
+    Status response_status = StatusFromPB(response.error().status());
     PeerStatus ps;
-    TabletServerErrorPB resp_error = response_.error();
-    switch (response_.error().code()) {
+    TabletServerErrorPB resp_error = response.error();
+    switch (response.error().code()) {
       // We treat WRONG_SERVER_UUID as failed.
       case TabletServerErrorPB::WRONG_SERVER_UUID: FALLTHROUGH_INTENDED;
       case TabletServerErrorPB::TABLET_FAILED:
@@ -336,7 +419,7 @@ void Peer::ProcessResponse() {
         ps = PeerStatus::REMOTE_ERROR;
     }
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(*rpc, response_status);
     return;
   }
 
@@ -348,32 +431,43 @@ void Peer::ProcessResponse() {
   // Capture a weak_ptr reference into the submitted functor so that we can
   // safely handle the functor outliving its peer.
   weak_ptr<Peer> w_this = shared_from_this();
-  Status s = raft_pool_token_->SubmitFunc([w_this]() {
+  Status s = raft_pool_token_->SubmitFunc([w_this, rpc]() {
     if (auto p = w_this.lock()) {
-      p->DoProcessResponse();
+      p->DoProcessResponse(rpc);
 
     }
   });
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << SecureShortDebugString(response_);
-    request_pending_ = false;
+        << ": " << SecureShortDebugString(response);
+    num_inflight_updates_--;
+    pipelined_next_index_ = 0;
   }
 }
 
-void Peer::DoProcessResponse() {
+void Peer::DoProcessResponse(const shared_ptr<UpdateRpc>& rpc) {
+  const ConsensusResponsePB& response = rpc->response;
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(response_);
+      << SecureShortDebugString(response);
 
   bool more_pending;
-  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_, &more_pending);
+  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response, &more_pending,
+                           rpc->send_time);
 
   {
     std::unique_lock<simple_spinlock> lock(peer_lock_);
-    CHECK(request_pending_);
+    CHECK_GT(num_inflight_updates_, 0);
     failed_attempts_ = 0;
-    request_pending_ = false;
+    num_inflight_updates_--;
+    // If the peer did not take every op of this request (e.g. it reported an
+    // LMP mismatch because a pipelined request overtook an earlier one), the
+    // requests after it were built on a wrong assumption. Start over from the
+    // queue's view of the peer, which this response just updated.
+    if (response.status().has_error() ||
+        response.status().last_received().index() < rpc->last_op_index) {
+      pipelined_next_index_ = 0;
+    }
   }
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
@@ -383,6 +477,29 @@ void Peer::DoProcessResponse() {
   }
 }
 
+Status Peer::MoveOpsToSidecar(UpdateRpc* rpc) {
+  using google::protobuf::internal::WireFormatLite;
+  static const uint32_t kOpsTag = WireFormatLite::MakeTag(
+      ConsensusRequestPB::kOpsFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  DCHECK_EQ(rpc->request.ops_size(), rpc->replicate_msg_refs.size());
+
+  unique_ptr<faststring> buf(new faststring);
+  for (const ReplicateRefPtr& msg : rpc->replicate_msg_refs) {
+    Slice encoded = msg->encoded();
+    PutVarint32(buf.get(), kOpsTag);
+    PutVarint32(buf.get(), encoded.size());
+    buf->append(encoded.data(), encoded.size());
+  }
+  int idx;
+  RETURN_NOT_OK(rpc->controller.AddOutboundSidecar(
+      rpc::RpcSidecar::FromFaststring(std::move(buf)), &idx));
+
+  // We don't own the ops (the queue does).
+  rpc->request.mutable_ops()->ExtractSubrange(0, rpc->request.ops_size(), nullptr);
+  rpc->request.set_ops_sidecar_idx(idx);
+  return Status::OK();
+}
+
 Status Peer::PrepareTabletCopyRequest() {
   if (!FLAGS_enable_tablet_copy) {
     failed_attempts_++;
@@ -400,11 +517,11 @@ void Peer::ProcessTabletCopyResponse() {
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
-  request_pending_ = false;
+  CHECK(tablet_copy_pending_);
+  tablet_copy_pending_ = false;
 
   // If the response is OK, or ALREADY_INPROGRESS, then consider the RPC successful.
-  const auto controller_status = controller_.status();
+  const auto controller_status = tc_controller_.status();
   bool success =
     controller_status.ok() &&
     (!tc_response_.has_error() ||
@@ -424,13 +541,13 @@ void Peer::ProcessTabletCopyResponse() {
   }
 }
 
-void Peer::ProcessResponseError(const Status& status) {
+void Peer::ProcessResponseError(const UpdateRpc& rpc, const Status& status) {
   failed_attempts_++;
   string resp_err_info;
-  if (response_.has_error()) {
+  if (rpc.response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(rpc.response.error().code()),
+                               rpc.response.error().code());
   }
   LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Couldn't send request to peer " << peer_pb_.permanent_uuid()
       << " for tablet " << tablet_id_ << "."
@@ -438,7 +555,10 @@ void Peer::ProcessResponseError(const Status& status) {
       << " Status: " << status.ToString() << "."
       << " Retrying in the next heartbeat period."
       << " Already tried " << failed_attempts_ << " times.";
-  request_pending_ = false;
+  num_inflight_updates_--;
+  // The requests still in flight are likely to fail too; once they have, the
+  // next request starts over from the queue's view of the peer.
+  pipelined_next_index_ = 0;
 }
 
 string Peer::LogPrefixUnlocked() const {
@@ -464,15 +584,177 @@ Peer::~Peer() {
   if (heartbeater_) {
     heartbeater_->Stop();
   }
+}
 
+Peer::UpdateRpc::~UpdateRpc() {
   // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+}
+
+// The MultiRaftUpdateConsensus RPC carrying a batch of heartbeats.
+struct MultiRaftHeartbeatBatcher::Batch {
+  MultiRaftConsensusRequestPB request;
+  MultiRaftConsensusResponsePB response;
+  RpcController controller;
+  vector<Heartbeat> heartbeats;
+};
+
+namespace {
+
+// The batchers in use, keyed by messenger and destination. Batchers are owned
+// by the RPC peer proxies using them, and go away along with the last one.
+struct BatcherRegistry {
+  simple_spinlock lock;
+  std::unordered_map<string, weak_ptr<MultiRaftHeartbeatBatcher>> batchers;
+};
+
+BatcherRegistry* GetBatcherRegistry() {
+  static BatcherRegistry* registry = new BatcherRegistry();
+  return registry;
+}
+
+Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger,
+                                          const HostPort& hostport,
+                                          gscoped_ptr<ConsensusServiceProxy>* new_proxy);
+
+} // anonymous namespace
+
+MultiRaftHeartbeatBatcher::MultiRaftHeartbeatBatcher(
+    shared_ptr<Messenger> messenger,
+    gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+    : messenger_(std::move(messenger)),
+      consensus_proxy_(std::move(consensus_proxy)) {
+}
+
+MultiRaftHeartbeatBatcher::~MultiRaftHeartbeatBatcher() {
+  // Every proxy which queued a heartbeat holds a reference to us until its
+  // callback is called, so nothing may be left pending.
+  DCHECK(pending_.empty());
+}
+
+Status MultiRaftHeartbeatBatcher::GetOrCreate(const shared_ptr<Messenger>& messenger,
+                                              const HostPort& hostport,
+                                              shared_ptr<MultiRaftHeartbeatBatcher>* batcher) {
+  const string key = Substitute("$0/$1", reinterpret_cast<uintptr_t>(messenger.get()),
+                                hostport.ToString());
+  BatcherRegistry* registry = GetBatcherRegistry();
+  std::lock_guard<simple_spinlock> l(registry->lock);
+  auto it = registry->batchers.find(key);
+  if (it != registry->batchers.end()) {
+    if (auto existing = it->second.lock()) {
+      *batcher = std::move(existing);
+      return Status::OK();
+    }
+  }
+  gscoped_ptr<ConsensusServiceProxy> proxy;
+  RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger, hostport, &proxy));
+  auto new_batcher = std::make_shared<MultiRaftHeartbeatBatcher>(messenger, std::move(proxy));
+  // Drop the entries of the batchers which went away meanwhile.
+  for (auto iter = registry->batchers.begin(); iter != registry->batchers.end();) {
+    if (iter->second.expired()) {
+      iter = registry->batchers.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  registry->batchers[key] = new_batcher;
+  *batcher = std::move(new_batcher);
+  return Status::OK();
+}
+
+void MultiRaftHeartbeatBatcher::AddHeartbeat(const ConsensusRequestPB* request,
+                                             ConsensusResponsePB* response,
+                                             StdStatusCallback callback) {
+  bool flush_now = false;
+  bool schedule_flush = false;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_.push_back({ request, response, std::move(callback) });
+    if (pending_.size() >= static_cast<size_t>(std::max(1, FLAGS_raft_heartbeat_batch_max_size))) {
+      flush_now = true;
+    } else if (!flush_scheduled_) {
+      flush_scheduled_ = true;
+      schedule_flush = true;
+    }
+  }
+  if (flush_now) {
+    Flush();
+  } else if (schedule_flush) {
+    // A heartbeat waiting in the batch keeps us alive until it is sent.
+    shared_ptr<MultiRaftHeartbeatBatcher> s_this = shared_from_this();
+    messenger_->ScheduleOnReactor([s_this](const Status& /*s*/) {
+                                    // Even if the reactor is shutting down, send
+                                    // the batch so that its heartbeats fail.
+                                    s_this->Flush();
+                                  },
+                                  MonoDelta::FromMilliseconds(
+                                      FLAGS_raft_heartbeat_batch_window_ms));
+  }
+}
+
+bool MultiRaftHeartbeatBatcher::supported() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return supported_;
+}
+
+void MultiRaftHeartbeatBatcher::Flush() {
+  shared_ptr<Batch> batch = std::make_shared<Batch>();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    flush_scheduled_ = false;
+    if (pending_.empty()) {
+      return;
+    }
+    batch->heartbeats.swap(pending_);
+  }
+  batch->request.mutable_consensus_requests()->Reserve(batch->heartbeats.size());
+  for (const auto& heartbeat : batch->heartbeats) {
+    *batch->request.add_consensus_requests() = *heartbeat.request;
+  }
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<MultiRaftHeartbeatBatcher> s_this = shared_from_this();
+  consensus_proxy_->MultiRaftUpdateConsensusAsync(batch->request, &batch->response,
+                                                  &batch->controller,
+                                                  [s_this, batch]() {
+                                                    s_this->ProcessResponse(batch);
+                                                  });
+}
+
+void MultiRaftHeartbeatBatcher::ProcessResponse(const shared_ptr<Batch>& batch) {
+  const int num_heartbeats = batch->heartbeats.size();
+  Status s = batch->controller.status();
+  if (PREDICT_FALSE(!s.ok())) {
+    const rpc::ErrorStatusPB* err = batch->controller.error_response();
+    if (err && err->has_code() && err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      // The destination runs a version without MultiRaftUpdateConsensus. The
+      // heartbeats of this batch are lost, the next ones are sent one by one.
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (supported_) {
+        LOG(INFO) << consensus_proxy_->ToString() << " doesn't support "
+                  << "batched heartbeats, sending them individually";
+      }
+      supported_ = false;
+    }
+  } else if (PREDICT_FALSE(batch->response.consensus_responses_size() != num_heartbeats)) {
+    s = Status::RemoteError(Substitute("expected $0 responses to batched heartbeats, got $1",
+                                       num_heartbeats,
+                                       batch->response.consensus_responses_size()));
+  }
+  for (int i = 0; i < num_heartbeats; i++) {
+    Heartbeat& heartbeat = batch->heartbeats[i];
+    if (s.ok()) {
+      heartbeat.response->Swap(batch->response.mutable_consensus_responses(i));
+    }
+    heartbeat.callback(s);
+  }
 }
 
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher)
     : hostport_(std::move(hostport)),
-      consensus_proxy_(std::move(consensus_proxy)) {
+      consensus_proxy_(std::move(consensus_proxy)),
+      heartbeat_batcher_(std::move(heartbeat_batcher)) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
@@ -497,6 +779,17 @@ void RpcPeerProxy::StartTabletCopy(const StartTabletCopyRequestPB* request,
   consensus_proxy_->StartTabletCopyAsync(*request, response, controller, callback);
 }
 
+bool RpcPeerProxy::SupportsBatchedHeartbeats() const {
+  return FLAGS_raft_batch_heartbeats && heartbeat_batcher_ && heartbeat_batcher_->supported();
+}
+
+void RpcPeerProxy::HeartbeatAsync(const ConsensusRequestPB* request,
+                                  ConsensusResponsePB* response,
+                                  const StdStatusCallback& callback) {
+  DCHECK(heartbeat_batcher_);
+  heartbeat_batcher_->AddHeartbeat(request, response, callback);
+}
+
 RpcPeerProxy::~RpcPeerProxy() {}
 
 namespace {
@@ -526,7 +819,9 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<MultiRaftHeartbeatBatcher> batcher;
+  RETURN_NOT_OK(MultiRaftHeartbeatBatcher::GetOrCreate(messenger_, *hostport, &batcher));
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy), std::move(batcher)));
   return Status::OK();
 }
 
@@ -28,13 +28,17 @@
 
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 class HostPort;
@@ -118,17 +122,51 @@ class Peer : public std::enable_shared_from_this<Peer> {
        gscoped_ptr<PeerProxy> proxy,
        std::shared_ptr<rpc::Messenger> messenger);
 
+  // An UpdateConsensus RPC sent to the peer, along with the buffers it uses.
+  // Up to --consensus_max_inflight_requests_per_peer of them may be in flight.
+  struct UpdateRpc {
+    ~UpdateRpc();
+
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+    rpc::RpcController controller;
+
+    // Reference-counted pointers to the ReplicateMsgs in 'request'. We may have
+    // loaded these messages from the LogCache, in which case we are potentially
+    // sharing the same object as other peers. Since the PB request itself can't
+    // hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+
+    // The index of the last op sent by 'request', or -1 if it has none. Kept
+    // apart since the ops may have moved to a sidecar.
+    int64_t last_op_index = -1;
+
+    // When 'request' was sent. A peer accepting it withholds its vote from
+    // other candidates for an election timeout counted from some later point,
+    // which is what leader leases are based on.
+    MonoTime send_time;
+
+    // Set if 'request' was sent as part of a batch of heartbeats, along with
+    // the status of the RPC which carried the batch. See --raft_batch_heartbeats.
+    bool batched = false;
+    Status batch_status;
+  };
+
+  // Moves the ops of 'rpc' into an outbound sidecar of its controller, built
+  // from the cached serialization of each op. See --consensus_encode_ops_once.
+  static Status MoveOpsToSidecar(UpdateRpc* rpc);
+
   void SendNextRequest(bool even_if_queue_empty);
 
-  // Signals that a response was received from the peer.
+  // Signals that a response was received from the peer for 'rpc'.
   //
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on raft_pool_token_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(const std::shared_ptr<UpdateRpc>& rpc);
 
   // Run on 'raft_pool_token'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  void DoProcessResponse(const std::shared_ptr<UpdateRpc>& rpc);
 
   // Fetch the desired tablet copy request from the queue and set up
   // tc_request_ appropriately.
@@ -140,8 +178,8 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending 'rpc' to the peer.
+  void ProcessResponseError(const UpdateRpc& rpc, const Status& status);
 
   std::string LogPrefixUnlocked() const;
 
@@ -157,21 +195,10 @@ class Peer : public std::enable_shared_from_this<Peer> {
   PeerMessageQueue* queue_;
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
-
   // The latest tablet copy request and response.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
-
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
-
-  rpc::RpcController controller_;
+  rpc::RpcController tc_controller_;
 
   std::shared_ptr<rpc::Messenger> messenger_;
 
@@ -185,10 +212,21 @@ class Peer : public std::enable_shared_from_this<Peer> {
 
   // lock that protects Peer state changes, initialization, etc.
   mutable simple_spinlock peer_lock_;
-  bool request_pending_ = false;
+  bool tablet_copy_pending_ = false;
   bool closed_ = false;
   bool has_sent_first_request_ = false;
 
+  // Number of UpdateConsensus RPCs in flight to the peer.
+  int num_inflight_updates_ = 0;
+
+  // The index following the last op sent to the peer by the requests in
+  // flight, or 0 if the next request should start from the queue's view of
+  // the peer. Reset whenever the peer did not take all the ops of a request.
+  int64_t pipelined_next_index_ = 0;
+
+  // The committed index of the last request built for the peer.
+  int64_t last_request_committed_index_ = kMinimumOpIdIndex;
+
 };
 
 // A proxy to another peer. Usually a thin wrapper around an rpc proxy but can
@@ -216,6 +254,20 @@ class PeerProxy {
     LOG(DFATAL) << "Not implemented";
   }
 
+  // Whether HeartbeatAsync() may be used.
+  virtual bool SupportsBatchedHeartbeats() const {
+    return false;
+  }
+
+  // Sends a request without ops asynchronously, possibly batched with the
+  // heartbeats of other tablets to the same server. 'callback' is called with
+  // the status of the RPC which carried it, once 'response' is filled in.
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              const StdStatusCallback& callback) {
+    LOG(DFATAL) << "Not implemented";
+  }
+
   virtual ~PeerProxy() {}
 };
 
@@ -232,11 +284,68 @@ class PeerProxyFactory {
   virtual const std::shared_ptr<rpc::Messenger>& messenger() const = 0;
 };
 
+// Coalesces the heartbeats sent by the tablets led by this server to the
+// same destination server into MultiRaftUpdateConsensus RPCs, so that idle
+// tablets don't each cost an RPC per heartbeat period. Heartbeats are held
+// for up to --raft_heartbeat_batch_window_ms before being sent.
+//
+// There is one batcher per messenger and destination, shared by the RPC peer
+// proxies to that destination.
+class MultiRaftHeartbeatBatcher :
+    public std::enable_shared_from_this<MultiRaftHeartbeatBatcher> {
+ public:
+  MultiRaftHeartbeatBatcher(std::shared_ptr<rpc::Messenger> messenger,
+                            gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+
+  ~MultiRaftHeartbeatBatcher();
+
+  // Returns the batcher for heartbeats sent through 'messenger' to the server
+  // at 'hostport', creating it if needed.
+  static Status GetOrCreate(const std::shared_ptr<rpc::Messenger>& messenger,
+                            const HostPort& hostport,
+                            std::shared_ptr<MultiRaftHeartbeatBatcher>* batcher);
+
+  // Queues 'request' to be sent with the next batch. See PeerProxy::HeartbeatAsync().
+  // 'request' and 'response' must remain valid until 'callback' is called.
+  void AddHeartbeat(const ConsensusRequestPB* request,
+                    ConsensusResponsePB* response,
+                    StdStatusCallback callback);
+
+  // Returns false once the destination responded that it doesn't support
+  // MultiRaftUpdateConsensus, in which case heartbeats should be sent one by one.
+  bool supported() const;
+
+ private:
+  struct Heartbeat {
+    const ConsensusRequestPB* request;
+    ConsensusResponsePB* response;
+    StdStatusCallback callback;
+  };
+  struct Batch;
+
+  // Sends the queued heartbeats, if any.
+  void Flush();
+
+  // Dispatches the responses of 'batch' to the callbacks of its heartbeats.
+  void ProcessResponse(const std::shared_ptr<Batch>& batch);
+
+  const std::shared_ptr<rpc::Messenger> messenger_;
+  const gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+
+  mutable simple_spinlock lock_;
+  std::vector<Heartbeat> pending_;
+  bool flush_scheduled_ = false;
+  bool supported_ = true;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiRaftHeartbeatBatcher);
+};
+
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher = nullptr);
 
   virtual void UpdateAsync(const ConsensusRequestPB* request,
                            ConsensusResponsePB* response,
@@ -253,11 +362,18 @@ class RpcPeerProxy : public PeerProxy {
                                     rpc::RpcController* controller,
                                     const rpc::ResponseCallback& callback) OVERRIDE;
 
+  virtual bool SupportsBatchedHeartbeats() const OVERRIDE;
+
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              const StdStatusCallback& callback) OVERRIDE;
+
   virtual ~RpcPeerProxy();
 
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
@@ -71,7 +71,27 @@ DEFINE_int32(consensus_inject_latency_ms_in_notifications, 0,
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, hidden);
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, unsafe);
 
+DEFINE_double(raft_leader_lease_fraction, 0.9,
+              "The fraction of the minimum election timeout a leader lease lasts "
+              "for, counted from when the request granting it was sent. Values "
+              "below 1.0 leave a margin for clock rate differences between servers. "
+              "Only relevant with --raft_enable_leader_leases.");
+TAG_FLAG(raft_leader_lease_fraction, advanced);
+TAG_FLAG(raft_leader_lease_fraction, experimental);
+
+DEFINE_bool(raft_tablet_copy_followers_behind_log_gc, false,
+            "Whether the leader catches up the followers which have fallen behind "
+            "its garbage collected logs with a tablet copy, rather than considering "
+            "them failed irrecoverably. The copy reuses the blocks of the follower "
+            "identical to those of the leader, so it usually transfers only the "
+            "data written since the follower fell behind.");
+TAG_FLAG(raft_tablet_copy_followers_behind_log_gc, experimental);
+TAG_FLAG(raft_tablet_copy_followers_behind_log_gc, runtime);
+
 DECLARE_int32(consensus_rpc_timeout_ms);
+DECLARE_int32(raft_heartbeat_interval_ms);
+DECLARE_double(leader_failure_max_missed_heartbeat_periods);
+DECLARE_bool(raft_enable_leader_leases);
 DECLARE_bool(safe_time_advancement_without_writes);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_bool(raft_attempt_to_replace_replica_without_majority);
@@ -124,6 +144,7 @@ PeerMessageQueue::TrackedPeer::TrackedPeer(RaftPeerPB peer_pb)
       last_exchange_status(PeerStatus::NEW),
       last_communication_time(MonoTime::Now()),
       wal_catchup_possible(true),
+      lease_granted_at(MonoTime::Min()),
       last_overall_health_status(HealthReportPB::UNKNOWN),
       status_log_throttler(std::make_shared<logging::LogThrottler>()),
       last_seen_term_(0) {
@@ -205,11 +226,18 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
 
   // Reset last communication time with all peers to reset the clock on the
   // failure timeout.
+  // Also forget leases granted before, so that the lease of this term only
+  // counts requests sent in it.
   const auto now = MonoTime::Now();
   for (const PeersMap::value_type& entry : peers_map_) {
     entry.second->last_communication_time = now;
+    entry.second->lease_granted_at = MonoTime::Min();
   }
   time_manager_->SetLeaderMode();
+  if (FLAGS_raft_enable_leader_leases) {
+    // A single-voter config holds the lease right away.
+    time_manager_->UpdateLeaderLease(LeaderLeaseExpirationUnlocked());
+  }
 }
 
 void PeerMessageQueue::SetNonLeaderMode(const RaftConfigPB& active_config) {
@@ -296,6 +324,20 @@ void PeerMessageQueue::TrackLocalPeerUnlocked() {
   TrackPeerUnlocked(*local_peer_in_config);
 }
 
+string PeerMessageQueue::GetCaughtUpVoter() const {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  for (const auto& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (peer->uuid() != local_peer_pb_.permanent_uuid() &&
+        peer->peer_pb.member_type() == RaftPeerPB::VOTER &&
+        peer->last_exchange_status == PeerStatus::OK &&
+        peer->last_received.index() >= queue_state_.last_appended.index()) {
+      return peer->uuid();
+    }
+  }
+  return "";
+}
+
 unordered_map<string, HealthReportPB> PeerMessageQueue::ReportHealthOfPeers() const {
   unordered_map<string, HealthReportPB> reports;
   std::lock_guard<simple_spinlock> lock(queue_lock_);
@@ -574,8 +616,8 @@ void PeerMessageQueue::UpdatePeerHealthUnlocked(TrackedPeer* peer) {
 HealthReportPB::HealthStatus PeerMessageQueue::PeerHealthStatus(const TrackedPeer& peer) {
   // Replicas that have fallen behind the leader's retained WAL segments are
   // failed irrecoverably and will not come back because they cannot ever catch
-  // up with the leader replica.
-  if (!peer.wal_catchup_possible) {
+  // up with the leader replica, unless they're caught up with a tablet copy.
+  if (!peer.wal_catchup_possible && !FLAGS_raft_tablet_copy_followers_behind_log_gc) {
     return HealthReportPB::FAILED_UNRECOVERABLE;
   }
 
@@ -594,6 +636,11 @@ HealthReportPB::HealthStatus PeerMessageQueue::PeerHealthStatus(const TrackedPee
     return HealthReportPB::FAILED;
   }
 
+  // Replicas being caught up with a tablet copy aren't healthy yet.
+  if (!peer.wal_catchup_possible) {
+    return HealthReportPB::UNKNOWN;
+  }
+
   // The happy case: replicas returned OK during the recent exchange are considered healthy.
   if (peer.last_exchange_status == PeerStatus::OK) {
     return HealthReportPB::HEALTHY;
@@ -609,7 +656,8 @@ HealthReportPB::HealthStatus PeerMessageQueue::PeerHealthStatus(const TrackedPee
 Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         ConsensusRequestPB* request,
                                         vector<ReplicateRefPtr>* msg_refs,
-                                        bool* needs_tablet_copy) {
+                                        bool* needs_tablet_copy,
+                                        int64_t pipelined_next_index) {
   // Maintain a thread-safe copy of necessary members.
   OpId preceding_id;
   int64_t current_term;
@@ -658,7 +706,8 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       UpdatePeerHealthUnlocked(peer);
     });
 
-  if (peer_copy.last_exchange_status == PeerStatus::TABLET_NOT_FOUND) {
+  if (peer_copy.last_exchange_status == PeerStatus::TABLET_NOT_FOUND ||
+      (!peer_copy.wal_catchup_possible && FLAGS_raft_tablet_copy_followers_behind_log_gc)) {
     VLOG(3) << LogPrefixUnlocked() << "Peer " << uuid << " needs tablet copy" << THROTTLE_MSG;
     *needs_tablet_copy = true;
     return Status::OK();
@@ -674,8 +723,10 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     vector<ReplicateRefPtr> messages;
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
-    // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer_copy.next_index - 1,
+    // We try to get the follower's next_index from our log, or the index
+    // following the requests already in flight to it.
+    int64_t next_index = std::max(peer_copy.next_index, pipelined_next_index);
+    Status s = log_cache_.ReadOps(next_index - 1,
                                   max_batch_size,
                                   &messages,
                                   &preceding_id);
@@ -764,6 +815,7 @@ Status PeerMessageQueue::GetTabletCopyRequestForPeer(const string& uuid,
                                                      StartTabletCopyRequestPB* req) {
   TrackedPeer* peer = nullptr;
   int64_t current_term;
+  int num_healthy_voters = 0;
   {
     std::lock_guard<simple_spinlock> lock(queue_lock_);
     DCHECK_EQ(queue_state_.state, kQueueOpen);
@@ -773,9 +825,21 @@ Status PeerMessageQueue::GetTabletCopyRequestForPeer(const string& uuid,
     if (PREDICT_FALSE(peer == nullptr || queue_state_.mode == NON_LEADER)) {
       return Status::NotFound("Peer not tracked or queue not in leader mode.");
     }
-    if (PREDICT_FALSE(peer->last_exchange_status != PeerStatus::TABLET_NOT_FOUND)) {
+    if (PREDICT_FALSE(peer->last_exchange_status != PeerStatus::TABLET_NOT_FOUND &&
+                      (peer->wal_catchup_possible ||
+                       !FLAGS_raft_tablet_copy_followers_behind_log_gc))) {
       return Status::IllegalState("Peer does not need to initiate Tablet Copy", uuid);
     }
+    // Let the destination prioritize the copies of the tablets closest to
+    // losing their majority.
+    for (const auto& entry : peers_map_) {
+      const TrackedPeer* p = entry.second;
+      if (p->peer_pb.member_type() == RaftPeerPB::VOTER &&
+          (entry.first == local_peer_pb_.permanent_uuid() ||
+           p->last_overall_health_status == HealthReportPB::HEALTHY)) {
+        num_healthy_voters++;
+      }
+    }
   }
   req->Clear();
   req->set_dest_uuid(uuid);
@@ -783,6 +847,7 @@ Status PeerMessageQueue::GetTabletCopyRequestForPeer(const string& uuid,
   req->set_copy_peer_uuid(local_peer_pb_.permanent_uuid());
   *req->mutable_copy_peer_addr() = local_peer_pb_.last_known_addr();
   req->set_caller_term(current_term);
+  req->set_num_healthy_voters(num_healthy_voters);
   return Status::OK();
 }
 
@@ -934,6 +999,13 @@ void PeerMessageQueue::UpdatePeerStatus(const string& peer_uuid,
 
     case PeerStatus::OK:
       DCHECK(status.ok());
+      // Only a started tablet copy is reported this way. If the peer had
+      // fallen behind our logs, the copy catches it up: find out where it's
+      // at with a status-only request, as with a new peer.
+      if (!peer->wal_catchup_possible) {
+        peer->wal_catchup_possible = true;
+        peer->last_exchange_status = PeerStatus::NEW;
+      }
       break;
   }
 }
@@ -1026,7 +1098,8 @@ void PeerMessageQueue::PromoteIfNeeded(TrackedPeer* peer, const TrackedPeer& pre
 
 void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
                                         const ConsensusResponsePB& response,
-                                        bool* more_pending) {
+                                        bool* more_pending,
+                                        MonoTime request_send_time) {
   DCHECK(response.IsInitialized()) << "Error: Uninitialized: "
       << response.InitializationErrorString() << ". Response: " << SecureShortDebugString(response);
   CHECK(!response.has_error());
@@ -1133,6 +1206,15 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     // is just pending behind the lock we're holding), but any future leader will observe
     // the same watermarks and make the same advancement, so this is safe.
     if (mode_copy == LEADER) {
+      // The peer accepted our request, so it withholds its vote from other
+      // candidates for an election timeout counted from some point after it
+      // was sent. That may extend our lease.
+      if (FLAGS_raft_enable_leader_leases && request_send_time.Initialized() &&
+          request_send_time > peer->lease_granted_at) {
+        peer->lease_granted_at = request_send_time;
+        time_manager_->UpdateLeaderLease(LeaderLeaseExpirationUnlocked());
+      }
+
       // Advance the majority replicated index.
       AdvanceQueueWatermark("majority_replicated",
                             &queue_state_.majority_replicated_index,
@@ -1339,6 +1421,45 @@ Status PeerMessageQueue::UnRegisterObserver(PeerMessageQueueObserver* observer)
   return Status::OK();
 }
 
+MonoTime PeerMessageQueue::LeaderLeaseExpiration() const {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  return LeaderLeaseExpirationUnlocked();
+}
+
+MonoTime PeerMessageQueue::LeaderLeaseExpirationUnlocked() const {
+  DCHECK(queue_lock_.is_locked());
+  if (queue_state_.mode != LEADER || queue_state_.majority_size_ <= 0) {
+    return MonoTime::Min();
+  }
+  // The lease lasts as long as a majority of the voters, counting ourselves,
+  // withhold their votes: i.e. it starts with the majority_size_-th most
+  // recent grant.
+  vector<MonoTime> grants;
+  grants.reserve(peers_map_.size());
+  for (const PeersMap::value_type& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (peer->peer_pb.member_type() != RaftPeerPB::VOTER) {
+      continue;
+    }
+    grants.push_back(peer->uuid() == local_peer_pb_.permanent_uuid() ?
+                     MonoTime::Max() : peer->lease_granted_at);
+  }
+  const size_t majority = queue_state_.majority_size_;
+  if (grants.size() < majority) {
+    return MonoTime::Min();
+  }
+  std::nth_element(grants.begin(), grants.begin() + majority - 1, grants.end(),
+                   std::greater<MonoTime>());
+  const MonoTime& start = grants[majority - 1];
+  if (start == MonoTime::Min() || start == MonoTime::Max()) {
+    return start;
+  }
+  return start + MonoDelta::FromMilliseconds(
+      FLAGS_raft_heartbeat_interval_ms *
+      FLAGS_leader_failure_max_missed_heartbeat_periods *
+      FLAGS_raft_leader_lease_fraction);
+}
+
 bool PeerMessageQueue::IsOpInLog(const OpId& desired_op) const {
   OpId log_op;
   Status s = log_cache_.LookupOpId(desired_op.index(), &log_op);
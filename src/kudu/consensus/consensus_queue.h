@@ -168,6 +168,11 @@ class PeerMessageQueue {
     // the local peer's WAL.
     bool wal_catchup_possible;
 
+    // When the latest request this peer accepted from us as leader was sent.
+    // Having accepted it, the peer won't vote for another candidate for at
+    // least a minimum election timeout after that. MonoTime::Min() if none.
+    MonoTime lease_granted_at;
+
     // The peer's latest overall health status.
     HealthReportPB::HealthStatus last_overall_health_status;
 
@@ -221,6 +226,11 @@ class PeerMessageQueue {
   // Returns IllegalState if the local peer is not the leader of the config.
   std::unordered_map<std::string, HealthReportPB> ReportHealthOfPeers() const;
 
+  // Returns the UUID of a voter other than the local peer which acked every
+  // operation appended to the queue in its last successful exchange, or an
+  // empty string if there is none.
+  std::string GetCaughtUpVoter() const;
+
   // Appends a single message to be replicated to the peers.
   // Returns OK unless the message could not be added to the queue for some
   // reason (e.g. the queue reached max size).
@@ -268,10 +278,16 @@ class PeerMessageQueue {
   // instance of ConsensusRequestPB to RequestForPeer(): the buffer will
   // replace the old entries with new ones without de-allocating the old
   // ones if they are still required.
+  //
+  // If 'pipelined_next_index' is beyond the peer's next index, the ops are
+  // read starting at 'pipelined_next_index' instead. This is used to build a
+  // request which is pipelined behind other requests still in flight to the
+  // peer, which carry the ops before it.
   Status RequestForPeer(const std::string& uuid,
                         ConsensusRequestPB* request,
                         std::vector<ReplicateRefPtr>* msg_refs,
-                        bool* needs_tablet_copy);
+                        bool* needs_tablet_copy,
+                        int64_t pipelined_next_index = 0);
 
   // Fill in a StartTabletCopyRequest for the specified peer.
   // If that peer should not initiate Tablet Copy, returns a non-OK status.
@@ -288,10 +304,18 @@ class PeerMessageQueue {
                         const Status& status);
 
   // Updates the request queue with the latest response of a peer, returns
-  // whether this peer has more requests pending.
+  // whether this peer has more requests pending. 'request_send_time', if
+  // initialized, is when the request being responded to was sent, and is
+  // used to extend the leader lease.
   void ResponseFromPeer(const std::string& peer_uuid,
                         const ConsensusResponsePB& response,
-                        bool* more_pending);
+                        bool* more_pending,
+                        MonoTime request_send_time = MonoTime());
+
+  // Returns when the leader lease backed by the latest responses of a
+  // majority of the voters expires, or MonoTime::Min() if there is no such
+  // lease or the queue is not in leader mode. See --raft_enable_leader_leases.
+  MonoTime LeaderLeaseExpiration() const;
 
   // Called by the consensus implementation to update the queue's watermarks
   // based on information provided by the leader. This is used for metrics and
@@ -444,6 +468,9 @@ class PeerMessageQueue {
   // notifications.
   void UpdatePeerHealthUnlocked(TrackedPeer* peer);
 
+  // Unlocked implementation of LeaderLeaseExpiration().
+  MonoTime LeaderLeaseExpirationUnlocked() const;
+
   // Update the peer's last exchange status, and other fields, based on the
   // response.
   void UpdateExchangeStatus(TrackedPeer* peer, const TrackedPeer& prev_peer_state,
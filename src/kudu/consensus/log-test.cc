@@ -44,6 +44,7 @@
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/move.h"
@@ -54,6 +55,8 @@
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -65,6 +68,8 @@ DEFINE_int32(num_batches, 10000,
 
 DECLARE_int32(log_min_segments_to_retain);
 DECLARE_int32(log_max_segments_to_retain);
+DECLARE_int32(log_max_recycled_segments);
+DECLARE_int32(log_shared_append_threads);
 DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
@@ -82,6 +87,8 @@ using consensus::MakeOpId;
 using consensus::NO_OP;
 using consensus::OpId;
 using consensus::ReplicateMsg;
+using consensus::ReplicateRefPtr;
+using consensus::make_scoped_refptr_replicate;
 using consensus::WRITE_OP;
 using strings::Substitute;
 
@@ -178,7 +185,8 @@ class LogTestOptionalCompression : public LogTest,
     FLAGS_log_compression_codec = name;
   }
 };
-INSTANTIATE_TEST_CASE_P(Codecs, LogTestOptionalCompression, ::testing::Values(NO_COMPRESSION, LZ4));
+INSTANTIATE_TEST_CASE_P(Codecs, LogTestOptionalCompression,
+                        ::testing::Values(NO_COMPRESSION, LZ4, ZSTD));
 
 // If we write more than one entry in a batch, we should be able to
 // read all of those entries back.
@@ -777,6 +785,44 @@ TEST_P(LogTestOptionalCompression, TestWriteManyBatches) {
 // seg002: 0.10 through 0.19
 // seg003: 0.20 through 0.29
 // seg004: 0.30 through 0.39
+// Tests that replicates whose serialization is already cached are written to
+// the log the same way as the others.
+TEST_P(LogTestOptionalCompression, TestAppendPreEncodedReplicates) {
+  ASSERT_OK(BuildLog());
+  vector<ReplicateRefPtr> replicates;
+  for (int i = 0; i < 3; i++) {
+    ReplicateRefPtr replicate = make_scoped_refptr_replicate(new ReplicateMsg());
+    replicate->get()->set_op_type(NO_OP);
+    replicate->get()->mutable_id()->CopyFrom(MakeOpId(1, kStartIndex + i));
+    replicate->get()->set_timestamp(clock_->Now().ToUint64());
+    replicate->get()->mutable_noop_request();
+    // Only the second replicate of the first batch is encoded, so that batch
+    // is serialized as a whole; the replicate of the second batch is encoded
+    // too, so that batch is assembled from its cached serialization.
+    if (i != 0) {
+      ASSERT_FALSE(replicate->encoded().empty());
+    }
+    replicates.emplace_back(std::move(replicate));
+  }
+  Synchronizer s;
+  ASSERT_OK(log_->AsyncAppendReplicates({ replicates[0], replicates[1] },
+                                        s.AsStatusCallback()));
+  ASSERT_OK(s.Wait());
+  s.Reset();
+  ASSERT_OK(log_->AsyncAppendReplicates({ replicates[2] }, s.AsStatusCallback()));
+  ASSERT_OK(s.Wait());
+
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  ASSERT_OK(segments[0]->ReadEntries(&entries_));
+  ASSERT_EQ(3, entries_.size());
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(REPLICATE, entries_[i]->type());
+    ASSERT_EQ(pb_util::SecureShortDebugString(*replicates[i]->get()),
+              pb_util::SecureShortDebugString(entries_[i]->replicate()));
+  }
+}
+
 TEST_P(LogTestOptionalCompression, TestLogReader) {
   LogReader reader(env_,
                    scoped_refptr<LogIndex>(),
@@ -1129,6 +1175,9 @@ TEST_F(LogTest, TestDiskSpaceCheck) {
 
 // Test that the append thread shuts itself down after it's idle.
 TEST_F(LogTest, TestAutoStopIdleAppendThread) {
+  // Tasks on the shared append pool go idle as soon as the queue is drained,
+  // so this needs a log with its own append thread.
+  FLAGS_log_shared_append_threads = 0;
   ASSERT_OK(BuildLog());
   OpId opid = MakeOpId(1, 1);
 
@@ -1146,6 +1195,71 @@ TEST_F(LogTest, TestAutoStopIdleAppendThread) {
     });
 }
 
+// Test that a log whose appends run on the shared append pool writes and
+// syncs its entries, and that its task gives the pool thread back once the
+// queue is drained.
+TEST_F(LogTest, TestSharedAppendPool) {
+  FLAGS_log_shared_append_threads = 2;
+  ASSERT_OK(BuildLog());
+  AppendReplicateBatchAndCommitEntryPairsToLog(2, APPEND_ASYNC);
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_FALSE(log_->append_thread_active_for_tests());
+    });
+
+  OpId opid = MakeOpId(1, current_index_);
+  AppendNoOpsToLogSync(clock_, log_.get(), &opid, 2);
+  shared_ptr<LogReader> reader = log_->reader();
+  ASSERT_OK(log_->Close());
+
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  ASSERT_OK(segments[0]->ReadEntries(&entries_));
+  ASSERT_EQ(6, entries_.size());
+}
+
+// Test that the files of GCed segments are reused for new segments, and that
+// the entries written to them are read back without stale ones.
+TEST_F(LogTest, TestRecycleSegments) {
+  FLAGS_log_min_segments_to_retain = 1;
+  FLAGS_log_max_recycled_segments = 2;
+  ASSERT_OK(BuildLog());
+  const int kNumOpsPerSegment = 5;
+  const string log_dir = JoinPathSegments(fs_manager_->GetWalsRootDir(), kTestTablet);
+  auto count_recycled_files = [&]() {
+    vector<string> files;
+    CHECK_OK(env_->GetChildren(log_dir, &files));
+    int count = 0;
+    for (const string& file : files) {
+      count += file.find(".recycled.") != string::npos;
+    }
+    return count;
+  };
+
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendMultiSegmentSequence(5, kNumOpsPerSegment, &op_id, nullptr));
+  int num_gced_segments;
+  ASSERT_OK(log_->GC(RetentionIndexes(op_id.index()), &num_gced_segments));
+  ASSERT_GT(num_gced_segments, 2);
+  ASSERT_EQ(2, count_recycled_files());
+
+  // Rolling over to new segments reuses the recycled files.
+  ASSERT_OK(AppendMultiSegmentSequence(3, kNumOpsPerSegment, &op_id, nullptr));
+  ASSERT_EQ(0, count_recycled_files());
+
+  shared_ptr<LogReader> reader = log_->reader();
+  ASSERT_OK(log_->Close());
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  ASSERT_GE(segments.size(), 3);
+  for (int i = segments.size() - 3; i < segments.size(); i++) {
+    vector<LogEntryPB*> entries;
+    ElementDeleter deleter(&entries);
+    ASSERT_OK(segments[i]->ReadEntries(&entries));
+    ASSERT_EQ(kNumOpsPerSegment, entries.size()) << DumpSegmentsToString(segments);
+  }
+}
+
 // Test that Log::TotalSize() captures creation, addition, and deletion of log segments.
 TEST_P(LogTestOptionalCompression, TestTotalSize) {
   // Build a log. There is an active segment, so on-disk size should be positive.
@@ -26,6 +26,7 @@
 
 #include <boost/range/adaptor/reversed.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/log_index.h"
@@ -40,8 +41,10 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/debug/trace_event.h"
@@ -84,13 +87,37 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_int32(log_group_commit_target_latency_us, 0,
+             "Target latency, in microseconds, of a log group commit, including "
+             "the time spent waiting for more entries to join the group. When "
+             "the previous group was made of several batches, the log append "
+             "thread waits until as many batches have arrived, as long as the "
+             "expected append and sync time of the group still fits within this "
+             "target. Entries appended to an idle log are never delayed. "
+             "If 0, groups are committed as soon as the append thread wakes up.");
+TAG_FLAG(log_group_commit_target_latency_us, advanced);
+TAG_FLAG(log_group_commit_target_latency_us, experimental);
+TAG_FLAG(log_group_commit_target_latency_us, runtime);
+
 
 DEFINE_int32(log_thread_idle_threshold_ms, 1000,
              "Number of milliseconds after which the log append thread decides that a "
-             "log is idle, and considers shutting down. Used by tests.");
+             "log is idle, and considers shutting down. Only applies to logs with their "
+             "own append thread; see --log_shared_append_threads. Used by tests.");
 TAG_FLAG(log_thread_idle_threshold_ms, experimental);
 TAG_FLAG(log_thread_idle_threshold_ms, hidden);
 
+DEFINE_int32(log_shared_append_threads, -1,
+             "The appends of all the WALs of this process run on a single shared "
+             "pool with at most this many threads, instead of each WAL starting "
+             "and stopping its own append thread. An append task goes idle as "
+             "soon as its queue is drained, so a server hosting many replicas "
+             "keeps a bounded, warm set of WAL threads. If -1, the pool has as "
+             "many threads as there are CPU cores. If 0, each WAL has its own "
+             "append thread.");
+TAG_FLAG(log_shared_append_threads, advanced);
+TAG_FLAG(log_shared_append_threads, experimental);
+
 // Compression configuration.
 // -----------------------------
 DEFINE_string(log_compression_codec, "LZ4",
@@ -142,6 +169,15 @@ DEFINE_double(log_inject_io_error_on_preallocate_fraction, 0.0,
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, unsafe);
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, runtime);
 
+DEFINE_int32(log_max_recycled_segments, 2,
+             "Maximum number of GCed segments of each tablet's log whose files "
+             "are kept to be reused as new segments, rather than deleted. Reusing "
+             "a file saves creating and preallocating a new one when rolling "
+             "over to a new segment. Only applies if --log_preallocate_segments "
+             "is set. 0 disables the reuse of segment files.");
+TAG_FLAG(log_max_recycled_segments, advanced);
+TAG_FLAG(log_max_recycled_segments, runtime);
+
 DEFINE_int64(fs_wal_dir_reserved_bytes, -1,
              "Number of bytes to reserve on the log directory filesystem for "
              "non-Kudu usage. The default, which is represented by -1, is that "
@@ -178,13 +214,35 @@ using std::vector;
 using std::unique_ptr;
 using strings::Substitute;
 
+namespace {
+
+// Returns the process-wide pool used by the append threads of all logs unless
+// --log_shared_append_threads is 0. The pool is created on first use and lives
+// until the process exits.
+ThreadPool* SharedAppendPool() {
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("wal-append-shared")
+             .set_min_threads(0)
+             .set_max_threads(FLAGS_log_shared_append_threads > 0 ?
+                              FLAGS_log_shared_append_threads : base::NumCPUs())
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+} // anonymous namespace
+
 // Manages the thread which drains groups of batches from the log's queue and
 // appends them to the underlying log instance.
 //
-// Rather than being a long-running thread, this instead uses a threadpool with
-// size 1 to automatically start and stop a thread on demand. When the log
-// is idle for some amount of time, no task will be on the thread pool, and thus
-// the underlying thread may exit.
+// Rather than being a long-running thread, this instead submits its work as
+// tasks, by default through a serial token on a process-wide pool shared by
+// all logs, so that the number of WAL threads doesn't grow with the number of
+// replicas. With --log_shared_append_threads=0, each log has its own
+// threadpool of size 1 instead. When the log is idle for some amount of time,
+// no task will be on the thread pool, and thus the underlying thread may exit.
 //
 // The design of submitting tasks to the threadpool is slightly tricky in order
 // to achieve group commit and not have to submit one task per appended batch.
@@ -233,6 +291,11 @@ class Log::AppendThread {
   // a new task was enqueued just as we were trying to go idle.
   bool GoIdle();
 
+  // If --log_group_commit_target_latency_us allows it, waits for more batches
+  // to join 'entry_batches' before the group is committed. See the flag's
+  // description for the policy.
+  void MaybeWaitForMoreBatches(vector<LogEntryBatch*>* entry_batches);
+
   // Handle the actual appending of a group of entries. Responsible for deleting the
   // LogEntryBatch* pointers.
   void HandleGroup(vector<LogEntryBatch*> entry_batches);
@@ -251,9 +314,19 @@ class Log::AppendThread {
   };
   Atomic32 worker_state_ = WORKER_STOPPED;
 
+  // Number of batches in the last committed group, and a moving average of
+  // the time spent appending and syncing a group, in microseconds. Only
+  // accessed by the worker task.
+  size_t last_group_size_ = 0;
+  double group_commit_us_avg_ = 0;
+
   // Pool with a single thread, which handles shutting down the thread
-  // when idle.
+  // when idle. Unset when the log uses the shared append pool.
   gscoped_ptr<ThreadPool> append_pool_;
+
+  // Serial token on SharedAppendPool(), set instead of 'append_pool_' unless
+  // --log_shared_append_threads is 0 at Init() time.
+  std::unique_ptr<ThreadPoolToken> append_token_;
 };
 
 
@@ -262,7 +335,12 @@ Log::AppendThread::AppendThread(Log *log)
 }
 
 Status Log::AppendThread::Init() {
-  DCHECK(!append_pool_) << "Already initialized";
+  DCHECK(!append_pool_ && !append_token_) << "Already initialized";
+  if (FLAGS_log_shared_append_threads != 0) {
+    VLOG_WITH_PREFIX(1) << "Using the shared log append pool";
+    append_token_ = SharedAppendPool()->NewToken(ThreadPool::ExecutionMode::SERIAL);
+    return Status::OK();
+  }
   VLOG_WITH_PREFIX(1) << "Starting log append thread";
   RETURN_NOT_OK(ThreadPoolBuilder("wal-append")
                 .set_min_threads(0)
@@ -277,11 +355,16 @@ Status Log::AppendThread::Init() {
 }
 
 void Log::AppendThread::Wake() {
-  DCHECK(append_pool_);
+  DCHECK(append_pool_ || append_token_);
   auto old_status = base::subtle::NoBarrier_CompareAndSwap(
       &worker_state_, WORKER_STOPPED, WORKER_ACTIVE);
   if (old_status == WORKER_STOPPED) {
-    CHECK_OK(append_pool_->SubmitClosure(Bind(&Log::AppendThread::DoWork, Unretained(this))));
+    Closure task = Bind(&Log::AppendThread::DoWork, Unretained(this));
+    if (append_token_) {
+      CHECK_OK(append_token_->SubmitClosure(std::move(task)));
+    } else {
+      CHECK_OK(append_pool_->SubmitClosure(std::move(task)));
+    }
   }
 }
 
@@ -328,9 +411,14 @@ bool Log::AppendThread::GoIdle() {
 void Log::AppendThread::DoWork() {
   DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(worker_state_), WORKER_ACTIVE);
   VLOG_WITH_PREFIX(2) << "WAL Appender going active";
+  // A task on the shared pool must not hold one of its threads while waiting
+  // for more work: other logs may be waiting for it. So it goes idle as soon
+  // as the queue is empty, and the next Wake() resubmits it.
+  const MonoDelta idle_threshold = append_token_ ?
+      MonoDelta::FromMilliseconds(0) :
+      MonoDelta::FromMilliseconds(FLAGS_log_thread_idle_threshold_ms);
   while (true) {
-    MonoTime deadline = MonoTime::Now() +
-        MonoDelta::FromMilliseconds(FLAGS_log_thread_idle_threshold_ms);
+    MonoTime deadline = MonoTime::Now() + idle_threshold;
     vector<LogEntryBatch*> entry_batches;
     Status s = log_->entry_queue()->BlockingDrainTo(&entry_batches, deadline);
     if (PREDICT_FALSE(s.IsAborted())) {
@@ -339,11 +427,42 @@ void Log::AppendThread::DoWork() {
       if (GoIdle()) break;
       continue;
     }
+    MaybeWaitForMoreBatches(&entry_batches);
+    last_group_size_ = entry_batches.size();
+    MonoTime group_start = MonoTime::Now();
     HandleGroup(std::move(entry_batches));
+    double group_us = (MonoTime::Now() - group_start).ToMicroseconds();
+    group_commit_us_avg_ = group_commit_us_avg_ == 0 ?
+        group_us : 0.8 * group_commit_us_avg_ + 0.2 * group_us;
   }
   VLOG_WITH_PREFIX(2) << "WAL Appender going idle";
 }
 
+void Log::AppendThread::MaybeWaitForMoreBatches(vector<LogEntryBatch*>* entry_batches) {
+  const int32_t target_us = FLAGS_log_group_commit_target_latency_us;
+  if (target_us <= 0 || entry_batches->size() >= last_group_size_) {
+    return;
+  }
+  const int64_t budget_us = target_us - static_cast<int64_t>(group_commit_us_avg_);
+  if (budget_us <= 0) {
+    return;
+  }
+  MonoTime start = MonoTime::Now();
+  MonoTime deadline = start + MonoDelta::FromMicroseconds(budget_us);
+  while (entry_batches->size() < last_group_size_) {
+    // BlockingDrainTo() appends to 'entry_batches'. It returns TimedOut once
+    // the deadline passes, or Aborted if the log is shutting down; the batches
+    // gathered so far are committed either way.
+    if (!log_->entry_queue()->BlockingDrainTo(entry_batches, deadline).ok()) {
+      break;
+    }
+  }
+  if (log_->metrics_) {
+    log_->metrics_->group_commit_delay->Increment(
+        (MonoTime::Now() - start).ToMicroseconds());
+  }
+}
+
 void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
   if (log_->metrics_) {
     log_->metrics_->entry_batches_per_group->Increment(entry_batches.size());
@@ -402,6 +521,10 @@ void Log::AppendThread::HandleGroup(vector<LogEntryBatch*> entry_batches) {
 
 void Log::AppendThread::Shutdown() {
   log_->entry_queue()->Shutdown();
+  if (append_token_) {
+    append_token_->Wait();
+    append_token_->Shutdown();
+  }
   if (append_pool_) {
     append_pool_->Wait();
     append_pool_->Shutdown();
@@ -574,10 +697,14 @@ Status Log::RollOver() {
 
 Status Log::CreateBatchFromPB(LogEntryTypePB type,
                               unique_ptr<LogEntryBatchPB> entry_batch_pb,
-                              unique_ptr<LogEntryBatch>* entry_batch) {
+                              unique_ptr<LogEntryBatch>* entry_batch,
+                              const vector<ReplicateRefPtr>& replicates) {
   int num_ops = entry_batch_pb->entry_size();
   unique_ptr<LogEntryBatch> new_entry_batch(new LogEntryBatch(
       type, std::move(entry_batch_pb), num_ops));
+  if (!replicates.empty()) {
+    new_entry_batch->SetReplicates(replicates);
+  }
   new_entry_batch->Serialize();
   TRACE("Serialized $0 byte log entry", new_entry_batch->total_size_bytes());
 
@@ -604,8 +731,7 @@ Status Log::AsyncAppendReplicates(const vector<ReplicateRefPtr>& replicates,
   unique_ptr<LogEntryBatchPB> batch_pb = CreateBatchFromAllocatedOperations(replicates);
 
   unique_ptr<LogEntryBatch> batch;
-  RETURN_NOT_OK(CreateBatchFromPB(REPLICATE, std::move(batch_pb), &batch));
-  batch->SetReplicates(replicates);
+  RETURN_NOT_OK(CreateBatchFromPB(REPLICATE, std::move(batch_pb), &batch, replicates));
   return AsyncAppend(std::move(batch), callback);
 }
 
@@ -843,9 +969,10 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
           segments_to_delete[segments_to_delete.size() - 1]->header().sequence_number()));
     }
 
-    // Now that they are no longer referenced by the Log, delete the files.
+    // Now that they are no longer referenced by the Log, recycle or delete
+    // the files.
     *num_gced = 0;
-    for (const scoped_refptr<ReadableLogSegment>& segment : segments_to_delete) {
+    for (scoped_refptr<ReadableLogSegment>& segment : segments_to_delete) {
       string ops_str;
       if (segment->HasFooter() && segment->footer().has_min_replicate_index()) {
         DCHECK(segment->footer().has_max_replicate_index());
@@ -853,8 +980,13 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
                              segment->footer().min_replicate_index(),
                              segment->footer().max_replicate_index());
       }
-      LOG_WITH_PREFIX(INFO) << "Deleting log segment in path: " << segment->path() << ops_str;
-      RETURN_NOT_OK(fs_manager_->env()->DeleteFile(segment->path()));
+      const string path = segment->path();
+      if (RecycleSegment(std::move(segment))) {
+        LOG_WITH_PREFIX(INFO) << "Recycled log segment in path: " << path << ops_str;
+      } else {
+        LOG_WITH_PREFIX(INFO) << "Deleting log segment in path: " << path << ops_str;
+        RETURN_NOT_OK(fs_manager_->env()->DeleteFile(path));
+      }
       (*num_gced)++;
     }
 
@@ -952,6 +1084,16 @@ Status Log::Close() {
       log_index_.reset();
       reader_.reset();
 
+      // The recycled segment files would only be reused by this log.
+      {
+        std::lock_guard<simple_spinlock> recycled_l(recycled_segments_lock_);
+        for (const auto& path : recycled_segment_paths_) {
+          WARN_NOT_OK(fs_manager_->env()->DeleteFile(path),
+                      Substitute("$0Could not delete recycled log segment", LogPrefix()));
+        }
+        recycled_segment_paths_.clear();
+      }
+
       if (log_hooks_) {
         RETURN_NOT_OK_PREPEND(log_hooks_->PostClose(),
                               "PostClose hook failed");
@@ -997,12 +1139,30 @@ Status Log::PreAllocateNewSegment() {
 
   WritableFileOptions opts;
   opts.sync_on_close = force_sync_all_;
-  RETURN_NOT_OK(CreatePlaceholderSegment(opts, &next_segment_path_, &next_segment_file_));
+  string recycled_path;
+  if (options_.preallocate_segments) {
+    std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+    if (!recycled_segment_paths_.empty()) {
+      recycled_path = std::move(recycled_segment_paths_.back());
+      recycled_segment_paths_.pop_back();
+    }
+  }
+  if (!recycled_path.empty()) {
+    // The recycled file is empty, and its space is already allocated.
+    TRACE("Reusing recycled segment $0", recycled_path);
+    opts.mode = Env::OPEN_EXISTING;
+    unique_ptr<WritableFile> segment_file;
+    RETURN_NOT_OK(fs_manager_->env()->NewWritableFile(opts, recycled_path, &segment_file));
+    next_segment_path_ = std::move(recycled_path);
+    next_segment_file_.reset(segment_file.release());
+  } else {
+    RETURN_NOT_OK(CreatePlaceholderSegment(opts, &next_segment_path_, &next_segment_file_));
+  }
 
   MAYBE_RETURN_FAILURE(FLAGS_log_inject_io_error_on_preallocate_fraction,
                        Status::IOError("Injected IOError in Log::PreAllocateNewSegment()"));
 
-  if (options_.preallocate_segments) {
+  if (options_.preallocate_segments && opts.mode != Env::OPEN_EXISTING) {
     TRACE("Preallocating $0 byte segment in $1", max_segment_size_, next_segment_path_);
     RETURN_NOT_OK(env_util::VerifySufficientDiskSpace(fs_manager_->env(),
                                                       next_segment_path_,
@@ -1016,6 +1176,56 @@ Status Log::PreAllocateNewSegment() {
   return Status::OK();
 }
 
+bool Log::RecycleSegment(scoped_refptr<ReadableLogSegment> segment) {
+  if (!options_.preallocate_segments) {
+    return false;
+  }
+  {
+    std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+    if (static_cast<int>(recycled_segment_paths_.size()) >= FLAGS_log_max_recycled_segments) {
+      return false;
+    }
+  }
+  // A reader may still be reading the segment, in which case it must keep
+  // its contents.
+  if (!segment->HasOneRef()) {
+    return false;
+  }
+  const string path = segment->path();
+  const string recycled_path = JoinPathSegments(
+      log_dir_, Substitute("$0.recycled.$1", kTmpInfix, segment->header().sequence_number()));
+  segment.reset();
+
+  // The file is emptied, and its space allocated again past its end, so that
+  // it can be reused as if it were a new preallocated segment. Appending to it
+  // then leaves no stale entries past the end of the new ones.
+  TRACE_EVENT1("log", "RecycleSegment", "file", path);
+  Env* env = fs_manager_->env();
+  RWFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING;
+  unique_ptr<RWFile> file;
+  Status s = env->NewRWFile(opts, path, &file);
+  if (s.ok()) {
+    s = file->Truncate(0);
+  }
+  if (s.ok()) {
+    s = file->PreAllocate(0, max_segment_size_, RWFile::DONT_CHANGE_FILE_SIZE);
+  }
+  if (s.ok()) {
+    s = file->Close();
+  }
+  if (s.ok()) {
+    s = env->RenameFile(path, recycled_path);
+  }
+  if (!s.ok()) {
+    WARN_NOT_OK(s, Substitute("$0Could not recycle log segment $1", LogPrefix(), path));
+    return false;
+  }
+  std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+  recycled_segment_paths_.push_back(recycled_path);
+  return true;
+}
+
 Status Log::SwitchToAllocatedSegment() {
   CHECK_EQ(allocation_state(), kAllocationFinished);
 
@@ -1156,7 +1366,38 @@ void LogEntryBatch::Serialize() {
     return;
   }
   buffer_.reserve(total_size_bytes_);
-  pb_util::AppendToString(*entry_batch_pb_, &buffer_);
+
+  bool all_encoded = type_ == REPLICATE && !replicates_.empty();
+  for (const ReplicateRefPtr& replicate : replicates_) {
+    all_encoded &= replicate->has_encoded();
+  }
+  if (!all_encoded) {
+    pb_util::AppendToString(*entry_batch_pb_, &buffer_);
+    return;
+  }
+
+  // Lay out each LogEntryPB the way protobuf would serialize it: the 'type'
+  // field followed by the 'replicate' field, whose bytes are already encoded.
+  using google::protobuf::internal::WireFormatLite;
+  static const uint32_t kEntryTag = WireFormatLite::MakeTag(
+      LogEntryBatchPB::kEntryFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  static const uint32_t kTypeTag = WireFormatLite::MakeTag(
+      LogEntryPB::kTypeFieldNumber, WireFormatLite::WIRETYPE_VARINT);
+  static const uint32_t kReplicateTag = WireFormatLite::MakeTag(
+      LogEntryPB::kReplicateFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  faststring entry_header;
+  for (const ReplicateRefPtr& replicate : replicates_) {
+    Slice encoded = replicate->encoded();
+    entry_header.clear();
+    PutVarint32(&entry_header, kTypeTag);
+    PutVarint32(&entry_header, REPLICATE);
+    PutVarint32(&entry_header, kReplicateTag);
+    PutVarint32(&entry_header, encoded.size());
+    PutVarint32(&buffer_, kEntryTag);
+    PutVarint32(&buffer_, entry_header.size() + encoded.size());
+    buffer_.append(entry_header.data(), entry_header.size());
+    buffer_.append(encoded.data(), encoded.size());
+  }
 }
 
 
@@ -269,9 +269,14 @@ class Log : public RefCountedThreadSafe<Log> {
   // Make segments roll over.
   Status RollOver();
 
-  static Status CreateBatchFromPB(LogEntryTypePB type,
-                                  std::unique_ptr<LogEntryBatchPB> entry_batch_pb,
-                                  std::unique_ptr<LogEntryBatch>* entry_batch);
+  // Creates and serializes a batch holding the entries of 'entry_batch_pb'.
+  // For a REPLICATE batch, 'replicates' are the refcounted messages of those
+  // entries; their cached serialization is reused if they have one.
+  static Status CreateBatchFromPB(
+      LogEntryTypePB type,
+      std::unique_ptr<LogEntryBatchPB> entry_batch_pb,
+      std::unique_ptr<LogEntryBatch>* entry_batch,
+      const std::vector<consensus::ReplicateRefPtr>& replicates = {});
 
   // Asynchronously appends 'entry_batch' to the log. Once the append
   // completes and is synced, 'callback' will be invoked.
@@ -293,9 +298,15 @@ class Log : public RefCountedThreadSafe<Log> {
   // disk as the header, and sets active_segment_ to point to this new segment.
   Status SwitchToAllocatedSegment();
 
-  // Preallocates the space for a new segment.
+  // Preallocates the space for a new segment, reusing a recycled segment
+  // file if there is one.
   Status PreAllocateNewSegment();
 
+  // Keeps the file of the GCed segment 'segment' for reuse as a new segment,
+  // if fewer than --log_max_recycled_segments are kept already. Returns false
+  // if the file should be deleted instead.
+  bool RecycleSegment(scoped_refptr<ReadableLogSegment> segment);
+
   // Writes serialized contents of 'entry' to the log. Called inside
   // AppenderThread.
   Status DoAppend(LogEntryBatch* entry_batch);
@@ -357,6 +368,11 @@ class Log : public RefCountedThreadSafe<Log> {
   // The path for the next allocated segment.
   std::string next_segment_path_;
 
+  // The paths of the files of GCed segments which were truncated and
+  // preallocated again, to be reused for new segments.
+  simple_spinlock recycled_segments_lock_;
+  std::vector<std::string> recycled_segment_paths_;
+
   // Lock to protect mutations to log_state_ and other shared state variables.
   mutable percpu_rwlock state_lock_;
 
@@ -462,6 +478,10 @@ class LogEntryBatch {
                 size_t count);
 
   // Serializes contents of the entry to an internal buffer.
+  //
+  // If every replicate of a REPLICATE batch already has its serialization
+  // cached (see RefCountedReplicate::encoded()), the buffer is assembled
+  // from those rather than by serializing the messages again.
   void Serialize();
 
   // Sets the callback that will be invoked after the entry is
@@ -19,6 +19,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <thread>
@@ -46,6 +47,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -62,6 +64,7 @@ using strings::Substitute;
 
 DECLARE_int32(log_cache_size_limit_mb);
 DECLARE_int32(global_log_cache_size_limit_mb);
+DECLARE_int64(log_cache_readahead_bytes);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -127,6 +130,11 @@ class LogCacheTest : public KuduTest {
     return Status::OK();
   }
 
+  int64_t ReadAheadBytes() const {
+    std::lock_guard<simple_spinlock> l(cache_->lock_);
+    return cache_->readahead_bytes_;
+  }
+
   const Schema schema_;
   MetricRegistry metric_registry_;
   scoped_refptr<MetricEntity> metric_entity_;
@@ -202,6 +210,44 @@ TEST_F(LogCacheTest, TestAlwaysYieldsAtLeastOneMessage) {
   ASSERT_EQ(1, messages.size());
 }
 
+// Tests that ops which are no longer cached are read ahead from disk after a
+// follower's first read, and that the follower then gets the same ops as if
+// they were read synchronously.
+TEST_F(LogCacheTest, TestReadAhead) {
+  FLAGS_log_cache_readahead_bytes = 10 * 1024 * 1024;
+  CloseAndReopenCache(MinimumOpId());
+
+  const int kNumOps = 100;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, kNumOps));
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(kNumOps);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+
+  // The first read goes to disk and starts reading ahead the following ops.
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 1, &messages, &preceding));
+  ASSERT_EQ(1, messages.size());
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_GT(ReadAheadBytes(), 0);
+  });
+
+  // Read the rest an op at a time, as a slow follower would.
+  for (int64_t index = 2; index <= kNumOps; index++) {
+    SCOPED_TRACE(index);
+    messages.clear();
+    ASSERT_OK(cache_->ReadOps(index - 1, 1, &messages, &preceding));
+    ASSERT_EQ(1, messages.size());
+    ASSERT_EQ(index, messages[0]->get()->id().index());
+    ASSERT_EQ(index - 1, preceding.index());
+  }
+
+  // Once the ops are replicated everywhere, the read-ahead ops are dropped.
+  cache_->EvictThroughOp(kNumOps);
+  ASSERT_EQ(0, ReadAheadBytes());
+  ASSERT_EQ(0, cache_->BytesUsed());
+}
+
 // Tests that the cache returns Status::NotFound() if queried for messages after an
 // index that is higher than it's latest, returns an empty set of messages when queried for
 // the the last index and returns all messages when queried for MinimumOpId().
@@ -314,6 +360,50 @@ TEST_F(LogCacheTest, TestGlobalMemoryLimit) {
   ASSERT_LE(cache_->BytesUsed(), 1024 * 1024);
 }
 
+// Test that, when the global limit is reached, ops are evicted from the caches
+// which were read from least recently, even if they belong to other tablets.
+TEST_F(LogCacheTest, TestGlobalEvictionPrefersColdCaches) {
+  cache_.reset();
+  FLAGS_global_log_cache_size_limit_mb = 4;
+  CloseAndReopenCache(MinimumOpId());
+
+  // Another tablet's cache, which is never read from.
+  scoped_refptr<log::Log> cold_log;
+  ASSERT_OK(log::Log::Open(log::LogOptions(), fs_manager_.get(), "cold-tablet",
+                           schema_, 0, nullptr, &cold_log));
+  LogCache cold_cache(metric_entity_, cold_log.get(), kPeerUuid, "cold-tablet");
+  cold_cache.Init(MinimumOpId());
+
+  const int kPayloadSize = 768 * 1024;
+  for (int64_t index = 1; index <= 2; index++) {
+    vector<ReplicateRefPtr> msgs;
+    msgs.push_back(make_scoped_refptr_replicate(
+        CreateDummyReplicate(0, index, clock_->Now(), kPayloadSize).release()));
+    ASSERT_OK(cold_cache.AppendOperations(msgs, Bind(&FatalOnError)));
+  }
+  cold_log->WaitUntilAllFlushed();
+  ASSERT_EQ(2, cold_cache.num_cached_ops());
+
+  // Append an op to this tablet's cache and read it back, as if to send it to
+  // a follower.
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 8 * 1024 * 1024, &messages, &preceding));
+  messages.clear();
+
+  // Leave room for less than one more op: appending another op to this
+  // tablet's cache must evict from the cold cache rather than from this one.
+  ScopedTrackedConsumption consumption(cache_->parent_tracker_, 1536 * 1024);
+  ASSERT_OK(AppendReplicateMessagesToCache(2, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+
+  ASSERT_EQ(2, cache_->num_cached_ops());
+  ASSERT_EQ(1, cold_cache.num_cached_ops());
+  ASSERT_OK(cold_log->Close());
+}
+
 // Test that the log cache properly replaces messages when an index
 // is reused. This is a regression test for a bug where the memtracker's
 // consumption wasn't properly managed when messages were replaced.
@@ -17,9 +17,12 @@
 
 #include "kudu/consensus/log_cache.h"
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <ostream>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -37,6 +40,7 @@
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/strings/human_readable.h"
@@ -46,7 +50,11 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/throttler.h"
 
 DEFINE_int32(log_cache_size_limit_mb, 128,
              "The total per-tablet size of consensus entries which may be kept in memory. "
@@ -60,7 +68,50 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_bool(log_cache_evict_across_tablets, true,
+            "If true, when appending ops to a tablet's log cache would exceed "
+            "'global_log_cache_size_limit_mb', ops are first evicted from the log "
+            "caches of all tablets, starting with those which were read from "
+            "least recently, rather than only from the appending tablet's cache.");
+TAG_FLAG(log_cache_evict_across_tablets, advanced);
+TAG_FLAG(log_cache_evict_across_tablets, runtime);
+
+DEFINE_bool(consensus_encode_ops_once, false,
+            "If true, each op appended to the log cache is serialized once, and "
+            "that serialization is reused to write the op to the WAL and to send "
+            "it to every follower: UpdateConsensus requests then carry their ops "
+            "in an RPC sidecar. The serialized ops count against the log cache "
+            "memory limits. Every tablet server of the cluster must be able to "
+            "read ops from sidecars before this is enabled.");
+TAG_FLAG(consensus_encode_ops_once, advanced);
+TAG_FLAG(consensus_encode_ops_once, experimental);
+TAG_FLAG(consensus_encode_ops_once, runtime);
+
+DEFINE_int64(log_cache_readahead_bytes, 0,
+             "If positive, when ops which are no longer in the log cache are read "
+             "from the WAL to catch up a lagging follower, up to this many bytes "
+             "of the ops which follow them are read ahead asynchronously on a "
+             "separate thread pool. The read-ahead ops count against the log "
+             "cache memory limits. 0 disables read-ahead.");
+TAG_FLAG(log_cache_readahead_bytes, advanced);
+TAG_FLAG(log_cache_readahead_bytes, experimental);
+
+DEFINE_int32(log_cache_readahead_threads, 4,
+             "The number of threads, shared by all tablets, used to read ahead "
+             "ops from the WAL when --log_cache_readahead_bytes is positive.");
+TAG_FLAG(log_cache_readahead_threads, advanced);
+TAG_FLAG(log_cache_readahead_threads, experimental);
+
+DEFINE_int64(log_cache_readahead_bytes_per_sec, 64 * 1024 * 1024,
+             "The maximum rate, in bytes per second and shared by all tablets, "
+             "at which ops are read ahead from the WAL for lagging followers. "
+             "Reads done synchronously to serve a follower's request are not "
+             "limited. 0 means no limit.");
+TAG_FLAG(log_cache_readahead_bytes_per_sec, advanced);
+TAG_FLAG(log_cache_readahead_bytes_per_sec, experimental);
+
 using kudu::pb_util::SecureShortDebugString;
+using std::pair;
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -79,6 +130,53 @@ static const char kParentMemTrackerId[] = "log_cache";
 
 typedef vector<const ReplicateMsg*>::const_iterator MsgIter;
 
+namespace {
+
+// The most a single read-ahead task reads from disk, and so the granularity
+// at which read-ahead is rate-limited.
+const int64_t kReadAheadSliceBytes = 1024 * 1024;
+
+// Returns the process-wide pool on which ops are read ahead from the WAL.
+// The pool is created on first use and lives until the process exits.
+ThreadPool* ReadAheadPool() {
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("log-cache-readahead")
+             .set_min_threads(0)
+             .set_max_threads(FLAGS_log_cache_readahead_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+// The log caches of the server, for evictions across tablets. A cache's lock
+// may be taken while holding 'lock', but not the other way around.
+struct LogCacheRegistry {
+  Mutex lock;
+  std::set<LogCache*> caches;
+};
+
+LogCacheRegistry* Registry() {
+  static LogCacheRegistry* registry = new LogCacheRegistry();
+  return registry;
+}
+
+// Returns the process-wide throttler for read-ahead IO.
+Throttler* ReadAheadThrottler() {
+  static Throttler* throttler = []() {
+    const int64_t rate = FLAGS_log_cache_readahead_bytes_per_sec;
+    // The burst must allow a whole slice to be taken at once.
+    const double refills_per_slice = rate > 0 ?
+        static_cast<double>(kReadAheadSliceBytes) * MonoTime::kMicrosecondsPerSecond /
+        (rate * Throttler::kRefillPeriodMicros) : 1;
+    return new Throttler(MonoTime::Now(), 0, rate, std::max(1.0, refills_per_slice));
+  }();
+  return throttler;
+}
+
+} // anonymous namespace
+
 LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
                    const scoped_refptr<log::Log>& log,
                    const string& local_uuid,
@@ -88,6 +186,10 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
     tablet_id_(tablet_id),
     next_sequential_op_index_(0),
     min_pinned_op_index_(0),
+    last_read_time_(MonoTime::Now()),
+    readahead_bytes_(0),
+    readahead_in_flight_from_(-1),
+    readahead_epoch_(0),
     metrics_(metric_entity) {
 
 
@@ -110,9 +212,26 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   auto zero_op = new ReplicateMsg();
   *zero_op->mutable_id() = MinimumOpId();
   InsertOrDie(&cache_, 0, { make_scoped_refptr_replicate(zero_op), zero_op->SpaceUsed() });
+
+  if (FLAGS_log_cache_readahead_bytes > 0) {
+    readahead_token_ = ReadAheadPool()->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  }
+
+  LogCacheRegistry* registry = Registry();
+  std::lock_guard<Mutex> l(registry->lock);
+  InsertOrDie(&registry->caches, this);
 }
 
 LogCache::~LogCache() {
+  {
+    LogCacheRegistry* registry = Registry();
+    std::lock_guard<Mutex> l(registry->lock);
+    CHECK_EQ(1, registry->caches.erase(this));
+  }
+  if (readahead_token_) {
+    // Waits for an in-flight read-ahead, which refers to this cache.
+    readahead_token_->Shutdown();
+  }
   tracker_->Release(tracker_->consumption());
   cache_.clear();
 }
@@ -145,6 +264,11 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
     }
   }
   next_sequential_op_index_ = index + 1;
+
+  // Ops read ahead past the truncation point are no longer valid, and neither
+  // would be those of a read-ahead which is in flight.
+  DropReadAheadUnlocked(first_to_truncate, MathLimits<int64_t>::kMax);
+  readahead_epoch_++;
 }
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
@@ -156,8 +280,13 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   int64_t mem_required = 0;
   vector<CacheEntry> entries_to_insert;
   entries_to_insert.reserve(msgs.size());
+  const bool encode_ops = FLAGS_consensus_encode_ops_once;
   for (const auto& msg : msgs) {
-    CacheEntry e = { msg, static_cast<int64_t>(msg->get()->SpaceUsedLong()) };
+    int64_t mem_usage = msg->get()->SpaceUsedLong();
+    if (encode_ops) {
+      mem_usage += msg->encoded().size();
+    }
+    CacheEntry e = { msg, mem_usage };
     mem_required += e.mem_usage;
     entries_to_insert.emplace_back(std::move(e));
   }
@@ -165,6 +294,15 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   int64_t first_idx_in_batch = msgs.front()->get()->id().index();
   int64_t last_idx_in_batch = msgs.back()->get()->id().index();
 
+  // If the server-wide limit would be exceeded, first make room by evicting
+  // the ops which are least likely to be read, whichever tablets they're from.
+  if (FLAGS_log_cache_evict_across_tablets) {
+    const int64_t global_spare = parent_tracker_->SpareCapacity();
+    if (global_spare < mem_required) {
+      EvictFromColdestCaches(mem_required - global_spare);
+    }
+  }
+
   std::unique_lock<simple_spinlock> l(lock_);
   // If we're not appending a consecutive op we're likely overwriting and
   // need to replace operations in the cache.
@@ -183,14 +321,14 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
                         << HumanReadableNumBytes::ToString(spare)
                         << "): attempting to evict some operations...";
 
-    // TODO: we should also try to evict from other tablets - probably better to
-    // evict really old ops from another tablet than evict recent ops from this one.
+    // Ops were already evicted from the caches of other tablets above, if the
+    // global limit was the one to be exceeded.
     EvictSomeUnlocked(min_pinned_op_index_, need_to_free);
 
     // Force consuming, so that we don't refuse appending data. We might
     // blow past our limit a little bit (as much as the number of tablets times
-    // the amount of in-flight data in the log), but until implementing the above TODO,
-    // it's difficult to solve this issue.
+    // the amount of in-flight data in the log), since ops which aren't yet in
+    // the log can't be evicted.
     tracker_->Consume(mem_required);
 
     borrowed_memory = parent_tracker_->LimitExceeded();
@@ -300,6 +438,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
   RETURN_NOT_OK(LookupOpId(after_op_index, preceding_op));
 
   std::unique_lock<simple_spinlock> l(lock_);
+  last_read_time_ = MonoTime::Now();
   int64_t next_index = after_op_index + 1;
 
   // Return as many operations as we can, up to the limit
@@ -319,6 +458,22 @@ Status LogCache::ReadOps(int64_t after_op_index,
         up_to = iter->first - 1;
       }
 
+      if (readahead_token_) {
+        // Serve what we can from ops which were read ahead. If the read-ahead
+        // of the next op is in flight, wait for it rather than reading the
+        // same ops from disk twice.
+        if (ConsumeReadAheadUnlocked(up_to, &next_index, &remaining_space, messages)) {
+          MaybeScheduleReadAheadUnlocked(next_index, up_to);
+          continue;
+        }
+        if (readahead_in_flight_from_ == next_index) {
+          l.unlock();
+          readahead_token_->Wait();
+          l.lock();
+          continue;
+        }
+      }
+
       l.unlock();
 
       vector<ReplicateMsg*> raw_replicate_ptrs;
@@ -343,6 +498,9 @@ Status LogCache::ReadOps(int64_t after_op_index,
           delete msg;
         }
       }
+      if (readahead_token_) {
+        MaybeScheduleReadAheadUnlocked(next_index, up_to);
+      }
 
     } else {
       // Pull contiguous messages from the cache until the size limit is achieved.
@@ -366,14 +524,144 @@ Status LogCache::ReadOps(int64_t after_op_index,
   return Status::OK();
 }
 
+bool LogCache::ConsumeReadAheadUnlocked(int64_t up_to,
+                                        int64_t* next_index,
+                                        int64_t* remaining_space,
+                                        vector<ReplicateRefPtr>* messages) {
+  DCHECK(lock_.is_locked());
+  bool consumed = false;
+  for (auto iter = readahead_.find(*next_index);
+       iter != readahead_.end() && iter->first == *next_index && *next_index <= up_to;
+       ++iter) {
+    const ReplicateRefPtr& msg = iter->second.msg;
+    *remaining_space -= TotalByteSizeForMessage(*msg->get());
+    if (*remaining_space < 0 && !messages->empty()) {
+      // The batch is full, which also counts as progress.
+      return true;
+    }
+    messages->push_back(msg);
+    (*next_index)++;
+    consumed = true;
+  }
+  return consumed;
+}
+
+void LogCache::MaybeScheduleReadAheadUnlocked(int64_t next_index, int64_t up_to) {
+  DCHECK(lock_.is_locked());
+  if (readahead_in_flight_from_ != -1) {
+    return;
+  }
+
+  // The buffer follows the follower which is being caught up; ops behind it
+  // won't be asked for again.
+  DropReadAheadUnlocked(0, next_index - 1);
+
+  // Read from the end of the run of ops which are already buffered.
+  int64_t from = next_index;
+  for (auto iter = readahead_.begin();
+       iter != readahead_.end() && iter->first == from;
+       ++iter) {
+    from++;
+  }
+  if (from > up_to || readahead_bytes_ >= FLAGS_log_cache_readahead_bytes) {
+    return;
+  }
+
+  readahead_in_flight_from_ = from;
+  Status s = readahead_token_->SubmitClosure(Bind(&LogCache::ReadAheadTask, Unretained(this),
+                                                  from, up_to, readahead_epoch_));
+  if (PREDICT_FALSE(!s.ok())) {
+    VLOG_WITH_PREFIX_UNLOCKED(1) << "Unable to schedule read-ahead: " << s.ToString();
+    readahead_in_flight_from_ = -1;
+  }
+}
+
+void LogCache::ReadAheadTask(int64_t from, int64_t up_to, int64_t epoch) {
+  // Don't saturate the WAL disk with read-ahead on behalf of lagging followers.
+  Throttler* throttler = ReadAheadThrottler();
+  while (!throttler->Take(MonoTime::Now(), 0, kReadAheadSliceBytes)) {
+    SleepFor(MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros));
+  }
+
+  // Read, and decompress, outside of the lock. If anything goes wrong, the
+  // ops are read synchronously instead, which surfaces the error.
+  vector<ReplicateMsg*> raw_replicate_ptrs;
+  std::shared_ptr<log::LogReader> reader = log_->reader();
+  Status s = reader ? reader->ReadReplicatesInRange(
+      from, up_to, kReadAheadSliceBytes, &raw_replicate_ptrs) :
+      Status::IllegalState("log is closed");
+  vector<ReadAheadEntry> entries;
+  entries.reserve(raw_replicate_ptrs.size());
+  for (ReplicateMsg* msg : raw_replicate_ptrs) {
+    entries.push_back({ make_scoped_refptr_replicate(msg), msg->SpaceUsedLong() });
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  readahead_in_flight_from_ = -1;
+  if (!s.ok()) {
+    VLOG_WITH_PREFIX_UNLOCKED(1) << Substitute("Failed to read ahead ops $0..$1: $2",
+                                               from, up_to, s.ToString());
+    return;
+  }
+  if (epoch != readahead_epoch_) {
+    return;
+  }
+  int64_t bytes_read = 0;
+  for (auto& e : entries) {
+    int64_t mem_usage = e.mem_usage;
+    if (EmplaceIfNotPresent(&readahead_, e.msg->get()->id().index(), std::move(e))) {
+      bytes_read += mem_usage;
+    }
+  }
+  tracker_->Consume(bytes_read);
+  readahead_bytes_ += bytes_read;
+  VLOG_WITH_PREFIX_UNLOCKED(2) << "Read ahead " << entries.size() << " ops from disk ("
+                               << from << ".." << (from + entries.size() - 1) << ")";
+}
+
+void LogCache::DropReadAheadUnlocked(int64_t from, int64_t to) {
+  DCHECK(lock_.is_locked());
+  auto iter = readahead_.lower_bound(from);
+  int64_t bytes_dropped = 0;
+  while (iter != readahead_.end() && iter->first <= to) {
+    bytes_dropped += iter->second.mem_usage;
+    iter = readahead_.erase(iter);
+  }
+  tracker_->Release(bytes_dropped);
+  readahead_bytes_ -= bytes_dropped;
+}
 
 void LogCache::EvictThroughOp(int64_t index) {
   std::lock_guard<simple_spinlock> lock(lock_);
 
   EvictSomeUnlocked(index, MathLimits<int64_t>::kMax);
+  DropReadAheadUnlocked(0, index);
+}
+
+void LogCache::EvictFromColdestCaches(int64_t bytes_to_evict) {
+  LogCacheRegistry* registry = Registry();
+  std::lock_guard<Mutex> l(registry->lock);
+  vector<pair<MonoTime, LogCache*>> caches;
+  caches.reserve(registry->caches.size());
+  for (LogCache* cache : registry->caches) {
+    std::lock_guard<simple_spinlock> cache_l(cache->lock_);
+    caches.emplace_back(cache->last_read_time_, cache);
+  }
+  std::sort(caches.begin(), caches.end(),
+            [](const pair<MonoTime, LogCache*>& a, const pair<MonoTime, LogCache*>& b) {
+              return a.first < b.first;
+            });
+  for (const auto& e : caches) {
+    if (bytes_to_evict <= 0) {
+      break;
+    }
+    LogCache* cache = e.second;
+    std::lock_guard<simple_spinlock> cache_l(cache->lock_);
+    bytes_to_evict -= cache->EvictSomeUnlocked(cache->min_pinned_op_index_, bytes_to_evict);
+  }
 }
 
-void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict) {
+int64_t LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict) {
   DCHECK(lock_.is_locked());
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting log cache index <= "
                       << stop_after_index
@@ -413,6 +701,7 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
     }
   }
   VLOG_WITH_PREFIX_UNLOCKED(1) << "Evicting log cache: after state: " << ToStringUnlocked();
+  return bytes_evicted;
 }
 
 void LogCache::AccountForMessageRemovalUnlocked(const LogCache::CacheEntry& entry) {
@@ -31,12 +31,14 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 
 namespace kudu {
 
 class MemTracker;
+class ThreadPoolToken;
 
 namespace log {
 class Log;
@@ -82,6 +84,10 @@ class LogCache {
   // If the ops being requested are not available in the log, this will synchronously
   // read these ops from disk. Therefore, this function may take a substantial amount
   // of time and should not be called with important locks held, etc.
+  //
+  // If --log_cache_readahead_bytes is positive, reading ops from disk also starts
+  // an asynchronous read of the ops which follow them, so that the next call for
+  // the same follower is likely served from memory.
   Status ReadOps(int64_t after_op_index,
                  int max_size_bytes,
                  std::vector<ReplicateRefPtr>* messages,
@@ -152,15 +158,54 @@ class LogCache {
   // An entry in the cache.
   struct CacheEntry {
     ReplicateRefPtr msg;
-    // The cached value of msg->SpaceUsedLong(). This method is expensive
-    // to compute, so we compute it only once upon insertion.
+    // The cached value of msg->SpaceUsedLong(), plus the size of the cached
+    // serialization of 'msg' if it was encoded on insertion. SpaceUsedLong()
+    // is expensive to compute, so we compute it only once upon insertion.
+    int64_t mem_usage;
+  };
+
+  // An op which was read ahead from disk on behalf of a lagging follower.
+  struct ReadAheadEntry {
+    ReplicateRefPtr msg;
+    // The cached value of msg->SpaceUsedLong().
     int64_t mem_usage;
   };
 
+  // Append the read-ahead ops with consecutive indexes starting at '*next_index'
+  // and no higher than 'up_to' to 'messages', while they fit in
+  // '*remaining_space'. Advances '*next_index' and '*remaining_space'
+  // accordingly. Returns false if no op was available to append.
+  bool ConsumeReadAheadUnlocked(int64_t up_to,
+                                int64_t* next_index,
+                                int64_t* remaining_space,
+                                std::vector<ReplicateRefPtr>* messages);
+
+  // Start reading ahead the ops after 'next_index', up to 'up_to', unless a
+  // read-ahead is already in flight or enough ops are already buffered.
+  // Buffered ops below 'next_index' are dropped.
+  void MaybeScheduleReadAheadUnlocked(int64_t next_index, int64_t up_to);
+
+  // Read ops starting at 'from', up to 'up_to', from disk into 'readahead_'.
+  // Runs on 'readahead_token_'. 'epoch' is the value of 'readahead_epoch_'
+  // when the read was scheduled; the ops are dropped if it has changed.
+  void ReadAheadTask(int64_t from, int64_t up_to, int64_t epoch);
+
+  // Drop the read-ahead ops with indexes in ['from', 'to'].
+  void DropReadAheadUnlocked(int64_t from, int64_t to);
+
   // Try to evict the oldest operations from the queue, stopping either when
   // 'bytes_to_evict' bytes have been evicted, or the op with index
-  // 'stop_after_index' has been evicted, whichever comes first.
-  void EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict);
+  // 'stop_after_index' has been evicted, whichever comes first. Returns the
+  // number of bytes evicted.
+  int64_t EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict);
+
+  // Evicts about 'bytes_to_evict' bytes of ops from the log caches of the
+  // server, starting with the caches which were read from least recently.
+  // Ops stay cached for the followers which haven't received them, so a cache
+  // which isn't being read holds ops which its followers aren't catching up
+  // on, e.g. because they're down. Must not be called with the lock of any
+  // cache held.
+  static void EvictFromColdestCaches(int64_t bytes_to_evict);
 
   // Update metrics and MemTracker to account for the removal of the
   // given message.
@@ -205,6 +250,27 @@ class LogCache {
   // Protected by lock_.
   int64_t min_pinned_op_index_;
 
+  // The last time ops were read from the cache. Protected by lock_.
+  MonoTime last_read_time_;
+
+  // Token on the shared read-ahead pool, set if --log_cache_readahead_bytes
+  // was positive when the cache was created.
+  std::unique_ptr<ThreadPoolToken> readahead_token_;
+
+  // Ops read ahead from disk which aren't in 'cache_', keyed by log index.
+  // They count against 'tracker_' but not against the cache metrics.
+  // Protected by lock_.
+  std::map<int64_t, ReadAheadEntry> readahead_;
+  int64_t readahead_bytes_;
+
+  // The first index read by the in-flight read-ahead, or -1 if none is in flight.
+  // Protected by lock_.
+  int64_t readahead_in_flight_from_;
+
+  // Bumped whenever ops are truncated, so that an in-flight read-ahead of ops
+  // which are no longer valid is discarded. Protected by lock_.
+  int64_t readahead_epoch_;
+
   // Pointer to a parent memtracker for all log caches. This
   // exists to compute server-wide cache size and enforce a
   // server-wide memory limit.  When the first instance of a log
@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -34,6 +35,7 @@ namespace log {
 
 using consensus::MakeOpId;
 using consensus::OpId;
+using std::vector;
 
 class LogIndexTest : public KuduTest {
  public:
@@ -117,5 +119,42 @@ TEST_F(LogIndexTest, TestMultiSegmentWithGC) {
   VerifyNotFound(2500000);
 }
 
+TEST_F(LogIndexTest, TestGetEntries) {
+  // Write a run of entries which spans a chunk boundary, with a hole after it.
+  for (int64_t i = 999990; i <= 1000010; i++) {
+    ASSERT_OK(AddEntry(MakeOpId(2, i), 3, i * 10));
+  }
+
+  vector<LogIndexEntry> entries;
+  ASSERT_OK(index_->GetEntries(999990, 1000010, &entries));
+  ASSERT_EQ(21, entries.size());
+  for (int64_t i = 999990; i <= 1000010; i++) {
+    const LogIndexEntry& e = entries[i - 999990];
+    EXPECT_EQ(2, e.op_id.term());
+    EXPECT_EQ(i, e.op_id.index());
+    EXPECT_EQ(3, e.segment_sequence_number);
+    EXPECT_EQ(i * 10, e.offset_in_segment);
+  }
+
+  // Reading past the last written entry returns the entries up to it.
+  entries.clear();
+  Status s = index_->GetEntries(1000005, 1000020, &entries);
+  EXPECT_TRUE(s.IsNotFound()) << s.ToString();
+  EXPECT_EQ(6, entries.size());
+
+  // A chunk which was never opened is reported the same way.
+  entries.clear();
+  s = index_->GetEntries(3000000, 3000001, &entries);
+  EXPECT_TRUE(s.IsNotFound()) << s.ToString();
+  EXPECT_TRUE(entries.empty());
+
+  // Once the first chunk is GCed, only the entries in the second remain.
+  index_->GC(1000000);
+  VerifyNotFound(999999);
+  entries.clear();
+  ASSERT_OK(index_->GetEntries(1000000, 1000010, &entries));
+  EXPECT_EQ(11, entries.size());
+}
+
 } // namespace log
 } // namespace kudu
@@ -25,6 +25,11 @@
 //
 // When the log is GCed, we remove any index chunks which are no longer needed, and
 // unmap them.
+//
+// The open chunks are kept in a vector indexed by chunk number relative to the
+// oldest retained chunk, so that a lookup is a division, a subtraction and a load
+// from the mapped array, done under the shared side of a per-CPU lock. Only opening
+// a new chunk or GCing old ones takes the lock exclusively.
 
 #include "kudu/consensus/log_index.h"
 
@@ -32,6 +37,7 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cinttypes>
 #include <cstdint>
@@ -45,7 +51,6 @@
 #include <glog/logging.h>
 
 #include "kudu/consensus/opid_util.h"
-#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -85,9 +90,12 @@ class LogIndex::IndexChunk : public RefCountedThreadSafe<LogIndex::IndexChunk> {
 
   // Open and map the memory.
   Status Open();
-  void GetEntry(int entry_index, PhysicalEntry* ret);
+  void GetEntry(int entry_index, PhysicalEntry* ret) const;
   void SetEntry(int entry_index, const PhysicalEntry& entry);
 
+  // Copy the 'count' entries starting at 'entry_index' into 'ret'.
+  void GetEntries(int entry_index, int count, PhysicalEntry* ret) const;
+
  private:
   const string path_;
   int fd_;
@@ -135,13 +143,21 @@ Status LogIndex::IndexChunk::Open() {
   return Status::OK();
 }
 
-void LogIndex::IndexChunk::GetEntry(int entry_index, PhysicalEntry* ret) {
+void LogIndex::IndexChunk::GetEntry(int entry_index, PhysicalEntry* ret) const {
   DCHECK_GE(fd_, 0) << "Must Open() first";
   DCHECK_LT(entry_index, kEntriesPerIndexChunk);
 
   memcpy(ret, mapping_ + sizeof(PhysicalEntry) * entry_index, sizeof(PhysicalEntry));
 }
 
+void LogIndex::IndexChunk::GetEntries(int entry_index, int count, PhysicalEntry* ret) const {
+  DCHECK_GE(fd_, 0) << "Must Open() first";
+  DCHECK_GE(count, 0);
+  DCHECK_LE(entry_index + count, kEntriesPerIndexChunk);
+
+  memcpy(ret, mapping_ + sizeof(PhysicalEntry) * entry_index, sizeof(PhysicalEntry) * count);
+}
+
 void LogIndex::IndexChunk::SetEntry(int entry_index, const PhysicalEntry& entry) {
   DCHECK_GE(fd_, 0) << "Must Open() first";
   DCHECK_LT(entry_index, kEntriesPerIndexChunk);
@@ -153,7 +169,10 @@ void LogIndex::IndexChunk::SetEntry(int entry_index, const PhysicalEntry& entry)
 // LogIndex
 ////////////////////////////////////////////////////////////
 
-LogIndex::LogIndex(std::string base_dir) : base_dir_(std::move(base_dir)) {}
+LogIndex::LogIndex(std::string base_dir)
+    : base_dir_(std::move(base_dir)),
+      first_chunk_idx_(0) {
+}
 
 LogIndex::~LogIndex() {
 }
@@ -171,44 +190,43 @@ Status LogIndex::OpenChunk(int64_t chunk_idx, scoped_refptr<IndexChunk>* chunk)
   return Status::OK();
 }
 
-Status LogIndex::GetChunkForIndex(int64_t log_index, bool create,
-                                  scoped_refptr<IndexChunk>* chunk) {
-  CHECK_GT(log_index, 0);
-  int64_t chunk_idx = log_index / kEntriesPerIndexChunk;
-
-  {
-    std::lock_guard<simple_spinlock> l(open_chunks_lock_);
-    if (FindCopy(open_chunks_, chunk_idx, chunk)) {
-      return Status::OK();
-    }
-  }
-
-  if (!create) {
-    return Status::NotFound("chunk not found");
+LogIndex::IndexChunk* LogIndex::FindChunkUnlocked(int64_t chunk_idx) const {
+  // The unsigned comparison also rejects chunks older than 'first_chunk_idx_'.
+  size_t slot = chunk_idx - first_chunk_idx_;
+  if (PREDICT_FALSE(slot >= chunks_.size())) {
+    return nullptr;
   }
+  return chunks_[slot].get();
+}
 
-  RETURN_NOT_OK_PREPEND(OpenChunk(chunk_idx, chunk),
+Status LogIndex::OpenChunkIfMissing(int64_t chunk_idx) {
+  scoped_refptr<IndexChunk> new_chunk;
+  RETURN_NOT_OK_PREPEND(OpenChunk(chunk_idx, &new_chunk),
                         "Couldn't open index chunk");
-  {
-    std::lock_guard<simple_spinlock> l(open_chunks_lock_);
-    if (PREDICT_FALSE(ContainsKey(open_chunks_, chunk_idx))) {
-      // Someone else opened the chunk in the meantime.
-      // We'll just return that one.
-      *chunk = FindOrDie(open_chunks_, chunk_idx);
-      return Status::OK();
-    }
 
-    InsertOrDie(&open_chunks_, chunk_idx, *chunk);
+  std::lock_guard<percpu_rwlock> l(chunks_lock_);
+  if (PREDICT_FALSE(FindChunkUnlocked(chunk_idx) != nullptr)) {
+    // Someone else opened the chunk in the meantime.
+    // We'll just use that one.
+    return Status::OK();
   }
-
+  if (chunks_.empty()) {
+    first_chunk_idx_ = chunk_idx;
+  } else if (chunk_idx < first_chunk_idx_) {
+    chunks_.insert(chunks_.begin(), first_chunk_idx_ - chunk_idx, nullptr);
+    first_chunk_idx_ = chunk_idx;
+  }
+  size_t slot = chunk_idx - first_chunk_idx_;
+  if (slot >= chunks_.size()) {
+    chunks_.resize(slot + 1);
+  }
+  chunks_[slot].swap(new_chunk);
   return Status::OK();
 }
 
 Status LogIndex::AddEntry(const LogIndexEntry& entry) {
-  scoped_refptr<IndexChunk> chunk;
-  RETURN_NOT_OK(GetChunkForIndex(entry.op_id.index(),
-                                 true /* create if not found */,
-                                 &chunk));
+  CHECK_GT(entry.op_id.index(), 0);
+  int64_t chunk_idx = entry.op_id.index() / kEntriesPerIndexChunk;
   int index_in_chunk = entry.op_id.index() % kEntriesPerIndexChunk;
 
   PhysicalEntry phys;
@@ -216,18 +234,33 @@ Status LogIndex::AddEntry(const LogIndexEntry& entry) {
   phys.segment_sequence_number = entry.segment_sequence_number;
   phys.offset_in_segment = entry.offset_in_segment;
 
-  chunk->SetEntry(index_in_chunk, phys);
+  while (true) {
+    {
+      shared_lock<rw_spinlock> l(chunks_lock_.get_lock());
+      IndexChunk* chunk = FindChunkUnlocked(chunk_idx);
+      if (PREDICT_TRUE(chunk != nullptr)) {
+        chunk->SetEntry(index_in_chunk, phys);
+        break;
+      }
+    }
+    RETURN_NOT_OK(OpenChunkIfMissing(chunk_idx));
+  }
   VLOG(3) << "Added log index entry " << entry.ToString();
 
   return Status::OK();
 }
 
 Status LogIndex::GetEntry(int64_t index, LogIndexEntry* entry) {
-  scoped_refptr<IndexChunk> chunk;
-  RETURN_NOT_OK(GetChunkForIndex(index, false /* do not create */, &chunk));
-  int index_in_chunk = index % kEntriesPerIndexChunk;
+  CHECK_GT(index, 0);
   PhysicalEntry phys;
-  chunk->GetEntry(index_in_chunk, &phys);
+  {
+    shared_lock<rw_spinlock> l(chunks_lock_.get_lock());
+    const IndexChunk* chunk = FindChunkUnlocked(index / kEntriesPerIndexChunk);
+    if (PREDICT_FALSE(chunk == nullptr)) {
+      return Status::NotFound("chunk not found");
+    }
+    chunk->GetEntry(index % kEntriesPerIndexChunk, &phys);
+  }
 
   // We never write any real entries to offset 0, because there's a header
   // in each log segment. So, this indicates an entry that was never written.
@@ -242,16 +275,58 @@ Status LogIndex::GetEntry(int64_t index, LogIndexEntry* entry) {
   return Status::OK();
 }
 
+Status LogIndex::GetEntries(int64_t start_index, int64_t end_index,
+                            vector<LogIndexEntry>* entries) {
+  CHECK_GT(start_index, 0);
+  DCHECK_GE(end_index, start_index);
+
+  vector<PhysicalEntry> phys;
+  int64_t index = start_index;
+  while (index <= end_index) {
+    // Copy out the run of entries which lives in the same chunk as 'index'.
+    int64_t chunk_idx = index / kEntriesPerIndexChunk;
+    int index_in_chunk = index % kEntriesPerIndexChunk;
+    int count = std::min<int64_t>(end_index - index + 1,
+                                  kEntriesPerIndexChunk - index_in_chunk);
+    phys.resize(count);
+    {
+      shared_lock<rw_spinlock> l(chunks_lock_.get_lock());
+      const IndexChunk* chunk = FindChunkUnlocked(chunk_idx);
+      if (PREDICT_FALSE(chunk == nullptr)) {
+        return Status::NotFound("chunk not found");
+      }
+      chunk->GetEntries(index_in_chunk, count, phys.data());
+    }
+
+    for (const PhysicalEntry& p : phys) {
+      // See GetEntry() for why offset 0 means the entry is missing.
+      if (p.offset_in_segment == 0) {
+        return Status::NotFound("entry not found");
+      }
+      LogIndexEntry entry;
+      entry.op_id = consensus::MakeOpId(p.term, index);
+      entry.segment_sequence_number = p.segment_sequence_number;
+      entry.offset_in_segment = p.offset_in_segment;
+      entries->emplace_back(std::move(entry));
+      index++;
+    }
+  }
+  return Status::OK();
+}
+
 void LogIndex::GC(int64_t min_index_to_retain) {
-  int min_chunk_to_retain = min_index_to_retain / kEntriesPerIndexChunk;
+  int64_t min_chunk_to_retain = min_index_to_retain / kEntriesPerIndexChunk;
 
   // Enumerate which chunks to delete.
   vector<int64_t> chunks_to_delete;
   {
-    std::lock_guard<simple_spinlock> l(open_chunks_lock_);
-    for (auto it = open_chunks_.begin();
-         it != open_chunks_.lower_bound(min_chunk_to_retain); ++it) {
-      chunks_to_delete.push_back(it->first);
+    shared_lock<rw_spinlock> l(chunks_lock_.get_lock());
+    for (size_t i = 0; i < chunks_.size(); i++) {
+      int64_t chunk_idx = first_chunk_idx_ + i;
+      if (chunk_idx >= min_chunk_to_retain) break;
+      if (chunks_[i]) {
+        chunks_to_delete.push_back(chunk_idx);
+      }
     }
   }
 
@@ -264,10 +339,21 @@ void LogIndex::GC(int64_t min_index_to_retain) {
       continue;
     }
     LOG(INFO) << "Deleted log index segment " << path;
+    scoped_refptr<IndexChunk> to_unmap;
     {
-      std::lock_guard<simple_spinlock> l(open_chunks_lock_);
-      open_chunks_.erase(chunk_idx);
+      std::lock_guard<percpu_rwlock> l(chunks_lock_);
+      size_t slot = chunk_idx - first_chunk_idx_;
+      DCHECK_LT(slot, chunks_.size());
+      to_unmap.swap(chunks_[slot]);
+      // Drop the leading empty slots so lookups stay relative to the oldest chunk.
+      size_t num_empty = 0;
+      while (num_empty < chunks_.size() && !chunks_[num_empty]) {
+        num_empty++;
+      }
+      chunks_.erase(chunks_.begin(), chunks_.begin() + num_empty);
+      first_chunk_idx_ += num_empty;
     }
+    // 'to_unmap' is released here, outside of the lock.
   }
 }
 
@@ -19,7 +19,7 @@
 
 #include <cstdint>
 #include <string>
-#include <map>
+#include <vector>
 
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/gutil/macros.h"
@@ -56,6 +56,10 @@ struct LogIndexEntry {
 // readers. In other words, if a reader is expected to see an index entry written by a
 // writer, there should be some other synchronization between them to ensure visibility.
 //
+// Lookups are on the hot path of serving lagging followers, so the read path only
+// takes a per-CPU read lock and then indexes directly into the mapped chunk. Opening
+// and GCing chunks take the lock exclusively.
+//
 // See .cc file for implementation notes.
 class LogIndex : public RefCountedThreadSafe<LogIndex> {
  public:
@@ -68,6 +72,15 @@ class LogIndex : public RefCountedThreadSafe<LogIndex> {
   // Returns NotFound() if the given log entry was never written.
   Status GetEntry(int64_t index, LogIndexEntry* entry);
 
+  // Retrieve the existing entries for the indexes in [start_index, end_index],
+  // appending them to 'entries' in index order. This is cheaper than calling
+  // GetEntry() for each index when reading a sequential range of ops.
+  //
+  // Returns NotFound() at the first index which was never written; the entries
+  // preceding it are still appended.
+  Status GetEntries(int64_t start_index, int64_t end_index,
+                    std::vector<LogIndexEntry>* entries);
+
   // Indicate that we no longer need to retain information about indexes lower than the
   // given index. Note that the implementation is conservative and _may_ choose to retain
   // earlier entries.
@@ -83,11 +96,13 @@ class LogIndex : public RefCountedThreadSafe<LogIndex> {
   // Note: 'chunk_idx' is the index of the index chunk, not the index of a log _entry_.
   Status OpenChunk(int64_t chunk_idx, scoped_refptr<IndexChunk>* chunk);
 
-  // Return the index chunk which contains the given log index.
-  // If 'create' is true, creates it on-demand. If 'create' is false, and
-  // the index chunk does not exist, returns NotFound.
-  Status GetChunkForIndex(int64_t log_index, bool create,
-                          scoped_refptr<IndexChunk>* chunk);
+  // Open the chunk with the given chunk index and publish it for lookups,
+  // unless another thread has already done so.
+  Status OpenChunkIfMissing(int64_t chunk_idx);
+
+  // Return the chunk with the given chunk index, or nullptr if it isn't open.
+  // Requires that 'chunks_lock_' is held, in either mode.
+  IndexChunk* FindChunkUnlocked(int64_t chunk_idx) const;
 
   // Return the path of the given index chunk.
   std::string GetChunkPath(int64_t chunk_idx);
@@ -95,13 +110,15 @@ class LogIndex : public RefCountedThreadSafe<LogIndex> {
   // The base directory where index files are located.
   const std::string base_dir_;
 
-  simple_spinlock open_chunks_lock_;
+  // Protects 'chunks_' and 'first_chunk_idx_'. Readers take the per-CPU lock
+  // in shared mode so that concurrent lookups don't bounce a cache line.
+  mutable percpu_rwlock chunks_lock_;
 
-  // Map from chunk index to IndexChunk. The chunk index is the log index modulo
-  // the number of entries per chunk (see docs in log_index.cc).
-  // Protected by open_chunks_lock_
-  typedef std::map<int64_t, scoped_refptr<IndexChunk> > ChunkMap;
-  ChunkMap open_chunks_;
+  // The open chunks, indexed by 'chunk_idx - first_chunk_idx_'. The chunk index
+  // is the log index divided by the number of entries per chunk (see docs in
+  // log_index.cc). Slots for chunks which were never opened are null.
+  std::vector<scoped_refptr<IndexChunk>> chunks_;
+  int64_t first_chunk_idx_;
 
   DISALLOW_COPY_AND_ASSIGN(LogIndex);
 };
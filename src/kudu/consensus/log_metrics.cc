@@ -48,6 +48,12 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         "Number of log entry batches in a group commit group",
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_group_commit_delay, "Log Group Commit Delay",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent waiting for more entries to join a "
+                        "group commit group. See --log_group_commit_target_latency_us",
+                        60000000LU, 2);
+
 namespace kudu {
 namespace log {
 
@@ -58,7 +64,8 @@ LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(group_commit_delay) {
 }
 #undef MINIT
 
@@ -282,10 +282,24 @@ Status LogReader::ReadReplicatesInRange(int64_t starting_at,
   bool limit_exceeded = false;
   faststring tmp_buf;
   gscoped_ptr<LogEntryBatchPB> batch;
+  // Index entries are looked up a window at a time rather than one by one,
+  // since catch-up reads are almost always sequential.
+  const int64_t kIndexLookupWindow = 128;
+  vector<LogIndexEntry> index_entries;
+  size_t window_pos = 0;
   for (int64_t index = starting_at; index <= up_to && !limit_exceeded; index++) {
-    LogIndexEntry index_entry;
-    RETURN_NOT_OK_PREPEND(log_index_->GetEntry(index, &index_entry),
-                          Substitute("Failed to read log index for op $0", index));
+    if (window_pos == index_entries.size()) {
+      index_entries.clear();
+      window_pos = 0;
+      Status s = log_index_->GetEntries(
+          index, std::min(up_to, index + kIndexLookupWindow - 1), &index_entries);
+      // A missing entry is only an error once we actually get to it.
+      if (!s.ok() && (!s.IsNotFound() || index_entries.empty())) {
+        return s.CloneAndPrepend(Substitute("Failed to read log index for op $0",
+                                            index + index_entries.size()));
+      }
+    }
+    const LogIndexEntry& index_entry = index_entries[window_pos++];
 
     // Since a given LogEntryBatchPB may contain multiple REPLICATE messages,
     // it's likely that this index entry points to the same batch as the previous
@@ -66,6 +66,8 @@ DEFINE_int32(num_batches_per_thread, 2000, "Number of batches per thread");
 DEFINE_int32(num_ops_per_batch_avg, 5, "Target average number of ops per batch");
 DEFINE_bool(verify_log, true, "Whether to verify the log by reading it after the writes complete");
 
+DECLARE_int32(log_group_commit_target_latency_us);
+DECLARE_int32(log_shared_append_threads);
 DECLARE_int32(log_thread_idle_threshold_ms);
 DECLARE_int32(log_inject_thread_lifecycle_latency_ms);
 
@@ -250,6 +252,7 @@ TEST_F(MultiThreadedLogTest, TestAppends) {
 // are triggered. It also injects latency into the writes done by the tests, so
 // that sometimes writes are spaced out enough to allow the thread to go idle.
 TEST_F(MultiThreadedLogTest, TestAppendThreadStartStopRaces) {
+  FLAGS_log_shared_append_threads = 0;
   FLAGS_log_thread_idle_threshold_ms = 1;
   FLAGS_log_inject_thread_lifecycle_latency_ms = 2;
   ASSERT_OK(BuildLog());
@@ -258,5 +261,15 @@ TEST_F(MultiThreadedLogTest, TestAppendThreadStartStopRaces) {
   ASSERT_NO_FATAL_FAILURE(VerifyLog());
 }
 
+// Appends from many threads with the adaptive group commit delay enabled, and
+// makes sure every entry still makes it to the log in order.
+TEST_F(MultiThreadedLogTest, TestAppendsWithGroupCommitDelay) {
+  FLAGS_log_group_commit_target_latency_us = 5000;
+  ASSERT_OK(BuildLog());
+  ASSERT_NO_FATAL_FAILURE(Run());
+  ASSERT_OK(log_->Close());
+  ASSERT_NO_FATAL_FAILURE(VerifyLog());
+}
+
 } // namespace log
 } // namespace kudu
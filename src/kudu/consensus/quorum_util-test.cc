@@ -95,6 +95,8 @@ static void AddPeer(RaftConfigPB* config,
         attrs_pb->set_promote(attr.second);
       } else if (attr.first == "REPLACE") {
         attrs_pb->set_replace(attr.second);
+      } else if (attr.first == "READ_REPLICA") {
+        attrs_pb->set_read_replica(attr.second);
       } else {
         FAIL() << attr.first << ": unexpected attribute to set";
       }
@@ -1435,6 +1437,32 @@ TEST(QuorumUtilTest, ShouldEvictReplicaNonVoters) {
   EXPECT_EQ("C", to_evict);
 }
 
+// Read replicas are neither excess replicas nor candidates for promotion, and
+// are only evicted once failed.
+TEST(QuorumUtilTest, ReadReplicas) {
+  RaftConfigPB config;
+  AddPeer(&config, "A", V, '+');
+  AddPeer(&config, "B", V, '+');
+  AddPeer(&config, "C", V, '+');
+  AddPeer(&config, "D", N, '+', {{"READ_REPLICA", true}});
+  AddPeer(&config, "E", N, '?', {{"READ_REPLICA", true}});
+  EXPECT_EQ(2, CountReadReplicas(config));
+  EXPECT_FALSE(ShouldEvictReplica(config, "A", 3, MHP_H));
+  EXPECT_FALSE(ShouldAddReplica(config, 3, MHP_H));
+
+  // The read replicas don't make up for a failed voter.
+  SetPeerHealth(&config, "C", '-');
+  EXPECT_TRUE(ShouldAddReplica(config, 3, MHP_H));
+  SetPeerHealth(&config, "C", '+');
+
+  // A failed read replica is evicted, and no longer counted.
+  SetPeerHealth(&config, "D", '-');
+  EXPECT_EQ(1, CountReadReplicas(config));
+  string to_evict;
+  ASSERT_TRUE(ShouldEvictReplica(config, "A", 3, MHP_H, &to_evict));
+  EXPECT_EQ("D", to_evict);
+}
+
 // A scenario of replica replacement where replicas fall behind the log segment
 // GC threshold and are replaced accordingly. This scenario is written to
 // address scenarios like of KUDU-2342.
@@ -122,6 +122,20 @@ int CountVoters(const RaftConfigPB& config) {
   return voters;
 }
 
+int CountReadReplicas(const RaftConfigPB& config) {
+  int read_replicas = 0;
+  for (const RaftPeerPB& peer : config.peers()) {
+    const auto overall_health = peer.health_report().overall_health();
+    if (peer.member_type() == RaftPeerPB::NON_VOTER &&
+        peer.attrs().read_replica() &&
+        overall_health != HealthReportPB::FAILED &&
+        overall_health != HealthReportPB::FAILED_UNRECOVERABLE) {
+      read_replicas++;
+    }
+  }
+  return read_replicas;
+}
+
 int MajoritySize(int num_voters) {
   DCHECK_GE(num_voters, 1);
   return (num_voters / 2) + 1;
@@ -614,6 +628,11 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
       case RaftPeerPB::NON_VOTER:
         DCHECK_NE(peer_uuid, leader_uuid) << peer_uuid
             << ": non-voter as a leader; " << SecureShortDebugString(config);
+        // Read replicas are not excess replicas: they're only evicted once
+        // failed, to be replaced by the master.
+        if (peer.attrs().read_replica() && !failed && !failed_unrecoverable) {
+          break;
+        }
         pq_non_voters.emplace(peer_to_elem(peer));
         ++num_non_voters_total;
         has_non_voter_failed |= failed;
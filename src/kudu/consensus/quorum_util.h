@@ -76,6 +76,10 @@ bool ReplicaTypesEqual(const RaftPeerPB& peer1, const RaftPeerPB& peer2);
 // Counts the number of voters in the configuration.
 int CountVoters(const RaftConfigPB& config);
 
+// Counts the number of read replicas in the configuration, i.e. NON_VOTER
+// replicas with the 'read_replica' attribute, which aren't reported as failed.
+int CountReadReplicas(const RaftConfigPB& config);
+
 // Calculates size of a configuration majority based on # of voters.
 int MajoritySize(int num_voters);
 
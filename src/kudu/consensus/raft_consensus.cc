@@ -178,6 +178,7 @@ RaftConsensus::RaftConsensus(
       state_(kNew),
       rng_(GetRandomSeed32()),
       withhold_votes_until_(MonoTime::Min()),
+      withhold_candidacy_(false),
       last_received_cur_leader_(MinimumOpId()),
       failed_elections_since_stable_leader_(0),
       shutdown_(false),
@@ -538,6 +539,23 @@ Status RaftConsensus::StepDown(LeaderStepDownResponsePB* resp) {
   return Status::OK();
 }
 
+Status RaftConsensus::GetLeadershipTransferTarget(RaftPeerPB* target) const {
+  ThreadRestrictions::AssertWaitAllowed();
+  LockGuard l(lock_);
+  RETURN_NOT_OK(CheckRunningUnlocked());
+  if (cmeta_->active_role() != RaftPeerPB::LEADER) {
+    return Status::IllegalState("Not currently leader");
+  }
+  const string uuid = queue_->GetCaughtUpVoter();
+  for (const auto& peer : cmeta_->ActiveConfig().peers()) {
+    if (!uuid.empty() && peer.permanent_uuid() == uuid) {
+      *target = peer;
+      return Status::OK();
+    }
+  }
+  return Status::NotFound("no voter is caught up with the leader");
+}
+
 scoped_refptr<ConsensusRound> RaftConsensus::NewRound(
     gscoped_ptr<ReplicateMsg> replicate_msg,
     ConsensusReplicatedCallback replicated_cb) {
@@ -547,6 +565,10 @@ scoped_refptr<ConsensusRound> RaftConsensus::NewRound(
 }
 
 void RaftConsensus::ReportFailureDetectedTask() {
+  if (withhold_candidacy_.Load()) {
+    VLOG_WITH_PREFIX(1) << "Not starting an election: candidacy is withheld";
+    return;
+  }
   std::unique_lock<simple_spinlock> try_lock(failure_detector_election_lock_,
                                              std::try_to_lock);
   if (try_lock.owns_lock()) {
@@ -1757,6 +1779,12 @@ Status RaftConsensus::BulkChangeConfig(const BulkChangeConfigRequestPB& req,
             return Status::InvalidArgument("peer must have last_known_addr specified",
                                            SecureShortDebugString(req));
           }
+          if (peer.attrs().read_replica() &&
+              (peer.member_type() != RaftPeerPB::NON_VOTER || peer.attrs().promote())) {
+            return Status::InvalidArgument("a read replica must be a NON_VOTER which "
+                                           "isn't to be promoted",
+                                           SecureShortDebugString(req));
+          }
           if (peer.member_type() == RaftPeerPB::VOTER) {
             num_voters_modified++;
           }
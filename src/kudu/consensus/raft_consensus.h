@@ -167,6 +167,20 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // Implement a LeaderStepDown() request.
   Status StepDown(LeaderStepDownResponsePB* resp);
 
+  // Returns in 'target' a voter which has received every operation of the
+  // local log, to which the leadership of this replica can be transferred
+  // without waiting for it to catch up. Returns IllegalState if this replica
+  // isn't the leader, and NotFound if no voter is caught up.
+  Status GetLeadershipTransferTarget(RaftPeerPB* target) const;
+
+  // Sets whether this replica withholds its candidacy. While it does, it
+  // doesn't start an election when it detects a leader failure, so that a
+  // server being drained of its leaders doesn't take leadership back.
+  // Elections requested explicitly still run.
+  void SetWithholdCandidacy(bool withhold) {
+    withhold_candidacy_.Store(withhold);
+  }
+
   // Creates a new ConsensusRound, the entity that owns all the data
   // structures required for a consensus round, such as the ReplicateMsg
   // (and later on the CommitMsg). ConsensusRound will also point to and
@@ -831,6 +845,9 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // nodes from disturbing the healthy leader.
   MonoTime withhold_votes_until_;
 
+  // See SetWithholdCandidacy().
+  AtomicBool withhold_candidacy_;
+
   // The last OpId received from the current leader. This is updated whenever the follower
   // accepts operations from a leader, and passed back so that the leader knows from what
   // point to continue sending operations.
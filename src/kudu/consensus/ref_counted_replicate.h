@@ -18,9 +18,15 @@
 #ifndef KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 #define KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 
+#include <atomic>
+#include <mutex>
+
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 namespace consensus {
@@ -34,8 +40,32 @@ class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
     return msg_.get();
   }
 
+  // Returns the serialized message. It is serialized on the first call and
+  // the result is kept, so the message must not be modified afterwards.
+  //
+  // This lets the WAL and the requests to every follower share a single
+  // serialization of the message.
+  //
+  // This method is thread-safe.
+  Slice encoded() {
+    std::call_once(encode_once_, [this]() {
+        pb_util::AppendToString(*msg_, &encoded_);
+        has_encoded_.store(true, std::memory_order_release);
+      });
+    return Slice(encoded_);
+  }
+
+  // Whether encoded() has already been called.
+  bool has_encoded() const {
+    return has_encoded_.load(std::memory_order_acquire);
+  }
+
  private:
   gscoped_ptr<ReplicateMsg> msg_;
+
+  std::once_flag encode_once_;
+  std::atomic<bool> has_encoded_ { false };
+  faststring encoded_;
 };
 
 typedef scoped_refptr<RefCountedReplicate> ReplicateRefPtr;
@@ -19,6 +19,7 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -34,6 +35,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(raft_enable_leader_leases);
+
 namespace kudu {
 namespace consensus {
 
@@ -204,5 +207,42 @@ TEST_F(TimeManagerTest, TestTimeManagerLeaderMode) {
   after_latch->Wait();
 }
 
+// Tests that, with leader leases enabled, a leader only moves safe time with the clock while
+// it holds a lease.
+TEST_F(TimeManagerTest, TestTimeManagerLeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  InitTimeManager(clock_->Now());
+  time_manager_->SetLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  // Without a lease, safe time stays put.
+  Timestamp safe_before = time_manager_->GetSafeTime();
+  Timestamp now = clock_->Now();
+  ASSERT_EQ(time_manager_->GetSafeTime(), safe_before);
+  ASSERT_FALSE(time_manager_->IsTimestampSafe(now));
+
+  // Getting a lease wakes up waiters and lets safe time move with the clock.
+  CountDownLatch* latch = WaitForSafeTimeAsync(now);
+  time_manager_->UpdateLeaderLease(MonoTime::Now() + MonoDelta::FromMilliseconds(200));
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  latch->Wait();
+  ASSERT_GT(time_manager_->GetSafeTime(), now);
+
+  // Once the lease expires, safe time stops moving again.
+  SleepFor(MonoDelta::FromMilliseconds(300));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  Timestamp safe_expired = time_manager_->GetSafeTime();
+  ASSERT_EQ(time_manager_->GetSafeTime(), safe_expired);
+
+  // Leases don't move backwards, and aren't kept across mode changes.
+  time_manager_->UpdateLeaderLease(MonoTime::Max());
+  time_manager_->UpdateLeaderLease(MonoTime::Now());
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  time_manager_->SetNonLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  time_manager_->UpdateLeaderLease(MonoTime::Max());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -49,6 +49,16 @@ DEFINE_int32(safe_time_max_lag_ms, 30 * 1000,
              "before forcing the client to retry, in milliseconds.");
 TAG_FLAG(safe_time_max_lag_ms, experimental);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether leaders track a lease: the time until which a majority of the "
+            "voters promised not to vote for another candidate, based on the last "
+            "requests they accepted. A leader only advances its safe time with the "
+            "clock while it holds a lease, so a deposed leader that hasn't noticed "
+            "yet doesn't serve reads at recent timestamps. Assumes all servers use "
+            "the same Raft heartbeat and failure detection settings.");
+TAG_FLAG(raft_enable_leader_leases, advanced);
+TAG_FLAG(raft_enable_leader_leases, experimental);
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 DECLARE_int32(scanner_max_wait_ms);
 
@@ -77,17 +87,49 @@ TimeManager::TimeManager(scoped_refptr<Clock> clock, Timestamp initial_safe_time
     last_safe_ts_(initial_safe_time),
     last_advanced_safe_time_(MonoTime::Now()),
     mode_(NON_LEADER),
+    leader_lease_expiration_(MonoTime::Min()),
     clock_(std::move(clock)) {}
 
 void TimeManager::SetLeaderMode() {
   Lock l(lock_);
   mode_ = LEADER;
-  AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  leader_lease_expiration_ = MonoTime::Min();
+  if (HasLeaderLeaseUnlocked()) {
+    AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  }
 }
 
 void TimeManager::SetNonLeaderMode() {
   Lock l(lock_);
   mode_ = NON_LEADER;
+  leader_lease_expiration_ = MonoTime::Min();
+}
+
+void TimeManager::UpdateLeaderLease(MonoTime expiration) {
+  Lock l(lock_);
+  if (mode_ != LEADER || expiration <= leader_lease_expiration_) {
+    return;
+  }
+  leader_lease_expiration_ = expiration;
+  // Safe time may have been held back while the lease was expired; move it to
+  // the clock, as SetLeaderMode() would, unless a transaction is in between
+  // timestamp assignment and being appended to the queue.
+  if (HasLeaderLeaseUnlocked() && last_serial_ts_assigned_ <= last_safe_ts_) {
+    AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  }
+}
+
+bool TimeManager::HasLeaderLease() {
+  Lock l(lock_);
+  return HasLeaderLeaseUnlocked();
+}
+
+bool TimeManager::HasLeaderLeaseUnlocked() const {
+  DCHECK(lock_.is_locked());
+  if (mode_ != LEADER) {
+    return false;
+  }
+  return !FLAGS_raft_enable_leader_leases || MonoTime::Now() < leader_lease_expiration_;
 }
 
 Status TimeManager::AssignTimestamp(ReplicateMsg* message) {
@@ -313,8 +355,10 @@ Timestamp TimeManager::GetSafeTimeUnlocked() {
       //                    \- last_safe_ts_
       //
       // If the current internal state is a), then we can advance safe time to 'N'. We know the
-      // leader will never assign a new timestamp lower than it.
-      if (PREDICT_TRUE(last_serial_ts_assigned_ <= last_safe_ts_)) {
+      // leader will never assign a new timestamp lower than it. With leader leases, we
+      // additionally need to know that no other leader may have been elected meanwhile.
+      if (PREDICT_TRUE(last_serial_ts_assigned_ <= last_safe_ts_) &&
+          HasLeaderLeaseUnlocked()) {
         last_safe_ts_ = clock_->Now();
         last_advanced_safe_time_ = MonoTime::Now();
         return last_safe_ts_;
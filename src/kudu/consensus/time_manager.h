@@ -63,7 +63,11 @@ class ReplicateMsg;
 //
 // See: docs/design-docs/repeatable-reads.md
 //
-// NOTE: Until leader leases are implemented the cluster's safe time can occasionally move back.
+// With --raft_enable_leader_leases, a leader only moves its safe time with the clock while it
+// holds a leader lease (see UpdateLeaderLease()), so that a deposed leader which hasn't yet
+// noticed it was deposed doesn't consider recent timestamps safe.
+//
+// NOTE: Unless leader leases are enabled the cluster's safe time can occasionally move back.
 //       This does not mean, however, that the timestamp returned by GetSafeTime() can move back.
 //       GetSafeTime will still return monotonically increasing timestamps, it's just
 //       that, in certain corner cases, the timestamp returned by GetSafeTime() can't be trusted
@@ -80,6 +84,15 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Sets this TimeManager to leader mode.
   void SetLeaderMode();
 
+  // Extends the leader lease of this replica until 'expiration', if that is later
+  // than its current expiration. A majority of the voters promised not to vote for
+  // another candidate until then. Has no effect unless in leader mode.
+  void UpdateLeaderLease(MonoTime expiration);
+
+  // Returns true if this replica is in leader mode and, if leader leases are
+  // enabled, holds an unexpired lease.
+  bool HasLeaderLease();
+
   // Sets this TimeManager to non-leader mode.
   void SetNonLeaderMode();
 
@@ -193,6 +206,9 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Internal, unlocked implementation of GetSafeTime().
   Timestamp GetSafeTimeUnlocked();
 
+  // Internal, unlocked implementation of HasLeaderLease().
+  bool HasLeaderLeaseUnlocked() const;
+
   // Lock to protect the non-const fields below.
   mutable simple_spinlock lock_;
 
@@ -213,6 +229,9 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // The current mode of the TimeManager.
   Mode mode_;
 
+  // When the current leader lease expires. MonoTime::Min() when not leader.
+  MonoTime leader_lease_expiration_;
+
   const scoped_refptr<clock::Clock> clock_;
   const std::string local_peer_uuid_;
 };
@@ -31,6 +31,7 @@ namespace kudu {
 
 class BlockId;
 class Env;
+class FileMapping;
 class MemTracker;
 class Slice;
 
@@ -162,16 +163,43 @@ class ReadableBlock : public Block {
   // If an error was encountered, returns a non-OK status.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Maps the whole block into memory, read-only. The mapping remains valid
+  // after the block is closed, and the block's data isn't reclaimed while
+  // the mapping is in use, even if the block is deleted.
+  //
+  // Returns NotSupported if the block can't be mapped.
+  virtual Status Map(std::shared_ptr<FileMapping>* mapping) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
 
+// The storage tier that a new block would prefer to be placed on. Data
+// directories belong to the fast tier if listed in --fs_data_dirs_fast_tier,
+// and to the slow tier otherwise.
+enum class StorageTier {
+  // No preference.
+  ANY,
+
+  // Frequently read data, e.g. bloom filters, indexes and freshly flushed
+  // rowsets.
+  FAST,
+
+  // Data that has aged, e.g. the output of compactions.
+  SLOW,
+};
+
 // Provides options and hints for block placement. This is used for identifying
-// the correct DataDirGroups to place blocks. In the future this may also be
-// used to specify directories based on block type (e.g. to prefer bloom block
-// placement into SSD-backed directories).
+// the correct DataDirGroups to place blocks, and the directories within them.
 struct CreateBlockOptions {
   const std::string tablet_id;
+
+  // The preferred tier for the block. If the tablet's directory group has no
+  // directory with space in that tier, the block is placed in any directory
+  // of the group.
+  //
+  // Defaults to ANY when left out of the initializer.
+  const StorageTier tier;
 };
 
 // Block manager creation options.
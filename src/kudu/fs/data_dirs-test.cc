@@ -52,11 +52,13 @@ using std::unique_ptr;
 using strings::Substitute;
 
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(fs_data_dirs_consider_write_load);
 DECLARE_double(env_inject_eio);
 DECLARE_int32(fs_data_dirs_full_disk_cache_seconds);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_int64(fs_data_dirs_reserved_bytes);
+DECLARE_string(fs_data_dirs_fast_tier);
 DECLARE_string(env_inject_eio_globs);
 
 METRIC_DECLARE_gauge_uint64(data_dirs_failed);
@@ -227,6 +229,141 @@ TEST_F(DataDirsTest, TestFailedDirNotReturned) {
   ASSERT_STR_CONTAINS(s.ToString(), "No healthy directories exist in tablet's directory group");
 }
 
+TEST_F(DataDirsTest, TestWriteLoadAwarePlacement) {
+  FLAGS_fs_target_data_dirs_per_tablet = 2;
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(test_tablet_name_));
+
+  // With no writes yet, both directories in the group are used.
+  set<DataDir*> used;
+  DataDir* dd;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    used.insert(dd);
+  }
+  ASSERT_EQ(2, used.size());
+  DataDir* slow_dd = *used.begin();
+  DataDir* fast_dd = *used.rbegin();
+
+  // Make one directory's writes slow. Since the group only has two members,
+  // both are considered for every block and the slow one should never win.
+  slow_dd->WriteStarted();
+  slow_dd->WriteFinished(MonoDelta::FromMilliseconds(500));
+  ASSERT_GT(slow_dd->WriteLoad(), 0);
+  ASSERT_EQ(0, fast_dd->WriteLoad());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    ASSERT_EQ(fast_dd, dd);
+  }
+
+  // With equal latencies, the directory with more writes in flight loses.
+  fast_dd->WriteStarted();
+  fast_dd->WriteFinished(MonoDelta::FromMilliseconds(500));
+  for (int i = 0; i < 3; i++) {
+    fast_dd->WriteStarted();
+  }
+  ASSERT_EQ(3, fast_dd->writes_in_flight());
+  ASSERT_GT(fast_dd->WriteLoad(), slow_dd->WriteLoad());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    ASSERT_EQ(slow_dd, dd);
+  }
+
+  // Without considering load, both directories are used.
+  FLAGS_fs_data_dirs_consider_write_load = false;
+  used.clear();
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    used.insert(dd);
+  }
+  ASSERT_EQ(2, used.size());
+}
+
+TEST_F(DataDirsTest, TestStorageTierPlacement) {
+  // Put the first two directories in the fast tier.
+  const vector<string> roots = GetDirNames(kNumDirs);
+  FLAGS_fs_data_dirs_fast_tier = JoinStrings(vector<string>({ roots[0], roots[1] }), ",");
+  dd_manager_.reset();
+  ASSERT_OK(DataDirManager::OpenExistingForTests(
+      env_, roots, DataDirManagerOptions(), &dd_manager_));
+  FLAGS_fs_target_data_dirs_per_tablet = kNumDirs;
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(test_tablet_name_));
+
+  const CreateBlockOptions fast_opts({ test_tablet_name_, StorageTier::FAST });
+  const CreateBlockOptions slow_opts({ test_tablet_name_, StorageTier::SLOW });
+  set<DataDir*> fast_used;
+  set<DataDir*> slow_used;
+  set<DataDir*> any_used;
+  DataDir* dd;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_OK(dd_manager_->GetNextDataDir(fast_opts, &dd));
+    ASSERT_TRUE(dd->is_fast_tier()) << dd->dir();
+    fast_used.insert(dd);
+    ASSERT_OK(dd_manager_->GetNextDataDir(slow_opts, &dd));
+    ASSERT_FALSE(dd->is_fast_tier()) << dd->dir();
+    slow_used.insert(dd);
+    ASSERT_OK(dd_manager_->GetNextDataDir(test_block_opts_, &dd));
+    any_used.insert(dd);
+  }
+  ASSERT_EQ(2, fast_used.size());
+  ASSERT_EQ(kNumDirs - 2, slow_used.size());
+  ASSERT_EQ(kNumDirs, any_used.size());
+
+  // Once the fast tier is full, its blocks spill over to the slow tier.
+  FLAGS_fs_data_dirs_reserved_bytes = 1;
+  FLAGS_disk_reserved_bytes_free_for_testing = 0;
+  for (DataDir* fast_dd : fast_used) {
+    ASSERT_OK(fast_dd->RefreshIsFull(DataDir::RefreshMode::ALWAYS));
+    ASSERT_TRUE(fast_dd->is_full());
+  }
+  FLAGS_fs_data_dirs_reserved_bytes = 0;
+  ASSERT_OK(dd_manager_->GetNextDataDir(fast_opts, &dd));
+  ASSERT_FALSE(dd->is_fast_tier()) << dd->dir();
+
+  // A fast tier directory must be one of the data roots.
+  dd_manager_.reset();
+  FLAGS_fs_data_dirs_fast_tier = GetTestPath("not-a-data-dir");
+  Status s = DataDirManager::OpenExistingForTests(
+      env_, roots, DataDirManagerOptions(), &dd_manager_);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(DataDirsTest, TestExpandGroup) {
+  FLAGS_fs_target_data_dirs_per_tablet = 2;
+  bool added;
+  Status s = dd_manager_->MaybeAddDataDirToGroup(test_tablet_name_, &added);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+
+  // Pile tablets onto the two directories of the first tablet's group, leaving
+  // the other directories empty, as if they were just added.
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(test_tablet_name_));
+  DataDirGroupPB orig_pb;
+  ASSERT_OK(dd_manager_->GetDataDirGroupPB(test_tablet_name_, &orig_pb));
+  const int kNumOtherTablets = 5;
+  for (int i = 0; i < kNumOtherTablets; i++) {
+    ASSERT_OK(dd_manager_->LoadDataDirGroupFromPB(Substitute("tablet-$0", i), orig_pb));
+  }
+
+  // The group gains one empty directory, which now holds the tablet.
+  ASSERT_OK(dd_manager_->MaybeAddDataDirToGroup(test_tablet_name_, &added));
+  ASSERT_TRUE(added);
+  DataDirGroupPB pb;
+  ASSERT_OK(dd_manager_->GetDataDirGroupPB(test_tablet_name_, &pb));
+  ASSERT_EQ(3, pb.uuids_size());
+  int new_uuid_idx;
+  ASSERT_TRUE(dd_manager_->FindUuidIndexByUuid(pb.uuids(2), &new_uuid_idx));
+  ASSERT_EQ(set<string>({ test_tablet_name_ }),
+            dd_manager_->FindTabletsByDataDirUuidIdx(new_uuid_idx));
+
+  // The remaining empty directories hold just one fewer tablet than the new
+  // member, so the group doesn't grow any further.
+  ASSERT_OK(dd_manager_->MaybeAddDataDirToGroup(test_tablet_name_, &added));
+  ASSERT_FALSE(added);
+
+  // The other tablets still have room to spread out.
+  ASSERT_OK(dd_manager_->MaybeAddDataDirToGroup("tablet-0", &added));
+  ASSERT_TRUE(added);
+}
+
 TEST_F(DataDirsTest, TestFailedDirNotAddedToGroup) {
   // Fail one dir and create a group with all directories. The failed directory
   // shouldn't be in the group.
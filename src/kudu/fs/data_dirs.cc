@@ -21,6 +21,7 @@
 #include <cerrno>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <numeric>
@@ -39,6 +40,7 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/block_manager_util.h"
 #include "kudu/fs/fs.pb.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/integral_types.h"
@@ -46,6 +48,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -91,6 +94,23 @@ DEFINE_int32(fs_data_dirs_full_disk_cache_seconds, 30,
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, advanced);
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, evolving);
 
+DEFINE_bool(fs_data_dirs_consider_write_load, true,
+            "Whether to place new blocks on the less loaded of two randomly "
+            "chosen data directories, judged by recent write latency and the "
+            "number of writes in progress, rather than on a random one.");
+TAG_FLAG(fs_data_dirs_consider_write_load, advanced);
+TAG_FLAG(fs_data_dirs_consider_write_load, runtime);
+TAG_FLAG(fs_data_dirs_consider_write_load, evolving);
+
+DEFINE_string(fs_data_dirs_fast_tier, "",
+              "Comma-separated list of data roots, each also listed in "
+              "--fs_data_dirs, that are backed by fast storage such as SSDs. "
+              "Bloom filters, indexes and freshly flushed rowsets are placed "
+              "in these directories when possible, while the output of "
+              "compactions is placed in the others. If empty, all data "
+              "directories are treated alike.");
+TAG_FLAG(fs_data_dirs_fast_tier, experimental);
+
 DEFINE_bool(fs_lock_data_dirs, true,
             "Lock the data directories to prevent concurrent usage. "
             "Note that read-only concurrent usage is still allowed.");
@@ -106,6 +126,32 @@ METRIC_DEFINE_gauge_uint64(server, data_dirs_full,
                            "Data Directories Full",
                            kudu::MetricUnit::kDataDirectories,
                            "Number of data directories whose disks are currently full");
+METRIC_DEFINE_counter(server, data_dirs_flush_io_throttled_time,
+                      "Data Directories Flush IO Throttled Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total time flushes waited for the IO budget of a data directory");
+METRIC_DEFINE_counter(server, data_dirs_compaction_io_throttled_time,
+                      "Data Directories Compaction IO Throttled Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total time compactions waited for the IO budget of a data directory");
+METRIC_DEFINE_counter(server, data_dirs_gc_io_throttled_time,
+                      "Data Directories GC IO Throttled Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total time garbage collection waited for the IO budget of a data "
+                      "directory");
+
+METRIC_DEFINE_histogram(server, data_dirs_write_latency,
+                        "Data Directories Write Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Latency of block data writes and syncs to data directories",
+                        60000000LU, 2);
+
+METRIC_DEFINE_counter(server, data_dir_groups_expanded,
+                      "Data Directory Groups Expanded",
+                      kudu::MetricUnit::kUnits,
+                      "Number of times a data directory was added to a tablet's "
+                      "directory group to spread its writes onto less loaded "
+                      "directories");
 
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_string(block_manager);
@@ -195,11 +241,18 @@ void DeleteTmpFilesRecursively(Env* env, const string& path) {
 ////////////////////////////////////////////////////////////
 
 #define GINIT(x) x(METRIC_##x.Instantiate(entity, 0))
+#define MINIT(x) x(METRIC_##x.Instantiate(entity))
 DataDirMetrics::DataDirMetrics(const scoped_refptr<MetricEntity>& entity)
   : GINIT(data_dirs_failed),
-    GINIT(data_dirs_full) {
+    GINIT(data_dirs_full),
+    MINIT(data_dirs_flush_io_throttled_time),
+    MINIT(data_dirs_compaction_io_throttled_time),
+    MINIT(data_dirs_gc_io_throttled_time),
+    MINIT(data_dirs_write_latency),
+    MINIT(data_dir_groups_expanded) {
 }
 #undef GINIT
+#undef MINIT
 
 ////////////////////////////////////////////////////////////
 // DataDir
@@ -210,15 +263,22 @@ DataDir::DataDir(Env* env,
                  DataDirFsType fs_type,
                  string dir,
                  unique_ptr<PathInstanceMetadataFile> metadata_file,
-                 unique_ptr<ThreadPool> pool)
+                 unique_ptr<ThreadPool> pool,
+                 bool is_fast_tier)
     : env_(env),
       metrics_(metrics),
       fs_type_(fs_type),
       dir_(std::move(dir)),
       metadata_file_(std::move(metadata_file)),
       pool_(std::move(pool)),
+      is_fast_tier_(is_fast_tier),
+      io_throttler_(metrics ? metrics->data_dirs_flush_io_throttled_time : nullptr,
+                    metrics ? metrics->data_dirs_compaction_io_throttled_time : nullptr,
+                    metrics ? metrics->data_dirs_gc_io_throttled_time : nullptr),
       is_shutdown_(false),
-      is_full_(false) {
+      is_full_(false),
+      writes_in_flight_(0),
+      avg_write_latency_us_(0) {
 }
 
 DataDir::~DataDir() {
@@ -248,6 +308,54 @@ void DataDir::WaitOnClosures() {
   pool_->Wait();
 }
 
+namespace {
+
+// Weight of each new sample in a data directory's moving average write latency.
+constexpr double kWriteLatencyAlpha = 0.1;
+
+// A data directory's average write latency is ignored once this much time has
+// passed without a write. Otherwise, a directory that was slow once and then
+// lost every placement decision would never be written to, and so would never
+// have its latency remeasured.
+const MonoDelta kWriteLatencyExpiry = MonoDelta::FromSeconds(10);
+
+} // anonymous namespace
+
+void DataDir::WriteStarted() {
+  writes_in_flight_.Increment();
+}
+
+void DataDir::WriteFinished(MonoDelta latency) {
+  writes_in_flight_.IncrementBy(-1);
+  int64_t latency_us = latency.ToMicroseconds();
+  if (metrics_) {
+    metrics_->data_dirs_write_latency->Increment(latency_us);
+  }
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(write_stats_lock_);
+  if (!last_write_finished_.Initialized() ||
+      now - last_write_finished_ > kWriteLatencyExpiry) {
+    avg_write_latency_us_ = latency_us;
+  } else {
+    avg_write_latency_us_ += kWriteLatencyAlpha * (latency_us - avg_write_latency_us_);
+  }
+  last_write_finished_ = now;
+}
+
+MonoDelta DataDir::recent_write_latency() const {
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(write_stats_lock_);
+  if (!last_write_finished_.Initialized() ||
+      now - last_write_finished_ > kWriteLatencyExpiry) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  return MonoDelta::FromMicroseconds(static_cast<int64_t>(avg_write_latency_us_));
+}
+
+int64_t DataDir::WriteLoad() const {
+  return recent_write_latency().ToMicroseconds() * (1 + writes_in_flight());
+}
+
 Status DataDir::RefreshIsFull(RefreshMode mode) {
   switch (mode) {
     case RefreshMode::EXPIRED_ONLY: {
@@ -703,6 +811,28 @@ Status DataDirManager::Open() {
                    JoinStrings(GetDataDirs(), ",")));
   }
 
+  // Determine which data directories belong to the fast storage tier.
+  unordered_set<string> fast_tier_dirs;
+  if (!FLAGS_fs_data_dirs_fast_tier.empty()) {
+    const vector<string> roots = GetDataRoots();
+    const unordered_set<string> roots_set(roots.begin(), roots.end());
+    for (const auto& r : strings::Split(FLAGS_fs_data_dirs_fast_tier, ",",
+                                        strings::SkipEmpty())) {
+      string root = r.ToString();
+      string canonicalized;
+      if (!ContainsKey(roots_set, root) &&
+          env_->Canonicalize(root, &canonicalized).ok()) {
+        root = std::move(canonicalized);
+      }
+      if (!ContainsKey(roots_set, root)) {
+        return Status::InvalidArgument(Substitute(
+            "fast tier data root $0 is not one of the data roots ($1)",
+            r.ToString(), JoinStrings(roots, ",")));
+      }
+      fast_tier_dirs.emplace(JoinPathSegments(root, kDataDirName));
+    }
+  }
+
   // All instances are present and accounted for. Time to create the in-memory
   // data directory structures.
   int i = 0;
@@ -734,7 +864,8 @@ Status DataDirManager::Open() {
 
     unique_ptr<DataDir> dd(new DataDir(
         env_, metrics_.get(), fs_type, data_dir, std::move(instance),
-        unique_ptr<ThreadPool>(pool.release())));
+        unique_ptr<ThreadPool>(pool.release()),
+        ContainsKey(fast_tier_dirs, data_dir)));
     dds.emplace_back(std::move(dd));
     i++;
   }
@@ -973,16 +1104,47 @@ Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir**
   iota(random_indices.begin(), random_indices.end(), 0);
   shuffle(random_indices.begin(), random_indices.end(), default_random_engine(rng_.Next()));
 
-  // Randomly select a member of the group that is not full.
-  for (int i : random_indices) {
-    int uuid_idx = (*group_uuid_indices)[i];
-    DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
-    Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
-    WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
-    if (s.ok() && !candidate->is_full()) {
-      *dir = candidate;
-      return Status::OK();
+  // Randomly select a member of the group that is not full. If considering
+  // write load, select two such members and pick the less loaded one, so that
+  // new blocks are steered away from slow or busy disks.
+  //
+  // If the block prefers a storage tier, only members of that tier are
+  // considered at first, falling back to the whole group.
+  const int num_choices = FLAGS_fs_data_dirs_consider_write_load ? 2 : 1;
+  const auto choose = [&] (bool match_tier) -> DataDir* {
+    DataDir* chosen = nullptr;
+    int num_candidates = 0;
+    for (int i : random_indices) {
+      int uuid_idx = (*group_uuid_indices)[i];
+      DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
+      if (match_tier &&
+          candidate->is_fast_tier() != (opts.tier == StorageTier::FAST)) {
+        continue;
+      }
+      Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
+      WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
+      if (!s.ok() || candidate->is_full()) {
+        continue;
+      }
+      if (!chosen || candidate->WriteLoad() < chosen->WriteLoad()) {
+        chosen = candidate;
+      }
+      if (++num_candidates == num_choices) {
+        break;
+      }
     }
+    return chosen;
+  };
+  DataDir* chosen = nullptr;
+  if (opts.tier != StorageTier::ANY) {
+    chosen = choose(true);
+  }
+  if (!chosen) {
+    chosen = choose(false);
+  }
+  if (chosen) {
+    *dir = chosen;
+    return Status::OK();
   }
   string tablet_id_str = "";
   if (PREDICT_TRUE(!opts.tablet_id.empty())) {
@@ -998,6 +1160,62 @@ Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir**
                          "", ENOSPC);
 }
 
+Status DataDirManager::MaybeAddDataDirToGroup(const string& tablet_id, bool* added) {
+  *added = false;
+  std::lock_guard<percpu_rwlock> write_lock(dir_group_lock_);
+  DataDirGroup* group = FindOrNull(group_by_tablet_map_, tablet_id);
+  if (group == nullptr) {
+    return Status::NotFound("Tried to expand directory group but no directory "
+                            "group registered for tablet", tablet_id);
+  }
+  const vector<int>& group_indices = group->uuid_indices();
+  size_t min_tablets_in_group = std::numeric_limits<size_t>::max();
+  for (int uuid_idx : group_indices) {
+    min_tablets_in_group = std::min(min_tablets_in_group,
+                                    FindOrDie(tablets_by_uuid_idx_map_, uuid_idx).size());
+  }
+
+  // Only consider directories that would still hold fewer tablets than any
+  // directory in the group once this tablet is added to them. This keeps a
+  // group from growing across restarts once directories are balanced.
+  DCHECK_GT(min_tablets_in_group, 0);
+  int best_idx = -1;
+  size_t best_num_tablets = min_tablets_in_group - 1;
+  for (const auto& e : data_dir_by_uuid_idx_) {
+    int uuid_idx = e.first;
+    if (ContainsKey(failed_data_dirs_, uuid_idx) ||
+        std::find(group_indices.begin(), group_indices.end(), uuid_idx) !=
+            group_indices.end()) {
+      continue;
+    }
+    size_t num_tablets = FindOrDie(tablets_by_uuid_idx_map_, uuid_idx).size();
+    if (num_tablets >= best_num_tablets) {
+      continue;
+    }
+    Status s = e.second->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
+    WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", e.second->dir()));
+    if (s.ok() && !e.second->is_full()) {
+      best_idx = uuid_idx;
+      best_num_tablets = num_tablets;
+    }
+  }
+  if (best_idx == -1) {
+    return Status::OK();
+  }
+
+  vector<int> new_indices = group_indices;
+  new_indices.push_back(best_idx);
+  *group = DataDirGroup(std::move(new_indices));
+  InsertOrDie(&FindOrDie(tablets_by_uuid_idx_map_, best_idx), tablet_id);
+  if (metrics_) {
+    metrics_->data_dir_groups_expanded->Increment();
+  }
+  VLOG(1) << Substitute("Added data dir $0 to the directory group of tablet $1",
+                        FindOrDie(data_dir_by_uuid_idx_, best_idx)->dir(), tablet_id);
+  *added = true;
+  return Status::OK();
+}
+
 void DataDirManager::DeleteDataDirGroup(const std::string& tablet_id) {
   std::lock_guard<percpu_rwlock> lock(dir_group_lock_);
   DataDirGroup* group = FindOrNull(group_by_tablet_map_, tablet_id);
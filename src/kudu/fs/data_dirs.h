@@ -28,9 +28,11 @@
 
 #include <gtest/gtest_prod.h>
 
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -135,6 +137,11 @@ struct DataDirMetrics {
 
   scoped_refptr<AtomicGauge<uint64_t>> data_dirs_failed;
   scoped_refptr<AtomicGauge<uint64_t>> data_dirs_full;
+  scoped_refptr<Counter> data_dirs_flush_io_throttled_time;
+  scoped_refptr<Counter> data_dirs_compaction_io_throttled_time;
+  scoped_refptr<Counter> data_dirs_gc_io_throttled_time;
+  scoped_refptr<Histogram> data_dirs_write_latency;
+  scoped_refptr<Counter> data_dir_groups_expanded;
 };
 
 // Representation of a data directory in use by the block manager.
@@ -145,7 +152,8 @@ class DataDir {
           DataDirFsType fs_type,
           std::string dir,
           std::unique_ptr<PathInstanceMetadataFile> metadata_file,
-          std::unique_ptr<ThreadPool> pool);
+          std::unique_ptr<ThreadPool> pool,
+          bool is_fast_tier = false);
   ~DataDir();
 
   // Shuts down this dir's thread pool, waiting for any closures submitted via
@@ -180,15 +188,41 @@ class DataDir {
 
   const std::string& dir() const { return dir_; }
 
+  // Whether this directory belongs to the fast storage tier.
+  bool is_fast_tier() const { return is_fast_tier_; }
+
   const PathInstanceMetadataFile* instance() const {
     return metadata_file_.get();
   }
 
+  // The IO budgets of the background priority classes in this directory.
+  // Block managers pass the reads and writes of the dir's blocks through it.
+  DataDirIOThrottler* io_throttler() { return &io_throttler_; }
+
   bool is_full() const {
     std::lock_guard<simple_spinlock> l(lock_);
     return is_full_;
   }
 
+  // Records that a write (or sync) to this directory is about to begin. Must
+  // be paired with a later call to WriteFinished().
+  void WriteStarted();
+
+  // Records that a write which began with WriteStarted() took 'latency'.
+  void WriteFinished(MonoDelta latency);
+
+  // Returns the number of writes to this directory currently in progress.
+  int32_t writes_in_flight() const { return writes_in_flight_.Load(); }
+
+  // Returns the moving average latency of recent writes to this directory, or
+  // zero if there were none recently.
+  MonoDelta recent_write_latency() const;
+
+  // Returns how loaded this directory is with writes, in microseconds: the
+  // recent average write latency multiplied by the number of writes that a
+  // new one would queue behind. Lower values are better.
+  int64_t WriteLoad() const;
+
  private:
   Env* env_;
   DataDirMetrics* metrics_;
@@ -196,6 +230,8 @@ class DataDir {
   const std::string dir_;
   const std::unique_ptr<PathInstanceMetadataFile> metadata_file_;
   const std::unique_ptr<ThreadPool> pool_;
+  const bool is_fast_tier_;
+  DataDirIOThrottler io_throttler_;
 
   bool is_shutdown_;
 
@@ -204,6 +240,13 @@ class DataDir {
   MonoTime last_check_is_full_;
   bool is_full_;
 
+  AtomicInt<int32_t> writes_in_flight_;
+
+  // Protects 'avg_write_latency_us_' and 'last_write_finished_'.
+  mutable simple_spinlock write_stats_lock_;
+  double avg_write_latency_us_;
+  MonoTime last_write_finished_;
+
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
 
@@ -323,6 +366,16 @@ class DataDirManager {
   Status CreateDataDirGroup(const std::string& tablet_id,
                             DirDistributionMode mode = DirDistributionMode::USE_FLAG_SPEC);
 
+  // Adds a directory to the specified tablet's group if there is a healthy,
+  // non-full directory outside of the group that holds at least two fewer
+  // tablets than every directory within it, such as a newly added disk. The
+  // least loaded such directory is chosen. Directories are never removed from the group,
+  // since the tablet may still have blocks in them.
+  //
+  // Sets 'added' to whether the group was changed. Returns an error if the
+  // tablet has no group.
+  Status MaybeAddDataDirToGroup(const std::string& tablet_id, bool* added);
+
   // Deletes the group for the specified tablet. Maps from tablet_id to group
   // and data dir to tablet set are cleared of all references to the tablet.
   void DeleteDataDirGroup(const std::string& tablet_id);
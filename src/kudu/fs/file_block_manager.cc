@@ -35,6 +35,7 @@
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs_report.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/integral_types.h"
@@ -339,16 +340,17 @@ Status FileWritableBlock::Append(const Slice& data) {
 
 Status FileWritableBlock::AppendV(ArrayView<const Slice> data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY) << "Invalid state: " << state_;
-  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
-  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
-      DataDir::RefreshMode::ALWAYS));
-  state_ = DIRTY;
 
   // Calculate the amount of data written
   size_t bytes_written = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
                                     [&](int sum, const Slice& curr) {
                                       return sum + curr.size();
                                     });
+  location_.data_dir()->io_throttler()->Throttle(bytes_written);
+  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
+      DataDir::RefreshMode::ALWAYS));
+  state_ = DIRTY;
   bytes_appended_ += bytes_written;
   return Status::OK();
 }
@@ -447,6 +449,8 @@ class FileReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Map(shared_ptr<FileMapping>* mapping) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
   void HandleError(const Status& s) const;
@@ -522,20 +526,38 @@ Status FileReadableBlock::Read(uint64_t offset, Slice result) const {
 Status FileReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const {
   DCHECK(!closed_.Load());
 
+  // Calculate the read amount of data
+  size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                                 [&](int sum, const Slice& curr) {
+                                   return sum + curr.size();
+                                 });
+  if (ScopedIOPriority::Current() != IOPriority::FOREGROUND) {
+    DataDir* dir = block_manager_->dd_manager_->FindDataDirByUuidIndex(
+        internal::FileBlockLocation::GetDataDirIdx(block_id_));
+    if (dir) {
+      dir->io_throttler()->Throttle(bytes_read);
+    }
+  }
+
   RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
 
   if (block_manager_->metrics_) {
-    // Calculate the read amount of data
-    size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
-                                   [&](int sum, const Slice& curr) {
-                                     return sum + curr.size();
-                                   });
     block_manager_->metrics_->total_bytes_read->IncrementBy(bytes_read);
   }
 
   return Status::OK();
 }
 
+Status FileReadableBlock::Map(shared_ptr<FileMapping>* mapping) const {
+  DCHECK(!closed_.Load());
+
+  // The mapping outlives the file's deletion, so there's nothing to pin.
+  uint64_t size;
+  RETURN_NOT_OK_HANDLE_ERROR(reader_->Size(&size));
+  RETURN_NOT_OK_HANDLE_ERROR(reader_->Map(0, size, mapping));
+  return Status::OK();
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
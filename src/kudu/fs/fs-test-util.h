@@ -81,6 +81,11 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual Status Map(std::shared_ptr<FileMapping>* /* mapping */) const OVERRIDE {
+    // Reads from a mapping couldn't be counted.
+    return Status::NotSupported("counted blocks can't be mapped");
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
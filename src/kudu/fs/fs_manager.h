@@ -222,6 +222,12 @@ class FsManager {
   // Return the path where InstanceMetadataPB is stored.
   std::string GetInstanceMetadataPath(const std::string& root) const;
 
+  // Return the path where the snapshot of the block cache is stored.
+  std::string GetBlockCacheSnapshotPath() const {
+    DCHECK(initted_);
+    return JoinPathSegments(canonicalized_metadata_fs_root_.path, kBlockCacheSnapshotFileName);
+  }
+
   // Return the directory where the consensus metadata is stored.
   std::string GetConsensusMetadataDir() const {
     DCHECK(initted_);
@@ -322,6 +328,7 @@ class FsManager {
   static const char *kInstanceMetadataMagicNumber;
   static const char *kTabletSuperBlockMagicNumber;
   static const char *kConsensusMetadataDirName;
+  static const char *kBlockCacheSnapshotFileName;
 
   // The environment to be used for all filesystem operations.
   Env* env_;
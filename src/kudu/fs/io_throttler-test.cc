@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/io_throttler.h"
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int64(fs_data_dir_compaction_io_bytes_per_sec);
+
+namespace kudu {
+namespace fs {
+
+class DataDirIOThrottlerTest : public KuduTest {
+};
+
+TEST_F(DataDirIOThrottlerTest, TestScopedIOPriority) {
+  ASSERT_EQ(IOPriority::FOREGROUND, ScopedIOPriority::Current());
+  {
+    ScopedIOPriority compaction(IOPriority::COMPACTION);
+    ASSERT_EQ(IOPriority::COMPACTION, ScopedIOPriority::Current());
+    {
+      ScopedIOPriority flush(IOPriority::FLUSH);
+      ASSERT_EQ(IOPriority::FLUSH, ScopedIOPriority::Current());
+    }
+    ASSERT_EQ(IOPriority::COMPACTION, ScopedIOPriority::Current());
+  }
+  ASSERT_EQ(IOPriority::FOREGROUND, ScopedIOPriority::Current());
+}
+
+// Only the IO of the classes with a budget is throttled.
+TEST_F(DataDirIOThrottlerTest, TestThrottle) {
+  FLAGS_fs_data_dir_compaction_io_bytes_per_sec = 1024 * 1024;
+  DataDirIOThrottler throttler(nullptr, nullptr, nullptr);
+
+  // 2MB of foreground and flush IO go through right away.
+  MonoTime start = MonoTime::Now();
+  throttler.Throttle(2 * 1024 * 1024);
+  {
+    ScopedIOPriority flush(IOPriority::FLUSH);
+    throttler.Throttle(2 * 1024 * 1024);
+  }
+  ASSERT_LT((MonoTime::Now() - start).ToSeconds(), 0.5);
+
+  // 1MB of compaction IO, larger than what a single refill period grants,
+  // takes about a second.
+  ScopedIOPriority compaction(IOPriority::COMPACTION);
+  start = MonoTime::Now();
+  throttler.Throttle(1024 * 1024);
+  ASSERT_GE((MonoTime::Now() - start).ToSeconds(), 0.8);
+}
+
+} // namespace fs
+} // namespace kudu
@@ -0,0 +1,122 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/io_throttler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/throttler.h"
+
+DEFINE_int64(fs_data_dir_flush_io_bytes_per_sec, 0,
+             "Maximum rate at which flushes may read and write the blocks of each "
+             "data directory. 0 disables throttling of flushes.");
+TAG_FLAG(fs_data_dir_flush_io_bytes_per_sec, experimental);
+
+DEFINE_int64(fs_data_dir_compaction_io_bytes_per_sec, 0,
+             "Maximum rate at which rowset and delta compactions may read and write "
+             "the blocks of each data directory. 0 disables throttling of compactions.");
+TAG_FLAG(fs_data_dir_compaction_io_bytes_per_sec, experimental);
+
+DEFINE_int64(fs_data_dir_gc_io_bytes_per_sec, 0,
+             "Maximum rate at which the garbage collection of ancient history may "
+             "read and write the blocks of each data directory. 0 disables "
+             "throttling of garbage collection.");
+TAG_FLAG(fs_data_dir_gc_io_bytes_per_sec, experimental);
+
+namespace kudu {
+namespace fs {
+
+namespace {
+__thread IOPriority tls_io_priority = IOPriority::FOREGROUND;
+} // anonymous namespace
+
+ScopedIOPriority::ScopedIOPriority(IOPriority priority)
+    : prev_(tls_io_priority) {
+  tls_io_priority = priority;
+}
+
+ScopedIOPriority::~ScopedIOPriority() {
+  tls_io_priority = prev_;
+}
+
+IOPriority ScopedIOPriority::Current() {
+  return tls_io_priority;
+}
+
+DataDirIOThrottler::DataDirIOThrottler(scoped_refptr<Counter> flush_throttled_us,
+                                       scoped_refptr<Counter> compaction_throttled_us,
+                                       scoped_refptr<Counter> gc_throttled_us) {
+  InitBudget(FLAGS_fs_data_dir_flush_io_bytes_per_sec,
+             std::move(flush_throttled_us), &flush_);
+  InitBudget(FLAGS_fs_data_dir_compaction_io_bytes_per_sec,
+             std::move(compaction_throttled_us), &compaction_);
+  InitBudget(FLAGS_fs_data_dir_gc_io_bytes_per_sec,
+             std::move(gc_throttled_us), &gc_);
+}
+
+DataDirIOThrottler::~DataDirIOThrottler() {}
+
+void DataDirIOThrottler::InitBudget(int64_t bytes_per_sec,
+                                    scoped_refptr<Counter> throttled_us,
+                                    ClassBudget* budget) {
+  budget->throttled_us = std::move(throttled_us);
+  // With a burst factor of 1, each refill period grants at most the tokens of
+  // a single period, so larger IOs must be split to ever fit.
+  budget->max_take_bytes = bytes_per_sec /
+      (MonoTime::kMicrosecondsPerSecond / Throttler::kRefillPeriodMicros);
+  if (budget->max_take_bytes > 0) {
+    budget->throttler.reset(new Throttler(MonoTime::Now(), 0, bytes_per_sec, 1.0));
+  }
+}
+
+void DataDirIOThrottler::Throttle(uint64_t bytes) {
+  ClassBudget* budget = nullptr;
+  switch (ScopedIOPriority::Current()) {
+    case IOPriority::FOREGROUND: return;
+    case IOPriority::FLUSH: budget = &flush_; break;
+    case IOPriority::COMPACTION: budget = &compaction_; break;
+    case IOPriority::GC: budget = &gc_; break;
+    default: LOG(FATAL) << "unknown IO priority";
+  }
+  if (!budget->throttler) {
+    return;
+  }
+
+  MonoTime start = MonoTime::Now();
+  MonoTime now = start;
+  while (bytes > 0) {
+    uint64_t take = std::min(bytes, budget->max_take_bytes);
+    while (!budget->throttler->Take(now, 0, take)) {
+      SleepFor(MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros / 10));
+      now = MonoTime::Now();
+    }
+    bytes -= take;
+  }
+  if (budget->throttled_us && now > start) {
+    budget->throttled_us->IncrementBy((now - start).ToMicroseconds());
+  }
+}
+
+} // namespace fs
+} // namespace kudu
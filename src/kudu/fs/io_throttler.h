@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/metrics.h"
+
+namespace kudu {
+
+class Throttler;
+
+namespace fs {
+
+// The classes of the IO issued to the block manager. The background classes
+// may each be given a per-directory bandwidth budget, so that maintenance
+// work doesn't saturate a disk at the expense of the foreground reads and
+// writes, which are never throttled.
+enum class IOPriority {
+  FOREGROUND,
+
+  // Flushes of in-memory stores, which are urgent since they release memory
+  // and WAL segments.
+  FLUSH,
+
+  // Rowset and delta compactions.
+  COMPACTION,
+
+  // Garbage collection of ancient history.
+  GC,
+};
+
+// Sets the IO priority class of the current thread for the lifetime of the
+// object, restoring the previous class on destruction.
+class ScopedIOPriority {
+ public:
+  explicit ScopedIOPriority(IOPriority priority);
+  ~ScopedIOPriority();
+
+  // Returns the IO priority class of the current thread.
+  static IOPriority Current();
+
+ private:
+  const IOPriority prev_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedIOPriority);
+};
+
+// Per-directory token buckets for the IO of the background priority classes,
+// whose rates are defined by the --fs_data_dir_*_io_bytes_per_sec flags.
+//
+// This class is thread-safe.
+class DataDirIOThrottler {
+ public:
+  // The time the threads of each class spent throttled is added to the
+  // respective counter, if not null.
+  DataDirIOThrottler(scoped_refptr<Counter> flush_throttled_us,
+                     scoped_refptr<Counter> compaction_throttled_us,
+                     scoped_refptr<Counter> gc_throttled_us);
+  ~DataDirIOThrottler();
+
+  // Blocks the current thread until 'bytes' bytes of IO of its priority class
+  // fit in this directory's budget for that class. Returns immediately for
+  // foreground IO, or if the class has no budget.
+  void Throttle(uint64_t bytes);
+
+ private:
+  struct ClassBudget {
+    // Null if the class isn't throttled.
+    std::unique_ptr<Throttler> throttler;
+
+    // The largest amount of tokens which may be taken at once.
+    uint64_t max_take_bytes = 0;
+
+    scoped_refptr<Counter> throttled_us;
+  };
+
+  static void InitBudget(int64_t bytes_per_sec, scoped_refptr<Counter> throttled_us,
+                         ClassBudget* budget);
+
+  ClassBudget flush_;
+  ClassBudget compaction_;
+  ClassBudget gc_;
+
+  DISALLOW_COPY_AND_ASSIGN(DataDirIOThrottler);
+};
+
+} // namespace fs
+} // namespace kudu
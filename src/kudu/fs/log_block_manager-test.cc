@@ -53,6 +53,7 @@
 #include "kudu/gutil/strings/util.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/env.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
@@ -74,10 +75,13 @@ using std::vector;
 using strings::Substitute;
 
 DECLARE_bool(cache_force_single_shard);
+DECLARE_bool(log_block_manager_bypass_page_cache);
 DECLARE_bool(crash_on_eio);
+DECLARE_bool(enable_data_block_fsync);
 DECLARE_double(env_inject_eio);
 DECLARE_double(log_container_excess_space_before_cleanup_fraction);
 DECLARE_double(log_container_live_metadata_before_compact_ratio);
+DECLARE_int32(log_block_manager_open_threads_per_dir);
 DECLARE_int64(block_manager_max_open_files);
 DECLARE_int64(log_container_max_blocks);
 DECLARE_string(block_manager_preflush_control);
@@ -517,6 +521,44 @@ TEST_F(LogBlockManagerTest, TestBumpBlockIds) {
   ASSERT_LT(max_so_far, writer->id());
 }
 
+// Test that a transaction whose blocks span many containers closes all of them
+// durably, and that the blocks survive a restart.
+TEST_F(LogBlockManagerTest, TestCommitBlocksAcrossContainers) {
+  FLAGS_enable_data_block_fsync = true;
+  const int kNumBlocks = 8;
+  vector<BlockId> block_ids;
+  {
+    // Blocks that are open at the same time are placed in different containers.
+    vector<unique_ptr<WritableBlock>> writers;
+    for (int i = 0; i < kNumBlocks; i++) {
+      unique_ptr<WritableBlock> writer;
+      ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+      ASSERT_OK(writer->Append(Substitute("block $0", i)));
+      ASSERT_OK(writer->Finalize());
+      block_ids.push_back(writer->id());
+      writers.emplace_back(std::move(writer));
+    }
+    unique_ptr<BlockCreationTransaction> transaction = bm_->NewCreationTransaction();
+    for (auto& writer : writers) {
+      transaction->AddCreatedBlock(std::move(writer));
+    }
+    ASSERT_OK(transaction->CommitCreatedBlocks());
+  }
+  NO_FATALS(AssertNumContainers(kNumBlocks));
+
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  NO_FATALS(AssertEmptyReport(report));
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(block_ids[i], &block));
+    string expected = Substitute("block $0", i);
+    string result(expected.size(), '\0');
+    ASSERT_OK(block->Read(0, Slice(&result[0], result.size())));
+    ASSERT_EQ(expected, result);
+  }
+}
+
 // Regression test for KUDU-1190, a crash at startup when a block ID has been
 // reused.
 TEST_F(LogBlockManagerTest, TestReuseBlockIds) {
@@ -1099,6 +1141,98 @@ TEST_F(LogBlockManagerTest, TestContainerBlockLimiting) {
   NO_FATALS(AssertNumContainers(4));
 }
 
+// Test that loading the containers of a data directory in parallel yields the
+// same blocks and report as loading them one at a time.
+TEST_F(LogBlockManagerTest, TestParallelContainerLoading) {
+  // Spread the blocks over many containers, and delete some of them.
+  FLAGS_log_container_max_blocks = 10;
+  ASSERT_OK(ReopenBlockManager());
+  vector<BlockId> created;
+  for (int i = 0; i < 500; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("aaaa"));
+    ASSERT_OK(block->Close());
+    created.push_back(block->id());
+  }
+  {
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (size_t i = 0; i < created.size(); i += 3) {
+      deletion_transaction->AddDeletedBlock(created[i]);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+  }
+
+  vector<BlockId> serial_ids;
+  FsReport serial_report;
+  FLAGS_log_block_manager_open_threads_per_dir = 1;
+  ASSERT_OK(ReopenBlockManager(nullptr, &serial_report));
+  ASSERT_OK(bm_->GetAllBlockIds(&serial_ids));
+
+  vector<BlockId> parallel_ids;
+  FsReport parallel_report;
+  FLAGS_log_block_manager_open_threads_per_dir = 8;
+  ASSERT_OK(ReopenBlockManager(nullptr, &parallel_report));
+  ASSERT_OK(bm_->GetAllBlockIds(&parallel_ids));
+
+  std::sort(serial_ids.begin(), serial_ids.end(), BlockIdCompare());
+  std::sort(parallel_ids.begin(), parallel_ids.end(), BlockIdCompare());
+  ASSERT_EQ(created.size() - (created.size() + 2) / 3, parallel_ids.size());
+  ASSERT_EQ(serial_ids, parallel_ids);
+  ASSERT_EQ(serial_report.stats.lbm_container_count,
+            parallel_report.stats.lbm_container_count);
+  ASSERT_GE(parallel_report.stats.lbm_container_count, 50);
+  ASSERT_EQ(serial_report.stats.live_block_count, parallel_report.stats.live_block_count);
+  ASSERT_EQ(serial_report.stats.live_block_bytes, parallel_report.stats.live_block_bytes);
+}
+
+// Test that blocks are intact when their data is evicted from the page cache
+// after every write and read.
+TEST_F(LogBlockManagerTest, TestBypassPageCache) {
+  FLAGS_log_block_manager_bypass_page_cache = true;
+  const string kData(16 * 1024, 'x');
+  unique_ptr<WritableBlock> block;
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+  ASSERT_OK(block->Append(kData));
+  ASSERT_OK(block->Close());
+
+  unique_ptr<ReadableBlock> read_block;
+  ASSERT_OK(bm_->OpenBlock(block->id(), &read_block));
+  for (int i = 0; i < 2; i++) {
+    string result(kData.size(), '\0');
+    ASSERT_OK(read_block->Read(0, Slice(&result[0], result.size())));
+    ASSERT_EQ(kData, result);
+  }
+}
+
+// Measures the memory used to track each live block, both for blocks created
+// at runtime and for blocks loaded from disk at startup.
+TEST_F(LogBlockManagerTest, TestBlockMapMemoryFootprint) {
+  const int kNumBlocks = AllowSlowTests() ? 100000 : 10000;
+  // The LogBlock itself plus its share of the sparse block map.
+  const int64_t kMaxBytesPerBlock = 96;
+
+  ASSERT_EQ(0, bm_->mem_tracker_->consumption());
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("a"));
+    ASSERT_OK(block->Close());
+  }
+  int64_t runtime_bytes = bm_->mem_tracker_->consumption();
+  LOG(INFO) << Substitute("$0 bytes per block for $1 created blocks",
+                          static_cast<double>(runtime_bytes) / kNumBlocks, kNumBlocks);
+  ASSERT_LE(runtime_bytes, kMaxBytesPerBlock * kNumBlocks);
+
+  ASSERT_OK(ReopenBlockManager());
+  int64_t startup_bytes = bm_->mem_tracker_->consumption();
+  LOG(INFO) << Substitute("$0 bytes per block for $1 loaded blocks",
+                          static_cast<double>(startup_bytes) / kNumBlocks, kNumBlocks);
+  ASSERT_LE(startup_bytes, kMaxBytesPerBlock * kNumBlocks);
+}
+
 TEST_F(LogBlockManagerTest, TestMisalignedBlocksFuzz) {
   FLAGS_log_container_preallocate_bytes = 0;
   const int kNumBlocks = 100;
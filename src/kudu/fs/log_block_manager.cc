@@ -21,6 +21,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <errno.h>
+#include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -36,6 +38,7 @@
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/message.h>
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/block_manager_util.h"
@@ -43,6 +46,7 @@
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_report.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
@@ -62,6 +66,7 @@
 #include "kudu/util/file_cache.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -73,6 +78,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/sorted_disjoint_interval_list.h"
 #include "kudu/util/test_util_prod.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DECLARE_bool(enable_data_block_fsync);
@@ -107,6 +113,24 @@ DEFINE_double(log_container_live_metadata_before_compact_ratio, 0.50,
               "the container's metadata file will be compacted at startup.");
 TAG_FLAG(log_container_live_metadata_before_compact_ratio, experimental);
 
+DEFINE_int32(log_block_manager_open_threads_per_dir, 4,
+             "Number of threads with which the log block manager loads the "
+             "containers of each data directory at startup. Raising it speeds "
+             "up startup on devices which serve concurrent reads well, such as "
+             "SSDs.");
+TAG_FLAG(log_block_manager_open_threads_per_dir, advanced);
+TAG_FLAG(log_block_manager_open_threads_per_dir, evolving);
+DEFINE_validator(log_block_manager_open_threads_per_dir,
+                 [](const char* /*flagname*/, int32_t value) { return value > 0; });
+
+DEFINE_bool(log_block_manager_bypass_page_cache, false,
+            "Whether to ask the kernel to evict block data from the page cache "
+            "once it has been read, or written and synced. Reads of hot data "
+            "are then served by the block cache alone instead of being cached "
+            "in memory twice.");
+TAG_FLAG(log_block_manager_bypass_page_cache, experimental);
+TAG_FLAG(log_block_manager_bypass_page_cache, runtime);
+
 DEFINE_bool(log_block_manager_test_hole_punching, true,
             "Ensure hole punching is supported by the underlying filesystem");
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
@@ -243,11 +267,19 @@ class LogBlock : public RefCountedThreadSafe<LogBlock> {
   const int64_t length_;
 
   // The block deletion transaction with which this block has been registered.
-  shared_ptr<LogBlockDeletionTransaction> transaction_;
+  //
+  // There is one LogBlock per live block, so they can number in the millions.
+  // Only deleted blocks need a transaction, so it is allocated out of line to
+  // keep the LogBlock in a smaller malloc size class.
+  unique_ptr<shared_ptr<LogBlockDeletionTransaction>> transaction_;
 
   DISALLOW_COPY_AND_ASSIGN(LogBlock);
 };
 
+// A refcount, four 8-byte fields and a pointer: 48 bytes on LP64 platforms.
+static_assert(sizeof(void*) != 8 || sizeof(LogBlock) <= 48,
+              "LogBlock is allocated once per block and must stay compact");
+
 ////////////////////////////////////////////////////////////
 // LogWritableBlock (declaration)
 ////////////////////////////////////////////////////////////
@@ -298,6 +330,8 @@ class LogWritableBlock : public WritableBlock {
 
   LogBlockContainer* container() const { return container_; }
 
+  int64_t block_offset() const { return block_offset_; }
+
  private:
   // The owning container. Must outlive the block.
   LogBlockContainer* container_;
@@ -366,6 +400,16 @@ class LogBlockContainer {
   // If successful, adds all blocks to the block manager's in-memory maps.
   Status DoCloseBlocks(const vector<LogWritableBlock*>& blocks, SyncMode mode);
 
+  // Like the above, but closes the blocks of several containers together,
+  // syncing each container's files and each data directory at most once.
+  //
+  // Blocks of a container that fails are left unclosed and the container is
+  // made read-only; blocks of the other containers are still closed. Returns
+  // the first failure.
+  typedef unordered_map<LogBlockContainer*, vector<LogWritableBlock*>> BlocksByContainerMap;
+  static Status DoCloseBlocks(const BlocksByContainerMap& blocks_by_container,
+                              SyncMode mode);
+
   // Frees the space associated with a block or a group of blocks at 'offset'
   // and 'length'. This is a physical operation, not a logical one; a separate
   // AppendMetadata() is required to record the deletion in container metadata.
@@ -373,6 +417,12 @@ class LogBlockContainer {
   // The on-disk effects of this call are made durable only after SyncData().
   Status PunchHole(int64_t offset, int64_t length);
 
+  // Evicts this container's data file range given by 'offset' and 'length'
+  // from the page cache if --log_block_manager_bypass_page_cache is set.
+  //
+  // Failures are logged and otherwise ignored, as eviction is only a hint.
+  void MaybeDropDataCache(int64_t offset, int64_t length);
+
   // Executes a hole punching operation at 'offset' with the given 'length'.
   void ContainerDeletionAsync(int64_t offset, int64_t length);
 
@@ -397,11 +447,20 @@ class LogBlockContainer {
   // See RWFile::ReadV().
   Status ReadVData(int64_t offset, ArrayView<Slice> results) const;
 
+  // See RWFile::Map().
+  Status MapData(int64_t offset, int64_t length, shared_ptr<FileMapping>* mapping) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
   Status AppendMetadata(const BlockRecordPB& pb);
 
+  // Appends all of 'pbs' to this container's metadata file with a single
+  // write.
+  //
+  // The on-disk effects of this call are made durable only after SyncMetadata().
+  Status AppendMetadata(const vector<BlockRecordPB>& pbs);
+
   // Asynchronously flush this container's data file from 'offset' through
   // to 'length'.
   //
@@ -908,41 +967,88 @@ Status LogBlockContainer::ProcessRecord(
 
 Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
                                         SyncMode mode) {
-  auto sync_blocks = [&]() -> Status {
-    if (mode == SYNC) {
-      VLOG(3) << "Syncing data file " << data_file_->filename();
-      RETURN_NOT_OK(SyncData());
+  return DoCloseBlocks({ { this, blocks } }, mode);
+}
+
+Status LogBlockContainer::DoCloseBlocks(const BlocksByContainerMap& blocks_by_container,
+                                        SyncMode mode) {
+  Status first_failure;
+  unordered_set<LogBlockContainer*> failed_containers;
+
+  // Runs 'step' on each container that hasn't yet failed. A container whose
+  // step fails is made read-only to forbid further writes: because its on-disk
+  // state may contain partial/incomplete data/metadata at this point, it is
+  // not safe to either overwrite it or append to it. The remaining containers
+  // are unaffected and proceed to the next step.
+  auto for_each_container = [&](const std::function<Status(
+      LogBlockContainer*, const vector<LogWritableBlock*>&)>& step) {
+    for (const auto& e : blocks_by_container) {
+      LogBlockContainer* container = e.first;
+      if (ContainsKey(failed_containers, container)) {
+        continue;
+      }
+      Status s = step(container, e.second);
+      if (PREDICT_FALSE(!s.ok())) {
+        container->SetReadOnly(s);
+        failed_containers.insert(container);
+        if (first_failure.ok()) first_failure = s;
+      }
     }
+  };
 
-    // Append metadata only after data is synced so that there's
-    // no chance of metadata landing on the disk before the data.
+  // Each step is applied to all containers before moving on to the next one.
+  // When blocks of many containers are closed together (e.g. at the end of a
+  // flush or compaction), this lets the writeback of every container's
+  // metadata proceed at once instead of one fsync() after another.
+  if (mode == SYNC) {
+    for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& blocks) {
+      VLOG(3) << "Syncing data file " << c->data_file_->filename();
+      RETURN_NOT_OK(c->SyncData());
+      for (const auto* block : blocks) {
+        c->MaybeDropDataCache(block->block_offset(), block->BytesAppended());
+      }
+      return Status::OK();
+    });
+  }
+
+  // Append metadata only after data is synced so that there's
+  // no chance of metadata landing on the disk before the data.
+  for_each_container([](LogBlockContainer* /* c */, const vector<LogWritableBlock*>& blocks) {
     for (auto* block : blocks) {
       RETURN_NOT_OK_PREPEND(block->AppendMetadata(),
                             "unable to append block's metadata during close");
     }
+    return Status::OK();
+  });
 
-    if (mode == SYNC) {
-      VLOG(3) << "Syncing metadata file " << metadata_file_->filename();
-      RETURN_NOT_OK(SyncMetadata());
+  if (mode == SYNC) {
+    if (blocks_by_container.size() > 1 && FLAGS_enable_data_block_fsync) {
+      for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& /* blocks */) {
+        return c->FlushMetadata();
+      });
     }
+    for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& /* blocks */) {
+      VLOG(3) << "Syncing metadata file " << c->metadata_file_->filename();
+      return c->SyncMetadata();
+    });
+  }
 
-    RETURN_NOT_OK(block_manager()->SyncContainer(*this));
+  // Each directory is synced at most once, no matter how many of its
+  // containers are closed here.
+  for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& /* blocks */) {
+    return c->block_manager()->SyncContainer(*c);
+  });
 
-    for (LogWritableBlock* block : blocks) {
-      if (blocks.size() > 1) DCHECK_EQ(block->state(), WritableBlock::State::FINALIZED);
+  for (const auto& e : blocks_by_container) {
+    if (ContainsKey(failed_containers, e.first)) {
+      continue;
+    }
+    for (LogWritableBlock* block : e.second) {
+      if (e.second.size() > 1) DCHECK_EQ(block->state(), WritableBlock::State::FINALIZED);
       block->DoClose();
     }
-    return Status::OK();
-  };
-
-  Status s = sync_blocks();
-  if (!s.ok()) {
-    // Make container read-only to forbid further writes in case of failure.
-    // Because the on-disk state may contain partial/incomplete data/metadata at
-    // this point, it is not safe to either overwrite it or append to it.
-    SetReadOnly(s);
   }
-  return s;
+  return first_failure;
 }
 
 Status LogBlockContainer::PunchHole(int64_t offset, int64_t length) {
@@ -959,6 +1065,19 @@ Status LogBlockContainer::PunchHole(int64_t offset, int64_t length) {
   return Status::OK();
 }
 
+void LogBlockContainer::MaybeDropDataCache(int64_t offset, int64_t length) {
+  if (!FLAGS_log_block_manager_bypass_page_cache || length == 0) {
+    return;
+  }
+  DCHECK_GE(offset, 0);
+  DCHECK_GT(length, 0);
+  Status s = data_file_->DropCache(offset, length);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << Substitute(
+        "Could not drop cached data of container $0: $1", ToString(), s.ToString());
+  }
+}
+
 Status LogBlockContainer::WriteData(int64_t offset, const Slice& data) {
   return WriteVData(offset, ArrayView<const Slice>(&data, 1));
 }
@@ -967,7 +1086,12 @@ Status LogBlockContainer::WriteVData(int64_t offset, ArrayView<const Slice> data
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   DCHECK_GE(offset, next_block_offset());
 
-  RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  {
+    data_dir_->WriteStarted();
+    MonoTime start = MonoTime::Now();
+    SCOPED_CLEANUP({ data_dir_->WriteFinished(MonoTime::Now() - start); });
+    RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
+  }
 
   // This append may have changed the container size if:
   // 1. It was large enough that it blew out the preallocated space.
@@ -993,6 +1117,14 @@ Status LogBlockContainer::ReadVData(int64_t offset, ArrayView<Slice> results) co
   return Status::OK();
 }
 
+Status LogBlockContainer::MapData(int64_t offset, int64_t length,
+                                  shared_ptr<FileMapping>* mapping) const {
+  DCHECK_GE(offset, 0);
+  DCHECK_GE(length, 0);
+  RETURN_NOT_OK_HANDLE_ERROR(data_file_->Map(offset, length, mapping));
+  return Status::OK();
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   // Note: We don't check for sufficient disk space for metadata writes in
@@ -1001,6 +1133,18 @@ Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   return Status::OK();
 }
 
+Status LogBlockContainer::AppendMetadata(const vector<BlockRecordPB>& pbs) {
+  RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
+  vector<const google::protobuf::Message*> msgs;
+  msgs.reserve(pbs.size());
+  for (const auto& pb : pbs) {
+    msgs.push_back(&pb);
+  }
+  // As above, deletions must succeed on full disks, so there's no space check.
+  RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->AppendBatch(msgs));
+  return Status::OK();
+}
+
 Status LogBlockContainer::FlushData(int64_t offset, int64_t length) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   DCHECK_GE(offset, 0);
@@ -1019,6 +1163,9 @@ Status LogBlockContainer::SyncData() {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    data_dir_->WriteStarted();
+    MonoTime start = MonoTime::Now();
+    SCOPED_CLEANUP({ data_dir_->WriteFinished(MonoTime::Now() - start); });
     RETURN_NOT_OK_HANDLE_ERROR(data_file_->Sync());
   }
   return Status::OK();
@@ -1192,7 +1339,7 @@ Status LogBlockCreationTransaction::CommitCreatedBlocks() {
   }
 
   VLOG(3) << "Closing " << created_blocks_.size() << " blocks";
-  unordered_map<LogBlockContainer*, vector<LogWritableBlock*>> created_block_map;
+  LogBlockContainer::BlocksByContainerMap created_block_map;
   for (const auto& block : created_blocks_) {
     if (FLAGS_block_manager_preflush_control == "close") {
       // Ask the kernel to begin writing out each block's dirty data. This is
@@ -1206,10 +1353,8 @@ Status LogBlockCreationTransaction::CommitCreatedBlocks() {
   // Close all blocks and sync the blocks belonging to the same
   // container together to reduce fsync() usage, waiting for them
   // to become durable.
-  for (const auto& entry : created_block_map) {
-    RETURN_NOT_OK(entry.first->DoCloseBlocks(entry.second,
-                                             LogBlockContainer::SyncMode::SYNC));
-  }
+  RETURN_NOT_OK(LogBlockContainer::DoCloseBlocks(created_block_map,
+                                                 LogBlockContainer::SyncMode::SYNC));
   created_blocks_.clear();
   return Status::OK();
 }
@@ -1342,7 +1487,7 @@ void LogBlock::RegisterDeletion(
   DCHECK(!transaction_);
   DCHECK(transaction);
 
-  transaction_ = transaction;
+  transaction_.reset(new shared_ptr<LogBlockDeletionTransaction>(transaction));
 }
 
 ////////////////////////////////////////////////////////////
@@ -1454,6 +1599,7 @@ Status LogWritableBlock::AppendV(ArrayView<const Slice> data) {
   int64_t cur_block_offset = block_offset_ + block_length_;
   RETURN_NOT_OK(container_->EnsurePreallocated(cur_block_offset, data_size));
 
+  container_->data_dir()->io_throttler()->Throttle(data_size);
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   RETURN_NOT_OK(container_->WriteVData(cur_block_offset, data));
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
@@ -1543,6 +1689,25 @@ Status LogWritableBlock::AppendMetadata() {
 // LogReadableBlock
 ////////////////////////////////////////////////////////////
 
+// A mapping of a log-backed block's data.
+//
+// Holds a reference to the block, so that its hole isn't punched until the
+// mapping is destroyed. The container's files may be deleted in the meantime,
+// but that doesn't affect the mapping.
+class LogBlockMapping : public FileMapping {
+ public:
+  LogBlockMapping(shared_ptr<FileMapping> mapping, scoped_refptr<LogBlock> log_block)
+      : mapping_(std::move(mapping)),
+        log_block_(std::move(log_block)) {
+  }
+
+  Slice data() const override { return mapping_->data(); }
+
+ private:
+  const shared_ptr<FileMapping> mapping_;
+  const scoped_refptr<LogBlock> log_block_;
+};
+
 // A log-backed block that has been opened for reading.
 //
 // Refers to a LogBlock representing the block's persisted metadata.
@@ -1563,6 +1728,8 @@ class LogReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Map(shared_ptr<FileMapping>* mapping) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -1639,9 +1806,11 @@ Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
                                       log_block_->offset() + log_block_->length()));
   }
 
+  container_->data_dir()->io_throttler()->Throttle(read_length);
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   RETURN_NOT_OK(container_->ReadVData(read_offset, results));
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
+  container_->MaybeDropDataCache(read_offset, read_length);
 
   int64_t dur = end_time - start_time;
   TRACE_COUNTER_INCREMENT("lbm_read_time_us", dur);
@@ -1655,6 +1824,16 @@ Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
   return Status::OK();
 }
 
+Status LogReadableBlock::Map(shared_ptr<FileMapping>* mapping) const {
+  DCHECK(!closed_.Load());
+
+  shared_ptr<FileMapping> container_mapping;
+  RETURN_NOT_OK(container_->MapData(log_block_->offset(), log_block_->length(),
+                                    &container_mapping));
+  *mapping = std::make_shared<LogBlockMapping>(std::move(container_mapping), log_block_);
+  return Status::OK();
+}
+
 size_t LogReadableBlock::memory_footprint() const {
   return kudu_malloc_usable_size(this);
 }
@@ -2084,18 +2263,30 @@ Status LogBlockManager::RemoveLogBlocks(vector<BlockId> block_ids,
     metrics()->bytes_under_management->DecrementBy(blocks_length);
   }
 
+  // Group the deletions by container so that each container's delete records
+  // are appended with a single write.
+  unordered_map<LogBlockContainer*, vector<scoped_refptr<LogBlock>>> lbs_by_container;
   for (auto& lb : lbs) {
     VLOG(3) << "Deleting block " << lb->block_id();
     lb->container()->BlockDeleted(lb);
+    LogBlockContainer* container = lb->container();
+    lbs_by_container[container].emplace_back(std::move(lb));
+  }
+
+  const int64_t now_us = GetCurrentTimeMicros();
+  for (auto& entry : lbs_by_container) {
+    vector<BlockRecordPB> records(entry.second.size());
+    for (size_t i = 0; i < entry.second.size(); i++) {
+      BlockRecordPB* record = &records[i];
+      entry.second[i]->block_id().CopyToPB(record->mutable_block_id());
+      record->set_op_type(DELETE);
+      record->set_timestamp_us(now_us);
+    }
 
-    // Record the on-disk deletion.
+    // Record the on-disk deletions.
     //
-    // TODO(unknown): what if this fails? Should we restore the in-memory block?
-    BlockRecordPB record;
-    lb->block_id().CopyToPB(record.mutable_block_id());
-    record.set_op_type(DELETE);
-    record.set_timestamp_us(GetCurrentTimeMicros());
-    Status s = lb->container()->AppendMetadata(record);
+    // TODO(unknown): what if this fails? Should we restore the in-memory blocks?
+    Status s = entry.first->AppendMetadata(records);
 
     // We don't bother fsyncing the metadata append for deletes in order to avoid
     // the disk overhead. Even if we did fsync it, we'd still need to account for
@@ -2110,8 +2301,10 @@ Status LogBlockManager::RemoveLogBlocks(vector<BlockId> block_ids,
             "Unable to append deletion record to block metadata");
       }
     } else {
-      deleted->emplace_back(lb->block_id());
-      log_blocks->emplace_back(std::move(lb));
+      for (auto& lb : entry.second) {
+        deleted->emplace_back(lb->block_id());
+        log_blocks->emplace_back(std::move(lb));
+      }
     }
   }
 
@@ -2148,6 +2341,195 @@ Status LogBlockManager::RemoveLogBlockUnlocked(const BlockId& block_id,
   return Status::OK();
 }
 
+Status LogBlockManager::LoadContainer(
+    DataDir* dir,
+    const string& container_name,
+    FsReport* report,
+    vector<scoped_refptr<internal::LogBlock>>* need_repunching,
+    vector<string>* dead_containers,
+    unordered_map<string, vector<BlockRecordPB>>* low_live_block_containers) {
+  unique_ptr<LogBlockContainer> container;
+  Status s = LogBlockContainer::Open(
+      this, dir, report, container_name, &container);
+  if (s.IsAborted()) {
+    // Skip the container. Open() added a record of it to 'report' for us.
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, Substitute("Could not open container $0", container_name));
+
+  // Process the records, building a container-local map for live blocks and
+  // a list of dead blocks.
+  //
+  // It's important that we don't try to add these blocks to the global map
+  // incrementally as we see each record, since it's possible that one container
+  // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
+  // If we processed those two containers in this order, then upon processing
+  // the second container, we'd think there was a duplicate block. Building
+  // the container-local map first ensures that we discount deleted blocks
+  // before checking for duplicate IDs.
+  //
+  // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
+  // exceedingly unlikely. However, we might have old data which still exhibits
+  // the above issue.
+  UntrackedBlockMap live_blocks;
+  BlockRecordMap live_block_records;
+  vector<scoped_refptr<internal::LogBlock>> dead_blocks;
+  uint64_t max_block_id = 0;
+  RETURN_NOT_OK_PREPEND(container->ProcessRecords(report,
+                                                  &live_blocks,
+                                                  &live_block_records,
+                                                  &dead_blocks,
+                                                  &max_block_id),
+                        Substitute("Could not process records in container $0",
+                                   container->ToString()));
+
+  // With deleted blocks out of the way, check for misaligned blocks.
+  //
+  // We could also enforce that the record's offset is aligned with the
+  // underlying filesystem's block size, an invariant maintained by the log
+  // block manager. However, due to KUDU-1793, that invariant may have been
+  // broken, so we'll note but otherwise allow it.
+  for (const auto& e : live_blocks) {
+    if (PREDICT_FALSE(e.second->offset() %
+                      container->instance()->filesystem_block_size_bytes() != 0)) {
+      report->misaligned_block_check->entries.emplace_back(
+          container->ToString(), e.first);
+
+    }
+  }
+
+  if (container->full()) {
+    // Full containers without any live blocks can be deleted outright.
+    //
+    // TODO(adar): this should be reported as an inconsistency once dead
+    // container deletion is also done in real time. Until then, it would be
+    // confusing to report it as such since it'll be a natural event at startup.
+    if (container->live_blocks() == 0) {
+      DCHECK(live_blocks.empty());
+      dead_containers->emplace_back(container->ToString());
+    } else if (static_cast<double>(container->live_blocks()) /
+        container->total_blocks() <= FLAGS_log_container_live_metadata_before_compact_ratio) {
+      // Metadata files of containers with very few live blocks will be compacted.
+      //
+      // TODO(adar): this should be reported as an inconsistency once
+      // container metadata compaction is also done in realtime. Until then,
+      // it would be confusing to report it as such since it'll be a natural
+      // event at startup.
+      vector<BlockRecordPB> records(live_block_records.size());
+      int i = 0;
+      for (auto& e : live_block_records) {
+        records[i].Swap(&e.second);
+        i++;
+      }
+
+      // Sort the records such that their ordering reflects the ordering in
+      // the pre-compacted metadata file.
+      //
+      // This is preferred to storing the records in an order-preserving
+      // container (such as std::map) because while records are temporarily
+      // retained for every container, only some containers will actually
+      // undergo metadata compaction.
+      std::sort(records.begin(), records.end(),
+                [](const BlockRecordPB& a, const BlockRecordPB& b) {
+        // Sort by timestamp.
+        if (a.timestamp_us() != b.timestamp_us()) {
+          return a.timestamp_us() < b.timestamp_us();
+        }
+
+        // If the timestamps match, sort by offset.
+        //
+        // If the offsets also match (i.e. both blocks are of zero length),
+        // it doesn't matter which of the two records comes first.
+        return a.offset() < b.offset();
+      });
+
+      (*low_live_block_containers)[container->ToString()] = std::move(records);
+    }
+
+    // Having processed the block records, let's check whether any full
+    // containers have any extra space (left behind after a crash or from an
+    // older version of Kudu).
+    //
+    // Filesystems are unpredictable beasts and may misreport the amount of
+    // space allocated to a file in various interesting ways. Some examples:
+    // - XFS's speculative preallocation feature may artificially enlarge the
+    //   container's data file without updating its file size. This makes the
+    //   file size untrustworthy for the purposes of measuring allocated space.
+    //   See KUDU-1856 for more details.
+    // - On el6.6/ext4 a container data file that consumed ~32K according to
+    //   its extent tree was actually reported as consuming an additional fs
+    //   block (2k) of disk space. A similar container data file (generated
+    //   via the same workload) on Ubuntu 16.04/ext4 did not exhibit this.
+    //   The suspicion is that older versions of ext4 include interior nodes
+    //   of the extent tree when reporting file block usage.
+    //
+    // To deal with these issues, our extra space cleanup code (deleted block
+    // repunching and container truncation) is gated on an "actual disk space
+    // consumed" heuristic. To prevent unnecessary triggering of the
+    // heuristic, we allow for some slop in our size measurements. The exact
+    // amount of slop is configurable via
+    // log_container_excess_space_before_cleanup_fraction.
+    //
+    // Too little slop and we'll do unnecessary work at startup. Too much and
+    // more unused space may go unreclaimed.
+    string data_filename = StrCat(container->ToString(), kContainerDataFileSuffix);
+    uint64_t reported_size;
+    s = env_->GetFileSizeOnDisk(data_filename, &reported_size);
+    if (!s.ok()) {
+      HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(ErrorHandlerType::DISK, dir));
+      return s.CloneAndPrepend(Substitute(
+          "Could not get on-disk file size of container $0", container->ToString()));
+    }
+    int64_t cleanup_threshold_size = container->live_bytes_aligned() *
+        (1 + FLAGS_log_container_excess_space_before_cleanup_fraction);
+    if (reported_size > cleanup_threshold_size) {
+      report->full_container_space_check->entries.emplace_back(
+          container->ToString(), reported_size - container->live_bytes_aligned());
+
+      // If the container is to be deleted outright, don't bother repunching
+      // its blocks. The report entry remains, however, so it's clear that
+      // there was a space discrepancy.
+      if (container->live_blocks()) {
+        need_repunching->insert(need_repunching->end(),
+                                dead_blocks.begin(), dead_blocks.end());
+      }
+    }
+
+    report->stats.lbm_full_container_count++;
+  }
+  report->stats.live_block_bytes += container->live_bytes();
+  report->stats.live_block_bytes_aligned += container->live_bytes_aligned();
+  report->stats.live_block_count += container->live_blocks();
+  report->stats.lbm_container_count++;
+
+  next_block_id_.StoreMax(max_block_id + 1);
+
+  // Under the lock, merge this map into the main block map and add
+  // the container.
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    // To avoid cacheline contention during startup, we aggregate all of the
+    // memory in a local and add it to the mem-tracker in a single increment
+    // at the end.
+    int64_t mem_usage = 0;
+    for (UntrackedBlockMap::value_type& e : live_blocks) {
+      int block_mem = kudu_malloc_usable_size(e.second.get());
+      if (!AddLogBlockUnlocked(std::move(e.second))) {
+        // TODO(adar): track as an inconsistency?
+        LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
+                   << " which already is alive from another container when "
+                   << " processing container " << container->ToString();
+      }
+      mem_usage += block_mem;
+    }
+
+    mem_tracker_->Consume(mem_usage);
+    AddNewContainerUnlocked(container.get());
+    MakeContainerAvailableUnlocked(container.release());
+  }
+  return Status::OK();
+}
+
 void LogBlockManager::OpenDataDir(DataDir* dir,
                                   FsReport* report,
                                   Status* result_status) {
@@ -2176,8 +2558,9 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
   // files will be compacted during repair.
   unordered_map<string, vector<BlockRecordPB>> low_live_block_containers;
 
-  // Find all containers and open them.
+  // Find all containers.
   unordered_set<string> containers_seen;
+  vector<string> container_names;
   vector<string> children;
   Status s = env_->GetChildren(dir->dir(), &children);
   if (!s.ok()) {
@@ -2186,7 +2569,6 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         "Could not list children of $0", dir->dir()));
     return;
   }
-  MonoTime last_opened_container_log_time = MonoTime::Now();
   for (const string& child : children) {
     string container_name;
     if (!TryStripSuffixString(
@@ -2195,206 +2577,89 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
             child, LogBlockManager::kContainerMetadataFileSuffix, &container_name)) {
       continue;
     }
-    if (!InsertIfNotPresent(&containers_seen, container_name)) {
-      continue;
-    }
-
-    unique_ptr<LogBlockContainer> container;
-    s = LogBlockContainer::Open(
-        this, dir, &local_report, container_name, &container);
-    if (s.IsAborted()) {
-      // Skip the container. Open() added a record of it to 'local_report' for us.
-      continue;
-    }
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", container_name));
-      return;
-    }
-
-    // Process the records, building a container-local map for live blocks and
-    // a list of dead blocks.
-    //
-    // It's important that we don't try to add these blocks to the global map
-    // incrementally as we see each record, since it's possible that one container
-    // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
-    // If we processed those two containers in this order, then upon processing
-    // the second container, we'd think there was a duplicate block. Building
-    // the container-local map first ensures that we discount deleted blocks
-    // before checking for duplicate IDs.
-    //
-    // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
-    // exceedingly unlikely. However, we might have old data which still exhibits
-    // the above issue.
-    UntrackedBlockMap live_blocks;
-    BlockRecordMap live_block_records;
-    vector<scoped_refptr<internal::LogBlock>> dead_blocks;
-    uint64_t max_block_id = 0;
-    s = container->ProcessRecords(&local_report,
-                                  &live_blocks,
-                                  &live_block_records,
-                                  &dead_blocks,
-                                  &max_block_id);
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not process records in container $0", container->ToString()));
-      return;
-    }
-
-    // With deleted blocks out of the way, check for misaligned blocks.
-    //
-    // We could also enforce that the record's offset is aligned with the
-    // underlying filesystem's block size, an invariant maintained by the log
-    // block manager. However, due to KUDU-1793, that invariant may have been
-    // broken, so we'll note but otherwise allow it.
-    for (const auto& e : live_blocks) {
-      if (PREDICT_FALSE(e.second->offset() %
-                        container->instance()->filesystem_block_size_bytes() != 0)) {
-        local_report.misaligned_block_check->entries.emplace_back(
-            container->ToString(), e.first);
-
-      }
+    if (InsertIfNotPresent(&containers_seen, container_name)) {
+      container_names.emplace_back(std::move(container_name));
     }
+  }
 
-    if (container->full()) {
-      // Full containers without any live blocks can be deleted outright.
-      //
-      // TODO(adar): this should be reported as an inconsistency once dead
-      // container deletion is also done in real time. Until then, it would be
-      // confusing to report it as such since it'll be a natural event at startup.
-      if (container->live_blocks() == 0) {
-        DCHECK(live_blocks.empty());
-        dead_containers.emplace_back(container->ToString());
-      } else if (static_cast<double>(container->live_blocks()) /
-          container->total_blocks() <= FLAGS_log_container_live_metadata_before_compact_ratio) {
-        // Metadata files of containers with very few live blocks will be compacted.
-        //
-        // TODO(adar): this should be reported as an inconsistency once
-        // container metadata compaction is also done in realtime. Until then,
-        // it would be confusing to report it as such since it'll be a natural
-        // event at startup.
-        vector<BlockRecordPB> records(live_block_records.size());
-        int i = 0;
-        for (auto& e : live_block_records) {
-          records[i].Swap(&e.second);
-          i++;
+  // Open the containers. Most of the time is spent reading their metadata
+  // files, so they are loaded in parallel: on a data directory with millions
+  // of blocks, a single thread leaves the device mostly idle.
+  //
+  // Each container is loaded into its own report and repair lists, which are
+  // then merged into the directory's under 'load_lock'.
+  unique_ptr<ThreadPool> pool;
+  s = ThreadPoolBuilder(Substitute("lbm open $0", dir->dir()))
+      .set_max_threads(FLAGS_log_block_manager_open_threads_per_dir)
+      .Build(&pool);
+  if (!s.ok()) {
+    *result_status = s.CloneAndPrepend("Could not create container loading pool");
+    return;
+  }
+  std::mutex load_lock;
+  Status load_status;
+  MonoTime last_opened_container_log_time = MonoTime::Now();
+  for (const string& container_name : container_names) {
+    s = pool->SubmitFunc([&, container_name]() {
+      {
+        std::lock_guard<std::mutex> l(load_lock);
+        if (!load_status.ok()) {
+          // Another container failed to load, so the directory won't be used.
+          return;
         }
-
-        // Sort the records such that their ordering reflects the ordering in
-        // the pre-compacted metadata file.
-        //
-        // This is preferred to storing the records in an order-preserving
-        // container (such as std::map) because while records are temporarily
-        // retained for every container, only some containers will actually
-        // undergo metadata compaction.
-        std::sort(records.begin(), records.end(),
-                  [](const BlockRecordPB& a, const BlockRecordPB& b) {
-          // Sort by timestamp.
-          if (a.timestamp_us() != b.timestamp_us()) {
-            return a.timestamp_us() < b.timestamp_us();
-          }
-
-          // If the timestamps match, sort by offset.
-          //
-          // If the offsets also match (i.e. both blocks are of zero length),
-          // it doesn't matter which of the two records comes first.
-          return a.offset() < b.offset();
-        });
-
-        low_live_block_containers[container->ToString()] = std::move(records);
       }
-
-      // Having processed the block records, let's check whether any full
-      // containers have any extra space (left behind after a crash or from an
-      // older version of Kudu).
-      //
-      // Filesystems are unpredictable beasts and may misreport the amount of
-      // space allocated to a file in various interesting ways. Some examples:
-      // - XFS's speculative preallocation feature may artificially enlarge the
-      //   container's data file without updating its file size. This makes the
-      //   file size untrustworthy for the purposes of measuring allocated space.
-      //   See KUDU-1856 for more details.
-      // - On el6.6/ext4 a container data file that consumed ~32K according to
-      //   its extent tree was actually reported as consuming an additional fs
-      //   block (2k) of disk space. A similar container data file (generated
-      //   via the same workload) on Ubuntu 16.04/ext4 did not exhibit this.
-      //   The suspicion is that older versions of ext4 include interior nodes
-      //   of the extent tree when reporting file block usage.
-      //
-      // To deal with these issues, our extra space cleanup code (deleted block
-      // repunching and container truncation) is gated on an "actual disk space
-      // consumed" heuristic. To prevent unnecessary triggering of the
-      // heuristic, we allow for some slop in our size measurements. The exact
-      // amount of slop is configurable via
-      // log_container_excess_space_before_cleanup_fraction.
-      //
-      // Too little slop and we'll do unnecessary work at startup. Too much and
-      // more unused space may go unreclaimed.
-      string data_filename = StrCat(container->ToString(), kContainerDataFileSuffix);
-      uint64_t reported_size;
-      s = env_->GetFileSizeOnDisk(data_filename, &reported_size);
-      if (!s.ok()) {
-        HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(ErrorHandlerType::DISK, dir));
-        *result_status = s.CloneAndPrepend(Substitute(
-            "Could not get on-disk file size of container $0", container->ToString()));
+      FsReport container_report;
+      container_report.full_container_space_check.emplace();
+      container_report.incomplete_container_check.emplace();
+      container_report.malformed_record_check.emplace();
+      container_report.misaligned_block_check.emplace();
+      container_report.partial_record_check.emplace();
+      vector<scoped_refptr<internal::LogBlock>> container_need_repunching;
+      vector<string> container_dead_containers;
+      unordered_map<string, vector<BlockRecordPB>> container_low_live_block_containers;
+      Status container_status = LoadContainer(dir, container_name, &container_report,
+                                              &container_need_repunching,
+                                              &container_dead_containers,
+                                              &container_low_live_block_containers);
+
+      std::lock_guard<std::mutex> l(load_lock);
+      if (!container_status.ok()) {
+        if (load_status.ok()) {
+          load_status = container_status;
+        }
         return;
       }
-      int64_t cleanup_threshold_size = container->live_bytes_aligned() *
-          (1 + FLAGS_log_container_excess_space_before_cleanup_fraction);
-      if (reported_size > cleanup_threshold_size) {
-        local_report.full_container_space_check->entries.emplace_back(
-            container->ToString(), reported_size - container->live_bytes_aligned());
-
-        // If the container is to be deleted outright, don't bother repunching
-        // its blocks. The report entry remains, however, so it's clear that
-        // there was a space discrepancy.
-        if (container->live_blocks()) {
-          need_repunching.insert(need_repunching.end(),
-                                 dead_blocks.begin(), dead_blocks.end());
-        }
+      local_report.MergeFrom(container_report);
+      need_repunching.insert(need_repunching.end(),
+                             std::make_move_iterator(container_need_repunching.begin()),
+                             std::make_move_iterator(container_need_repunching.end()));
+      dead_containers.insert(dead_containers.end(),
+                             std::make_move_iterator(container_dead_containers.begin()),
+                             std::make_move_iterator(container_dead_containers.end()));
+      for (auto& e : container_low_live_block_containers) {
+        low_live_block_containers.emplace(e.first, std::move(e.second));
       }
 
-      local_report.stats.lbm_full_container_count++;
-    }
-    local_report.stats.live_block_bytes += container->live_bytes();
-    local_report.stats.live_block_bytes_aligned += container->live_bytes_aligned();
-    local_report.stats.live_block_count += container->live_blocks();
-    local_report.stats.lbm_container_count++;
-
-    // Log number of containers opened every 10 seconds
-    MonoTime now = MonoTime::Now();
-    if ((now - last_opened_container_log_time).ToSeconds() > 10) {
-      LOG(INFO) << Substitute("Opened $0 log block containers in $1",
-                              local_report.stats.lbm_container_count, dir->dir());
-      last_opened_container_log_time = now;
-    }
-
-    next_block_id_.StoreMax(max_block_id + 1);
-
-    // Under the lock, merge this map into the main block map and add
-    // the container.
-    {
-      std::lock_guard<simple_spinlock> l(lock_);
-      // To avoid cacheline contention during startup, we aggregate all of the
-      // memory in a local and add it to the mem-tracker in a single increment
-      // at the end of this loop.
-      int64_t mem_usage = 0;
-      for (UntrackedBlockMap::value_type& e : live_blocks) {
-        int block_mem = kudu_malloc_usable_size(e.second.get());
-        if (!AddLogBlockUnlocked(std::move(e.second))) {
-          // TODO(adar): track as an inconsistency?
-          LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
-                     << " which already is alive from another container when "
-                     << " processing container " << container->ToString();
-        }
-        mem_usage += block_mem;
+      // Log number of containers opened every 10 seconds
+      MonoTime now = MonoTime::Now();
+      if ((now - last_opened_container_log_time).ToSeconds() > 10) {
+        LOG(INFO) << Substitute("Opened $0 log block containers in $1",
+                                local_report.stats.lbm_container_count, dir->dir());
+        last_opened_container_log_time = now;
       }
-
-      mem_tracker_->Consume(mem_usage);
-      AddNewContainerUnlocked(container.get());
-      MakeContainerAvailableUnlocked(container.release());
+    });
+    if (!s.ok()) {
+      pool->Wait();
+      *result_status = s.CloneAndPrepend("Could not submit container loading task");
+      return;
     }
   }
+  pool->Wait();
+  pool->Shutdown();
+  if (!load_status.ok()) {
+    *result_status = load_status;
+    return;
+  }
 
   // Like the rest of Open(), repairs are performed per data directory to take
   // advantage of parallelism.
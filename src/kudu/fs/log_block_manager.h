@@ -218,6 +218,7 @@ class LogBlockManager : public BlockManager {
   FRIEND_TEST(LogBlockManagerTest, TestLookupBlockLimit);
   FRIEND_TEST(LogBlockManagerTest, TestMetadataTruncation);
   FRIEND_TEST(LogBlockManagerTest, TestParseKernelRelease);
+  FRIEND_TEST(LogBlockManagerTest, TestBlockMapMemoryFootprint);
   FRIEND_TEST(LogBlockManagerTest, TestBumpBlockIds);
   FRIEND_TEST(LogBlockManagerTest, TestReuseBlockIds);
   FRIEND_TEST(LogBlockManagerTest, TestFailMultipleTransactionsPerContainer);
@@ -360,6 +361,21 @@ class LogBlockManager : public BlockManager {
                              const std::vector<BlockRecordPB>& records,
                              int64_t* file_bytes_delta);
 
+  // Opens the container 'container_name' in 'dir', processing its records
+  // and adding its live blocks to the block map. Inconsistencies are written
+  // to 'report', and the blocks and containers in need of repair are
+  // appended to the other out parameters, as consumed by Repair().
+  //
+  // Safe to call concurrently for different containers.
+  Status LoadContainer(DataDir* dir,
+                       const std::string& container_name,
+                       FsReport* report,
+                       std::vector<scoped_refptr<internal::LogBlock>>* need_repunching,
+                       std::vector<std::string>* dead_containers,
+                       std::unordered_map<
+                           std::string,
+                           std::vector<BlockRecordPB>>* low_live_block_containers);
+
   // Opens a particular data directory belonging to the block manager. The
   // results of consistency checking (and repair, if applicable) are written to
   // 'report'.
@@ -26,11 +26,14 @@
 #include <glog/stl_logging.h> // IWYU pragma: keep
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/hms/hive_metastore_constants.h"
 #include "kudu/hms/hive_metastore_types.h"
+#include "kudu/hms/hms_client_pool.h"
 #include "kudu/hms/mini_hms.h"
 #include "kudu/rpc/sasl_common.h"
 #include "kudu/security/test/mini_kdc.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
@@ -44,6 +47,7 @@ using kudu::rpc::SaslProtection;
 using std::make_pair;
 using std::string;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace hms {
@@ -387,6 +391,67 @@ TEST_F(HmsClientTest, TestHmsConnect) {
   ASSERT_TRUE(start_client(unbound).IsNetworkError());
 }
 
+TEST_F(HmsClientTest, TestHmsClientPool) {
+  MiniHms hms;
+  ASSERT_OK(hms.Start());
+
+  HmsClientPoolOptions options;
+  options.client_options.recv_timeout = MonoDelta::FromMilliseconds(500);
+  options.client_options.send_timeout = MonoDelta::FromMilliseconds(500);
+  options.num_clients = 4;
+  HmsClientPool pool(hms.address(), options);
+  ASSERT_OK(pool.Start());
+  const MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(60);
+
+  hive::Database db;
+  db.name = "my_db";
+  ASSERT_OK(pool.Execute([&] (HmsClient* client) {
+    return client->CreateDatabase(db);
+  }, deadline));
+
+  // Create tables concurrently.
+  const int kNumTables = 20;
+  CountDownLatch latch(kNumTables);
+  vector<Status> results(kNumTables);
+  for (int i = 0; i < kNumTables; i++) {
+    pool.ExecuteAsync([this, i] (HmsClient* client) {
+      return CreateTable(client, "my_db", Substitute("table_$0", i), Substitute("id_$0", i));
+    }, deadline, [&, i] (const Status& s) {
+      results[i] = s;
+      latch.CountDown();
+    });
+  }
+  latch.Wait();
+  for (const auto& s : results) {
+    ASSERT_OK(s);
+  }
+  vector<string> tables;
+  ASSERT_OK(pool.Execute([&] (HmsClient* client) {
+    return client->GetAllTables("my_db", &tables);
+  }, deadline));
+  ASSERT_EQ(kNumTables, tables.size());
+
+  // Calls past their deadline aren't run.
+  Status s = pool.Execute([] (HmsClient* /*client*/) {
+    return Status::OK();
+  }, MonoTime::Now() - MonoDelta::FromSeconds(1));
+  ASSERT_TRUE(s.IsTimedOut()) << s.ToString();
+
+  // Connections are reopened once the HMS is back.
+  ASSERT_OK(hms.Stop());
+  s = pool.Execute([&] (HmsClient* client) {
+    return client->GetDatabase("my_db", &db);
+  }, deadline);
+  ASSERT_FALSE(s.ok());
+  ASSERT_OK(hms.Start());
+  for (int i = 0; i < options.num_clients; i++) {
+    ASSERT_OK(pool.Execute([&] (HmsClient* client) {
+      return client->GetDatabase("my_db", &db);
+    }, deadline));
+  }
+  pool.Stop();
+}
+
 TEST_F(HmsClientTest, TestDeserializeJsonTable) {
   string json = R"#({"1":{"str":"table_name"},"2":{"str":"database_name"}})#";
   hive::Table table;
@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/hms/hms_client_pool.h"
+
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/util/async_util.h"
+#include "kudu/util/threadpool.h"
+
+METRIC_DEFINE_histogram(server, hms_client_queue_time,
+                        "HMS Client Queue Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time HMS calls spent waiting for an idle connection to "
+                        "the Hive MetaStore",
+                        60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, hms_client_call_duration,
+                        "HMS Client Call Duration",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time taken by the Hive MetaStore to run HMS calls, including "
+                        "opening the connection if needed",
+                        60000000LU, 2);
+
+namespace kudu {
+namespace hms {
+
+HmsClientPool::HmsClientPool(HostPort hms_address, HmsClientPoolOptions options)
+    : hms_address_(std::move(hms_address)),
+      options_(std::move(options)) {
+  CHECK_GT(options_.num_clients, 0);
+  if (options_.metric_entity) {
+    queue_time_ = METRIC_hms_client_queue_time.Instantiate(options_.metric_entity);
+    call_duration_ = METRIC_hms_client_call_duration.Instantiate(options_.metric_entity);
+  }
+}
+
+HmsClientPool::~HmsClientPool() {
+  Stop();
+}
+
+Status HmsClientPool::Start() {
+  for (int i = 0; i < options_.num_clients; i++) {
+    idle_clients_.push_back({ std::unique_ptr<HmsClient>(
+        new HmsClient(hms_address_, options_.client_options)), false });
+  }
+  return ThreadPoolBuilder("hms-client")
+      .set_min_threads(0)
+      .set_max_threads(options_.num_clients)
+      .Build(&pool_);
+}
+
+void HmsClientPool::Stop() {
+  if (!pool_) {
+    return;
+  }
+  pool_->Shutdown();
+  for (auto& idle_client : idle_clients_) {
+    if (idle_client.started) {
+      WARN_NOT_OK(idle_client.client->Stop(), "failed to stop HMS client");
+      idle_client.started = false;
+    }
+  }
+}
+
+void HmsClientPool::ExecuteAsync(Task task, MonoTime deadline, StdStatusCallback callback) {
+  DCHECK(pool_) << "HmsClientPool must be started";
+  const MonoTime enqueue_time = MonoTime::Now();
+  Status s = pool_->SubmitFunc([this, task, callback, enqueue_time, deadline]() {
+    callback(RunTask(task, enqueue_time, deadline));
+  });
+  if (PREDICT_FALSE(!s.ok())) {
+    callback(s.CloneAndPrepend("failed to queue HMS call"));
+  }
+}
+
+Status HmsClientPool::Execute(Task task, MonoTime deadline) {
+  Synchronizer sync;
+  ExecuteAsync(std::move(task), deadline, sync.AsStdStatusCallback());
+  return sync.Wait();
+}
+
+Status HmsClientPool::RunTask(const Task& task, MonoTime enqueue_time, MonoTime deadline) {
+  const MonoTime start_time = MonoTime::Now();
+  if (queue_time_) {
+    queue_time_->Increment((start_time - enqueue_time).ToMicroseconds());
+  }
+  if (start_time > deadline) {
+    return Status::TimedOut("timed out waiting for an idle HMS connection");
+  }
+
+  PooledClient pooled_client;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    CHECK(!idle_clients_.empty());
+    pooled_client = std::move(idle_clients_.back());
+    idle_clients_.pop_back();
+  }
+
+  Status s;
+  if (!pooled_client.started) {
+    s = pooled_client.client->Start();
+    pooled_client.started = s.ok();
+  }
+  if (s.ok()) {
+    s = task(pooled_client.client.get());
+    // The connection may be in an unknown state, so it's reopened before
+    // being used again.
+    if (s.IsNetworkError() || s.IsTimedOut()) {
+      WARN_NOT_OK(pooled_client.client->Stop(), "failed to stop HMS client");
+      pooled_client.started = false;
+    }
+  }
+  if (call_duration_) {
+    call_duration_->Increment((MonoTime::Now() - start_time).ToMicroseconds());
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  idle_clients_.push_back(std::move(pooled_client));
+  return s;
+}
+
+} // namespace hms
+} // namespace kudu
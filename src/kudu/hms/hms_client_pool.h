@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/hms/hms_client.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
+#include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
+
+namespace kudu {
+
+class ThreadPool;
+
+namespace hms {
+
+struct HmsClientPoolOptions {
+
+  // Options of each of the HMS connections.
+  HmsClientOptions client_options;
+
+  // The number of connections to the HMS, i.e. the number of HMS calls which
+  // may be in flight at once.
+  int num_clients = 4;
+
+  // The entity the latency histograms of the pool are registered with, if any.
+  scoped_refptr<MetricEntity> metric_entity;
+};
+
+// A pool of connections to the Hive MetaStore, whose calls run concurrently on
+// worker threads.
+//
+// Each call is a task which is handed a connected HmsClient, and runs on a
+// worker thread once one of the connections is idle. Connections are opened
+// lazily, and a connection whose call failed with a network error or a
+// timeout is reopened before its next use. Like HmsClient, the pool doesn't
+// retry failed calls.
+//
+// HmsClientPool is thread safe.
+class HmsClientPool {
+ public:
+  // A call to run with one of the connections.
+  typedef std::function<Status(HmsClient*)> Task;
+
+  HmsClientPool(HostPort hms_address, HmsClientPoolOptions options);
+  ~HmsClientPool();
+
+  // Starts the worker threads of the pool. Must be called before any task
+  // is executed.
+  Status Start() WARN_UNUSED_RESULT;
+
+  // Waits for the queued tasks to run, and closes the connections.
+  //
+  // This is optional; if not called the destructor will stop the pool.
+  void Stop();
+
+  // Runs 'task' on a worker thread, then 'callback' with its result on the
+  // same thread. If no connection is idle by 'deadline', the task isn't run
+  // and 'callback' is called with TimedOut.
+  void ExecuteAsync(Task task, MonoTime deadline, StdStatusCallback callback);
+
+  // Like ExecuteAsync(), but waits for the task to run and returns its result.
+  Status Execute(Task task, MonoTime deadline) WARN_UNUSED_RESULT;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HmsClientPool);
+
+  // A connection to the HMS, and whether it's open.
+  struct PooledClient {
+    std::unique_ptr<HmsClient> client;
+    bool started;
+  };
+
+  // Runs 'task' with an idle connection, opening it if necessary.
+  Status RunTask(const Task& task, MonoTime enqueue_time, MonoTime deadline);
+
+  const HostPort hms_address_;
+  const HmsClientPoolOptions options_;
+
+  gscoped_ptr<ThreadPool> pool_;
+
+  // Protects 'idle_clients_'. There are as many worker threads as connections,
+  // so that a worker always finds an idle connection.
+  simple_spinlock lock_;
+  std::vector<PooledClient> idle_clients_;
+
+  // The time tasks spent waiting for a connection, and the time the HMS
+  // took to run them.
+  scoped_refptr<Histogram> queue_time_;
+  scoped_refptr<Histogram> call_duration_;
+};
+
+} // namespace hms
+} // namespace kudu
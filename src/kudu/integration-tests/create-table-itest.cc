@@ -217,6 +217,42 @@ TEST_F(CreateTableITest, TestSpreadReplicasEvenly) {
   ASSERT_GE(avg_num_peers, kNumServers / 2);
 }
 
+// Test that a table whose tablet assignment is paced over several rounds is
+// created completely, with its replicas spread evenly.
+TEST_F(CreateTableITest, TestPacedTabletAssignment) {
+  const int kNumServers = 3;
+  const int kNumTablets = 30;
+  NO_FATALS(StartCluster({}, {
+      "--max_create_tablet_requests_per_ts_per_round=4",
+      "--catalog_manager_bg_task_wait_ms=100",
+      "--max_create_tablets_per_ts=100",
+  }, kNumServers));
+
+  gscoped_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+  client::KuduSchema client_schema(client::KuduSchemaFromSchema(GetSimpleTestSchema()));
+  ASSERT_OK(table_creator->table_name(kTableName)
+            .schema(&client_schema)
+            .set_range_partition_columns({ "key" })
+            .num_replicas(3)
+            .add_hash_partitions({ "key" }, kNumTablets)
+            .Create());
+
+  // With as many replicas as servers, every server hosts every tablet.
+  for (int ts_idx = 0; ts_idx < kNumServers; ts_idx++) {
+    ASSERT_EQ(kNumTablets, inspect_->ListTabletsOnTS(ts_idx).size());
+  }
+
+  // The master reports the progress of the creation as complete.
+  master::IsCreateTableDoneRequestPB req;
+  master::IsCreateTableDoneResponsePB resp;
+  req.mutable_table()->set_table_name(kTableName);
+  rpc::RpcController rpc;
+  ASSERT_OK(cluster_->master_proxy()->IsCreateTableDone(req, &resp, &rpc));
+  ASSERT_TRUE(resp.done());
+  ASSERT_EQ(kNumTablets, resp.num_tablets());
+  ASSERT_EQ(kNumTablets, resp.num_running_tablets());
+}
+
 static void LookUpRandomKeysLoop(std::shared_ptr<master::MasterServiceProxy> master,
                                  const char* table_name,
                                  AtomicBool* quit) {
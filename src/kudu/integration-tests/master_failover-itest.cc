@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <ostream>
@@ -283,6 +284,39 @@ TEST_F(MasterFailoverTest, TestRenameTableSync) {
   ASSERT_TRUE(s.IsNotFound());
 }
 
+// Test that the tables and tablets which a follower master keeps up to date
+// as the system catalog changes are current once it takes over as leader.
+TEST_F(MasterFailoverTest, TestFailoverAfterCatalogChanges) {
+  if (!AllowSlowTests()) {
+    LOG(INFO) << "This test can only be run in slow mode.";
+    return;
+  }
+
+  ASSERT_OK(CreateTable("table-a", kWaitForCreate));
+  ASSERT_OK(CreateTable("table-b", kWaitForCreate));
+  ASSERT_OK(CreateTable("table-c", kWaitForCreate));
+  ASSERT_OK(RenameTable("table-a", "table-a-renamed"));
+  ASSERT_OK(client_->DeleteTable("table-b"));
+
+  for (int i = 0; i < 2; i++) {
+    int leader_idx;
+    ASSERT_OK(cluster_->GetLeaderMasterIndex(&leader_idx));
+    LOG(INFO) << "Shutting down leader master " << leader_idx;
+    cluster_->master(leader_idx)->Shutdown();
+
+    vector<string> tables;
+    ASSERT_OK(client_->ListTables(&tables));
+    std::sort(tables.begin(), tables.end());
+    ASSERT_EQ(vector<string>({ "table-a-renamed", "table-c" }), tables);
+    shared_ptr<KuduTable> table;
+    ASSERT_OK(client_->OpenTable("table-a-renamed", &table));
+    ASSERT_EQ(0, CountTableRows(table.get()));
+    ASSERT_TRUE(client_->OpenTable("table-b", &table).IsNotFound());
+
+    ASSERT_OK(cluster_->master(leader_idx)->Restart());
+  }
+}
+
 
 TEST_F(MasterFailoverTest, TestKUDU1374) {
   const char* kTableName = "testKUDU1374";
@@ -27,8 +27,10 @@
 
 #include "kudu/client/client.h"
 #include "kudu/client/schema.h"
+#include "kudu/client/write_op.h"
 #include "kudu/client/shared_ptr.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/replica_management.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -52,13 +54,17 @@
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
+DECLARE_bool(client_lookup_tablets_from_master_followers);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
 using kudu::client::KuduClient;
 using kudu::client::KuduClientBuilder;
 using kudu::client::KuduColumnSchema;
 using kudu::client::KuduSchema;
+using kudu::client::KuduInsert;
 using kudu::client::KuduSchemaBuilder;
+using kudu::client::KuduSession;
+using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
 using kudu::client::sp::shared_ptr;
 using kudu::consensus::ReplicaManagementInfoPB;
@@ -345,6 +351,71 @@ TEST_F(MasterReplicationTest, TestConnectToFollowerMasterOnly) {
   EXPECT_LE(successes, 1);
 }
 
+// Test that follower masters serve tablet location lookups which allow it,
+// unless their copy of the catalog lags behind the requested version.
+TEST_F(MasterReplicationTest, TestFollowerMastersServeLocationLookups) {
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(CreateClient(&client));
+  ASSERT_OK(CreateTable(client, kTableId1));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableId1, &table));
+
+  int leader_idx;
+  ASSERT_OK(cluster_->GetLeaderMasterIndex(&leader_idx));
+  for (int i = 0; i < cluster_->num_masters(); i++) {
+    if (i == leader_idx) {
+      continue;
+    }
+    SCOPED_TRACE(Substitute("Looking up locations from follower master $0", i));
+    GetTableLocationsRequestPB req;
+    req.mutable_table()->set_table_id(table->id());
+
+    // Without allowing a follower, the lookup is left to the leader.
+    {
+      GetTableLocationsResponsePB resp;
+      rpc::RpcController rpc;
+      ASSERT_OK(cluster_->master_proxy(i)->GetTableLocations(req, &resp, &rpc));
+      ASSERT_TRUE(resp.has_error());
+      ASSERT_EQ(MasterErrorPB::NOT_THE_LEADER, resp.error().code());
+    }
+
+    // The follower serves the lookup once it has reloaded the new table.
+    req.set_allow_follower(true);
+    int64_t catalog_version = 0;
+    ASSERT_EVENTUALLY([&]() {
+      GetTableLocationsResponsePB resp;
+      rpc::RpcController rpc;
+      ASSERT_OK(cluster_->master_proxy(i)->GetTableLocations(req, &resp, &rpc));
+      ASSERT_FALSE(resp.has_error()) << pb_util::SecureShortDebugString(resp);
+      ASSERT_EQ(1, resp.tablet_locations_size());
+      ASSERT_GT(resp.catalog_version(), 0);
+      catalog_version = resp.catalog_version();
+    });
+
+    // A follower lagging behind the requested version doesn't serve it.
+    req.set_min_catalog_version(catalog_version + 1000000);
+    GetTableLocationsResponsePB resp;
+    rpc::RpcController rpc;
+    ASSERT_OK(cluster_->master_proxy(i)->GetTableLocations(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(MasterErrorPB::NOT_THE_LEADER, resp.error().code());
+  }
+
+  // A client spreading its lookups across the masters can write to the table.
+  FLAGS_client_lookup_tablets_from_master_followers = true;
+  ASSERT_OK(CreateClient(&client));
+  ASSERT_OK(client->OpenTable(kTableId1, &table));
+  shared_ptr<KuduSession> session = client->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  for (int i = 0; i < 10; i++) {
+    gscoped_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt32("key", i));
+    ASSERT_OK(insert->mutable_row()->SetInt32("int_val", i));
+    ASSERT_OK(insert->mutable_row()->SetStringCopy("string_val", "val"));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+}
 
 } // namespace master
 } // namespace kudu
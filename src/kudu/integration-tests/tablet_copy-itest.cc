@@ -1028,9 +1028,10 @@ TEST_F(TabletCopyITest, TestTabletCopyThrottling) {
   const int kNumTablets = 4;
   // We want 2 tablet servers and we don't want the master to interfere when we
   // forcibly make copies of tablets onto servers it doesn't know about.
-  // We also want to make sure only one tablet copy is possible at a given time
-  // in order to test the throttling.
-  NO_FATALS(StartCluster({"--num_tablets_to_copy_simultaneously=1"},
+  // We also want to make sure only one tablet copy is possible at a given time,
+  // with none waiting in the queue, in order to test the throttling.
+  NO_FATALS(StartCluster({"--num_tablets_to_copy_simultaneously=1",
+                          "--tablet_copy_queue_length=0"},
                          {"--master_tombstone_evicted_tablet_replicas=false"},
                          2));
   // Shut down the 2nd tablet server; we'll create tablets on the first one.
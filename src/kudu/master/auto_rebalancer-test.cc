@@ -0,0 +1,150 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/auto_rebalancer.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(auto_rebalancing_enabled);
+DECLARE_int32(auto_rebalancing_max_moves_in_progress);
+
+using std::set;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+class AutoRebalancerTest : public KuduTest {
+ protected:
+  // Adds 'num_tablets' tablets of 'table_id' with their replicas on the
+  // given servers and their leaders on the first of them.
+  void AddTablets(const string& table_id, int num_tablets, const vector<string>& uuids) {
+    for (int i = 0; i < num_tablets; i++) {
+      TabletPlacement tablet;
+      tablet.tablet_id = Substitute("$0-$1", table_id, tablets_.size());
+      tablet.table_id = table_id;
+      tablet.replica_uuids = uuids;
+      tablet.leader_uuid = uuids[0];
+      tablets_.push_back(tablet);
+    }
+  }
+
+  // Applies 'moves' to the tablets, verifying each is valid.
+  void ApplyMoves(const vector<ReplicaMove>& moves) {
+    set<string> moved_tablet_ids;
+    for (const auto& move : moves) {
+      ASSERT_TRUE(moved_tablet_ids.insert(move.tablet_id).second);
+      for (auto& tablet : tablets_) {
+        if (tablet.tablet_id != move.tablet_id) {
+          continue;
+        }
+        auto& uuids = tablet.replica_uuids;
+        ASSERT_EQ(0, std::count(uuids.begin(), uuids.end(), move.to_uuid));
+        auto it = std::find(uuids.begin(), uuids.end(), move.from_uuid);
+        ASSERT_TRUE(it != uuids.end());
+        *it = move.to_uuid;
+      }
+    }
+  }
+
+  vector<TabletPlacement> tablets_;
+};
+
+TEST_F(AutoRebalancerTest, TestBalancesTablesAndServers) {
+  const vector<string> ts_uuids = { "ts-0", "ts-1", "ts-2", "ts-3", "ts-4" };
+  // Both tables start out on the first three servers only.
+  AddTablets("table-a", 10, { "ts-0", "ts-1", "ts-2" });
+  AddTablets("table-b", 5, { "ts-0", "ts-1", "ts-2" });
+  ASSERT_EQ(15, ComputeSkew(tablets_, ts_uuids, "", false));
+  ASSERT_EQ(10, ComputeSkew(tablets_, ts_uuids, "table-a", false));
+
+  // Since a tablet is moved at most once per round, it takes a few rounds to
+  // balance the cluster, after which no more moves are planned.
+  int num_rounds = 0;
+  while (true) {
+    vector<ReplicaMove> moves;
+    ComputeReplicaMoves(tablets_, ts_uuids, 1000, &moves);
+    if (moves.empty()) {
+      break;
+    }
+    NO_FATALS(ApplyMoves(moves));
+    ASSERT_LT(++num_rounds, 10);
+  }
+  ASSERT_GT(num_rounds, 1);
+  EXPECT_LE(ComputeSkew(tablets_, ts_uuids, "table-a", false), 1);
+  EXPECT_LE(ComputeSkew(tablets_, ts_uuids, "table-b", false), 1);
+  EXPECT_LE(ComputeSkew(tablets_, ts_uuids, "", false), 1);
+}
+
+TEST_F(AutoRebalancerTest, TestMovesAreThrottled) {
+  const vector<string> ts_uuids = { "ts-0", "ts-1", "ts-2", "ts-3" };
+  AddTablets("table", 20, { "ts-0", "ts-1", "ts-2" });
+
+  vector<ReplicaMove> moves;
+  ComputeReplicaMoves(tablets_, ts_uuids, 3, &moves);
+  ASSERT_EQ(3, moves.size());
+
+  // The rebalancer deducts the moves already in progress.
+  FLAGS_auto_rebalancing_enabled = true;
+  FLAGS_auto_rebalancing_max_moves_in_progress = 5;
+  AutoRebalancer rebalancer;
+  ASSERT_TRUE(rebalancer.ShouldRunRound());
+  moves.clear();
+  vector<LeaderStepDown> step_downs;
+  rebalancer.PlanRound(tablets_, ts_uuids, 4, &moves, &step_downs);
+  ASSERT_EQ(1, moves.size());
+  ASSERT_FALSE(rebalancer.ShouldRunRound());
+
+  const AutoRebalancer::Stats stats = rebalancer.stats();
+  ASSERT_EQ(1, stats.num_rounds);
+  ASSERT_EQ(1, stats.num_moves_scheduled);
+  ASSERT_EQ(4, stats.num_moves_in_progress);
+  ASSERT_EQ(20, stats.replica_skew);
+}
+
+TEST_F(AutoRebalancerTest, TestLeaderStepDowns) {
+  const vector<string> ts_uuids = { "ts-0", "ts-1", "ts-2" };
+  AddTablets("table", 9, { "ts-0", "ts-1", "ts-2" });
+  ASSERT_EQ(9, ComputeSkew(tablets_, ts_uuids, "", true));
+
+  // All the leaders are on ts-0, which should hand off all but its fair share.
+  vector<LeaderStepDown> step_downs;
+  ComputeLeaderStepDowns(tablets_, ts_uuids, { "table-0" }, 100, &step_downs);
+  ASSERT_EQ(6, step_downs.size());
+  for (const auto& step_down : step_downs) {
+    ASSERT_EQ("ts-0", step_down.leader_uuid);
+    ASSERT_NE("table-0", step_down.tablet_id);
+  }
+
+  step_downs.clear();
+  ComputeLeaderStepDowns(tablets_, ts_uuids, {}, 2, &step_downs);
+  ASSERT_EQ(2, step_downs.size());
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,336 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/auto_rebalancer.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_bool(auto_rebalancing_enabled, false,
+            "Whether the leader master rebalances the replicas and the leader "
+            "replicas of tablets across the tablet servers in the background.");
+TAG_FLAG(auto_rebalancing_enabled, experimental);
+TAG_FLAG(auto_rebalancing_enabled, runtime);
+
+DEFINE_int32(auto_rebalancing_interval_seconds, 30,
+             "How often the leader master plans a round of rebalancing, "
+             "in seconds.");
+TAG_FLAG(auto_rebalancing_interval_seconds, experimental);
+TAG_FLAG(auto_rebalancing_interval_seconds, runtime);
+
+DEFINE_int32(auto_rebalancing_max_moves_in_progress, 10,
+             "The maximum number of tablets in the process of changing their "
+             "configuration at any time for the rebalancer to schedule "
+             "more replica moves.");
+TAG_FLAG(auto_rebalancing_max_moves_in_progress, experimental);
+TAG_FLAG(auto_rebalancing_max_moves_in_progress, runtime);
+
+DEFINE_int32(auto_rebalancing_max_leader_step_downs_per_round, 5,
+             "The maximum number of leader replicas the rebalancer asks to "
+             "step down per round. Set to 0 to not rebalance leaders.");
+TAG_FLAG(auto_rebalancing_max_leader_step_downs_per_round, experimental);
+TAG_FLAG(auto_rebalancing_max_leader_step_downs_per_round, runtime);
+
+DECLARE_bool(raft_prepare_replacement_before_eviction);
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace master {
+
+namespace {
+
+typedef map<string, int> CountByServer;
+
+// Returns the servers with the highest and the lowest count in 'counts',
+// breaking ties by the counts in 'tiebreak': the most loaded server is
+// picked among those most loaded per 'tiebreak', and vice versa.
+pair<string, string> MostAndLeastLoaded(const CountByServer& counts,
+                                        const CountByServer& tiebreak) {
+  DCHECK(!counts.empty());
+  auto most = counts.begin();
+  auto least = counts.begin();
+  for (auto it = counts.begin(); it != counts.end(); ++it) {
+    const int tb = FindOrDie(tiebreak, it->first);
+    if (it->second > most->second ||
+        (it->second == most->second && tb > FindOrDie(tiebreak, most->first))) {
+      most = it;
+    }
+    if (it->second < least->second ||
+        (it->second == least->second && tb < FindOrDie(tiebreak, least->first))) {
+      least = it;
+    }
+  }
+  return { most->first, least->first };
+}
+
+bool HostsReplica(const TabletPlacement& tablet, const string& uuid) {
+  return std::find(tablet.replica_uuids.begin(), tablet.replica_uuids.end(),
+                   uuid) != tablet.replica_uuids.end();
+}
+
+} // anonymous namespace
+
+void ComputeReplicaMoves(const vector<TabletPlacement>& tablets,
+                         const vector<string>& ts_uuids,
+                         int max_moves,
+                         vector<ReplicaMove>* moves) {
+  if (ts_uuids.size() < 2 || max_moves <= 0) {
+    return;
+  }
+
+  CountByServer empty_counts;
+  for (const auto& uuid : ts_uuids) {
+    empty_counts[uuid] = 0;
+  }
+  CountByServer total_counts = empty_counts;
+  map<string, CountByServer> table_counts;
+  map<string, vector<const TabletPlacement*>> table_tablets;
+  for (const auto& tablet : tablets) {
+    auto* counts = &LookupOrInsert(&table_counts, tablet.table_id, empty_counts);
+    table_tablets[tablet.table_id].push_back(&tablet);
+    for (const auto& uuid : tablet.replica_uuids) {
+      if (ContainsKey(total_counts, uuid)) {
+        (*counts)[uuid]++;
+        total_counts[uuid]++;
+      }
+    }
+  }
+
+  // Moves a replica of a tablet of 'table_id' from 'from' to 'to', if there is
+  // a tablet which hasn't been moved yet and has a replica on 'from' only.
+  set<string> moved_tablet_ids;
+  const auto try_move = [&](const string& table_id,
+                            const string& from, const string& to) -> bool {
+    for (const auto* tablet : FindOrDie(table_tablets, table_id)) {
+      if (ContainsKey(moved_tablet_ids, tablet->tablet_id) ||
+          !HostsReplica(*tablet, from) || HostsReplica(*tablet, to)) {
+        continue;
+      }
+      moves->push_back({ tablet->tablet_id, from, to });
+      InsertOrDie(&moved_tablet_ids, tablet->tablet_id);
+      auto& counts = FindOrDie(table_counts, table_id);
+      counts[from]--;
+      counts[to]++;
+      total_counts[from]--;
+      total_counts[to]++;
+      return true;
+    }
+    return false;
+  };
+
+  int num_moves = 0;
+
+  // First, balance the replicas of each table, breaking ties in favor of
+  // evening out the total counts as well.
+  for (const auto& entry : table_tablets) {
+    const string& table_id = entry.first;
+    while (num_moves < max_moves) {
+      const auto& counts = FindOrDie(table_counts, table_id);
+      const auto servers = MostAndLeastLoaded(counts, total_counts);
+      if (FindOrDie(counts, servers.first) - FindOrDie(counts, servers.second) <= 1 ||
+          !try_move(table_id, servers.first, servers.second)) {
+        break;
+      }
+      num_moves++;
+    }
+  }
+
+  // Then balance the total counts, moving only replicas of those tables which
+  // remain balanced.
+  while (num_moves < max_moves) {
+    const auto servers = MostAndLeastLoaded(total_counts, total_counts);
+    const string& from = servers.first;
+    const string& to = servers.second;
+    if (FindOrDie(total_counts, from) - FindOrDie(total_counts, to) <= 1) {
+      break;
+    }
+    bool moved = false;
+    for (const auto& entry : table_counts) {
+      if (FindOrDie(entry.second, from) > FindOrDie(entry.second, to) &&
+          try_move(entry.first, from, to)) {
+        moved = true;
+        break;
+      }
+    }
+    if (!moved) {
+      break;
+    }
+    num_moves++;
+  }
+}
+
+void ComputeLeaderStepDowns(const vector<TabletPlacement>& tablets,
+                            const vector<string>& ts_uuids,
+                            const vector<string>& exclude_tablet_ids,
+                            int max_step_downs,
+                            vector<LeaderStepDown>* step_downs) {
+  if (ts_uuids.size() < 2 || max_step_downs <= 0) {
+    return;
+  }
+
+  CountByServer leader_counts;
+  for (const auto& uuid : ts_uuids) {
+    leader_counts[uuid] = 0;
+  }
+  int num_leaders = 0;
+  for (const auto& tablet : tablets) {
+    int* count = FindOrNull(leader_counts, tablet.leader_uuid);
+    if (count) {
+      (*count)++;
+      num_leaders++;
+    }
+  }
+
+  // A server hosting more leaders than the rounded up average hands off the
+  // excess. Since a stepping down leader doesn't pick its successor, leaders
+  // converge towards the average over several rounds.
+  const int num_servers = ts_uuids.size();
+  const int fair_share = (num_leaders + num_servers - 1) / num_servers;
+  const set<string> excluded(exclude_tablet_ids.begin(), exclude_tablet_ids.end());
+  int num_step_downs = 0;
+  for (const auto& tablet : tablets) {
+    if (num_step_downs >= max_step_downs) {
+      break;
+    }
+    int* count = FindOrNull(leader_counts, tablet.leader_uuid);
+    if (!count || *count <= fair_share || ContainsKey(excluded, tablet.tablet_id)) {
+      continue;
+    }
+    step_downs->push_back({ tablet.tablet_id, tablet.leader_uuid });
+    (*count)--;
+    num_step_downs++;
+  }
+}
+
+int ComputeSkew(const vector<TabletPlacement>& tablets,
+                const vector<string>& ts_uuids,
+                const string& table_id,
+                bool leaders) {
+  if (ts_uuids.empty()) {
+    return 0;
+  }
+  CountByServer counts;
+  for (const auto& uuid : ts_uuids) {
+    counts[uuid] = 0;
+  }
+  for (const auto& tablet : tablets) {
+    if (!table_id.empty() && tablet.table_id != table_id) {
+      continue;
+    }
+    if (leaders) {
+      int* count = FindOrNull(counts, tablet.leader_uuid);
+      if (count) {
+        (*count)++;
+      }
+      continue;
+    }
+    for (const auto& uuid : tablet.replica_uuids) {
+      int* count = FindOrNull(counts, uuid);
+      if (count) {
+        (*count)++;
+      }
+    }
+  }
+  const auto servers = MostAndLeastLoaded(counts, counts);
+  return counts[servers.first] - counts[servers.second];
+}
+
+AutoRebalancer::Stats::Stats()
+    : num_rounds(0),
+      num_moves_scheduled(0),
+      num_step_downs_scheduled(0),
+      num_moves_in_progress(0),
+      replica_skew(0),
+      max_table_replica_skew(0),
+      leader_skew(0) {
+}
+
+AutoRebalancer::AutoRebalancer() {
+}
+
+bool AutoRebalancer::ShouldRunRound() const {
+  if (!FLAGS_auto_rebalancing_enabled) {
+    return false;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  return !stats_.last_round_time.Initialized() ||
+      MonoTime::Now() - stats_.last_round_time >=
+      MonoDelta::FromSeconds(FLAGS_auto_rebalancing_interval_seconds);
+}
+
+void AutoRebalancer::PlanRound(const vector<TabletPlacement>& tablets,
+                               const vector<string>& ts_uuids,
+                               int num_moves_in_progress,
+                               vector<ReplicaMove>* moves,
+                               vector<LeaderStepDown>* step_downs) {
+  // Moves are completed by evicting the replicas marked for replacement,
+  // which only happens when replacements are prepared before eviction.
+  if (FLAGS_raft_prepare_replacement_before_eviction) {
+    ComputeReplicaMoves(tablets, ts_uuids,
+                        FLAGS_auto_rebalancing_max_moves_in_progress - num_moves_in_progress,
+                        moves);
+  }
+  vector<string> moved_tablet_ids;
+  for (const auto& move : *moves) {
+    moved_tablet_ids.push_back(move.tablet_id);
+  }
+  ComputeLeaderStepDowns(tablets, ts_uuids, moved_tablet_ids,
+                         FLAGS_auto_rebalancing_max_leader_step_downs_per_round,
+                         step_downs);
+
+  set<string> table_ids;
+  for (const auto& tablet : tablets) {
+    table_ids.insert(tablet.table_id);
+  }
+  int max_table_replica_skew = 0;
+  for (const auto& table_id : table_ids) {
+    max_table_replica_skew = std::max(max_table_replica_skew,
+                                      ComputeSkew(tablets, ts_uuids, table_id, false));
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  stats_.num_rounds++;
+  stats_.last_round_time = MonoTime::Now();
+  stats_.num_moves_scheduled += moves->size();
+  stats_.num_step_downs_scheduled += step_downs->size();
+  stats_.num_moves_in_progress = num_moves_in_progress;
+  stats_.replica_skew = ComputeSkew(tablets, ts_uuids, "", false);
+  stats_.max_table_replica_skew = max_table_replica_skew;
+  stats_.leader_skew = ComputeSkew(tablets, ts_uuids, "", true);
+}
+
+AutoRebalancer::Stats AutoRebalancer::stats() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return stats_;
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_MASTER_AUTO_REBALANCER_H
+#define KUDU_MASTER_AUTO_REBALANCER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace master {
+
+// The placement of a tablet's replicas, as seen by the rebalancer.
+struct TabletPlacement {
+  std::string tablet_id;
+  std::string table_id;
+
+  // UUIDs of the tablet servers hosting the voter replicas of the tablet.
+  std::vector<std::string> replica_uuids;
+
+  // UUID of the tablet server hosting the leader replica, or empty if unknown.
+  std::string leader_uuid;
+};
+
+// A move of a tablet's replica from one tablet server to another.
+struct ReplicaMove {
+  std::string tablet_id;
+  std::string from_uuid;
+  std::string to_uuid;
+};
+
+// A request for the leader replica of a tablet to step down.
+struct LeaderStepDown {
+  std::string tablet_id;
+  std::string leader_uuid;
+};
+
+// Computes at most 'max_moves' replica moves evening out the replica counts
+// among the tablet servers in 'ts_uuids': first the counts of each table's
+// replicas, and then the total counts, without making any table's replica
+// distribution more skewed. A tablet is moved at most once.
+void ComputeReplicaMoves(const std::vector<TabletPlacement>& tablets,
+                         const std::vector<std::string>& ts_uuids,
+                         int max_moves,
+                         std::vector<ReplicaMove>* moves);
+
+// Computes at most 'max_step_downs' leader step-downs for the tablet servers
+// in 'ts_uuids' hosting more than their fair share of leader replicas.
+// Tablets in 'exclude_tablet_ids' are skipped.
+void ComputeLeaderStepDowns(const std::vector<TabletPlacement>& tablets,
+                            const std::vector<std::string>& ts_uuids,
+                            const std::vector<std::string>& exclude_tablet_ids,
+                            int max_step_downs,
+                            std::vector<LeaderStepDown>* step_downs);
+
+// Returns the difference between the highest and the lowest number of
+// replicas (leader replicas if 'leaders' is true) hosted by any of the
+// tablet servers in 'ts_uuids', considering all the tablets or only those of
+// 'table_id' if it's not empty.
+int ComputeSkew(const std::vector<TabletPlacement>& tablets,
+                const std::vector<std::string>& ts_uuids,
+                const std::string& table_id,
+                bool leaders);
+
+// Rebalances replicas and leaders across the tablet servers of the cluster
+// in the background of the leader master.
+//
+// Each round plans a bounded number of replica moves and leader step-downs,
+// which the catalog manager carries out as asynchronous tasks: a replica is
+// moved by adding a non-voter which is promoted once caught up, while the
+// replica being moved is marked for replacement and eventually evicted.
+//
+// This class is thread-safe.
+class AutoRebalancer {
+ public:
+  // Statistics on the rebalancer, for display in the web UI.
+  struct Stats {
+    Stats();
+
+    int64_t num_rounds;
+    MonoTime last_round_time;
+
+    // The total number of moves and step-downs scheduled since startup.
+    int64_t num_moves_scheduled;
+    int64_t num_step_downs_scheduled;
+
+    // The state of the cluster as of the last round.
+    int num_moves_in_progress;
+    int replica_skew;
+    int max_table_replica_skew;
+    int leader_skew;
+  };
+
+  AutoRebalancer();
+
+  // Returns whether it's time for another round, given the rebalancing flags.
+  bool ShouldRunRound() const;
+
+  // Plans a round given the placement of the healthy tablets and the live
+  // tablet servers, of which 'num_moves_in_progress' tablets are in the
+  // process of changing their configuration.
+  void PlanRound(const std::vector<TabletPlacement>& tablets,
+                 const std::vector<std::string>& ts_uuids,
+                 int num_moves_in_progress,
+                 std::vector<ReplicaMove>* moves,
+                 std::vector<LeaderStepDown>* step_downs);
+
+  Stats stats() const;
+
+ private:
+  mutable simple_spinlock lock_;
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoRebalancer);
+};
+
+} // namespace master
+} // namespace kudu
+
+#endif
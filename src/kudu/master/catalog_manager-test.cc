@@ -17,6 +17,8 @@
 
 #include <ostream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -24,12 +26,14 @@
 
 #include "kudu/common/common.pb.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/util/cow_object.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
@@ -95,6 +99,76 @@ TEST(TableInfoTest, TestAssignmentRanges) {
   }
 }
 
+// Creates a table with 'num_tablets' running tablets, evenly splitting the
+// partition key space of 8-digit keys.
+static scoped_refptr<TableInfo> CreateTableWithTablets(const string& table_id,
+                                                       int num_tablets) {
+  scoped_refptr<TableInfo> table(new TableInfo(table_id));
+  vector<scoped_refptr<TabletInfo>> tablets;
+  for (int i = 0; i < num_tablets; i++) {
+    scoped_refptr<TabletInfo> tablet(
+        new TabletInfo(table, Substitute("$0-tablet-$1", table_id, i)));
+    {
+      TabletMetadataLock meta_lock(tablet.get(), LockMode::WRITE);
+      PartitionPB* partition = meta_lock.mutable_data()->pb.mutable_partition();
+      partition->set_partition_key_start(i == 0 ? "" : StringPrintf("%08d", i));
+      partition->set_partition_key_end(
+          i == num_tablets - 1 ? "" : StringPrintf("%08d", i + 1));
+      meta_lock.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+      meta_lock.Commit();
+    }
+    tablets.emplace_back(std::move(tablet));
+  }
+  table->AddRemoveTablets(tablets, {});
+  return table;
+}
+
+// Looks up single tablets at random keys of 'table' from several threads
+// concurrently, returning the average latency of a lookup in nanoseconds.
+static double BenchmarkTabletLookups(const scoped_refptr<TableInfo>& table,
+                                     int num_tablets) {
+  const int kNumThreads = 8;
+  const int kLookupsPerThread = AllowSlowTests() ? 200000 : 20000;
+  vector<std::thread> threads;
+  MonoTime start = MonoTime::Now();
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      Random rng(t);
+      GetTableLocationsRequestPB req;
+      req.set_max_returned_locations(1);
+      vector<scoped_refptr<TabletInfo>> tablets_in_range;
+      for (int i = 0; i < kLookupsPerThread; i++) {
+        req.set_partition_key_start(
+            StringPrintf("%08d", static_cast<int>(rng.Uniform(num_tablets))));
+        tablets_in_range.clear();
+        table->GetTabletsInRange(&req, &tablets_in_range);
+        CHECK_EQ(1U, tablets_in_range.size());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const MonoDelta elapsed = MonoTime::Now() - start;
+  return static_cast<double>(elapsed.ToNanoseconds()) / (kNumThreads * kLookupsPerThread);
+}
+
+// Simulates location lookups against a catalog of 100k tablets, comparing
+// their latency with lookups against a small catalog. The tablets of a table
+// are kept in a sorted map, so the latency should barely grow with its size.
+TEST(TableInfoTest, TestLookupLatencyWithLargeCatalog) {
+  const int kSmallNumTablets = 100;
+  const int kLargeNumTablets = AllowSlowTests() ? 100000 : 10000;
+  scoped_refptr<TableInfo> small_table = CreateTableWithTablets("small", kSmallNumTablets);
+  scoped_refptr<TableInfo> large_table = CreateTableWithTablets("large", kLargeNumTablets);
+  ASSERT_EQ(kLargeNumTablets, large_table->num_tablets());
+
+  const double small_ns = BenchmarkTabletLookups(small_table, kSmallNumTablets);
+  const double large_ns = BenchmarkTabletLookups(large_table, kLargeNumTablets);
+  LOG(INFO) << Substitute("Average lookup latency: $0 ns with $1 tablets, $2 ns with $3 tablets",
+                          small_ns, kSmallNumTablets, large_ns, kLargeNumTablets);
+}
+
 TEST(TestTSDescriptor, TestReplicaCreationsDecay) {
   TSDescriptor ts("test");
   ASSERT_EQ(0, ts.RecentReplicaCreations());
@@ -42,6 +42,7 @@
 #include "kudu/master/catalog_manager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
@@ -91,10 +92,12 @@
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/utf/utf.h"
 #include "kudu/gutil/walltime.h"
+#include "kudu/master/auto_rebalancer.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master_cert_authority.h"
 #include "kudu/master/sys_catalog.h"
+#include "kudu/master/table_locations_cache.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/master/ts_manager.h"
 #include "kudu/rpc/messenger.h"
@@ -111,9 +114,12 @@
 #include "kudu/server/monitored_task.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
@@ -186,6 +192,15 @@ DEFINE_int32(max_create_tablets_per_ts, 20,
              "The number of tablets per TS that can be requested for a new table.");
 TAG_FLAG(max_create_tablets_per_ts, advanced);
 
+DEFINE_int32(max_create_tablet_requests_per_ts_per_round, 0,
+             "Maximum number of new tablet replicas the master asks each tablet "
+             "server to create per round of tablet assignment, which runs every "
+             "--catalog_manager_bg_task_wait_ms. Tablets beyond the limit are "
+             "assigned in later rounds, pacing the creation of very large "
+             "tables. Set to 0 to assign all pending tablets at once.");
+TAG_FLAG(max_create_tablet_requests_per_ts_per_round, advanced);
+TAG_FLAG(max_create_tablet_requests_per_ts_per_round, runtime);
+
 DEFINE_int32(master_failover_catchup_timeout_ms, 30 * 1000, // 30 sec
              "Amount of time to give a newly-elected leader master to load"
              " the previous master's metadata and become active. If this time"
@@ -215,6 +230,20 @@ DEFINE_int32(table_locations_ttl_ms, 5 * 60 * 1000, // 5 minutes
              "until after waiting for the ttl period.");
 TAG_FLAG(table_locations_ttl_ms, advanced);
 
+DEFINE_int64(table_locations_cache_capacity_mb, 0,
+             "Capacity of the cache of GetTableLocations responses, in MiB. "
+             "Cached responses are served without rebuilding them from the "
+             "tablet metadata, and are invalidated by any change to the "
+             "locations of the table's tablets or to the tablet server "
+             "registrations. Set to 0 to disable the cache.");
+TAG_FLAG(table_locations_cache_capacity_mb, advanced);
+
+DEFINE_int32(list_tables_max_page_tablets, 10000,
+             "Maximum number of tablet locations returned in a page of "
+             "ListTables results. A page holds at least one table regardless.");
+TAG_FLAG(list_tables_max_page_tablets, advanced);
+TAG_FLAG(list_tables_max_page_tablets, runtime);
+
 DEFINE_bool(catalog_manager_fail_ts_rpcs, false,
             "Whether all master->TS async calls should fail. Only for testing!");
 TAG_FLAG(catalog_manager_fail_ts_rpcs, hidden);
@@ -241,6 +270,32 @@ DEFINE_bool(catalog_manager_evict_excess_replicas, true,
 TAG_FLAG(catalog_manager_evict_excess_replicas, hidden);
 TAG_FLAG(catalog_manager_evict_excess_replicas, runtime);
 
+DEFINE_bool(master_support_follower_lookups, true,
+            "Whether a follower master serves the tablet location lookups of "
+            "clients which allow it. A follower serves them from a copy of the "
+            "tables and tablets it reloads from its replica of the system "
+            "catalog table whenever the catalog changes.");
+TAG_FLAG(master_support_follower_lookups, experimental);
+TAG_FLAG(master_support_follower_lookups, runtime);
+
+DEFINE_bool(master_follower_catalog_incremental_updates, true,
+            "Whether a follower master keeps its copy of the tables and "
+            "tablets up to date by applying the changes of the writes to its "
+            "replica of the system catalog as they commit, rather than by "
+            "reloading the whole catalog whenever it changes. Once elected "
+            "leader, a master whose copy is up to date takes it over instead "
+            "of reloading the catalog.");
+TAG_FLAG(master_follower_catalog_incremental_updates, experimental);
+TAG_FLAG(master_follower_catalog_incremental_updates, runtime);
+
+DEFINE_int32(master_follower_lookups_max_staleness_ms, 10 * 1000, // 10 sec
+             "Maximum time in milliseconds since a follower master last brought "
+             "its copy of the tables and tablets up to date with its replica "
+             "of the system catalog table for it to serve tablet location "
+             "lookups. The leader master serves the lookups otherwise.");
+TAG_FLAG(master_follower_lookups_max_staleness_ms, experimental);
+TAG_FLAG(master_follower_lookups_max_staleness_ms, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_bool(raft_attempt_to_replace_replica_without_majority);
 DECLARE_int64(tsk_rotation_seconds);
@@ -293,8 +348,10 @@ namespace master {
 
 class TableLoader : public TableVisitor {
  public:
-  explicit TableLoader(CatalogManager *catalog_manager)
-    : catalog_manager_(catalog_manager) {
+  // If 'verbose' is false, the loaded entries are only logged at VLOG level.
+  explicit TableLoader(CatalogManager *catalog_manager, bool verbose = true)
+    : catalog_manager_(catalog_manager),
+      verbose_(verbose) {
   }
 
   Status VisitTable(const string& table_id,
@@ -315,7 +372,7 @@ class TableLoader : public TableVisitor {
     }
     l.Commit();
 
-    if (!is_deleted) {
+    if (!is_deleted && verbose_) {
       LOG(INFO) << Substitute("Loaded metadata for table $0", table->ToString());
     }
     VLOG(2) << Substitute("Metadata for table $0: $1",
@@ -325,6 +382,7 @@ class TableLoader : public TableVisitor {
 
  private:
   CatalogManager *catalog_manager_;
+  const bool verbose_;
 
   DISALLOW_COPY_AND_ASSIGN(TableLoader);
 };
@@ -335,8 +393,10 @@ class TableLoader : public TableVisitor {
 
 class TabletLoader : public TabletVisitor {
  public:
-  explicit TabletLoader(CatalogManager *catalog_manager)
-    : catalog_manager_(catalog_manager) {
+  // If 'verbose' is false, the loaded entries are only logged at VLOG level.
+  explicit TabletLoader(CatalogManager *catalog_manager, bool verbose = true)
+    : catalog_manager_(catalog_manager),
+      verbose_(verbose) {
   }
 
   Status VisitTablet(const string& table_id,
@@ -370,8 +430,10 @@ class TabletLoader : public TabletVisitor {
       // from clean state, which is uninitialized for these brand new tablets.
       TabletMetadataLock l(tablet.get(), LockMode::READ);
       table->AddRemoveTablets({ tablet }, {});
-      LOG(INFO) << Substitute("Loaded metadata for tablet $0 (table $1)",
-                              tablet_id, table->ToString());
+      if (verbose_) {
+        LOG(INFO) << Substitute("Loaded metadata for tablet $0 (table $1)",
+                                tablet_id, table->ToString());
+      }
     }
 
     VLOG(2) << Substitute("Metadata for tablet $0: $1",
@@ -381,6 +443,7 @@ class TabletLoader : public TabletVisitor {
 
  private:
   CatalogManager *catalog_manager_;
+  const bool verbose_;
 
   DISALLOW_COPY_AND_ASSIGN(TabletLoader);
 };
@@ -524,6 +587,9 @@ void CatalogManagerBgTasks::Run() {
           }
         }
 
+        // Rebalance the replicas across the tablet servers, if enabled.
+        catalog_manager_->RunAutoRebalancerRound();
+
         // If this is the leader master, check if it's time to generate
         // and store a new TSK (Token Signing Key).
         Status s = catalog_manager_->TryGenerateNewTskUnlocked();
@@ -560,6 +626,19 @@ void CatalogManagerBgTasks::Run() {
           LOG(WARNING) << s.ToString()
                        << ": failed to prepare follower catalog manager, will retry";
         }
+        // To serve tablet location lookups and to take over quickly once
+        // elected leader, a follower keeps its copy of the tables and tablets
+        // up to date with its replica of the system catalog. A leader which is
+        // not yet ready is about to load them on its own.
+        if ((FLAGS_master_support_follower_lookups ||
+             FLAGS_master_follower_catalog_incremental_updates) &&
+            l.leader_status().IsIllegalState()) {
+          s = catalog_manager_->RefreshFollowerCatalog();
+          if (!s.ok()) {
+            LOG(WARNING) << s.ToString()
+                         << ": failed to refresh follower catalog, will retry";
+          }
+        }
       }
     }
     // Wait for a notification or a timeout expiration.
@@ -649,14 +728,21 @@ CatalogManager::CatalogManager(Master *master)
   : master_(master),
     rng_(GetRandomSeed32()),
     state_(kConstructed),
+    auto_rebalancer_(new AutoRebalancer()),
     leader_ready_term_(-1),
-    leader_lock_(RWMutex::Priority::PREFER_WRITING) {
+    leader_lock_(RWMutex::Priority::PREFER_WRITING),
+    follower_catalog_version_(-1),
+    follower_changes_lost_index_(-1) {
   CHECK_OK(ThreadPoolBuilder("leader-initialization")
            // Presently, this thread pool must contain only a single thread
            // (to correctly serialize invocations of ElectedAsLeaderCb upon
            // closely timed consecutive elections).
            .set_max_threads(1)
            .Build(&leader_election_pool_));
+  if (FLAGS_table_locations_cache_capacity_mb > 0) {
+    table_locations_cache_.reset(new TableLocationsCache(
+        FLAGS_table_locations_cache_capacity_mb * 1024 * 1024));
+  }
 }
 
 CatalogManager::~CatalogManager() {
@@ -884,7 +970,7 @@ Status CatalogManager::InitTokenSigner() {
 void CatalogManager::PrepareForLeadershipTask() {
   {
     // Hack to block this function until InitSysCatalogAsync() is finished.
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
   }
   const RaftConsensus* consensus = sys_catalog_->tablet_replica()->consensus();
   const int64_t term_before_wait = consensus->CurrentTerm();
@@ -971,7 +1057,7 @@ void CatalogManager::PrepareForLeadershipTask() {
         "Loading table and tablet metadata into memory";
     LOG(INFO) << kLoadMetaOpDescription << "...";
     LOG_SLOW_EXECUTION(WARNING, 1000, LogPrefix() + kLoadMetaOpDescription) {
-      if (!check(std::bind(&CatalogManager::VisitTablesAndTabletsUnlocked, this),
+      if (!check(std::bind(&CatalogManager::LoadTablesAndTabletsForLeadership, this),
                  *consensus, term, kLoadMetaOpDescription).ok()) {
         return;
       }
@@ -1065,13 +1151,273 @@ Status CatalogManager::PrepareFollower(MonoTime* last_tspk_run) {
   return Status::OK();
 }
 
+Status CatalogManager::RefreshFollowerCatalog() {
+  leader_lock_.AssertAcquiredForReading();
+  tablet::TabletReplica* replica = sys_catalog_->tablet_replica().get();
+  const auto committed_op_id = replica->consensus()->GetLastOpId(consensus::COMMITTED_OPID);
+  if (!committed_op_id) {
+    return Status::IllegalState("system catalog consensus is not running");
+  }
+
+  // The catalog version is the index of the last committed operation whose
+  // changes a visit of the system catalog is sure to see: the committed
+  // operations which are still pending may not have been applied yet.
+  int64_t version = committed_op_id->index();
+  vector<scoped_refptr<tablet::TransactionDriver>> pending;
+  replica->transaction_tracker()->GetPendingTransactions(&pending);
+  for (const auto& driver : pending) {
+    const consensus::OpId op_id = driver->GetOpId();
+    if (op_id.IsInitialized() && op_id.index() <= version) {
+      version = op_id.index() - 1;
+    }
+  }
+
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<LockType> lock(lock_);
+  if (follower_catalog_refresh_time_.Initialized() &&
+      version <= follower_catalog_version_) {
+    // Nothing has changed since the last reload.
+    follower_catalog_refresh_time_ = now;
+    return Status::OK();
+  }
+
+  RETURN_NOT_OK(CatchUpFollowerCatalogUnlocked(version));
+  follower_catalog_refresh_time_ = now;
+  return Status::OK();
+}
+
+void CatalogManager::QueueFollowerCatalogChanges(int64_t op_index,
+                                                 const Status& s,
+                                                 vector<CatalogEntryChange> changes) {
+  std::lock_guard<simple_spinlock> l(follower_changes_lock_);
+  if (!s.ok() || !FLAGS_master_follower_catalog_incremental_updates) {
+    // The copy must be reloaded past the lost changes.
+    follower_changes_lost_index_ = std::max(follower_changes_lost_index_, op_index);
+    return;
+  }
+  if (!changes.empty()) {
+    follower_changes_.emplace_back(op_index, std::move(changes));
+  }
+}
+
+Status CatalogManager::CatchUpFollowerCatalogUnlocked(int64_t version) {
+  vector<pair<int64_t, vector<CatalogEntryChange>>> queued;
+  int64_t lost_index;
+  {
+    std::lock_guard<simple_spinlock> l(follower_changes_lock_);
+    queued.swap(follower_changes_);
+    lost_index = follower_changes_lost_index_;
+  }
+
+  // The changes of the writes to the same entry are queued in the order of
+  // the writes, so applying them in the order they were queued brings a copy
+  // which was loaded past any lost changes up to date.
+  if (FLAGS_master_follower_catalog_incremental_updates &&
+      follower_catalog_refresh_time_.Initialized() &&
+      follower_catalog_version_ >= lost_index) {
+    Status s;
+    int num_changes = 0;
+    for (const auto& entry : queued) {
+      // The changes up to the version of the copy are part of it already.
+      if (entry.first <= follower_catalog_version_) {
+        continue;
+      }
+      s = ApplyFollowerCatalogChanges(entry.second);
+      if (!s.ok()) {
+        break;
+      }
+      num_changes += entry.second.size();
+    }
+    if (s.ok()) {
+      VLOG_WITH_PREFIX(1) << Substitute(
+          "Applied $0 changes to follower catalog: version $1 -> $2",
+          num_changes, follower_catalog_version_, version);
+      follower_catalog_version_ = std::max(follower_catalog_version_, version);
+      return Status::OK();
+    }
+    LOG_WITH_PREFIX(WARNING) << "Unable to apply changes to follower catalog, "
+                             << "reloading it: " << s.ToString();
+  }
+
+  // The changes of the writes past the catalog version may not be visible to
+  // the reload, so they remain queued.
+  {
+    std::lock_guard<simple_spinlock> l(follower_changes_lock_);
+    queued.erase(std::remove_if(queued.begin(), queued.end(),
+                                [&](const pair<int64_t, vector<CatalogEntryChange>>& e) {
+                                  return e.first <= version;
+                                }),
+                 queued.end());
+    follower_changes_.insert(follower_changes_.begin(),
+                             std::make_move_iterator(queued.begin()),
+                             std::make_move_iterator(queued.end()));
+  }
+
+  // Don't serve lookups from the partially loaded maps if the reload fails.
+  follower_catalog_refresh_time_ = MonoTime();
+  LOG_SLOW_EXECUTION(WARNING, 1000, LogPrefix() + "Reloading follower catalog") {
+    RETURN_NOT_OK(ReloadTablesAndTablets(/*verbose=*/false));
+  }
+  VLOG_WITH_PREFIX(1) << Substitute("Reloaded follower catalog: version $0 -> $1",
+                                    follower_catalog_version_, version);
+  follower_catalog_version_ = version;
+  return Status::OK();
+}
+
+Status CatalogManager::ApplyFollowerCatalogChanges(const vector<CatalogEntryChange>& changes) {
+  for (const auto& change : changes) {
+    RETURN_NOT_OK(change.is_table ? ApplyFollowerTableChange(change)
+                                  : ApplyFollowerTabletChange(change));
+  }
+  return Status::OK();
+}
+
+Status CatalogManager::ApplyFollowerTableChange(const CatalogEntryChange& change) {
+  scoped_refptr<TableInfo> table = FindPtrOrNull(table_ids_map_, change.entry_id);
+  if (change.deleted) {
+    if (table) {
+      TableMetadataLock l(table.get(), LockMode::READ);
+      const scoped_refptr<TableInfo>* named = FindOrNull(table_names_map_, l.data().name());
+      if (named && *named == table) {
+        table_names_map_.erase(l.data().name());
+      }
+      table_ids_map_.erase(change.entry_id);
+    }
+    return Status::OK();
+  }
+
+  SysTablesEntryPB metadata;
+  RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(
+      &metadata, reinterpret_cast<const uint8_t*>(change.metadata.data()),
+      change.metadata.size()), "unable to parse metadata of table " + change.entry_id);
+  if (!table) {
+    TableLoader loader(this, /*verbose=*/false);
+    return loader.VisitTable(change.entry_id, metadata);
+  }
+
+  TableMetadataLock l(table.get(), LockMode::WRITE);
+  const scoped_refptr<TableInfo>* named = FindOrNull(table_names_map_, l.data().name());
+  if (named && *named == table) {
+    table_names_map_.erase(l.data().name());
+  }
+  l.mutable_data()->pb.Swap(&metadata);
+  if (!l.mutable_data()->is_deleted()) {
+    table_names_map_[l.mutable_data()->name()] = table;
+  }
+  l.Commit();
+  table->InvalidateLocations();
+  return Status::OK();
+}
+
+Status CatalogManager::ApplyFollowerTabletChange(const CatalogEntryChange& change) {
+  scoped_refptr<TabletInfo> tablet = FindPtrOrNull(tablet_map_, change.entry_id);
+  if (change.deleted) {
+    if (tablet) {
+      TabletMetadataLock l(tablet.get(), LockMode::READ);
+      tablet->table()->RemoveTabletIfPresent(tablet);
+      tablet_map_.erase(change.entry_id);
+    }
+    return Status::OK();
+  }
+
+  SysTabletsEntryPB metadata;
+  RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(
+      &metadata, reinterpret_cast<const uint8_t*>(change.metadata.data()),
+      change.metadata.size()), "unable to parse metadata of tablet " + change.entry_id);
+  if (!tablet) {
+    TabletLoader loader(this, /*verbose=*/false);
+    return loader.VisitTablet(metadata.table_id(), change.entry_id, metadata);
+  }
+
+  const scoped_refptr<TableInfo>& table = tablet->table();
+  bool was_deleted;
+  bool is_deleted;
+  {
+    TabletMetadataLock l(tablet.get(), LockMode::WRITE);
+    was_deleted = l.data().is_deleted();
+    l.mutable_data()->pb.Swap(&metadata);
+    is_deleted = l.mutable_data()->is_deleted();
+    if (is_deleted && !was_deleted) {
+      // A deleted tablet may have been replaced by another one already.
+      table->RemoveTabletIfPresent(tablet);
+    }
+    l.Commit();
+  }
+  if (was_deleted && !is_deleted) {
+    TabletMetadataLock l(tablet.get(), LockMode::READ);
+    table->AddRemoveTablets({ tablet }, {});
+  } else {
+    table->InvalidateLocations();
+  }
+  return Status::OK();
+}
+
+Status CatalogManager::LoadTablesAndTabletsForLeadership() {
+  leader_lock_.AssertAcquiredForWriting();
+  std::lock_guard<LockType> lock(lock_);
+  Status s;
+  if (FLAGS_master_follower_catalog_incremental_updates &&
+      follower_catalog_refresh_time_.Initialized()) {
+    // Having caught up as the leader, this master has applied all the writes
+    // of the previous terms, so their changes are all queued by now.
+    s = CatchUpFollowerCatalogUnlocked(GetLeaderCatalogVersion());
+    if (s.ok()) {
+      LOG_WITH_PREFIX(INFO) << "Took over the tables and tablets of the follower "
+                            << "catalog at version " << follower_catalog_version_;
+    }
+  } else {
+    s = ReloadTablesAndTablets();
+  }
+
+  // The leader changes the tables and tablets on its own, so the copy is to
+  // be reloaded should this master become a follower again.
+  follower_catalog_version_ = -1;
+  follower_catalog_refresh_time_ = MonoTime();
+  {
+    std::lock_guard<simple_spinlock> l(follower_changes_lock_);
+    follower_changes_.clear();
+  }
+  return s;
+}
+
+Status CatalogManager::CheckFollowerCatalogIsFresh(int64_t min_catalog_version,
+                                                   int64_t* catalog_version) const {
+  leader_lock_.AssertAcquiredForReading();
+  if (!FLAGS_master_support_follower_lookups) {
+    return Status::IllegalState("follower lookups are disabled");
+  }
+  shared_lock<rw_spinlock> l(lock_.get_lock());
+  const MonoDelta max_staleness =
+      MonoDelta::FromMilliseconds(FLAGS_master_follower_lookups_max_staleness_ms);
+  if (!follower_catalog_refresh_time_.Initialized() ||
+      follower_catalog_refresh_time_ + max_staleness < MonoTime::Now()) {
+    return Status::ServiceUnavailable("follower catalog is stale");
+  }
+  if (follower_catalog_version_ < min_catalog_version) {
+    return Status::ServiceUnavailable(Substitute(
+        "follower catalog version $0 is behind the requested version $1",
+        follower_catalog_version_, min_catalog_version));
+  }
+  *catalog_version = follower_catalog_version_;
+  return Status::OK();
+}
+
+int64_t CatalogManager::GetLeaderCatalogVersion() const {
+  const auto committed_op_id =
+      sys_catalog_->tablet_replica()->consensus()->GetLastOpId(consensus::COMMITTED_OPID);
+  return committed_op_id ? committed_op_id->index() : 0;
+}
+
 Status CatalogManager::VisitTablesAndTabletsUnlocked() {
   leader_lock_.AssertAcquiredForWriting();
 
   // This lock is held for the entirety of the function because the calls to
   // VisitTables and VisitTablets mutate global maps.
   std::lock_guard<LockType> lock(lock_);
+  return ReloadTablesAndTablets();
+}
 
+Status CatalogManager::ReloadTablesAndTablets(bool verbose) {
   // Abort any outstanding tasks. All TableInfos are orphaned below, so
   // it's important to end their tasks now; otherwise Shutdown() will
   // destroy master state used by these tasks.
@@ -1085,10 +1431,10 @@ Status CatalogManager::VisitTablesAndTabletsUnlocked() {
   tablet_map_.clear();
 
   // Visit tables and tablets, load them into memory.
-  TableLoader table_loader(this);
+  TableLoader table_loader(this, verbose);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
                         "Failed while visiting tables in sys catalog");
-  TabletLoader tablet_loader(this);
+  TabletLoader tablet_loader(this, verbose);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
                         "Failed while visiting tablets in sys catalog");
   return Status::OK();
@@ -1153,7 +1499,7 @@ void CatalogManager::Shutdown() {
   // tasks for those entries.
   vector<scoped_refptr<TableInfo>> copy;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     AppendValuesFromMap(table_ids_map_, &copy);
   }
   AbortAndWaitForAllTasks(copy);
@@ -1270,6 +1616,36 @@ Status ValidateClientSchema(const boost::optional<string>& name,
     if (!s.ok()) {
       return s.CloneAndPrepend(Substitute("invalid encoding for column '$0'", col.name()));
     }
+    // The default codec is chosen by each tablet server, so its level can't be
+    // checked here.
+    if (col.attributes().compression != DEFAULT_COMPRESSION) {
+      const CompressionCodec* codec;
+      s = GetCompressionCodec(col.attributes().compression,
+                              col.attributes().compression_level,
+                              &codec);
+      if (!s.ok()) {
+        return s.CloneAndPrepend(Substitute("invalid compression for column '$0'",
+                                            col.name()));
+      }
+    }
+    // Secondary indexes are ordered by the key encoding of the values.
+    if (col.attributes().indexed && !IsTypeAllowableInKey(col.type_info())) {
+      return Status::InvalidArgument(Substitute("column '$0' of type $1 can't be indexed",
+                                                col.name(), col.type_info()->name()));
+    }
+    // Row TTLs are enforced against the wall clock, in microseconds.
+    if (col.attributes().ttl_seconds < 0) {
+      return Status::InvalidArgument(Substitute("column '$0' has a negative TTL", col.name()));
+    }
+    if (col.attributes().ttl_seconds > 0) {
+      if (col.type_info()->type() != UNIXTIME_MICROS) {
+        return Status::InvalidArgument(Substitute(
+            "column '$0' of type $1 can't have a TTL", col.name(), col.type_info()->name()));
+      }
+      if (schema.find_ttl_column() != i) {
+        return Status::InvalidArgument("at most one column may have a TTL");
+      }
+    }
   }
   return Status::OK();
 }
@@ -1406,6 +1782,14 @@ Status CatalogManager::CreateTable(const CreateTableRequestPB* orig_req,
                                            FLAGS_max_num_replicas));
     return SetError(MasterErrorPB::ILLEGAL_REPLICATION_FACTOR, s);
   }
+  if (req.num_read_replicas() < 0 ||
+      num_replicas + req.num_read_replicas() > FLAGS_max_num_replicas) {
+    s = Status::InvalidArgument(Substitute("illegal number of read replicas $0 (the total "
+                                           "number of replicas must not exceed $1)",
+                                           req.num_read_replicas(),
+                                           FLAGS_max_num_replicas));
+    return SetError(MasterErrorPB::ILLEGAL_REPLICATION_FACTOR, s);
+  }
 
   // Verify that the total number of tablets is reasonable, relative to the number
   // of live tablet servers.
@@ -1580,7 +1964,12 @@ Status CatalogManager::IsCreateTableDone(const IsCreateTableDoneRequestPB* req,
 
   // 2. Verify if the create is in-progress
   TRACE("Verify if the table creation is in progress for $0", table->ToString());
-  resp->set_done(!table->IsCreateInProgress());
+  int num_tablets;
+  int num_running_tablets;
+  table->GetCreateProgress(&num_tablets, &num_running_tablets);
+  resp->set_done(num_running_tablets == num_tablets);
+  resp->set_num_tablets(num_tablets);
+  resp->set_num_running_tablets(num_running_tablets);
 
   return Status::OK();
 }
@@ -1597,6 +1986,9 @@ scoped_refptr<TableInfo> CatalogManager::CreateTableInfo(const CreateTableReques
   metadata->set_version(0);
   metadata->set_next_column_id(ColumnId(schema.max_col_id() + 1));
   metadata->set_num_replicas(req.num_replicas());
+  if (req.num_read_replicas() > 0) {
+    metadata->set_num_read_replicas(req.num_read_replicas());
+  }
   // Use the Schema object passed in, since it has the column IDs already assigned,
   // whereas the user request PB does not.
   CHECK_OK(SchemaToPB(schema, metadata->mutable_schema()));
@@ -1621,7 +2013,7 @@ Status CatalogManager::FindAndLockTable(const TableIdentifierPB& table_identifie
                                         TableMetadataLock* table_lock) {
   scoped_refptr<TableInfo> table;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     if (table_identifier.has_table_id()) {
       table = FindPtrOrNull(table_ids_map_, table_identifier.table_id());
 
@@ -2327,22 +2719,79 @@ Status CatalogManager::ListTables(const ListTablesRequestPB* req,
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
-
-  for (const TableInfoMap::value_type& entry : table_names_map_) {
-    TableMetadataLock ltm(entry.second.get(), LockMode::READ);
-    if (!ltm.data().is_running()) continue; // implies !is_deleted() too
+  const bool paged = req->has_max_returned_tables();
+  if (paged && req->max_returned_tables() == 0) {
+    return Status::InvalidArgument("max_returned_tables must be greater than 0");
+  }
 
-    if (req->has_name_filter()) {
-      size_t found = ltm.data().name().find(req->name_filter());
-      if (found == string::npos) {
+  // Collect the candidate tables, keyed by name, without holding the lock
+  // any longer than necessary: building tablet locations takes a while.
+  vector<pair<string, scoped_refptr<TableInfo>>> tables;
+  {
+    shared_lock<rw_spinlock> l(lock_.get_lock());
+    for (const TableInfoMap::value_type& entry : table_names_map_) {
+      if (req->has_page_token() && entry.first <= req->page_token()) {
+        continue;
+      }
+      if (req->has_name_filter() &&
+          entry.first.find(req->name_filter()) == string::npos) {
         continue;
       }
+      tables.emplace_back(entry.first, entry.second);
+    }
+  }
+
+  // Only the first page's worth of tables needs to be sorted.
+  size_t num_tables = tables.size();
+  if (paged) {
+    num_tables = std::min<size_t>(num_tables, req->max_returned_tables());
+    std::partial_sort(tables.begin(), tables.begin() + num_tables, tables.end(),
+                      [](const pair<string, scoped_refptr<TableInfo>>& a,
+                         const pair<string, scoped_refptr<TableInfo>>& b) {
+                        return a.first < b.first;
+                      });
+  }
+
+  int num_tablet_locations = 0;
+  for (size_t i = 0; i < num_tables; i++) {
+    if (paged && i > 0 && num_tablet_locations >= FLAGS_list_tables_max_page_tablets) {
+      resp->set_next_page_token(tables[i - 1].first);
+      break;
     }
+    const scoped_refptr<TableInfo>& table_info = tables[i].second;
+    TableMetadataLock ltm(table_info.get(), LockMode::READ);
+    if (!ltm.data().is_running()) continue; // implies !is_deleted() too
 
     ListTablesResponsePB::TableInfo *table = resp->add_tables();
-    table->set_id(entry.second->id());
+    table->set_id(table_info->id());
     table->set_name(ltm.data().name());
+    if (!req->include_tablet_locations()) {
+      continue;
+    }
+    table->set_num_replicas(ltm.data().pb.num_replicas());
+    table->mutable_schema()->CopyFrom(ltm.data().pb.schema());
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table_info->GetAllTablets(&tablets);
+    for (const auto& tablet : tablets) {
+      TabletLocationsPB locs_pb;
+      Status s = BuildLocationsForTablet(tablet, req->replica_type_filter(), &locs_pb);
+      if (s.IsNotFound()) {
+        // The tablet has been deleted by a concurrent alter table operation.
+        continue;
+      }
+      if (s.IsServiceUnavailable()) {
+        // The tablet isn't running yet.
+        locs_pb.Clear();
+        locs_pb.set_tablet_id(tablet->id());
+      } else {
+        RETURN_NOT_OK(s);
+      }
+      table->add_tablet_locations()->Swap(&locs_pb);
+      num_tablet_locations++;
+    }
+  }
+  if (paged && !resp->has_next_page_token() && num_tables < tables.size()) {
+    resp->set_next_page_token(tables[num_tables - 1].first);
   }
 
   return Status::OK();
@@ -2352,7 +2801,7 @@ Status CatalogManager::GetTableInfo(const string& table_id, scoped_refptr<TableI
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   *table = FindPtrOrNull(table_ids_map_, table_id);
   return Status::OK();
 }
@@ -2362,7 +2811,7 @@ Status CatalogManager::GetAllTables(vector<scoped_refptr<TableInfo>>* tables) {
   RETURN_NOT_OK(CheckOnline());
 
   tables->clear();
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   AppendValuesFromMap(table_ids_map_, tables);
 
   return Status::OK();
@@ -2372,7 +2821,7 @@ Status CatalogManager::TableNameExists(const string& table_name, bool* exists) {
   leader_lock_.AssertAcquiredForReading();
   RETURN_NOT_OK(CheckOnline());
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   *exists = ContainsKey(table_names_map_, table_name);
   return Status::OK();
 }
@@ -2417,7 +2866,7 @@ Status CatalogManager::GetTabletReplica(const string& tablet_id,
                                         scoped_refptr<TabletReplica>* replica) const {
   // Note: CatalogManager has only one table, 'sys_catalog', with only
   // one tablet.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return Status::ServiceUnavailable("Systable not yet initialized");
   }
@@ -2433,7 +2882,7 @@ Status CatalogManager::GetTabletReplica(const string& tablet_id,
 void CatalogManager::GetTabletReplicas(vector<scoped_refptr<TabletReplica>>* replicas) const {
   // Note: CatalogManager has only one table, 'sys_catalog', with only
   // one tablet.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return;
   }
@@ -2938,13 +3387,27 @@ namespace {
 
 // Given exactly two choices in 'two_choices', pick the better tablet server on
 // which to place a tablet replica. Ties are broken using 'rng'.
-shared_ptr<TSDescriptor> PickBetterReplicaLocation(const TSDescriptorVector& two_choices,
-                                                   ThreadSafeRandom* rng) {
+//
+// If 'table_replicas' is not null, it maps the UUIDs of tablet servers to the
+// number of replicas of the tablet's table placed on them so far, and the
+// server with fewer of them is preferred regardless of the overall load.
+shared_ptr<TSDescriptor> PickBetterReplicaLocation(
+    const TSDescriptorVector& two_choices,
+    ThreadSafeRandom* rng,
+    const unordered_map<string, int>* table_replicas) {
   DCHECK_EQ(two_choices.size(), 2);
 
   const auto& a = two_choices[0];
   const auto& b = two_choices[1];
 
+  if (table_replicas) {
+    int table_replicas_a = FindWithDefault(*table_replicas, a->permanent_uuid(), 0);
+    int table_replicas_b = FindWithDefault(*table_replicas, b->permanent_uuid(), 0);
+    if (table_replicas_a != table_replicas_b) {
+      return table_replicas_a < table_replicas_b ? a : b;
+    }
+  }
+
   // When creating replicas, we consider two aspects of load:
   //   (1) how many tablet replicas are already on the server, and
   //   (2) how often we've chosen this server recently.
@@ -2976,9 +3439,13 @@ shared_ptr<TSDescriptor> PickBetterReplicaLocation(const TSDescriptorVector& two
 // Given the tablet servers in 'ts_descs', use 'rng' to pick a tablet server to
 // host a tablet replica, excluding tablet servers in 'excluded'.
 // If there are no servers in 'ts_descs' that are not in 'excluded, return nullptr.
-shared_ptr<TSDescriptor> SelectReplica(const TSDescriptorVector& ts_descs,
-                                       const set<shared_ptr<TSDescriptor>>& excluded,
-                                       ThreadSafeRandom* rng) {
+//
+// See PickBetterReplicaLocation() for 'table_replicas'.
+shared_ptr<TSDescriptor> SelectReplica(
+    const TSDescriptorVector& ts_descs,
+    const set<shared_ptr<TSDescriptor>>& excluded,
+    ThreadSafeRandom* rng,
+    const unordered_map<string, int>* table_replicas = nullptr) {
   // The replica selection algorithm follows the idea from
   // "Power of Two Choices in Randomized Load Balancing"[1]. For each replica,
   // we randomly select two tablet servers, and then assign the replica to the
@@ -3010,7 +3477,7 @@ shared_ptr<TSDescriptor> SelectReplica(const TSDescriptorVector& ts_descs,
 
   if (two_choices.size() == 2) {
     // Pick the better of the two.
-    return PickBetterReplicaLocation(two_choices, rng);
+    return PickBetterReplicaLocation(two_choices, rng, table_replicas);
   }
   if (two_choices.size() == 1) {
     return two_choices[0];
@@ -3194,7 +3661,8 @@ class AsyncAddReplicaTask : public AsyncChangeConfigTask {
                       scoped_refptr<TabletInfo> tablet,
                       ConsensusStatePB cstate,
                       RaftPeerPB::MemberType member_type,
-                      ThreadSafeRandom* rng);
+                      ThreadSafeRandom* rng,
+                      bool read_replica = false);
 
   string type_name() const override;
 
@@ -3204,6 +3672,10 @@ class AsyncAddReplicaTask : public AsyncChangeConfigTask {
  private:
   const RaftPeerPB::MemberType member_type_;
 
+  // Whether the new replica is a read replica, rather than one which is to
+  // be promoted.
+  const bool read_replica_;
+
   // Used to make random choices in replica selection.
   ThreadSafeRandom* rng_;
 };
@@ -3212,11 +3684,14 @@ AsyncAddReplicaTask::AsyncAddReplicaTask(Master* master,
                                          scoped_refptr<TabletInfo> tablet,
                                          ConsensusStatePB cstate,
                                          RaftPeerPB::MemberType member_type,
-                                         ThreadSafeRandom* rng)
+                                         ThreadSafeRandom* rng,
+                                         bool read_replica)
     : AsyncChangeConfigTask(master, std::move(tablet), std::move(cstate),
                             consensus::ADD_PEER),
       member_type_(member_type),
+      read_replica_(read_replica),
       rng_(rng) {
+  DCHECK(!read_replica_ || member_type_ == RaftPeerPB::NON_VOTER);
 }
 
 string AsyncAddReplicaTask::type_name() const {
@@ -3291,8 +3766,10 @@ bool AsyncAddReplicaTask::SendRequest(int attempt) {
   req.set_cas_config_opid_index(cstate_.committed_config().opid_index());
   RaftPeerPB* peer = req.mutable_server();
   peer->set_permanent_uuid(replacement_replica->permanent_uuid());
-  if (FLAGS_raft_prepare_replacement_before_eviction &&
-      member_type_ == RaftPeerPB::NON_VOTER) {
+  if (read_replica_) {
+    peer->mutable_attrs()->set_read_replica(true);
+  } else if (FLAGS_raft_prepare_replacement_before_eviction &&
+             member_type_ == RaftPeerPB::NON_VOTER) {
     peer->mutable_attrs()->set_promote(true);
   }
   ServerRegistrationPB peer_reg;
@@ -3360,6 +3837,131 @@ bool AsyncEvictReplicaTask::SendRequest(int attempt) {
   return true;
 }
 
+// Moves a replica of a tablet to another tablet server on behalf of the
+// rebalancer: in a single config change, the replica is marked for
+// replacement and a non-voter to be promoted is added on the destination
+// server. Once the non-voter is promoted, the marked replica is evicted by
+// the regular handling of tablet reports (see ShouldEvictReplica()).
+class AsyncMoveReplicaTask : public AsyncChangeConfigTask {
+ public:
+  AsyncMoveReplicaTask(Master* master,
+                       scoped_refptr<TabletInfo> tablet,
+                       ConsensusStatePB cstate,
+                       string from_uuid,
+                       shared_ptr<TSDescriptor> to_ts_desc);
+
+  string type_name() const override;
+
+ protected:
+  bool SendRequest(int attempt) override;
+
+ private:
+  const string from_uuid_;
+  const shared_ptr<TSDescriptor> to_ts_desc_;
+};
+
+AsyncMoveReplicaTask::AsyncMoveReplicaTask(Master* master,
+                                           scoped_refptr<TabletInfo> tablet,
+                                           ConsensusStatePB cstate,
+                                           string from_uuid,
+                                           shared_ptr<TSDescriptor> to_ts_desc)
+    : AsyncChangeConfigTask(master, std::move(tablet), std::move(cstate),
+                            consensus::MODIFY_PEER),
+      from_uuid_(std::move(from_uuid)),
+      to_ts_desc_(std::move(to_ts_desc)) {
+}
+
+string AsyncMoveReplicaTask::type_name() const {
+  return "BulkChangeConfig:MOVE_REPLICA";
+}
+
+bool AsyncMoveReplicaTask::SendRequest(int attempt) {
+  // Bail if we're retrying in vain.
+  if (!CheckOpIdIndex()) {
+    return false;
+  }
+
+  LOG(INFO) << Substitute("Sending $0 on tablet $1 from $2 to $3 (attempt $4)",
+                          type_name(), tablet_->id(), from_uuid_,
+                          to_ts_desc_->permanent_uuid(), attempt);
+
+  consensus::BulkChangeConfigRequestPB req;
+  req.set_dest_uuid(target_ts_desc_->permanent_uuid());
+  req.set_tablet_id(tablet_->id());
+  req.set_cas_config_opid_index(cstate_.committed_config().opid_index());
+  {
+    auto* change = req.add_config_changes();
+    change->set_type(consensus::MODIFY_PEER);
+    change->mutable_peer()->set_permanent_uuid(from_uuid_);
+    change->mutable_peer()->mutable_attrs()->set_replace(true);
+  }
+  {
+    auto* change = req.add_config_changes();
+    change->set_type(consensus::ADD_PEER);
+    RaftPeerPB* peer = change->mutable_peer();
+    peer->set_permanent_uuid(to_ts_desc_->permanent_uuid());
+    peer->set_member_type(RaftPeerPB::NON_VOTER);
+    peer->mutable_attrs()->set_promote(true);
+    ServerRegistrationPB peer_reg;
+    to_ts_desc_->GetRegistration(&peer_reg);
+    CHECK_GT(peer_reg.rpc_addresses_size(), 0);
+    *peer->mutable_last_known_addr() = peer_reg.rpc_addresses(0);
+  }
+  VLOG(1) << Substitute("Sending $0 request to $1: $2",
+                        type_name(), target_ts_desc_->ToString(), SecureDebugString(req));
+  consensus_proxy_->BulkChangeConfigAsync(req, &resp_, &rpc_,
+                                          boost::bind(&AsyncMoveReplicaTask::RpcCallback, this));
+  return true;
+}
+
+// Asks the leader replica of a tablet to step down on behalf of the
+// rebalancer. The request is not retried if rejected: leadership may have
+// moved on in the meantime.
+class AsyncLeaderStepDownTask : public RetrySpecificTSRpcTask {
+ public:
+  AsyncLeaderStepDownTask(Master* master,
+                          const string& leader_uuid,
+                          scoped_refptr<TabletInfo> tablet)
+      : RetrySpecificTSRpcTask(master, leader_uuid, tablet->table()),
+        tablet_(std::move(tablet)) {
+  }
+
+  string type_name() const override { return "LeaderStepDown"; }
+
+  string description() const override {
+    return Substitute("LeaderStepDown RPC for tablet $0 on TS $1",
+                      tablet_->id(), permanent_uuid_);
+  }
+
+ protected:
+  bool SendRequest(int attempt) override {
+    consensus::LeaderStepDownRequestPB req;
+    req.set_dest_uuid(permanent_uuid_);
+    req.set_tablet_id(tablet_->id());
+    VLOG(1) << Substitute("Sending $0 request to $1 (attempt $2)",
+                          type_name(), target_ts_desc_->ToString(), attempt);
+    consensus_proxy_->LeaderStepDownAsync(
+        req, &resp_, &rpc_, boost::bind(&AsyncLeaderStepDownTask::RpcCallback, this));
+    return true;
+  }
+
+  void HandleResponse(int attempt) override {
+    if (resp_.has_error()) {
+      LOG_WITH_PREFIX(INFO) << Substitute("$0 failed (attempt $1): $2",
+          type_name(), attempt, StatusFromPB(resp_.error().status()).ToString());
+      MarkFailed();
+      return;
+    }
+    MarkComplete();
+  }
+
+ private:
+  string tablet_id() const override { return tablet_->id(); }
+
+  const scoped_refptr<TabletInfo> tablet_;
+  consensus::LeaderStepDownResponsePB resp_;
+};
+
 Status CatalogManager::ProcessTabletReport(
     TSDescriptor* ts_desc,
     const TabletReportPB& full_report,
@@ -3415,7 +4017,7 @@ Status CatalogManager::ProcessTabletReport(
     // We only need to acquire lock_ for the tablet_map_ access, but since it's
     // acquired exclusively so rarely, it's probably cheaper to acquire and
     // hold it for all tablets here than to acquire/release it for each tablet.
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     for (const ReportedTabletPB& report : full_report.updated_tablets()) {
       const string& tablet_id = report.tablet_id();
 
@@ -3487,12 +4089,19 @@ Status CatalogManager::ProcessTabletReport(
     // the opid_index is strictly less than the latest reported committed
     // config. This prevents us from spuriously deleting replicas that have
     // just been added to the committed config and are in the process of copying.
+    // A report whose consensus state is unchanged since the last acknowledged
+    // one carries only the committed config's opid_index.
     const ConsensusStatePB& prev_cstate = tablet->metadata().state().pb.consensus_state();
     const int64_t prev_opid_index = prev_cstate.committed_config().opid_index();
-    const int64_t report_opid_index = (report.has_consensus_state() &&
-        report.consensus_state().committed_config().has_opid_index()) ?
-            report.consensus_state().committed_config().opid_index() :
-            consensus::kInvalidOpIdIndex;
+    int64_t report_opid_index = consensus::kInvalidOpIdIndex;
+    if (report.has_consensus_state()) {
+      if (report.consensus_state().committed_config().has_opid_index()) {
+        report_opid_index = report.consensus_state().committed_config().opid_index();
+      }
+    } else if (report.consensus_state_unchanged() &&
+               report.has_committed_config_opid_index()) {
+      report_opid_index = report.committed_config_opid_index();
+    }
     if (FLAGS_master_tombstone_evicted_tablet_replicas &&
         report.tablet_data_state() != TABLET_DATA_TOMBSTONED &&
         report.tablet_data_state() != TABLET_DATA_DELETED &&
@@ -3521,7 +4130,8 @@ Status CatalogManager::ProcessTabletReport(
     const auto replication_factor = table->metadata().state().pb.num_replicas();
     bool consensus_state_updated = false;
     // 7. Process the report's consensus state. There may be one even when the
-    // replica has been tombstoned.
+    // replica has been tombstoned. A consensus state which is unchanged since
+    // the last acknowledged report was processed then and isn't sent again.
     if (report.has_consensus_state()) {
       // 7a. The master only processes reports for replicas with committed
       // consensus configurations since it needs the committed index to only
@@ -3637,6 +4247,7 @@ Status CatalogManager::ProcessTabletReport(
       // 7e. Make tablet configuration change depending on the mode the server
       // is running with. The choice between two alternative modes is controlled
       // by the 'raft_prepare_replacement_before_eviction' run-time flag.
+      const auto num_rpcs_before_config_change = rpcs.size();
       if (!FLAGS_raft_prepare_replacement_before_eviction) {
         if (consensus_state_updated &&
             FLAGS_master_add_server_when_underreplicated &&
@@ -3675,6 +4286,34 @@ Status CatalogManager::ProcessTabletReport(
               master_, tablet, cstate, RaftPeerPB::NON_VOTER, &rng_));
         }
       }
+
+      // 7f. Once the voters are taken care of, add or remove read replicas
+      // to match the table's number of them. Failed read replicas are
+      // evicted by the above, and replaced here.
+      const auto& config = cstate.committed_config();
+      const int num_read_replicas = table->metadata().state().pb.num_read_replicas();
+      const int cur_num_read_replicas = CountReadReplicas(config);
+      if (rpcs.size() == num_rpcs_before_config_change &&
+          !cstate.has_pending_config() &&
+          !cstate.leader_uuid().empty() &&
+          cstate.leader_uuid() == ts_desc->permanent_uuid() &&
+          cur_num_read_replicas != num_read_replicas) {
+        if (cur_num_read_replicas < num_read_replicas) {
+          if (FLAGS_master_add_server_when_underreplicated) {
+            rpcs.emplace_back(new AsyncAddReplicaTask(
+                master_, tablet, cstate, RaftPeerPB::NON_VOTER, &rng_,
+                /*read_replica=*/true));
+          }
+        } else if (FLAGS_catalog_manager_evict_excess_replicas) {
+          for (const auto& peer : config.peers()) {
+            if (peer.member_type() == RaftPeerPB::NON_VOTER && peer.attrs().read_replica()) {
+              rpcs.emplace_back(new AsyncEvictReplicaTask(
+                  master_, tablet, cstate, peer.permanent_uuid()));
+              break;
+            }
+          }
+        }
+      }
     }
 
     // 8. Send an AlterSchema RPC if the tablet has an old schema version.
@@ -3728,6 +4367,9 @@ Status CatalogManager::ProcessTabletReport(
 
   // 12. Publish the in-memory tablet mutations and release the locks.
   tablets_lock.Commit();
+  for (const auto& tablet : actions.tablets_to_update) {
+    tablet->table()->InvalidateLocations();
+  }
 
   // 13. Process all tablet schema version changes.
   //
@@ -3762,7 +4404,7 @@ std::shared_ptr<RaftConsensus> CatalogManager::master_consensus() const {
   // CatalogManager::InitSysCatalogAsync takes lock_ in exclusive mode in order
   // to initialize sys_catalog_, so it's sufficient to take lock_ in shared mode
   // here to protect access to sys_catalog_.
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   if (!sys_catalog_) {
     return nullptr;
   }
@@ -3819,7 +4461,7 @@ void CatalogManager::SendDeleteTabletRequest(const scoped_refptr<TabletInfo>& ta
 void CatalogManager::ExtractTabletsToProcess(
     vector<scoped_refptr<TabletInfo>>* tablets_to_process) {
 
-  shared_lock<LockType> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   // TODO: At the moment we loop through all the tablets
   //       we can keep a set of tablets waiting for "assignment"
@@ -3848,6 +4490,101 @@ void CatalogManager::ExtractTabletsToProcess(
   }
 }
 
+void CatalogManager::RunAutoRebalancerRound() {
+  if (!auto_rebalancer_->ShouldRunRound()) {
+    return;
+  }
+
+  TSDescriptorVector ts_descs;
+  master_->ts_manager()->GetAllLiveDescriptors(&ts_descs);
+  unordered_map<string, shared_ptr<TSDescriptor>> live_ts_by_uuid;
+  vector<string> ts_uuids;
+  for (const auto& ts_desc : ts_descs) {
+    InsertOrDie(&live_ts_by_uuid, ts_desc->permanent_uuid(), ts_desc);
+    ts_uuids.push_back(ts_desc->permanent_uuid());
+  }
+
+  // Only the tablets whose committed configs consist of the expected number
+  // of voters on live tablet servers are rebalanced: the others are either
+  // being moved or re-replicated already, or have yet to be.
+  vector<TabletPlacement> placements;
+  unordered_map<string, pair<scoped_refptr<TabletInfo>, ConsensusStatePB>> tablets_by_id;
+  int num_moves_in_progress = 0;
+  {
+    shared_lock<rw_spinlock> l(lock_.get_lock());
+    for (const auto& table_entry : table_ids_map_) {
+      const scoped_refptr<TableInfo>& table = table_entry.second;
+      int num_replicas;
+      {
+        TableMetadataLock table_lock(table.get(), LockMode::READ);
+        if (!table_lock.data().is_running()) {
+          continue;
+        }
+        num_replicas = table_lock.data().pb.num_replicas();
+      }
+
+      vector<scoped_refptr<TabletInfo>> tablets;
+      table->GetAllTablets(&tablets);
+      for (const auto& tablet : tablets) {
+        TabletMetadataLock tablet_lock(tablet.get(), LockMode::READ);
+        if (!tablet_lock.data().is_running()) {
+          continue;
+        }
+        const ConsensusStatePB& cstate = tablet_lock.data().pb.consensus_state();
+        TabletPlacement placement;
+        bool is_stable = !cstate.has_pending_config();
+        bool is_live = true;
+        for (const auto& peer : cstate.committed_config().peers()) {
+          if (peer.member_type() != RaftPeerPB::VOTER ||
+              peer.attrs().replace() || peer.attrs().promote()) {
+            is_stable = false;
+            break;
+          }
+          is_live &= ContainsKey(live_ts_by_uuid, peer.permanent_uuid());
+          placement.replica_uuids.push_back(peer.permanent_uuid());
+        }
+        if (!is_stable) {
+          num_moves_in_progress++;
+          continue;
+        }
+        if (!is_live || placement.replica_uuids.size() != static_cast<size_t>(num_replicas)) {
+          continue;
+        }
+        placement.tablet_id = tablet->id();
+        placement.table_id = table->id();
+        placement.leader_uuid = cstate.leader_uuid();
+        placements.emplace_back(std::move(placement));
+        EmplaceOrDie(&tablets_by_id, tablet->id(), std::make_pair(tablet, cstate));
+      }
+    }
+  }
+
+  vector<ReplicaMove> moves;
+  vector<LeaderStepDown> step_downs;
+  auto_rebalancer_->PlanRound(placements, ts_uuids, num_moves_in_progress,
+                              &moves, &step_downs);
+  if (!moves.empty() || !step_downs.empty()) {
+    LOG(INFO) << Substitute("Rebalancing: scheduling $0 replica moves and $1 leader "
+                            "step-downs ($2 tablets changing their configuration)",
+                            moves.size(), step_downs.size(), num_moves_in_progress);
+  }
+
+  for (const auto& move : moves) {
+    const auto& entry = FindOrDie(tablets_by_id, move.tablet_id);
+    const scoped_refptr<TabletInfo>& tablet = entry.first;
+    auto* task = new AsyncMoveReplicaTask(master_, tablet, entry.second, move.from_uuid,
+                                          FindOrDie(live_ts_by_uuid, move.to_uuid));
+    tablet->table()->AddTask(task);
+    WARN_NOT_OK(task->Run(), Substitute("Failed to send $0", task->description()));
+  }
+  for (const auto& step_down : step_downs) {
+    const scoped_refptr<TabletInfo>& tablet = FindOrDie(tablets_by_id, step_down.tablet_id).first;
+    auto* task = new AsyncLeaderStepDownTask(master_, step_down.leader_uuid, tablet);
+    tablet->table()->AddTask(task);
+    WARN_NOT_OK(task->Run(), Substitute("Failed to send $0", task->description()));
+  }
+}
+
 // Check if it's time to roll TokenSigner's key. There's a bit of subtlety here:
 // we shouldn't start exporting a key until it is properly persisted.
 // So, the protocol is:
@@ -3914,6 +4651,72 @@ struct DeferredAssignmentActions {
   vector<scoped_refptr<TabletInfo>> needs_create_rpc;
 };
 
+// The placement of the new replicas in one round of tablet assignment.
+//
+// The replicas of all tablets assigned in the round are placed with their
+// cumulative effect in mind: the replicas of a table are spread evenly over
+// the servers first, so that a table created with many tablets gets a
+// balanced layout, and servers which were asked to create
+// --max_create_tablet_requests_per_ts_per_round replicas in the round are
+// only picked when there's no other choice.
+class ReplicaPlacementPlan {
+ public:
+  explicit ReplicaPlacementPlan(TSDescriptorVector ts_descs)
+      : ts_descs_(std::move(ts_descs)),
+        max_replicas_per_ts_(FLAGS_max_create_tablet_requests_per_ts_per_round),
+        num_reserved_replicas_(0) {
+  }
+
+  const TSDescriptorVector& ts_descs() const { return ts_descs_; }
+
+  // Reserves room for 'nreplicas' new replicas in the round, returning false
+  // if the round is already full.
+  bool TryReserve(int nreplicas) {
+    if (max_replicas_per_ts_ > 0 &&
+        num_reserved_replicas_ + nreplicas >
+            max_replicas_per_ts_ * static_cast<int64_t>(ts_descs_.size())) {
+      return false;
+    }
+    num_reserved_replicas_ += nreplicas;
+    return true;
+  }
+
+  // Returns the servers which may be asked to create more replicas in the
+  // round, or all servers if fewer than 'nreplicas' of them may.
+  TSDescriptorVector ServersWithRoom(int nreplicas) const {
+    if (max_replicas_per_ts_ <= 0) {
+      return ts_descs_;
+    }
+    TSDescriptorVector ret;
+    for (const auto& ts : ts_descs_) {
+      if (FindWithDefault(replicas_per_ts_, ts->permanent_uuid(), 0) < max_replicas_per_ts_) {
+        ret.push_back(ts);
+      }
+    }
+    return ret.size() < static_cast<size_t>(nreplicas) ? ts_descs_ : ret;
+  }
+
+  // Returns the number of replicas of the given table placed per server in
+  // the round.
+  const unordered_map<string, int>* table_replicas(const string& table_id) const {
+    return FindOrNull(table_replicas_per_ts_, table_id);
+  }
+
+  void AddReplica(const string& table_id, const string& ts_uuid) {
+    replicas_per_ts_[ts_uuid]++;
+    table_replicas_per_ts_[table_id][ts_uuid]++;
+  }
+
+ private:
+  const TSDescriptorVector ts_descs_;
+  const int max_replicas_per_ts_;
+  int64_t num_reserved_replicas_;
+  unordered_map<string, int> replicas_per_ts_;
+  unordered_map<string, unordered_map<string, int>> table_replicas_per_ts_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplicaPlacementPlan);
+};
+
 void CatalogManager::HandleAssignPreparingTablet(const scoped_refptr<TabletInfo>& tablet,
                                                  DeferredAssignmentActions* deferred) {
   // The tablet was just created (probably by a CreateTable RPC).
@@ -4023,6 +4826,11 @@ Status CatalogManager::ProcessPendingAssignments(
 
   DeferredAssignmentActions deferred;
 
+  TSDescriptorVector ts_descs;
+  master_->ts_manager()->GetAllLiveDescriptors(&ts_descs);
+  ReplicaPlacementPlan plan(std::move(ts_descs));
+  int num_paced_tablets = 0;
+
   // Any tablets created by the helper functions will also be created in a
   // locked state, so we must ensure they are unlocked before we return to
   // avoid deadlocks.
@@ -4039,8 +4847,16 @@ Status CatalogManager::ProcessPendingAssignments(
 
     switch (t_state) {
       case SysTabletsEntryPB::PREPARING:
+      {
+        // Leave the tablet for a later round if this one is full.
+        TableMetadataLock table_lock(tablet->table().get(), LockMode::READ);
+        if (!plan.TryReserve(table_lock.data().pb.num_replicas())) {
+          num_paced_tablets++;
+          break;
+        }
         HandleAssignPreparingTablet(tablet, &deferred);
         break;
+      }
 
       case SysTabletsEntryPB::CREATING:
       {
@@ -4058,6 +4874,11 @@ Status CatalogManager::ProcessPendingAssignments(
     }
   }
 
+  if (num_paced_tablets > 0) {
+    VLOG(1) << Substitute("Deferring assignment of $0 tablets to later rounds",
+                          num_paced_tablets);
+  }
+
   // Nothing to do
   if (deferred.tablets_to_add.empty() &&
       deferred.tablets_to_update.empty() &&
@@ -4066,14 +4887,11 @@ Status CatalogManager::ProcessPendingAssignments(
   }
 
   // For those tablets which need to be created in this round, assign replicas.
-  TSDescriptorVector ts_descs;
-  master_->ts_manager()->GetAllLiveDescriptors(&ts_descs);
-
   for (const auto& tablet : deferred.needs_create_rpc) {
     // NOTE: if we fail to select replicas on the first pass (due to
     // insufficient Tablet Servers being online), we will still try
     // again unless the tablet/table creation is cancelled.
-    RETURN_NOT_OK_PREPEND(SelectReplicasForTablet(ts_descs, tablet),
+    RETURN_NOT_OK_PREPEND(SelectReplicasForTablet(&plan, tablet),
                           Substitute("error selecting replicas for tablet $0", tablet->id()));
   }
 
@@ -4120,7 +4938,7 @@ Status CatalogManager::ProcessPendingAssignments(
   return Status::OK();
 }
 
-Status CatalogManager::SelectReplicasForTablet(const TSDescriptorVector& ts_descs,
+Status CatalogManager::SelectReplicasForTablet(ReplicaPlacementPlan* plan,
                                                const scoped_refptr<TabletInfo>& tablet) {
   TableMetadataLock table_guard(tablet->table().get(), LockMode::READ);
 
@@ -4132,11 +4950,11 @@ Status CatalogManager::SelectReplicasForTablet(const TSDescriptorVector& ts_desc
 
   int nreplicas = table_guard.data().pb.num_replicas();
 
-  if (ts_descs.size() < nreplicas) {
+  if (plan->ts_descs().size() < nreplicas) {
     return Status::InvalidArgument(
         Substitute("Not enough tablet servers are online for table '$0'. Need at least $1 "
                    "replicas, but only $2 tablet servers are available",
-                   table_guard.data().name(), nreplicas, ts_descs.size()));
+                   table_guard.data().name(), nreplicas, plan->ts_descs().size()));
   }
 
   // Select the set of replicas for the tablet.
@@ -4153,7 +4971,8 @@ Status CatalogManager::SelectReplicasForTablet(const TSDescriptorVector& ts_desc
   }
 
   config->set_opid_index(consensus::kInvalidOpIdIndex);
-  SelectReplicas(ts_descs, nreplicas, config);
+  SelectReplicas(plan->ServersWithRoom(nreplicas), nreplicas, config,
+                 tablet->table()->id(), plan);
   return Status::OK();
 }
 
@@ -4173,7 +4992,9 @@ void CatalogManager::SendCreateTabletRequest(const scoped_refptr<TabletInfo>& ta
 
 void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
                                     int nreplicas,
-                                    RaftConfigPB *config) {
+                                    RaftConfigPB *config,
+                                    const string& table_id,
+                                    ReplicaPlacementPlan* plan) {
   DCHECK_EQ(0, config->peers_size()) << "RaftConfig not empty: " << SecureShortDebugString(*config);
   DCHECK_LE(nreplicas, ts_descs.size());
 
@@ -4181,7 +5002,8 @@ void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
   // put two replicas on the same host.
   set<shared_ptr<TSDescriptor> > already_selected;
   for (int i = 0; i < nreplicas; ++i) {
-    shared_ptr<TSDescriptor> ts = SelectReplica(ts_descs, already_selected, &rng_);
+    shared_ptr<TSDescriptor> ts = SelectReplica(ts_descs, already_selected, &rng_,
+                                                plan->table_replicas(table_id));
     // We must be able to find a tablet server for the replica because of
     // checks before this function is called.
     DCHECK(ts) << "ts_descs: " << ts_descs.size()
@@ -4192,6 +5014,7 @@ void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
     // account when assigning replicas for other tablets of the same table. This
     // value decays back to 0 over time.
     ts->IncrementRecentReplicaCreations();
+    plan->AddReplica(table_id, ts->permanent_uuid());
 
     ServerRegistrationPB reg;
     ts->GetRegistration(&reg);
@@ -4260,6 +5083,9 @@ Status CatalogManager::BuildLocationsForTablet(
       ServerRegistrationPB reg;
       ts_desc->GetRegistration(&reg);
       tsinfo_pb->mutable_rpc_addresses()->Swap(reg.mutable_rpc_addresses());
+      if (reg.has_unix_domain_socket_path()) {
+        tsinfo_pb->set_unix_domain_socket_path(reg.unix_domain_socket_path());
+      }
     } else {
       // If we've never received a heartbeat from the tserver, we'll fall back
       // to the last known RPC address in the RaftPeerPB.
@@ -4287,7 +5113,7 @@ Status CatalogManager::GetTabletLocations(const string& tablet_id,
   locs_pb->mutable_replicas()->Clear();
   scoped_refptr<TabletInfo> tablet_info;
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     if (!FindCopy(tablet_map_, tablet_id, &tablet_info)) {
       return Status::NotFound(Substitute("Unknown tablet $0", tablet_id));
     }
@@ -4323,6 +5149,19 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
   }
   RETURN_NOT_OK(CheckIfTableDeletedOrNotRunning(&l, resp));
 
+  // The key embeds the versions the response is built from, so it must be
+  // made before looking up the tablets.
+  string cache_key;
+  if (table_locations_cache_) {
+    cache_key = TableLocationsCache::MakeKey(
+        *table, master_->ts_manager()->registration_version(), *req);
+    if (table_locations_cache_->Get(cache_key, resp)) {
+      TRACE("Found table locations in cache");
+      resp->set_ttl_millis(FLAGS_table_locations_ttl_ms);
+      return Status::OK();
+    }
+  }
+
   vector<scoped_refptr<TabletInfo>> tablets_in_range;
   table->GetTabletsInRange(req, &tablets_in_range);
 
@@ -4352,6 +5191,9 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
           << s.ToString();
     }
   }
+  if (table_locations_cache_ && !resp->has_error()) {
+    table_locations_cache_->Put(cache_key, *resp);
+  }
   resp->set_ttl_millis(FLAGS_table_locations_ttl_ms);
   return Status::OK();
 }
@@ -4363,7 +5205,7 @@ void CatalogManager::DumpState(std::ostream* out) const {
   // Copy the internal state so that, if the output stream blocks,
   // we don't end up holding the lock for a long time.
   {
-    shared_lock<LockType> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     ids_copy = table_ids_map_;
     names_copy = table_names_map_;
     tablets_copy = tablet_map_;
@@ -4517,6 +5359,30 @@ bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrResp
   return false;
 }
 
+template<typename RespClass>
+bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeLookupsOrRespond(
+    bool allow_follower, int64_t min_catalog_version, int64_t* follower_catalog_version,
+    RespClass* resp, RpcContext* rpc) {
+  *follower_catalog_version = -1;
+  Status s = first_failed_status();
+  if (PREDICT_TRUE(s.ok())) {
+    return true;
+  }
+  // A follower, not just a leader which is not yet ready, may serve the lookup.
+  if (allow_follower && catalog_status_.ok() && leader_status_.IsIllegalState() &&
+      owns_lock()) {
+    s = catalog_->CheckFollowerCatalogIsFresh(min_catalog_version, follower_catalog_version);
+    if (s.ok()) {
+      return true;
+    }
+  }
+
+  StatusToPB(s, resp->mutable_error()->mutable_status());
+  resp->mutable_error()->set_code(MasterErrorPB::NOT_THE_LEADER);
+  rpc->RespondSuccess();
+  return false;
+}
+
 // Explicit specialization for callers outside this compilation unit.
 #define INITTED_OR_RESPOND(RespClass) \
   template bool \
@@ -4526,6 +5392,11 @@ bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrResp
   template bool \
   CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrRespond( \
       RespClass* resp, RpcContext* rpc)
+#define INITTED_AND_CAN_SERVE_LOOKUPS_OR_RESPOND(RespClass) \
+  template bool \
+  CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeLookupsOrRespond( \
+      bool allow_follower, int64_t min_catalog_version, int64_t* follower_catalog_version, \
+      RespClass* resp, RpcContext* rpc)
 
 INITTED_OR_RESPOND(ConnectToMasterResponsePB);
 INITTED_OR_RESPOND(GetMasterRegistrationResponsePB);
@@ -4539,9 +5410,12 @@ INITTED_AND_LEADER_OR_RESPOND(ListTablesResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableLocationsResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableSchemaResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTabletLocationsResponsePB);
+INITTED_AND_CAN_SERVE_LOOKUPS_OR_RESPOND(GetTableLocationsResponsePB);
+INITTED_AND_CAN_SERVE_LOOKUPS_OR_RESPOND(GetTabletLocationsResponsePB);
 
 #undef INITTED_OR_RESPOND
 #undef INITTED_AND_LEADER_OR_RESPOND
+#undef INITTED_AND_CAN_SERVE_LOOKUPS_OR_RESPOND
 
 ////////////////////////////////////////////////////////////
 // TabletInfo
@@ -4635,7 +5509,25 @@ void PersistentTabletInfo::set_state(SysTabletsEntryPB::State state, const strin
 // TableInfo
 ////////////////////////////////////////////////////////////
 
-TableInfo::TableInfo(string table_id) : table_id_(std::move(table_id)) {}
+namespace {
+
+// The source of the locations versions of all tables.
+std::atomic<int64_t> g_next_locations_version(0);
+
+int64_t NextLocationsVersion() {
+  return g_next_locations_version.fetch_add(1) + 1;
+}
+
+} // anonymous namespace
+
+TableInfo::TableInfo(string table_id)
+    : table_id_(std::move(table_id)),
+      locations_version_(NextLocationsVersion()) {
+}
+
+void TableInfo::InvalidateLocations() {
+  locations_version_.store(NextLocationsVersion(), std::memory_order_release);
+}
 
 TableInfo::~TableInfo() {
 }
@@ -4668,6 +5560,7 @@ void TableInfo::AddRemoveTablets(const vector<scoped_refptr<TabletInfo>>& tablet
     }
     IncrementSchemaVersionCountUnlocked(tablet->reported_schema_version());
   }
+  InvalidateLocations();
 
 #ifndef NDEBUG
   if (tablet_map_.empty()) {
@@ -4676,6 +5569,18 @@ void TableInfo::AddRemoveTablets(const vector<scoped_refptr<TabletInfo>>& tablet
 #endif
 }
 
+void TableInfo::RemoveTabletIfPresent(const scoped_refptr<TabletInfo>& tablet) {
+  std::lock_guard<rw_spinlock> l(lock_);
+  const auto& lower_bound = tablet->metadata().state().pb.partition().partition_key_start();
+  auto it = tablet_map_.find(lower_bound);
+  if (it == tablet_map_.end() || it->second != tablet.get()) {
+    return;
+  }
+  tablet_map_.erase(it);
+  DecrementSchemaVersionCountUnlocked(tablet->reported_schema_version());
+  InvalidateLocations();
+}
+
 void TableInfo::GetTabletsInRange(const GetTableLocationsRequestPB* req,
                                   vector<scoped_refptr<TabletInfo>>* ret) const {
   shared_lock<rw_spinlock> l(lock_);
@@ -4731,6 +5636,18 @@ bool TableInfo::IsCreateInProgress() const {
   return false;
 }
 
+void TableInfo::GetCreateProgress(int* num_tablets, int* num_running_tablets) const {
+  shared_lock<rw_spinlock> l(lock_);
+  *num_tablets = tablet_map_.size();
+  *num_running_tablets = 0;
+  for (const auto& e : tablet_map_) {
+    TabletMetadataLock tablet_lock(e.second, LockMode::READ);
+    if (tablet_lock.data().is_running()) {
+      (*num_running_tablets)++;
+    }
+  }
+}
+
 void TableInfo::AddTask(MonitoredTask* task) {
   task->AddRef();
   {
@@ -17,6 +17,7 @@
 #ifndef KUDU_MASTER_CATALOG_MANAGER_H
 #define KUDU_MASTER_CATALOG_MANAGER_H
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <iosfwd>
@@ -87,12 +88,15 @@ class TabletReplica;
 
 namespace master {
 
+class AutoRebalancer;
 class CatalogManagerBgTasks;
 class Master;
 class SysCatalogTable;
 class TSDescriptor;
 class TableInfo;
+class TableLocationsCache;
 
+class ReplicaPlacementPlan;
 struct DeferredAssignmentActions;
 
 // The data related to a tablet which is persisted on disk.
@@ -244,6 +248,10 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
   void AddRemoveTablets(const std::vector<scoped_refptr<TabletInfo>>& tablets_to_add,
                         const std::vector<scoped_refptr<TabletInfo>>& tablets_to_drop);
 
+  // Removes 'tablet' from this table, unless another tablet has replaced it
+  // already. The tablet lock in READ mode or greater must be held.
+  void RemoveTabletIfPresent(const scoped_refptr<TabletInfo>& tablet);
+
   // This only returns tablets which are in RUNNING state.
   void GetTabletsInRange(const GetTableLocationsRequestPB* req,
                          std::vector<scoped_refptr<TabletInfo>>* ret) const;
@@ -259,6 +267,10 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
   // Returns true if the table creation is in-progress
   bool IsCreateInProgress() const;
 
+  // Sets 'num_tablets' to the number of the table's tablets, and
+  // 'num_running_tablets' to the number of those which are RUNNING.
+  void GetCreateProgress(int* num_tablets, int* num_running_tablets) const;
+
   // Returns true if an "Alter" operation is in-progress
   bool IsAlterInProgress(uint32_t version) const;
 
@@ -286,6 +298,17 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
     return tablet_map_.size();
   }
 
+  // Returns the version of the locations of the table's tablets. It changes
+  // whenever InvalidateLocations() is called, and a version is never reused,
+  // not even by another TableInfo object for the same table.
+  int64_t locations_version() const {
+    return locations_version_.load(std::memory_order_acquire);
+  }
+
+  // Marks the locations of the table's tablets as changed. Must be called
+  // after publishing the change.
+  void InvalidateLocations();
+
  private:
   friend class RefCountedThreadSafe<TableInfo>;
   friend class TabletInfo;
@@ -324,6 +347,9 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
   // tablet_map_ and summing up the tablets' reported schema versions.
   std::map<int64_t, int64_t> schema_version_counts_;
 
+  // See locations_version().
+  std::atomic<int64_t> locations_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TableInfo);
 };
 
@@ -381,6 +407,19 @@ typedef MetadataLock<TabletInfo> TabletMetadataLock;
 typedef MetadataGroupLock<TableInfo> TableMetadataGroupLock;
 typedef MetadataGroupLock<TabletInfo> TabletMetadataGroupLock;
 
+// A change to a table or tablet entry of the system catalog, decoded from a
+// write which a follower master applied to its replica of the catalog.
+struct CatalogEntryChange {
+  // Whether the entry is a table entry; otherwise it's a tablet entry.
+  bool is_table;
+  std::string entry_id;
+
+  // Whether the entry was deleted; otherwise 'metadata' holds the serialized
+  // SysTablesEntryPB or SysTabletsEntryPB of the inserted or updated entry.
+  bool deleted;
+  std::string metadata;
+};
+
 // The component of the master which tracks the state and location
 // of tables/tablets in the cluster.
 //
@@ -476,6 +515,23 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
     template<typename RespClass>
     bool CheckIsInitializedAndIsLeaderOrRespond(RespClass* resp, rpc::RpcContext* rpc);
 
+    // Check that the catalog manager is initialized and that it may serve
+    // tablet location lookups: either it is the leader of its Raft
+    // configuration or, if 'allow_follower' is true, it is a follower whose
+    // copy of the catalog is fresh and reflects at least 'min_catalog_version'.
+    //
+    // If a follower may serve the lookup, sets 'follower_catalog_version' to
+    // the catalog version of its copy, otherwise to -1. If the lookup may not
+    // be served, writes the corresponding error to 'resp', responds to 'rpc',
+    // and returns false. NOT_THE_LEADER is the error code of a follower which
+    // may not serve the lookup.
+    template<typename RespClass>
+    bool CheckIsInitializedAndCanServeLookupsOrRespond(bool allow_follower,
+                                                       int64_t min_catalog_version,
+                                                       int64_t* follower_catalog_version,
+                                                       RespClass* resp,
+                                                       rpc::RpcContext* rpc);
+
    private:
     CatalogManager* catalog_;
     shared_lock<RWMutex> leader_shared_lock_;
@@ -557,7 +613,8 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   Status GetTableSchema(const GetTableSchemaRequestPB* req,
                         GetTableSchemaResponsePB* resp);
 
-  // List all the running tables
+  // List all the running tables, or a page of them in the order of their
+  // names if the request asks for paging.
   Status ListTables(const ListTablesRequestPB* req,
                     ListTablesResponsePB* resp);
 
@@ -576,6 +633,27 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                             master::ReplicaTypeFilter filter,
                             TabletLocationsPB* locs_pb);
 
+  // Returns the catalog version of the tablet locations served by the leader
+  // master: the index of the last committed operation on the system catalog.
+  int64_t GetLeaderCatalogVersion() const;
+
+  // Returns OK if this follower master may serve tablet location lookups
+  // from its copy of the tables and tablets: the copy was brought up to date
+  // with the local replica of the system catalog recently enough, and its
+  // catalog version is at least 'min_catalog_version'. On success, sets
+  // 'catalog_version' to the version of the copy. Caller must hold
+  // leader_lock_.
+  Status CheckFollowerCatalogIsFresh(int64_t min_catalog_version,
+                                     int64_t* catalog_version) const;
+
+  // Queues the changes to the tables and tablets made by the write to the
+  // system catalog at 'op_index', which this master applied as a follower,
+  // for them to be applied to its copy of the tables and tablets. If 's' is
+  // not OK, the changes couldn't be decoded and the copy must be reloaded.
+  void QueueFollowerCatalogChanges(int64_t op_index,
+                                   const Status& s,
+                                   std::vector<CatalogEntryChange> changes);
+
   // Handle a tablet report from the given tablet server.
   //
   // The RPC context is provided for logging/tracing purposes,
@@ -587,6 +665,8 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
 
   SysCatalogTable* sys_catalog() { return sys_catalog_.get(); }
 
+  const AutoRebalancer* auto_rebalancer() const { return auto_rebalancer_.get(); }
+
   // Returns the Master tablet's RaftConsensus instance if it is initialized, or
   // else a nullptr.
   std::shared_ptr<consensus::RaftConsensus> master_consensus() const;
@@ -693,6 +773,29 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // of authn tokens.
   Status PrepareFollowerTokenVerifier();
 
+  // Reload the tables and tablets of a follower catalog manager from the
+  // local replica of the system catalog if it has changed since the last
+  // reload, so the follower may serve tablet location lookups.
+  Status RefreshFollowerCatalog();
+
+  // Brings the copy of the tables and tablets of a follower catalog manager
+  // up to date with catalog version 'version', applying the queued changes
+  // if the copy is kept up to date incrementally and reloading it otherwise.
+  // Caller must hold lock_ for writing.
+  Status CatchUpFollowerCatalogUnlocked(int64_t version);
+
+  // Applies the changes to the tables and tablets of a follower catalog
+  // manager. Returns an error if they don't apply to the current copy, which
+  // must then be reloaded. Caller must hold lock_ for writing.
+  Status ApplyFollowerCatalogChanges(const std::vector<CatalogEntryChange>& changes);
+  Status ApplyFollowerTableChange(const CatalogEntryChange& change);
+  Status ApplyFollowerTabletChange(const CatalogEntryChange& change);
+
+  // Loads the tables and tablets for a newly elected leader catalog manager:
+  // if the copy it kept up to date as a follower is current, just applies the
+  // last queued changes; otherwise, reloads them from the system catalog.
+  Status LoadTablesAndTabletsForLeadership();
+
   // Clears out the existing metadata ('table_names_map_', 'table_ids_map_',
   // and 'tablet_map_'), loads tables metadata into memory and if successful
   // loads the tablets metadata.
@@ -700,6 +803,11 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // This is called by tests only.
   Status VisitTablesAndTablets();
 
+  // Does the work of VisitTablesAndTabletsUnlocked() for both the leader and
+  // follower catalog manager. If 'verbose' is false, the loaded entries are
+  // not logged. Caller must hold lock_ for writing.
+  Status ReloadTablesAndTablets(bool verbose = true);
+
   // Helper for initializing 'sys_catalog_'. After calling this
   // method, the caller should call WaitUntilRunning() on sys_catalog_
   // WITHOUT holding 'lock_' to wait for consensus to start for
@@ -769,6 +877,11 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Extract the set of tablets that must be processed because not running yet.
   void ExtractTabletsToProcess(std::vector<scoped_refptr<TabletInfo>>* tablets_to_process);
 
+  // If it's time for a round of rebalancing, plans it given the current
+  // placement of the replicas and schedules the replica moves and leader
+  // step-downs. See --auto_rebalancing_enabled.
+  void RunAutoRebalancerRound();
+
   // Check if it's time to generate a new Token Signing Key for TokenSigner.
   // If so, generate one and persist it into the system table. After that,
   // push it into the TokenSigner's key queue.
@@ -802,22 +915,25 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Loops through the "not created" tablets and sends a CreateTablet() request.
   Status ProcessPendingAssignments(const std::vector<scoped_refptr<TabletInfo> >& tablets);
 
-  // Select N Replicas from online tablet servers (as specified by
-  // 'ts_descs') for the specified tablet and populate the consensus configuration
-  // object. If 'ts_descs' does not specify enough online tablet
-  // servers to select the N replicas, return Status::InvalidArgument.
+  // Select N Replicas from the online tablet servers of 'plan' for the
+  // specified tablet and populate the consensus configuration object. If
+  // there aren't enough online tablet servers to select the N replicas,
+  // return Status::InvalidArgument.
   //
   // This method is called by "ProcessPendingAssignments()".
-  Status SelectReplicasForTablet(const TSDescriptorVector& ts_descs,
+  Status SelectReplicasForTablet(ReplicaPlacementPlan* plan,
                                  const scoped_refptr<TabletInfo>& tablet);
 
-  // Select N Replicas from the online tablet servers
-  // and populate the consensus configuration object.
+  // Select N Replicas from the tablet servers in 'ts_descs' for a tablet of
+  // the given table, populate the consensus configuration object and record
+  // the replicas in 'plan'.
   //
   // This method is called by "SelectReplicasForTablet".
   void SelectReplicas(const TSDescriptorVector& ts_descs,
                       int nreplicas,
-                      consensus::RaftConfigPB *config);
+                      consensus::RaftConfigPB *config,
+                      const std::string& table_id,
+                      ReplicaPlacementPlan* plan);
 
   // Handles 'tablet' currently in the PREPARING state.
   //
@@ -880,7 +996,12 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // easy to make a "gettable set".
 
   // Lock protecting the various maps and sets below.
-  typedef rw_spinlock LockType;
+  //
+  // Readers (location lookups, heartbeats, table listings) vastly outnumber
+  // writers (DDL), so the lock is sharded per CPU: readers take the shard of
+  // their CPU via lock_.get_lock() and don't bounce a shared cache line
+  // between cores, while writers take all the shards.
+  typedef percpu_rwlock LockType;
   mutable LockType lock_;
 
   // Table maps: table-id -> TableInfo and table-name -> TableInfo
@@ -931,6 +1052,13 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Singleton pool that serializes invocations of ElectedAsLeaderCb().
   gscoped_ptr<ThreadPool> leader_election_pool_;
 
+  // Cache of GetTableLocations responses. NULL if disabled by
+  // --table_locations_cache_capacity_mb.
+  gscoped_ptr<TableLocationsCache> table_locations_cache_;
+
+  // Plans the rounds of replica and leader rebalancing, and tracks their stats.
+  gscoped_ptr<AutoRebalancer> auto_rebalancer_;
+
   // This field is updated when a node becomes leader master,
   // waits for all outstanding uncommitted metadata (table and tablet metadata)
   // in the sys catalog to commit, and then reads that metadata into in-memory
@@ -950,6 +1078,19 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Always acquire this lock before state_lock_.
   RWMutex leader_lock_;
 
+  // The catalog version of the tables and tablets loaded by a follower
+  // catalog manager, and the last time they were known to be up to date with
+  // the local replica of the system catalog. Protected by lock_.
+  int64_t follower_catalog_version_;
+  MonoTime follower_catalog_refresh_time_;
+
+  // The changes queued by QueueFollowerCatalogChanges() which are yet to be
+  // applied, along with the index of the write which made them, and the
+  // index of the last write whose changes were lost, if any.
+  simple_spinlock follower_changes_lock_;
+  std::vector<std::pair<int64_t, std::vector<CatalogEntryChange>>> follower_changes_;
+  int64_t follower_changes_lost_index_;
+
   // Async operations are accessing some private methods
   // (TODO: this stuff should be deferred and done in the background thread)
   friend class AsyncAlterTable;
@@ -101,6 +101,7 @@ using strings::Substitute;
 DECLARE_bool(catalog_manager_check_ts_count_for_create_table);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_double(sys_catalog_fail_during_write);
+DECLARE_int32(list_tables_max_page_tablets);
 DECLARE_int32(master_inject_latency_on_tablet_lookups_ms);
 
 namespace kudu {
@@ -330,6 +331,43 @@ TEST_F(MasterTest, TestRegisterAndHeartbeat) {
     ASSERT_FALSE(resp.needs_reregister());
     ASSERT_FALSE(resp.needs_full_tablet_report());
     ASSERT_TRUE(resp.has_tablet_report());
+    ASSERT_TRUE(resp.accepts_unchanged_consensus_states());
+  }
+
+  // An incremental report may omit the consensus state of a tablet whose
+  // consensus state hasn't changed. The master ignores unknown tablets, but
+  // it must accept the report.
+  {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    TabletReportPB* tr = req.mutable_tablet_report();
+    tr->set_is_incremental(true);
+    tr->set_sequence_number(1);
+    ReportedTabletPB* reported = tr->add_updated_tablets();
+    reported->set_tablet_id("unknown-tablet");
+    reported->set_consensus_state_unchanged(true);
+    reported->set_committed_config_opid_index(1);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.leader_master());
+    ASSERT_TRUE(resp.has_tablet_report());
+  }
+
+  // Load statistics of the tablet replicas may be sent with any heartbeat.
+  {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    TabletLoadStatsPB* stats = req.add_tablet_load_stats();
+    stats->set_tablet_id("hot-tablet");
+    stats->set_on_disk_size(1024);
+    stats->set_rows_written_per_sec(100);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error());
   }
 
   master_->ts_manager()->GetAllDescriptors(&descs);
@@ -350,6 +388,25 @@ TEST_F(MasterTest, TestRegisterAndHeartbeat) {
     ASSERT_EQ(1, resp.servers_size());
     ASSERT_EQ("my-ts-uuid", resp.servers(0).instance_id().permanent_uuid());
     ASSERT_EQ(1, resp.servers(0).instance_id().instance_seqno());
+    ASSERT_EQ(0, resp.servers(0).tablet_load_stats_size());
+  }
+
+  // The load statistics of the replicas are listed on request.
+  {
+    ListTabletServersRequestPB req;
+    ListTabletServersResponsePB resp;
+    RpcController rpc;
+    req.set_include_tablet_load_stats(true);
+    ASSERT_OK(proxy_->ListTabletServers(req, &resp, &rpc));
+
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(1, resp.servers_size());
+    ASSERT_EQ(1, resp.servers(0).tablet_load_stats_size());
+    const TabletLoadStatsPB& stats = resp.servers(0).tablet_load_stats(0);
+    ASSERT_EQ("hot-tablet", stats.tablet_id());
+    ASSERT_EQ(1024, stats.on_disk_size());
+    ASSERT_EQ(100, stats.rows_written_per_sec());
+    ASSERT_FALSE(stats.has_rows_scanned_per_sec());
   }
 
   // Ensure that /dump-entities endpoint also shows the faked server.
@@ -578,6 +635,57 @@ TEST_F(MasterTest, TestCatalog) {
   }
 }
 
+TEST_F(MasterTest, TestListTablesInPages) {
+  const Schema kTableSchema({ ColumnSchema("key", INT32) }, 1);
+  const int kNumTables = 5;
+  for (int i = kNumTables - 1; i >= 0; i--) {
+    ASSERT_OK(CreateTable(Substitute("table-$0", i), kTableSchema));
+  }
+
+  // Page through the tables, two at a time, in the order of their names.
+  vector<string> names;
+  ListTablesRequestPB req;
+  req.set_max_returned_tables(2);
+  req.set_include_tablet_locations(true);
+  while (true) {
+    ListTablesResponsePB resp;
+    NO_FATALS(DoListTables(req, &resp));
+    ASSERT_LE(resp.tables_size(), 2);
+    for (const auto& table : resp.tables()) {
+      names.push_back(table.name());
+      ASSERT_GT(table.num_replicas(), 0);
+      ASSERT_TRUE(table.has_schema());
+      // No tablet servers are running, so the tablets have no replicas.
+      ASSERT_EQ(3, table.tablet_locations_size());
+      for (const auto& locs : table.tablet_locations()) {
+        ASSERT_EQ(0, locs.replicas_size());
+      }
+    }
+    if (!resp.has_next_page_token()) {
+      break;
+    }
+    req.set_page_token(resp.next_page_token());
+  }
+  ASSERT_EQ((vector<string>{ "table-0", "table-1", "table-2", "table-3", "table-4" }), names);
+
+  // Pages are cut short once they hold enough tablets.
+  FLAGS_list_tables_max_page_tablets = 1;
+  ListTablesRequestPB page_req;
+  page_req.set_max_returned_tables(kNumTables);
+  page_req.set_include_tablet_locations(true);
+  ListTablesResponsePB resp;
+  NO_FATALS(DoListTables(page_req, &resp));
+  ASSERT_EQ(1, resp.tables_size());
+  ASSERT_EQ("table-0", resp.next_page_token());
+
+  // Tables listed without paging don't come with their tablets.
+  ListTablesResponsePB all_tables;
+  NO_FATALS(DoListAllTables(&all_tables));
+  ASSERT_EQ(kNumTables, all_tables.tables_size());
+  ASSERT_FALSE(all_tables.has_next_page_token());
+  ASSERT_EQ(0, all_tables.tables(0).tablet_locations_size());
+}
+
 TEST_F(MasterTest, TestCreateTableCheckRangeInvariants) {
   const char *kTableName = "testtb";
   const Schema kTableSchema({ ColumnSchema("key", INT32), ColumnSchema("val", INT32) }, 1);
@@ -31,6 +31,7 @@
 #include <vector>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/common/common.pb.h"
@@ -44,9 +45,11 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/auto_rebalancer.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
@@ -67,6 +70,8 @@
 #include "kudu/util/url-coding.h"
 #include "kudu/util/web_callback_registry.h"
 
+DECLARE_bool(auto_rebalancing_enabled);
+
 namespace kudu {
 
 using consensus::ConsensusStatePB;
@@ -82,6 +87,9 @@ using strings::Substitute;
 
 namespace master {
 
+// The number of the busiest tablet replicas listed on the tablet servers page.
+static const size_t kNumHotReplicasToShow = 20;
+
 MasterPathHandlers::~MasterPathHandlers() {
 }
 
@@ -133,6 +141,61 @@ void MasterPathHandlers::HandleTabletServers(const Webserver::WebRequest& /*req*
     version_count_json["live"] = Substitute("$0", entry.second[0]);
     version_count_json["dead"] = Substitute("$0", entry.second[1]);
   }
+
+  // List the busiest replicas, by the rate of rows written and scanned, as
+  // of the latest load statistics of the live tablet servers.
+  vector<pair<string, TabletLoadStatsPB>> replica_stats;
+  for (const auto& desc : descs) {
+    if (desc->PresumedDead()) {
+      continue;
+    }
+    for (auto& stats : desc->tablet_load_stats()) {
+      replica_stats.emplace_back(desc->permanent_uuid(), std::move(stats));
+    }
+  }
+  const auto load = [](const TabletLoadStatsPB& stats) {
+    return stats.rows_written_per_sec() + stats.rows_scanned_per_sec();
+  };
+  const size_t num_hot_replicas = std::min<size_t>(replica_stats.size(), kNumHotReplicasToShow);
+  std::partial_sort(replica_stats.begin(), replica_stats.begin() + num_hot_replicas,
+                    replica_stats.end(),
+                    [&](const pair<string, TabletLoadStatsPB>& a,
+                        const pair<string, TabletLoadStatsPB>& b) {
+                      return load(a.second) > load(b.second);
+                    });
+  (*output)["has_no_hot_replicas"] = num_hot_replicas == 0;
+  output->Set("hot_replicas", EasyJson::kArray);
+  for (size_t i = 0; i < num_hot_replicas; i++) {
+    const auto& stats = replica_stats[i].second;
+    EasyJson replica_json = (*output)["hot_replicas"].PushBack(EasyJson::kObject);
+    replica_json["tablet_id"] = stats.tablet_id();
+    replica_json["uuid"] = replica_stats[i].first;
+    replica_json["on_disk_size"] = HumanReadableNumBytes::ToString(stats.on_disk_size());
+    replica_json["rows_written_per_sec"] = StringPrintf("%.1f", stats.rows_written_per_sec());
+    replica_json["rows_scanned_per_sec"] = StringPrintf("%.1f", stats.rows_scanned_per_sec());
+    replica_json["bytes_scanned_per_sec"] =
+        HumanReadableNumBytes::ToString(static_cast<int64_t>(stats.bytes_scanned_per_sec())) +
+        "/s";
+  }
+
+  // List the replicas which their tablet servers deemed large or busy enough
+  // to split, along with the suggested split keys.
+  bool has_no_split_candidates = true;
+  output->Set("split_candidates", EasyJson::kArray);
+  for (const auto& entry : replica_stats) {
+    const auto& stats = entry.second;
+    if (!stats.has_split_key()) {
+      continue;
+    }
+    has_no_split_candidates = false;
+    EasyJson candidate_json = (*output)["split_candidates"].PushBack(EasyJson::kObject);
+    candidate_json["tablet_id"] = stats.tablet_id();
+    candidate_json["uuid"] = entry.first;
+    candidate_json["on_disk_size"] = HumanReadableNumBytes::ToString(stats.on_disk_size());
+    candidate_json["rows_written_per_sec"] = StringPrintf("%.1f", stats.rows_written_per_sec());
+    candidate_json["split_key"] = stats.split_key_debug_string();
+  }
+  (*output)["has_no_split_candidates"] = has_no_split_candidates;
 }
 
 namespace {
@@ -376,6 +439,36 @@ void MasterPathHandlers::HandleTablePage(const Webserver::WebRequest& req,
   TaskListToJson(task_list, output);
 }
 
+void MasterPathHandlers::HandleRebalancer(const Webserver::WebRequest& req,
+                                          Webserver::WebResponse* resp) {
+  EasyJson* output = resp->output;
+  CatalogManager::ScopedLeaderSharedLock l(master_->catalog_manager());
+  if (!l.catalog_status().ok()) {
+    (*output)["error"] = Substitute("Master is not ready: $0",  l.catalog_status().ToString());
+    return;
+  }
+  if (!l.leader_status().ok()) {
+    // Only the leader master rebalances.
+    int redirects = ExtractRedirectsFromRequest(req);
+    SetupLeaderMasterRedirect("rebalancer?", redirects, output);
+    return;
+  }
+
+  const AutoRebalancer::Stats stats = master_->catalog_manager()->auto_rebalancer()->stats();
+  (*output)["enabled"] = FLAGS_auto_rebalancing_enabled;
+  (*output)["num_rounds"] = stats.num_rounds;
+  if (stats.last_round_time.Initialized()) {
+    (*output)["time_since_last_round"] =
+        StringPrintf("%.1fs", (MonoTime::Now() - stats.last_round_time).ToSeconds());
+  }
+  (*output)["num_moves_scheduled"] = stats.num_moves_scheduled;
+  (*output)["num_step_downs_scheduled"] = stats.num_step_downs_scheduled;
+  (*output)["num_moves_in_progress"] = stats.num_moves_in_progress;
+  (*output)["replica_skew"] = stats.replica_skew;
+  (*output)["max_table_replica_skew"] = stats.max_table_replica_skew;
+  (*output)["leader_skew"] = stats.leader_skew;
+}
+
 void MasterPathHandlers::HandleMasters(const Webserver::WebRequest& /*req*/,
                                        Webserver::WebResponse* resp) {
   EasyJson* output = resp->output;
@@ -611,6 +704,10 @@ Status MasterPathHandlers::Register(Webserver* server) {
       "/table", "",
       boost::bind(&MasterPathHandlers::HandleTablePage, this, _1, _2),
       is_styled, false);
+  server->RegisterPathHandler(
+      "/rebalancer", "Rebalancer",
+      boost::bind(&MasterPathHandlers::HandleRebalancer, this, _1, _2),
+      is_styled, false);
   server->RegisterPathHandler(
       "/masters", "Masters",
       boost::bind(&MasterPathHandlers::HandleMasters, this, _1, _2),
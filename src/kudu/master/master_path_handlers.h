@@ -50,6 +50,8 @@ class MasterPathHandlers {
                             Webserver::WebResponse* resp);
   void HandleTablePage(const Webserver::WebRequest& req,
                        Webserver::WebResponse* resp);
+  void HandleRebalancer(const Webserver::WebRequest& req,
+                        Webserver::WebResponse* resp);
   void HandleMasters(const Webserver::WebRequest& req,
                      Webserver::WebResponse* resp);
   void HandleDumpEntities(const Webserver::WebRequest& req,
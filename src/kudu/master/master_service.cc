@@ -17,6 +17,7 @@
 
 #include "kudu/master/master_service.h"
 
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -149,6 +150,7 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   // 2. All responses contain this.
   resp->mutable_master_instance()->CopyFrom(server_->instance_pb());
   resp->set_leader_master(is_leader_master);
+  resp->set_accepts_unchanged_consensus_states(true);
 
   // 3. Register or look up the tserver.
   shared_ptr<TSDescriptor> ts_desc;
@@ -220,6 +222,10 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   // 4. Update tserver soft state based on the heartbeat contents.
   ts_desc->UpdateHeartbeatTime();
   ts_desc->set_num_live_replicas(req->num_live_tablets());
+  if (req->tablet_load_stats_size() > 0) {
+    ts_desc->set_tablet_load_stats(vector<TabletLoadStatsPB>(
+        req->tablet_load_stats().begin(), req->tablet_load_stats().end()));
+  }
 
   // 5. Only leaders handle tablet reports.
   if (is_leader_master && req->has_tablet_report()) {
@@ -265,7 +271,11 @@ void MasterServiceImpl::GetTabletLocations(const GetTabletLocationsRequestPB* re
                                            GetTabletLocationsResponsePB* resp,
                                            rpc::RpcContext* rpc) {
   CatalogManager::ScopedLeaderSharedLock l(server_->catalog_manager());
-  if (!l.CheckIsInitializedAndIsLeaderOrRespond(resp, rpc)) {
+  int64_t follower_catalog_version;
+  if (!l.CheckIsInitializedAndCanServeLookupsOrRespond(req->allow_follower(),
+                                                       req->min_catalog_version(),
+                                                       &follower_catalog_version,
+                                                       resp, rpc)) {
     return;
   }
 
@@ -288,6 +298,10 @@ void MasterServiceImpl::GetTabletLocations(const GetTabletLocationsRequestPB* re
       StatusToPB(s, err->mutable_status());
     }
   }
+  // The leader's version is read after the lookup, so it covers every change
+  // the lookup may have observed.
+  resp->set_catalog_version(follower_catalog_version >= 0 ?
+      follower_catalog_version : server_->catalog_manager()->GetLeaderCatalogVersion());
 
   rpc->RespondSuccess();
 }
@@ -374,7 +388,11 @@ void MasterServiceImpl::GetTableLocations(const GetTableLocationsRequestPB* req,
                                           GetTableLocationsResponsePB* resp,
                                           rpc::RpcContext* rpc) {
   CatalogManager::ScopedLeaderSharedLock l(server_->catalog_manager());
-  if (!l.CheckIsInitializedAndIsLeaderOrRespond(resp, rpc)) {
+  int64_t follower_catalog_version;
+  if (!l.CheckIsInitializedAndCanServeLookupsOrRespond(req->allow_follower(),
+                                                       req->min_catalog_version(),
+                                                       &follower_catalog_version,
+                                                       resp, rpc)) {
     return;
   }
 
@@ -383,6 +401,10 @@ void MasterServiceImpl::GetTableLocations(const GetTableLocationsRequestPB* req,
   }
   Status s = server_->catalog_manager()->GetTableLocations(req, resp);
   CheckRespErrorOrSetUnknown(s, resp);
+  if (!resp->has_error()) {
+    resp->set_catalog_version(follower_catalog_version >= 0 ?
+        follower_catalog_version : server_->catalog_manager()->GetLeaderCatalogVersion());
+  }
   rpc->RespondSuccess();
 }
 
@@ -409,6 +431,11 @@ void MasterServiceImpl::ListTabletServers(const ListTabletServersRequestPB* req,
     desc->GetNodeInstancePB(entry->mutable_instance_id());
     desc->GetRegistration(entry->mutable_registration());
     entry->set_millis_since_heartbeat(desc->TimeSinceHeartbeat().ToMilliseconds());
+    if (req->include_tablet_load_stats()) {
+      for (auto& stats : desc->tablet_load_stats()) {
+        entry->add_tablet_load_stats()->Swap(&stats);
+      }
+    }
   }
   rpc->RespondSuccess();
 }
@@ -515,7 +542,8 @@ bool MasterServiceImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case MasterFeatures::RANGE_PARTITION_BOUNDS:    FALLTHROUGH_INTENDED;
     case MasterFeatures::ADD_DROP_RANGE_PARTITIONS: FALLTHROUGH_INTENDED;
-    case MasterFeatures::REPLICA_MANAGEMENT:
+    case MasterFeatures::REPLICA_MANAGEMENT:        FALLTHROUGH_INTENDED;
+    case MasterFeatures::LIST_TABLES_PAGING:
       return true;
     case MasterFeatures::CONNECT_TO_MASTER:
       return FLAGS_master_support_connect_to_master_rpc;
@@ -41,6 +41,8 @@
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
+#include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
@@ -347,6 +349,82 @@ void SysCatalogTable::SysCatalogStateChanged(const string& tablet_id, const stri
   }
 }
 
+void SysCatalogTable::ReplicaWriteApplied(int64_t op_index,
+                                          const WriteRequestPB& req,
+                                          bool has_row_errors) {
+  vector<CatalogEntryChange> changes;
+  Status s = has_row_errors ?
+      Status::IllegalState("some of the row operations failed") :
+      DecodeEntryChanges(req, &changes);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG_WITH_PREFIX(WARNING) << Substitute(
+        "Unable to decode the catalog changes of the write at index $0: $1",
+        op_index, s.ToString());
+  }
+  master_->catalog_manager()->QueueFollowerCatalogChanges(
+      op_index, s, std::move(changes));
+}
+
+Status SysCatalogTable::DecodeEntryChanges(const WriteRequestPB& req,
+                                           vector<CatalogEntryChange>* changes) const {
+  const Schema* tablet_schema = tablet_replica_->tablet()->schema();
+  Arena arena(32 * 1024);
+  RowOperationsPBDecoder decoder(&req.row_operations(), &schema_, tablet_schema, &arena);
+  vector<DecodedRowOperation> ops;
+  RETURN_NOT_OK(decoder.DecodeOperations(&ops));
+
+  const int type_col_idx = tablet_schema->find_column(kSysCatalogTableColType);
+  const int id_col_idx = tablet_schema->find_column(kSysCatalogTableColId);
+  const int metadata_col_idx = tablet_schema->find_column(kSysCatalogTableColMetadata);
+  const ColumnId metadata_col_id = tablet_schema->column_id(metadata_col_idx);
+  for (const auto& op : ops) {
+    // Inserted rows and the keys of updated and deleted rows alike are laid
+    // out per the tablet schema, with the key columns first.
+    ConstContiguousRow row(tablet_schema, op.row_data);
+    const int8_t entry_type =
+        *tablet_schema->ExtractColumnFromRow<INT8>(row, type_col_idx);
+    if (entry_type != TABLES_ENTRY && entry_type != TABLETS_ENTRY) {
+      continue;
+    }
+    CatalogEntryChange change;
+    change.is_table = entry_type == TABLES_ENTRY;
+    change.entry_id = tablet_schema->ExtractColumnFromRow<STRING>(row, id_col_idx)->ToString();
+    change.deleted = false;
+    switch (op.type) {
+      case RowOperationsPB::INSERT:
+        change.metadata =
+            tablet_schema->ExtractColumnFromRow<STRING>(row, metadata_col_idx)->ToString();
+        break;
+      case RowOperationsPB::UPDATE: {
+        RowChangeListDecoder update_decoder(op.changelist);
+        RETURN_NOT_OK(update_decoder.Init());
+        bool has_metadata = false;
+        while (update_decoder.HasNext()) {
+          RowChangeListDecoder::DecodedUpdate update;
+          RETURN_NOT_OK(update_decoder.DecodeNext(&update));
+          if (update.col_id == metadata_col_id && !update.null) {
+            change.metadata = update.raw_value.ToString();
+            has_metadata = true;
+          }
+        }
+        if (!has_metadata) {
+          return Status::Corruption("update of the catalog entry without metadata",
+                                    change.entry_id);
+        }
+        break;
+      }
+      case RowOperationsPB::DELETE:
+        change.deleted = true;
+        break;
+      default:
+        return Status::NotSupported("unexpected operation on the catalog entry",
+                                    change.entry_id);
+    }
+    changes->emplace_back(std::move(change));
+  }
+  return Status::OK();
+}
+
 Status SysCatalogTable::SetupTablet(const scoped_refptr<tablet::TabletMetadata>& metadata) {
   shared_ptr<Tablet> tablet;
   scoped_refptr<Log> log;
@@ -361,6 +439,10 @@ Status SysCatalogTable::SetupTablet(const scoped_refptr<tablet::TabletMetadata>&
       local_peer_pb_,
       master_->tablet_apply_pool(),
       Bind(&SysCatalogTable::SysCatalogStateChanged, Unretained(this), metadata->tablet_id())));
+  tablet_replica_->SetReplicaWriteCallback(
+      [this](int64_t op_index, const WriteRequestPB& req, bool has_row_errors) {
+        this->ReplicaWriteApplied(op_index, req, has_row_errors);
+      });
   Status s = tablet_replica_->Init(master_->raft_pool());
   if (!s.ok()) {
     tablet_replica_->SetError(s);
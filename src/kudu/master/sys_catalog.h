@@ -203,6 +203,17 @@ class SysCatalogTable {
 
   void SysCatalogStateChanged(const std::string& tablet_id, const std::string& reason);
 
+  // Invoked for each write to the system catalog which this master applies
+  // as a follower: passes the changes to the tables and tablets on to the
+  // catalog manager.
+  void ReplicaWriteApplied(int64_t op_index,
+                           const tserver::WriteRequestPB& req,
+                           bool has_row_errors);
+
+  // Decodes the changes to the table and tablet entries made by 'req'.
+  Status DecodeEntryChanges(const tserver::WriteRequestPB& req,
+                            std::vector<CatalogEntryChange>* changes) const;
+
   Status SetupTablet(const scoped_refptr<tablet::TabletMetadata>& metadata);
 
   // Use the master options to generate a new consensus configuration.
@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/table_locations_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/master/catalog_manager.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/test_util.h"
+
+using kudu::pb_util::SecureDebugString;
+using std::string;
+
+namespace kudu {
+namespace master {
+
+class TableLocationsCacheTest : public KuduTest {
+ protected:
+  static GetTableLocationsResponsePB MakeResponse(const string& tablet_id) {
+    GetTableLocationsResponsePB resp;
+    TabletLocationsPB* locs = resp.add_tablet_locations();
+    locs->set_tablet_id(tablet_id);
+    TabletLocationsPB::ReplicaPB* replica = locs->add_replicas();
+    replica->set_role(consensus::RaftPeerPB::LEADER);
+    replica->mutable_ts_info()->set_permanent_uuid("ts");
+    return resp;
+  }
+};
+
+TEST_F(TableLocationsCacheTest, TestGetAndPut) {
+  TableLocationsCache cache(1024 * 1024);
+  scoped_refptr<TableInfo> table(new TableInfo("table"));
+  GetTableLocationsRequestPB req;
+  req.set_partition_key_start("a");
+
+  const string key = TableLocationsCache::MakeKey(*table, 0, req);
+  GetTableLocationsResponsePB resp;
+  ASSERT_FALSE(cache.Get(key, &resp));
+
+  const GetTableLocationsResponsePB expected = MakeResponse("tablet");
+  cache.Put(key, expected);
+  ASSERT_TRUE(cache.Get(key, &resp));
+  ASSERT_EQ(SecureDebugString(expected), SecureDebugString(resp));
+
+  // Requests for other ranges have other keys.
+  GetTableLocationsRequestPB other_req;
+  other_req.set_partition_key_start("b");
+  ASSERT_FALSE(cache.Get(TableLocationsCache::MakeKey(*table, 0, other_req), &resp));
+
+  // An absent partition key differs from an empty one.
+  GetTableLocationsRequestPB empty_key_req;
+  empty_key_req.set_partition_key_start("");
+  ASSERT_NE(TableLocationsCache::MakeKey(*table, 0, GetTableLocationsRequestPB()),
+            TableLocationsCache::MakeKey(*table, 0, empty_key_req));
+}
+
+TEST_F(TableLocationsCacheTest, TestInvalidation) {
+  TableLocationsCache cache(1024 * 1024);
+  scoped_refptr<TableInfo> table(new TableInfo("table"));
+  GetTableLocationsRequestPB req;
+  GetTableLocationsResponsePB resp;
+  cache.Put(TableLocationsCache::MakeKey(*table, 0, req), MakeResponse("tablet"));
+  ASSERT_TRUE(cache.Get(TableLocationsCache::MakeKey(*table, 0, req), &resp));
+
+  // Re-registering tablet servers invalidate the responses.
+  ASSERT_FALSE(cache.Get(TableLocationsCache::MakeKey(*table, 1, req), &resp));
+
+  // So do changes to the table's tablets.
+  table->InvalidateLocations();
+  ASSERT_FALSE(cache.Get(TableLocationsCache::MakeKey(*table, 0, req), &resp));
+
+  // A new TableInfo for the same table, e.g. after reloading the catalog,
+  // doesn't see the responses cached for the old one.
+  cache.Put(TableLocationsCache::MakeKey(*table, 0, req), MakeResponse("tablet"));
+  scoped_refptr<TableInfo> reloaded_table(new TableInfo("table"));
+  ASSERT_FALSE(cache.Get(TableLocationsCache::MakeKey(*reloaded_table, 0, req), &resp));
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,80 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/table_locations_cache.h"
+
+#include "kudu/gutil/port.h"
+#include "kudu/master/catalog_manager.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+
+using std::string;
+
+namespace kudu {
+namespace master {
+
+TableLocationsCache::TableLocationsCache(size_t capacity_bytes)
+    : cache_(NewCache(DRAM_CACHE, CacheEvictionPolicy::CLOCK, capacity_bytes,
+                      "table-locations-cache")) {
+}
+
+TableLocationsCache::~TableLocationsCache() {
+}
+
+string TableLocationsCache::MakeKey(const TableInfo& table,
+                                    int64_t ts_registration_version,
+                                    const GetTableLocationsRequestPB& req) {
+  faststring key;
+  PutLengthPrefixedSlice(&key, table.id());
+  PutFixed64(&key, table.locations_version());
+  PutFixed64(&key, ts_registration_version);
+  // Distinguish an absent partition key from an empty one.
+  key.push_back(req.has_partition_key_start());
+  PutLengthPrefixedSlice(&key, req.partition_key_start());
+  key.push_back(req.has_partition_key_end());
+  PutLengthPrefixedSlice(&key, req.partition_key_end());
+  PutVarint32(&key, req.max_returned_locations());
+  PutVarint32(&key, req.replica_type_filter());
+  return key.ToString();
+}
+
+bool TableLocationsCache::Get(const string& key, GetTableLocationsResponsePB* resp) const {
+  Cache::UniqueHandle h(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                        Cache::HandleDeleter(cache_.get()));
+  if (!h) {
+    return false;
+  }
+  const Slice value = cache_->Value(h.get());
+  return resp->ParseFromArray(value.data(), value.size());
+}
+
+void TableLocationsCache::Put(const string& key, const GetTableLocationsResponsePB& resp) {
+  const int size = resp.ByteSize();
+  Cache::PendingHandle* pending = cache_->Allocate(key, size);
+  if (PREDICT_FALSE(pending == nullptr)) {
+    // The response doesn't fit into the cache.
+    return;
+  }
+  resp.SerializeWithCachedSizesToArray(cache_->MutableValue(pending));
+  cache_->Release(cache_->Insert(pending, nullptr));
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,74 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_MASTER_TABLE_LOCATIONS_CACHE_H
+#define KUDU_MASTER_TABLE_LOCATIONS_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+
+namespace kudu {
+
+class Cache;
+
+namespace master {
+
+class GetTableLocationsRequestPB;
+class GetTableLocationsResponsePB;
+class TableInfo;
+
+// A cache of serialized GetTableLocations responses.
+//
+// Entries are never invalidated explicitly: instead, the key of an entry
+// embeds the locations version of the table and the registration version of
+// the tablet servers at the time the response was built. Any change to the
+// locations changes one of the versions, so lookups no longer find the
+// outdated entries, which eventually get evicted.
+//
+// This class is thread-safe.
+class TableLocationsCache {
+ public:
+  explicit TableLocationsCache(size_t capacity_bytes);
+  ~TableLocationsCache();
+
+  // Returns the cache key for the given request to 'table', given the
+  // current registration version of the tablet servers. Must be called
+  // before building the response which is to be cached under the key.
+  static std::string MakeKey(const TableInfo& table,
+                             int64_t ts_registration_version,
+                             const GetTableLocationsRequestPB& req);
+
+  // Looks up the response cached under 'key', filling in 'resp' and
+  // returning true if found.
+  bool Get(const std::string& key, GetTableLocationsResponsePB* resp) const;
+
+  // Caches 'resp' under 'key'.
+  void Put(const std::string& key, const GetTableLocationsResponsePB& resp);
+
+ private:
+  gscoped_ptr<Cache> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(TableLocationsCache);
+};
+
+} // namespace master
+} // namespace kudu
+
+#endif
@@ -21,12 +21,15 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/master/master.pb.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/make_shared.h"
 #include "kudu/util/monotime.h"
@@ -119,6 +122,19 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
     return num_live_replicas_;
   }
 
+  // Replace the load statistics of the replicas hosted by this TS with the
+  // ones from its latest heartbeat.
+  void set_tablet_load_stats(std::vector<TabletLoadStatsPB> stats) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    tablet_load_stats_ = std::move(stats);
+  }
+
+  // Return the latest load statistics of the replicas hosted by this TS.
+  std::vector<TabletLoadStatsPB> tablet_load_stats() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return tablet_load_stats_;
+  }
+
   // Return a string form of this TS, suitable for printing.
   // Includes the UUID as well as last known host/port.
   std::string ToString() const;
@@ -152,6 +168,10 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
   // The number of live replicas on this host, from the last heartbeat.
   int num_live_replicas_;
 
+  // The load statistics of the replicas on this host, from the last
+  // heartbeat which carried them.
+  std::vector<TabletLoadStatsPB> tablet_load_stats_;
+
   gscoped_ptr<ServerRegistrationPB> registration_;
 
   std::shared_ptr<tserver::TabletServerAdminServiceProxy> ts_admin_proxy_;
@@ -36,7 +36,8 @@ using strings::Substitute;
 namespace kudu {
 namespace master {
 
-TSManager::TSManager() {
+TSManager::TSManager()
+    : registration_version_(0) {
 }
 
 TSManager::~TSManager() {
@@ -88,6 +89,7 @@ Status TSManager::RegisterTS(const NodeInstancePB& instance,
                             found->ToString());
     desc->swap(found);
   }
+  registration_version_.fetch_add(1, std::memory_order_release);
 
   return Status::OK();
 }
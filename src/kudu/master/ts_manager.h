@@ -17,6 +17,8 @@
 #ifndef KUDU_MASTER_TS_MANAGER_H
 #define KUDU_MASTER_TS_MANAGER_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -83,9 +85,18 @@ class TSManager {
   // Get the TS count.
   int GetCount() const;
 
+  // Returns a version which changes whenever a tablet server registers or
+  // re-registers, possibly with different addresses.
+  int64_t registration_version() const {
+    return registration_version_.load(std::memory_order_acquire);
+  }
+
  private:
   mutable rw_spinlock lock_;
 
+  // See registration_version().
+  std::atomic<int64_t> registration_version_;
+
   typedef std::unordered_map<
     std::string, std::shared_ptr<TSDescriptor>> TSDescriptorMap;
   TSDescriptorMap servers_by_id_;
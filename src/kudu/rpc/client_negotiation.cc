@@ -49,6 +49,7 @@
 #include "kudu/util/faststring.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/trace.h"
 
@@ -59,6 +60,7 @@ using std::unique_ptr;
 
 using strings::Substitute;
 
+DECLARE_bool(rpc_compress_loopback_connections);
 DECLARE_bool(rpc_encrypt_loopback_connections);
 
 namespace kudu {
@@ -116,6 +118,7 @@ ClientNegotiation::ClientNegotiation(unique_ptr<Socket> socket,
       tls_context_(tls_context),
       encryption_(encryption),
       tls_negotiated_(false),
+      tls_session_reused_(false),
       authn_token_(std::move(authn_token)),
       psecret_(nullptr, std::free),
       negotiated_authn_(AuthenticationType::INVALID),
@@ -162,6 +165,14 @@ Status ClientNegotiation::Negotiate(unique_ptr<ErrorStatusPB>* rpc_error) {
   // Ensure we can use blocking calls on the socket during negotiation.
   RETURN_NOT_OK(CheckInBlockingMode(socket_.get()));
 
+  // If the negotiation fails past the TLS handshake, the next one shouldn't
+  // resume its session: whatever went wrong may well go wrong again.
+  auto erase_tls_session = MakeScopedCleanup([&]() {
+    if (!tls_session_key_.empty()) {
+      tls_context_->EraseSession(tls_session_key_);
+    }
+  });
+
   // Step 1: send the connection header.
   RETURN_NOT_OK(SendConnectionHeader());
 
@@ -179,15 +190,17 @@ Status ClientNegotiation::Negotiate(unique_ptr<ErrorStatusPB>* rpc_error) {
   // TODO(KUDU-1921): allow the client to require TLS.
   if (encryption_ != RpcEncryption::DISABLED &&
       ContainsKey(server_features_, TLS)) {
+    // When using SASL authentication, verifying the server's certificate is
+    // not necessary. This allows the client to still use TLS encryption for
+    // connections to servers which only have a self-signed certificate.
+    const auto verification_mode = negotiated_authn_ == AuthenticationType::SASL
+        ? security::TlsVerificationMode::VERIFY_NONE
+        : security::TlsVerificationMode::VERIFY_REMOTE_CERT_AND_HOST;
+    tls_session_key_ = TlsSessionKey(verification_mode);
     RETURN_NOT_OK(tls_context_->InitiateHandshake(security::TlsHandshakeType::CLIENT,
-                                                  &tls_handshake_));
-
-    if (negotiated_authn_ == AuthenticationType::SASL) {
-      // When using SASL authentication, verifying the server's certificate is
-      // not necessary. This allows the client to still use TLS encryption for
-      // connections to servers which only have a self-signed certificate.
-      tls_handshake_.set_verification_mode(security::TlsVerificationMode::VERIFY_NONE);
-    }
+                                                  &tls_handshake_,
+                                                  tls_session_key_));
+    tls_handshake_.set_verification_mode(verification_mode);
 
     // To initiate the TLS handshake, we pretend as if the server sent us an
     // empty TLS_HANDSHAKE token.
@@ -223,9 +236,21 @@ Status ClientNegotiation::Negotiate(unique_ptr<ErrorStatusPB>* rpc_error) {
   RETURN_NOT_OK(SendConnectionContext());
 
   TRACE("Negotiation successful");
+  erase_tls_session.cancel();
   return Status::OK();
 }
 
+string ClientNegotiation::TlsSessionKey(security::TlsVerificationMode mode) const {
+  // A session resumed from a handshake which didn't verify the server must not
+  // stand in for one which does, hence the verification mode in the key.
+  Sockaddr remote;
+  if (!socket_->GetPeerAddress(&remote).ok()) {
+    return "";
+  }
+  return Substitute("$0/$1", remote.ToString(),
+                    mode == security::TlsVerificationMode::VERIFY_NONE ? "unverified" : "verified");
+}
+
 Status ClientNegotiation::SendNegotiatePB(const NegotiatePB& msg) {
   RequestHeader header;
   header.set_call_id(kNegotiateCallId);
@@ -314,6 +339,13 @@ Status ClientNegotiation::SendNegotiate() {
     }
   }
 
+  // Advertise the codecs we can uncompress; the server only compresses its
+  // responses with one of them if it's configured to do so.
+  if (!socket_->IsLoopbackConnection() || FLAGS_rpc_compress_loopback_connections) {
+    client_features_.insert(COMPRESSION_LZ4);
+    client_features_.insert(COMPRESSION_ZSTD);
+  }
+
   for (RpcFeatureFlag feature : client_features_) {
     msg.add_supported_features(feature);
   }
@@ -491,6 +523,10 @@ Status ClientNegotiation::HandleTlsHandshake(const NegotiatePB& response) {
   RETURN_NOT_OK(s);
 
   // TLS handshake is finished.
+  tls_session_reused_ = tls_handshake_.session_reused();
+  if (tls_session_reused_) {
+    TRACE("Resumed TLS session");
+  }
   if (ContainsKey(server_features_, TLS_AUTHENTICATION_ONLY) &&
       ContainsKey(client_features_, TLS_AUTHENTICATION_ONLY)) {
     TRACE("Negotiated auth-only $0 with cipher $1",
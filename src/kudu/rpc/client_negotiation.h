@@ -94,6 +94,12 @@ class ClientNegotiation {
     return tls_negotiated_;
   }
 
+  // Returns true if the TLS handshake resumed a previously established
+  // session. Must be called after Negotiate().
+  bool tls_session_reused() const {
+    return tls_session_reused_;
+  }
+
   // Returns the set of RPC system features supported by the remote server.
   // Must be called before Negotiate().
   std::set<RpcFeatureFlag> server_features() const {
@@ -170,6 +176,10 @@ class ClientNegotiation {
   Status HandleNegotiate(const NegotiatePB& response) WARN_UNUSED_RESULT;
 
   // Send a TLS_HANDSHAKE request message to the server with the provided token.
+  // Returns the key under which to cache the TLS session with the server, or
+  // an empty string if the session shouldn't be cached.
+  std::string TlsSessionKey(security::TlsVerificationMode mode) const;
+
   Status SendTlsHandshake(std::string tls_token) WARN_UNUSED_RESULT;
 
   // Handle a TLS_HANDSHAKE response message from the server.
@@ -229,6 +239,8 @@ class ClientNegotiation {
   security::TlsHandshake tls_handshake_;
   const RpcEncryption encryption_;
   bool tls_negotiated_;
+  bool tls_session_reused_;
+  std::string tls_session_key_;
 
   // TSK state.
   boost::optional<security::SignedTokenPB> authn_token_;
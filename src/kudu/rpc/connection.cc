@@ -24,10 +24,13 @@
 #include <set>
 #include <string>
 #include <type_traits>
+#include <vector>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/intrusive/detail/list_iterator.hpp>
 #include <boost/intrusive/list.hpp>
 #include <ev.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
@@ -42,7 +45,12 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
+#include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/status.h"
@@ -51,13 +59,101 @@ using std::includes;
 using std::set;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(rpc_zero_copy_send, false,
+            "Whether to send large call responses on unencrypted connections "
+            "with MSG_ZEROCOPY, avoiding the copy of the response and its "
+            "sidecars into the kernel's socket buffers. Requires Linux 4.14 "
+            "or newer; ignored otherwise.");
+TAG_FLAG(rpc_zero_copy_send, advanced);
+TAG_FLAG(rpc_zero_copy_send, experimental);
+
+DEFINE_int32(rpc_zero_copy_send_min_bytes, 64 * 1024,
+             "Call responses smaller than this many bytes are copied into the "
+             "kernel even if --rpc_zero_copy_send is set, since pinning their "
+             "pages and tracking the completion costs more than the copy.");
+TAG_FLAG(rpc_zero_copy_send_min_bytes, advanced);
+TAG_FLAG(rpc_zero_copy_send_min_bytes, experimental);
+
+DEFINE_int32(rpc_max_write_batch_transfers, 16,
+             "Maximum number of queued outbound transfers which a connection "
+             "writes to its socket with a single syscall. Batching cuts the "
+             "number of syscalls when many small RPCs are queued on the same "
+             "connection. Set to 1 to write each transfer separately.");
+TAG_FLAG(rpc_max_write_batch_transfers, advanced);
+TAG_FLAG(rpc_max_write_batch_transfers, experimental);
+
+static bool ValidateMaxWriteBatchTransfers(const char* flagname, int32_t value) {
+  if (value < 1) {
+    LOG(ERROR) << "Invalid value for " << flagname << ": " << value << ", must be at least 1";
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(rpc_max_write_batch_transfers, &ValidateMaxWriteBatchTransfers);
+
+DEFINE_string(rpc_compression_codec, "none",
+              "Codec with which to compress large call requests and responses "
+              "on connections to peers that support it: 'none', 'lz4' or "
+              "'zstd'. Payloads that do not shrink are sent uncompressed. "
+              "Trades CPU for network bandwidth; see the rpc_compression_* "
+              "metrics for the ratio achieved and the time spent.");
+TAG_FLAG(rpc_compression_codec, advanced);
+TAG_FLAG(rpc_compression_codec, experimental);
+
+static bool ValidateCompressionCodec(const char* flagname, const std::string& value) {
+  if (!boost::iequals(value, "none") && !boost::iequals(value, "lz4") &&
+      !boost::iequals(value, "zstd")) {
+    LOG(ERROR) << "Invalid value for " << flagname << ": " << value
+               << ", must be one of 'none', 'lz4' or 'zstd'";
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(rpc_compression_codec, &ValidateCompressionCodec);
+
+DEFINE_int32(rpc_compression_min_bytes, 32 * 1024,
+             "Call requests and responses smaller than this many bytes, "
+             "including sidecars, are sent uncompressed even if "
+             "--rpc_compression_codec is set.");
+TAG_FLAG(rpc_compression_min_bytes, advanced);
+TAG_FLAG(rpc_compression_min_bytes, experimental);
+TAG_FLAG(rpc_compression_min_bytes, runtime);
+
+METRIC_DEFINE_counter(server, rpc_compression_input_bytes,
+                      "RPC Compression Input Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of call payloads sent compressed, before "
+                      "compression. Divide by rpc_compression_output_bytes for "
+                      "the compression ratio.");
+METRIC_DEFINE_counter(server, rpc_compression_output_bytes,
+                      "RPC Compression Output Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of call payloads sent compressed, after "
+                      "compression.");
+METRIC_DEFINE_counter(server, rpc_compression_time_us,
+                      "RPC Compression Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Time spent compressing outbound call payloads, including "
+                      "payloads which did not shrink and were sent uncompressed.");
+METRIC_DEFINE_counter(server, rpc_uncompression_time_us,
+                      "RPC Uncompression Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Time spent uncompressing inbound call payloads.");
+
 namespace kudu {
 namespace rpc {
 
 typedef OutboundCall::Phase Phase;
 
+// The maximum number of iovecs passed to a single write of a batch of
+// transfers. Must fit any single transfer.
+static const int kMaxWriteBatchIovecs = 64;
+static_assert(kMaxWriteBatchIovecs >= TransferLimits::kMaxPayloadSlices,
+              "a write batch must fit any single transfer");
+
 ///
 /// Connection
 ///
@@ -73,10 +169,15 @@ Connection::Connection(ReactorThread *reactor_thread,
       last_activity_time_(MonoTime::Now()),
       is_epoll_registered_(false),
       next_call_id_(1),
+      num_calls_received_(0),
       credentials_policy_(policy),
       negotiation_complete_(false),
       is_confidential_(false),
-      scheduled_for_shutdown_(false) {
+      scheduled_for_shutdown_(false),
+      zero_copy_send_enabled_(false),
+      compression_codec_(nullptr),
+      zero_copy_sends_issued_(0),
+      zero_copy_sends_completed_(0) {
 }
 
 Status Connection::SetNonBlocking(bool enabled) {
@@ -102,6 +203,7 @@ void Connection::EpollRegister(ev::loop_ref& loop) {
 Connection::~Connection() {
   // Must clear the outbound_transfers_ list before deleting.
   CHECK(outbound_transfers_.begin() == outbound_transfers_.end());
+  CHECK(zero_copy_pending_.empty());
 
   // It's crucial that the connection is Shutdown first -- otherwise
   // our destructor will end up calling read_io_.stop() and write_io_.stop()
@@ -118,7 +220,7 @@ bool Connection::Idle() const {
     return false;
   }
   // check if we still need to send something
-  if (!outbound_transfers_.empty()) {
+  if (!outbound_transfers_.empty() || !zero_copy_pending_.empty()) {
     return false;
   }
   // can't kill a connection if calls are waiting response
@@ -183,8 +285,21 @@ void Connection::Shutdown(const Status &status,
   write_io_.stop();
   is_epoll_registered_ = false;
   if (socket_) {
+    if (!zero_copy_pending_.empty()) {
+      // The kernel may still send from the buffers of the pending zero-copy
+      // transfers, which are about to be freed. Reset the connection rather
+      // than let it flush them.
+      WARN_NOT_OK(socket_->SetResetOnClose(), "Error setting socket to reset on close");
+    }
     WARN_NOT_OK(socket_->Close(), "Error closing socket");
   }
+
+  // Only now that the socket is closed, release the zero-copy buffers.
+  while (!zero_copy_pending_.empty()) {
+    unique_ptr<OutboundTransfer> t(zero_copy_pending_.front().second);
+    zero_copy_pending_.pop_front();
+    t->Abort(shutdown_status_);
+  }
 }
 
 void Connection::QueueOutbound(gscoped_ptr<OutboundTransfer> transfer) {
@@ -333,7 +448,7 @@ void Connection::QueueOutboundCall(shared_ptr<OutboundCall> call) {
 
   // Serialize the actual bytes to be put on the wire.
   TransferPayload tmp_slices;
-  size_t n_slices = call->SerializeTo(&tmp_slices);
+  size_t n_slices = call->SerializeTo(this, &tmp_slices);
 
   call->SetQueued();
 
@@ -501,6 +616,12 @@ void Connection::ReadHandler(ev::io &watcher, int revents) {
   }
   last_activity_time_ = reactor_thread_->cur_time();
 
+  // The kernel signals zero-copy completions as errors on the socket, which
+  // wake up this handler.
+  if (zero_copy_sends_completed_ < zero_copy_sends_issued_ && !ProcessZeroCopyCompletions()) {
+    return;
+  }
+
   while (true) {
     if (!inbound_) {
       inbound_.reset(new InboundTransfer());
@@ -561,13 +682,14 @@ void Connection::HandleIncomingCall(gscoped_ptr<InboundTransfer> transfer) {
     return;
   }
 
+  ++num_calls_received_;
   reactor_thread_->reactor()->messenger()->QueueInboundCall(std::move(call));
 }
 
 void Connection::HandleCallResponse(gscoped_ptr<InboundTransfer> transfer) {
   DCHECK(reactor_thread_->IsCurrentThread());
   gscoped_ptr<CallResponse> resp(new CallResponse);
-  CHECK_OK(resp->ParseFrom(std::move(transfer)));
+  CHECK_OK(resp->ParseFrom(this, std::move(transfer)));
 
   CallAwaitingResponse *car_ptr =
     EraseKeyReturnValuePtr(&awaiting_response_, resp->call_id());
@@ -593,6 +715,53 @@ void Connection::HandleCallResponse(gscoped_ptr<InboundTransfer> transfer) {
   MaybeInjectCancellation(car->call);
 }
 
+bool Connection::PrepareToSend(OutboundTransfer* transfer) {
+  DCHECK(!transfer->TransferStarted());
+  if (!transfer->is_for_outbound_call()) {
+    if (ShouldSendZeroCopy(*transfer)) {
+      transfer->set_zero_copy();
+    }
+    return true;
+  }
+
+  CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
+  if (!car->call) {
+    // If the call has already timed out or has already been cancelled, the 'call'
+    // field would be set to NULL. In that case, don't bother sending it.
+    transfer->Abort(Status::Aborted("already timed out or cancelled"));
+    return false;
+  }
+
+  // If this is the start of the transfer, then check if the server has the
+  // required RPC flags. We have to wait until just before the transfer in
+  // order to ensure that the negotiation has taken place, so that the flags
+  // are available.
+  const set<RpcFeatureFlag>& required_features = car->call->required_rpc_features();
+  if (!includes(remote_features_.begin(), remote_features_.end(),
+                required_features.begin(), required_features.end())) {
+    Status s = Status::NotSupported("server does not support the required RPC features");
+    transfer->Abort(s);
+    Phase phase = negotiation_complete_ ? Phase::REMOTE_CALL : Phase::CONNECTION_NEGOTIATION;
+    car->call->SetFailed(std::move(s), phase);
+    // Test cancellation when 'call_' is in 'FINISHED_ERROR' state.
+    MaybeInjectCancellation(car->call);
+    car->call.reset();
+    return false;
+  }
+
+  car->call->SetSending();
+
+  // Test cancellation when 'call_' is in 'SENDING' state.
+  MaybeInjectCancellation(car->call);
+  return true;
+}
+
+bool Connection::ShouldSendZeroCopy(const OutboundTransfer& transfer) const {
+  return zero_copy_send_enabled_ &&
+      !transfer.is_for_outbound_call() &&
+      transfer.TotalLength() >= FLAGS_rpc_zero_copy_send_min_bytes;
+}
+
 void Connection::WriteHandler(ev::io &watcher, int revents) {
   DCHECK(reactor_thread_->IsCurrentThread());
 
@@ -603,7 +772,6 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
   DVLOG(3) << ToString() << ": writeHandler: revents = " << revents;
 
-  OutboundTransfer *transfer;
   if (outbound_transfers_.empty()) {
     LOG(WARNING) << ToString() << " got a ready-to-write callback, but there is "
       "nothing to write.";
@@ -612,62 +780,69 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
 
   while (!outbound_transfers_.empty()) {
-    transfer = &(outbound_transfers_.front());
-
-    if (!transfer->TransferStarted()) {
-
-      if (transfer->is_for_outbound_call()) {
-        CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
-        if (!car->call) {
-          // If the call has already timed out or has already been cancelled, the 'call'
-          // field would be set to NULL. In that case, don't bother sending it.
-          outbound_transfers_.pop_front();
-          transfer->Abort(Status::Aborted("already timed out or cancelled"));
-          delete transfer;
-          continue;
-        }
-
-        // If this is the start of the transfer, then check if the server has the
-        // required RPC flags. We have to wait until just before the transfer in
-        // order to ensure that the negotiation has taken place, so that the flags
-        // are available.
-        const set<RpcFeatureFlag>& required_features = car->call->required_rpc_features();
-        if (!includes(remote_features_.begin(), remote_features_.end(),
-                      required_features.begin(), required_features.end())) {
-          outbound_transfers_.pop_front();
-          Status s = Status::NotSupported("server does not support the required RPC features");
-          transfer->Abort(s);
-          Phase phase = negotiation_complete_ ? Phase::REMOTE_CALL : Phase::CONNECTION_NEGOTIATION;
-          car->call->SetFailed(std::move(s), phase);
-          // Test cancellation when 'call_' is in 'FINISHED_ERROR' state.
-          MaybeInjectCancellation(car->call);
-          car->call.reset();
-          delete transfer;
-          continue;
-        }
-
-        car->call->SetSending();
-
-        // Test cancellation when 'call_' is in 'SENDING' state.
-        MaybeInjectCancellation(car->call);
+    // Collect the transfers to write with a single syscall: the one at the
+    // front of the queue, followed by as many of the next ones as fit in the
+    // batch. Zero-copy transfers are always sent on their own.
+    OutboundTransfer* batch[kMaxWriteBatchIovecs];
+    int n_batch = 0;
+    int n_iovecs = 0;
+    auto it = outbound_transfers_.begin();
+    while (it != outbound_transfers_.end() && n_batch < FLAGS_rpc_max_write_batch_transfers) {
+      OutboundTransfer* transfer = &(*it);
+      if (n_batch > 0 &&
+          (transfer->zero_copy() ||
+           (!transfer->TransferStarted() && ShouldSendZeroCopy(*transfer)) ||
+           n_iovecs + transfer->num_unsent_slices() > kMaxWriteBatchIovecs)) {
+        break;
+      }
+      if (!transfer->TransferStarted() && !PrepareToSend(transfer)) {
+        it = outbound_transfers_.erase(it);
+        delete transfer;
+        continue;
       }
+      batch[n_batch++] = transfer;
+      n_iovecs += transfer->num_unsent_slices();
+      ++it;
+      if (transfer->zero_copy()) {
+        break;
+      }
+    }
+    if (n_batch == 0) {
+      // All the remaining transfers were aborted.
+      break;
     }
 
     last_activity_time_ = reactor_thread_->cur_time();
-    Status status = transfer->SendBuffer(*socket_);
+    Status status;
+    if (n_batch == 1) {
+      OutboundTransfer* transfer = batch[0];
+      int64_t zero_copy_sends_before = transfer->num_zero_copy_sends();
+      status = transfer->SendBuffer(*socket_);
+      zero_copy_sends_issued_ += transfer->num_zero_copy_sends() - zero_copy_sends_before;
+    } else {
+      status = OutboundTransfer::SendBuffers(*socket_, batch, n_batch);
+    }
     if (PREDICT_FALSE(!status.ok())) {
       LOG(WARNING) << ToString() << " send error: " << status.ToString();
       reactor_thread_->DestroyConnection(this, status);
       return;
     }
 
-    if (!transfer->TransferFinished()) {
-      DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
-      return;
-    }
+    for (int i = 0; i < n_batch; i++) {
+      OutboundTransfer* transfer = batch[i];
+      if (!transfer->TransferFinished()) {
+        DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
+        return;
+      }
 
-    outbound_transfers_.pop_front();
-    delete transfer;
+      DCHECK_EQ(transfer, &outbound_transfers_.front());
+      outbound_transfers_.pop_front();
+      if (transfer->num_zero_copy_sends() > 0) {
+        zero_copy_pending_.emplace_back(zero_copy_sends_issued_, transfer);
+      } else {
+        delete transfer;
+      }
+    }
   }
 
   // If we were able to write all of our outbound transfers,
@@ -727,6 +902,108 @@ void Connection::CompleteNegotiation(Status negotiation_status,
 void Connection::MarkNegotiationComplete() {
   DCHECK(reactor_thread_->IsCurrentThread());
   negotiation_complete_ = true;
+
+  // Negotiation has swapped in a TLS socket if the connection is encrypted,
+  // which refuses zero-copy.
+  if (FLAGS_rpc_zero_copy_send && direction_ == SERVER) {
+    Status s = socket_->EnableZeroCopySend();
+    if (s.ok()) {
+      zero_copy_send_enabled_ = true;
+    } else {
+      VLOG(2) << ToString() << ": not using zero-copy send: " << s.ToString();
+    }
+  }
+
+  const scoped_refptr<MetricEntity>& metric_entity =
+      reactor_thread_->reactor()->messenger()->metric_entity();
+  if (metric_entity) {
+    compression_input_bytes_ = METRIC_rpc_compression_input_bytes.Instantiate(metric_entity);
+    compression_output_bytes_ = METRIC_rpc_compression_output_bytes.Instantiate(metric_entity);
+    compression_time_us_ = METRIC_rpc_compression_time_us.Instantiate(metric_entity);
+    uncompression_time_us_ = METRIC_rpc_uncompression_time_us.Instantiate(metric_entity);
+  }
+
+  // Only compress with a codec the peer advertised it can uncompress. Peers
+  // don't advertise any on loopback connections.
+  CompressionType compression = GetCompressionCodecType(FLAGS_rpc_compression_codec);
+  if ((compression == LZ4 && ContainsKey(remote_features_, COMPRESSION_LZ4)) ||
+      (compression == ZSTD && ContainsKey(remote_features_, COMPRESSION_ZSTD))) {
+    CHECK_OK(GetCompressionCodec(compression, &compression_codec_));
+  }
+}
+
+void Connection::PrepareToMigrate() {
+  DCHECK(reactor_thread_->IsCurrentThread());
+  DCHECK_EQ(direction_, SERVER);
+  DCHECK(Idle());
+  read_io_.stop();
+  write_io_.stop();
+  is_epoll_registered_ = false;
+}
+
+void Connection::CompleteMigration(ReactorThread* reactor_thread, ev::loop_ref& loop) {
+  reactor_thread_ = reactor_thread;
+  DCHECK(reactor_thread_->IsCurrentThread());
+  last_activity_time_ = reactor_thread_->cur_time();
+  EpollRegister(loop);
+}
+
+CompressionType Connection::MaybeCompressMessage(const faststring& param_buf,
+                                                 const vector<Slice>& sidecars,
+                                                 int64_t main_msg_size,
+                                                 faststring* compressed_buf,
+                                                 uint32_t* uncompressed_size) {
+  if (compression_codec_ == nullptr || main_msg_size < FLAGS_rpc_compression_min_bytes) {
+    return NO_COMPRESSION;
+  }
+  MonoTime start = MonoTime::Now();
+  bool compressed = serialization::CompressMessage(
+      *compression_codec_, param_buf, sidecars, compressed_buf, uncompressed_size);
+  if (compression_time_us_) {
+    compression_time_us_->IncrementBy((MonoTime::Now() - start).ToMicroseconds());
+    if (compressed) {
+      compression_input_bytes_->IncrementBy(*uncompressed_size);
+      compression_output_bytes_->IncrementBy(compressed_buf->size());
+    }
+  }
+  return compressed ? compression_codec_->type() : NO_COMPRESSION;
+}
+
+Status Connection::UncompressMessage(CompressionType compression,
+                                     uint32_t uncompressed_size,
+                                     faststring* buf,
+                                     Slice* main_message) {
+  MonoTime start = MonoTime::Now();
+  RETURN_NOT_OK(serialization::UncompressMessage(
+      compression, uncompressed_size, buf, main_message));
+  if (uncompression_time_us_) {
+    uncompression_time_us_->IncrementBy((MonoTime::Now() - start).ToMicroseconds());
+  }
+  return Status::OK();
+}
+
+bool Connection::ProcessZeroCopyCompletions() {
+  DCHECK(reactor_thread_->IsCurrentThread());
+  bool copied = false;
+  Status s = socket_->ReadZeroCopyCompletions(&zero_copy_sends_completed_, &copied);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(WARNING) << ToString() << " error reading zero-copy completions: " << s.ToString();
+    reactor_thread_->DestroyConnection(this, s);
+    return false;
+  }
+  if (copied && zero_copy_send_enabled_) {
+    // The kernel had to copy the data anyway (e.g. on loopback, or if the NIC
+    // can't do scatter-gather), so zero-copy only adds overhead here.
+    VLOG(1) << ToString() << ": kernel copied zero-copy send, disabling zero-copy";
+    zero_copy_send_enabled_ = false;
+  }
+  while (!zero_copy_pending_.empty() &&
+         zero_copy_pending_.front().first <= zero_copy_sends_completed_) {
+    unique_ptr<OutboundTransfer> t(zero_copy_pending_.front().second);
+    zero_copy_pending_.pop_front();
+    t->NotifyZeroCopyCompleted();
+  }
+  return true;
 }
 
 Status Connection::DumpPB(const DumpRunningRpcsRequestPB& req,
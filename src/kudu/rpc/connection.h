@@ -20,12 +20,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <limits>
 #include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 #include <boost/optional/optional.hpp>
@@ -40,6 +42,8 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/remote_user.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
@@ -48,6 +52,9 @@
 
 namespace kudu {
 
+class CompressionCodec;
+class faststring;
+
 namespace rpc {
 
 class DumpRunningRpcsRequestPB;
@@ -157,6 +164,27 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // Set/unset the 'confidentiality' property for this connection.
   void set_confidential(bool is_confidential);
 
+  // Compresses the main message of an outbound request or response with the
+  // codec negotiated for this connection, if any, provided that the message
+  // is at least --rpc_compression_min_bytes long. 'param_buf', 'sidecars',
+  // 'compressed_buf' and 'uncompressed_size' are as for
+  // serialization::CompressMessage(). Returns the codec used, or
+  // NO_COMPRESSION if the message should be sent as is.
+  //
+  // Safe to be called from any thread once negotiation is complete.
+  CompressionType MaybeCompressMessage(const faststring& param_buf,
+                                       const std::vector<Slice>& sidecars,
+                                       int64_t main_msg_size,
+                                       faststring* compressed_buf,
+                                       uint32_t* uncompressed_size);
+
+  // Uncompresses the main message of an inbound call or response received on
+  // this connection. See serialization::UncompressMessage().
+  Status UncompressMessage(CompressionType compression,
+                           uint32_t uncompressed_size,
+                           faststring* buf,
+                           Slice* main_message);
+
   // Credentials policy to start connection negotiation.
   CredentialsPolicy credentials_policy() const { return credentials_policy_; }
 
@@ -193,6 +221,23 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // Indicate that negotiation is complete and that the Reactor is now in control of the socket.
   void MarkNegotiationComplete();
 
+  // Stops watching the socket of an Idle() inbound connection, so that it can
+  // be migrated to another reactor thread, which then calls CompleteMigration().
+  void PrepareToMigrate();
+
+  // Starts watching the socket on 'loop' of 'reactor_thread', which must be
+  // the current thread, after the connection was migrated to it.
+  void CompleteMigration(ReactorThread* reactor_thread, ev::loop_ref& loop);
+
+  // Returns the number of calls received on the connection since the last
+  // call of this method.
+  uint64_t TakeNumCallsReceived() {
+    DCHECK_EQ(direction_, SERVER);
+    uint64_t num_calls = num_calls_received_;
+    num_calls_received_ = 0;
+    return num_calls;
+  }
+
   Status DumpPB(const DumpRunningRpcsRequestPB& req,
                 RpcConnectionPB* resp);
 
@@ -294,12 +339,27 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // This must be called from the reactor thread.
   void QueueOutbound(gscoped_ptr<OutboundTransfer> transfer);
 
+  // Runs the checks due before the first byte of 'transfer' is written, and
+  // marks its call as being sent. Returns false if the transfer must not be
+  // sent, in which case it has been aborted and must be removed from the
+  // queue.
+  bool PrepareToSend(OutboundTransfer* transfer);
+
+  // Returns true if 'transfer' should be sent with MSG_ZEROCOPY.
+  bool ShouldSendZeroCopy(const OutboundTransfer& transfer) const;
+
+  // Reads the zero-copy completions from the socket and notifies the finished
+  // zero-copy transfers whose sends have all completed. Returns false if the
+  // connection was destroyed due to an error.
+  bool ProcessZeroCopyCompletions();
+
   // Internal test function for injecting cancellation request when 'call'
   // reaches state specified in 'FLAGS_rpc_inject_cancellation_state'.
   void MaybeInjectCancellation(const std::shared_ptr<OutboundCall> &call);
 
-  // The reactor thread that created this connection.
-  ReactorThread* const reactor_thread_;
+  // The reactor thread that handles this connection: the one that created it,
+  // unless the connection was migrated.
+  ReactorThread* reactor_thread_;
 
   // The remote address we're talking to.
   const Sockaddr remote_;
@@ -337,6 +397,33 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // waiting to be sent
   boost::intrusive::list<OutboundTransfer> outbound_transfers_; // NOLINT(*)
 
+  // Whether large call responses are sent with MSG_ZEROCOPY. Only set for
+  // server connections whose socket supports it. See --rpc_zero_copy_send.
+  bool zero_copy_send_enabled_;
+
+  // The codec with which large outbound payloads are compressed, or null if
+  // they are sent uncompressed. Set when negotiation completes.
+  // See --rpc_compression_codec.
+  const CompressionCodec* compression_codec_;
+
+  // Metrics for the payloads compressed and uncompressed on the connection.
+  // Null if the messenger has no metric entity.
+  scoped_refptr<Counter> compression_input_bytes_;
+  scoped_refptr<Counter> compression_output_bytes_;
+  scoped_refptr<Counter> compression_time_us_;
+  scoped_refptr<Counter> uncompression_time_us_;
+
+  // The number of zero-copy sends issued on the socket, and the number of
+  // those the kernel has reported as completed.
+  uint64_t zero_copy_sends_issued_;
+  uint64_t zero_copy_sends_completed_;
+
+  // Zero-copy transfers that have been fully written, but whose payload the
+  // kernel may still be reading from. Each is paired with the value of
+  // 'zero_copy_sends_issued_' after its last send, and is kept, along with
+  // the buffers it pins, until that many sends have completed.
+  std::deque<std::pair<uint64_t, OutboundTransfer*>> zero_copy_pending_;
+
   // Calls which have been sent and are now waiting for a response.
   car_map_t awaiting_response_;
 
@@ -347,6 +434,9 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // the next call ID to use
   int32_t next_call_id_;
 
+  // The number of calls received since the last TakeNumCallsReceived().
+  uint64_t num_calls_received_;
+
   // Starts as Status::OK, gets set to a shutdown status upon Shutdown().
   Status shutdown_status_;
 
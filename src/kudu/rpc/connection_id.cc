@@ -48,7 +48,7 @@ void ConnectionId::set_user_credentials(UserCredentials user_credentials) {
 
 string ConnectionId::ToString() const {
   string remote;
-  if (hostname_ != remote_.host()) {
+  if (!remote_.is_ip() || hostname_ != remote_.host()) {
     remote = strings::Substitute("$0 ($1)", remote_.ToString(), hostname_);
   } else {
     remote = remote_.ToString();
@@ -70,6 +70,10 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   TRACE_EVENT_FLOW_BEGIN0("rpc", "InboundCall", this);
   TRACE_EVENT0("rpc", "InboundCall::ParseFrom");
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &serialized_request_));
+  if (header_.has_compression()) {
+    RETURN_NOT_OK(conn_->UncompressMessage(header_.compression(), header_.uncompressed_size(),
+                                           &uncompressed_request_buf_, &serialized_request_));
+  }
 
   // Adopt the service/method info from the header as soon as it's available.
   if (PREDICT_FALSE(!header_.has_remote_method())) {
@@ -188,6 +192,23 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   sidecar_byte_size, true);
   int64_t main_msg_size = sidecar_byte_size + response_msg_buf_.size();
+
+  vector<Slice> sidecar_slices;
+  sidecar_slices.reserve(outbound_sidecars_.size());
+  for (const unique_ptr<RpcSidecar>& car : outbound_sidecars_) {
+    sidecar_slices.push_back(car->AsSlice());
+  }
+  uint32_t uncompressed_size;
+  CompressionType compression = conn_->MaybeCompressMessage(
+      response_msg_buf_, sidecar_slices, main_msg_size,
+      &compressed_response_buf_, &uncompressed_size);
+  if (compression != NO_COMPRESSION) {
+    resp_hdr.set_compression(compression);
+    resp_hdr.set_uncompressed_size(uncompressed_size);
+    main_msg_size = compressed_response_buf_.size();
+  } else {
+    compressed_response_buf_.clear();
+  }
   serialization::SerializeHeader(resp_hdr, main_msg_size,
                                  &response_hdr_buf_);
 }
@@ -196,6 +217,12 @@ size_t InboundCall::SerializeResponseTo(TransferPayload* slices) const {
   TRACE_EVENT0("rpc", "InboundCall::SerializeResponseTo");
   DCHECK_GT(response_hdr_buf_.size(), 0);
   DCHECK_GT(response_msg_buf_.size(), 0);
+  if (!compressed_response_buf_.empty()) {
+    DCHECK_LE(2, slices->size());
+    (*slices)[0] = Slice(response_hdr_buf_);
+    (*slices)[1] = Slice(compressed_response_buf_);
+    return 2;
+  }
   size_t n_slices = 2 + outbound_sidecars_.size();
   DCHECK_LE(n_slices, slices->size());
   auto slice_iter = slices->begin();
@@ -277,12 +304,16 @@ void InboundCall::RecordCallReceived() {
   timing_.time_received = MonoTime::Now();
 }
 
-void InboundCall::RecordHandlingStarted(scoped_refptr<Histogram> incoming_queue_time) {
+void InboundCall::RecordHandlingStarted(scoped_refptr<Histogram> incoming_queue_time,
+                                        Histogram* service_queue_time) {
   DCHECK(incoming_queue_time != nullptr);
   DCHECK(!timing_.time_handled.Initialized());  // Protect against multiple calls.
   timing_.time_handled = MonoTime::Now();
-  incoming_queue_time->Increment(
-      (timing_.time_handled - timing_.time_received).ToMicroseconds());
+  int64_t queue_time_us = (timing_.time_handled - timing_.time_received).ToMicroseconds();
+  incoming_queue_time->Increment(queue_time_us);
+  if (service_queue_time) {
+    service_queue_time->Increment(queue_time_us);
+  }
 }
 
 void InboundCall::RecordHandlingCompleted() {
@@ -342,11 +373,13 @@ Status InboundCall::GetInboundSidecar(int idx, Slice* sidecar) const {
 
 void InboundCall::DiscardTransfer() {
   transfer_.reset();
+  uncompressed_request_buf_.clear();
+  uncompressed_request_buf_.shrink_to_fit();
 }
 
 size_t InboundCall::GetTransferSize() {
   if (!transfer_) return 0;
-  return transfer_->data().size();
+  return transfer_->data().size() + uncompressed_request_buf_.capacity();
 }
 
 } // namespace rpc
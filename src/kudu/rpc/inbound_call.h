@@ -173,9 +173,11 @@ class InboundCall {
 
   // When RPC call Handle() was called on the server side.
   // Updates the Histogram with time elapsed since the call was received,
-  // and should only be called once on a given instance.
+  // and should only be called once on a given instance. If
+  // 'service_queue_time' is non-null, it is updated as well.
   // Not thread-safe. Should only be called by the current "owner" thread.
-  void RecordHandlingStarted(scoped_refptr<Histogram> incoming_queue_time);
+  void RecordHandlingStarted(scoped_refptr<Histogram> incoming_queue_time,
+                             Histogram* service_queue_time = nullptr);
 
   // Return true if the deadline set by the client has already elapsed.
   // In this case, the server may stop processing the call, since the
@@ -240,10 +242,20 @@ class InboundCall {
   // by 'serialized_request_' above.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // The uncompressed request body and sidecars, if the request was
+  // compressed. 'serialized_request_' and 'inbound_sidecar_slices_' then
+  // refer into it rather than into 'transfer_'.
+  faststring uncompressed_request_buf_;
+
   // The buffers for serialized response. Set by SerializeResponseBuffer().
   faststring response_hdr_buf_;
   faststring response_msg_buf_;
 
+  // The compressed response body and sidecars, sent in place of
+  // 'response_msg_buf_' and 'outbound_sidecars_' if not empty. Set by
+  // SerializeResponseBuffer().
+  faststring compressed_response_buf_;
+
   // Vector of additional sidecars that are tacked on to the call's response
   // after serialization of the protobuf. See rpc/rpc_sidecar.h for more info.
   std::vector<std::unique_ptr<RpcSidecar>> outbound_sidecars_;
@@ -25,6 +25,7 @@
 #include <type_traits>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
@@ -62,6 +63,8 @@ using std::shared_ptr;
 using std::make_shared;
 using strings::Substitute;
 
+DECLARE_bool(rpc_reactor_load_balancing);
+
 namespace boost {
 template <typename Signature> class function;
 }
@@ -310,7 +313,7 @@ Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
   }
 
   Socket sock;
-  RETURN_NOT_OK(sock.Init(0));
+  RETURN_NOT_OK(sock.Init(accept_addr.family(), 0));
   RETURN_NOT_OK(sock.SetReuseAddr(true));
   RETURN_NOT_OK(sock.Bind(accept_addr));
   Sockaddr remote;
@@ -387,7 +390,8 @@ void Messenger::QueueCancellation(const shared_ptr<OutboundCall> &call) {
 }
 
 void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote) {
-  Reactor *reactor = RemoteToReactor(remote);
+  Reactor *reactor = FLAGS_rpc_reactor_load_balancing ?
+      LeastLoadedReactor() : RemoteToReactor(remote);
   reactor->RegisterInboundSocket(new_socket, remote);
 }
 
@@ -397,7 +401,7 @@ Messenger::Messenger(const MessengerBuilder &bld)
     authentication_(RpcAuthentication::REQUIRED),
     encryption_(RpcEncryption::REQUIRED),
     tls_context_(new security::TlsContext(bld.rpc_tls_ciphers_, bld.rpc_tls_min_protocol_)),
-    token_verifier_(new security::TokenVerifier()),
+    token_verifier_(new security::TokenVerifier(bld.metric_entity_)),
     rpcz_store_(new RpczStore()),
     metric_entity_(bld.metric_entity_),
     rpc_negotiation_timeout_ms_(bld.rpc_negotiation_timeout_ms_),
@@ -431,6 +435,27 @@ Reactor* Messenger::RemoteToReactor(const Sockaddr &remote) {
   return reactors_[reactor_idx];
 }
 
+Reactor* Messenger::LeastLoadedReactor() const {
+  // Loads within the same bucket are considered similar, so that connections
+  // are spread across reactors which are all mostly idle.
+  static const int kLoadBucketPercent = 10;
+  Reactor* least_loaded = nullptr;
+  int least_load_bucket = 0;
+  int least_num_conns = 0;
+  for (Reactor* r : reactors_) {
+    int load_bucket = r->load_percent() / kLoadBucketPercent;
+    int num_conns = r->num_server_connections();
+    if (least_loaded == nullptr ||
+        load_bucket < least_load_bucket ||
+        (load_bucket == least_load_bucket && num_conns < least_num_conns)) {
+      least_loaded = r;
+      least_load_bucket = load_bucket;
+      least_num_conns = num_conns;
+    }
+  }
+  return least_loaded;
+}
+
 Status Messenger::Init() {
   RETURN_NOT_OK(tls_context_->Init());
   for (Reactor* r : reactors_) {
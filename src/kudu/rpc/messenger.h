@@ -299,6 +299,12 @@ class Messenger {
 
   int num_reactors() const { return reactors_.size(); }
 
+  // Returns the reactor with the lowest recent load. Among reactors with
+  // similar loads, returns the one handling the fewest inbound connections.
+  //
+  // This method is thread-safe.
+  Reactor* LeastLoadedReactor() const;
+
   const std::string& name() const {
     return name_;
   }
@@ -326,6 +332,8 @@ class Messenger {
   FRIEND_TEST(TestRpc, TestClientConnectionsMetrics);
   FRIEND_TEST(TestRpc, TestCredentialsPolicy);
   FRIEND_TEST(TestRpc, TestReopenOutboundConnections);
+  FRIEND_TEST(TestRpc, TestReactorConnectionMigration);
+  FRIEND_TEST(TestRpc, TestReactorLoadBalancing);
 
   explicit Messenger(const MessengerBuilder &bld);
 
@@ -47,6 +47,7 @@
 #include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/slice.h"
@@ -72,6 +73,34 @@ DEFINE_bool(rpc_encrypt_loopback_connections, false,
             "an attacker.");
 TAG_FLAG(rpc_encrypt_loopback_connections, advanced);
 
+DEFINE_bool(rpc_compress_loopback_connections, false,
+            "Whether to allow compressing call payloads on RPC connections that "
+            "stay within a single host, where the CPU cost of compression is "
+            "unlikely to pay off. See --rpc_compression_codec.");
+TAG_FLAG(rpc_compress_loopback_connections, advanced);
+TAG_FLAG(rpc_compress_loopback_connections, experimental);
+
+METRIC_DEFINE_histogram(server, rpc_client_negotiation_time_us,
+                        "RPC Client Negotiation Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent negotiating outbound RPC connections, from "
+                        "connecting through authentication.",
+                        60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, rpc_server_negotiation_time_us,
+                        "RPC Server Negotiation Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent negotiating inbound RPC connections, including "
+                        "the TLS handshake and authentication.",
+                        60000000LU, 2);
+
+METRIC_DEFINE_counter(server, rpc_tls_sessions_resumed,
+                      "RPC TLS Sessions Resumed",
+                      kudu::MetricUnit::kConnections,
+                      "Number of inbound and outbound RPC connections whose TLS "
+                      "handshake resumed a previously established session instead "
+                      "of going through a full handshake.");
+
 using std::string;
 using std::unique_ptr;
 using strings::Substitute;
@@ -166,6 +195,7 @@ static Status DoClientNegotiation(Connection* conn,
                                   RpcAuthentication authentication,
                                   RpcEncryption encryption,
                                   MonoTime deadline,
+                                  bool* tls_session_reused,
                                   unique_ptr<ErrorStatusPB>* rpc_error) {
   const auto* messenger = conn->reactor_thread()->reactor()->messenger();
   // Prefer secondary credentials (such as authn token) if permitted by policy.
@@ -222,6 +252,7 @@ static Status DoClientNegotiation(Connection* conn,
   conn->set_remote_features(client_negotiation.take_server_features());
   conn->set_confidential(client_negotiation.tls_negotiated() ||
       (conn->socket()->IsLoopbackConnection() && !FLAGS_rpc_encrypt_loopback_connections));
+  *tls_session_reused = client_negotiation.tls_session_reused();
 
   // Sanity check: if no authn token was supplied as user credentials,
   // the negotiated authentication type cannot be AuthenticationType::TOKEN.
@@ -235,7 +266,8 @@ static Status DoClientNegotiation(Connection* conn,
 static Status DoServerNegotiation(Connection* conn,
                                   RpcAuthentication authentication,
                                   RpcEncryption encryption,
-                                  const MonoTime& deadline) {
+                                  const MonoTime& deadline,
+                                  bool* tls_session_reused) {
   const auto* messenger = conn->reactor_thread()->reactor()->messenger();
   if (authentication == RpcAuthentication::REQUIRED &&
       messenger->keytab_file().empty() &&
@@ -278,6 +310,7 @@ static Status DoServerNegotiation(Connection* conn,
   conn->set_remote_user(server_negotiation.take_authenticated_user());
   conn->set_confidential(server_negotiation.tls_negotiated() ||
       (conn->socket()->IsLoopbackConnection() && !FLAGS_rpc_encrypt_loopback_connections));
+  *tls_session_reused = server_negotiation.tls_session_reused();
 
   return Status::OK();
 }
@@ -286,13 +319,28 @@ void Negotiation::RunNegotiation(const scoped_refptr<Connection>& conn,
                                  RpcAuthentication authentication,
                                  RpcEncryption encryption,
                                  MonoTime deadline) {
+  const MonoTime start = MonoTime::Now();
   Status s;
   unique_ptr<ErrorStatusPB> rpc_error;
+  bool tls_session_reused = false;
   if (conn->direction() == Connection::SERVER) {
-    s = DoServerNegotiation(conn.get(), authentication, encryption, deadline);
+    s = DoServerNegotiation(conn.get(), authentication, encryption, deadline,
+                            &tls_session_reused);
   } else {
     s = DoClientNegotiation(conn.get(), authentication, encryption, deadline,
-                            &rpc_error);
+                            &tls_session_reused, &rpc_error);
+  }
+
+  const auto& metric_entity = conn->reactor_thread()->reactor()->messenger()->metric_entity();
+  if (metric_entity) {
+    const auto& time_histogram = conn->direction() == Connection::SERVER
+        ? METRIC_rpc_server_negotiation_time_us
+        : METRIC_rpc_client_negotiation_time_us;
+    time_histogram.Instantiate(metric_entity)->Increment(
+        (MonoTime::Now() - start).ToMicroseconds());
+    if (tls_session_reused) {
+      METRIC_rpc_tls_sessions_resumed.Instantiate(metric_entity)->Increment();
+    }
   }
 
   if (PREDICT_FALSE(!s.ok())) {
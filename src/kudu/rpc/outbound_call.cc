@@ -34,6 +34,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/walltime.h"
+#include "kudu/rpc/connection.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/outbound_call.h"
 #include "kudu/rpc/rpc_controller.h"
@@ -110,7 +111,7 @@ OutboundCall::~OutboundCall() {
   DVLOG(4) << "OutboundCall " << this << " destroyed with state_: " << StateName(state_);
 }
 
-size_t OutboundCall::SerializeTo(TransferPayload* slices) {
+size_t OutboundCall::SerializeTo(Connection* conn, TransferPayload* slices) {
   DCHECK_LT(0, request_buf_.size())
       << "Must call SetRequestPayload() before SerializeTo()";
 
@@ -124,6 +125,25 @@ size_t OutboundCall::SerializeTo(TransferPayload* slices) {
   }
 
   DCHECK_LE(0, sidecar_byte_size_);
+  vector<Slice> sidecar_slices;
+  sidecar_slices.reserve(sidecars_.size());
+  for (const auto& sidecar : sidecars_) {
+    sidecar_slices.push_back(sidecar->AsSlice());
+  }
+  uint32_t uncompressed_size;
+  CompressionType compression = conn->MaybeCompressMessage(
+      request_buf_, sidecar_slices, sidecar_byte_size_ + request_buf_.size(),
+      &compressed_request_buf_, &uncompressed_size);
+  if (compression != NO_COMPRESSION) {
+    header_.set_compression(compression);
+    header_.set_uncompressed_size(uncompressed_size);
+    serialization::SerializeHeader(header_, compressed_request_buf_.size(), &header_buf_);
+    DCHECK_LE(2, slices->size());
+    (*slices)[0] = Slice(header_buf_);
+    (*slices)[1] = Slice(compressed_request_buf_);
+    return 2;
+  }
+
   serialization::SerializeHeader(
       header_, sidecar_byte_size_ + request_buf_.size(), &header_buf_);
 
@@ -509,10 +529,14 @@ Status CallResponse::GetSidecar(int idx, Slice* sidecar) const {
   return Status::OK();
 }
 
-Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
+Status CallResponse::ParseFrom(Connection* conn, gscoped_ptr<InboundTransfer> transfer) {
   CHECK(!parsed_);
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &serialized_response_));
+  if (header_.has_compression()) {
+    RETURN_NOT_OK(conn->UncompressMessage(header_.compression(), header_.uncompressed_size(),
+                                          &uncompressed_response_buf_, &serialized_response_));
+  }
 
   // Use information from header to extract the payload slices.
   RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(),
@@ -55,6 +55,7 @@ namespace kudu {
 namespace rpc {
 
 class CallResponse;
+class Connection;
 class DumpRunningRpcsRequestPB;
 class RpcCallInProgressPB;
 class RpcController;
@@ -105,9 +106,11 @@ class OutboundCall {
   }
 
   // Serialize the call for the wire. Requires that SetRequestPayload()
-  // is called first. This is called from the Reactor thread.
+  // is called first. This is called from the Reactor thread. The request
+  // body and sidecars are compressed if 'conn' negotiated compression and
+  // they are large enough.
   // Returns the number of slices in the serialized call.
-  size_t SerializeTo(TransferPayload* slices);
+  size_t SerializeTo(Connection* conn, TransferPayload* slices);
 
   // Mark in the call that cancellation has been requested. If the call hasn't yet
   // started sending or has finished sending the RPC request but is waiting for a
@@ -266,6 +269,10 @@ class OutboundCall {
   faststring header_buf_;
   faststring request_buf_;
 
+  // The compressed request body and sidecars, sent in place of 'request_buf_'
+  // and 'sidecars_' if the header specifies a compression codec.
+  faststring compressed_request_buf_;
+
   // Once a response has been received for this call, contains that response.
   // Otherwise NULL.
   gscoped_ptr<CallResponse> call_response_;
@@ -295,9 +302,9 @@ class CallResponse {
  public:
   CallResponse();
 
-  // Parse the response received from a call. This must be called before any
-  // other methods on this object.
-  Status ParseFrom(gscoped_ptr<InboundTransfer> transfer);
+  // Parse the response received from a call on 'conn'. This must be called
+  // before any other methods on this object.
+  Status ParseFrom(Connection* conn, gscoped_ptr<InboundTransfer> transfer);
 
   // Return true if the call succeeded.
   bool is_success() const {
@@ -339,6 +346,10 @@ class CallResponse {
   // and sidecar_slices_ refer into its data.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // The uncompressed response body and sidecars, if the response was
+  // compressed. serialized_response_ and sidecar_slices_ then refer into it.
+  faststring uncompressed_response_buf_;
+
   DISALLOW_COPY_AND_ASSIGN(CallResponse);
 };
 
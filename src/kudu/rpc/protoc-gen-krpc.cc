@@ -207,6 +207,9 @@ class MethodSubstitutions : public Substituter {
     (*map)["metric_enum_key"] = strings::Substitute("kMetricIndex$0", method_->name());
     bool track_result = static_cast<bool>(method_->options().GetExtension(track_rpc_result));
     (*map)["track_result"] = track_result ? " true" : "false";
+    bool use_arena = method_->input_type()->file()->options().cc_enable_arenas() &&
+        method_->output_type()->file()->options().cc_enable_arenas();
+    (*map)["use_arena"] = use_arena ? "true" : "false";
     (*map)["authz_method"] = GetAuthzMethod(*method_).get_value_or("AuthorizeAllowAll");
   }
 
@@ -248,6 +251,8 @@ class ServiceSubstitutions : public Substituter {
   virtual void InitSubstitutionMap(map<string, string> *map) const OVERRIDE {
     (*map)["service_name"] = service_->name();
     (*map)["full_service_name"] = service_->full_name();
+    (*map)["full_service_name_plainchars"] =
+        StringReplace(service_->full_name(), ".", "_", true);
     (*map)["service_method_count"] = SimpleItoa(service_->method_count());
 
     // TODO: upgrade to protobuf 2.5.x and attach service comments
@@ -459,6 +464,15 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
       const ServiceDescriptor *service = file->service(service_idx);
       subs->PushService(service);
 
+      Print(printer, *subs,
+        "METRIC_DEFINE_histogram(server, rpc_incoming_queue_time_$full_service_name_plainchars$,\n"
+        "  \"$full_service_name$ RPC Queue Time\",\n"
+        "  kudu::MetricUnit::kMicroseconds,\n"
+        "  \"Number of microseconds incoming $full_service_name$ RPC requests spend in "
+        "the worker queue\",\n"
+        "  60000000LU, 3);\n"
+        "\n");
+
       for (int method_idx = 0; method_idx < service->method_count();
           ++method_idx) {
         const MethodDescriptor *method = service->method(method_idx);
@@ -496,6 +510,8 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
         "$service_name$If::$service_name$If(const scoped_refptr<MetricEntity>& entity,"
             " const scoped_refptr<ResultTracker>& result_tracker) {\n"
             "result_tracker_ = result_tracker;\n"
+            "queue_time_histogram_ =\n"
+            "    METRIC_rpc_incoming_queue_time_$full_service_name_plainchars$.Instantiate(entity);\n"
       );
       for (int method_idx = 0; method_idx < service->method_count();
            ++method_idx) {
@@ -514,6 +530,7 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
               "                           ctx);\n"
               "    };\n"
               "    mi->track_result = $track_result$;\n"
+              "    mi->use_arena = $use_arena$;\n"
               "    mi->handler_latency_histogram =\n"
               "        METRIC_handler_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
               "    mi->func = [this](const Message* req, Message* resp, RpcContext* ctx) {\n"
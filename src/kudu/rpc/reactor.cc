@@ -80,6 +80,31 @@ DEFINE_bool(rpc_reopen_outbound_connections, false,
 TAG_FLAG(rpc_reopen_outbound_connections, unsafe);
 TAG_FLAG(rpc_reopen_outbound_connections, runtime);
 
+DEFINE_bool(rpc_reactor_load_balancing, true,
+            "Whether to assign each new inbound connection to the least loaded "
+            "reactor thread, rather than to one chosen by hashing the remote "
+            "address, which may pile several busy connections onto the same "
+            "reactor thread.");
+TAG_FLAG(rpc_reactor_load_balancing, advanced);
+TAG_FLAG(rpc_reactor_load_balancing, runtime);
+
+DEFINE_bool(rpc_reactor_migrate_connections, false,
+            "Whether a reactor thread which is much busier than the least "
+            "loaded one periodically hands one of its busy inbound connections "
+            "over to it. Connections are only migrated between calls. See "
+            "--rpc_reactor_migration_load_gap_pct.");
+TAG_FLAG(rpc_reactor_migrate_connections, advanced);
+TAG_FLAG(rpc_reactor_migrate_connections, experimental);
+TAG_FLAG(rpc_reactor_migrate_connections, runtime);
+
+DEFINE_int32(rpc_reactor_migration_load_gap_pct, 25,
+             "The number of percentage points by which the load of a reactor "
+             "thread must exceed that of the least loaded reactor thread for "
+             "it to migrate a connection. See --rpc_reactor_migrate_connections.");
+TAG_FLAG(rpc_reactor_migration_load_gap_pct, advanced);
+TAG_FLAG(rpc_reactor_migration_load_gap_pct, experimental);
+TAG_FLAG(rpc_reactor_migration_load_gap_pct, runtime);
+
 METRIC_DEFINE_histogram(server, reactor_load_percent,
                         "Reactor Thread Load Percentage",
                         kudu::MetricUnit::kUnits,
@@ -97,10 +122,21 @@ METRIC_DEFINE_histogram(server, reactor_active_latency_us,
                         "to the latency of both inbound and outbound RPCs.",
                         1000000, 2);
 
+METRIC_DEFINE_counter(server, reactor_connections_migrated,
+                      "Reactor Connections Migrated",
+                      kudu::MetricUnit::kConnections,
+                      "Number of inbound connections which reactor threads handed "
+                      "over to less loaded reactor threads.");
+
 namespace kudu {
 namespace rpc {
 
 namespace {
+
+// The minimum time between two connection migrations by a reactor thread,
+// which gives the load measurements time to reflect the previous migration.
+const MonoDelta kMinMigrationInterval = MonoDelta::FromSeconds(1);
+
 Status ShutdownError(bool aborted) {
   const char* msg = "reactor is shutting down";
   return aborted ?
@@ -132,6 +168,9 @@ ReactorThread::ReactorThread(Reactor *reactor, const MessengerBuilder& bld)
     reactor_(reactor),
     connection_keepalive_time_(bld.connection_keepalive_time_),
     coarse_timer_granularity_(bld.coarse_timer_granularity_),
+    load_percent_(0),
+    num_server_conns_(0),
+    next_migration_time_(cur_time_),
     total_client_conns_cnt_(0),
     total_server_conns_cnt_(0) {
 
@@ -140,6 +179,8 @@ ReactorThread::ReactorThread(Reactor *reactor, const MessengerBuilder& bld)
         METRIC_reactor_active_latency_us.Instantiate(bld.metric_entity_);
     load_percent_histogram_ =
         METRIC_reactor_load_percent.Instantiate(bld.metric_entity_);
+    connections_migrated_ =
+        METRIC_reactor_connections_migrated.Instantiate(bld.metric_entity_);
   }
 }
 
@@ -237,6 +278,7 @@ void ReactorThread::ShutdownInternal() {
     conn->Shutdown(service_unavailable);
   }
   server_conns_.clear();
+  num_server_conns_ = 0;
 
   // Abort any scheduled tasks.
   //
@@ -318,12 +360,60 @@ void ReactorThread::RegisterConnection(scoped_refptr<Connection> conn) {
   if (PREDICT_FALSE(!s.ok())) {
     LOG(ERROR) << "Server connection negotiation failed: " << s.ToString();
     DestroyConnection(conn.get(), s);
+    --num_server_conns_;
     return;
   }
   ++total_server_conns_cnt_;
   server_conns_.emplace_back(std::move(conn));
 }
 
+void ReactorThread::MaybeMigrateConnection() {
+  DCHECK(IsCurrentThread());
+  if (!FLAGS_rpc_reactor_migrate_connections) {
+    return;
+  }
+
+  // Find the connection which received the most calls since the last scan
+  // among those which are between calls, and so can be migrated.
+  auto busiest = server_conns_.end();
+  uint64_t busiest_calls = 0;
+  for (auto it = server_conns_.begin(); it != server_conns_.end(); ++it) {
+    uint64_t calls = (*it)->TakeNumCallsReceived();
+    if (calls > busiest_calls && (*it)->Idle()) {
+      busiest = it;
+      busiest_calls = calls;
+    }
+  }
+  if (busiest == server_conns_.end() || cur_time_ < next_migration_time_) {
+    return;
+  }
+
+  Reactor* target = reactor_->messenger()->LeastLoadedReactor();
+  if (target == reactor_ ||
+      load_percent_ - target->load_percent() < FLAGS_rpc_reactor_migration_load_gap_pct) {
+    return;
+  }
+
+  scoped_refptr<Connection> conn = std::move(*busiest);
+  server_conns_.erase(busiest);
+  --num_server_conns_;
+  conn->PrepareToMigrate();
+  next_migration_time_ = cur_time_ + kMinMigrationInterval;
+  if (connections_migrated_) {
+    connections_migrated_->Increment();
+  }
+  VLOG(1) << name() << ": migrating " << conn->ToString() << " (load "
+          << load_percent_ << "%) to " << target->name() << " (load "
+          << target->load_percent() << "%)";
+  target->MigrateConnection(std::move(conn));
+}
+
+void ReactorThread::AdoptConnection(scoped_refptr<Connection> conn) {
+  DCHECK(IsCurrentThread());
+  conn->CompleteMigration(this, loop_);
+  server_conns_.emplace_back(std::move(conn));
+}
+
 void ReactorThread::AssignOutboundCall(shared_ptr<OutboundCall> call) {
   DCHECK(IsCurrentThread());
 
@@ -385,13 +475,18 @@ void ReactorThread::TimerHandler(ev::timer& /*watcher*/, int revents) {
     int64_t poll_cycles_delta = total_poll_cycles_ - last_load_measurement_.poll_cycles;
     double poll_fraction = static_cast<double>(poll_cycles_delta) / cycles_delta;
     double active_fraction = 1 - poll_fraction;
+    int load_percent = static_cast<int>(active_fraction * 100);
     if (load_percent_histogram_) {
-      load_percent_histogram_->Increment(static_cast<int>(active_fraction * 100));
+      load_percent_histogram_->Increment(load_percent);
     }
+    // Smooth the load used to balance connections across reactor threads, so
+    // that a single busy or quiet interval doesn't move them around.
+    load_percent_ = (3 * load_percent_ + load_percent) / 4;
   }
   last_load_measurement_.time_cycles = now_cycles;
   last_load_measurement_.poll_cycles = total_poll_cycles_;
 
+  MaybeMigrateConnection();
   ScanIdleConnections();
 }
 
@@ -426,6 +521,7 @@ void ReactorThread::ScanIdleConnections() {
               << connection_delta.ToString();
       ++timed_out;
       it = server_conns_.erase(it);
+      --num_server_conns_;
     }
   }
   // Take care of idle client-side connections marked for shutdown.
@@ -538,7 +634,7 @@ Status ReactorThread::FindOrStartConnection(const ConnectionId& conn_id,
 
   // Create a new socket and start connecting to the remote.
   Socket sock;
-  RETURN_NOT_OK(CreateClientSocket(&sock));
+  RETURN_NOT_OK(CreateClientSocket(conn_id.remote().family(), &sock));
   RETURN_NOT_OK(StartConnect(&sock, conn_id.remote()));
 
   unique_ptr<Socket> new_socket(new Socket(sock.Release()));
@@ -606,8 +702,8 @@ void ReactorThread::CompleteConnectionNegotiation(
   conn->EpollRegister(loop_);
 }
 
-Status ReactorThread::CreateClientSocket(Socket *sock) {
-  Status ret = sock->Init(Socket::FLAG_NONBLOCKING);
+Status ReactorThread::CreateClientSocket(int family, Socket *sock) {
+  Status ret = sock->Init(family, Socket::FLAG_NONBLOCKING);
   if (ret.ok()) {
     ret = sock->SetNoDelay(true);
   }
@@ -659,6 +755,7 @@ void ReactorThread::DestroyConnection(Connection *conn,
     while (it != server_conns_.end()) {
       if ((*it).get() == conn) {
         server_conns_.erase(it);
+        --num_server_conns_;
         break;
       }
       ++it;
@@ -815,6 +912,7 @@ class RegisterConnectionTask : public ReactorTask {
     // We don't need to Shutdown the connection since it was never registered.
     // This is only used for inbound connections, and inbound connections will
     // never have any calls added to them until they've been registered.
+    --conn_->reactor_thread()->num_server_conns_;
     delete this;
   }
 
@@ -825,11 +923,44 @@ class RegisterConnectionTask : public ReactorTask {
 void Reactor::RegisterInboundSocket(Socket *socket, const Sockaddr& remote) {
   VLOG(3) << name_ << ": new inbound connection to " << remote.ToString();
   unique_ptr<Socket> new_socket(new Socket(socket->Release()));
+  ++thread_.num_server_conns_;
   auto task = new RegisterConnectionTask(
       new Connection(&thread_, remote, std::move(new_socket), Connection::SERVER));
   ScheduleReactorTask(task);
 }
 
+// Task which runs in the reactor thread to take over an inbound connection
+// migrated from another reactor thread.
+class MigrateConnectionTask : public ReactorTask {
+ public:
+  MigrateConnectionTask(ReactorThread* thread, scoped_refptr<Connection> conn)
+      : thread_(thread),
+        conn_(std::move(conn)) {
+  }
+
+  void Run(ReactorThread* reactor) override {
+    DCHECK_EQ(thread_, reactor);
+    reactor->AdoptConnection(std::move(conn_));
+    delete this;
+  }
+
+  void Abort(const Status& /*status*/) override {
+    // The connection is no longer watched by any reactor thread, and it has
+    // no calls in flight, so dropping it closes its socket.
+    --thread_->num_server_conns_;
+    delete this;
+  }
+
+ private:
+  ReactorThread* const thread_;
+  scoped_refptr<Connection> conn_;
+};
+
+void Reactor::MigrateConnection(scoped_refptr<Connection> conn) {
+  ++thread_.num_server_conns_;
+  ScheduleReactorTask(new MigrateConnectionTask(&thread_, std::move(conn)));
+}
+
 // Task which runs in the reactor thread to assign an outbound call
 // to a connection.
 class AssignOutboundCallTask : public ReactorTask {
@@ -17,6 +17,7 @@
 #ifndef KUDU_RPC_REACTOR_H
 #define KUDU_RPC_REACTOR_H
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -178,6 +179,16 @@ class ReactorThread {
   // This may be called from another thread.
   Reactor *reactor();
 
+  // The recent load of the thread: the smoothed percentage of time it spent
+  // busy rather than waiting for network activity.
+  // This may be called from another thread.
+  int load_percent() const { return load_percent_; }
+
+  // The number of inbound connections handled by the thread, including the
+  // ones queued to be registered or migrated to it.
+  // This may be called from another thread.
+  int num_server_connections() const { return num_server_conns_; }
+
   // Return true if this reactor thread is the thread currently
   // running. Should be used in DCHECK assertions.
   bool IsCurrentThread() const;
@@ -199,6 +210,8 @@ class ReactorThread {
  private:
   friend class AssignOutboundCallTask;
   friend class CancellationTask;
+  friend class MigrateConnectionTask;
+  friend class Reactor;
   friend class RegisterConnectionTask;
   friend class DelayedTask;
 
@@ -248,7 +261,7 @@ class ReactorThread {
   void ScanIdleConnections();
 
   // Create a new client socket (non-blocking, NODELAY)
-  static Status CreateClientSocket(Socket *sock);
+  static Status CreateClientSocket(int family, Socket *sock);
 
   // Initiate a new connection on the given socket.
   static Status StartConnect(Socket *sock, const Sockaddr &remote);
@@ -267,6 +280,14 @@ class ReactorThread {
   // Register a new connection.
   void RegisterConnection(scoped_refptr<Connection> conn);
 
+  // If this thread is much busier than the least loaded reactor thread, hands
+  // the busiest of its idle inbound connections over to that thread.
+  // See --rpc_reactor_migrate_connections.
+  void MaybeMigrateConnection();
+
+  // Take over an inbound connection migrated from another reactor thread.
+  void AdoptConnection(scoped_refptr<Connection> conn);
+
   // Actually perform shutdown of the thread, tearing down any connections,
   // etc. This is called from within the thread.
   void ShutdownInternal();
@@ -311,6 +332,16 @@ class ReactorThread {
   // Metrics.
   scoped_refptr<Histogram> invoke_us_histogram_;
   scoped_refptr<Histogram> load_percent_histogram_;
+  scoped_refptr<Counter> connections_migrated_;
+
+  // See load_percent(). Updated by TimerHandler().
+  std::atomic<int> load_percent_;
+
+  // See num_server_connections().
+  std::atomic<int> num_server_conns_;
+
+  // The earliest time at which the thread may migrate another connection.
+  MonoTime next_migration_time_;
 
   // Total number of client connections opened during Reactor's lifetime.
   uint64_t total_client_conns_cnt_;
@@ -363,6 +394,18 @@ class Reactor {
   // If the reactor is already shut down, takes care of closing the socket.
   void RegisterInboundSocket(Socket *socket, const Sockaddr &remote);
 
+  // Queue an inbound connection migrated from another reactor, which has
+  // stopped watching its socket. If the reactor is already shut down, the
+  // connection is closed.
+  void MigrateConnection(scoped_refptr<Connection> conn);
+
+  // See ReactorThread::load_percent() and
+  // ReactorThread::num_server_connections().
+  //
+  // These methods are thread-safe.
+  int load_percent() const { return thread_.load_percent(); }
+  int num_server_connections() const { return thread_.num_server_connections(); }
+
   // Queue a new call to be sent. If the reactor is already shut down, marks
   // the call as failed.
   void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
@@ -254,6 +254,9 @@ class CalculatorService : public CalculatorServiceIf {
 
   void Add(const AddRequestPB *req, AddResponsePB *resp, RpcContext *context) override {
     CHECK_GT(context->GetTransferSize(), 0);
+    // The messages are allocated on the call's arena.
+    CHECK(req->GetArena() != nullptr);
+    CHECK_EQ(req->GetArena(), resp->GetArena());
     resp->set_result(req->x() + req->y());
     context->RespondSuccess();
   }
@@ -55,7 +55,9 @@
 #include "kudu/rpc/rtest.pb.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/rpc/user_credentials.h"
 #include "kudu/security/test/test_certs.h"
+#include "kudu/security/tls_context.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
@@ -72,9 +74,24 @@
 
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
+METRIC_DECLARE_histogram(rpc_incoming_queue_time_kudu_rpc_test_CalculatorService);
+METRIC_DECLARE_counter(rpc_compression_input_bytes);
+METRIC_DECLARE_counter(rpc_compression_output_bytes);
+METRIC_DECLARE_counter(reactor_connections_migrated);
+METRIC_DECLARE_counter(rpc_tls_sessions_resumed);
+METRIC_DECLARE_histogram(rpc_client_negotiation_time_us);
+METRIC_DECLARE_histogram(rpc_server_negotiation_time_us);
 
 DECLARE_bool(rpc_reopen_outbound_connections);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_bool(rpc_zero_copy_send);
+DECLARE_int32(rpc_zero_copy_send_min_bytes);
+DECLARE_int32(rpc_max_write_batch_transfers);
+DECLARE_string(rpc_compression_codec);
+DECLARE_int32(rpc_compression_min_bytes);
+DECLARE_bool(rpc_compress_loopback_connections);
+DECLARE_bool(rpc_reactor_migrate_connections);
+DECLARE_int32(rpc_reactor_migration_load_gap_pct);
 
 using std::shared_ptr;
 using std::string;
@@ -187,6 +204,69 @@ TEST_P(TestRpc, TestCall) {
   }
 }
 
+// Test that a client resumes its TLS session with a server when it opens
+// another connection to it.
+TEST_P(TestRpc, TestTlsSessionResumption) {
+  bool enable_ssl = GetParam();
+  if (!enable_ssl) return;
+
+  // Set up server.
+  Sockaddr server_addr;
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+
+  // Calls on behalf of different users go over different connections.
+  for (const char* user : { "alice", "bob" }) {
+    Proxy p(client_messenger, server_addr, server_addr.host(),
+            GenericCalculatorService::static_service_name());
+    UserCredentials creds;
+    creds.set_real_user(user);
+    p.set_user_credentials(creds);
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  // The client and server messengers share their metric entity, and both count
+  // the session resumed by the second connection.
+  const auto& metric_entity = server_messenger_->metric_entity();
+  ASSERT_EQ(2, METRIC_rpc_tls_sessions_resumed.Instantiate(metric_entity)->value());
+  ASSERT_EQ(2, METRIC_rpc_client_negotiation_time_us.Instantiate(metric_entity)->TotalCount());
+  ASSERT_EQ(2, METRIC_rpc_server_negotiation_time_us.Instantiate(metric_entity)->TotalCount());
+  ASSERT_EQ(1, client_messenger->tls_context().session_cache_size_for_tests());
+}
+
+// Test making calls over a UNIX domain socket, as used by clients co-located
+// with a server.
+TEST_P(TestRpc, TestCallOverUnixDomainSocket) {
+  // Set up a server which also accepts connections on an abstract socket.
+  Sockaddr tcp_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&tcp_addr, enable_ssl));
+  Sockaddr server_addr;
+  ASSERT_OK(server_addr.ParseUnixDomainPath(
+      strings::Substitute("@kudu-rpc-test-$0", getpid())));
+  shared_ptr<AcceptorPool> pool;
+  ASSERT_OK(server_messenger_->AddAcceptorPool(server_addr, &pool));
+  ASSERT_OK(pool->Start(1));
+  Sockaddr bound_addr;
+  ASSERT_OK(pool->GetBoundAddress(&bound_addr));
+  ASSERT_EQ(server_addr, bound_addr);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, "localhost",
+          GenericCalculatorService::static_service_name());
+  ASSERT_STR_CONTAINS(p.ToString(), "remote=unix:@kudu-rpc-test-");
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+  DoTestSidecar(p, 123, 456);
+  pool->Shutdown();
+}
+
 TEST_P(TestRpc, TestCallWithChainCerts) {
   bool enable_ssl = GetParam();
   // We're only interested in running this test with TLS enabled.
@@ -561,6 +641,71 @@ TEST_P(TestRpc, TestReopenOutboundConnections) {
   }
 }
 
+// Test that inbound connections are spread evenly across the server's
+// reactors.
+TEST_P(TestRpc, TestReactorLoadBalancing) {
+  n_server_reactor_threads_ = 3;
+  keepalive_time_ms_ = -1;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Each client messenger opens its own connection to the server.
+  const int kConnsPerReactor = 2;
+  vector<shared_ptr<Messenger>> client_messengers;
+  for (int i = 0; i < kConnsPerReactor * n_server_reactor_threads_; i++) {
+    shared_ptr<Messenger> client_messenger;
+    ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+    Proxy p(client_messenger, server_addr, server_addr.host(),
+            GenericCalculatorService::static_service_name());
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+    client_messengers.emplace_back(std::move(client_messenger));
+  }
+
+  for (int i = 0; i < n_server_reactor_threads_; i++) {
+    ReactorMetrics metrics;
+    ASSERT_OK(server_messenger_->reactors_[i]->GetMetrics(&metrics));
+    ASSERT_EQ(kConnsPerReactor, metrics.num_server_connections_) << "reactor " << i;
+  }
+}
+
+// Test that calls keep succeeding on a connection which is migrated back and
+// forth between the server's reactors.
+TEST_P(TestRpc, TestReactorConnectionMigration) {
+  FLAGS_rpc_reactor_migrate_connections = true;
+  // Migrate the busy connection to the other reactor, which has fewer
+  // connections, regardless of load.
+  FLAGS_rpc_reactor_migration_load_gap_pct = 0;
+  n_server_reactor_threads_ = 2;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  scoped_refptr<Counter> migrated =
+      METRIC_reactor_connections_migrated.Instantiate(server_messenger_->metric_entity());
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(30);
+  while (migrated->value() < 3 && MonoTime::Now() < deadline) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+    DoTestSidecar(p, 123, 456);
+  }
+  ASSERT_GE(migrated->value(), 3);
+
+  // The client kept using its one connection.
+  ReactorMetrics metrics;
+  ASSERT_OK(client_messenger->reactors_[0]->GetMetrics(&metrics));
+  ASSERT_EQ(1, metrics.total_client_connections_);
+}
+
 // Test that an outbound connection is closed and a new one is open if going
 // from ANY_CREDENTIALS to PRIMARY_CREDENTIALS policy for RPC calls to the same
 // destination.
@@ -691,6 +836,108 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestOutgoingSidecarExpectOK(p, 3000 * 1024, 2000 * 1024);
 }
 
+// Test that many small calls queued on the same connection, whose requests
+// and responses are written to the socket in batches, all get the right
+// responses.
+TEST_P(TestRpc, TestBatchedWrites) {
+  FLAGS_rpc_max_write_batch_transfers = 8;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  const int kNumCalls = 100;
+  vector<AddRequestPB> reqs(kNumCalls);
+  vector<AddResponsePB> resps(kNumCalls);
+  vector<unique_ptr<RpcController>> controllers;
+  CountDownLatch latch(kNumCalls);
+  for (int i = 0; i < kNumCalls; i++) {
+    reqs[i].set_x(i);
+    reqs[i].set_y(2 * i);
+    controllers.emplace_back(new RpcController());
+    p.AsyncRequest(GenericCalculatorService::kAddMethodName, reqs[i], &resps[i],
+                   controllers.back().get(),
+                   boost::bind(&CountDownLatch::CountDown, boost::ref(latch)));
+  }
+  latch.Wait();
+
+  for (int i = 0; i < kNumCalls; i++) {
+    ASSERT_OK(controllers[i]->status());
+    ASSERT_EQ(3 * i, resps[i].result());
+  }
+}
+
+// Test that responses sent with MSG_ZEROCOPY arrive intact. Zero-copy isn't
+// available on TLS connections or older kernels, in which case the responses
+// are sent the regular way.
+TEST_P(TestRpc, TestRpcSidecarZeroCopy) {
+  FLAGS_rpc_zero_copy_send = true;
+  FLAGS_rpc_zero_copy_send_min_bytes = 0;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, GetParam()));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  for (int i = 0; i < 5; i++) {
+    DoTestSidecar(p, 123, 456);
+    DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+  }
+}
+
+// Test that compressed requests and responses arrive intact, and that large
+// compressible payloads are actually sent compressed.
+TEST_P(TestRpc, TestRpcCompression) {
+  FLAGS_rpc_compression_codec = "lz4";
+  FLAGS_rpc_compression_min_bytes = 1024;
+  FLAGS_rpc_compress_loopback_connections = true;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  // Payloads below the threshold, and large random ones, which are sent
+  // uncompressed if they don't shrink.
+  DoTestSidecar(p, 123, 456);
+  DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+  DoTestOutgoingSidecarExpectOK(p, 123, 456);
+
+  // Both the request sidecars and the response of this call are highly
+  // compressible.
+  scoped_refptr<Counter> input_bytes =
+      METRIC_rpc_compression_input_bytes.Instantiate(server_messenger_->metric_entity());
+  scoped_refptr<Counter> output_bytes =
+      METRIC_rpc_compression_output_bytes.Instantiate(server_messenger_->metric_entity());
+  int64_t input_bytes_before = input_bytes->value();
+  int64_t output_bytes_before = output_bytes->value();
+  DoTestOutgoingSidecarExpectOK(p, 3000 * 1024, 2000 * 1024);
+
+  int64_t input = input_bytes->value() - input_bytes_before;
+  int64_t output = output_bytes->value() - output_bytes_before;
+  ASSERT_GT(input, (3000 + 2000) * 1024);
+  ASSERT_LT(output, input / 10);
+}
+
 TEST_P(TestRpc, TestRpcSidecarLimits) {
   {
     // Test that the limits on the number of sidecars is respected.
@@ -1000,6 +1247,12 @@ TEST_P(TestRpc, TestRpcHandlerLatencyMetric) {
   // TODO: Implement an incoming queue latency test.
   // For now we just assert that the metric exists.
   ASSERT_TRUE(FindOrDie(metric_map, &METRIC_rpc_incoming_queue_time));
+
+  // The call is also accounted to its service's own queue time histogram.
+  scoped_refptr<Histogram> service_queue_time = down_cast<Histogram *>(
+      FindOrDie(metric_map,
+                &METRIC_rpc_incoming_queue_time_kudu_rpc_test_CalculatorService).get());
+  ASSERT_EQ(1, service_queue_time->TotalCount());
 }
 
 static void DestroyMessengerCallback(shared_ptr<Messenger>* messenger,
@@ -22,8 +22,10 @@
 #include <utility>
 
 #include <glog/logging.h>
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 
+#include "kudu/gutil/basictypes.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/remote_method.h"
@@ -49,8 +51,10 @@ namespace rpc {
 RpcContext::RpcContext(InboundCall *call,
                        const google::protobuf::Message *request_pb,
                        google::protobuf::Message *response_pb,
-                       const scoped_refptr<ResultTracker>& result_tracker)
+                       const scoped_refptr<ResultTracker>& result_tracker,
+                       unique_ptr<google::protobuf::Arena> arena)
   : call_(CHECK_NOTNULL(call)),
+    arena_(std::move(arena)),
     request_pb_(request_pb),
     response_pb_(response_pb),
     result_tracker_(result_tracker) {
@@ -62,6 +66,11 @@ RpcContext::RpcContext(InboundCall *call,
 }
 
 RpcContext::~RpcContext() {
+  if (arena_) {
+    // The messages are freed along with the arena.
+    ignore_result(request_pb_.release());
+    ignore_result(response_pb_.release());
+  }
 }
 
 void RpcContext::RespondSuccess() {
@@ -189,6 +198,10 @@ MonoTime RpcContext::GetTimeReceived() const {
   return call_->GetTimeReceived();
 }
 
+MonoTime RpcContext::GetTimeHandled() const {
+  return call_->timing().time_handled;
+}
+
 Trace* RpcContext::trace() {
   return call_->trace();
 }
@@ -31,6 +31,7 @@
 
 namespace google {
 namespace protobuf {
+class Arena;
 class Message;
 } // namespace protobuf
 } // namespace google
@@ -67,10 +68,14 @@ class RpcContext {
  public:
   // Create an RpcContext. This is called only from generated code
   // and is not a public API.
+  //
+  // If 'arena' is set, 'request_pb' and 'response_pb' were allocated on it,
+  // and it is destroyed, along with them, when the call is done.
   RpcContext(InboundCall *call,
              const google::protobuf::Message *request_pb,
              google::protobuf::Message *response_pb,
-             const scoped_refptr<ResultTracker>& result_tracker);
+             const scoped_refptr<ResultTracker>& result_tracker,
+             std::unique_ptr<google::protobuf::Arena> arena);
 
   ~RpcContext();
 
@@ -207,6 +212,9 @@ class RpcContext {
   // Return the time when the inbound call was received.
   MonoTime GetTimeReceived() const;
 
+  // Return the time when the handling of the inbound call started.
+  MonoTime GetTimeHandled() const;
+
   // Whether the results of this RPC are tracked with a ResultTracker.
   // If this returns true, both result_tracker() and request_id() should return non-null results.
   bool AreResultsTracked() const { return result_tracker_.get() != nullptr; }
@@ -235,8 +243,11 @@ class RpcContext {
  private:
   friend class ResultTracker;
   InboundCall* const call_;
-  const gscoped_ptr<const google::protobuf::Message> request_pb_;
-  const gscoped_ptr<google::protobuf::Message> response_pb_;
+  // Declared before the messages, so that it outlives them.
+  std::unique_ptr<google::protobuf::Arena> arena_;
+  // Owned unless 'arena_' is set.
+  gscoped_ptr<const google::protobuf::Message> request_pb_;
+  gscoped_ptr<google::protobuf::Message> response_pb_;
   scoped_refptr<ResultTracker> result_tracker_;
 };
 
@@ -20,6 +20,7 @@
 #include <limits>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -31,6 +32,7 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/constants.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
@@ -41,6 +43,7 @@ DECLARE_int64(rpc_max_message_size);
 using google::protobuf::MessageLite;
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::CodedOutputStream;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -177,6 +180,70 @@ Status ParseMessage(const Slice& buf,
   return Status::OK();
 }
 
+bool CompressMessage(const CompressionCodec& codec,
+                     const faststring& param_buf,
+                     const vector<Slice>& sidecars,
+                     faststring* compressed_buf,
+                     uint32_t* uncompressed_size) {
+  // Skip the length prefix written by SerializeMessage().
+  CodedInputStream in(param_buf.data(), param_buf.size());
+  uint32_t main_msg_len;
+  CHECK(in.ReadVarint32(&main_msg_len));
+  int prefix_len = in.CurrentPosition();
+
+  vector<Slice> input;
+  input.reserve(1 + sidecars.size());
+  input.emplace_back(param_buf.data() + prefix_len, param_buf.size() - prefix_len);
+  input.insert(input.end(), sidecars.begin(), sidecars.end());
+
+  // Compress past the room needed for the largest possible length prefix,
+  // then move the compressed bytes down behind the actual prefix.
+  const int kMaxPrefixLen = CodedOutputStream::VarintSize32(
+      std::numeric_limits<uint32_t>::max());
+  compressed_buf->resize(kMaxPrefixLen + codec.MaxCompressedLength(main_msg_len));
+  size_t compressed_len;
+  Status s = codec.Compress(input, compressed_buf->data() + kMaxPrefixLen, &compressed_len);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(WARNING) << "Unable to compress RPC message, sending it uncompressed: "
+                 << s.ToString();
+    return false;
+  }
+  size_t compressed_prefix_len = CodedOutputStream::VarintSize32(compressed_len);
+  if (compressed_prefix_len + compressed_len >=
+      static_cast<size_t>(prefix_len) + main_msg_len) {
+    return false;
+  }
+  uint8_t* dst = CodedOutputStream::WriteVarint32ToArray(compressed_len,
+                                                         compressed_buf->data());
+  memmove(dst, compressed_buf->data() + kMaxPrefixLen, compressed_len);
+  compressed_buf->resize(compressed_prefix_len + compressed_len);
+  *uncompressed_size = main_msg_len;
+  return true;
+}
+
+Status UncompressMessage(CompressionType compression,
+                         uint32_t uncompressed_size,
+                         faststring* buf,
+                         Slice* main_message) {
+  if (PREDICT_FALSE(compression != LZ4 && compression != ZSTD)) {
+    return Status::Corruption(Substitute("Invalid packet: unsupported compression $0",
+                                         CompressionType_Name(compression)));
+  }
+  if (PREDICT_FALSE(uncompressed_size > FLAGS_rpc_max_message_size)) {
+    return Status::Corruption(Substitute(
+        "Invalid packet: uncompressed main msg of $0 bytes is larger than the "
+        "maximum configured RPC message size ($1 bytes)",
+        uncompressed_size, FLAGS_rpc_max_message_size));
+  }
+  const CompressionCodec* codec;
+  RETURN_NOT_OK(GetCompressionCodec(compression, &codec));
+  buf->resize(uncompressed_size);
+  RETURN_NOT_OK_PREPEND(codec->Uncompress(*main_message, buf->data(), uncompressed_size),
+                        "Invalid packet: unable to uncompress main msg");
+  *main_message = Slice(*buf);
+  return Status::OK();
+}
+
 void SerializeConnHeader(uint8_t* buf) {
   memcpy(reinterpret_cast<char *>(buf), kMagicNumber, kMagicNumberLength);
   buf += kMagicNumberLength;
@@ -20,6 +20,9 @@
 
 #include <cstdint>
 #include <cstring>
+#include <vector>
+
+#include "kudu/util/compression/compression.pb.h"
 
 namespace google {
 namespace protobuf {
@@ -29,6 +32,7 @@ class MessageLite;
 
 namespace kudu {
 
+class CompressionCodec;
 class Status;
 class faststring;
 class Slice;
@@ -74,6 +78,28 @@ Status ParseMessage(const Slice& buf,
                     google::protobuf::MessageLite* parsed_header,
                     Slice* parsed_main_message);
 
+// Compress the main message of a call or response: the body in 'param_buf',
+// as produced by SerializeMessage(), followed by the 'sidecars'.
+// Out: 'compressed_buf' is populated with the varint-prefixed compressed
+//        bytes, to be sent in place of 'param_buf' and the sidecars.
+//      'uncompressed_size' is set to the size of the main message.
+// Returns false if the payload did not shrink, in which case it should be
+// sent as is.
+bool CompressMessage(const CompressionCodec& codec,
+                     const faststring& param_buf,
+                     const std::vector<Slice>& sidecars,
+                     faststring* compressed_buf,
+                     uint32_t* uncompressed_size);
+
+// Uncompress a main message returned by ParseMessage() from a frame whose
+// header specified 'compression' and 'uncompressed_size'.
+// Out: 'buf' is populated with the uncompressed main message, and
+//      'main_message' is pointed at it.
+Status UncompressMessage(CompressionType compression,
+                         uint32_t uncompressed_size,
+                         faststring* buf,
+                         Slice* main_message);
+
 // Serialize the RPC connection header (magic number + flags).
 // buf must have 7 bytes available (kMagicNumberLength + kHeaderFlagsLength).
 void SerializeConnHeader(uint8_t* buf);
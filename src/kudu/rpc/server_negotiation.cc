@@ -17,6 +17,8 @@
 
 #include "kudu/rpc/server_negotiation.h"
 
+#include <sys/socket.h>
+
 #include <algorithm>
 #include <cstdint>
 #include <cstdlib>
@@ -72,6 +74,7 @@ DEFINE_double(rpc_inject_invalid_authn_token_ratio, 0,
 TAG_FLAG(rpc_inject_invalid_authn_token_ratio, runtime);
 TAG_FLAG(rpc_inject_invalid_authn_token_ratio, unsafe);
 
+DECLARE_bool(rpc_compress_loopback_connections);
 DECLARE_bool(rpc_encrypt_loopback_connections);
 
 DEFINE_string(trusted_subnets,
@@ -140,6 +143,7 @@ ServerNegotiation::ServerNegotiation(unique_ptr<Socket> socket,
       tls_context_(tls_context),
       encryption_(encryption),
       tls_negotiated_(false),
+      tls_session_reused_(false),
       token_verifier_(token_verifier),
       negotiated_authn_(AuthenticationType::INVALID),
       negotiated_mech_(SaslMechanism::INVALID),
@@ -507,6 +511,13 @@ Status ServerNegotiation::HandleNegotiate(const NegotiatePB& request) {
     }
   }
 
+  // Advertise the codecs we can uncompress; the client only compresses its
+  // requests with one of them if it's configured to do so.
+  if (!socket_->IsLoopbackConnection() || FLAGS_rpc_compress_loopback_connections) {
+    server_features_.insert(COMPRESSION_LZ4);
+    server_features_.insert(COMPRESSION_ZSTD);
+  }
+
   for (RpcFeatureFlag feature : server_features_) {
     response.add_supported_features(feature);
   }
@@ -570,6 +581,10 @@ Status ServerNegotiation::HandleTlsHandshake(const NegotiatePB& request) {
   RETURN_NOT_OK(s);
 
   // TLS handshake is finished.
+  tls_session_reused_ = tls_handshake_.session_reused();
+  if (tls_session_reused_) {
+    TRACE("Resumed TLS session");
+  }
   if (ContainsKey(server_features_, TLS_AUTHENTICATION_ONLY) &&
       ContainsKey(client_features_, TLS_AUTHENTICATION_ONLY)) {
     TRACE("Negotiated auth-only $0 with cipher $1",
@@ -963,6 +978,11 @@ int ServerNegotiation::PlainAuthCb(sasl_conn_t* /*conn*/,
 }
 
 bool ServerNegotiation::IsTrustedConnection(const Sockaddr& addr) {
+  // A UNIX domain socket can only be connected to from the local host.
+  if (addr.family() == AF_UNIX) {
+    return true;
+  }
+
   static std::once_flag once;
   std::call_once(once, [] {
     g_trusted_subnets = new vector<Network>();
@@ -95,6 +95,12 @@ class ServerNegotiation {
     return tls_negotiated_;
   }
 
+  // Returns true if the TLS handshake resumed a session previously established
+  // with the client. Must be called after Negotiate().
+  bool tls_session_reused() const {
+    return tls_session_reused_;
+  }
+
   // Returns the set of RPC system features supported by the remote client.
   // Must be called after Negotiate().
   std::set<RpcFeatureFlag> client_features() const {
@@ -229,6 +235,7 @@ class ServerNegotiation {
   security::TlsHandshake tls_handshake_;
   const RpcEncryption encryption_;
   bool tls_negotiated_;
+  bool tls_session_reused_;
 
   // TSK state.
   const security::TokenVerifier* token_verifier_;
@@ -52,6 +52,11 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // Whether the request and response are allocated on a per-call protobuf
+  // arena. Only set if both message types were generated with arena support,
+  // since other messages would still be allocated on the heap.
+  bool use_arena;
+
   // The authorization function for this RPC. If this function
   // returns false, the RPC has already been handled (i.e. rejected)
   // by the authorization function.
@@ -85,6 +90,13 @@ class ServiceIf {
     return nullptr;
   }
 
+  // Returns the histogram tracking the time this service's calls spend
+  // waiting in its worker queue, or nullptr if the service doesn't track
+  // it separately from the server-wide rpc_incoming_queue_time.
+  virtual Histogram* queue_time_histogram() const {
+    return nullptr;
+  }
+
   // Default authorization method, which just allows all RPCs.
   //
   // See docs/design-docs/rpc.md for details on how to add custom
@@ -114,6 +126,10 @@ class GeneratedServiceIf : public ServiceIf {
 
   RpcMethodInfo* LookupMethod(const RemoteMethod& method) override;
 
+  Histogram* queue_time_histogram() const override {
+    return queue_time_histogram_.get();
+  }
+
   // Returns the mapping from method names to method infos.
   typedef std::unordered_map<std::string, scoped_refptr<RpcMethodInfo>> MethodInfoMap;
   const MethodInfoMap& methods_by_name() const { return methods_by_name_; }
@@ -127,6 +143,10 @@ class GeneratedServiceIf : public ServiceIf {
 
   // The result tracker for this service's methods.
   scoped_refptr<ResultTracker> result_tracker_;
+
+  // Time spent by this service's calls in the worker queue. Set by the
+  // constructor of the generated subclass.
+  scoped_refptr<Histogram> queue_time_histogram_;
 };
 
 } // namespace rpc
@@ -17,28 +17,35 @@
 
 #include "kudu/rpc/service_pool.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/move.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/remote_method.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
+#include "kudu/rpc/remote_user.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
@@ -48,9 +55,40 @@
 
 using std::shared_ptr;
 using std::string;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(rpc_fair_service_queue, false,
+            "Whether RPC services queue inbound calls with weighted fair queuing "
+            "between flows, each flow being the calls of one user to one method, "
+            "rather than in earliest-deadline-first order. This keeps a client "
+            "flooding a service with calls from starving other clients and methods.");
+TAG_FLAG(rpc_fair_service_queue, advanced);
+TAG_FLAG(rpc_fair_service_queue, experimental);
+
+DEFINE_string(rpc_latency_critical_methods,
+              "UpdateConsensus,MultiRaftUpdateConsensus,RequestConsensusVote",
+              "Comma-separated names of the RPC methods whose calls are latency-critical. "
+              "With --rpc_fair_service_queue, their flows are weighted by "
+              "--rpc_latency_critical_method_weight and may use the workers reserved by "
+              "--rpc_reserved_latency_critical_workers.");
+TAG_FLAG(rpc_latency_critical_methods, advanced);
+TAG_FLAG(rpc_latency_critical_methods, experimental);
+
+DEFINE_int32(rpc_latency_critical_method_weight, 4,
+             "Weight of the flows of latency-critical calls in the fair service queue, "
+             "relative to a weight of 1 for other flows.");
+TAG_FLAG(rpc_latency_critical_method_weight, advanced);
+TAG_FLAG(rpc_latency_critical_method_weight, experimental);
+
+DEFINE_int32(rpc_reserved_latency_critical_workers, 1,
+             "Number of the workers of each RPC service which only handle latency-critical "
+             "calls when using the fair service queue. At least one worker is always left "
+             "for other calls.");
+TAG_FLAG(rpc_reserved_latency_critical_workers, advanced);
+TAG_FLAG(rpc_reserved_latency_critical_workers, experimental);
+
 METRIC_DEFINE_histogram(server, rpc_incoming_queue_time,
                         "RPC Queue Time",
                         kudu::MetricUnit::kMicroseconds,
@@ -72,15 +110,35 @@ METRIC_DEFINE_counter(server, rpcs_queue_overflow,
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+unordered_set<string> LatencyCriticalMethods() {
+  unordered_set<string> methods = strings::Split(FLAGS_rpc_latency_critical_methods, ",",
+                                                 strings::SkipEmpty());
+  return methods;
+}
+
+} // anonymous namespace
+
 ServicePool::ServicePool(gscoped_ptr<ServiceIf> service,
                          const scoped_refptr<MetricEntity>& entity,
                          size_t service_queue_length)
   : service_(std::move(service)),
-    service_queue_(service_queue_length),
+    latency_critical_methods_(LatencyCriticalMethods()),
+    fair_service_queue_(nullptr),
     incoming_queue_time_(METRIC_rpc_incoming_queue_time.Instantiate(entity)),
     rpcs_timed_out_in_queue_(METRIC_rpcs_timed_out_in_queue.Instantiate(entity)),
     rpcs_queue_overflow_(METRIC_rpcs_queue_overflow.Instantiate(entity)),
     closing_(false) {
+  if (FLAGS_rpc_fair_service_queue) {
+    fair_service_queue_ = new FairServiceQueue(
+        service_queue_length,
+        [this](const InboundCall* call) { return ClassifyCall(call); },
+        FLAGS_rpc_latency_critical_method_weight);
+    service_queue_.reset(fair_service_queue_);
+  } else {
+    service_queue_.reset(new LifoServiceQueue(service_queue_length));
+  }
 }
 
 ServicePool::~ServicePool() {
@@ -88,6 +146,10 @@ ServicePool::~ServicePool() {
 }
 
 Status ServicePool::Init(int num_threads) {
+  if (fair_service_queue_) {
+    fair_service_queue_->set_num_reserved_consumers(
+        std::max(0, std::min(FLAGS_rpc_reserved_latency_critical_workers, num_threads - 1)));
+  }
   for (int i = 0; i < num_threads; i++) {
     scoped_refptr<kudu::Thread> new_thread;
     CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
@@ -98,7 +160,7 @@ Status ServicePool::Init(int num_threads) {
 }
 
 void ServicePool::Shutdown() {
-  service_queue_.Shutdown();
+  service_queue_->Shutdown();
 
   MutexLock lock(shutdown_lock_);
   if (closing_) return;
@@ -111,7 +173,7 @@ void ServicePool::Shutdown() {
   // Now we must drain the service queue.
   Status status = Status::ServiceUnavailable("Service is shutting down");
   std::unique_ptr<InboundCall> incoming;
-  while (service_queue_.BlockingGet(&incoming)) {
+  while (service_queue_->BlockingGet(&incoming)) {
     incoming.release()->RespondFailure(ErrorStatusPB::FATAL_SERVER_SHUTTING_DOWN, status);
   }
 
@@ -125,13 +187,13 @@ void ServicePool::RejectTooBusy(InboundCall* c) {
                  c->remote_method().method_name(),
                  service_->service_name(),
                  c->remote_address().ToString(),
-                 service_queue_.max_size());
+                 service_queue_->max_size());
   rpcs_queue_overflow_->Increment();
   KLOG_EVERY_N_SECS(WARNING, 1) << err_msg;
   c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
                     Status::ServiceUnavailable(err_msg));
   DLOG(INFO) << err_msg << " Contents of service queue:\n"
-             << service_queue_.ToString();
+             << service_queue_->ToString();
 
   if (too_busy_hook_) {
     too_busy_hook_();
@@ -164,7 +226,7 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
 
   // Queue message on service queue
   boost::optional<InboundCall*> evicted;
-  auto queue_status = service_queue_.Put(c, &evicted);
+  auto queue_status = service_queue_->Put(c, &evicted);
   if (queue_status == QUEUE_FULL) {
     RejectTooBusy(c);
     return Status::OK();
@@ -195,12 +257,12 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
 void ServicePool::RunThread() {
   while (true) {
     std::unique_ptr<InboundCall> incoming;
-    if (!service_queue_.BlockingGet(&incoming)) {
+    if (!service_queue_->BlockingGet(&incoming)) {
       VLOG(1) << "ServicePool: messenger shutting down.";
       return;
     }
 
-    incoming->RecordHandlingStarted(incoming_queue_time_);
+    incoming->RecordHandlingStarted(incoming_queue_time_, service_->queue_time_histogram());
     ADOPT_TRACE(incoming->trace());
 
     if (PREDICT_FALSE(incoming->ClientTimedOut())) {
@@ -227,6 +289,12 @@ void ServicePool::RunThread() {
   }
 }
 
+FairServiceQueue::CallClass ServicePool::ClassifyCall(const InboundCall* call) const {
+  const string& method = call->remote_method().method_name();
+  return { Substitute("$0/$1", call->remote_user().username(), method),
+           ContainsKey(latency_critical_methods_, method) };
+}
+
 const string ServicePool::service_name() const {
   return service_->service_name();
 }
@@ -20,7 +20,9 @@
 
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -96,9 +98,16 @@ class ServicePool : public RpcService {
   void RunThread();
   void RejectTooBusy(InboundCall* c);
 
+  // Classifies 'call' for the fair service queue: calls of each user to each
+  // method form a flow. See --rpc_fair_service_queue.
+  FairServiceQueue::CallClass ClassifyCall(const InboundCall* call) const;
+
   gscoped_ptr<ServiceIf> service_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
-  LifoServiceQueue service_queue_;
+  const std::unordered_set<std::string> latency_critical_methods_;
+  std::unique_ptr<ServiceQueue> service_queue_;
+  // Set if 'service_queue_' is a fair queue.
+  FairServiceQueue* fair_service_queue_;
   scoped_refptr<Histogram> incoming_queue_time_;
   scoped_refptr<Counter> rpcs_timed_out_in_queue_;
   scoped_refptr<Counter> rpcs_queue_overflow_;
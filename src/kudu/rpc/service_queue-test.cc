@@ -21,6 +21,7 @@
 #include <ostream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -29,11 +30,14 @@
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/basictypes.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
@@ -147,5 +151,125 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+// Tests the dequeuing order, eviction and worker reservation of FairServiceQueue.
+class FairServiceQueueTest : public KuduTest {
+ protected:
+  // Returns a new call in the given flow.
+  InboundCall* NewCall(const string& flow, bool latency_critical = false) {
+    calls_.emplace_back(new InboundCall(nullptr));
+    InboundCall* call = calls_.back().get();
+    classes_[call] = { flow, latency_critical };
+    return call;
+  }
+
+  FairServiceQueue::Classifier classifier() {
+    return [this](const InboundCall* call) { return FindOrDie(classes_, call); };
+  }
+
+  // Dequeues a call from 'queue' and returns its flow.
+  string GetFlow(FairServiceQueue* queue) {
+    unique_ptr<InboundCall> call;
+    CHECK(queue->BlockingGet(&call));
+    // The call is owned by 'calls_'.
+    return FindOrDie(classes_, call.release()).flow;
+  }
+
+  vector<unique_ptr<InboundCall>> calls_;
+  std::unordered_map<const InboundCall*, FairServiceQueue::CallClass> classes_;
+};
+
+TEST_F(FairServiceQueueTest, TestFairOrder) {
+  FairServiceQueue queue(100, classifier(), 4);
+  boost::optional<InboundCall*> evicted;
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("flood"), &evicted));
+  }
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("interactive"), &evicted));
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("interactive"), &evicted));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("consensus", true), &evicted));
+  }
+  ASSERT_FALSE(evicted);
+  ASSERT_EQ(14, queue.estimated_queue_length());
+
+  // The latency-critical flow has a weight of 4, so its first three calls
+  // come before anything else.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ("consensus", GetFlow(&queue));
+  }
+  // The interactive calls don't wait for the flood to drain.
+  int interactive_seen = 0;
+  for (int i = 0; i < 6; i++) {
+    if (GetFlow(&queue) == "interactive") {
+      interactive_seen++;
+    }
+  }
+  ASSERT_EQ(2, interactive_seen);
+  while (!queue.empty()) {
+    GetFlow(&queue);
+  }
+  queue.Shutdown();
+}
+
+TEST_F(FairServiceQueueTest, TestEvictLongestFlow) {
+  FairServiceQueue queue(4, classifier(), 4);
+  boost::optional<InboundCall*> evicted;
+  vector<InboundCall*> flood;
+  for (int i = 0; i < 4; i++) {
+    flood.push_back(NewCall("flood"));
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(flood.back(), &evicted));
+  }
+  // A call of another flow bumps the newest call of the flood...
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("interactive"), &evicted));
+  ASSERT_EQ(flood.back(), evicted.get());
+  // ... while more calls of the flood are rejected.
+  evicted = boost::none;
+  ASSERT_EQ(QUEUE_FULL, queue.Put(NewCall("flood"), &evicted));
+  ASSERT_FALSE(evicted);
+
+  queue.Shutdown();
+  unique_ptr<InboundCall> call;
+  int drained = 0;
+  while (queue.BlockingGet(&call)) {
+    ignore_result(call.release());
+    drained++;
+  }
+  ASSERT_EQ(4, drained);
+}
+
+TEST_F(FairServiceQueueTest, TestReservedConsumers) {
+  FairServiceQueue queue(100, classifier(), 4);
+  queue.set_num_reserved_consumers(1);
+
+  // The first consumer is reserved for latency-critical calls.
+  std::atomic<int> reserved_got(0);
+  std::thread reserved([&]() {
+    unique_ptr<InboundCall> call;
+    while (queue.BlockingGet(&call)) {
+      ignore_result(call.release());
+      reserved_got++;
+    }
+  });
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(1, queue.estimated_idle_worker_count());
+  });
+
+  boost::optional<InboundCall*> evicted;
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("scan"), &evicted));
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(0, reserved_got);
+  ASSERT_EQ(1, queue.estimated_queue_length());
+
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(NewCall("consensus", true), &evicted));
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(1, reserved_got);
+  });
+
+  // Other consumers get the remaining calls.
+  ASSERT_EQ("scan", GetFlow(&queue));
+  queue.Shutdown();
+  reserved.join();
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -17,12 +17,16 @@
 
 #include "kudu/rpc/service_queue.h"
 
+#include <algorithm>
 #include <mutex>
 #include <ostream>
+#include <tuple>
+#include <utility>
 
 #include <boost/optional/optional.hpp>
 
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 
 namespace kudu {
 namespace rpc {
@@ -141,5 +145,203 @@ std::string LifoServiceQueue::ToString() const {
   return ret;
 }
 
+__thread const FairServiceQueue* FairServiceQueue::tl_bound_queue_ = nullptr;
+__thread bool FairServiceQueue::tl_reserved_ = false;
+
+FairServiceQueue::FairServiceQueue(int max_size,
+                                   Classifier classifier,
+                                   int latency_critical_weight)
+    : max_queue_size_(max_size),
+      classifier_(std::move(classifier)),
+      latency_critical_weight_(std::max(1, latency_critical_weight)),
+      cond_(&lock_),
+      reserved_cond_(&lock_),
+      shutdown_(false),
+      num_reserved_consumers_(0),
+      num_reserved_claimed_(0),
+      num_waiting_(0),
+      num_reserved_waiting_(0),
+      size_(0),
+      virtual_time_(0) {
+  CHECK_GT(max_queue_size_, 0);
+}
+
+FairServiceQueue::~FairServiceQueue() {
+  DCHECK_EQ(0, size_)
+      << "ServiceQueue holds bare pointers at destruction time";
+}
+
+void FairServiceQueue::set_num_reserved_consumers(int num_reserved_consumers) {
+  MutexLock l(lock_);
+  DCHECK_EQ(0, num_reserved_claimed_);
+  num_reserved_consumers_ = num_reserved_consumers;
+}
+
+bool FairServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
+  MutexLock l(lock_);
+  if (PREDICT_FALSE(tl_bound_queue_ != this)) {
+    tl_bound_queue_ = this;
+    tl_reserved_ = num_reserved_claimed_ < num_reserved_consumers_;
+    if (tl_reserved_) {
+      num_reserved_claimed_++;
+    }
+  }
+  while (true) {
+    // Once shut down, any consumer helps draining the queue.
+    InboundCall* call = PopUnlocked(tl_reserved_ && !shutdown_);
+    if (call != nullptr) {
+      out->reset(call);
+      return true;
+    }
+    if (PREDICT_FALSE(shutdown_)) {
+      return false;
+    }
+    if (tl_reserved_) {
+      num_reserved_waiting_++;
+      reserved_cond_.Wait();
+      num_reserved_waiting_--;
+    } else {
+      num_waiting_++;
+      cond_.Wait();
+      num_waiting_--;
+    }
+  }
+}
+
+QueueStatus FairServiceQueue::Put(InboundCall* call,
+                                  boost::optional<InboundCall*>* evicted) {
+  CallClass call_class = classifier_(call);
+
+  MutexLock l(lock_);
+  if (PREDICT_FALSE(shutdown_)) {
+    return QUEUE_SHUTDOWN;
+  }
+
+  std::unique_ptr<Flow>& flow_ptr = flows_[call_class.flow];
+  if (!flow_ptr) {
+    flow_ptr.reset(new Flow);
+    flow_ptr->key = call_class.flow;
+    flow_ptr->latency_critical = call_class.latency_critical;
+    flow_ptr->weight = call_class.latency_critical ? latency_critical_weight_ : 1;
+  }
+  Flow* flow = flow_ptr.get();
+
+  if (PREDICT_FALSE(size_ >= max_queue_size_)) {
+    // Find the longest flow to evict a call from.
+    Flow* longest = nullptr;
+    for (const auto& e : flows_) {
+      if (!longest || e.second->calls.size() > longest->calls.size()) {
+        longest = e.second.get();
+      }
+    }
+    if (longest->calls.size() <= flow->calls.size()) {
+      if (flow->calls.empty()) {
+        flows_.erase(call_class.flow);
+      }
+      return QUEUE_FULL;
+    }
+    *evicted = longest->calls.back().second;
+    if (longest->calls.size() == 1) {
+      RemoveHeadUnlocked(longest);
+      flows_.erase(flows_.find(longest->key));
+    } else {
+      longest->calls.pop_back();
+    }
+    size_--;
+  }
+
+  const double start = flow->calls.empty() ?
+      virtual_time_ : std::max(virtual_time_, flow->calls.back().first);
+  const double finish = start + 1.0 / flow->weight;
+  if (flow->calls.empty()) {
+    flow->calls.emplace_back(finish, call);
+    AddHeadUnlocked(flow);
+  } else {
+    flow->calls.emplace_back(finish, call);
+  }
+  size_++;
+
+  if (call_class.latency_critical && num_reserved_waiting_ > 0) {
+    reserved_cond_.Signal();
+  } else {
+    cond_.Signal();
+  }
+  return QUEUE_SUCCESS;
+}
+
+void FairServiceQueue::Shutdown() {
+  MutexLock l(lock_);
+  shutdown_ = true;
+  cond_.Broadcast();
+  reserved_cond_.Broadcast();
+}
+
+bool FairServiceQueue::empty() const {
+  MutexLock l(lock_);
+  return size_ == 0;
+}
+
+int FairServiceQueue::max_size() const {
+  return max_queue_size_;
+}
+
+std::string FairServiceQueue::ToString() const {
+  std::string ret;
+
+  MutexLock l(lock_);
+  for (const auto& e : flows_) {
+    ret.append(strings::Substitute("flow $0 ($1 calls):\n", e.first, e.second->calls.size()));
+    for (const auto& tagged_call : e.second->calls) {
+      ret.append(tagged_call.second->ToString());
+      ret.append("\n");
+    }
+  }
+  return ret;
+}
+
+void FairServiceQueue::AddHeadUnlocked(Flow* flow) {
+  lock_.AssertAcquired();
+  DCHECK(!flow->calls.empty());
+  const auto head = std::make_pair(flow->calls.front().first, flow);
+  heads_.insert(head);
+  if (flow->latency_critical) {
+    latency_critical_heads_.insert(head);
+  }
+}
+
+void FairServiceQueue::RemoveHeadUnlocked(Flow* flow) {
+  lock_.AssertAcquired();
+  DCHECK(!flow->calls.empty());
+  const auto head = std::make_pair(flow->calls.front().first, flow);
+  heads_.erase(head);
+  if (flow->latency_critical) {
+    latency_critical_heads_.erase(head);
+  }
+}
+
+InboundCall* FairServiceQueue::PopUnlocked(bool latency_critical_only) {
+  lock_.AssertAcquired();
+  const FlowHeads& heads = latency_critical_only ? latency_critical_heads_ : heads_;
+  if (heads.empty()) {
+    return nullptr;
+  }
+  Flow* flow = heads.begin()->second;
+  RemoveHeadUnlocked(flow);
+  double finish;
+  InboundCall* call;
+  std::tie(finish, call) = flow->calls.front();
+  flow->calls.pop_front();
+  size_--;
+  virtual_time_ = std::max(virtual_time_, finish);
+  if (flow->calls.empty()) {
+    // Idle flows are forgotten; when calls arrive again, they start from the
+    // current virtual time.
+    flows_.erase(flows_.find(flow->key));
+  } else {
+    AddHeadUnlocked(flow);
+  }
+  return call;
+}
+
 } // namespace rpc
 } // namespace kudu
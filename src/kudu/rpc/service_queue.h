@@ -17,9 +17,13 @@
 #ifndef KUDU_UTIL_SERVICE_QUEUE_H
 #define KUDU_UTIL_SERVICE_QUEUE_H
 
+#include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -47,6 +51,48 @@ enum QueueStatus {
   QUEUE_FULL = 2
 };
 
+// Interface of the blocking queues used for passing inbound RPC calls to the
+// service handler pool.
+class ServiceQueue {
+ public:
+  virtual ~ServiceQueue() {}
+
+  // Get an element from the queue.  Returns false if we were shut down prior to
+  // getting the element.
+  virtual bool BlockingGet(std::unique_ptr<InboundCall>* out) = 0;
+
+  // Add a new call to the queue.
+  // Returns:
+  // - QUEUE_SHUTDOWN if Shutdown() has already been called.
+  // - QUEUE_FULL if the queue is full and 'call' may not evict any call
+  //   already in the queue.
+  // - QUEUE_SUCCESS if 'call' was enqueued.
+  //
+  // In the case of a 'QUEUE_SUCCESS' response, the new element may have bumped
+  // another call out of the queue. In that case, *evicted will be set to the
+  // call that was bumped.
+  virtual QueueStatus Put(InboundCall* call, boost::optional<InboundCall*>* evicted) = 0;
+
+  // Shut down the queue.
+  // When a blocking queue is shut down, no more elements can be added to it,
+  // and Put() will return QUEUE_SHUTDOWN.
+  // Existing elements will drain out of it, and then BlockingGet will start
+  // returning false.
+  virtual void Shutdown() = 0;
+
+  virtual bool empty() const = 0;
+
+  virtual int max_size() const = 0;
+
+  virtual std::string ToString() const = 0;
+
+  // Return an estimate of the current queue length.
+  virtual int estimated_queue_length() const = 0;
+
+  // Return an estimate of the number of idle threads currently awaiting work.
+  virtual int estimated_idle_worker_count() const = 0;
+};
+
 // Blocking queue used for passing inbound RPC calls to the service handler pool.
 // Calls are dequeued in 'earliest-deadline first' order. The queue also maintains a
 // bounded number of calls. If the queue overflows, then calls with deadlines farthest
@@ -75,43 +121,27 @@ enum QueueStatus {
 // NOTE: because of the use of thread-local consumer records, once a consumer
 // thread accesses one LifoServiceQueue, it becomes "bound" to that queue and
 // must never access any other instance.
-class LifoServiceQueue {
+class LifoServiceQueue final : public ServiceQueue {
  public:
   explicit LifoServiceQueue(int max_size);
 
   ~LifoServiceQueue();
 
-  // Get an element from the queue.  Returns false if we were shut down prior to
-  // getting the element.
-  bool BlockingGet(std::unique_ptr<InboundCall>* out);
+  bool BlockingGet(std::unique_ptr<InboundCall>* out) override;
 
-  // Add a new call to the queue.
-  // Returns:
-  // - QUEUE_SHUTDOWN if Shutdown() has already been called.
-  // - QUEUE_FULL if the queue is full and 'call' has a later deadline than any
-  //   RPC already in the queue.
-  // - QUEUE_SUCCESS if 'call' was enqueued.
-  //
-  // In the case of a 'QUEUE_SUCCESS' response, the new element may have bumped
-  // another call out of the queue. In that case, *evicted will be set to the
-  // call that was bumped.
-  QueueStatus Put(InboundCall* call, boost::optional<InboundCall*>* evicted);
+  // QUEUE_FULL is returned if the queue is full and 'call' has a later
+  // deadline than any RPC already in the queue.
+  QueueStatus Put(InboundCall* call, boost::optional<InboundCall*>* evicted) override;
 
-  // Shut down the queue.
-  // When a blocking queue is shut down, no more elements can be added to it,
-  // and Put() will return QUEUE_SHUTDOWN.
-  // Existing elements will drain out of it, and then BlockingGet will start
-  // returning false.
-  void Shutdown();
+  void Shutdown() override;
 
-  bool empty() const;
+  bool empty() const override;
 
-  int max_size() const;
+  int max_size() const override;
 
-  std::string ToString() const;
+  std::string ToString() const override;
 
-  // Return an estimate of the current queue length.
-  int estimated_queue_length() const {
+  int estimated_queue_length() const override {
     ANNOTATE_IGNORE_READS_BEGIN();
     // The C++ standard says that std::multiset::size must be constant time,
     // so this method won't try to traverse any actual nodes of the underlying
@@ -122,8 +152,7 @@ class LifoServiceQueue {
     return ret;
   }
 
-  // Return an estimate of the number of idle threads currently awaiting work.
-  int estimated_idle_worker_count() const {
+  int estimated_idle_worker_count() const override {
     ANNOTATE_IGNORE_READS_BEGIN();
     // Size of a vector is a simple field access so this is safe.
     int ret = waiting_consumers_.size();
@@ -219,6 +248,126 @@ class LifoServiceQueue {
   DISALLOW_COPY_AND_ASSIGN(LifoServiceQueue);
 };
 
+// Blocking queue which shares the service handler pool fairly between flows of
+// calls, so that a client flooding the service with one kind of call doesn't
+// starve other clients or other kinds of calls.
+//
+// Each call belongs to a flow, e.g. the calls of one user to one method, as
+// determined by a classifier function. Calls are dequeued in weighted fair
+// queuing order: each call is tagged with a virtual finish time which grows by
+// 1/weight with every call queued in its flow, and the call with the earliest
+// tag is dequeued first. Flows of latency-critical calls get a higher weight.
+// Within a flow, calls are dequeued in arrival order.
+//
+// When the queue is full, the newest call of the longest flow is evicted,
+// unless the flow of the new call is at least as long, in which case the new
+// call is rejected. Thus a flood of calls doesn't push out other flows' calls.
+//
+// A number of consumer threads may be reserved for latency-critical calls: the
+// first consumer threads to call BlockingGet() only dequeue latency-critical
+// calls, so that those always find a worker even when the others are all busy.
+class FairServiceQueue final : public ServiceQueue {
+ public:
+  // The class of a call.
+  struct CallClass {
+    // The flow the call belongs to.
+    std::string flow;
+    // Whether the call is latency-critical.
+    bool latency_critical;
+  };
+  typedef std::function<CallClass(const InboundCall*)> Classifier;
+
+  // 'latency_critical_weight' is the weight of flows of latency-critical
+  // calls, relative to a weight of 1 for other flows.
+  FairServiceQueue(int max_size, Classifier classifier, int latency_critical_weight);
+
+  ~FairServiceQueue();
+
+  // Sets the number of consumer threads reserved for latency-critical calls.
+  // Must be called before any consumer calls BlockingGet().
+  void set_num_reserved_consumers(int num_reserved_consumers);
+
+  bool BlockingGet(std::unique_ptr<InboundCall>* out) override;
+
+  QueueStatus Put(InboundCall* call, boost::optional<InboundCall*>* evicted) override;
+
+  void Shutdown() override;
+
+  bool empty() const override;
+
+  int max_size() const override;
+
+  std::string ToString() const override;
+
+  int estimated_queue_length() const override {
+    ANNOTATE_IGNORE_READS_BEGIN();
+    int ret = size_;
+    ANNOTATE_IGNORE_READS_END();
+    return ret;
+  }
+
+  int estimated_idle_worker_count() const override {
+    ANNOTATE_IGNORE_READS_BEGIN();
+    int ret = num_waiting_ + num_reserved_waiting_;
+    ANNOTATE_IGNORE_READS_END();
+    return ret;
+  }
+
+ private:
+  struct Flow {
+    std::string key;
+    bool latency_critical;
+    double weight;
+    // The queued calls of the flow and their virtual finish times, in
+    // arrival order.
+    std::deque<std::pair<double, InboundCall*>> calls;
+  };
+
+  // Flows with queued calls, ordered by the virtual finish time of their
+  // first call.
+  typedef std::set<std::pair<double, Flow*>> FlowHeads;
+
+  // Adds or removes 'flow' to or from the flow heads, based on its first call.
+  void AddHeadUnlocked(Flow* flow);
+  void RemoveHeadUnlocked(Flow* flow);
+
+  // Dequeues the call with the earliest virtual finish time, among
+  // latency-critical calls only if 'latency_critical_only' is true. Returns
+  // nullptr if there is no such call.
+  InboundCall* PopUnlocked(bool latency_critical_only);
+
+  // Thread-local reservation state of consumer threads.
+  static __thread const FairServiceQueue* tl_bound_queue_;
+  static __thread bool tl_reserved_;
+
+  const int max_queue_size_;
+  const Classifier classifier_;
+  const int latency_critical_weight_;
+
+  mutable Mutex lock_;
+  // Signaled when a call is queued, for non-reserved and reserved consumers.
+  ConditionVariable cond_;
+  ConditionVariable reserved_cond_;
+  bool shutdown_;
+
+  int num_reserved_consumers_;
+  int num_reserved_claimed_;
+  int num_waiting_;
+  int num_reserved_waiting_;
+
+  // The total number of queued calls.
+  int size_;
+
+  // The virtual finish time of the last dequeued call.
+  double virtual_time_;
+
+  std::unordered_map<std::string, std::unique_ptr<Flow>> flows_;
+  FlowHeads heads_;
+  FlowHeads latency_critical_heads_;
+
+  DISALLOW_COPY_AND_ASSIGN(FairServiceQueue);
+};
+
 } // namespace rpc
 } // namespace kudu
 
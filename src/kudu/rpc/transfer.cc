@@ -20,6 +20,7 @@
 #include <sys/uio.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
 #include <iostream>
 #include <limits>
@@ -171,7 +172,10 @@ OutboundTransfer::OutboundTransfer(int32_t call_id,
     callbacks_(callbacks),
     call_id_(call_id),
     started_(false),
-    aborted_(false) {
+    aborted_(false),
+    zero_copy_(false),
+    num_zero_copy_sends_(0),
+    awaiting_zero_copy_completion_(false) {
 
   n_payload_slices_ = n_payload_slices;
   CHECK_LE(n_payload_slices_, payload_slices_.size());
@@ -181,7 +185,7 @@ OutboundTransfer::OutboundTransfer(int32_t call_id,
 }
 
 OutboundTransfer::~OutboundTransfer() {
-  if (!TransferFinished() && !aborted_) {
+  if ((!TransferFinished() || awaiting_zero_copy_completion_) && !aborted_) {
     callbacks_->NotifyTransferAborted(
       Status::RuntimeError("RPC transfer destroyed before it finished sending"));
   }
@@ -189,59 +193,123 @@ OutboundTransfer::~OutboundTransfer() {
 
 void OutboundTransfer::Abort(const Status &status) {
   CHECK(!aborted_) << "Already aborted";
-  CHECK(!TransferFinished()) << "Cannot abort a finished transfer";
+  CHECK(!TransferFinished() || awaiting_zero_copy_completion_)
+      << "Cannot abort a finished transfer";
   callbacks_->NotifyTransferAborted(status);
   aborted_ = true;
 }
 
+void OutboundTransfer::NotifyZeroCopyCompleted() {
+  CHECK(awaiting_zero_copy_completion_);
+  awaiting_zero_copy_completion_ = false;
+  callbacks_->NotifyTransferFinished();
+}
+
 Status OutboundTransfer::SendBuffer(Socket &socket) {
   CHECK_LT(cur_slice_idx_, n_payload_slices_);
 
-  started_ = true;
-  int n_iovecs = n_payload_slices_ - cur_slice_idx_;
+  int n_iovecs = num_unsent_slices();
   struct iovec iovec[n_iovecs];
-  {
-    int offset_in_slice = cur_offset_in_slice_;
-    for (int i = 0; i < n_iovecs; i++) {
-      Slice &slice = payload_slices_[cur_slice_idx_ + i];
-      iovec[i].iov_base = slice.mutable_data() + offset_in_slice;
-      iovec[i].iov_len = slice.size() - offset_in_slice;
-
-      offset_in_slice = 0;
+  FillIovecs(iovec);
+
+  int64_t written;
+  Status status;
+  if (zero_copy_) {
+    status = socket.WritevZeroCopy(iovec, n_iovecs, &written);
+    if (status.ok() && written > 0) {
+      num_zero_copy_sends_++;
+    } else if (status.posix_code() == ENOBUFS) {
+      // The kernel ran out of memory for pinning our pages. This is only
+      // temporary, so send this part of the payload the regular way.
+      status = socket.Writev(iovec, n_iovecs, &written);
     }
+  } else {
+    status = socket.Writev(iovec, n_iovecs, &written);
+  }
+  RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
+
+  Advance(&written);
+  return Status::OK();
+}
+
+Status OutboundTransfer::SendBuffers(Socket &socket,
+                                     OutboundTransfer* const* transfers,
+                                     int n_transfers) {
+  DCHECK_GT(n_transfers, 0);
+  int n_iovecs = 0;
+  for (int i = 0; i < n_transfers; i++) {
+    DCHECK(!transfers[i]->zero_copy_);
+    CHECK_LT(transfers[i]->cur_slice_idx_, transfers[i]->n_payload_slices_);
+    n_iovecs += transfers[i]->num_unsent_slices();
+  }
+  struct iovec iovec[n_iovecs];
+  int filled = 0;
+  for (int i = 0; i < n_transfers; i++) {
+    filled += transfers[i]->FillIovecs(iovec + filled);
   }
+  DCHECK_EQ(n_iovecs, filled);
 
   int64_t written;
   Status status = socket.Writev(iovec, n_iovecs, &written);
   RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
 
+  // Hand the written bytes to the transfers in order. Only the last transfer
+  // to get any bytes may be left partially written.
+  for (int i = 0; i < n_transfers; i++) {
+    transfers[i]->Advance(&written);
+    if (!transfers[i]->TransferFinished()) {
+      DCHECK_EQ(0, written);
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+int OutboundTransfer::FillIovecs(struct iovec* iov) {
+  started_ = true;
+  int n_iovecs = num_unsent_slices();
+  int offset_in_slice = cur_offset_in_slice_;
+  for (int i = 0; i < n_iovecs; i++) {
+    Slice &slice = payload_slices_[cur_slice_idx_ + i];
+    iov[i].iov_base = slice.mutable_data() + offset_in_slice;
+    iov[i].iov_len = slice.size() - offset_in_slice;
+
+    offset_in_slice = 0;
+  }
+  return n_iovecs;
+}
+
+void OutboundTransfer::Advance(int64_t* written) {
   // Adjust our accounting of current writer position.
   for (int i = cur_slice_idx_; i < n_payload_slices_; i++) {
     Slice &slice = payload_slices_[i];
     int rem_in_slice = slice.size() - cur_offset_in_slice_;
     DCHECK_GE(rem_in_slice, 0);
 
-    if (written >= rem_in_slice) {
+    if (*written >= rem_in_slice) {
       // Used up this entire slice, advance to the next slice.
       cur_slice_idx_++;
       cur_offset_in_slice_ = 0;
-      written -= rem_in_slice;
+      *written -= rem_in_slice;
     } else {
       // Partially used up this slice, just advance the offset within it.
-      cur_offset_in_slice_ += written;
+      cur_offset_in_slice_ += *written;
+      *written = 0;
       break;
     }
   }
 
   if (cur_slice_idx_ == n_payload_slices_) {
-    callbacks_->NotifyTransferFinished();
+    if (num_zero_copy_sends_ > 0) {
+      awaiting_zero_copy_completion_ = true;
+    } else {
+      callbacks_->NotifyTransferFinished();
+    }
     DCHECK_EQ(0, cur_offset_in_slice_);
   } else {
     DCHECK_LT(cur_slice_idx_, n_payload_slices_);
     DCHECK_LT(cur_offset_in_slice_, payload_slices_[cur_slice_idx_].size());
   }
-
-  return Status::OK();
 }
 
 bool OutboundTransfer::TransferStarted() const {
@@ -36,6 +36,8 @@
 
 DECLARE_int64(rpc_max_message_size);
 
+struct iovec;
+
 namespace kudu {
 
 class Socket;
@@ -141,6 +143,19 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // send from our buffers into the sock
   Status SendBuffer(Socket &socket);
 
+  // Sends the unsent parts of 'transfers', in order, with a single write to
+  // the socket, so that several small transfers cost one syscall. Each
+  // transfer is advanced by the bytes written for it, and notifies its
+  // callbacks if it finishes. None of the transfers may be zero-copy.
+  static Status SendBuffers(Socket &socket,
+                            OutboundTransfer* const* transfers,
+                            int n_transfers);
+
+  // Returns the number of payload slices which are not fully sent yet.
+  int num_unsent_slices() const {
+    return n_payload_slices_ - cur_slice_idx_;
+  }
+
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
 
@@ -163,12 +178,47 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
     return call_id_;
   }
 
+  // Makes SendBuffer() write the payload with Socket::WritevZeroCopy().
+  // The kernel may then still be reading from the payload after the last
+  // byte has been written, so the callbacks aren't notified when the
+  // transfer finishes, but when NotifyZeroCopyCompleted() is called.
+  //
+  // Must be called before the transfer has started.
+  void set_zero_copy() {
+    DCHECK(!started_);
+    zero_copy_ = true;
+  }
+
+  bool zero_copy() const {
+    return zero_copy_;
+  }
+
+  // Returns the number of zero-copy sends that SendBuffer() has issued for
+  // this transfer so far.
+  int64_t num_zero_copy_sends() const {
+    return num_zero_copy_sends_;
+  }
+
+  // Notifies the callbacks that a finished zero-copy transfer is done with its
+  // payload, once the kernel has completed all of its zero-copy sends.
+  void NotifyZeroCopyCompleted();
+
  private:
   OutboundTransfer(int32_t call_id,
                    const TransferPayload& payload,
                    size_t n_payload_slices,
                    TransferCallbacks *callbacks);
 
+  // Fills 'iov' with the unsent part of the payload and marks the transfer
+  // as started. 'iov' must have room for num_unsent_slices() entries.
+  // Returns the number of entries filled.
+  int FillIovecs(struct iovec* iov);
+
+  // Advances the transfer by up to '*written' bytes, subtracting the bytes
+  // consumed from '*written'. Notifies the callbacks if this finishes the
+  // transfer.
+  void Advance(int64_t* written);
+
   // Slices to send. Uses an array here instead of a vector to avoid an expensive
   // vector construction (improved performance a couple percent).
   TransferPayload payload_slices_;
@@ -192,6 +242,14 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
 
   bool aborted_;
 
+  // See set_zero_copy().
+  bool zero_copy_;
+  int64_t num_zero_copy_sends_;
+
+  // True if this is a zero-copy transfer that has finished, but whose
+  // callbacks have not been notified yet.
+  bool awaiting_zero_copy_completion_;
+
   DISALLOW_COPY_AND_ASSIGN(OutboundTransfer);
 };
 
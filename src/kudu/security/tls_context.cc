@@ -18,6 +18,7 @@
 #include "kudu/security/tls_context.h"
 
 #include <algorithm>
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
@@ -27,12 +28,14 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <openssl/err.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/ca/cert_management.h"
 #include "kudu/security/cert.h"
@@ -68,7 +71,16 @@
 #define TLS1_2_VERSION 0x0303
 #endif
 
+// The size of the session ticket keys, ie the key name, the HMAC key and the
+// AES key, which grew in OpenSSL 1.1.1.
+#if OPENSSL_VERSION_NUMBER < 0x10101000L
+#define KUDU_TLS_TICKET_KEYS_SIZE 48
+#else
+#define KUDU_TLS_TICKET_KEYS_SIZE 80
+#endif
+
 using strings::Substitute;
+using std::lock_guard;
 using std::string;
 using std::unique_lock;
 using std::vector;
@@ -78,6 +90,18 @@ DEFINE_int32(ipki_server_key_size, 2048,
              "is used for TLS connections to and from clients and other servers.");
 TAG_FLAG(ipki_server_key_size, experimental);
 
+DEFINE_int32(rpc_tls_session_cache_size, 1024,
+             "The maximum number of TLS sessions a client caches for resuming "
+             "them when it reconnects to the same servers, saving the cost of "
+             "full TLS handshakes. 0 disables TLS session resumption on the "
+             "client side.");
+TAG_FLAG(rpc_tls_session_cache_size, advanced);
+
+DEFINE_int32(rpc_tls_session_timeout_secs, 3600,
+             "The lifetime of the TLS sessions issued by a server, after which "
+             "clients must go through a full TLS handshake again.");
+TAG_FLAG(rpc_tls_session_timeout_secs, advanced);
+
 namespace kudu {
 namespace security {
 
@@ -89,6 +113,28 @@ template<> struct SslTypeTraits<SSL> {
 template<> struct SslTypeTraits<X509_STORE_CTX> {
   static constexpr auto kFreeFunc = &X509_STORE_CTX_free;
 };
+template<> struct SslTypeTraits<SSL_SESSION> {
+  static constexpr auto kFreeFunc = &SSL_SESSION_free;
+};
+
+namespace {
+
+// The context within which the sessions of this process may be resumed.
+const unsigned char kSessionIdContext[] = "kudu";
+
+void FreeSessionKey(void* /*parent*/, void* ptr, CRYPTO_EX_DATA* /*ad*/,
+                    int /*idx*/, long /*argl*/, void* /*argp*/) { // NOLINT(*)
+  delete static_cast<string*>(ptr);
+}
+
+// Returns the index of the ex_data slot of the SSL handles of client
+// handshakes which holds their session key.
+int SessionKeyIndex() {
+  static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, &FreeSessionKey);
+  return index;
+}
+
+} // anonymous namespace
 
 TlsContext::TlsContext()
     : tls_ciphers_(kudu::security::SecurityDefaults::kDefaultTlsCiphers),
@@ -164,6 +210,18 @@ Status TlsContext::Init() {
       SSL_CTX_set_cipher_list(ctx_.get(), tls_ciphers_.c_str()),
       "failed to set TLS ciphers");
 
+  // Resume sessions using session tickets: servers keep no per-session state,
+  // and clients hand the sessions they establish to NewSessionCallback(),
+  // which caches them for InitiateHandshake() to look up.
+  SSL_CTX_set_app_data(ctx_.get(), this);
+  SSL_CTX_set_session_cache_mode(ctx_.get(),
+                                 SSL_SESS_CACHE_BOTH | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx_.get(), &TlsContext::NewSessionCallback);
+  SSL_CTX_set_timeout(ctx_.get(), FLAGS_rpc_tls_session_timeout_secs);
+  OPENSSL_RET_NOT_OK(
+      SSL_CTX_set_session_id_context(ctx_.get(), kSessionIdContext, sizeof(kSessionIdContext)),
+      "failed to set TLS session id context");
+
   // Enable ECDH curves. For OpenSSL 1.1.0 and up, this is done automatically.
 #ifndef OPENSSL_NO_ECDH
 #if OPENSSL_VERSION_NUMBER < 0x10002000L
@@ -239,10 +297,67 @@ Status TlsContext::UseCertificateAndKey(const Cert& cert, const PrivateKey& key)
                      "failed to use private key");
   OPENSSL_RET_NOT_OK(SSL_CTX_use_certificate(ctx_.get(), cert.GetTopOfChainX509()),
                      "failed to use certificate");
+  RETURN_NOT_OK(InvalidateSessionsUnlocked());
   has_cert_ = true;
   return Status::OK();
 }
 
+Status TlsContext::InvalidateSessionsUnlocked() {
+  SCOPED_OPENSSL_NO_PENDING_ERRORS;
+  unsigned char keys[KUDU_TLS_TICKET_KEYS_SIZE];
+  OPENSSL_RET_NOT_OK(RAND_bytes(keys, sizeof(keys)),
+                     "failed to generate TLS session ticket keys");
+  OPENSSL_RET_NOT_OK(SSL_CTX_set_tlsext_ticket_keys(ctx_.get(), keys, sizeof(keys)),
+                     "failed to set TLS session ticket keys");
+  lock_guard<simple_spinlock> l(session_cache_lock_);
+  session_cache_.clear();
+  return Status::OK();
+}
+
+int TlsContext::NewSessionCallback(SSL* ssl, SSL_SESSION* session) {
+  const auto* key = static_cast<const string*>(SSL_get_ex_data(ssl, SessionKeyIndex()));
+  if (!key) {
+    // A server-side session, or a client-side one which isn't to be resumed.
+    return 0;
+  }
+  auto* context = static_cast<TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  const size_t max_size = FLAGS_rpc_tls_session_cache_size;
+  lock_guard<simple_spinlock> l(context->session_cache_lock_);
+  if (!ContainsKey(context->session_cache_, *key)) {
+    if (max_size == 0) {
+      return 0;
+    }
+    if (context->session_cache_.size() >= max_size) {
+      // Evicting an arbitrary session is good enough: the cache is only
+      // expected to fill up if the client talks to more servers than it holds.
+      context->session_cache_.erase(context->session_cache_.begin());
+    }
+  }
+  // Taking ownership of 'session', as signaled by returning 1.
+  context->session_cache_[*key] = ssl_make_unique(session);
+  return 1;
+}
+
+Status TlsContext::ResumeSession(SSL* ssl, const string& session_key) const {
+  SCOPED_OPENSSL_NO_PENDING_ERRORS;
+  std::unique_ptr<string> key(new string(session_key));
+  OPENSSL_RET_NOT_OK(SSL_set_ex_data(ssl, SessionKeyIndex(), key.get()),
+                     "failed to set TLS session key");
+  key.release();
+  lock_guard<simple_spinlock> l(session_cache_lock_);
+  const auto* session = FindOrNull(session_cache_, session_key);
+  if (session) {
+    OPENSSL_RET_NOT_OK(SSL_set_session(ssl, session->get()),
+                       "failed to set TLS session");
+  }
+  return Status::OK();
+}
+
+void TlsContext::EraseSession(const string& session_key) const {
+  lock_guard<simple_spinlock> l(session_cache_lock_);
+  session_cache_.erase(session_key);
+}
+
 Status TlsContext::AddTrustedCertificate(const Cert& cert) {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   VLOG(2) << "Trusting certificate " << cert.SubjectName();
@@ -376,6 +491,7 @@ Status TlsContext::GenerateSelfSignedCertAndKey() {
                      "failed to use private key");
   OPENSSL_RET_NOT_OK(SSL_CTX_use_certificate(ctx_.get(), cert.GetTopOfChainX509()),
                      "failed to use certificate");
+  RETURN_NOT_OK(InvalidateSessionsUnlocked());
   has_cert_ = true;
   csr_ = std::move(csr);
   return Status::OK();
@@ -423,6 +539,7 @@ Status TlsContext::AdoptSignedCert(const Cert& cert) {
   // state.
   OPENSSL_CHECK_OK(SSL_CTX_check_private_key(ctx_.get()))
     << "certificate does not match the private key";
+  RETURN_NOT_OK(InvalidateSessionsUnlocked());
 
   csr_ = boost::none;
 
@@ -464,7 +581,8 @@ Status TlsContext::LoadCertificateAuthority(const string& certificate_path) {
 }
 
 Status TlsContext::InitiateHandshake(TlsHandshakeType handshake_type,
-                                     TlsHandshake* handshake) const {
+                                     TlsHandshake* handshake,
+                                     const string& session_key) const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(ctx_);
   CHECK(!handshake->ssl_);
@@ -486,6 +604,9 @@ Status TlsContext::InitiateHandshake(TlsHandshakeType handshake_type,
       break;
     case TlsHandshakeType::CLIENT:
       SSL_set_connect_state(handshake->ssl());
+      if (!session_key.empty()) {
+        RETURN_NOT_OK(ResumeSession(handshake->ssl(), session_key));
+      }
       break;
   }
 
@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -64,6 +67,12 @@ class PrivateKey;
 // connections, when mutual TLS authentication is not needed (for example, for
 // token or Kerberos authenticated connections).
 //
+// The TlsContext also enables TLS session resumption. As a server, it issues
+// session tickets to its clients. As a client, it caches the sessions it
+// establishes under caller-provided keys (see InitiateHandshake()), so that
+// later handshakes with the same peer can skip the certificate exchange and
+// the asymmetric cryptography of a full handshake.
+//
 // This class is thread-safe after initialization.
 class TlsContext {
 
@@ -160,8 +169,27 @@ class TlsContext {
   Status LoadCertificateAuthority(const std::string& certificate_path) WARN_UNUSED_RESULT;
 
   // Initiates a new TlsHandshake instance.
+  //
+  // If 'session_key' is not empty, a CLIENT handshake attempts to resume the
+  // session cached under that key, and the session it establishes is cached
+  // under that key in turn. The key should identify the remote peer as well as
+  // how the handshake verifies it, since a resumed session carries over the
+  // outcome of the original verification.
   Status InitiateHandshake(TlsHandshakeType handshake_type,
-                           TlsHandshake* handshake) const WARN_UNUSED_RESULT;
+                           TlsHandshake* handshake,
+                           const std::string& session_key = "") const WARN_UNUSED_RESULT;
+
+  // Drops the session cached under 'session_key', if any. Should be called when
+  // a negotiation which resumed or established that session fails, so that the
+  // next attempt starts over with a full handshake.
+  void EraseSession(const std::string& session_key) const;
+
+  // Return the number of cached client sessions.
+  // Used by tests.
+  size_t session_cache_size_for_tests() const {
+    std::lock_guard<simple_spinlock> l(session_cache_lock_);
+    return session_cache_.size();
+  }
 
   // Return the number of certs that have been marked as trusted.
   // Used by tests.
@@ -176,6 +204,19 @@ class TlsContext {
 
   Status VerifyCertChainUnlocked(const Cert& cert) WARN_UNUSED_RESULT;
 
+  // Invalidates all the sessions established so far, on the server side by
+  // rotating the session ticket keys, and on the client side by clearing the
+  // session cache. Called whenever the cert of this context changes, since
+  // resumed sessions would otherwise keep presenting the previous one.
+  Status InvalidateSessionsUnlocked() WARN_UNUSED_RESULT;
+
+  // Sets up the client handshake 'ssl' to resume the session cached under
+  // 'session_key', if any, and to cache the session it establishes.
+  Status ResumeSession(SSL* ssl, const std::string& session_key) const WARN_UNUSED_RESULT;
+
+  // Called by OpenSSL when a client handshake establishes a new session.
+  static int NewSessionCallback(SSL* ssl, SSL_SESSION* session);
+
   // The cipher suite preferences to use for TLS-secured RPC connections. Uses the OpenSSL
   // cipher preference list format. See man (1) ciphers for more information.
   std::string tls_ciphers_;
@@ -195,6 +236,11 @@ class TlsContext {
   bool has_cert_;
   bool is_external_cert_;
   boost::optional<CertSignRequest> csr_;
+
+  // Client sessions, keyed by the session keys passed to InitiateHandshake().
+  // Bounded by --rpc_tls_session_cache_size.
+  mutable simple_spinlock session_cache_lock_;
+  mutable std::unordered_map<std::string, c_unique_ptr<SSL_SESSION>> session_cache_;
 };
 
 } // namespace security
@@ -252,6 +252,12 @@ string TlsHandshake::GetProtocol() const {
   return SSL_get_version(ssl_.get());
 }
 
+bool TlsHandshake::session_reused() const {
+  SCOPED_OPENSSL_NO_PENDING_ERRORS;
+  CHECK(has_started_);
+  return SSL_session_reused(ssl_.get()) == 1;
+}
+
 string TlsHandshake::GetCipherDescription() const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(has_started_);
@@ -130,6 +130,11 @@ class TlsHandshake {
   // handshake is complete and before 'Finish()'.
   std::string GetProtocol() const;
 
+  // Returns true if the handshake resumed a previously established session
+  // rather than going through a full handshake. Only valid to call after the
+  // handshake is complete and before 'Finish()'.
+  bool session_reused() const;
+
   // Retrive the description of the negotiated cipher.
   // Only valid to call after the handshake is complete and before 'Finish()'.
   std::string GetCipherDescription() const;
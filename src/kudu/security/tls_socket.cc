@@ -147,6 +147,10 @@ Status TlsSocket::Recv(uint8_t *buf, int32_t amt, int32_t *nread) {
   return Status::OK();
 }
 
+Status TlsSocket::EnableZeroCopySend() {
+  return Status::NotSupported("zero-copy send is not supported on TLS sockets");
+}
+
 Status TlsSocket::Close() {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   errno = 0;
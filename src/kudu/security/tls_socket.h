@@ -44,6 +44,10 @@ class TlsSocket : public Socket {
 
   Status Recv(uint8_t *buf, int32_t amt, int32_t *nread) override WARN_UNUSED_RESULT;
 
+  // Always returns NotSupported: OpenSSL encrypts into its own buffers, so
+  // there is nothing to gain from sending them without copying.
+  Status EnableZeroCopySend() override WARN_UNUSED_RESULT;
+
   Status Close() override WARN_UNUSED_RESULT;
 
  private:
@@ -26,6 +26,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/security/crypto.h"
 #include "kudu/security/openssl_util.h"
@@ -33,13 +34,19 @@
 #include "kudu/security/token_signer.h"
 #include "kudu/security/token_signing_key.h"
 #include "kudu/security/token_verifier.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(token_verification_cache_size);
 DECLARE_int32(tsk_num_rsa_bits);
 
+METRIC_DECLARE_counter(token_verification_cache_hits);
+METRIC_DECLARE_counter(token_verification_cache_misses);
+METRIC_DECLARE_entity(server);
+
 using std::string;
 using std::make_shared;
 using std::unique_ptr;
@@ -542,6 +549,49 @@ TEST_F(TokenTest, TestEndToEnd_Valid) {
   ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
 }
 
+// Test that the TokenVerifier verifies the signature of a token only the first
+// time the token is presented, and that it never caches invalid signatures.
+TEST_F(TokenTest, TestVerificationCache) {
+  TokenSigner signer(10, 10);
+  {
+    std::unique_ptr<TokenSigningPrivateKey> key;
+    ASSERT_OK(signer.CheckNeedKey(&key));
+    ASSERT_NE(nullptr, key.get());
+    ASSERT_OK(signer.AddKey(std::move(key)));
+  }
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  TokenVerifier verifier(entity);
+  ASSERT_OK(verifier.ImportKeys(signer.verifier().ExportKeys()));
+  scoped_refptr<Counter> hits = METRIC_token_verification_cache_hits.Instantiate(entity);
+  scoped_refptr<Counter> misses = METRIC_token_verification_cache_misses.Instantiate(entity);
+
+  SignedTokenPB signed_token = MakeUnsignedToken(WallTime_Now() + 600);
+  ASSERT_OK(signer.SignToken(&signed_token));
+  for (int i = 0; i < 3; i++) {
+    TokenPB token;
+    ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
+  }
+  ASSERT_EQ(2, hits->value());
+  ASSERT_EQ(1, misses->value());
+  ASSERT_EQ(1, verifier.verified_token_cache_size_for_tests());
+
+  // A token carrying the same data with a corrupted signature is still
+  // rejected.
+  SignedTokenPB forged_token = signed_token;
+  forged_token.set_signature("xyz");
+  TokenPB token;
+  ASSERT_EQ(VerificationResult::INVALID_SIGNATURE,
+            verifier.VerifyTokenSignature(forged_token, &token));
+  ASSERT_EQ(2, misses->value());
+  ASSERT_EQ(1, verifier.verified_token_cache_size_for_tests());
+
+  // With the cache disabled, every verification checks the signature.
+  FLAGS_token_verification_cache_size = 0;
+  ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
+  ASSERT_EQ(2, hits->value());
+}
+
 // Test all of the possible cases covered by token verification.
 // See VerificationResult.
 TEST_F(TokenTest, TestEndToEnd_InvalidCases) {
@@ -25,16 +25,39 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <openssl/evp.h>
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/security/token_signing_key.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(token_verification_cache_size, 10000,
+             "The maximum number of tokens whose successful signature "
+             "verification is remembered until they expire, sparing the cost "
+             "of verifying them again when clients present them on new "
+             "connections. 0 disables the cache.");
+TAG_FLAG(token_verification_cache_size, advanced);
+
+METRIC_DEFINE_counter(server, token_verification_cache_hits,
+                      "Token Verification Cache Hits",
+                      kudu::MetricUnit::kRequests,
+                      "Number of token verifications which found the token in "
+                      "the cache of tokens with a verified signature.");
+
+METRIC_DEFINE_counter(server, token_verification_cache_misses,
+                      "Token Verification Cache Misses",
+                      kudu::MetricUnit::kRequests,
+                      "Number of token verifications which had to verify the "
+                      "signature of the token.");
+
 using std::lock_guard;
 using std::string;
 using std::transform;
@@ -44,9 +67,40 @@ using std::vector;
 namespace kudu {
 namespace security {
 
+namespace {
+
+// Returns the SHA-256 digest of everything the validity of the signature of
+// 'signed_token' depends on.
+string TokenDigest(const SignedTokenPB& signed_token) {
+  const int64_t seq_num = signed_token.signing_key_seq_num();
+  const uint64_t data_size = signed_token.token_data().size();
+  EVP_MD_CTX* ctx = EVP_MD_CTX_create();
+  CHECK(ctx);
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int md_size = 0;
+  CHECK_EQ(1, EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr));
+  CHECK_EQ(1, EVP_DigestUpdate(ctx, &seq_num, sizeof(seq_num)));
+  CHECK_EQ(1, EVP_DigestUpdate(ctx, &data_size, sizeof(data_size)));
+  CHECK_EQ(1, EVP_DigestUpdate(ctx, signed_token.token_data().data(), data_size));
+  CHECK_EQ(1, EVP_DigestUpdate(ctx, signed_token.signature().data(),
+                               signed_token.signature().size()));
+  CHECK_EQ(1, EVP_DigestFinal_ex(ctx, md, &md_size));
+  EVP_MD_CTX_destroy(ctx);
+  return string(reinterpret_cast<const char*>(md), md_size);
+}
+
+} // anonymous namespace
+
 TokenVerifier::TokenVerifier() {
 }
 
+TokenVerifier::TokenVerifier(const scoped_refptr<MetricEntity>& metric_entity) {
+  if (metric_entity) {
+    cache_hits_ = METRIC_token_verification_cache_hits.Instantiate(metric_entity);
+    cache_misses_ = METRIC_token_verification_cache_misses.Instantiate(metric_entity);
+  }
+}
+
 TokenVerifier::~TokenVerifier() {
 }
 
@@ -138,7 +192,7 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
     if (tsk->pb().expire_unix_epoch_seconds() < now) {
       return VerificationResult::EXPIRED_SIGNING_KEY;
     }
-    if (!tsk->VerifySignature(signed_token)) {
+    if (!VerifySignatureCached(*tsk, signed_token, token->expire_unix_epoch_seconds())) {
       return VerificationResult::INVALID_SIGNATURE;
     }
   }
@@ -146,6 +200,48 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
   return VerificationResult::VALID;
 }
 
+bool TokenVerifier::VerifySignatureCached(const TokenSigningPublicKey& tsk,
+                                          const SignedTokenPB& signed_token,
+                                          int64_t expire_unix_epoch_seconds) const {
+  const size_t max_size = std::max(FLAGS_token_verification_cache_size, 0);
+  if (max_size == 0) {
+    return tsk.VerifySignature(signed_token);
+  }
+
+  // The token is known to not have expired yet, so neither has its entry.
+  const string digest = TokenDigest(signed_token);
+  {
+    lock_guard<simple_spinlock> l(verified_tokens_lock_);
+    if (ContainsKey(verified_tokens_, digest)) {
+      if (cache_hits_) cache_hits_->Increment();
+      return true;
+    }
+  }
+  if (cache_misses_) cache_misses_->Increment();
+  if (!tsk.VerifySignature(signed_token)) {
+    return false;
+  }
+
+  lock_guard<simple_spinlock> l(verified_tokens_lock_);
+  if (verified_tokens_.size() >= max_size) {
+    // Make room by dropping the expired tokens, or an arbitrary one if none
+    // has expired.
+    const int64_t now = WallTime_Now();
+    for (auto it = verified_tokens_.begin(); it != verified_tokens_.end();) {
+      if (it->second < now) {
+        it = verified_tokens_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (verified_tokens_.size() >= max_size) {
+      verified_tokens_.erase(verified_tokens_.begin());
+    }
+  }
+  verified_tokens_.emplace(digest, expire_unix_epoch_seconds);
+  return true;
+}
+
 const char* VerificationResultToString(VerificationResult r) {
   switch (r) {
     case security::VerificationResult::VALID:
@@ -16,17 +16,25 @@
 // under the License.
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/rw_mutex.h"
 
 namespace kudu {
 
+class Counter;
+class MetricEntity;
 class Status;
 
 namespace security {
@@ -49,6 +57,12 @@ enum class VerificationResult;
 // so this class can look up the correct key and verify the token's
 // validity and expiration.
 //
+// Verifying a signature is expensive, while clients present the same tokens
+// over and over as they open new connections. So the digests of the tokens
+// whose signature was verified are cached until the tokens expire, up to
+// --token_verification_cache_size of them, and the signatures of the tokens
+// found in the cache aren't verified again.
+//
 // Note that this class does not perform any "business logic" around the
 // content of a token. It only verifies that the token has a valid signature
 // and is not yet expired. Any business rules around authorization or
@@ -63,6 +77,11 @@ enum class VerificationResult;
 class TokenVerifier {
  public:
   TokenVerifier();
+
+  // Creates a verifier which reports the hits and misses of its cache of
+  // verified tokens to 'metric_entity'.
+  explicit TokenVerifier(const scoped_refptr<MetricEntity>& metric_entity);
+
   ~TokenVerifier();
 
   // Return the highest key sequence number known by this instance.
@@ -88,13 +107,35 @@ class TokenVerifier {
   VerificationResult VerifyTokenSignature(const SignedTokenPB& signed_token,
                                           TokenPB* token) const;
 
+  // Return the number of tokens in the cache of verified tokens.
+  // Used by tests.
+  size_t verified_token_cache_size_for_tests() const {
+    std::lock_guard<simple_spinlock> l(verified_tokens_lock_);
+    return verified_tokens_.size();
+  }
+
  private:
   typedef std::map<int64_t, std::unique_ptr<TokenSigningPublicKey>> KeysMap;
 
+  // Returns whether the signature of 'signed_token' was made by 'tsk', looking
+  // it up in the cache of verified tokens first. Valid signatures are added
+  // to the cache until 'expire_unix_epoch_seconds'.
+  bool VerifySignatureCached(const TokenSigningPublicKey& tsk,
+                             const SignedTokenPB& signed_token,
+                             int64_t expire_unix_epoch_seconds) const;
+
   // Lock protecting keys_by_seq_
   mutable RWMutex lock_;
   KeysMap keys_by_seq_;
 
+  // The digests of the tokens whose signature was verified, mapped to the
+  // expiration time of the tokens.
+  mutable simple_spinlock verified_tokens_lock_;
+  mutable std::unordered_map<std::string, int64_t> verified_tokens_;
+
+  scoped_refptr<Counter> cache_hits_;
+  scoped_refptr<Counter> cache_misses_;
+
   DISALLOW_COPY_AND_ASSIGN(TokenVerifier);
 };
 
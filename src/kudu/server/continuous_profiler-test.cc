@@ -0,0 +1,78 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/server/continuous_profiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+
+DECLARE_int32(continuous_profiling_interval_ms);
+
+using std::string;
+
+namespace kudu {
+namespace server {
+
+class ContinuousProfilerTest : public KuduTest {
+};
+
+#if defined(__linux__)
+// Stack collection is only supported on Linux.
+TEST_F(ContinuousProfilerTest, TestSamplesRunningThreads) {
+  FLAGS_continuous_profiling_interval_ms = 10;
+  const int64_t start = GetCurrentTimeMicros();
+  ContinuousProfiler profiler;
+  ASSERT_OK(profiler.Start());
+
+  std::atomic<bool> done(false);
+  scoped_refptr<Thread> spinner;
+  ASSERT_OK(Thread::Create("test", "spinner", [&]() {
+      while (!done.load()) {
+      }
+    }, &spinner));
+
+  // The busy thread eventually shows up in the folded stacks, prefixed with
+  // its name.
+  AssertEventually([&]() {
+      std::ostringstream out;
+      profiler.DumpFoldedStacks(start, GetCurrentTimeMicros(), &out);
+      ASSERT_STR_CONTAINS(out.str(), "spinner;");
+    });
+  done = true;
+  spinner->Join();
+
+  // Nothing was sampled before the profiler was started.
+  std::ostringstream out;
+  profiler.DumpFoldedStacks(0, start - 1, &out);
+  ASSERT_EQ("", out.str());
+  profiler.Stop();
+}
+#endif
+
+} // namespace server
+} // namespace kudu
@@ -0,0 +1,260 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/server/continuous_profiler.h"
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/thread.h"
+#include "kudu/util/web_callback_registry.h"
+
+DEFINE_int32(continuous_profiling_interval_ms, 200,
+             "How often the continuous profiler samples the stacks of the "
+             "threads running on a CPU, in milliseconds. If 0, the continuous "
+             "profiler isn't started.");
+TAG_FLAG(continuous_profiling_interval_ms, experimental);
+
+DEFINE_int32(continuous_profiling_window_secs, 600,
+             "How long the continuous profiler keeps its samples for, in seconds.");
+TAG_FLAG(continuous_profiling_window_secs, experimental);
+TAG_FLAG(continuous_profiling_window_secs, runtime);
+
+DEFINE_int32(continuous_profiling_max_samples, 100000,
+             "The maximum number of samples kept by the continuous profiler. "
+             "The oldest samples are evicted first.");
+TAG_FLAG(continuous_profiling_max_samples, experimental);
+TAG_FLAG(continuous_profiling_max_samples, runtime);
+
+using std::map;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+// GLog already implements symbolization. Just import their hidden symbol.
+namespace google {
+// Symbolizes a program counter.  On success, returns true and write the
+// symbol name to "out".  The symbol name is demangled if possible
+// (supports symbols generated by GCC 3.x or newer).  Otherwise,
+// returns false.
+bool Symbolize(void *pc, char *out, int out_size);
+}
+
+namespace kudu {
+namespace server {
+
+namespace {
+
+// Returns true if the thread with the given TID is running or runnable, per
+// the state reported by procfs.
+bool IsThreadRunning(int64_t tid) {
+  faststring buf;
+  if (!ReadFileToString(Env::Default(), Substitute("/proc/self/task/$0/stat", tid), &buf).ok()) {
+    return false;
+  }
+  // The state follows the command name, which is parenthesized and may itself
+  // contain parentheses and spaces.
+  const string stat = buf.ToString();
+  const size_t name_end = stat.rfind(')');
+  return name_end != string::npos &&
+      name_end + 2 < stat.size() &&
+      stat[name_end + 2] == 'R';
+}
+
+string ThreadName(int64_t tid) {
+  faststring buf;
+  if (!ReadFileToString(Env::Default(), Substitute("/proc/self/task/$0/comm", tid), &buf).ok()) {
+    return "<unknown name>";
+  }
+  string name = buf.ToString();
+  StripTrailingNewline(&name);
+  return name;
+}
+
+} // anonymous namespace
+
+ContinuousProfiler::ContinuousProfiler()
+    : wake_(&lock_) {
+}
+
+ContinuousProfiler::~ContinuousProfiler() {
+  Stop();
+}
+
+Status ContinuousProfiler::Start() {
+  return Thread::Create("server", "continuous-profiler",
+                        &ContinuousProfiler::RunThread, this, &thread_);
+}
+
+void ContinuousProfiler::Stop() {
+  if (!thread_) return;
+
+  {
+    MutexLock l(lock_);
+    stop_ = true;
+    wake_.Signal();
+  }
+  thread_->Join();
+  thread_.reset();
+  stop_ = false;
+}
+
+void ContinuousProfiler::RunThread() {
+  MutexLock l(lock_);
+  while (!stop_) {
+    wake_.WaitFor(MonoDelta::FromMilliseconds(FLAGS_continuous_profiling_interval_ms));
+    if (stop_) {
+      break;
+    }
+    // Don't hold the lock while collecting the stacks, so as not to block
+    // the dumps of the samples.
+    l.Unlock();
+    WARN_NOT_OK(TakeSamples(), "Unable to take continuous profiling samples");
+    l.Lock();
+  }
+}
+
+Status ContinuousProfiler::TakeSamples() {
+  vector<pid_t> tids;
+  RETURN_NOT_OK_PREPEND(ListThreads(&tids), "could not list threads");
+
+  // Only sample the threads which are on a CPU, skipping this one.
+  const int64_t self_tid = Thread::CurrentThreadId();
+  vector<int64_t> running_tids;
+  for (pid_t tid : tids) {
+    if (tid != self_tid && IsThreadRunning(tid)) {
+      running_tids.push_back(tid);
+    }
+  }
+
+  const int64_t now = GetCurrentTimeMicros();
+  vector<StackTraceCollector> collectors(running_tids.size());
+  vector<Sample> samples(running_tids.size());
+  vector<Status> statuses(running_tids.size());
+  for (int i = 0; i < running_tids.size(); i++) {
+    samples[i].timestamp_micros = now;
+    statuses[i] = collectors[i].TriggerAsync(running_tids[i], &samples[i].stack);
+  }
+  // Collect the thread names while waiting on the stacks.
+  for (int i = 0; i < running_tids.size(); i++) {
+    if (statuses[i].ok()) {
+      samples[i].thread_name = ThreadName(running_tids[i]);
+    }
+  }
+  const MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(1);
+  for (int i = 0; i < running_tids.size(); i++) {
+    if (statuses[i].ok()) {
+      statuses[i] = collectors[i].AwaitCollection(deadline);
+    }
+  }
+
+  MutexLock l(lock_);
+  for (int i = 0; i < running_tids.size(); i++) {
+    // Threads which exited or block signals are left out.
+    if (statuses[i].ok()) {
+      samples_.emplace_back(std::move(samples[i]));
+    }
+  }
+  const int64_t window_start =
+      now - static_cast<int64_t>(FLAGS_continuous_profiling_window_secs) * 1000000;
+  while (!samples_.empty() &&
+         (samples_.front().timestamp_micros < window_start ||
+          samples_.size() > std::max(FLAGS_continuous_profiling_max_samples, 0))) {
+    samples_.pop_front();
+  }
+  return Status::OK();
+}
+
+void ContinuousProfiler::DumpFoldedStacks(int64_t start_micros,
+                                          int64_t end_micros,
+                                          std::ostream* out) const {
+  // Copy the samples in the window so as not to symbolize them under the lock.
+  vector<Sample> samples;
+  {
+    MutexLock l(lock_);
+    for (const auto& sample : samples_) {
+      if (sample.timestamp_micros >= start_micros && sample.timestamp_micros <= end_micros) {
+        samples.push_back(sample);
+      }
+    }
+  }
+
+  // Fold the samples into counts of distinct stacks.
+  map<string, int64_t> counts;
+  unordered_map<void*, string> symbols;
+  for (const auto& sample : samples) {
+    string folded = sample.thread_name;
+    for (int i = sample.stack.num_frames() - 1; i >= 0; i--) {
+      void* addr = sample.stack.frame(i);
+      string* symbol = FindOrNull(symbols, addr);
+      if (!symbol) {
+        // Symbolize the call instruction rather than the return address, as
+        // the latter may belong to the next function.
+        char buf[1024];
+        string s = google::Symbolize(static_cast<char*>(addr) - 1, buf, sizeof(buf)) ?
+            buf : Substitute("$0", addr);
+        symbol = &symbols.emplace(addr, std::move(s)).first->second;
+      }
+      folded.push_back(';');
+      folded.append(*symbol);
+    }
+    counts[folded]++;
+  }
+  for (const auto& entry : counts) {
+    *out << entry.first << " " << entry.second << std::endl;
+  }
+}
+
+void ContinuousProfiler::RegisterPathHandler(WebCallbackRegistry* registry) {
+  registry->RegisterPrerenderedPathHandler(
+      "/pprof/continuous", "",
+      [this](const WebCallbackRegistry::WebRequest& req,
+             WebCallbackRegistry::PrerenderedWebResponse* resp) {
+        const int32_t seconds = ParseLeadingInt32Value(
+            FindWithDefault(req.parsed_args, "seconds", "").c_str(), 60);
+        const int32_t end_seconds_ago = ParseLeadingInt32Value(
+            FindWithDefault(req.parsed_args, "end_seconds_ago", "").c_str(), 0);
+        const int64_t end = GetCurrentTimeMicros() -
+            static_cast<int64_t>(end_seconds_ago) * 1000000;
+        DumpFoldedStacks(end - static_cast<int64_t>(seconds) * 1000000, end, resp->output);
+      },
+      false, false);
+}
+
+} // namespace server
+} // namespace kudu
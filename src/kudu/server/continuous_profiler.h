@@ -0,0 +1,92 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/debug-util.h"
+#include "kudu/util/mutex.h"
+
+namespace kudu {
+
+class Status;
+class Thread;
+class WebCallbackRegistry;
+
+namespace server {
+
+// A low-frequency sampling profiler meant to be left running at all times.
+//
+// Periodically, the profiler collects the stacks of the threads of the process
+// which are running on a CPU, and keeps them in memory for a rolling window of
+// time. The samples of any part of that window may then be dumped in the
+// "folded" format consumed by flamegraph tools, which makes it possible to find
+// out after the fact what the process was busy doing, eg during a CPU spike.
+class ContinuousProfiler {
+ public:
+  ContinuousProfiler();
+  ~ContinuousProfiler();
+
+  Status Start();
+  void Stop();
+
+  // Writes the samples taken between 'start_micros' and 'end_micros' (in
+  // microseconds since the Unix epoch) to 'out' in the folded format: one line
+  // per distinct stack, consisting of the thread name and the frames from the
+  // outermost to the innermost one, separated by semicolons, followed by the
+  // number of samples of that stack.
+  void DumpFoldedStacks(int64_t start_micros, int64_t end_micros, std::ostream* out) const;
+
+  // Registers the /pprof/continuous endpoint, which dumps the samples of the
+  // last 'seconds' (60 by default) ending 'end_seconds_ago' (0 by default)
+  // seconds ago.
+  void RegisterPathHandler(WebCallbackRegistry* registry);
+
+ private:
+  struct Sample {
+    int64_t timestamp_micros;
+    std::string thread_name;
+    StackTrace stack;
+  };
+
+  void RunThread();
+
+  // Collects the stacks of the running threads, and evicts the samples which
+  // have fallen out of the window.
+  Status TakeSamples();
+
+  scoped_refptr<Thread> thread_;
+
+  // Protects 'samples_' and 'stop_'.
+  mutable Mutex lock_;
+  ConditionVariable wake_;
+  bool stop_ = false;
+
+  // The samples in the window, from the oldest to the newest.
+  std::deque<Sample> samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContinuousProfiler);
+};
+
+} // namespace server
+} // namespace kudu
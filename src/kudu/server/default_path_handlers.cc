@@ -19,10 +19,12 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -45,6 +47,7 @@
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/server/pprof_path_handlers.h"
 #include "kudu/server/webserver.h"
 #include "kudu/util/array_view.h"
@@ -59,6 +62,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
+#include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/status.h"
 #include "kudu/util/web_callback_registry.h"
 
@@ -182,6 +186,67 @@ static void StacksHandler(const Webserver::WebRequest& /*req*/,
     });
 }
 
+// Registered to handle "/lock-contention". Profiles lock contention for a
+// window of time and prints the acquiring stacks which waited the longest.
+//
+// Parameters:
+//   seconds: the length of the window (default 10)
+//   top:     the number of stacks to print (default 20)
+static void LockContentionHandler(const Webserver::WebRequest& req,
+                                  Webserver::PrerenderedWebResponse* resp) {
+  std::ostringstream* output = resp->output;
+  int32_t seconds = ParseLeadingInt32Value(
+      FindWithDefault(req.parsed_args, "seconds", "").c_str(), 10);
+  int32_t top = ParseLeadingInt32Value(
+      FindWithDefault(req.parsed_args, "top", "").c_str(), 20);
+
+  vector<ContentionSample> samples;
+  int64_t dropped = 0;
+  MonoTime end = MonoTime::Now() + MonoDelta::FromSeconds(seconds);
+  StartSynchronizationProfiling();
+  while (MonoTime::Now() < end) {
+    SleepFor(MonoDelta::FromMilliseconds(500));
+    FlushSynchronizationProfile(&samples, &dropped);
+  }
+  StopSynchronizationProfiling();
+  FlushSynchronizationProfile(&samples, &dropped);
+
+  // A stack may have been flushed several times, or recorded in several
+  // slots of the profile, so merge the samples of equal stacks.
+  std::sort(samples.begin(), samples.end(),
+            [](const ContentionSample& a, const ContentionSample& b) {
+              return a.stack.LessThan(b.stack);
+            });
+  vector<ContentionSample> merged;
+  for (const auto& sample : samples) {
+    if (!merged.empty() && merged.back().stack.Equals(sample.stack)) {
+      merged.back().cycles += sample.cycles;
+      merged.back().count += sample.count;
+    } else {
+      merged.push_back(sample);
+    }
+  }
+  std::sort(merged.begin(), merged.end(),
+            [](const ContentionSample& a, const ContentionSample& b) {
+              return a.cycles > b.cycles;
+            });
+
+  *output << "Collected " << merged.size() << " contended stacks over "
+          << seconds << " seconds";
+  if (dropped > 0) {
+    *output << " (" << dropped << " samples dropped)";
+  }
+  *output << "\n\n";
+  int num_printed = std::min<int>(top, merged.size());
+  for (int i = 0; i < num_printed; i++) {
+    const auto& sample = merged[i];
+    double wait_secs = static_cast<double>(sample.cycles) / base::CyclesPerSecond();
+    *output << "Waited " << HumanReadableElapsedTime::ToShortString(wait_secs)
+            << " in " << sample.count << " contended acquisitions:\n"
+            << sample.stack.Symbolize() << "\n\n";
+  }
+}
+
 // Registered to handle "/memz", and prints out memory allocation statistics.
 static void MemUsageHandler(const Webserver::WebRequest& req,
                             Webserver::PrerenderedWebResponse* resp) {
@@ -304,18 +369,38 @@ void AddDefaultPathHandlers(Webserver* webserver) {
   webserver->RegisterPrerenderedPathHandler("/stacks", "Stacks", StacksHandler,
                                             /*is_styled=*/false,
                                             /*is_on_nav_bar=*/false);
+  webserver->RegisterPrerenderedPathHandler("/lock-contention", "Lock Contention",
+                                            LockContentionHandler,
+                                            /*is_styled=*/false,
+                                            /*is_on_nav_bar=*/false);
 
   AddPprofPathHandlers(webserver);
 }
 
 
+// Parses the arguments of a metrics request shared by all its formats.
+static void ParseMetricsRequest(const Webserver::WebRequest& req,
+                                vector<string>* requested_metrics,
+                                MetricJsonOptions* opts) {
+  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+  if (requested_metrics_param != nullptr) {
+    SplitStringUsing(*requested_metrics_param, ",", requested_metrics);
+  } else {
+    // Default to including all metrics.
+    requested_metrics->emplace_back("*");
+  }
+  const string* types_param = FindOrNull(req.parsed_args, "types");
+  if (types_param != nullptr) {
+    SplitStringUsing(*types_param, ",", &opts->entity_types);
+  }
+}
+
 static void WriteMetricsAsJson(const MetricRegistry* const metrics,
                                const Webserver::WebRequest& req,
-                               Webserver::PrerenderedWebResponse* resp) {
-  std::ostringstream* output = resp->output;
-  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+                               std::ostream* output) {
   vector<string> requested_metrics;
   MetricJsonOptions opts;
+  ParseMetricsRequest(req, &requested_metrics, &opts);
 
   {
     string arg = FindWithDefault(req.parsed_args, "include_raw_histograms", "false");
@@ -333,31 +418,39 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
   }
 
   JsonWriter writer(output, json_mode);
-
-  if (requested_metrics_param != nullptr) {
-    SplitStringUsing(*requested_metrics_param, ",", &requested_metrics);
-  } else {
-    // Default to including all metrics.
-    requested_metrics.emplace_back("*");
-  }
-
   WARN_NOT_OK(metrics->WriteAsJson(&writer, requested_metrics, opts),
               "Couldn't write JSON metrics over HTTP");
 }
 
+static void WriteMetricsAsPrometheus(const MetricRegistry* const metrics,
+                                     const Webserver::WebRequest& req,
+                                     std::ostream* output) {
+  vector<string> requested_metrics;
+  MetricJsonOptions opts;
+  ParseMetricsRequest(req, &requested_metrics, &opts);
+  WARN_NOT_OK(metrics->WriteAsPrometheus(output, requested_metrics, opts),
+              "Couldn't write Prometheus metrics over HTTP");
+}
+
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics) {
-  Webserver::PrerenderedPathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics,
-                                                                   _1, _2);
-  bool not_styled = false;
+  // The metrics of a server with many tablets take up many megabytes, so they
+  // are streamed rather than buffered.
+  Webserver::StreamingPathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics,
+                                                                 _1, _2);
   bool not_on_nav_bar = false;
   bool is_on_nav_bar = true;
-  webserver->RegisterPrerenderedPathHandler("/metrics", "Metrics", callback,
-                                            not_styled, is_on_nav_bar);
+  webserver->RegisterStreamingPathHandler("/metrics", "Metrics", callback,
+                                          "text/plain", is_on_nav_bar);
 
   // The old name -- this is preserved for compatibility with older releases of
   // monitoring software which expects the old name.
-  webserver->RegisterPrerenderedPathHandler("/jsonmetricz", "Metrics", callback,
-                                            not_styled, not_on_nav_bar);
+  webserver->RegisterStreamingPathHandler("/jsonmetricz", "Metrics", callback,
+                                          "text/plain", not_on_nav_bar);
+
+  webserver->RegisterStreamingPathHandler(
+      "/metrics_prometheus", "Prometheus Metrics",
+      boost::bind(WriteMetricsAsPrometheus, metrics, _1, _2),
+      "text/plain; version=0.0.4", not_on_nav_bar);
 }
 
 } // namespace kudu
@@ -15,6 +15,10 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <ostream>
@@ -38,6 +42,7 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_pool.h"
 #include "kudu/server/rpc_server.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
@@ -76,6 +81,17 @@ DEFINE_int32(rpc_service_queue_length, 50,
              "Default length of queue for incoming RPC requests");
 TAG_FLAG(rpc_service_queue_length, advanced);
 
+DEFINE_int32(rpc_num_consensus_service_threads, 10,
+             "Number of RPC worker threads dedicated to the Raft consensus service. "
+             "These are separate from the --rpc_num_service_threads workers which "
+             "handle client RPCs, so that a backlog of client requests doesn't "
+             "delay heartbeats and votes.");
+TAG_FLAG(rpc_num_consensus_service_threads, advanced);
+
+DEFINE_int32(rpc_consensus_service_queue_length, 50,
+             "Length of the queue for incoming Raft consensus service RPC requests");
+TAG_FLAG(rpc_consensus_service_queue_length, advanced);
+
 DEFINE_bool(rpc_server_allow_ephemeral_ports, false,
             "Allow binding to ephemeral ports. This can cause problems, so currently "
             "only allowed in tests.");
@@ -89,7 +105,9 @@ RpcServerOptions::RpcServerOptions()
     num_acceptors_per_address(FLAGS_rpc_num_acceptors_per_address),
     num_service_threads(FLAGS_rpc_num_service_threads),
     default_port(0),
-    service_queue_length(FLAGS_rpc_service_queue_length) {
+    service_queue_length(FLAGS_rpc_service_queue_length),
+    num_consensus_service_threads(FLAGS_rpc_num_consensus_service_threads),
+    consensus_service_queue_length(FLAGS_rpc_consensus_service_queue_length) {
 }
 
 RpcServer::RpcServer(RpcServerOptions opts)
@@ -126,6 +144,11 @@ Status RpcServer::Init(const shared_ptr<Messenger>& messenger) {
     }
   }
 
+  if (!unix_domain_socket_path_.empty()) {
+    RETURN_NOT_OK_PREPEND(unix_domain_addr_.ParseUnixDomainPath(unix_domain_socket_path_),
+                          "invalid RPC UNIX domain socket path");
+  }
+
   if (!options_.rpc_advertised_addresses.empty()) {
     RETURN_NOT_OK(ParseAddressList(options_.rpc_advertised_addresses,
                                    options_.default_port,
@@ -144,13 +167,21 @@ Status RpcServer::Init(const shared_ptr<Messenger>& messenger) {
 }
 
 Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service) {
+  return RegisterService(std::move(service),
+                         options_.num_service_threads,
+                         options_.service_queue_length);
+}
+
+Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service,
+                                  uint32_t num_service_threads,
+                                  size_t service_queue_length) {
   CHECK(server_state_ == INITIALIZED ||
         server_state_ == BOUND) << "bad state: " << server_state_;
   string service_name = service->service_name();
   scoped_refptr<rpc::ServicePool> service_pool =
     new rpc::ServicePool(std::move(service), messenger_->metric_entity(),
-                         options_.service_queue_length);
-  RETURN_NOT_OK(service_pool->Init(options_.num_service_threads));
+                         service_queue_length);
+  RETURN_NOT_OK(service_pool->Init(num_service_threads));
   auto* service_pool_raw_ptr = service_pool.get();
   service_pool->set_too_busy_hook([this, service_pool_raw_ptr]() {
       if (too_busy_hook_) {
@@ -174,6 +205,20 @@ Status RpcServer::Bind() {
                     &pool));
     new_acceptor_pools.push_back(pool);
   }
+  if (!unix_domain_socket_path_.empty()) {
+    if (unix_domain_socket_path_[0] != '@') {
+      // Remove the socket file left behind by a previous run of the server,
+      // if any: binding to an existing path fails.
+      struct stat st;
+      if (stat(unix_domain_socket_path_.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        RETURN_NOT_OK_PREPEND(Env::Default()->DeleteFile(unix_domain_socket_path_),
+                              "could not remove stale RPC UNIX domain socket");
+      }
+    }
+    shared_ptr<rpc::AcceptorPool> pool;
+    RETURN_NOT_OK(messenger_->AddAcceptorPool(unix_domain_addr_, &pool));
+    new_acceptor_pools.push_back(pool);
+  }
   acceptor_pools_.swap(new_acceptor_pools);
 
   server_state_ = BOUND;
@@ -198,6 +243,9 @@ Status RpcServer::Start() {
     if (!bound_addrs_str.empty()) bound_addrs_str += ", ";
     bound_addrs_str += bind_addr.ToString();
   }
+  if (!unix_domain_socket_path_.empty()) {
+    bound_addrs_str += ", " + unix_domain_addr_.ToString();
+  }
   LOG(INFO) << "RPC server started. Bound to: " << bound_addrs_str;
 
   return Status::OK();
@@ -223,6 +271,10 @@ Status RpcServer::GetBoundAddresses(vector<Sockaddr>* addresses) const {
     Sockaddr bound_addr;
     RETURN_NOT_OK_PREPEND(pool->GetBoundAddress(&bound_addr),
                           "Unable to get bound address from AcceptorPool");
+    if (!bound_addr.is_ip()) {
+      // The UNIX domain socket is reported by unix_domain_socket_path().
+      continue;
+    }
     addresses->push_back(bound_addr);
   }
   return Status::OK();
@@ -52,6 +52,8 @@ struct RpcServerOptions {
   uint32_t num_service_threads;
   uint16_t default_port;
   size_t service_queue_length;
+  uint32_t num_consensus_service_threads;
+  size_t consensus_service_queue_length;
 };
 
 class RpcServer {
@@ -69,17 +71,38 @@ class RpcServer {
     too_busy_hook_ = std::move(hook);
   }
 
+  // Sets the path of a UNIX domain socket to accept connections on, in
+  // addition to the RPC bind addresses. See Sockaddr::ParseUnixDomainPath()
+  // for its format.
+  //
+  // REQUIRES: must be set before the server is initialized.
+  void set_unix_domain_socket_path(std::string path) {
+    CHECK_EQ(server_state_, UNINITIALIZED);
+    unix_domain_socket_path_ = std::move(path);
+  }
+
+  // Returns the path of the UNIX domain socket the server accepts connections
+  // on, or an empty string if there is none.
+  const std::string& unix_domain_socket_path() const {
+    return unix_domain_socket_path_;
+  }
+
   Status Init(const std::shared_ptr<rpc::Messenger>& messenger) WARN_UNUSED_RESULT;
   // Services need to be registered after Init'ing, but before Start'ing.
   // The service's ownership will be given to a ServicePool.
   Status RegisterService(gscoped_ptr<rpc::ServiceIf> service) WARN_UNUSED_RESULT;
+  // Like the above, but the service gets 'num_service_threads' workers and a
+  // queue of 'service_queue_length' calls instead of the server defaults.
+  Status RegisterService(gscoped_ptr<rpc::ServiceIf> service,
+                         uint32_t num_service_threads,
+                         size_t service_queue_length) WARN_UNUSED_RESULT;
   Status Bind() WARN_UNUSED_RESULT;
   Status Start() WARN_UNUSED_RESULT;
   void Shutdown();
 
   std::string ToString() const;
 
-  // Return the addresses that this server has successfully
+  // Return the IP addresses that this server has successfully
   // bound to. Requires that the server has been Start()ed.
   Status GetBoundAddresses(std::vector<Sockaddr>* addresses) const WARN_UNUSED_RESULT;
 
@@ -117,6 +140,11 @@ class RpcServer {
   // should be advertised.
   std::vector<Sockaddr> rpc_advertised_addresses_;
 
+  // See set_unix_domain_socket_path(). 'unix_domain_addr_' is parsed from
+  // the path by Init().
+  std::string unix_domain_socket_path_;
+  Sockaddr unix_domain_addr_;
+
   std::vector<std::shared_ptr<rpc::AcceptorPool> > acceptor_pools_;
 
   // Function called when one of this server's pools rejects an RPC due to queue overflow.
@@ -44,6 +44,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/remote_user.h"
 #include "kudu/rpc/result_tracker.h"
@@ -52,6 +53,7 @@
 #include "kudu/rpc/service_pool.h"
 #include "kudu/security/init.h"
 #include "kudu/security/security_flags.h"
+#include "kudu/server/continuous_profiler.h"
 #include "kudu/server/default_path_handlers.h"
 #include "kudu/server/diagnostics_log.h"
 #include "kudu/server/generic_service.h"
@@ -71,12 +73,14 @@
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/memory/memory.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/minidump.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/thread.h"
@@ -206,7 +210,22 @@ DEFINE_int32(rpc_default_keepalive_time_ms, 65000,
              "always alive.");
 TAG_FLAG(rpc_default_keepalive_time_ms, advanced);
 
+DEFINE_bool(rpc_listen_on_unix_domain_socket, false,
+            "Whether to also accept RPC connections on the UNIX domain socket given "
+            "by --rpc_unix_domain_socket_path. Co-located clients which connect "
+            "through it bypass the TCP/IP stack, and their connections are treated "
+            "as loopback connections, e.g. by --rpc_encrypt_loopback_connections.");
+TAG_FLAG(rpc_listen_on_unix_domain_socket, experimental);
+
+DEFINE_string(rpc_unix_domain_socket_path, "@kudu-$UUID",
+              "Path of the UNIX domain socket to accept RPC connections on if "
+              "--rpc_listen_on_unix_domain_socket is set. A path starting with '@' "
+              "names a socket in the Linux abstract namespace. Any '$UUID' in the "
+              "path is replaced by the server's UUID.");
+TAG_FLAG(rpc_unix_domain_socket_path, experimental);
+
 DECLARE_bool(use_hybrid_clock);
+DECLARE_int32(continuous_profiling_interval_ms);
 
 using kudu::security::RpcAuthentication;
 using kudu::security::RpcEncryption;
@@ -417,7 +436,9 @@ void ServerBase::GenerateInstanceID() {
 Status ServerBase::Init() {
   glog_metrics_.reset(new ScopedGLogMetrics(metric_entity_));
   tcmalloc::RegisterMetrics(metric_entity_);
+  process_memory::StartBackgroundMemoryRelease();
   RegisterSpinLockContentionMetrics(metric_entity_);
+  HugePageBufferAllocator::Get()->RegisterMetrics(metric_entity_);
 
   InitSpinLockContentionProfiling();
 
@@ -475,11 +496,16 @@ Status ServerBase::Init() {
   rpc_server_->set_too_busy_hook(std::bind(
       &ServerBase::ServiceQueueOverflowed, this, std::placeholders::_1));
 
+  if (FLAGS_rpc_listen_on_unix_domain_socket) {
+    rpc_server_->set_unix_domain_socket_path(StringReplace(
+        FLAGS_rpc_unix_domain_socket_path, "$UUID", fs_manager_->uuid(), true));
+  }
   RETURN_NOT_OK(rpc_server_->Init(messenger_));
   RETURN_NOT_OK(rpc_server_->Bind());
   clock_->RegisterMetrics(metric_entity_);
 
   RETURN_NOT_OK_PREPEND(StartMetricsLogging(), "Could not enable metrics logging");
+  RETURN_NOT_OK_PREPEND(StartContinuousProfiler(), "Could not start continuous profiler");
 
   result_tracker_->StartGCThread();
   RETURN_NOT_OK(StartExcessLogFileDeleterThread());
@@ -612,6 +638,12 @@ Status ServerBase::RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl) {
   return rpc_server_->RegisterService(std::move(rpc_impl));
 }
 
+Status ServerBase::RegisterConsensusService(gscoped_ptr<rpc::ServiceIf> rpc_impl) {
+  return rpc_server_->RegisterService(std::move(rpc_impl),
+                                      options_.rpc_opts.num_consensus_service_threads,
+                                      options_.rpc_opts.consensus_service_queue_length);
+}
+
 Status ServerBase::StartMetricsLogging() {
   if (options_.metrics_log_interval_ms <= 0) {
     return Status::OK();
@@ -627,6 +659,15 @@ Status ServerBase::StartMetricsLogging() {
   return Status::OK();
 }
 
+Status ServerBase::StartContinuousProfiler() {
+  if (FLAGS_continuous_profiling_interval_ms <= 0) {
+    return Status::OK();
+  }
+  unique_ptr<ContinuousProfiler> p(new ContinuousProfiler());
+  RETURN_NOT_OK(p->Start());
+  profiler_ = std::move(p);
+  return Status::OK();
+}
 
 Status ServerBase::StartExcessLogFileDeleterThread() {
   // Try synchronously deleting excess log files once at startup to make sure it
@@ -670,6 +711,9 @@ Status ServerBase::Start() {
     AddRpczPathHandlers(messenger_, web_server_.get());
     RegisterMetricsJsonHandler(web_server_.get(), metric_registry_.get());
     TracingPathHandlers::RegisterHandlers(web_server_.get());
+    if (profiler_) {
+      profiler_->RegisterPathHandler(web_server_.get());
+    }
     web_server_->set_footer_html(FooterHtml());
     RETURN_NOT_OK(web_server_->Start());
   }
@@ -701,6 +745,9 @@ void ServerBase::Shutdown() {
   if (diag_log_) {
     diag_log_->Stop();
   }
+  if (profiler_) {
+    profiler_->Stop();
+  }
   if (excess_log_deleter_thread_) {
     excess_log_deleter_thread_->Join();
   }
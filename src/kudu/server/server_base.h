@@ -61,6 +61,7 @@ class TokenVerifier;
 } // namespace security
 
 namespace server {
+class ContinuousProfiler;
 class DiagnosticsLog;
 class ServerStatusPB;
 
@@ -137,6 +138,12 @@ class ServerBase {
   // process and dispatch incoming RPCs belonging to this service.
   Status RegisterService(gscoped_ptr<rpc::ServiceIf> rpc_impl);
 
+  // Like RegisterService(), but runs the service on its own worker pool and
+  // queue, sized by --rpc_num_consensus_service_threads and
+  // --rpc_consensus_service_queue_length. Used for the Raft consensus service
+  // so that its calls don't wait behind client RPCs.
+  Status RegisterConsensusService(gscoped_ptr<rpc::ServiceIf> rpc_impl);
+
   // Unregisters all RPC services. After this function returns, any subsequent
   // incoming RPCs will be rejected.
   //
@@ -193,6 +200,7 @@ class ServerBase {
   Status DumpServerInfo(const std::string& path,
                         const std::string& format) const;
   Status StartMetricsLogging();
+  Status StartContinuousProfiler();
   void MetricsLoggingThread();
   std::string FooterHtml() const;
 
@@ -206,6 +214,7 @@ class ServerBase {
   ServerBaseOptions options_;
 
   std::unique_ptr<DiagnosticsLog> diag_log_;
+  std::unique_ptr<ContinuousProfiler> profiler_;
   scoped_refptr<Thread> excess_log_deleter_thread_;
   CountDownLatch stop_background_threads_latch_;
 
@@ -28,6 +28,7 @@
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/process_memory.h"
 
 #ifndef TCMALLOC_ENABLED
 #define TCM_ASAN_MSG " (Disabled - no tcmalloc in this build)"
@@ -72,6 +73,24 @@ METRIC_DEFINE_gauge_uint64(server, tcmalloc_current_total_thread_cache_bytes,
     "Thread Cache Memory Usage", kudu::MetricUnit::kBytes,
     "A measure of some of the memory TCMalloc is using (for small objects)." TCM_ASAN_MSG);
 
+METRIC_DEFINE_gauge_double(server, tcmalloc_pageheap_fragmentation,
+    "Heap Fragmentation", kudu::MetricUnit::kUnits,
+    "Fraction of the mapped page heap which is free, i.e. reserved by TCMalloc "
+    "but not allocated to the application. A high value after a drop in memory "
+    "use means that memory is waiting to be released to the OS." TCM_ASAN_MSG);
+
+METRIC_DEFINE_gauge_int64(server, tcmalloc_background_released_bytes,
+    "Memory Released In Background", kudu::MetricUnit::kBytes,
+    "Number of bytes of free heap memory released to the OS by the background "
+    "memory release thread." TCM_ASAN_MSG,
+    kudu::EXPOSE_AS_COUNTER);
+
+METRIC_DEFINE_gauge_int64(server, tcmalloc_background_releases,
+    "Background Memory Releases", kudu::MetricUnit::kOperations,
+    "Number of times the background memory release thread released free heap "
+    "memory to the OS." TCM_ASAN_MSG,
+    kudu::EXPOSE_AS_COUNTER);
+
 #undef TCM_ASAN_MSG
 
 namespace kudu {
@@ -87,6 +106,16 @@ static uint64_t GetTCMallocPropValue(const char* prop) {
   return value;
 }
 
+static double GetPageHeapFragmentation() {
+  uint64_t heap_size = GetTCMallocPropValue("generic.heap_size");
+  uint64_t unmapped = GetTCMallocPropValue("tcmalloc.pageheap_unmapped_bytes");
+  if (heap_size <= unmapped) {
+    return 0;
+  }
+  return static_cast<double>(GetTCMallocPropValue("tcmalloc.pageheap_free_bytes")) /
+      (heap_size - unmapped);
+}
+
 void RegisterMetrics(const scoped_refptr<MetricEntity>& entity) {
   entity->NeverRetire(
       METRIC_generic_current_allocated_bytes.InstantiateFunctionGauge(
@@ -107,6 +136,15 @@ void RegisterMetrics(const scoped_refptr<MetricEntity>& entity) {
       METRIC_tcmalloc_current_total_thread_cache_bytes.InstantiateFunctionGauge(
           entity, Bind(GetTCMallocPropValue,
                        Unretained("tcmalloc.current_total_thread_cache_bytes"))));
+  entity->NeverRetire(
+      METRIC_tcmalloc_pageheap_fragmentation.InstantiateFunctionGauge(
+          entity, Bind(GetPageHeapFragmentation)));
+  entity->NeverRetire(
+      METRIC_tcmalloc_background_released_bytes.InstantiateFunctionGauge(
+          entity, Bind(process_memory::BackgroundReleasedBytes)));
+  entity->NeverRetire(
+      METRIC_tcmalloc_background_releases.InstantiateFunctionGauge(
+          entity, Bind(process_memory::BackgroundReleaseCount)));
 }
 
 } // namespace tcmalloc
@@ -15,8 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -34,12 +37,14 @@
 #include "kudu/server/default_path_handlers.h"
 #include "kudu/server/webserver.h"
 #include "kudu/server/webserver_options.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/curl_util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -49,7 +54,10 @@ using std::string;
 using std::vector;
 using std::unique_ptr;
 
+DECLARE_int32(webserver_max_concurrent_renders_per_page);
 DECLARE_int32(webserver_max_post_length_bytes);
+DECLARE_int32(webserver_render_cache_max_staleness_ms);
+DECLARE_int32(webserver_render_cache_ms);
 
 DEFINE_bool(test_sensitive_flag, false, "a sensitive flag");
 TAG_FLAG(test_sensitive_flag, sensitive);
@@ -234,6 +242,84 @@ TEST_F(WebserverTest, TestPostTooBig) {
   ASSERT_EQ("Remote error: HTTP 413", s.ToString());
 }
 
+// Test that the response of a streaming handler, which is larger than a single
+// chunk of the chunked encoding, arrives whole.
+TEST_F(WebserverTest, TestStreamingPathHandler) {
+  string expected;
+  for (int i = 0; i < 100000; i++) {
+    expected += std::to_string(i);
+  }
+  server_->RegisterStreamingPathHandler(
+      "/streaming", "Streaming",
+      [&](const Webserver::WebRequest& /*req*/, std::ostream* output) {
+        for (int i = 0; i < 100000; i++) {
+          *output << i;
+        }
+      },
+      "text/plain", /*is_on_nav_bar=*/false);
+  ASSERT_OK(curl_.FetchURL(strings::Substitute("http://$0/streaming", addr_.ToString()),
+                           &buf_));
+  ASSERT_EQ(expected, buf_.ToString());
+}
+
+// Test that the renders of a page are reused within --webserver_render_cache_ms,
+// and that the requests beyond --webserver_max_concurrent_renders_per_page are
+// served the cached render of the page, or rejected if it is too stale.
+TEST_F(WebserverTest, TestRenderCache) {
+  std::atomic<int> renders(0);
+  std::atomic<bool> block_renders(false);
+  CountDownLatch rendering(1);
+  CountDownLatch unblock(1);
+  server_->RegisterPrerenderedPathHandler(
+      "/counter", "",
+      [&](const Webserver::WebRequest& /*req*/, Webserver::PrerenderedWebResponse* resp) {
+        int n = ++renders;
+        if (block_renders) {
+          rendering.CountDown();
+          unblock.Wait();
+        }
+        *resp->output << n;
+      },
+      /*is_styled=*/false, /*is_on_nav_bar=*/false);
+  const string url = strings::Substitute("http://$0/counter", addr_.ToString());
+
+  // By default, every request renders the page.
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_EQ("1", buf_.ToString());
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_EQ("2", buf_.ToString());
+
+  // Recent renders are reused by the requests with the same query string.
+  FLAGS_webserver_render_cache_ms = 60 * 1000;
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_EQ("2", buf_.ToString());
+  ASSERT_OK(curl_.FetchURL(url + "?foo=bar", &buf_));
+  ASSERT_EQ("3", buf_.ToString());
+  FLAGS_webserver_render_cache_ms = 0;
+
+  // While a request is rendering the page, the others get its cached render.
+  FLAGS_webserver_max_concurrent_renders_per_page = 1;
+  block_renders = true;
+  std::thread t([&]() {
+    EasyCurl curl;
+    faststring buf;
+    CHECK_OK(curl.FetchURL(url, &buf));
+    CHECK_EQ("4", buf.ToString());
+  });
+  SCOPED_CLEANUP({
+    unblock.CountDown();
+    t.join();
+  });
+  rendering.Wait();
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_EQ("2", buf_.ToString());
+
+  // ... unless the cached render is too stale.
+  FLAGS_webserver_render_cache_max_staleness_ms = 0;
+  Status s = curl_.FetchURL(url, &buf_);
+  ASSERT_EQ("Remote error: HTTP 503", s.ToString());
+}
+
 // Test that static files are served and that directory listings are
 // disabled.
 TEST_F(WebserverTest, TestStaticFiles) {
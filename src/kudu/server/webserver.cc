@@ -20,13 +20,16 @@
 #include <algorithm>
 #include <csignal>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -54,6 +57,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/version_info.h"
 
@@ -65,6 +69,7 @@ typedef sig_t sighandler_t;
 
 using mustache::RenderTemplate;
 using std::ostringstream;
+using std::shared_ptr;
 using std::stringstream;
 using std::string;
 using std::vector;
@@ -81,6 +86,30 @@ DEFINE_string(webserver_x_frame_options, "DENY",
               "to all responses. This can help prevent clickjacking attacks.");
 TAG_FLAG(webserver_x_frame_options, advanced);
 
+DEFINE_int32(webserver_render_cache_ms, 0,
+             "If positive, a GET request for a page is served the cached output of an "
+             "earlier request for the page with the same query string, if that output was "
+             "rendered less than this many milliseconds ago, instead of rendering the page "
+             "again. Does not apply to streamed pages.");
+TAG_FLAG(webserver_render_cache_ms, advanced);
+TAG_FLAG(webserver_render_cache_ms, runtime);
+
+DEFINE_int32(webserver_max_concurrent_renders_per_page, 4,
+             "The maximum number of requests which may render a single page of the "
+             "embedded web server at once. Further requests for the page are served its "
+             "latest cached output if it is no older than "
+             "--webserver_render_cache_max_staleness_ms, and are rejected otherwise. "
+             "Bounds the work done, and the server locks held, by the web server while "
+             "many clients poll expensive pages. Does not apply to streamed pages.");
+TAG_FLAG(webserver_max_concurrent_renders_per_page, advanced);
+TAG_FLAG(webserver_max_concurrent_renders_per_page, runtime);
+
+DEFINE_int32(webserver_render_cache_max_staleness_ms, 10000,
+             "The maximum age of the cached output of a page which is served while "
+             "--webserver_max_concurrent_renders_per_page requests are rendering the page.");
+TAG_FLAG(webserver_render_cache_max_staleness_ms, advanced);
+TAG_FLAG(webserver_render_cache_max_staleness_ms, runtime);
+
 
 namespace {
   // Last error message from the webserver.
@@ -453,37 +482,43 @@ int Webserver::RunPathHandler(const PathHandler& handler,
     }
   }
 
+  if (handler.is_streaming()) {
+    return RunStreamingPathHandler(handler, req, connection, request_info);
+  }
+
   if (!handler.is_styled() || ContainsKey(req.parsed_args, "raw")) {
     use_style = false;
   }
 
-  ostringstream content;
-  PrerenderedWebResponse resp { HttpStatusCode::Ok, HttpResponseHeaders{}, &content };
-  // Enable or disable redaction from the web UI based on the setting of --redact.
-  // This affects operations like default value and scan predicate pretty printing.
-  if (kudu::g_should_redact == kudu::RedactContext::ALL) {
-    handler.callback()(req, &resp);
-  } else {
-    ScopedDisableRedaction s;
-    handler.callback()(req, &resp);
+  shared_ptr<const CachedRender> render;
+  Status s = GetPageRender(handler, req, &render);
+  if (!s.ok()) {
+    string msg = s.ToString();
+    sq_printf(connection,
+              "HTTP/1.1 %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n"
+              "Retry-After: 1\r\n\r\n",
+              HttpStatusCodeToString(HttpStatusCode::ServiceUnavailable).c_str(),
+              msg.length());
+    sq_write(connection, msg.c_str(), msg.length());
+    return 1;
   }
 
   string full_content;
   if (use_style) {
     stringstream output;
-    RenderMainTemplate(content.str(), &output);
+    RenderMainTemplate(render->content, &output);
     full_content = output.str();
   } else {
-    full_content = content.str();
+    full_content = render->content;
   }
 
   ostringstream headers_stream;
-  headers_stream << Substitute("HTTP/1.1 $0\r\n", HttpStatusCodeToString(resp.status_code));
+  headers_stream << Substitute("HTTP/1.1 $0\r\n", HttpStatusCodeToString(render->status_code));
   headers_stream << Substitute("Content-Type: $0\r\n", use_style ? "text/html" : "text/plain");
   headers_stream << Substitute("Content-Length: $0\r\n", full_content.length());
   headers_stream << Substitute("X-Frame-Options: $0\r\n", FLAGS_webserver_x_frame_options);
   std::unordered_set<string> invalid_headers{"Content-Type", "Content-Length", "X-Frame-Options"};
-  for (const auto& entry : resp.response_headers) {
+  for (const auto& entry : render->response_headers) {
     // It's forbidden to override the above headers.
     if (ContainsKey(invalid_headers, entry.first)) {
       LOG(FATAL) << "Reserved header " << entry.first << " was overridden "
@@ -500,6 +535,191 @@ int Webserver::RunPathHandler(const PathHandler& handler,
   return 1;
 }
 
+Status Webserver::GetPageRender(const PathHandler& handler,
+                                const WebRequest& req,
+                                shared_ptr<const CachedRender>* render) {
+  // The maximum number of query strings whose renders are cached per page.
+  static constexpr size_t kMaxCachedRendersPerPage = 8;
+
+  // Only the output of GET requests is reused.
+  bool cacheable = req.request_method == "GET";
+  RenderCache* cache = handler.render_cache();
+  MonoTime now = MonoTime::Now();
+  {
+    std::lock_guard<simple_spinlock> l(cache->lock);
+    shared_ptr<const CachedRender> cached;
+    if (cacheable) {
+      const auto* entry = FindOrNull(cache->renders, req.query_string);
+      if (entry) {
+        cached = *entry;
+      }
+    }
+    if (cached && FLAGS_webserver_render_cache_ms > 0 &&
+        now - cached->rendered_at < MonoDelta::FromMilliseconds(FLAGS_webserver_render_cache_ms)) {
+      *render = std::move(cached);
+      return Status::OK();
+    }
+    if (cache->renders_in_flight >= FLAGS_webserver_max_concurrent_renders_per_page) {
+      if (cached && now - cached->rendered_at <
+          MonoDelta::FromMilliseconds(FLAGS_webserver_render_cache_max_staleness_ms)) {
+        *render = std::move(cached);
+        return Status::OK();
+      }
+      return Status::ServiceUnavailable(Substitute(
+          "$0 requests are already rendering this page", cache->renders_in_flight));
+    }
+    cache->renders_in_flight++;
+  }
+  SCOPED_CLEANUP({
+    std::lock_guard<simple_spinlock> l(cache->lock);
+    cache->renders_in_flight--;
+  });
+
+  ostringstream content;
+  PrerenderedWebResponse resp { HttpStatusCode::Ok, HttpResponseHeaders{}, &content };
+  // Enable or disable redaction from the web UI based on the setting of --redact.
+  // This affects operations like default value and scan predicate pretty printing.
+  if (kudu::g_should_redact == kudu::RedactContext::ALL) {
+    handler.callback()(req, &resp);
+  } else {
+    ScopedDisableRedaction s;
+    handler.callback()(req, &resp);
+  }
+
+  // The render is as old as the state it was rendered from, so it is dated
+  // from before the callback ran.
+  auto new_render = std::make_shared<CachedRender>();
+  new_render->rendered_at = now;
+  new_render->status_code = resp.status_code;
+  new_render->response_headers = std::move(resp.response_headers);
+  new_render->content = content.str();
+
+  if (cacheable && new_render->status_code == HttpStatusCode::Ok) {
+    std::lock_guard<simple_spinlock> l(cache->lock);
+    const auto* entry = FindOrNull(cache->renders, req.query_string);
+    if (!entry && cache->renders.size() >= kMaxCachedRendersPerPage) {
+      // Make room by evicting the oldest render.
+      auto oldest = cache->renders.begin();
+      for (auto i = cache->renders.begin(); i != cache->renders.end(); ++i) {
+        if (i->second->rendered_at < oldest->second->rendered_at) {
+          oldest = i;
+        }
+      }
+      cache->renders.erase(oldest);
+    }
+    // Don't replace a render by an older one finished later.
+    if (!entry || (*entry)->rendered_at < now) {
+      cache->renders[req.query_string] = new_render;
+    }
+  }
+  *render = std::move(new_render);
+  return Status::OK();
+}
+
+namespace {
+
+// A stream buffer which sends the data written to it to a webserver
+// connection, as the chunks of a response using the chunked transfer
+// encoding if 'chunked' is true, or as is otherwise.
+class ChunkedResponseStreamBuf : public std::streambuf {
+ public:
+  ChunkedResponseStreamBuf(struct sq_connection* connection, bool chunked)
+      : connection_(connection),
+        chunked_(chunked),
+        failed_(false),
+        buf_(kChunkSize) {
+    setp(buf_.data(), buf_.data() + buf_.size());
+  }
+
+  // Sends the buffered data and, with the chunked encoding, the last chunk.
+  void Finish() {
+    SendChunk();
+    if (chunked_) {
+      Send("0\r\n\r\n", 5);
+    }
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    SendChunk();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return failed_ ? traits_type::eof() : traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    SendChunk();
+    return failed_ ? -1 : 0;
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  void SendChunk() {
+    size_t len = pptr() - pbase();
+    if (len == 0) {
+      return;
+    }
+    if (chunked_) {
+      char header[32];
+      int header_len = snprintf(header, sizeof(header), "%zx\r\n", len);
+      Send(header, header_len);
+      Send(pbase(), len);
+      Send("\r\n", 2);
+    } else {
+      Send(pbase(), len);
+    }
+    setp(buf_.data(), buf_.data() + buf_.size());
+  }
+
+  // Once a write failed, e.g. because the client went away, the rest of the
+  // response is dropped.
+  void Send(const char* data, size_t len) {
+    if (!failed_ && sq_write(connection_, data, len) != static_cast<int>(len)) {
+      failed_ = true;
+    }
+  }
+
+  struct sq_connection* const connection_;
+  const bool chunked_;
+  bool failed_;
+  vector<char> buf_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChunkedResponseStreamBuf);
+};
+
+} // anonymous namespace
+
+int Webserver::RunStreamingPathHandler(const PathHandler& handler,
+                                       const WebRequest& req,
+                                       struct sq_connection* connection,
+                                       struct sq_request_info* request_info) {
+  // Only HTTP/1.1 clients understand the chunked encoding: the responses to
+  // the others are delimited by closing the connection.
+  bool chunked = request_info->http_version != nullptr &&
+      strcmp(request_info->http_version, "1.1") == 0;
+  string headers = Substitute("HTTP/1.1 $0\r\n", HttpStatusCodeToString(HttpStatusCode::Ok));
+  headers += Substitute("Content-Type: $0\r\n", handler.content_type());
+  headers += Substitute("X-Frame-Options: $0\r\n", FLAGS_webserver_x_frame_options);
+  headers += chunked ? "Transfer-Encoding: chunked\r\n" : "Connection: close\r\n";
+  headers += "\r\n";
+  sq_write(connection, headers.c_str(), headers.length());
+
+  ChunkedResponseStreamBuf buf(connection, chunked);
+  std::ostream output(&buf);
+  // Enable or disable redaction from the web UI based on the setting of --redact.
+  if (kudu::g_should_redact == kudu::RedactContext::ALL) {
+    handler.streaming_callback()(req, &output);
+  } else {
+    ScopedDisableRedaction s;
+    handler.streaming_callback()(req, &output);
+  }
+  buf.Finish();
+  return 1;
+}
+
 void Webserver::RegisterPathHandler(const string& path, const string& alias,
     const PathHandlerCallback& callback, bool is_styled, bool is_on_nav_bar) {
   string render_path = (path == "/") ? "/home" : path;
@@ -522,6 +742,14 @@ void Webserver::RegisterPrerenderedPathHandler(const string& path, const string&
   InsertOrDie(&path_handlers_, path, new PathHandler(is_styled, is_on_nav_bar, alias, callback));
 }
 
+void Webserver::RegisterStreamingPathHandler(const string& path, const string& alias,
+    const StreamingPathHandlerCallback& callback, const string& content_type,
+    bool is_on_nav_bar) {
+  std::lock_guard<RWMutex> l(lock_);
+  InsertOrDie(&path_handlers_, path,
+              new PathHandler(is_on_nav_bar, alias, content_type, callback));
+}
+
 string Webserver::MustachePartialTag(const string& path) const {
   return Substitute("{{> $0.mustache}}", path);
 }
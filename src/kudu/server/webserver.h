@@ -19,12 +19,16 @@
 
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "kudu/gutil/port.h"
 #include "kudu/server/webserver_options.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/status.h"
@@ -78,6 +82,14 @@ class Webserver : public WebCallbackRegistry {
                                       bool is_styled,
                                       bool is_on_nav_bar) override;
 
+  // Register a route 'path' whose response is streamed to the client using the
+  // chunked transfer encoding. See RegisterStreamingPathHandler in
+  // WebCallbackRegistry for details.
+  void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                    const StreamingPathHandlerCallback& callback,
+                                    const std::string& content_type,
+                                    bool is_on_nav_bar) override;
+
   // Change the footer HTML to be displayed at the bottom of all styled web pages.
   void set_footer_html(const std::string& html);
 
@@ -85,6 +97,27 @@ class Webserver : public WebCallbackRegistry {
   bool IsSecure() const;
 
  private:
+  // The output of a single render of a prerendered page, before it is
+  // wrapped in the main template.
+  struct CachedRender {
+    MonoTime rendered_at;
+    HttpStatusCode status_code;
+    HttpResponseHeaders response_headers;
+    std::string content;
+  };
+
+  // Bookkeeping of the renders of a single prerendered page.
+  struct RenderCache {
+    simple_spinlock lock;
+
+    // The number of renders of the page in progress.
+    int renders_in_flight = 0;
+
+    // The latest successful render of the page for each query string it was
+    // requested with.
+    std::unordered_map<std::string, std::shared_ptr<const CachedRender>> renders;
+  };
+
   // Container class for a list of path handler callbacks for a single URL.
   class PathHandler {
    public:
@@ -95,10 +128,24 @@ class Webserver : public WebCallbackRegistry {
           alias_(std::move(alias)),
           callback_(std::move(callback)) {}
 
+    PathHandler(bool is_on_nav_bar, std::string alias, std::string content_type,
+                StreamingPathHandlerCallback streaming_callback)
+        : is_styled_(false),
+          is_on_nav_bar_(is_on_nav_bar),
+          alias_(std::move(alias)),
+          content_type_(std::move(content_type)),
+          streaming_callback_(std::move(streaming_callback)) {}
+
     bool is_styled() const { return is_styled_; }
     bool is_on_nav_bar() const { return is_on_nav_bar_; }
+    bool is_streaming() const { return !streaming_callback_.empty(); }
     const std::string& alias() const { return alias_; }
+    const std::string& content_type() const { return content_type_; }
     const PrerenderedPathHandlerCallback& callback() const { return callback_; }
+    const StreamingPathHandlerCallback& streaming_callback() const {
+      return streaming_callback_;
+    }
+    RenderCache* render_cache() const { return &render_cache_; }
 
    private:
     // If true, the page appears is rendered styled.
@@ -110,8 +157,18 @@ class Webserver : public WebCallbackRegistry {
     // Alias used when displaying this link on the nav bar.
     std::string alias_;
 
-    // Callback to render output for this page.
+    // Content type of the responses of a streaming page.
+    std::string content_type_;
+
+    // Callback to render output for this page. Unset for streaming pages.
     PrerenderedPathHandlerCallback callback_;
+
+    // Callback to stream the output of this page. Unset for other pages.
+    StreamingPathHandlerCallback streaming_callback_;
+
+    // Renders of this page which may be served again. Unused for streaming
+    // pages.
+    mutable RenderCache render_cache_;
   };
 
   bool static_pages_available() const;
@@ -146,6 +203,23 @@ class Webserver : public WebCallbackRegistry {
                      struct sq_connection* connection,
                      struct sq_request_info* request_info);
 
+  // Sets 'render' to the output of the prerendered 'handler' for request
+  // 'req': either a fresh render, or a cached one if it is recent enough per
+  // --webserver_render_cache_ms, or if the page is already being rendered by
+  // --webserver_max_concurrent_renders_per_page other requests. Returns
+  // Status::ServiceUnavailable if the page can't be rendered nor served
+  // from the cache.
+  Status GetPageRender(const PathHandler& handler,
+                       const WebRequest& req,
+                       std::shared_ptr<const CachedRender>* render);
+
+  // Runs the streaming 'handler' for request 'req', sending the response to
+  // 'connection' as it is written.
+  int RunStreamingPathHandler(const PathHandler& handler,
+                              const WebRequest& req,
+                              struct sq_connection* connection,
+                              struct sq_request_info* request_info);
+
   // Callback to funnel mongoose logs through glog.
   static int LogMessageCallbackStatic(const struct sq_connection* connection,
                                       const char* message);
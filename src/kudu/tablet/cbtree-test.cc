@@ -305,6 +305,81 @@ TEST_F(TestCBTree, TestInsertAndVerify) {
   }
 }
 
+// Inserts 'key' into 'tree', starting from the leaf node '*hint' if it's not
+// null, and sets '*hint' to the leaf node which the key went into.
+template<class T>
+static bool InsertWithHint(CBTree<T> *tree, const Slice &key, const Slice &val,
+                           LeafNode<T> **hint) {
+  PreparedMutation<T> mutation(key);
+  mutation.Prepare(tree, *hint);
+  if (mutation.exists()) {
+    return false;
+  }
+  bool ret = mutation.Insert(val);
+  *hint = mutation.leaf();
+  return ret;
+}
+
+// Check that inserts which start from the leaf node of the previous insert
+// end up in the right place, whether or not the key falls within that node.
+TEST_F(TestCBTree, TestInsertWithHint) {
+  CBTree<SmallFanoutTraits> t;
+  char kbuf[64];
+  char vbuf[64];
+
+  const int n_keys = 10000;
+  LeafNode<SmallFanoutTraits> *hint = nullptr;
+
+  // Insert the even keys in ascending order: the hint is the rightmost leaf,
+  // and covers every key.
+  for (int i = 0; i < n_keys; i += 2) {
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", i);
+    ASSERT_TRUE(InsertWithHint(&t, Slice(kbuf), Slice(vbuf), &hint))
+        << "Failed insert at iteration " << i;
+  }
+
+  // Insert the odd keys in ascending order, starting from the rightmost leaf:
+  // the first insert falls back to a traversal from the root, and the
+  // following inserts mostly go into the leaf of the previous one.
+  for (int i = 1; i < n_keys; i += 2) {
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", i);
+    ASSERT_TRUE(InsertWithHint(&t, Slice(kbuf), Slice(vbuf), &hint))
+        << "Failed insert at iteration " << i;
+  }
+
+  // Duplicates are found both through the hint and without it.
+  for (int i = 0; i < n_keys; i += 100) {
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "xxx_%d", i);
+    ASSERT_FALSE(InsertWithHint(&t, Slice(kbuf), Slice(vbuf), &hint))
+        << "Allowed duplicate insert at iteration " << i;
+  }
+
+  ASSERT_EQ(n_keys, t.count());
+  for (int i = 0; i < n_keys; i++) {
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", i);
+    VerifyGet(t, Slice(kbuf), Slice(vbuf));
+  }
+
+  // The keys are iterated in order.
+  gscoped_ptr<CBTreeIterator<SmallFanoutTraits> > iter(t.NewIterator());
+  bool exact;
+  iter->SeekAtOrAfter(Slice(""), &exact);
+  int count = 0;
+  while (iter->IsValid()) {
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", count);
+    ASSERT_EQ(string(kbuf), k.ToString());
+    count++;
+    iter->Next();
+  }
+  ASSERT_EQ(n_keys, count);
+}
+
 template<class TREE, class COLLECTION>
 static void InsertRandomKeys(TREE *t, int n_keys,
                              COLLECTION *inserted) {
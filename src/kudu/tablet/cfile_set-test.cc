@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -44,6 +45,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/stringpiece.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/tablet-test-util.h"
@@ -54,11 +56,15 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(tablet_use_secondary_indexes);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(scan_sample_unit_rows);
+DECLARE_int32(tablet_bitmap_index_max_cardinality);
 
 using std::shared_ptr;
 using std::string;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -322,6 +328,47 @@ TEST_F(TestCFileSet, TestRangeScan) {
   EXPECT_EQ(1, stats[2].blocks_read);
 }
 
+// Sample a rowset and ensure that whole units of rows are read or skipped, that
+// about the requested fraction is read, and that the same seed reads the same
+// sample.
+TEST_F(TestCFileSet, TestSampledScan) {
+  const int kNumRows = 100000;
+  FLAGS_scan_sample_unit_rows = 1000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  Schema key_schema = schema_.CreateKeyProjection();
+  auto scan_sample = [&](uint64_t seed, vector<string>* results) {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&key_schema));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    ScanSpec spec;
+    spec.set_sample(ScanSample(0.25, seed));
+    RETURN_NOT_OK(iter->Init(&spec));
+    return IterateToStringList(iter.get(), results);
+  };
+
+  vector<string> results;
+  ASSERT_OK(scan_sample(1, &results));
+  ASSERT_EQ(0, results.size() % FLAGS_scan_sample_unit_rows);
+  ASSERT_GT(results.size(), kNumRows / 8);
+  ASSERT_LT(results.size(), kNumRows / 2);
+  for (int i = 0; i < results.size(); i += FLAGS_scan_sample_unit_rows) {
+    int32_t first;
+    ASSERT_EQ(1, sscanf(results[i].c_str(), "(int32 c0=%d)", &first));
+    ASSERT_EQ(0, (first / 2) % FLAGS_scan_sample_unit_rows) << results[i];
+  }
+
+  vector<string> same_seed_results;
+  ASSERT_OK(scan_sample(1, &same_seed_results));
+  ASSERT_EQ(results, same_seed_results);
+
+  vector<string> other_seed_results;
+  ASSERT_OK(scan_sample(2, &other_seed_results));
+  ASSERT_NE(results, other_seed_results);
+}
+
 // Several other black-box tests for range scans. These are similar to
 // TestRangeScan above, except don't inspect internal state.
 TEST_F(TestCFileSet, TestRangePredicates2) {
@@ -349,6 +396,154 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
   DoTestRangeScan(fileset, kNumRows * 10, kNoBound);
 }
 
+// Parameterized on the maximum cardinality of bitmap indexes, so that the
+// indexes are written either as sorted indexes or as bitmap files.
+class TestCFileSetSecondaryIndex : public KuduRowSetTest,
+                                   public ::testing::WithParamInterface<int> {
+ public:
+  TestCFileSetSecondaryIndex()
+      : KuduRowSetTest(Schema({ ColumnSchema("key", INT32),
+                                ColumnSchema("val", STRING, true, nullptr, nullptr,
+                                             GetIndexedStorage()),
+                                ColumnSchema("tag", INT32, false, nullptr, nullptr,
+                                             GetIndexedStorage()) }, 1)) {
+  }
+
+  void SetUp() override {
+    KuduRowSetTest::SetUp();
+    FLAGS_cfile_default_block_size = 512;
+    FLAGS_tablet_bitmap_index_max_cardinality = GetParam();
+  }
+
+  // Writes 'nrows' rows whose value is "v<key % 10>", or NULL when the key is
+  // a multiple of 7, and whose tag is 'key % 3'.
+  void WriteTestRowSet(int nrows) {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+    RowBuilder rb(schema_);
+    for (int i = 0; i < nrows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      if (i % 7 == 0) {
+        rb.AddNull();
+      } else {
+        rb.AddString(Substitute("v$0", i % 10));
+      }
+      rb.AddInt32(i % 3);
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+
+  // Scans 'fileset' with 'preds' and returns the keys of the result rows.
+  vector<int32_t> ScanKeys(const shared_ptr<CFileSet>& fileset,
+                           const vector<ColumnPredicate>& preds) {
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    ScanSpec spec;
+    for (const auto& pred : preds) {
+      spec.AddPredicate(pred);
+    }
+    CHECK_OK(iter->Init(&spec));
+
+    vector<int32_t> keys;
+    Arena arena(1024);
+    RowBlock block(schema_, 100, &arena);
+    while (iter->HasNext()) {
+      CHECK_OK(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (block.selection_vector()->IsRowSelected(i)) {
+          keys.push_back(*schema_.ExtractColumnFromRow<INT32>(block.row(i), 0));
+        }
+      }
+    }
+    return keys;
+  }
+
+ private:
+  static ColumnStorageAttributes GetIndexedStorage() {
+    ColumnStorageAttributes attr;
+    attr.indexed = true;
+    return attr;
+  }
+
+ protected:
+  google::FlagSaver saver;
+};
+
+// Disable bitmap indexes, or write every index of the test as a bitmap file.
+INSTANTIATE_TEST_CASE_P(IndexForms, TestCFileSetSecondaryIndex, ::testing::Values(0, 256));
+
+// Scans using the secondary indexes return the same rows as scans without them.
+TEST_P(TestCFileSetSecondaryIndex, TestEqualityAndInListPredicates) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+  ASSERT_EQ(2, rowset_meta_->GetSecondaryIndexBlocksById().size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  ASSERT_GT(fileset->SecondaryIndexOnDiskSize(), 0);
+
+  Slice v3("v3");
+  Slice v1("v1");
+  Slice v5("v5");
+  Slice missing("zz");
+  vector<const void*> in_values = { &v1, &v5, &missing };
+  const ColumnSchema& col = schema_.column(1);
+  vector<ColumnPredicate> preds = {
+    ColumnPredicate::Equality(col, &v3),
+    ColumnPredicate::Equality(col, &missing),
+    ColumnPredicate::InList(col, &in_values),
+  };
+  vector<vector<int32_t>> expected(preds.size());
+  for (int i = 0; i < kNumRows; i++) {
+    if (i % 7 == 0) continue;
+    if (i % 10 == 3) expected[0].push_back(i);
+    if (i % 10 == 1 || i % 10 == 5) expected[2].push_back(i);
+  }
+
+  for (bool use_index : { true, false }) {
+    FLAGS_tablet_use_secondary_indexes = use_index;
+    for (size_t i = 0; i < preds.size(); i++) {
+      SCOPED_TRACE(Substitute("$0, use index: $1", preds[i].ToString(), use_index));
+      ASSERT_EQ(expected[i], ScanKeys(fileset, { preds[i] }));
+    }
+  }
+}
+
+// Predicates on several indexed columns are combined through their indexes.
+TEST_P(TestCFileSetSecondaryIndex, TestPredicatesOnSeveralColumns) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+
+  Slice v1("v1");
+  Slice v5("v5");
+  vector<const void*> in_values = { &v1, &v5 };
+  int32_t tag = 2;
+  int32_t max_key = kNumRows / 2;
+  vector<ColumnPredicate> preds = {
+    ColumnPredicate::InList(schema_.column(1), &in_values),
+    ColumnPredicate::Equality(schema_.column(2), &tag),
+    // A predicate which can't use an index.
+    ColumnPredicate::Range(schema_.column(0), nullptr, &max_key),
+  };
+  vector<int32_t> expected;
+  for (int i = 0; i < max_key; i++) {
+    if (i % 7 != 0 && (i % 10 == 1 || i % 10 == 5) && i % 3 == 2) {
+      expected.push_back(i);
+    }
+  }
+
+  for (bool use_index : { true, false }) {
+    FLAGS_tablet_use_secondary_indexes = use_index;
+    SCOPED_TRACE(Substitute("use index: $0", use_index));
+    ASSERT_EQ(expected, ScanKeys(fileset, preds));
+  }
+}
 
 } // namespace tablet
 } // namespace kudu
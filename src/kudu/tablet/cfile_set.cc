@@ -19,6 +19,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -28,19 +29,25 @@
 #include "kudu/cfile/bloomfile.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/column_stats.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -48,14 +55,37 @@
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/secondary_index.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(cfile_use_zone_maps, true,
+            "Whether scans consult cfile zone maps to skip blocks of rows which "
+            "cannot match a predicate");
+TAG_FLAG(cfile_use_zone_maps, runtime);
+TAG_FLAG(cfile_use_zone_maps, advanced);
+
+DEFINE_bool(tablet_use_secondary_indexes, true,
+            "Whether scans consult the secondary indexes of indexed columns to "
+            "skip the rows which cannot match an equality or IN-list predicate");
+TAG_FLAG(tablet_use_secondary_indexes, runtime);
+TAG_FLAG(tablet_use_secondary_indexes, advanced);
+
+DEFINE_int32(scan_sample_unit_rows, 4096,
+             "The number of consecutive rows of a rowset which sampled scans "
+             "include or leave out together. Smaller units make samples more "
+             "uniform but cut scans into smaller batches.");
+TAG_FLAG(scan_sample_unit_rows, advanced);
+
 namespace kudu {
 
 class MemTracker;
@@ -145,8 +175,24 @@ Status CFileSet::DoOpen() {
                              &ad_hoc_idx_reader_));
   }
 
-  // However, the key reader should always be fully opened, so that we
-  // can figure out where in the rowset tree we belong.
+  for (const auto& e : rowset_metadata_->GetSecondaryIndexBlocksById()) {
+    unique_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(rowset_metadata_->fs_manager()->OpenBlock(e.second, &block));
+    ReaderOptions opts;
+    opts.parent_mem_tracker = parent_mem_tracker_;
+    RETURN_NOT_OK(SecondaryIndexReader::Open(std::move(block), std::move(opts),
+                                             &secondary_index_readers_[e.first]));
+  }
+  secondary_index_readers_.shrink_to_fit();
+
+  // If the key bounds were persisted in the rowset metadata, the key reader
+  // may be opened lazily like the others.
+  if (rowset_metadata_->GetEncodedKeyBounds(&min_encoded_key_, &max_encoded_key_)) {
+    return Status::OK();
+  }
+
+  // Otherwise, the key reader must be fully opened, so that we can figure
+  // out where in the rowset tree we belong.
   RETURN_NOT_OK(key_index_reader()->Init());
 
   // Determine the upper and lower key bounds for this CFileSet.
@@ -213,7 +259,24 @@ CFileSet::Iterator *CFileSet::NewIterator(const Schema *projection) const {
 }
 
 Status CFileSet::CountRows(rowid_t *count) const {
-  return key_index_reader()->CountRows(count);
+  CFileReader* key_reader = key_index_reader();
+  RETURN_NOT_OK(key_reader->Init());
+  return key_reader->CountRows(count);
+}
+
+Status CFileSet::AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const {
+  CFileReader* reader = FindPointeeOrNull(readers_by_col_id_, col_id);
+  if (reader == nullptr) {
+    return Status::OK();
+  }
+  ColumnStatsPB file_stats;
+  Status s = reader->ReadColumnStats(&file_stats);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+  cfile::MergeColumnStats(file_stats, stats);
+  return Status::OK();
 }
 
 Status CFileSet::GetBounds(string* min_encoded_key,
@@ -230,6 +293,14 @@ uint64_t CFileSet::AdhocIndexOnDiskSize() const {
   return 0;
 }
 
+uint64_t CFileSet::SecondaryIndexOnDiskSize() const {
+  uint64_t ret = 0;
+  for (const auto& e : secondary_index_readers_) {
+    ret += e.second->file_size();
+  }
+  return ret;
+}
+
 uint64_t CFileSet::BloomFileOnDiskSize() const {
   return bloom_reader_->FileSize();
 }
@@ -242,6 +313,39 @@ uint64_t CFileSet::OnDiskDataSize() const {
   return ret;
 }
 
+Status CFileSet::GetEncodedKeyAtOrdinal(rowid_t ordinal, string* encoded_key) const {
+  CFileIterator* key_iter = nullptr;
+  RETURN_NOT_OK(NewKeyIterator(&key_iter));
+  unique_ptr<CFileIterator> key_iter_scoped(key_iter); // free on return
+  RETURN_NOT_OK(key_iter->SeekToOrdinal(ordinal));
+
+  // The ad-hoc index of a compound key holds the encoded keys, otherwise the
+  // key index is the key column itself.
+  const TypeInfo* type_info = ad_hoc_idx_reader_ ?
+      GetTypeInfo(BINARY) : tablet_schema().column(0).type_info();
+  Arena arena(1024);
+  alignas(16) uint8_t cell[16];
+  DCHECK_LE(type_info->size(), sizeof(cell));
+  ColumnBlock block(type_info, nullptr, cell, 1, &arena);
+  SelectionVector sel(1);
+  ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+  ctx.SetDecoderEvalNotSupported();
+  size_t n = 1;
+  RETURN_NOT_OK(key_iter->CopyNextValues(&n, &ctx));
+  if (n != 1) {
+    return Status::NotFound(Substitute("no row at ordinal $0", ordinal), ToString());
+  }
+
+  if (ad_hoc_idx_reader_) {
+    *encoded_key = reinterpret_cast<const Slice*>(cell)->ToString();
+  } else {
+    faststring buf;
+    GetKeyEncoder<faststring>(type_info).Encode(cell, true, &buf);
+    *encoded_key = buf.ToString();
+  }
+  return Status::OK();
+}
+
 Status CFileSet::FindRow(const RowSetKeyProbe &probe,
                          boost::optional<rowid_t>* idx,
                          ProbeStats* stats) const {
@@ -299,6 +403,59 @@ Status CFileSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
   return Status::OK();
 }
 
+Status CFileSet::CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                                  bool* present, rowid_t* rowids,
+                                  ProbeStats* const* stats) const {
+  // Keys for which the bloom filter can't be consulted may be present.
+  std::fill(present, present + num_probes, true);
+  if (FLAGS_consult_bloom_filters) {
+    // Fully open the BloomFileReader if it was lazily opened earlier.
+    //
+    // If it's already initialized, this is a no-op.
+    RETURN_NOT_OK(bloom_reader_->Init());
+
+    vector<const BloomKeyProbe*> bloom_probes(num_probes);
+    for (int i = 0; i < num_probes; i++) {
+      bloom_probes[i] = &probes[i]->bloom_probe();
+      stats[i]->blooms_consulted++;
+    }
+    Status s = bloom_reader_->CheckKeysPresent(bloom_probes.data(), num_probes, present);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 1) << Substitute("Unable to query bloom in $0: $1",
+          rowset_metadata_->bloom_block().ToString(), s.ToString());
+      if (PREDICT_FALSE(s.IsDiskFailure())) {
+        // If the bloom lookup failed because of a disk failure, return early
+        // since I/O to the tablet should be stopped.
+        return s;
+      }
+      // Continue with the slow path
+      std::fill(present, present + num_probes, true);
+    }
+  }
+
+  unique_ptr<CFileIterator> key_iter;
+  for (int i = 0; i < num_probes; i++) {
+    if (!present[i]) {
+      continue;
+    }
+    stats[i]->keys_consulted++;
+    if (!key_iter) {
+      CFileIterator *iter = nullptr;
+      RETURN_NOT_OK(NewKeyIterator(&iter));
+      key_iter.reset(iter);
+    }
+    bool exact;
+    Status s = key_iter->SeekAtOrAfter(probes[i]->encoded_key(), &exact);
+    if (s.IsNotFound() || (s.ok() && !exact)) {
+      present[i] = false;
+      continue;
+    }
+    RETURN_NOT_OK(s);
+    rowids[i] = key_iter->GetCurrentOrdinal();
+  }
+  return Status::OK();
+}
+
 Status CFileSet::NewKeyIterator(CFileIterator **key_iter) const {
   return key_index_reader()->NewIterator(key_iter, CFileReader::CACHE_BLOCK);
 }
@@ -312,7 +469,9 @@ CFileSet::Iterator::~Iterator() {
 Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
   DCHECK_EQ(0, col_iters_.size());
   vector<unique_ptr<ColumnIterator>> ret_iters;
+  vector<CFileReader*> ret_readers;
   ret_iters.reserve(projection_->num_columns());
+  ret_readers.reserve(projection_->num_columns());
 
   CFileReader::CacheControl cache_blocks = CFileReader::CACHE_BLOCK;
   if (spec && !spec->cache_blocks()) {
@@ -335,6 +494,7 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
       }
       ret_iters.emplace_back(new DefaultColumnValueIterator(col_schema.type_info(),
                                                             col_schema.read_default_value()));
+      ret_readers.push_back(nullptr);
       continue;
     }
     CFileIterator *iter;
@@ -342,9 +502,11 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
                           Substitute("could not create iterator for column $0",
                                      projection_->column(proj_col_idx).ToString()));
     ret_iters.emplace_back(iter);
+    ret_readers.push_back(FindOrDie(base_data_->readers_by_col_id_, col_id).get());
   }
 
   col_iters_.swap(ret_iters);
+  col_readers_.swap(ret_readers);
   return Status::OK();
 }
 
@@ -363,6 +525,18 @@ Status CFileSet::Iterator::Init(ScanSpec *spec) {
   // ordinal range.
   RETURN_NOT_OK(PushdownRangeScanPredicate(spec));
 
+  CollectIndexPredicates(spec);
+
+  if (spec != nullptr) {
+    sample_ = spec->sample();
+    if (spec->top_n_bound()) {
+      top_n_col_idx_ = projection_->find_column(spec->top_n_bound()->column().name());
+      if (top_n_col_idx_ != Schema::kColumnNotFound) {
+        top_n_bound_ = spec->top_n_bound();
+      }
+    }
+  }
+
   initted_ = true;
 
   // Don't actually seek -- we'll seek when we first actually read the
@@ -372,6 +546,25 @@ Status CFileSet::Iterator::Init(ScanSpec *spec) {
   return Status::OK();
 }
 
+void CFileSet::Iterator::CollectIndexPredicates(const ScanSpec* spec) {
+  if (spec == nullptr) {
+    return;
+  }
+  for (const auto& e : spec->predicates()) {
+    const ColumnPredicate& pred = e.second;
+    if (pred.predicate_type() != PredicateType::Equality &&
+        pred.predicate_type() != PredicateType::InList) {
+      continue;
+    }
+    int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound ||
+        !ContainsKey(base_data_->secondary_index_readers_, projection_->column_id(col_idx))) {
+      continue;
+    }
+    index_predicates_.emplace_back(col_idx, pred);
+  }
+}
+
 Status CFileSet::Iterator::PushdownRangeScanPredicate(ScanSpec *spec) {
   CHECK_GT(row_count_, 0);
 
@@ -444,6 +637,11 @@ Status CFileSet::Iterator::PrepareBatch(size_t *n) {
   if (*n > remaining) {
     *n = remaining;
   }
+  // Don't let a batch span several sample units.
+  if (sample_.enabled()) {
+    const size_t unit_rows = FLAGS_scan_sample_unit_rows;
+    *n = std::min(*n, unit_rows - cur_idx_ % unit_rows);
+  }
 
   prepared_count_ = *n;
 
@@ -489,14 +687,126 @@ Status CFileSet::Iterator::PrepareColumn(ColumnMaterializationContext *ctx) {
 }
 
 Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
+  if (sample_.enabled()) {
+    // Identify the unit of the batch by the rowset and the unit's index in it.
+    faststring unit_id;
+    PutFixed64(&unit_id, base_data_->rowset_metadata_->id());
+    PutFixed32(&unit_id, cur_idx_ / FLAGS_scan_sample_unit_rows);
+    if (!sample_.Includes(unit_id)) {
+      sel_vec->SetAllFalse();
+      return Status::OK();
+    }
+  }
   sel_vec->SetAllTrue();
   return Status::OK();
 }
 
+Status CFileSet::Iterator::ZoneMapsMayMatch(ColumnMaterializationContext *ctx,
+                                            bool* may_match) {
+  *may_match = true;
+  // Zone maps describe the base data only, so they can only be used to rule
+  // out rows when the predicate is evaluated against the base data, i.e.
+  // when decoder-level evaluation has not been disabled due to deltas.
+  if (ctx->pred() == nullptr || !ctx->DecoderEvalNotDisabled() ||
+      !FLAGS_cfile_use_zone_maps) {
+    return Status::OK();
+  }
+  CFileReader* reader = col_readers_[ctx->col_idx()];
+  if (reader == nullptr) {
+    return Status::OK();
+  }
+  return reader->ZoneMapsMayMatch(*ctx->pred(), cur_idx_, prepared_count_, may_match);
+}
+
+Status CFileSet::Iterator::TopNBoundMayMatch(bool* may_match) {
+  *may_match = true;
+  if (!top_n_bound_ || !FLAGS_cfile_use_zone_maps) {
+    return Status::OK();
+  }
+  CFileReader* reader = col_readers_[top_n_col_idx_];
+  if (reader == nullptr) {
+    return Status::OK();
+  }
+  top_n_arena_.Reset();
+  boost::optional<ColumnPredicate> pred = top_n_bound_->GetPredicate(&top_n_arena_);
+  if (!pred) {
+    return Status::OK();
+  }
+  return reader->ZoneMapsMayMatch(*pred, cur_idx_, prepared_count_, may_match);
+}
+
+Status CFileSet::Iterator::SecondaryIndexMayMatch(ColumnMaterializationContext *ctx,
+                                                  bool* may_match) {
+  *may_match = true;
+  // Like the zone maps, the secondary indexes describe the base data only.
+  // The indexed rows are only applied when materializing an indexed column
+  // with a predicate, which the scan evaluates on every batch anyway.
+  if (ctx->pred() == nullptr || !ctx->DecoderEvalNotDisabled() ||
+      !FLAGS_tablet_use_secondary_indexes ||
+      std::none_of(index_predicates_.begin(), index_predicates_.end(),
+                   [&](const std::pair<int, ColumnPredicate>& p) {
+                     return p.first == ctx->col_idx();
+                   })) {
+    return Status::OK();
+  }
+
+  if (!index_rows_) {
+    // Intersect the rows found for each predicate, so that the predicates on
+    // every indexed column are applied at once, without decoding any of them.
+    unique_ptr<RoaringBitmap> rows;
+    for (const auto& p : index_predicates_) {
+      const ColumnPredicate& pred = p.second;
+      vector<const void*> values;
+      if (pred.predicate_type() == PredicateType::Equality) {
+        values.push_back(pred.raw_lower());
+      } else {
+        values = pred.raw_values();
+      }
+      const SecondaryIndexReader* reader = FindOrDie(
+          base_data_->secondary_index_readers_, projection_->column_id(p.first)).get();
+      RoaringBitmap found;
+      RETURN_NOT_OK(reader->FindRows(projection_->column(p.first).type_info(), values, &found));
+      if (!rows) {
+        rows.reset(new RoaringBitmap(std::move(found)));
+      } else {
+        rows->IntersectWith(found);
+      }
+      if (rows->empty()) {
+        break;
+      }
+    }
+    index_rows_ = std::move(rows);
+  }
+
+  SelectionVector* sel = ctx->sel();
+  index_rows_->IntersectDenseBitmap(cur_idx_, prepared_count_, sel->mutable_bitmap());
+  *may_match = sel->AnySelected();
+  return Status::OK();
+}
+
 Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx) {
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
 
+  if (ctx->SkipUnselectedRows() && !ctx->sel()->AnySelected()) {
+    // Nothing in the batch needs this column: don't even seek it.
+    // PrepareColumn() will reposition it if a later batch reads it.
+    return Status::OK();
+  }
+
+  bool may_match;
+  RETURN_NOT_OK(ZoneMapsMayMatch(ctx, &may_match));
+  if (may_match) {
+    RETURN_NOT_OK(SecondaryIndexMayMatch(ctx, &may_match));
+  }
+  if (!may_match) {
+    // No row in the batch can pass the predicate: skip reading the column
+    // entirely and filter out the whole batch.
+    ctx->SetDecoderEvalSupported();
+    ctx->sel()->SetAllFalse();
+    return Status::OK();
+  }
+
   RETURN_NOT_OK(PrepareColumn(ctx));
   ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
 
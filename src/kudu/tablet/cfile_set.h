@@ -30,14 +30,18 @@
 #include <gtest/gtest_prod.h>
 
 #include "kudu/cfile/cfile_reader.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/rowid.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/roaring_bitmap.h"
 #include "kudu/util/status.h"
 
 namespace boost {
@@ -48,6 +52,7 @@ class optional;
 namespace kudu {
 
 class ColumnMaterializationContext;
+class ColumnStatsPB;
 class MemTracker;
 class ScanSpec;
 class SelectionVector;
@@ -60,6 +65,7 @@ class BloomFileReader;
 namespace tablet {
 
 class RowSetKeyProbe;
+class SecondaryIndexReader;
 struct ProbeStats;
 
 // Set of CFiles which make up the base data for a single rowset
@@ -80,6 +86,11 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
 
   Status CountRows(rowid_t *count) const;
 
+  // Merges the statistics of the CFile of column 'col_id' into '*stats'.
+  // Leaves '*stats' untouched if the column has no CFile, e.g. because it was
+  // added after this CFileSet was written, or if its CFile has no statistics.
+  Status AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const;
+
   // See RowSet::GetBounds
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const;
@@ -92,10 +103,17 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // Returns 0 if there are no bloomfiles.
   uint64_t BloomFileOnDiskSize() const;
 
+  // The on-disk size, in bytes, of this cfile set's secondary indexes.
+  // Returns 0 if there are no secondary indexes.
+  uint64_t SecondaryIndexOnDiskSize() const;
+
   // The size on-disk of this cfile set's data, in bytes.
-  // Excludes the ad hoc index and bloomfiles.
+  // Excludes the ad hoc index, secondary indexes and bloomfiles.
   uint64_t OnDiskDataSize() const;
 
+  // Sets 'encoded_key' to the encoded key of the row at 'ordinal'.
+  Status GetEncodedKeyAtOrdinal(rowid_t ordinal, std::string* encoded_key) const;
+
   // Determine the index of the given row key.
   // Sets *idx to boost::none if the row is not found.
   Status FindRow(const RowSetKeyProbe& probe,
@@ -111,11 +129,25 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                          rowid_t *rowid, ProbeStats* stats) const;
 
+  // Same as CheckRowPresent(), for each of the 'num_probes' probes in
+  // 'probes', which must be sorted by key. The bloom filter is probed for
+  // all of the keys at once, and a single key iterator is used for the keys
+  // which may be present.
+  Status CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                          bool* present, rowid_t* rowids,
+                          ProbeStats* const* stats) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
   }
 
+  // Returns the reader of the CFile for the given column ID, or null if there
+  // is none.
+  cfile::CFileReader* column_reader(ColumnId col_id) const {
+    return FindPointeeOrNull(readers_by_col_id_, col_id);
+  }
+
   virtual ~CFileSet();
 
  private:
@@ -159,6 +191,11 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // index pertains to more than one column, as in the case of composite keys.
   std::unique_ptr<cfile::CFileReader> ad_hoc_idx_reader_;
   std::unique_ptr<cfile::BloomFileReader> bloom_reader_;
+
+  // Map of column ID to the reader of the column's secondary index, for the
+  // columns which were indexed when this CFileSet was written.
+  typedef boost::container::flat_map<int, std::unique_ptr<SecondaryIndexReader>> IndexReaderMap;
+  IndexReaderMap secondary_index_readers_;
 };
 
 
@@ -203,6 +240,12 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // Collect the IO statistics for each of the underlying columns.
   virtual void GetIteratorStats(std::vector<IteratorStats> *stats) const OVERRIDE;
 
+  // Sets '*may_match' to false if the zone maps prove that no row of the
+  // prepared batch can be among the top N rows of the scan, as of its
+  // current bound. Zone maps describe the base data only, so the caller
+  // must make sure that the batch has no updates.
+  Status TopNBoundMayMatch(bool* may_match);
+
   virtual ~Iterator();
  private:
   DISALLOW_COPY_AND_ASSIGN(Iterator);
@@ -215,13 +258,19 @@ class CFileSet::Iterator : public ColumnwiseIterator {
         projection_(projection),
         initted_(false),
         cur_idx_(0),
-        prepared_count_(0) {
+        prepared_count_(0),
+        top_n_col_idx_(-1),
+        top_n_arena_(256) {
     CHECK_OK(base_data_->CountRows(&row_count_));
   }
 
   // Fill in col_iters_ for each of the requested columns.
   Status CreateColumnIterators(const ScanSpec* spec);
 
+  // Collect the equality and IN-list predicates of 'spec' which can be
+  // answered by the secondary indexes of this CFileSet.
+  void CollectIndexPredicates(const ScanSpec* spec);
+
   // Look for a predicate which can be converted into a range scan using the key
   // column's index. If such a predicate exists, remove it from the scan spec and
   // store it in member fields.
@@ -232,6 +281,15 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // Prepare the given column if not already prepared.
   Status PrepareColumn(ColumnMaterializationContext *ctx);
 
+  // Sets '*may_match' to false if the column's zone maps prove that no row in
+  // the prepared batch satisfies the context's predicate.
+  Status ZoneMapsMayMatch(ColumnMaterializationContext *ctx, bool* may_match);
+
+  // Deselects the rows of the prepared batch which the secondary indexes
+  // prove don't satisfy every indexed predicate of the scan, and sets
+  // '*may_match' to false if no row is left selected.
+  Status SecondaryIndexMayMatch(ColumnMaterializationContext *ctx, bool* may_match);
+
   const std::shared_ptr<CFileSet const> base_data_;
   const Schema* projection_;
 
@@ -239,6 +297,10 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   gscoped_ptr<cfile::CFileIterator> key_iter_;
   std::vector<std::unique_ptr<cfile::ColumnIterator>> col_iters_;
 
+  // The reader backing each entry of 'col_iters_', or nullptr for columns
+  // which have no data in this CFileSet. Used to consult zone maps.
+  std::vector<cfile::CFileReader*> col_readers_;
+
   bool initted_;
 
   size_t cur_idx_;
@@ -259,6 +321,25 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // materialized, it doesn't need to be read off disk.
   std::vector<bool> cols_prepared_;
 
+  // The predicates which can be answered by secondary indexes, along with
+  // the projection index of their column.
+  std::vector<std::pair<int, ColumnPredicate>> index_predicates_;
+
+  // The rows which the secondary indexes found for all of
+  // 'index_predicates_', looked up on first use.
+  std::unique_ptr<RoaringBitmap> index_rows_;
+
+  // The sample of the scan. Batches are cut at the boundaries of the units
+  // of --scan_sample_unit_rows rows, and those left out of the sample are
+  // deselected before any column is read.
+  ScanSample sample_;
+
+  // The bound of the top-N scan, if any and if its column is in the
+  // projection, along with the projection index of the column. The arena
+  // holds the bound's value while it's checked.
+  std::shared_ptr<TopNBound> top_n_bound_;
+  int top_n_col_idx_;
+  Arena top_n_arena_;
 };
 
 } // namespace tablet
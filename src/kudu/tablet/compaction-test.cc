@@ -34,6 +34,7 @@
 
 #include "kudu/clock/logical_clock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
@@ -88,6 +89,7 @@ DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
              "Number of rowsets as input to the merge");
 
 DECLARE_string(block_manager);
+DECLARE_int32(tablet_compaction_max_partitions);
 
 using std::shared_ptr;
 using std::string;
@@ -265,6 +267,15 @@ class TestCompaction : public KuduRowSetTest {
                                 &result));
   }
 
+  // Collects the rows of the tablet, sorted.
+  void CollectRows(vector<string>* rows) {
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(schema_, &iter));
+    ASSERT_OK(iter->Init(nullptr));
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+    std::sort(rows->begin(), rows->end());
+  }
+
   // Iterate over the given compaction input, stringifying and dumping each
   // yielded row to *out
   void IterateInput(CompactionInput *input, vector<string> *out) {
@@ -1107,6 +1118,99 @@ TEST_F(TestCompaction, TestConcurrentCompactionRowSetPicking) {
   ASSERT_EQ(kExpectedRows, num_rows);
 }
 
+// Test that a compaction split into key range partitions yields the same rows
+// as the input, with their updates and deletions.
+TEST_F(TestCompaction, TestPartitionedCompaction) {
+  FLAGS_tablet_compaction_max_partitions = 4;
+  LocalTabletWriter writer(tablet().get(), &client_schema());
+  KuduPartialRow row(&client_schema());
+  const int kNumRowSets = 3;
+  const int kNumRowsPerRowSet = 1000;
+
+  // Flush overlapping rowsets, then update and delete some of their rows.
+  for (int i = 0; i < kNumRowSets; i++) {
+    for (int j = 0; j < kNumRowsPerRowSet; j++) {
+      const int val = j * kNumRowSets + i;
+      ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", val)));
+      ASSERT_OK(row.SetInt32("val", val));
+      ASSERT_OK(writer.Insert(row));
+    }
+    ASSERT_OK(tablet()->Flush());
+  }
+  for (int val = 0; val < kNumRowSets * kNumRowsPerRowSet; val += 7) {
+    ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", val)));
+    if (val % 2 == 0) {
+      ASSERT_OK(row.SetInt32("val", -val));
+      ASSERT_OK(writer.Update(row));
+    } else {
+      ASSERT_OK(writer.Delete(row));
+    }
+  }
+
+  vector<string> rows_before;
+  NO_FATALS(CollectRows(&rows_before));
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+
+  // Every partition was written to its own rowset.
+  ASSERT_EQ(FLAGS_tablet_compaction_max_partitions, tablet()->num_rowsets());
+  vector<string> rows_after;
+  NO_FATALS(CollectRows(&rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+}
+
+// Test that a compaction of rowsets whose key ranges don't overlap copies the
+// data blocks of the non-key columns, and yields the same rows as its input.
+TEST_F(TestCompaction, TestCompactionCopiesUnchangedColumns) {
+  LocalTabletWriter writer(tablet().get(), &client_schema());
+  KuduPartialRow row(&client_schema());
+  const int kNumRowSets = 3;
+  const int kNumRowsPerRowSet = 1000;
+
+  for (int i = 0; i < kNumRowSets; i++) {
+    for (int j = 0; j < kNumRowsPerRowSet; j++) {
+      const int val = i * kNumRowsPerRowSet + j;
+      ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", 100000 + val)));
+      ASSERT_OK(row.SetInt32("val", val));
+      if (val % 2 == 0) {
+        ASSERT_OK(row.SetInt32("nullable_val", val));
+      } else {
+        ASSERT_OK(row.SetNull("nullable_val"));
+      }
+      ASSERT_OK(writer.Insert(row));
+    }
+    ASSERT_OK(tablet()->Flush());
+  }
+
+  vector<shared_ptr<RowSet>> rowsets;
+  tablet()->GetRowSetsForTests(&rowsets);
+  vector<shared_ptr<DiskRowSet>> sorted_rowsets;
+  vector<bool> encoded_cols;
+  ASSERT_OK(ChooseEncodedColumns(rowsets, *tablet()->schema(), HistoryGcOpts::Disabled(),
+                                 &sorted_rowsets, &encoded_cols));
+  ASSERT_EQ(vector<bool>({ false, true, true }), encoded_cols);
+  ASSERT_EQ(kNumRowSets, sorted_rowsets.size());
+
+  vector<string> rows_before;
+  NO_FATALS(CollectRows(&rows_before));
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  vector<string> rows_after;
+  NO_FATALS(CollectRows(&rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+
+  // Once a row is updated, the rowset's rows have to be merged again.
+  ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", 100000)));
+  ASSERT_OK(row.SetInt32("val", -1));
+  ASSERT_OK(writer.Update(row));
+  rowsets.clear();
+  tablet()->GetRowSetsForTests(&rowsets);
+  ASSERT_OK(ChooseEncodedColumns(rowsets, *tablet()->schema(), HistoryGcOpts::Disabled(),
+                                 &sorted_rowsets, &encoded_cols));
+  ASSERT_TRUE(encoded_cols.empty());
+  ASSERT_TRUE(sorted_rowsets.empty());
+}
+
 TEST_F(TestCompaction, TestCompactionFreesDiskSpace) {
   {
     // We must force the LocalTabletWriter out of scope before measuring
@@ -19,24 +19,39 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <string>
 #include <type_traits>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/cfile/type_encodings.h"
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/casts.h"
@@ -56,10 +71,29 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
-
+#include "kudu/util/slice.h"
+
+DEFINE_bool(compaction_copy_unchanged_columns, true,
+            "Whether compactions of rowsets whose key ranges don't overlap, and "
+            "whose rows have no pending updates or deletes, copy the data blocks "
+            "of the columns they don't rewrite instead of decoding and encoding "
+            "them again. Keys and indexed columns are always rewritten.");
+TAG_FLAG(compaction_copy_unchanged_columns, advanced);
+TAG_FLAG(compaction_copy_unchanged_columns, runtime);
+
+using kudu::cfile::BlockHandle;
+using kudu::cfile::BlockPointer;
+using kudu::cfile::CFileReader;
+using kudu::cfile::IndexTreeIterator;
+using kudu::cfile::TypeEncodingInfo;
+using kudu::cfile::ZoneMapBlockPB;
+using kudu::cfile::ZoneMapPB;
 using kudu::clock::HybridClock;
+using kudu::key_util::NormalizedKeyPrefix;
 using std::deque;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -67,6 +101,8 @@ using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
+DECLARE_bool(merge_use_normalized_key_prefixes);
+
 namespace kudu {
 namespace tablet {
 
@@ -76,6 +112,10 @@ namespace {
 // compaction.
 const int kCompactionOutputBlockNumRows = 100;
 
+// The number of keys sampled from each input rowset per partition, in order
+// to choose the split keys of a partitioned compaction.
+const int kSplitKeySamplesPerPartition = 8;
+
 // Advances to the last mutation in a mutation list.
 void AdvanceToLastInList(const Mutation** m) {
   if (*m == nullptr) return;
@@ -194,11 +234,17 @@ class MemRowSetCompactionInput : public CompactionInput {
 class DiskRowSetCompactionInput : public CompactionInput {
  public:
   DiskRowSetCompactionInput(gscoped_ptr<RowwiseIterator> base_iter,
+                            const CFileSet::Iterator* base_cfile_iter,
                             unique_ptr<DeltaIterator> redo_delta_iter,
-                            unique_ptr<DeltaIterator> undo_delta_iter)
+                            unique_ptr<DeltaIterator> undo_delta_iter,
+                            const EncodedKey* lower_bound,
+                            const EncodedKey* exclusive_upper_bound)
       : base_iter_(std::move(base_iter)),
+        base_cfile_iter_(base_cfile_iter),
         redo_delta_iter_(std::move(redo_delta_iter)),
         undo_delta_iter_(std::move(undo_delta_iter)),
+        lower_bound_(lower_bound),
+        exclusive_upper_bound_(exclusive_upper_bound),
         arena_(32 * 1024),
         block_(base_iter_->schema(), kRowsPerBlock, &arena_),
         redo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)),
@@ -208,11 +254,21 @@ class DiskRowSetCompactionInput : public CompactionInput {
   Status Init() override {
     ScanSpec spec;
     spec.set_cache_blocks(false);
+    if (lower_bound_) {
+      spec.SetLowerBoundKey(lower_bound_);
+    }
+    if (exclusive_upper_bound_) {
+      spec.SetExclusiveUpperBoundKey(exclusive_upper_bound_);
+    }
     RETURN_NOT_OK(base_iter_->Init(&spec));
+
+    // The key bounds were pushed down into a range of row ordinals: the deltas
+    // are read starting at the first row of that range.
+    first_rowid_in_block_ = base_iter_->HasNext() ? base_cfile_iter_->cur_ordinal_idx() : 0;
     RETURN_NOT_OK(redo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(first_rowid_in_block_));
     RETURN_NOT_OK(undo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(first_rowid_in_block_));
     return Status::OK();
   }
 
@@ -260,9 +316,14 @@ class DiskRowSetCompactionInput : public CompactionInput {
  private:
   DISALLOW_COPY_AND_ASSIGN(DiskRowSetCompactionInput);
   gscoped_ptr<RowwiseIterator> base_iter_;
+  // The iterator over the base data wrapped by 'base_iter_'.
+  const CFileSet::Iterator* base_cfile_iter_;
   unique_ptr<DeltaIterator> redo_delta_iter_;
   unique_ptr<DeltaIterator> undo_delta_iter_;
 
+  const EncodedKey* lower_bound_;
+  const EncodedKey* exclusive_upper_bound_;
+
   Arena arena_;
 
   // The current block of data which has come from the input iterator
@@ -360,6 +421,20 @@ void CopyMutations(Mutation* from, Mutation** to, Arena* arena) {
 
 class MergeCompactionInput : public CompactionInput {
  private:
+  // Compares the rows 'a' and 'b' by their normalized key prefixes if both
+  // are given, and by their keys if the prefixes are missing or equal.
+  static int CompareRows(const CompactionInputRow& a, const NormalizedKeyPrefix* a_prefix,
+                         const CompactionInputRow& b, const NormalizedKeyPrefix* b_prefix,
+                         const Schema& schema) {
+    if (a_prefix != nullptr && b_prefix != nullptr) {
+      int prefix_comp = a_prefix->Compare(*b_prefix);
+      if (prefix_comp != 0) {
+        return prefix_comp;
+      }
+    }
+    return schema.Compare(a.row, b.row);
+  }
+
   // State kept for each of the inputs.
   struct MergeState {
     MergeState() :
@@ -382,15 +457,30 @@ class MergeCompactionInput : public CompactionInput {
       return &pending[pending_idx];
     }
 
+    // The normalized key prefix of next(), or NULL if key prefixes aren't
+    // in use.
+    const NormalizedKeyPrefix* next_prefix() const {
+      return pending_prefixes.empty() ? nullptr : &pending_prefixes[pending_idx];
+    }
+
     void pop_front() {
       pending_idx++;
     }
 
     void Reset() {
       pending.clear();
+      pending_prefixes.clear();
       pending_idx = 0;
     }
 
+    // Encodes the normalized key prefixes of the pending rows.
+    void EncodePendingPrefixes() {
+      pending_prefixes.resize(pending.size());
+      for (int i = 0; i < pending.size(); i++) {
+        key_util::EncodeKeyPrefix(pending[i].row, &key_buf, &pending_prefixes[i]);
+      }
+    }
+
     // Return true if the current block of this input fully dominates
     // the current block of the other input -- i.e that the last
     // row of this block is less than the first row of the other block.
@@ -400,12 +490,19 @@ class MergeCompactionInput : public CompactionInput {
       DCHECK(!empty());
       DCHECK(!other.empty());
 
-      return schema.Compare(pending.back().row, (*other.next()).row) < 0;
+      const NormalizedKeyPrefix* last_prefix =
+          pending_prefixes.empty() ? nullptr : &pending_prefixes.back();
+      return CompareRows(pending.back(), last_prefix, *other.next(), other.next_prefix(),
+                         schema) < 0;
     }
 
     shared_ptr<CompactionInput> input;
     vector<CompactionInputRow> pending;
+    // The normalized key prefixes of the rows in 'pending', if in use.
+    vector<NormalizedKeyPrefix> pending_prefixes;
     int pending_idx;
+    // Scratch space for encoding the key prefixes.
+    faststring key_buf;
 
     vector<MergeState *> dominated;
   };
@@ -414,7 +511,8 @@ class MergeCompactionInput : public CompactionInput {
   MergeCompactionInput(const vector<shared_ptr<CompactionInput> > &inputs,
                        const Schema* schema)
     : schema_(schema),
-      num_dup_rows_(0) {
+      num_dup_rows_(0),
+      use_key_prefixes_(FLAGS_merge_use_normalized_key_prefixes) {
     for (const shared_ptr<CompactionInput> &input : inputs) {
       gscoped_ptr<MergeState> state(new MergeState);
       state->input = input;
@@ -457,6 +555,7 @@ class MergeCompactionInput : public CompactionInput {
     while (true) {
       int smallest_idx = -1;
       CompactionInputRow* smallest;
+      const NormalizedKeyPrefix* smallest_prefix = nullptr;
 
       // Iterate over the inputs to find the one with the smallest next row.
       // It may seem like an O(n lg k) merge using a heap would be more efficient,
@@ -477,14 +576,17 @@ class MergeCompactionInput : public CompactionInput {
         if (smallest_idx < 0) {
           smallest_idx = i;
           smallest = state->next();
+          smallest_prefix = state->next_prefix();
           DVLOG(4) << "Set (initial) smallest from state: " << i << " smallest: "
                    << CompactionInputRowToString(*smallest);
           continue;
         }
-        int row_comp = schema_->Compare(state->next()->row, smallest->row);
+        int row_comp = CompareRows(*state->next(), state->next_prefix(),
+                                   *smallest, smallest_prefix, *schema_);
         if (row_comp < 0) {
           smallest_idx = i;
           smallest = state->next();
+          smallest_prefix = state->next_prefix();
           DVLOG(4) << "Set (by comp) smallest from state: " << i << " smallest: "
                    << CompactionInputRowToString(*smallest);
           continue;
@@ -504,6 +606,7 @@ class MergeCompactionInput : public CompactionInput {
             states_[smallest_idx]->pop_front();
             smallest_idx = i;
             smallest = state->next();
+            smallest_prefix = state->next_prefix();
             DVLOG(4) << "Set smallest to right duplicate: "
                      << CompactionInputRowToString(*smallest);
             continue;
@@ -572,6 +675,9 @@ class MergeCompactionInput : public CompactionInput {
 
       state->Reset();
       RETURN_NOT_OK(state->input->PrepareBlock(&state->pending));
+      if (use_key_prefixes_) {
+        state->EncodePendingPrefixes();
+      }
 
       // Now that this input has moved to its next block, it's possible that
       // it no longer dominates the inputs in it 'dominated' list. Re-check
@@ -706,6 +812,9 @@ class MergeCompactionInput : public CompactionInput {
   vector<std::unique_ptr<RowBlock>> duplicated_rows_;
   int num_dup_rows_;
 
+  // Whether the rows are compared by their normalized key prefixes first.
+  const bool use_key_prefixes_;
+
   enum {
     kDuplicatedRowsPerBlock = 10
   };
@@ -851,25 +960,58 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
                                const Schema* projection,
                                const MvccSnapshot &snap,
                                gscoped_ptr<CompactionInput>* out) {
+  return Create(rowset, projection, snap, nullptr, nullptr, out);
+}
+
+Status CompactionInput::Create(const DiskRowSet &rowset,
+                               const Schema* projection,
+                               const MvccSnapshot &snap,
+                               const EncodedKey* lower_bound,
+                               const EncodedKey* exclusive_upper_bound,
+                               gscoped_ptr<CompactionInput>* out) {
+  // Using the "empty" snapshot ensures that all UNDO deltas are included.
+  return CreateDiskRowSetInput(rowset, projection, snap,
+                               MvccSnapshot::CreateSnapshotIncludingNoTransactions(),
+                               lower_bound, exclusive_upper_bound, out);
+}
+
+Status CompactionInput::Create(const DiskRowSet &rowset,
+                               const Schema* projection,
+                               const MvccSnapshot &snap,
+                               const MvccSnapshot &undo_snap,
+                               gscoped_ptr<CompactionInput>* out) {
+  return CreateDiskRowSetInput(rowset, projection, snap, undo_snap, nullptr, nullptr, out);
+}
+
+Status CompactionInput::CreateDiskRowSetInput(const DiskRowSet &rowset,
+                                              const Schema* projection,
+                                              const MvccSnapshot &snap,
+                                              const MvccSnapshot &undo_snap,
+                                              const EncodedKey* lower_bound,
+                                              const EncodedKey* exclusive_upper_bound,
+                                              gscoped_ptr<CompactionInput>* out) {
   CHECK(projection->has_column_ids());
 
-  shared_ptr<ColumnwiseIterator> base_cwise(rowset.base_data_->NewIterator(projection));
+  CFileSet::Iterator* base_cfile_iter = rowset.base_data_->NewIterator(projection);
+  shared_ptr<ColumnwiseIterator> base_cwise(base_cfile_iter);
   gscoped_ptr<RowwiseIterator> base_iter(new MaterializingIterator(base_cwise));
 
   // Creates a DeltaIteratorMerger that will only include the relevant REDO deltas.
   unique_ptr<DeltaIterator> redo_deltas;
   RETURN_NOT_OK_PREPEND(rowset.delta_tracker_->NewDeltaIterator(
       projection, snap, DeltaTracker::REDOS_ONLY, &redo_deltas), "Could not open REDOs");
-  // Creates a DeltaIteratorMerger that will only include UNDO deltas. Using the
-  // "empty" snapshot ensures that all deltas are included.
+  // Creates a DeltaIteratorMerger that will only include the UNDO deltas
+  // uncommitted in 'undo_snap'.
   unique_ptr<DeltaIterator> undo_deltas;
   RETURN_NOT_OK_PREPEND(rowset.delta_tracker_->NewDeltaIterator(
-      projection, MvccSnapshot::CreateSnapshotIncludingNoTransactions(),
-      DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
+      projection, undo_snap, DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
 
   out->reset(new DiskRowSetCompactionInput(std::move(base_iter),
+                                           base_cfile_iter,
                                            std::move(redo_deltas),
-                                           std::move(undo_deltas)));
+                                           std::move(undo_deltas),
+                                           lower_bound,
+                                           exclusive_upper_bound));
   return Status::OK();
 }
 
@@ -910,6 +1052,90 @@ Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
   return Status::OK();
 }
 
+Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
+                                                  const Schema* schema,
+                                                  const EncodedKey* lower_bound,
+                                                  const EncodedKey* exclusive_upper_bound,
+                                                  shared_ptr<CompactionInput> *out) const {
+  CHECK(schema->has_column_ids());
+
+  vector<shared_ptr<CompactionInput> > inputs;
+  for (const shared_ptr<RowSet> &rs : rowsets_) {
+    gscoped_ptr<CompactionInput> input;
+    RETURN_NOT_OK_PREPEND(CompactionInput::Create(*down_cast<DiskRowSet*>(rs.get()),
+                                                  schema, snap, lower_bound,
+                                                  exclusive_upper_bound, &input),
+                          Substitute("Could not create compaction input for rowset $0",
+                                     rs->ToString()));
+    inputs.push_back(shared_ptr<CompactionInput>(input.release()));
+  }
+
+  if (inputs.size() == 1) {
+    out->swap(inputs[0]);
+  } else {
+    out->reset(CompactionInput::Merge(inputs, schema));
+  }
+
+  return Status::OK();
+}
+
+Status RowSetsInCompaction::ChooseSplitKeys(int max_partitions,
+                                            vector<string>* split_keys) const {
+  return tablet::ChooseSplitKeys(rowsets_, max_partitions, split_keys);
+}
+
+Status ChooseSplitKeys(const RowSetVector& rowsets,
+                       int max_partitions,
+                       vector<string>* split_keys) {
+  split_keys->clear();
+  if (max_partitions <= 1) {
+    return Status::OK();
+  }
+
+  // Sample the keys of every rowset at evenly spaced rows, each sample
+  // standing for an equal share of the rowset's base data.
+  const int num_samples_per_rowset = max_partitions * kSplitKeySamplesPerPartition;
+  vector<pair<string, double>> samples;
+  double total_size = 0;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    const DiskRowSet* drs = down_cast<DiskRowSet*>(rs.get());
+    rowid_t num_rows;
+    RETURN_NOT_OK(drs->CountRows(&num_rows));
+    if (num_rows == 0) {
+      continue;
+    }
+    const int num_samples = std::min<int64_t>(num_rows, num_samples_per_rowset);
+    const double size = drs->OnDiskBaseDataSize();
+    for (int i = 0; i < num_samples; i++) {
+      string key;
+      RETURN_NOT_OK(drs->GetEncodedKeyAtOrdinal(
+          static_cast<int64_t>(num_rows) * i / num_samples, &key));
+      samples.emplace_back(std::move(key), size / num_samples);
+    }
+    total_size += size;
+  }
+  if (total_size <= 0) {
+    return Status::OK();
+  }
+  std::sort(samples.begin(), samples.end());
+
+  // Split where the running total of the samples crosses each multiple of
+  // the partition size. The first sample is the smallest key, which would
+  // leave the first partition empty.
+  double size_before = samples.empty() ? 0 : samples[0].second;
+  int partition = 1;
+  for (int i = 1; i < samples.size() && partition < max_partitions; i++) {
+    if (size_before >= total_size * partition / max_partitions &&
+        (split_keys->empty() || split_keys->back() != samples[i].first) &&
+        samples[i].first != samples[0].first) {
+      split_keys->push_back(samples[i].first);
+      partition++;
+    }
+    size_before += samples[i].second;
+  }
+  return Status::OK();
+}
+
 void RowSetsInCompaction::DumpToLog() const {
   LOG(INFO) << "Selected " << rowsets_.size() << " rowsets to compact:";
   // Dump the selected rowsets to the log, and collect corresponding iterators.
@@ -919,6 +1145,54 @@ void RowSetsInCompaction::DumpToLog() const {
   }
 }
 
+Status IsRowExpired(const HistoryGcOpts& history_gc_opts,
+                    const CompactionInputRow& row,
+                    const MvccSnapshot& snap,
+                    bool* is_expired) {
+  *is_expired = false;
+  if (!history_gc_opts.row_expiry_enabled()) {
+    return Status::OK();
+  }
+  const Schema* schema = row.row.schema();
+  const ColumnId col_id = history_gc_opts.expiry_col_id();
+  const int col_idx = schema->find_column_by_id(col_id);
+  if (col_idx == Schema::kColumnNotFound) {
+    return Status::OK();
+  }
+  DCHECK_EQ(UNIXTIME_MICROS, schema->column(col_idx).type_info()->type());
+
+  bool is_null = row.row.is_null(col_idx);
+  int64_t micros = 0;
+  if (!is_null) {
+    memcpy(&micros, row.row.cell_ptr(col_idx), sizeof(micros));
+  }
+  // The expiry column may have been updated since the base data was written.
+  for (const Mutation* mut = row.redo_head; mut != nullptr; mut = mut->acquire_next()) {
+    if (!snap.IsCommitted(mut->timestamp())) {
+      break;
+    }
+    RowChangeListDecoder decoder(mut->changelist());
+    RETURN_NOT_OK(decoder.Init());
+    if (decoder.is_delete()) {
+      continue;
+    }
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate dec;
+      RETURN_NOT_OK(decoder.DecodeNext(&dec));
+      if (dec.col_id != col_id) {
+        continue;
+      }
+      is_null = dec.null;
+      if (!is_null) {
+        DCHECK_EQ(sizeof(micros), dec.raw_value.size());
+        memcpy(&micros, dec.raw_value.data(), sizeof(micros));
+      }
+    }
+  }
+  *is_expired = !is_null && history_gc_opts.IsExpired(micros);
+  return Status::OK();
+}
+
 void RemoveAncientUndos(const HistoryGcOpts& history_gc_opts,
                         Mutation** undo_head,
                         const Mutation* redo_head,
@@ -1113,6 +1387,14 @@ Status FlushCompactionInput(CompactionInput* input,
 
       DVLOG(4) << "Input Row: " << CompactionInputRowToString(*input_row);
 
+      // Drop the rows expired by the row TTL, with all their history.
+      bool is_expired;
+      RETURN_NOT_OK(IsRowExpired(history_gc_opts, *input_row, snap, &is_expired));
+      if (is_expired) {
+        DVLOG(4) << "Dropping expired row";
+        continue;
+      }
+
       // Collect the new UNDO/REDO mutations.
       Mutation* new_undos_head = nullptr;
       Mutation* new_redos_head = nullptr;
@@ -1176,6 +1458,259 @@ Status FlushCompactionInput(CompactionInput* input,
   return Status::OK();
 }
 
+namespace {
+
+// Sets '*can_copy' to true if the data blocks of the CFile read by 'reader'
+// may be copied into the CFile which a DiskRowSetWriter writes for 'col'.
+// 'reader' is null if the rowset has no CFile for the column.
+Status CanCopyEncodedBlocks(const ColumnSchema& col, CFileReader* reader, bool* can_copy) {
+  *can_copy = false;
+  if (reader == nullptr) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(reader->Init());
+
+  // Resolve the encoding the way CFileWriter does.
+  const TypeEncodingInfo* encoding_info;
+  if (!TypeEncodingInfo::Get(col.type_info(), col.attributes().encoding, &encoding_info).ok()) {
+    RETURN_NOT_OK(TypeEncodingInfo::Get(col.type_info(),
+                                        TypeEncodingInfo::GetDefaultEncoding(col.type_info()),
+                                        &encoding_info));
+  }
+  const EncodingType encoding = encoding_info->encoding_type();
+  *can_copy = reader->type_info()->type() == col.type_info()->type() &&
+      reader->is_nullable() == col.is_nullable() &&
+      reader->has_posidx() &&
+      reader->type_encoding_info()->encoding_type() == encoding &&
+      TypeEncodingInfo::FirstOrdinalOffset(col.type_info(), encoding) >= 0 &&
+      // Copying blocks without zone maps would leave the output without any.
+      (reader->has_zone_maps() || !IsTypeAllowableInKey(col.type_info()));
+  return Status::OK();
+}
+
+// Appends the data blocks of the CFile read by 'reader', which must hold
+// 'num_rows' values, to the column at 'col_idx' of 'out'.
+Status CopyEncodedBlocks(CFileReader* reader,
+                         int col_idx,
+                         rowid_t num_rows,
+                         RollingDiskRowSetWriter* out) {
+  rowid_t file_rows;
+  RETURN_NOT_OK(reader->CountRows(&file_rows));
+  if (file_rows != num_rows) {
+    return Status::Corruption(Substitute("CFile $0 has $1 rows, expected $2",
+                                         reader->ToString(), file_rows, num_rows));
+  }
+  if (num_rows == 0) {
+    return Status::OK();
+  }
+
+  // The positional index holds the first ordinal of every data block.
+  vector<pair<rowid_t, BlockPointer>> blocks;
+  gscoped_ptr<IndexTreeIterator> posidx_iter(
+      IndexTreeIterator::Create(reader, reader->posidx_root()));
+  RETURN_NOT_OK(posidx_iter->SeekToFirst());
+  while (true) {
+    Slice key = posidx_iter->GetCurrentKey();
+    rowid_t first_ordinal;
+    RETURN_NOT_OK(KeyEncoderTraits<UINT32, faststring>::DecodeKeyPortion(
+        &key, true, nullptr, reinterpret_cast<uint8_t*>(&first_ordinal)));
+    blocks.emplace_back(first_ordinal, posidx_iter->GetCurrentBlockPointer());
+    if (!posidx_iter->HasNext()) {
+      break;
+    }
+    RETURN_NOT_OK(posidx_iter->Next());
+  }
+
+  const ZoneMapBlockPB* zone_maps = nullptr;
+  if (reader->has_zone_maps()) {
+    RETURN_NOT_OK(reader->GetBlockZoneMaps(&zone_maps));
+    if (zone_maps->zone_maps_size() != static_cast<int>(blocks.size())) {
+      return Status::Corruption(Substitute("CFile $0 has $1 zone maps for $2 data blocks",
+                                           reader->ToString(), zone_maps->zone_maps_size(),
+                                           blocks.size()));
+    }
+  }
+
+  for (int b = 0; b < blocks.size(); b++) {
+    const rowid_t first_ordinal = blocks[b].first;
+    const rowid_t end_ordinal = b + 1 < blocks.size() ? blocks[b + 1].first : num_rows;
+    const ZoneMapPB* zone_map = zone_maps ? &zone_maps->zone_maps(b) : nullptr;
+    if ((b == 0 && first_ordinal != 0) || first_ordinal >= end_ordinal ||
+        (zone_map && (zone_map->first_ordinal() != first_ordinal ||
+                      zone_map->num_values() != end_ordinal - first_ordinal))) {
+      return Status::Corruption(Substitute("bad positional index entry for block $0 of CFile $1",
+                                           blocks[b].second.ToString(), reader->ToString()));
+    }
+    BlockHandle handle;
+    RETURN_NOT_OK(reader->ReadBlock(blocks[b].second, CFileReader::DONT_CACHE_BLOCK, &handle));
+    RETURN_NOT_OK(out->AppendEncodedDataBlock(col_idx, handle.data(),
+                                              end_ordinal - first_ordinal, zone_map));
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status ChooseEncodedColumns(const RowSetVector& rowsets,
+                            const Schema& schema,
+                            const HistoryGcOpts& history_gc_opts,
+                            vector<shared_ptr<DiskRowSet>>* sorted_rowsets,
+                            vector<bool>* encoded_cols) {
+  sorted_rowsets->clear();
+  encoded_cols->clear();
+  if (!FLAGS_compaction_copy_unchanged_columns || history_gc_opts.row_expiry_enabled()) {
+    return Status::OK();
+  }
+
+  // The snapshot was taken before the REDO stores are checked: any mutation
+  // which isn't in a store by now was committed after the snapshot.
+  vector<pair<string, shared_ptr<DiskRowSet>>> min_keys;
+  vector<string> max_keys;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    shared_ptr<DiskRowSet> drs = std::dynamic_pointer_cast<DiskRowSet>(rs);
+    if (!drs || !drs->DeltaMemStoreEmpty() ||
+        drs->delta_tracker()->CountRedoDeltaStores() > 0) {
+      return Status::OK();
+    }
+    string min_key;
+    string max_key;
+    RETURN_NOT_OK(drs->GetBounds(&min_key, &max_key));
+    min_keys.emplace_back(std::move(min_key), std::move(drs));
+    max_keys.emplace_back(std::move(max_key));
+  }
+  vector<int> order(min_keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return Slice(min_keys[a].first).compare(Slice(min_keys[b].first)) < 0;
+  });
+  for (int i = 1; i < order.size(); i++) {
+    if (Slice(max_keys[order[i - 1]]).compare(Slice(min_keys[order[i]].first)) >= 0) {
+      return Status::OK();
+    }
+  }
+
+  vector<bool> cols(schema.num_columns(), false);
+  bool any_col = false;
+  for (int i = schema.num_key_columns(); i < schema.num_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (col.attributes().indexed) {
+      continue;
+    }
+    bool can_copy = true;
+    for (int j = 0; j < min_keys.size() && can_copy; j++) {
+      shared_ptr<CFileSet> base_data = min_keys[j].second->base_data();
+      RETURN_NOT_OK(CanCopyEncodedBlocks(col, base_data->column_reader(schema.column_id(i)),
+                                         &can_copy));
+    }
+    cols[i] = can_copy;
+    any_col |= can_copy;
+  }
+  if (!any_col) {
+    return Status::OK();
+  }
+
+  for (int i : order) {
+    sorted_rowsets->emplace_back(min_keys[i].second);
+  }
+  *encoded_cols = std::move(cols);
+  return Status::OK();
+}
+
+Status FlushDisjointRowSets(const vector<shared_ptr<DiskRowSet>>& rowsets,
+                            const MvccSnapshot& snap,
+                            const HistoryGcOpts& history_gc_opts,
+                            const vector<bool>& encoded_cols,
+                            RollingDiskRowSetWriter* out) {
+  const Schema& schema = out->schema();
+  DCHECK_EQ(schema.num_columns(), encoded_cols.size());
+  DCHECK(!history_gc_opts.row_expiry_enabled());
+
+  // The rows are read without their encoded columns.
+  vector<ColumnSchema> read_cols;
+  vector<ColumnId> read_col_ids;
+  vector<int> read_col_idxs;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    if (!encoded_cols[i]) {
+      read_cols.push_back(schema.column(i));
+      read_col_ids.push_back(schema.column_id(i));
+      read_col_idxs.push_back(i);
+    }
+  }
+  const Schema read_schema(read_cols, read_col_ids, schema.num_key_columns());
+
+  // The cells of the encoded columns are left unset, since they aren't written.
+  RowBlock block(schema, kCompactionOutputBlockNumRows, nullptr);
+  vector<CompactionInputRow> rows;
+
+  for (const shared_ptr<DiskRowSet>& rowset : rowsets) {
+    gscoped_ptr<CompactionInput> input;
+    RETURN_NOT_OK(CompactionInput::Create(*rowset, &read_schema, snap, &input));
+    RETURN_NOT_OK(input->Init());
+
+    rowid_t num_rows = 0;
+    while (input->HasMoreBlocks()) {
+      RETURN_NOT_OK(input->PrepareBlock(&rows));
+
+      int n = 0;
+      for (CompactionInputRow& input_row : rows) {
+        // Any REDO committed in the snapshot would have been found by
+        // ChooseEncodedColumns().
+        if (input_row.redo_head != nullptr) {
+          return Status::IllegalState("unexpected REDO in rowset compacted by copying blocks",
+                                      rowset->ToString());
+        }
+
+        RowBlockRow dst_row = block.row(n);
+        for (int j = 0; j < read_col_idxs.size(); j++) {
+          RowBlockRow::Cell dst_cell = dst_row.cell(read_col_idxs[j]);
+          RETURN_NOT_OK(CopyCell(input_row.row.cell(j), &dst_cell, static_cast<Arena*>(nullptr)));
+        }
+
+        // Without REDOs, the UNDOs carry over as they are, and rows can't be
+        // garbage collected.
+        Mutation* new_undos_head = input_row.undo_head;
+        bool is_garbage_collected;
+        RemoveAncientUndos(history_gc_opts, &new_undos_head, nullptr, &is_garbage_collected);
+        DCHECK(!is_garbage_collected);
+
+        if (new_undos_head != nullptr) {
+          rowid_t index_in_current_drs;
+          RETURN_NOT_OK(out->AppendUndoDeltas(dst_row.row_index(), new_undos_head,
+                                              &index_in_current_drs));
+        }
+
+        n++;
+        if (n == block.nrows()) {
+          RETURN_NOT_OK(out->AppendBlock(block));
+          num_rows += n;
+          n = 0;
+        }
+      }
+
+      if (n > 0) {
+        block.Resize(n);
+        RETURN_NOT_OK(out->AppendBlock(block));
+        block.Resize(block.row_capacity());
+        num_rows += n;
+      }
+
+      RETURN_NOT_OK(input->FinishBlock());
+    }
+
+    // The encoded columns catch up with the rows of the rowset before the
+    // output may roll.
+    shared_ptr<CFileSet> base_data = rowset->base_data();
+    for (int i = 0; i < schema.num_columns(); i++) {
+      if (encoded_cols[i]) {
+        RETURN_NOT_OK(CopyEncodedBlocks(base_data->column_reader(schema.column_id(i)),
+                                        i, num_rows, out));
+      }
+    }
+    RETURN_NOT_OK(out->RollIfNecessary());
+  }
+  return Status::OK();
+}
+
 Status ReupdateMissedDeltas(const string &tablet_name,
                             CompactionInput *input,
                             const HistoryGcOpts& history_gc_opts,
@@ -1223,6 +1758,16 @@ Status ReupdateMissedDeltas(const string &tablet_name,
     for (const CompactionInputRow &row : rows) {
       DVLOG(4) << "Revisiting row: " << CompactionInputRowToString(row);
 
+      // Rows found expired by the first pass weren't written to the output,
+      // so any mutation they got since is dropped along with them.
+      bool is_expired;
+      RETURN_NOT_OK(IsRowExpired(history_gc_opts, row, snap_to_exclude, &is_expired));
+      if (is_expired) {
+        DVLOG(4) << "Skipping expired input row: " << schema->DebugRow(row.row)
+                 << " while reupdating missed deltas";
+        continue;
+      }
+
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
            mut != nullptr;
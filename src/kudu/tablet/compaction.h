@@ -18,6 +18,7 @@
 #define KUDU_TABLET_COMPACTION_H
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -27,6 +28,7 @@
 #include <glog/logging.h>
 
 #include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/tablet/rowset.h"
@@ -35,7 +37,7 @@
 namespace kudu {
 
 class Arena;
-class Schema;
+class EncodedKey;
 
 namespace tablet {
 
@@ -74,10 +76,40 @@ class HistoryGcOpts {
     return ancient_history_mark_;
   }
 
+  // Returns a copy of these options which also drops the rows whose value of
+  // the UNIXTIME_MICROS column with ID 'col_id' is lower than 'cutoff_micros'.
+  HistoryGcOpts WithRowExpiry(ColumnId col_id, int64_t cutoff_micros) const {
+    return HistoryGcOpts(gc_enabled_, ancient_history_mark_, true, col_id, cutoff_micros);
+  }
+
+  // Returns true if expired rows are dropped.
+  bool row_expiry_enabled() const {
+    return row_expiry_enabled_;
+  }
+
+  // Returns true if a row whose value of the expiry column is 'micros' is
+  // expired.
+  bool IsExpired(int64_t micros) const {
+    return row_expiry_enabled_ && micros < expiry_cutoff_micros_;
+  }
+
+  // Returns the ID of the column which rows expire by.
+  ColumnId expiry_col_id() const {
+    return expiry_col_id_;
+  }
+
  private:
   HistoryGcOpts(bool gc_enabled, Timestamp ahm)
+      : HistoryGcOpts(gc_enabled, ahm, false, ColumnId(), 0) {
+  }
+
+  HistoryGcOpts(bool gc_enabled, Timestamp ahm, bool row_expiry_enabled,
+                ColumnId expiry_col_id, int64_t expiry_cutoff_micros)
       : gc_enabled_(gc_enabled),
-        ancient_history_mark_(ahm) {
+        ancient_history_mark_(ahm),
+        row_expiry_enabled_(row_expiry_enabled),
+        expiry_col_id_(expiry_col_id),
+        expiry_cutoff_micros_(expiry_cutoff_micros) {
   }
 
   // Whether historical records prior to the ancient history mark should be
@@ -87,6 +119,12 @@ class HistoryGcOpts {
   // A timestamp prior to which no history will be preserved.
   // Ignored if 'enabled' != GC_ENABLED.
   const Timestamp ancient_history_mark_;
+
+  // Whether the rows whose value of the column with ID 'expiry_col_id_' is
+  // lower than 'expiry_cutoff_micros_' are dropped, along with their history.
+  const bool row_expiry_enabled_;
+  const ColumnId expiry_col_id_;
+  const int64_t expiry_cutoff_micros_;
 };
 
 // Interface for an input feeding into a compaction or flush.
@@ -106,6 +144,26 @@ class CompactionInput {
                        const MvccSnapshot &snap,
                        gscoped_ptr<CompactionInput>* out);
 
+  // Like the above, but only yields the rows whose keys fall in
+  // ['lower_bound', 'exclusive_upper_bound'). Either bound may be null to leave
+  // the range open on that side. The bounds must remain valid for the lifetime
+  // of the returned input.
+  static Status Create(const DiskRowSet &rowset,
+                       const Schema* projection,
+                       const MvccSnapshot &snap,
+                       const EncodedKey* lower_bound,
+                       const EncodedKey* exclusive_upper_bound,
+                       gscoped_ptr<CompactionInput>* out);
+
+  // Like the first of the above, but the rows' UNDO lists only hold the
+  // mutations which are uncommitted in 'undo_snap', so that the UNDO delta
+  // files holding only older mutations are not read.
+  static Status Create(const DiskRowSet &rowset,
+                       const Schema* projection,
+                       const MvccSnapshot &snap,
+                       const MvccSnapshot &undo_snap,
+                       gscoped_ptr<CompactionInput>* out);
+
   // Create an input which reads from the given memrowset, yielding base rows and updates
   // prior to the given snapshot.
   static CompactionInput *Create(const MemRowSet &memrowset,
@@ -131,6 +189,15 @@ class CompactionInput {
   virtual const Schema &schema() const = 0;
 
   virtual ~CompactionInput() {}
+
+ private:
+  static Status CreateDiskRowSetInput(const DiskRowSet &rowset,
+                                      const Schema* projection,
+                                      const MvccSnapshot &snap,
+                                      const MvccSnapshot &undo_snap,
+                                      const EncodedKey* lower_bound,
+                                      const EncodedKey* exclusive_upper_bound,
+                                      gscoped_ptr<CompactionInput>* out);
 };
 
 // The set of rowsets which are taking part in a given compaction.
@@ -153,6 +220,23 @@ class RowSetsInCompaction {
                                const Schema* schema,
                                std::shared_ptr<CompactionInput> *out) const;
 
+  // Like the above, but the input only yields the rows whose keys fall in
+  // ['lower_bound', 'exclusive_upper_bound'), so that the key ranges of a
+  // compaction may be merged independently. Either bound may be null. Only
+  // supported if all of the rowsets are DiskRowSets.
+  Status CreateCompactionInput(const MvccSnapshot &snap,
+                               const Schema* schema,
+                               const EncodedKey* lower_bound,
+                               const EncodedKey* exclusive_upper_bound,
+                               std::shared_ptr<CompactionInput> *out) const;
+
+  // Choose up to 'max_partitions' - 1 encoded keys which split the key range of
+  // the rowsets into partitions holding about the same amount of data, using
+  // keys sampled from each rowset. The keys are returned in ascending order in
+  // 'split_keys', which is left empty if the rowsets can't be split. Only
+  // supported if all of the rowsets are DiskRowSets.
+  Status ChooseSplitKeys(int max_partitions, std::vector<std::string>* split_keys) const;
+
   // Dump a log message indicating the chosen rowsets.
   void DumpToLog() const;
 
@@ -202,6 +286,15 @@ void RemoveAncientUndos(const HistoryGcOpts& history_gc_opts,
                         const Mutation* redo_head,
                         bool* is_garbage_collected);
 
+// Sets '*is_expired' to true if 'row', as of 'snap', is expired by the row
+// expiry of 'history_gc_opts': its value of the expiry column, after the
+// REDOs committed in 'snap', is non-NULL and older than the cutoff. Such rows
+// are dropped by flushes and compactions.
+Status IsRowExpired(const HistoryGcOpts& history_gc_opts,
+                    const CompactionInputRow& row,
+                    const MvccSnapshot& snap,
+                    bool* is_expired);
+
 // Function shared by flushes, compactions and major delta compactions. Applies all the REDO
 // mutations from 'src_row' to the 'dst_row', and generates the related UNDO mutations. Some
 // handling depends on the nature of the operation being performed:
@@ -227,6 +320,39 @@ Status FlushCompactionInput(CompactionInput *input,
                             const HistoryGcOpts& history_gc_opts,
                             RollingDiskRowSetWriter *out);
 
+// Chooses the columns whose data blocks a compaction of 'rowsets' may copy
+// into its output, of schema 'schema', without decoding them. This is only
+// possible if the rowsets are DiskRowSets whose key ranges don't overlap, so
+// that their rows are output one rowset after the other, and if the only
+// mutations of their rows are UNDOs, so that the rows are output unchanged.
+// Rows mustn't expire by TTL either. Must be called after the snapshot of
+// the compaction was taken.
+//
+// The copied columns are the non-key, non-indexed columns which every rowset
+// wrote with the same type, nullability and encoding as the output will,
+// with an encoding whose blocks can be moved to another position.
+//
+// If the compaction is eligible and some columns may be copied, sets
+// 'encoded_cols' to flag those columns, indexed like the columns of 'schema',
+// and 'sorted_rowsets' to the rowsets in key order. Otherwise, leaves both
+// empty.
+Status ChooseEncodedColumns(const RowSetVector& rowsets,
+                            const Schema& schema,
+                            const HistoryGcOpts& history_gc_opts,
+                            std::vector<std::shared_ptr<DiskRowSet>>* sorted_rowsets,
+                            std::vector<bool>* encoded_cols);
+
+// Like FlushCompactionInput(), for the rowsets and columns chosen by
+// ChooseEncodedColumns(). The encoded columns of 'out' must have been set to
+// 'encoded_cols'. The rowsets are flushed one after the other: their keys,
+// UNDO deltas and remaining columns are read and written row by row, while
+// the data blocks of the encoded columns are copied as they are.
+Status FlushDisjointRowSets(const std::vector<std::shared_ptr<DiskRowSet>>& rowsets,
+                            const MvccSnapshot& snap,
+                            const HistoryGcOpts& history_gc_opts,
+                            const std::vector<bool>& encoded_cols,
+                            RollingDiskRowSetWriter* out);
+
 // Iterate through this compaction input, finding any mutations which came between
 // snap_to_exclude and snap_to_include (ie those transactions that were not yet
 // committed in 'snap_to_exclude' but _are_ committed in 'snap_to_include'). For
@@ -248,6 +374,14 @@ Status ReupdateMissedDeltas(const std::string &tablet_name,
 // This consumes all of the input in the compaction input.
 Status DebugDumpCompactionInput(CompactionInput *input, std::vector<std::string> *lines);
 
+// Chooses up to 'max_partitions' - 1 encoded keys which split the key range
+// of 'rowsets' into partitions holding about the same amount of data. See
+// RowSetsInCompaction::ChooseSplitKeys(). All of 'rowsets' must be
+// DiskRowSets.
+Status ChooseSplitKeys(const RowSetVector& rowsets,
+                       int max_partitions,
+                       std::vector<std::string>* split_keys);
+
 // Helper methods to print a row with full history.
 std::string RowToString(const RowBlockRow& row,
                         const Mutation* redo_head,
@@ -22,10 +22,12 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <glog/stl_logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
@@ -42,6 +44,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_double(compaction_deleted_rows_ratio_threshold);
+
 using std::unordered_set;
 using std::string;
 using std::vector;
@@ -217,5 +221,69 @@ TEST_F(TestCompactionPolicy, KUDU2251) {
   ASSERT_GE(quality, 1.0);
 }
 
+// Test that a mostly deleted rowset is picked for compaction even though it
+// doesn't overlap any other rowset.
+TEST_F(TestCompactionPolicy, TestMostlyDeletedRowSet) {
+  const uint64_t kSize = 8 * 1024 * 1024;
+  RowSetVector vec = {
+    std::make_shared<MockDiskRowSet>("A", "B", kSize, 0.9),
+    std::make_shared<MockDiskRowSet>("C", "D", kSize),
+    std::make_shared<MockDiskRowSet>("E", "F", kSize, 0.1)
+  };
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  NO_FATALS(RunTestCase(vec, /*size_budget_mb=*/100, &picked, &quality));
+  ASSERT_GT(quality, 0);
+  ASSERT_TRUE(ContainsKey(picked, vec[0].get()));
+  ASSERT_FALSE(ContainsKey(picked, vec[2].get()));
+
+  // Nothing is picked when deleted rows aren't taken into account.
+  FLAGS_compaction_deleted_rows_ratio_threshold = 2;
+  picked.clear();
+  NO_FATALS(RunTestCase(vec, /*size_budget_mb=*/100, &picked, &quality));
+  ASSERT_EQ(0, quality);
+  ASSERT_TRUE(picked.empty());
+}
+
+// Test that the size-tiered policy merges the non-overlapping rowsets of the
+// most populated tier, and leaves out the rowsets of the other tiers as well
+// as those which reached the target rowset size.
+TEST_F(TestCompactionPolicy, TestSizeTieredSelection) {
+  const uint64_t kMb = 1024 * 1024;
+  ASSERT_EQ(0, SizeTieredCompactionPolicy::TierForSize(1 * kMb));
+  ASSERT_EQ(1, SizeTieredCompactionPolicy::TierForSize(8 * kMb));
+  ASSERT_EQ(2, SizeTieredCompactionPolicy::TierForSize(40 * kMb));
+
+  RowSetVector vec;
+  for (int i = 0; i < 6; i++) {
+    vec.emplace_back(new MockDiskRowSet(StringPrintf("%04d", i * 2),
+                                        StringPrintf("%04d", i * 2 + 1),
+                                        1 * kMb));
+  }
+  vec.emplace_back(new MockDiskRowSet("0100", "0101", 40 * kMb));
+  vec.emplace_back(new MockDiskRowSet("0102", "0103", 40 * kMb));
+  vec.emplace_back(new MockDiskRowSet("0104", "0105", 300 * kMb));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  SizeTieredCompactionPolicy policy(/*size_budget_mb=*/128);
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(6, picked.size());
+  for (int i = 0; i < 6; i++) {
+    ASSERT_TRUE(ContainsKey(picked, vec[i].get()));
+  }
+  ASSERT_GT(quality, 0);
+
+  // With fewer rowsets than the minimum in every tier, nothing is picked.
+  vec.erase(vec.begin() + 3, vec.begin() + 6);
+  ASSERT_OK(tree.Reset(vec));
+  picked.clear();
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_TRUE(picked.empty());
+  ASSERT_EQ(0, quality);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,6 +18,8 @@
 #include "kudu/tablet/compaction_policy.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
 #include <ostream>
 #include <queue>
 #include <string>
@@ -55,6 +57,33 @@ DEFINE_double(compaction_minimum_improvement, 0.01f,
               "improve the average height of DiskRowSets by at least this amount, the "
               "compaction will be considered ineligible.");
 
+DEFINE_int64(size_tiered_compaction_target_rowset_size, 256*1024*1024,
+             "The target size for DiskRowSets during flush/compact when the "
+             "size-tiered compaction policy is used. Rowsets which reached this "
+             "size are no longer compacted by that policy.");
+TAG_FLAG(size_tiered_compaction_target_rowset_size, experimental);
+TAG_FLAG(size_tiered_compaction_target_rowset_size, advanced);
+
+DEFINE_int32(size_tiered_compaction_min_tier_size_mb, 8,
+             "The size of the smallest tier of the size-tiered compaction "
+             "policy. All rowsets smaller than this belong to the first tier.");
+TAG_FLAG(size_tiered_compaction_min_tier_size_mb, experimental);
+
+DEFINE_double(size_tiered_compaction_tier_ratio, 4.0,
+              "The size ratio between consecutive tiers of the size-tiered "
+              "compaction policy.");
+TAG_FLAG(size_tiered_compaction_tier_ratio, experimental);
+
+DEFINE_int32(size_tiered_compaction_min_rowsets, 4,
+             "The minimum number of rowsets of the same tier which the size-tiered "
+             "compaction policy merges together.");
+TAG_FLAG(size_tiered_compaction_min_rowsets, experimental);
+
+DEFINE_int32(size_tiered_compaction_max_rowsets, 32,
+             "The maximum number of rowsets which the size-tiered compaction "
+             "policy merges in a single compaction.");
+TAG_FLAG(size_tiered_compaction_max_rowsets, experimental);
+
 namespace kudu {
 namespace tablet {
 
@@ -120,7 +149,7 @@ struct KnapsackTraits {
     return item->size_mb();
   }
   static value_type get_value(const RowSetInfo* item) {
-    return item->width();
+    return item->value();
   }
 };
 
@@ -171,11 +200,11 @@ class BoundCalculator {
                    DerefCompare<CompareByDescendingDensity>());
 
     total_weight_ += candidate.size_mb();
-    total_value_ += candidate.width();
+    total_value_ += candidate.value();
     const RowSetInfo* top = fractional_solution_.front();
     while (total_weight_ - top->size_mb() > max_weight_) {
       total_weight_ -= top->size_mb();
-      total_value_ -= top->width();
+      total_value_ -= top->value();
       std::pop_heap(fractional_solution_.begin(), fractional_solution_.end(),
                     DerefCompare<CompareByDescendingDensity>());
       fractional_solution_.pop_back();
@@ -201,16 +230,16 @@ class BoundCalculator {
     // - the N+1th item, if it fits
     // This is a 2-approximation (i.e. no worse than 1/2 of the best solution).
     // See https://courses.engr.illinois.edu/cs598csc/sp2009/lectures/lecture_4.pdf
-    double lower_bound = std::max(total_value_ - top.width(), top.width());
+    double lower_bound = std::max(total_value_ - top.value(), top.value());
 
     // An upper bound for the integer problem is the solution to the fractional problem:
     // in the fractional problem we can add just a portion of the top element. The
     // portion to remove is determined by the amount of excess weight:
     //
     //   fraction_to_remove = excess_weight / top.size_mb();
-    //   portion_to_remove = fraction_to_remove * top.width()
+    //   portion_to_remove = fraction_to_remove * top.value()
     //
-    // To avoid the division, we can just use the fact that density = width/size:
+    // To avoid the division, we can just use the fact that density = value/size:
     double portion_of_top_to_remove = static_cast<double>(excess_weight) * top.density();
     DCHECK_GT(portion_of_top_to_remove, 0);
     double upper_bound = total_value_ - portion_of_top_to_remove;
@@ -229,7 +258,7 @@ class BoundCalculator {
 
       // See above: there are two choices for the lower-bound estimate,
       // and we need to return the one matching the bound we computed.
-      if (total_value_ - top->width() > top->width()) {
+      if (total_value_ - top->value() > top->value()) {
         // The current solution less the top (minimum density) element.
         solution->assign(fractional_solution_.begin() + 1,
                          fractional_solution_.end());
@@ -477,5 +506,108 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// SizeTieredCompactionPolicy
+////////////////////////////////////////////////////////////
+
+SizeTieredCompactionPolicy::SizeTieredCompactionPolicy(int budget)
+  : size_budget_mb_(budget) {
+  CHECK_GT(budget, 0);
+}
+
+uint64_t SizeTieredCompactionPolicy::target_rowset_size() const {
+  CHECK_GT(FLAGS_size_tiered_compaction_target_rowset_size, 0);
+  return FLAGS_size_tiered_compaction_target_rowset_size;
+}
+
+int SizeTieredCompactionPolicy::TierForSize(uint64_t size_bytes) {
+  CHECK_GT(FLAGS_size_tiered_compaction_min_tier_size_mb, 0);
+  CHECK_GT(FLAGS_size_tiered_compaction_tier_ratio, 1.0);
+  double min_tier_bytes = FLAGS_size_tiered_compaction_min_tier_size_mb * 1024.0 * 1024.0;
+  if (size_bytes < min_tier_bytes) {
+    return 0;
+  }
+  return 1 + static_cast<int>(std::log(size_bytes / min_tier_bytes) /
+                              std::log(FLAGS_size_tiered_compaction_tier_ratio));
+}
+
+Status SizeTieredCompactionPolicy::PickRowSets(const RowSetTree &tree,
+                                               std::unordered_set<RowSet*>* picked,
+                                               double* quality,
+                                               std::vector<std::string>* log) {
+  *quality = 0;
+  vector<RowSetInfo> asc_min_key, asc_max_key;
+  RowSetInfo::CollectOrdered(tree, &asc_min_key, &asc_max_key);
+  if (asc_min_key.size() < 2) {
+    if (log) {
+      LOG_STRING(INFO, log) << "No rowsets to compact";
+    }
+    return Status::OK();
+  }
+
+  // Group the rowsets which are still below the target size by tier, keeping
+  // each tier in ascending min-key order so that the picked rowsets tend to be
+  // adjacent in the key space.
+  std::map<int, vector<const RowSetInfo*>> tiers;
+  for (const RowSetInfo& cand : asc_min_key) {
+    if (cand.size_bytes() >= target_rowset_size()) continue;
+    tiers[TierForSize(cand.size_bytes())].push_back(&cand);
+  }
+
+  // Pick the tier which eliminates the most rowsets, preferring the smaller
+  // tiers on ties since they are the cheapest to merge.
+  int best_tier = -1;
+  vector<const RowSetInfo*> best;
+  for (const auto& tier : tiers) {
+    vector<const RowSetInfo*> cands;
+    size_t total_mb = 0;
+    for (const RowSetInfo* cand : tier.second) {
+      if (cands.size() >= std::max<size_t>(2, FLAGS_size_tiered_compaction_max_rowsets)) break;
+      if (total_mb + cand->size_mb() > size_budget_mb_ && !cands.empty()) break;
+      total_mb += cand->size_mb();
+      cands.push_back(cand);
+    }
+    if (cands.size() < std::max<size_t>(2, FLAGS_size_tiered_compaction_min_rowsets)) continue;
+    if (cands.size() > best.size()) {
+      best_tier = tier.first;
+      best.swap(cands);
+    }
+  }
+
+  // The quality is the fraction of the tablet's rowsets which the compaction
+  // eliminates.
+  double value = best.empty() ? 0 : static_cast<double>(best.size() - 1) / asc_min_key.size();
+
+  if (VLOG_IS_ON(1) || log != nullptr) {
+    LOG_STRING(INFO, log) << "Size-tiered compaction selection:";
+    for (const auto& tier : tiers) {
+      for (const RowSetInfo* cand : tier.second) {
+        const char *checkbox = "[ ]";
+        if (tier.first == best_tier &&
+            std::find(best.begin(), best.end(), cand) != best.end()) {
+          checkbox = "[x]";
+        }
+        LOG_STRING(INFO, log) << "  " << checkbox << " tier " << tier.first
+                              << " " << cand->ToString();
+      }
+    }
+    LOG_STRING(INFO, log) << "Solution value: " << value;
+  }
+
+  if (value <= FLAGS_compaction_minimum_improvement) {
+    VLOG(1) << "Best compaction available (" << value << " less than "
+            << "minimum quality " << FLAGS_compaction_minimum_improvement
+            << ": not compacting.";
+    return Status::OK();
+  }
+
+  *quality = value;
+  for (const RowSetInfo* rsi : best) {
+    picked->insert(rsi->rowset());
+  }
+  DumpCompactionSVG(asc_min_key, *picked);
+  return Status::OK();
+}
+
 } // namespace tablet
 } // namespace kudu
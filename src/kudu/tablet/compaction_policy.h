@@ -127,6 +127,35 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   size_t size_budget_mb_;
 };
 
+// Compaction policy which groups rowsets into tiers of similar on-disk size
+// and merges several rowsets of the same tier together, regardless of how
+// much their key ranges overlap.
+//
+// Unlike the budgeted policy, which only compacts rowsets which overlap, this
+// bounds the number of rowsets in tablets with append-mostly workloads (e.g.
+// tables keyed by an increasing timestamp), where the flushed rowsets rarely
+// overlap. Each row is rewritten roughly once per tier, which bounds the write
+// amplification to the logarithm of the data size.
+class SizeTieredCompactionPolicy : public CompactionPolicy {
+ public:
+  explicit SizeTieredCompactionPolicy(int size_budget_mb);
+
+  virtual Status PickRowSets(const RowSetTree &tree,
+                             std::unordered_set<RowSet*>* picked,
+                             double* quality,
+                             std::vector<std::string>* log) OVERRIDE;
+
+  virtual uint64_t target_rowset_size() const OVERRIDE;
+
+  // Return the tier of a rowset of 'size_bytes' bytes. Tier 0 holds the
+  // rowsets smaller than the minimum tier size, and each subsequent tier holds
+  // rowsets which are larger by the configured tier size ratio.
+  static int TierForSize(uint64_t size_bytes);
+
+ private:
+  size_t size_budget_mb_;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
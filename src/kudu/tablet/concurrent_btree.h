@@ -695,6 +695,20 @@ class LeafNode : public NodeBase<Traits> {
     ret->idx_ = Find(ret->key(), &ret->exists_);
   }
 
+  // Return true if 'key' is known to belong in this leaf node, i.e. it's
+  // between the first and the last keys of the node, or it's past the first
+  // key and this is the rightmost leaf. A false result doesn't imply that the
+  // key belongs elsewhere.
+  //
+  // Requires that the lock is held.
+  bool Covers(const Slice &key) {
+    DCHECK(this->IsLocked());
+    if (num_entries_ == 0 || key.compare(GetKey(0)) < 0) {
+      return false;
+    }
+    return next_ == NULL || key.compare(GetKey(num_entries_ - 1)) <= 0;
+  }
+
   // Insert a new entry into this leaf node.
   InsertStatus Insert(PreparedMutation<Traits> *mut, const Slice &val) {
     DCHECK_EQ(this, mut->leaf());
@@ -856,11 +870,19 @@ class PreparedMutation {
   // If the returned PreparedMutation object is not used with
   // Insert(), it will be automatically unlocked by its destructor.
   void Prepare(CBTree<Traits> *tree) {
+    Prepare(tree, NULL);
+  }
+
+  // Same as the above, but first tries the leaf node 'hint' of the same
+  // tree, e.g. the leaf() of the previous mutation. If the key falls within
+  // it, as it usually does when the keys of a batch are prepared in
+  // ascending order, the traversal from the root of the tree is saved.
+  void Prepare(CBTree<Traits> *tree, LeafNode<Traits> *hint) {
     debug::ScopedTSANIgnoreReadsAndWrites ignore_tsan;
     CHECK(!prepared());
     this->tree_ = tree;
     this->arena_ = tree->arena_.get();
-    tree->PrepareMutation(this);
+    tree->PrepareMutation(this, hint);
     needs_unlock_ = true;
   }
 
@@ -1270,8 +1292,20 @@ class CBTree {
     }
   }
 
-  void PrepareMutation(PreparedMutation<Traits> *mutation) {
+  void PrepareMutation(PreparedMutation<Traits> *mutation,
+                       LeafNode<Traits> *hint) {
     DCHECK_EQ(mutation->tree(), this);
+    if (hint != NULL) {
+      // Leaf nodes are never removed from the tree, so 'hint' is still valid.
+      // Once it's locked, it can't be split, and the keys it holds bound the
+      // range of keys it covers.
+      hint->Lock();
+      if (hint->Covers(mutation->key())) {
+        hint->PrepareMutation(mutation);
+        return;
+      }
+      hint->Unlock();
+    }
     while (true) {
       AtomicVersion stable_version;
       LeafNode<Traits> *lnode = TraverseToLeaf(mutation->key(), &stable_version);
@@ -25,6 +25,7 @@
 #include <glog/logging.h>
 
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/tablet/delta_store.h"
 #include "kudu/util/status.h"
 
@@ -100,11 +101,26 @@ Status DeltaApplier::FinishBatch() {
 Status DeltaApplier::InitializeSelectionVector(SelectionVector *sel_vec) {
   DCHECK(!first_prepare_) << "PrepareBatch() must be called at least once";
   RETURN_NOT_OK(base_iter_->InitializeSelectionVector(sel_vec));
+  // The zone maps only describe the base data, so batches may only be
+  // skipped by the bound of a top-N scan if they have no updates.
+  if (!delta_iter_->MayHaveDeltas() && sel_vec->AnySelected()) {
+    bool may_match;
+    RETURN_NOT_OK(base_iter_->TopNBoundMayMatch(&may_match));
+    if (!may_match) {
+      sel_vec->SetAllFalse();
+      return Status::OK();
+    }
+  }
   return delta_iter_->ApplyDeletes(sel_vec);
 }
 
 Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   DCHECK(!first_prepare_) << "PrepareBatch() must be called at least once";
+  if (ctx->SkipUnselectedRows() && !ctx->sel()->AnySelected()) {
+    // Every row of the batch was deleted or filtered out by a predicate, so
+    // neither the base data nor the updates are needed.
+    return Status::OK();
+  }
   // Data with updates cannot be evaluated at the decoder-level.
   if (delta_iter_->MayHaveDeltas()) {
     ctx->SetDecoderEvalNotSupported();
@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/common/generic_iterators.h"
@@ -34,6 +35,7 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -47,7 +49,15 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_bool(major_delta_compaction_read_ahead, false,
+            "Whether major delta compactions read the next batch of base data and "
+            "collect its REDO deltas on a separate thread while the current batch "
+            "is applied and written.");
+TAG_FLAG(major_delta_compaction_read_ahead, experimental);
 
 using std::shared_ptr;
 
@@ -109,6 +119,131 @@ string MajorDeltaCompaction::ColumnNamesToString() const {
   return result;
 }
 
+// A batch of base data rows, along with the REDO mutations which apply to
+// them. Each batch owns its arena so that the next batch can be read while
+// the current one is being written.
+struct MajorDeltaCompaction::Batch {
+  explicit Batch(const Schema& schema)
+      : arena(32 * 1024),
+        block(schema, kRowsPerBlock, &arena) {
+  }
+
+  Arena arena;
+  RowBlock block;
+
+  // The REDO mutations to apply to each row of 'block'.
+  vector<Mutation*> redo_mutations;
+
+  // The REDO mutations which don't refer to the columns being compacted,
+  // which must be written back to the new REDO delta file.
+  vector<DeltaKeyAndUpdate> remaining_redos;
+};
+
+Status MajorDeltaCompaction::ReadBatch(RowwiseIterator* base_iter, Batch* batch) {
+  // 1) Get the next batch of base data for the columns we're compacting.
+  batch->arena.Reset();
+  RETURN_NOT_OK(base_iter->NextBlock(&batch->block));
+  size_t n = batch->block.nrows();
+
+  // 2) Fetch all the REDO mutations.
+  batch->redo_mutations.assign(kRowsPerBlock, nullptr);
+  RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
+  RETURN_NOT_OK(delta_iter_->CollectMutations(&batch->redo_mutations, &batch->arena));
+
+  // 3) Collect the REDO mutations which will be written back, i.e. all but
+  //    the ones to the columns we're doing our major REDO delta compaction
+  //    on, keeping all the delete and reinsert mutations.
+  batch->remaining_redos.clear();
+  return delta_iter_->FilterColumnIdsAndCollectDeltas(column_ids_,
+                                                      &batch->remaining_redos,
+                                                      &batch->arena);
+}
+
+Status MajorDeltaCompaction::WriteBatch(const MvccSnapshot& snap,
+                                        size_t nrows,
+                                        Batch* batch,
+                                        DeltaStats* redo_stats,
+                                        DeltaStats* undo_stats) {
+  RowBlock& block = batch->block;
+
+  // 4) Write new UNDO mutations for the current block. The REDO mutations
+  //    are written out in step 6.
+  vector<CompactionInputRow> input_rows;
+  input_rows.resize(block.nrows());
+  for (int i = 0; i < block.nrows(); i++) {
+    CompactionInputRow* input_row = &input_rows[i];
+    input_row->row.Reset(&block, i);
+    input_row->redo_head = batch->redo_mutations[i];
+    Mutation::ReverseMutationList(&input_row->redo_head);
+    input_row->undo_head = nullptr;
+
+    RowBlockRow dst_row = block.row(i);
+    RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
+
+    Mutation* new_undos_head = nullptr;
+    // We're ignoring the result from new_redos_head because the REDOs to
+    // keep were already collected in 'remaining_redos'.
+    Mutation* new_redos_head = nullptr;
+
+    // Since this is a delta compaction the input and output row id's are the same.
+    rowid_t row_id = nrows + input_row->row.row_index();
+
+    DVLOG(3) << "MDC Input Row - RowId: " << row_id << " "
+             << CompactionInputRowToString(*input_row);
+
+    // NOTE: This is presently ignored.
+    bool is_garbage_collected;
+
+    RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
+                                                 *input_row,
+                                                 &new_undos_head,
+                                                 &new_redos_head,
+                                                 &batch->arena,
+                                                 &dst_row));
+
+    RemoveAncientUndos(history_gc_opts_,
+                       &new_undos_head,
+                       new_redos_head,
+                       &is_garbage_collected);
+
+    DVLOG(3) << "MDC Output Row - RowId: " << row_id << " "
+             << RowToString(dst_row, new_undos_head, new_redos_head);
+
+    // We only create a new undo delta file if we need to.
+    if (new_undos_head != nullptr && !new_undo_delta_writer_) {
+      RETURN_NOT_OK(OpenUndoDeltaFileWriter());
+    }
+    for (const Mutation *mut = new_undos_head; mut != nullptr; mut = mut->next()) {
+      DeltaKey undo_key(nrows + dst_row.row_index(), mut->timestamp());
+      RETURN_NOT_OK(new_undo_delta_writer_->AppendDelta<UNDO>(undo_key, mut->changelist()));
+      undo_stats->UpdateStats(undo_key, mut->changelist());
+      undo_delta_mutations_written_++;
+    }
+  }
+
+  // 5) Write the new base data.
+  RETURN_NOT_OK(base_data_writer_->AppendBlock(block));
+
+  // We only create a new redo delta file if we need to.
+  if (!batch->remaining_redos.empty() && !new_redo_delta_writer_) {
+    RETURN_NOT_OK(OpenRedoDeltaFileWriter());
+  }
+
+  // 6) Write the remaining REDO deltas that we haven't compacted away back
+  //    into a REDO delta file.
+  for (const DeltaKeyAndUpdate& key_and_update : batch->remaining_redos) {
+    RowChangeList update(key_and_update.cell);
+    DVLOG(4) << "Keeping delta as REDO: "
+             << key_and_update.Stringify(DeltaType::REDO, base_schema_);
+    RETURN_NOT_OK_PREPEND(new_redo_delta_writer_->AppendDelta<REDO>(key_and_update.key, update),
+                          "Failed to append a delta");
+    WARN_NOT_OK(redo_stats->UpdateStats(key_and_update.key, update),
+                "Failed to update stats");
+  }
+  redo_delta_mutations_written_ += batch->remaining_redos.size();
+  return Status::OK();
+}
+
 Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   CHECK_EQ(state_, kInitialized);
 
@@ -124,8 +259,19 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   RETURN_NOT_OK(delta_iter_->Init(&spec));
   RETURN_NOT_OK(delta_iter_->SeekToOrdinal(0));
 
-  Arena arena(32 * 1024);
-  RowBlock block(partial_schema_, kRowsPerBlock, &arena);
+  // With read-ahead, the next batch is read on 'read_pool' while the current
+  // one is written. 'read_pool' is declared after the batches so that any
+  // outstanding read finishes before they are destroyed.
+  Batch batch_a(partial_schema_);
+  Batch batch_b(partial_schema_);
+  Batch* batches[] = { &batch_a, &batch_b };
+  gscoped_ptr<ThreadPool> read_pool;
+  if (FLAGS_major_delta_compaction_read_ahead) {
+    RETURN_NOT_OK(ThreadPoolBuilder("mdc-read-ahead")
+                  .set_min_threads(0)
+                  .set_max_threads(1)
+                  .Build(&read_pool));
+  }
 
   DVLOG(1) << "Applying deltas and rewriting columns (" << partial_schema_.ToString() << ")";
   DeltaStats redo_stats;
@@ -133,101 +279,40 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   size_t nrows = 0;
   // We know that we're reading everything from disk so we're including all transactions.
   MvccSnapshot snap = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
-  while (old_base_data_rwise->HasNext()) {
-
-    // 1) Get the next batch of base data for the columns we're compacting.
-    arena.Reset();
-    RETURN_NOT_OK(old_base_data_rwise->NextBlock(&block));
-    size_t n = block.nrows();
-
-    // 2) Fetch all the REDO mutations.
-    vector<Mutation *> redo_mutation_block(kRowsPerBlock, static_cast<Mutation *>(nullptr));
-    RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
-    RETURN_NOT_OK(delta_iter_->CollectMutations(&redo_mutation_block, block.arena()));
-
-    // 3) Write new UNDO mutations for the current block. The REDO mutations
-    //    are written out in step 6.
-    vector<CompactionInputRow> input_rows;
-    input_rows.resize(block.nrows());
-    for (int i = 0; i < block.nrows(); i++) {
-      CompactionInputRow* input_row = &input_rows[i];
-      input_row->row.Reset(&block, i);
-      input_row->redo_head = redo_mutation_block[i];
-      Mutation::ReverseMutationList(&input_row->redo_head);
-      input_row->undo_head = nullptr;
-
-      RowBlockRow dst_row = block.row(i);
-      RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
-
-      Mutation* new_undos_head = nullptr;
-      // We're ignoring the result from new_redos_head because we'll find them
-      // later at step 5.
-      Mutation* new_redos_head = nullptr;
-
-      // Since this is a delta compaction the input and output row id's are the same.
-      rowid_t row_id = nrows + input_row->row.row_index();
-
-      DVLOG(3) << "MDC Input Row - RowId: " << row_id << " "
-               << CompactionInputRowToString(*input_row);
-
-      // NOTE: This is presently ignored.
-      bool is_garbage_collected;
-
-      RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
-                                                   *input_row,
-                                                   &new_undos_head,
-                                                   &new_redos_head,
-                                                   &arena,
-                                                   &dst_row));
-
-      RemoveAncientUndos(history_gc_opts_,
-                         &new_undos_head,
-                         new_redos_head,
-                         &is_garbage_collected);
-
-      DVLOG(3) << "MDC Output Row - RowId: " << row_id << " "
-               << RowToString(dst_row, new_undos_head, new_redos_head);
-
-      // We only create a new undo delta file if we need to.
-      if (new_undos_head != nullptr && !new_undo_delta_writer_) {
-        RETURN_NOT_OK(OpenUndoDeltaFileWriter());
-      }
-      for (const Mutation *mut = new_undos_head; mut != nullptr; mut = mut->next()) {
-        DeltaKey undo_key(nrows + dst_row.row_index(), mut->timestamp());
-        RETURN_NOT_OK(new_undo_delta_writer_->AppendDelta<UNDO>(undo_key, mut->changelist()));
-        undo_stats.UpdateStats(mut->timestamp(), mut->changelist());
-        undo_delta_mutations_written_++;
-      }
+  int cur = 0;
+  bool has_batch = old_base_data_rwise->HasNext();
+  if (has_batch) {
+    RETURN_NOT_OK(ReadBatch(old_base_data_rwise.get(), batches[cur]));
+  }
+  while (has_batch) {
+    Batch* batch = batches[cur];
+    Batch* next_batch = batches[1 - cur];
+    const bool has_next_batch = old_base_data_rwise->HasNext();
+
+    Status read_status;
+    if (has_next_batch && read_pool) {
+      const fs::IOPriority io_priority = fs::ScopedIOPriority::Current();
+      RETURN_NOT_OK(read_pool->SubmitFunc([&, next_batch, io_priority]() {
+          fs::ScopedIOPriority p(io_priority);
+          read_status = ReadBatch(old_base_data_rwise.get(), next_batch);
+        }));
     }
-
-    // 4) Write the new base data.
-    RETURN_NOT_OK(base_data_writer_->AppendBlock(block));
-
-    // 5) Remove the columns that we've done our major REDO delta compaction on
-    //    from this delta flush, except keep all the delete and reinsert
-    //    mutations.
-    arena.Reset();
-    vector<DeltaKeyAndUpdate> out;
-    RETURN_NOT_OK(delta_iter_->FilterColumnIdsAndCollectDeltas(column_ids_, &out, &arena));
-
-    // We only create a new redo delta file if we need to.
-    if (!out.empty() && !new_redo_delta_writer_) {
-      RETURN_NOT_OK(OpenRedoDeltaFileWriter());
+    Status write_status = WriteBatch(snap, nrows, batch, &redo_stats, &undo_stats);
+    if (read_pool) {
+      read_pool->Wait();
     }
-
-    // 6) Write the remaining REDO deltas that we haven't compacted away back
-    //    into a REDO delta file.
-    for (const DeltaKeyAndUpdate& key_and_update : out) {
-      RowChangeList update(key_and_update.cell);
-      DVLOG(4) << "Keeping delta as REDO: "
-               << key_and_update.Stringify(DeltaType::REDO, base_schema_);
-      RETURN_NOT_OK_PREPEND(new_redo_delta_writer_->AppendDelta<REDO>(key_and_update.key, update),
-                            "Failed to append a delta");
-      WARN_NOT_OK(redo_stats.UpdateStats(key_and_update.key.timestamp(), update),
-                  "Failed to update stats");
+    RETURN_NOT_OK(write_status);
+    nrows += batch->block.nrows();
+
+    if (has_next_batch) {
+      if (read_pool) {
+        RETURN_NOT_OK(read_status);
+      } else {
+        RETURN_NOT_OK(ReadBatch(old_base_data_rwise.get(), next_batch));
+      }
     }
-    redo_delta_mutations_written_ += out.size();
-    nrows += n;
+    has_batch = has_next_batch;
+    cur = 1 - cur;
   }
 
   BlockManager* bm = fs_manager_->block_manager();
@@ -32,13 +32,16 @@
 namespace kudu {
 
 class FsManager;
+class RowwiseIterator;
 
 namespace tablet {
 
 class CFileSet;
 class DeltaFileWriter;
+class DeltaStats;
 class DeltaTracker;
 class MultiColumnWriter;
+class MvccSnapshot;
 class RowSetMetadataUpdate;
 
 // Handles major delta compaction: applying deltas to specific columns
@@ -95,6 +98,20 @@ class MajorDeltaCompaction {
   // deltas need to be written back into a delta file.
   Status FlushRowSetAndDeltas();
 
+  struct Batch;
+
+  // Reads the next block of base data from 'base_iter' into 'batch', along
+  // with the REDO mutations which apply to it.
+  Status ReadBatch(RowwiseIterator* base_iter, Batch* batch);
+
+  // Applies the REDO mutations of 'batch', whose first row is 'nrows', and
+  // writes out the new base data, UNDO mutations and remaining REDO mutations.
+  Status WriteBatch(const MvccSnapshot& snap,
+                    size_t nrows,
+                    Batch* batch,
+                    DeltaStats* redo_stats,
+                    DeltaStats* undo_stats);
+
   FsManager* const fs_manager_;
 
   // TODO: doc me
@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/tablet/delta_stats.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <ostream>
 #include <utility>
@@ -25,8 +26,10 @@
 
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/schema.h"
+#include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/tablet.pb.h"
 
 using strings::Substitute;
@@ -39,7 +42,9 @@ using std::vector;
 namespace tablet {
 
 DeltaStats::DeltaStats()
-    : delete_count_(0),
+    : min_row_idx_(MathLimits<rowid_t>::kMax),
+      max_row_idx_(0),
+      delete_count_(0),
       reinsert_count_(0),
       max_timestamp_(Timestamp::kMin),
       min_timestamp_(Timestamp::kMax) {
@@ -58,8 +63,10 @@ void DeltaStats::IncrReinsertCount(int64_t reinsert_count) {
   reinsert_count_ += reinsert_count;
 }
 
-Status DeltaStats::UpdateStats(const Timestamp& timestamp,
+Status DeltaStats::UpdateStats(const DeltaKey& key,
                                const RowChangeList& update) {
+  const Timestamp& timestamp = key.timestamp();
+
   // Decode the mutation incrementing the update count for each of the
   // columns we find present.
   RowChangeListDecoder decoder(update);
@@ -74,6 +81,13 @@ Status DeltaStats::UpdateStats(const Timestamp& timestamp,
       RETURN_NOT_OK(decoder.GetIncludedColumnIds(&col_ids));
       for (const ColumnId& col_id : col_ids) {
         IncrUpdateCount(col_id, 1);
+        TimestampRange& range = ts_ranges_by_col_id_[col_id];
+        if (range.min > timestamp) {
+          range.min = timestamp;
+        }
+        if (range.max < timestamp) {
+          range.max = timestamp;
+        }
       }
       break;
     }
@@ -90,20 +104,41 @@ Status DeltaStats::UpdateStats(const Timestamp& timestamp,
   if (max_timestamp_ < timestamp) {
     max_timestamp_ = timestamp;
   }
+  min_row_idx_ = std::min(min_row_idx_, key.row_idx());
+  max_row_idx_ = std::max(max_row_idx_, key.row_idx());
 
   return Status::OK();
 }
 
+Timestamp DeltaStats::min_timestamp_for_col_id(const ColumnId& col_id) const {
+  const TimestampRange* range = FindOrNull(ts_ranges_by_col_id_, col_id);
+  if (range == nullptr || range->min > range->max) {
+    return min_timestamp_;
+  }
+  return range->min;
+}
+
+Timestamp DeltaStats::max_timestamp_for_col_id(const ColumnId& col_id) const {
+  const TimestampRange* range = FindOrNull(ts_ranges_by_col_id_, col_id);
+  if (range == nullptr || range->min > range->max) {
+    return max_timestamp_;
+  }
+  return range->max;
+}
+
 string DeltaStats::ToString() const {
   return strings::Substitute(
-      "ts range=[$0, $1], delete_count=[$2], reinsert_count=[$3], update_counts_by_col_id=[$4]",
+      "ts range=[$0, $1], row range=[$5, $6], delete_count=[$2], reinsert_count=[$3], "
+      "update_counts_by_col_id=[$4]",
       min_timestamp_.ToString(),
       max_timestamp_.ToString(),
       delete_count_,
       reinsert_count_,
       JoinKeysAndValuesIterator(update_counts_by_col_id_.begin(),
                                 update_counts_by_col_id_.end(),
-                                ":", ","));
+                                ":", ","),
+      min_row_idx_,
+      max_row_idx_);
 }
 
 void DeltaStats::ToPB(DeltaStatsPB* pb) const {
@@ -114,6 +149,15 @@ void DeltaStats::ToPB(DeltaStatsPB* pb) const {
     DeltaStatsPB::ColumnStats* stats = pb->add_column_stats();
     stats->set_col_id(e.first);
     stats->set_update_count(e.second);
+    const TimestampRange* range = FindOrNull(ts_ranges_by_col_id_, e.first);
+    if (range != nullptr && range->min <= range->max) {
+      stats->set_min_timestamp(range->min.ToUint64());
+      stats->set_max_timestamp(range->max.ToUint64());
+    }
+  }
+  if (min_row_idx_ <= max_row_idx_) {
+    pb->set_min_row_idx(min_row_idx_);
+    pb->set_max_row_idx(max_row_idx_);
   }
 
   pb->set_max_timestamp(max_timestamp_.ToUint64());
@@ -124,8 +168,23 @@ Status DeltaStats::InitFromPB(const DeltaStatsPB& pb) {
   delete_count_ = pb.delete_count();
   reinsert_count_ = pb.reinsert_count();
   update_counts_by_col_id_.clear();
+  ts_ranges_by_col_id_.clear();
   for (const DeltaStatsPB::ColumnStats& stats : pb.column_stats()) {
-    IncrUpdateCount(ColumnId(stats.col_id()), stats.update_count());
+    ColumnId col_id(stats.col_id());
+    IncrUpdateCount(col_id, stats.update_count());
+    if (stats.has_min_timestamp() && stats.has_max_timestamp()) {
+      TimestampRange& range = ts_ranges_by_col_id_[col_id];
+      range.min.FromUint64(stats.min_timestamp());
+      range.max.FromUint64(stats.max_timestamp());
+    }
+  }
+  if (pb.has_min_row_idx() && pb.has_max_row_idx()) {
+    min_row_idx_ = pb.min_row_idx();
+    max_row_idx_ = pb.max_row_idx();
+  } else {
+    // Deltas written before row ranges were tracked may span any row.
+    min_row_idx_ = 0;
+    max_row_idx_ = MathLimits<rowid_t>::kMax;
   }
   max_timestamp_.FromUint64(pb.max_timestamp());
   min_timestamp_.FromUint64(pb.min_timestamp());
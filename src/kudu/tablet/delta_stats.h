@@ -22,6 +22,7 @@
 #include <string>
 #include <unordered_map>
 
+#include "kudu/common/rowid.h"
 #include "kudu/common/schema.h" // IWYU pragma: keep
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/map-util.h"
@@ -33,6 +34,7 @@ class RowChangeList;
 
 namespace tablet {
 
+class DeltaKey;
 class DeltaStatsPB;
 
 // A wrapper class for describing data statistics.
@@ -49,9 +51,10 @@ class DeltaStats {
   // Increment the per-store reinsert count by 'reinsert_count'.
   void IncrReinsertCount(int64_t reinsert_count);
 
-  // Increment delete and update counts based on changes contained in
-  // 'update'.
-  Status UpdateStats(const Timestamp& timestamp,
+  // Increment delete and update counts, and widen the row and timestamp
+  // ranges, based on the changes contained in 'update' to the row and
+  // timestamp in 'key'.
+  Status UpdateStats(const DeltaKey& key,
                      const RowChangeList& update);
 
   // Return the number of deletes in the current delta store.
@@ -65,6 +68,16 @@ class DeltaStats {
     return FindWithDefault(update_counts_by_col_id_, col_id, 0);
   }
 
+  // Returns the minimum and maximum timestamp of any update to 'col_id'.
+  // If unknown, e.g. because these stats were read from a delta file written
+  // before per-column ranges were tracked, returns the range of the whole store.
+  Timestamp min_timestamp_for_col_id(const ColumnId& col_id) const;
+  Timestamp max_timestamp_for_col_id(const ColumnId& col_id) const;
+
+  // Returns the minimum and maximum row ordinal of any mutation in a delta file.
+  rowid_t min_row_idx() const { return min_row_idx_; }
+  rowid_t max_row_idx() const { return max_row_idx_; }
+
   // Returns the maximum transaction id of any mutation in a delta file.
   Timestamp max_timestamp() const {
     return max_timestamp_;
@@ -98,7 +111,17 @@ class DeltaStats {
   void AddColumnIdsWithUpdates(std::set<ColumnId>* col_ids) const;
 
  private:
+  // The range of timestamps of the updates to a single column.
+  struct TimestampRange {
+    TimestampRange() : min(Timestamp::kMax), max(Timestamp::kMin) {}
+    Timestamp min;
+    Timestamp max;
+  };
+
   std::unordered_map<ColumnId, int64_t> update_counts_by_col_id_;
+  std::unordered_map<ColumnId, TimestampRange> ts_ranges_by_col_id_;
+  rowid_t min_row_idx_;
+  rowid_t max_row_idx_;
   uint64_t delete_count_;
   uint64_t reinsert_count_;
   Timestamp max_timestamp_;
@@ -54,6 +54,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace.h"
 
 namespace kudu {
 
@@ -513,6 +514,33 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+Status DeltaTracker::MayHaveDeltasBetween(Timestamp start,
+                                          Timestamp end,
+                                          bool* may_have_deltas) const {
+  SharedDeltaStoreVector stores;
+  CollectStores(&stores, UNDOS_AND_REDOS);
+  for (const auto& store : stores) {
+    const DeltaMemStore* dms = dynamic_cast<const DeltaMemStore*>(store.get());
+    if (dms != nullptr) {
+      if (!dms->Empty()) {
+        *may_have_deltas = true;
+        return Status::OK();
+      }
+      continue;
+    }
+    if (!store->Initted()) {
+      RETURN_NOT_OK(store->Init());
+    }
+    const DeltaStats& stats = store->delta_stats();
+    if (stats.min_timestamp() < end && stats.max_timestamp() >= start) {
+      *may_have_deltas = true;
+      return Status::OK();
+    }
+  }
+  *may_have_deltas = false;
+  return Status::OK();
+}
+
 Status DeltaTracker::DoCompactStores(size_t start_idx, size_t end_idx,
          unique_ptr<WritableBlock> block,
          vector<shared_ptr<DeltaStore> > *compacted_stores,
@@ -591,8 +619,29 @@ Status DeltaTracker::NewDeltaFileIterator(
 Status DeltaTracker::WrapIterator(const shared_ptr<CFileSet::Iterator> &base,
                                   const MvccSnapshot &mvcc_snap,
                                   gscoped_ptr<ColumnwiseIterator>* out) const {
+  const Schema* projection = &base->schema();
+  vector<shared_ptr<DeltaStore>> stores;
+  CollectStores(&stores, UNDOS_AND_REDOS);
+
+  // The DeltaApplier only applies deltas to the projected columns, so delta
+  // files whose stats show no relevant updates to them can be left out.
+  int num_skipped = 0;
+  auto it = std::remove_if(stores.begin(), stores.end(),
+                           [&](const shared_ptr<DeltaStore>& store) {
+    DeltaFileReader* dfr = dynamic_cast<DeltaFileReader*>(store.get());
+    if (dfr != nullptr && !dfr->IsRelevantForProjection(*projection, mvcc_snap)) {
+      num_skipped++;
+      return true;
+    }
+    return false;
+  });
+  stores.erase(it, stores.end());
+  if (num_skipped > 0) {
+    TRACE_COUNTER_INCREMENT("delta_iterators_skipped_for_projection", num_skipped);
+  }
+
   unique_ptr<DeltaIterator> iter;
-  RETURN_NOT_OK(NewDeltaIterator(&base->schema(), mvcc_snap, &iter));
+  RETURN_NOT_OK(DeltaIteratorMerger::Create(stores, projection, mvcc_snap, &iter));
 
   out->reset(new DeltaApplier(base, std::move(iter)));
   return Status::OK();
@@ -789,6 +838,19 @@ uint64_t DeltaTracker::RedoDeltaOnDiskSize() const {
   return size;
 }
 
+int64_t DeltaTracker::EstimateDeletedRowCount() const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  int64_t count = 0;
+  for (const shared_ptr<DeltaStore>& ds : redo_delta_stores_) {
+    // We won't force open files just to read their stats.
+    if (!ds->Initted()) {
+      continue;
+    }
+    count += ds->delta_stats().delete_count() - ds->delta_stats().reinsert_count();
+  }
+  return std::max<int64_t>(0, count);
+}
+
 void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const {
   shared_lock<rw_spinlock> lock(component_lock_);
 
@@ -192,6 +192,13 @@ class DeltaTracker {
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted);
 
+  // Sets '*may_have_deltas' to false if none of the delta stores holds
+  // mutations committed at or after 'start' and before 'end', according to
+  // the stats of the delta files, which are initialized as needed. The
+  // DeltaMemStore doesn't track the timestamps of its mutations, so it's
+  // assumed to hold some in any window unless it's empty.
+  Status MayHaveDeltasBetween(Timestamp start, Timestamp end, bool* may_have_deltas) const;
+
   // Opens the input 'blocks' of type 'type' and returns the opened delta file
   // readers in 'stores'.
   Status OpenDeltaReaders(const std::vector<BlockId>& blocks,
@@ -246,6 +253,11 @@ class DeltaTracker {
   uint64_t RedoDeltaOnDiskSize() const;
 
   // Retrieves the list of column indexes that currently have updates.
+  // Returns an estimate of the number of deleted rows, from the stats of the
+  // REDO delta files which are open. Deletes in the DeltaMemStore aren't
+  // counted.
+  int64_t EstimateDeletedRowCount() const;
+
   void GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const;
 
   Mutex* compact_flush_lock() {
@@ -54,7 +54,9 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(deltafile_decode_updates_by_column);
 DECLARE_int32(deltafile_default_block_size);
+DECLARE_int32(deltafile_delete_index_max_entries);
 DEFINE_int32(first_row_to_update, 10000, "the first row to update");
 DEFINE_int32(last_row_to_update, 100000, "the last row to update");
 DEFINE_int32(n_verify, 1, "number of times to verify the updates"
@@ -114,7 +116,7 @@ class TestDeltaFile : public KuduTest {
         DeltaKey key(i, Timestamp(timestamp));
         RowChangeList rcl(buf);
         ASSERT_OK_FAST(dfw.AppendDelta<REDO>(key, rcl));
-        ASSERT_OK_FAST(stats.UpdateStats(key.timestamp(), rcl));
+        ASSERT_OK_FAST(stats.UpdateStats(key, rcl));
       }
     }
     dfw.WriteDeltaStats(stats);
@@ -286,6 +288,54 @@ TEST_F(TestDeltaFile, TestRoundTrip) {
   DoTestRoundTrip();
 }
 
+TEST_F(TestDeltaFile, TestRoundTripWithoutColumnDecoding) {
+  google::FlagSaver saver;
+  FLAGS_deltafile_decode_updates_by_column = false;
+  FLAGS_deltafile_default_block_size = 256;
+  DoTestRoundTrip();
+}
+
+// Test that columns of the projection which the delta stats show have no
+// updates are left untouched, while the updated column is still applied.
+TEST_F(TestDeltaFile, TestApplyUpdatesSkipsColumnsWithoutUpdates) {
+  WriteTestFile();
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+
+  SchemaBuilder builder(schema_);
+  ASSERT_OK(builder.AddNullableColumn("other", UINT32));
+  Schema projection = builder.Build();
+  ASSERT_EQ(0, reader->delta_stats().update_count_for_col_id(projection.column_id(1)));
+
+  DeltaIterator* raw_iter;
+  ASSERT_OK(reader->NewDeltaIterator(
+      &projection, MvccSnapshot::CreateSnapshotIncludingAllTransactions(), &raw_iter));
+  gscoped_ptr<DeltaIterator> it(raw_iter);
+  ASSERT_OK(it->Init(nullptr));
+  ASSERT_OK(it->SeekToOrdinal(FLAGS_first_row_to_update));
+
+  RowBlock block(projection, 100, &arena_);
+  block.ZeroMemory();
+  ColumnBlock updated_col = block.column_block(0);
+  ColumnBlock other_col = block.column_block(1);
+  const uint32_t kUntouched = 12345;
+  for (int i = 0; i < block.nrows(); i++) {
+    other_col.SetCellIsNull(i, false);
+    other_col.SetCellValue(i, &kUntouched);
+  }
+
+  ASSERT_OK(it->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_OK(it->ApplyUpdates(1, &other_col));
+  ASSERT_OK(it->ApplyUpdates(0, &updated_col));
+  for (int i = 0; i < block.nrows(); i++) {
+    uint32_t row = FLAGS_first_row_to_update + i;
+    uint32_t expected_val = (row % 2 == 0) ? row : 0;
+    ASSERT_EQ(expected_val, *reinterpret_cast<const uint32_t*>(updated_col.cell_ptr(i)));
+    ASSERT_FALSE(other_col.is_null(i));
+    ASSERT_EQ(kUntouched, *reinterpret_cast<const uint32_t*>(other_col.cell_ptr(i)));
+  }
+}
+
 TEST_F(TestDeltaFile, TestCollectMutations) {
   WriteTestFile();
 
@@ -356,6 +406,109 @@ TEST_F(TestDeltaFile, TestSkipsDeltasOutOfRange) {
   iter.reset(raw_iter);
 }
 
+// Test that the per-column timestamp ranges and the row range are persisted
+// in the delta stats, and used to decide which projections a file affects.
+TEST_F(TestDeltaFile, TestRelevanceForProjection) {
+  WriteTestFile(10, 20);
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+  const DeltaStats& stats = reader->delta_stats();
+  ASSERT_EQ(static_cast<rowid_t>(FLAGS_first_row_to_update), stats.min_row_idx());
+  ASSERT_EQ(static_cast<rowid_t>(FLAGS_last_row_to_update), stats.max_row_idx());
+  ASSERT_EQ(Timestamp(10), stats.min_timestamp_for_col_id(schema_.column_id(0)));
+  ASSERT_EQ(Timestamp(20), stats.max_timestamp_for_col_id(schema_.column_id(0)));
+
+  SchemaBuilder builder(schema_);
+  ASSERT_OK(builder.AddNullableColumn("other", UINT32));
+  Schema full_schema = builder.Build();
+  Schema only_other;
+  ASSERT_OK(full_schema.CreateProjectionByNames({ "other" }, &only_other));
+
+  MvccSnapshot snap(Timestamp(15));
+  ASSERT_TRUE(reader->IsRelevantForProjection(schema_, snap));
+  ASSERT_TRUE(reader->IsRelevantForProjection(full_schema, snap));
+  ASSERT_FALSE(reader->IsRelevantForProjection(only_other, snap));
+  ASSERT_FALSE(reader->IsRelevantForProjection(schema_, MvccSnapshot(Timestamp(9))));
+
+  // Seeking past the last updated row exhausts the iterator right away.
+  gscoped_ptr<DeltaIterator> it;
+  ASSERT_OK(OpenDeltaFileIteratorFromReader(REDO, reader, &it));
+  ASSERT_OK(it->Init(nullptr));
+  ASSERT_OK(it->SeekToOrdinal(FLAGS_last_row_to_update + 1));
+  ASSERT_FALSE(it->HasNext());
+}
+
+// Test that DELETEs and REINSERTs are applied the same way whether the file
+// has a delete index or not.
+TEST_F(TestDeltaFile, TestApplyDeletesFromDeleteIndex) {
+  const int kNumRows = 1000;
+  for (bool write_index : { true, false }) {
+    SCOPED_TRACE(write_index);
+    FLAGS_deltafile_delete_index_max_entries = write_index ? 1000 : 0;
+
+    // Every third row is deleted at timestamp 10, and every sixth one is
+    // reinserted at timestamp 20. Other rows are updated.
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &block));
+    test_block_ = block->id();
+    DeltaFileWriter dfw(std::move(block));
+    ASSERT_OK(dfw.Start());
+    DeltaStats stats;
+    faststring buf;
+    for (int i = 0; i < kNumRows; i++) {
+      buf.clear();
+      RowChangeListEncoder enc(&buf);
+      uint32_t new_val = i;
+      if (i % 3 != 0) {
+        enc.AddColumnUpdate(schema_.column(0), schema_.column_id(0), &new_val);
+        DeltaKey key(i, Timestamp(10));
+        ASSERT_OK(dfw.AppendDelta<REDO>(key, enc.as_changelist()));
+        ASSERT_OK(stats.UpdateStats(key, enc.as_changelist()));
+        continue;
+      }
+      enc.SetToDelete();
+      DeltaKey delete_key(i, Timestamp(10));
+      ASSERT_OK(dfw.AppendDelta<REDO>(delete_key, enc.as_changelist()));
+      ASSERT_OK(stats.UpdateStats(delete_key, enc.as_changelist()));
+      if (i % 6 == 0) {
+        enc.Reset();
+        enc.SetToReinsert();
+        enc.EncodeColumnMutation(schema_.column(0), schema_.column_id(0), &new_val);
+        DeltaKey reinsert_key(i, Timestamp(20));
+        ASSERT_OK(dfw.AppendDelta<REDO>(reinsert_key, enc.as_changelist()));
+        ASSERT_OK(stats.UpdateStats(reinsert_key, enc.as_changelist()));
+      }
+    }
+    dfw.WriteDeltaStats(stats);
+    ASSERT_OK(dfw.Finish());
+
+    shared_ptr<DeltaFileReader> reader;
+    ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+    ASSERT_EQ(write_index, reader->has_delete_index());
+
+    for (int snap_ts : { 15, 25 }) {
+      DeltaIterator* raw_iter;
+      ASSERT_OK(reader->NewDeltaIterator(&schema_, MvccSnapshot(Timestamp(snap_ts)), &raw_iter));
+      gscoped_ptr<DeltaIterator> it(raw_iter);
+      ASSERT_OK(it->Init(nullptr));
+      ASSERT_OK(it->SeekToOrdinal(0));
+      const int kBatchSize = 128;
+      for (int start_row = 0; start_row < kNumRows; start_row += kBatchSize) {
+        const int nrows = std::min(kBatchSize, kNumRows - start_row);
+        ASSERT_OK(it->PrepareBatch(nrows, DeltaIterator::PREPARE_FOR_APPLY));
+        SelectionVector sel_vec(nrows);
+        sel_vec.SetAllTrue();
+        ASSERT_OK(it->ApplyDeletes(&sel_vec));
+        for (int i = 0; i < nrows; i++) {
+          const int row = start_row + i;
+          const bool deleted = row % 3 == 0 && (row % 6 != 0 || snap_ts < 20);
+          ASSERT_EQ(!deleted, sel_vec.IsRowSelected(i)) << "row " << row << " at " << snap_ts;
+        }
+      }
+    }
+  }
+}
+
 TEST_F(TestDeltaFile, TestLazyInit) {
   WriteTestFile();
 
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/deltafile.h"
 
+#include <algorithm>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -33,6 +34,7 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
@@ -49,6 +51,7 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
@@ -65,6 +68,22 @@ DEFINE_string(deltafile_default_compression_codec, "lz4",
               "The compression codec used when writing deltafiles.");
 TAG_FLAG(deltafile_default_compression_codec, experimental);
 
+DEFINE_bool(deltafile_decode_updates_by_column, true,
+            "Whether to decode the updates of a prepared batch of a delta file "
+            "once, grouped by column, rather than re-decoding every mutation "
+            "for each column the updates are applied to.");
+TAG_FLAG(deltafile_decode_updates_by_column, advanced);
+TAG_FLAG(deltafile_decode_updates_by_column, runtime);
+
+DEFINE_int32(deltafile_delete_index_max_entries, 256 * 1024,
+             "The maximum number of DELETEs and REINSERTs a REDO delta file may "
+             "hold for its delete index to be written. Scans apply the deletes "
+             "of a file with a delete index without decoding its mutations. The "
+             "index is kept in memory once the file is opened. Set to 0 to stop "
+             "writing delete indexes.");
+TAG_FLAG(deltafile_delete_index_max_entries, advanced);
+TAG_FLAG(deltafile_delete_index_max_entries, runtime);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -88,14 +107,56 @@ using fs::WritableBlock;
 namespace tablet {
 
 const char * const DeltaFileReader::kDeltaStatsEntryName = "deltafilestats";
+const char * const DeltaFileReader::kDeleteIndexEntryName = "deltafiledeletes";
 
 namespace {
 
+// The delete index is encoded as the varint64 smallest timestamp of its
+// entries, followed by one pair of varints per entry: the difference of its
+// row index with the previous entry's, shifted left by one bit with the low
+// bit set for REINSERTs, and the difference of its timestamp with the
+// smallest one.
+void EncodeDeleteIndex(const vector<DeltaFileDeleteIndexEntry>& entries, faststring* buf) {
+  DCHECK(!entries.empty());
+  uint64_t min_ts = entries[0].timestamp.value();
+  for (const auto& e : entries) {
+    min_ts = std::min(min_ts, e.timestamp.value());
+  }
+  buf->clear();
+  PutVarint64(buf, min_ts);
+  rowid_t prev_idx = 0;
+  for (const auto& e : entries) {
+    PutVarint64(buf, (static_cast<uint64_t>(e.row_idx - prev_idx) << 1) | e.is_reinsert);
+    PutVarint64(buf, e.timestamp.value() - min_ts);
+    prev_idx = e.row_idx;
+  }
+}
+
+Status DecodeDeleteIndex(Slice data, vector<DeltaFileDeleteIndexEntry>* entries) {
+  entries->clear();
+  uint64_t min_ts;
+  if (!GetVarint64(&data, &min_ts)) {
+    return Status::Corruption("unable to decode the delete index");
+  }
+  rowid_t row_idx = 0;
+  while (!data.empty()) {
+    uint64_t idx_and_type;
+    uint64_t ts_delta;
+    if (!GetVarint64(&data, &idx_and_type) || !GetVarint64(&data, &ts_delta)) {
+      return Status::Corruption("unable to decode the delete index");
+    }
+    row_idx += idx_and_type >> 1;
+    entries->push_back({ row_idx, (idx_and_type & 1) != 0, Timestamp(min_ts + ts_delta) });
+  }
+  return Status::OK();
+}
+
 } // namespace
 
 DeltaFileWriter::DeltaFileWriter(unique_ptr<WritableBlock> block)
+    : delete_index_overflowed_(false)
 #ifndef NDEBUG
- : has_appended_(false)
+    , has_appended_(false)
 #endif
 { // NOLINT(*)
   cfile::WriterOptions opts;
@@ -146,6 +207,11 @@ Status DeltaFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transact
   if (writer_->written_value_count() == 0) {
     return Status::Aborted("no deltas written");
   }
+  if (!delete_index_.empty() && !delete_index_overflowed_) {
+    faststring buf;
+    EncodeDeleteIndex(delete_index_, &buf);
+    writer_->AddMetadataPair(DeltaFileReader::kDeleteIndexEntryName, buf);
+  }
   return writer_->FinishAndReleaseBlock(transaction);
 }
 
@@ -179,6 +245,16 @@ Status DeltaFileWriter::AppendDelta<REDO>(
   last_key_ = key;
 #endif
 
+  if ((delta.is_delete() || delta.is_reinsert()) && !delete_index_overflowed_) {
+    if (static_cast<int64_t>(delete_index_.size()) >=
+        FLAGS_deltafile_delete_index_max_entries) {
+      delete_index_overflowed_ = true;
+      delete_index_.clear();
+      delete_index_.shrink_to_fit();
+    } else {
+      delete_index_.push_back({ key.row_idx(), delta.is_reinsert(), key.timestamp() });
+    }
+  }
   return DoAppendDelta(key, delta);
 }
 
@@ -252,6 +328,7 @@ Status DeltaFileReader::OpenNoInit(unique_ptr<ReadableBlock> block,
 DeltaFileReader::DeltaFileReader(unique_ptr<CFileReader> cf_reader,
                                  DeltaType delta_type)
     : reader_(cf_reader.release()),
+      has_delete_index_(false),
       delta_type_(delta_type) {}
 
 Status DeltaFileReader::Init() {
@@ -270,6 +347,9 @@ Status DeltaFileReader::InitOnce() {
 
   // Initialize delta file stats
   RETURN_NOT_OK(ReadDeltaStats());
+  if (delta_type_ == REDO) {
+    RETURN_NOT_OK(ReadDeleteIndex());
+  }
   return Status::OK();
 }
 
@@ -289,6 +369,20 @@ Status DeltaFileReader::ReadDeltaStats() {
   return Status::OK();
 }
 
+Status DeltaFileReader::ReadDeleteIndex() {
+  string buf;
+  if (!reader_->GetMetadataEntry(kDeleteIndexEntryName, &buf)) {
+    // Files written with too many deletes, or before delete indexes existed,
+    // have none. Those without any deletes don't need one.
+    has_delete_index_ = delta_stats_->delete_count() == 0 &&
+                        delta_stats_->reinsert_count() == 0;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(DecodeDeleteIndex(buf, &delete_index_));
+  has_delete_index_ = true;
+  return Status::OK();
+}
+
 bool DeltaFileReader::IsRelevantForSnapshot(const MvccSnapshot& snap) const {
   if (!init_once_.init_succeeded()) {
     // If we're not initted, it means we have no delta stats and must
@@ -305,6 +399,36 @@ bool DeltaFileReader::IsRelevantForSnapshot(const MvccSnapshot& snap) const {
   return false;
 }
 
+bool DeltaFileReader::IsRelevantForProjection(const Schema& projection,
+                                              const MvccSnapshot& snap) const {
+  if (!IsRelevantForSnapshot(snap)) {
+    return false;
+  }
+  if (!init_once_.init_succeeded()) {
+    return true;
+  }
+  if (delta_stats_->delete_count() > 0 || delta_stats_->reinsert_count() > 0) {
+    return true;
+  }
+  for (int i = 0; i < projection.num_columns(); i++) {
+    ColumnId col_id = projection.column_id(i);
+    if (delta_stats_->update_count_for_col_id(col_id) == 0) {
+      continue;
+    }
+    if (delta_type_ == REDO &&
+        snap.MayHaveCommittedTransactionsAtOrAfter(
+            delta_stats_->min_timestamp_for_col_id(col_id))) {
+      return true;
+    }
+    if (delta_type_ == UNDO &&
+        snap.MayHaveUncommittedTransactionsAtOrBefore(
+            delta_stats_->max_timestamp_for_col_id(col_id))) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Status DeltaFileReader::CloneForDebugging(FsManager* fs_manager,
                                           const shared_ptr<MemTracker>& parent_mem_tracker,
                                           shared_ptr<DeltaFileReader>* out) const {
@@ -411,6 +535,7 @@ DeltaFileIterator::DeltaFileIterator(shared_ptr<DeltaFileReader> dfr,
       prepared_(false),
       exhausted_(false),
       initted_(false),
+      updates_decoded_(false),
       delta_type_(delta_type),
       cache_blocks_(CFileReader::CACHE_BLOCK) {}
 
@@ -442,6 +567,27 @@ Status DeltaFileIterator::SeekToOrdinal(rowid_t idx) {
     return Status::OK();
   }
 
+  if (col_has_updates_.empty()) {
+    // REINSERTs are accounted for in the per-column update counts, so a zero
+    // count means no mutation in this file can change the column.
+    const DeltaStats& stats = dfr_->delta_stats();
+    col_has_updates_.resize(projection_->num_columns());
+    for (int i = 0; i < projection_->num_columns(); i++) {
+      col_has_updates_[i] = stats.update_count_for_col_id(projection_->column_id(i)) > 0;
+    }
+  }
+
+  // If every mutation in this file is for a row before 'idx', there is
+  // nothing left to apply, and no need to consult the index.
+  if (idx > dfr_->delta_stats().max_row_idx()) {
+    exhausted_ = true;
+    delta_blocks_.clear();
+    prepared_idx_ = idx;
+    prepared_count_ = 0;
+    prepared_ = false;
+    return Status::OK();
+  }
+
   if (!index_iter_) {
     index_iter_.reset(IndexTreeIterator::Create(
         dfr_->cfile_reader().get(),
@@ -586,6 +732,7 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   prepared_idx_ = start_row;
   prepared_count_ = nrows;
   prepared_ = true;
+  updates_decoded_ = false;
   return Status::OK();
 }
 
@@ -736,9 +883,124 @@ inline Status ApplyingVisitor<UNDO>::Visit(const DeltaKey& key,
   return Status::OK();
 }
 
+// Visitor which decodes the updates of the prepared batch, grouping them by
+// projected column so that they can later be scattered one column at a time.
+template<DeltaType Type>
+struct DecodingVisitor {
+
+  Status Visit(const DeltaKey &key, const Slice &deltas, bool* continue_visit);
+
+  inline Status DecodeMutation(const DeltaKey &key, const Slice &deltas) {
+    int64_t rel_idx = key.row_idx() - dfi->prepared_idx_;
+    DCHECK_GE(rel_idx, 0);
+
+    const Schema* schema = dfi->projection_;
+    RowChangeListDecoder decoder((RowChangeList(deltas)));
+    RETURN_NOT_OK(decoder.Init());
+    if (decoder.is_delete()) {
+      // DELETEs are processed by LivenessVisitor.
+      return Status::OK();
+    }
+    DCHECK(decoder.is_update() || decoder.is_reinsert());
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate dec;
+      RETURN_NOT_OK(decoder.DecodeNext(&dec));
+      int col_idx;
+      const void* unused;
+      RETURN_NOT_OK(dec.Validate(*schema, &col_idx, &unused));
+      if (col_idx == Schema::kColumnNotFound) {
+        continue;
+      }
+      dfi->decoded_updates_[col_idx].push_back(
+          { static_cast<uint32_t>(rel_idx), dec.null, dec.raw_value });
+    }
+    return Status::OK();
+  }
+
+  DeltaFileIterator *dfi;
+};
+
+template<>
+inline Status DecodingVisitor<REDO>::Visit(const DeltaKey& key,
+                                           const Slice& deltas,
+                                           bool* continue_visit) {
+  if (IsRedoRelevant(dfi->mvcc_snap_, key.timestamp(), continue_visit)) {
+    return DecodeMutation(key, deltas);
+  }
+  return Status::OK();
+}
+
+template<>
+inline Status DecodingVisitor<UNDO>::Visit(const DeltaKey& key,
+                                           const Slice& deltas,
+                                           bool* continue_visit) {
+  if (IsUndoRelevant(dfi->mvcc_snap_, key.timestamp(), continue_visit)) {
+    return DecodeMutation(key, deltas);
+  }
+  return Status::OK();
+}
+
+Status DeltaFileIterator::DecodeUpdatesByColumn() {
+  decoded_updates_.resize(projection_->num_columns());
+  for (auto& col_updates : decoded_updates_) {
+    col_updates.clear();
+  }
+  if (delta_type_ == REDO) {
+    DecodingVisitor<REDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
+  } else {
+    DecodingVisitor<UNDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
+  }
+  updates_decoded_ = true;
+  return Status::OK();
+}
+
+Status DeltaFileIterator::ScatterDecodedUpdates(size_t col_to_apply, ColumnBlock* dst) {
+  const ColumnSchema& col_schema = projection_->column(col_to_apply);
+  const vector<DecodedColumnUpdate>& col_updates = decoded_updates_[col_to_apply];
+
+  if (col_schema.type_info()->physical_type() == BINARY) {
+    for (const DecodedColumnUpdate& u : col_updates) {
+      SimpleConstCell src(&col_schema, u.is_null ? nullptr : &u.value);
+      ColumnBlock::Cell dst_cell = dst->cell(u.rel_idx);
+      RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+    }
+    return Status::OK();
+  }
+
+  // Fixed-length values were already size-checked while decoding, so they
+  // can be copied straight into the destination block.
+  const bool nullable = dst->is_nullable();
+  for (const DecodedColumnUpdate& u : col_updates) {
+    if (nullable) {
+      dst->SetCellIsNull(u.rel_idx, u.is_null);
+    }
+    if (!u.is_null) {
+      dst->SetCellValue(u.rel_idx, u.value.data());
+    }
+  }
+  return Status::OK();
+}
+
 Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
   DCHECK_LE(prepared_count_, dst->nrows());
 
+  if (PREDICT_TRUE(col_to_apply < col_has_updates_.size()) &&
+      !col_has_updates_[col_to_apply]) {
+    DVLOG(3) << "No updates to column " << col_to_apply << " in this delta file";
+    return Status::OK();
+  }
+
+  if (FLAGS_deltafile_decode_updates_by_column) {
+    if (!updates_decoded_) {
+      RETURN_NOT_OK(DecodeUpdatesByColumn());
+    }
+    DVLOG(3) << "Scattering decoded " << DeltaType_Name(delta_type_)
+             << " updates to " << col_to_apply;
+    return ScatterDecodedUpdates(col_to_apply, dst);
+  }
+
   if (delta_type_ == REDO) {
     DVLOG(3) << "Applying REDO mutations to " << col_to_apply;
     ApplyingVisitor<REDO> visitor = {this, col_to_apply, dst};
@@ -807,9 +1069,36 @@ inline Status LivenessVisitor<UNDO>::Visit(const DeltaKey& key,
 }
 
 
+void DeltaFileIterator::ApplyIndexedDeletes(SelectionVector* sel_vec) {
+  const vector<DeltaFileDeleteIndexEntry>& index = dfr_->delete_index_;
+  const rowid_t end_idx = prepared_idx_ + prepared_count_;
+  auto it = std::lower_bound(index.begin(), index.end(), prepared_idx_,
+                             [](const DeltaFileDeleteIndexEntry& e, rowid_t idx) {
+                               return e.row_idx < idx;
+                             });
+  // The entries of each row are in ascending timestamp order, so the last
+  // committed one decides whether the row is live.
+  for (; it != index.end() && it->row_idx < end_idx; ++it) {
+    if (!mvcc_snap_.IsCommitted(it->timestamp)) {
+      continue;
+    }
+    const size_t rel_idx = it->row_idx - prepared_idx_;
+    if (it->is_reinsert) {
+      sel_vec->SetRowSelected(rel_idx);
+    } else {
+      sel_vec->SetRowUnselected(rel_idx);
+    }
+  }
+}
+
 Status DeltaFileIterator::ApplyDeletes(SelectionVector *sel_vec) {
   DCHECK_LE(prepared_count_, sel_vec->nrows());
   if (delta_type_ == REDO) {
+    if (dfr_->has_delete_index_) {
+      DVLOG(3) << "Applying REDO deletes from the delete index";
+      ApplyIndexedDeletes(sel_vec);
+      return Status::OK();
+    }
     DVLOG(3) << "Applying REDO deletes";
     LivenessVisitor<REDO> visitor = { this, sel_vec };
     return VisitMutations(&visitor);
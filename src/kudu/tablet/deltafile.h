@@ -33,6 +33,7 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/common/rowid.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -77,8 +78,19 @@ struct ApplyingVisitor;
 template<DeltaType Type>
 struct CollectingVisitor;
 template<DeltaType Type>
+struct DecodingVisitor;
+template<DeltaType Type>
 struct LivenessVisitor;
 
+// An entry of the delete index of a REDO delta file: a DELETE, or a REINSERT
+// if 'is_reinsert' is set, of row 'row_idx' at 'timestamp'. The entries are
+// in the order of the file's deltas, by ascending row index then timestamp.
+struct DeltaFileDeleteIndexEntry {
+  rowid_t row_idx;
+  bool is_reinsert;
+  Timestamp timestamp;
+};
+
 class DeltaFileWriter {
  public:
   // Construct a new delta file writer.
@@ -121,6 +133,12 @@ class DeltaFileWriter {
   // of the deltas
   faststring tmp_buf_;
 
+  // The DELETEs and REINSERTs appended as REDOs, written as the delete index
+  // of the file unless there were more than
+  // --deltafile_delete_index_max_entries of them.
+  std::vector<DeltaFileDeleteIndexEntry> delete_index_;
+  bool delete_index_overflowed_;
+
   #ifndef NDEBUG
   // The index of the previously written row.
   // This is used in debug mode to make sure that rows are appended
@@ -136,6 +154,7 @@ class DeltaFileReader : public DeltaStore,
                         public std::enable_shared_from_this<DeltaFileReader> {
  public:
   static const char * const kDeltaStatsEntryName;
+  static const char * const kDeleteIndexEntryName;
 
   // Fully open a delta file using a previously opened block.
   //
@@ -188,6 +207,21 @@ class DeltaFileReader : public DeltaStore,
   // been fully initialized.
   bool IsRelevantForSnapshot(const MvccSnapshot& snap) const;
 
+  // Returns true if this delta file may include any deltas which need to be
+  // applied to the columns of 'projection' when scanning the given snapshot,
+  // or if the file has not yet been fully initialized. Files holding DELETEs
+  // or REINSERTs are always relevant, since they affect row liveness.
+  //
+  // Unlike IsRelevantForSnapshot(), a false result is only meaningful for
+  // iterators which apply deltas: iterators that collect mutations return
+  // updates to every column, whatever their projection.
+  bool IsRelevantForProjection(const Schema& projection, const MvccSnapshot& snap) const;
+
+  // Returns true if the DELETEs and REINSERTs of this file are applied from
+  // its delete index rather than by decoding its deltas. Only meaningful once
+  // the file is initialized.
+  bool has_delete_index() const { return has_delete_index_; }
+
   // Clone this DeltaFileReader for testing and validation purposes (such as
   // while in DEBUG mode). The resulting object will not be Initted().
   Status CloneForDebugging(FsManager* fs_manager,
@@ -211,9 +245,17 @@ class DeltaFileReader : public DeltaStore,
 
   Status ReadDeltaStats();
 
+  // Loads the delete index of a REDO file, if it has one.
+  Status ReadDeleteIndex();
+
   std::shared_ptr<cfile::CFileReader> reader_;
   gscoped_ptr<DeltaStats> delta_stats_;
 
+  // The DELETEs and REINSERTs of the file, if 'has_delete_index_' is set.
+  // Files without any have an empty index.
+  std::vector<DeltaFileDeleteIndexEntry> delete_index_;
+  bool has_delete_index_;
+
   // The type of this delta, i.e. UNDO or REDO.
   const DeltaType delta_type_;
 
@@ -245,6 +287,8 @@ class DeltaFileIterator : public DeltaIterator {
   friend struct ApplyingVisitor<UNDO>;
   friend struct CollectingVisitor<REDO>;
   friend struct CollectingVisitor<UNDO>;
+  friend struct DecodingVisitor<REDO>;
+  friend struct DecodingVisitor<UNDO>;
   friend struct LivenessVisitor<REDO>;
   friend struct LivenessVisitor<UNDO>;
   friend struct FilterAndAppendVisitor;
@@ -287,6 +331,21 @@ class DeltaFileIterator : public DeltaIterator {
     std::string ToString() const;
   };
 
+  // A single column update which applies to the prepared batch, as decoded
+  // from a REDO or UNDO RowChangeList. 'value' points into the delta block
+  // it was decoded from, and is only valid until the next PrepareBatch().
+  struct DecodedColumnUpdate {
+    // The index of the updated row, relative to 'prepared_idx_'.
+    uint32_t rel_idx;
+
+    // If true, the update sets the cell to NULL and 'value' is unused.
+    bool is_null;
+
+    // The raw new value of the cell: the little-endian value for fixed-length
+    // types, or the string data for BINARY ones.
+    Slice value;
+  };
+
 
   // The passed 'projection' and 'dfr' must remain valid for the lifetime
   // of the iterator.
@@ -311,6 +370,17 @@ class DeltaFileIterator : public DeltaIterator {
   template<class Visitor>
   Status VisitMutations(Visitor *visitor);
 
+  // Decode every relevant update in the prepared batch exactly once, grouping
+  // the decoded values by projected column into 'decoded_updates_'.
+  Status DecodeUpdatesByColumn();
+
+  // Scatter the decoded updates for 'col_to_apply' into 'dst'.
+  Status ScatterDecodedUpdates(size_t col_to_apply, ColumnBlock* dst);
+
+  // Applies the DELETEs and REINSERTs of the prepared batch to 'sel_vec'
+  // from the delete index of the file, without decoding its deltas.
+  void ApplyIndexedDeletes(SelectionVector* sel_vec);
+
   // Log a FATAL error message about a bad delta.
   void FatalUnexpectedDelta(const DeltaKey &key, const Slice &deltas,
                             const std::string &msg);
@@ -336,6 +406,16 @@ class DeltaFileIterator : public DeltaIterator {
   // which correspond to prepared_block_.
   std::deque<std::unique_ptr<PreparedDeltaBlock>> delta_blocks_;
 
+  // Indexed by projection column. False if the delta stats show that this
+  // file holds no updates at all to that column, so ApplyUpdates() can skip it.
+  std::vector<bool> col_has_updates_;
+
+  // Indexed by projection column. The updates to apply to the prepared batch,
+  // in the order they must be applied. Built lazily by the first ApplyUpdates()
+  // call after PrepareBatch(), when 'updates_decoded_' is false.
+  std::vector<std::vector<DecodedColumnUpdate>> decoded_updates_;
+  bool updates_decoded_;
+
   // Temporary buffer used in seeking.
   faststring tmp_buf_;
 
@@ -19,6 +19,7 @@
 #include <ostream>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/common/columnblock.h"
@@ -40,6 +41,8 @@
 #include "kudu/util/memory/memory.h"
 #include "kudu/util/status.h"
 
+DECLARE_bool(tablet_arena_use_huge_pages);
+
 namespace kudu {
 namespace tablet {
 
@@ -75,12 +78,18 @@ DeltaMemStore::DeltaMemStore(int64_t id,
   : id_(id),
     rs_id_(rs_id),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(), std::move(parent_tracker))),
+        FLAGS_tablet_arena_use_huge_pages ?
+            static_cast<BufferAllocator*>(HugePageBufferAllocator::Get()) :
+            HeapBufferAllocator::Get(),
+        std::move(parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
     disambiguator_sequence_number_(0) {
+  if (FLAGS_tablet_arena_use_huge_pages) {
+    arena_->SetMaxBufferSize(HugePageBufferAllocator::kHugePageSize);
+  }
 }
 
 Status DeltaMemStore::Init() {
@@ -134,7 +143,7 @@ Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
     RETURN_NOT_OK(key.DecodeFrom(&key_slice));
     RowChangeList rcl(val);
     RETURN_NOT_OK_PREPEND(dfw->AppendDelta<REDO>(key, rcl), "Failed to append delta");
-    stats->UpdateStats(key.timestamp(), rcl);
+    stats->UpdateStats(key, rcl);
     iter->Next();
   }
   dfw->WriteDeltaStats(*stats);
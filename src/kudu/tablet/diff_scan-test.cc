@@ -0,0 +1,190 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/diff_scan.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/clock/clock.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/compaction.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/tablet/tablet-test-base.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+class DiffScanTest : public TabletTestBase<IntKeyTestSetup<INT64>> {
+ public:
+  DiffScanTest()
+      : projection_({ ColumnSchema("key_idx", INT32),
+                      ColumnSchema("val", INT32),
+                      ColumnSchema(kDiffScanChangeTypeColumnName, INT8),
+                      ColumnSchema(kDiffScanCommitTimestampColumnName, INT64) },
+                    0) {
+  }
+
+ protected:
+  // Scans the changes between 'start' and 'end' which match 'spec', if not
+  // null, into 'changes' as "<key_idx>: <change type> val=<val>" strings
+  // ordered by key_idx. Checks that their timestamps are in the window.
+  void ScanDiff(Timestamp start, Timestamp end, ScanSpec* spec, vector<string>* changes) {
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewDiffScanIterator(projection_, start, end, &iter));
+    ScanSpec empty_spec;
+    ASSERT_OK(iter->Init(spec ? spec : &empty_spec));
+
+    changes->clear();
+    Arena arena(1024);
+    RowBlock block(iter->schema(), 100, &arena);
+    while (iter->HasNext()) {
+      arena.Reset();
+      ASSERT_OK(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (!block.selection_vector()->IsRowSelected(i)) {
+          continue;
+        }
+        RowBlockRow row = block.row(i);
+        const int32_t key_idx = *reinterpret_cast<const int32_t*>(row.cell_ptr(0));
+        const int32_t val = *reinterpret_cast<const int32_t*>(row.cell_ptr(1));
+        const int8_t type = *reinterpret_cast<const int8_t*>(row.cell_ptr(2));
+        const int64_t ts = *reinterpret_cast<const int64_t*>(row.cell_ptr(3));
+        ASSERT_GE(ts, start.value());
+        ASSERT_LT(ts, end.value());
+        const char* type_name = type == DIFF_SCAN_INSERT ? "INSERT" :
+                                type == DIFF_SCAN_UPDATE ? "UPDATE" :
+                                type == DIFF_SCAN_DELETE ? "DELETE" : "UNKNOWN";
+        changes->push_back(Substitute("$0: $1 val=$2", key_idx, type_name, val));
+      }
+    }
+    std::sort(changes->begin(), changes->end());
+  }
+
+  const Schema projection_;
+};
+
+// Tests that each kind of change is reported with the right values whether
+// the history is held by the MemRowSet, by DeltaMemStores, by delta files or
+// by the UNDOs of compacted rowsets.
+TEST_F(DiffScanTest, TestChangeTypes) {
+  InsertTestRows(0, 5, 0);
+  ASSERT_OK(tablet()->Flush());
+
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  const Timestamp start = clock()->Now();
+  ASSERT_OK(UpdateTestRow(&writer, 1, 10));
+  ASSERT_OK(DeleteTestRow(&writer, 2));
+  // Deleted and reinserted: an update.
+  ASSERT_OK(DeleteTestRow(&writer, 3));
+  ASSERT_OK(InsertTestRow(&writer, 3, 30));
+  ASSERT_OK(InsertTestRow(&writer, 5, 50));
+  // Inserted and deleted within the window: not a change.
+  ASSERT_OK(InsertTestRow(&writer, 6, 60));
+  ASSERT_OK(DeleteTestRow(&writer, 6));
+  const Timestamp end = clock()->Now();
+  // Changed after the window.
+  ASSERT_OK(UpdateTestRow(&writer, 4, 40));
+  ASSERT_OK(UpdateTestRow(&writer, 5, 55));
+
+  const vector<string> expected = {
+    "1: UPDATE val=10",
+    "2: DELETE val=0",
+    "3: UPDATE val=30",
+    "5: INSERT val=50",
+  };
+  vector<string> changes;
+  NO_FATALS(ScanDiff(start, end, nullptr, &changes));
+  ASSERT_EQ(expected, changes);
+
+  ASSERT_OK(tablet()->Flush());
+  NO_FATALS(ScanDiff(start, end, nullptr, &changes));
+  ASSERT_EQ(expected, changes);
+
+  ASSERT_OK(tablet()->FlushAllDMSForTests());
+  NO_FATALS(ScanDiff(start, end, nullptr, &changes));
+  ASSERT_EQ(expected, changes);
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  NO_FATALS(ScanDiff(start, end, nullptr, &changes));
+  ASSERT_EQ(expected, changes);
+
+  // Predicates are evaluated over the yielded values.
+  ScanSpec spec;
+  const int32_t lower = 30;
+  spec.AddPredicate(ColumnPredicate::Range(projection_.column(1), &lower, nullptr));
+  NO_FATALS(ScanDiff(start, end, &spec, &changes));
+  ASSERT_EQ(vector<string>({ "3: UPDATE val=30", "5: INSERT val=50" }), changes);
+
+  // An empty window has no changes.
+  NO_FATALS(ScanDiff(end, end, nullptr, &changes));
+  ASSERT_TRUE(changes.empty());
+
+  gscoped_ptr<RowwiseIterator> iter;
+  ASSERT_TRUE(tablet()->NewDiffScanIterator(projection_, end, start, &iter).IsInvalidArgument());
+}
+
+// Tests that DiskRowSets without changes in the window aren't read.
+TEST_F(DiffScanTest, TestSkipsUnchangedRowSets) {
+  InsertTestRows(0, 10, 0);
+  ASSERT_OK(tablet()->Flush());
+  const Timestamp start = clock()->Now();
+  const Timestamp end = clock()->Now();
+
+  vector<shared_ptr<RowSet>> rowsets;
+  tablet()->GetRowSetsForTests(&rowsets);
+  ASSERT_EQ(1, rowsets.size());
+  gscoped_ptr<CompactionInput> input;
+  ASSERT_OK(rowsets[0]->NewDiffScanInput(&schema_, start, end, &input));
+  ASSERT_FALSE(input);
+
+  // The window of the inserts does need the rowset.
+  ASSERT_OK(rowsets[0]->NewDiffScanInput(&schema_, Timestamp::kMin, end, &input));
+  ASSERT_TRUE(input);
+
+  vector<string> changes;
+  NO_FATALS(ScanDiff(start, end, nullptr, &changes));
+  ASSERT_TRUE(changes.empty());
+  NO_FATALS(ScanDiff(Timestamp::kMin, end, nullptr, &changes));
+  ASSERT_EQ(10, changes.size());
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,367 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/diff_scan.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/row.h"
+#include "kudu/common/row_changelist.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/mutation.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/slice.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+const char* const kDiffScanChangeTypeColumnName = "$change_type";
+const char* const kDiffScanCommitTimestampColumnName = "$commit_timestamp";
+
+bool IsDiffScanVirtualColumn(const string& col_name) {
+  return col_name == kDiffScanChangeTypeColumnName ||
+         col_name == kDiffScanCommitTimestampColumnName;
+}
+
+namespace {
+
+// The history of a version of a row, i.e. of its incarnation in one rowset,
+// over the window of a diff scan.
+struct VersionHistory {
+  bool live_at_start = true;
+  bool live_at_end = true;
+  // Whether any of the version's mutations committed in the window.
+  bool changed = false;
+  Timestamp last_change = Timestamp::kMin;
+};
+
+Status TraceVersion(const CompactionInputRow& version,
+                    const MvccSnapshot& start_snap,
+                    const MvccSnapshot& end_snap,
+                    VersionHistory* history) {
+  auto trace_change = [&](Timestamp ts) {
+    if (!start_snap.IsCommitted(ts) && end_snap.IsCommitted(ts)) {
+      history->changed = true;
+      history->last_change = std::max(history->last_change, ts);
+    }
+  };
+
+  // The base row was live when its rowset was written. Its UNDOs, newest
+  // first, roll it back: an UNDO DELETE to before its insertion, and an UNDO
+  // REINSERT to before its deletion.
+  for (const Mutation* undo = version.undo_head; undo != nullptr; undo = undo->next()) {
+    RowChangeListDecoder decoder(undo->changelist());
+    RETURN_NOT_OK(decoder.Init());
+    if (!decoder.is_update()) {
+      if (!start_snap.IsCommitted(undo->timestamp())) {
+        history->live_at_start = decoder.is_reinsert();
+      }
+      if (!end_snap.IsCommitted(undo->timestamp())) {
+        history->live_at_end = decoder.is_reinsert();
+      }
+    }
+    trace_change(undo->timestamp());
+  }
+
+  // Its REDOs, oldest first, roll it forward.
+  for (const Mutation* redo = version.redo_head; redo != nullptr; redo = redo->acquire_next()) {
+    RowChangeListDecoder decoder(redo->changelist());
+    RETURN_NOT_OK(decoder.Init());
+    if (!decoder.is_update()) {
+      if (start_snap.IsCommitted(redo->timestamp())) {
+        history->live_at_start = decoder.is_reinsert();
+      }
+      if (end_snap.IsCommitted(redo->timestamp())) {
+        history->live_at_end = decoder.is_reinsert();
+      }
+    }
+    trace_change(redo->timestamp());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+DiffScanIterator::DiffScanIterator(const Tablet* tablet,
+                                   const Schema& projection,
+                                   Timestamp start,
+                                   Timestamp end)
+    : tablet_(tablet),
+      projection_(projection),
+      start_(start),
+      end_(end),
+      start_snap_(start),
+      end_snap_(end),
+      lower_bound_key_(nullptr),
+      exclusive_upper_bound_key_(nullptr),
+      block_prepared_(false),
+      next_input_row_(0),
+      done_(false) {
+}
+
+DiffScanIterator::~DiffScanIterator() {
+}
+
+Status DiffScanIterator::MapProjection() {
+  const Schema* tablet_schema = tablet_->schema();
+  vector<ColumnSchema> read_cols;
+  vector<ColumnId> read_col_ids;
+  for (int i = 0; i < tablet_schema->num_key_columns(); i++) {
+    read_cols.push_back(tablet_schema->column(i));
+    read_col_ids.push_back(tablet_schema->column_id(i));
+  }
+
+  projected_cols_.clear();
+  for (int i = 0; i < projection_.num_columns(); i++) {
+    const ColumnSchema& col = projection_.column(i);
+    if (IsDiffScanVirtualColumn(col.name())) {
+      const bool is_change_type = col.name() == kDiffScanChangeTypeColumnName;
+      if (col.type_info()->type() != (is_change_type ? INT8 : INT64) || col.is_nullable()) {
+        return Status::InvalidArgument("invalid type for diff scan column", col.ToString());
+      }
+      projected_cols_.push_back({ is_change_type ? ProjectedColumn::CHANGE_TYPE
+                                                 : ProjectedColumn::COMMIT_TIMESTAMP, -1 });
+      continue;
+    }
+
+    const int tablet_col_idx = tablet_schema->find_column(col.name());
+    if (tablet_col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("column not found in the tablet schema", col.name());
+    }
+    const ColumnSchema& tablet_col = tablet_schema->column(tablet_col_idx);
+    if (col.type_info()->type() != tablet_col.type_info()->type() ||
+        col.is_nullable() != tablet_col.is_nullable()) {
+      return Status::InvalidArgument(
+          Substitute("projected column $0 does not match the tablet column $1",
+                     col.ToString(), tablet_col.ToString()));
+    }
+    const ColumnId col_id = tablet_schema->column_id(tablet_col_idx);
+    auto it = std::find(read_col_ids.begin(), read_col_ids.end(), col_id);
+    if (it == read_col_ids.end()) {
+      read_cols.push_back(tablet_col);
+      read_col_ids.push_back(col_id);
+      it = read_col_ids.end() - 1;
+    }
+    projected_cols_.push_back({ ProjectedColumn::READ_COLUMN,
+                                static_cast<int>(it - read_col_ids.begin()) });
+  }
+  return read_schema_.Reset(read_cols, read_col_ids, tablet_schema->num_key_columns());
+}
+
+Status DiffScanIterator::Init(ScanSpec* spec) {
+  RETURN_NOT_OK(MapProjection());
+  if (spec != nullptr) {
+    for (const auto& entry : spec->predicates()) {
+      if (projection_.find_column(entry.first) == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("predicate column is not in the diff scan projection",
+                                       entry.first);
+      }
+      predicates_.push_back(entry.second);
+    }
+    spec->RemovePredicates();
+    lower_bound_key_ = spec->lower_bound_key();
+    exclusive_upper_bound_key_ = spec->exclusive_upper_bound_key();
+  }
+  RETURN_NOT_OK(tablet_->CaptureDiffScanInput(&read_schema_, start_, end_, spec,
+                                              &components_, &input_));
+  if (input_) {
+    RETURN_NOT_OK(input_->Init());
+  }
+  return Status::OK();
+}
+
+bool DiffScanIterator::HasNext() const {
+  return !done_ && input_ &&
+      (next_input_row_ < input_rows_.size() || input_->HasMoreBlocks());
+}
+
+Status DiffScanIterator::NextBlock(RowBlock* dst) {
+  dst->Resize(dst->row_capacity());
+  size_t num_rows = 0;
+  while (!done_ && input_ && num_rows < dst->row_capacity()) {
+    if (next_input_row_ < input_rows_.size()) {
+      RETURN_NOT_OK(AppendChange(input_rows_[next_input_row_++], dst, &num_rows));
+      continue;
+    }
+    if (block_prepared_) {
+      RETURN_NOT_OK(input_->FinishBlock());
+      block_prepared_ = false;
+    }
+    if (!input_->HasMoreBlocks()) {
+      break;
+    }
+    RETURN_NOT_OK(input_->PrepareBlock(&input_rows_));
+    block_prepared_ = true;
+    next_input_row_ = 0;
+  }
+  dst->Resize(num_rows);
+  dst->selection_vector()->SetAllTrue();
+
+  for (const ColumnPredicate& pred : predicates_) {
+    const int col_idx = projection_.find_column(pred.column().name());
+    DCHECK_NE(Schema::kColumnNotFound, col_idx);
+    pred.Evaluate(dst->column_block(col_idx), dst->selection_vector());
+  }
+  return Status::OK();
+}
+
+Status DiffScanIterator::AppendChange(const CompactionInputRow& input_row,
+                                      RowBlock* dst,
+                                      size_t* num_rows) {
+  if (lower_bound_key_ != nullptr || exclusive_upper_bound_key_ != nullptr) {
+    const Slice key = read_schema_.EncodeComparableKey(input_row.row, &key_buf_);
+    if (lower_bound_key_ != nullptr && key.compare(lower_bound_key_->encoded_key()) < 0) {
+      return Status::OK();
+    }
+    if (exclusive_upper_bound_key_ != nullptr &&
+        key.compare(exclusive_upper_bound_key_->encoded_key()) >= 0) {
+      // The rows are read in key order.
+      done_ = true;
+      return Status::OK();
+    }
+  }
+
+  // At most one version of the row is live at any time, so the row was
+  // live at either end of the window if any of its versions was.
+  const CompactionInputRow* start_version = nullptr;
+  const CompactionInputRow* end_version = nullptr;
+  bool changed = false;
+  Timestamp last_change = Timestamp::kMin;
+  for (const CompactionInputRow* version = &input_row;
+       version != nullptr;
+       version = version->previous_ghost) {
+    VersionHistory history;
+    RETURN_NOT_OK(TraceVersion(*version, start_snap_, end_snap_, &history));
+    if (history.live_at_start) {
+      start_version = version;
+    }
+    if (history.live_at_end) {
+      end_version = version;
+    }
+    if (history.changed) {
+      changed = true;
+      last_change = std::max(last_change, history.last_change);
+    }
+  }
+
+  DiffScanChangeType change_type;
+  if (!changed) {
+    return Status::OK();
+  }
+  if (end_version != nullptr) {
+    change_type = start_version != nullptr ? DIFF_SCAN_UPDATE : DIFF_SCAN_INSERT;
+  } else if (start_version != nullptr) {
+    change_type = DIFF_SCAN_DELETE;
+  } else {
+    // The row was inserted and deleted within the window.
+    return Status::OK();
+  }
+
+  const size_t row_idx = *num_rows;
+  RETURN_NOT_OK(ProjectVersion(end_version != nullptr ? *end_version : *start_version,
+                               dst, row_idx));
+  for (int i = 0; i < projected_cols_.size(); i++) {
+    ColumnBlock col = dst->column_block(i);
+    switch (projected_cols_[i].source) {
+      case ProjectedColumn::CHANGE_TYPE:
+        *reinterpret_cast<int8_t*>(col.mutable_cell_ptr(row_idx)) = change_type;
+        break;
+      case ProjectedColumn::COMMIT_TIMESTAMP:
+        *reinterpret_cast<int64_t*>(col.mutable_cell_ptr(row_idx)) = last_change.ToUint64();
+        break;
+      case ProjectedColumn::READ_COLUMN:
+        break;
+    }
+  }
+  (*num_rows)++;
+  return Status::OK();
+}
+
+Status DiffScanIterator::ProjectVersion(const CompactionInputRow& version,
+                                        RowBlock* dst,
+                                        size_t row_idx) {
+  RowBlockRow dst_row = dst->row(row_idx);
+  for (int i = 0; i < projected_cols_.size(); i++) {
+    if (projected_cols_[i].source == ProjectedColumn::READ_COLUMN) {
+      RowBlockRow::Cell dst_cell = dst_row.cell(i);
+      RETURN_NOT_OK(CopyCell(version.row.cell(projected_cols_[i].read_col_idx),
+                             &dst_cell, dst->arena()));
+    }
+  }
+
+  // Applies the values of an UPDATE or REINSERT to the projected non-key
+  // columns, which are the only ones they may change.
+  auto apply = [&](const Mutation* mutation) -> Status {
+    for (int i = 0; i < projected_cols_.size(); i++) {
+      const ProjectedColumn& col = projected_cols_[i];
+      if (col.source != ProjectedColumn::READ_COLUMN ||
+          col.read_col_idx < read_schema_.num_key_columns()) {
+        continue;
+      }
+      RowChangeListDecoder decoder(mutation->changelist());
+      RETURN_NOT_OK(decoder.Init());
+      if (decoder.is_delete()) {
+        return Status::OK();
+      }
+      ColumnBlock dst_col = dst->column_block(i);
+      RETURN_NOT_OK(decoder.ApplyToOneColumn(row_idx, &dst_col, read_schema_,
+                                             col.read_col_idx, dst->arena()));
+    }
+    return Status::OK();
+  };
+
+  // The UNDOs uncommitted at the end of the window, newest first, restore
+  // the values overwritten by later mutations; the REDOs committed by then,
+  // oldest first, apply the later values.
+  for (const Mutation* undo = version.undo_head; undo != nullptr; undo = undo->next()) {
+    if (!end_snap_.IsCommitted(undo->timestamp())) {
+      RETURN_NOT_OK(apply(undo));
+    }
+  }
+  for (const Mutation* redo = version.redo_head; redo != nullptr; redo = redo->acquire_next()) {
+    if (end_snap_.IsCommitted(redo->timestamp())) {
+      RETURN_NOT_OK(apply(redo));
+    }
+  }
+  return Status::OK();
+}
+
+string DiffScanIterator::ToString() const {
+  return Substitute("DiffScanIterator($0, $1)", start_.ToString(), end_.ToString());
+}
+
+void DiffScanIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  stats->assign(projection_.num_columns(), IteratorStats());
+}
+
+} // namespace tablet
+} // namespace kudu
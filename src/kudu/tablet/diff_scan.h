@@ -0,0 +1,180 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/tablet/compaction.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class EncodedKey;
+class RowBlock;
+class ScanSpec;
+struct IteratorStats;
+
+namespace tablet {
+
+class Tablet;
+struct TabletComponents;
+
+// The kinds of changes yielded by a diff scan, as stored in its change type
+// column.
+enum DiffScanChangeType : int8_t {
+  // The row didn't exist at the start of the window, and exists at its end.
+  DIFF_SCAN_INSERT = 1,
+  // The row existed at both ends of the window, and was mutated within it.
+  DIFF_SCAN_UPDATE = 2,
+  // The row existed at the start of the window, and doesn't at its end.
+  DIFF_SCAN_DELETE = 3,
+};
+
+// The names of the virtual columns which the projection of a diff scan may
+// include, besides the columns of the tablet: the change type of the row,
+// a non-nullable INT8 holding a DiffScanChangeType, and the timestamp of
+// the row's last change in the window, a non-nullable INT64.
+extern const char* const kDiffScanChangeTypeColumnName;
+extern const char* const kDiffScanCommitTimestampColumnName;
+
+// Returns true if 'col_name' is the name of a virtual column of diff scans.
+bool IsDiffScanVirtualColumn(const std::string& col_name);
+
+// An iterator over the rows of a tablet which were inserted, updated or
+// deleted by the operations committed at or after 'start' and before 'end'.
+// Rows inserted and deleted within the window are left out. Rows are
+// yielded in primary key order, with their latest values as of 'end', or
+// the values they were deleted with.
+//
+// Rather than scanning both snapshots, the iterator reads each row's
+// history from its rowsets' UNDO and REDO deltas and MemRowSet mutation
+// lists, through the compaction inputs of the rowsets. DiskRowSets whose
+// delta files hold no mutations in the window are skipped, as are the UNDO
+// delta files whose mutations all committed before 'start' and the REDO
+// delta files whose mutations all committed at or after 'end'.
+//
+// All the operations committed before 'end' must be committed when the
+// iterator is initialized, and the history since 'start' must not have
+// been garbage collected.
+class DiffScanIterator : public RowwiseIterator {
+ public:
+  DiffScanIterator(const Tablet* tablet,
+                   const Schema& projection,
+                   Timestamp start,
+                   Timestamp end);
+  ~DiffScanIterator();
+
+  // Captures the rowsets of the tablet which may hold changes in the window,
+  // restricted to the key range of 'spec'. Its predicates are taken over and
+  // evaluated over the yielded rows, so their columns must be in the
+  // projection. The key bounds of 'spec' must outlive the iterator.
+  Status Init(ScanSpec* spec) override;
+
+  bool HasNext() const override;
+
+  Status NextBlock(RowBlock* dst) override;
+
+  std::string ToString() const override;
+
+  const Schema& schema() const override {
+    return projection_;
+  }
+
+  void GetIteratorStats(std::vector<IteratorStats>* stats) const override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DiffScanIterator);
+
+  // How a column of the projection is filled in.
+  struct ProjectedColumn {
+    enum Source {
+      CHANGE_TYPE,
+      COMMIT_TIMESTAMP,
+      // The column at 'read_col_idx' in 'read_schema_'.
+      READ_COLUMN,
+    };
+    Source source;
+    int read_col_idx;
+  };
+
+  // Maps the columns of the projection to the virtual columns and to the
+  // columns of 'read_schema_', which it builds.
+  Status MapProjection();
+
+  // Copies the change of 'input_row', if any, into row '*num_rows' of 'dst'
+  // and increments '*num_rows'. Sets 'done_' instead if the row's key is at
+  // or past the exclusive upper bound of the scan.
+  Status AppendChange(const CompactionInputRow& input_row,
+                      RowBlock* dst,
+                      size_t* num_rows);
+
+  // Copies the columns of 'version' at 'end_snap_' into row 'row_idx' of
+  // 'dst', ignoring DELETEs.
+  Status ProjectVersion(const CompactionInputRow& version, RowBlock* dst, size_t row_idx);
+
+  const Tablet* const tablet_;
+  const Schema projection_;
+  const Timestamp start_;
+  const Timestamp end_;
+  const MvccSnapshot start_snap_;
+  const MvccSnapshot end_snap_;
+
+  // The schema the rows are read with: the key columns of the tablet,
+  // followed by the other tablet columns of the projection.
+  Schema read_schema_;
+  std::vector<ProjectedColumn> projected_cols_;
+
+  // The predicates evaluated over the yielded rows.
+  std::vector<ColumnPredicate> predicates_;
+
+  // The key bounds of the scan, if any. Not owned.
+  const EncodedKey* lower_bound_key_;
+  const EncodedKey* exclusive_upper_bound_key_;
+
+  // The tablet components read by 'input_', which are kept alive while it's
+  // in use. 'input_' is null if no rowset may hold changes in the window.
+  scoped_refptr<TabletComponents> components_;
+  std::shared_ptr<CompactionInput> input_;
+
+  // The rows of the block prepared by 'input_', if any, and the index of the
+  // next one to be examined.
+  bool block_prepared_;
+  std::vector<CompactionInputRow> input_rows_;
+  size_t next_input_row_;
+
+  // Set once a row at or past the upper bound of the scan was read.
+  bool done_;
+
+  // Scratch buffer for encoded keys.
+  faststring key_buf_;
+};
+
+} // namespace tablet
+} // namespace kudu
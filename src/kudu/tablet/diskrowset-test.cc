@@ -42,11 +42,13 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/stringpiece.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/deltamemstore.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/diskrowset-test-base.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/mvcc.h"
@@ -66,6 +68,7 @@ DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_bool(crash_on_eio);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(multi_column_writer_threads);
 DECLARE_double(env_inject_eio);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
@@ -76,6 +79,7 @@ using std::string;
 using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -160,6 +164,44 @@ TEST_F(TestRowSet, TestRowSetRoundTrip) {
   }
 }
 
+// Test that the key bounds of a rowset are persisted in its metadata, and
+// that rowsets are opened the same way with or without them.
+TEST_F(TestRowSet, TestPersistedKeyBounds) {
+  WriteTestRowSet();
+  string min_key;
+  string max_key;
+  ASSERT_TRUE(rowset_meta_->GetEncodedKeyBounds(&min_key, &max_key));
+
+  RowSetDataPB pb;
+  rowset_meta_->ToProtobuf(&pb);
+  ASSERT_EQ(min_key, pb.min_encoded_key());
+  ASSERT_EQ(max_key, pb.max_encoded_key());
+
+  for (bool persisted : { true, false }) {
+    SCOPED_TRACE(persisted);
+    if (!persisted) {
+      // Rowsets written by older versions don't have their bounds in the
+      // metadata, which must then be read from the key index.
+      pb.clear_min_encoded_key();
+      pb.clear_max_encoded_key();
+      rowset_meta_->LoadFromPB(pb);
+      string unused;
+      ASSERT_FALSE(rowset_meta_->GetEncodedKeyBounds(&unused, &unused));
+    }
+    shared_ptr<DiskRowSet> rs;
+    ASSERT_OK(OpenTestRowSet(&rs));
+    string rs_min_key;
+    string rs_max_key;
+    ASSERT_OK(rs->GetBounds(&rs_min_key, &rs_max_key));
+    ASSERT_EQ(min_key, rs_min_key);
+    ASSERT_EQ(max_key, rs_max_key);
+    rowid_t num_rows;
+    ASSERT_OK(rs->CountRows(&num_rows));
+    ASSERT_EQ(n_rows_, num_rows);
+    NO_FATALS(IterateProjection(*rs, schema_, n_rows_));
+  }
+}
+
 // Test writing a rowset, and then updating some rows in it.
 TEST_F(TestRowSet, TestRowSetUpdate) {
   WriteTestRowSet();
@@ -256,6 +298,34 @@ TEST_F(TestRowSet, TestRandomRead) {
   NO_FATALS(VerifyRandomRead(*rs, "hello 000000000000101", ""));
 }
 
+// Test writing a rowset whose columns are written by a pool of threads.
+TEST_F(TestRowSet, TestMultiColumnWriterThreads) {
+  google::FlagSaver saver;
+  FLAGS_multi_column_writer_threads = 2;
+  FLAGS_cfile_default_block_size = 4096;
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  NO_FATALS(IterateProjection(*rs, schema_, n_rows_));
+  const int n_rows = n_rows_;
+  for (int i : { 0, n_rows / 2, n_rows - 1 }) {
+    char buf[256];
+    FormatKey(i, buf, sizeof(buf));
+    NO_FATALS(VerifyRandomRead(*rs, buf, Substitute(R"((string key="$0", uint32 val=$1))",
+                                                    buf, i)));
+  }
+
+  // The written size keeps up with the queued appends, so that the rolling
+  // writer still rolls.
+  RollingDiskRowSetWriter writer(tablet()->metadata(), schema_,
+                                 BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f),
+                                 64 * 1024); // roll every 64KB
+  DoWriteTestRowSet(10000, &writer);
+  vector<shared_ptr<RowSetMetadata> > metas;
+  writer.GetWrittenRowSetMetadata(&metas);
+  EXPECT_GT(metas.size(), 1);
+}
+
 // Test Delete() support within a DiskRowSet.
 TEST_F(TestRowSet, TestDelete) {
   // Write and open a DiskRowSet with 2 rows.
@@ -312,6 +382,66 @@ TEST_F(TestRowSet, TestDelete) {
 }
 
 
+// Test that checking the presence of a sorted batch of keys gives the same
+// results as checking them one at a time, and compare how long both take.
+TEST_F(TestRowSet, TestCheckRowsPresent) {
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // Delete a row, which must be reported as absent.
+  OperationResultPB result;
+  ASSERT_OK(DeleteRow(rs.get(), 1, &result));
+
+  // Probe the keys of the rowset, and keys in between them.
+  Schema key_schema = schema_.CreateKeyProjection();
+  vector<string> keys;
+  for (int i = 0; i < n_rows_; i++) {
+    char buf[256];
+    FormatKey(i, buf, sizeof(buf));
+    keys.emplace_back(buf);
+    keys.emplace_back(string(buf) + "x");
+  }
+  vector<unique_ptr<RowBuilder>> rbs;
+  vector<unique_ptr<RowSetKeyProbe>> probes;
+  vector<const RowSetKeyProbe*> probe_ptrs;
+  for (const string& key : keys) {
+    rbs.emplace_back(new RowBuilder(key_schema));
+    rbs.back()->AddString(Slice(key));
+    probes.emplace_back(new RowSetKeyProbe(rbs.back()->row()));
+    probe_ptrs.push_back(probes.back().get());
+  }
+  const int kNumProbes = probe_ptrs.size();
+
+  vector<ProbeStats> stats_one_by_one(kNumProbes);
+  unique_ptr<bool[]> present_one_by_one(new bool[kNumProbes]);
+  LOG_TIMING(INFO, Substitute("checking $0 keys one at a time", kNumProbes)) {
+    for (int i = 0; i < kNumProbes; i++) {
+      ASSERT_OK(rs->CheckRowPresent(*probe_ptrs[i], &present_one_by_one[i],
+                                    &stats_one_by_one[i]));
+    }
+  }
+
+  vector<ProbeStats> stats_batch(kNumProbes);
+  vector<ProbeStats*> stats_ptrs;
+  for (auto& stats : stats_batch) {
+    stats_ptrs.push_back(&stats);
+  }
+  unique_ptr<bool[]> present_batch(new bool[kNumProbes]);
+  LOG_TIMING(INFO, Substitute("checking $0 keys in a batch", kNumProbes)) {
+    ASSERT_OK(rs->CheckRowsPresent(probe_ptrs.data(), kNumProbes, present_batch.get(),
+                                   stats_ptrs.data()));
+  }
+
+  for (int i = 0; i < kNumProbes; i++) {
+    ASSERT_EQ(present_one_by_one[i], present_batch[i]) << keys[i];
+    ASSERT_EQ(i % 2 == 0 && i != 2, present_batch[i]) << keys[i];
+    ASSERT_EQ(stats_one_by_one[i].blooms_consulted, stats_batch[i].blooms_consulted);
+    ASSERT_EQ(stats_one_by_one[i].keys_consulted, stats_batch[i].keys_consulted);
+    ASSERT_EQ(stats_one_by_one[i].deltas_consulted, stats_batch[i].deltas_consulted);
+  }
+}
+
 TEST_F(TestRowSet, TestDMSFlush) {
   WriteTestRowSet();
 
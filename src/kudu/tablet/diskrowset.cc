@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <map>
 #include <ostream>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -32,6 +33,8 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
@@ -50,6 +53,7 @@
 #include "kudu/tablet/multi_column_writer.h"
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/tablet/secondary_index.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
@@ -59,6 +63,7 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace.h"
 
 DEFINE_int32(tablet_delta_store_minor_compact_max, 1000,
              "How many delta stores are required before forcing a minor delta compaction "
@@ -88,6 +93,7 @@ using cfile::BloomFileWriter;
 using fs::BlockManager;
 using fs::BlockCreationTransaction;
 using fs::CreateBlockOptions;
+using fs::StorageTier;
 using fs::WritableBlock;
 using log::LogAnchorRegistry;
 using std::shared_ptr;
@@ -100,21 +106,31 @@ const char *DiskRowSet::kMaxKeyMetaEntryName = "max_key";
 
 DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
                                    const Schema* schema,
-                                   BloomFilterSizing bloom_sizing)
+                                   BloomFilterSizing bloom_sizing,
+                                   StorageTier data_tier)
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
+      data_tier_(data_tier),
       finished_(false),
       written_count_(0) {
   CHECK(schema->has_column_ids());
 }
 
+void DiskRowSetWriter::SetEncodedColumns(vector<bool> encoded_cols) {
+  CHECK(!col_writer_);
+  encoded_cols_ = std::move(encoded_cols);
+}
+
 Status DiskRowSetWriter::Open() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::Open");
 
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id));
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id, data_tier_));
+  if (!encoded_cols_.empty()) {
+    col_writer_->SetEncodedColumns(encoded_cols_);
+  }
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -125,6 +141,8 @@ Status DiskRowSetWriter::Open() {
     RETURN_NOT_OK(InitAdHocIndexWriter());
   }
 
+  RETURN_NOT_OK(InitSecondaryIndexWriters());
+
   return Status::OK();
 }
 
@@ -133,8 +151,8 @@ Status DiskRowSetWriter::InitBloomFileWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
-                                           &block),
+  const CreateBlockOptions block_opts({ tablet_id, StorageTier::FAST });
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
 
@@ -148,8 +166,8 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
-                                           &block),
+  const CreateBlockOptions block_opts({ tablet_id, StorageTier::FAST });
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &block),
                         "Couldn't allocate a block for compoound index");
 
   rowset_metadata_->set_adhoc_index_block(block->id());
@@ -176,6 +194,25 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
 
 }
 
+Status DiskRowSetWriter::InitSecondaryIndexWriters() {
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::InitSecondaryIndexWriters");
+  FsManager* fs = rowset_metadata_->fs_manager();
+  const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    const ColumnSchema& col = schema_->column(i);
+    // The master only accepts indexes on columns whose type can be key-encoded.
+    if (!col.attributes().indexed || !IsTypeAllowableInKey(col.type_info())) {
+      continue;
+    }
+    unique_ptr<WritableBlock> block;
+    const CreateBlockOptions block_opts({ tablet_id, StorageTier::FAST });
+    RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &block),
+                          "Couldn't allocate a block for secondary index");
+    secondary_index_writers_[i].reset(new SecondaryIndexWriter(col.type_info(), std::move(block)));
+  }
+  return Status::OK();
+}
+
 Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   DCHECK_EQ(block.schema().num_columns(), schema_->num_columns());
   CHECK(!finished_);
@@ -191,33 +228,28 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   // Write the batch to each of the columns
   RETURN_NOT_OK(col_writer_->AppendBlock(block));
 
-#ifndef NDEBUG
-    faststring prev_key;
-#endif
-
   // Write the batch to the bloom and optionally the ad-hoc index
-  for (size_t i = 0; i < block.nrows(); i++) {
-#ifndef NDEBUG
-    prev_key.assign_copy(last_encoded_key_.data(), last_encoded_key_.size());
-#endif
-
-    // TODO: performance might be better if we actually batch this -
-    // encode a bunch of key slices, then pass them all in one go.
-    RowBlockRow row = block.row(i);
-    // Insert the encoded key into the bloom.
-    Slice enc_key = schema_->EncodeComparableKey(row, &last_encoded_key_);
-    RETURN_NOT_OK(bloom_writer_->AppendKeys(&enc_key, 1));
-
-    // Write the batch to the ad hoc index if we're using one
-    if (ad_hoc_index_writer_ != nullptr) {
-      RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(&enc_key, 1));
-    }
+  key_util::EncodeKeys(block, &block_keys_buf_, &block_keys_);
+  RETURN_NOT_OK(bloom_writer_->AppendKeys(block_keys_.data(), block_keys_.size()));
+  if (ad_hoc_index_writer_ != nullptr) {
+    RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(block_keys_.data(), block_keys_.size()));
+  }
+  for (const auto& e : secondary_index_writers_) {
+    RETURN_NOT_OK(e.second->AppendBlock(block.column_block(e.first), written_count_));
+  }
 
 #ifndef NDEBUG
-    CHECK(prev_key.size() == 0 || Slice(prev_key).compare(enc_key) < 0)
+  Slice prev_key(last_encoded_key_);
+  for (const Slice& enc_key : block_keys_) {
+    CHECK(prev_key.size() == 0 || prev_key.compare(enc_key) < 0)
       << KUDU_REDACT(enc_key.ToDebugString()) << " appended to file not > previous key "
-      << KUDU_REDACT(Slice(prev_key).ToDebugString());
+      << KUDU_REDACT(prev_key.ToDebugString());
+    prev_key = enc_key;
+  }
 #endif
+
+  if (!block_keys_.empty()) {
+    last_encoded_key_.assign_copy(block_keys_.back().data(), block_keys_.back().size());
   }
 
   written_count_ += block.nrows();
@@ -225,6 +257,14 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   return Status::OK();
 }
 
+Status DiskRowSetWriter::AppendEncodedDataBlock(int col_idx,
+                                                const Slice& data,
+                                                size_t num_values,
+                                                const cfile::ZoneMapPB* zone_map) {
+  CHECK(!finished_);
+  return col_writer_->AppendEncodedDataBlock(col_idx, data, num_values, zone_map);
+}
+
 Status DiskRowSetWriter::Finish() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::Finish");
   BlockManager* bm = rowset_metadata_->fs_manager()->block_manager();
@@ -252,6 +292,20 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
       << "First Key not <= Last key: first_key=" << KUDU_REDACT(first_enc_slice.ToDebugString())
       << "   last_key=" << KUDU_REDACT(last_enc_slice.ToDebugString());
   key_index_writer()->AddMetadataPair(DiskRowSet::kMaxKeyMetaEntryName, last_enc_slice);
+  rowset_metadata_->set_encoded_key_bounds(first_encoded_key, last_enc_slice.ToString());
+
+  // The copied data blocks must line up with the appended rows.
+  for (int i = 0; i < encoded_cols_.size(); i++) {
+    if (!encoded_cols_[i]) {
+      continue;
+    }
+    const rowid_t num_values = col_writer_->writer_for_col_idx(i)->written_value_count();
+    if (num_values != written_count_) {
+      return Status::IllegalState(strings::Substitute("column $0 has $1 values, expected $2",
+                                             schema_->column(i).name(), num_values,
+                                             written_count_));
+    }
+  }
 
   // Finish writing the columns themselves.
   RETURN_NOT_OK(col_writer_->FinishAndReleaseBlocks(transaction));
@@ -269,6 +323,20 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
     }
   }
 
+  // Finish the secondary indexes.
+  if (!secondary_index_writers_.empty()) {
+    std::map<ColumnId, BlockId> index_blocks;
+    for (const auto& e : secondary_index_writers_) {
+      Status s = e.second->FinishAndReleaseBlock(transaction);
+      if (!s.ok()) {
+        LOG(WARNING) << "Unable to Finish secondary index writer: " << s.ToString();
+        return s;
+      }
+      index_blocks[schema_->column_id(e.first)] = e.second->block_id();
+    }
+    rowset_metadata_->SetSecondaryIndexBlocks(index_blocks);
+  }
+
   // Finish bloom.
   Status s = bloom_writer_->FinishAndReleaseBlock(transaction);
   if (!s.ok()) {
@@ -299,6 +367,10 @@ size_t DiskRowSetWriter::written_size() const {
     size += ad_hoc_index_writer_->written_size();
   }
 
+  for (const auto& e : secondary_index_writers_) {
+    size += e.second->written_size();
+  }
+
   return size;
 }
 
@@ -307,12 +379,14 @@ DiskRowSetWriter::~DiskRowSetWriter() {
 
 RollingDiskRowSetWriter::RollingDiskRowSetWriter(
     TabletMetadata* tablet_metadata, const Schema& schema,
-    BloomFilterSizing bloom_sizing, size_t target_rowset_size)
+    BloomFilterSizing bloom_sizing, size_t target_rowset_size,
+    StorageTier data_tier)
     : state_(kInitialized),
       tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
       target_rowset_size_(target_rowset_size),
+      data_tier_(data_tier),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
@@ -322,6 +396,11 @@ RollingDiskRowSetWriter::RollingDiskRowSetWriter(
   CHECK(schema.has_column_ids());
 }
 
+void RollingDiskRowSetWriter::SetEncodedColumns(vector<bool> encoded_cols) {
+  CHECK_EQ(state_, kInitialized);
+  encoded_cols_ = std::move(encoded_cols);
+}
+
 Status RollingDiskRowSetWriter::Open() {
   TRACE_EVENT0("tablet", "RollingDiskRowSetWriter::Open");
   CHECK_EQ(state_, kInitialized);
@@ -338,16 +417,19 @@ Status RollingDiskRowSetWriter::RollWriter() {
 
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_));
 
-  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_,
+                                         data_tier_));
+  if (!encoded_cols_.empty()) {
+    cur_writer_->SetEncodedColumns(encoded_cols_);
+  }
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
   unique_ptr<WritableBlock> undo_data_block;
   unique_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &redo_data_block));
+  const CreateBlockOptions block_opts({ tablet_metadata_->tablet_id(), data_tier_ });
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &undo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
   cur_undo_writer_.reset(new DeltaFileWriter(std::move(undo_data_block)));
@@ -381,6 +463,14 @@ Status RollingDiskRowSetWriter::AppendBlock(const RowBlock &block) {
   return Status::OK();
 }
 
+Status RollingDiskRowSetWriter::AppendEncodedDataBlock(int col_idx,
+                                                       const Slice& data,
+                                                       size_t num_values,
+                                                       const cfile::ZoneMapPB* zone_map) {
+  DCHECK_EQ(state_, kStarted);
+  return cur_writer_->AppendEncodedDataBlock(col_idx, data, num_values, zone_map);
+}
+
 Status RollingDiskRowSetWriter::AppendUndoDeltas(rowid_t row_idx_in_block,
                                                  Mutation* undo_delta_head,
                                                  rowid_t* row_idx) {
@@ -411,7 +501,7 @@ Status RollingDiskRowSetWriter::AppendDeltas(rowid_t row_idx_in_block,
   for (const Mutation *mut = delta_head; mut != nullptr; mut = mut->next()) {
     DeltaKey undo_key(*row_idx, mut->timestamp());
     RETURN_NOT_OK(writer->AppendDelta<Type>(undo_key, mut->changelist()));
-    delta_stats->UpdateStats(mut->timestamp(), mut->changelist());
+    delta_stats->UpdateStats(undo_key, mut->changelist());
   }
   return Status::OK();
 }
@@ -657,6 +747,22 @@ Status DiskRowSet::NewCompactionInput(const Schema* projection,
   return CompactionInput::Create(*this, projection, snap, out);
 }
 
+Status DiskRowSet::NewDiffScanInput(const Schema* projection,
+                                    Timestamp start,
+                                    Timestamp end,
+                                    gscoped_ptr<CompactionInput>* out) const {
+  // Since every base row's insertion is recorded as an UNDO, the delta stores
+  // hold all of the rowset's history.
+  bool may_have_deltas;
+  RETURN_NOT_OK(delta_tracker_->MayHaveDeltasBetween(start, end, &may_have_deltas));
+  if (!may_have_deltas) {
+    TRACE_COUNTER_INCREMENT("diff_scan_rowsets_skipped", 1);
+    out->reset();
+    return Status::OK();
+  }
+  return CompactionInput::Create(*this, projection, MvccSnapshot(end), MvccSnapshot(start), out);
+}
+
 Status DiskRowSet::MutateRow(Timestamp timestamp,
                              const RowSetKeyProbe &probe,
                              const RowChangeList &update,
@@ -719,6 +825,37 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::CheckKeyMayBePresent(const RowSetKeyProbe& probe,
+                                        bool* may_be_present,
+                                        ProbeStats* stats) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  rowid_t row_idx;
+  return base_data_->CheckRowPresent(probe, may_be_present, &row_idx, stats);
+}
+
+Status DiskRowSet::CheckRowsPresent(const RowSetKeyProbe* const* probes,
+                                    int num_probes,
+                                    bool* present,
+                                    ProbeStats* const* stats) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+
+  vector<rowid_t> row_idxs(num_probes);
+  RETURN_NOT_OK(base_data_->CheckRowsPresent(probes, num_probes, present,
+                                             row_idxs.data(), stats));
+  for (int i = 0; i < num_probes; i++) {
+    // If it wasn't in the base data, then it's definitely not in the rowset.
+    // Otherwise it might be in the base data but deleted.
+    if (present[i]) {
+      bool deleted = false;
+      RETURN_NOT_OK(delta_tracker_->CheckRowDeleted(row_idxs[i], &deleted, stats[i]));
+      present[i] = !deleted;
+    }
+  }
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(rowid_t *count) const {
   DCHECK(open_);
   rowid_t num_rows = num_rows_.load();
@@ -739,16 +876,38 @@ Status DiskRowSet::GetBounds(std::string* min_encoded_key,
   return base_data_->GetBounds(min_encoded_key, max_encoded_key);
 }
 
+Status DiskRowSet::GetEncodedKeyAtOrdinal(rowid_t ordinal, string* encoded_key) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return base_data_->GetEncodedKeyAtOrdinal(ordinal, encoded_key);
+}
+
 void DiskRowSet::GetDiskRowSetSpaceUsage(DiskRowSetSpace* drss) const {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_);
   drss->base_data_size = base_data_->OnDiskDataSize();
   drss->bloom_size = base_data_->BloomFileOnDiskSize();
   drss->ad_hoc_index_size = base_data_->AdhocIndexOnDiskSize();
+  drss->secondary_index_size = base_data_->SecondaryIndexOnDiskSize();
   drss->redo_deltas_size = delta_tracker_->RedoDeltaOnDiskSize();
   drss->undo_deltas_size = delta_tracker_->UndoDeltaOnDiskSize();
 }
 
+Status DiskRowSet::AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return base_data_->AddColumnStats(col_id, stats);
+}
+
+double DiskRowSet::EstimateDeletedRowRatio() const {
+  DCHECK(open_);
+  rowid_t num_rows;
+  if (!CountRows(&num_rows).ok() || num_rows == 0) {
+    return 0;
+  }
+  return std::min(1.0, static_cast<double>(delta_tracker_->EstimateDeletedRowCount()) / num_rows);
+}
+
 uint64_t DiskRowSet::OnDiskSize() const {
   DiskRowSetSpace drss;
   GetDiskRowSetSpaceUsage(&drss);
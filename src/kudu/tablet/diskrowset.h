@@ -23,6 +23,7 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -35,6 +36,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -61,6 +63,7 @@ class Timestamp;
 namespace cfile {
 class BloomFileWriter;
 class CFileWriter;
+class ZoneMapPB;
 }
 
 namespace consensus {
@@ -86,15 +89,27 @@ class MultiColumnWriter;
 class Mutation;
 class MvccSnapshot;
 class OperationResultPB;
+class SecondaryIndexWriter;
 
 class DiskRowSetWriter {
  public:
   // TODO: document ownership of rowset_metadata
+  //
+  // The column blocks are placed on the given storage 'data_tier' if
+  // possible. The bloom filter and ad-hoc index blocks are read by every
+  // lookup and always prefer the fast tier.
   DiskRowSetWriter(RowSetMetadata* rowset_metadata, const Schema* schema,
-                   BloomFilterSizing bloom_sizing);
+                   BloomFilterSizing bloom_sizing,
+                   fs::StorageTier data_tier = fs::StorageTier::ANY);
 
   ~DiskRowSetWriter();
 
+  // Leaves the columns flagged in 'encoded_cols' out of AppendBlock(), for
+  // their data blocks to be copied from other files with
+  // AppendEncodedDataBlock(). The flagged columns must be neither key nor
+  // indexed columns. Must be called before Open().
+  void SetEncodedColumns(std::vector<bool> encoded_cols);
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -102,6 +117,15 @@ class DiskRowSetWriter {
   // Rows must be appended in ascending order.
   Status AppendBlock(const RowBlock &block);
 
+  // Appends a data block copied from another file to the column at 'col_idx',
+  // which must have been flagged by SetEncodedColumns(). By the time the
+  // writer is finished, the column must hold a value for every row appended
+  // by AppendBlock(). See CFileWriter::AppendEncodedDataBlock().
+  Status AppendEncodedDataBlock(int col_idx,
+                                const Slice& data,
+                                size_t num_values,
+                                const cfile::ZoneMapPB* zone_map);
+
   // Closes the CFiles and their underlying writable blocks.
   // If no rows were written, returns Status::Aborted().
   Status Finish();
@@ -135,6 +159,9 @@ class DiskRowSetWriter {
   // this index is written to a new file instead of embedded in the col_* files
   Status InitAdHocIndexWriter();
 
+  // Initializes a secondary index writer for each indexed column.
+  Status InitSecondaryIndexWriters();
+
   // Return the cfile::Writer responsible for writing the key index.
   // (the ad-hoc writer for composite keys, otherwise the key column writer)
   cfile::CFileWriter *key_index_writer();
@@ -143,6 +170,10 @@ class DiskRowSetWriter {
   const Schema* const schema_;
 
   BloomFilterSizing bloom_sizing_;
+  const fs::StorageTier data_tier_;
+
+  // The columns left out of AppendBlock(), if any.
+  std::vector<bool> encoded_cols_;
 
   bool finished_;
   rowid_t written_count_;
@@ -150,8 +181,15 @@ class DiskRowSetWriter {
   gscoped_ptr<cfile::BloomFileWriter> bloom_writer_;
   gscoped_ptr<cfile::CFileWriter> ad_hoc_index_writer_;
 
+  // The secondary index writers, keyed by the index of the column in 'schema_'.
+  std::map<int, std::unique_ptr<SecondaryIndexWriter>> secondary_index_writers_;
+
   // The last encoded key written.
   faststring last_encoded_key_;
+
+  // The encoded keys of the block being appended, reused across blocks.
+  faststring block_keys_buf_;
+  std::vector<Slice> block_keys_;
 };
 
 
@@ -165,11 +203,18 @@ class RollingDiskRowSetWriter {
   // Create a new rolling writer. The given 'tablet_metadata' must stay valid
   // for the lifetime of this writer, and is used to construct the new rowsets
   // that this RollingDiskRowSetWriter creates.
+  //
+  // The column and delta blocks of the rowsets are placed on the given
+  // storage 'data_tier' if possible.
   RollingDiskRowSetWriter(TabletMetadata* tablet_metadata, const Schema& schema,
                           BloomFilterSizing bloom_sizing,
-                          size_t target_rowset_size);
+                          size_t target_rowset_size,
+                          fs::StorageTier data_tier = fs::StorageTier::ANY);
   ~RollingDiskRowSetWriter();
 
+  // See DiskRowSetWriter::SetEncodedColumns(). Must be called before Open().
+  void SetEncodedColumns(std::vector<bool> encoded_cols);
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -198,6 +243,15 @@ class RollingDiskRowSetWriter {
                           Mutation* undo_deltas,
                           rowid_t* row_idx_in_drs);
 
+  // Appends a data block copied from another file to the column at 'col_idx'
+  // of the DiskRowSet currently being written. See
+  // DiskRowSetWriter::AppendEncodedDataBlock(). The encoded columns must have
+  // caught up with AppendBlock() whenever the output may roll.
+  Status AppendEncodedDataBlock(int col_idx,
+                                const Slice& data,
+                                size_t num_values,
+                                const cfile::ZoneMapPB* zone_map);
+
   // Try to roll the output, if we've passed the configured threshold. This will
   // only roll if called immediately after an AppendBlock() call. The implementation
   // of AppendBlock() doesn't call it automatically, because it doesn't know if there
@@ -243,6 +297,8 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  const fs::StorageTier data_tier_;
+  std::vector<bool> encoded_cols_;
 
   gscoped_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -280,6 +336,7 @@ class RollingDiskRowSetWriter {
 //   - base data
 //   - bloom file
 //   - ad hoc index
+//   - secondary indexes
 // - delta files
 //   - UNDO deltas
 //   - REDO deltas
@@ -288,12 +345,13 @@ struct DiskRowSetSpace {
   uint64_t base_data_size;
   uint64_t bloom_size;
   uint64_t ad_hoc_index_size;
+  uint64_t secondary_index_size;
   uint64_t redo_deltas_size;
   uint64_t undo_deltas_size;
 
   // Helper method to compute the size of the diskrowset's underlying cfile set.
   uint64_t CFileSetOnDiskSize() {
-    return base_data_size + bloom_size + ad_hoc_index_size;
+    return base_data_size + bloom_size + ad_hoc_index_size + secondary_index_size;
   }
 };
 
@@ -349,6 +407,17 @@ class DiskRowSet : public RowSet {
                          bool *present,
                          ProbeStats* stats) const override;
 
+  Status CheckRowsPresent(const RowSetKeyProbe* const* probes,
+                          int num_probes,
+                          bool* present,
+                          ProbeStats* const* stats) const override;
+
+  // Looks the key up in the base data only, through its bloom filter and key
+  // index.
+  Status CheckKeyMayBePresent(const RowSetKeyProbe& probe,
+                              bool* may_be_present,
+                              ProbeStats* stats) const override;
+
   ////////////////////
   // Read functions.
   ////////////////////
@@ -361,14 +430,29 @@ class DiskRowSet : public RowSet {
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const override;
 
+  // Skips the rowset if its delta stores hold no mutations in the window,
+  // and only reads the UNDO and REDO delta files which may hold mutations
+  // uncommitted at 'start' and committed at 'end' respectively.
+  Status NewDiffScanInput(const Schema* projection,
+                          Timestamp start,
+                          Timestamp end,
+                          gscoped_ptr<CompactionInput>* out) const override;
+
   // Gets the number of rows in this rowset, checking 'num_rows_' first. If not
   // yet set, consults the base data and stores the result in 'num_rows_'.
   Status CountRows(rowid_t *count) const final override;
 
+  Status AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const override;
+
+  double EstimateDeletedRowRatio() const override;
+
   // See RowSet::GetBounds(...)
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const override;
 
+  // Sets 'encoded_key' to the encoded key of the base data row at 'ordinal'.
+  Status GetEncodedKeyAtOrdinal(rowid_t ordinal, std::string* encoded_key) const;
+
   void GetDiskRowSetSpaceUsage(DiskRowSetSpace* drss) const;
 
   uint64_t OnDiskSize() const override;
@@ -413,6 +497,13 @@ class DiskRowSet : public RowSet {
     has_been_compacted_.store(true);
   }
 
+  // Returns the base data of the rowset. It's only replaced by major delta
+  // compactions, which can't run while the rowset is locked for compaction.
+  std::shared_ptr<CFileSet> base_data() const {
+    shared_lock<rw_spinlock> l(component_lock_);
+    return base_data_;
+  }
+
   DeltaTracker *delta_tracker() {
     return DCHECK_NOTNULL(delta_tracker_.get());
   }
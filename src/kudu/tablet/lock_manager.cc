@@ -17,10 +17,12 @@
 
 #include "kudu/tablet/lock_manager.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -29,6 +31,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
@@ -38,12 +41,17 @@
 #include "kudu/util/trace.h"
 
 using base::subtle::NoBarrier_Load;
+using std::vector;
 
 namespace kudu {
 namespace tablet {
 
 class TransactionState;
 
+// The maximum number of shards of a LockManager created with the default
+// constructor.
+static const int kMaxNumShards = 64;
+
 // ============================================================================
 //  LockTable
 // ============================================================================
@@ -52,14 +60,18 @@ class TransactionState;
 // Callers should generally use ScopedRowLock (see below).
 class LockEntry {
  public:
-  explicit LockEntry(const Slice& key)
+  LockEntry(const Slice& key, uint64_t key_hash)
   : sem(1),
     recursion_(0) {
-    key_hash_ = util_hash::CityHash64(reinterpret_cast<const char *>(key.data()), key.size());
+    key_hash_ = key_hash;
     key_ = key;
     refs_ = 1;
   }
 
+  static uint64_t HashKey(const Slice& key) {
+    return util_hash::CityHash64(reinterpret_cast<const char *>(key.data()), key.size());
+  }
+
   bool Equals(const Slice& key, uint64_t hash) const {
     return key_hash_ == hash && key_ == key;
   }
@@ -100,6 +112,14 @@ class LockEntry {
   const TransactionState* holder_;
 };
 
+// A key to look up in the lock table, along with its position in a batch.
+struct LockRequest {
+  Slice key;
+  uint64_t hash;
+  int idx;
+  LockEntry* entry;
+};
+
 class LockTable {
  private:
   struct Bucket {
@@ -124,7 +144,12 @@ class LockTable {
     }
   }
 
-  LockEntry *GetLockEntry(const Slice &key);
+  LockEntry *GetLockEntry(const Slice &key, uint64_t hash);
+
+  // Sets the entry of each of the requests in ['begin', 'end'), taking the
+  // table lock only once.
+  void GetLockEntries(LockRequest* begin, LockRequest* end);
+
   void ReleaseLockEntry(LockEntry *entry);
 
  private:
@@ -158,8 +183,10 @@ class LockTable {
   void Resize();
 
  private:
-  // table rwlock used as write on resize
-  percpu_rwlock lock_;
+  // table rwlock used as write on resize. Since the tables of a LockManager
+  // are sharded, a plain rw_spinlock scales well enough, and it's much
+  // smaller than a percpu_rwlock.
+  rw_spinlock lock_;
   // size - 1 used to lookup the bucket (hash & mask_)
   uint64_t mask_;
   // number of buckets in the table
@@ -170,48 +197,52 @@ class LockTable {
   base::subtle::Atomic64 item_count_;
 };
 
-LockEntry *LockTable::GetLockEntry(const Slice& key) {
-  auto new_entry = new LockEntry(key);
-  LockEntry *old_entry;
+LockEntry *LockTable::GetLockEntry(const Slice& key, uint64_t hash) {
+  LockRequest req = { key, hash, 0, nullptr };
+  GetLockEntries(&req, &req + 1);
+  return req.entry;
+}
 
+void LockTable::GetLockEntries(LockRequest* begin, LockRequest* end) {
+  int num_new_entries = 0;
   {
-    shared_lock<rw_spinlock> l(lock_.get_lock());
-    Bucket *bucket = FindBucket(new_entry->key_hash_);
-    {
-      std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
-      LockEntry **node = FindSlot(bucket, new_entry->key_, new_entry->key_hash_);
-      old_entry = *node;
-      if (old_entry != nullptr) {
-        old_entry->refs_++;
-      } else {
-        new_entry->ht_next_ = nullptr;
-        new_entry->CopyKey();
-        *node = new_entry;
+    shared_lock<rw_spinlock> l(lock_);
+    for (LockRequest* req = begin; req != end; ++req) {
+      // Allocate the entry before taking the bucket lock, in case it's missing.
+      gscoped_ptr<LockEntry> new_entry(new LockEntry(req->key, req->hash));
+      Bucket *bucket = FindBucket(req->hash);
+      {
+        std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
+        LockEntry **node = FindSlot(bucket, req->key, req->hash);
+        if (*node != nullptr) {
+          (*node)->refs_++;
+          req->entry = *node;
+        } else {
+          new_entry->ht_next_ = nullptr;
+          new_entry->CopyKey();
+          req->entry = new_entry.release();
+          *node = req->entry;
+          num_new_entries++;
+        }
       }
     }
   }
 
-  if (old_entry != nullptr) {
-    delete new_entry;
-    return old_entry;
-  }
-
-  if (base::subtle::NoBarrier_AtomicIncrement(&item_count_, 1) > size_) {
-    std::unique_lock<percpu_rwlock> table_wrlock(lock_, std::try_to_lock);
+  if (num_new_entries > 0 &&
+      base::subtle::NoBarrier_AtomicIncrement(&item_count_, num_new_entries) > size_) {
+    std::unique_lock<rw_spinlock> table_wrlock(lock_, std::try_to_lock);
     // if we can't take the lock, means that someone else is resizing.
-    // (The percpu_rwlock try_lock waits for readers to complete)
+    // (The rw_spinlock try_lock waits for readers to complete)
     if (table_wrlock.owns_lock()) {
       Resize();
     }
   }
-
-  return new_entry;
 }
 
 void LockTable::ReleaseLockEntry(LockEntry *entry) {
   bool removed = false;
   {
-    std::lock_guard<rw_spinlock> table_rdlock(lock_.get_lock());
+    shared_lock<rw_spinlock> table_rdlock(lock_);
     Bucket *bucket = FindBucket(entry->key_hash_);
     {
       std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
@@ -289,6 +320,24 @@ ScopedRowLock::ScopedRowLock(LockManager *manager,
   }
 }
 
+void ScopedRowLock::AcquireBatch(LockManager* manager,
+                                 const TransactionState* tx,
+                                 const vector<Slice>& keys,
+                                 LockManager::LockMode mode,
+                                 vector<ScopedRowLock>* locks) {
+  vector<LockEntry*> entries(keys.size());
+  manager->LockBatch(keys.data(), keys.size(), tx, mode, entries.data());
+  locks->reserve(locks->size() + keys.size());
+  for (LockEntry* entry : entries) {
+    locks->emplace_back();
+    ScopedRowLock& l = locks->back();
+    l.manager_ = manager;
+    l.entry_ = entry;
+    l.ls_ = LockManager::LOCK_ACQUIRED;
+    l.acquired_ = true;
+  }
+}
+
 ScopedRowLock::ScopedRowLock(ScopedRowLock&& other) noexcept {
   TakeState(&other);
 }
@@ -324,24 +373,95 @@ void ScopedRowLock::Release() {
 //  LockManager
 // ============================================================================
 
+namespace {
+
+// Returns the default number of shards of a LockManager: the number of CPUs,
+// rounded up to a power of 2.
+int DefaultNumShards() {
+  int num_shards = 1;
+  while (num_shards < std::min(base::NumCPUs(), kMaxNumShards)) {
+    num_shards <<= 1;
+  }
+  return num_shards;
+}
+
+} // anonymous namespace
+
 LockManager::LockManager()
-  : locks_(new LockTable()) {
+  : LockManager(DefaultNumShards()) {
+}
+
+LockManager::LockManager(int num_shards)
+  : shard_mask_(num_shards - 1) {
+  CHECK_GT(num_shards, 0);
+  CHECK_EQ(0, num_shards & (num_shards - 1)) << "number of shards must be a power of 2";
+  shards_.reserve(num_shards);
+  for (int i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new LockTable());
+  }
 }
 
 LockManager::~LockManager() {
-  delete locks_;
+}
+
+LockTable* LockManager::GetShard(uint64_t key_hash) const {
+  // The buckets of a table are picked with the low bits of the hash, so pick
+  // the shard with high bits.
+  return shards_[(key_hash >> 48) & shard_mask_].get();
 }
 
 LockManager::LockStatus LockManager::Lock(const Slice& key,
                                           const TransactionState* tx,
                                           LockManager::LockMode mode,
                                           LockEntry** entry) {
-  *entry = locks_->GetLockEntry(key);
+  uint64_t hash = LockEntry::HashKey(key);
+  *entry = GetShard(hash)->GetLockEntry(key, hash);
+  return AcquireEntry(key, tx, *entry);
+}
 
+void LockManager::LockBatch(const Slice* keys, int num_keys, const TransactionState* tx,
+                            LockManager::LockMode mode, LockEntry** entries) {
+  vector<LockRequest> reqs(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    reqs[i] = { keys[i], LockEntry::HashKey(keys[i]), i, nullptr };
+  }
+
+  // Look up the entries of the keys of each shard together.
+  std::sort(reqs.begin(), reqs.end(),
+            [&](const LockRequest& a, const LockRequest& b) {
+              return GetShard(a.hash) < GetShard(b.hash);
+            });
+  int run_start = 0;
+  while (run_start < num_keys) {
+    LockTable* shard = GetShard(reqs[run_start].hash);
+    int run_end = run_start + 1;
+    while (run_end < num_keys && GetShard(reqs[run_end].hash) == shard) {
+      run_end++;
+    }
+    shard->GetLockEntries(&reqs[run_start], &reqs[0] + run_end);
+    run_start = run_end;
+  }
+
+  // Acquire the locks in the order of the keys. The locks of duplicate keys
+  // are then acquired one after the other, recursively.
+  std::sort(reqs.begin(), reqs.end(),
+            [](const LockRequest& a, const LockRequest& b) {
+              int cmp = a.key.compare(b.key);
+              return cmp != 0 ? cmp < 0 : a.idx < b.idx;
+            });
+  for (const LockRequest& req : reqs) {
+    CHECK_EQ(LOCK_ACQUIRED, AcquireEntry(req.key, tx, req.entry));
+    entries[req.idx] = req.entry;
+  }
+}
+
+LockManager::LockStatus LockManager::AcquireEntry(const Slice& key,
+                                                  const TransactionState* tx,
+                                                  LockEntry* entry) {
   // We expect low contention, so just try to try_lock first. This is faster
   // than a timed_lock, since we don't have to do a syscall to get the current
   // time.
-  if (!(*entry)->sem.TryAcquire()) {
+  if (!entry->sem.TryAcquire()) {
     // If the current holder of this lock is the same transaction just return
     // a LOCK_ALREADY_ACQUIRED status without actually acquiring the mutex.
     //
@@ -351,8 +471,8 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     // obtained and released at the same time). If at any time in the future
     // we opt to perform more fine grained locking, possibly letting transactions
     // release a portion of the locks they no longer need, this no longer is OK.
-    if (ANNOTATE_UNPROTECTED_READ((*entry)->holder_) == tx) {
-      (*entry)->recursion_++;
+    if (ANNOTATE_UNPROTECTED_READ(entry->holder_) == tx) {
+      entry->recursion_++;
       return LOCK_ACQUIRED;
     }
 
@@ -363,8 +483,8 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     TRACE_COUNTER_INCREMENT("row_lock_wait_count", 1);
     MicrosecondsInt64 start_wait_us = GetMonoTimeMicros();
     int waited_seconds = 0;
-    while (!(*entry)->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
-      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ((*entry)->holder_);
+    while (!entry->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
+      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ(entry->holder_);
       LOG(WARNING) << "Waited " << (++waited_seconds) << " seconds to obtain row lock on key "
                    << KUDU_REDACT(key.ToDebugString()) << " cur holder: " << cur_holder;
       // TODO(unknown): would be nice to also include some info about the blocking transaction,
@@ -378,7 +498,7 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     }
   }
 
-  (*entry)->holder_ = tx;
+  entry->holder_ = tx;
   return LOCK_ACQUIRED;
 }
 
@@ -386,10 +506,12 @@ LockManager::LockStatus LockManager::TryLock(const Slice& key,
                                              const TransactionState* tx,
                                              LockManager::LockMode mode,
                                              LockEntry **entry) {
-  *entry = locks_->GetLockEntry(key);
+  uint64_t hash = LockEntry::HashKey(key);
+  LockTable* shard = GetShard(hash);
+  *entry = shard->GetLockEntry(key, hash);
   bool locked = (*entry)->sem.TryAcquire();
   if (!locked) {
-    locks_->ReleaseLockEntry(*entry);
+    shard->ReleaseLockEntry(*entry);
     return LOCK_BUSY;
   }
   (*entry)->holder_ = tx;
@@ -405,7 +527,7 @@ void LockManager::Release(LockEntry *lock, LockStatus ls) {
       lock->sem.Release();
     }
   }
-  locks_->ReleaseLockEntry(lock);
+  GetShard(lock->key_hash_)->ReleaseLockEntry(lock);
 }
 
 } // namespace tablet
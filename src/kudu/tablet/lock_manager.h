@@ -18,6 +18,9 @@
 #define KUDU_TABLET_LOCK_MANAGER_H
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
@@ -35,9 +38,20 @@ class TransactionState;
 // In the future when we want to support multi-row transactions of some kind
 // we'll have to implement a proper lock manager with all its trappings,
 // but this should be enough for the single-row use case.
+//
+// The locks are kept in a hash table which is split into shards by key hash,
+// each with its own table lock, so that concurrent writers of different rows
+// rarely contend with each other.
 class LockManager {
  public:
+  // Creates a lock manager with a number of shards which scales with the
+  // number of CPUs.
   LockManager();
+
+  // Creates a lock manager with 'num_shards' shards, which must be a power
+  // of 2.
+  explicit LockManager(int num_shards);
+
   ~LockManager();
 
   enum LockStatus {
@@ -59,7 +73,21 @@ class LockManager {
                      LockMode mode, LockEntry **entry);
   void Release(LockEntry *lock, LockStatus ls);
 
-  LockTable *locks_;
+  // Locks all of the 'num_keys' keys of 'keys', setting the entry of the
+  // i-th key into 'entries[i]'. The lock table entries of the keys which fall
+  // into the same shard are looked up together, and the locks are acquired
+  // in the order of the keys, so that concurrent batches can't deadlock.
+  void LockBatch(const Slice* keys, int num_keys, const TransactionState* tx,
+                 LockMode mode, LockEntry** entries);
+
+  // Acquires the lock of 'entry', which was looked up for 'key', waiting
+  // for it if it's held by another transaction.
+  LockStatus AcquireEntry(const Slice& key, const TransactionState* tx, LockEntry* entry);
+
+  LockTable* GetShard(uint64_t key_hash) const;
+
+  std::vector<std::unique_ptr<LockTable>> shards_;
+  const uint64_t shard_mask_;
 
   DISALLOW_COPY_AND_ASSIGN(LockManager);
 };
@@ -107,6 +135,14 @@ class ScopedRowLock {
   ScopedRowLock(ScopedRowLock&& other) noexcept;
   ScopedRowLock& operator=(ScopedRowLock&& other) noexcept;
 
+  // Locks all of 'keys' in the given LockManager, appending one lock per
+  // key to '*locks', in the order of 'keys'. This is cheaper than locking
+  // the keys one at a time. The keys must remain valid and un-changed for
+  // the lifetime of their locks.
+  static void AcquireBatch(LockManager* manager, const TransactionState* ctx,
+                           const std::vector<Slice>& keys, LockManager::LockMode mode,
+                           std::vector<ScopedRowLock>* locks);
+
   void Release();
 
   bool acquired() const { return acquired_; }
@@ -23,6 +23,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -42,6 +43,8 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(major_delta_compaction_read_ahead);
+
 using std::shared_ptr;
 using std::string;
 using std::unordered_set;
@@ -221,6 +224,31 @@ TEST_F(TestMajorDeltaCompaction, TestCompact) {
   }
 }
 
+// Tests a major delta compaction run which reads its next batch of base data
+// ahead, over enough rows to span many batches.
+TEST_F(TestMajorDeltaCompaction, TestCompactWithReadAhead) {
+  FLAGS_major_delta_compaction_read_ahead = true;
+  const int kNumRows = 1000;
+  ASSERT_NO_FATAL_FAILURE(WriteTestTablet(kNumRows));
+  ASSERT_OK(tablet()->Flush());
+
+  vector<shared_ptr<RowSet> > all_rowsets;
+  tablet()->GetRowSetsForTests(&all_rowsets);
+  shared_ptr<RowSet> rs = all_rowsets.front();
+
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumRows, false));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumRows, true));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+
+  // Only compact some of the updated columns, so that the remaining REDOs
+  // must be written back as well.
+  vector<ColumnId> col_ids = { schema_.column_id(1), schema_.column_id(4) };
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids, rs));
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+}
+
 // Verify that we do issue UNDO files and that we can read them.
 TEST_F(TestMajorDeltaCompaction, TestUndos) {
   const int kNumRows = 100;
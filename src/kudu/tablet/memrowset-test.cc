@@ -59,6 +59,8 @@ DEFINE_int32(roundtrip_num_rows, 10000,
 DEFINE_int32(num_scan_passes, 1,
              "Number of passes to run the scan portion of the round-trip test");
 
+DECLARE_bool(mrs_scan_by_column);
+
 namespace kudu {
 namespace tablet {
 
@@ -116,7 +118,7 @@ class TestMemRowSet : public KuduTest {
     return mrs.CheckRowPresent(probe, present, &stats);
   }
 
-  Status InsertRows(MemRowSet *mrs, int num_rows) {
+  Status InsertRows(MemRowSet *mrs, int num_rows, MemRowSetInsertHint* hint = nullptr) {
     RowBuilder rb(schema_);
     char keybuf[256];
     for (uint32_t i = 0; i < num_rows; i++) {
@@ -124,7 +126,7 @@ class TestMemRowSet : public KuduTest {
       snprintf(keybuf, sizeof(keybuf), "hello %d", i);
       rb.AddString(Slice(keybuf));
       rb.AddUint32(i);
-      RETURN_NOT_OK(mrs->Insert(Timestamp(i), rb.row(), op_id_));
+      RETURN_NOT_OK(mrs->Insert(Timestamp(i), rb.row(), op_id_, hint));
     }
 
     return Status::OK();
@@ -331,6 +333,34 @@ TEST_F(TestMemRowSet, TestInsertDuplicate) {
   ASSERT_TRUE(s.IsAlreadyPresent()) << "bad status: " << s.ToString();
 }
 
+// Test inserts which start from the btree leaf node of the previous insert.
+TEST_F(TestMemRowSet, TestInsertWithHint) {
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  shared_ptr<MemRowSet> other_mrs;
+  ASSERT_OK(MemRowSet::Create(1, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &other_mrs));
+
+  MemRowSetInsertHint hint;
+  LOG_TIMING(INFO, "Inserting rows with a hint") {
+    ASSERT_OK(InsertRows(mrs.get(), FLAGS_roundtrip_num_rows, &hint));
+  }
+  ASSERT_EQ(FLAGS_roundtrip_num_rows, mrs->entry_count());
+
+  // A hint set by another MemRowSet is ignored.
+  ASSERT_OK(InsertRows(other_mrs.get(), 10, &hint));
+  ASSERT_EQ(10, other_mrs->entry_count());
+
+  // Duplicates are detected.
+  Status s = InsertRows(mrs.get(), 1, &hint);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << "bad status: " << s.ToString();
+
+  CheckValue(mrs, "hello 0", R"((string key="hello 0", uint32 val=0))");
+  CheckValue(mrs, "hello 9", R"((string key="hello 9", uint32 val=9))");
+  CheckValue(other_mrs, "hello 9", R"((string key="hello 9", uint32 val=9))");
+}
+
 // Test for updating rows in memrowset
 TEST_F(TestMemRowSet, TestUpdate) {
   shared_ptr<MemRowSet> mrs;
@@ -475,8 +505,73 @@ TEST_F(TestMemRowSet, TestMemRowSetInsertCountAndScan) {
                 ScanAndCount(mrs.get(),
                              MvccSnapshot(Timestamp(FLAGS_roundtrip_num_rows + 1))));
     }
+
+    FLAGS_mrs_scan_by_column = true;
+    LOG_TIMING(INFO, "Scanning rows where all are committed, by column") {
+      ASSERT_EQ(FLAGS_roundtrip_num_rows,
+                ScanAndCount(mrs.get(),
+                             MvccSnapshot(Timestamp(FLAGS_roundtrip_num_rows + 1))));
+    }
+    FLAGS_mrs_scan_by_column = false;
   }
 }
+// Test that scanning by column returns the same rows as scanning by row,
+// including updated and deleted rows, null cells, and defaulted columns.
+// Also compares the speed of both when run with a high --roundtrip_num_rows.
+TEST_F(TestMemRowSet, TestScanByColumn) {
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddKeyColumn("key", STRING));
+  ASSERT_OK(builder.AddColumn("val", UINT32));
+  ASSERT_OK(builder.AddNullableColumn("str", STRING));
+  Schema schema = builder.Build();
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+
+  const int kNumRows = FLAGS_roundtrip_num_rows;
+  for (int i = 0; i < kNumRows; i++) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    RowBuilder rb(schema);
+    rb.AddString(StringPrintf("hello %08d", i));
+    rb.AddUint32(i);
+    if (i % 2 == 0) {
+      rb.AddNull();
+    } else {
+      rb.AddString(StringPrintf("str %d", i));
+    }
+    ASSERT_OK(mrs->Insert(tx.timestamp(), rb.row(), op_id_));
+    tx.Commit();
+  }
+  int num_deleted = 0;
+  for (int i = 0; i < kNumRows; i += 3) {
+    OperationResultPB result;
+    ASSERT_OK(UpdateRow(mrs.get(), StringPrintf("hello %08d", i), i * 10, &result));
+    if (i % 2 == 0) {
+      ASSERT_OK(DeleteRow(mrs.get(), StringPrintf("hello %08d", i), &result));
+      num_deleted++;
+    }
+  }
+
+  // Project a column which was added after the MemRowSet was created.
+  SchemaBuilder projection_builder(schema);
+  int32_t default_val = 42;
+  ASSERT_OK(projection_builder.AddColumn("added", INT32, false, &default_val, &default_val));
+  Schema projection = projection_builder.Build();
+
+  vector<string> rows[2];
+  for (bool by_column : { false, true }) {
+    FLAGS_mrs_scan_by_column = by_column;
+    gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(&projection, MvccSnapshot(mvcc_)));
+    ASSERT_OK(iter->Init(nullptr));
+    LOG_TIMING(INFO, by_column ? "Scanning rows by column" : "Scanning rows by row") {
+      ASSERT_OK(IterateToStringList(iter.get(), &rows[by_column]));
+    }
+  }
+  ASSERT_EQ(kNumRows - num_deleted, rows[0].size());
+  ASSERT_EQ(rows[0], rows[1]);
+}
+
 // Test that scanning at past MVCC snapshots will hide rows which are
 // not committed in that snapshot.
 TEST_F(TestMemRowSet, TestInsertionMVCC) {
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -27,7 +28,9 @@
 #include <glog/logging.h>
 
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -35,6 +38,7 @@
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
+#include "kudu/common/types.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/gutil/dynamic_annotations.h"
@@ -44,6 +48,7 @@
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/memory.h"
@@ -52,6 +57,33 @@ DEFINE_bool(mrs_use_codegen, true, "whether the memrowset should use code "
             "generation for iteration");
 TAG_FLAG(mrs_use_codegen, hidden);
 
+DEFINE_bool(mrs_codegen_predicates, true,
+            "Whether MemRowSet scans evaluate the scan's column predicates with "
+            "a single pass of generated code, when code generation is enabled "
+            "and supports the predicates. Otherwise the predicates are evaluated "
+            "one at a time after the rows are fetched.");
+TAG_FLAG(mrs_codegen_predicates, hidden);
+
+DEFINE_bool(mrs_codegen_warm_up, true,
+            "Whether to compile the projection of a new MemRowSet's rows into "
+            "its full schema in the background when the MemRowSet is created, "
+            "rather than when it's first scanned, so that flushes and scans of "
+            "newly opened or altered tablets use code generation right away.");
+TAG_FLAG(mrs_codegen_warm_up, hidden);
+
+DEFINE_bool(mrs_scan_by_column, false,
+            "Whether MemRowSet scans copy the rows of each block into the "
+            "destination one column at a time rather than one row at a time. "
+            "This writes each column of the block contiguously, which is friendlier "
+            "to the caches and to the evaluation of the column predicates which follows.");
+TAG_FLAG(mrs_scan_by_column, experimental);
+
+DEFINE_bool(tablet_arena_use_huge_pages, false,
+            "Whether MemRowSets and DeltaMemStores allocate their memory in 2MB "
+            "huge pages once they've grown past that size. This reduces the TLB "
+            "misses of inserts and scans on large in-memory stores.");
+TAG_FLAG(tablet_arena_use_huge_pages, experimental);
+
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -114,8 +146,11 @@ MemRowSet::MemRowSet(int64_t id,
                      shared_ptr<MemTracker> parent_tracker)
   : id_(id),
     schema_(schema),
-    allocator_(new MemoryTrackingBufferAllocator(HeapBufferAllocator::Get(),
-                                                 CreateMemTrackerForMemRowSet(id, parent_tracker))),
+    allocator_(new MemoryTrackingBufferAllocator(
+        FLAGS_tablet_arena_use_huge_pages ?
+            static_cast<BufferAllocator*>(HugePageBufferAllocator::Get()) :
+            HeapBufferAllocator::Get(),
+        CreateMemTrackerForMemRowSet(id, parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
     debug_insert_count_(0),
@@ -123,8 +158,14 @@ MemRowSet::MemRowSet(int64_t id,
     anchorer_(log_anchor_registry, Substitute("MemRowSet-$0", id_)),
     has_been_compacted_(false) {
   CHECK(schema.has_column_ids());
+  if (FLAGS_tablet_arena_use_huge_pages) {
+    arena_->SetMaxBufferSize(HugePageBufferAllocator::kHugePageSize);
+  }
   ANNOTATE_BENIGN_RACE(&debug_insert_count_, "insert count isnt accurate");
   ANNOTATE_BENIGN_RACE(&debug_update_count_, "update count isnt accurate");
+  if (FLAGS_mrs_use_codegen && FLAGS_mrs_codegen_warm_up) {
+    codegen::CompilationManager::GetSingleton()->PrecompileRowProjector(schema_, schema_);
+  }
 }
 
 MemRowSet::~MemRowSet() {
@@ -149,7 +190,8 @@ Status MemRowSet::DebugDump(vector<string> *lines) {
 
 Status MemRowSet::Insert(Timestamp timestamp,
                          const ConstContiguousRow& row,
-                         const OpId& op_id) {
+                         const OpId& op_id,
+                         MemRowSetInsertHint* hint) {
   CHECK(row.schema()->has_column_ids());
   DCHECK_SCHEMA_EQ(schema_, *row.schema());
 
@@ -159,7 +201,11 @@ Status MemRowSet::Insert(Timestamp timestamp,
     Slice enc_key(enc_key_buf);
 
     btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
-    mutation.Prepare(&tree_);
+    if (hint != nullptr && hint->mrs_ == this) {
+      mutation.Prepare(&tree_, hint->leaf_);
+    } else {
+      mutation.Prepare(&tree_);
+    }
 
     // TODO: for now, the key ends up stored doubly --
     // once encoded in the btree key, and again in the value
@@ -188,6 +234,12 @@ Status MemRowSet::Insert(Timestamp timestamp,
     CHECK(mutation.Insert(mrsrow_slice))
     << "Expected to be able to insert, since the prepared mutation "
     << "succeeded!";
+    if (hint != nullptr) {
+      // If the insert split the leaf node, this is the half which the row
+      // went into.
+      hint->mrs_ = this;
+      hint->leaf_ = mutation.leaf();
+    }
   }
 
   anchorer_.AnchorIfMinimum(op_id.index());
@@ -382,6 +434,15 @@ gscoped_ptr<MRSRowProjector> GenerateAppropriateProjector(
     new MRSRowProjectorImpl<RowProjector>(std::move(actual)));
 }
 
+// Copies the 'kSize'-byte cell at 'offset' of each of the rows to the cell of
+// the row's index in the column data 'dst'.
+template<size_t kSize, class VisibleRows>
+void CopyFixedSizeCells(const VisibleRows& rows, size_t offset, uint8_t* dst) {
+  for (const auto& row : rows) {
+    memcpy(dst + row.idx * kSize, row.row_data + offset, kSize);
+  }
+}
+
 } // anonymous namespace
 
 MemRowSet::Iterator::Iterator(const std::shared_ptr<const MemRowSet>& mrs,
@@ -410,6 +471,16 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
 
+  vector<bool> is_base_col(projection_->num_columns(), false);
+  for (const auto& mapping : projector_->base_cols_mapping()) {
+    is_base_col[mapping.first] = true;
+  }
+  for (size_t i = 0; i < projection_->num_columns(); i++) {
+    if (!is_base_col[i]) {
+      projection_defaults_.push_back(i);
+    }
+  }
+
   if (spec && spec->lower_bound_key()) {
     bool exact;
     const Slice &lower_bound = spec->lower_bound_key()->encoded_key();
@@ -426,6 +497,23 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
     exclusive_upper_bound_.reset(upper_bound);
   }
 
+  if (spec) {
+    sample_ = spec->sample();
+  }
+
+  // Take over the evaluation of the predicates if their code is ready.
+  if (FLAGS_mrs_use_codegen && FLAGS_mrs_codegen_predicates &&
+      spec && !spec->predicates().empty()) {
+    vector<ColumnPredicate> predicates;
+    for (const auto& entry : spec->predicates()) {
+      predicates.push_back(entry.second);
+    }
+    if (codegen::CompilationManager::GetSingleton()->RequestPredicateEvaluator(
+          projection_, predicates, &predicate_evaluator_)) {
+      spec->RemovePredicates();
+    }
+  }
+
   state_ = kScanning;
   return Status::OK();
 }
@@ -476,13 +564,21 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
   // Fill
   dst->selection_vector()->SetAllTrue();
   size_t fetched;
-  RETURN_NOT_OK(FetchRows(dst, &fetched));
+  if (FLAGS_mrs_scan_by_column) {
+    RETURN_NOT_OK(FetchRowsByColumn(dst, &fetched));
+  } else {
+    RETURN_NOT_OK(FetchRows(dst, &fetched));
+  }
   DCHECK_LE(0, fetched);
   DCHECK_LE(fetched, dst->nrows());
 
   // Clear unreached bits by resizing
   dst->Resize(fetched);
 
+  if (predicate_evaluator_ && fetched > 0) {
+    predicate_evaluator_->Evaluate(dst);
+  }
+
   return Status::OK();
 }
 
@@ -503,6 +599,8 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
       if (has_upper_bound() && out_of_bounds(k)) {
         state_ = kFinished;
         break;
+      } else if (!sample_.Includes(k)) {
+        dst->selection_vector()->SetRowUnselected(*fetched);
       } else {
         RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
 
@@ -532,6 +630,105 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
   return Status::OK();
 }
 
+Status MemRowSet::Iterator::FetchRowsByColumn(RowBlock* dst, size_t* fetched) {
+  *fetched = 0;
+  visible_rows_.clear();
+  do {
+    Slice k, v;
+    iter_->GetCurrentEntry(&k, &v);
+    MRSRow row(memrowset_.get(), v);
+
+    if (mvcc_snap_.IsCommitted(row.insertion_timestamp())) {
+      if (has_upper_bound() && out_of_bounds(k)) {
+        state_ = kFinished;
+        break;
+      }
+      if (sample_.Includes(k)) {
+        const Mutation* redo_head = reinterpret_cast<const Mutation*>(
+            base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&row.header_->redo_head)));
+        visible_rows_.push_back({ *fetched, row.row_data(), redo_head });
+      } else {
+        dst->selection_vector()->SetRowUnselected(*fetched);
+      }
+    } else {
+      // This row was not yet committed in the current MVCC snapshot
+      dst->selection_vector()->SetRowUnselected(*fetched);
+    }
+
+    ++*fetched;
+  } while (iter_->Next() && *fetched < dst->nrows());
+
+  for (const auto& mapping : projector_->base_cols_mapping()) {
+    ColumnBlock dst_col = dst->column_block(mapping.first);
+    RETURN_NOT_OK(ProjectColumn(mapping.second, &dst_col, dst->arena()));
+  }
+  for (size_t proj_idx : projection_defaults_) {
+    const ColumnSchema& col = projection_->column(proj_idx);
+    ColumnBlock dst_col = dst->column_block(proj_idx);
+    for (const auto& row : visible_rows_) {
+      SimpleConstCell src_cell(&col, col.read_default_value());
+      ColumnBlockCell dst_cell = dst_col.cell(row.idx);
+      RETURN_NOT_OK(CopyCell(src_cell, &dst_cell, dst->arena()));
+    }
+  }
+
+  // Roll-forward MVCC for committed updates.
+  for (const auto& row : visible_rows_) {
+    if (row.redo_head != nullptr) {
+      RowBlockRow dst_row = dst->row(row.idx);
+      RETURN_NOT_OK(ApplyMutationsToProjectedRow(row.redo_head, &dst_row, dst->arena()));
+    }
+  }
+  return Status::OK();
+}
+
+Status MemRowSet::Iterator::ProjectColumn(size_t base_col_idx, ColumnBlock* dst, Arena* arena) {
+  const Schema& schema = memrowset_->schema_nonvirtual();
+  const ColumnSchema& col = schema.column(base_col_idx);
+  const size_t offset = schema.column_offset(base_col_idx);
+
+  if (col.is_nullable()) {
+    // The null bitmap of a row follows its cells.
+    const size_t bitmap_offset = schema.byte_size();
+    for (const auto& row : visible_rows_) {
+      dst->SetCellIsNull(row.idx, BitmapTest(row.row_data + bitmap_offset, base_col_idx));
+    }
+  }
+
+  if (col.type_info()->physical_type() == BINARY) {
+    Slice* dst_slices = reinterpret_cast<Slice*>(dst->data());
+    for (const auto& row : visible_rows_) {
+      if (col.is_nullable() && dst->is_null(row.idx)) {
+        continue;
+      }
+      const Slice* src_slice = reinterpret_cast<const Slice*>(row.row_data + offset);
+      if (arena == nullptr) {
+        dst_slices[row.idx] = *src_slice;
+      } else if (PREDICT_FALSE(!arena->RelocateSlice(*src_slice, &dst_slices[row.idx]))) {
+        return Status::IOError("out of memory copying slice", src_slice->ToString());
+      }
+    }
+    return Status::OK();
+  }
+
+  // The cells of null values are copied too: their content doesn't matter.
+  uint8_t* dst_data = dst->data();
+  switch (col.type_info()->size()) {
+    case 1: CopyFixedSizeCells<1>(visible_rows_, offset, dst_data); break;
+    case 2: CopyFixedSizeCells<2>(visible_rows_, offset, dst_data); break;
+    case 4: CopyFixedSizeCells<4>(visible_rows_, offset, dst_data); break;
+    case 8: CopyFixedSizeCells<8>(visible_rows_, offset, dst_data); break;
+    case 16: CopyFixedSizeCells<16>(visible_rows_, offset, dst_data); break;
+    default: {
+      const size_t size = col.type_info()->size();
+      for (const auto& row : visible_rows_) {
+        memcpy(dst_data + row.idx * size, row.row_data + offset, size);
+      }
+    }
+  }
+  return Status::OK();
+}
+
 Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
   const Mutation *mutation_head, RowBlockRow *dst_row, Arena *dst_arena) {
   // Fast short-circuit the likely case of a row which was inserted and never
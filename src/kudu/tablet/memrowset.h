@@ -32,6 +32,7 @@
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowid.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/consensus/log_anchor_registry.h"
@@ -50,6 +51,7 @@
 
 namespace kudu {
 
+class ColumnBlock;
 class MemTracker;
 class MemoryTrackingBufferAllocator;
 class RowBlock;
@@ -58,6 +60,10 @@ class RowChangeList;
 class ScanSpec;
 struct IteratorStats;
 
+namespace codegen {
+class PredicateEvaluator;
+}
+
 namespace consensus {
 class OpId;
 }
@@ -195,6 +201,28 @@ struct MSBTreeTraits : public btree::BTreeTraits {
   ContiguousRowHelper::InitNullsBitmap((memrowset)->schema_nonvirtual(), slice_name); \
   MRSRow varname(memrowset, slice_name);
 
+// Remembers the btree leaf node which the last row inserted into a
+// MemRowSet went into, so that the next insert into the same MemRowSet can
+// start from that leaf instead of the root of the tree. This pays off when
+// the rows of a batch are inserted in ascending key order.
+//
+// A hint may be reused across MemRowSets: it's ignored by any MemRowSet but
+// the one which set it. It must not outlive that MemRowSet.
+class MemRowSetInsertHint {
+ public:
+  MemRowSetInsertHint()
+      : mrs_(nullptr),
+        leaf_(nullptr) {
+  }
+
+ private:
+  friend class MemRowSet;
+
+  const MemRowSet* mrs_;
+  btree::LeafNode<MSBTreeTraits>* leaf_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemRowSetInsertHint);
+};
 
 // In-memory storage for data currently being written to the tablet.
 // This is a holding area for inserts, currently held in row form
@@ -223,10 +251,15 @@ class MemRowSet : public RowSet,
   // have been copied into this MemRowSet's internal storage, and thus
   // the provided memory buffer may safely be re-used or freed.
   //
+  // If 'hint' is not null, the btree traversal starts from the leaf node
+  // which the previous insert with the same hint went into, and 'hint' is
+  // updated to point to the leaf node of this insert.
+  //
   // Returns Status::OK unless allocation fails.
   Status Insert(Timestamp timestamp,
                 const ConstContiguousRow& row,
-                const consensus::OpId& op_id);
+                const consensus::OpId& op_id,
+                MemRowSetInsertHint* hint = nullptr);
 
 
   // Update or delete an existing row in the memrowset.
@@ -544,8 +577,25 @@ class MemRowSet::Iterator : public RowwiseIterator {
            MemRowSet::MSBTIter *iter, const Schema *projection,
            MvccSnapshot mvcc_snap);
 
+  // A row of the block being fetched which is visible in the snapshot.
+  struct VisibleRow {
+    // The index of the row in the destination block.
+    size_t idx;
+    const uint8_t* row_data;
+    const Mutation* redo_head;
+  };
+
   // Various helper functions called while getting the next RowBlock
   Status FetchRows(RowBlock* dst, size_t* fetched);
+
+  // Same as FetchRows(), but first collects the visible rows of the block,
+  // then copies them into 'dst' one column at a time.
+  Status FetchRowsByColumn(RowBlock* dst, size_t* fetched);
+
+  // Copies the column 'base_col_idx' of 'visible_rows_' to 'dst', relocating
+  // indirect data to 'arena'.
+  Status ProjectColumn(size_t base_col_idx, ColumnBlock* dst, Arena* arena);
+
   Status ApplyMutationsToProjectedRow(const Mutation *mutation_head,
                                       RowBlockRow *dst_row,
                                       Arena *dst_arena);
@@ -565,6 +615,13 @@ class MemRowSet::Iterator : public RowwiseIterator {
   gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // The indexes of the projected columns which aren't in the MemRowSet's
+  // schema, and are filled with their read defaults.
+  std::vector<size_t> projection_defaults_;
+
+  // The visible rows of the block being fetched by FetchRowsByColumn().
+  std::vector<VisibleRow> visible_rows_;
+
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
@@ -579,6 +636,14 @@ class MemRowSet::Iterator : public RowwiseIterator {
 
   // Pushed down encoded upper bound key, if any
   boost::optional<const Slice &> exclusive_upper_bound_;
+
+  // The sample of the scan. The MemRowSet has no blocks, so its rows are
+  // sampled one by one, by key.
+  ScanSample sample_;
+
+  // Evaluates the pushed down column predicates, if code was generated for
+  // them. Otherwise the predicates are left to the caller.
+  gscoped_ptr<codegen::PredicateEvaluator> predicate_evaluator_;
 };
 
 inline const Schema* MRSRow::schema() const {
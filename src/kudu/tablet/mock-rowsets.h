@@ -164,10 +164,11 @@ class MockRowSet : public RowSet {
 class MockDiskRowSet : public MockRowSet {
  public:
   MockDiskRowSet(std::string first_key, std::string last_key,
-                 uint64_t size = 1000000)
+                 uint64_t size = 1000000, double deleted_row_ratio = 0)
       : first_key_(std::move(first_key)),
         last_key_(std::move(last_key)),
-        size_(size) {}
+        size_(size),
+        deleted_row_ratio_(deleted_row_ratio) {}
 
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const OVERRIDE {
@@ -188,6 +189,10 @@ class MockDiskRowSet : public MockRowSet {
     return size_;
   }
 
+  virtual double EstimateDeletedRowRatio() const OVERRIDE {
+    return deleted_row_ratio_;
+  }
+
   virtual std::string ToString() const OVERRIDE {
     return strings::Substitute("mock[$0, $1]",
                                Slice(first_key_).ToDebugString(),
@@ -198,6 +203,7 @@ class MockDiskRowSet : public MockRowSet {
   const std::string first_key_;
   const std::string last_key_;
   const uint64_t size_;
+  const double deleted_row_ratio_;
 };
 
 // Mock which acts like a MemRowSet and has no known bounds.
@@ -17,49 +17,99 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
 
+#include <boost/function.hpp>
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(multi_column_writer_threads, 1,
+             "Number of threads with which the columns of a rowset are encoded, "
+             "compressed and written during flushes and compactions. If 1, the "
+             "columns are written one after the other by the flushing thread.");
+TAG_FLAG(multi_column_writer_threads, experimental);
 
 namespace kudu {
 namespace tablet {
 
+namespace {
+
+// The maximum number of blocks which may be queued for each column, when the
+// columns are written by a pool of threads.
+const int kMaxQueuedBlocksPerColumn = 8;
+
+} // anonymous namespace
+
 using cfile::CFileWriter;
 using fs::BlockCreationTransaction;
 using fs::CreateBlockOptions;
+using fs::StorageTier;
 using fs::WritableBlock;
+using std::shared_ptr;
 using std::unique_ptr;
 
+// A copy of the cells of a ColumnBlock, along with the data they point to.
+struct MultiColumnWriter::ColumnBatch {
+  size_t nrows;
+  faststring data;
+  faststring null_bitmap;
+  faststring indirect_data;
+};
+
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema,
-                                     std::string tablet_id)
+                                     std::string tablet_id,
+                                     StorageTier tier)
   : fs_(fs),
     schema_(schema),
     finished_(false),
-    tablet_id_(std::move(tablet_id)) {
+    tablet_id_(std::move(tablet_id)),
+    tier_(tier),
+    queue_cond_(&lock_),
+    num_queued_(0) {
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
+  // The queued appends must be done before the writers are destroyed.
+  if (pool_) {
+    pool_->Shutdown();
+  }
   STLDeleteElements(&cfile_writers_);
 }
 
+void MultiColumnWriter::SetEncodedColumns(std::vector<bool> encoded_cols) {
+  CHECK(cfile_writers_.empty());
+  DCHECK_EQ(schema_->num_columns(), encoded_cols.size());
+  encoded_cols_ = std::move(encoded_cols);
+}
+
 Status MultiColumnWriter::Open() {
   CHECK(cfile_writers_.empty());
 
   // Open columns.
-  const CreateBlockOptions block_opts({ tablet_id_ });
+  const CreateBlockOptions block_opts({ tablet_id_, tier_ });
   for (int i = 0; i < schema_->num_columns(); i++) {
     const ColumnSchema &col = schema_->column(i);
 
@@ -69,6 +119,10 @@ Status MultiColumnWriter::Open() {
     // the corresponding rows.
     opts.write_posidx = true;
 
+    // Record per-block min/max values so scans can skip blocks which cannot
+    // match their predicates.
+    opts.write_zone_maps = true;
+
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
 
@@ -97,25 +151,141 @@ Status MultiColumnWriter::Open() {
   }
   LOG(INFO) << "Opened CFile writers for " << cfile_writers_.size() << " column(s)";
 
+  const int num_threads = std::min<int>(FLAGS_multi_column_writer_threads,
+                                        cfile_writers_.size());
+  if (num_threads > 1) {
+    RETURN_NOT_OK(ThreadPoolBuilder("column-writer")
+                  .set_min_threads(0)
+                  .set_max_threads(num_threads)
+                  .Build(&pool_));
+    written_sizes_ = std::vector<std::atomic<size_t>>(cfile_writers_.size());
+    for (int i = 0; i < cfile_writers_.size(); i++) {
+      tokens_.emplace_back(pool_->NewToken(ThreadPool::ExecutionMode::SERIAL));
+      written_sizes_[i] = cfile_writers_[i]->written_size();
+    }
+  }
+
   return Status::OK();
 }
 
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
   for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
-    if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
-          column.data(), column.nrows()));
+    if (!encoded_cols_.empty() && encoded_cols_[i]) {
+      continue;
+    }
+    if (pool_) {
+      RETURN_NOT_OK(QueueColumn(i, block.column_block(i)));
     } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+      RETURN_NOT_OK(AppendColumn(i, block.column_block(i)));
+    }
+  }
+  return Status::OK();
+}
+
+Status MultiColumnWriter::AppendEncodedDataBlock(int i,
+                                                 const Slice& data,
+                                                 size_t num_values,
+                                                 const cfile::ZoneMapPB* zone_map) {
+  DCHECK(!encoded_cols_.empty() && encoded_cols_[i]);
+  // The column isn't queued by AppendBlock(), so its writer is idle.
+  RETURN_NOT_OK(cfile_writers_[i]->AppendEncodedDataBlock(data, num_values, zone_map));
+  if (pool_) {
+    written_sizes_[i] = cfile_writers_[i]->written_size();
+  }
+  return Status::OK();
+}
+
+Status MultiColumnWriter::AppendColumn(int i, const ColumnBlock& column) {
+  if (column.is_nullable()) {
+    return cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
+                                                    column.data(), column.nrows());
+  }
+  return cfile_writers_[i]->AppendEntries(column.data(), column.nrows());
+}
+
+Status MultiColumnWriter::QueueColumn(int i, const ColumnBlock& column) {
+  // The caller may reuse the block once AppendBlock() returns: copy the cells,
+  // and the strings which they point to.
+  shared_ptr<ColumnBatch> batch(new ColumnBatch);
+  batch->nrows = column.nrows();
+  batch->data.assign_copy(column.data(), column.nrows() * column.stride());
+  if (column.is_nullable()) {
+    batch->null_bitmap.assign_copy(column.null_bitmap(), BitmapSize(column.nrows()));
+  }
+  if (column.type_info()->physical_type() == BINARY) {
+    Slice* cells = reinterpret_cast<Slice*>(batch->data.data());
+    size_t indirect_size = 0;
+    for (size_t row = 0; row < batch->nrows; row++) {
+      if (!column.is_nullable() || !column.is_null(row)) {
+        indirect_size += cells[row].size();
+      }
+    }
+    batch->indirect_data.resize(indirect_size);
+    uint8_t* dst = batch->indirect_data.data();
+    for (size_t row = 0; row < batch->nrows; row++) {
+      if (!column.is_nullable() || !column.is_null(row)) {
+        memcpy(dst, cells[row].data(), cells[row].size());
+        cells[row] = Slice(dst, cells[row].size());
+        dst += cells[row].size();
+      }
+    }
+  }
+
+  {
+    MutexLock l(lock_);
+    RETURN_NOT_OK(queue_status_);
+    while (num_queued_ >= kMaxQueuedBlocksPerColumn * static_cast<int>(cfile_writers_.size())) {
+      queue_cond_.Wait();
     }
+    num_queued_++;
+  }
+
+  const TypeInfo* type_info = column.type_info();
+  const bool nullable = column.is_nullable();
+  const fs::IOPriority io_priority = fs::ScopedIOPriority::Current();
+  Status s = tokens_[i]->SubmitFunc([this, i, batch, type_info, nullable, io_priority]() {
+      fs::ScopedIOPriority p(io_priority);
+      ColumnBlock queued(type_info,
+                         nullable ? batch->null_bitmap.data() : nullptr,
+                         batch->data.data(), batch->nrows, nullptr);
+      Status append_status = AppendColumn(i, queued);
+      written_sizes_[i] = cfile_writers_[i]->written_size();
+      MutexLock l(lock_);
+      if (queue_status_.ok() && !append_status.ok()) {
+        queue_status_ = append_status;
+      }
+      num_queued_--;
+      queue_cond_.Broadcast();
+    });
+  if (!s.ok()) {
+    MutexLock l(lock_);
+    num_queued_--;
+    return s;
   }
   return Status::OK();
 }
 
+Status MultiColumnWriter::WaitForQueuedColumns() {
+  if (!pool_) {
+    return Status::OK();
+  }
+  pool_->Wait();
+  MutexLock l(lock_);
+  return queue_status_;
+}
+
+CFileWriter* MultiColumnWriter::writer_for_col_idx(int i) {
+  DCHECK_LT(i, cfile_writers_.size());
+  if (pool_) {
+    tokens_[i]->Wait();
+  }
+  return cfile_writers_[i];
+}
+
 Status MultiColumnWriter::FinishAndReleaseBlocks(
     BlockCreationTransaction* transaction) {
   CHECK(!finished_);
+  RETURN_NOT_OK(WaitForQueuedColumns());
   for (int i = 0; i < schema_->num_columns(); i++) {
     CFileWriter *writer = cfile_writers_[i];
     Status s = writer->FinishAndReleaseBlock(transaction);
@@ -139,6 +309,12 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
 
 size_t MultiColumnWriter::written_size() const {
   size_t size = 0;
+  if (pool_ && !finished_) {
+    for (const auto& written_size : written_sizes_) {
+      size += written_size;
+    }
+    return size;
+  }
   for (const CFileWriter *writer : cfile_writers_) {
     size += writer->written_size();
   }
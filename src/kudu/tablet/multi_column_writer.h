@@ -17,26 +17,37 @@
 #ifndef KUDU_TABLET_MULTI_COLUMN_WRITER_H
 #define KUDU_TABLET_MULTI_COLUMN_WRITER_H
 
+#include <atomic>
 #include <cstddef>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glog/logging.h>
 
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class ColumnBlock;
 class FsManager;
 class RowBlock;
 class Schema;
+class Slice;
+class ThreadPool;
+class ThreadPoolToken;
 struct ColumnId;
 
 namespace cfile {
 class CFileWriter;
+class ZoneMapPB;
 } // namespace cfile
 
 namespace fs {
@@ -47,14 +58,28 @@ namespace tablet {
 
 // Wrapper which writes several columns in parallel corresponding to some
 // Schema. Written blocks will fall in the tablet_id's data dir group.
+//
+// If --multi_column_writer_threads is greater than 1, the columns are encoded,
+// compressed and written by a pool of threads: AppendBlock() copies the
+// columns of the block and queues them, one serial queue per column so that
+// the rows of every column are appended in order. AppendBlock() blocks while
+// too many columns are queued. Errors of the queued appends are returned by
+// the next call to AppendBlock() or FinishAndReleaseBlocks().
 class MultiColumnWriter {
  public:
+  // The column blocks are placed on the given storage 'tier' if possible.
   MultiColumnWriter(FsManager* fs,
                     const Schema* schema,
-                    std::string tablet_id);
+                    std::string tablet_id,
+                    fs::StorageTier tier = fs::StorageTier::ANY);
 
   virtual ~MultiColumnWriter();
 
+  // Leaves the columns flagged in 'encoded_cols' out of AppendBlock(): their
+  // values are appended as data blocks copied from other files, with
+  // AppendEncodedDataBlock(). Must be called before Open().
+  void SetEncodedColumns(std::vector<bool> encoded_cols);
+
   // Open and start writing the columns.
   Status Open();
 
@@ -63,6 +88,13 @@ class MultiColumnWriter {
   // Note that the selection vector here is ignored.
   Status AppendBlock(const RowBlock& block);
 
+  // Append an encoded data block to the i-th column, which must have been
+  // flagged by SetEncodedColumns(). See CFileWriter::AppendEncodedDataBlock().
+  Status AppendEncodedDataBlock(int i,
+                                const Slice& data,
+                                size_t num_values,
+                                const cfile::ZoneMapPB* zone_map);
+
   // Close the in-progress CFiles, finalizing the underlying writable
   // blocks and releasing them to 'transaction'.
   Status FinishAndReleaseBlocks(fs::BlockCreationTransaction* transaction);
@@ -70,10 +102,8 @@ class MultiColumnWriter {
   // Return the number of bytes written so far.
   size_t written_size() const;
 
-  cfile::CFileWriter* writer_for_col_idx(int i) {
-    DCHECK_LT(i, cfile_writers_.size());
-    return cfile_writers_[i];
-  }
+  // Returns the writer of the i-th column, once its queued appends are done.
+  cfile::CFileWriter* writer_for_col_idx(int i);
 
   // Return the block IDs of the written columns, keyed by column ID.
   //
@@ -81,16 +111,49 @@ class MultiColumnWriter {
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
  private:
+  struct ColumnBatch;
+
+  // Appends 'column' to the writer of the i-th column.
+  Status AppendColumn(int i, const ColumnBlock& column);
+
+  // Queues a copy of 'column' to be appended by the pool.
+  Status QueueColumn(int i, const ColumnBlock& column);
+
+  // Waits for all of the queued appends, and returns the first error.
+  Status WaitForQueuedColumns();
+
   FsManager* const fs_;
   const Schema* const schema_;
 
   bool finished_;
 
   const std::string tablet_id_;
+  const fs::StorageTier tier_;
 
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // The columns left out of AppendBlock(), if any.
+  std::vector<bool> encoded_cols_;
+
+  // Set if the columns are written by a pool of threads. There's one serial
+  // token per column.
+  gscoped_ptr<ThreadPool> pool_;
+  std::vector<std::unique_ptr<ThreadPoolToken>> tokens_;
+
+  // The size written by each column, updated once its queued appends are done.
+  std::vector<std::atomic<size_t>> written_sizes_;
+
+  // Protects the fields below.
+  Mutex lock_;
+  ConditionVariable queue_cond_;
+
+  // The number of queued columns.
+  int num_queued_;
+
+  // The first error of the queued appends.
+  Status queue_status_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
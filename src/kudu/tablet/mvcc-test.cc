@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <ostream>
 #include <string>
@@ -30,6 +32,7 @@
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -38,6 +41,8 @@
 #include "kudu/util/test_util.h"
 
 using std::thread;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -640,6 +645,49 @@ TEST_F(MvccTest, TestTxnAbort) {
   ASSERT_EQ(tx3, mgr.GetCleanTimestamp());
 }
 
+// Test that committing transactions in bulk has the same effect as committing
+// them one at a time.
+TEST_F(MvccTest, TestCommitTransactionsInBulk) {
+  MvccManager mgr;
+  clock_->Update(Timestamp(20));
+
+  for (int ts = 10; ts <= 14; ts++) {
+    mgr.StartTransaction(Timestamp(ts));
+  }
+  mgr.AdjustSafeTime(Timestamp(14));
+
+  // Commit all but the earliest transaction: the clean time doesn't move.
+  vector<Timestamp> timestamps;
+  for (int ts = 11; ts <= 14; ts++) {
+    mgr.StartApplyingTransaction(Timestamp(ts));
+    timestamps.emplace_back(ts);
+  }
+  mgr.CommitTransactions(timestamps);
+  ASSERT_EQ(Timestamp(10), mgr.GetCleanTimestamp());
+  for (int ts = 11; ts <= 14; ts++) {
+    ASSERT_TRUE(mgr.cur_snap_.IsCommitted(Timestamp(ts)));
+  }
+
+  // Committing the earliest one through a ScopedTransaction moves it to the
+  // safe time.
+  mgr.StartTransaction(Timestamp(15));
+  mgr.AdjustSafeTime(Timestamp(15));
+  {
+    ScopedTransaction txn(&mgr, Timestamp(16));
+    mgr.StartApplyingTransaction(Timestamp(10));
+    mgr.StartApplyingTransaction(Timestamp(15));
+    mgr.CommitTransactions({ Timestamp(10), Timestamp(15) });
+    ASSERT_EQ(Timestamp(15), mgr.GetCleanTimestamp());
+    ASSERT_EQ(1, mgr.CountTransactionsInFlight());
+
+    txn.StartApplying();
+    ScopedTransaction::CommitAll({ &txn });
+    ASSERT_TRUE(txn.is_done());
+    ASSERT_EQ(0, mgr.CountTransactionsInFlight());
+  }
+  ASSERT_TRUE(mgr.cur_snap_.IsCommitted(Timestamp(16)));
+}
+
 // This tests for a bug we were observing, where a clean snapshot would not
 // coalesce to the latest timestamp.
 TEST_F(MvccTest, TestAutomaticCleanTimeMoveToSafeTimeOnCommit) {
@@ -782,5 +830,48 @@ TEST_F(MvccTest, TestCorrectInitWithNoTxns) {
   EXPECT_EQ(snap2.committed_timestamps_.size(), 0);
 }
 
+// Benchmark of snapshots taken by concurrent scanners while transactions
+// commit, as on a tablet serving both small writes and scans.
+TEST_F(MvccTest, TestSnapshotContention) {
+  const int kNumReaders = 4;
+  const int kNumTxns = AllowSlowTests() ? 1000000 : 10000;
+  MvccManager mgr;
+  std::atomic<bool> done(false);
+  std::atomic<int64_t> num_snapshots(0);
+  vector<thread> readers;
+  for (int i = 0; i < kNumReaders; i++) {
+    readers.emplace_back([&]() {
+        int64_t n = 0;
+        MvccSnapshot snap;
+        while (!done) {
+          mgr.TakeSnapshot(&snap);
+          n++;
+        }
+        num_snapshots += n;
+      });
+  }
+
+  MonoTime start = MonoTime::Now();
+  for (int i = 0; i < kNumTxns; i++) {
+    // Like a leader, move the safe time to the timestamp of each transaction
+    // before it commits.
+    Timestamp ts(i + 10);
+    mgr.StartTransaction(ts);
+    mgr.AdjustSafeTime(ts);
+    mgr.StartApplyingTransaction(ts);
+    mgr.CommitTransaction(ts);
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(Timestamp(kNumTxns + 9), mgr.GetCleanTimestamp());
+  LOG(INFO) << Substitute("Committed $0 transactions in $1 while taking $2 snapshots "
+                          "from $3 threads ($4 snapshots/sec)",
+                          kNumTxns, elapsed.ToString(), num_snapshots.load(), kNumReaders,
+                          num_snapshots.load() / elapsed.ToSeconds());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -35,6 +36,7 @@
 namespace kudu {
 namespace tablet {
 
+using std::vector;
 using strings::Substitute;
 
 MvccManager::MvccManager()
@@ -43,6 +45,7 @@ MvccManager::MvccManager()
     open_(true) {
   cur_snap_.all_committed_before_ = Timestamp::kInitialTimestamp;
   cur_snap_.none_committed_at_or_after_ = Timestamp::kInitialTimestamp;
+  PublishCleanTimeUnlocked();
 }
 
 void MvccManager::StartTransaction(Timestamp timestamp) {
@@ -126,6 +129,24 @@ void MvccManager::CommitTransaction(Timestamp timestamp) {
   }
 }
 
+void MvccManager::CommitTransactions(const vector<Timestamp>& timestamps) {
+  std::lock_guard<LockType> l(lock_);
+
+  // The clean time only depends on the earliest in-flight transaction and on
+  // the safe time, so it's enough to adjust it once, after all the commits.
+  bool adjust_clean_time = false;
+  for (const Timestamp& timestamp : timestamps) {
+    bool was_earliest = false;
+    CommitTransactionUnlocked(timestamp, &was_earliest);
+    if (was_earliest && safe_time_ >= timestamp) {
+      adjust_clean_time = true;
+    }
+  }
+  if (adjust_clean_time) {
+    AdjustCleanTime();
+  }
+}
+
 MvccManager::TxnState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
   DCHECK(lock_.is_locked());
 
@@ -157,17 +178,37 @@ void MvccManager::CommitTransactionUnlocked(Timestamp timestamp,
   if (*was_earliest_in_flight) {
     AdvanceEarliestInFlightTimestamp();
   }
+  PublishCleanTimeUnlocked();
 }
 
 void MvccManager::AdvanceEarliestInFlightTimestamp() {
   if (timestamps_in_flight_.empty()) {
     earliest_in_flight_ = Timestamp::kMax;
   } else {
-    earliest_in_flight_ = Timestamp(std::min_element(timestamps_in_flight_.begin(),
-                                                     timestamps_in_flight_.end())->first);
+    earliest_in_flight_ = Timestamp(timestamps_in_flight_.begin()->first);
   }
 }
 
+void MvccManager::PublishCleanTimeUnlocked() {
+  const Timestamp::val_type clean_time = cur_snap_.all_committed_before_.value();
+  const auto& committed = cur_snap_.committed_timestamps_;
+  Timestamp::val_type clean_snapshot_time = Timestamp::kInvalidTimestamp.value();
+  Timestamp::val_type clean_snapshot_time_plus_one = Timestamp::kInvalidTimestamp.value();
+  if (committed.empty()) {
+    clean_snapshot_time = clean_time;
+  } else if (committed.size() == 1 && committed[0] == clean_time &&
+             cur_snap_.none_committed_at_or_after_.value() == clean_time + 1) {
+    clean_snapshot_time_plus_one = clean_time;
+  }
+
+  // A concurrent TakeSnapshot() may see the old value of one and the new
+  // value of the other, both of which describe a state of 'cur_snap_' during
+  // the call which changed it.
+  clean_time_.store(clean_time, std::memory_order_release);
+  clean_snapshot_time_.store(clean_snapshot_time, std::memory_order_release);
+  clean_snapshot_time_plus_one_.store(clean_snapshot_time_plus_one, std::memory_order_release);
+}
+
 void MvccManager::AdjustSafeTime(Timestamp safe_time) {
   std::lock_guard<LockType> l(lock_);
   // No more transactions will start with a ts that is lower than or equal
@@ -244,6 +285,7 @@ void MvccManager::AdjustCleanTime() {
   if (cur_snap_.committed_timestamps_.empty()) {
     cur_snap_.none_committed_at_or_after_ = cur_snap_.all_committed_before_;
   }
+  PublishCleanTimeUnlocked();
 
   // it may also have unblocked some waiters.
   // Check if someone is waiting for transactions to be committed.
@@ -328,15 +370,26 @@ bool MvccManager::AreAllTransactionsCommittedUnlocked(Timestamp ts) const {
 bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
   // TODO(todd) this is not actually checking on the applying txns, it's checking on
   // _all in-flight_. Is this a bug?
-  for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-    if (entry.first <= ts.value()) {
-      return true;
-    }
-  }
-  return false;
+  return !timestamps_in_flight_.empty() &&
+      timestamps_in_flight_.begin()->first <= ts.value();
 }
 
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
+  // In the common cases, the snapshot is entirely described by its clean
+  // time, published without the lock. The transactions which commit
+  // concurrently with this call may or may not be included.
+  const Timestamp::val_type kInvalid = Timestamp::kInvalidTimestamp.value();
+  Timestamp::val_type clean_time = clean_snapshot_time_.load(std::memory_order_acquire);
+  if (PREDICT_TRUE(clean_time != kInvalid)) {
+    *snap = MvccSnapshot(Timestamp(clean_time));
+    return;
+  }
+  clean_time = clean_snapshot_time_plus_one_.load(std::memory_order_acquire);
+  if (PREDICT_TRUE(clean_time != kInvalid)) {
+    *snap = MvccSnapshot(Timestamp(clean_time));
+    snap->AddCommittedTimestamp(Timestamp(clean_time));
+    return;
+  }
   std::lock_guard<LockType> l(lock_);
   *snap = cur_snap_;
 }
@@ -378,6 +431,9 @@ Status MvccManager::WaitForApplyingTransactionsToCommit() const {
 }
 
 bool MvccManager::AreAllTransactionsCommitted(Timestamp ts) const {
+  if (ts.value() < clean_time_.load(std::memory_order_acquire)) {
+    return true;
+  }
   std::lock_guard<LockType> l(lock_);
   return AreAllTransactionsCommittedUnlocked(ts);
 }
@@ -388,8 +444,7 @@ int MvccManager::CountTransactionsInFlight() const {
 }
 
 Timestamp MvccManager::GetCleanTimestamp() const {
-  std::lock_guard<LockType> l(lock_);
-  return cur_snap_.all_committed_before_;
+  return Timestamp(clean_time_.load(std::memory_order_acquire));
 }
 
 void MvccManager::GetApplyingTransactionsTimestamps(std::vector<Timestamp>* timestamps) const {
@@ -517,6 +572,24 @@ void ScopedTransaction::Commit() {
   done_ = true;
 }
 
+void ScopedTransaction::CommitAll(const vector<ScopedTransaction*>& txns) {
+  if (txns.empty()) {
+    return;
+  }
+  MvccManager* manager = txns[0]->manager_;
+  vector<Timestamp> timestamps;
+  timestamps.reserve(txns.size());
+  for (const ScopedTransaction* txn : txns) {
+    DCHECK_EQ(manager, txn->manager_);
+    DCHECK(!txn->done_);
+    timestamps.push_back(txn->timestamp_);
+  }
+  manager->CommitTransactions(timestamps);
+  for (ScopedTransaction* txn : txns) {
+    txn->done_ = true;
+  }
+}
+
 void ScopedTransaction::Abort() {
   manager_->AbortTransaction(timestamp_);
   done_ = true;
@@ -18,9 +18,9 @@
 #pragma once
 
 #include <atomic>
+#include <map>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -219,6 +219,11 @@ class MvccManager {
   // StartApplyingTransaction(), or else this logs a FATAL error.
   void CommitTransaction(Timestamp timestamp);
 
+  // Commits all of the given transactions under a single acquisition of the
+  // lock, adjusting the clean time at most once. Equivalent to calling
+  // CommitTransaction() for each of them, in order.
+  void CommitTransactions(const std::vector<Timestamp>& timestamps);
+
   // Adjusts the safe time so that the MvccManager can trim state.
   //
   // This must only be called when there is a guarantee that there won't be
@@ -289,6 +294,7 @@ class MvccManager {
   FRIEND_TEST(MvccTest, TestAreAllTransactionsCommitted);
   FRIEND_TEST(MvccTest, TestTxnAbort);
   FRIEND_TEST(MvccTest, TestAutomaticCleanTimeMoveToSafeTimeOnCommit);
+  FRIEND_TEST(MvccTest, TestCommitTransactionsInBulk);
   FRIEND_TEST(MvccTest, TestWaitForApplyingTransactionsToCommit);
   FRIEND_TEST(MvccTest, TestWaitForCleanSnapshot_SnapAfterSafeTimeWithInFlights);
   FRIEND_TEST(MvccTest, TestDontWaitAfterClose);
@@ -354,6 +360,10 @@ class MvccManager {
   // commits or aborts.
   void AdvanceEarliestInFlightTimestamp();
 
+  // Publishes 'clean_time_', 'clean_snapshot_time_' and
+  // 'clean_snapshot_time_plus_one_' after a change to 'cur_snap_'.
+  void PublishCleanTimeUnlocked();
+
   int GetNumWaitersForTests() const {
     std::lock_guard<simple_spinlock> l(lock_);
     return waiters_.size();
@@ -364,8 +374,9 @@ class MvccManager {
 
   MvccSnapshot cur_snap_;
 
-  // The set of timestamps corresponding to currently in-flight transactions.
-  typedef std::unordered_map<Timestamp::val_type, TxnState> InFlightMap;
+  // The set of timestamps corresponding to currently in-flight transactions,
+  // ordered so that the earliest one is found without a scan.
+  typedef std::map<Timestamp::val_type, TxnState> InFlightMap;
   InFlightMap timestamps_in_flight_;
 
   // A transaction timestamp below which all transactions are either committed or in-flight,
@@ -378,6 +389,21 @@ class MvccManager {
   // over timestamps_in_flight_ on every commit.
   Timestamp earliest_in_flight_;
 
+  // The clean time of 'cur_snap_', published on every change so that
+  // GetCleanTimestamp() doesn't need to take 'lock_'.
+  std::atomic<Timestamp::val_type> clean_time_;
+
+  // So that TakeSnapshot() doesn't need to take 'lock_' in the common cases,
+  // the clean time is also published in one of these, depending on the
+  // shape of 'cur_snap_', and Timestamp::kInvalidTimestamp in the other:
+  // - 'clean_snapshot_time_' if no timestamp past the clean time is committed,
+  // - 'clean_snapshot_time_plus_one_' if the only timestamp past the clean
+  //   time which is committed is the clean time itself, as it is right after
+  //   a transaction commits at the safe time.
+  // If neither applies, both are Timestamp::kInvalidTimestamp.
+  std::atomic<Timestamp::val_type> clean_snapshot_time_;
+  std::atomic<Timestamp::val_type> clean_snapshot_time_plus_one_;
+
   mutable std::vector<WaitingState*> waiters_;
 
   std::atomic<bool> open_;
@@ -415,6 +441,17 @@ class ScopedTransaction {
   // Requires that StartApplying() has been called.
   void Commit();
 
+  // Commit all of the in-flight transactions in 'txns', which must belong to
+  // the same MvccManager, with a single call to MvccManager::CommitTransactions().
+  //
+  // Requires that StartApplying() has been called on each of them.
+  static void CommitAll(const std::vector<ScopedTransaction*>& txns);
+
+  // Returns true if the transaction was committed or aborted.
+  bool is_done() const {
+    return done_;
+  }
+
   // Abort the in-flight transaction.
   //
   // Requires that StartApplying() has NOT been called.
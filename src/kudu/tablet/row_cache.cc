@@ -0,0 +1,139 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <cstring>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+
+DEFINE_int64(row_cache_capacity_mb, 0,
+             "Capacity of the cache of rows read by primary key point lookups, "
+             "in MB. 0 disables the cache.");
+TAG_FLAG(row_cache_capacity_mb, experimental);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+RowCache* RowCache::GetSingleton() {
+  return FLAGS_row_cache_capacity_mb > 0 ? Singleton<RowCache>::get() : nullptr;
+}
+
+RowCache::RowCache()
+    : RowCache(FLAGS_row_cache_capacity_mb * 1024 * 1024) {
+}
+
+RowCache::RowCache(size_t capacity_bytes)
+    : cache_(NewCache(DRAM_CACHE, CacheEvictionPolicy::CLOCK, capacity_bytes, "row-cache")) {
+}
+
+RowCache::~RowCache() {
+}
+
+string RowCache::MakeKey(const string& tablet_id, uint32_t schema_version,
+                         const Slice& encoded_key) {
+  faststring key;
+  PutLengthPrefixedSlice(&key, tablet_id);
+  PutFixed32(&key, schema_version);
+  key.append(encoded_key.data(), encoded_key.size());
+  return key.ToString();
+}
+
+bool RowCache::Lookup(const string& key, const Schema& schema, const Schema& projection,
+                      RowBlockRow* dst, Arena* arena) {
+  Cache::UniqueHandle h(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                        Cache::HandleDeleter(cache_.get()));
+  if (!h) {
+    return false;
+  }
+  vector<int> col_idxs(projection.num_columns());
+  for (int i = 0; i < projection.num_columns(); i++) {
+    col_idxs[i] = schema.find_column_by_id(projection.column_id(i));
+    if (PREDICT_FALSE(col_idxs[i] == Schema::kColumnNotFound)) {
+      return false;
+    }
+  }
+  ConstContiguousRow row(&schema, cache_->Value(h.get()).data());
+  for (int i = 0; i < projection.num_columns(); i++) {
+    RowBlockRow::Cell dst_cell = dst->cell(i);
+    if (PREDICT_FALSE(!CopyCell(row.cell(col_idxs[i]), &dst_cell, arena).ok())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RowCache::Insert(const string& key, const RowBlockRow& row) {
+  const Schema& schema = *row.schema();
+  const size_t row_size = ContiguousRowHelper::row_size(schema);
+  size_t indirect_size = 0;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (col.type_info()->physical_type() == BINARY && !(col.is_nullable() && row.is_null(i))) {
+      indirect_size += reinterpret_cast<const Slice*>(row.cell_ptr(i))->size();
+    }
+  }
+
+  Cache::PendingHandle* pending = cache_->Allocate(key, row_size + indirect_size);
+  if (PREDICT_FALSE(pending == nullptr)) {
+    // The row doesn't fit into the cache.
+    return;
+  }
+  // The entry is never moved once allocated, so its slices may point to the
+  // indirect data following the row.
+  uint8_t* value = cache_->MutableValue(pending);
+  ContiguousRow cached(&schema, value);
+  ContiguousRowHelper::InitNullsBitmap(schema, value,
+                                       ContiguousRowHelper::null_bitmap_size(schema));
+  uint8_t* indirect = value + row_size;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    ContiguousRow::Cell dst_cell = cached.cell(i);
+    CHECK_OK(CopyCell(row.cell(i), &dst_cell, static_cast<Arena*>(nullptr)));
+    const ColumnSchema& col = schema.column(i);
+    if (col.type_info()->physical_type() == BINARY && !(col.is_nullable() && cached.is_null(i))) {
+      Slice* s = reinterpret_cast<Slice*>(cached.mutable_cell_ptr(i));
+      memcpy(indirect, s->data(), s->size());
+      *s = Slice(indirect, s->size());
+      indirect += s->size();
+    }
+  }
+  cache_->Release(cache_->Insert(pending, nullptr));
+}
+
+void RowCache::Erase(const string& key) {
+  cache_->Erase(key);
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/singleton.h"
+
+namespace kudu {
+
+class Arena;
+class Cache;
+class RowBlockRow;
+class Schema;
+class Slice;
+
+namespace tablet {
+
+// A cache of fully materialized rows, keyed by tablet and encoded primary
+// key, so that repeated point lookups of hot keys are answered without
+// decoding a CFile block per column and applying the row's deltas.
+//
+// An entry holds every column of the row, in the layout of the tablet's
+// schema, followed by the row's indirect data. Its key embeds the schema
+// version of the tablet, so that rows cached before an alter are never
+// returned after it. Tablets erase the entries of the rows they mutate.
+//
+// The memory used by the entries is tracked by the "row-cache" MemTracker.
+// The cache is disabled when --row_cache_capacity_mb is 0.
+//
+// This class is thread-safe.
+class RowCache {
+ public:
+  // Returns the process-wide cache, or nullptr if it's disabled.
+  static RowCache* GetSingleton();
+
+  explicit RowCache(size_t capacity_bytes);
+  ~RowCache();
+
+  // Returns the key of the row with encoded primary key 'encoded_key' of
+  // tablet 'tablet_id', whose schema version is 'schema_version'.
+  static std::string MakeKey(const std::string& tablet_id,
+                             uint32_t schema_version,
+                             const Slice& encoded_key);
+
+  // Looks up the row cached under 'key', whose layout is that of 'schema'.
+  // If found, copies the columns of 'projection', which are mapped to those
+  // of 'schema' by ID, into 'dst', relocating indirect data into 'arena',
+  // and returns true.
+  bool Lookup(const std::string& key, const Schema& schema, const Schema& projection,
+              RowBlockRow* dst, Arena* arena);
+
+  // Caches 'row', which holds every column of its schema, under 'key'.
+  void Insert(const std::string& key, const RowBlockRow& row);
+
+  // Erases the row cached under 'key', if any.
+  void Erase(const std::string& key);
+
+ private:
+  friend class Singleton<RowCache>;
+
+  RowCache();
+
+  gscoped_ptr<Cache> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowCache);
+};
+
+} // namespace tablet
+} // namespace kudu
@@ -28,6 +28,8 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/compaction.h"
+#include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset_metadata.h"
 
 using std::shared_ptr;
@@ -37,6 +39,38 @@ using strings::Substitute;
 
 namespace kudu { namespace tablet {
 
+Status RowSet::CheckRowsPresent(const RowSetKeyProbe* const* probes,
+                                int num_probes,
+                                bool* present,
+                                ProbeStats* const* stats) const {
+  for (int i = 0; i < num_probes; i++) {
+    RETURN_NOT_OK(CheckRowPresent(*probes[i], &present[i], stats[i]));
+  }
+  return Status::OK();
+}
+
+Status RowSet::CheckKeyMayBePresent(const RowSetKeyProbe& /*probe*/,
+                                    bool* may_be_present,
+                                    ProbeStats* /*stats*/) const {
+  *may_be_present = true;
+  return Status::OK();
+}
+
+Status RowSet::NewDiffScanInput(const Schema* projection,
+                                Timestamp /*start*/,
+                                Timestamp end,
+                                gscoped_ptr<CompactionInput>* out) const {
+  return NewCompactionInput(projection, MvccSnapshot(end), out);
+}
+
+Status RowSet::AddColumnStats(ColumnId /*col_id*/, ColumnStatsPB* /*stats*/) const {
+  return Status::OK();
+}
+
+double RowSet::EstimateDeletedRowRatio() const {
+  return 0;
+}
+
 DuplicatingRowSet::DuplicatingRowSet(RowSetVector old_rowsets,
                                      RowSetVector new_rowsets)
     : old_rowsets_(std::move(old_rowsets)),
@@ -112,6 +146,28 @@ Status DuplicatingRowSet::NewCompactionInput(const Schema* projection,
   return Status::OK();
 }
 
+Status DuplicatingRowSet::NewDiffScanInput(const Schema* projection,
+                                           Timestamp start,
+                                           Timestamp end,
+                                           gscoped_ptr<CompactionInput>* out) const {
+  vector<shared_ptr<CompactionInput>> inputs;
+  for (const shared_ptr<RowSet>& rowset : old_rowsets_) {
+    gscoped_ptr<CompactionInput> input;
+    RETURN_NOT_OK_PREPEND(rowset->NewDiffScanInput(projection, start, end, &input),
+                          Substitute("Could not create diff scan input for rowset $0",
+                                     rowset->ToString()));
+    if (input) {
+      inputs.emplace_back(input.release());
+    }
+  }
+  if (inputs.empty()) {
+    out->reset();
+  } else {
+    out->reset(CompactionInput::Merge(inputs, projection));
+  }
+  return Status::OK();
+}
+
 
 Status DuplicatingRowSet::MutateRow(Timestamp timestamp,
                                     const RowSetKeyProbe &probe,
@@ -183,6 +239,13 @@ Status DuplicatingRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DuplicatingRowSet::AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const {
+  for (const shared_ptr<RowSet>& rowset : old_rowsets_) {
+    RETURN_NOT_OK(rowset->AddColumnStats(col_id, stats));
+  }
+  return Status::OK();
+}
+
 Status DuplicatingRowSet::CountRows(rowid_t *count) const {
   int64_t accumulated_count = 0;
   for (const shared_ptr<RowSet> &rs : new_rowsets_) {
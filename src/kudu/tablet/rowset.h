@@ -31,6 +31,7 @@
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -78,6 +79,26 @@ class RowSet {
   virtual Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                                  ProbeStats* stats) const = 0;
 
+  // Same as CheckRowPresent(), for each of the 'num_probes' probes in
+  // 'probes', which must be sorted by key. Sets 'present[i]', and adds the
+  // statistics of the i-th probe into '*stats[i]'.
+  //
+  // The default implementation checks the probes one at a time.
+  virtual Status CheckRowsPresent(const RowSetKeyProbe* const* probes,
+                                  int num_probes,
+                                  bool* present,
+                                  ProbeStats* const* stats) const;
+
+  // Sets '*may_be_present' to false if this rowset is known never to have
+  // held a row with the key of 'probe', e.g. according to its bloom filter.
+  // Unlike CheckRowPresent(), deleted rows count as present, since they may
+  // still be visible at an older MVCC snapshot.
+  //
+  // The default implementation conservatively sets '*may_be_present' to true.
+  virtual Status CheckKeyMayBePresent(const RowSetKeyProbe& probe,
+                                      bool* may_be_present,
+                                      ProbeStats* stats) const;
+
   // Update/delete a row in this rowset.
   // The 'update_schema' is the client schema used to encode the 'update' RowChangeList.
   //
@@ -107,9 +128,31 @@ class RowSet {
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const = 0;
 
+  // Create the input of a diff scan over the changes committed at or after
+  // 'start' and before 'end', like NewCompactionInput() at the snapshot of
+  // 'end'. Mutations committed before 'start' may be left out of the rows'
+  // UNDO lists. If the rowset holds no changes in the window, 'out' is reset
+  // to null.
+  //
+  // By default, every rowset is assumed to hold changes in any window.
+  virtual Status NewDiffScanInput(const Schema* projection,
+                                  Timestamp start,
+                                  Timestamp end,
+                                  gscoped_ptr<CompactionInput>* out) const;
+
   // Count the number of rows in this rowset.
   virtual Status CountRows(rowid_t *count) const = 0;
 
+  // Merges the statistics of the base data of column 'col_id' into '*stats'.
+  // See cfile::MergeColumnStats(). Updates and deletes aren't reflected.
+  //
+  // By default, a rowset has no statistics and leaves '*stats' untouched.
+  virtual Status AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const;
+
+  // Return an estimate of the fraction of this rowset's rows which are
+  // deleted. The default implementation returns 0.
+  virtual double EstimateDeletedRowRatio() const;
+
   // Return the bounds for this RowSet. 'min_encoded_key' and 'max_encoded_key'
   // are set to the first and last encoded keys for this RowSet.
   //
@@ -346,8 +389,19 @@ class DuplicatingRowSet : public RowSet {
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const OVERRIDE;
 
+  // Merges the diff scan inputs of the input rowsets, which are the ones
+  // reads are directed to.
+  Status NewDiffScanInput(const Schema* projection,
+                          Timestamp start,
+                          Timestamp end,
+                          gscoped_ptr<CompactionInput>* out) const OVERRIDE;
+
   Status CountRows(rowid_t *count) const OVERRIDE;
 
+  // Adds the statistics of the input rowsets, which are the ones reads are
+  // directed to.
+  Status AddColumnStats(ColumnId col_id, ColumnStatsPB* stats) const OVERRIDE;
+
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const OVERRIDE;
 
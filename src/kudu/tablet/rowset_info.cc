@@ -27,6 +27,7 @@
 #include <unordered_map>
 #include <utility>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/casts.h"
@@ -34,10 +35,19 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_tree.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+DEFINE_double(compaction_deleted_rows_ratio_threshold, 0.5,
+              "The estimated fraction of deleted rows above which a rowset is "
+              "favored by the budgeted compaction policy, in proportion to that "
+              "fraction, so that mostly deleted rowsets are compacted away even "
+              "if they don't overlap others. Set above 1 to disable.");
+TAG_FLAG(compaction_deleted_rows_ratio_threshold, advanced);
+TAG_FLAG(compaction_deleted_rows_ratio_threshold, runtime);
+
 using std::shared_ptr;
 using std::string;
 using std::unordered_map;
@@ -259,6 +269,8 @@ void RowSetInfo::CollectOrdered(const RowSetTree& tree,
 RowSetInfo::RowSetInfo(RowSet* rs, double init_cdf)
     : cdf_min_key_(init_cdf),
       cdf_max_key_(init_cdf),
+      value_(0),
+      deleted_row_ratio_(rs->EstimateDeletedRowRatio()),
       extra_(new ExtraData()) {
   extra_->rowset = rs;
   extra_->size_bytes = rs->OnDiskBaseDataSizeWithRedos();
@@ -276,8 +288,11 @@ void RowSetInfo::FinalizeCDFVector(vector<RowSetInfo>* vec,
                                  << " bytes.";
     cdf_rs.cdf_min_key_ /= quot;
     cdf_rs.cdf_max_key_ /= quot;
-    cdf_rs.density_ = (cdf_rs.cdf_max_key() - cdf_rs.cdf_min_key())
-      / cdf_rs.size_mb_;
+    cdf_rs.value_ = cdf_rs.width();
+    if (cdf_rs.deleted_row_ratio_ >= FLAGS_compaction_deleted_rows_ratio_threshold) {
+      cdf_rs.value_ *= 1 + cdf_rs.deleted_row_ratio_;
+    }
+    cdf_rs.density_ = cdf_rs.value_ / cdf_rs.size_mb_;
   }
 }
 
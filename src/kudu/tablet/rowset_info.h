@@ -65,6 +65,11 @@ class RowSetInfo {
     return cdf_max_key_ - cdf_min_key_;
   }
 
+  // Return the value of compacting the candidate: its width, increased in
+  // proportion to its fraction of deleted rows if it is mostly deleted.
+  double value() const { return value_; }
+
+  // Return the value of the candidate per MB.
   double density() const { return density_; }
 
   RowSet* rowset() const { return extra_->rowset; }
@@ -89,8 +94,12 @@ class RowSetInfo {
   int size_mb_;
 
   double cdf_min_key_, cdf_max_key_;
+  double value_;
   double density_;
 
+  // The estimated fraction of the rowset's rows which are deleted.
+  double deleted_row_ratio_;
+
   // We move these out of the RowSetInfo object because the std::strings are relatively
   // large objects, and we'd like the RowSetInfos to be as small as possible so that
   // the algorithm can fit mostly in CPU cache. The string bounds themselves are rarely
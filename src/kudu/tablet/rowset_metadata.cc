@@ -89,6 +89,11 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
     adhoc_index_block_ = BlockId::FromPB(pb.adhoc_index_block());
   }
 
+  // Load the key bounds.
+  has_encoded_key_bounds_ = pb.has_min_encoded_key() && pb.has_max_encoded_key();
+  min_encoded_key_ = pb.min_encoded_key();
+  max_encoded_key_ = pb.max_encoded_key();
+
   // Load Column Files.
   blocks_by_col_id_.clear();
   for (const ColumnDataPB& col_pb : pb.columns()) {
@@ -96,6 +101,12 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
     blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.block());
   }
 
+  // Load Secondary Index Files.
+  index_blocks_by_col_id_.clear();
+  for (const ColumnDataPB& index_pb : pb.secondary_indexes()) {
+    index_blocks_by_col_id_[ColumnId(index_pb.column_id())] = BlockId::FromPB(index_pb.block());
+  }
+
   // Load redo delta files.
   redo_delta_blocks_.clear();
   for (const DeltaDataPB& redo_delta_pb : pb.redo_deltas()) {
@@ -126,6 +137,13 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     col_data->set_column_id(col_id);
   }
 
+  // Write Secondary Index Files
+  for (const ColumnIdToBlockIdMap::value_type& e : index_blocks_by_col_id_) {
+    ColumnDataPB *index_data = pb->add_secondary_indexes();
+    e.second.CopyToPB(index_data->mutable_block());
+    index_data->set_column_id(e.first);
+  }
+
   // Write Delta Files
   pb->set_last_durable_dms_id(last_durable_redo_dms_id_);
 
@@ -148,6 +166,12 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   if (!adhoc_index_block_.IsNull()) {
     adhoc_index_block_.CopyToPB(pb->mutable_adhoc_index_block());
   }
+
+  // Write the key bounds.
+  if (has_encoded_key_bounds_) {
+    pb->set_min_encoded_key(min_encoded_key_);
+    pb->set_max_encoded_key(max_encoded_key_);
+  }
 }
 
 const std::string RowSetMetadata::ToString() const {
@@ -161,6 +185,14 @@ void RowSetMetadata::SetColumnDataBlocks(const std::map<ColumnId, BlockId>& bloc
   blocks_by_col_id_ = std::move(new_map);
 }
 
+void RowSetMetadata::SetSecondaryIndexBlocks(
+    const std::map<ColumnId, BlockId>& index_blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(index_blocks_by_col_id.begin(), index_blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  index_blocks_by_col_id_ = std::move(new_map);
+}
+
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
                                                 const BlockId& block_id) {
   std::lock_guard<LockType> l(lock_);
@@ -241,12 +273,20 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
         removed->push_back(old_block_id);
       }
+      if (FindCopy(index_blocks_by_col_id_, e.first, &old_block_id)) {
+        index_blocks_by_col_id_.erase(e.first);
+        removed->push_back(old_block_id);
+      }
     }
 
     for (const ColumnId& col_id : update.col_ids_to_remove_) {
       BlockId old = FindOrDie(blocks_by_col_id_, col_id);
       CHECK_EQ(1, blocks_by_col_id_.erase(col_id));
       removed->push_back(old);
+      if (FindCopy(index_blocks_by_col_id_, col_id, &old)) {
+        index_blocks_by_col_id_.erase(col_id);
+        removed->push_back(old);
+      }
     }
   }
 
@@ -263,6 +303,7 @@ vector<BlockId> RowSetMetadata::GetAllBlocks() {
     blocks.push_back(bloom_block_);
   }
   AppendValuesFromMap(blocks_by_col_id_, &blocks);
+  AppendValuesFromMap(index_blocks_by_col_id_, &blocks);
 
   blocks.insert(blocks.end(),
                 undo_delta_blocks_.begin(), undo_delta_blocks_.end());
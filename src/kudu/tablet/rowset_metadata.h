@@ -115,6 +115,29 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
 
+  void SetSecondaryIndexBlocks(const std::map<ColumnId, BlockId>& index_blocks_by_col_id);
+
+  void set_encoded_key_bounds(const std::string& min_encoded_key,
+                              const std::string& max_encoded_key) {
+    std::lock_guard<LockType> l(lock_);
+    min_encoded_key_ = min_encoded_key;
+    max_encoded_key_ = max_encoded_key;
+    has_encoded_key_bounds_ = true;
+  }
+
+  // Returns whether the encoded key bounds of the rowset are known without
+  // reading its key index, in which case they're returned in the arguments.
+  bool GetEncodedKeyBounds(std::string* min_encoded_key,
+                           std::string* max_encoded_key) const {
+    std::lock_guard<LockType> l(lock_);
+    if (!has_encoded_key_bounds_) {
+      return false;
+    }
+    *min_encoded_key = min_encoded_key_;
+    *max_encoded_key = max_encoded_key_;
+    return true;
+  }
+
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
   Status CommitUndoDeltaDataBlock(const BlockId& block_id);
@@ -144,6 +167,11 @@ class RowSetMetadata {
     return blocks_by_col_id_;
   }
 
+  ColumnIdToBlockIdMap GetSecondaryIndexBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return index_blocks_by_col_id_;
+  }
+
   std::vector<BlockId> redo_delta_blocks() const {
     std::lock_guard<LockType> l(lock_);
     return redo_delta_blocks_;
@@ -199,6 +227,7 @@ class RowSetMetadata {
   explicit RowSetMetadata(TabletMetadata *tablet_metadata)
     : tablet_metadata_(tablet_metadata),
       initted_(false),
+      has_encoded_key_bounds_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -207,6 +236,7 @@ class RowSetMetadata {
     : tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       initted_(true),
       id_(id),
+      has_encoded_key_bounds_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -222,8 +252,17 @@ class RowSetMetadata {
   BlockId bloom_block_;
   BlockId adhoc_index_block_;
 
+  // The encoded key bounds of the rowset, if known.
+  bool has_encoded_key_bounds_;
+  std::string min_encoded_key_;
+  std::string max_encoded_key_;
+
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
+
+  // Map of column ID to the block ID of the column's secondary index. The
+  // index of a column is dropped whenever its base data is replaced.
+  ColumnIdToBlockIdMap index_blocks_by_col_id_;
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
@@ -251,10 +290,11 @@ class RowSetMetadataUpdate {
   // Remove the specified undo delta blocks.
   RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
 
-  // Replace the CFile for the given column ID.
+  // Replace the CFile for the given column ID. Its secondary index, if any,
+  // is removed since it describes the replaced data.
   RowSetMetadataUpdate& ReplaceColumnId(ColumnId col_id, const BlockId& block_id);
 
-  // Remove the CFile for the given column ID.
+  // Remove the CFile for the given column ID, along with its secondary index.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
   // Add a new UNDO delta block to the list of UNDO files.
@@ -25,6 +25,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/tablet/mock-rowsets.h"
@@ -112,6 +113,107 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+// Check that FindRowSetsIntersectingKeys() matches each key against the same
+// rowsets as FindRowSetsWithKeyInRange().
+TEST_F(TestRowSetTree, TestFindRowSetsIntersectingKeys) {
+  SeedRandom();
+  RowSetVector vec = GenerateRandomRowSets(100);
+  // Add rowsets which start or stop at the same keys, and one-key rowsets.
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0100", "0200")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0200", "0300")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0200", "0200")));
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  // Query keys which fall on the bounds, duplicates, and keys past the
+  // bounds of all the rowsets.
+  vector<string> queries = { "0100", "0200", "0200", "0300", "99999" };
+  for (int i = 0; i < 200; i++) {
+    queries.emplace_back(StringPrintf("%04d", rand() % 10000));
+  }
+  std::sort(queries.begin(), queries.end());
+  vector<Slice> query_slices(queries.begin(), queries.end());
+
+  vector<RowSetTree::RowSetKeyGroup> groups;
+  tree.FindRowSetsIntersectingKeys(query_slices, &groups);
+  vector<vector<RowSet*>> swept(queries.size());
+  unordered_set<RowSet*> seen;
+  for (const auto& group : groups) {
+    ASSERT_TRUE(seen.insert(group.first).second) << "rowset in more than one group";
+    ASSERT_FALSE(group.second.empty());
+    ASSERT_TRUE(std::is_sorted(group.second.begin(), group.second.end()));
+    for (int idx : group.second) {
+      swept[idx].push_back(group.first);
+    }
+  }
+
+  for (int i = 0; i < queries.size(); i++) {
+    vector<RowSet*> expected;
+    tree.FindRowSetsWithKeyInRange(query_slices[i], &expected);
+    std::sort(expected.begin(), expected.end());
+    std::sort(swept[i].begin(), swept[i].end());
+    ASSERT_EQ(expected, swept[i]) << "key " << queries[i];
+  }
+
+  // The MemRowSet matches every key.
+  ASSERT_EQ(vec.back().get(), groups[0].first);
+  ASSERT_EQ(queries.size(), groups[0].second.size());
+
+  // An empty query has no matches.
+  groups.clear();
+  tree.FindRowSetsIntersectingKeys({}, &groups);
+  ASSERT_TRUE(groups.empty());
+}
+
+// Check that a tree incrementally built from another one is the same as a
+// tree built from scratch with the resulting rowsets, and that it remains
+// valid once the original tree is destroyed.
+TEST_F(TestRowSetTree, TestIncrementalReset) {
+  SeedRandom();
+  RowSetVector vec = GenerateRandomRowSets(100);
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  gscoped_ptr<RowSetTree> base(new RowSetTree());
+  ASSERT_OK(base->Reset(vec));
+
+  RowSetVector to_remove = { vec[3], vec[10], vec[50], vec.back() };
+  RowSetVector to_add = GenerateRandomRowSets(5);
+  to_add.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  RowSetTree incremental;
+  ASSERT_OK(incremental.Reset(*base, to_remove, to_add));
+  base.reset();
+
+  RowSetVector expected_rowsets;
+  for (const auto& rs : vec) {
+    if (std::find(to_remove.begin(), to_remove.end(), rs) == to_remove.end()) {
+      expected_rowsets.push_back(rs);
+    }
+  }
+  expected_rowsets.insert(expected_rowsets.end(), to_add.begin(), to_add.end());
+  RowSetTree expected;
+  ASSERT_OK(expected.Reset(expected_rowsets));
+
+  ASSERT_EQ(expected.all_rowsets(), incremental.all_rowsets());
+  ASSERT_EQ(expected.key_endpoints().size(), incremental.key_endpoints().size());
+  for (int i = 0; i < expected.key_endpoints().size(); i++) {
+    const auto& e = expected.key_endpoints()[i];
+    const auto& inc = incremental.key_endpoints()[i];
+    ASSERT_EQ(e.rowset_, inc.rowset_);
+    ASSERT_EQ(e.endpoint_, inc.endpoint_);
+    ASSERT_EQ(e.slice_, inc.slice_);
+  }
+  for (int i = 0; i < 100; i++) {
+    string key = StringPrintf("%04d", rand() % 10000);
+    vector<RowSet*> expected_out, incremental_out;
+    expected.FindRowSetsWithKeyInRange(key, &expected_out);
+    incremental.FindRowSetsWithKeyInRange(key, &incremental_out);
+    std::sort(expected_out.begin(), expected_out.end());
+    std::sort(incremental_out.begin(), incremental_out.end());
+    ASSERT_EQ(expected_out, incremental_out) << "key " << key;
+  }
+}
+
 class TestRowSetTreePerformance : public TestRowSetTree,
                                   public testing::WithParamInterface<std::tuple<int, int>> {
 };
@@ -132,6 +234,7 @@ TEST_P(TestRowSetTreePerformance, TestPerformance) {
 
   Stopwatch one_at_time_timer;
   Stopwatch batch_timer;
+  Stopwatch sweep_timer;
   for (int i = 0; i < kNumIterations; i++) {
     // Create a bunch of rowsets, each of which spans about 10% of the "row space".
     // The row space here is 4-digit 0-padded numbers.
@@ -175,7 +278,19 @@ TEST_P(TestRowSetTreePerformance, TestPerformance) {
     }
     batch_timer.stop();
 
+    sweep_timer.resume();
+    int swept_matches = 0;
+    {
+      vector<RowSetTree::RowSetKeyGroup> groups;
+      tree.FindRowSetsIntersectingKeys(query_slices, &groups);
+      for (const auto& group : groups) {
+        swept_matches += group.second.size();
+      }
+    }
+    sweep_timer.stop();
+
     ASSERT_EQ(bulk_matches, individual_matches);
+    ASSERT_EQ(swept_matches, individual_matches);
   }
 
   double batch_total = batch_timer.elapsed().user;
@@ -190,6 +305,12 @@ TEST_P(TestRowSetTreePerformance, TestPerformance) {
                             "batched",
                             static_cast<int>(batch_total/1e6),
                             batch_total ? (oat_total / batch_total) : 0);
+  double sweep_total = sweep_timer.elapsed().user;
+  LOG(INFO) << StringPrintf("%s %10s %d ms (%.2fx)",
+                            case_desc.c_str(),
+                            "swept",
+                            static_cast<int>(sweep_total/1e6),
+                            sweep_total ? (oat_total / sweep_total) : 0);
 }
 
 TEST_F(TestRowSetTree, TestEndpointsConsistency) {
@@ -20,20 +20,25 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <ostream>
 
 #include <glog/logging.h>
 
-#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/interval_tree-inl.h"
 #include "kudu/util/interval_tree.h"
 #include "kudu/util/slice.h"
 
+using std::pair;
 using std::vector;
 using std::shared_ptr;
 using std::string;
@@ -103,60 +108,117 @@ struct RowSetIntervalTraits {
 
 };
 
-RowSetTree::RowSetTree()
-  : initted_(false) {
+namespace {
+
+// Fetch the bounds of 'rs' into a new entry for the interval tree. Sets
+// '*entry' to null if 'rs' has no fixed bounds.
+Status CreateEntry(const shared_ptr<RowSet>& rs, shared_ptr<RowSetWithBounds>* entry) {
+  entry->reset();
+  string min_key, max_key;
+  Status s = rs->GetBounds(&min_key, &max_key);
+  if (s.IsNotSupported()) {
+    // This rowset is a MemRowSet, for which the bounds change as more
+    // data gets inserted. Therefore we can't put it in the static
+    // interval tree -- instead put it on the list which is consulted
+    // on every access.
+    return Status::OK();
+  } else if (!s.ok()) {
+    LOG(WARNING) << "Unable to construct RowSetTree: "
+                 << rs->ToString() << " unable to determine its bounds: "
+                 << s.ToString();
+    return s;
+  }
+  DCHECK_LE(min_key.compare(max_key), 0)
+    << "Rowset min must be <= max: " << rs->ToString();
+
+  // Load bounds and save entry
+  entry->reset(new RowSetWithBounds());
+  (*entry)->rowset = rs.get();
+  (*entry)->min_key = std::move(min_key);
+  (*entry)->max_key = std::move(max_key);
+  return Status::OK();
 }
 
-Status RowSetTree::Reset(const RowSetVector &rowsets) {
-  CHECK(!initted_);
-  std::vector<RowSetWithBounds *> entries;
-  RowSetVector unbounded;
-  ElementDeleter deleter(&entries);
-  entries.reserve(rowsets.size());
-  std::vector<RSEndpoint> endpoints;
-  endpoints.reserve(rowsets.size()*2);
+bool EntryByMinKeyCompare(const RowSetWithBounds* a, const RowSetWithBounds* b) {
+  return a->min_key < b->min_key;
+}
 
-  // Iterate over each of the provided RowSets, fetching their
-  // bounds and adding them to the local vectors.
+bool EntryByMaxKeyCompare(const RowSetWithBounds* a, const RowSetWithBounds* b) {
+  return a->max_key < b->max_key;
+}
+
+// Fetch the bounds of each of 'rowsets', adding the ones with fixed bounds to
+// '*entries', '*endpoints', '*by_min_key' and '*by_max_key', sorted, and the
+// others to '*unbounded'.
+Status CollectEntries(const RowSetVector& rowsets,
+                      vector<shared_ptr<RowSetWithBounds>>* entries,
+                      vector<RowSetTree::RSEndpoint>* endpoints,
+                      vector<RowSetWithBounds*>* by_min_key,
+                      vector<RowSetWithBounds*>* by_max_key,
+                      RowSetVector* unbounded) {
+  entries->reserve(rowsets.size());
+  endpoints->reserve(rowsets.size() * 2);
   for (const shared_ptr<RowSet> &rs : rowsets) {
-    gscoped_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
-    rsit->rowset = rs.get();
-    string min_key, max_key;
-    Status s = rs->GetBounds(&min_key, &max_key);
-    if (s.IsNotSupported()) {
-      // This rowset is a MemRowSet, for which the bounds change as more
-      // data gets inserted. Therefore we can't put it in the static
-      // interval tree -- instead put it on the list which is consulted
-      // on every access.
-      unbounded.push_back(rs);
+    shared_ptr<RowSetWithBounds> entry;
+    RETURN_NOT_OK(CreateEntry(rs, &entry));
+    if (!entry) {
+      unbounded->push_back(rs);
       continue;
-    } else if (!s.ok()) {
-      LOG(WARNING) << "Unable to construct RowSetTree: "
-                   << rs->ToString() << " unable to determine its bounds: "
-                   << s.ToString();
-      return s;
     }
-    DCHECK_LE(min_key.compare(max_key), 0)
-      << "Rowset min must be <= max: " << rs->ToString();
+    endpoints->emplace_back(entry->rowset, RowSetTree::START, entry->min_key);
+    endpoints->emplace_back(entry->rowset, RowSetTree::STOP, entry->max_key);
+    by_min_key->push_back(entry.get());
+    by_max_key->push_back(entry.get());
+    entries->push_back(std::move(entry));
+  }
+  std::sort(endpoints->begin(), endpoints->end(), RSEndpointBySliceCompare);
+  std::sort(by_min_key->begin(), by_min_key->end(), EntryByMinKeyCompare);
+  std::sort(by_max_key->begin(), by_max_key->end(), EntryByMaxKeyCompare);
+  return Status::OK();
+}
 
-    // Load bounds and save entry
-    rsit->min_key = std::move(min_key);
-    rsit->max_key = std::move(max_key);
+// Merge the elements of the sorted 'base' for which 'is_removed' is false with
+// the sorted 'added' into '*out', keeping them sorted according to 'less'.
+template<class T, class Removed, class Less>
+void MergeSorted(const vector<T>& base, const Removed& is_removed,
+                 const vector<T>& added, const Less& less, vector<T>* out) {
+  out->reserve(base.size() + added.size());
+  auto next_added = added.begin();
+  for (const T& elem : base) {
+    if (is_removed(elem)) continue;
+    for (; next_added != added.end() && less(*next_added, elem); ++next_added) {
+      out->push_back(*next_added);
+    }
+    out->push_back(elem);
+  }
+  out->insert(out->end(), next_added, added.end());
+}
 
-    // Load into key endpoints.
-    endpoints.emplace_back(rsit->rowset, START, rsit->min_key);
-    endpoints.emplace_back(rsit->rowset, STOP, rsit->max_key);
+} // anonymous namespace
 
-    entries.push_back(rsit.release());
-  }
+RowSetTree::RowSetTree()
+  : initted_(false) {
+}
+
+Status RowSetTree::Reset(const RowSetVector &rowsets) {
+  CHECK(!initted_);
+  vector<shared_ptr<RowSetWithBounds>> entries;
+  vector<RSEndpoint> endpoints;
+  vector<RowSetWithBounds*> by_min_key;
+  vector<RowSetWithBounds*> by_max_key;
+  RowSetVector unbounded;
 
-  // Sort endpoints
-  std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
+  // Iterate over each of the provided RowSets, fetching their
+  // bounds and adding them to the local vectors.
+  RETURN_NOT_OK(CollectEntries(rowsets, &entries, &endpoints,
+                               &by_min_key, &by_max_key, &unbounded));
 
   // Install the vectors into the object.
   entries_.swap(entries);
   unbounded_rowsets_.swap(unbounded);
-  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_));
+  entries_by_min_key_.swap(by_min_key);
+  entries_by_max_key_.swap(by_max_key);
+  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_by_min_key_));
   key_endpoints_.swap(endpoints);
   all_rowsets_.assign(rowsets.begin(), rowsets.end());
 
@@ -173,6 +235,86 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   return Status::OK();
 }
 
+Status RowSetTree::Reset(const RowSetTree& base,
+                         const RowSetVector& rowsets_to_remove,
+                         const RowSetVector& rowsets_to_add) {
+  CHECK(!initted_);
+  DCHECK(base.initted_);
+
+  // Only the added rowsets need their bounds fetched and sorted.
+  vector<shared_ptr<RowSetWithBounds>> added_entries;
+  vector<RSEndpoint> added_endpoints;
+  vector<RowSetWithBounds*> added_by_min_key;
+  vector<RowSetWithBounds*> added_by_max_key;
+  RowSetVector added_unbounded;
+  RETURN_NOT_OK(CollectEntries(rowsets_to_add, &added_entries, &added_endpoints,
+                               &added_by_min_key, &added_by_max_key, &added_unbounded));
+
+  std::unordered_set<const RowSet*> removed;
+  for (const shared_ptr<RowSet>& rs : rowsets_to_remove) {
+    InsertOrDie(&removed, rs.get());
+  }
+  auto rowset_removed = [&](const shared_ptr<RowSet>& rs) {
+    return ContainsKey(removed, rs.get());
+  };
+  auto entry_removed = [&](const RowSetWithBounds* entry) {
+    return ContainsKey(removed, entry->rowset);
+  };
+
+  int num_removed = 0;
+  all_rowsets_.reserve(base.all_rowsets_.size() + rowsets_to_add.size());
+  for (const shared_ptr<RowSet>& rs : base.all_rowsets_) {
+    if (rowset_removed(rs)) {
+      num_removed++;
+    } else {
+      all_rowsets_.push_back(rs);
+    }
+  }
+  CHECK_EQ(num_removed, rowsets_to_remove.size());
+  all_rowsets_.insert(all_rowsets_.end(), rowsets_to_add.begin(), rowsets_to_add.end());
+
+  entries_.reserve(base.entries_.size() + added_entries.size());
+  for (const shared_ptr<RowSetWithBounds>& entry : base.entries_) {
+    if (!entry_removed(entry.get())) {
+      entries_.push_back(entry);
+    }
+  }
+  entries_.insert(entries_.end(), added_entries.begin(), added_entries.end());
+
+  for (const shared_ptr<RowSet>& rs : base.unbounded_rowsets_) {
+    if (!rowset_removed(rs)) {
+      unbounded_rowsets_.push_back(rs);
+    }
+  }
+  unbounded_rowsets_.insert(unbounded_rowsets_.end(),
+                            added_unbounded.begin(), added_unbounded.end());
+
+  MergeSorted(base.key_endpoints_,
+              [&](const RSEndpoint& e) { return ContainsKey(removed, e.rowset_); },
+              added_endpoints, RSEndpointBySliceCompare, &key_endpoints_);
+  MergeSorted(base.entries_by_min_key_, entry_removed, added_by_min_key,
+              EntryByMinKeyCompare, &entries_by_min_key_);
+  MergeSorted(base.entries_by_max_key_, entry_removed, added_by_max_key,
+              EntryByMaxKeyCompare, &entries_by_max_key_);
+  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_by_min_key_));
+
+  drs_by_id_ = base.drs_by_id_;
+  for (const shared_ptr<RowSet>& rs : rowsets_to_remove) {
+    if (rs->metadata()) {
+      CHECK_EQ(1, drs_by_id_.erase(rs->metadata()->id()));
+    }
+  }
+  for (const shared_ptr<RowSet>& rs : rowsets_to_add) {
+    if (rs->metadata()) {
+      InsertOrDie(&drs_by_id_, rs->metadata()->id(), rs.get());
+    }
+  }
+
+  initted_ = true;
+
+  return Status::OK();
+}
+
 void RowSetTree::FindRowSetsIntersectingInterval(const Slice &lower_bound,
                                                  const Slice &upper_bound,
                                                  vector<RowSet *> *rowsets) const {
@@ -248,9 +390,75 @@ void RowSetTree::ForEachRowSetContainingKeys(
       });
 }
 
+void RowSetTree::FindRowSetsIntersectingKeys(const vector<Slice>& encoded_keys,
+                                             vector<RowSetKeyGroup>* groups) const {
+  DCHECK(initted_);
+  DCHECK(std::is_sorted(encoded_keys.cbegin(), encoded_keys.cend(),
+                        Slice::Comparator()));
+  if (encoded_keys.empty()) {
+    return;
+  }
+
+  // All rowsets with unknown bounds need to be checked.
+  for (const shared_ptr<RowSet> &rs : unbounded_rowsets_) {
+    groups->emplace_back(rs.get(), vector<int>(encoded_keys.size()));
+    std::iota(groups->back().second.begin(), groups->back().second.end(), 0);
+  }
+
+  // The rowsets whose bounds contain the current key, along with the index of
+  // their group in '*groups', or -1 if no key matched them yet.
+  vector<pair<const RowSetWithBounds*, int>> active;
+
+  // Start the sweep at the first key: the rowsets whose bounds contain it are
+  // found with the interval tree, and the ones entirely past it are skipped.
+  vector<RowSetWithBounds*> from_tree;
+  tree_->FindContainingPoint(encoded_keys[0], &from_tree);
+  for (const RowSetWithBounds* rs : from_tree) {
+    active.emplace_back(rs, -1);
+  }
+  const Slice& first_key = encoded_keys[0];
+  auto next_start = std::upper_bound(
+      entries_by_min_key_.begin(), entries_by_min_key_.end(), first_key,
+      [](const Slice& key, const RowSetWithBounds* rs) {
+        return key.compare(rs->min_key) < 0;
+      });
+  auto next_stop = std::lower_bound(
+      entries_by_max_key_.begin(), entries_by_max_key_.end(), first_key,
+      [](const RowSetWithBounds* rs, const Slice& key) {
+        return Slice(rs->max_key).compare(key) < 0;
+      });
+
+  for (int i = 0; i < encoded_keys.size(); i++) {
+    const Slice& key = encoded_keys[i];
+    // Since a rowset's min_key is not greater than its max_key, it's always
+    // activated before it's deactivated.
+    for (; next_start != entries_by_min_key_.end() &&
+           key.compare((*next_start)->min_key) >= 0;
+         ++next_start) {
+      active.emplace_back(*next_start, -1);
+    }
+    for (; next_stop != entries_by_max_key_.end() &&
+           key.compare((*next_stop)->max_key) > 0;
+         ++next_stop) {
+      for (auto it = active.begin(); it != active.end(); ++it) {
+        if (it->first == *next_stop) {
+          *it = active.back();
+          active.pop_back();
+          break;
+        }
+      }
+    }
+    for (auto& a : active) {
+      if (a.second == -1) {
+        a.second = groups->size();
+        groups->emplace_back(a.first->rowset, vector<int>());
+      }
+      (*groups)[a.second].second.push_back(i);
+    }
+  }
+}
 
 RowSetTree::~RowSetTree() {
-  STLDeleteElements(&entries_);
 }
 
 } // namespace tablet
@@ -19,7 +19,9 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
@@ -66,6 +68,19 @@ class RowSetTree {
 
   RowSetTree();
   Status Reset(const RowSetVector &rowsets);
+
+  // Reset this tree to the rowsets of 'base', minus 'rowsets_to_remove' and
+  // plus 'rowsets_to_add', which end up at the end of all_rowsets().
+  //
+  // The bounds of the rowsets kept from 'base' are shared with it rather than
+  // fetched again, and its sorted endpoints are merged with those of the added
+  // rowsets rather than sorted again, so this is cheaper than Reset() with the
+  // resulting rowsets when few of them changed.
+  //
+  // REQUIRES: every rowset in 'rowsets_to_remove' is in 'base'.
+  Status Reset(const RowSetTree& base,
+               const RowSetVector& rowsets_to_remove,
+               const RowSetVector& rowsets_to_add);
   ~RowSetTree();
 
   // Return all RowSets whose range may contain the given encoded key.
@@ -85,6 +100,22 @@ class RowSetTree {
   void ForEachRowSetContainingKeys(const std::vector<Slice>& encoded_keys,
                                    const std::function<void(RowSet*, int)>& cb) const;
 
+  // A rowset along with the indexes of the keys of a batch query which may be
+  // within its bounds, in ascending order.
+  typedef std::pair<RowSet*, std::vector<int>> RowSetKeyGroup;
+
+  // Same as ForEachRowSetContainingKeys(), but returns the matches grouped by
+  // rowset into '*groups'. The rowsets with unknown bounds come first, and
+  // match every key.
+  //
+  // This sweeps through the sorted keys and the sorted rowset bounds at the
+  // same time rather than querying the interval tree for each key, and so is
+  // cheaper for large batches or tablets with many small rowsets.
+  //
+  // REQUIRES: 'encoded_keys' must be in sorted order.
+  void FindRowSetsIntersectingKeys(const std::vector<Slice>& encoded_keys,
+                                   std::vector<RowSetKeyGroup>* groups) const;
+
   void FindRowSetsIntersectingInterval(const Slice &lower_bound,
                                        const Slice &upper_bound,
                                        std::vector<RowSet *> *rowsets) const;
@@ -110,10 +141,16 @@ class RowSetTree {
   // TODO map to usage statistics as well. See KUDU-???
   std::vector<RSEndpoint> key_endpoints_;
 
+  // The entries of tree_, sorted by their min_key and by their max_key
+  // respectively. Used by FindRowSetsIntersectingKeys().
+  std::vector<RowSetWithBounds *> entries_by_min_key_;
+  std::vector<RowSetWithBounds *> entries_by_max_key_;
+
   // Container for all of the entries in tree_. IntervalTree does
   // not itself manage memory, so this provides a simple way to enumerate
-  // all the entry structs and free them in the destructor.
-  std::vector<RowSetWithBounds *> entries_;
+  // all the entry structs. The entries are immutable, and are shared with
+  // the trees built from this one by the incremental Reset().
+  std::vector<std::shared_ptr<RowSetWithBounds>> entries_;
 
   // All of the rowsets which were put in this RowSetTree.
   RowSetVector all_rowsets_;
@@ -0,0 +1,296 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/secondary_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/bitmapfile.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/gutil/endian.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/roaring_bitmap.h"
+#include "kudu/util/slice.h"
+
+DECLARE_int32(default_composite_key_index_block_size_bytes);
+
+DEFINE_int32(tablet_bitmap_index_max_cardinality, 256,
+             "The maximum number of distinct values an indexed column may have "
+             "in a rowset for its index to be written as a bitmap file, rather "
+             "than as a sorted index. 0 disables bitmap indexes.");
+TAG_FLAG(tablet_bitmap_index_max_cardinality, advanced);
+TAG_FLAG(tablet_bitmap_index_max_cardinality, experimental);
+
+namespace kudu {
+namespace tablet {
+
+using cfile::BitmapFileReader;
+using cfile::BitmapFileWriter;
+using cfile::CFileIterator;
+using cfile::CFileReader;
+using cfile::CFileWriter;
+using cfile::ReaderOptions;
+using fs::BlockCreationTransaction;
+using fs::ReadableBlock;
+using fs::WritableBlock;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The number of entries written or read at a time.
+const size_t kBatchSize = 1024;
+
+// Appends the encoding of the index entry prefix for 'value' to 'buf'.
+void EncodeValue(const KeyEncoder<faststring>& encoder, const void* value, faststring* buf) {
+  // Not the final key component, so that the encoded values are prefix-free.
+  encoder.Encode(value, false, buf);
+}
+
+// Returns the encoded value of a sorted index entry.
+Slice EntryValue(const Slice& entry) {
+  return Slice(entry.data(), entry.size() - sizeof(rowid_t));
+}
+
+rowid_t EntryOrdinal(const Slice& entry) {
+  return BigEndian::Load32(entry.data() + entry.size() - sizeof(rowid_t));
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// SecondaryIndexWriter
+////////////////////////////////////////////////////////////
+
+SecondaryIndexWriter::SecondaryIndexWriter(const TypeInfo* type_info,
+                                           unique_ptr<WritableBlock> block)
+    : type_info_(type_info),
+      block_id_(block->id()),
+      block_(std::move(block)),
+      written_size_(0) {
+}
+
+SecondaryIndexWriter::~SecondaryIndexWriter() {
+}
+
+Status SecondaryIndexWriter::AppendBlock(const ColumnBlock& block, rowid_t first_ordinal) {
+  DCHECK_EQ(block.type_info(), type_info_);
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info_);
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (block.is_nullable() && block.is_null(i)) {
+      continue;
+    }
+    entry_offsets_.push_back(entries_buf_.size());
+    EncodeValue(encoder, block.cell_ptr(i), &entries_buf_);
+    uint8_t ordinal[sizeof(rowid_t)];
+    BigEndian::Store32(ordinal, first_ordinal + i);
+    entries_buf_.append(ordinal, sizeof(ordinal));
+  }
+  return Status::OK();
+}
+
+Status SecondaryIndexWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
+  const size_t num_entries = entry_offsets_.size();
+  vector<Slice> entries;
+  entries.reserve(num_entries);
+  for (size_t i = 0; i < num_entries; i++) {
+    size_t end = i + 1 < num_entries ? entry_offsets_[i + 1] : entries_buf_.size();
+    entries.emplace_back(entries_buf_.data() + entry_offsets_[i], end - entry_offsets_[i]);
+  }
+  // Entries for equal values are ordered by their ordinal suffix.
+  std::sort(entries.begin(), entries.end(),
+            [](const Slice& a, const Slice& b) { return a.compare(b) < 0; });
+
+  // Count the distinct values, stopping once there are too many for a
+  // bitmap file.
+  const size_t max_cardinality = std::max(FLAGS_tablet_bitmap_index_max_cardinality, 0);
+  size_t cardinality = 0;
+  for (size_t i = 0; i < num_entries && cardinality <= max_cardinality; i++) {
+    if (i == 0 || EntryValue(entries[i]) != EntryValue(entries[i - 1])) {
+      cardinality++;
+    }
+  }
+
+  if (num_entries > 0 && cardinality <= max_cardinality) {
+    RETURN_NOT_OK(WriteBitmapFile(entries, transaction));
+  } else {
+    RETURN_NOT_OK(WriteSortedIndex(entries, transaction));
+  }
+
+  entries_buf_.clear();
+  entries_buf_.shrink_to_fit();
+  entry_offsets_.clear();
+  entry_offsets_.shrink_to_fit();
+  return Status::OK();
+}
+
+Status SecondaryIndexWriter::WriteBitmapFile(const vector<Slice>& entries,
+                                             BlockCreationTransaction* transaction) {
+  BitmapFileWriter writer(std::move(block_));
+  RETURN_NOT_OK(writer.Start());
+  size_t i = 0;
+  while (i < entries.size()) {
+    const Slice value = EntryValue(entries[i]);
+    RoaringBitmap rows;
+    for (; i < entries.size() && EntryValue(entries[i]) == value; i++) {
+      rows.AddSorted(EntryOrdinal(entries[i]));
+    }
+    RETURN_NOT_OK(writer.AppendBitmap(value, rows));
+  }
+  written_size_ = writer.written_size();
+  return writer.FinishAndReleaseBlock(transaction);
+}
+
+Status SecondaryIndexWriter::WriteSortedIndex(const vector<Slice>& entries,
+                                              BlockCreationTransaction* transaction) {
+  cfile::WriterOptions opts;
+  // The index is only ever looked up by value.
+  opts.write_validx = true;
+  opts.write_posidx = false;
+  opts.storage_attributes.encoding = PREFIX_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  opts.storage_attributes.cfile_block_size = FLAGS_default_composite_key_index_block_size_bytes;
+  CFileWriter writer(std::move(opts), GetTypeInfo(BINARY), false, std::move(block_));
+  RETURN_NOT_OK(writer.Start());
+  for (size_t i = 0; i < entries.size(); i += kBatchSize) {
+    RETURN_NOT_OK(writer.AppendEntries(&entries[i], std::min(kBatchSize, entries.size() - i)));
+  }
+  written_size_ = writer.written_size();
+  return writer.FinishAndReleaseBlock(transaction);
+}
+
+size_t SecondaryIndexWriter::written_size() const {
+  return block_ ? entries_buf_.size() : written_size_;
+}
+
+////////////////////////////////////////////////////////////
+// SecondaryIndexReader
+////////////////////////////////////////////////////////////
+
+Status SecondaryIndexReader::Open(unique_ptr<ReadableBlock> block,
+                                  ReaderOptions options,
+                                  unique_ptr<SecondaryIndexReader>* reader) {
+  unique_ptr<CFileReader> cfile_reader;
+  RETURN_NOT_OK(CFileReader::OpenNoInit(std::move(block), std::move(options), &cfile_reader));
+  reader->reset(new SecondaryIndexReader(std::move(cfile_reader)));
+  return Status::OK();
+}
+
+SecondaryIndexReader::SecondaryIndexReader(unique_ptr<CFileReader> reader)
+    : reader_(std::move(reader)) {
+}
+
+SecondaryIndexReader::~SecondaryIndexReader() {
+}
+
+Status SecondaryIndexReader::FindRows(const TypeInfo* type_info,
+                                      const vector<const void*>& values,
+                                      RoaringBitmap* rows) const {
+  *rows = RoaringBitmap();
+  RETURN_NOT_OK(reader_->Init());
+  const bool is_bitmap_file = BitmapFileReader::IsBitmapFile(*reader_);
+  BitmapFileReader bitmaps(reader_.get());
+
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info);
+  for (const void* value : values) {
+    faststring encoded_value;
+    EncodeValue(encoder, value, &encoded_value);
+    if (is_bitmap_file) {
+      RETURN_NOT_OK(bitmaps.UnionBitmap(encoded_value, rows));
+    } else {
+      RETURN_NOT_OK(UnionSortedIndexRows(encoded_value, rows));
+    }
+  }
+  return Status::OK();
+}
+
+Status SecondaryIndexReader::UnionSortedIndexRows(const Slice& encoded_value,
+                                                  RoaringBitmap* rows) const {
+  rowid_t num_entries;
+  RETURN_NOT_OK(reader_->CountRows(&num_entries));
+  if (num_entries == 0) {
+    // Every indexed cell was NULL.
+    return Status::OK();
+  }
+
+  CFileIterator* iter_ptr;
+  RETURN_NOT_OK(reader_->NewIterator(&iter_ptr, CFileReader::CACHE_BLOCK));
+  unique_ptr<CFileIterator> iter(iter_ptr);
+
+  // The index has a single BINARY "key" column, the raw entry. The seek key
+  // takes ownership of its own copy of the value.
+  faststring key_buf;
+  key_buf.append(encoded_value.data(), encoded_value.size());
+  vector<const void*> raw_keys = { &encoded_value };
+  EncodedKey key(&key_buf, &raw_keys, 1);
+  bool exact;
+  Status s = iter->SeekAtOrAfter(key, &exact);
+  if (s.IsNotFound()) {
+    // Every entry sorts before the value.
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+
+  // The rows holding the value are read in ascending order.
+  RoaringBitmap value_rows;
+  Arena arena(32 * 1024);
+  vector<Slice> entries(kBatchSize);
+  ColumnBlock block(GetTypeInfo(BINARY), nullptr, entries.data(), kBatchSize, &arena);
+  SelectionVector sel(kBatchSize);
+  bool done = false;
+  while (!done && iter->HasNext()) {
+    size_t n = kBatchSize;
+    ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+    ctx.SetDecoderEvalNotSupported();
+    RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+    for (size_t i = 0; i < n; i++) {
+      const Slice& entry = entries[i];
+      if (entry.size() != encoded_value.size() + sizeof(rowid_t) ||
+          !entry.starts_with(encoded_value)) {
+        done = true;
+        break;
+      }
+      value_rows.AddSorted(EntryOrdinal(entry));
+    }
+    arena.Reset();
+  }
+  rows->UnionWith(value_rows);
+  return Status::OK();
+}
+
+uint64_t SecondaryIndexReader::file_size() const {
+  return reader_->file_size();
+}
+
+} // namespace tablet
+} // namespace kudu
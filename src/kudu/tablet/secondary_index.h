@@ -0,0 +1,136 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/common/rowid.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class RoaringBitmap;
+class Slice;
+class TypeInfo;
+
+namespace cfile {
+class CFileReader;
+struct ReaderOptions;
+} // namespace cfile
+
+namespace fs {
+class BlockCreationTransaction;
+class ReadableBlock;
+class WritableBlock;
+} // namespace fs
+
+namespace tablet {
+
+// A secondary index maps the values of a non-key column of a DiskRowSet to
+// the ordinals of the rows holding them. NULL cells are not indexed.
+//
+// The index of a rowset takes one of two forms, chosen when the rowset is
+// written:
+// - If the column has few distinct values in the rowset, a bitmap file (see
+//   cfile/bitmapfile.h) holding the bitmap of the rows of each value.
+// - Otherwise, a BINARY CFile with a value index, whose entries are the
+//   key-encoded values each followed by the big-endian ordinal of a row
+//   holding them, in sorted order. The rows holding a value are found by
+//   seeking to its encoding and reading the entries which start with it.
+//
+// The non-final key encoding is used for the values in both forms, so that
+// no encoded value is a prefix of another.
+class SecondaryIndexWriter {
+ public:
+  // The index is written to 'block' when finished.
+  SecondaryIndexWriter(const TypeInfo* type_info,
+                       std::unique_ptr<fs::WritableBlock> block);
+  ~SecondaryIndexWriter();
+
+  // Adds the cells of 'block', the first of which belongs to the row at
+  // ordinal 'first_ordinal'. The entries are buffered in memory until
+  // FinishAndReleaseBlock(), since they must be written in sorted order
+  // and the form of the index depends on all of them.
+  Status AppendBlock(const ColumnBlock& block, rowid_t first_ordinal);
+
+  // Writes out the index, finalizing the underlying block and releasing it
+  // to 'transaction'.
+  Status FinishAndReleaseBlock(fs::BlockCreationTransaction* transaction);
+
+  // Returns the number of bytes buffered or written so far.
+  size_t written_size() const;
+
+  const BlockId& block_id() const { return block_id_; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SecondaryIndexWriter);
+
+  // Writes the sorted 'entries' out as a bitmap file, or as a sorted index.
+  Status WriteBitmapFile(const std::vector<Slice>& entries,
+                         fs::BlockCreationTransaction* transaction);
+  Status WriteSortedIndex(const std::vector<Slice>& entries,
+                          fs::BlockCreationTransaction* transaction);
+
+  const TypeInfo* const type_info_;
+  const BlockId block_id_;
+  std::unique_ptr<fs::WritableBlock> block_;
+
+  // The buffered entries, back to back, and the offset of each of them
+  // in 'entries_buf_'.
+  faststring entries_buf_;
+  std::vector<uint32_t> entry_offsets_;
+
+  // The size of the index once written out.
+  size_t written_size_;
+};
+
+class SecondaryIndexReader {
+ public:
+  static Status Open(std::unique_ptr<fs::ReadableBlock> block,
+                     cfile::ReaderOptions options,
+                     std::unique_ptr<SecondaryIndexReader>* reader);
+  ~SecondaryIndexReader();
+
+  // Sets 'rows' to the ordinals of the rows whose value is any of 'values',
+  // each of which points to a cell of the type 'type_info'.
+  Status FindRows(const TypeInfo* type_info,
+                  const std::vector<const void*>& values,
+                  RoaringBitmap* rows) const;
+
+  uint64_t file_size() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SecondaryIndexReader);
+
+  explicit SecondaryIndexReader(std::unique_ptr<cfile::CFileReader> reader);
+
+  // Unions into 'rows' the ordinals of the sorted index entries which start
+  // with 'encoded_value'.
+  Status UnionSortedIndexRows(const Slice& encoded_value, RoaringBitmap* rows) const;
+
+  const std::unique_ptr<cfile::CFileReader> reader_;
+};
+
+} // namespace tablet
+} // namespace kudu
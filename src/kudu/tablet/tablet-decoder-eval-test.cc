@@ -23,6 +23,7 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -216,6 +217,48 @@ public:
     return StringPrintf(Substitute("%0$0$1", strlen, PRId64).c_str(), static_cast<int64_t>(n));
   }
 
+  // Fills the tablet with the pattern [0, cardinality) and scans with an IN
+  // list of 'values', some of which may not be in the tablet.
+  void TestInListScan(size_t cardinality, const std::vector<size_t>& values) {
+    if (GetParam() == LARGE && !AllowSlowTests()) {
+      LOG(INFO) << "Skipped large test case";
+      return;
+    }
+    size_t nrows = static_cast<size_t>(GetParam());
+    size_t strlen = std::max(static_cast<size_t>(FLAGS_decoder_eval_test_strlen),
+                             Substitute("$0", cardinality).length() + 1);
+    FillTestTablet(nrows, cardinality, strlen, -1);
+
+    Arena arena(128);
+    AutoReleasePool pool;
+    ScanSpec spec;
+    std::vector<std::string> value_strings;
+    for (size_t value : values) {
+      value_strings.emplace_back(LeftZeroPadded(value, strlen));
+    }
+    std::vector<Slice> value_slices(value_strings.begin(), value_strings.end());
+    std::vector<const void*> value_ptrs;
+    for (const Slice& value : value_slices) {
+      value_ptrs.push_back(&value);
+    }
+    spec.AddPredicate(ColumnPredicate::InList(schema_.column(2), &value_ptrs));
+    spec.OptimizeScan(schema_, &arena, &pool, true);
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(client_schema_, &iter));
+    ASSERT_OK(iter->Init(&spec));
+    ASSERT_TRUE(spec.predicates().empty()) << "Should have accepted all predicates";
+
+    size_t expected_count = 0;
+    for (size_t i = 0; i < nrows; i++) {
+      if (std::find(values.begin(), values.end(), i % cardinality) != values.end()) {
+        expected_count++;
+      }
+    }
+    int fetched = 0;
+    ASSERT_OK(SilentIterateToStringList(iter.get(), &fetched));
+    ASSERT_EQ(expected_count, fetched);
+  }
+
   void TestMultipleColumnPredicates(size_t cardinality, size_t lower, size_t upper) {
     if (GetParam() == LARGE && !AllowSlowTests()) {
       LOG(INFO) << "Skipped large test case";
@@ -327,6 +370,12 @@ TEST_P(TabletDecoderEvalTest, MultipleColumns) {
   TestMultipleColumnPredicates(10, 3, 5);
 }
 
+TEST_P(TabletDecoderEvalTest, InList) {
+  // Fill a tablet with pattern [0, 50) and query for a few of its values, and
+  // one which isn't present.
+  TestInListScan(50, { 3, 17, 42, 99 });
+}
+
 INSTANTIATE_TEST_CASE_P(DecoderEvaluation, TabletDecoderEvalTest, ::testing::Values(EMPTY,
                                                                                     SMALL,
                                                                                     MEDIUM,
@@ -31,6 +31,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
@@ -307,5 +308,64 @@ TEST_F(TestTabletSchema, TestModifyEmptyMemRowSet) {
   EXPECT_EQ("(int32 key=2, int32 c1=4, int32 c2=3)", rows[0]);
 }
 
+class TestRowTtl : public KuduTabletTest {
+ public:
+  TestRowTtl()
+    : KuduTabletTest(CreateSchema()) {
+  }
+
+  void WriteRow(int32_t key, int64_t ts, bool update) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    CHECK_OK(row.SetInt32(0, key));
+    CHECK_OK(row.SetUnixTimeMicros(1, ts));
+    ASSERT_OK(update ? writer.Update(row) : writer.Insert(row));
+  }
+
+  static const int64_t kTtlSeconds = 3600;
+
+ private:
+  static Schema CreateSchema() {
+    ColumnStorageAttributes attrs;
+    attrs.ttl_seconds = kTtlSeconds;
+    return Schema({ ColumnSchema("key", INT32),
+                    ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr, attrs) }, 1);
+  }
+};
+
+// Tests that the rows expired by the row TTL are dropped by flushes and
+// compactions, as of their latest value of the TTL column.
+TEST_F(TestRowTtl, TestExpiredRowsAreDropped) {
+  const int64_t now = GetCurrentTimeMicros();
+  const int64_t expired = now - 2 * kTtlSeconds * 1000000;
+  NO_FATALS(WriteRow(0, expired, false));
+  NO_FATALS(WriteRow(1, now, false));
+  NO_FATALS(WriteRow(2, expired, false));
+  NO_FATALS(WriteRow(2, now, true));
+  NO_FATALS(WriteRow(3, now, false));
+  NO_FATALS(WriteRow(3, expired, true));
+
+  uint64_t count;
+  ASSERT_OK(tablet()->CountRows(&count));
+  ASSERT_EQ(4, count);
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(tablet()->CountRows(&count));
+  ASSERT_EQ(2, count);
+
+  // Updates of flushed rows are taken into account by compactions.
+  NO_FATALS(WriteRow(1, expired, true));
+  NO_FATALS(WriteRow(4, now, false));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_OK(tablet()->CountRows(&count));
+  ASSERT_EQ(2, count);
+
+  vector<string> rows;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema_, &rows));
+  ASSERT_EQ(2, rows.size());
+  ASSERT_STR_CONTAINS(rows[0], "key=2");
+  ASSERT_STR_CONTAINS(rows[1], "key=4");
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -32,9 +32,12 @@
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/wire_protocol.pb.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -56,11 +59,16 @@
 #include "kudu/tablet/tablet_metrics.h" // IWYU pragma: keep
 #include "kudu/util/faststring.h"
 #include "kudu/util/jsonwriter.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_int64(row_cache_capacity_mb);
+
 DEFINE_int32(testflush_num_inserts, 1000,
              "Number of rows inserted in TestFlush");
 DEFINE_int32(testiterator_num_inserts, 1000,
@@ -386,6 +394,52 @@ TYPED_TEST(TestTablet, TestDeleteWithFlushAndCompact) {
   EXPECT_EQ(this->setup_.FormatDebugRow(0, 2, false), rows[0]);
 }
 
+// Test point lookups of rows spread across the MemRowSet and DiskRowSets.
+TYPED_TEST(TestTablet, TestGetRows) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  // Rows 0-9 are on disk, with row 5 updated and row 3 deleted. Rows 10-19
+  // are in the MemRowSet, with row 12 deleted. Row 7 is deleted from disk and
+  // reinserted into the MemRowSet.
+  this->InsertTestRows(0, 10, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(10, 10, 0);
+  ASSERT_OK(this->UpdateTestRow(&writer, 5, 100));
+  ASSERT_OK(this->DeleteTestRow(&writer, 3));
+  ASSERT_OK(this->DeleteTestRow(&writer, 12));
+  ASSERT_OK(this->DeleteTestRow(&writer, 7));
+  ASSERT_OK(this->InsertTestRow(&writer, 7, 200));
+
+  // Look up every row, along with a key which was never inserted.
+  const int kNumKeys = 21;
+  vector<string> encoded_keys;
+  for (int i = 0; i < kNumKeys; i++) {
+    KuduPartialRow row(&this->client_schema_);
+    this->setup_.BuildRowKey(&row, i == kNumKeys - 1 ? 1000 : i);
+    encoded_keys.push_back(row.ToEncodedRowKeyOrDie());
+  }
+  vector<Slice> keys(encoded_keys.begin(), encoded_keys.end());
+
+  Arena arena(1024);
+  RowBlock block(this->client_schema_, kNumKeys, &arena);
+  for (int pass = 0; pass < 2; pass++) {
+    ASSERT_OK(this->tablet()->GetRows(this->client_schema_, keys, &block));
+    ASSERT_EQ(kNumKeys, block.nrows());
+    for (int i = 0; i < kNumKeys; i++) {
+      SCOPED_TRACE(i);
+      bool absent = i == 3 || i == 12 || i == kNumKeys - 1;
+      ASSERT_EQ(!absent, block.selection_vector()->IsRowSelected(i));
+      if (absent) continue;
+      int32_t val = i == 5 ? 100 : i == 7 ? 200 : 0;
+      EXPECT_EQ(this->setup_.FormatDebugRow(i, val, i == 5),
+                this->client_schema_.DebugRow(block.row(i)));
+    }
+
+    // The results are the same once everything is flushed and compacted.
+    ASSERT_OK(this->tablet()->Flush());
+    ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  }
+}
+
 // Test flushes dealing with REINSERT mutations in the MemRowSet.
 TYPED_TEST(TestTablet, TestFlushWithReinsert) {
   LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
@@ -718,6 +772,36 @@ TYPED_TEST(TestTablet, TestInsertsPersist) {
   // TODO: add some more data, re-flush
 }
 
+TYPED_TEST(TestTablet, TestChooseSplitKey) {
+  // A tablet without data on disk can't be split.
+  string split_key;
+  ASSERT_TRUE(this->tablet()->ChooseSplitKey(&split_key).IsNotFound());
+
+  const int64_t num_rows = this->ClampRowCount(2000);
+  this->InsertTestRows(0, num_rows / 2, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(num_rows / 2, num_rows - num_rows / 2, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  ASSERT_OK(this->tablet()->ChooseSplitKey(&split_key));
+
+  // The split key leaves some of the rows on either side.
+  string min_key;
+  string max_key;
+  KuduPartialRow row(&this->client_schema_);
+  for (int64_t i = 0; i < num_rows; i++) {
+    this->setup_.BuildRowKey(&row, i);
+    const string key = row.ToEncodedRowKeyOrDie();
+    if (i == 0 || key < min_key) {
+      min_key = key;
+    }
+    if (i == 0 || key > max_key) {
+      max_key = key;
+    }
+  }
+  ASSERT_GT(split_key, min_key);
+  ASSERT_LE(split_key, max_key);
+}
+
 TYPED_TEST(TestTablet, TestUpsert) {
   vector<string> rows;
   const auto& upserts_as_updates = this->tablet()->metrics()->upserts_as_updates;
@@ -1137,5 +1221,142 @@ TEST(TestTablet, TestGetReplaySizeForIndex) {
   EXPECT_EQ(Tablet::GetReplaySizeForIndex(min_log_index, replay_size_map), 0);
 }
 
+
+class TabletBulkLoadTest : public TabletTestBase<NullableValueTestSetup> {
+ protected:
+  // Bulk loads the test rows 'first_row' to 'first_row + count - 1', in
+  // ascending order if 'sorted', else in descending order.
+  Status BulkLoadTestRows(int64_t first_row, int64_t count, int32_t val,
+                          bool sorted = true) {
+    RowOperationsPB ops;
+    RowOperationsPBEncoder enc(&ops);
+    KuduPartialRow row(&client_schema_);
+    for (int64_t i = 0; i < count; i++) {
+      setup_.BuildRow(&row, sorted ? first_row + i : first_row + count - 1 - i, val);
+      enc.Add(RowOperationsPB::INSERT, row);
+    }
+    return tablet()->BulkLoadSortedRows(&client_schema_, ops);
+  }
+
+  // Returns the number of rows visible at 'timestamp'.
+  uint64_t CountRowsAt(Timestamp timestamp) {
+    gscoped_ptr<RowwiseIterator> iter;
+    CHECK_OK(tablet()->NewRowIterator(client_schema_, MvccSnapshot(timestamp),
+                                      UNORDERED, &iter));
+    CHECK_OK(iter->Init(nullptr));
+    vector<string> rows;
+    CHECK_OK(kudu::tablet::IterateToStringList(iter.get(), &rows));
+    return rows.size();
+  }
+};
+
+TEST_F(TabletBulkLoadTest, TestBulkLoad) {
+  // Existing rows, both on disk and in the MemRowSet.
+  InsertTestRows(0, 10, 0);
+  ASSERT_OK(tablet()->Flush());
+  InsertTestRows(10, 10, 0);
+  Timestamp before_load = clock()->Now();
+
+  const int kNumRows = 1000;
+  ASSERT_OK(BulkLoadTestRows(100, kNumRows, 1));
+  ASSERT_EQ(20 + kNumRows, TabletCount());
+  ASSERT_EQ(2, tablet()->num_rowsets());
+  ASSERT_EQ(20, CountRowsAt(before_load));
+  NO_FATALS(VerifyTestRowsWithVerifier(100, kNumRows, boost::none));
+
+  // Batches with a key which is already present are rejected as a whole,
+  // whether the key is on disk, in the MemRowSet or in a bulk loaded rowset.
+  for (int64_t first_row : { 5, 15, 95 + kNumRows }) {
+    Status s = BulkLoadTestRows(first_row, 10, 1);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  }
+  ASSERT_EQ(20 + kNumRows, TabletCount());
+
+  // So are unsorted batches.
+  Status s = BulkLoadTestRows(5000, 10, 1, /*sorted=*/ false);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_EQ(2, tablet()->num_rowsets());
+
+  // The loaded rows are regular rows.
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  ASSERT_OK(UpdateTestRow(&writer, 100, 2));
+  s = InsertTestRow(&writer, 101, 0);
+  ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+
+  // The loaded rows survive a restart. The MemRowSet has no WAL here, so it's
+  // flushed first.
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_NO_FATAL_FAILURE(TabletReOpen());
+  ASSERT_EQ(20 + kNumRows, TabletCount());
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(20 + kNumRows, TabletCount());
+}
+
+class TabletRowCacheTest : public TabletTestBase<StringKeyTestSetup> {
+ public:
+  void SetUp() override {
+    // The tablet picks up the row cache when it's created.
+    FLAGS_row_cache_capacity_mb = 16;
+    TabletTestBase::SetUp();
+  }
+
+ protected:
+  // Looks up the rows with keys 0 to 'num_keys' - 1, returning the
+  // stringified rows found, or "absent".
+  vector<string> GetRows(int num_keys) {
+    vector<string> encoded_keys;
+    for (int i = 0; i < num_keys; i++) {
+      KuduPartialRow row(&client_schema_);
+      setup_.BuildRowKey(&row, i);
+      encoded_keys.push_back(row.ToEncodedRowKeyOrDie());
+    }
+    vector<Slice> keys(encoded_keys.begin(), encoded_keys.end());
+    Arena arena(1024);
+    RowBlock block(client_schema_, num_keys, &arena);
+    CHECK_OK(tablet()->GetRows(client_schema_, keys, &block));
+    vector<string> rows;
+    for (int i = 0; i < num_keys; i++) {
+      rows.push_back(block.selection_vector()->IsRowSelected(i) ?
+                     client_schema_.DebugRow(block.row(i)) : "absent");
+    }
+    return rows;
+  }
+};
+
+TEST_F(TabletRowCacheTest, TestGetRowsWithRowCache) {
+  const int kNumRows = 10;
+  InsertTestRows(0, kNumRows, 0);
+  ASSERT_OK(tablet()->Flush());
+
+  shared_ptr<MemTracker> cache_tracker;
+  ASSERT_TRUE(MemTracker::FindTracker("row-cache-sharded_lru_cache", &cache_tracker));
+  const int64_t initial_consumption = cache_tracker->consumption();
+  vector<string> expected;
+  for (int i = 0; i < kNumRows; i++) {
+    expected.push_back(setup_.FormatDebugRow(i, 0, false));
+  }
+  ASSERT_EQ(expected, GetRows(kNumRows));
+  ASSERT_GT(cache_tracker->consumption(), initial_consumption);
+
+  // Cached rows are returned until they're mutated, whether they're
+  // updated, deleted, or deleted and reinserted.
+  ASSERT_EQ(expected, GetRows(kNumRows));
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  ASSERT_OK(UpdateTestRow(&writer, 2, 100));
+  ASSERT_OK(DeleteTestRow(&writer, 4));
+  ASSERT_OK(DeleteTestRow(&writer, 6));
+  ASSERT_OK(InsertTestRow(&writer, 6, 200));
+  expected[2] = setup_.FormatDebugRow(2, 100, true);
+  expected[4] = "absent";
+  expected[6] = setup_.FormatDebugRow(6, 200, false);
+  ASSERT_EQ(expected, GetRows(kNumRows));
+  ASSERT_EQ(expected, GetRows(kNumRows));
+
+  // Flushes and compactions don't change the rows.
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(expected, GetRows(kNumRows));
+}
+
 } // namespace tablet
 } // namespace kudu
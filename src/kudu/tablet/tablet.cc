@@ -42,6 +42,7 @@
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
@@ -50,7 +51,11 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/casts.h"
@@ -59,11 +64,15 @@
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/threading/thread_collision_warner.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/compaction_policy.h"
 #include "kudu/tablet/delta_tracker.h"
+#include "kudu/tablet/diff_scan.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/memrowset.h"
+#include "kudu/tablet/mutation.h"
+#include "kudu/tablet/row_cache.h"
 #include "kudu/tablet/row_op.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -84,11 +93,13 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/throttler.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
@@ -97,6 +108,24 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_string(tablet_compaction_policy, "budgeted",
+              "The policy which picks the rowsets to compact together. 'budgeted' "
+              "compacts the overlapping rowsets which most reduce the average "
+              "rowset height within the compaction budget. 'size_tiered' merges "
+              "rowsets of similar sizes regardless of their overlap, which bounds "
+              "the number of rowsets of append-mostly tables.");
+TAG_FLAG(tablet_compaction_policy, experimental);
+
+static bool ValidateCompactionPolicy(const char* flag_name, const std::string& flag_value) {
+  if (flag_value == "budgeted" || flag_value == "size_tiered") {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for --" << flag_name << ": " << flag_value
+             << " (expected 'budgeted' or 'size_tiered')";
+  return false;
+}
+DEFINE_validator(tablet_compaction_policy, &ValidateCompactionPolicy);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -163,6 +192,29 @@ DEFINE_bool(enable_undo_delta_block_gc, true,
     "To change what is considered ancient history use --tablet_history_max_age_sec");
 TAG_FLAG(enable_undo_delta_block_gc, evolving);
 
+DEFINE_int32(undo_delta_block_gc_max_blocks_per_run, 0,
+             "The number of undo delta blocks after which a single run of the undo "
+             "delta block GC maintenance op stops GCing further rowsets of a tablet. "
+             "Rowsets with the most ancient undo data are GCed first, and the "
+             "remainder is left for later runs. The metadata is flushed, and the "
+             "blocks deleted, once per run. If 0, there's no limit.");
+TAG_FLAG(undo_delta_block_gc_max_blocks_per_run, advanced);
+TAG_FLAG(undo_delta_block_gc_max_blocks_per_run, runtime);
+
+DEFINE_int32(tablet_scan_parallelism, 1,
+             "Maximum number of threads with which a single unordered tablet scan "
+             "reads its rowsets. Scans only run in parallel on tablet servers, "
+             "using the scanners' shared thread pool. 1 disables parallel scans.");
+TAG_FLAG(tablet_scan_parallelism, experimental);
+TAG_FLAG(tablet_scan_parallelism, runtime);
+
+DEFINE_int32(tablet_compaction_max_partitions, 1,
+             "Maximum number of key range partitions which a rowset compaction is "
+             "split into. The partitions are merged and written in parallel, each "
+             "into its own output rowsets. 1 disables parallel compactions.");
+TAG_FLAG(tablet_compaction_max_partitions, experimental);
+TAG_FLAG(tablet_compaction_max_partitions, runtime);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -170,6 +222,12 @@ METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
 METRIC_DEFINE_gauge_size(tablet, on_disk_data_size, "Tablet Data Size On Disk",
                          kudu::MetricUnit::kBytes,
                          "Space used by this tablet's data blocks.");
+METRIC_DEFINE_gauge_double(tablet, compaction_write_amplification,
+                           "Compaction Write Amplification",
+                           kudu::MetricUnit::kUnits,
+                           "Ratio between the bytes written by the flushes and compactions "
+                           "of this tablet and the bytes flushed from its MemRowSets and "
+                           "bulk loads.");
 
 using kudu::MaintenanceManager;
 using kudu::clock::HybridClock;
@@ -178,6 +236,7 @@ using std::ostream;
 using std::pair;
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
 using strings::Substitute;
@@ -189,7 +248,14 @@ struct IteratorStats;
 
 namespace tablet {
 
+// The number of rows appended to the DiskRowSet writer at a time by
+// BulkLoadSortedRows().
+static const int kBulkLoadBlockNumRows = 100;
+
 static CompactionPolicy *CreateCompactionPolicy() {
+  if (FLAGS_tablet_compaction_policy == "size_tiered") {
+    return new SizeTieredCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
@@ -216,6 +282,8 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     mem_trackers_(tablet_id(), parent_mem_tracker),
     next_mrs_id_(0),
     clock_(clock),
+    row_cache_(RowCache::GetSingleton()),
+    row_cache_invalidations_(0),
     rowsets_flush_sem_(1),
     state_(kInitialized) {
       CHECK(schema()->has_column_ids());
@@ -235,6 +303,9 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     METRIC_on_disk_data_size.InstantiateFunctionGauge(
       metric_entity_, Bind(&Tablet::OnDiskDataSize, Unretained(this)))
       ->AutoDetach(&metric_detacher_);
+    METRIC_compaction_write_amplification.InstantiateFunctionGauge(
+      metric_entity_, Bind(&Tablet::CompactionWriteAmplification, Unretained(this)))
+      ->AutoDetach(&metric_detacher_);
   }
 
   if (FLAGS_tablet_throttler_rpc_per_sec > 0 || FLAGS_tablet_throttler_bytes_per_sec > 0) {
@@ -375,16 +446,172 @@ Status Tablet::NewRowIterator(const Schema &projection,
 Status Tablet::NewRowIterator(const Schema &projection,
                               const MvccSnapshot &snap,
                               const OrderMode order,
-                              gscoped_ptr<RowwiseIterator> *iter) const {
+                              gscoped_ptr<RowwiseIterator> *iter,
+                              ThreadPool* scan_pool) const {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   if (metrics_) {
     metrics_->scans_started->Increment();
   }
   VLOG_WITH_PREFIX(2) << "Created new Iterator under snap: " << snap.ToString();
-  iter->reset(new Iterator(this, projection, snap, order));
+  iter->reset(new Iterator(this, projection, snap, order, scan_pool));
+  return Status::OK();
+}
+
+Status Tablet::NewDiffScanIterator(const Schema& projection,
+                                   Timestamp start,
+                                   Timestamp end,
+                                   gscoped_ptr<RowwiseIterator>* iter) const {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  if (PREDICT_FALSE(start > end)) {
+    return Status::InvalidArgument(
+        Substitute("diff scan start timestamp $0 is after its end timestamp $1",
+                   start.ToString(), end.ToString()));
+  }
+  if (metrics_) {
+    metrics_->scans_started->Increment();
+  }
+  iter->reset(new DiffScanIterator(this, projection, start, end));
+  return Status::OK();
+}
+
+Status Tablet::GetRows(const Schema& projection,
+                       const vector<Slice>& encoded_keys,
+                       RowBlock* dst) const {
+  TRACE_EVENT1("tablet", "Tablet::GetRows", "num_keys", encoded_keys.size());
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  DCHECK_GE(dst->row_capacity(), encoded_keys.size());
+  dst->Resize(encoded_keys.size());
+  dst->selection_vector()->SetAllFalse();
+
+  const uint32_t schema_version = metadata_->schema_version();
+  const Schema* cur_schema = schema();
+  Schema mapped_projection;
+  RETURN_NOT_OK(cur_schema->GetMappedReadProjection(projection, &mapped_projection));
+
+  // A row read may only be cached if every write which could have changed it
+  // is either in the snapshot or invalidates the cache after this point: so,
+  // no write may be in flight yet, nor the schema have been altered since its
+  // version was read.
+  const uint64_t cache_invalidations = row_cache_invalidations_.load();
+  const bool use_cache = row_cache_ && schema_version == metadata_->schema_version();
+  const bool may_fill_cache = use_cache && mvcc_.CountTransactionsInFlight() == 0;
+
+  // Like a scan, read the components after taking the snapshot, so that a
+  // concurrent flush can't hide rows committed before it.
+  MvccSnapshot snap(mvcc_);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // To fill the cache, whole rows are read and then projected.
+  const Schema& read_schema = may_fill_cache ? *cur_schema : mapped_projection;
+  vector<int> read_idxs(mapped_projection.num_columns());
+  for (int col = 0; col < mapped_projection.num_columns(); col++) {
+    read_idxs[col] = read_schema.find_column_by_id(mapped_projection.column_id(col));
+    DCHECK_NE(Schema::kColumnNotFound, read_idxs[col]);
+  }
+
+  Arena arena(1024);
+  Arena row_arena(1024);
+  RowBlock scratch(read_schema, 1, &row_arena);
+  vector<RowSet*> rowsets;
+  ProbeStats stats;
+  for (int i = 0; i < encoded_keys.size(); i++) {
+    arena.Reset();
+    row_arena.Reset();
+
+    // Decode the key into a row of the key columns, to probe the rowsets with.
+    gscoped_ptr<EncodedKey> key;
+    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(key_schema_, &arena,
+                                                          encoded_keys[i], &key),
+                          "invalid primary key");
+    uint8_t* key_data = static_cast<uint8_t*>(arena.AllocateBytes(key_schema_.byte_size()));
+    if (PREDICT_FALSE(key_data == nullptr)) {
+      return Status::RuntimeError("unable to allocate a key row");
+    }
+    ContiguousRow key_row(&key_schema_, key_data);
+    for (int col = 0; col < key_schema_.num_columns(); col++) {
+      memcpy(key_row.mutable_cell_ptr(col), key->raw_keys()[col],
+             key_schema_.column(col).type_info()->size());
+    }
+    RowSetKeyProbe probe((ConstContiguousRow(key_row)));
+
+    string cache_key;
+    if (use_cache) {
+      cache_key = RowCache::MakeKey(tablet_id(), schema_version, probe.encoded_key_slice());
+      RowBlockRow dst_row = dst->row(i);
+      if (row_cache_->Lookup(cache_key, *cur_schema, mapped_projection, &dst_row, dst->arena())) {
+        dst->selection_vector()->SetRowSelected(i);
+        continue;
+      }
+    }
+
+    // Restrict the reads to the key. If it's the greatest possible key,
+    // leave the upper bound open.
+    ScanSpec spec;
+    spec.SetLowerBoundKey(&probe.encoded_key());
+    gscoped_ptr<EncodedKey> upper_bound(EncodedKey::FromContiguousRow(probe.row_key()));
+    if (EncodedKey::IncrementEncodedKey(key_schema_, &upper_bound, &arena).ok()) {
+      spec.SetExclusiveUpperBoundKey(upper_bound.get());
+    }
+
+    // Only one rowset may hold a version of the row which is visible in the
+    // snapshot, so stop at the first one found.
+    rowsets.clear();
+    rowsets.push_back(comps->memrowset.get());
+    comps->rowsets->FindRowSetsWithKeyInRange(probe.encoded_key_slice(), &rowsets);
+    bool found = false;
+    for (const RowSet* rs : rowsets) {
+      bool may_be_present;
+      RETURN_NOT_OK(rs->CheckKeyMayBePresent(probe, &may_be_present, &stats));
+      if (!may_be_present) {
+        continue;
+      }
+      gscoped_ptr<RowwiseIterator> iter;
+      RETURN_NOT_OK(rs->NewRowIterator(&read_schema, snap, UNORDERED, &iter));
+      RETURN_NOT_OK(iter->Init(&spec));
+      while (!found && iter->HasNext()) {
+        RETURN_NOT_OK(iter->NextBlock(&scratch));
+        found = scratch.nrows() == 1 && scratch.selection_vector()->IsRowSelected(0);
+      }
+      if (found) {
+        break;
+      }
+    }
+    if (!found) {
+      continue;
+    }
+
+    RowBlockRow src_row = scratch.row(0);
+    RowBlockRow dst_row = dst->row(i);
+    for (int col = 0; col < mapped_projection.num_columns(); col++) {
+      RowBlockRow::Cell dst_cell = dst_row.cell(col);
+      RETURN_NOT_OK(CopyCell(src_row.cell(read_idxs[col]), &dst_cell, dst->arena()));
+    }
+    dst->selection_vector()->SetRowSelected(i);
+
+    if (may_fill_cache) {
+      row_cache_->Insert(cache_key, src_row);
+      // A write which mutated the row concurrently may have erased it from
+      // the cache before it was inserted.
+      if (PREDICT_FALSE(row_cache_invalidations_.load() != cache_invalidations)) {
+        row_cache_->Erase(cache_key);
+      }
+    }
+  }
   return Status::OK();
 }
 
+void Tablet::InvalidateCachedRow(const RowOp& op) {
+  if (!row_cache_) {
+    return;
+  }
+  // Count the invalidation before erasing the row, so that a concurrent
+  // GetRows() either sees the count change or has the row it cached erased.
+  row_cache_invalidations_.fetch_add(1);
+  row_cache_->Erase(RowCache::MakeKey(tablet_id(), metadata_->schema_version(),
+                                      op.key_probe->encoded_key_slice()));
+}
+
 Status Tablet::DecodeWriteOperations(const Schema* client_schema,
                                      WriteTransactionState* tx_state) {
   TRACE_EVENT0("tablet", "Tablet::DecodeWriteOperations");
@@ -397,11 +624,12 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
 
   // The Schema needs to be held constant while any transactions are between
   // PREPARE and APPLY stages
-  TRACE("PREPARE: Decoding operations");
+  TRACE_BINARY("PREPARE: Decoding operations");
   vector<DecodedRowOperation> ops;
 
   // Decode the ops
-  RowOperationsPBDecoder dec(&tx_state->request()->row_operations(),
+  RowOperationsPBDecoder dec(tx_state->rows_data(),
+                             tx_state->indirect_data(),
                              client_schema,
                              schema(),
                              tx_state->arena());
@@ -419,11 +647,24 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
 Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
-  TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
-  for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
-  }
-  TRACE("PREPARE: locks acquired");
+  TRACE_BINARY("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
+  const auto& row_ops = tx_state->row_ops();
+  vector<Slice> keys;
+  keys.reserve(row_ops.size());
+  for (RowOp* op : row_ops) {
+    ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
+    op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
+    RETURN_NOT_OK(CheckRowInTablet(row_key));
+    keys.push_back(op->key_probe->encoded_key_slice());
+  }
+  // Lock all of the rows at once, which is cheaper than one at a time.
+  vector<ScopedRowLock> row_locks;
+  ScopedRowLock::AcquireBatch(&lock_manager_, tx_state, keys,
+                              LockManager::LOCK_EXCLUSIVE, &row_locks);
+  for (int i = 0; i < row_ops.size(); i++) {
+    row_ops[i]->row_lock = std::move(row_locks[i]);
+  }
+  TRACE_BINARY("PREPARE: locks acquired");
   return Status::OK();
 }
 
@@ -573,7 +814,8 @@ Status Tablet::ValidateMutateUnlocked(const RowOp& op) const {
 
 Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
                                       RowOp* op,
-                                      ProbeStats* stats) {
+                                      ProbeStats* stats,
+                                      MemRowSetInsertHint* mrs_hint) {
   DCHECK(op->checked_present);
   DCHECK(op->validated);
 
@@ -600,7 +842,7 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
 
   // Now try to op into memrowset. The memrowset itself will return
   // AlreadyPresent if it has already been oped there.
-  Status s = comps->memrowset->Insert(ts, row, tx_state->op_id());
+  Status s = comps->memrowset->Insert(ts, row, tx_state->op_id(), mrs_hint);
   if (s.ok()) {
     op->SetInsertSucceeded(comps->memrowset->mrs_id());
   } else {
@@ -621,6 +863,7 @@ Status Tablet::ApplyUpsertAsUpdate(WriteTransactionState* tx_state,
                                    RowOp* upsert,
                                    RowSet* rowset,
                                    ProbeStats* stats) {
+  InvalidateCachedRow(*upsert);
   const auto* schema = this->schema();
   ConstContiguousRow row(schema, upsert->decoded_op.row_data);
   faststring buf;
@@ -712,6 +955,7 @@ Status Tablet::MutateRowUnlocked(WriteTransactionState *tx_state,
                                  ProbeStats* stats) {
   DCHECK(mutate->checked_present);
   DCHECK(mutate->validated);
+  InvalidateCachedRow(*mutate);
 
   gscoped_ptr<OperationResultPB> result(new OperationResultPB());
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
@@ -801,65 +1045,52 @@ Status Tablet::BulkCheckPresence(WriteTransactionState* tx_state) {
   }
 
   // Actually perform the presence checks. We use the "bulk query" functionality
-  // provided by RowSetTree::ForEachRowSetContainingKeys(), which yields results
-  // via a callback, with grouping guarantees that callbacks for the same RowSet
-  // will be grouped together with increasing query keys.
-  //
-  // We want to process each such "group" (set of subsequent calls for the same
-  // RowSet) one at a time. So, the callback itself aggregates results into
-  // 'pending_group' and then calls 'ProcessPendingGroup' when the next group
-  // begins.
-  vector<pair<RowSet*, int>> pending_group;
-  Status s;
-  const auto& ProcessPendingGroup = [&]() {
-    if (pending_group.empty() || !s.ok()) return;
-    // Check invariant of the batch RowSetTree query: within each output group
-    // we should have fully-sorted keys.
-    DCHECK(std::is_sorted(pending_group.begin(), pending_group.end(),
-                          [&](const pair<RowSet*, int>& a,
-                              const pair<RowSet*, int>& b) {
-                            auto s_a = keys[a.second];
-                            auto s_b = keys[b.second];
-                            return s_a.compare(s_b) < 0;
-                          }));
-    RowSet* rs = pending_group[0].first;
-    for (auto it = pending_group.begin();
-         it != pending_group.end();
-         ++it) {
-      DCHECK_EQ(it->first, rs) << "All results within a group should be for the same RowSet";
-      int op_idx = keys_and_indexes[it->second].second;
+  // provided by RowSetTree::FindRowSetsIntersectingKeys(), which groups the
+  // keys by RowSet, in increasing order within each group. Each group is then
+  // checked against its RowSet with a single batch query, which lets the
+  // RowSet probe its bloom filter for all of the keys at once.
+  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
+  vector<RowSetTree::RowSetKeyGroup> groups;
+  comps->rowsets->FindRowSetsIntersectingKeys(keys, &groups);
+
+  vector<const RowSetKeyProbe*> probes;
+  vector<ProbeStats*> probe_stats;
+  vector<RowOp*> probe_ops;
+  probes.reserve(keys.size());
+  probe_stats.reserve(keys.size());
+  probe_ops.reserve(keys.size());
+  unique_ptr<bool[]> present(new bool[keys.size()]);
+  for (const auto& group : groups) {
+    RowSet* rs = group.first;
+    probes.clear();
+    probe_stats.clear();
+    probe_ops.clear();
+    for (int key_idx : group.second) {
+      int op_idx = keys_and_indexes[key_idx].second;
       RowOp* op = row_ops_base[op_idx];
       if (op->present_in_rowset) {
         // Already found this op present somewhere.
         continue;
       }
-
-      bool present = false;
-      s = rs->CheckRowPresent(*op->key_probe, &present, tx_state->mutable_op_stats(op_idx));
-      if (PREDICT_FALSE(!s.ok())) {
-        LOG(WARNING) << Substitute("Tablet $0 failed to check row presence for op $1: $2",
-            tablet_id(), op->ToString(key_schema_), s.ToString());
-        return;
-      }
-      if (present) {
-        op->present_in_rowset = rs;
+      probes.push_back(op->key_probe.get());
+      probe_stats.push_back(tx_state->mutable_op_stats(op_idx));
+      probe_ops.push_back(op);
+    }
+    if (probes.empty()) continue;
+
+    Status s = rs->CheckRowsPresent(probes.data(), probes.size(), present.get(),
+                                    probe_stats.data());
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << Substitute("Tablet $0 failed to check row presence in $1: $2",
+                                 tablet_id(), rs->ToString(), s.ToString());
+      return s.CloneAndPrepend("Error while checking presence of rows");
+    }
+    for (int i = 0; i < probe_ops.size(); i++) {
+      if (present[i]) {
+        probe_ops[i]->present_in_rowset = rs;
       }
     }
-    pending_group.clear();
-  };
-
-  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
-  comps->rowsets->ForEachRowSetContainingKeys(
-      keys,
-      [&](RowSet* rs, int i) {
-        if (!pending_group.empty() && rs != pending_group.back().first) {
-          ProcessPendingGroup();
-        }
-        pending_group.emplace_back(rs, i);
-      });
-  // Process the last group.
-  ProcessPendingGroup();
-  RETURN_NOT_OK_PREPEND(s, "Error while checking presence of rows");
+  }
 
   // Mark all of the ops as having been checked.
   // TODO(todd): this could potentially be weaved into the std::unique() call up
@@ -895,12 +1126,31 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
 
   RETURN_NOT_OK(BulkCheckPresence(tx_state));
 
-  // Actually apply the ops.
+  // Actually apply the ops, in the order of their keys, so that consecutive
+  // inserts into the MemRowSet mostly go into the same btree leaf node and
+  // can share its traversal. Ops on different keys don't affect each other,
+  // and the stable sort keeps the ops on the same key in the order they were
+  // specified.
+  const auto& row_ops = tx_state->row_ops();
+  vector<int> op_order;
+  op_order.reserve(num_ops);
   for (int op_idx = 0; op_idx < num_ops; op_idx++) {
-    RowOp* row_op = tx_state->row_ops()[op_idx];
-    if (row_op->has_result()) continue;
-
-    RETURN_NOT_OK(ApplyRowOperation(tx_state, row_op, tx_state->mutable_op_stats(op_idx)));
+    if (!row_ops[op_idx]->has_result()) {
+      op_order.push_back(op_idx);
+    }
+  }
+  const auto& KeyLess = [&](int a, int b) {
+    return row_ops[a]->key_probe->encoded_key_slice().compare(
+        row_ops[b]->key_probe->encoded_key_slice()) < 0;
+  };
+  if (!std::is_sorted(op_order.begin(), op_order.end(), KeyLess)) {
+    std::stable_sort(op_order.begin(), op_order.end(), KeyLess);
+  }
+  MemRowSetInsertHint mrs_hint;
+  for (int op_idx : op_order) {
+    RowOp* row_op = row_ops[op_idx];
+    RETURN_NOT_OK(ApplyRowOperation(tx_state, row_op, tx_state->mutable_op_stats(op_idx),
+                                    &mrs_hint));
     DCHECK(row_op->has_result());
   }
 
@@ -912,7 +1162,8 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
 
 Status Tablet::ApplyRowOperation(WriteTransactionState* tx_state,
                                  RowOp* row_op,
-                                 ProbeStats* stats) {
+                                 ProbeStats* stats,
+                                 MemRowSetInsertHint* mrs_hint) {
   {
     std::lock_guard<simple_spinlock> l(state_lock_);
     RETURN_NOT_OK_PREPEND(CheckHasNotBeenStoppedUnlocked(),
@@ -948,7 +1199,7 @@ Status Tablet::ApplyRowOperation(WriteTransactionState* tx_state,
   switch (row_op->decoded_op.type) {
     case RowOperationsPB::INSERT:
     case RowOperationsPB::UPSERT:
-      s = InsertOrUpsertUnlocked(tx_state, row_op, stats);
+      s = InsertOrUpsertUnlocked(tx_state, row_op, stats, mrs_hint);
       if (s.IsAlreadyPresent()) {
         return Status::OK();
       }
@@ -972,35 +1223,9 @@ void Tablet::ModifyRowSetTree(const RowSetTree& old_tree,
                               const RowSetVector& rowsets_to_remove,
                               const RowSetVector& rowsets_to_add,
                               RowSetTree* new_tree) {
-  RowSetVector post_swap;
-
-  // O(n^2) diff algorithm to collect the set of rowsets excluding
-  // the rowsets that were included in the compaction
-  int num_removed = 0;
-
-  for (const shared_ptr<RowSet> &rs : old_tree.all_rowsets()) {
-    // Determine if it should be removed
-    bool should_remove = false;
-    for (const shared_ptr<RowSet> &to_remove : rowsets_to_remove) {
-      if (to_remove == rs) {
-        should_remove = true;
-        num_removed++;
-        break;
-      }
-    }
-    if (!should_remove) {
-      post_swap.push_back(rs);
-    }
-  }
-
-  CHECK_EQ(num_removed, rowsets_to_remove.size());
-
-  // Then push the new rowsets on the end of the new list
-  std::copy(rowsets_to_add.begin(),
-            rowsets_to_add.end(),
-            std::back_inserter(post_swap));
-
-  CHECK_OK(new_tree->Reset(post_swap));
+  // The new tree shares the bounds of the rowsets which didn't change with
+  // 'old_tree', so that the swap costs little when few rowsets changed.
+  CHECK_OK(new_tree->Reset(old_tree, rowsets_to_remove, rowsets_to_add));
 }
 
 void Tablet::AtomicSwapRowSets(const RowSetVector &old_rowsets,
@@ -1052,10 +1277,15 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
 
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
-  if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
-    return HistoryGcOpts::Enabled(ancient_history_mark);
+  HistoryGcOpts opts = GetTabletAncientHistoryMark(&ancient_history_mark) ?
+      HistoryGcOpts::Enabled(ancient_history_mark) : HistoryGcOpts::Disabled();
+  const Schema* s = schema();
+  const int ttl_col_idx = s->find_ttl_column();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    const int64_t ttl_micros = s->column(ttl_col_idx).attributes().ttl_seconds * 1000000;
+    return opts.WithRowExpiry(s->column_id(ttl_col_idx), GetCurrentTimeMicros() - ttl_micros);
   }
-  return HistoryGcOpts::Disabled();
+  return opts;
 }
 
 Status Tablet::Flush() {
@@ -1164,6 +1394,148 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
   return Status::OK();
 }
 
+Status Tablet::BulkLoadSortedRows(const Schema* client_schema, const RowOperationsPB& ops) {
+  TRACE_EVENT1("tablet", "Tablet::BulkLoadSortedRows", "id", tablet_id());
+  RETURN_NOT_OK(CheckHasNotBeenStopped());
+
+  // The row locks are released after the transaction, which is committed or
+  // aborted when 'tx_state' is destroyed.
+  vector<ScopedRowLock> row_locks;
+  tserver::WriteRequestPB req;
+  WriteTransactionState tx_state(nullptr, &req, nullptr);
+
+  // Hold the schema constant until the rows are visible.
+  tx_state.AcquireSchemaLock(&schema_lock_);
+  vector<DecodedRowOperation> decoded_ops;
+  RowOperationsPBDecoder dec(&ops, client_schema, schema(), tx_state.arena());
+  RETURN_NOT_OK(dec.DecodeOperations(&decoded_ops));
+  if (decoded_ops.empty()) {
+    return Status::OK();
+  }
+
+  // Check that the rows belong to this tablet and are sorted, and lock them so
+  // that no concurrent write may insert the same keys.
+  vector<unique_ptr<RowSetKeyProbe>> probes;
+  probes.reserve(decoded_ops.size());
+  row_locks.reserve(decoded_ops.size());
+  for (const DecodedRowOperation& op : decoded_ops) {
+    if (PREDICT_FALSE(op.type != RowOperationsPB::INSERT)) {
+      return Status::InvalidArgument("only INSERT operations may be bulk loaded",
+                                     op.ToString(*schema()));
+    }
+    ConstContiguousRow row_key(&key_schema_, op.row_data);
+    RETURN_NOT_OK(CheckRowInTablet(row_key));
+    probes.emplace_back(new RowSetKeyProbe(row_key));
+    if (PREDICT_FALSE(probes.size() > 1 &&
+                      probes[probes.size() - 2]->encoded_key_slice().compare(
+                          probes.back()->encoded_key_slice()) >= 0)) {
+      return Status::InvalidArgument("bulk loaded rows must be sorted by primary key "
+                                     "without duplicates",
+                                     KUDU_REDACT(key_schema_.DebugRowKey(row_key)));
+    }
+    row_locks.emplace_back(&lock_manager_, &tx_state,
+                           probes.back()->encoded_key_slice(),
+                           LockManager::LOCK_EXCLUSIVE);
+  }
+
+  // Check that none of the rows are present. The keys are sorted, so all of the
+  // probes of a rowset are done in a single sweep, and only the rowsets whose
+  // key ranges overlap the keys are probed. Since the rows are locked, a
+  // concurrent flush or compaction may move rows around but can't make any of
+  // these keys present.
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  {
+    vector<Slice> keys;
+    keys.reserve(probes.size());
+    for (const auto& probe : probes) {
+      keys.push_back(probe->encoded_key_slice());
+    }
+    ProbeStats stats;
+    Status s;
+    const auto& CheckAbsent = [&](const RowSet* rs, int i) {
+      if (!s.ok()) return;
+      bool present = false;
+      s = rs->CheckRowPresent(*probes[i], &present, &stats);
+      if (s.ok() && present) {
+        s = Status::AlreadyPresent("key already present",
+                                   KUDU_REDACT(key_schema_.DebugRowKey(probes[i]->row_key())));
+      }
+    };
+    comps->rowsets->ForEachRowSetContainingKeys(keys, CheckAbsent);
+    if (!comps->memrowset->empty()) {
+      for (int i = 0; i < probes.size() && s.ok(); i++) {
+        CheckAbsent(comps->memrowset.get(), i);
+      }
+    }
+    RETURN_NOT_OK(s);
+  }
+
+  // Write the rows out, with an UNDO delete at the load timestamp so that
+  // older snapshots don't see them.
+  tx_state.set_timestamp(clock_->Now());
+  StartTransaction(&tx_state);
+
+  RollingDiskRowSetWriter drsw(metadata_.get(), *schema(), DefaultBloomSizing(),
+                               compaction_policy_->target_rowset_size(),
+                               fs::StorageTier::FAST);
+  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for bulk load");
+  faststring undo_buf;
+  RowChangeListEncoder undo_encoder(&undo_buf);
+  undo_encoder.SetToDelete();
+  Mutation* undo_delete = Mutation::CreateInArena(tx_state.arena(), tx_state.timestamp(),
+                                                  undo_encoder.as_changelist());
+  RowBlock block(*schema(), kBulkLoadBlockNumRows, nullptr);
+  int n = 0;
+  for (const DecodedRowOperation& op : decoded_ops) {
+    RETURN_NOT_OK(drsw.RollIfNecessary());
+    RowBlockRow dst_row = block.row(n);
+    RETURN_NOT_OK(CopyRow(ConstContiguousRow(schema(), op.row_data), &dst_row,
+                          static_cast<Arena*>(nullptr)));
+    rowid_t index_in_current_drs;
+    RETURN_NOT_OK(drsw.AppendUndoDeltas(n, undo_delete, &index_in_current_drs));
+    if (++n == block.nrows()) {
+      RETURN_NOT_OK(drsw.AppendBlock(block));
+      n = 0;
+    }
+  }
+  if (n > 0) {
+    block.Resize(n);
+    RETURN_NOT_OK(drsw.AppendBlock(block));
+  }
+  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+
+  RowSetMetadataVector new_drs_metas;
+  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  RowSetVector new_disk_rowsets;
+  for (const shared_ptr<RowSetMetadata>& meta : new_drs_metas) {
+    shared_ptr<DiskRowSet> new_rowset;
+    RETURN_NOT_OK_PREPEND(DiskRowSet::Open(meta,
+                                           log_anchor_registry_.get(),
+                                           mem_trackers_,
+                                           &new_rowset),
+                          Substitute("Unable to open bulk loaded rowset $0",
+                                     meta->ToString()));
+    new_disk_rowsets.push_back(new_rowset);
+  }
+  RETURN_NOT_OK_PREPEND(FlushMetadata({}, new_drs_metas, TabletMetadata::kNoMrsFlushed),
+                        "Failed to flush new tablet metadata");
+
+  // Make the rows visible.
+  tx_state.StartApplying();
+  AtomicSwapRowSets({}, new_disk_rowsets);
+  tx_state.CommitOrAbort(Transaction::COMMITTED);
+
+  if (metrics_) {
+    metrics_->rows_inserted->IncrementBy(decoded_ops.size());
+    metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  }
+  LOG_WITH_PREFIX(INFO) << "Bulk loaded " << drsw.written_count() << " rows ("
+                        << drsw.written_size() << " bytes) into "
+                        << new_disk_rowsets.size() << " rowsets";
+  return Status::OK();
+}
+
 Status Tablet::CreatePreparedAlterSchema(AlterSchemaTransactionState *tx_state,
                                          const Schema* schema) {
 
@@ -1449,17 +1821,67 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                           "PostTakeMvccSnapshot hook failed");
   }
 
-  shared_ptr<CompactionInput> merge;
-  RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
+  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
 
-  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), DefaultBloomSizing(),
-                               compaction_policy_->target_rowset_size());
-  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
+  // Compactions of rowsets whose key ranges don't overlap copy the data
+  // blocks of the columns they leave unchanged. Other compactions may be
+  // split into key ranges which are merged in parallel. Flushes are neither,
+  // since the MemRowSet can't be read by key range.
+  vector<shared_ptr<DiskRowSet>> disjoint_rowsets;
+  vector<bool> encoded_cols;
+  vector<string> split_keys;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) {
+    RETURN_NOT_OK_PREPEND(ChooseEncodedColumns(input.rowsets(), *schema(), history_gc_opts,
+                                               &disjoint_rowsets, &encoded_cols),
+                          "Failed to choose the columns to copy");
+    if (encoded_cols.empty()) {
+      RETURN_NOT_OK_PREPEND(input.ChooseSplitKeys(FLAGS_tablet_compaction_max_partitions,
+                                                  &split_keys),
+                            "Failed to choose the compaction partitions");
+    }
+  }
 
-  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw),
-                        "Flush to disk failed");
-  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+  // The output rowsets of all of the writers, in key order.
+  vector<unique_ptr<RollingDiskRowSetWriter>> drsws;
+  shared_ptr<CompactionInput> merge;
+  if (!encoded_cols.empty()) {
+    drsws.emplace_back(new RollingDiskRowSetWriter(metadata_.get(), *schema(),
+                                                   DefaultBloomSizing(),
+                                                   compaction_policy_->target_rowset_size(),
+                                                   fs::StorageTier::SLOW));
+    RollingDiskRowSetWriter* drsw = drsws.back().get();
+    drsw->SetEncodedColumns(encoded_cols);
+    RETURN_NOT_OK_PREPEND(drsw->Open(), "Failed to open DiskRowSet for flush");
+    RETURN_NOT_OK_PREPEND(FlushDisjointRowSets(disjoint_rowsets, flush_snap, history_gc_opts,
+                                               encoded_cols, drsw),
+                          "Flush to disk failed");
+    RETURN_NOT_OK_PREPEND(drsw->Finish(), "Failed to finish DRS writer");
+  } else if (split_keys.empty()) {
+    RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
+
+    // Freshly flushed data is the most likely to be read, so it goes to the
+    // fast storage tier; compactions move the data they rewrite to the slow one.
+    const fs::StorageTier tier = mrs_being_flushed == TabletMetadata::kNoMrsFlushed ?
+        fs::StorageTier::SLOW : fs::StorageTier::FAST;
+    drsws.emplace_back(new RollingDiskRowSetWriter(metadata_.get(), merge->schema(),
+                                                   DefaultBloomSizing(),
+                                                   compaction_policy_->target_rowset_size(),
+                                                   tier));
+    RollingDiskRowSetWriter* drsw = drsws.back().get();
+    RETURN_NOT_OK_PREPEND(drsw->Open(), "Failed to open DiskRowSet for flush");
+    RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, drsw),
+                          "Flush to disk failed");
+    RETURN_NOT_OK_PREPEND(drsw->Finish(), "Failed to finish DRS writer");
+  } else {
+    RETURN_NOT_OK(FlushCompactionPartitions(input, flush_snap, history_gc_opts, split_keys,
+                                            &drsws));
+  }
+  int64_t written_count = 0;
+  size_t written_size = 0;
+  for (const auto& drsw : drsws) {
+    written_count += drsw->written_count();
+    written_size += drsw->written_size();
+  }
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostWriteSnapshot(),
@@ -1468,7 +1890,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
 
   // Though unlikely, it's possible that all of the input rows were actually
   // GCed in this compaction. In that case, we don't actually want to reopen.
-  bool gced_all_input = drsw.written_count() == 0;
+  bool gced_all_input = written_count == 0;
   if (gced_all_input) {
     LOG_WITH_PREFIX(INFO) << op_name << " resulted in no output rows (all input rows "
                           << "were GCed!)  Removing all input rowsets.";
@@ -1479,9 +1901,18 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // output. Open these into 'new_rowsets'.
   vector<shared_ptr<RowSet> > new_disk_rowsets;
   RowSetMetadataVector new_drs_metas;
-  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  for (const auto& drsw : drsws) {
+    RowSetMetadataVector metas;
+    drsw->GetWrittenRowSetMetadata(&metas);
+    new_drs_metas.insert(new_drs_metas.end(), metas.begin(), metas.end());
+  }
 
-  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  if (metrics_.get()) {
+    metrics_->bytes_flushed->IncrementBy(written_size);
+    if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) {
+      metrics_->compaction_bytes_written->IncrementBy(written_size);
+    }
+  }
   CHECK(!new_drs_metas.empty());
   {
     TRACE_EVENT0("tablet", "Opening compaction results");
@@ -1631,8 +2062,8 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // their metadata was written to disk.
   AtomicSwapRowSets({ inprogress_rowset }, new_disk_rowsets);
 
-  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << drsw.written_count()
-                        << " rows " << "(" << drsw.written_size() << " bytes)";
+  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << written_count
+                        << " rows " << "(" << written_size << " bytes)";
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostSwapNewRowSet(),
@@ -1642,6 +2073,72 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   return Status::OK();
 }
 
+Status Tablet::FlushCompactionPartitions(const RowSetsInCompaction& input,
+                                         const MvccSnapshot& snap,
+                                         const HistoryGcOpts& history_gc_opts,
+                                         const vector<string>& split_keys,
+                                         vector<unique_ptr<RollingDiskRowSetWriter>>* drsws) {
+  const int num_partitions = split_keys.size() + 1;
+  TRACE_EVENT1("tablet", "Tablet::FlushCompactionPartitions",
+               "num_partitions", num_partitions);
+  LOG_WITH_PREFIX(INFO) << "Compaction: merging " << num_partitions
+                        << " key range partitions in parallel";
+
+  Arena arena(1024);
+  vector<unique_ptr<EncodedKey>> bounds;
+  for (const string& split_key : split_keys) {
+    gscoped_ptr<EncodedKey> bound;
+    RETURN_NOT_OK(EncodedKey::DecodeEncodedString(*schema(), &arena, split_key, &bound));
+    bounds.emplace_back(bound.release());
+  }
+
+  vector<shared_ptr<CompactionInput>> merges(num_partitions);
+  for (int i = 0; i < num_partitions; i++) {
+    const EncodedKey* lower_bound = i == 0 ? nullptr : bounds[i - 1].get();
+    const EncodedKey* upper_bound = i == num_partitions - 1 ? nullptr : bounds[i].get();
+    RETURN_NOT_OK(input.CreateCompactionInput(snap, schema(), lower_bound, upper_bound,
+                                              &merges[i]));
+    drsws->emplace_back(new RollingDiskRowSetWriter(metadata_.get(), merges[i]->schema(),
+                                                    DefaultBloomSizing(),
+                                                    compaction_policy_->target_rowset_size(),
+                                                    fs::StorageTier::SLOW));
+    RETURN_NOT_OK_PREPEND(drsws->back()->Open(), "Failed to open DiskRowSet for compaction");
+  }
+
+  vector<Status> statuses(num_partitions);
+  const auto flush_partition = [&](int i) {
+    RollingDiskRowSetWriter* drsw = (*drsws)[i].get();
+    statuses[i] = FlushCompactionInput(merges[i].get(), snap, history_gc_opts, drsw);
+    if (statuses[i].ok()) {
+      statuses[i] = drsw->Finish();
+    }
+  };
+
+  // The first partition is merged on this thread.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("compaction")
+                .set_min_threads(0)
+                .set_max_threads(num_partitions - 1)
+                .Build(&pool));
+  const fs::IOPriority io_priority = fs::ScopedIOPriority::Current();
+  for (int i = 1; i < num_partitions; i++) {
+    Status s = pool->SubmitFunc([&flush_partition, i, io_priority]() {
+        fs::ScopedIOPriority p(io_priority);
+        flush_partition(i);
+      });
+    if (!s.ok()) {
+      statuses[i] = s;
+    }
+  }
+  flush_partition(0);
+  pool->Wait();
+
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK_PREPEND(s, "Flush to disk failed");
+  }
+  return Status::OK();
+}
+
 Status Tablet::HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
                                             int mrs_being_flushed) {
   // Write out the new Tablet Metadata and remove old rowsets.
@@ -1686,7 +2183,7 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
   // been in the last 5 minutes, and somehow scale the compaction quality
   // based on that, so we favor hot tablets.
   double quality = 0;
-  unordered_set<RowSet*> picked_set_ignored;
+  unordered_set<RowSet*> picked;
 
   shared_ptr<RowSetTree> rowsets_copy;
   {
@@ -1696,14 +2193,21 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   {
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored, &quality, NULL),
+    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked, &quality, NULL),
                 Substitute("Couldn't determine compaction quality for $0", tablet_id()));
   }
 
   VLOG_WITH_PREFIX(1) << "Best compaction for " << tablet_id() << ": " << quality;
 
+  // The compaction reads the picked rowsets and writes them out again.
+  int64_t io_bytes = 0;
+  for (const RowSet* rs : picked) {
+    io_bytes += 2 * rs->OnDiskBaseDataSizeWithRedos();
+  }
+
   stats->set_runnable(quality >= 0);
   stats->set_perf_improvement(quality);
+  stats->set_io_bytes(io_bytes);
 }
 
 
@@ -1729,19 +2233,38 @@ Status Tablet::CaptureConsistentIterators(
     const MvccSnapshot& snap,
     const ScanSpec* spec,
     OrderMode order,
-    vector<shared_ptr<RowwiseIterator>>* iters) const {
+    vector<IterWithBounds>* iters) const {
 
   shared_lock<rw_spinlock> l(component_lock_);
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
 
   // Construct all the iterators locally first, so that if we fail
   // in the middle, we don't modify the output arguments.
-  vector<shared_ptr<RowwiseIterator>> ret;
+  vector<IterWithBounds> ret;
 
   // Grab the memrowset iterator.
   gscoped_ptr<RowwiseIterator> ms_iter;
   RETURN_NOT_OK(components_->memrowset->NewRowIterator(projection, snap, order, &ms_iter));
-  ret.emplace_back(ms_iter.release());
+  ret.emplace_back(shared_ptr<RowwiseIterator>(ms_iter.release()));
+
+  // Creates an iterator for 'rs' and appends it to 'ret'. A MergeIterator
+  // uses the rowset's key bounds to avoid merging rowsets which do not
+  // overlap the scan's key range.
+  auto add_rowset_iter = [&](const RowSet* rs) -> Status {
+    gscoped_ptr<RowwiseIterator> row_it;
+    RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
+                          Substitute("Could not create iterator for rowset $0",
+                                     rs->ToString()));
+    IterWithBounds iter(shared_ptr<RowwiseIterator>(row_it.release()));
+    if (order == ORDERED) {
+      string min_key, max_key;
+      if (rs->GetBounds(&min_key, &max_key).ok()) {
+        iter.encoded_bounds = std::make_pair(std::move(min_key), std::move(max_key));
+      }
+    }
+    ret.emplace_back(std::move(iter));
+    return Status::OK();
+  };
 
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && spec->lower_bound_key() && spec->exclusive_upper_bound_key()) {
@@ -1755,11 +2278,7 @@ Status Tablet::CaptureConsistentIterators(
         spec->exclusive_upper_bound_key()->encoded_key(),
         &interval_sets);
     for (const RowSet *rs : interval_sets) {
-      gscoped_ptr<RowwiseIterator> row_it;
-      RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
-                            Substitute("Could not create iterator for rowset $0",
-                                       rs->ToString()));
-      ret.emplace_back(row_it.release());
+      RETURN_NOT_OK(add_rowset_iter(rs));
     }
     ret.swap(*iters);
     return Status::OK();
@@ -1768,11 +2287,7 @@ Status Tablet::CaptureConsistentIterators(
   // If there are no encoded predicates or they represent an open-ended range, then
   // fall back to grabbing all rowset iterators
   for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
-    gscoped_ptr<RowwiseIterator> row_it;
-    RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
-                          Substitute("Could not create iterator for rowset $0",
-                                     rs->ToString()));
-    ret.emplace_back(row_it.release());
+    RETURN_NOT_OK(add_rowset_iter(rs.get()));
   }
 
   // Swap results into the parameters.
@@ -1780,6 +2295,53 @@ Status Tablet::CaptureConsistentIterators(
   return Status::OK();
 }
 
+Status Tablet::CaptureDiffScanInput(const Schema* projection,
+                                    Timestamp start,
+                                    Timestamp end,
+                                    const ScanSpec* spec,
+                                    scoped_refptr<TabletComponents>* components,
+                                    shared_ptr<CompactionInput>* input) const {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // The inputs are created out of the component lock, since they may have
+  // to initialize delta files to check their timestamps.
+  vector<RowSet*> rowsets = { comps->memrowset.get() };
+  if (spec != nullptr && spec->lower_bound_key() && spec->exclusive_upper_bound_key()) {
+    comps->rowsets->FindRowSetsIntersectingInterval(
+        spec->lower_bound_key()->encoded_key(),
+        spec->exclusive_upper_bound_key()->encoded_key(),
+        &rowsets);
+  } else {
+    for (const shared_ptr<RowSet>& rs : comps->rowsets->all_rowsets()) {
+      rowsets.push_back(rs.get());
+    }
+  }
+
+  vector<shared_ptr<CompactionInput>> inputs;
+  for (const RowSet* rs : rowsets) {
+    gscoped_ptr<CompactionInput> rs_input;
+    RETURN_NOT_OK_PREPEND(rs->NewDiffScanInput(projection, start, end, &rs_input),
+                          Substitute("Could not create diff scan input for rowset $0",
+                                     rs->ToString()));
+    if (rs_input) {
+      inputs.emplace_back(rs_input.release());
+    }
+  }
+  TRACE_COUNTER_INCREMENT("diff_scan_rowsets_read", inputs.size());
+
+  if (inputs.empty()) {
+    input->reset();
+  } else if (inputs.size() == 1) {
+    *input = std::move(inputs[0]);
+  } else {
+    input->reset(CompactionInput::Merge(inputs, projection));
+  }
+  *components = std::move(comps);
+  return Status::OK();
+}
+
 Status Tablet::CountRows(uint64_t *count) const {
   // First grab a consistent view of the components of the tablet.
   scoped_refptr<TabletComponents> comps;
@@ -1796,6 +2358,21 @@ Status Tablet::CountRows(uint64_t *count) const {
   return Status::OK();
 }
 
+Status Tablet::GetColumnStats(const vector<ColumnId>& col_ids,
+                              vector<ColumnStatsPB>* stats) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  stats->clear();
+  stats->resize(col_ids.size());
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    for (int i = 0; i < col_ids.size(); i++) {
+      RETURN_NOT_OK(rowset->AddColumnStats(col_ids[i], &(*stats)[i]));
+    }
+  }
+  return Status::OK();
+}
+
 size_t Tablet::MemRowSetSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1834,6 +2411,30 @@ size_t Tablet::OnDiskSize() const {
   return ret;
 }
 
+Status Tablet::ChooseSplitKey(string* split_key) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return Status::IllegalState("tablet is not open");
+  }
+
+  // Skip the DuplicatingRowSets which don't have metadata: the rowsets of a
+  // compaction in progress are left out until it completes.
+  RowSetVector disk_rowsets;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    if (rowset->metadata().get() != nullptr) {
+      disk_rowsets.push_back(rowset);
+    }
+  }
+  vector<string> split_keys;
+  RETURN_NOT_OK(ChooseSplitKeys(disk_rowsets, 2, &split_keys));
+  if (split_keys.empty()) {
+    return Status::NotFound("no key to split the tablet at");
+  }
+  *split_key = std::move(split_keys[0]);
+  return Status::OK();
+}
+
 size_t Tablet::OnDiskDataSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1847,6 +2448,23 @@ size_t Tablet::OnDiskDataSize() const {
   return ret;
 }
 
+double Tablet::CompactionWriteAmplification() const {
+  if (!metrics_) return 0;
+  int64_t total_written = metrics_->bytes_flushed->value();
+  int64_t ingested = total_written - metrics_->compaction_bytes_written->value();
+  if (ingested <= 0) return 0;
+  return static_cast<double>(total_written) / ingested;
+}
+
+void Tablet::GetDataDirUuids(vector<string>* uuids) const {
+  fs::DataDirManager* dd_manager = metadata_->fs_manager()->dd_manager();
+  DataDirGroupPB group_pb;
+  if (!dd_manager || !dd_manager->GetDataDirGroupPB(tablet_id(), &group_pb).ok()) {
+    return;
+  }
+  uuids->insert(uuids->end(), group_pb.uuids().begin(), group_pb.uuids().end());
+}
+
 size_t Tablet::DeltaMemStoresSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -2143,6 +2761,24 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
 
+  // Only rowsets which may hold ancient undos are worth locking. They are GCed
+  // in descending order of their estimated ancient bytes, so that a bounded
+  // run frees the most space.
+  vector<pair<shared_ptr<RowSet>, int64_t>> candidates; // rowset, bytes
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    int64_t bytes;
+    RETURN_NOT_OK(rowset->EstimateBytesInPotentiallyAncientUndoDeltas(ancient_history_mark,
+                                                                      &bytes));
+    if (bytes > 0) {
+      candidates.emplace_back(rowset, bytes);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const pair<shared_ptr<RowSet>, int64_t>& a,
+               const pair<shared_ptr<RowSet>, int64_t>& b) {
+              return a.second > b.second; // Descending order.
+            });
+
   // We need to hold the compact_flush_lock for each rowset we GC undos from.
   RowSetVector rowsets_to_gc_undos;
   vector<std::unique_lock<std::mutex>> rowset_locks;
@@ -2150,7 +2786,8 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
     // We hold the selection lock so other threads will not attempt to select the
     // same rowsets for compaction while we delete old undos.
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    for (const auto& candidate : candidates) {
+      const auto& rowset = candidate.first;
       if (!rowset->IsAvailableForCompaction()) {
         continue;
       }
@@ -2161,9 +2798,15 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
     }
   }
 
+  const int64_t max_blocks = FLAGS_undo_delta_block_gc_max_blocks_per_run;
   int64_t tablet_blocks_deleted = 0;
   int64_t tablet_bytes_deleted = 0;
   for (const auto& rowset : rowsets_to_gc_undos) {
+    if (max_blocks > 0 && tablet_blocks_deleted >= max_blocks) {
+      VLOG_WITH_PREFIX(1) << Substitute("Deleted $0 undo delta blocks, leaving the remaining "
+                                        "ancient undos for the next run", tablet_blocks_deleted);
+      break;
+    }
     int64_t rowset_blocks_deleted;
     int64_t rowset_bytes_deleted;
     RETURN_NOT_OK(rowset->DeleteAncientUndoDeltas(ancient_history_mark,
@@ -2265,11 +2908,13 @@ string Tablet::LogPrefix() const {
 ////////////////////////////////////////////////////////////
 
 Tablet::Iterator::Iterator(const Tablet* tablet, const Schema& projection,
-                           MvccSnapshot snap, const OrderMode order)
+                           MvccSnapshot snap, const OrderMode order,
+                           ThreadPool* scan_pool)
     : tablet_(tablet),
       projection_(projection),
       snap_(std::move(snap)),
-      order_(order) {}
+      order_(order),
+      scan_pool_(scan_pool) {}
 
 Tablet::Iterator::~Iterator() {}
 
@@ -2279,7 +2924,7 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
 
   RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
 
-  vector<shared_ptr<RowwiseIterator>> iters;
+  vector<IterWithBounds> iters;
 
   RETURN_NOT_OK(tablet_->CaptureConsistentIterators(&projection_, snap_, spec, order_, &iters));
 
@@ -2288,9 +2933,20 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
       iter_.reset(new MergeIterator(projection_, std::move(iters)));
       break;
     case UNORDERED:
-    default:
-      iter_.reset(new UnionIterator(std::move(iters)));
+    default: {
+      vector<shared_ptr<RowwiseIterator>> union_iters;
+      union_iters.reserve(iters.size());
+      for (auto& i : iters) {
+        union_iters.emplace_back(std::move(i.iter));
+      }
+      if (scan_pool_ && FLAGS_tablet_scan_parallelism > 1 && union_iters.size() > 1) {
+        iter_.reset(new ParallelUnionIterator(std::move(union_iters), scan_pool_,
+                                              FLAGS_tablet_scan_parallelism));
+      } else {
+        iter_.reset(new UnionIterator(std::move(union_iters)));
+      }
       break;
+    }
   }
 
   RETURN_NOT_OK(iter_->Init(spec));
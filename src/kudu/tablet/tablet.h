@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
@@ -60,9 +61,12 @@ class MaintenanceOpStats;
 class MemTracker;
 class MonoDelta;
 class RowBlock;
+class RowOperationsPB;
 class ScanSpec;
+class ThreadPool;
 class Throttler;
 class Timestamp;
+struct IterWithBounds;
 struct IteratorStats;
 
 namespace log {
@@ -72,10 +76,14 @@ class LogAnchorRegistry;
 namespace tablet {
 
 class AlterSchemaTransactionState;
+class CompactionInput;
 class CompactionPolicy;
 class HistoryGcOpts;
 class MemRowSet;
+class MemRowSetInsertHint;
 struct RowOp;
+class RollingDiskRowSetWriter;
+class RowCache;
 class RowSetsInCompaction;
 class RowSetTree;
 struct TabletComponents;
@@ -181,9 +189,13 @@ class Tablet {
 
   // Apply a single row operation, which must already be prepared.
   // The result is set back into row_op->result.
+  //
+  // If 'mrs_hint' is not null, it's passed to the MemRowSet on insert: see
+  // MemRowSet::Insert().
   Status ApplyRowOperation(WriteTransactionState* tx_state,
                            RowOp* row_op,
-                           ProbeStats* stats) WARN_UNUSED_RESULT;
+                           ProbeStats* stats,
+                           MemRowSetInsertHint* mrs_hint = nullptr) WARN_UNUSED_RESULT;
 
   // Create a new row iterator which yields the rows as of the current MVCC
   // state of this tablet.
@@ -192,10 +204,40 @@ class Tablet {
                         gscoped_ptr<RowwiseIterator> *iter) const;
 
   // Create a new row iterator for some historical snapshot.
+  //
+  // If 'scan_pool' is set, an UNORDERED iterator may scan its rowsets in
+  // parallel on it, as configured by --tablet_scan_parallelism. 'scan_pool'
+  // must outlive the iterator.
   Status NewRowIterator(const Schema &projection,
                         const MvccSnapshot &snap,
                         const OrderMode order,
-                        gscoped_ptr<RowwiseIterator> *iter) const;
+                        gscoped_ptr<RowwiseIterator> *iter,
+                        ThreadPool* scan_pool = nullptr) const;
+
+  // Create an iterator over the rows inserted, updated or deleted by the
+  // operations committed at or after 'start' and before 'end': see
+  // DiffScanIterator. 'projection' may include the virtual columns of diff
+  // scans. The returned iterator is not initialized.
+  Status NewDiffScanIterator(const Schema& projection,
+                             Timestamp start,
+                             Timestamp end,
+                             gscoped_ptr<RowwiseIterator>* iter) const;
+
+  // Reads the rows whose encoded primary keys are 'encoded_keys', as of the
+  // current MVCC state of this tablet, without setting up an iterator over
+  // every rowset: for each key, only the MemRowSet and the rowsets whose key
+  // ranges and bloom filters may hold it are read, starting at a seek to
+  // the key.
+  //
+  // 'dst' must use 'projection' and have room for a row per key. Row i of
+  // 'dst' is set to the row with the i-th key and selected in its selection
+  // vector if that row exists, and unselected otherwise. Indirect data is
+  // allocated from the arena of 'dst'.
+  //
+  // Returns InvalidArgument if a key can't be decoded.
+  Status GetRows(const Schema& projection,
+                 const std::vector<Slice>& encoded_keys,
+                 RowBlock* dst) const;
 
   // Flush the current MemRowSet for this tablet to disk. This swaps
   // in a new (initially empty) MemRowSet in its place.
@@ -204,6 +246,21 @@ class Tablet {
   // To do that, call FlushBiggestDMS() for example.
   Status Flush();
 
+  // Writes the rows of the INSERT operations in 'ops', encoded with
+  // 'client_schema', directly into new DiskRowSets, bypassing the MemRowSet.
+  // The rows must be sorted by primary key, without duplicates.
+  //
+  // All the rows are checked for presence up front, with a single sorted
+  // probe of the rowsets whose key ranges overlap them; if any of them is
+  // already present, nothing is written and AlreadyPresent is returned. The
+  // rows become visible at once, at a single timestamp.
+  //
+  // The new rowsets are durable once this returns, but nothing is written to
+  // the WAL nor replicated: this is meant for tablets which are written
+  // locally, like LocalTabletWriter does, e.g. to load data in bulk before
+  // the tablet is served.
+  Status BulkLoadSortedRows(const Schema* client_schema, const RowOperationsPB& ops);
+
   // Prepares the transaction context for the alter schema operation.
   // An error will be returned if the specified schema is invalid (e.g.
   // key mismatch, or missing IDs)
@@ -266,6 +323,21 @@ class Tablet {
   // Excludes all metadata (both tablet metadata and the metadata of this tablet's rowsets).
   size_t OnDiskDataSize() const;
 
+  // Chooses the encoded primary key which splits the base data of this
+  // tablet's disk rowsets about evenly, sampling keys at evenly spaced
+  // positions of each rowset. Returns NotFound if there is no such key, e.g.
+  // if the tablet has no data on disk.
+  Status ChooseSplitKey(std::string* split_key) const;
+
+  // Returns the ratio between the bytes written to disk by flushes and
+  // compactions and the bytes which entered the tablet's disk rowsets through
+  // flushes and bulk loads, or 0 if nothing was flushed yet.
+  double CompactionWriteAmplification() const;
+
+  // Appends the UUIDs of the data directories holding this tablet's blocks
+  // to 'uuids'. Appends nothing if the tablet has no data dir group.
+  void GetDataDirUuids(std::vector<std::string>* uuids) const;
+
   // Get the total size of all the DMS
   size_t DeltaMemStoresSize() const;
 
@@ -334,6 +406,13 @@ class Tablet {
   // memrowset in the current implementation.
   Status CountRows(uint64_t *count) const;
 
+  // Sets '*stats' to the statistics of the columns 'col_ids', in the same
+  // order, merged across the rowsets of the tablet. They're approximate: the
+  // rows of the MemRowSet, updates and deletes aren't reflected, and columns
+  // of types which can't be part of a primary key have no statistics.
+  Status GetColumnStats(const std::vector<ColumnId>& col_ids,
+                        std::vector<ColumnStatsPB>* stats) const;
+
 
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
@@ -378,7 +457,8 @@ class Tablet {
   // Otherwise, returns false.
   bool GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const WARN_UNUSED_RESULT;
 
-  // Calculates history GC options based on properties of the Clock implementation.
+  // Calculates history GC options based on properties of the Clock implementation,
+  // and the row expiry cutoff from the row TTL of the schema, if any.
   HistoryGcOpts GetHistoryGcOpts() const;
 
   // Method used by tests to retrieve all rowsets of this table. This
@@ -430,6 +510,7 @@ class Tablet {
   static BloomFilterSizing DefaultBloomSizing();
 
  private:
+  friend class DiffScanIterator;
   friend class Iterator;
   friend class TabletReplicaTest;
   FRIEND_TEST(TestTablet, TestGetReplaySizeForIndex);
@@ -513,7 +594,8 @@ class Tablet {
   // - the operation has been decoded
   Status InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
                                 RowOp* op,
-                                ProbeStats* stats);
+                                ProbeStats* stats,
+                                MemRowSetInsertHint* mrs_hint);
 
   // Same as above, but for UPDATE.
   Status MutateRowUnlocked(WriteTransactionState *tx_state,
@@ -527,6 +609,9 @@ class Tablet {
                              RowSet* rowset,
                              ProbeStats* stats);
 
+  // Erases the row mutated by 'op' from the row cache, if it's enabled.
+  void InvalidateCachedRow(const RowOp& op);
+
   // Return the list of RowSets that need to be consulted when processing the
   // given insertion or mutation.
   static std::vector<RowSet*> FindRowSetsToCheck(const RowOp* op,
@@ -543,13 +628,25 @@ class Tablet {
   // concurrent modification. They will include all data that was present at the time
   // of creation, and potentially newer data.
   //
-  // The returned iterators are not Init()ed.
+  // The returned iterators are not Init()ed. For ORDERED scans, the iterators
+  // of rowsets with known key bounds are annotated with those bounds.
   // 'projection' must remain valid and unchanged for the lifetime of the returned iterators.
   Status CaptureConsistentIterators(const Schema *projection,
                                     const MvccSnapshot &snap,
                                     const ScanSpec *spec,
                                     OrderMode order,
-                                    std::vector<std::shared_ptr<RowwiseIterator> > *iters) const;
+                                    std::vector<IterWithBounds>* iters) const;
+
+  // Captures the components of the tablet into 'components' and creates the
+  // merged diff scan input of its rowsets in 'input', which is left null if
+  // none of them may hold changes in the window. Only the rowsets
+  // overlapping the key range of 'spec' are read, if it's bounded.
+  Status CaptureDiffScanInput(const Schema* projection,
+                              Timestamp start,
+                              Timestamp end,
+                              const ScanSpec* spec,
+                              scoped_refptr<TabletComponents>* components,
+                              std::shared_ptr<CompactionInput>* input) const;
 
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
@@ -558,6 +655,16 @@ class Tablet {
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                   int64_t mrs_being_flushed);
 
+  // Merges the rows of 'input' committed in 'snap', in the key range
+  // partitions delimited by 'split_keys', each on its own thread and into its
+  // own writer. The writers are returned in 'drsws' in key order, finished.
+  Status FlushCompactionPartitions(
+      const RowSetsInCompaction& input,
+      const MvccSnapshot& snap,
+      const HistoryGcOpts& history_gc_opts,
+      const std::vector<std::string>& split_keys,
+      std::vector<std::unique_ptr<RollingDiskRowSetWriter>>* drsws);
+
   // Handle the case in which a compaction or flush yielded no output rows.
   // In this case, we just need to remove the rowsets in 'rowsets' from the
   // metadata and flush it.
@@ -677,6 +784,14 @@ class Tablet {
   MvccManager mvcc_;
   LockManager lock_manager_;
 
+  // The cache of rows read by GetRows(), or nullptr if it's disabled.
+  RowCache* const row_cache_;
+
+  // The number of rows erased from 'row_cache_'. A row read by GetRows() is
+  // only cached if no row was mutated while it was being read, as it may be
+  // stale otherwise.
+  std::atomic<uint64_t> row_cache_invalidations_;
+
   gscoped_ptr<CompactionPolicy> compaction_policy_;
 
   // Lock protecting the selection of rowsets for compaction.
@@ -762,12 +877,13 @@ class Tablet::Iterator : public RowwiseIterator {
   DISALLOW_COPY_AND_ASSIGN(Iterator);
 
   Iterator(const Tablet* tablet, const Schema& projection, MvccSnapshot snap,
-           const OrderMode order);
+           const OrderMode order, ThreadPool* scan_pool);
 
   const Tablet *tablet_;
   Schema projection_;
   const MvccSnapshot snap_;
   const OrderMode order_;
+  ThreadPool* const scan_pool_;
   gscoped_ptr<RowwiseIterator> iter_;
 };
 
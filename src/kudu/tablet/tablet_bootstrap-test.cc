@@ -60,6 +60,7 @@
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/result_tracker.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/mvcc.h"
@@ -76,7 +77,9 @@
 #include "kudu/util/logging_test_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
 
 using std::shared_ptr;
 using std::string;
@@ -266,6 +269,27 @@ TEST_F(BootstrapTest, TestBootstrapHighOpIdIndex) {
   ASSERT_OPID_EQ(last_opid, boot_info.last_committed_id);
 }
 
+// Measures the time to replay a log with many operations. Run with
+// --tablet_bootstrap_read_ahead_bytes=0 to compare against reading the log
+// on the replaying thread.
+TEST_F(BootstrapTest, TestReplayPerformance) {
+  const int kNumOps = AllowSlowTests() ? 100000 : 1000;
+  ASSERT_OK(BuildLog());
+  AppendReplicateBatchAndCommitEntryPairsToLog(kNumOps, false /* sync */);
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  LOG_TIMING(INFO, strings::Substitute("bootstrapping a tablet with $0 ops", kNumOps)) {
+    ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+  }
+  ASSERT_EQ(current_index_ - 1, boot_info.last_id.index());
+
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_EQ(kNumOps, results.size());
+}
+
 // Tests attempting a local bootstrap of a tablet that was in the middle of a
 // tablet copy before "crashing".
 TEST_F(BootstrapTest, TestIncompleteTabletCopy) {
@@ -17,6 +17,8 @@
 
 #include "kudu/tablet/tablet_bootstrap.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <map>
@@ -79,6 +81,7 @@
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -90,6 +93,7 @@
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 DECLARE_int32(group_commit_queue_size_bytes);
 
@@ -103,6 +107,12 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int64(tablet_bootstrap_read_ahead_bytes, 8 * 1024 * 1024,
+             "The maximum number of bytes of WAL entries which are read and "
+             "decoded ahead of replay by a separate thread during tablet "
+             "bootstrap. 0 reads the entries on the replaying thread.");
+TAG_FLAG(tablet_bootstrap_read_ahead_bytes, advanced);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 namespace kudu {
@@ -1139,6 +1149,145 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+namespace {
+
+// An entry read from a log segment during replay. For the end of a segment,
+// or an error reading it, 'entry' is null and 'status' is set.
+struct ReplayEntry {
+  unique_ptr<LogEntryPB> entry;
+  Status status;
+
+  // The number of entries successfully read from this entry's segment so far,
+  // including this one.
+  int entry_count;
+
+  // The reader's offset into the segment after reading the entry, and the
+  // offset it reads up to.
+  int64_t offset;
+  int64_t read_up_to_offset;
+
+  // The number of bytes of the segment read to produce this entry. All the
+  // bytes of a batch are attributed to its first entry.
+  size_t bytes;
+};
+
+struct ReplayEntryLogicalSize {
+  static size_t logical_size(const ReplayEntry* e) {
+    return std::max<size_t>(1, e->bytes);
+  }
+};
+
+// Reads the entries of a sequence of log segments, in order. If
+// --tablet_bootstrap_read_ahead_bytes is positive, the segments are read and
+// decoded on a separate thread, so that this IO and CPU work overlaps with
+// replaying the entries. Otherwise the entries are read on demand.
+//
+// For each segment, returns its entries followed by an entry with an
+// EndOfFile() status. If reading fails, returns an entry with the error,
+// after which no more entries are returned.
+class ReplayEntryReader {
+ public:
+  explicit ReplayEntryReader(log::SegmentSequence segments)
+      : segments_(std::move(segments)),
+        segment_idx_(0),
+        entry_count_(0),
+        queue_(std::max<int64_t>(1, FLAGS_tablet_bootstrap_read_ahead_bytes)) {
+  }
+
+  ~ReplayEntryReader() {
+    if (thread_) {
+      queue_.Shutdown();
+      CHECK_OK(ThreadJoiner(thread_.get()).Join());
+      // Free whatever was read ahead but not consumed.
+      ReplayEntry* e;
+      while (queue_.BlockingGet(&e)) {
+        delete e;
+      }
+    }
+  }
+
+  Status Start() {
+    if (FLAGS_tablet_bootstrap_read_ahead_bytes <= 0) {
+      return Status::OK();
+    }
+    return Thread::Create("tablet-bootstrap", "wal-read-ahead",
+                          &ReplayEntryReader::ReadAheadThread, this, &thread_);
+  }
+
+  // Return the next entry, blocking until it has been read.
+  unique_ptr<ReplayEntry> Next() {
+    unique_ptr<ReplayEntry> e;
+    if (thread_) {
+      ReplayEntry* raw;
+      CHECK(queue_.BlockingGet(&raw)) << "read past the last segment";
+      e.reset(raw);
+    } else {
+      e.reset(new ReplayEntry);
+      CHECK(ReadNext(e.get())) << "read past the last segment";
+    }
+    return e;
+  }
+
+ private:
+  // Read the next entry into 'e'. Returns false if there are no more entries.
+  bool ReadNext(ReplayEntry* e) {
+    if (segment_idx_ == segments_.size()) {
+      return false;
+    }
+    if (!reader_) {
+      reader_.reset(new log::LogEntryReader(segments_[segment_idx_].get()));
+      entry_count_ = 0;
+    }
+    int64_t prev_offset = reader_->offset();
+    e->entry.reset(new LogEntryPB);
+    e->status = reader_->ReadNextEntry(e->entry.get());
+    if (e->status.ok()) {
+      entry_count_++;
+    }
+    e->entry_count = entry_count_;
+    e->offset = reader_->offset();
+    e->read_up_to_offset = reader_->read_up_to_offset();
+    e->bytes = reader_->offset() - prev_offset;
+    if (!e->status.ok()) {
+      e->entry.reset();
+      reader_.reset();
+      // Move on to the next segment, or stop after an error.
+      segment_idx_ = e->status.IsEndOfFile() ? segment_idx_ + 1 : segments_.size();
+    }
+    return true;
+  }
+
+  void ReadAheadThread() {
+    while (true) {
+      unique_ptr<ReplayEntry> e(new ReplayEntry);
+      if (!ReadNext(e.get())) {
+        break;
+      }
+      if (!queue_.BlockingPut(e.get())) {
+        // The consumer has gone away.
+        return;
+      }
+      e.release();
+    }
+    queue_.Shutdown();
+  }
+
+  const log::SegmentSequence segments_;
+
+  // The state of the read through 'segments_'. Only accessed by the read-ahead
+  // thread, if there is one.
+  size_t segment_idx_;
+  unique_ptr<log::LogEntryReader> reader_;
+  int entry_count_;
+
+  BlockingQueue<ReplayEntry*, ReplayEntryLogicalSize> queue_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplayEntryReader);
+};
+
+} // anonymous namespace
+
 Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
   log::SegmentSequence segments;
@@ -1167,14 +1316,13 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
-  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
+  ReplayEntryReader entry_reader(segments);
+  RETURN_NOT_OK_PREPEND(entry_reader.Start(), "Failed to start reading log segments");
 
-    int entry_count = 0;
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
     while (true) {
-      unique_ptr<LogEntryPB> entry(new LogEntryPB);
-
-      Status s = reader.ReadNextEntry(entry.get());
+      unique_ptr<ReplayEntry> replay_entry = entry_reader.Next();
+      Status s = replay_entry->status;
       if (PREDICT_FALSE(!s.ok())) {
         if (s.IsEndOfFile()) {
           break;
@@ -1183,11 +1331,12 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
                                              "(Read up to entry $2 of segment $3, in path $4)",
                                              tablet_->tablet_id(),
                                              s.ToString(),
-                                             entry_count,
+                                             replay_entry->entry_count,
                                              segment->header().sequence_number(),
                                              segment->path()));
       }
-      entry_count++;
+      int entry_count = replay_entry->entry_count;
+      unique_ptr<LogEntryPB>& entry = replay_entry->entry;
 
       s = HandleEntry(&state, entry.get());
       if (!s.ok()) {
@@ -1206,8 +1355,9 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
         SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
                                     "($2/$3 this segment, stats: $4)",
                                     segment_count + 1, log_reader_->num_segments(),
-                                    HumanReadableNumBytes::ToString(reader.offset()),
-                                    HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
+                                    HumanReadableNumBytes::ToString(replay_entry->offset),
+                                    HumanReadableNumBytes::ToString(
+                                        replay_entry->read_up_to_offset),
                                     stats_.ToString()));
         last_status_update = now;
       }
@@ -60,6 +60,7 @@
 
 DECLARE_bool(enable_maintenance_manager);
 DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_int32(undo_delta_block_gc_max_blocks_per_run);
 DECLARE_string(time_source);
 
 using kudu::clock::HybridClock;
@@ -643,5 +644,34 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestUndoDeltaBlockGc) {
   ASSERT_EQ(1, tablet()->metrics()->undo_delta_block_gc_delete_duration->TotalCount());
 }
 
+// Test that a bounded run of undo delta block GC only deletes the undos of
+// some of the rowsets, and that later runs pick up the rest.
+TEST_F(TabletHistoryGcNoMaintMgrTest, TestBoundedUndoDeltaBlockGc) {
+  FLAGS_tablet_history_max_age_sec = 1000;
+  FLAGS_undo_delta_block_gc_max_blocks_per_run = 1;
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(1)));
+  NO_FATALS(UpdateOriginalRows(num_rowsets_, rows_per_rowset_, 0));
+  ASSERT_OK(tablet()->MajorCompactAllDeltaStoresForTests());
+  const int kUndosPerRowSet = 2;
+  ASSERT_EQ(kUndosPerRowSet * num_rowsets_, tablet()->CountUndoDeltasForTests());
+
+  // Move the clock so all deltas should be ancient.
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(FLAGS_tablet_history_max_age_sec + 1)));
+
+  // Each run stops once it has GCed a rowset's undos.
+  for (int run = 0; run < num_rowsets_; run++) {
+    SCOPED_TRACE(run);
+    int64_t bytes_in_ancient_undos = 0;
+    ASSERT_OK(tablet()->InitAncientUndoDeltas(MonoDelta(), &bytes_in_ancient_undos));
+    ASSERT_GT(bytes_in_ancient_undos, 0);
+    int64_t blocks_deleted;
+    ASSERT_OK(tablet()->DeleteAncientUndoDeltas(&blocks_deleted));
+    ASSERT_EQ(kUndosPerRowSet, blocks_deleted);
+    ASSERT_EQ(kUndosPerRowSet * (num_rowsets_ - run - 1), tablet()->CountUndoDeltasForTests());
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -19,12 +19,15 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol-test-util.h"
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/local_tablet_writer.h"
@@ -33,8 +36,10 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 #include "kudu/util/test_macros.h"
 
 namespace kudu {
@@ -143,5 +148,39 @@ TEST_F(TestTabletMetadata, TestOnDiskSize) {
 }
 
 
+namespace {
+Status SleepBeforeFlush() {
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  return Status::OK();
+}
+} // anonymous namespace
+
+// Test that concurrent flushes of the metadata are coalesced.
+TEST_F(TestTabletMetadata, TestConcurrentFlushesAreCoalesced) {
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  meta->SetPreFlushCallback(Bind(&SleepBeforeFlush));
+  const int initial_flush_count = meta->flush_count_for_tests();
+
+  // While the first flush is slowed down, the others pile up behind it and
+  // are all covered by the next one.
+  const int kNumThreads = 10;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([meta]() {
+      CHECK_OK(meta->Flush());
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const int num_flushes = meta->flush_count_for_tests() - initial_flush_count;
+  ASSERT_GE(num_flushes, 1);
+  ASSERT_LT(num_flushes, kNumThreads);
+
+  // A flush after the others still writes the metadata.
+  ASSERT_OK(meta->Flush());
+  ASSERT_EQ(initial_flush_count + num_flushes + 1, meta->flush_count_for_tests());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -59,6 +59,13 @@ TAG_FLAG(enable_tablet_orphaned_block_deletion, advanced);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, hidden);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, runtime);
 
+DEFINE_bool(fs_data_dirs_expand_groups_at_startup, false,
+            "Whether to add a less loaded data directory, such as one on a newly "
+            "added disk, to a tablet's data directory group when loading the "
+            "tablet's metadata. New data written by the tablet is then spread "
+            "onto that directory, and existing data follows as it is compacted.");
+TAG_FLAG(fs_data_dirs_expand_groups_at_startup, experimental);
+
 using base::subtle::Barrier_AtomicIncrement;
 using kudu::consensus::MinimumOpId;
 using kudu::consensus::OpId;
@@ -173,6 +180,9 @@ vector<BlockIdPB> TabletMetadata::CollectBlockIdPBs(const TabletSuperBlockPB& su
     if (rowset.has_adhoc_index_block()) {
       block_ids.push_back(rowset.adhoc_index_block());
     }
+    for (const ColumnDataPB& index : rowset.secondary_indexes()) {
+      block_ids.push_back(index.block());
+    }
   }
   return block_ids;
 }
@@ -217,10 +227,14 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
 
   // Keep a copy of the old data dir group in case of flush failure.
   DataDirGroupPB pb;
-  bool old_group_exists = fs_manager_->dd_manager()->GetDataDirGroupPB(tablet_id_, &pb).ok();
+  bool old_group_exists = false;
 
-  // Remove the tablet's data dir group tracked by the DataDirManager.
-  fs_manager_->dd_manager()->DeleteDataDirGroup(tablet_id_);
+  // Remove the tablet's data dir group tracked by the DataDirManager, unless
+  // the orphaned blocks in its directories are retained.
+  if (!retain_orphaned_blocks()) {
+    old_group_exists = fs_manager_->dd_manager()->GetDataDirGroupPB(tablet_id_, &pb).ok();
+    fs_manager_->dd_manager()->DeleteDataDirGroup(tablet_id_);
+  }
   auto revert_group_cleanup = MakeScopedCleanup([&]() {
     if (old_group_exists) {
       fs_manager_->dd_manager()->LoadDataDirGroupFromPB(tablet_id_, pb);
@@ -290,7 +304,10 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       tombstone_last_logged_opid_(std::move(tombstone_last_logged_opid)),
       num_flush_pins_(0),
       needs_flush_(false),
+      flush_requests_(0),
+      flushed_requests_(0),
       flush_count_for_tests_(0),
+      retain_orphaned_blocks_(false),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {
   CHECK(schema_->has_column_ids());
   CHECK_GT(schema_->num_key_columns(), 0);
@@ -309,7 +326,10 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
       schema_(nullptr),
       num_flush_pins_(0),
       needs_flush_(false),
+      flush_requests_(0),
+      flushed_requests_(0),
       flush_count_for_tests_(0),
+      retain_orphaned_blocks_(false),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {}
 
 Status TabletMetadata::LoadFromDisk() {
@@ -424,9 +444,17 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     if (superblock.has_data_dir_group()) {
       // An error loading the data dir group is non-fatal, it just means the
       // tablet will fail to bootstrap later.
-      WARN_NOT_OK(fs_manager_->dd_manager()->LoadDataDirGroupFromPB(
-          tablet_id_, superblock.data_dir_group()),
-          "failed to load DataDirGroup from superblock");
+      Status s = fs_manager_->dd_manager()->LoadDataDirGroupFromPB(
+          tablet_id_, superblock.data_dir_group());
+      WARN_NOT_OK(s, "failed to load DataDirGroup from superblock");
+      if (s.ok() && FLAGS_fs_data_dirs_expand_groups_at_startup &&
+          tablet_data_state_ == TABLET_DATA_READY) {
+        // The expanded group is persisted by the next metadata flush. Until
+        // then, losing it is harmless: it only steers where new blocks go.
+        bool added;
+        WARN_NOT_OK(fs_manager_->dd_manager()->MaybeAddDataDirToGroup(tablet_id_, &added),
+                    "failed to expand DataDirGroup");
+      }
     } else if (tablet_data_state_ == TABLET_DATA_READY) {
       // If the superblock does not contain a DataDirGroup, this server has
       // likely been upgraded from before 1.5.0. Create a new DataDirGroup for
@@ -480,7 +508,26 @@ void TabletMetadata::AddOrphanedBlocksUnlocked(const vector<BlockId>& blocks) {
   orphaned_blocks_.insert(blocks.begin(), blocks.end());
 }
 
+vector<BlockId> TabletMetadata::orphaned_blocks() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return vector<BlockId>(orphaned_blocks_.begin(), orphaned_blocks_.end());
+}
+
+void TabletMetadata::set_retain_orphaned_blocks(bool retain) {
+  std::lock_guard<LockType> l(data_lock_);
+  retain_orphaned_blocks_ = retain;
+}
+
+bool TabletMetadata::retain_orphaned_blocks() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return retain_orphaned_blocks_;
+}
+
 void TabletMetadata::DeleteOrphanedBlocks(const vector<BlockId>& blocks) {
+  if (retain_orphaned_blocks()) {
+    VLOG_WITH_PREFIX(1) << "Retaining " << blocks.size() << " orphaned block(s)";
+    return;
+  }
   if (PREDICT_FALSE(!FLAGS_enable_tablet_orphaned_block_deletion)) {
     LOG_WITH_PREFIX(WARNING) << "Not deleting " << blocks.size()
         << " block(s) from disk. Block deletion disabled via "
@@ -528,9 +575,24 @@ Status TabletMetadata::Flush() {
   TRACE_EVENT1("tablet", "TabletMetadata::Flush",
                "tablet_id", tablet_id_);
 
+  // Number this request, so that it's known which of the superblocks
+  // written by the concurrent calls to Flush() covers it.
+  int64_t request;
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    request = ++flush_requests_;
+  }
+
   MutexLock l_flush(flush_lock_);
+  if (flushed_requests_ >= request) {
+    // While this call was waiting for 'flush_lock_', another one wrote a
+    // superblock reflecting the state as of this request.
+    TRACE("Metadata flush coalesced");
+    return Status::OK();
+  }
   vector<BlockId> orphaned;
   TabletSuperBlockPB pb;
+  int64_t covered_requests;
   {
     std::lock_guard<LockType> l(data_lock_);
     CHECK_GE(num_flush_pins_, 0);
@@ -540,6 +602,7 @@ Status TabletMetadata::Flush() {
       return Status::OK();
     }
     needs_flush_ = false;
+    covered_requests = flush_requests_;
 
     RETURN_NOT_OK(ToSuperBlockUnlocked(&pb, rowsets_));
 
@@ -553,6 +616,7 @@ Status TabletMetadata::Flush() {
   }
   pre_flush_callback_.Run();
   RETURN_NOT_OK(ReplaceSuperBlockUnlocked(pb));
+  flushed_requests_ = covered_requests;
   TRACE("Metadata flushed");
   l_flush.Unlock();
 
@@ -185,6 +185,22 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // in a call to DeleteOrphanedBlocks().
   void AddOrphanedBlocks(const std::vector<BlockId>& block_ids);
 
+  // Returns the blocks in 'orphaned_blocks_'.
+  std::vector<BlockId> orphaned_blocks() const;
+
+  // Sets whether orphaned blocks are kept on disk rather than deleted when
+  // the metadata is flushed. They remain listed in the superblock, so they
+  // are still deleted upon the next flush after this is unset, or on startup
+  // if the tablet isn't in the TABLET_DATA_READY state.
+  //
+  // While set, DeleteTabletData() also keeps the tablet's data dir group.
+  //
+  // Set while a replica is being replaced by a tablet copy, so that the
+  // blocks of the old replica identical to those of the source may be
+  // reused rather than downloaded. Not persisted.
+  void set_retain_orphaned_blocks(bool retain);
+  bool retain_orphaned_blocks() const;
+
   // Mark the superblock to be in state 'delete_type', sync it to disk, and
   // then delete all of the rowsets in this tablet.
   // The metadata (superblock) is not deleted. For that, call DeleteSuperBlock().
@@ -376,9 +392,19 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // metadata is persisted.
   bool needs_flush_;
 
+  // The number of calls to Flush() so far, protected by 'data_lock_', and
+  // the number of those reflected by the last superblock written to disk,
+  // protected by 'flush_lock_'. Concurrent calls to Flush() are coalesced:
+  // those covered by a superblock written while they waited return at once.
+  int64_t flush_requests_;
+  int64_t flushed_requests_;
+
   // The number of times metadata has been flushed to disk
   int flush_count_for_tests_;
 
+  // Whether DeleteOrphanedBlocks() keeps the blocks. Protected by 'data_lock_'.
+  bool retain_orphaned_blocks_;
+
   // A callback that, if set, is called before this metadata is flushed
   // to disk. Protected by the 'flush_lock_'.
   StatusClosure pre_flush_callback_;
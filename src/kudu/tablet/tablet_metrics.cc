@@ -98,6 +98,22 @@ METRIC_DEFINE_counter(tablet, scanner_bytes_scanned_from_disk, "Scanner Bytes Sc
                       "and does not include data read from in-memory stores. However, it"
                       "includes both cache misses and cache hits.");
 
+METRIC_DEFINE_counter(tablet, scanner_cfile_cache_miss_bytes,
+                      "Scanner CFile Cache Miss Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes read from disk by scan requests because they "
+                      "were missing from the block cache.");
+
+METRIC_DEFINE_counter(tablet, scanner_cpu_time_us, "Scanner CPU Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total user and system CPU time spent by scan requests reading "
+                      "rows from this tablet.");
+
+METRIC_DEFINE_counter(tablet, write_apply_cpu_time_us, "Write Apply CPU Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total user and system CPU time spent applying write operations "
+                      "to this tablet.");
+
 METRIC_DEFINE_counter(tablet, scans_started, "Scans Started",
                       kudu::MetricUnit::kScanners,
                       "Number of scanners which have been started on this tablet");
@@ -120,6 +136,10 @@ METRIC_DEFINE_counter(tablet, mrs_lookups, "MemRowSet Lookups",
 METRIC_DEFINE_counter(tablet, bytes_flushed, "Bytes Flushed",
                       kudu::MetricUnit::kBytes,
                       "Amount of data that has been flushed to disk by this tablet.");
+METRIC_DEFINE_counter(tablet, compaction_bytes_written, "Compaction Bytes Written",
+                      kudu::MetricUnit::kBytes,
+                      "Amount of data that has been rewritten to disk by rowset compactions "
+                      "of this tablet. This is included in the bytes flushed.");
 
 METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
                       "Undo Delta Block GC Bytes Deleted",
@@ -162,6 +182,48 @@ METRIC_DEFINE_histogram(tablet, write_op_duration_commit_wait_consistency,
   "Duration of writes to this tablet with external consistency set to COMMIT_WAIT.",
   60000000LU, 2);
 
+METRIC_DEFINE_histogram(tablet, write_op_prepare_queue_duration,
+  "Write Op Prepare Queue Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent waiting in the prepare queue.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_prepare_duration,
+  "Write Op Prepare Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent being prepared, including acquiring their row locks.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_row_lock_duration,
+  "Write Op Row Lock Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent acquiring their row locks.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_replication_duration,
+  "Write Op Replication Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent being replicated, including being appended to the local WAL.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_apply_queue_duration,
+  "Write Op Apply Queue Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent waiting in the apply queue.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_apply_duration,
+  "Write Op Apply Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time write operations on this tablet which were led by this server "
+  "spent being applied.",
+  60000000LU, 2);
+
 METRIC_DEFINE_histogram(tablet, commit_wait_duration,
   "Commit-Wait Duration",
   kudu::MetricUnit::kMicroseconds,
@@ -271,12 +333,15 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(rows_deleted),
     MINIT(insertions_failed_dup_key),
     MINIT(upserts_as_updates),
+    MINIT(write_apply_cpu_time_us),
     MINIT(scanner_rows_returned),
     MINIT(scanner_cells_returned),
     MINIT(scanner_bytes_returned),
     MINIT(scanner_rows_scanned),
     MINIT(scanner_cells_scanned_from_disk),
     MINIT(scanner_bytes_scanned_from_disk),
+    MINIT(scanner_cfile_cache_miss_bytes),
+    MINIT(scanner_cpu_time_us),
     MINIT(scans_started),
     GINIT(tablet_active_scanners),
     MINIT(bloom_lookups),
@@ -284,6 +349,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(delta_file_lookups),
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
+    MINIT(compaction_bytes_written),
     MINIT(undo_delta_block_gc_bytes_deleted),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
@@ -292,6 +358,12 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(snapshot_read_inflight_wait_duration),
     MINIT(write_op_duration_client_propagated_consistency),
     MINIT(write_op_duration_commit_wait_consistency),
+    MINIT(write_op_prepare_queue_duration),
+    MINIT(write_op_prepare_duration),
+    MINIT(write_op_row_lock_duration),
+    MINIT(write_op_replication_duration),
+    MINIT(write_op_apply_queue_duration),
+    MINIT(write_op_apply_duration),
     GINIT(flush_dms_running),
     GINIT(flush_mrs_running),
     GINIT(compact_rs_running),
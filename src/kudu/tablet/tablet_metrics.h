@@ -50,6 +50,7 @@ struct TabletMetrics {
   scoped_refptr<Counter> rows_deleted;
   scoped_refptr<Counter> insertions_failed_dup_key;
   scoped_refptr<Counter> upserts_as_updates;
+  scoped_refptr<Counter> write_apply_cpu_time_us;
 
   // Scanner metrics
   scoped_refptr<Counter> scanner_rows_returned;
@@ -58,6 +59,8 @@ struct TabletMetrics {
   scoped_refptr<Counter> scanner_rows_scanned;
   scoped_refptr<Counter> scanner_cells_scanned_from_disk;
   scoped_refptr<Counter> scanner_bytes_scanned_from_disk;
+  scoped_refptr<Counter> scanner_cfile_cache_miss_bytes;
+  scoped_refptr<Counter> scanner_cpu_time_us;
   scoped_refptr<Counter> scans_started;
   scoped_refptr<AtomicGauge<size_t>> tablet_active_scanners;
 
@@ -69,6 +72,7 @@ struct TabletMetrics {
 
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
+  scoped_refptr<Counter> compaction_bytes_written;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
@@ -79,6 +83,12 @@ struct TabletMetrics {
   scoped_refptr<Histogram> snapshot_read_inflight_wait_duration;
   scoped_refptr<Histogram> write_op_duration_client_propagated_consistency;
   scoped_refptr<Histogram> write_op_duration_commit_wait_consistency;
+  scoped_refptr<Histogram> write_op_prepare_queue_duration;
+  scoped_refptr<Histogram> write_op_prepare_duration;
+  scoped_refptr<Histogram> write_op_row_lock_duration;
+  scoped_refptr<Histogram> write_op_replication_duration;
+  scoped_refptr<Histogram> write_op_apply_queue_duration;
+  scoped_refptr<Histogram> write_op_apply_duration;
 
   scoped_refptr<AtomicGauge<uint32_t> > flush_dms_running;
   scoped_refptr<AtomicGauge<uint32_t> > flush_mrs_running;
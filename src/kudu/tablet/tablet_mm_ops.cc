@@ -23,6 +23,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/tablet.h"
@@ -56,6 +57,10 @@ string TabletOpBase::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+void TabletOpBase::GetIODevices(std::vector<std::string>* devices) const {
+  tablet_->GetDataDirUuids(devices);
+}
+
 ////////////////////////////////////////////////////////////
 // CompactRowSetsOp
 ////////////////////////////////////////////////////////////
@@ -105,6 +110,7 @@ bool CompactRowSetsOp::Prepare() {
 }
 
 void CompactRowSetsOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::COMPACTION);
   WARN_NOT_OK(tablet_->Compact(Tablet::COMPACT_NO_FLAGS),
               Substitute("$0Compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -176,6 +182,7 @@ bool MinorDeltaCompactionOp::Prepare() {
 }
 
 void MinorDeltaCompactionOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::COMPACTION);
   WARN_NOT_OK(tablet_->CompactWorstDeltas(RowSet::MINOR_DELTA_COMPACTION),
               Substitute("$0Minor delta compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -252,6 +259,7 @@ bool MajorDeltaCompactionOp::Prepare() {
 }
 
 void MajorDeltaCompactionOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::COMPACTION);
   WARN_NOT_OK(tablet_->CompactWorstDeltas(RowSet::MAJOR_DELTA_COMPACTION),
               Substitute("$0Major delta compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -288,6 +296,7 @@ bool UndoDeltaBlockGCOp::Prepare() {
 }
 
 void UndoDeltaBlockGCOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::GC);
   MonoDelta time_budget = MonoDelta::FromMilliseconds(FLAGS_undo_delta_block_gc_init_budget_millis);
   int64_t bytes_in_ancient_undos = 0;
   Status s = tablet_->InitAncientUndoDeltas(time_budget, &bytes_in_ancient_undos);
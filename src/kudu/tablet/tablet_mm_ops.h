@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -42,6 +43,8 @@ class TabletOpBase : public MaintenanceOp {
   TabletOpBase(std::string name, IOUsage io_usage, Tablet* tablet);
   std::string LogPrefix() const;
 
+  virtual void GetIODevices(std::vector<std::string>* devices) const OVERRIDE;
+
  protected:
   Tablet* const tablet_;
 };
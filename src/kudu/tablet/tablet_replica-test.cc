@@ -20,6 +20,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -77,6 +78,7 @@
 METRIC_DECLARE_entity(tablet);
 
 DECLARE_int32(flush_threshold_mb);
+DECLARE_int32(tablet_apply_batch_max_txns);
 
 namespace kudu {
 namespace tablet {
@@ -97,6 +99,7 @@ using rpc::Messenger;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
 
@@ -569,6 +572,48 @@ TEST_F(TabletReplicaTest, TestGCEmptyLog) {
   ASSERT_OK(tablet_replica_->RunLogGC());
 }
 
+class TabletReplicaBatchedApplyTest : public TabletReplicaTest {
+ public:
+  void SetUp() override {
+    FLAGS_tablet_apply_batch_max_txns = 8;
+    TabletReplicaTest::SetUp();
+  }
+};
+
+// Test that concurrent writes applied in batches are all applied and
+// committed.
+TEST_F(TabletReplicaBatchedApplyTest, TestConcurrentWrites) {
+  ConsensusBootstrapInfo info;
+  ASSERT_OK(StartReplicaAndWaitUntilLeader(info));
+
+  const int kNumWrites = 100;
+  vector<unique_ptr<WriteRequestPB>> reqs;
+  vector<unique_ptr<WriteResponsePB>> resps;
+  CountDownLatch latch(kNumWrites);
+  for (int i = 0; i < kNumWrites; i++) {
+    reqs.emplace_back(new WriteRequestPB());
+    resps.emplace_back(new WriteResponsePB());
+    ASSERT_OK(GenerateSequentialInsertRequest(reqs.back().get()));
+    unique_ptr<WriteTransactionState> tx_state(
+        new WriteTransactionState(tablet_replica_.get(), reqs.back().get(),
+                                  nullptr, resps.back().get()));
+    tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+        new LatchTransactionCompletionCallback<WriteResponsePB>(&latch, resps.back().get())));
+    ASSERT_OK(tablet_replica_->SubmitWrite(std::move(tx_state)));
+  }
+  latch.Wait();
+  for (const auto& resp : resps) {
+    ASSERT_FALSE(resp->has_error()) << SecureDebugString(*resp);
+  }
+
+  uint64_t count;
+  ASSERT_OK(tablet()->CountRows(&count));
+  ASSERT_EQ(kNumWrites, static_cast<int>(count));
+  ASSERT_EVENTUALLY([&] {
+      ASSERT_EQ(0, tablet()->mvcc_manager()->CountTransactionsInFlight());
+    });
+}
+
 TEST_F(TabletReplicaTest, TestFlushOpsPerfImprovements) {
   FLAGS_flush_threshold_mb = 64;
 
@@ -26,6 +26,7 @@
 #include <type_traits>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/clock/clock.h"
@@ -49,6 +50,7 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/metrics.h"
@@ -58,6 +60,15 @@
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(tablet_apply_batch_max_txns, 1,
+             "Maximum number of consecutive replicated transactions of a tablet "
+             "which are applied together, committing their MVCC transactions in "
+             "bulk. Batching amortizes the per-transaction overhead of small "
+             "writes, but applies the transactions of a tablet on a single thread "
+             "at a time. If 1, every transaction is applied by its own task.");
+TAG_FLAG(tablet_apply_batch_max_txns, experimental);
+TAG_FLAG(tablet_apply_batch_max_txns, advanced);
+
 METRIC_DEFINE_histogram(tablet, op_prepare_queue_length, "Operation Prepare Queue Length",
                         kudu::MetricUnit::kTasks,
                         "Number of operations waiting to be prepared within this tablet. "
@@ -129,6 +140,9 @@ TabletReplica::TabletReplica(
       mark_dirty_clbk_(std::move(mark_dirty_clbk)),
       state_(NOT_INITIALIZED),
       last_status_("Tablet initializing...") {
+  if (FLAGS_tablet_apply_batch_max_txns > 1) {
+    apply_queue_ = new TransactionApplyQueue(apply_pool_, FLAGS_tablet_apply_batch_max_txns);
+  }
 }
 
 TabletReplica::~TabletReplica() {
@@ -646,7 +660,8 @@ Status TabletReplica::NewLeaderTransactionDriver(gscoped_ptr<Transaction> transa
     log_.get(),
     prepare_pool_token_.get(),
     apply_pool_,
-    &txn_order_verifier_);
+    &txn_order_verifier_,
+    apply_queue_.get());
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::LEADER));
   driver->swap(tx_driver);
 
@@ -661,7 +676,8 @@ Status TabletReplica::NewReplicaTransactionDriver(gscoped_ptr<Transaction> trans
     log_.get(),
     prepare_pool_token_.get(),
     apply_pool_,
-    &txn_order_verifier_);
+    &txn_order_verifier_,
+    apply_queue_.get());
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::REPLICA));
   driver->swap(tx_driver);
 
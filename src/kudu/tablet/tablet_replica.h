@@ -19,10 +19,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -74,9 +76,14 @@ class Messenger;
 class ResultTracker;
 } // namespace rpc
 
+namespace tserver {
+class WriteRequestPB;
+} // namespace tserver
+
 namespace tablet {
 class AlterSchemaTransactionState;
 class TabletStatusPB;
+class TransactionApplyQueue;
 class TransactionDriver;
 class WriteTransactionState;
 
@@ -88,6 +95,13 @@ class WriteTransactionState;
 class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
                       public consensus::ReplicaTransactionFactory {
  public:
+  // Invoked with the index of the operation, the request and whether any of
+  // the row operations failed, for each write this replica applies as a
+  // follower. See SetReplicaWriteCallback().
+  typedef std::function<void(int64_t op_index,
+                             const tserver::WriteRequestPB& request,
+                             bool has_row_errors)> ReplicaWriteCallback;
+
   TabletReplica(scoped_refptr<TabletMetadata> meta,
                 scoped_refptr<consensus::ConsensusMetadataManager> cmeta_manager,
                 consensus::RaftPeerPB local_peer_pb,
@@ -297,6 +311,18 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // Return the total on-disk size of this tablet replica, in bytes.
   size_t OnDiskSize() const;
 
+  // Sets the callback invoked for each write applied by this replica as a
+  // follower, once the write is committed but before its row locks are
+  // released: the callbacks for writes to the same row are thus invoked in
+  // the order of the writes. Must be called before Start().
+  void SetReplicaWriteCallback(ReplicaWriteCallback cb) {
+    replica_write_cb_ = std::move(cb);
+  }
+
+  const ReplicaWriteCallback& replica_write_callback() const {
+    return replica_write_cb_;
+  }
+
  private:
   friend class RefCountedThreadSafe<TabletReplica>;
   friend class TabletReplicaTest;
@@ -328,12 +354,19 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // the Tablet server.
   ThreadPool* const apply_pool_;
 
+  // If set, applies the transactions of this replica in batches on
+  // 'apply_pool_'. See --tablet_apply_batch_max_txns.
+  scoped_refptr<TransactionApplyQueue> apply_queue_;
+
   // Function to mark this TabletReplica's tablet as dirty in the TSTabletManager.
   //
   // Must be called whenever cluster membership or leadership changes, or when
   // the tablet's schema changes.
   const Callback<void(const std::string& reason)> mark_dirty_clbk_;
 
+  // See SetReplicaWriteCallback().
+  ReplicaWriteCallback replica_write_cb_;
+
   TabletStatePB state_;
   Status error_;
   TransactionTracker txn_tracker_;
@@ -21,10 +21,12 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/fs/io_throttler.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -115,6 +117,8 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
   }
 
   stats->set_ram_anchored(tablet_replica_->tablet()->MemRowSetSize());
+  // The flush writes out the MemRowSet's rows.
+  stats->set_io_bytes(tablet_replica_->tablet()->MemRowSetSize());
   stats->set_logs_retained_bytes(
       tablet_replica_->tablet()->MemRowSetLogReplaySize(replay_size_map));
 
@@ -133,6 +137,7 @@ bool FlushMRSOp::Prepare() {
 }
 
 void FlushMRSOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::FLUSH);
   Tablet* tablet = tablet_replica_->tablet();
   CHECK(!tablet->rowsets_flush_sem_.try_lock());
   SCOPED_CLEANUP({
@@ -161,6 +166,10 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushMRSOp::RunningGauge() const {
   return tablet_replica_->tablet()->metrics()->flush_mrs_running;
 }
 
+void FlushMRSOp::GetIODevices(std::vector<std::string>* devices) const {
+  tablet_replica_->tablet()->GetDataDirUuids(devices);
+}
+
 //
 // FlushDeltaMemStoresOp.
 //
@@ -187,6 +196,7 @@ void FlushDeltaMemStoresOp::UpdateStats(MaintenanceOpStats* stats) {
 }
 
 void FlushDeltaMemStoresOp::Perform() {
+  fs::ScopedIOPriority io_priority(fs::IOPriority::FLUSH);
   map<int64_t, int64_t> max_idx_to_replay_size;
   if (!tablet_replica_->GetReplaySizeMap(&max_idx_to_replay_size).ok()) {
     LOG(WARNING) << "Won't flush deltas since tablet shutting down: "
@@ -215,6 +225,10 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushDeltaMemStoresOp::RunningGauge() cons
   return tablet_replica_->tablet()->metrics()->flush_dms_running;
 }
 
+void FlushDeltaMemStoresOp::GetIODevices(std::vector<std::string>* devices) const {
+  tablet_replica_->tablet()->GetDataDirUuids(devices);
+}
+
 //
 // LogGCOp.
 //
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -67,6 +68,8 @@ class FlushMRSOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual void GetIODevices(std::vector<std::string>* devices) const OVERRIDE;
+
  private:
   // Lock protecting time_since_flush_.
   mutable simple_spinlock lock_;
@@ -99,6 +102,8 @@ class FlushDeltaMemStoresOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual void GetIODevices(std::vector<std::string>* devices) const OVERRIDE;
+
  private:
   // Lock protecting time_since_flush_
   mutable simple_spinlock lock_;
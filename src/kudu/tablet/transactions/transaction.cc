@@ -76,7 +76,13 @@ TransactionMetrics::TransactionMetrics()
     successful_upserts(0),
     successful_updates(0),
     successful_deletes(0),
-    commit_wait_duration_usec(0) {
+    commit_wait_duration_usec(0),
+    prepare_queue_duration_usec(0),
+    prepare_duration_usec(0),
+    row_lock_duration_usec(0),
+    replication_duration_usec(0),
+    apply_queue_duration_usec(0),
+    apply_duration_usec(0) {
 }
 
 void TransactionMetrics::Reset() {
@@ -84,6 +90,12 @@ void TransactionMetrics::Reset() {
   successful_updates = 0;
   successful_deletes = 0;
   commit_wait_duration_usec = 0;
+  prepare_queue_duration_usec = 0;
+  prepare_duration_usec = 0;
+  row_lock_duration_usec = 0;
+  replication_duration_usec = 0;
+  apply_queue_duration_usec = 0;
+  apply_duration_usec = 0;
 }
 
 
@@ -51,6 +51,7 @@ class Message;
 
 namespace kudu {
 namespace tablet {
+class ScopedTransaction;
 class TabletReplica;
 class TransactionCompletionCallback;
 class TransactionState;
@@ -64,6 +65,21 @@ struct TransactionMetrics {
   int successful_updates;
   int successful_deletes;
   uint64_t commit_wait_duration_usec;
+
+  // The time spent in each of the stages of the transaction.
+  //
+  // Waiting in the prepare pool's queue.
+  uint64_t prepare_queue_duration_usec;
+  // Preparing, including acquiring the row locks.
+  uint64_t prepare_duration_usec;
+  // Acquiring the row locks.
+  uint64_t row_lock_duration_usec;
+  // Replicating through consensus, including appending to the local WAL.
+  uint64_t replication_duration_usec;
+  // Waiting in the apply pool's queue.
+  uint64_t apply_queue_duration_usec;
+  // Applying to the tablet.
+  uint64_t apply_duration_usec;
 };
 
 // Base class for transactions.
@@ -159,6 +175,11 @@ class TransactionState {
   // This will only return a non-null object for leader-side transactions.
   virtual google::protobuf::Message* response() const { return NULL; }
 
+  // Returns the MVCC transaction of this transaction, if it has one and it
+  // hasn't been released yet. Used to commit a batch of applied transactions
+  // together.
+  virtual ScopedTransaction* mvcc_tx() { return nullptr; }
+
   // Returns whether the results of the transaction are being tracked.
   bool are_results_tracked() const {
     return result_tracker_.get() != nullptr && has_request_id();
@@ -23,6 +23,7 @@
 #include <ostream>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 #include <google/protobuf/descriptor.h>
@@ -66,6 +67,7 @@ using pb_util::SecureShortDebugString;
 using rpc::RequestIdPB;
 using rpc::ResultTracker;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 static const char* kTimestampFieldName = "timestamp";
@@ -109,13 +111,15 @@ TransactionDriver::TransactionDriver(TransactionTracker *txn_tracker,
                                      Log* log,
                                      ThreadPoolToken* prepare_pool_token,
                                      ThreadPool* apply_pool,
-                                     TransactionOrderVerifier* order_verifier)
+                                     TransactionOrderVerifier* order_verifier,
+                                     TransactionApplyQueue* apply_queue)
     : txn_tracker_(txn_tracker),
       consensus_(consensus),
       log_(log),
       prepare_pool_token_(prepare_pool_token),
       apply_pool_(apply_pool),
       order_verifier_(order_verifier),
+      apply_queue_(apply_queue),
       trace_(new Trace()),
       start_time_(MonoTime::Now()),
       replication_state_(NOT_REPLICATING),
@@ -241,6 +245,8 @@ Status TransactionDriver::ExecuteAsync() {
 
 void TransactionDriver::PrepareTask() {
   TRACE_EVENT_FLOW_END0("txn", "PrepareTask", this);
+  mutable_state()->mutable_metrics()->prepare_queue_duration_usec =
+      (MonoTime::Now() - start_time_).ToMicroseconds();
   Status prepare_status = Prepare();
   if (PREDICT_FALSE(!prepare_status.ok())) {
     HandleFailure(prepare_status);
@@ -282,7 +288,10 @@ Status TransactionDriver::Prepare() {
   // Actually prepare and start the transaction.
   prepare_physical_timestamp_ = GetMonoTimeMicros();
 
+  const MonoTime prepare_start_time = MonoTime::Now();
   RETURN_NOT_OK(transaction_->Prepare());
+  mutable_state()->mutable_metrics()->prepare_duration_usec =
+      (MonoTime::Now() - prepare_start_time).ToMicroseconds();
 
   // Only take the lock long enough to take a local copy of the
   // replication state and set our prepare state. This ensures that
@@ -363,7 +372,7 @@ Status TransactionDriver::Prepare() {
 void TransactionDriver::HandleFailure(const Status& s) {
   VLOG_WITH_PREFIX(2) << "Failed transaction: " << s.ToString();
   CHECK(!s.ok());
-  TRACE("HandleFailure($0)", s.ToString());
+  TRACE_BINARY("HandleFailure($0)", s.ToString());
 
   ReplicationState repl_state_copy;
 
@@ -435,6 +444,8 @@ void TransactionDriver::ReplicationFinished(const Status& status) {
   }
 
   TRACE_COUNTER_INCREMENT("replication_time_us", replication_duration.ToMicroseconds());
+  mutable_state()->mutable_metrics()->replication_duration_usec =
+      replication_duration.ToMicroseconds();
 
   // If we have prepared and replicated, we're ready
   // to move ahead and apply this operation.
@@ -490,17 +501,31 @@ Status TransactionDriver::ApplyAsync() {
     }
   }
 
+  apply_submit_time_ = MonoTime::Now();
+  if (apply_queue_) {
+    return apply_queue_->Submit(this);
+  }
   TRACE_EVENT_FLOW_BEGIN0("txn", "ApplyTask", this);
   return apply_pool_->SubmitClosure(Bind(&TransactionDriver::ApplyTask, Unretained(this)));
 }
 
 void TransactionDriver::ApplyTask() {
   TRACE_EVENT_FLOW_END0("txn", "ApplyTask", this);
+
+  // We need to ref-count ourself, since Commit() may run very quickly
+  // and end up calling Finalize() while we're still in this code.
+  scoped_refptr<TransactionDriver> ref(this);
+  if (ApplyAndAppendCommit()) {
+    Finalize();
+  }
+}
+
+bool TransactionDriver::ApplyAndAppendCommit() {
   ADOPT_TRACE(trace());
   Tablet* tablet = state()->tablet_replica()->tablet();
   if (tablet->HasBeenStopped()) {
     HandleFailure(Status::IllegalState("Not Applying transaction; the tablet is stopped"));
-    return;
+    return false;
   }
 
   {
@@ -509,18 +534,19 @@ void TransactionDriver::ApplyTask() {
     DCHECK_EQ(prepare_state_, PREPARED);
   }
 
-  // We need to ref-count ourself, since Commit() may run very quickly
-  // and end up calling Finalize() while we're still in this code.
-  scoped_refptr<TransactionDriver> ref(this);
-
   {
+    TransactionMetrics* metrics = mutable_state()->mutable_metrics();
+    const MonoTime apply_start_time = MonoTime::Now();
+    metrics->apply_queue_duration_usec =
+        (apply_start_time - apply_submit_time_).ToMicroseconds();
     gscoped_ptr<CommitMsg> commit_msg;
     Status s = transaction_->Apply(&commit_msg);
+    metrics->apply_duration_usec = (MonoTime::Now() - apply_start_time).ToMicroseconds();
     if (PREDICT_FALSE(!s.ok())) {
       LOG(WARNING) << Substitute("Did not Apply transaction $0: $1",
           transaction_->ToString(), s.ToString());
       HandleFailure(s);
-      return;
+      return false;
     }
     commit_msg->mutable_commited_op_id()->CopyFrom(op_id_copy_);
     SetResponseTimestamp(transaction_->state(), transaction_->state()->timestamp());
@@ -537,16 +563,15 @@ void TransactionDriver::ApplyTask() {
     // until now.earliest > prepare_latest. Only after this are the locks
     // released.
     if (mutable_state()->external_consistency_mode() == COMMIT_WAIT) {
-      TRACE("APPLY: Commit Wait.");
+      TRACE_BINARY("APPLY: Commit Wait.");
       // If we can't commit wait and have already applied we might have consistency
       // issues if we still reply to the client that the operation was a success.
       // On the other hand we don't have rollbacks as of yet thus we can't undo the
       // the apply either, so we just CHECK_OK for now.
       CHECK_OK(CommitWait());
     }
-
-    Finalize();
   }
+  return true;
 }
 
 void TransactionDriver::SetResponseTimestamp(TransactionState* transaction_state,
@@ -581,6 +606,84 @@ void TransactionDriver::Finalize() {
 }
 
 
+////////////////////////////////////////////////////////////
+// TransactionApplyQueue
+////////////////////////////////////////////////////////////
+
+TransactionApplyQueue::TransactionApplyQueue(ThreadPool* apply_pool, int max_batch_size)
+    : apply_pool_(apply_pool),
+      max_batch_size_(max_batch_size),
+      draining_(false) {
+  DCHECK_GT(max_batch_size_, 0);
+}
+
+Status TransactionApplyQueue::Submit(const scoped_refptr<TransactionDriver>& driver) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  queue_.push_back(driver);
+  if (draining_) {
+    return Status::OK();
+  }
+  // The task holds a reference to the queue, which may otherwise be destroyed
+  // as soon as its last transaction is finalized.
+  scoped_refptr<TransactionApplyQueue> self(this);
+  Status s = apply_pool_->SubmitFunc([self]() { self->ApplyBatchesTask(); });
+  if (PREDICT_FALSE(!s.ok())) {
+    queue_.pop_back();
+    return s;
+  }
+  draining_ = true;
+  return Status::OK();
+}
+
+void TransactionApplyQueue::ApplyBatchesTask() {
+  vector<scoped_refptr<TransactionDriver>> batch;
+  batch.reserve(max_batch_size_);
+  while (true) {
+    batch.clear();
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (queue_.empty()) {
+        draining_ = false;
+        return;
+      }
+      while (!queue_.empty() && batch.size() < max_batch_size_) {
+        batch.emplace_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    ApplyBatch(batch);
+  }
+}
+
+void TransactionApplyQueue::ApplyBatch(const vector<scoped_refptr<TransactionDriver>>& batch) {
+  TRACE_EVENT1("txn", "TransactionApplyQueue::ApplyBatch", "num_txns", batch.size());
+  vector<TransactionDriver*> applied;
+  applied.reserve(batch.size());
+  vector<ScopedTransaction*> mvcc_txns;
+  mvcc_txns.reserve(batch.size());
+  for (const auto& driver : batch) {
+    if (!driver->ApplyAndAppendCommit()) {
+      continue;
+    }
+    applied.push_back(driver.get());
+    ScopedTransaction* mvcc_tx = driver->mutable_state()->mvcc_tx();
+    if (mvcc_tx) {
+      mvcc_txns.push_back(mvcc_tx);
+    }
+  }
+
+  // The writes of the whole batch become visible to scanners at once.
+  ScopedTransaction::CommitAll(mvcc_txns);
+
+  for (TransactionDriver* driver : applied) {
+    {
+      ADOPT_TRACE(driver->trace());
+      TRACE_BINARY("APPLY: committed in a batch of $0 transactions", batch.size());
+    }
+    driver->Finalize();
+  }
+}
+
 std::string TransactionDriver::StateString(ReplicationState repl_state,
                                            PrepareState prep_state) {
   string state_str;
@@ -17,7 +17,9 @@
 
 #pragma once
 
+#include <deque>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -47,6 +49,7 @@ class RaftConsensus;
 }
 
 namespace tablet {
+class TransactionApplyQueue;
 class TransactionOrderVerifier;
 class TransactionTracker;
 
@@ -85,7 +88,8 @@ class TransactionTracker;
 //
 //      If Prepare() has already completed, then we trigger ApplyAsync().
 //
-//  5 - ApplyAsync() submits ApplyTask() to the apply_pool_.
+//  5 - ApplyAsync() submits ApplyTask() to the apply_pool_, or queues the
+//      transaction on the apply_queue_, which applies it in a batch.
 //      ApplyTask() calls transaction_->Apply().
 //
 //      When Apply() is called, changes are made to the in-memory data structures. These
@@ -225,12 +229,16 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
  public:
   // Construct TransactionDriver. TransactionDriver does not take ownership
   // of any of the objects pointed to in the constructor's arguments.
+  //
+  // If 'apply_queue' isn't null, the transaction is applied as part of a
+  // batch by 'apply_queue' rather than by its own task on 'apply_pool'.
   TransactionDriver(TransactionTracker* txn_tracker,
                     consensus::RaftConsensus* consensus,
                     log::Log* log,
                     ThreadPoolToken* prepare_pool_token,
                     ThreadPool* apply_pool,
-                    TransactionOrderVerifier* order_verifier);
+                    TransactionOrderVerifier* order_verifier,
+                    TransactionApplyQueue* apply_queue);
 
   // Perform any non-constructor initialization. Sets the transaction
   // that will be executed.
@@ -280,6 +288,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
  private:
   FRIEND_TEST(TabletReplicaTest, TestShuttingDownMVCC);
   friend class RefCountedThreadSafe<TransactionDriver>;
+  friend class TransactionApplyQueue;
   enum ReplicationState {
     // The operation has not yet been sent to consensus for replication
     NOT_REPLICATING,
@@ -311,13 +320,19 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   // Actually prepare.
   Status Prepare();
 
-  // Submits ApplyTask to the apply pool.
+  // Submits ApplyTask to the apply pool, or queues the transaction on
+  // 'apply_queue_' to be applied as part of a batch.
   Status ApplyAsync();
 
-  // Calls Transaction::Apply() followed by RaftConsensus::Commit() with the
-  // results from the Apply().
+  // Calls ApplyAndAppendCommit() followed by Finalize().
   void ApplyTask();
 
+  // Calls Transaction::Apply() and appends the resulting CommitMsg to the
+  // WAL, commit-waiting if required. Returns false if the transaction
+  // failed, in which case HandleFailure() was already called; otherwise the
+  // transaction must then be finalized with Finalize().
+  bool ApplyAndAppendCommit();
+
   // Sleeps until the transaction is allowed to commit based on the
   // requested consistency mode.
   Status CommitWait();
@@ -356,6 +371,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   ThreadPoolToken* const prepare_pool_token_;
   ThreadPool* const apply_pool_;
   TransactionOrderVerifier* const order_verifier_;
+  TransactionApplyQueue* const apply_queue_;
 
   Status transaction_status_;
 
@@ -383,6 +399,9 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   const MonoTime start_time_;
   MonoTime replication_start_time_;
 
+  // When the transaction was submitted to be applied.
+  MonoTime apply_submit_time_;
+
   ReplicationState replication_state_;
   PrepareState prepare_state_;
 
@@ -393,6 +412,56 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   DISALLOW_COPY_AND_ASSIGN(TransactionDriver);
 };
 
+// Applies the replicated transactions of a tablet in batches.
+//
+// Transactions are queued in the order they're submitted, and a single task
+// at a time drains the queue on the apply pool, in batches of up to
+// 'max_batch_size' transactions: the transactions of a batch are applied
+// and their commit messages appended one after the other, then their MVCC
+// transactions are committed together with a single acquisition of the
+// MvccManager lock, and finally the transactions are finalized, releasing
+// their locks and responding to their clients.
+//
+// This amortizes the per-transaction overhead of the apply pool, and of the
+// MVCC commit, over many small transactions, at the cost of applying the
+// transactions of a tablet on a single thread at a time.
+//
+// This class is thread safe.
+class TransactionApplyQueue : public RefCountedThreadSafe<TransactionApplyQueue> {
+ public:
+  TransactionApplyQueue(ThreadPool* apply_pool, int max_batch_size);
+
+  // Queues 'driver' to be applied, submitting a task to drain the queue if
+  // there isn't one already. Returns an error if the task couldn't be
+  // submitted, in which case 'driver' isn't queued.
+  Status Submit(const scoped_refptr<TransactionDriver>& driver);
+
+ private:
+  friend class RefCountedThreadSafe<TransactionApplyQueue>;
+
+  ~TransactionApplyQueue() {}
+
+  // Applies batches of queued transactions until the queue is empty.
+  void ApplyBatchesTask();
+
+  // Applies the transactions of 'batch', in order.
+  void ApplyBatch(const std::vector<scoped_refptr<TransactionDriver>>& batch);
+
+  ThreadPool* const apply_pool_;
+  const int max_batch_size_;
+
+  // Protects the fields below.
+  simple_spinlock lock_;
+
+  // The transactions waiting to be applied, in order.
+  std::deque<scoped_refptr<TransactionDriver>> queue_;
+
+  // Whether a task is submitted to drain the queue.
+  bool draining_;
+
+  DISALLOW_COPY_AND_ASSIGN(TransactionApplyQueue);
+};
+
 }  // namespace tablet
 }  // namespace kudu
 
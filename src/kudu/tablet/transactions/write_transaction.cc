@@ -56,6 +56,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rw_semaphore.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/trace.h"
 
 DEFINE_int32(tablet_inject_latency_on_apply_write_txn_ms, 0,
@@ -91,6 +92,17 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
   replicate_msg->reset(new ReplicateMsg);
   (*replicate_msg)->set_op_type(WRITE_OP);
   (*replicate_msg)->mutable_write_request()->CopyFrom(*state()->request());
+  RowOperationsPB* row_ops = (*replicate_msg)->mutable_write_request()->mutable_row_operations();
+  if (row_ops->has_rows_sidecar()) {
+    // The replicas and the WAL only see the request, so the rows are copied
+    // from the sidecars into it.
+    Slice rows = state()->rows_data();
+    Slice indirect_data = state()->indirect_data();
+    row_ops->clear_rows_sidecar();
+    row_ops->clear_indirect_data_sidecar();
+    row_ops->set_rows(rows.data(), rows.size());
+    row_ops->set_indirect_data(indirect_data.data(), indirect_data.size());
+  }
   if (state()->are_results_tracked()) {
     (*replicate_msg)->mutable_request_id()->CopyFrom(state()->request_id());
   }
@@ -98,7 +110,7 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
 
 Status WriteTransaction::Prepare() {
   TRACE_EVENT0("txn", "WriteTransaction::Prepare");
-  TRACE("PREPARE: Starting");
+  TRACE_BINARY("PREPARE: Starting");
   // Decode everything first so that we give up if something major is wrong.
   Schema client_schema;
   RETURN_NOT_OK_PREPEND(SchemaFromPB(state_->request()->schema(), &client_schema),
@@ -121,9 +133,12 @@ Status WriteTransaction::Prepare() {
   }
 
   // Now acquire row locks and prepare everything for apply
+  const MonoTime lock_start_time = MonoTime::Now();
   RETURN_NOT_OK(tablet->AcquireRowLocks(state()));
+  state()->mutable_metrics()->row_lock_duration_usec =
+      (MonoTime::Now() - lock_start_time).ToMicroseconds();
 
-  TRACE("PREPARE: finished.");
+  TRACE_BINARY("PREPARE: finished.");
   return Status::OK();
 }
 
@@ -133,12 +148,13 @@ void WriteTransaction::AbortPrepare() {
 
 Status WriteTransaction::Start() {
   TRACE_EVENT0("txn", "WriteTransaction::Start");
-  TRACE("Start()");
+  TRACE_BINARY("Start()");
   DCHECK(!state_->has_timestamp());
   DCHECK(state_->consensus_round()->replicate_msg()->has_timestamp());
   state_->set_timestamp(Timestamp(state_->consensus_round()->replicate_msg()->timestamp()));
   state_->tablet_replica()->tablet()->StartTransaction(state_.get());
-  TRACE("Timestamp: $0", state_->tablet_replica()->clock()->Stringify(state_->timestamp()));
+  TRACE_BINARY("Timestamp: $0",
+               state_->tablet_replica()->clock()->Stringify(state_->timestamp()));
   return Status::OK();
 }
 
@@ -146,17 +162,24 @@ Status WriteTransaction::Start() {
 // it seems pointless to return a Status!
 Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
   TRACE_EVENT0("txn", "WriteTransaction::Apply");
-  TRACE("APPLY: Starting");
+  TRACE_BINARY("APPLY: Starting");
 
   if (PREDICT_FALSE(
           ANNOTATE_UNPROTECTED_READ(FLAGS_tablet_inject_latency_on_apply_write_txn_ms) > 0)) {
-    TRACE("Injecting $0ms of latency due to --tablet_inject_latency_on_apply_write_txn_ms",
-          FLAGS_tablet_inject_latency_on_apply_write_txn_ms);
+    TRACE_BINARY("Injecting $0ms of latency due to --tablet_inject_latency_on_apply_write_txn_ms",
+                 FLAGS_tablet_inject_latency_on_apply_write_txn_ms);
     SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_inject_latency_on_apply_write_txn_ms));
   }
 
   Tablet* tablet = state()->tablet_replica()->tablet();
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
   RETURN_NOT_OK(tablet->ApplyRowOperations(state()));
+  sw.stop();
+  if (tablet->metrics()) {
+    const CpuTimes cpu = sw.elapsed();
+    tablet->metrics()->write_apply_cpu_time_us->IncrementBy((cpu.user + cpu.system) / 1000);
+  }
 
   // Add per-row errors to the result, update metrics.
   int i = 0;
@@ -184,16 +207,25 @@ Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
 void WriteTransaction::Finish(TransactionResult result) {
   TRACE_EVENT0("txn", "WriteTransaction::Finish");
 
+  // Notify of the write while still holding its row locks.
+  if (result == Transaction::COMMITTED && type() == consensus::REPLICA) {
+    const auto& cb = state()->tablet_replica()->replica_write_callback();
+    if (cb) {
+      cb(state()->op_id().index(), *state()->request(),
+         state()->response()->per_row_errors_size() > 0);
+    }
+  }
+
   state()->CommitOrAbort(result);
 
   if (PREDICT_FALSE(result == Transaction::ABORTED)) {
-    TRACE("FINISH: transaction aborted");
+    TRACE_BINARY("FINISH: transaction aborted");
     return;
   }
 
   DCHECK_EQ(result, Transaction::COMMITTED);
 
-  TRACE("FINISH: updating metrics");
+  TRACE_BINARY("FINISH: updating metrics");
 
   TabletMetrics* metrics = state_->tablet_replica()->tablet()->metrics();
   if (metrics) {
@@ -208,6 +240,15 @@ void WriteTransaction::Finish(TransactionResult result) {
       if (state()->external_consistency_mode() == COMMIT_WAIT) {
         metrics->commit_wait_duration->Increment(state_->metrics().commit_wait_duration_usec);
       }
+      const TransactionMetrics& txn_metrics = state_->metrics();
+      metrics->write_op_prepare_queue_duration->Increment(
+          txn_metrics.prepare_queue_duration_usec);
+      metrics->write_op_prepare_duration->Increment(txn_metrics.prepare_duration_usec);
+      metrics->write_op_row_lock_duration->Increment(txn_metrics.row_lock_duration_usec);
+      metrics->write_op_replication_duration->Increment(txn_metrics.replication_duration_usec);
+      metrics->write_op_apply_queue_duration->Increment(txn_metrics.apply_queue_duration_usec);
+      metrics->write_op_apply_duration->Increment(txn_metrics.apply_duration_usec);
+
       uint64_t op_duration_usec =
           (MonoTime::Now() - start_time_).ToMicroseconds();
       switch (state()->external_consistency_mode()) {
@@ -265,16 +306,16 @@ void WriteTransactionState::set_tablet_components(
 }
 
 void WriteTransactionState::AcquireSchemaLock(rw_semaphore* schema_lock) {
-  TRACE("Acquiring schema lock in shared mode");
+  TRACE_BINARY("Acquiring schema lock in shared mode");
   shared_lock<rw_semaphore> temp(*schema_lock);
   schema_lock_.swap(temp);
-  TRACE("Acquired schema lock");
+  TRACE_BINARY("Acquired schema lock");
 }
 
 void WriteTransactionState::ReleaseSchemaLock() {
   shared_lock<rw_semaphore> temp;
   schema_lock_.swap(temp);
-  TRACE("Released schema lock");
+  TRACE_BINARY("Released schema lock");
 }
 
 void WriteTransactionState::SetRowOps(vector<DecodedRowOperation> decoded_ops) {
@@ -306,7 +347,7 @@ void WriteTransactionState::StartApplying() {
 void WriteTransactionState::CommitOrAbort(Transaction::TransactionResult result) {
   ReleaseMvccTxn(result);
 
-  TRACE("Releasing row and schema locks");
+  TRACE_BINARY("Releasing row and schema locks");
   ReleaseRowLocks();
   ReleaseSchemaLock();
 
@@ -321,7 +362,11 @@ void WriteTransactionState::ReleaseMvccTxn(Transaction::TransactionResult result
     // Commit the transaction.
     switch (result) {
       case Transaction::COMMITTED:
-        mvcc_tx_->Commit();
+        // The transaction may have been committed along with the rest of
+        // its apply batch.
+        if (!mvcc_tx_->is_done()) {
+          mvcc_tx_->Commit();
+        }
         break;
       case Transaction::ABORTED:
         mvcc_tx_->Abort();
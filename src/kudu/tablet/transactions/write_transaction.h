@@ -36,6 +36,7 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -100,6 +101,27 @@ class WriteTransactionState : public TransactionState {
     return request_;
   }
 
+  // Sets the encoded rows and indirect data of the request's row operations,
+  // when they were received in RPC sidecars rather than in the request. The
+  // slices point into the inbound call, which lives until the response is
+  // sent, after the transaction is applied.
+  void set_row_operations_sidecars(Slice rows, Slice indirect_data) {
+    DCHECK(request_->row_operations().has_rows_sidecar());
+    rows_sidecar_ = rows;
+    indirect_data_sidecar_ = indirect_data;
+  }
+
+  // Returns the encoded rows and indirect data of the request's row
+  // operations, either from the sidecars which were set, or from the request.
+  Slice rows_data() const {
+    return request_->row_operations().has_rows_sidecar() ?
+        rows_sidecar_ : Slice(request_->row_operations().rows());
+  }
+  Slice indirect_data() const {
+    return request_->row_operations().has_rows_sidecar() ?
+        indirect_data_sidecar_ : Slice(request_->row_operations().indirect_data());
+  }
+
   // Returns the prepared response to the client that will be sent when this
   // transaction is completed, if this transaction was started by a client.
   tserver::WriteResponsePB *response() const OVERRIDE {
@@ -112,6 +134,10 @@ class WriteTransactionState : public TransactionState {
   // WriteTransactionState object.
   void SetMvccTx(gscoped_ptr<ScopedTransaction> mvcc_tx);
 
+  ScopedTransaction* mvcc_tx() OVERRIDE {
+    return mvcc_tx_.get();
+  }
+
   // Set the Tablet components that this transaction will write into.
   // Called exactly once at the beginning of Apply, before applying its
   // in-memory edits.
@@ -202,6 +228,10 @@ class WriteTransactionState : public TransactionState {
   const tserver::WriteRequestPB* request_;
   tserver::WriteResponsePB* response_;
 
+  // The rows and indirect data of the request, if they were sent in sidecars.
+  Slice rows_sidecar_;
+  Slice indirect_data_sidecar_;
+
   // The row operations which are decoded from the request during PREPARE
   // Protected by superclass's txn_state_lock_.
   std::vector<RowOp*> row_ops_;
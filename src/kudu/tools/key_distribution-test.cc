@@ -0,0 +1,108 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/key_distribution.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+
+const uint64_t kNumKeys = 1000;
+const int kNumSamples = 100000;
+
+// Returns how many times every key was chosen out of 'kNumSamples' draws.
+vector<int> Histogram(KeyChooser* chooser) {
+  vector<int> counts(kNumKeys);
+  for (int i = 0; i < kNumSamples; i++) {
+    uint64_t key = chooser->Next(kNumKeys);
+    CHECK_LT(key, kNumKeys);
+    counts[key]++;
+  }
+  return counts;
+}
+
+} // anonymous namespace
+
+TEST(KeyDistributionTest, TestCreate) {
+  unique_ptr<KeyChooser> chooser;
+  for (const char* name : { "uniform", "zipfian", "latest" }) {
+    ASSERT_OK(KeyChooser::Create(name, 0, &chooser));
+    ASSERT_LT(chooser->Next(1), 1);
+  }
+  Status s = KeyChooser::Create("hotspot", 0, &chooser);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST(KeyDistributionTest, TestUniform) {
+  UniformKeyChooser chooser(0);
+  vector<int> counts = Histogram(&chooser);
+  // Every key is expected to be chosen about 100 times.
+  for (int count : counts) {
+    ASSERT_GT(count, 50);
+    ASSERT_LT(count, 150);
+  }
+}
+
+TEST(KeyDistributionTest, TestZipfian) {
+  ZipfianKeyChooser chooser(0);
+  vector<int> counts = Histogram(&chooser);
+  // With theta = 0.99 and 1000 keys, the first key makes up about 13% of the
+  // draws, and the key of rank i about 1/i of that.
+  ASSERT_GT(counts[0], kNumSamples / 10);
+  ASSERT_LT(counts[0], kNumSamples / 6);
+  ASSERT_GT(counts[0], counts[1]);
+  ASSERT_GT(counts[1], counts[9]);
+  ASSERT_GT(counts[9], counts[99]);
+  ASSERT_GT(counts[0], 50 * counts[99]);
+}
+
+TEST(KeyDistributionTest, TestLatest) {
+  LatestKeyChooser chooser(0);
+  vector<int> counts = Histogram(&chooser);
+  ASSERT_GT(counts[kNumKeys - 1], kNumSamples / 10);
+  ASSERT_GT(counts[kNumKeys - 1], counts[kNumKeys - 10]);
+  ASSERT_GT(counts[kNumKeys - 10], counts[kNumKeys - 100]);
+}
+
+// The zeta constant keeps up with the number of keys as it grows.
+TEST(KeyDistributionTest, TestZipfianGrowingKeys) {
+  ZipfianKeyChooser chooser(0);
+  for (uint64_t num_keys = 1; num_keys <= kNumKeys; num_keys++) {
+    ASSERT_LT(chooser.Next(num_keys), num_keys);
+  }
+  ZipfianKeyChooser fresh(0);
+  vector<int> grown = Histogram(&chooser);
+  vector<int> direct = Histogram(&fresh);
+  ASSERT_NEAR(grown[0], direct[0], kNumSamples / 100);
+}
+
+} // namespace tools
+} // namespace kudu
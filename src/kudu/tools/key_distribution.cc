@@ -0,0 +1,87 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/key_distribution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/substitute.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace tools {
+
+Status KeyChooser::Create(const string& name, uint64_t seed,
+                          unique_ptr<KeyChooser>* chooser) {
+  if (name == "uniform") {
+    chooser->reset(new UniformKeyChooser(seed));
+  } else if (name == "zipfian") {
+    chooser->reset(new ZipfianKeyChooser(seed));
+  } else if (name == "latest") {
+    chooser->reset(new LatestKeyChooser(seed));
+  } else {
+    return Status::InvalidArgument(
+        strings::Substitute("unknown key distribution '$0'", name));
+  }
+  return Status::OK();
+}
+
+ZipfianKeyChooser::ZipfianKeyChooser(uint64_t seed, double theta)
+    : random_(seed),
+      theta_(theta),
+      alpha_(1.0 / (1.0 - theta)),
+      zeta_2_(1.0 + std::pow(0.5, theta)) {
+  CHECK(theta > 0 && theta < 1) << "invalid theta: " << theta;
+}
+
+void ZipfianKeyChooser::UpdateZeta(uint64_t num_keys) {
+  if (num_keys < num_keys_) {
+    num_keys_ = 0;
+    zeta_n_ = 0;
+  }
+  for (uint64_t i = num_keys_ + 1; i <= num_keys; i++) {
+    zeta_n_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+  }
+  num_keys_ = num_keys;
+  eta_ = (1.0 - std::pow(2.0 / num_keys, 1.0 - theta_)) / (1.0 - zeta_2_ / zeta_n_);
+}
+
+uint64_t ZipfianKeyChooser::Next(uint64_t num_keys) {
+  DCHECK_GT(num_keys, 0);
+  if (num_keys != num_keys_) {
+    UpdateZeta(num_keys);
+  }
+  const double u = random_.NextDoubleFraction();
+  const double uz = u * zeta_n_;
+  if (uz < 1.0) {
+    return 0;
+  }
+  if (uz < zeta_2_) {
+    return std::min<uint64_t>(1, num_keys - 1);
+  }
+  const auto key = static_cast<uint64_t>(
+      num_keys * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+  return std::min(key, num_keys - 1);
+}
+
+} // namespace tools
+} // namespace kudu
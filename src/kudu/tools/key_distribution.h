@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Distributions of the keys accessed by a workload, modeled after the
+// generators of the Yahoo! Cloud Serving Benchmark (YCSB).
+
+#ifndef KUDU_TOOLS_KEY_DISTRIBUTION_H_
+#define KUDU_TOOLS_KEY_DISTRIBUTION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tools {
+
+// Chooses the keys accessed by a workload among the keys in [0, num_keys),
+// where 'num_keys' may grow as the workload inserts new keys.
+//
+// Not thread-safe: every workload thread should use its own instance.
+class KeyChooser {
+ public:
+  virtual ~KeyChooser() = default;
+
+  // Returns a key in [0, num_keys). 'num_keys' must be positive.
+  virtual uint64_t Next(uint64_t num_keys) = 0;
+
+  // Creates the chooser for the distribution named 'name', which is one of
+  // "uniform", "zipfian" or "latest".
+  static Status Create(const std::string& name, uint64_t seed,
+                       std::unique_ptr<KeyChooser>* chooser);
+};
+
+// Every key is equally likely to be chosen.
+class UniformKeyChooser : public KeyChooser {
+ public:
+  explicit UniformKeyChooser(uint64_t seed)
+      : random_(seed) {
+  }
+
+  uint64_t Next(uint64_t num_keys) override {
+    return random_.Uniform64(num_keys);
+  }
+
+ private:
+  Random random_;
+
+  DISALLOW_COPY_AND_ASSIGN(UniformKeyChooser);
+};
+
+// The smaller keys are chosen much more often than the larger ones: the
+// probability of choosing the i-th key is proportional to 1 / (i + 1)^theta.
+//
+// This is the algorithm from "Quickly Generating Billion-Record Synthetic
+// Databases" by Gray et al, as implemented by YCSB, including the incremental
+// computation of the zeta constant as the number of keys grows.
+class ZipfianKeyChooser : public KeyChooser {
+ public:
+  static constexpr double kDefaultTheta = 0.99;
+
+  explicit ZipfianKeyChooser(uint64_t seed, double theta = kDefaultTheta);
+
+  uint64_t Next(uint64_t num_keys) override;
+
+ private:
+  // Brings 'zeta_n_' up to date with 'num_keys'.
+  void UpdateZeta(uint64_t num_keys);
+
+  Random random_;
+  const double theta_;
+  const double alpha_;
+  const double zeta_2_;
+
+  // zeta(n, theta) for n = 'num_keys_'.
+  uint64_t num_keys_ = 0;
+  double zeta_n_ = 0;
+  double eta_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipfianKeyChooser);
+};
+
+// The most recently inserted keys, ie the largest ones, are chosen much more
+// often than the older ones, following a Zipfian distribution.
+class LatestKeyChooser : public KeyChooser {
+ public:
+  explicit LatestKeyChooser(uint64_t seed)
+      : zipfian_(seed) {
+  }
+
+  uint64_t Next(uint64_t num_keys) override {
+    return num_keys - 1 - zipfian_.Next(num_keys);
+  }
+
+ private:
+  ZipfianKeyChooser zipfian_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatestKeyChooser);
+};
+
+} // namespace tools
+} // namespace kudu
+
+#endif // KUDU_TOOLS_KEY_DISTRIBUTION_H_
@@ -53,7 +53,12 @@ DEFINE_int32(checksum_timeout_sec, 3600,
              "Maximum total seconds to wait for a checksum scan to complete "
              "before timing out.");
 DEFINE_int32(checksum_scan_concurrency, 4,
-             "Number of concurrent checksum scans to execute per tablet server.");
+             "Number of concurrent checksum scans to execute per tablet server. "
+             "Each scan keeps a tablet server thread and the disk holding the "
+             "replica's data busy.");
+DEFINE_validator(checksum_scan_concurrency, [](const char* /*n*/, int32_t v) {
+  return v > 0;
+});
 DEFINE_bool(checksum_snapshot, true, "Should the checksum scanner use a snapshot scan");
 DEFINE_uint64(checksum_snapshot_timestamp,
               kudu::tools::ChecksumOptions::kCurrentTimestamp,
@@ -17,7 +17,9 @@
 
 #include "kudu/tools/ksck_remote.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <ostream>
 #include <unordered_map>
 #include <utility>
@@ -36,17 +38,21 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus.proxy.h"
+#include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/master/master.proxy.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/server/server_base.pb.h"
 #include "kudu/server/server_base.proxy.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/tools/tool_action_common.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.pb.h"
@@ -54,9 +60,16 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/threadpool.h"
 
 DECLARE_int64(timeout_ms); // defined in tool_action_common
 DEFINE_bool(checksum_cache_blocks, false, "Should the checksum scanners cache the read blocks");
+DEFINE_int32(fetch_table_info_page_size, 100,
+             "Number of tables to fetch the tablet locations of from the master "
+             "per request.");
+DEFINE_int32(fetch_table_info_concurrency, 4,
+             "Number of concurrent requests to fetch the tablet locations of the "
+             "tables from the master with.");
 
 namespace kudu {
 namespace tools {
@@ -71,6 +84,10 @@ using client::KuduScanTokenBuilder;
 using client::KuduTable;
 using client::KuduTabletServer;
 using client::internal::ReplicaController;
+using master::ListTablesRequestPB;
+using master::ListTablesResponsePB;
+using master::MasterFeatures;
+using master::MasterServiceProxy;
 using rpc::Messenger;
 using rpc::MessengerBuilder;
 using rpc::RpcController;
@@ -83,6 +100,88 @@ MonoDelta GetDefaultTimeout() {
   return MonoDelta::FromMilliseconds(FLAGS_timeout_ms);
 }
 
+namespace {
+
+// The number of table names listed per request to the master.
+const int kMaxTableNamesPerPage = 10000;
+
+// Lists the names of all the tables, in order, page by page.
+Status ListTableNames(LeaderMasterProxy* proxy, vector<string>* table_names) {
+  ListTablesRequestPB req;
+  req.set_max_returned_tables(kMaxTableNamesPerPage);
+  while (true) {
+    ListTablesResponsePB resp;
+    RETURN_NOT_OK((proxy->SyncRpc<ListTablesRequestPB, ListTablesResponsePB>(
+        req, &resp, "ListTables", &MasterServiceProxy::ListTables,
+        { MasterFeatures::LIST_TABLES_PAGING })));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+    for (const auto& table : resp.tables()) {
+      table_names->push_back(table.name());
+    }
+    if (!resp.has_next_page_token()) {
+      return Status::OK();
+    }
+    req.set_page_token(resp.next_page_token());
+  }
+}
+
+// Fetches the schemas and the tablet locations of the tables named after
+// 'page_token' up to and including 'last_table_name', page by page.
+Status FetchTables(LeaderMasterProxy* proxy,
+                   const string& page_token,
+                   const string& last_table_name,
+                   vector<shared_ptr<KsckTable>>* tables) {
+  ListTablesRequestPB req;
+  req.set_max_returned_tables(FLAGS_fetch_table_info_page_size);
+  req.set_include_tablet_locations(true);
+  req.set_replica_type_filter(master::ANY_REPLICA);
+  if (!page_token.empty()) {
+    req.set_page_token(page_token);
+  }
+  while (true) {
+    ListTablesResponsePB resp;
+    RETURN_NOT_OK((proxy->SyncRpc<ListTablesRequestPB, ListTablesResponsePB>(
+        req, &resp, "ListTables", &MasterServiceProxy::ListTables,
+        { MasterFeatures::LIST_TABLES_PAGING })));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+    for (const auto& table_pb : resp.tables()) {
+      if (table_pb.name() > last_table_name) {
+        // The rest of the tables are fetched by another request.
+        return Status::OK();
+      }
+      Schema schema;
+      RETURN_NOT_OK(SchemaFromPB(table_pb.schema(), &schema));
+      auto table = std::make_shared<KsckTable>(table_pb.name(), schema,
+                                               table_pb.num_replicas());
+      vector<shared_ptr<KsckTablet>> tablets;
+      for (const auto& locs : table_pb.tablet_locations()) {
+        auto tablet = std::make_shared<KsckTablet>(table.get(), locs.tablet_id());
+        vector<shared_ptr<KsckTabletReplica>> replicas;
+        for (const auto& r : locs.replicas()) {
+          const bool is_leader = r.role() == consensus::RaftPeerPB::LEADER;
+          const bool is_voter = is_leader || r.role() == consensus::RaftPeerPB::FOLLOWER;
+          replicas.push_back(std::make_shared<KsckTabletReplica>(
+              r.ts_info().permanent_uuid(), is_leader, is_voter));
+        }
+        tablet->set_replicas(std::move(replicas));
+        tablets.emplace_back(std::move(tablet));
+      }
+      table->set_tablets(std::move(tablets));
+      tables->emplace_back(std::move(table));
+    }
+    if (!resp.has_next_page_token() || resp.next_page_token() >= last_table_name) {
+      return Status::OK();
+    }
+    req.set_page_token(resp.next_page_token());
+  }
+}
+
+} // anonymous namespace
+
 Status RemoteKsckTabletServer::Init() {
   vector<Sockaddr> addresses;
   RETURN_NOT_OK(ParseAddressList(
@@ -359,6 +458,49 @@ Status RemoteKsckMaster::RetrieveTabletServers(TSMap* tablet_servers) {
 }
 
 Status RemoteKsckMaster::RetrieveTablesList(vector<shared_ptr<KsckTable>>* tables) {
+  LeaderMasterProxy proxy;
+  proxy.Init(client_);
+
+  // List the names of the tables first, so that the tables can be split into
+  // ranges whose schemas and tablet locations are fetched concurrently.
+  vector<string> table_names;
+  Status s = ListTableNames(&proxy, &table_names);
+  if (s.IsRemoteError()) {
+    LOG(INFO) << "Unable to list the tables in pages, falling back to fetching "
+              << "them one by one: " << s.ToString();
+    return RetrieveTablesListOneByOne(tables);
+  }
+  RETURN_NOT_OK(s);
+
+  const size_t page_size = FLAGS_fetch_table_info_page_size;
+  const size_t num_pages = (table_names.size() + page_size - 1) / page_size;
+  vector<vector<shared_ptr<KsckTable>>> pages(num_pages);
+  vector<Status> page_statuses(num_pages);
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("ksck-fetch-tables")
+                .set_max_threads(FLAGS_fetch_table_info_concurrency)
+                .Build(&pool));
+  for (size_t i = 0; i < num_pages; i++) {
+    const string page_token = i == 0 ? "" : table_names[i * page_size - 1];
+    const string last_table_name =
+        table_names[std::min(table_names.size(), (i + 1) * page_size) - 1];
+    CHECK_OK(pool->SubmitFunc([&, i, page_token, last_table_name]() {
+          page_statuses[i] = FetchTables(&proxy, page_token, last_table_name, &pages[i]);
+        }));
+  }
+  pool->Wait();
+
+  vector<shared_ptr<KsckTable>> tables_temp;
+  for (size_t i = 0; i < num_pages; i++) {
+    RETURN_NOT_OK_PREPEND(page_statuses[i], "unable to fetch table info from the master");
+    std::move(pages[i].begin(), pages[i].end(), std::back_inserter(tables_temp));
+  }
+  tables->swap(tables_temp);
+  tablets_listed_with_tables_ = true;
+  return Status::OK();
+}
+
+Status RemoteKsckMaster::RetrieveTablesListOneByOne(vector<shared_ptr<KsckTable>>* tables) {
   vector<string> table_names;
   RETURN_NOT_OK(client_->ListTables(&table_names));
 
@@ -373,10 +515,16 @@ Status RemoteKsckMaster::RetrieveTablesList(vector<shared_ptr<KsckTable>>* table
     tables_temp.push_back(table);
   }
   tables->assign(tables_temp.begin(), tables_temp.end());
+  tablets_listed_with_tables_ = false;
   return Status::OK();
 }
 
 Status RemoteKsckMaster::RetrieveTabletsList(const shared_ptr<KsckTable>& table) {
+  if (tablets_listed_with_tables_) {
+    // The tablets were fetched along with the list of tables.
+    return Status::OK();
+  }
+
   vector<shared_ptr<KsckTablet>> tablets;
 
   client::sp::shared_ptr<KuduTable> client_table;
@@ -114,13 +114,21 @@ class RemoteKsckMaster : public KsckMaster {
   RemoteKsckMaster(std::vector<std::string> master_addresses,
                    std::shared_ptr<rpc::Messenger> messenger)
       : master_addresses_(std::move(master_addresses)),
-        messenger_(std::move(messenger)) {
+        messenger_(std::move(messenger)),
+        tablets_listed_with_tables_(false) {
   }
 
+  // Gets the list of tables by opening each table, for masters which don't
+  // support listing the tables in pages along with their tablets.
+  Status RetrieveTablesListOneByOne(std::vector<std::shared_ptr<KsckTable>>* tables);
+
   const std::vector<std::string> master_addresses_;
   const std::shared_ptr<rpc::Messenger> messenger_;
 
   client::sp::shared_ptr<client::KuduClient> client_;
+
+  // Whether the tablets of the tables were fetched by RetrieveTablesList().
+  bool tablets_listed_with_tables_;
 };
 
 } // namespace tools
@@ -36,6 +36,7 @@
 #include <glog/stl_logging.h>
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
+#include <rapidjson/document.h>
 
 #include "kudu/cfile/cfile-test-base.h"
 #include "kudu/cfile/cfile_util.h"
@@ -98,7 +99,9 @@
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/int128_util.h" // IWYU pragma: keep
+#include "kudu/util/jsonreader.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -490,6 +493,11 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kPerfRegexes = {
         "loadgen.*Run load generation with optional scan afterwards",
+        "table_scan.*Measure the throughput of scanning a table",
+        "tablet_bulk_load.*Compare the write throughput of a local tablet",
+        "wal.*Measure the latency of the appends, syncs and rolls of a WAL",
+        "workload.*Run a mix of reads, scans and writes and report their latencies",
+        "write_stages.*Show where the time of the writes led by a tablet server goes",
     };
     NO_FATALS(RunTestHelp("perf", kPerfRegexes));
   }
@@ -506,6 +514,7 @@ TEST_F(ToolTest, TestModeHelp) {
   }
   {
     const vector<string> kTableModeRegexes = {
+        "copy.*Copy the rows of a table to another table",
         "delete.*Delete a table",
         "list.*List all tables",
     };
@@ -538,6 +547,8 @@ TEST_F(ToolTest, TestModeHelp) {
         "set_flag.*Change a gflag value",
         "status.*Get the status",
         "timestamp.*Get the current timestamp",
+        "drain.*Transfer the leaderships",
+        "undrain.*Let a drained Kudu Tablet Server",
         "list.*List tablet servers"
     };
     NO_FATALS(RunTestHelp("tserver", kTServerModeRegexes));
@@ -1429,6 +1440,158 @@ TEST_F(ToolTest, TestLoadgenManualFlush) {
       "bench_manual_flush"));
 }
 
+TEST_F(ToolTest, TestTableScan) {
+  const string kTableName = "bench_table_scan";
+  NO_FATALS(RunLoadgen(1, { "--num_rows_per_thread=1000" }, kTableName));
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 $1 --num_threads=2 --scan_columns=key,int32_val "
+      "--scan_predicates=key>=0 --scan_replica_selection=LEADER_ONLY",
+      cluster_->master()->bound_rpc_addr().ToString(), kTableName), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "tablets    : 2");
+  ASSERT_STR_CONTAINS(stdout, "rows       : 2000");
+  ASSERT_STR_CONTAINS(stdout, "cells_read: ");
+  ASSERT_STR_NOT_CONTAINS(stdout, "cells_read: 0\n");
+
+  // Nothing passes contradictory predicates.
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 $1 --scan_predicates=key<0",
+      cluster_->master()->bound_rpc_addr().ToString(), kTableName), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "rows       : 0");
+
+  string stderr;
+  Status s = RunActionStderrString(Substitute(
+      "perf table_scan $0 $1 --scan_predicates=nonexistent=1",
+      cluster_->master()->bound_rpc_addr().ToString(), kTableName), &stderr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "no such column");
+}
+
+TEST_F(ToolTest, TestTableCopy) {
+  const string kTableName = "table_copy_src";
+  NO_FATALS(RunLoadgen(1, { "--num_rows_per_thread=1000" }, kTableName));
+  const string master_addr = cluster_->master()->bound_rpc_addr().ToString();
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "table copy $0 $1 --dst_table=table_copy_dst --create_table --num_threads=2",
+      master_addr, kTableName), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Copied 2000 rows");
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 table_copy_dst", master_addr), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "rows       : 2000");
+
+  // Inserting the same rows again fails, but upserting them succeeds.
+  string stderr;
+  Status s = RunActionStderrString(Substitute(
+      "table copy $0 $1 --dst_table=table_copy_dst", master_addr, kTableName), &stderr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "key already present");
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "table copy $0 $1 --dst_table=table_copy_dst --write_type=upsert",
+      master_addr, kTableName), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Copied 2000 rows");
+
+  // Only the rows which pass the predicates are copied.
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "table copy $0 $1 --dst_table=table_copy_dst --write_type=upsert "
+      "--scan_predicates=key<0", master_addr, kTableName), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Copied 0 rows");
+
+  // A table can't be copied onto itself.
+  s = RunActionStderrString(Substitute(
+      "table copy $0 $1", master_addr, kTableName), &stderr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "the destination table must differ");
+}
+
+TEST_F(ToolTest, TestTabletBulkLoad) {
+  const string kRootDir = GetTestPath("bulk_load");
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf tablet_bulk_load $0 --bulk_load_num_rows=10000 --bulk_load_batch_size=1000",
+      kRootDir), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Tablet load report (10000 rows)");
+  ASSERT_STR_CONTAINS(stdout, "bulk load");
+  ASSERT_FALSE(env_->FileExists(kRootDir));
+}
+
+TEST_F(ToolTest, TestWal) {
+  const string kRootDir = GetTestPath("wal");
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf wal $0 --format=csv --num_threads=2 --wal_duration_secs=1 "
+      "--log_force_fsync_all --log_segment_size_mb=1 --wal_entry_size_bytes=10000",
+      kRootDir), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "WAL report (2 threads");
+  const string rows = "\n" + stdout;
+  for (const char* hist : { "batch durable", "append", "sync", "group commit" }) {
+    ASSERT_STR_CONTAINS(rows, Substitute("\n$0,", hist));
+    ASSERT_STR_NOT_CONTAINS(rows, Substitute("\n$0,us,0,", hist));
+  }
+  ASSERT_FALSE(env_->FileExists(kRootDir));
+}
+
+TEST_F(ToolTest, TestWriteStages) {
+  NO_FATALS(RunLoadgen(1));
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf write_stages $0 --format=csv",
+      cluster_->tablet_server(0)->bound_http_hostport().ToString()), &stdout));
+  // The writes of loadgen went through all the stages but commit wait.
+  const string rows = "\n" + stdout;
+  for (const char* stage : { "prepare queue", "prepare", "replication",
+                             "apply queue", "apply" }) {
+    ASSERT_STR_CONTAINS(rows, Substitute("\n$0,", stage));
+    ASSERT_STR_NOT_CONTAINS(rows, Substitute("\n$0,0,", stage));
+  }
+  ASSERT_STR_CONTAINS(rows, "\ncommit wait,0,");
+}
+
+TEST_F(ToolTest, TestWorkload) {
+  NO_FATALS(StartExternalMiniCluster());
+  const string kReportFile = GetTestPath("workload.json");
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf workload $0 --num_threads=2 --workload_record_count=1000 "
+      "--workload_duration_secs=3 --workload_target_qps=300 "
+      "--workload_key_distribution=latest "
+      "--workload_read_proportion=0.3 --workload_scan_proportion=0.2 "
+      "--workload_insert_proportion=0.1 --workload_update_proportion=0.2 "
+      "--workload_upsert_proportion=0.1 --workload_delete_proportion=0.1 "
+      "--workload_report_file=$1",
+      cluster_->master()->bound_rpc_addr().ToString(), kReportFile), &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Loading 1000 records");
+
+  // Every type of operation was run and shows up in the report.
+  faststring buf;
+  ASSERT_OK(ReadFileToString(env_, kReportFile, &buf));
+  JsonReader r(buf.ToString());
+  ASSERT_OK(r.Init());
+  const rapidjson::Value* ops;
+  ASSERT_OK(r.ExtractObject(r.root(), "ops", &ops));
+  for (const char* op : { "read", "scan", "insert", "update", "upsert", "delete" }) {
+    SCOPED_TRACE(op);
+    const rapidjson::Value* op_report;
+    ASSERT_OK(r.ExtractObject(ops, op, &op_report));
+    int64_t count;
+    ASSERT_OK(r.ExtractInt64(op_report, "count", &count));
+    ASSERT_GT(count, 0);
+    const rapidjson::Value* latency;
+    ASSERT_OK(r.ExtractObject(op_report, "latency_us", &latency));
+    int64_t p99;
+    ASSERT_OK(r.ExtractInt64(latency, "p99", &p99));
+    ASSERT_GT(p99, 0);
+  }
+  // The reads and scans aren't expected to fail.
+  for (const char* op : { "read", "scan" }) {
+    const rapidjson::Value* op_report;
+    ASSERT_OK(r.ExtractObject(ops, op, &op_report));
+    int64_t errors;
+    ASSERT_OK(r.ExtractInt64(op_report, "errors", &errors));
+    ASSERT_EQ(0, errors);
+  }
+}
+
 // Test 'kudu remote_replica copy' tool when the destination tablet server is online.
 // 1. Test the copy tool when the destination replica is healthy
 // 2. Test the copy tool when the destination replica is tombstoned
@@ -1810,6 +1973,36 @@ TEST_F(ToolTest, TestTserverList) {
   }
 }
 
+TEST_F(ToolTest, TestTserverDrain) {
+  const int kNumTablets = 6;
+  ExternalMiniClusterOptions opts;
+  opts.num_tablet_servers = 3;
+  NO_FATALS(StartExternalMiniCluster(std::move(opts)));
+
+  TestWorkload workload(cluster_.get());
+  workload.set_num_tablets(kNumTablets);
+  workload.set_num_replicas(3);
+  workload.Setup();
+
+  // Once drained, the tablet server leads none of the tablets, and doesn't
+  // take any leadership back while its peers are alive.
+  const string ts_addr = cluster_->tablet_server(0)->bound_rpc_addr().ToString();
+  string out;
+  NO_FATALS(RunActionStdoutString(
+      Substitute("tserver drain $0 --timeout_ms=60000", ts_addr), &out));
+  ASSERT_STR_CONTAINS(out, "leads no tablets");
+
+  workload.Start();
+  while (workload.rows_inserted() < 1000) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  workload.StopAndJoin();
+  NO_FATALS(RunActionStdoutString(Substitute("tserver drain $0", ts_addr), &out));
+  ASSERT_STR_CONTAINS(out, "leads no tablets");
+
+  NO_FATALS(RunActionStdoutNone(Substitute("tserver undrain $0", ts_addr)));
+}
+
 TEST_F(ToolTest, TestMasterList) {
   ExternalMiniClusterOptions opts;
   opts.num_tablet_servers = 0;
@@ -28,6 +28,7 @@
 #include <numeric>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
@@ -37,7 +38,10 @@
 
 #include "kudu/client/client-internal.h"  // IWYU pragma: keep
 #include "kudu/client/client.h"
+#include "kudu/client/scan_predicate.h"
+#include "kudu/client/schema.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/value.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
@@ -52,6 +56,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.proxy.h" // IWYU pragma: keep
 #include "kudu/rpc/messenger.h"
@@ -104,13 +109,21 @@ namespace kudu {
 namespace master {
 class ListMastersRequestPB;
 class ListMastersResponsePB;
+class ListTablesRequestPB;
+class ListTablesResponsePB;
 class ListTabletServersRequestPB;
 class ListTabletServersResponsePB;
 } // namespace master
 
 namespace tools {
 
+using client::KuduClient;
 using client::KuduClientBuilder;
+using client::KuduColumnSchema;
+using client::KuduPredicate;
+using client::KuduSchema;
+using client::KuduTable;
+using client::KuduValue;
 using consensus::ConsensusServiceProxy;
 using consensus::ReplicateMsg;
 using log::LogEntryPB;
@@ -120,6 +133,8 @@ using master::ListTabletServersRequestPB;
 using master::ListTabletServersResponsePB;
 using master::ListMastersRequestPB;
 using master::ListMastersResponsePB;
+using master::ListTablesRequestPB;
+using master::ListTablesResponsePB;
 using master::MasterServiceProxy;
 using pb_util::SecureDebugString;
 using pb_util::SecureShortDebugString;
@@ -399,6 +414,95 @@ Status PrintServerTimestamp(const string& address, uint16_t default_port) {
   return Status::OK();
 }
 
+Status ParseScanPredicate(const string& predicate, KuduTable* table,
+                          KuduPredicate** pred) {
+  const size_t op_pos = predicate.find_first_of("<>=");
+  if (op_pos == string::npos || op_pos == 0) {
+    return Status::InvalidArgument("invalid predicate", predicate);
+  }
+  size_t value_pos = op_pos + 1;
+  KuduPredicate::ComparisonOp op;
+  if (predicate[op_pos] == '=') {
+    op = KuduPredicate::EQUAL;
+  } else {
+    const bool or_equal = value_pos < predicate.size() && predicate[value_pos] == '=';
+    if (or_equal) {
+      value_pos++;
+    }
+    if (predicate[op_pos] == '<') {
+      op = or_equal ? KuduPredicate::LESS_EQUAL : KuduPredicate::LESS;
+    } else {
+      op = or_equal ? KuduPredicate::GREATER_EQUAL : KuduPredicate::GREATER;
+    }
+  }
+  string column = predicate.substr(0, op_pos);
+  string value = predicate.substr(value_pos);
+  StripWhiteSpace(&column);
+  StripWhiteSpace(&value);
+
+  const KuduSchema& schema = table->schema();
+  int col_idx = -1;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    if (schema.Column(i).name() == column) {
+      col_idx = i;
+      break;
+    }
+  }
+  if (col_idx == -1) {
+    return Status::NotFound("no such column", column);
+  }
+  const Status bad_value = Status::InvalidArgument(
+      Substitute("invalid value for column $0", column), value);
+  unique_ptr<KuduValue> kudu_value;
+  switch (schema.Column(col_idx).type()) {
+    case KuduColumnSchema::INT8:
+    case KuduColumnSchema::INT16:
+    case KuduColumnSchema::INT32:
+    case KuduColumnSchema::INT64:
+    case KuduColumnSchema::UNIXTIME_MICROS: {
+      int64_t v;
+      if (!safe_strto64(value, &v)) {
+        return bad_value;
+      }
+      kudu_value.reset(KuduValue::FromInt(v));
+      break;
+    }
+    case KuduColumnSchema::FLOAT: {
+      float v;
+      if (!safe_strtof(value, &v)) {
+        return bad_value;
+      }
+      kudu_value.reset(KuduValue::FromFloat(v));
+      break;
+    }
+    case KuduColumnSchema::DOUBLE: {
+      double v;
+      if (!safe_strtod(value, &v)) {
+        return bad_value;
+      }
+      kudu_value.reset(KuduValue::FromDouble(v));
+      break;
+    }
+    case KuduColumnSchema::BOOL: {
+      if (value != "true" && value != "false") {
+        return bad_value;
+      }
+      kudu_value.reset(KuduValue::FromBool(value == "true"));
+      break;
+    }
+    case KuduColumnSchema::STRING:
+    case KuduColumnSchema::BINARY:
+      kudu_value.reset(KuduValue::CopyString(value));
+      break;
+    default:
+      return Status::NotSupported(Substitute(
+          "predicates on column $0 of type $1 are not supported", column,
+          KuduColumnSchema::DataTypeToString(schema.Column(col_idx).type())));
+  }
+  *pred = table->NewComparisonPredicate(column, op, kudu_value.release());
+  return Status::OK();
+}
+
 namespace {
 
 // Pretty print a table using the psql format. For example:
@@ -557,16 +661,22 @@ Status LeaderMasterProxy::Init(const RunnerContext& context) {
                             .Build(&client_);
 }
 
+void LeaderMasterProxy::Init(client::sp::shared_ptr<KuduClient> client) {
+  client_ = std::move(client);
+}
+
 template<typename Req, typename Resp>
 Status LeaderMasterProxy::SyncRpc(const Req& req,
                                   Resp* resp,
                                   const char* func_name,
                                   const boost::function<Status(master::MasterServiceProxy*,
                                                                const Req&, Resp*,
-                                                               rpc::RpcController*)>& func) {
+                                                               rpc::RpcController*)>& func,
+                                  vector<uint32_t> required_feature_flags) {
   MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_timeout_ms);
   return client_->data_->SyncLeaderMasterRpc(deadline, client_.get(), req, resp,
-                                             func_name, func, {});
+                                             func_name, func,
+                                             std::move(required_feature_flags));
 }
 
 // Explicit specialization for callers outside this compilation unit.
@@ -577,7 +687,8 @@ Status LeaderMasterProxy::SyncRpc(const ListTabletServersRequestPB& req,
                                   const boost::function<Status(MasterServiceProxy*,
                                                                const ListTabletServersRequestPB&,
                                                                ListTabletServersResponsePB*,
-                                                               RpcController*)>& func);
+                                                               RpcController*)>& func,
+                                  vector<uint32_t> required_feature_flags);
 template
 Status LeaderMasterProxy::SyncRpc(const ListMastersRequestPB& req,
                                   ListMastersResponsePB* resp,
@@ -585,7 +696,17 @@ Status LeaderMasterProxy::SyncRpc(const ListMastersRequestPB& req,
                                   const boost::function<Status(MasterServiceProxy*,
                                                                const ListMastersRequestPB&,
                                                                ListMastersResponsePB*,
-                                                               RpcController*)>& func);
+                                                               RpcController*)>& func,
+                                  vector<uint32_t> required_feature_flags);
+template
+Status LeaderMasterProxy::SyncRpc(const ListTablesRequestPB& req,
+                                  ListTablesResponsePB* resp,
+                                  const char* func_name,
+                                  const boost::function<Status(MasterServiceProxy*,
+                                                               const ListTablesRequestPB&,
+                                                               ListTablesResponsePB*,
+                                                               RpcController*)>& func,
+                                  vector<uint32_t> required_feature_flags);
 
 const int ControlShellProtocol::kMaxMessageBytes = 1024 * 1024;
 
@@ -40,6 +40,8 @@ class faststring;
 
 namespace client {
 class KuduClient;
+class KuduPredicate;
+class KuduTable;
 } // namespace client
 
 namespace master {
@@ -111,6 +113,11 @@ Status PrintServerTimestamp(const std::string& address, uint16_t default_port);
 Status SetServerFlag(const std::string& address, uint16_t default_port,
                      const std::string& flag, const std::string& value);
 
+// Parses a predicate of the form <column><op><value> on a column of 'table',
+// where <op> is one of '=', '<', '<=', '>' or '>='.
+Status ParseScanPredicate(const std::string& predicate, client::KuduTable* table,
+                          client::KuduPredicate** pred);
+
 // A table of data to present to the user.
 //
 // Supports formatting based on the --format flag.
@@ -157,14 +164,19 @@ class LeaderMasterProxy {
   // the optional 'timeout_ms' flag to control admin and operation timeouts.
   Status Init(const RunnerContext& context);
 
-  // Calls a master RPC service method on the current leader master.
+  // Initialize the leader master proxy to send its calls through 'client'.
+  void Init(client::sp::shared_ptr<client::KuduClient> client);
+
+  // Calls a master RPC service method on the current leader master, which
+  // must support the master features in 'required_feature_flags'.
   template<typename Req, typename Resp>
   Status SyncRpc(const Req& req,
                  Resp* resp,
                  const char* func_name,
                  const boost::function<Status(master::MasterServiceProxy*,
                                               const Req&, Resp*,
-                                              rpc::RpcController*)>& func);
+                                              rpc::RpcController*)>& func,
+                 std::vector<uint32_t> required_feature_flags = {});
 
  private:
   client::sp::shared_ptr<client::KuduClient> client_;
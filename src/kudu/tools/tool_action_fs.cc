@@ -786,7 +786,11 @@ Status List(const RunnerContext& /*context*/) {
         RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
                                       rowset, "adhoc-index", boost::none,
                                       rowset.adhoc_index_block()));
-
+        for (const auto& index_block : rowset.GetSecondaryIndexBlocksById()) {
+          RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet, rowset,
+                                        "secondary-index", index_block.first,
+                                        index_block.second));
+        }
       }
     }
     // TODO(dan): should orphaned blocks be included, perhaps behind a flag?
@@ -104,44 +104,122 @@
 // so for the example above each run increments the sequence number by 10000:
 // 1000 rows per thread * 2 threads * 5 columns
 //
+//
+// Compare the time it takes to write 10M sorted rows into a local tablet
+// through the MemRowSet with the time it takes to bulk load them into new
+// DiskRowSets, in batches of 1M rows:
+//
+//   kudu perf tablet_bulk_load /tmp/bulk_load \
+//     --bulk_load_num_rows=10000000 \
+//     --bulk_load_batch_size=1000000
+//
+//
+// Measure how long it takes to append 4KB entries to a WAL on /data/1 and
+// sync them, with 8 threads appending concurrently for 30 seconds:
+//
+//   kudu perf wal /data/1/wal_bench \
+//     --num_threads=8 \
+//     --log_force_fsync_all \
+//     --wal_entry_size_bytes=4096 \
+//     --wal_duration_secs=30
+//
+//
+// Scan the 'int_val' and 'string_val' columns of the rows of table 't3' with
+// keys from 1000 to 1999, with 8 threads scanning the tablets in parallel:
+//
+//   kudu perf table_scan 127.0.0.1 t3 \
+//     --num_threads=8 \
+//     --scan_columns=int_val,string_val \
+//     --scan_predicates='key>=1000,key<2000'
+//
+//
+// Load 1M records into an auto-created table, then run a mix of 95% reads
+// and 5% updates on Zipfian-distributed keys at 20000 operations per second
+// for a minute, saving the latencies of both to a JSON file:
+//
+//   kudu perf workload 127.0.0.1 \
+//     --num_threads=16 \
+//     --workload_record_count=1000000 \
+//     --workload_read_proportion=0.95 \
+//     --workload_update_proportion=0.05 \
+//     --workload_key_distribution=zipfian \
+//     --workload_target_qps=20000 \
+//     --workload_duration_secs=60 \
+//     --workload_report_file=/tmp/workload.json
+//
 
 #include "kudu/tools/tool_action.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
+#include <rapidjson/document.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/resource_metrics.h"
 #include "kudu/client/scan_batch.h"
+#include "kudu/client/scan_predicate.h"
 #include "kudu/client/schema.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/value.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_util.h"
+#include "kudu/consensus/opid.pb.h"
+#include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-harness.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tools/key_distribution.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/curl_util.h"
 #include "kudu/util/decimal_util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/int128.h"
+#include "kudu/util/jsonreader.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 
@@ -149,24 +227,33 @@ using kudu::ColumnSchema;
 using kudu::KuduPartialRow;
 using kudu::Stopwatch;
 using kudu::TypeInfo;
+using kudu::tablet::LocalTabletWriter;
+using kudu::tablet::Tablet;
+using kudu::tablet::TabletHarness;
 using kudu::client::KuduClient;
 using kudu::client::KuduClientBuilder;
 using kudu::client::KuduColumnSchema;
 using kudu::client::KuduError;
 using kudu::client::KuduInsert;
+using kudu::client::KuduPredicate;
 using kudu::client::KuduScanBatch;
+using kudu::client::KuduScanToken;
+using kudu::client::KuduScanTokenBuilder;
 using kudu::client::KuduScanner;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSchemaBuilder;
 using kudu::client::KuduSession;
 using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
+using kudu::client::KuduUpsert;
+using kudu::client::KuduValue;
 using kudu::client::sp::shared_ptr;
 using std::accumulate;
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::lock_guard;
+using std::map;
 using std::mutex;
 using std::numeric_limits;
 using std::ostringstream;
@@ -183,6 +270,12 @@ DEFINE_int32(buffer_size_bytes, 4 * 1024 * 1024,
              "Size of the mutation buffer, per session (bytes).");
 DEFINE_int32(buffers_num, 2,
              "Number of mutation buffers per session.");
+DEFINE_int32(bulk_load_batch_size, 100000,
+             "Number of rows per batch written into the local tablet by "
+             "'kudu perf tablet_bulk_load'.");
+DEFINE_uint64(bulk_load_num_rows, 1000000,
+              "Number of rows written into the local tablet by "
+              "'kudu perf tablet_bulk_load'.");
 DEFINE_int32(error_buffer_size_bytes, 16 * 1024 * 1024,
              "Size of the error buffer, per session (bytes). 0 means 'unlimited'. "
              "This setting may impose an additional upper limit for the "
@@ -211,6 +304,22 @@ DEFINE_bool(run_scan, false,
             "the inserted rows matches the expected number. If enabled, "
             "the scan is run only if no errors were encountered "
             "while inserting the generated rows.");
+DEFINE_string(scan_columns, "",
+              "Comma-separated list of the columns projected by "
+              "'kudu perf table_scan' and 'kudu table copy'. If empty, all the "
+              "columns are projected.");
+DEFINE_bool(scan_fault_tolerant, false,
+            "Whether 'kudu perf table_scan' runs fault-tolerant scans, which "
+            "return the rows in primary key order and can resume on another "
+            "replica upon failure.");
+DEFINE_string(scan_predicates, "",
+              "Comma-separated list of the predicates of 'kudu perf table_scan' "
+              "and 'kudu table copy', each of the form <column><op><value>, where <op> is one of "
+              "'=', '<', '<=', '>' or '>='. Only the columns of integer, "
+              "floating point, boolean, string and binary types are supported.");
+DEFINE_string(scan_replica_selection, "CLOSEST_REPLICA",
+              "The replicas 'kudu perf table_scan' scans, one of LEADER_ONLY, "
+              "CLOSEST_REPLICA or FIRST_REPLICA.");
 DEFINE_uint64(seq_start, 0,
               "Initial value for the generator in sequential mode. "
               "This is useful when running multiple times against already "
@@ -254,12 +363,77 @@ DEFINE_bool(use_random, false,
             "Whether to use random numbers instead of sequential ones. "
             "In case of using random numbers collisions are possible over "
             "the data for columns with unique constraint (e.g. primary key).");
+DEFINE_int32(wal_batch_size, 1,
+             "Number of entries of every batch appended to the WAL by "
+             "'kudu perf wal'. Every thread waits for its batch to be durable "
+             "before appending the next one.");
+DEFINE_int32(wal_duration_secs, 10,
+             "How long 'kudu perf wal' appends to the WAL for, in seconds.");
+DEFINE_int32(wal_entry_size_bytes, 1024,
+             "Size of the payload of every entry appended to the WAL by "
+             "'kudu perf wal'.");
+DEFINE_double(workload_delete_proportion, 0,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "delete a row.");
+DEFINE_int32(workload_duration_secs, 10,
+             "How long 'kudu perf workload' runs its operations for, in "
+             "seconds, once the initial records are loaded.");
+DEFINE_double(workload_insert_proportion, 0,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "insert a row with a new key.");
+DEFINE_string(workload_key_distribution, "zipfian",
+              "Distribution of the keys accessed by the operations of "
+              "'kudu perf workload', one of 'uniform', 'zipfian' (a few keys "
+              "are much hotter than the rest) or 'latest' (the most recently "
+              "inserted keys are the hottest).");
+DEFINE_double(workload_read_proportion, 0.5,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "read a row by its key.");
+DEFINE_uint64(workload_record_count, 100000,
+              "Number of records 'kudu perf workload' loads into the table "
+              "before running its operations, with keys from 0 to "
+              "the number of records.");
+DEFINE_string(workload_report_file, "",
+              "If not empty, the path of the file to which 'kudu perf workload' "
+              "saves its results in JSON format.");
+DEFINE_double(workload_scan_proportion, 0,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "scan a range of rows starting at a key.");
+DEFINE_int32(workload_scan_max_rows, 100,
+             "Maximum number of rows scanned by a scan operation of "
+             "'kudu perf workload'. Every scan reads a uniformly distributed "
+             "number of rows up to that maximum.");
+DEFINE_double(workload_target_qps, 0,
+              "Target number of operations per second of 'kudu perf workload', "
+              "across all threads; 0 means 'as fast as possible'. With a target, "
+              "the operations are scheduled at a fixed rate regardless of how "
+              "long the previous ones took, and their latency is measured from "
+              "their scheduled start time.");
+DEFINE_double(workload_update_proportion, 0.5,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "update a row.");
+DEFINE_double(workload_upsert_proportion, 0,
+              "Proportion of the operations of 'kudu perf workload' which "
+              "upsert a row.");
+
+METRIC_DECLARE_counter(log_bytes_logged);
+METRIC_DECLARE_entity(tablet);
+METRIC_DECLARE_histogram(log_append_latency);
+METRIC_DECLARE_histogram(log_entry_batches_per_group);
+METRIC_DECLARE_histogram(log_group_commit_delay);
+METRIC_DECLARE_histogram(log_group_commit_latency);
+METRIC_DECLARE_histogram(log_roll_latency);
+METRIC_DECLARE_histogram(log_sync_latency);
 
 namespace kudu {
 namespace tools {
 
 namespace {
 
+const char* const kRootDirArg = "root_dir";
+const char* const kTableNameArg = "table_name";
+const char* const kWebserverAddressArg = "webserver_address";
+
 class Generator {
  public:
   enum Mode {
@@ -547,7 +721,7 @@ Status CountTableRows(const shared_ptr<KuduClient>& client,
   return Status::OK();
 }
 
-Status TestLoadGenerator(const RunnerContext& context) {
+Status CreateClient(const RunnerContext& context, shared_ptr<KuduClient>* client) {
   const string& master_addresses_str =
       FindOrDie(context.required_args, kMasterAddressesArg);
 
@@ -556,36 +730,48 @@ Status TestLoadGenerator(const RunnerContext& context) {
     return Status::InvalidArgument(
         "At least one master address must be specified");
   }
+  return KuduClientBuilder()
+      .master_server_addrs(master_addrs)
+      .Build(client);
+}
+
+// Creates a table of pre-defined columnar structure, with an INT64 primary
+// key, named after 'prefix' and a unique suffix.
+Status CreateAutoTable(const shared_ptr<KuduClient>& client,
+                       const string& prefix,
+                       string* table_name) {
+  static const string kKeyColumnName = "key";
+
+  ObjectIdGenerator oid_generator;
+  *table_name = prefix + oid_generator.Next();
+  KuduSchema schema;
+  KuduSchemaBuilder b;
+  b.AddColumn(kKeyColumnName)->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+  b.AddColumn("int_val")->Type(KuduColumnSchema::INT32);
+  b.AddColumn("string_val")->Type(KuduColumnSchema::STRING);
+  RETURN_NOT_OK(b.Build(&schema));
+
+  unique_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
+  return table_creator->table_name(*table_name)
+      .schema(&schema)
+      .num_replicas(FLAGS_table_num_replicas)
+      .add_hash_partitions(vector<string>({ kKeyColumnName }),
+                           FLAGS_table_num_buckets)
+      .wait(true)
+      .Create();
+}
+
+Status TestLoadGenerator(const RunnerContext& context) {
   shared_ptr<KuduClient> client;
-  RETURN_NOT_OK(KuduClientBuilder()
-                .master_server_addrs(master_addrs)
-                .Build(&client));
+  RETURN_NOT_OK(CreateClient(context, &client));
   string table_name;
   bool is_auto_table = false;
   if (!FLAGS_table_name.empty()) {
     table_name = FLAGS_table_name;
   } else {
-    static const string kKeyColumnName = "key";
-
     // The auto-created table case.
     is_auto_table = true;
-    ObjectIdGenerator oid_generator;
-    table_name = "loadgen_auto_" + oid_generator.Next();
-    KuduSchema schema;
-    KuduSchemaBuilder b;
-    b.AddColumn(kKeyColumnName)->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
-    b.AddColumn("int_val")->Type(KuduColumnSchema::INT32);
-    b.AddColumn("string_val")->Type(KuduColumnSchema::STRING);
-    RETURN_NOT_OK(b.Build(&schema));
-
-    unique_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
-    RETURN_NOT_OK(table_creator->table_name(table_name)
-                  .schema(&schema)
-                  .num_replicas(FLAGS_table_num_replicas)
-                  .add_hash_partitions(vector<string>({ kKeyColumnName }),
-                                       FLAGS_table_num_buckets)
-                  .wait(true)
-                  .Create());
+    RETURN_NOT_OK(CreateAutoTable(client, "loadgen_auto_", &table_name));
   }
   cout << "Using " << (is_auto_table ? "auto-created " : "")
        << "table '" << table_name << "'" << endl;
@@ -641,6 +827,849 @@ Status TestLoadGenerator(const RunnerContext& context) {
   return Status::OK();
 }
 
+// Writes --bulk_load_num_rows generated rows, sorted by key, into a new local
+// tablet in 'root_dir', through the MemRowSet and a flush or with bulk loads,
+// and returns the time it took in 'elapsed_secs'.
+Status LoadLocalTablet(const string& root_dir, bool bulk_load, double* elapsed_secs) {
+  const Schema schema({ ColumnSchema("key", INT64),
+                        ColumnSchema("int_val", INT32),
+                        ColumnSchema("string_val", STRING) }, 1);
+  TabletHarness::Options opts(root_dir);
+  opts.enable_metrics = false;
+  TabletHarness harness(schema.CopyWithColumnIds(), opts);
+  RETURN_NOT_OK(harness.Create(/*first_time=*/ true));
+  RETURN_NOT_OK(harness.Open());
+  Tablet* tablet = harness.tablet().get();
+  LocalTabletWriter writer(tablet, &schema);
+
+  // With sequential values, the keys are generated in ascending order.
+  Generator gen(Generator::MODE_SEQ, 0, FLAGS_string_len);
+  const size_t batch_size = std::max(FLAGS_bulk_load_batch_size, 1);
+  vector<KuduPartialRow> rows(batch_size, KuduPartialRow(&schema));
+  Stopwatch sw;
+  sw.start();
+  for (uint64_t num_written = 0; num_written < FLAGS_bulk_load_num_rows;) {
+    size_t num_rows = std::min<uint64_t>(batch_size, FLAGS_bulk_load_num_rows - num_written);
+    for (size_t i = 0; i < num_rows; i++) {
+      RETURN_NOT_OK(GenerateRowData(&gen, &rows[i], FLAGS_string_fixed));
+    }
+    if (bulk_load) {
+      RowOperationsPB ops;
+      RowOperationsPBEncoder enc(&ops);
+      for (size_t i = 0; i < num_rows; i++) {
+        enc.Add(RowOperationsPB::INSERT, rows[i]);
+      }
+      RETURN_NOT_OK(tablet->BulkLoadSortedRows(&schema, ops));
+    } else {
+      vector<LocalTabletWriter::Op> ops;
+      ops.reserve(num_rows);
+      for (size_t i = 0; i < num_rows; i++) {
+        ops.emplace_back(RowOperationsPB::INSERT, &rows[i]);
+      }
+      RETURN_NOT_OK(writer.WriteBatch(ops));
+    }
+    num_written += num_rows;
+  }
+  if (!bulk_load) {
+    RETURN_NOT_OK(tablet->Flush());
+  }
+  sw.stop();
+  *elapsed_secs = sw.elapsed().wall_seconds();
+  tablet->Shutdown();
+  return Status::OK();
+}
+
+// Compares the time it takes to write rows into a local tablet through the
+// MemRowSet with the time it takes to bulk load them.
+Status TestTabletBulkLoad(const RunnerContext& context) {
+  const string& root_dir = FindOrDie(context.required_args, kRootDirArg);
+  Env* env = Env::Default();
+  if (env->FileExists(root_dir)) {
+    return Status::AlreadyPresent("root directory already exists", root_dir);
+  }
+  RETURN_NOT_OK(env->CreateDir(root_dir));
+  SCOPED_CLEANUP({
+    WARN_NOT_OK(env->DeleteRecursively(root_dir),
+                "Could not delete the root directory");
+  });
+
+  double memrowset_secs;
+  double bulk_load_secs;
+  RETURN_NOT_OK(LoadLocalTablet(JoinPathSegments(root_dir, "memrowset"),
+                                /*bulk_load=*/ false, &memrowset_secs));
+  RETURN_NOT_OK(LoadLocalTablet(JoinPathSegments(root_dir, "bulk_load"),
+                                /*bulk_load=*/ true, &bulk_load_secs));
+  const double num_rows = static_cast<double>(FLAGS_bulk_load_num_rows);
+  cout << "Tablet load report (" << FLAGS_bulk_load_num_rows << " rows)" << endl
+       << "  MemRowSet and flush: " << memrowset_secs << " s, "
+       << num_rows / memrowset_secs << " rows/s" << endl
+       << "  bulk load          : " << bulk_load_secs << " s, "
+       << num_rows / bulk_load_secs << " rows/s" << endl;
+  return Status::OK();
+}
+
+// The results of scanning a tablet.
+struct TabletScanResult {
+  string tablet_id;
+  uint64_t num_rows = 0;
+  uint64_t num_bytes = 0;
+  double elapsed_secs = 0;
+  map<string, int64_t> resource_metrics;
+};
+
+Status ScanTablet(const KuduScanToken& token, TabletScanResult* result) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(token.IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  result->tablet_id = token.tablet().id();
+  Stopwatch sw;
+  sw.start();
+  RETURN_NOT_OK(scanner->Open());
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    result->num_rows += batch.NumRows();
+    result->num_bytes += batch.direct_data().size() + batch.indirect_data().size();
+  }
+  sw.stop();
+  result->elapsed_secs = sw.elapsed().wall_seconds();
+  result->resource_metrics = scanner->GetResourceMetrics().Get();
+  return Status::OK();
+}
+
+Status TableScan(const RunnerContext& context) {
+  const string& table_name = FindOrDie(context.required_args, kTableNameArg);
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(CreateClient(context, &client));
+  shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(table_name, &table));
+
+  KuduScanTokenBuilder builder(table.get());
+  if (!FLAGS_scan_columns.empty()) {
+    vector<string> columns = strings::Split(FLAGS_scan_columns, ",", strings::SkipEmpty());
+    RETURN_NOT_OK(builder.SetProjectedColumnNames(columns));
+  }
+  vector<string> predicates = strings::Split(FLAGS_scan_predicates, ",", strings::SkipEmpty());
+  for (const string& predicate : predicates) {
+    KuduPredicate* pred;
+    RETURN_NOT_OK(ParseScanPredicate(predicate, table.get(), &pred));
+    RETURN_NOT_OK(builder.AddConjunctPredicate(pred));
+  }
+  if (FLAGS_scan_fault_tolerant) {
+    RETURN_NOT_OK(builder.SetFaultTolerant());
+  }
+  KuduClient::ReplicaSelection selection;
+  if (FLAGS_scan_replica_selection == "LEADER_ONLY") {
+    selection = KuduClient::LEADER_ONLY;
+  } else if (FLAGS_scan_replica_selection == "CLOSEST_REPLICA") {
+    selection = KuduClient::CLOSEST_REPLICA;
+  } else if (FLAGS_scan_replica_selection == "FIRST_REPLICA") {
+    selection = KuduClient::FIRST_REPLICA;
+  } else {
+    return Status::InvalidArgument("unknown replica selection",
+                                   FLAGS_scan_replica_selection);
+  }
+  RETURN_NOT_OK(builder.SetSelection(selection));
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  RETURN_NOT_OK(builder.Build(&tokens));
+
+  // Every thread scans the tablets of the next token until none is left.
+  vector<TabletScanResult> results(tokens.size());
+  vector<Status> statuses(tokens.size());
+  std::atomic<size_t> next_token(0);
+  vector<thread> threads;
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < std::max(FLAGS_num_threads, 1); i++) {
+    threads.emplace_back([&]() {
+      for (size_t t = next_token++; t < tokens.size(); t = next_token++) {
+        statuses[t] = ScanTablet(*tokens[t], &results[t]);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+
+  DataTable tablets({ "tablet", "rows", "bytes", "latency (ms)", "cells read",
+                      "bytes read", "blocks read" });
+  uint64_t total_rows = 0;
+  uint64_t total_bytes = 0;
+  map<string, int64_t> total_metrics;
+  for (const auto& result : results) {
+    total_rows += result.num_rows;
+    total_bytes += result.num_bytes;
+    for (const auto& e : result.resource_metrics) {
+      total_metrics[e.first] += e.second;
+    }
+    tablets.AddRow({ result.tablet_id,
+                     std::to_string(result.num_rows),
+                     std::to_string(result.num_bytes),
+                     std::to_string(static_cast<int64_t>(result.elapsed_secs * 1000)),
+                     std::to_string(FindWithDefault(result.resource_metrics, "cells_read", 0)),
+                     std::to_string(FindWithDefault(result.resource_metrics, "bytes_read", 0)),
+                     std::to_string(FindWithDefault(result.resource_metrics, "blocks_read", 0)) });
+  }
+  RETURN_NOT_OK(tablets.PrintTo(cout));
+
+  const double elapsed_secs = sw.elapsed().wall_seconds();
+  cout << endl << "Scan report" << endl
+       << "  tablets    : " << tokens.size() << endl
+       << "  threads    : " << threads.size() << endl
+       << "  time total : " << elapsed_secs << " s" << endl
+       << "  rows       : " << total_rows << endl
+       << "  bytes      : " << total_bytes << endl
+       << "  rows/s     : " << total_rows / elapsed_secs << endl
+       << "  bytes/s    : " << total_bytes / elapsed_secs << endl
+       << endl << "Server-side stats" << endl;
+  for (const auto& e : total_metrics) {
+    cout << "  " << e.first << ": " << e.second << endl;
+  }
+  return Status::OK();
+}
+
+// The stages of a write, in order, along with the tablet histograms tracking
+// the time spent in them.
+const struct {
+  const char* name;
+  const char* metric;
+} kWriteStages[] = {
+  { "prepare queue", "write_op_prepare_queue_duration" },
+  { "prepare", "write_op_prepare_duration" },
+  { "  row locks", "write_op_row_lock_duration" },
+  { "replication", "write_op_replication_duration" },
+  { "apply queue", "write_op_apply_queue_duration" },
+  { "apply", "write_op_apply_duration" },
+  { "commit wait", "commit_wait_duration" },
+};
+
+// Returns the smallest value of those counted in 'counts' which is greater
+// than or equal to 'percentile' percent of the 'total_count' values.
+uint64_t ValueAtPercentile(const map<uint64_t, uint64_t>& counts,
+                           uint64_t total_count,
+                           double percentile) {
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(total_count * percentile / 100)));
+  uint64_t count = 0;
+  for (const auto& e : counts) {
+    count += e.second;
+    if (count >= rank) {
+      return e.first;
+    }
+  }
+  return counts.empty() ? 0 : counts.rbegin()->first;
+}
+
+Status WriteStages(const RunnerContext& context) {
+  const string& address = FindOrDie(context.required_args, kWebserverAddressArg);
+  EasyCurl curl;
+  faststring buf;
+  RETURN_NOT_OK_PREPEND(curl.FetchURL(Substitute(
+      "http://$0/metrics?include_raw_histograms=true&compact=true&metrics=duration", address),
+                                      &buf),
+                        Substitute("unable to fetch the metrics of $0", address));
+  JsonReader r(buf.ToString());
+  RETURN_NOT_OK(r.Init());
+  vector<const rapidjson::Value*> entities;
+  RETURN_NOT_OK(r.ExtractObjectArray(r.root(), nullptr, &entities));
+
+  // Merge the histograms of all the tablets of the server.
+  map<string, map<uint64_t, uint64_t>> counts_by_metric;
+  map<string, int64_t> sum_by_metric;
+  for (const rapidjson::Value* entity : entities) {
+    string type;
+    RETURN_NOT_OK(r.ExtractString(entity, "type", &type));
+    if (type != "tablet") {
+      continue;
+    }
+    vector<const rapidjson::Value*> metrics;
+    RETURN_NOT_OK(r.ExtractObjectArray(entity, "metrics", &metrics));
+    for (const rapidjson::Value* metric : metrics) {
+      string name;
+      RETURN_NOT_OK(r.ExtractString(metric, "name", &name));
+      // Empty histograms have no raw values.
+      if (!metric->HasMember("values")) {
+        continue;
+      }
+      int64_t sum;
+      RETURN_NOT_OK(r.ExtractInt64(metric, "total_sum", &sum));
+      sum_by_metric[name] += sum;
+      const rapidjson::Value& values = (*metric)["values"];
+      const rapidjson::Value& counts = (*metric)["counts"];
+      auto& merged = counts_by_metric[name];
+      for (int i = 0; i < values.Size(); i++) {
+        merged[values[i].GetUint64()] += counts[i].GetUint64();
+      }
+    }
+  }
+
+  DataTable table({ "stage", "count", "mean (us)", "p50 (us)", "p99 (us)",
+                    "p99.9 (us)", "max (us)" });
+  for (const auto& stage : kWriteStages) {
+    const auto* counts = FindOrNull(counts_by_metric, stage.metric);
+    uint64_t total_count = 0;
+    if (counts) {
+      for (const auto& e : *counts) {
+        total_count += e.second;
+      }
+    }
+    if (total_count == 0) {
+      table.AddRow({ stage.name, "0", "", "", "", "", "" });
+      continue;
+    }
+    table.AddRow({
+        stage.name,
+        std::to_string(total_count),
+        std::to_string(FindOrDie(sum_by_metric, stage.metric) / total_count),
+        std::to_string(ValueAtPercentile(*counts, total_count, 50)),
+        std::to_string(ValueAtPercentile(*counts, total_count, 99)),
+        std::to_string(ValueAtPercentile(*counts, total_count, 99.9)),
+        std::to_string(counts->rbegin()->first) });
+  }
+  return table.PrintTo(cout);
+}
+
+// The types of operations of 'kudu perf workload'.
+enum WorkloadOp {
+  WORKLOAD_READ,
+  WORKLOAD_SCAN,
+  WORKLOAD_INSERT,
+  WORKLOAD_UPDATE,
+  WORKLOAD_UPSERT,
+  WORKLOAD_DELETE,
+  kNumWorkloadOps
+};
+
+const char* const kWorkloadOpNames[] = {
+  "read", "scan", "insert", "update", "upsert", "delete"
+};
+
+// The latencies above a minute are all recorded as a minute.
+const uint64_t kMaxWorkloadLatencyUs = 60 * 1000 * 1000;
+
+// Runs a mix of reads, scans and writes against a table with an INT64
+// primary key, in the spirit of the Yahoo! Cloud Serving Benchmark (YCSB).
+//
+// The table is first loaded with --workload_record_count records, with keys
+// from 0 on. Then --num_threads threads run operations picked according to
+// their proportions, on keys picked according to --workload_key_distribution,
+// for --workload_duration_secs seconds. The latencies of every type of
+// operation are recorded in a histogram.
+class Workload {
+ public:
+  Workload(shared_ptr<KuduClient> client, string table_name)
+      : client_(std::move(client)),
+        table_name_(std::move(table_name)),
+        num_keys_(FLAGS_workload_record_count),
+        elapsed_secs_(0) {
+    for (auto& histogram : latency_us_) {
+      histogram.reset(new HdrHistogram(kMaxWorkloadLatencyUs, 2));
+    }
+    for (auto& num_errors : num_errors_) {
+      num_errors = 0;
+    }
+  }
+
+  Status Init() {
+    const double proportions[] = {
+      FLAGS_workload_read_proportion,
+      FLAGS_workload_scan_proportion,
+      FLAGS_workload_insert_proportion,
+      FLAGS_workload_update_proportion,
+      FLAGS_workload_upsert_proportion,
+      FLAGS_workload_delete_proportion,
+    };
+    double total = 0;
+    for (int i = 0; i < kNumWorkloadOps; i++) {
+      if (proportions[i] < 0) {
+        return Status::InvalidArgument(Substitute(
+            "the proportion of $0 operations must not be negative", kWorkloadOpNames[i]));
+      }
+      total += proportions[i];
+      cumulative_proportions_[i] = total;
+    }
+    if (total == 0) {
+      return Status::InvalidArgument("at least one operation proportion must be positive");
+    }
+    if (FLAGS_workload_record_count == 0 &&
+        FLAGS_workload_insert_proportion != total) {
+      return Status::InvalidArgument(
+          "operations other than inserts require --workload_record_count > 0");
+    }
+    if (FLAGS_num_threads <= 0) {
+      return Status::InvalidArgument("--num_threads must be positive");
+    }
+    // Check the distribution early, rather than in every thread.
+    unique_ptr<KeyChooser> chooser;
+    RETURN_NOT_OK(KeyChooser::Create(FLAGS_workload_key_distribution, 0, &chooser));
+
+    RETURN_NOT_OK(client_->OpenTable(table_name_, &table_));
+    const KuduSchema& schema = table_->schema();
+    vector<int> key_idxs;
+    schema.GetPrimaryKeyColumnIndexes(&key_idxs);
+    if (key_idxs.size() != 1 || schema.Column(key_idxs[0]).type() != KuduColumnSchema::INT64) {
+      return Status::NotSupported(Substitute(
+          "table $0 must have a primary key of a single INT64 column", table_name_));
+    }
+    key_column_idx_ = key_idxs[0];
+    key_column_name_ = schema.Column(key_column_idx_).name();
+    return Status::OK();
+  }
+
+  // Loads the initial records, upserting them so as to be able to run
+  // several times against the same table.
+  Status Load() {
+    const size_t num_threads = FLAGS_num_threads;
+    const uint64_t num_records = FLAGS_workload_record_count;
+    vector<Status> statuses(num_threads);
+    vector<thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i]() {
+        statuses[i] = LoadRange(num_records * i / num_threads,
+                                num_records * (i + 1) / num_threads, i);
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK_PREPEND(s, "unable to load the initial records");
+    }
+    return Status::OK();
+  }
+
+  Status Run() {
+    const size_t num_threads = FLAGS_num_threads;
+    vector<Status> statuses(num_threads);
+    vector<thread> threads;
+    start_time_ = MonoTime::Now();
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i]() { statuses[i] = RunThread(i); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    elapsed_secs_ = (MonoTime::Now() - start_time_).ToSeconds();
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK(s);
+    }
+    return Status::OK();
+  }
+
+  // Prints the throughput and latencies of every type of operation run.
+  Status PrintReport() const {
+    DataTable table({ "op", "count", "errors", "ops/s", "mean (us)", "p50 (us)",
+                      "p95 (us)", "p99 (us)", "p99.9 (us)", "max (us)" });
+    for (int i = 0; i < kNumWorkloadOps; i++) {
+      const HdrHistogram& h = *latency_us_[i];
+      if (h.TotalCount() == 0) {
+        continue;
+      }
+      table.AddRow({ kWorkloadOpNames[i],
+                     std::to_string(h.TotalCount()),
+                     std::to_string(num_errors_[i].load()),
+                     std::to_string(static_cast<uint64_t>(h.TotalCount() / elapsed_secs_)),
+                     std::to_string(static_cast<uint64_t>(h.MeanValue())),
+                     std::to_string(h.ValueAtPercentile(50)),
+                     std::to_string(h.ValueAtPercentile(95)),
+                     std::to_string(h.ValueAtPercentile(99)),
+                     std::to_string(h.ValueAtPercentile(99.9)),
+                     std::to_string(h.MaxValue()) });
+    }
+    return table.PrintTo(cout);
+  }
+
+  // Saves the results to 'path' in JSON format.
+  Status SaveReport(const string& path) const {
+    ostringstream out;
+    JsonWriter jw(&out, JsonWriter::PRETTY);
+    jw.StartObject();
+    jw.String("table_name");
+    jw.String(table_name_);
+    jw.String("num_threads");
+    jw.Int(FLAGS_num_threads);
+    jw.String("key_distribution");
+    jw.String(FLAGS_workload_key_distribution);
+    jw.String("record_count");
+    jw.Uint64(FLAGS_workload_record_count);
+    jw.String("target_qps");
+    jw.Double(FLAGS_workload_target_qps);
+    jw.String("duration_secs");
+    jw.Double(elapsed_secs_);
+    jw.String("ops");
+    jw.StartObject();
+    for (int i = 0; i < kNumWorkloadOps; i++) {
+      const HdrHistogram& h = *latency_us_[i];
+      if (h.TotalCount() == 0) {
+        continue;
+      }
+      jw.String(kWorkloadOpNames[i]);
+      jw.StartObject();
+      jw.String("count");
+      jw.Uint64(h.TotalCount());
+      jw.String("errors");
+      jw.Uint64(num_errors_[i].load());
+      jw.String("ops_per_sec");
+      jw.Double(h.TotalCount() / elapsed_secs_);
+      jw.String("latency_us");
+      jw.StartObject();
+      jw.String("mean");
+      jw.Double(h.MeanValue());
+      for (double percentile : { 50.0, 95.0, 99.0, 99.9 }) {
+        jw.String(Substitute("p$0", percentile));
+        jw.Uint64(h.ValueAtPercentile(percentile));
+      }
+      jw.String("max");
+      jw.Uint64(h.MaxValue());
+      jw.EndObject();
+      jw.EndObject();
+    }
+    jw.EndObject();
+    jw.EndObject();
+    return WriteStringToFile(Env::Default(), out.str(), path);
+  }
+
+ private:
+  Status LoadRange(uint64_t start_key, uint64_t end_key, size_t thread_idx) {
+    shared_ptr<KuduSession> session(client_->NewSession());
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+    RETURN_NOT_OK(session->SetMutationBufferSpace(FLAGS_buffer_size_bytes));
+    Generator gen(Generator::MODE_RAND, thread_idx, FLAGS_string_len);
+    for (uint64_t key = start_key; key < end_key; key++) {
+      unique_ptr<KuduUpsert> upsert(table_->NewUpsert());
+      RETURN_NOT_OK(GenerateRowData(&gen, upsert->mutable_row(), FLAGS_string_fixed));
+      RETURN_NOT_OK(upsert->mutable_row()->SetInt64(key_column_idx_, key));
+      RETURN_NOT_OK(session->Apply(upsert.release()));
+    }
+    Status s = session->Flush();
+    vector<KuduError*> errors;
+    ElementDeleter d(&errors);
+    session->GetPendingErrors(&errors, nullptr);
+    if (!errors.empty()) {
+      return errors[0]->status();
+    }
+    return s;
+  }
+
+  Status RunThread(size_t thread_idx) {
+    shared_ptr<KuduSession> session(client_->NewSession());
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+    unique_ptr<KeyChooser> chooser;
+    RETURN_NOT_OK(KeyChooser::Create(FLAGS_workload_key_distribution,
+                                     2 * thread_idx, &chooser));
+    Random random(2 * thread_idx + 1);
+    Generator gen(Generator::MODE_RAND, thread_idx, FLAGS_string_len);
+
+    const MonoTime deadline =
+        start_time_ + MonoDelta::FromSeconds(FLAGS_workload_duration_secs);
+    // With a target throughput, every thread schedules its operations at a
+    // fixed interval, staggered with respect to the other threads.
+    const double interval_us = FLAGS_workload_target_qps > 0 ?
+        1e6 * FLAGS_num_threads / FLAGS_workload_target_qps : 0;
+    for (uint64_t i = 0; ; i++) {
+      MonoTime op_start;
+      if (interval_us > 0) {
+        op_start = start_time_ + MonoDelta::FromMicroseconds(static_cast<int64_t>(
+            (i + static_cast<double>(thread_idx) / FLAGS_num_threads) * interval_us));
+        if (op_start >= deadline) {
+          break;
+        }
+        const MonoTime now = MonoTime::Now();
+        if (op_start > now) {
+          SleepFor(op_start - now);
+        }
+      } else {
+        op_start = MonoTime::Now();
+        if (op_start >= deadline) {
+          break;
+        }
+      }
+
+      const double r = random.NextDoubleFraction() * cumulative_proportions_[kNumWorkloadOps - 1];
+      int op = 0;
+      while (op < kNumWorkloadOps - 1 && r >= cumulative_proportions_[op]) {
+        op++;
+      }
+      const uint64_t key = op == WORKLOAD_INSERT ? num_keys_++
+                                                 : chooser->Next(num_keys_.load());
+      Status s = RunOp(static_cast<WorkloadOp>(op), key, session.get(), &random, &gen);
+      // The latency is measured from the scheduled start of the operation, so
+      // as to account for the time it spent waiting behind the previous ones.
+      const int64_t latency_us = (MonoTime::Now() - op_start).ToMicroseconds();
+      latency_us_[op]->Increment(std::min<uint64_t>(latency_us, kMaxWorkloadLatencyUs));
+      if (!s.ok()) {
+        num_errors_[op]++;
+        KLOG_EVERY_N_SECS(WARNING, 1) << Substitute("$0 operation failed: $1",
+                                                    kWorkloadOpNames[op], s.ToString());
+      }
+    }
+    return Status::OK();
+  }
+
+  Status RunOp(WorkloadOp op, uint64_t key, KuduSession* session,
+               Random* random, Generator* gen) {
+    switch (op) {
+      case WORKLOAD_READ:
+        return ScanRows(key, KuduPredicate::EQUAL, 1);
+      case WORKLOAD_SCAN:
+        return ScanRows(key, KuduPredicate::GREATER_EQUAL,
+                        1 + random->Uniform(std::max(FLAGS_workload_scan_max_rows, 1)));
+      case WORKLOAD_INSERT:
+        return ApplyWrite(table_->NewInsert(), key, session, gen);
+      case WORKLOAD_UPDATE:
+        return ApplyWrite(table_->NewUpdate(), key, session, gen);
+      case WORKLOAD_UPSERT:
+        return ApplyWrite(table_->NewUpsert(), key, session, gen);
+      case WORKLOAD_DELETE:
+        return ApplyWrite(table_->NewDelete(), key, session, nullptr);
+      default:
+        break;
+    }
+    return Status::InvalidArgument(Substitute("unknown workload operation $0", op));
+  }
+
+  // Reads up to 'max_rows' rows whose key compares to 'key' as per 'op'.
+  Status ScanRows(uint64_t key, KuduPredicate::ComparisonOp op, int max_rows) {
+    KuduScanner scanner(table_.get());
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table_->NewComparisonPredicate(
+        key_column_name_, op, KuduValue::FromInt(key))));
+    RETURN_NOT_OK(scanner.Open());
+    int num_rows = 0;
+    KuduScanBatch batch;
+    while (num_rows < max_rows && scanner.HasMoreRows()) {
+      RETURN_NOT_OK(scanner.NextBatch(&batch));
+      num_rows += batch.NumRows();
+    }
+    return Status::OK();
+  }
+
+  // Applies the write 'op' to the row with key 'key'. If 'gen' isn't null,
+  // sets the other columns of the row to generated values.
+  template<class WriteOp>
+  Status ApplyWrite(WriteOp* op, uint64_t key, KuduSession* session, Generator* gen) {
+    unique_ptr<WriteOp> write(op);
+    KuduPartialRow* row = write->mutable_row();
+    if (gen) {
+      RETURN_NOT_OK(GenerateRowData(gen, row, FLAGS_string_fixed));
+    }
+    RETURN_NOT_OK(row->SetInt64(key_column_idx_, key));
+    Status s = session->Apply(write.release());
+    if (!s.ok()) {
+      // Surface the error of the row rather than the one of the flush.
+      vector<KuduError*> errors;
+      ElementDeleter d(&errors);
+      session->GetPendingErrors(&errors, nullptr);
+      if (!errors.empty()) {
+        return errors[0]->status();
+      }
+    }
+    return s;
+  }
+
+  const shared_ptr<KuduClient> client_;
+  const string table_name_;
+  shared_ptr<KuduTable> table_;
+  int key_column_idx_;
+  string key_column_name_;
+
+  // The running sums of the proportions of the operations, in the order of
+  // WorkloadOp.
+  double cumulative_proportions_[kNumWorkloadOps];
+
+  // The keys are in [0, num_keys_). Inserts add new keys at the end.
+  std::atomic<uint64_t> num_keys_;
+
+  MonoTime start_time_;
+  double elapsed_secs_;
+
+  unique_ptr<HdrHistogram> latency_us_[kNumWorkloadOps];
+  std::atomic<uint64_t> num_errors_[kNumWorkloadOps];
+
+  DISALLOW_COPY_AND_ASSIGN(Workload);
+};
+
+Status RunWorkload(const RunnerContext& context) {
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(CreateClient(context, &client));
+  string table_name;
+  bool is_auto_table = false;
+  if (!FLAGS_table_name.empty()) {
+    table_name = FLAGS_table_name;
+  } else {
+    is_auto_table = true;
+    RETURN_NOT_OK(CreateAutoTable(client, "workload_auto_", &table_name));
+  }
+  cout << "Using " << (is_auto_table ? "auto-created " : "")
+       << "table '" << table_name << "'" << endl;
+
+  Workload workload(client, table_name);
+  RETURN_NOT_OK(workload.Init());
+  cout << "Loading " << FLAGS_workload_record_count << " records" << endl;
+  RETURN_NOT_OK(workload.Load());
+  cout << "Running the workload for " << FLAGS_workload_duration_secs
+       << " seconds" << endl;
+  RETURN_NOT_OK(workload.Run());
+  RETURN_NOT_OK(workload.PrintReport());
+  if (!FLAGS_workload_report_file.empty()) {
+    RETURN_NOT_OK_PREPEND(workload.SaveReport(FLAGS_workload_report_file),
+                          "unable to save the report");
+  }
+
+  if (is_auto_table && !FLAGS_keep_auto_table) {
+    cout << "Dropping auto-created table '" << table_name << "'" << endl;
+    RETURN_NOT_OK(client->DeleteTable(table_name));
+  }
+  return Status::OK();
+}
+
+// The histograms of the log reported by 'kudu perf wal', along with the unit
+// of their values.
+const struct {
+  const char* name;
+  HistogramPrototype* prototype;
+  const char* unit;
+} kWalHistograms[] = {
+  { "append", &METRIC_log_append_latency, "us" },
+  { "sync", &METRIC_log_sync_latency, "us" },
+  { "group commit", &METRIC_log_group_commit_latency, "us" },
+  { "group commit delay", &METRIC_log_group_commit_delay, "us" },
+  { "roll", &METRIC_log_roll_latency, "us" },
+  { "batches per group", &METRIC_log_entry_batches_per_group, "batches" },
+};
+
+// Appends batches of --wal_batch_size entries to 'log' until 'deadline',
+// waiting for every batch to be durable before appending the next one, and
+// records how long every batch took in 'latency_us', which is shared by all
+// the threads.
+Status AppendToWal(log::Log* log, mutex* op_id_lock, consensus::OpId* op_id,
+                   const MonoTime& deadline, size_t thread_idx,
+                   HdrHistogram* latency_us, int64_t* num_batches) {
+  Random random(thread_idx);
+  string payload(FLAGS_wal_entry_size_bytes, '\0');
+  while (MonoTime::Now() < deadline) {
+    vector<consensus::ReplicateRefPtr> replicates;
+    for (int i = 0; i < FLAGS_wal_batch_size; i++) {
+      // Random alphanumeric characters, so that compression has something to
+      // do without making the payload trivially compressible.
+      for (auto& c : payload) {
+        c = 'a' + random.Uniform(26);
+      }
+      auto replicate = consensus::make_scoped_refptr_replicate(new consensus::ReplicateMsg);
+      replicate->get()->set_op_type(consensus::NO_OP);
+      replicate->get()->mutable_noop_request()->set_payload_for_tests(payload);
+      replicates.emplace_back(std::move(replicate));
+    }
+    Synchronizer s;
+    const MonoTime start = MonoTime::Now();
+    {
+      // The op ids must be assigned in the order the entries are appended.
+      lock_guard<mutex> l(*op_id_lock);
+      for (auto& replicate : replicates) {
+        op_id->set_index(op_id->index() + 1);
+        *replicate->get()->mutable_id() = *op_id;
+        replicate->get()->set_timestamp(op_id->index());
+      }
+      RETURN_NOT_OK(log->AsyncAppendReplicates(replicates, s.AsStatusCallback()));
+    }
+    RETURN_NOT_OK(s.Wait());
+    latency_us->Increment(std::min<int64_t>((MonoTime::Now() - start).ToMicroseconds(),
+                                            latency_us->highest_trackable_value()));
+    (*num_batches)++;
+  }
+  return Status::OK();
+}
+
+// Appends entries to a WAL with the real log implementation, and reports the
+// latency of the appends, syncs and rolls of the log.
+Status WalBenchmark(const RunnerContext& context) {
+  const string& root_dir = FindOrDie(context.required_args, kRootDirArg);
+  if (FLAGS_wal_batch_size <= 0 || FLAGS_wal_entry_size_bytes < 0) {
+    return Status::InvalidArgument("--wal_batch_size must be positive and "
+                                   "--wal_entry_size_bytes non-negative");
+  }
+  Env* env = Env::Default();
+  if (env->FileExists(root_dir)) {
+    return Status::AlreadyPresent("root directory already exists", root_dir);
+  }
+  FsManager fs_manager(env, root_dir);
+  RETURN_NOT_OK(fs_manager.CreateInitialFileSystemLayout());
+  SCOPED_CLEANUP({
+    WARN_NOT_OK(env->DeleteRecursively(root_dir),
+                "Could not delete the root directory");
+  });
+  RETURN_NOT_OK(fs_manager.Open());
+
+  MetricRegistry metric_registry;
+  scoped_refptr<MetricEntity> metric_entity =
+      METRIC_ENTITY_tablet.Instantiate(&metric_registry, "wal-bench");
+  const Schema schema({ ColumnSchema("key", INT64) }, 1);
+  scoped_refptr<log::Log> log;
+  ObjectIdGenerator oid_generator;
+  RETURN_NOT_OK(log::Log::Open(log::LogOptions(), &fs_manager, oid_generator.Next(),
+                               schema, 0, metric_entity, &log));
+
+  const int num_threads = FLAGS_num_threads;
+  mutex op_id_lock;
+  consensus::OpId op_id;
+  op_id.set_term(1);
+  op_id.set_index(0);
+  HdrHistogram batch_latency_us(60 * 1000 * 1000, 2);
+  vector<int64_t> num_batches(num_threads);
+  vector<Status> statuses(num_threads);
+  vector<thread> threads;
+  const MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(FLAGS_wal_duration_secs);
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i]() {
+        statuses[i] = AppendToWal(log.get(), &op_id_lock, &op_id, deadline, i,
+                                  &batch_latency_us, &num_batches[i]);
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  RETURN_NOT_OK(log->Close());
+  sw.stop();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+
+  const double elapsed_secs = sw.elapsed().wall_seconds();
+  const int64_t total_batches = accumulate(num_batches.begin(), num_batches.end(), int64_t(0));
+  const int64_t bytes_logged = METRIC_log_bytes_logged.Instantiate(metric_entity)->value();
+  cout << "WAL report (" << num_threads << " threads, " << elapsed_secs << " s)" << endl
+       << "  batches/s: " << total_batches / elapsed_secs << endl
+       << "  entries/s: " << total_batches * FLAGS_wal_batch_size / elapsed_secs << endl
+       << "  bytes/s  : " << bytes_logged / elapsed_secs << endl
+       << endl;
+
+  DataTable table({ "histogram", "unit", "count", "mean", "p50", "p95", "p99",
+                    "p99.9", "max" });
+  const auto add_row = [&](const string& name, const string& unit, const HdrHistogram& h) {
+    table.AddRow({ name,
+                   unit,
+                   std::to_string(h.TotalCount()),
+                   std::to_string(static_cast<uint64_t>(h.MeanValue())),
+                   std::to_string(h.ValueAtPercentile(50)),
+                   std::to_string(h.ValueAtPercentile(95)),
+                   std::to_string(h.ValueAtPercentile(99)),
+                   std::to_string(h.ValueAtPercentile(99.9)),
+                   std::to_string(h.MaxValue()) });
+  };
+  add_row("batch durable", "us", batch_latency_us);
+  for (const auto& hist : kWalHistograms) {
+    add_row(hist.name, hist.unit, *hist.prototype->Instantiate(metric_entity)->histogram());
+  }
+  return table.PrintTo(cout);
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildPerfMode() {
@@ -675,9 +1704,129 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("use_random")
       .Build();
 
+  unique_ptr<Action> tablet_bulk_load =
+      ActionBuilder("tablet_bulk_load", &TestTabletBulkLoad)
+      .Description("Compare the write throughput of a local tablet with "
+                   "and without bulk loads")
+      .ExtraDescription(
+          "Write sorted, generated rows into a new local tablet in batches, "
+          "first through the MemRowSet followed by a flush, then by bulk "
+          "loading the batches directly into new DiskRowSets, and report the "
+          "throughput of both.")
+      .AddRequiredParameter({ kRootDirArg,
+          "Directory in which to create the tablets. It must not exist, and "
+          "it's deleted once done." })
+      .AddOptionalParameter("bulk_load_batch_size")
+      .AddOptionalParameter("bulk_load_num_rows")
+      .AddOptionalParameter("string_fixed")
+      .AddOptionalParameter("string_len")
+      .Build();
+
+  unique_ptr<Action> write_stages =
+      ActionBuilder("write_stages", &WriteStages)
+      .Description("Show where the time of the writes led by a tablet server goes")
+      .ExtraDescription(
+          "Fetch the per-stage latency histograms of the writes led by a "
+          "tablet server from its web server, merge them across all of its "
+          "tablets, and print the count, mean, percentiles and maximum of "
+          "the time spent in each stage of the writes.")
+      .AddRequiredParameter({ kWebserverAddressArg,
+          "Address of the tablet server's web server, in 'hostname:port' form." })
+      .AddOptionalParameter("format")
+      .Build();
+
+  unique_ptr<Action> table_scan =
+      ActionBuilder("table_scan", &TableScan)
+      .Description("Measure the throughput of scanning a table")
+      .ExtraDescription(
+          "Scan an existing table with one scan token per tablet, running "
+          "the tokens in parallel with the specified projection, predicates, "
+          "fault tolerance and replica selection, and report the throughput "
+          "of the scans, the latency of every tablet's scan, and the cells, "
+          "bytes and blocks read by the tablet servers to serve them.")
+      .AddRequiredParameter({ kMasterAddressesArg,
+          "Comma-separated list of master addresses to run against. "
+          "Addresses are in 'hostname:port' form where port may be omitted "
+          "if a master server listens at the default port." })
+      .AddRequiredParameter({ kTableNameArg, "Name of the table to scan" })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("scan_columns")
+      .AddOptionalParameter("scan_fault_tolerant")
+      .AddOptionalParameter("scan_predicates")
+      .AddOptionalParameter("scan_replica_selection")
+      .Build();
+
+  unique_ptr<Action> wal =
+      ActionBuilder("wal", &WalBenchmark)
+      .Description("Measure the latency of the appends, syncs and rolls of a WAL")
+      .ExtraDescription(
+          "Append batches of entries to a new write-ahead log in a local "
+          "directory, with the same code, preallocation and group commit as "
+          "the tablet servers, and report the throughput of the appends along "
+          "with the latency histograms of the log. This is useful to qualify "
+          "the disks and file systems meant for the WAL.")
+      .AddRequiredParameter({ kRootDirArg,
+          "Directory in which to create the WAL. It must not exist, and "
+          "it's deleted once done." })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("log_async_preallocate_segments")
+      .AddOptionalParameter("log_compression_codec")
+      .AddOptionalParameter("log_force_fsync_all")
+      .AddOptionalParameter("log_group_commit_target_latency_us")
+      .AddOptionalParameter("log_preallocate_segments")
+      .AddOptionalParameter("log_segment_size_mb")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("wal_batch_size")
+      .AddOptionalParameter("wal_duration_secs")
+      .AddOptionalParameter("wal_entry_size_bytes")
+      .Build();
+
+  unique_ptr<Action> workload =
+      ActionBuilder("workload", &RunWorkload)
+      .Description("Run a mix of reads, scans and writes and report their latencies")
+      .ExtraDescription(
+          "Load records into an existing or auto-created table, then run "
+          "reads, scans, inserts, updates, upserts and deletes in the "
+          "specified proportions, on keys following the specified "
+          "distribution, either as fast as possible or at a target "
+          "throughput, and report the throughput and latency percentiles of "
+          "every type of operation. The table must have a primary key of "
+          "a single INT64 column.")
+      .AddRequiredParameter({ kMasterAddressesArg,
+          "Comma-separated list of master addresses to run against. "
+          "Addresses are in 'hostname:port' form where port may be omitted "
+          "if a master server listens at the default port." })
+      .AddOptionalParameter("buffer_size_bytes")
+      .AddOptionalParameter("keep_auto_table")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("string_fixed")
+      .AddOptionalParameter("string_len")
+      .AddOptionalParameter("table_name")
+      .AddOptionalParameter("table_num_buckets")
+      .AddOptionalParameter("table_num_replicas")
+      .AddOptionalParameter("workload_delete_proportion")
+      .AddOptionalParameter("workload_duration_secs")
+      .AddOptionalParameter("workload_insert_proportion")
+      .AddOptionalParameter("workload_key_distribution")
+      .AddOptionalParameter("workload_read_proportion")
+      .AddOptionalParameter("workload_record_count")
+      .AddOptionalParameter("workload_report_file")
+      .AddOptionalParameter("workload_scan_max_rows")
+      .AddOptionalParameter("workload_scan_proportion")
+      .AddOptionalParameter("workload_target_qps")
+      .AddOptionalParameter("workload_update_proportion")
+      .AddOptionalParameter("workload_upsert_proportion")
+      .Build();
+
   return ModeBuilder("perf")
       .Description("Measure the performance of a Kudu cluster")
       .AddAction(std::move(insert))
+      .AddAction(std::move(table_scan))
+      .AddAction(std::move(tablet_bulk_load))
+      .AddAction(std::move(wal))
+      .AddAction(std::move(workload))
+      .AddAction(std::move(write_stages))
       .Build();
 }
 
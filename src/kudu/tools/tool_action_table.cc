@@ -17,9 +17,13 @@
 
 #include "kudu/tools/tool_action.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -28,32 +32,78 @@
 
 #include "kudu/client/client.h"
 #include "kudu/client/replica_controller-internal.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/scan_predicate.h"
+#include "kudu/client/schema.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_op.h"
+#include "kudu/common/partial_row.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/int128.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
 
 DEFINE_bool(list_tablets, false,
             "Include tablet and replica UUIDs in the output");
+DEFINE_string(dst_cluster, "",
+              "Comma-separated list of the master addresses of the cluster "
+              "'kudu table copy' writes to. If empty, the table is copied "
+              "within the source cluster.");
+DEFINE_string(dst_table, "",
+              "Name of the table 'kudu table copy' writes to. If empty, the "
+              "name of the source table is used.");
+DEFINE_bool(create_table, false,
+            "Whether 'kudu table copy' creates the destination table, with "
+            "the schema and the replication factor of the source table and "
+            "hash partitioned on its primary key into "
+            "--create_table_hash_buckets buckets. To repartition or re-encode "
+            "a table, create the destination table beforehand instead.");
+DEFINE_int32(create_table_hash_buckets, 0,
+             "Number of hash buckets of the table created by 'kudu table copy' "
+             "with --create_table. If 0, there are as many buckets as tablets "
+             "scanned in the source table.");
+DEFINE_string(write_type, "insert",
+              "How 'kudu table copy' writes the rows to the destination table: "
+              "'insert' fails on rows whose key already exists, 'upsert' "
+              "overwrites them.");
+
+DECLARE_int32(num_threads);
+DECLARE_string(scan_columns);
+DECLARE_string(scan_predicates);
 
 namespace kudu {
 namespace tools {
 
 using client::KuduClient;
 using client::KuduClientBuilder;
+using client::KuduColumnSchema;
+using client::KuduError;
+using client::KuduPredicate;
+using client::KuduScanBatch;
 using client::KuduScanToken;
 using client::KuduScanTokenBuilder;
+using client::KuduScanner;
+using client::KuduSchema;
+using client::KuduSession;
 using client::KuduTable;
+using client::KuduTableCreator;
+using client::KuduWriteOperation;
 using client::internal::ReplicaController;
 using std::cout;
 using std::endl;
 using std::string;
+using std::thread;
 using std::unique_ptr;
 using std::vector;
 using strings::Split;
+using strings::Substitute;
 
 // This class only exists so that ListTables() can easily be friended by
 // KuduReplica, KuduReplica::Data, and KuduClientBuilder.
@@ -121,9 +171,312 @@ Status ListTables(const RunnerContext& context) {
   return TableLister::ListTablets(Split(master_addresses_str, ","));
 }
 
+// Copies the columns of 'src', a row scanned from the source table, to 'dst',
+// a row of the destination table. 'dst_idxs' maps the index of each column in
+// the scan projection to the index of the same column in the destination.
+Status CopyRow(const KuduScanBatch::RowPtr& src, const KuduSchema& projection,
+               const vector<int>& dst_idxs, KuduPartialRow* dst) {
+  for (int i = 0; i < projection.num_columns(); i++) {
+    const int dst_idx = dst_idxs[i];
+    if (src.IsNull(i)) {
+      RETURN_NOT_OK(dst->SetNull(dst_idx));
+      continue;
+    }
+    switch (projection.Column(i).type()) {
+      case KuduColumnSchema::INT8: {
+        int8_t v;
+        RETURN_NOT_OK(src.GetInt8(i, &v));
+        RETURN_NOT_OK(dst->SetInt8(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::INT16: {
+        int16_t v;
+        RETURN_NOT_OK(src.GetInt16(i, &v));
+        RETURN_NOT_OK(dst->SetInt16(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::INT32: {
+        int32_t v;
+        RETURN_NOT_OK(src.GetInt32(i, &v));
+        RETURN_NOT_OK(dst->SetInt32(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::INT64: {
+        int64_t v;
+        RETURN_NOT_OK(src.GetInt64(i, &v));
+        RETURN_NOT_OK(dst->SetInt64(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::UNIXTIME_MICROS: {
+        int64_t v;
+        RETURN_NOT_OK(src.GetUnixTimeMicros(i, &v));
+        RETURN_NOT_OK(dst->SetUnixTimeMicros(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::FLOAT: {
+        float v;
+        RETURN_NOT_OK(src.GetFloat(i, &v));
+        RETURN_NOT_OK(dst->SetFloat(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::DOUBLE: {
+        double v;
+        RETURN_NOT_OK(src.GetDouble(i, &v));
+        RETURN_NOT_OK(dst->SetDouble(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::BOOL: {
+        bool v;
+        RETURN_NOT_OK(src.GetBool(i, &v));
+        RETURN_NOT_OK(dst->SetBool(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::STRING: {
+        Slice v;
+        RETURN_NOT_OK(src.GetString(i, &v));
+        RETURN_NOT_OK(dst->SetStringCopy(dst_idx, v));
+        break;
+      }
+      case KuduColumnSchema::BINARY: {
+        Slice v;
+        RETURN_NOT_OK(src.GetBinary(i, &v));
+        RETURN_NOT_OK(dst->SetBinaryCopy(dst_idx, v));
+        break;
+      }
+#if KUDU_INT128_SUPPORTED
+      case KuduColumnSchema::DECIMAL: {
+        int128_t v;
+        RETURN_NOT_OK(src.GetUnscaledDecimal(i, &v));
+        RETURN_NOT_OK(dst->SetUnscaledDecimal(dst_idx, v));
+        break;
+      }
+#endif
+      default:
+        return Status::NotSupported(Substitute(
+            "copying column $0 of type $1 is not supported",
+            projection.Column(i).name(),
+            KuduColumnSchema::DataTypeToString(projection.Column(i).type())));
+    }
+  }
+  return Status::OK();
+}
+
+// Returns the status of the first failed write of 'session', or 's' if the
+// session has no failed write.
+Status FirstPendingError(KuduSession* session, const Status& s) {
+  vector<KuduError*> errors;
+  ElementDeleter deleter(&errors);
+  session->GetPendingErrors(&errors, nullptr);
+  return errors.empty() ? s : errors[0]->status();
+}
+
+// The progress of a table copy, shared by the threads copying its tablets.
+struct CopyProgress {
+  std::atomic<uint64_t> rows_copied{0};
+  std::atomic<size_t> tablets_copied{0};
+};
+
+// Scans the rows of 'token' and writes them to 'dst_table' in batches,
+// through a session of its own.
+Status CopyTablet(const KuduScanToken& token, KuduClient* dst_client,
+                  const client::sp::shared_ptr<KuduTable>& dst_table,
+                  CopyProgress* progress) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(token.IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  RETURN_NOT_OK(scanner->Open());
+  const KuduSchema projection = scanner->GetProjectionSchema();
+
+  const KuduSchema& dst_schema = dst_table->schema();
+  vector<int> dst_idxs(projection.num_columns());
+  for (int i = 0; i < projection.num_columns(); i++) {
+    const string& name = projection.Column(i).name();
+    dst_idxs[i] = -1;
+    for (int j = 0; j < dst_schema.num_columns(); j++) {
+      if (dst_schema.Column(j).name() == name) {
+        dst_idxs[i] = j;
+        break;
+      }
+    }
+    if (dst_idxs[i] == -1) {
+      return Status::NotFound("no such column in the destination table", name);
+    }
+  }
+
+  client::sp::shared_ptr<KuduSession> session(dst_client->NewSession());
+  RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  const bool upsert = FLAGS_write_type == "upsert";
+  KuduScanBatch batch;
+  vector<KuduWriteOperation*> ops;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    ops.clear();
+    ops.reserve(batch.NumRows());
+    for (const auto& row : batch) {
+      KuduWriteOperation* op = upsert ?
+          static_cast<KuduWriteOperation*>(dst_table->NewUpsert()) :
+          static_cast<KuduWriteOperation*>(dst_table->NewInsert());
+      ops.push_back(op);
+      Status s = CopyRow(row, projection, dst_idxs, op->mutable_row());
+      if (!s.ok()) {
+        STLDeleteElements(&ops);
+        return s;
+      }
+    }
+    // The session takes ownership of the operations.
+    Status s = session->ApplyBatch(ops);
+    if (!s.ok()) {
+      return FirstPendingError(session.get(), s);
+    }
+    progress->rows_copied += ops.size();
+  }
+  Status s = session->Flush();
+  if (!s.ok()) {
+    return FirstPendingError(session.get(), s);
+  }
+  progress->tablets_copied++;
+  return Status::OK();
+}
+
+// Creates 'table_name' in 'client' with the schema and the replication
+// factor of 'src_table', hash partitioned on its primary key.
+Status CreateDestinationTable(KuduClient* client, const string& table_name,
+                              const KuduTable& src_table, int num_buckets) {
+  KuduSchema schema(src_table.schema());
+  vector<int> key_idxs;
+  schema.GetPrimaryKeyColumnIndexes(&key_idxs);
+  vector<string> key_columns;
+  for (int idx : key_idxs) {
+    key_columns.emplace_back(schema.Column(idx).name());
+  }
+  unique_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
+  return table_creator->table_name(table_name)
+      .schema(&schema)
+      .num_replicas(src_table.num_replicas())
+      .add_hash_partitions(key_columns, std::max(num_buckets, 2))
+      .wait(true)
+      .Create();
+}
+
+Status CopyTable(const RunnerContext& context) {
+  const string& master_addresses_str = FindOrDie(context.required_args,
+                                                 kMasterAddressesArg);
+  const string& table_name = FindOrDie(context.required_args, kTableNameArg);
+  const string& dst_table_name = FLAGS_dst_table.empty() ? table_name : FLAGS_dst_table;
+  if (FLAGS_dst_cluster.empty() && dst_table_name == table_name) {
+    return Status::InvalidArgument(
+        "the destination table must differ from the source table; "
+        "use --dst_table or --dst_cluster");
+  }
+  if (FLAGS_write_type != "insert" && FLAGS_write_type != "upsert") {
+    return Status::InvalidArgument("unknown write type", FLAGS_write_type);
+  }
+
+  vector<string> master_addresses = Split(master_addresses_str, ",");
+  client::sp::shared_ptr<KuduClient> src_client;
+  RETURN_NOT_OK(KuduClientBuilder()
+                .master_server_addrs(master_addresses)
+                .Build(&src_client));
+  client::sp::shared_ptr<KuduClient> dst_client = src_client;
+  if (!FLAGS_dst_cluster.empty()) {
+    vector<string> dst_master_addresses = Split(FLAGS_dst_cluster, ",");
+    RETURN_NOT_OK(KuduClientBuilder()
+                  .master_server_addrs(dst_master_addresses)
+                  .Build(&dst_client));
+  }
+
+  client::sp::shared_ptr<KuduTable> src_table;
+  RETURN_NOT_OK(src_client->OpenTable(table_name, &src_table));
+  KuduScanTokenBuilder builder(src_table.get());
+  if (!FLAGS_scan_columns.empty()) {
+    vector<string> columns = Split(FLAGS_scan_columns, ",", strings::SkipEmpty());
+    RETURN_NOT_OK(builder.SetProjectedColumnNames(columns));
+  }
+  vector<string> predicates = Split(FLAGS_scan_predicates, ",", strings::SkipEmpty());
+  for (const string& predicate : predicates) {
+    KuduPredicate* pred;
+    RETURN_NOT_OK(ParseScanPredicate(predicate, src_table.get(), &pred));
+    RETURN_NOT_OK(builder.AddConjunctPredicate(pred));
+  }
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  RETURN_NOT_OK(builder.Build(&tokens));
+
+  if (FLAGS_create_table) {
+    int num_buckets = FLAGS_create_table_hash_buckets > 0 ?
+        FLAGS_create_table_hash_buckets : static_cast<int>(tokens.size());
+    RETURN_NOT_OK_PREPEND(CreateDestinationTable(dst_client.get(), dst_table_name,
+                                                 *src_table, num_buckets),
+                          "unable to create the destination table");
+  }
+  client::sp::shared_ptr<KuduTable> dst_table;
+  RETURN_NOT_OK(dst_client->OpenTable(dst_table_name, &dst_table));
+
+  // Every thread copies the tablet of the next token until none is left,
+  // while this thread reports the progress.
+  const int num_threads = std::min<int>(std::max(FLAGS_num_threads, 1), tokens.size());
+  vector<Status> statuses(tokens.size());
+  std::atomic<size_t> next_token(0);
+  CopyProgress progress;
+  CountDownLatch finished(num_threads);
+  vector<thread> threads;
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&]() {
+      for (size_t t = next_token++; t < tokens.size(); t = next_token++) {
+        statuses[t] = CopyTablet(*tokens[t], dst_client.get(), dst_table, &progress);
+      }
+      finished.CountDown();
+    });
+  }
+  while (!finished.WaitFor(MonoDelta::FromSeconds(5))) {
+    cout << Substitute("Copied $0 rows, $1/$2 tablets done",
+                       progress.rows_copied.load(), progress.tablets_copied.load(),
+                       tokens.size()) << endl;
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+
+  const double elapsed_secs = sw.elapsed().wall_seconds();
+  cout << Substitute("Copied $0 rows from $1 tablets of $2 to $3 in $4 s ($5 rows/s)",
+                     progress.rows_copied.load(), tokens.size(), table_name,
+                     dst_table_name, elapsed_secs,
+                     progress.rows_copied.load() / std::max(elapsed_secs, 1e-6)) << endl;
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildTableMode() {
+  unique_ptr<Action> copy_table =
+      ActionBuilder("copy", &CopyTable)
+      .Description("Copy the rows of a table to another table")
+      .ExtraDescription(
+          "Scan the table with one scan token per tablet, running the tokens "
+          "in parallel with the specified projection and predicates, and "
+          "write the rows to another table, in the same or in another "
+          "cluster, in batches. The destination table must exist unless "
+          "--create_table is set; it may have a different partitioning and "
+          "different column encodings, and must have every projected column. "
+          "The progress is reported every 5 seconds.")
+      .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
+      .AddRequiredParameter({ kTableNameArg, "Name of the table to copy" })
+      .AddOptionalParameter("create_table")
+      .AddOptionalParameter("create_table_hash_buckets")
+      .AddOptionalParameter("dst_cluster")
+      .AddOptionalParameter("dst_table")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("scan_columns")
+      .AddOptionalParameter("scan_predicates")
+      .AddOptionalParameter("write_type")
+      .Build();
+
   unique_ptr<Action> delete_table =
       ActionBuilder("delete", &DeleteTable)
       .Description("Delete a table")
@@ -140,6 +493,7 @@ unique_ptr<Mode> BuildTableMode() {
 
   return ModeBuilder("table")
       .Description("Operate on Kudu tables")
+      .AddAction(std::move(copy_table))
       .AddAction(std::move(delete_table))
       .AddAction(std::move(list_tables))
       .Build();
@@ -37,11 +37,17 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/server/server_base.pb.h"
 #include "kudu/tools/tool_action_common.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/tserver/tserver_admin.proxy.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 DECLARE_string(columns);
+DECLARE_int64(timeout_ms); // defined in tool_action_common
 
 using std::cout;
 using std::string;
@@ -53,6 +59,10 @@ namespace kudu {
 using master::ListTabletServersRequestPB;
 using master::ListTabletServersResponsePB;
 using master::MasterServiceProxy;
+using rpc::RpcController;
+using tserver::DrainLeadersRequestPB;
+using tserver::DrainLeadersResponsePB;
+using tserver::TabletServerAdminServiceProxy;
 
 namespace tools {
 namespace {
@@ -82,6 +92,57 @@ Status TServerTimestamp(const RunnerContext& context) {
   return PrintServerTimestamp(address, tserver::TabletServer::kDefaultPort);
 }
 
+// Sets the draining state of the tablet server at 'address', returning the
+// number of replicas it still leads in 'num_leaders' if 'drain' is true.
+Status SetTServerDraining(const string& address, bool drain, int* num_leaders) {
+  server::ServerStatusPB status;
+  RETURN_NOT_OK(GetServerStatus(address, tserver::TabletServer::kDefaultPort, &status));
+  unique_ptr<TabletServerAdminServiceProxy> proxy;
+  RETURN_NOT_OK(BuildProxy(address, tserver::TabletServer::kDefaultPort, &proxy));
+
+  DrainLeadersRequestPB req;
+  DrainLeadersResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromMilliseconds(FLAGS_timeout_ms));
+  req.set_dest_uuid(status.node_instance().permanent_uuid());
+  req.set_drain(drain);
+  RETURN_NOT_OK(proxy->DrainLeaders(req, &resp, &rpc));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  if (num_leaders) {
+    *num_leaders = resp.num_leaders();
+  }
+  return Status::OK();
+}
+
+Status TServerDrain(const RunnerContext& context) {
+  const string& address = FindOrDie(context.required_args, kTServerAddressArg);
+  const MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_timeout_ms);
+  // Each request hands the leaderships the tablet server still holds over to
+  // caught-up followers, which may not all be available at first.
+  while (true) {
+    int num_leaders;
+    RETURN_NOT_OK(SetTServerDraining(address, true, &num_leaders));
+    if (num_leaders == 0) {
+      cout << "Tablet server " << address << " leads no tablets and may be stopped" << std::endl;
+      return Status::OK();
+    }
+    if (MonoTime::Now() > deadline) {
+      return Status::TimedOut(strings::Substitute(
+          "tablet server $0 still leads $1 tablets", address, num_leaders));
+    }
+    cout << "Tablet server " << address << " still leads " << num_leaders
+         << " tablets, waiting..." << std::endl;
+    SleepFor(MonoDelta::FromSeconds(1));
+  }
+}
+
+Status TServerUndrain(const RunnerContext& context) {
+  const string& address = FindOrDie(context.required_args, kTServerAddressArg);
+  return SetTServerDraining(address, false, nullptr);
+}
+
 Status ListTServers(const RunnerContext& context) {
   LeaderMasterProxy proxy;
   RETURN_NOT_OK(proxy.Init(context));
@@ -167,6 +228,24 @@ unique_ptr<Mode> BuildTServerMode() {
       .AddRequiredParameter({ kTServerAddressArg, kTServerAddressDesc })
       .Build();
 
+  unique_ptr<Action> drain =
+      ActionBuilder("drain", &TServerDrain)
+      .Description("Transfer the leaderships of a Kudu Tablet Server to other replicas")
+      .ExtraDescription("The tablet server stops running for election until it's "
+                        "undrained or restarted. This waits until the tablet server "
+                        "leads no tablet, so that it can be restarted without "
+                        "waiting for the election of new leaders.")
+      .AddRequiredParameter({ kTServerAddressArg, kTServerAddressDesc })
+      .AddOptionalParameter("timeout_ms")
+      .Build();
+
+  unique_ptr<Action> undrain =
+      ActionBuilder("undrain", &TServerUndrain)
+      .Description("Let a drained Kudu Tablet Server run for election again")
+      .AddRequiredParameter({ kTServerAddressArg, kTServerAddressDesc })
+      .AddOptionalParameter("timeout_ms")
+      .Build();
+
   unique_ptr<Action> list_tservers =
       ActionBuilder("list", &ListTServers)
       .Description("List tablet servers in a Kudu cluster")
@@ -185,6 +264,8 @@ unique_ptr<Mode> BuildTServerMode() {
       .AddAction(std::move(set_flag))
       .AddAction(std::move(status))
       .AddAction(std::move(timestamp))
+      .AddAction(std::move(drain))
+      .AddAction(std::move(undrain))
       .AddAction(std::move(list_tservers))
       .Build();
 }
@@ -0,0 +1,269 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/block_cache_warmer.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp> // IWYU pragma: keep
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_bool(block_cache_warmup, false,
+            "Whether to save the set of blocks in the block cache periodically and "
+            "at shutdown, and to read them back into the cache at startup once the "
+            "tablets are open. This shortens the time it takes for the cache hit "
+            "ratio to recover after a restart.");
+TAG_FLAG(block_cache_warmup, experimental);
+
+DEFINE_int32(block_cache_snapshot_interval_secs, 300,
+             "Interval at which the set of blocks in the block cache is saved, if "
+             "--block_cache_warmup is set.");
+TAG_FLAG(block_cache_snapshot_interval_secs, experimental);
+
+DEFINE_int32(block_cache_warmup_rate_mb, 32,
+             "Maximum rate at which blocks are read back into the block cache at "
+             "startup, in MB per second, if --block_cache_warmup is set. If 0, the "
+             "reads aren't rate-limited.");
+TAG_FLAG(block_cache_warmup_rate_mb, experimental);
+
+using kudu::cfile::BlockCache;
+using kudu::cfile::BlockCacheSnapshotPB;
+using kudu::cfile::BlockHandle;
+using kudu::cfile::BlockPointer;
+using kudu::cfile::CFileReader;
+using kudu::cfile::ReaderOptions;
+using kudu::fs::ReadableBlock;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+BlockCacheSnapshotPB::BlockType ToBlockTypePB(BlockCache::BlockType type) {
+  switch (type) {
+    case BlockCache::DATA_BLOCK: return BlockCacheSnapshotPB::DATA;
+    case BlockCache::INDEX_BLOCK: return BlockCacheSnapshotPB::INDEX;
+    case BlockCache::BLOOM_BLOCK: return BlockCacheSnapshotPB::BLOOM;
+    case BlockCache::DICTIONARY_BLOCK: return BlockCacheSnapshotPB::DICTIONARY;
+  }
+  LOG(FATAL) << "Unknown block type: " << type;
+  __builtin_unreachable();
+}
+
+bool FromBlockTypePB(BlockCacheSnapshotPB::BlockType pb, BlockCache::BlockType* type) {
+  switch (pb) {
+    case BlockCacheSnapshotPB::DATA: *type = BlockCache::DATA_BLOCK; return true;
+    case BlockCacheSnapshotPB::INDEX: *type = BlockCache::INDEX_BLOCK; return true;
+    case BlockCacheSnapshotPB::BLOOM: *type = BlockCache::BLOOM_BLOCK; return true;
+    case BlockCacheSnapshotPB::DICTIONARY: *type = BlockCache::DICTIONARY_BLOCK; return true;
+    default: return false;
+  }
+}
+
+} // anonymous namespace
+
+BlockCacheWarmer::BlockCacheWarmer(FsManager* fs_manager, TSTabletManager* tablet_manager)
+    : fs_manager_(fs_manager),
+      tablet_manager_(tablet_manager),
+      warmup_done_(false),
+      shutdown_(false),
+      shutdown_cv_(&shutdown_lock_) {
+}
+
+BlockCacheWarmer::~BlockCacheWarmer() {
+  Shutdown();
+}
+
+Status BlockCacheWarmer::Init() {
+  if (!FLAGS_block_cache_warmup) {
+    return Status::OK();
+  }
+  string path = fs_manager_->GetBlockCacheSnapshotPath();
+  Status s = pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, &snapshot_);
+  if (s.IsNotFound()) {
+    snapshot_.Clear();
+  } else if (!s.ok()) {
+    // The snapshot only speeds up the startup: go on without it.
+    LOG(WARNING) << "Could not read the block cache snapshot " << path << ": "
+                 << s.ToString();
+    snapshot_.Clear();
+  }
+  BlockCache::GetSingleton()->StartTrackingBlocks();
+  return ThreadPoolBuilder("block-cache-warmup")
+      .set_min_threads(0)
+      .set_max_threads(1)
+      .Build(&warmup_pool_);
+}
+
+Status BlockCacheWarmer::Start() {
+  if (!FLAGS_block_cache_warmup) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(warmup_pool_->SubmitFunc(boost::bind(&BlockCacheWarmer::RunWarmup, this)));
+  if (fs_manager_->read_only()) {
+    return Status::OK();
+  }
+  return Thread::Create("block-cache-warmup", "snapshot",
+                        &BlockCacheWarmer::RunSnapshotThread, this, &snapshot_thread_);
+}
+
+void BlockCacheWarmer::Shutdown() {
+  {
+    MutexLock l(shutdown_lock_);
+    if (shutdown_) {
+      return;
+    }
+    shutdown_ = true;
+    shutdown_cv_.Broadcast();
+  }
+  if (warmup_pool_) {
+    warmup_pool_->Shutdown();
+  }
+  if (snapshot_thread_) {
+    CHECK_OK(ThreadJoiner(snapshot_thread_.get()).Join());
+    WARN_NOT_OK(SaveSnapshot(), "Could not save the block cache snapshot");
+  }
+}
+
+Status BlockCacheWarmer::SaveSnapshot() {
+  if (!warmup_done()) {
+    return Status::OK();
+  }
+  vector<BlockCache::TrackedBlock> blocks;
+  BlockCache::GetSingleton()->GetTrackedBlocks(&blocks);
+  BlockCacheSnapshotPB pb;
+  for (const auto& block : blocks) {
+    BlockCacheSnapshotPB::BlockPB* block_pb = pb.add_blocks();
+    block_pb->set_file_id(block.key.file_id_);
+    block_pb->set_offset(block.key.offset_);
+    block_pb->set_size(block.disk_size);
+    block_pb->set_type(ToBlockTypePB(block.type));
+  }
+  RETURN_NOT_OK(pb_util::WritePBContainerToPath(fs_manager_->env(),
+                                                fs_manager_->GetBlockCacheSnapshotPath(),
+                                                pb, pb_util::OVERWRITE, pb_util::NO_SYNC));
+  VLOG(1) << "Saved a snapshot of " << blocks.size() << " cached blocks";
+  return Status::OK();
+}
+
+bool BlockCacheWarmer::WaitUntil(const MonoTime& deadline) {
+  MutexLock l(shutdown_lock_);
+  while (!shutdown_) {
+    MonoTime now = MonoTime::Now();
+    if (now >= deadline) {
+      return true;
+    }
+    shutdown_cv_.WaitFor(deadline - now);
+  }
+  return false;
+}
+
+void BlockCacheWarmer::RunWarmup() {
+  // Don't compete with the bootstrap of the tablets.
+  WARN_NOT_OK(tablet_manager_->WaitForAllBootstrapsToFinish(),
+              "Some tablets failed to open");
+
+  LOG_TIMING(INFO, Substitute("warming up the block cache with $0 blocks",
+                              snapshot_.blocks_size())) {
+    const int64_t rate = static_cast<int64_t>(FLAGS_block_cache_warmup_rate_mb) * 1024 * 1024;
+    const MonoTime start = MonoTime::Now();
+    int64_t bytes_read = 0;
+    int num_read = 0;
+    unique_ptr<CFileReader> reader;
+    uint64_t reader_file_id = 0;
+    bool reader_failed = false;
+    for (const auto& block : snapshot_.blocks()) {
+      // Files which were deleted since the snapshot, e.g. by compactions, are
+      // skipped.
+      if (!reader || reader_file_id != block.file_id()) {
+        if (reader_failed && reader_file_id == block.file_id()) {
+          continue;
+        }
+        reader.reset();
+        reader_file_id = block.file_id();
+        unique_ptr<ReadableBlock> fs_block;
+        reader_failed = !fs_manager_->OpenBlock(BlockId(block.file_id()), &fs_block).ok() ||
+            !CFileReader::Open(std::move(fs_block), ReaderOptions(), &reader).ok();
+        if (reader_failed) {
+          reader.reset();
+          continue;
+        }
+      }
+      BlockCache::BlockType type;
+      if (!FromBlockTypePB(block.type(), &type)) {
+        continue;
+      }
+      // Blocks which are already cached are found without any IO.
+      BlockHandle handle;
+      Status s = reader->ReadBlock(BlockPointer(block.offset(), block.size()),
+                                   CFileReader::CACHE_BLOCK, &handle, type);
+      if (!s.ok()) {
+        VLOG(1) << "Could not read block " << BlockId(block.file_id()).ToString()
+                << " at " << block.offset() << ": " << s.ToString();
+        continue;
+      }
+      num_read++;
+      bytes_read += block.size();
+      MonoTime deadline = rate > 0 ?
+          start + MonoDelta::FromSeconds(static_cast<double>(bytes_read) / rate) :
+          MonoTime::Now();
+      if (!WaitUntil(deadline)) {
+        break;
+      }
+    }
+    LOG(INFO) << Substitute("Read $0 blocks ($1 bytes) into the block cache",
+                            num_read, bytes_read);
+  }
+  snapshot_.Clear();
+  warmup_done_.Store(true);
+}
+
+void BlockCacheWarmer::RunSnapshotThread() {
+  while (WaitUntil(MonoTime::Now() +
+                   MonoDelta::FromSeconds(FLAGS_block_cache_snapshot_interval_secs))) {
+    WARN_NOT_OK(SaveSnapshot(), "Could not save the block cache snapshot");
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
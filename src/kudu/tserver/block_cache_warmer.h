@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_BLOCK_CACHE_WARMER_H
+#define KUDU_TSERVER_BLOCK_CACHE_WARMER_H
+
+#include <memory>
+
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class FsManager;
+class MonoTime;
+class Thread;
+class ThreadPool;
+
+namespace tserver {
+
+class TSTabletManager;
+
+// Keeps the block cache warm across restarts.
+//
+// If --block_cache_warmup is set, the set of blocks in the block cache is
+// saved to a file in the metadata directory periodically and at shutdown.
+// At startup, once the tablets are open, the blocks listed by the previous
+// snapshot are read back into the cache in the background, sorted by file
+// and offset and no faster than --block_cache_warmup_rate_mb, so that the
+// reads don't compete with the bootstrap of the tablets.
+class BlockCacheWarmer {
+ public:
+  BlockCacheWarmer(FsManager* fs_manager, TSTabletManager* tablet_manager);
+  ~BlockCacheWarmer();
+
+  // Loads the snapshot saved by the previous run, and starts tracking the
+  // blocks read into the cache. Must be called before the tablets are
+  // opened.
+  Status Init();
+
+  // Starts reading the blocks of the previous snapshot into the cache, once
+  // the tablets are open, and saving snapshots periodically.
+  Status Start();
+
+  // Stops the warm-up and saves a last snapshot.
+  void Shutdown();
+
+  // Saves the blocks currently in the block cache.
+  Status SaveSnapshot();
+
+  // Returns true if the warm-up is done.
+  bool warmup_done() const {
+    return warmup_done_.Load();
+  }
+
+ private:
+  // Reads the blocks of 'snapshot_' into the block cache.
+  void RunWarmup();
+
+  // Saves the snapshot every --block_cache_snapshot_interval_secs.
+  void RunSnapshotThread();
+
+  // Waits until 'deadline' or shutdown. Returns false on shutdown.
+  bool WaitUntil(const MonoTime& deadline);
+
+  FsManager* const fs_manager_;
+  TSTabletManager* const tablet_manager_;
+
+  // The snapshot saved by the previous run.
+  cfile::BlockCacheSnapshotPB snapshot_;
+
+  // Snapshots are only saved once the warm-up is done, so that a restart
+  // during the warm-up doesn't lose the part of the previous snapshot which
+  // wasn't read yet.
+  AtomicBool warmup_done_;
+
+  gscoped_ptr<ThreadPool> warmup_pool_;
+  scoped_refptr<Thread> snapshot_thread_;
+
+  // Set on shutdown, and protected by 'shutdown_lock_'.
+  bool shutdown_;
+  Mutex shutdown_lock_;
+  ConditionVariable shutdown_cv_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCacheWarmer);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
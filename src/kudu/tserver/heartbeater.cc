@@ -34,6 +34,7 @@
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/replica_management.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
@@ -100,12 +101,29 @@ DEFINE_uint32(heartbeat_inject_required_feature_flag, 0,
 TAG_FLAG(heartbeat_inject_required_feature_flag, runtime);
 TAG_FLAG(heartbeat_inject_required_feature_flag, unsafe);
 
+DEFINE_bool(heartbeat_omit_unchanged_consensus_states, true,
+            "Whether incremental tablet reports omit the consensus state of "
+            "tablets whose consensus state hasn't changed since the last "
+            "report acknowledged by the leader master, sending only a marker "
+            "in its place.");
+TAG_FLAG(heartbeat_omit_unchanged_consensus_states, advanced);
+TAG_FLAG(heartbeat_omit_unchanged_consensus_states, runtime);
+
+DEFINE_int32(heartbeat_tablet_load_stats_interval_ms, 10000,
+             "Interval at which the tablet server sends the load statistics "
+             "of its tablet replicas to the leader master along with a "
+             "heartbeat. Set to 0 to not send them.");
+TAG_FLAG(heartbeat_tablet_load_stats_interval_ms, advanced);
+TAG_FLAG(heartbeat_tablet_load_stats_interval_ms, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
+using kudu::consensus::ConsensusStatePB;
 using kudu::consensus::ReplicaManagementInfoPB;
 using kudu::master::MasterErrorPB;
 using kudu::master::MasterFeatures;
 using kudu::master::MasterServiceProxy;
+using kudu::master::ReportedTabletPB;
 using kudu::master::TabletReportPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::rpc::ErrorStatusPB;
@@ -162,6 +180,16 @@ class Heartbeater::Thread {
   // tablets which have not changed since the acknowledged report.
   void MarkTabletReportAcknowledged(const TabletReportPB& report);
 
+  // Replace the consensus states in the incremental 'report' which are the
+  // same as in the last acknowledged report with the 'unchanged' marker.
+  void OmitUnchangedConsensusStates(TabletReportPB* report) const;
+
+  // Remember the consensus states sent in the given report, which was
+  // acknowledged by the master. If the master isn't the leader, forget all
+  // of them instead: only the leader processes the reports.
+  void RecordReportedConsensusStates(const TabletReportPB& report,
+                                     bool is_leader_master);
+
  private:
   void RunThread();
   Status ConnectToMaster();
@@ -217,6 +245,15 @@ class Heartbeater::Thread {
   // Next tablet report seqno.
   std::atomic_int next_report_seq_;
 
+  // The last time load statistics were sent to the leader master. Only
+  // accessed by the heartbeat thread.
+  MonoTime last_tablet_load_stats_time_;
+
+  // The serialized consensus states of the tablets as of the last reports
+  // acknowledged by the leader master, keyed by tablet ID. Only accessed by
+  // the heartbeat thread.
+  std::unordered_map<std::string, std::string> reported_cstates_;
+
   // Mutex/condition pair to trigger the heartbeater thread
   // to either heartbeat early or exit.
   Mutex mutex_;
@@ -359,6 +396,10 @@ Status Heartbeater::Thread::SetupRegistration(ServerRegistrationPB* reg) {
   RETURN_NOT_OK(CHECK_NOTNULL(server_->rpc_server())->GetAdvertisedAddresses(&addrs));
   RETURN_NOT_OK_PREPEND(AddHostPortPBs(addrs, reg->mutable_rpc_addresses()),
                         "Failed to add RPC addresses to registration");
+  const string& unix_domain_socket_path = server_->rpc_server()->unix_domain_socket_path();
+  if (!unix_domain_socket_path.empty()) {
+    reg->set_unix_domain_socket_path(unix_domain_socket_path);
+  }
 
   addrs.clear();
   if (server_->web_server()) {
@@ -480,9 +521,29 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
     VLOG(2) << Substitute("Sending an incremental tablet report to master $0...",
                           master_address_.ToString());
     GenerateIncrementalTabletReport(req.mutable_tablet_report());
+    if (FLAGS_heartbeat_omit_unchanged_consensus_states &&
+        last_hb_response_.accepts_unchanged_consensus_states()) {
+      OmitUnchangedConsensusStates(req.mutable_tablet_report());
+    }
   }
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
 
+  // Only the leader master keeps track of the load statistics.
+  const MonoTime now = MonoTime::Now();
+  bool send_tablet_load_stats = false;
+  if (FLAGS_heartbeat_tablet_load_stats_interval_ms > 0 &&
+      last_hb_response_.leader_master() &&
+      (!last_tablet_load_stats_time_.Initialized() ||
+       now - last_tablet_load_stats_time_ >=
+       MonoDelta::FromMilliseconds(FLAGS_heartbeat_tablet_load_stats_interval_ms))) {
+    vector<master::TabletLoadStatsPB> stats;
+    server_->tablet_manager()->GetTabletLoadStats(&stats);
+    for (auto& tablet_stats : stats) {
+      req.add_tablet_load_stats()->Swap(&tablet_stats);
+    }
+    send_tablet_load_stats = true;
+  }
+
   VLOG(2) << "Sending heartbeat:\n" << SecureDebugString(req);
   master::TSHeartbeatResponsePB resp;
   const auto& s = proxy_->TSHeartbeat(req, &resp, &rpc);
@@ -540,6 +601,11 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
         "failed to import token signing public keys from master heartbeat");
   }
 
+  if (send_tablet_load_stats) {
+    last_tablet_load_stats_time_ = now;
+  }
+
+  RecordReportedConsensusStates(req.tablet_report(), last_hb_response_.leader_master());
   MarkTabletReportAcknowledged(req.tablet_report());
   return Status::OK();
 }
@@ -639,6 +705,61 @@ void Heartbeater::Thread::MarkTabletReportAcknowledged(const TabletReportPB& rep
   }
 }
 
+void Heartbeater::Thread::OmitUnchangedConsensusStates(TabletReportPB* report) const {
+  DCHECK(IsCurrentThread());
+  DCHECK(report->is_incremental());
+  for (auto& reported_tablet : *report->mutable_updated_tablets()) {
+    if (!reported_tablet.has_consensus_state() || reported_tablet.has_error()) {
+      continue;
+    }
+    const ConsensusStatePB& cstate = reported_tablet.consensus_state();
+    // The health reports of a leader drive the replica replacement decisions
+    // of the master, which it reconsiders on every report that carries them.
+    bool has_health_report = false;
+    for (const auto& peer : cstate.committed_config().peers()) {
+      if (peer.has_health_report()) {
+        has_health_report = true;
+        break;
+      }
+    }
+    if (has_health_report) {
+      continue;
+    }
+    const string* prev = FindOrNull(reported_cstates_, reported_tablet.tablet_id());
+    if (prev == nullptr || *prev != cstate.SerializeAsString()) {
+      continue;
+    }
+    if (cstate.committed_config().has_opid_index()) {
+      reported_tablet.set_committed_config_opid_index(
+          cstate.committed_config().opid_index());
+    }
+    reported_tablet.clear_consensus_state();
+    reported_tablet.set_consensus_state_unchanged(true);
+  }
+}
+
+void Heartbeater::Thread::RecordReportedConsensusStates(const TabletReportPB& report,
+                                                        bool is_leader_master) {
+  DCHECK(IsCurrentThread());
+  if (!is_leader_master || !report.is_incremental()) {
+    reported_cstates_.clear();
+    if (!is_leader_master) {
+      return;
+    }
+  }
+  for (const auto& tablet_id : report.removed_tablet_ids()) {
+    reported_cstates_.erase(tablet_id);
+  }
+  for (const auto& reported_tablet : report.updated_tablets()) {
+    if (reported_tablet.has_consensus_state() && !reported_tablet.has_error()) {
+      reported_cstates_[reported_tablet.tablet_id()] =
+          reported_tablet.consensus_state().SerializeAsString();
+    } else if (!reported_tablet.consensus_state_unchanged()) {
+      reported_cstates_.erase(reported_tablet.tablet_id());
+    }
+  }
+}
+
 Status Heartbeater::Thread::Start() {
   CHECK(thread_ == nullptr);
 
@@ -0,0 +1,207 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_aggregator.h"
+
+#include <cstddef>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/slice.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+bool IsSummable(const TypeInfo* type_info) {
+  if (type_info->type() == UNIXTIME_MICROS) {
+    return false;
+  }
+  switch (type_info->physical_type()) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case FLOAT:
+    case DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // anonymous namespace
+
+Status ScanAggregator::Create(const RepeatedPtrField<AggregatePB>& aggregates,
+                              const Schema& projection,
+                              unique_ptr<ScanAggregator>* aggregator) {
+  unique_ptr<ScanAggregator> agg(new ScanAggregator());
+  for (const AggregatePB& pb : aggregates) {
+    State state;
+    state.type = pb.type();
+    state.col_idx = -1;
+    state.type_info = nullptr;
+    state.count = 0;
+    state.int_sum = 0;
+    state.double_sum = 0;
+
+    if (pb.has_projection_idx()) {
+      if (pb.projection_idx() < 0 || pb.projection_idx() >= projection.num_columns()) {
+        return Status::InvalidArgument(
+            Substitute("aggregate column index $0 is out of range", pb.projection_idx()));
+      }
+      state.col_idx = pb.projection_idx();
+      state.type_info = projection.column(state.col_idx).type_info();
+    }
+
+    switch (pb.type()) {
+      case AggregatePB::COUNT:
+        break;
+      case AggregatePB::SUM:
+        if (state.type_info != nullptr && !IsSummable(state.type_info)) {
+          return Status::InvalidArgument(
+              Substitute("cannot SUM column $0 of type $1",
+                         projection.column(state.col_idx).name(),
+                         state.type_info->name()));
+        }
+        FALLTHROUGH_INTENDED;
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        if (state.type_info == nullptr) {
+          return Status::InvalidArgument(
+              Substitute("$0 aggregate requires a column", AggregatePB::Type_Name(pb.type())));
+        }
+        break;
+      default:
+        return Status::InvalidArgument("unknown aggregate type", pb.ShortDebugString());
+    }
+    agg->states_.emplace_back(std::move(state));
+  }
+  *aggregator = std::move(agg);
+  return Status::OK();
+}
+
+void ScanAggregator::AddRowBlock(const RowBlock& block) {
+  for (State& state : states_) {
+    if (state.col_idx < 0) {
+      state.count += block.selection_vector()->CountSelected();
+    } else {
+      AddColumn(block, &state);
+    }
+  }
+}
+
+void ScanAggregator::AddColumn(const RowBlock& block, State* state) {
+  const SelectionVector* sel = block.selection_vector();
+  ColumnBlock col = block.column_block(state->col_idx);
+  const TypeInfo* type_info = state->type_info;
+  const bool is_binary = type_info->physical_type() == BINARY;
+  const size_t nrows = block.nrows();
+
+  for (size_t i = 0; i < nrows; i++) {
+    if (!sel->IsRowSelected(i) || (col.is_nullable() && col.is_null(i))) {
+      continue;
+    }
+    const uint8_t* cell = col.cell_ptr(i);
+    switch (state->type) {
+      case AggregatePB::COUNT:
+        break;
+      case AggregatePB::SUM:
+        switch (type_info->physical_type()) {
+          case INT8: state->int_sum += *reinterpret_cast<const int8_t*>(cell); break;
+          case INT16: state->int_sum += *reinterpret_cast<const int16_t*>(cell); break;
+          case INT32: state->int_sum += *reinterpret_cast<const int32_t*>(cell); break;
+          case INT64:
+            // Wrap around on overflow rather than invoking undefined behavior.
+            state->int_sum = static_cast<int64_t>(
+                static_cast<uint64_t>(state->int_sum) +
+                static_cast<uint64_t>(*reinterpret_cast<const int64_t*>(cell)));
+            break;
+          case FLOAT: state->double_sum += *reinterpret_cast<const float*>(cell); break;
+          case DOUBLE: state->double_sum += *reinterpret_cast<const double*>(cell); break;
+          default: LOG(DFATAL) << "unexpected type " << type_info->name();
+        }
+        break;
+      case AggregatePB::MIN:
+      case AggregatePB::MAX: {
+        bool replace = state->count == 0;
+        if (!replace) {
+          int cmp;
+          if (is_binary) {
+            Slice cur(state->value);
+            cmp = type_info->Compare(cell, &cur);
+          } else {
+            cmp = type_info->Compare(cell, state->value.data());
+          }
+          replace = state->type == AggregatePB::MIN ? cmp < 0 : cmp > 0;
+        }
+        if (replace) {
+          if (is_binary) {
+            const Slice* s = reinterpret_cast<const Slice*>(cell);
+            state->value.assign(reinterpret_cast<const char*>(s->data()), s->size());
+          } else {
+            state->value.assign(reinterpret_cast<const char*>(cell), type_info->size());
+          }
+        }
+        break;
+      }
+      default:
+        LOG(DFATAL) << "unexpected aggregate type " << state->type;
+    }
+    state->count++;
+  }
+}
+
+void ScanAggregator::ToPB(RepeatedPtrField<AggregateResultPB>* results) const {
+  for (const State& state : states_) {
+    AggregateResultPB* result = results->Add();
+    result->set_count(state.count);
+    switch (state.type) {
+      case AggregatePB::SUM:
+        if (state.type_info->physical_type() == FLOAT ||
+            state.type_info->physical_type() == DOUBLE) {
+          result->set_double_sum(state.double_sum);
+        } else {
+          result->set_int_sum(state.int_sum);
+        }
+        break;
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        if (state.count > 0) {
+          result->set_value(state.value);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_AGGREGATOR_H
+#define KUDU_TSERVER_SCAN_AGGREGATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/repeated_field.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowBlock;
+class Schema;
+class TypeInfo;
+
+namespace tserver {
+
+// Evaluates the aggregates of an aggregating scan (see
+// NewScanRequestPB.aggregates) over the row blocks produced by the scanner's
+// iterator, which have already had all predicates applied.
+//
+// Not thread-safe.
+class ScanAggregator {
+ public:
+  // Creates an aggregator for 'aggregates', where 'projection' is the client's
+  // projection. Returns InvalidArgument if an aggregate is malformed or does
+  // not apply to its column's type.
+  static Status Create(const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates,
+                       const Schema& projection,
+                       std::unique_ptr<ScanAggregator>* aggregator);
+
+  // Folds the selected rows of 'block' into the results. The leading columns
+  // of the block's schema must be those of the projection passed to Create().
+  void AddRowBlock(const RowBlock& block);
+
+  // Appends one result per aggregate, in the order they were requested.
+  void ToPB(google::protobuf::RepeatedPtrField<AggregateResultPB>* results) const;
+
+ private:
+  struct State {
+    AggregatePB::Type type;
+
+    // The index of the aggregated column, or -1 for COUNT(*).
+    int col_idx;
+    const TypeInfo* type_info;
+
+    int64_t count;
+    int64_t int_sum;
+    double double_sum;
+
+    // The current MIN or MAX, valid if 'count' > 0. Holds the cell for
+    // fixed-length types and the data for binary types.
+    std::string value;
+  };
+
+  ScanAggregator() = default;
+
+  void AddColumn(const RowBlock& block, State* state);
+
+  std::vector<State> states_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanAggregator);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif // KUDU_TSERVER_SCAN_AGGREGATOR_H
@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_result_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+class ScanResultCacheTest : public KuduTest {
+ protected:
+  static NewScanRequestPB MakeScan() {
+    NewScanRequestPB scan_pb;
+    scan_pb.set_tablet_id("tablet");
+    scan_pb.set_read_mode(READ_AT_SNAPSHOT);
+    scan_pb.set_snap_timestamp(12345);
+    scan_pb.add_projected_columns()->set_name("key");
+    return scan_pb;
+  }
+};
+
+TEST_F(ScanResultCacheTest, TestIsCacheable) {
+  NewScanRequestPB scan_pb = MakeScan();
+  ASSERT_TRUE(ScanResultCache::IsCacheable(scan_pb));
+
+  scan_pb.clear_snap_timestamp();
+  ASSERT_FALSE(ScanResultCache::IsCacheable(scan_pb));
+
+  scan_pb = MakeScan();
+  scan_pb.set_read_mode(READ_LATEST);
+  ASSERT_FALSE(ScanResultCache::IsCacheable(scan_pb));
+
+  scan_pb = MakeScan();
+  scan_pb.set_row_format_flags(RowFormatFlags::COLUMNAR_LAYOUT);
+  ASSERT_FALSE(ScanResultCache::IsCacheable(scan_pb));
+}
+
+TEST_F(ScanResultCacheTest, TestMakeKey) {
+  const NewScanRequestPB scan_pb = MakeScan();
+  const string key = ScanResultCache::MakeKey(0, scan_pb);
+
+  // The propagated timestamp doesn't change the result of the scan.
+  NewScanRequestPB other = scan_pb;
+  other.set_propagated_timestamp(67890);
+  other.set_cache_blocks(false);
+  ASSERT_EQ(key, ScanResultCache::MakeKey(0, other));
+
+  // The snapshot, the projection and the schema version do.
+  other = scan_pb;
+  other.set_snap_timestamp(12346);
+  ASSERT_NE(key, ScanResultCache::MakeKey(0, other));
+  other = scan_pb;
+  other.add_projected_columns()->set_name("val");
+  ASSERT_NE(key, ScanResultCache::MakeKey(0, other));
+  ASSERT_NE(key, ScanResultCache::MakeKey(1, scan_pb));
+}
+
+TEST_F(ScanResultCacheTest, TestGetAndPut) {
+  ScanResultCache cache(1024 * 1024, nullptr);
+  const string key = ScanResultCache::MakeKey(0, MakeScan());
+  ScanResultCache::Result result;
+  ASSERT_FALSE(cache.Get(key, &result));
+
+  cache.Put(key, 2, Slice("rows"), Slice(), Slice("last"));
+  ASSERT_TRUE(cache.Get(key, &result));
+  ASSERT_EQ(2, result.num_rows);
+  ASSERT_EQ("rows", result.rows_data->ToString());
+  ASSERT_EQ(0, result.indirect_data->size());
+  ASSERT_EQ("last", result.last_primary_key);
+
+  // The result of the scan after an alter isn't found.
+  ASSERT_FALSE(cache.Get(ScanResultCache::MakeKey(1, MakeScan()), &result));
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,123 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_result_cache.h"
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/port.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+
+METRIC_DEFINE_counter(server, scan_result_cache_hits,
+                      "Scan Result Cache Hits",
+                      kudu::MetricUnit::kRequests,
+                      "Number of new scans answered from the scan result cache");
+
+METRIC_DEFINE_counter(server, scan_result_cache_misses,
+                      "Scan Result Cache Misses",
+                      kudu::MetricUnit::kRequests,
+                      "Number of cacheable new scans not found in the scan result cache");
+
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+ScanResultCache::ScanResultCache(size_t capacity_bytes,
+                                 const scoped_refptr<MetricEntity>& metric_entity)
+    : cache_(NewCache(DRAM_CACHE, CacheEvictionPolicy::CLOCK, capacity_bytes,
+                      "scan-result-cache")) {
+  if (metric_entity) {
+    hits_ = METRIC_scan_result_cache_hits.Instantiate(metric_entity);
+    misses_ = METRIC_scan_result_cache_misses.Instantiate(metric_entity);
+  }
+}
+
+ScanResultCache::~ScanResultCache() {
+}
+
+bool ScanResultCache::IsCacheable(const NewScanRequestPB& scan_pb) {
+  return scan_pb.read_mode() == READ_AT_SNAPSHOT &&
+      scan_pb.has_snap_timestamp() &&
+      scan_pb.aggregates_size() == 0 &&
+      !(scan_pb.row_format_flags() & RowFormatFlags::COLUMNAR_LAYOUT);
+}
+
+string ScanResultCache::MakeKey(uint32_t schema_version, const NewScanRequestPB& scan_pb) {
+  // Neither the propagated timestamp nor whether to cache the blocks read
+  // changes the rows returned at the snapshot.
+  NewScanRequestPB key_pb(scan_pb);
+  key_pb.clear_propagated_timestamp();
+  key_pb.clear_cache_blocks();
+  faststring key;
+  PutVarint32(&key, schema_version);
+  PutLengthPrefixedSlice(&key, key_pb.SerializeAsString());
+  return key.ToString();
+}
+
+bool ScanResultCache::Get(const string& key, Result* result) {
+  Cache::UniqueHandle h(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                        Cache::HandleDeleter(cache_.get()));
+  if (!h) {
+    if (misses_) misses_->Increment();
+    return false;
+  }
+  Slice value = cache_->Value(h.get());
+  uint32_t num_rows;
+  Slice rows_data;
+  Slice indirect_data;
+  Slice last_primary_key;
+  if (PREDICT_FALSE(!GetVarint32(&value, &num_rows) ||
+                    !GetLengthPrefixedSlice(&value, &rows_data) ||
+                    !GetLengthPrefixedSlice(&value, &indirect_data) ||
+                    !GetLengthPrefixedSlice(&value, &last_primary_key))) {
+    LOG(DFATAL) << "corrupt scan result cache entry";
+    return false;
+  }
+  if (hits_) hits_->Increment();
+  result->num_rows = num_rows;
+  result->rows_data.reset(new faststring(rows_data.size()));
+  result->rows_data->append(rows_data.data(), rows_data.size());
+  result->indirect_data.reset(new faststring(indirect_data.size()));
+  result->indirect_data->append(indirect_data.data(), indirect_data.size());
+  result->last_primary_key = last_primary_key.ToString();
+  return true;
+}
+
+void ScanResultCache::Put(const string& key, int32_t num_rows, const Slice& rows_data,
+                          const Slice& indirect_data, const Slice& last_primary_key) {
+  faststring value;
+  PutVarint32(&value, num_rows);
+  PutLengthPrefixedSlice(&value, rows_data);
+  PutLengthPrefixedSlice(&value, indirect_data);
+  PutLengthPrefixedSlice(&value, last_primary_key);
+  Cache::PendingHandle* pending = cache_->Allocate(key, value.size());
+  if (PREDICT_FALSE(pending == nullptr)) {
+    // The result doesn't fit into the cache.
+    return;
+  }
+  memcpy(cache_->MutableValue(pending), value.data(), value.size());
+  cache_->Release(cache_->Insert(pending, nullptr));
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,96 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_RESULT_CACHE_H
+#define KUDU_TSERVER_SCAN_RESULT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+class Cache;
+
+namespace tserver {
+
+class NewScanRequestPB;
+
+// A cache of the results of snapshot scans which are answered with a single
+// batch, so that repeated identical scans, such as those of dashboards, are
+// answered without reading the tablet again.
+//
+// Only scans at an explicit snapshot timestamp are cached. Once that
+// timestamp is safe, which it is by the time the scan has run, the scan
+// always returns the same rows: entries never need to be invalidated by
+// writes, flushes or compactions. The key of an entry embeds the schema
+// version of the tablet, since the columns a projection refers to by name
+// may change with an alter.
+//
+// The memory used by the entries is tracked by the "scan-result-cache"
+// MemTracker.
+//
+// This class is thread-safe.
+class ScanResultCache {
+ public:
+  // The cached result of a scan.
+  struct Result {
+    int32_t num_rows;
+    std::unique_ptr<faststring> rows_data;
+    std::unique_ptr<faststring> indirect_data;
+    std::string last_primary_key;
+  };
+
+  ScanResultCache(size_t capacity_bytes, const scoped_refptr<MetricEntity>& metric_entity);
+  ~ScanResultCache();
+
+  // Returns whether the result of the scan requested by 'scan_pb' may be
+  // cached, provided it's answered with a single batch of rows.
+  static bool IsCacheable(const NewScanRequestPB& scan_pb);
+
+  // Returns the cache key for the scan requested by 'scan_pb' of a tablet
+  // with schema version 'schema_version'.
+  static std::string MakeKey(uint32_t schema_version, const NewScanRequestPB& scan_pb);
+
+  // Looks up the result cached under 'key', filling in 'result' and
+  // returning true if found.
+  bool Get(const std::string& key, Result* result);
+
+  // Caches the result of a scan under 'key'.
+  void Put(const std::string& key, int32_t num_rows, const Slice& rows_data,
+           const Slice& indirect_data, const Slice& last_primary_key);
+
+ private:
+  gscoped_ptr<Cache> cache_;
+
+  scoped_refptr<Counter> hits_;
+  scoped_refptr<Counter> misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultCache);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
@@ -30,6 +30,18 @@ METRIC_DEFINE_histogram(server, scanner_duration,
                         "Histogram of the duration of active scanners on this server",
                         60000000LU, 2);
 
+METRIC_DEFINE_counter(server, scan_batches_shrunk,
+                      "Scan Batches Shrunk",
+                      kudu::MetricUnit::kRequests,
+                      "Number of batches of scan results shrunk to fit the remaining "
+                      "scanner memory budget since service start");
+
+METRIC_DEFINE_counter(server, scan_batches_rejected,
+                      "Scan Batches Rejected",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan requests rejected because the scanner memory "
+                      "budget was exhausted since service start");
+
 namespace kudu {
 
 namespace tserver {
@@ -37,7 +49,9 @@ namespace tserver {
 ScannerMetrics::ScannerMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : scanners_expired(
           METRIC_scanners_expired.Instantiate(metric_entity)),
-      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)) {
+      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)),
+      scan_batches_shrunk(METRIC_scan_batches_shrunk.Instantiate(metric_entity)),
+      scan_batches_rejected(METRIC_scan_batches_rejected.Instantiate(metric_entity)) {
 }
 
 void ScannerMetrics::SubmitScannerDuration(const MonoTime& time_started) {
@@ -41,6 +41,11 @@ struct ScannerMetrics {
 
   // Keeps track of the duration of scanners.
   scoped_refptr<Histogram> scanner_duration;
+
+  // Keeps track of the batches of scan results shrunk or rejected because
+  // the scanners' memory budget was short.
+  scoped_refptr<Counter> scan_batches_shrunk;
+  scoped_refptr<Counter> scan_batches_rejected;
 };
 
 } // namespace tserver
@@ -27,8 +27,11 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
 
 DECLARE_int32(scanner_ttl_ms);
 
@@ -38,6 +41,7 @@ using tablet::TabletReplica;
 
 namespace tserver {
 
+using std::shared_ptr;
 using std::vector;
 
 TEST(ScannersTest, TestManager) {
@@ -87,5 +91,33 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+TEST(ScannerTest, TestAdmitBatch) {
+  MetricRegistry registry;
+  shared_ptr<MemTracker> parent = MemTracker::CreateTracker(1024 * 1024, "parent");
+  ScannerManager mgr(METRIC_ENTITY_server.Instantiate(&registry, "test"), parent);
+
+  // Each batch is accounted for twice its size, for its row and indirect data.
+  size_t admitted;
+  ASSERT_OK(mgr.AdmitBatch(256 * 1024, &admitted));
+  ASSERT_EQ(256 * 1024, admitted);
+  ASSERT_EQ(512 * 1024, mgr.mem_tracker()->consumption());
+
+  // A batch which doesn't fit is shrunk to the remaining memory.
+  size_t shrunk;
+  ASSERT_OK(mgr.AdmitBatch(512 * 1024, &shrunk));
+  ASSERT_EQ(256 * 1024, shrunk);
+  ASSERT_EQ(1, mgr.metrics_->scan_batches_shrunk->value());
+
+  // Once the memory is exhausted, batches are rejected.
+  size_t rejected;
+  Status s = mgr.AdmitBatch(256 * 1024, &rejected);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  ASSERT_EQ(1, mgr.metrics_->scan_batches_rejected->value());
+
+  mgr.ReleaseBatch(admitted);
+  mgr.ReleaseBatch(shrunk);
+  ASSERT_EQ(0, mgr.mem_tracker()->consumption());
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -40,9 +40,11 @@
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(scanner_ttl_ms, 60000,
              "Number of milliseconds of inactivity allowed for a scanner"
@@ -57,6 +59,22 @@ DEFINE_int32(scan_history_count, 20,
              "scans will be shown on the tablet server's scans dashboard.");
 TAG_FLAG(scan_history_count, experimental);
 
+DEFINE_int64(scanner_memory_limit_mb, -1,
+             "Maximum amount of memory the batches of scan results being built "
+             "may use, in MiB. Beyond it, batches are shrunk and eventually "
+             "rejected so that the client retries them later. The batches are "
+             "also bounded by the memory limit of the server. -1 means no limit "
+             "beyond that of the server.");
+TAG_FLAG(scanner_memory_limit_mb, advanced);
+TAG_FLAG(scanner_memory_limit_mb, experimental);
+
+DEFINE_int32(scanner_min_admitted_batch_size_bytes, 64 * 1024,
+             "The smallest batch of scan results admitted when memory is short. "
+             "Scan requests whose batch would need to be shrunk further are "
+             "rejected instead.");
+TAG_FLAG(scanner_min_admitted_batch_size_bytes, advanced);
+TAG_FLAG(scanner_min_admitted_batch_size_bytes, runtime);
+
 METRIC_DEFINE_gauge_size(server, active_scanners,
                          "Active Scanners",
                          kudu::MetricUnit::kScanners,
@@ -72,8 +90,12 @@ using tablet::TabletReplica;
 
 namespace tserver {
 
-ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
-    : shutdown_(false),
+ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                               const std::shared_ptr<MemTracker>& parent_mem_tracker)
+    : mem_tracker_(MemTracker::CreateTracker(
+          FLAGS_scanner_memory_limit_mb < 0 ? -1 : FLAGS_scanner_memory_limit_mb * 1024 * 1024,
+          "scanners", parent_mem_tracker)),
+      shutdown_(false),
       shutdown_cv_(&shutdown_lock_),
       completed_scans_offset_(0) {
   if (metric_entity) {
@@ -86,6 +108,7 @@ ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
   for (size_t i = 0; i < kNumScannerMapStripes; i++) {
     scanner_maps_.push_back(new ScannerMapStripe());
   }
+  CHECK_OK(ThreadPoolBuilder("scan").Build(&scan_pool_));
 
   if (FLAGS_scan_history_count > 0) {
     completed_scans_.reserve(FLAGS_scan_history_count);
@@ -273,6 +296,48 @@ void ScannerManager::RemoveExpiredScanners() {
   }
 }
 
+namespace {
+// The memory needed to build a batch of results of 'batch_size_bytes': the
+// row data and the indirect data are each buffered for the whole batch.
+int64_t BatchMemory(size_t batch_size_bytes) {
+  return 2 * static_cast<int64_t>(batch_size_bytes);
+}
+} // anonymous namespace
+
+Status ScannerManager::AdmitBatch(size_t batch_size_bytes, size_t* admitted_bytes) {
+  if (mem_tracker_->TryConsume(BatchMemory(batch_size_bytes))) {
+    *admitted_bytes = batch_size_bytes;
+    return Status::OK();
+  }
+
+  // Shrink the batch to fit the remaining memory, down to a floor below
+  // which batches are too small to be worth the round trip.
+  const size_t min_batch_size_bytes =
+      std::min<size_t>(batch_size_bytes, FLAGS_scanner_min_admitted_batch_size_bytes);
+  const size_t spare_bytes = std::max<int64_t>(mem_tracker_->SpareCapacity(), 0) / 2;
+  const size_t shrunk_bytes = std::min(batch_size_bytes, spare_bytes);
+  if (shrunk_bytes >= min_batch_size_bytes &&
+      mem_tracker_->TryConsume(BatchMemory(shrunk_bytes))) {
+    if (metrics_) {
+      metrics_->scan_batches_shrunk->Increment();
+    }
+    *admitted_bytes = shrunk_bytes;
+    return Status::OK();
+  }
+
+  if (metrics_) {
+    metrics_->scan_batches_rejected->Increment();
+  }
+  KLOG_EVERY_N_SECS(WARNING, 1) << Substitute(
+      "Rejecting scan batch of $0 bytes: scanner memory budget exhausted "
+      "($1 bytes consumed)", batch_size_bytes, mem_tracker_->consumption()) << THROTTLE_MSG;
+  return Status::ServiceUnavailable("Rejecting scan request: scanner memory budget exhausted");
+}
+
+void ScannerManager::ReleaseBatch(size_t admitted_bytes) {
+  mem_tracker_->Release(BatchMemory(admitted_bytes));
+}
+
 void ScannerManager::RecordCompletedScanUnlocked(ScanDescriptor descriptor) {
   if (completed_scans_.capacity() == 0) {
     return;
@@ -296,10 +361,13 @@ Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
       tablet_replica_(tablet_replica),
       requestor_string_(std::move(requestor_string)),
       call_seq_id_(0),
+      cpu_time_us_(0),
+      cfile_cache_miss_bytes_(0),
       start_time_(MonoTime::Now()),
       metrics_(metrics),
       arena_(256),
-      row_format_flags_(row_format_flags) {
+      row_format_flags_(row_format_flags),
+      rows_left_(-1) {
   if (tablet_replica_) {
     auto tablet = tablet_replica->shared_tablet();
     if (tablet && tablet->metrics()) {
@@ -326,6 +394,12 @@ void Scanner::UpdateAccessTime() {
   last_access_time_ = MonoTime::Now();
 }
 
+void Scanner::AddResourceUsage(int64_t cpu_time_us, int64_t cfile_cache_miss_bytes) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  cpu_time_us_ += cpu_time_us;
+  cfile_cache_miss_bytes_ += cfile_cache_miss_bytes;
+}
+
 void Scanner::Init(gscoped_ptr<RowwiseIterator> iter,
                    gscoped_ptr<ScanSpec> spec) {
   std::lock_guard<simple_spinlock> l(lock_);
@@ -389,6 +463,8 @@ ScanDescriptor Scanner::descriptor() const {
     std::lock_guard<simple_spinlock> l(lock_);
     descriptor.last_call_seq_id = call_seq_id_;
     descriptor.last_access_time = last_access_time_;
+    descriptor.cpu_time_us = cpu_time_us_;
+    descriptor.cfile_cache_miss_bytes = cfile_cache_miss_bytes_;
   }
 
   return descriptor;
@@ -34,6 +34,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
@@ -46,11 +47,13 @@
 
 namespace kudu {
 
+class MemTracker;
 class RowwiseIterator;
 class ScanSpec;
 class Schema;
 class Status;
 class Thread;
+class ThreadPool;
 
 namespace tserver {
 
@@ -68,9 +71,15 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 //
 // Since scanners keep resources on the server, the manager periodically
 // removes any scanners which have not been accessed since a configurable TTL.
+//
+// The memory buffering the scanners' batches of results is tracked by the
+// "scanners" MemTracker, a child of 'parent_mem_tracker', and bounded by
+// --scanner_memory_limit_mb as well as by the limits of its ancestors.
 class ScannerManager {
  public:
-  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
+  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                          const std::shared_ptr<MemTracker>& parent_mem_tracker =
+                              std::shared_ptr<MemTracker>());
   ~ScannerManager();
 
   // Starts the expired scanner removal thread.
@@ -106,7 +115,29 @@ class ScannerManager {
   // Iterate through scanners and remove any which are past their TTL.
   void RemoveExpiredScanners();
 
+  // Admits a batch of scan results of up to 'batch_size_bytes' against the
+  // scanners' memory budget, setting 'admitted_bytes' to the batch size to
+  // use: if the budget is short, the batch is shrunk to fit the remaining
+  // memory. Returns ServiceUnavailable, so that the client retries with
+  // backoff, if not even a batch of --scanner_min_admitted_batch_size_bytes
+  // fits. On success, the batch must be released with ReleaseBatch().
+  Status AdmitBatch(size_t batch_size_bytes, size_t* admitted_bytes);
+
+  // Releases the memory of a batch admitted with AdmitBatch().
+  void ReleaseBatch(size_t admitted_bytes);
+
+  const std::shared_ptr<MemTracker>& mem_tracker() const {
+    return mem_tracker_;
+  }
+
+  // The thread pool on which scanners' iterators scan in parallel. Outlives
+  // all of the registered scanners.
+  ThreadPool* scan_pool() const {
+    return scan_pool_.get();
+  }
+
  private:
+  FRIEND_TEST(ScannerTest, TestAdmitBatch);
   FRIEND_TEST(ScannerTest, TestExpire);
 
   enum {
@@ -133,6 +164,13 @@ class ScannerManager {
   // (Optional) scanner metrics for this instance.
   gscoped_ptr<ScannerMetrics> metrics_;
 
+  // Tracks the memory buffering the batches of results being built.
+  std::shared_ptr<MemTracker> mem_tracker_;
+
+  // Shared by the scanners' iterators. The scanners are deleted by the
+  // destructor, before the pool is.
+  gscoped_ptr<ThreadPool> scan_pool_;
+
   // If true, removal thread should shut itself down. Protected
   // by 'shutdown_lock_' and 'shutdown_cv_'.
   bool shutdown_;
@@ -215,6 +253,10 @@ class Scanner {
   // period.
   void UpdateAccessTime();
 
+  // Charges the CPU time and the bytes read on cfile cache misses by a call
+  // of this scanner.
+  void AddResourceUsage(int64_t cpu_time_us, int64_t cfile_cache_miss_bytes);
+
   // Return the auto-release pool which will be freed when this scanner
   // closes. This can be used as a storage area for the ScanSpec and any
   // associated data (eg storage for its predicates).
@@ -293,6 +335,22 @@ class Scanner {
     return row_format_flags_;
   }
 
+  // The aggregates requested by the client, if this is an aggregating scan.
+  void set_aggregates(const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates) {
+    aggregates_ = aggregates;
+  }
+  const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates() const {
+    return aggregates_;
+  }
+
+  // The number of rows the scan may still return, or -1 if it has no limit.
+  int64_t rows_left() const {
+    return rows_left_;
+  }
+  void set_rows_left(int64_t rows_left) {
+    rows_left_ = rows_left;
+  }
+
   ScanDescriptor descriptor() const;
 
  private:
@@ -316,7 +374,12 @@ class Scanner {
   // The current call sequence ID.
   uint32_t call_seq_id_;
 
-  // Protects last_access_time_ call_seq_id_, iter_, and spec_.
+  // The resources consumed by the scanner so far.
+  int64_t cpu_time_us_;
+  int64_t cfile_cache_miss_bytes_;
+
+  // Protects last_access_time_ call_seq_id_, cpu_time_us_,
+  // cfile_cache_miss_bytes_, iter_, and spec_.
   mutable simple_spinlock lock_;
 
   // The time the scanner was started.
@@ -349,6 +412,12 @@ class Scanner {
   // The row format flags the client passed, if any.
   const uint64_t row_format_flags_;
 
+  // The aggregates the client requested, if any.
+  google::protobuf::RepeatedPtrField<AggregatePB> aggregates_;
+
+  // The number of rows the scan may still return, or -1 if unlimited.
+  int64_t rows_left_;
+
   DISALLOW_COPY_AND_ASSIGN(Scanner);
 };
 
@@ -389,6 +458,10 @@ struct ScanDescriptor {
   MonoTime start_time;
   MonoTime last_access_time;
   uint32_t last_call_seq_id;
+
+  // The CPU time spent by the scan, and the bytes it read on cfile cache misses.
+  int64_t cpu_time_us;
+  int64_t cfile_cache_miss_bytes;
 };
 
 } // namespace tserver
@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/tserver/tablet_copy-test-base.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -25,6 +26,7 @@
 #include <thread>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <glog/stl_logging.h>
@@ -52,8 +54,10 @@
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/tserver/tablet_copy_client.h"
+#include "kudu/tserver/tablet_server.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -70,6 +74,7 @@ using std::string;
 using std::thread;
 using std::vector;
 
+DECLARE_int32(tablet_copy_download_threads_per_session);
 DECLARE_string(block_manager);
 
 METRIC_DECLARE_counter(block_manager_total_disk_sync);
@@ -236,13 +241,13 @@ TEST_F(TabletCopyClientTest, TestVerifyData) {
   valid_chunk.set_total_data_length(kDataTotalLen);
 
   // Make sure we work on the happy case.
-  ASSERT_OK(client_->VerifyData(kGoodOffset, valid_chunk));
+  ASSERT_OK(client_->VerifyData(kGoodOffset, valid_chunk, valid_chunk.data()));
 
   // Test unexpected offset.
   DataChunkPB bad_offset = valid_chunk;
   bad_offset.set_offset(kBadOffset);
   Status s;
-  s = client_->VerifyData(kGoodOffset, bad_offset);
+  s = client_->VerifyData(kGoodOffset, bad_offset, bad_offset.data());
   ASSERT_TRUE(s.IsInvalidArgument()) << "Bad offset expected: " << s.ToString();
   ASSERT_STR_CONTAINS(s.ToString(), "Offset did not match");
   LOG(INFO) << "Expected error returned: " << s.ToString();
@@ -250,13 +255,17 @@ TEST_F(TabletCopyClientTest, TestVerifyData) {
   // Test bad checksum.
   DataChunkPB bad_checksum = valid_chunk;
   bad_checksum.set_data(bad);
-  s = client_->VerifyData(kGoodOffset, bad_checksum);
+  s = client_->VerifyData(kGoodOffset, bad_checksum, bad_checksum.data());
   ASSERT_TRUE(s.IsCorruption()) << "Invalid checksum expected: " << s.ToString();
   ASSERT_STR_CONTAINS(s.ToString(), "CRC32 does not match");
   LOG(INFO) << "Expected error returned: " << s.ToString();
 }
 
 TEST_F(TabletCopyClientTest, TestDownloadAllBlocks) {
+  // The disk synchronization counts below assume the blocks are downloaded
+  // one at a time: concurrent downloads may spread them over more containers.
+  FLAGS_tablet_copy_download_threads_per_session = 1;
+
   // Download and commit all the blocks.
   ASSERT_OK(client_->DownloadBlocks());
   ASSERT_OK(client_->transaction_->CommitCreatedBlocks());
@@ -287,6 +296,70 @@ TEST_F(TabletCopyClientTest, TestDownloadAllBlocks) {
   }
 }
 
+// Test that blocks downloaded concurrently end up in the right places of the
+// new superblock.
+TEST_F(TabletCopyClientTest, TestDownloadBlocksConcurrently) {
+  FLAGS_tablet_copy_download_threads_per_session = 8;
+  ASSERT_OK(client_->DownloadBlocks());
+  ASSERT_OK(client_->transaction_->CommitCreatedBlocks());
+  ASSERT_EQ(0, client_->superblock_->orphaned_blocks_size());
+
+  vector<BlockId> old_data_blocks = ListBlocks(*client_->remote_superblock_);
+  vector<BlockId> new_data_blocks = ListBlocks(*client_->superblock_);
+  ASSERT_EQ(old_data_blocks.size(), new_data_blocks.size());
+  for (size_t i = 0; i < old_data_blocks.size(); i++) {
+    faststring old_scratch;
+    faststring new_scratch;
+    Slice old_slice;
+    Slice new_slice;
+    ASSERT_OK(ReadLocalBlockFile(mini_server_->server()->fs_manager(), old_data_blocks[i],
+                                 &old_scratch, &old_slice));
+    ASSERT_OK(ReadLocalBlockFile(fs_manager_.get(), new_data_blocks[i],
+                                 &new_scratch, &new_slice));
+    ASSERT_TRUE(old_slice == new_slice) << old_data_blocks[i].ToString();
+  }
+}
+
+// Test that a copy replacing a replica whose blocks were retained reuses the
+// blocks identical to those of the source rather than downloading them.
+TEST_F(TabletCopyClientTest, TestReuseLocalBlocks) {
+  ASSERT_OK(client_->FetchAll(nullptr));
+  ASSERT_OK(client_->Finish());
+  vector<BlockId> local_blocks = ListBlocks(*client_->superblock_);
+  ASSERT_FALSE(local_blocks.empty());
+
+  // Tombstone the replica, retaining its blocks as orphans.
+  meta_->set_retain_orphaned_blocks(true);
+  ASSERT_OK(meta_->DeleteTabletData(tablet::TABLET_DATA_TOMBSTONED, boost::none));
+  ASSERT_EQ(local_blocks.size(), meta_->orphaned_blocks().size());
+
+  // Copy the tablet again over the tombstoned replica.
+  client_.reset(new TabletCopyClient(GetTabletId(),
+                                     fs_manager_.get(),
+                                     new ConsensusMetadataManager(fs_manager_.get()),
+                                     messenger_,
+                                     nullptr /* no metrics */));
+  ASSERT_OK(client_->SetTabletToReplace(meta_, std::numeric_limits<int64_t>::max()));
+  HostPort host_port;
+  ASSERT_OK(HostPortFromPB(leader_.last_known_addr(), &host_port));
+  ASSERT_OK(client_->Start(host_port, &meta_));
+  ASSERT_OK(client_->DownloadBlocks());
+
+  // All the blocks were reused, so none is left orphaned.
+  vector<BlockId> new_blocks = ListBlocks(*client_->superblock_);
+  std::sort(local_blocks.begin(), local_blocks.end());
+  std::sort(new_blocks.begin(), new_blocks.end());
+  ASSERT_EQ(local_blocks, new_blocks);
+  ASSERT_EQ(0, client_->superblock_->orphaned_blocks_size());
+
+  ASSERT_OK(client_->Finish());
+  ASSERT_FALSE(meta_->retain_orphaned_blocks());
+  for (const BlockId& block_id : new_blocks) {
+    unique_ptr<fs::ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  }
+}
+
 // Test that failing a disk outside fo the tablet copy client will eventually
 // stop the copy client and cause it to fail.
 TEST_F(TabletCopyClientTest, TestFailedDiskStopsClient) {
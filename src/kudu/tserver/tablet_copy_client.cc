@@ -17,8 +17,11 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <utility>
 
@@ -40,6 +43,8 @@
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
@@ -50,11 +55,13 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/tserver/tablet_copy.proxy.h"
+#include "kudu/tserver/tablet_copy_throttler.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/fault_injection.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
@@ -64,6 +71,8 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 3000,
              "Tablet server RPC client timeout for BeginTabletCopySession calls. "
@@ -95,6 +104,17 @@ DEFINE_double(tablet_copy_fault_crash_before_write_cmeta, 0.0,
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, unsafe);
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, runtime);
 
+DEFINE_int32(tablet_copy_download_threads_per_session, 4,
+             "Number of blocks a tablet copy session downloads concurrently.");
+TAG_FLAG(tablet_copy_download_threads_per_session, advanced);
+TAG_FLAG(tablet_copy_download_threads_per_session, experimental);
+
+DEFINE_int64(tablet_copy_dest_bytes_per_sec, 0,
+             "Maximum rate at which this server downloads data for the tablet "
+             "copies it is the destination of, all together. 0 means no limit.");
+TAG_FLAG(tablet_copy_dest_bytes_per_sec, advanced);
+TAG_FLAG(tablet_copy_dest_bytes_per_sec, runtime);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 METRIC_DEFINE_counter(server, tablet_copy_bytes_fetched,
@@ -121,6 +141,7 @@ using consensus::OpId;
 using env_util::CopyFile;
 using fs::BlockManager;
 using fs::CreateBlockOptions;
+using fs::ReadableBlock;
 using fs::WritableBlock;
 using rpc::Messenger;
 using std::shared_ptr;
@@ -137,6 +158,17 @@ using tablet::TabletMetadata;
 using tablet::TabletReplica;
 using tablet::TabletSuperBlockPB;
 
+namespace {
+
+// Returns the budget shared by all the tablet copies downloading to this
+// process.
+TabletCopyThrottler* DownloadThrottler() {
+  static TabletCopyThrottler* throttler = new TabletCopyThrottler();
+  return throttler;
+}
+
+} // anonymous namespace
+
 TabletCopyClientMetrics::TabletCopyClientMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : bytes_fetched(METRIC_tablet_copy_bytes_fetched.Instantiate(metric_entity)),
       open_client_sessions(METRIC_tablet_copy_open_client_sessions.Instantiate(metric_entity, 0)) {
@@ -325,8 +357,21 @@ Status TabletCopyClient::Start(const HostPort& copy_source_addr,
                                           tablet::TABLET_DATA_COPYING,
                                           /*last_logged_opid=*/ boost::none),
         "Could not replace superblock with COPYING data state");
-    RETURN_NOT_OK_PREPEND(fs_manager_->dd_manager()->CreateDataDirGroup(tablet_id_),
-        "Could not create a new directory group for tablet copy");
+
+    // If the blocks of the replaced replica were retained, they're candidates
+    // for reuse, and their directory group is kept for the copy. They stay
+    // orphaned until they're reused, so they're deleted if the copy is aborted.
+    if (meta_->retain_orphaned_blocks()) {
+      local_block_ids_ = meta_->orphaned_blocks();
+      for (const BlockId& block_id : local_block_ids_) {
+        block_id.CopyToPB(superblock_->add_orphaned_blocks());
+      }
+    }
+    DataDirGroupPB group;
+    if (!fs_manager_->dd_manager()->GetDataDirGroupPB(tablet_id_, &group).ok()) {
+      RETURN_NOT_OK_PREPEND(fs_manager_->dd_manager()->CreateDataDirGroup(tablet_id_),
+          "Could not create a new directory group for tablet copy");
+    }
   } else {
     // HACK: Set the initial tombstoned last-logged OpId to 1.0 when copying a
     // replica for the first time, so that if the tablet copy fails, the
@@ -371,7 +416,7 @@ Status TabletCopyClient::FetchAll(const scoped_refptr<TabletReplica>& tablet_rep
 
   tablet_replica_ = tablet_replica;
 
-  // Download all the files (serially, for now, but in parallel in the future).
+  // Download all the files: the blocks concurrently, then the WAL segments.
   RETURN_NOT_OK(DownloadBlocks());
   RETURN_NOT_OK(DownloadWALs());
 
@@ -398,6 +443,7 @@ Status TabletCopyClient::Finish() {
   SetStatusMessage("Replacing tablet superblock");
   superblock_->set_tablet_data_state(tablet::TABLET_DATA_READY);
   superblock_->clear_tombstone_last_logged_opid();
+  meta_->set_retain_orphaned_blocks(false);
   RETURN_NOT_OK(meta_->ReplaceSuperBlock(*superblock_));
 
   if (FLAGS_tablet_copy_save_downloaded_metadata) {
@@ -419,8 +465,10 @@ Status TabletCopyClient::Abort() {
   CHECK(meta_);
 
   // Write the in-progress superblock to disk so that when we delete the tablet
-  // data all the partial blocks we have persisted will be deleted.
+  // data all the partial blocks we have persisted will be deleted, along with
+  // the blocks of the replaced replica.
   DCHECK_EQ(tablet::TABLET_DATA_COPYING, superblock_->tablet_data_state());
+  meta_->set_retain_orphaned_blocks(false);
   RETURN_NOT_OK(meta_->ReplaceSuperBlock(*superblock_));
 
   // Delete all of the tablet data, including blocks and WALs.
@@ -513,6 +561,7 @@ int TabletCopyClient::CountRemoteBlocks() const {
     if (rowset.has_adhoc_index_block()) {
       num_blocks++;
     }
+    num_blocks += rowset.secondary_indexes_size();
   }
   return num_blocks;
 }
@@ -522,63 +571,114 @@ Status TabletCopyClient::DownloadBlocks() {
 
   // Count up the total number of blocks to download.
   int num_remote_blocks = CountRemoteBlocks();
+  const vector<BlockIdPB> src_block_ids =
+      TabletMetadata::CollectBlockIdPBs(*remote_superblock_);
+  DCHECK_EQ(num_remote_blocks, static_cast<int>(src_block_ids.size()));
+
+  // Download the blocks concurrently. The new superblock can only reference a
+  // rowset's blocks once all of them are downloaded, so until then each
+  // downloaded block is listed as orphaned in the superblock: that way, it's
+  // deleted if the copy is aborted.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy-download")
+                .set_max_threads(FLAGS_tablet_copy_download_threads_per_session)
+                .Build(&pool));
+
+  // Checksum the blocks of the replaced replica, if any, to match them with
+  // the remote blocks. A block which can't be read is just not reused.
+  for (const BlockId& block_id : local_block_ids_) {
+    RETURN_NOT_OK(pool->SubmitFunc([this, block_id]() {
+      uint64_t size;
+      uint32_t crc32;
+      Status s = ChecksumLocalBlock(block_id, &size, &crc32);
+      if (PREDICT_FALSE(!s.ok())) {
+        LOG_WITH_PREFIX(WARNING) << "Unable to checksum local block " << block_id.ToString()
+                                 << ", not reusing it: " << s.ToString();
+        return;
+      }
+      std::lock_guard<simple_spinlock> l(download_lock_);
+      reusable_blocks_.emplace(std::make_pair(size, crc32), block_id);
+    }));
+  }
+  pool->Wait();
 
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
-  int block_count = 0;
+  vector<BlockIdPB> new_block_ids(src_block_ids.size());
+  Status download_status;
+  int num_reused_blocks = 0;
   LOG_WITH_PREFIX(INFO) << "Starting download of " << num_remote_blocks << " data blocks...";
+  for (size_t i = 0; i < src_block_ids.size(); i++) {
+    Status submit_status = pool->SubmitFunc([&, i]() {
+      {
+        std::lock_guard<simple_spinlock> l(download_lock_);
+        if (!download_status.ok()) {
+          return;
+        }
+      }
+      bool reused = false;
+      Status s = DownloadAndRewriteBlock(src_block_ids[i], i + 1, num_remote_blocks,
+                                         &new_block_ids[i], &reused);
+      std::lock_guard<simple_spinlock> l(download_lock_);
+      if (s.ok()) {
+        // A reused block is already listed as orphaned.
+        if (reused) {
+          num_reused_blocks++;
+        } else {
+          *superblock_->add_orphaned_blocks() = new_block_ids[i];
+        }
+      } else if (download_status.ok()) {
+        download_status = s;
+      }
+    });
+    if (PREDICT_FALSE(!submit_status.ok())) {
+      std::lock_guard<simple_spinlock> l(download_lock_);
+      download_status = submit_status;
+      break;
+    }
+  }
+  pool->Wait();
+  RETURN_NOT_OK(download_status);
+  if (!local_block_ids_.empty()) {
+    LOG_WITH_PREFIX(INFO) << "Reused " << num_reused_blocks << " of " << local_block_ids_.size()
+                          << " blocks of the replaced replica";
+  }
+
+  // Write the rowsets with the new block IDs into the new superblock, in the
+  // order the blocks were collected in.
+  size_t block_idx = 0;
   for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
-    // Create rowset.
     RowSetDataPB* dst_rowset = superblock_->add_rowsets();
     *dst_rowset = src_rowset;
-    // Clear the data in the rowset so that we don't end up deleting the wrong
-    // blocks (using the ids of the remote blocks) if we fail.
-    // TODO(mpercy): This is pretty fragile. Consider building a class
-    // structure on top of SuperBlockPB to abstract copying details.
-    dst_rowset->clear_columns();
-    dst_rowset->clear_redo_deltas();
-    dst_rowset->clear_undo_deltas();
-    dst_rowset->clear_bloom_block();
-    dst_rowset->clear_adhoc_index_block();
-
-    // We can't leave superblock_ unserializable with unset required field
-    // values in child elements, so we must download and rewrite each block
-    // before referencing it in the rowset.
-    for (const ColumnDataPB& src_col : src_rowset.columns()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_col.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      ColumnDataPB* dst_col = dst_rowset->add_columns();
-      *dst_col = src_col;
-      *dst_col->mutable_block() = new_block_id;
+    for (ColumnDataPB& dst_col : *dst_rowset->mutable_columns()) {
+      *dst_col.mutable_block() = new_block_ids[block_idx++];
     }
-    for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_redo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      DeltaDataPB* dst_redo = dst_rowset->add_redo_deltas();
-      *dst_redo = src_redo;
-      *dst_redo->mutable_block() = new_block_id;
+    for (DeltaDataPB& dst_redo : *dst_rowset->mutable_redo_deltas()) {
+      *dst_redo.mutable_block() = new_block_ids[block_idx++];
     }
-    for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_undo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      DeltaDataPB* dst_undo = dst_rowset->add_undo_deltas();
-      *dst_undo = src_undo;
-      *dst_undo->mutable_block() = new_block_id;
+    for (DeltaDataPB& dst_undo : *dst_rowset->mutable_undo_deltas()) {
+      *dst_undo.mutable_block() = new_block_ids[block_idx++];
     }
-    if (src_rowset.has_bloom_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.bloom_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_bloom_block() = new_block_id;
+    if (dst_rowset->has_bloom_block()) {
+      *dst_rowset->mutable_bloom_block() = new_block_ids[block_idx++];
     }
-    if (src_rowset.has_adhoc_index_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.adhoc_index_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_adhoc_index_block() = new_block_id;
+    if (dst_rowset->has_adhoc_index_block()) {
+      *dst_rowset->mutable_adhoc_index_block() = new_block_ids[block_idx++];
+    }
+    for (ColumnDataPB& dst_index : *dst_rowset->mutable_secondary_indexes()) {
+      *dst_index.mutable_block() = new_block_ids[block_idx++];
+    }
+  }
+  DCHECK_EQ(new_block_ids.size(), block_idx);
+
+  // Only the blocks of the replaced replica which weren't reused remain
+  // orphaned: they're deleted once the new superblock replaces the old one.
+  BlockIdSet new_block_id_set;
+  for (const BlockIdPB& block_id : new_block_ids) {
+    new_block_id_set.insert(BlockId::FromPB(block_id));
+  }
+  superblock_->clear_orphaned_blocks();
+  for (const BlockId& block_id : local_block_ids_) {
+    if (!ContainsKey(new_block_id_set, block_id)) {
+      block_id.CopyToPB(superblock_->add_orphaned_blocks());
     }
   }
 
@@ -632,19 +732,90 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 }
 
 Status TabletCopyClient::DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
+                                                 int block_num,
                                                  int num_blocks,
-                                                 int* block_count,
-                                                 BlockIdPB* dest_block_id) {
+                                                 BlockIdPB* dest_block_id,
+                                                 bool* reused) {
   BlockId old_block_id(BlockId::FromPB(src_block_id));
   SetStatusMessage(Substitute("Downloading block $0 ($1/$2)",
                               old_block_id.ToString(),
-                              *block_count + 1, num_blocks));
+                              block_num, num_blocks));
   BlockId new_block_id;
-  RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
-      "Unable to download block with id " + old_block_id.ToString());
+  RETURN_NOT_OK_PREPEND(FindReusableBlock(old_block_id, reused, &new_block_id),
+      "Unable to look for a local copy of block with id " + old_block_id.ToString());
+  if (!*reused) {
+    RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
+        "Unable to download block with id " + old_block_id.ToString());
+  }
 
   new_block_id.CopyToPB(dest_block_id);
-  (*block_count)++;
+  return Status::OK();
+}
+
+Status TabletCopyClient::ChecksumLocalBlock(const BlockId& block_id,
+                                            uint64_t* size,
+                                            uint32_t* crc32) {
+  unique_ptr<ReadableBlock> block;
+  RETURN_NOT_OK(fs_manager_->OpenBlock(block_id, &block));
+  uint64_t block_size;
+  RETURN_NOT_OK(block->Size(&block_size));
+
+  uint32_t crc = 0;
+  faststring buf;
+  buf.resize(std::min<uint64_t>(block_size, FLAGS_tablet_copy_transfer_chunk_size_bytes));
+  for (uint64_t offset = 0; offset < block_size; offset += buf.size()) {
+    buf.resize(std::min<uint64_t>(block_size - offset, buf.size()));
+    RETURN_NOT_OK(block->Read(offset, Slice(buf.data(), buf.size())));
+    crc = crc::Crc32c(buf.data(), buf.size(), crc);
+  }
+  *size = block_size;
+  *crc32 = crc;
+  return Status::OK();
+}
+
+Status TabletCopyClient::FindReusableBlock(const BlockId& src_block_id,
+                                           bool* found,
+                                           BlockId* local_block_id) {
+  *found = false;
+  {
+    std::lock_guard<simple_spinlock> l(download_lock_);
+    if (reusable_blocks_.empty()) {
+      return Status::OK();
+    }
+  }
+
+  // Ask the source for the block's size and checksum only.
+  rpc::RpcController controller;
+  FetchDataRequestPB req;
+  req.set_session_id(session_id_);
+  req.mutable_data_id()->set_type(DataIdPB::BLOCK);
+  src_block_id.CopyToPB(req.mutable_data_id()->mutable_block_id());
+  req.set_checksum_only(true);
+  FetchDataResponsePB resp;
+  RETURN_NOT_OK_PREPEND(SendRpcWithRetry(&controller, [&] {
+        return proxy_->FetchData(req, &resp, &controller);
+  }), "unable to fetch block checksum from remote");
+
+  std::lock_guard<simple_spinlock> l(download_lock_);
+  // A source which doesn't support checksum-only requests sends data instead.
+  if (resp.chunk().has_data() || resp.chunk().has_sidecar_idx()) {
+    if (!reusable_blocks_.empty()) {
+      LOG_WITH_PREFIX(INFO) << "Tablet copy source doesn't support block checksums, "
+                            << "not reusing any local blocks";
+      reusable_blocks_.clear();
+    }
+    return Status::OK();
+  }
+  auto it = reusable_blocks_.find(std::make_pair(
+      static_cast<uint64_t>(resp.chunk().total_data_length()), resp.chunk().crc32()));
+  if (it == reusable_blocks_.end()) {
+    return Status::OK();
+  }
+  VLOG_WITH_PREFIX(1) << "Reusing local block " << it->second.ToString()
+                      << " for block " << src_block_id.ToString();
+  *local_block_id = it->second;
+  reusable_blocks_.erase(it);
+  *found = true;
   return Status::OK();
 }
 
@@ -666,6 +837,7 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
 
   *new_block_id = block->id();
   RETURN_NOT_OK_PREPEND(block->Finalize(), "Unable to finalize block");
+  std::lock_guard<simple_spinlock> l(download_lock_);
   transaction_->AddCreatedBlock(std::move(block));
   return Status::OK();
 }
@@ -680,6 +852,7 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
   req.set_session_id(session_id_);
   req.mutable_data_id()->CopyFrom(data_id);
   req.set_max_length(FLAGS_tablet_copy_transfer_chunk_size_bytes);
+  req.set_data_in_sidecar(true);
 
   bool done = false;
   while (!done) {
@@ -691,13 +864,25 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
           return proxy_->FetchData(req, &resp, &controller);
     }), "unable to fetch data from remote");
 
+    // The data is appended straight from the sidecar, unless the server is
+    // too old to send it in one.
+    Slice data;
+    if (resp.chunk().has_sidecar_idx()) {
+      RETURN_NOT_OK_PREPEND(controller.GetInboundSidecar(resp.chunk().sidecar_idx(), &data),
+                            "unable to get data sidecar");
+    } else {
+      data = resp.chunk().data();
+    }
+
     // Sanity-check for corruption.
-    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk()),
+    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk(), data),
                           Substitute("Error validating data item $0",
                                      pb_util::SecureShortDebugString(data_id)));
 
     // Write the data.
-    RETURN_NOT_OK(appendable->Append(resp.chunk().data()));
+    RETURN_NOT_OK(appendable->Append(data));
+
+    DownloadThrottler()->Throttle(data.size(), FLAGS_tablet_copy_dest_bytes_per_sec);
 
     if (PREDICT_FALSE(FLAGS_tablet_copy_download_file_inject_latency_ms > 0)) {
       LOG_WITH_PREFIX(INFO) << "Injecting latency into file download: " <<
@@ -705,7 +890,7 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_copy_download_file_inject_latency_ms));
     }
 
-    auto chunk_size = resp.chunk().data().size();
+    auto chunk_size = data.size();
     done = offset + chunk_size == resp.chunk().total_data_length();
     offset += chunk_size;
     if (tablet_copy_metrics_) {
@@ -716,7 +901,8 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
   return Status::OK();
 }
 
-Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
+Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk,
+                                    const Slice& data) {
   // Verify the offset is what we expected.
   if (offset != chunk.offset()) {
     return Status::InvalidArgument("Offset did not match what was asked for",
@@ -724,17 +910,17 @@ Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
   }
 
   // Verify that the chunk does not overflow the total data length.
-  if (offset + chunk.data().length() > chunk.total_data_length()) {
+  if (offset + data.size() > chunk.total_data_length()) {
     return Status::InvalidArgument("Chunk exceeds total block data length",
-        Substitute("$0 vs $1", offset + chunk.data().length(), chunk.total_data_length()));
+        Substitute("$0 vs $1", offset + data.size(), chunk.total_data_length()));
   }
 
   // Verify the checksum.
-  uint32_t crc32 = crc::Crc32c(chunk.data().data(), chunk.data().length());
+  uint32_t crc32 = crc::Crc32c(data.data(), data.size());
   if (PREDICT_FALSE(crc32 != chunk.crc32())) {
     return Status::Corruption(
         Substitute("CRC32 does not match at offset $0 size $1: $2 vs $3",
-          offset, chunk.data().size(), crc32, chunk.crc32()));
+          offset, data.size(), crc32, chunk.crc32()));
   }
   return Status::OK();
 }
@@ -18,24 +18,28 @@
 #define KUDU_TSERVER_TABLET_COPY_CLIENT_H
 
 #include <cstdint>
+#include <map>
 #include <string>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
 
+#include "kudu/fs/block_id.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
-class BlockId;
 class BlockIdPB;
 class FsManager;
 class HostPort;
+class Slice;
 
 namespace consensus {
 class ConsensusMetadata;
@@ -59,8 +63,8 @@ class TabletSuperBlockPB;
 } // namespace tablet
 
 namespace tserver {
-class DataIdPB;
 class DataChunkPB;
+class DataIdPB;
 class TabletCopyServiceProxy;
 
 // Server-wide tablet copy metrics.
@@ -92,7 +96,9 @@ class TabletCopyClient {
   ~TabletCopyClient();
 
   // Pass in the existing metadata for a tombstoned tablet, which will be
-  // replaced if validation checks pass in Start().
+  // replaced if validation checks pass in Start(). If the metadata retains
+  // the orphaned blocks of the replica, those identical to blocks of the
+  // source are reused rather than downloaded.
   // 'meta' is the metadata for the tombstoned tablet and 'caller_term' is the
   // term provided by the caller (assumed to be the current leader of the
   // consensus config) for validation purposes.
@@ -135,6 +141,7 @@ class TabletCopyClient {
   FRIEND_TEST(TabletCopyClientTest, TestVerifyData);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadWalSegment);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadAllBlocks);
+  FRIEND_TEST(TabletCopyClientTest, TestReuseLocalBlocks);
   FRIEND_TEST(TabletCopyClientAbortTest, TestAbort);
 
   enum State {
@@ -171,25 +178,36 @@ class TabletCopyClient {
   // Count the number of blocks on the remote (from 'remote_superblock_').
   int CountRemoteBlocks() const;
 
-  // Download all blocks belonging to a tablet sequentially. Add all
+  // Download all blocks belonging to a tablet, up to
+  // --tablet_copy_download_threads_per_session of them concurrently. Add all
   // downloaded blocks to the tablet copy's transaction.
   //
   // Blocks are given new IDs upon creation. On success, 'superblock_'
   // is populated to reflect the new block IDs.
   Status DownloadBlocks();
 
-  // Download the remote block specified by 'src_block_id'. 'num_blocks' should
-  // be given as the total number of blocks there are to download (for logging
-  // purposes). Add the block to the tablet copy's transaction, to close blocks
-  // belonging to the transaction together when the copying is complete.
+  // Compute the size and CRC32C of the local block 'block_id'.
+  Status ChecksumLocalBlock(const BlockId& block_id, uint64_t* size, uint32_t* crc32);
+
+  // Look for a block of the replaced replica identical to the remote block
+  // 'src_block_id', as per their sizes and checksums. If there is one, it's
+  // taken out of 'reusable_blocks_' and its ID is set in 'local_block_id'.
+  Status FindReusableBlock(const BlockId& src_block_id, bool* found, BlockId* local_block_id);
+
+  // Download the remote block specified by 'src_block_id'. 'block_num' and
+  // 'num_blocks' should be given as the number of the block and the total
+  // number of blocks there are to download (for logging purposes). Add the
+  // block to the tablet copy's transaction, to close blocks belonging to the
+  // transaction together when the copying is complete.
   //
-  // On success:
-  // - 'dest_block_id' is set to the new ID of the downloaded block.
-  // - 'block_count' is incremented by 1.
+  // On success, 'dest_block_id' is set to the new ID of the downloaded block,
+  // or that of an identical block of the replaced replica, in which case
+  // 'reused' is set to true.
   Status DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
+                                 int block_num,
                                  int num_blocks,
-                                 int* block_count,
-                                 BlockIdPB* dest_block_id);
+                                 BlockIdPB* dest_block_id,
+                                 bool* reused);
 
   // Download a single block.
   // Data block is opened with new ID. After downloading, the block is finalized
@@ -209,7 +227,9 @@ class TabletCopyClient {
   template<class Appendable>
   Status DownloadFile(const DataIdPB& data_id, Appendable* appendable);
 
-  Status VerifyData(uint64_t offset, const DataChunkPB& resp);
+  // Verifies 'data', received in 'chunk' or in a sidecar of its response,
+  // against the offset, length and checksum in 'chunk'.
+  Status VerifyData(uint64_t offset, const DataChunkPB& chunk, const Slice& data);
 
   // Runs the provided functor, which must send an RPC and return the result
   // status, until it succeeds, times out, or fails with a non-retriable error.
@@ -249,10 +269,20 @@ class TabletCopyClient {
   std::vector<uint64_t> wal_seqnos_;
   int64_t start_time_micros_;
 
-  Random rng_;
+  ThreadSafeRandom rng_;
 
   TabletCopyClientMetrics* tablet_copy_metrics_;
 
+  // Protects 'transaction_', 'superblock_' and 'reusable_blocks_' while
+  // blocks are being downloaded concurrently.
+  simple_spinlock download_lock_;
+
+  // The blocks of the replaced replica which may be reused.
+  std::vector<BlockId> local_block_ids_;
+
+  // Those of 'local_block_ids_' not reused yet, by size and checksum.
+  std::multimap<std::pair<uint64_t, uint32_t>, BlockId> reusable_blocks_;
+
   // Block transaction for the tablet copy.
   std::unique_ptr<fs::BlockCreationTransaction> transaction_;
 
@@ -17,6 +17,7 @@
 #include "kudu/tserver/tablet_copy_service.h"
 
 #include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -35,17 +36,20 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/server_base.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/fault_injection.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/slice.h"
 
 #define RPC_RETURN_NOT_OK(expr, app_err, message, context) \
   do { \
@@ -79,7 +83,14 @@ DEFINE_double(tablet_copy_early_session_timeout_prob, 0,
 TAG_FLAG(tablet_copy_early_session_timeout_prob, runtime);
 TAG_FLAG(tablet_copy_early_session_timeout_prob, unsafe);
 
+DEFINE_int64(tablet_copy_source_bytes_per_sec, 0,
+             "Maximum rate at which this server sends data to the tablet copies "
+             "it is the source of, all together. 0 means no limit.");
+TAG_FLAG(tablet_copy_source_bytes_per_sec, advanced);
+TAG_FLAG(tablet_copy_source_bytes_per_sec, runtime);
+
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -94,6 +105,7 @@ namespace kudu {
 using crc::Crc32c;
 using server::ServerBase;
 using pb_util::SecureShortDebugString;
+using rpc::RpcSidecar;
 using tablet::TabletReplica;
 
 namespace tserver {
@@ -102,6 +114,21 @@ static MonoTime GetNewExpireTime() {
   return MonoTime::Now() + MonoDelta::FromSeconds(FLAGS_tablet_copy_idle_timeout_sec);
 }
 
+// Reads the requested piece of a block or log segment into 'data'.
+template<class Buffer>
+static Status GetDataPiece(TabletCopySourceSession* session,
+                           const DataIdPB& data_id,
+                           uint64_t offset, int64_t client_maxlen,
+                           Buffer* data, int64_t* total_data_length,
+                           TabletCopyErrorPB::Code* error_code) {
+  if (data_id.type() == DataIdPB::BLOCK) {
+    return session->GetBlockPiece(BlockId::FromPB(data_id.block_id()), offset, client_maxlen,
+                                  data, total_data_length, error_code);
+  }
+  return session->GetLogSegmentPiece(data_id.wal_segment_seqno(), offset, client_maxlen,
+                                     data, total_data_length, error_code);
+}
+
 TabletCopyServiceImpl::TabletCopyServiceImpl(
     ServerBase* server,
     TabletReplicaLookupIf* tablet_replica_lookup)
@@ -284,32 +311,72 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   RPC_RETURN_NOT_OK(ValidateFetchRequestDataId(data_id, &error_code, session),
                     error_code, "Invalid DataId", context);
 
+  // A checksum of the whole block is enough for a client which may already
+  // hold an identical block.
+  if (req->checksum_only()) {
+    if (PREDICT_FALSE(data_id.type() != DataIdPB::BLOCK)) {
+      RPC_RETURN_NOT_OK(Status::InvalidArgument("only block checksums may be requested",
+                                                SecureShortDebugString(data_id)),
+                        TabletCopyErrorPB::INVALID_TABLET_COPY_REQUEST,
+                        "Invalid DataId", context);
+    }
+    uint32_t crc32 = 0;
+    int64_t total_data_length = 0;
+    RPC_RETURN_NOT_OK(session->GetBlockChecksum(BlockId::FromPB(data_id.block_id()),
+                                                &crc32, &total_data_length, &error_code),
+                      error_code, "Unable to checksum data block", context);
+    DataChunkPB* data_chunk = resp->mutable_chunk();
+    data_chunk->set_offset(0);
+    data_chunk->set_crc32(crc32);
+    data_chunk->set_total_data_length(total_data_length);
+    context->RespondSuccess();
+    return;
+  }
+
+  // Read the data straight into the buffer it's sent from: an RPC sidecar,
+  // which spares serializing it into the response, if the client asked for
+  // one, or the response itself otherwise.
   DataChunkPB* data_chunk = resp->mutable_chunk();
-  string* data = data_chunk->mutable_data();
+  const char* error_msg = data_id.type() == DataIdPB::BLOCK ?
+      "Unable to get piece of data block" : "Unable to get piece of log segment";
   int64_t total_data_length = 0;
-  if (data_id.type() == DataIdPB::BLOCK) {
-    // Fetching a data block chunk.
-    const BlockId& block_id = BlockId::FromPB(data_id.block_id());
-    RPC_RETURN_NOT_OK(session->GetBlockPiece(block_id, offset, client_maxlen,
-                                             data, &total_data_length, &error_code),
-                      error_code, "Unable to get piece of data block", context);
+  unique_ptr<faststring> sidecar_data;
+  Slice data;
+  if (req->data_in_sidecar()) {
+    sidecar_data.reset(new faststring());
+    RPC_RETURN_NOT_OK(GetDataPiece(session.get(), data_id, offset, client_maxlen,
+                                   sidecar_data.get(), &total_data_length, &error_code),
+                      error_code, error_msg, context);
+    data = Slice(*sidecar_data);
   } else {
-    // Fetching a log segment chunk.
-    uint64_t segment_seqno = data_id.wal_segment_seqno();
-    RPC_RETURN_NOT_OK(session->GetLogSegmentPiece(segment_seqno, offset, client_maxlen,
-                                                  data, &total_data_length, &error_code),
-                      error_code, "Unable to get piece of log segment", context);
+    string* pb_data = data_chunk->mutable_data();
+    RPC_RETURN_NOT_OK(GetDataPiece(session.get(), data_id, offset, client_maxlen,
+                                   pb_data, &total_data_length, &error_code),
+                      error_code, error_msg, context);
+    data = Slice(*pb_data);
   }
 
   data_chunk->set_total_data_length(total_data_length);
   data_chunk->set_offset(offset);
 
-  tablet_copy_metrics_.bytes_sent->IncrementBy(resp->chunk().data().size());
+  // Pace the chunks served to all the sessions so that copies don't starve
+  // the production traffic of this server's disks and network.
+  throttler_.Throttle(data.size(), FLAGS_tablet_copy_source_bytes_per_sec);
+
+  tablet_copy_metrics_.bytes_sent->IncrementBy(data.size());
 
   // Calculate checksum.
-  uint32_t crc32 = Crc32c(data->data(), data->length());
+  uint32_t crc32 = Crc32c(data.data(), data.size());
   data_chunk->set_crc32(crc32);
 
+  if (sidecar_data) {
+    int sidecar_idx;
+    RPC_RETURN_NOT_OK(context->AddOutboundSidecar(
+                          RpcSidecar::FromFaststring(std::move(sidecar_data)), &sidecar_idx),
+                      TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to add sidecar", context);
+    data_chunk->set_sidecar_idx(sidecar_idx);
+  }
+
   context->RespondSuccess();
 }
 
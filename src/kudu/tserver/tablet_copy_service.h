@@ -25,6 +25,7 @@
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/tserver/tablet_copy.service.h"
 #include "kudu/tserver/tablet_copy_source_session.h"
+#include "kudu/tserver/tablet_copy_throttler.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
@@ -132,6 +133,9 @@ class TabletCopyServiceImpl : public TabletCopyServiceIf {
   scoped_refptr<Thread> session_expiration_thread_;
 
   TabletCopySourceMetrics tablet_copy_metrics_;
+
+  // The budget shared by all the data served to tablet copy sessions.
+  TabletCopyThrottler throttler_;
 };
 
 } // namespace tserver
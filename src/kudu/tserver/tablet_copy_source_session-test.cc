@@ -338,6 +338,34 @@ TEST_F(TabletCopyTest, TestBlocksEqual) {
 
 // Ensure that blocks are still readable through the open session even
 // after they've been deleted.
+// Pieces read into a faststring, as when they're sent in RPC sidecars, must
+// match those read into a string.
+TEST_F(TabletCopyTest, TestBlockPiecesIntoFaststring) {
+  TabletSuperBlockPB tablet_superblock;
+  ASSERT_OK(tablet()->metadata()->ToSuperBlock(&tablet_superblock));
+  for (const RowSetDataPB& rowset : tablet_superblock.rowsets()) {
+    for (const ColumnDataPB& column : rowset.columns()) {
+      BlockId block_id = BlockId::FromPB(column.block());
+      TabletCopyErrorPB::Code error_code;
+      string data;
+      int64_t total_size;
+      ASSERT_OK(session_->GetBlockPiece(block_id, 0, 0, &data, &total_size, &error_code));
+
+      // Read the block in two pieces to exercise nonzero offsets too.
+      const int64_t first_len = total_size / 2;
+      faststring first;
+      faststring second;
+      int64_t fs_total_size;
+      ASSERT_OK(session_->GetBlockPiece(block_id, 0, first_len, &first,
+                                        &fs_total_size, &error_code));
+      ASSERT_EQ(total_size, fs_total_size);
+      ASSERT_OK(session_->GetBlockPiece(block_id, first.size(), 0, &second,
+                                        &fs_total_size, &error_code));
+      ASSERT_EQ(data, first.ToString() + second.ToString());
+    }
+  }
+}
+
 TEST_F(TabletCopyTest, TestBlocksAreFetchableAfterBeingDeleted) {
   TabletSuperBlockPB tablet_superblock;
   ASSERT_OK(tablet()->metadata()->ToSuperBlock(&tablet_superblock));
@@ -44,6 +44,8 @@
 #include "kudu/rpc/transfer.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
@@ -256,11 +258,11 @@ static Status GetResponseDataSize(int64_t total_size,
 
 // Read a chunk of a file into a buffer.
 // data_name provides a string for the block/log to be used in error messages.
-template <class Info>
+template <class Info, class Buffer>
 static Status ReadFileChunkToBuf(const Info* info,
                                  uint64_t offset, int64_t client_maxlen,
                                  const string& data_name,
-                                 string* data, int64_t* file_size,
+                                 Buffer* data, int64_t* file_size,
                                  TabletCopyErrorPB::Code* error_code) {
   int64_t response_data_size = 0;
   RETURN_NOT_OK_PREPEND(GetResponseDataSize(info->size, offset, client_maxlen, error_code,
@@ -274,7 +276,7 @@ static Status ReadFileChunkToBuf(const Info* info,
   // however any modern compiler should be compatible with it.
   // Violates the API contract, but avoids excessive copies.
   data->resize(response_data_size);
-  uint8_t* buf = reinterpret_cast<uint8_t*>(const_cast<char*>(data->data()));
+  uint8_t* buf = reinterpret_cast<uint8_t*>(&(*data)[0]);
   Slice slice(buf, response_data_size);
   Status s = info->Read(offset, slice);
   if (PREDICT_FALSE(!s.ok())) {
@@ -297,9 +299,10 @@ static Status ReadFileChunkToBuf(const Info* info,
   return Status::OK();
 }
 
+template<class Buffer>
 Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
                                              uint64_t offset, int64_t client_maxlen,
-                                             string* data, int64_t* block_file_size,
+                                             Buffer* data, int64_t* block_file_size,
                                              TabletCopyErrorPB::Code* error_code) {
   DCHECK(init_once_.init_succeeded());
   RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
@@ -319,9 +322,32 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
   return Status::OK();
 }
 
+Status TabletCopySourceSession::GetBlockChecksum(const BlockId& block_id,
+                                                 uint32_t* crc32, int64_t* block_file_size,
+                                                 TabletCopyErrorPB::Code* error_code) {
+  DCHECK(init_once_.init_succeeded());
+  RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
+                        "Tablet copy source could not get block");
+  ImmutableReadableBlockInfo* block_info;
+  RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
+
+  const string data_name = Substitute("block $0", block_id.ToString());
+  uint32_t crc = 0;
+  faststring buf;
+  for (int64_t offset = 0; offset < block_info->size; offset += buf.size()) {
+    RETURN_NOT_OK(ReadFileChunkToBuf(block_info, offset, /*client_maxlen=*/ 0,
+                                     data_name, &buf, block_file_size, error_code));
+    crc = crc::Crc32c(buf.data(), buf.size(), crc);
+  }
+  *crc32 = crc;
+  *block_file_size = block_info->size;
+  return Status::OK();
+}
+
+template<class Buffer>
 Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
                                                    uint64_t offset, int64_t client_maxlen,
-                                                   std::string* data, int64_t* log_file_size,
+                                                   Buffer* data, int64_t* log_file_size,
                                                    TabletCopyErrorPB::Code* error_code) {
   DCHECK(init_once_.init_succeeded());
   RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
@@ -337,6 +363,28 @@ Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
   return Status::OK();
 }
 
+// Explicit instantiations for the buffers the tablet copy service reads into.
+template
+Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
+                                             uint64_t offset, int64_t client_maxlen,
+                                             string* data, int64_t* block_file_size,
+                                             TabletCopyErrorPB::Code* error_code);
+template
+Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
+                                             uint64_t offset, int64_t client_maxlen,
+                                             faststring* data, int64_t* block_file_size,
+                                             TabletCopyErrorPB::Code* error_code);
+template
+Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
+                                                   uint64_t offset, int64_t client_maxlen,
+                                                   string* data, int64_t* log_file_size,
+                                                   TabletCopyErrorPB::Code* error_code);
+template
+Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
+                                                   uint64_t offset, int64_t client_maxlen,
+                                                   faststring* data, int64_t* log_file_size,
+                                                   TabletCopyErrorPB::Code* error_code);
+
 bool TabletCopySourceSession::IsBlockOpenForTests(const BlockId& block_id) const {
   DCHECK(init_once_.init_succeeded());
   return ContainsKey(blocks_, block_id);
@@ -122,23 +122,34 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
 
   // Open block for reading, if it's not already open, and read some of it.
   // If maxlen is 0, we use a system-selected length for the data piece.
-  // *data is set to a std::string containing the data. Ownership of this object
-  // is passed to the caller. A string is used because the RPC interface is
-  // sending data serialized as protobuf and we want to minimize copying.
+  // *data is set to the data, read straight into it to minimize copying:
+  // 'Buffer' is either a std::string, to send the data serialized in a
+  // protobuf, or a faststring, to send it as an RPC sidecar.
   // On error, Status is set to a non-OK value and error_code is filled in.
   //
   // This method is thread-safe.
+  template<class Buffer>
   Status GetBlockPiece(const BlockId& block_id,
                        uint64_t offset, int64_t client_maxlen,
-                       std::string* data, int64_t* block_file_size,
+                       Buffer* data, int64_t* block_file_size,
                        TabletCopyErrorPB::Code* error_code);
 
+  // Compute the CRC32C of the whole block, reading it piece by piece, and
+  // set *block_file_size to its size. Used by clients that may already hold
+  // an identical block, to decide whether to download it.
+  //
+  // This method is thread-safe.
+  Status GetBlockChecksum(const BlockId& block_id,
+                          uint32_t* crc32, int64_t* block_file_size,
+                          TabletCopyErrorPB::Code* error_code);
+
   // Get a piece of a log segment.
   // The behavior and params are very similar to GetBlockPiece(), but this one
   // is only for sending WAL segment files.
+  template<class Buffer>
   Status GetLogSegmentPiece(uint64_t segment_seqno,
                             uint64_t offset, int64_t client_maxlen,
-                            std::string* data, int64_t* log_file_size,
+                            Buffer* data, int64_t* log_file_size,
                             TabletCopyErrorPB::Code* error_code);
 
   const tablet::TabletSuperBlockPB& tablet_superblock() const {
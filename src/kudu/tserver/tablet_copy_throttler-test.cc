@@ -0,0 +1,60 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/tablet_copy_throttler.h"
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+namespace kudu {
+namespace tserver {
+
+class TabletCopyThrottlerTest : public KuduTest {
+};
+
+TEST_F(TabletCopyThrottlerTest, TestUnlimited) {
+  TabletCopyThrottler throttler;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(0, throttler.Throttle(1024 * 1024, 0).ToMicroseconds());
+  }
+}
+
+TEST_F(TabletCopyThrottlerTest, TestThrottlesAndAdjustsRate) {
+  TabletCopyThrottler throttler;
+
+  // Chunks larger than what a refill period grants still go through, at the
+  // budgeted rate: 1MB at 2MB/s takes about half a second.
+  const int64_t kChunkBytes = 1024 * 1024;
+  MonoTime start = MonoTime::Now();
+  throttler.Throttle(kChunkBytes, 2 * kChunkBytes);
+  MonoDelta elapsed = MonoTime::Now() - start;
+  ASSERT_GE(elapsed.ToMilliseconds(), 300);
+
+  // Raising the rate takes effect right away.
+  start = MonoTime::Now();
+  throttler.Throttle(kChunkBytes, 100 * kChunkBytes);
+  elapsed = MonoTime::Now() - start;
+  ASSERT_LT(elapsed.ToMilliseconds(), 400);
+
+  // And so does lifting the budget altogether.
+  ASSERT_EQ(0, throttler.Throttle(kChunkBytes, 0).ToMicroseconds());
+}
+
+} // namespace tserver
+} // namespace kudu
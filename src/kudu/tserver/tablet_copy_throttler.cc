@@ -0,0 +1,72 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/tablet_copy_throttler.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "kudu/util/throttler.h"
+
+namespace kudu {
+namespace tserver {
+
+// The number of refill periods per second of the underlying throttler.
+static const int64_t kRefillsPerSec =
+    MonoTime::kMicrosecondsPerSecond / Throttler::kRefillPeriodMicros;
+
+TabletCopyThrottler::TabletCopyThrottler()
+    : bytes_per_sec_(0) {
+}
+
+TabletCopyThrottler::~TabletCopyThrottler() {}
+
+std::shared_ptr<Throttler> TabletCopyThrottler::GetThrottler(int64_t bytes_per_sec) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (bytes_per_sec != bytes_per_sec_) {
+    bytes_per_sec_ = bytes_per_sec;
+    // Rates too low to grant a single byte per refill period are rounded up.
+    throttler_.reset(new Throttler(MonoTime::Now(), 0,
+                                   std::max(bytes_per_sec, kRefillsPerSec), 1.0));
+  }
+  return throttler_;
+}
+
+MonoDelta TabletCopyThrottler::Throttle(uint64_t bytes, int64_t bytes_per_sec) {
+  if (bytes_per_sec <= 0) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  std::shared_ptr<Throttler> throttler = GetThrottler(bytes_per_sec);
+
+  // With a burst factor of 1, each refill period grants at most the tokens of
+  // a single period, so chunks larger than that are taken in pieces.
+  const uint64_t max_take_bytes = std::max<int64_t>(bytes_per_sec / kRefillsPerSec, 1);
+  MonoTime start = MonoTime::Now();
+  MonoTime now = start;
+  while (bytes > 0) {
+    uint64_t take = std::min(bytes, max_take_bytes);
+    while (!throttler->Take(now, 0, take)) {
+      SleepFor(MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros / 10));
+      now = MonoTime::Now();
+    }
+    bytes -= take;
+  }
+  return now - start;
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+class Throttler;
+
+namespace tserver {
+
+// A bandwidth budget shared by the tablet copies going through a server,
+// either as their source or as their destination. The rate is passed on each
+// call rather than fixed at construction, so that it may be changed at runtime.
+//
+// This class is thread-safe.
+class TabletCopyThrottler {
+ public:
+  TabletCopyThrottler();
+  ~TabletCopyThrottler();
+
+  // Blocks the current thread until 'bytes' bytes fit in a budget of
+  // 'bytes_per_sec', or returns immediately if 'bytes_per_sec' is 0.
+  // Returns the time spent blocked.
+  MonoDelta Throttle(uint64_t bytes, int64_t bytes_per_sec);
+
+ private:
+  // Returns the throttler for 'bytes_per_sec', replacing the current one if
+  // the rate changed.
+  std::shared_ptr<Throttler> GetThrottler(int64_t bytes_per_sec);
+
+  simple_spinlock lock_;
+  int64_t bytes_per_sec_;
+  std::shared_ptr<Throttler> throttler_;
+
+  DISALLOW_COPY_AND_ASSIGN(TabletCopyThrottler);
+};
+
+} // namespace tserver
+} // namespace kudu
@@ -20,7 +20,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -37,21 +40,26 @@
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/clock/clock.h"
 #include "kudu/clock/hybrid_clock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol-test-util.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/consensus.proxy.h"
 #include "kudu/consensus/log-test-base.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs-test-util.h"
@@ -69,6 +77,7 @@
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/server_base.pb.h"
 #include "kudu/server/server_base.proxy.h"
@@ -76,6 +85,7 @@
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/block_cache_warmer.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/scanners.h"
@@ -111,13 +121,19 @@
 using google::protobuf::util::MessageDifferencer;
 using kudu::clock::Clock;
 using kudu::clock::HybridClock;
+using kudu::consensus::ConsensusRequestPB;
+using kudu::consensus::ConsensusResponsePB;
 using kudu::consensus::ConsensusStatePB;
+using kudu::consensus::MultiRaftConsensusRequestPB;
+using kudu::consensus::MultiRaftConsensusResponsePB;
 using kudu::fs::CreateCorruptBlock;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
+using kudu::rpc::RequestIdPB;
 using kudu::rpc::RpcController;
+using kudu::rpc::RpcSidecar;
 using kudu::tablet::RowSetDataPB;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletReplica;
@@ -141,10 +157,12 @@ DEFINE_int32(single_threaded_insert_latency_bench_insert_rows, 1000,
 DEFINE_int32(delete_tablet_bench_num_flushes, 200,
              "Number of disk row sets to flush in the delete tablet benchmark");
 
+DECLARE_bool(block_cache_warmup);
 DECLARE_bool(crash_on_eio);
 DECLARE_bool(enable_maintenance_manager);
 DECLARE_bool(fail_dns_resolution);
 DECLARE_double(env_inject_eio);
+DECLARE_int32(block_cache_warmup_rate_mb);
 DECLARE_int32(flush_threshold_mb);
 DECLARE_int32(flush_threshold_secs);
 DECLARE_int32(maintenance_manager_num_threads);
@@ -434,6 +452,46 @@ TEST_F(TabletServerTest, TestFailedTabletsRejectConsensusState) {
   ASSERT_STR_CONTAINS(s.ToString(), "Tablet replica is shutdown");
 }
 
+// Test that a MultiRaftUpdateConsensus RPC applies each of its requests to
+// its own tablet, and reports per-request errors in the matching response.
+TEST_F(TabletServerTest, TestMultiRaftUpdateConsensus) {
+  MultiRaftConsensusRequestPB req;
+  MultiRaftConsensusResponsePB resp;
+  RpcController rpc;
+
+  // A heartbeat from a stale leader for the tablet hosted by the server...
+  ConsensusRequestPB* stale = req.add_consensus_requests();
+  stale->set_tablet_id(kTabletId);
+  stale->set_dest_uuid(mini_server_->uuid());
+  stale->set_caller_uuid("fake-leader");
+  stale->set_caller_term(0);
+  *stale->mutable_preceding_id() = consensus::MinimumOpId();
+  stale->set_committed_index(0);
+  stale->set_all_replicated_index(0);
+  // ... one for a tablet it doesn't host...
+  ConsensusRequestPB* missing = req.add_consensus_requests();
+  missing->CopyFrom(*stale);
+  missing->set_tablet_id("missing-tablet");
+  // ... and one meant for another server.
+  ConsensusRequestPB* wrong_server = req.add_consensus_requests();
+  wrong_server->CopyFrom(*stale);
+  wrong_server->set_dest_uuid("other-server");
+
+  ASSERT_OK(consensus_proxy_->MultiRaftUpdateConsensus(req, &resp, &rpc));
+  ASSERT_EQ(3, resp.consensus_responses_size());
+
+  const ConsensusResponsePB& stale_resp = resp.consensus_responses(0);
+  ASSERT_FALSE(stale_resp.has_error()) << SecureShortDebugString(stale_resp);
+  ASSERT_EQ(mini_server_->uuid(), stale_resp.responder_uuid());
+  ASSERT_TRUE(stale_resp.status().has_error());
+  ASSERT_EQ(consensus::ConsensusErrorPB::INVALID_TERM, stale_resp.status().error().code());
+
+  ASSERT_TRUE(resp.consensus_responses(1).has_error());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.consensus_responses(1).error().code());
+  ASSERT_TRUE(resp.consensus_responses(2).has_error());
+  ASSERT_EQ(TabletServerErrorPB::WRONG_SERVER_UUID, resp.consensus_responses(2).error().code());
+}
+
 // Test that tablets that get failed and deleted will eventually show up as
 // failed tombstones on the web UI.
 TEST_F(TabletServerTest, TestFailedTabletsOnWebUI) {
@@ -824,6 +882,97 @@ TEST_F(TabletServerTest, TestExternalConsistencyModes_CommitWait) {
 }
 
 
+// Test a write whose rows are sent in sidecars, and that they're replayed
+// from the WAL after a restart.
+TEST_F(TabletServerTest, TestInsertWithRowsInSidecars) {
+  WriteRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  RowOperationsPB ops;
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 10, "hello via a sidecar", &ops);
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 20, "hello again", &ops);
+
+  WriteResponsePB resp;
+  RpcController controller;
+  int idx;
+  ASSERT_OK(controller.AddOutboundSidecar(RpcSidecar::FromSlice(Slice(ops.rows())), &idx));
+  req.mutable_row_operations()->set_rows_sidecar(idx);
+  ASSERT_OK(controller.AddOutboundSidecar(
+      RpcSidecar::FromSlice(Slice(ops.indirect_data())), &idx));
+  req.mutable_row_operations()->set_indirect_data_sidecar(idx);
+  controller.RequireServerFeature(TabletServerFeatures::ROW_OPERATIONS_SIDECARS);
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  ASSERT_FALSE(resp.has_error()) << SecureShortDebugString(resp);
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+
+  ASSERT_NO_FATAL_FAILURE(ShutdownAndRebuildTablet());
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+
+  // A sidecar index which wasn't sent is rejected.
+  controller.Reset();
+  req.mutable_row_operations()->set_rows_sidecar(5);
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_MUTATION, resp.error().code());
+}
+
+// Test writes to several tablets in a single MultiTabletWrite RPC, and that
+// the tracked result of one of them is used for a retry in a Write RPC.
+TEST_F(TabletServerTest, TestMultiTabletWrite) {
+  MultiTabletWriteRequestPB req;
+  MultiTabletWriteResponsePB resp;
+  RpcController controller;
+
+  // A write with a request id to the tablet hosted by the server...
+  auto* tracked = req.add_writes();
+  tracked->mutable_request()->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, tracked->mutable_request()->mutable_schema()));
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 10, "tracked",
+                 tracked->mutable_request()->mutable_row_operations());
+  RequestIdPB* request_id = tracked->mutable_request_id();
+  request_id->set_client_id("test-client");
+  request_id->set_seq_no(0);
+  request_id->set_first_incomplete_seq_no(0);
+  request_id->set_attempt_no(0);
+  // ... one to a tablet it doesn't host...
+  auto* missing = req.add_writes();
+  missing->mutable_request()->CopyFrom(tracked->request());
+  missing->mutable_request()->set_tablet_id("missing-tablet");
+  // ... and an untracked one with a duplicate key.
+  auto* untracked = req.add_writes();
+  untracked->mutable_request()->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, untracked->mutable_request()->mutable_schema()));
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 20, "untracked",
+                 untracked->mutable_request()->mutable_row_operations());
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 30, "duplicate",
+                 untracked->mutable_request()->mutable_row_operations());
+
+  ASSERT_OK(proxy_->MultiTabletWrite(req, &resp, &controller));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_EQ(3, resp.responses_size());
+  const WriteResponsePB& tracked_resp = resp.responses(0);
+  ASSERT_FALSE(tracked_resp.has_error());
+  ASSERT_EQ(0, tracked_resp.per_row_errors_size());
+  ASSERT_TRUE(resp.responses(1).has_error());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  ASSERT_FALSE(resp.responses(2).has_error());
+  ASSERT_EQ(1, resp.responses(2).per_row_errors_size());
+  ASSERT_EQ(1, resp.responses(2).per_row_errors(0).row_index());
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+
+  // A retry of the tracked write gets its recorded response, and isn't applied
+  // a second time.
+  WriteResponsePB retry_resp;
+  controller.Reset();
+  unique_ptr<RequestIdPB> retry_id(new RequestIdPB(tracked->request_id()));
+  retry_id->set_attempt_no(1);
+  controller.SetRequestIdPB(std::move(retry_id));
+  ASSERT_OK(proxy_->Write(tracked->request(), &retry_resp, &controller));
+  ASSERT_FALSE(retry_resp.has_error()) << SecureShortDebugString(retry_resp);
+  ASSERT_EQ(tracked_resp.timestamp(), retry_resp.timestamp());
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+}
+
 TEST_F(TabletServerTest, TestInsertAndMutate) {
 
   scoped_refptr<TabletReplica> tablet;
@@ -1252,6 +1401,43 @@ TEST_F(TabletServerTest, TestKUDU_176_RecoveryAfterMajorDeltaCompaction) {
   ANFF(VerifyRows(schema_, { KeyValue(1, 2) }));
 }
 
+// Test that the blocks in the block cache are saved at shutdown and read
+// back after the restart.
+TEST_F(TabletServerTest, TestBlockCacheWarmup) {
+  FLAGS_block_cache_warmup = true;
+  FLAGS_block_cache_warmup_rate_mb = 0;
+  // Restart with the warm-up enabled, so that the blocks read are tracked.
+  ASSERT_OK(ShutdownAndRebuildTablet());
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_TRUE(mini_server_->server()->block_cache_warmer()->warmup_done());
+    });
+
+  const int kNumRows = 1000;
+  NO_FATALS(InsertTestRowsDirect(0, kNumRows));
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  vector<KeyValue> expected;
+  for (int i = 0; i < kNumRows; i++) {
+    expected.emplace_back(i, i * 2);
+  }
+  NO_FATALS(VerifyRows(schema_, expected));
+
+  ASSERT_OK(ShutdownAndRebuildTablet());
+  cfile::BlockCacheSnapshotPB snapshot;
+  ASSERT_OK(pb_util::ReadPBContainerFromPath(
+      env_, mini_server_->server()->fs_manager()->GetBlockCacheSnapshotPath(), &snapshot));
+  ASSERT_GT(snapshot.blocks_size(), 0);
+  for (int i = 1; i < snapshot.blocks_size(); i++) {
+    const auto& prev = snapshot.blocks(i - 1);
+    const auto& cur = snapshot.blocks(i);
+    ASSERT_TRUE(prev.file_id() < cur.file_id() ||
+                (prev.file_id() == cur.file_id() && prev.offset() < cur.offset()));
+  }
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_TRUE(mini_server_->server()->block_cache_warmer()->warmup_done());
+    });
+  NO_FATALS(VerifyRows(schema_, expected));
+}
+
 // Regression test for KUDU-1341, a case in which, during bootstrap,
 // we have a DELETE for a row which is still live in multiple on-disk
 // rowsets.
@@ -2025,6 +2211,54 @@ TEST_F(TabletServerTest, TestScanYourWrites_PropagatedTimestampInTheFuture) {
   ASSERT_EQ(R"((int32 key=0, int32 int_val=0, string string_val="original0"))", results[0]);
 }
 
+TEST_F(TabletServerTest, TestGet) {
+  // Some rows on disk and some in the MemRowSet.
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(100, 10);
+
+  GetRequestPB req;
+  GetResponsePB resp;
+  RpcController rpc;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_projected_columns()));
+  for (int32_t key : { 50, 1000, 105 }) {
+    KuduPartialRow row(&schema_);
+    ASSERT_OK(row.SetInt32(0, key));
+    req.add_encoded_primary_keys(row.ToEncodedRowKeyOrDie());
+  }
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Get(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+
+  // Only the rows which exist are returned.
+  ASSERT_EQ(2, resp.key_indexes_size());
+  ASSERT_EQ(0, resp.key_indexes(0));
+  ASSERT_EQ(2, resp.key_indexes(1));
+  Slice direct, indirect;
+  ASSERT_OK(rpc.GetInboundSidecar(resp.data().rows_sidecar(), &direct));
+  if (resp.data().has_indirect_data_sidecar()) {
+    ASSERT_OK(rpc.GetInboundSidecar(resp.data().indirect_data_sidecar(), &indirect));
+  }
+  vector<const uint8_t*> rows;
+  ASSERT_OK(ExtractRowsFromRowBlockPB(schema_, resp.data(), indirect, &direct, &rows));
+  ASSERT_EQ(2, rows.size());
+  ASSERT_EQ(R"((int32 key=50, int32 int_val=100, string string_val="hello 50"))",
+            schema_.DebugRow(ConstContiguousRow(&schema_, rows[0])));
+  ASSERT_EQ(R"((int32 key=105, int32 int_val=210, string string_val="hello 105"))",
+            schema_.DebugRow(ConstContiguousRow(&schema_, rows[1])));
+
+  // Keys which can't be decoded are rejected.
+  req.add_encoded_primary_keys("x");
+  rpc.Reset();
+  ASSERT_OK(proxy_->Get(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::MISMATCHED_SCHEMA, resp.error().code());
+}
+
 TEST_F(TabletServerTest, TestScanWithStringPredicates) {
   InsertTestRowsDirect(0, 100);
 
@@ -2154,6 +2388,104 @@ TEST_F(TabletServerTest, TestScanWithEncodedPredicates) {
             results.back());
 }
 
+TEST_F(TabletServerTest, TestAggregateScan) {
+  InsertTestRowsDirect(0, 1000);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  // Use a tiny batch size to make sure partial results from several responses
+  // are combined correctly.
+  req.set_batch_size_bytes(1);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+
+  // Set up a range predicate: 51 <= key <= 100
+  ColumnRangePredicatePB* pred = scan->add_deprecated_range_predicates();
+  pred->mutable_column()->CopyFrom(scan->projected_columns(0));
+  int32_t lower_bound_int = 51;
+  int32_t upper_bound_int = 100;
+  pred->mutable_lower_bound()->append(reinterpret_cast<char*>(&lower_bound_int),
+                                      sizeof(lower_bound_int));
+  pred->mutable_inclusive_upper_bound()->append(reinterpret_cast<char*>(&upper_bound_int),
+                                                sizeof(upper_bound_int));
+
+  // COUNT(*), SUM(int_val), MIN(key), MAX(string_val).
+  scan->add_aggregates()->set_type(AggregatePB::COUNT);
+  AggregatePB* sum = scan->add_aggregates();
+  sum->set_type(AggregatePB::SUM);
+  sum->set_projection_idx(1);
+  AggregatePB* min = scan->add_aggregates();
+  min->set_type(AggregatePB::MIN);
+  min->set_projection_idx(0);
+  AggregatePB* max = scan->add_aggregates();
+  max->set_type(AggregatePB::MAX);
+  max->set_projection_idx(2);
+
+  int64_t count = 0;
+  int64_t int_sum = 0;
+  int32_t min_key = std::numeric_limits<int32_t>::max();
+  string max_string;
+  int num_responses = 0;
+  while (true) {
+    ScanResponsePB resp;
+    RpcController rpc;
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_data());
+    ASSERT_EQ(4, resp.aggregate_results_size());
+    num_responses++;
+
+    count += resp.aggregate_results(0).count();
+    int_sum += resp.aggregate_results(1).int_sum();
+    if (resp.aggregate_results(2).has_value()) {
+      int32_t key;
+      ASSERT_EQ(sizeof(key), resp.aggregate_results(2).value().size());
+      memcpy(&key, resp.aggregate_results(2).value().data(), sizeof(key));
+      min_key = std::min(min_key, key);
+    }
+    if (resp.aggregate_results(3).has_value()) {
+      max_string = std::max(max_string, resp.aggregate_results(3).value());
+    }
+
+    if (!resp.has_more_results()) {
+      break;
+    }
+    ScanRequestPB next_req;
+    next_req.set_scanner_id(resp.has_scanner_id() ? resp.scanner_id() : req.scanner_id());
+    next_req.set_call_seq_id(req.has_new_scan_request() ? 1 : req.call_seq_id() + 1);
+    next_req.set_batch_size_bytes(1);
+    req = next_req;
+  }
+
+  ASSERT_GE(num_responses, 1);
+  ASSERT_EQ(50, count);
+  ASSERT_EQ(7550, int_sum); // 2 * (51 + ... + 100)
+  ASSERT_EQ(51, min_key);
+  ASSERT_EQ("hello 99", max_string);
+}
+
+TEST_F(TabletServerTest, TestAggregateScan_BadAggregates) {
+  InsertTestRowsDirect(0, 10);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+
+  // SUM over a string column is not allowed.
+  AggregatePB* sum = scan->add_aggregates();
+  sum->set_type(AggregatePB::SUM);
+  sum->set_projection_idx(2);
+
+  ScanResponsePB resp;
+  RpcController rpc;
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  ASSERT_STR_CONTAINS(resp.error().status().message(), "cannot SUM column");
+}
 
 // Test requesting more rows from a scanner which doesn't exist
 TEST_F(TabletServerTest, TestBadScannerID) {
@@ -2355,6 +2687,36 @@ TEST_F(TabletServerTest, TestScan_KeepAliveExpiredScanner) {
   ASSERT_EQ(resp.error().code(), TabletServerErrorPB::SCANNER_EXPIRED);
 }
 
+// Test that MultiScannerKeepAlive keeps live scanners alive and reports
+// missing ones, each in the response slot matching its request entry.
+TEST_F(TabletServerTest, TestScan_MultiScannerKeepAlive) {
+  InsertTestRowsDirect(0, 10);
+  ScanResponsePB scan_resp;
+  ASSERT_NO_FATAL_FAILURE(OpenScannerWithAllColumns(&scan_resp));
+  const string& scanner_id = scan_resp.scanner_id();
+  ASSERT_FALSE(scanner_id.empty());
+
+  SharedScanner scanner;
+  ASSERT_TRUE(mini_server_->server()->scanner_manager()->LookupScanner(scanner_id, &scanner));
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  MonoTime before_keep_alive = MonoTime::Now();
+  ASSERT_GE(scanner->TimeSinceLastAccess(before_keep_alive).ToMilliseconds(), 100);
+
+  MultiScannerKeepAliveRequestPB req;
+  MultiScannerKeepAliveResponsePB resp;
+  RpcController rpc;
+  req.add_scanner_ids("does-not-exist");
+  req.add_scanner_ids(scanner_id);
+  ASSERT_OK(proxy_->MultiScannerKeepAlive(req, &resp, &rpc));
+  ASSERT_EQ(2, resp.responses_size());
+  ASSERT_TRUE(resp.responses(0).has_error());
+  ASSERT_EQ(TabletServerErrorPB::SCANNER_EXPIRED, resp.responses(0).error().code());
+  ASSERT_FALSE(resp.responses(1).has_error());
+  // The scanner's access time was updated by the keepalive.
+  MonoTime now = MonoTime::Now();
+  ASSERT_LE(scanner->TimeSinceLastAccess(now), now - before_keep_alive);
+}
+
 void TabletServerTest::ScanYourWritesTest(uint64_t propagated_timestamp,
                                           ScanResponsePB* resp) {
   ScanRequestPB req;
@@ -32,6 +32,7 @@
 #include "kudu/gutil/move.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/service_if.h"
+#include "kudu/tserver/block_cache_warmer.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_copy_service.h"
@@ -55,7 +56,7 @@ TabletServer::TabletServer(const TabletServerOptions& opts)
     fail_heartbeats_for_tests_(false),
     opts_(opts),
     tablet_manager_(new TSTabletManager(this)),
-    scanner_manager_(new ScannerManager(metric_entity())),
+    scanner_manager_(new ScannerManager(metric_entity(), mem_tracker())),
     path_handlers_(new TabletServerPathHandlers(this)),
     maintenance_manager_(new MaintenanceManager(MaintenanceManager::kDefaultOptions)) {
 }
@@ -97,6 +98,11 @@ Status TabletServer::Init() {
 
   heartbeater_.reset(new Heartbeater(opts_, this));
 
+  // The blocks read while the tablets are opened must be tracked.
+  block_cache_warmer_.reset(new BlockCacheWarmer(fs_manager_.get(), tablet_manager_.get()));
+  RETURN_NOT_OK_PREPEND(block_cache_warmer_->Init(),
+                        "Could not init the block cache warmer");
+
   RETURN_NOT_OK_PREPEND(tablet_manager_->Init(),
                         "Could not init Tablet Manager");
 
@@ -125,12 +131,13 @@ Status TabletServer::Start() {
 
   RETURN_NOT_OK(RegisterService(std::move(ts_service)));
   RETURN_NOT_OK(RegisterService(std::move(admin_service)));
-  RETURN_NOT_OK(RegisterService(std::move(consensus_service)));
+  RETURN_NOT_OK(RegisterConsensusService(std::move(consensus_service)));
   RETURN_NOT_OK(RegisterService(std::move(tablet_copy_service)));
   RETURN_NOT_OK(KuduServer::Start());
 
   RETURN_NOT_OK(heartbeater_->Start());
   RETURN_NOT_OK(maintenance_manager_->Init(fs_manager_->uuid()));
+  RETURN_NOT_OK(block_cache_warmer_->Start());
 
   google::FlushLogFiles(google::INFO); // Flush the startup messages.
 
@@ -149,6 +156,7 @@ void TabletServer::Shutdown() {
     maintenance_manager_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::DISK);
+    block_cache_warmer_->Shutdown();
     tablet_manager_->Shutdown();
 
     // 3. Shut down generic subsystems.
@@ -34,6 +34,7 @@ class MaintenanceManager;
 
 namespace tserver {
 
+class BlockCacheWarmer;
 class Heartbeater;
 class ScannerManager;
 class TabletServerPathHandlers;
@@ -70,6 +71,8 @@ class TabletServer : public kserver::KuduServer {
 
   Heartbeater* heartbeater() { return heartbeater_.get(); }
 
+  BlockCacheWarmer* block_cache_warmer() { return block_cache_warmer_.get(); }
+
   void set_fail_heartbeats_for_tests(bool fail_heartbeats_for_tests) {
     base::subtle::NoBarrier_Store(&fail_heartbeats_for_tests_, 1);
   }
@@ -106,6 +109,9 @@ class TabletServer : public kserver::KuduServer {
   // Thread responsible for heartbeating to the master.
   gscoped_ptr<Heartbeater> heartbeater_;
 
+  // Saves the blocks in the block cache and reads them back after a restart.
+  gscoped_ptr<BlockCacheWarmer> block_cache_warmer_;
+
   // Webserver path handlers
   gscoped_ptr<TabletServerPathHandlers> path_handlers_;
 
@@ -17,7 +17,10 @@
 
 #include "kudu/tserver/tablet_service.h"
 
+#include <nmmintrin.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <functional>
@@ -34,11 +37,13 @@
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/column_stats.h"
 #include "kudu/clock/clock.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
+#include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/iterator_stats.h"
 #include "kudu/common/partition.h"
@@ -55,12 +60,17 @@
 #include "kudu/consensus/replica_management.pb.h"
 #include "kudu/consensus/time_manager.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/move.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/rpc/remote_user.h"
+#include "kudu/rpc/result_tracker.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
@@ -75,6 +85,8 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/scan_aggregator.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tablet_server.h"
@@ -83,7 +95,6 @@
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_service.pb.h"
 #include "kudu/util/auto_release_pool.h"
-#include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
@@ -93,9 +104,11 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/process_memory.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/trace_metrics.h"
 #include "kudu/util/website_util.h"
@@ -116,6 +129,12 @@ DEFINE_int32(scanner_batch_size_rows, 100,
 TAG_FLAG(scanner_batch_size_rows, advanced);
 TAG_FLAG(scanner_batch_size_rows, runtime);
 
+DEFINE_int64(scanner_max_top_n_rows, 100000,
+             "The maximum limit of top-N scans. Each top-N scan holds up to that "
+             "many rows in memory until the whole tablet was scanned.");
+TAG_FLAG(scanner_max_top_n_rows, advanced);
+TAG_FLAG(scanner_max_top_n_rows, runtime);
+
 DEFINE_bool(scanner_allow_snapshot_scans_with_logical_timestamps, false,
             "If set, the server will support snapshot scans with logical timestamps.");
 TAG_FLAG(scanner_allow_snapshot_scans_with_logical_timestamps, unsafe);
@@ -126,6 +145,14 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
              "longer.");
 TAG_FLAG(scanner_max_wait_ms, advanced);
 
+DEFINE_int64(scan_result_cache_capacity_mb, 0,
+             "Capacity of the cache of the results of snapshot scans answered with a "
+             "single batch, in MiB. Repeated identical scans at the same snapshot are "
+             "answered from the cache without reading the tablet. "
+             "Set to 0 to disable the cache.");
+TAG_FLAG(scan_result_cache_capacity_mb, advanced);
+TAG_FLAG(scan_result_cache_capacity_mb, experimental);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -148,6 +175,8 @@ using kudu::consensus::GetNodeInstanceRequestPB;
 using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiRaftConsensusRequestPB;
+using kudu::consensus::MultiRaftConsensusResponsePB;
 using kudu::consensus::OpId;
 using kudu::consensus::RaftConsensus;
 using kudu::consensus::RunLeaderElectionRequestPB;
@@ -161,6 +190,8 @@ using kudu::consensus::VoteRequestPB;
 using kudu::consensus::VoteResponsePB;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using kudu::rpc::RequestIdPB;
+using kudu::rpc::ResultTracker;
 using kudu::rpc::RpcContext;
 using kudu::rpc::RpcSidecar;
 using kudu::server::ServerBase;
@@ -190,6 +221,12 @@ namespace tserver {
 
 namespace {
 
+// The names of the trace counters of the iterator stats of scans, reported
+// to the clients in the resource metrics of the scan responses.
+const char* const kScanCellsReadCounterName = "scan_cells_read";
+const char* const kScanBytesReadCounterName = "scan_bytes_read";
+const char* const kScanBlocksReadCounterName = "scan_blocks_read";
+
 // Lookup the given tablet, only ensuring that it exists.
 // If it does not, responds to the RPC associated with 'context' after setting
 // resp->mutable_error() to indicate the failure reason.
@@ -210,24 +247,34 @@ bool LookupTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
   return true;
 }
 
-template<class RespClass>
-void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+// Returns the error for a request to 'replica' while it is in 'tablet_state',
+// rather than RUNNING, and sets 'error_code' accordingly.
+Status TabletNotRunningError(const scoped_refptr<TabletReplica>& replica,
                              tablet::TabletStatePB tablet_state,
-                             RespClass* resp,
-                             rpc::RpcContext* context) {
+                             TabletServerErrorPB::Code* error_code) {
   Status s = Status::IllegalState("Tablet not RUNNING",
                                   tablet::TabletStatePB_Name(tablet_state));
-  auto error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
   if (replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_TOMBSTONED ||
       replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_DELETED) {
     // Treat tombstoned tablets as if they don't exist for most purposes.
     // This takes precedence over failed, since we don't reset the failed
     // status of a TabletReplica when deleting it. Only tablet copy does that.
-    error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
   } else if (tablet_state == tablet::FAILED) {
     s = s.CloneAndAppend(replica->error().ToString());
-    error_code = TabletServerErrorPB::TABLET_FAILED;
+    *error_code = TabletServerErrorPB::TABLET_FAILED;
   }
+  return s;
+}
+
+template<class RespClass>
+void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+                             tablet::TabletStatePB tablet_state,
+                             RespClass* resp,
+                             rpc::RpcContext* context) {
+  TabletServerErrorPB::Code error_code;
+  Status s = TabletNotRunningError(replica, tablet_state, &error_code);
   SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
 }
 
@@ -415,6 +462,79 @@ class RpcTransactionCompletionCallback : public TransactionCompletionCallback {
   tablet::TransactionState* state_;
 };
 
+namespace {
+
+// Sets 'error' as the error of 'resp', one of the responses to a
+// MultiTabletWrite() RPC.
+void SetWriteError(WriteResponsePB* resp,
+                   const Status& error,
+                   TabletServerErrorPB::Code code) {
+  StatusToPB(error, resp->mutable_error()->mutable_status());
+  resp->mutable_error()->set_code(code);
+}
+
+// Responds to a MultiTabletWrite() RPC once all of its writes completed.
+class MultiTabletWriteCompletion {
+ public:
+  MultiTabletWriteCompletion(rpc::RpcContext* context, int num_pending)
+      : context_(context),
+        num_pending_(num_pending) {}
+
+  // Called once for each write, and once by the handler after submitting them.
+  // The last call responds to the RPC and deletes this object.
+  void WriteCompleted() {
+    if (num_pending_.fetch_sub(1) == 1) {
+      context_->RespondSuccess();
+      delete this;
+    }
+  }
+
+ private:
+  rpc::RpcContext* context_;
+  std::atomic<int> num_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiTabletWriteCompletion);
+};
+
+// A transaction completion callback for one write of a MultiTabletWrite()
+// RPC. Sets the error of the write in its response, records its result if
+// it is tracked, and lets 'completion' know it is done.
+class MultiTabletWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  MultiTabletWriteCompletionCallback(WriteResponsePB* response,
+                                     const RequestIdPB* request_id,
+                                     scoped_refptr<ResultTracker> result_tracker,
+                                     MultiTabletWriteCompletion* completion)
+      : response_(response),
+        request_id_(request_id),
+        result_tracker_(std::move(result_tracker)),
+        completion_(completion) {}
+
+  virtual void TransactionCompleted() OVERRIDE {
+    if (!status_.ok()) {
+      SetWriteError(response_, status_, code_);
+    }
+    if (request_id_) {
+      // Any retry of the write sent meanwhile in a Write() RPC is attached to
+      // the tracked result, and gets its response here.
+      if (status_.ok()) {
+        result_tracker_->RecordCompletionAndRespond(*request_id_, response_);
+      } else {
+        result_tracker_->FailAndRespond(*request_id_, response_);
+      }
+    }
+    completion_->WriteCompleted();
+  }
+
+ private:
+  WriteResponsePB* response_;
+  const RequestIdPB* request_id_;
+  scoped_refptr<ResultTracker> result_tracker_;
+  MultiTabletWriteCompletion* completion_;
+};
+
+} // anonymous namespace
+
 // Generic interface to handle scan results.
 class ScanResultCollector {
  public:
@@ -438,6 +558,12 @@ class ScanResultCollector {
   //
   // Does nothing by default.
   virtual void set_row_format_flags(uint64_t /* row_format_flags */) {}
+
+  // Sets the aggregator for an aggregating scan. Like the row format flags,
+  // this is set once the request (or the scanner it continues) is decoded.
+  //
+  // Does nothing by default.
+  virtual void set_aggregator(unique_ptr<ScanAggregator> /* aggregator */) {}
 };
 
 namespace {
@@ -478,18 +604,47 @@ class ScanResultCopier : public ScanResultCollector {
         rows_data_(DCHECK_NOTNULL(rows_data)),
         indirect_data_(DCHECK_NOTNULL(indirect_data)),
         num_rows_returned_(0),
-        pad_unixtime_micros_to_16_bytes_(false) {}
+        pad_unixtime_micros_to_16_bytes_(false),
+        columnar_layout_(false),
+        columnar_size_(0) {}
 
   void HandleRowBlock(const Schema* client_projection_schema,
                               const RowBlock& row_block) override {
+    if (aggregator_) {
+      // Aggregating scans return no rows, only the aggregate results.
+      aggregator_->AddRowBlock(row_block);
+      SetLastRow(row_block, &last_primary_key_);
+      return;
+    }
     num_rows_returned_ += row_block.selection_vector()->CountSelected();
-    SerializeRowBlock(row_block, rowblock_pb_, client_projection_schema,
-                      rows_data_, indirect_data_, pad_unixtime_micros_to_16_bytes_);
+    if (columnar_layout_) {
+      SerializeRowBlockColumnar(row_block, client_projection_schema, &columnar_batch_);
+      columnar_size_ = 0;
+      for (const auto& col : columnar_batch_.columns) {
+        columnar_size_ += col.data->size();
+        if (col.varlen_data) {
+          columnar_size_ += col.varlen_data->size();
+        }
+        if (col.non_null_bitmap) {
+          columnar_size_ += col.non_null_bitmap->size();
+        }
+      }
+    } else {
+      SerializeRowBlock(row_block, rowblock_pb_, client_projection_schema,
+                        rows_data_, indirect_data_, pad_unixtime_micros_to_16_bytes_);
+    }
     SetLastRow(row_block, &last_primary_key_);
   }
 
   // Returns number of bytes buffered to return.
   int64_t ResponseSize() const override {
+    if (aggregator_) {
+      // Like checksum scans, aggregating scans are bounded by the time budget.
+      return 0;
+    }
+    if (columnar_layout_) {
+      return columnar_size_;
+    }
     return rows_data_->size() + indirect_data_->size();
   }
 
@@ -505,6 +660,34 @@ class ScanResultCopier : public ScanResultCollector {
     if (row_format_flags & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES) {
       pad_unixtime_micros_to_16_bytes_ = true;
     }
+    if (row_format_flags & RowFormatFlags::COLUMNAR_LAYOUT) {
+      columnar_layout_ = true;
+    }
+  }
+
+  // Whether the results were serialized in columnar layout, in which case
+  // they are held in columnar_batch() rather than the row block PB.
+  bool columnar_layout() const {
+    return columnar_layout_;
+  }
+
+  ColumnarSerializedBatch* columnar_batch() {
+    return &columnar_batch_;
+  }
+
+  void set_aggregator(unique_ptr<ScanAggregator> aggregator) override {
+    aggregator_ = std::move(aggregator);
+  }
+
+  // Whether this is an aggregating scan, in which case the results are
+  // retrieved with AggregateResultsToPB().
+  bool aggregating() const {
+    return aggregator_ != nullptr;
+  }
+
+  void AggregateResultsToPB(RepeatedPtrField<AggregateResultPB>* results) const {
+    DCHECK(aggregator_);
+    aggregator_->ToPB(results);
   }
 
  private:
@@ -514,16 +697,46 @@ class ScanResultCopier : public ScanResultCollector {
   int64_t num_rows_returned_;
   faststring last_primary_key_;
   bool pad_unixtime_micros_to_16_bytes_;
+  bool columnar_layout_;
+  ColumnarSerializedBatch columnar_batch_;
+  int64_t columnar_size_;
+  unique_ptr<ScanAggregator> aggregator_;
 
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
 
+// Extends the CRC32C register 'crc' with 'len' bytes at 'data', using the
+// SSE4.2 CRC32 instruction. The register is the CRC before its final
+// inversion, so that data can be appended to it piece by piece.
+static inline uint32_t ExtendCrc32c(uint32_t crc, const void* data, size_t len) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint64_t crc64 = crc;
+  for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+    crc64 = _mm_crc32_u64(crc64, UNALIGNED_LOAD64(p));
+  }
+  crc = static_cast<uint32_t>(crc64);
+  if (len >= sizeof(uint32_t)) {
+    crc = _mm_crc32_u32(crc, UNALIGNED_LOAD32(p));
+    len -= sizeof(uint32_t);
+    p += sizeof(uint32_t);
+  }
+  for (; len > 0; len--, p++) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+
 // Checksums the scan result.
+//
+// The checksum of a row is the CRC32C of its cells, each prefixed by its
+// column index and, if the column is nullable, by whether it's defined. The
+// checksum of the scan is the sum of those of its rows, which doesn't depend
+// on how the rows were split into blocks, so that replicas whose rowsets
+// differ yield the same checksums.
 class ScanResultChecksummer : public ScanResultCollector {
  public:
   ScanResultChecksummer()
-      : crc_(crc::GetCrc32cInstance()),
-        agg_checksum_(0),
+      : agg_checksum_(0),
         rows_checksummed_(0) {
   }
 
@@ -533,13 +746,48 @@ class ScanResultChecksummer : public ScanResultCollector {
       client_projection_schema = &row_block.schema();
     }
 
-    size_t nrows = row_block.nrows();
+    // Rather than serializing each row, the CRCs of all the selected rows are
+    // extended one column at a time.
+    selected_rows_.clear();
+    const size_t nrows = row_block.nrows();
     for (size_t i = 0; i < nrows; i++) {
-      if (!row_block.selection_vector()->IsRowSelected(i)) continue;
-      uint32_t row_crc = CalcRowCrc32(*client_projection_schema, row_block.row(i));
-      agg_checksum_ += row_crc;
-      rows_checksummed_++;
+      if (row_block.selection_vector()->IsRowSelected(i)) {
+        selected_rows_.push_back(i);
+      }
+    }
+    row_crcs_.assign(selected_rows_.size(), ~0U);
+
+    for (size_t j = 0; j < client_projection_schema->num_columns(); j++) {
+      const uint32_t col_index = static_cast<uint32_t>(j);  // For the CRC.
+      const ColumnBlock column = row_block.column_block(j);
+      const bool is_nullable = column.is_nullable();
+      const bool is_binary = column.type_info()->physical_type() == BINARY;
+      const size_t cell_size = column.type_info()->size();
+      for (size_t k = 0; k < selected_rows_.size(); k++) {
+        const size_t i = selected_rows_[k];
+        uint32_t crc = ExtendCrc32c(row_crcs_[k], &col_index, sizeof(col_index));
+        if (is_nullable) {
+          const uint8_t is_defined = column.is_null(i) ? 0 : 1;
+          crc = ExtendCrc32c(crc, &is_defined, sizeof(is_defined));
+          if (!is_defined) {
+            row_crcs_[k] = crc;
+            continue;
+          }
+        }
+        if (is_binary) {
+          const Slice* data = reinterpret_cast<const Slice*>(column.cell_ptr(i));
+          crc = ExtendCrc32c(crc, data->data(), data->size());
+        } else {
+          crc = ExtendCrc32c(crc, column.cell_ptr(i), cell_size);
+        }
+        row_crcs_[k] = crc;
+      }
+    }
+
+    for (uint32_t crc : row_crcs_) {
+      agg_checksum_ += ~crc;
     }
+    rows_checksummed_ += row_crcs_.size();
     // Find the last selected row and save its encoded key.
     SetLastRow(row_block, &encoded_last_row_);
   }
@@ -562,35 +810,11 @@ class ScanResultChecksummer : public ScanResultCollector {
   uint64_t agg_checksum() const { return agg_checksum_; }
 
  private:
-  // Calculates a CRC32C for the given row.
-  uint32_t CalcRowCrc32(const Schema& projection, const RowBlockRow& row) {
-    tmp_buf_.clear();
-
-    for (size_t j = 0; j < projection.num_columns(); j++) {
-      uint32_t col_index = static_cast<uint32_t>(j);  // For the CRC.
-      tmp_buf_.append(&col_index, sizeof(col_index));
-      ColumnBlockCell cell = row.cell(j);
-      if (cell.is_nullable()) {
-        uint8_t is_defined = cell.is_null() ? 0 : 1;
-        tmp_buf_.append(&is_defined, sizeof(is_defined));
-        if (!is_defined) continue;
-      }
-      if (cell.typeinfo()->physical_type() == BINARY) {
-        const Slice* data = reinterpret_cast<const Slice *>(cell.ptr());
-        tmp_buf_.append(data->data(), data->size());
-      } else {
-        tmp_buf_.append(cell.ptr(), cell.size());
-      }
-    }
+  // The indexes of the selected rows of the current block, and their CRC
+  // registers.
+  vector<size_t> selected_rows_;
+  vector<uint32_t> row_crcs_;
 
-    uint64_t row_crc = 0;
-    crc_->Compute(tmp_buf_.data(), tmp_buf_.size(), &row_crc, nullptr);
-    return static_cast<uint32_t>(row_crc); // CRC32 only uses the lower 32 bits.
-  }
-
-
-  faststring tmp_buf_;
-  crc::Crc* const crc_;
   uint64_t agg_checksum_;
   int64_t rows_checksummed_;
   faststring encoded_last_row_;
@@ -613,7 +837,12 @@ static size_t GetMaxBatchSizeBytesHint(const ScanRequestPB* req) {
 
 TabletServiceImpl::TabletServiceImpl(TabletServer* server)
   : TabletServerServiceIf(server->metric_entity(), server->result_tracker()),
-    server_(server) {
+    server_(server),
+    write_quota_manager_(server->metric_entity()) {
+  if (FLAGS_scan_result_cache_capacity_mb > 0) {
+    scan_result_cache_.reset(new ScanResultCache(
+        FLAGS_scan_result_cache_capacity_mb * 1024 * 1024, server->metric_entity()));
+  }
 }
 
 bool TabletServiceImpl::AuthorizeClientOrServiceUser(const google::protobuf::Message* /*req*/,
@@ -814,6 +1043,24 @@ void TabletServiceAdminImpl::DeleteTablet(const DeleteTabletRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceAdminImpl::DrainLeaders(const DrainLeadersRequestPB* req,
+                                          DrainLeadersResponsePB* resp,
+                                          rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "DrainLeaders", req, resp, context)) {
+    return;
+  }
+  TSTabletManager* tablet_manager = server_->tablet_manager();
+  if (tablet_manager->draining() != req->drain()) {
+    LOG(INFO) << "Processing DrainLeaders(drain=" << req->drain() << ") from "
+              << context->requestor_string();
+  }
+  tablet_manager->SetDraining(req->drain());
+  if (req->drain()) {
+    resp->set_num_leaders(tablet_manager->TransferLeaderships());
+  }
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Write(const WriteRequestPB* req,
                               WriteResponsePB* resp,
                               rpc::RpcContext* context) {
@@ -821,28 +1068,131 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
                "tablet_id", req->tablet_id());
   DVLOG(3) << "Received Write RPC: " << SecureDebugString(*req);
 
+  TabletServerErrorPB::Code error_code;
+  Status s = SubmitWrite(
+      req,
+      context->AreResultsTracked() ? context->request_id() : nullptr,
+      resp,
+      context,
+      gscoped_ptr<TransactionCompletionCallback>(
+          new RpcTransactionCompletionCallback<WriteResponsePB>(context, resp)),
+      &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+}
+
+void TabletServiceImpl::MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                                         MultiTabletWriteResponsePB* resp,
+                                         rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiTabletWrite",
+               "num_writes", req->writes_size());
+  DVLOG(3) << "Received Multi-Tablet Write RPC with " << req->writes_size() << " writes";
+
+  // All the responses are added up front: the writes complete concurrently.
+  resp->mutable_responses()->Reserve(req->writes_size());
+  for (int i = 0; i < req->writes_size(); i++) {
+    resp->add_responses();
+  }
+
+  // The pending count includes this handler, so that the RPC isn't responded
+  // to before all the writes are submitted.
+  MultiTabletWriteCompletion* completion =
+      new MultiTabletWriteCompletion(context, req->writes_size() + 1);
+  const scoped_refptr<ResultTracker>& result_tracker = server_->result_tracker();
+  for (int i = 0; i < req->writes_size(); i++) {
+    const auto& write = req->writes(i);
+    WriteResponsePB* write_resp = resp->mutable_responses(i);
+
+    const RequestIdPB* request_id = nullptr;
+    if (write.has_request_id()) {
+      ResultTracker::RpcState state = result_tracker->TrackRpc(write.request_id(),
+                                                               nullptr, nullptr);
+      if (PREDICT_FALSE(state != ResultTracker::RpcState::NEW)) {
+        // Another attempt of this write was already seen. Have the client retry
+        // it in a Write() RPC, which gets the tracked result of the write.
+        SetWriteError(write_resp,
+                      Status::ServiceUnavailable("Write already in progress or completed"),
+                      TabletServerErrorPB::UNKNOWN_ERROR);
+        completion->WriteCompleted();
+        continue;
+      }
+      request_id = &write.request_id();
+    }
+
+    TabletServerErrorPB::Code error_code;
+    Status s = SubmitWrite(
+        &write.request(),
+        request_id,
+        write_resp,
+        context,
+        gscoped_ptr<TransactionCompletionCallback>(
+            new MultiTabletWriteCompletionCallback(write_resp, request_id,
+                                                   result_tracker, completion)),
+        &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetWriteError(write_resp, s, error_code);
+      if (request_id) {
+        result_tracker->FailAndRespond(*request_id, write_resp);
+      }
+      completion->WriteCompleted();
+    }
+  }
+  completion->WriteCompleted();
+}
+
+Status TabletServiceImpl::SubmitWrite(
+    const WriteRequestPB* req,
+    const RequestIdPB* request_id,
+    WriteResponsePB* resp,
+    rpc::RpcContext* context,
+    gscoped_ptr<TransactionCompletionCallback> completion_callback,
+    TabletServerErrorPB::Code* error_code) {
   scoped_refptr<TabletReplica> replica;
-  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
-                                           context, &replica)) {
-    return;
+  Status s = server_->tablet_manager()->GetTabletReplica(req->tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  tablet::TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    return TabletNotRunningError(replica, state, error_code);
   }
 
   shared_ptr<Tablet> tablet;
-  TabletServerErrorPB::Code error_code;
-  Status s = GetTabletRef(replica, &tablet, &error_code);
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
-    return;
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
+
+  // The rows may be sent in sidecars, which the transaction decodes in place.
+  Slice rows_sidecar;
+  Slice indirect_data_sidecar;
+  const RowOperationsPB& row_ops = req->row_operations();
+  if (row_ops.has_rows_sidecar()) {
+    s = context->GetInboundSidecar(row_ops.rows_sidecar(), &rows_sidecar);
+    if (s.ok() && row_ops.has_indirect_data_sidecar()) {
+      s = context->GetInboundSidecar(row_ops.indirect_data_sidecar(), &indirect_data_sidecar);
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_MUTATION;
+      return s.CloneAndPrepend("Invalid row operations sidecar");
+    }
   }
 
-  uint64_t bytes = req->row_operations().rows().size() +
-      req->row_operations().indirect_data().size();
+  uint64_t bytes = row_ops.has_rows_sidecar() ?
+      rows_sidecar.size() + indirect_data_sidecar.size() :
+      row_ops.rows().size() + row_ops.indirect_data().size();
   if (!tablet->ShouldThrottleAllow(bytes)) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::ServiceUnavailable("Rejecting Write request: throttled"),
-                         TabletServerErrorPB::THROTTLED,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: throttled");
+  }
+
+  // Enforce the write quotas of the table and the user, leaving some time to
+  // apply the write before the client's deadline.
+  s = write_quota_manager_.AdmitWrite(
+      replica->tablet_metadata()->table_id(), context->remote_user().username(), bytes,
+      context->GetClientDeadline() - MonoDelta::FromMilliseconds(10));
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return s;
   }
 
   // Check for memory pressure; don't bother doing any additional work if we've
@@ -858,53 +1208,47 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
-    SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::ServiceUnavailable(msg);
   }
 
   if (!server_->clock()->SupportsExternalConsistencyMode(req->external_consistency_mode())) {
-    Status s = Status::NotSupported("The configured clock does not support the"
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::NotSupported("The configured clock does not support the"
         " required consistency mode.");
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
   }
 
   unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
       replica.get(),
       req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
+      request_id,
       resp));
+  if (row_ops.has_rows_sidecar()) {
+    tx_state->set_row_operations_sidecars(rows_sidecar, indirect_data_sidecar);
+  }
 
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
   if (req->has_propagated_timestamp()) {
     Timestamp ts(req->propagated_timestamp());
     s = server_->clock()->Update(ts);
-  }
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
   }
 
-  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
-      new RpcTransactionCompletionCallback<WriteResponsePB>(context,
-                                                            resp)));
+  tx_state->set_completion_callback(std::move(completion_callback));
 
   // Submit the write. The RPC will be responded to asynchronously.
   s = replica->SubmitWrite(std::move(tx_state));
 
   // Check that we could submit the write
   if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return s;
   }
+  return Status::OK();
 }
 
 ConsensusServiceImpl::ConsensusServiceImpl(ServerBase* server,
@@ -923,6 +1267,82 @@ bool ConsensusServiceImpl::AuthorizeServiceUser(const google::protobuf::Message*
   return server_->Authorize(rpc, ServerBase::SUPER_USER | ServerBase::SERVICE_USER);
 }
 
+namespace {
+
+// Sets 'out' to a copy of 'req' whose ops are decoded from the sidecar which
+// carries them. See ConsensusRequestPB::ops_sidecar_idx.
+Status DecodeOpsFromSidecar(const ConsensusRequestPB& req,
+                            RpcContext* context,
+                            ConsensusRequestPB* out) {
+  Slice sidecar;
+  RETURN_NOT_OK(context->GetInboundSidecar(req.ops_sidecar_idx(), &sidecar));
+  // The sidecar only holds the 'ops' field, so it doesn't parse as a complete
+  // request on its own.
+  ConsensusRequestPB ops;
+  if (!ops.ParsePartialFromArray(sidecar.data(), sidecar.size())) {
+    return Status::Corruption("unable to parse the ops sidecar");
+  }
+  *out = req;
+  out->clear_ops_sidecar_idx();
+  out->mutable_ops()->Swap(ops.mutable_ops());
+  if (!out->IsInitialized()) {
+    return Status::Corruption("invalid ops in sidecar", out->InitializationErrorString());
+  }
+  return Status::OK();
+}
+
+// Applies 'req', one of the requests of a MultiRaftUpdateConsensus() RPC, to
+// its tablet replica. Errors which UpdateConsensus() would respond with are
+// set in 'resp' instead.
+void UpdateConsensusInBatch(TabletReplicaLookupIf* tablet_manager,
+                            const ConsensusRequestPB& req,
+                            ConsensusResponsePB* resp) {
+  const auto set_error = [resp](const Status& s, TabletServerErrorPB::Code code) {
+    resp->Clear();
+    StatusToPB(s, resp->mutable_error()->mutable_status());
+    resp->mutable_error()->set_code(code);
+  };
+  const string& local_uuid = tablet_manager->NodeInstance().permanent_uuid();
+  if (PREDICT_FALSE(req.has_dest_uuid() && req.dest_uuid() != local_uuid)) {
+    set_error(Status::InvalidArgument(Substitute(
+                  "MultiRaftUpdateConsensus: Wrong destination UUID requested. "
+                  "Local UUID: $0. Requested UUID: $1", local_uuid, req.dest_uuid())),
+              TabletServerErrorPB::WRONG_SERVER_UUID);
+    return;
+  }
+  if (PREDICT_FALSE(req.has_ops_sidecar_idx())) {
+    set_error(Status::InvalidArgument("batched requests may not carry ops in a sidecar"),
+              TabletServerErrorPB::UNKNOWN_ERROR);
+    return;
+  }
+  scoped_refptr<TabletReplica> replica;
+  Status s = tablet_manager->GetTabletReplica(req.tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    set_error(s, TabletServerErrorPB::TABLET_NOT_FOUND);
+    return;
+  }
+  tablet::TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    TabletServerErrorPB::Code error_code;
+    s = TabletNotRunningError(replica, state, &error_code);
+    set_error(s, error_code);
+    return;
+  }
+  shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  if (PREDICT_FALSE(!consensus)) {
+    set_error(Status::ServiceUnavailable("Raft Consensus unavailable",
+                                         "Tablet replica not initialized"),
+              TabletServerErrorPB::TABLET_NOT_RUNNING);
+    return;
+  }
+  s = consensus->Update(&req, resp);
+  if (PREDICT_FALSE(!s.ok())) {
+    set_error(s, TabletServerErrorPB::UNKNOWN_ERROR);
+  }
+}
+
+} // anonymous namespace
+
 void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
                                            ConsensusResponsePB* resp,
                                            rpc::RpcContext* context) {
@@ -936,6 +1356,19 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
     return;
   }
 
+  // The leader may send the ops in a sidecar, see --consensus_encode_ops_once.
+  ConsensusRequestPB req_with_ops;
+  if (req->has_ops_sidecar_idx()) {
+    Status s = DecodeOpsFromSidecar(*req, context, &req_with_ops);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s,
+                           TabletServerErrorPB::UNKNOWN_ERROR,
+                           context);
+      return;
+    }
+    req = &req_with_ops;
+  }
+
   // Submit the update directly to the TabletReplica's RaftConsensus instance.
   shared_ptr<RaftConsensus> consensus;
   if (!GetConsensusOrRespond(replica, resp, context, &consensus)) return;
@@ -954,6 +1387,17 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+void ConsensusServiceImpl::MultiRaftUpdateConsensus(const MultiRaftConsensusRequestPB* req,
+                                                    MultiRaftConsensusResponsePB* resp,
+                                                    rpc::RpcContext* context) {
+  DVLOG(3) << "Received Multi-Raft Consensus Update RPC with "
+           << req->consensus_requests_size() << " requests";
+  for (const auto& consensus_req : req->consensus_requests()) {
+    UpdateConsensusInBatch(tablet_manager_, consensus_req, resp->add_consensus_responses());
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -1263,12 +1707,65 @@ void TabletServiceImpl::ScannerKeepAlive(const ScannerKeepAliveRequestPB *req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::MultiScannerKeepAlive(const MultiScannerKeepAliveRequestPB* req,
+                                              MultiScannerKeepAliveResponsePB* resp,
+                                              rpc::RpcContext* context) {
+  // Each scanner is handled exactly as in ScannerKeepAlive(), with its
+  // outcome reported in the response slot matching its position in the
+  // request. A missing scanner doesn't fail the others.
+  for (const auto& scanner_id : req->scanner_ids()) {
+    ScannerKeepAliveResponsePB* scanner_resp = resp->add_responses();
+    SharedScanner scanner;
+    if (!server_->scanner_manager()->LookupScanner(scanner_id, &scanner)) {
+      scanner_resp->mutable_error()->set_code(TabletServerErrorPB::SCANNER_EXPIRED);
+      StatusToPB(Status::NotFound("Scanner not found"),
+                 scanner_resp->mutable_error()->mutable_status());
+      continue;
+    }
+    scanner->UpdateAccessTime();
+  }
+  context->RespondSuccess();
+}
+
 namespace {
 void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
   metrics->set_cfile_cache_miss_bytes(
     context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
   metrics->set_cfile_cache_hit_bytes(
     context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+  const MonoTime time_handled = context->GetTimeHandled();
+  if (time_handled.Initialized()) {
+    metrics->set_queue_duration_nanos(
+        (time_handled - context->GetTimeReceived()).ToNanoseconds());
+  }
+  metrics->set_cells_read(context->trace()->metrics()->GetMetric(kScanCellsReadCounterName));
+  metrics->set_bytes_read(context->trace()->metrics()->GetMetric(kScanBytesReadCounterName));
+  metrics->set_blocks_read(context->trace()->metrics()->GetMetric(kScanBlocksReadCounterName));
+}
+
+// Moves the columns of 'batch' into sidecars of 'context', recording their
+// indices in 'pb'.
+void SetColumnarSidecars(ColumnarSerializedBatch* batch,
+                         ColumnarRowBlockPB* pb,
+                         rpc::RpcContext* context) {
+  pb->set_num_rows(batch->num_rows);
+  for (auto& col : batch->columns) {
+    ColumnarRowBlockPB::Column* col_pb = pb->add_columns();
+    int idx;
+    CHECK_OK(context->AddOutboundSidecar(
+        RpcSidecar::FromFaststring(std::move(col.data)), &idx));
+    col_pb->set_data_sidecar(idx);
+    if (col.varlen_data) {
+      CHECK_OK(context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(col.varlen_data)), &idx));
+      col_pb->set_varlen_data_sidecar(idx);
+    }
+    if (col.non_null_bitmap) {
+      CHECK_OK(context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(col.non_null_bitmap)), &idx));
+      col_pb->set_non_null_bitmap_sidecar(idx);
+    }
+  }
 }
 } // anonymous namespace
 
@@ -1285,7 +1782,28 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
 
+  // Admit the batch against the scanners' memory budget, which may shrink it.
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
+  size_t admitted_bytes;
+  Status admit_status = server_->scanner_manager()->AdmitBatch(batch_size_bytes,
+                                                               &admitted_bytes);
+  if (PREDICT_FALSE(!admit_status.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), admit_status,
+                         TabletServerErrorPB::THROTTLED, context);
+    return;
+  }
+  SCOPED_CLEANUP({
+    server_->scanner_manager()->ReleaseBatch(admitted_bytes);
+  });
+  ScanRequestPB shrunk_req;
+  if (admitted_bytes < batch_size_bytes) {
+    TRACE("Shrinking the batch to $0 bytes", admitted_bytes);
+    shrunk_req = *req;
+    shrunk_req.set_batch_size_bytes(admitted_bytes);
+    req = &shrunk_req;
+    batch_size_bytes = admitted_bytes;
+  }
+
   unique_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
   unique_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
   RowwiseRowBlockPB data;
@@ -1293,6 +1811,8 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
 
   bool has_more_results = false;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  // The key to cache the result of the scan under, if it's cacheable.
+  string cache_key;
   if (req->has_new_scan_request()) {
     const NewScanRequestPB& scan_pb = req->new_scan_request();
     scoped_refptr<TabletReplica> replica;
@@ -1300,6 +1820,28 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
                                              context, &replica)) {
       return;
     }
+
+    // A scan with a zero batch size expects an empty first batch, so only
+    // cache the scans asking for rows right away.
+    if (scan_result_cache_ && batch_size_bytes > 0 &&
+        ScanResultCache::IsCacheable(scan_pb)) {
+      cache_key = ScanResultCache::MakeKey(replica->tablet_metadata()->schema_version(),
+                                           scan_pb);
+      ScanResultCache::Result cached;
+      if (scan_result_cache_->Get(cache_key, &cached)) {
+        Status s = HandleCachedScanRequest(replica.get(), scan_pb, &cached, resp, context,
+                                           &error_code);
+        if (PREDICT_FALSE(!s.ok())) {
+          SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+          return;
+        }
+        resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+        SetResourceMetrics(resp->mutable_resource_metrics(), context);
+        context->RespondSuccess();
+        return;
+      }
+    }
+
     string scanner_id;
     Timestamp scan_timestamp;
     Status s = HandleNewScanRequest(replica.get(), req, context,
@@ -1317,6 +1859,9 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     if (scan_timestamp != Timestamp::kInvalidTimestamp) {
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
+    if (scan_pb.has_sample_percent()) {
+      resp->set_sample_percent(scan_pb.sample_percent());
+    }
   } else if (req->has_scanner_id()) {
     Status s = HandleContinueScanRequest(req, &collector, &has_more_results, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
@@ -1330,20 +1875,32 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
   resp->set_has_more_results(has_more_results);
 
-  resp->mutable_data()->CopyFrom(data);
+  if (collector.aggregating()) {
+    collector.AggregateResultsToPB(resp->mutable_aggregate_results());
+  } else if (collector.columnar_layout()) {
+    SetColumnarSidecars(collector.columnar_batch(), resp->mutable_columnar_data(), context);
+  } else {
+    resp->mutable_data()->CopyFrom(data);
 
-  // Add sidecar data to context and record the returned indices.
-  int rows_idx;
-  CHECK_OK(context->AddOutboundSidecar(
-      RpcSidecar::FromFaststring((std::move(rows_data))), &rows_idx));
-  resp->mutable_data()->set_rows_sidecar(rows_idx);
+    // Cache the result if the whole scan fit into this batch.
+    if (!cache_key.empty() && !has_more_results) {
+      scan_result_cache_->Put(cache_key, data.num_rows(), *rows_data, *indirect_data,
+                              collector.last_primary_key());
+    }
 
-  // Add indirect data as a sidecar, if applicable.
-  if (indirect_data->size() > 0) {
-    int indirect_idx;
+    // Add sidecar data to context and record the returned indices.
+    int rows_idx;
     CHECK_OK(context->AddOutboundSidecar(
-        RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
-    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+        RpcSidecar::FromFaststring((std::move(rows_data))), &rows_idx));
+    resp->mutable_data()->set_rows_sidecar(rows_idx);
+
+    // Add indirect data as a sidecar, if applicable.
+    if (indirect_data->size() > 0) {
+      int indirect_idx;
+      CHECK_OK(context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
+      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+    }
   }
 
   // Set the last row found by the collector.
@@ -1359,6 +1916,136 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::Get(const GetRequestPB* req,
+                            GetResponsePB* resp,
+                            rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::Get",
+               "tablet_id", req->tablet_id());
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
+                                           context, &replica)) {
+    return;
+  }
+
+  Schema projection;
+  Status s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_TRUE(s.ok()) && projection.has_column_ids()) {
+    s = Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::INVALID_SCHEMA, context);
+    return;
+  }
+
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  vector<Slice> keys(req->encoded_primary_keys().begin(), req->encoded_primary_keys().end());
+  Arena arena(32 * 1024);
+  RowBlock block(projection, keys.size(), &arena);
+  s = tablet->GetRows(projection, keys, &block);
+  if (PREDICT_FALSE(!s.ok())) {
+    // Both a projection and keys which can't be decoded mean that the
+    // request doesn't match the tablet's schema.
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         s.IsInvalidArgument() ? TabletServerErrorPB::MISMATCHED_SCHEMA
+                                               : TabletServerErrorPB::UNKNOWN_ERROR,
+                         context);
+    return;
+  }
+  for (int i = 0; i < keys.size(); i++) {
+    if (block.selection_vector()->IsRowSelected(i)) {
+      resp->add_key_indexes(i);
+    }
+  }
+
+  unique_ptr<faststring> rows_data(new faststring());
+  unique_ptr<faststring> indirect_data(new faststring());
+  SerializeRowBlock(block, resp->mutable_data(), &projection,
+                    rows_data.get(), indirect_data.get());
+  int rows_idx;
+  CHECK_OK(context->AddOutboundSidecar(
+      RpcSidecar::FromFaststring(std::move(rows_data)), &rows_idx));
+  resp->mutable_data()->set_rows_sidecar(rows_idx);
+  if (indirect_data->size() > 0) {
+    int indirect_idx;
+    CHECK_OK(context->AddOutboundSidecar(
+        RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
+    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  }
+
+  resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+  SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::GetColumnStats(const GetColumnStatsRequestPB* req,
+                                       GetColumnStatsResponsePB* resp,
+                                       rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::GetColumnStats",
+               "tablet_id", req->tablet_id());
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
+                                           context, &replica)) {
+    return;
+  }
+
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  const Schema& schema = *tablet->schema();
+  vector<ColumnId> col_ids;
+  vector<string> col_names;
+  if (req->column_names().empty()) {
+    for (int i = 0; i < schema.num_columns(); i++) {
+      col_ids.push_back(schema.column_id(i));
+      col_names.push_back(schema.column(i).name());
+    }
+  } else {
+    for (const string& name : req->column_names()) {
+      const int idx = schema.find_column(name);
+      if (idx == Schema::kColumnNotFound) {
+        SetupErrorAndRespond(resp->mutable_error(),
+                             Status::InvalidArgument("Unknown column", name),
+                             TabletServerErrorPB::MISMATCHED_SCHEMA, context);
+        return;
+      }
+      col_ids.push_back(schema.column_id(idx));
+      col_names.push_back(name);
+    }
+  }
+
+  vector<ColumnStatsPB> stats;
+  s = tablet->GetColumnStats(col_ids, &stats);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  for (int i = 0; i < col_ids.size(); i++) {
+    auto* entry = resp->add_columns();
+    entry->set_column_name(col_names[i]);
+    if (!stats[i].has_num_values()) {
+      continue;
+    }
+    const int64_t ndv = cfile::EstimateDistinctValues(stats[i]);
+    if (ndv >= 0) {
+      entry->set_estimated_distinct_values(ndv);
+    }
+    entry->mutable_stats()->Swap(&stats[i]);
+  }
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::ListTablets(const ListTabletsRequestPB* req,
                                     ListTabletsResponsePB* resp,
                                     rpc::RpcContext* context) {
@@ -1449,6 +2136,12 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case TabletServerFeatures::COLUMN_PREDICATES:
     case TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE:
+    case TabletServerFeatures::AGGREGATE_PUSHDOWN:
+    case TabletServerFeatures::ROW_OPERATIONS_SIDECARS:
+    case TabletServerFeatures::POINT_LOOKUPS:
+    case TabletServerFeatures::COLUMN_STATS:
+    case TabletServerFeatures::TOP_N:
       return true;
     default:
       return false;
@@ -1559,6 +2252,22 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     ret->AddPredicate(std::move(*predicate));
   }
 
+  // Then the row TTL, which is enforced as a lower bound on the TTL column:
+  // beyond filtering out the expired rows, this lets the rowsets and blocks
+  // holding only expired rows be skipped by their zone maps.
+  const int ttl_col_idx = tablet_schema.find_ttl_column();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    const ColumnSchema& ttl_col = tablet_schema.column(ttl_col_idx);
+    int64_t* cutoff = scanner->arena()->NewObject<int64_t>(
+        GetCurrentTimeMicros() - ttl_col.attributes().ttl_seconds * 1000000);
+    if (projection.find_column(ttl_col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, ttl_col.name())) {
+      InsertOrDie(&missing_col_names, ttl_col.name());
+      missing_cols->push_back(ttl_col);
+    }
+    ret->AddPredicate(ColumnPredicate::Range(ttl_col, cutoff, nullptr));
+  }
+
   // Then the column range predicates.
   // TODO: remove this once all clients have moved to ColumnPredicatePB and
   // backwards compatibility can be broken.
@@ -1642,8 +2351,63 @@ Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp tim
   }
   return Status::OK();
 }
+
+// Deselects the selected rows of 'sel' past the first 'max_rows' of them.
+// Returns the number of rows left selected.
+int64_t LimitSelectedRows(int64_t max_rows, SelectionVector* sel) {
+  int64_t num_selected = 0;
+  for (size_t i = 0; i < sel->nrows(); i++) {
+    if (!sel->IsRowSelected(i)) {
+      continue;
+    }
+    if (num_selected == max_rows) {
+      sel->SetRowUnselected(i);
+    } else {
+      num_selected++;
+    }
+  }
+  return num_selected;
+}
 } // anonymous namespace
 
+Status TabletServiceImpl::HandleCachedScanRequest(TabletReplica* replica,
+                                                  const NewScanRequestPB& scan_pb,
+                                                  ScanResultCache::Result* result,
+                                                  ScanResponsePB* resp,
+                                                  RpcContext* rpc_context,
+                                                  TabletServerErrorPB::Code* error_code) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::HandleCachedScanRequest",
+               "tablet_id", scan_pb.tablet_id());
+  // The cached rows are those at the snapshot, which must still be readable.
+  shared_ptr<Tablet> tablet;
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
+  const Timestamp snap_timestamp(scan_pb.snap_timestamp());
+  Status s = VerifyNotAncientHistory(tablet.get(), scan_pb.read_mode(), snap_timestamp);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
+    return s;
+  }
+  TRACE("Found the scan result in the cache");
+
+  resp->set_has_more_results(false);
+  resp->set_snap_timestamp(snap_timestamp.ToUint64());
+  resp->mutable_data()->set_num_rows(result->num_rows);
+  int rows_idx;
+  RETURN_NOT_OK(rpc_context->AddOutboundSidecar(
+      RpcSidecar::FromFaststring(std::move(result->rows_data)), &rows_idx));
+  resp->mutable_data()->set_rows_sidecar(rows_idx);
+  if (result->indirect_data->size() > 0) {
+    int indirect_idx;
+    RETURN_NOT_OK(rpc_context->AddOutboundSidecar(
+        RpcSidecar::FromFaststring(std::move(result->indirect_data)), &indirect_idx));
+    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  }
+  if (!result->last_primary_key.empty()) {
+    resp->set_last_primary_key(result->last_primary_key);
+  }
+  return Status::OK();
+}
+
 // Start a new scan.
 Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
                                                const ScanRequestPB* req,
@@ -1662,6 +2426,13 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
 
   const Schema& tablet_schema = replica->tablet_metadata()->schema();
 
+  if ((scan_pb.row_format_flags() & RowFormatFlags::COLUMNAR_LAYOUT) &&
+      (scan_pb.row_format_flags() & ~static_cast<uint64_t>(RowFormatFlags::COLUMNAR_LAYOUT))) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument("COLUMNAR_LAYOUT may not be combined with other "
+                                   "row format flags");
+  }
+
   SharedScanner scanner;
   server_->scanner_manager()->NewScanner(replica,
                                          rpc_context->requestor_string(),
@@ -1686,6 +2457,39 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return Status::InvalidArgument("User requests should not have Column IDs");
   }
 
+  if (scan_pb.has_top_n()) {
+    const TopNPB& top_n = scan_pb.top_n();
+    if (!scan_pb.has_limit() || scan_pb.order_mode() == ORDERED ||
+        scan_pb.aggregates_size() > 0) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "Top-N scans require a limit, and may not be ordered or aggregating");
+    }
+    if (scan_pb.limit() > static_cast<uint64_t>(FLAGS_scanner_max_top_n_rows)) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          Substitute("Top-N scans may return at most $0 rows", FLAGS_scanner_max_top_n_rows));
+    }
+    if (top_n.projection_idx() < 0 || top_n.projection_idx() >= projection.num_columns()) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          Substitute("Invalid top-N column index $0", top_n.projection_idx()));
+    }
+  }
+
+  if (scan_pb.aggregates_size() > 0) {
+    // Set up the aggregator now so that even scans which short-circuit below
+    // respond with (empty) aggregate results.
+    unique_ptr<ScanAggregator> aggregator;
+    s = ScanAggregator::Create(scan_pb.aggregates(), projection, &aggregator);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+    scanner->set_aggregates(scan_pb.aggregates());
+    result_collector->set_aggregator(std::move(aggregator));
+  }
+
   if (scan_pb.order_mode() == ORDERED) {
     // Ordered scans must be at a snapshot so that we perform a serializable read (which can be
     // resumed). Otherwise, this would be read committed isolation, which is not resumable.
@@ -1695,6 +2499,21 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     }
   }
 
+  if (scan_pb.has_diff_scan_start_timestamp() &&
+      (scan_pb.read_mode() != READ_AT_SNAPSHOT || scan_pb.order_mode() == ORDERED)) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument("Diff scans must be unordered snapshot reads");
+  }
+
+  if (scan_pb.has_sample_percent() &&
+      (!(scan_pb.sample_percent() > 0 && scan_pb.sample_percent() <= 100) ||
+       scan_pb.has_diff_scan_start_timestamp())) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument(
+        Substitute("Invalid sample percent $0: must be in (0, 100], and not for a diff scan",
+                   scan_pb.sample_percent()));
+  }
+
   gscoped_ptr<ScanSpec> spec(new ScanSpec);
 
   // Missing columns will contain the columns that are not mentioned in the client
@@ -1707,6 +2526,10 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
+  if (scan_pb.has_sample_percent()) {
+    spec->set_sample(ScanSample(scan_pb.sample_percent() / 100, scan_pb.sample_seed()));
+  }
+
   VLOG(3) << "Before optimizing scan spec: " << spec->ToString(tablet_schema);
   spec->OptimizeScan(tablet_schema, scanner->arena(), scanner->autorelease_pool(), true);
   VLOG(3) << "After optimizing scan spec: " << spec->ToString(tablet_schema);
@@ -1752,7 +2575,9 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
         return s;
       }
       case READ_LATEST: {
-        s = tablet->NewRowIterator(projection, &iter);
+        tablet::MvccSnapshot snap(*tablet->mvcc_manager());
+        s = tablet->NewRowIterator(projection, snap, UNORDERED, &iter,
+                                   server_->scanner_manager()->scan_pool());
         break;
       }
       case READ_YOUR_WRITES: // Fallthrough intended
@@ -1775,6 +2600,15 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     }
   }
 
+  // The projection starts with the client's columns, so the top-N column is
+  // at the same index in the iterator's schema.
+  if (PREDICT_TRUE(s.ok()) && scan_pb.has_top_n()) {
+    iter.reset(new TopNIterator(shared_ptr<RowwiseIterator>(iter.release()),
+                                scan_pb.top_n().projection_idx(),
+                                scan_pb.top_n().descending(),
+                                scan_pb.limit()));
+  }
+
   // Make a copy of the optimized spec before it's passed to the iterator.
   // This copy will be given to the Scanner so it can report its predicates to
   // /scans. The copy is necessary because the original spec will be modified
@@ -1834,7 +2668,13 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
-  *has_more_results = iter->HasNext();
+  // The limit of aggregating scans applies to the aggregated rows, and is
+  // left to the client.
+  if (scan_pb.has_limit() && scan_pb.aggregates_size() == 0) {
+    scanner->set_rows_left(std::min<uint64_t>(scan_pb.limit(), kint64max));
+  }
+
+  *has_more_results = iter->HasNext() && scanner->rows_left() != 0;
   TRACE("has_more: $0", *has_more_results);
   if (!*has_more_results) {
     // If there are no more rows, we can short circuit some work and respond immediately.
@@ -1893,6 +2733,20 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   // Set the row format flags on the ScanResultCollector.
   result_collector->set_row_format_flags(scanner->row_format_flags());
 
+  // Aggregating scans return partial results for the rows scanned by each
+  // request, so each request gets a fresh aggregator.
+  if (scanner->aggregates().size() > 0) {
+    unique_ptr<ScanAggregator> aggregator;
+    Status s = ScanAggregator::Create(scanner->aggregates(),
+                                      *scanner->client_projection_schema(),
+                                      &aggregator);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+    result_collector->set_aggregator(std::move(aggregator));
+  }
+
   // If we early-exit out of this function, automatically unregister the scanner.
   ScopedUnregisterScanner unreg_scanner(server_->scanner_manager(), scanner->id());
 
@@ -1926,8 +2780,19 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   int budget_ms = 500;
   MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
 
+  // The CPU time and the cfile cache misses of this call are charged to the
+  // scanner and its tablet.
+  Trace* trace = Trace::CurrentTrace();
+  const int64_t cache_miss_bytes_before = trace ?
+      trace->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME) : 0;
+  Stopwatch sw(Stopwatch::THIS_THREAD);
+  sw.start();
+
+  // Scans with a limit stop as soon as it's reached, so that scans in key
+  // order read no more rows than they return.
+  int64_t rows_left = scanner->rows_left();
   int64_t rows_scanned = 0;
-  while (iter->HasNext()) {
+  while (rows_left != 0 && iter->HasNext()) {
     if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
     }
@@ -1945,6 +2810,9 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       // The collector will separately count the number of rows actually returned to
       // the client.
       rows_scanned += block.nrows();
+      if (rows_left > 0) {
+        rows_left -= LimitSelectedRows(rows_left, block.selection_vector());
+      }
       result_collector->HandleRowBlock(scanner->client_projection_schema(), block);
     }
 
@@ -1966,6 +2834,14 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     }
   }
 
+  sw.stop();
+  const CpuTimes cpu = sw.elapsed();
+  const int64_t cpu_time_us = (cpu.user + cpu.system) / 1000;
+  const int64_t cache_miss_bytes = trace ?
+      trace->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME) -
+      cache_miss_bytes_before : 0;
+  scanner->AddResourceUsage(cpu_time_us, cache_miss_bytes);
+
   scoped_refptr<TabletReplica> replica = scanner->tablet_replica();
   shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code tablet_ref_error_code;
@@ -2002,15 +2878,21 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
 
   IteratorStats delta_stats = total_stats - scanner->already_reported_stats();
   scanner->set_already_reported_stats(total_stats);
+  TRACE_COUNTER_INCREMENT(kScanCellsReadCounterName, delta_stats.cells_read);
+  TRACE_COUNTER_INCREMENT(kScanBytesReadCounterName, delta_stats.bytes_read);
+  TRACE_COUNTER_INCREMENT(kScanBlocksReadCounterName, delta_stats.blocks_read);
 
   if (tablet) {
     tablet->metrics()->scanner_rows_scanned->IncrementBy(rows_scanned);
     tablet->metrics()->scanner_cells_scanned_from_disk->IncrementBy(delta_stats.cells_read);
     tablet->metrics()->scanner_bytes_scanned_from_disk->IncrementBy(delta_stats.bytes_read);
+    tablet->metrics()->scanner_cpu_time_us->IncrementBy(cpu_time_us);
+    tablet->metrics()->scanner_cfile_cache_miss_bytes->IncrementBy(cache_miss_bytes);
   }
 
+  scanner->set_rows_left(rows_left);
   scanner->UpdateAccessTime();
-  *has_more_results = !req->close_scanner() && iter->HasNext();
+  *has_more_results = !req->close_scanner() && rows_left != 0 && iter->HasNext();
   if (*has_more_results) {
     unreg_scanner.Cancel();
   } else {
@@ -2095,7 +2977,19 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   if (scan_pb.order_mode() == UNKNOWN_ORDER_MODE) {
     return Status::InvalidArgument("Unknown order mode specified");
   }
-  RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, scan_pb.order_mode(), iter));
+  if (scan_pb.has_diff_scan_start_timestamp()) {
+    Timestamp start(scan_pb.diff_scan_start_timestamp());
+    if (start > tmp_snap_timestamp) {
+      return Status::InvalidArgument(
+          Substitute("Diff scan start timestamp $0 is later than the snapshot timestamp $1",
+                     start.ToString(), tmp_snap_timestamp.ToString()));
+    }
+    RETURN_NOT_OK(VerifyNotAncientHistory(tablet, scan_pb.read_mode(), start));
+    RETURN_NOT_OK(tablet->NewDiffScanIterator(projection, start, tmp_snap_timestamp, iter));
+  } else {
+    RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, scan_pb.order_mode(), iter,
+                                         server_->scanner_manager()->scan_pool()));
+  }
 
   // Return the picked snapshot timestamp for both READ_AT_SNAPSHOT
   // and READ_YOUR_WRITES mode.
@@ -23,9 +23,11 @@
 #include "kudu/consensus/consensus.service.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.service.h"
 #include "kudu/tserver/tserver_service.service.h"
+#include "kudu/tserver/write_quota_manager.h"
 
 namespace google {
 namespace protobuf {
@@ -70,12 +72,14 @@ class VoteResponsePB;
 } // namespace consensus
 
 namespace rpc {
+class RequestIdPB;
 class RpcContext;
 } // namespace rpc
 
 namespace tablet {
 class Tablet;
 class TabletReplica;
+class TransactionCompletionCallback;
 } // namespace tablet
 
 namespace tserver {
@@ -88,6 +92,8 @@ class CreateTabletRequestPB;
 class CreateTabletResponsePB;
 class DeleteTabletRequestPB;
 class DeleteTabletResponsePB;
+class DrainLeadersRequestPB;
+class DrainLeadersResponsePB;
 class ScanResultCollector;
 class TabletReplicaLookupIf;
 class TabletServer;
@@ -111,6 +117,10 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Write(const WriteRequestPB* req, WriteResponsePB* resp,
                    rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                                MultiTabletWriteResponsePB* resp,
+                                rpc::RpcContext* context) OVERRIDE;
+
   virtual void Scan(const ScanRequestPB* req,
                     ScanResponsePB* resp,
                     rpc::RpcContext* context) OVERRIDE;
@@ -119,6 +129,18 @@ class TabletServiceImpl : public TabletServerServiceIf {
                                 ScannerKeepAliveResponsePB *resp,
                                 rpc::RpcContext *context) OVERRIDE;
 
+  virtual void MultiScannerKeepAlive(const MultiScannerKeepAliveRequestPB* req,
+                                     MultiScannerKeepAliveResponsePB* resp,
+                                     rpc::RpcContext* context) OVERRIDE;
+
+  virtual void Get(const GetRequestPB* req,
+                   GetResponsePB* resp,
+                   rpc::RpcContext* context) OVERRIDE;
+
+  virtual void GetColumnStats(const GetColumnStatsRequestPB* req,
+                              GetColumnStatsResponsePB* resp,
+                              rpc::RpcContext* context) OVERRIDE;
+
   virtual void ListTablets(const ListTabletsRequestPB* req,
                            ListTabletsResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
@@ -132,6 +154,19 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Validates 'req', one write of the RPC of 'context', and submits it to its
+  // tablet replica. The result of the write is tracked under 'request_id',
+  // if set. 'completion_callback' is called once the write completes.
+  //
+  // If the write can't be submitted, returns the error and sets 'error_code',
+  // and 'completion_callback' is never called.
+  Status SubmitWrite(const WriteRequestPB* req,
+                     const rpc::RequestIdPB* request_id,
+                     WriteResponsePB* resp,
+                     rpc::RpcContext* context,
+                     gscoped_ptr<tablet::TransactionCompletionCallback> completion_callback,
+                     TabletServerErrorPB::Code* error_code);
+
   Status HandleNewScanRequest(tablet::TabletReplica* tablet_replica,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
@@ -141,6 +176,15 @@ class TabletServiceImpl : public TabletServerServiceIf {
                               bool* has_more_results,
                               TabletServerErrorPB::Code* error_code);
 
+  // Fills in 'resp' and the sidecars of 'rpc_context' with 'result', the
+  // cached result of the new scan of 'tablet_replica' requested by 'scan_pb'.
+  Status HandleCachedScanRequest(tablet::TabletReplica* tablet_replica,
+                                 const NewScanRequestPB& scan_pb,
+                                 ScanResultCache::Result* result,
+                                 ScanResponsePB* resp,
+                                 rpc::RpcContext* rpc_context,
+                                 TabletServerErrorPB::Code* error_code);
+
   Status HandleContinueScanRequest(const ScanRequestPB* req,
                                    ScanResultCollector* result_collector,
                                    bool* has_more_results,
@@ -166,6 +210,11 @@ class TabletServiceImpl : public TabletServerServiceIf {
                                 Timestamp* snap_timestamp);
 
   TabletServer* server_;
+
+  // Caches the results of repeated snapshot scans, or null if disabled.
+  gscoped_ptr<ScanResultCache> scan_result_cache_;
+
+  WriteQuotaManager write_quota_manager_;
 };
 
 class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
@@ -188,6 +237,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                            AlterSchemaResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  void DrainLeaders(const DrainLeadersRequestPB* req,
+                    DrainLeadersResponsePB* resp,
+                    rpc::RpcContext* context) override;
+
  private:
   TabletServer* server_;
 };
@@ -207,6 +260,10 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                                consensus::ConsensusResponsePB* resp,
                                rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiRaftUpdateConsensus(const consensus::MultiRaftConsensusRequestPB* req,
+                                        consensus::MultiRaftConsensusResponsePB* resp,
+                                        rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -38,10 +39,12 @@
 #include "kudu/master/master.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet-harness.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
@@ -58,6 +61,10 @@
 using std::string;
 using std::vector;
 
+DECLARE_string(tablet_bootstrap_priority_tables);
+
+METRIC_DECLARE_gauge_int64(startup_wal_bytes_remaining);
+
 namespace kudu {
 
 class FsManager;
@@ -168,6 +175,54 @@ TEST_F(TsTabletManagerTest, TestCreateTablet) {
   ASSERT_EQ(kTabletId, replica->tablet()->tablet_id());
 }
 
+TEST_F(TsTabletManagerTest, TestTabletLoadStats) {
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_OK(CreateNewTablet(kTabletId, schema_, &replica));
+
+  // The first statistics of a replica carry no rates.
+  vector<master::TabletLoadStatsPB> stats;
+  tablet_manager_->GetTabletLoadStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_EQ(kTabletId, stats[0].tablet_id());
+  ASSERT_GT(stats[0].on_disk_size(), 0);
+  ASSERT_FALSE(stats[0].has_rows_written_per_sec());
+
+  // The next ones carry the rates since the previous ones.
+  replica->tablet()->metrics()->rows_inserted->IncrementBy(100);
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  stats.clear();
+  tablet_manager_->GetTabletLoadStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_GT(stats[0].rows_written_per_sec(), 0);
+  ASSERT_EQ(0, stats[0].rows_scanned_per_sec());
+}
+
+TEST_F(TsTabletManagerTest, TestStartupOrdering) {
+  const string kOtherTabletId = "other-tablet-id";
+  ASSERT_OK(CreateNewTablet(kTabletId, schema_, nullptr));
+  ASSERT_OK(CreateNewTablet(kOtherTabletId, schema_, nullptr));
+
+  // Restart with one of the tables marked as a priority. Both tablets should
+  // still be opened, after which no WAL remains to be replayed.
+  FLAGS_tablet_bootstrap_priority_tables = kOtherTabletId;
+  mini_server_->Shutdown();
+  mini_server_.reset(new MiniTabletServer(GetTestPath("TsTabletManagerTest-fsroot"),
+                                          HostPort("127.0.0.1", 0)));
+  ASSERT_OK(mini_server_->Start());
+  ASSERT_OK(mini_server_->WaitStarted());
+  tablet_manager_ = mini_server_->server()->tablet_manager();
+
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_TRUE(tablet_manager_->LookupTablet(kTabletId, &replica));
+  ASSERT_TRUE(tablet_manager_->LookupTablet(kOtherTabletId, &replica));
+  scoped_refptr<AtomicGauge<int64_t>> wal_bytes_remaining =
+      METRIC_startup_wal_bytes_remaining.Instantiate(
+          mini_server_->server()->metric_entity(), 0);
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(0, wal_bytes_remaining->value());
+  });
+}
+
 static void AssertMonotonicReportSeqno(int64_t* report_seqno,
                                        const TabletReportPB &report) {
   ASSERT_LT(*report_seqno, report.sequence_number());
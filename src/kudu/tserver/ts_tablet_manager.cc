@@ -17,12 +17,16 @@
 
 #include "kudu/tserver/ts_tablet_manager.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -33,9 +37,11 @@
 #include <glog/logging.h>
 
 #include "kudu/clock/clock.h"
+#include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/consensus.proxy.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/consensus_meta_manager.h"
 #include "kudu/consensus/log.h"
@@ -50,17 +56,22 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/rpc/result_tracker.h"
+#include "kudu/rpc/rpc_controller.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_bootstrap.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -76,6 +87,22 @@ DEFINE_int32(num_tablets_to_copy_simultaneously, 10,
              "Number of threads available to copy tablets from remote servers.");
 TAG_FLAG(num_tablets_to_copy_simultaneously, advanced);
 
+DEFINE_int32(tablet_copy_queue_length, 10,
+             "Number of tablet copies which may wait for one of the "
+             "--num_tablets_to_copy_simultaneously threads to become available. "
+             "Copies of the tablets with the fewest healthy voters start first. "
+             "Copies which don't fit in the queue are rejected, and retried later "
+             "by their callers.");
+TAG_FLAG(tablet_copy_queue_length, advanced);
+TAG_FLAG(tablet_copy_queue_length, runtime);
+
+DEFINE_bool(tablet_copy_reuse_local_blocks, true,
+            "Whether a tablet copy replacing a replica which still has its data "
+            "reuses the replica's blocks identical to those of the copy source "
+            "rather than downloading them again.");
+TAG_FLAG(tablet_copy_reuse_local_blocks, advanced);
+TAG_FLAG(tablet_copy_reuse_local_blocks, runtime);
+
 DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "Number of threads available to open tablets during startup. If this "
              "is set to 0 (the default), then the number of bootstrap threads will "
@@ -84,6 +111,22 @@ DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
+DEFINE_bool(prioritize_tablet_bootstrap_order, true,
+            "Whether to order the tablets opened on startup so that the most "
+            "important ones, and the cheapest ones to bootstrap, are opened first. "
+            "Tablets of the tables listed in --tablet_bootstrap_priority_tables come "
+            "first, then those whose local replica voted for itself in its last "
+            "term, i.e. likely leaders. Within each group, tablets with smaller "
+            "WALs are opened first. If false, tablets are opened in the order "
+            "their metadata is found on disk.");
+TAG_FLAG(prioritize_tablet_bootstrap_order, advanced);
+
+DEFINE_string(tablet_bootstrap_priority_tables, "",
+              "Comma-separated list of table names whose tablets are opened before "
+              "those of other tables on startup. Only used if "
+              "--prioritize_tablet_bootstrap_order is set.");
+TAG_FLAG(tablet_bootstrap_priority_tables, advanced);
+
 DEFINE_int32(tablet_start_warn_threshold_ms, 500,
              "If a tablet takes more than this number of millis to start, issue "
              "a warning with a trace.");
@@ -119,6 +162,22 @@ DEFINE_int32(tablet_state_walk_min_period_ms, 1000,
              "tablet map to update tablet state counts.");
 TAG_FLAG(tablet_state_walk_min_period_ms, advanced);
 
+DEFINE_int64(tablet_split_min_size_mb, 10 * 1024,
+             "The on-disk size of a tablet replica, in MiB, starting from which "
+             "the tablet server suggests a key to split the tablet at in the "
+             "load statistics it sends to the master. Set to 0 to not suggest "
+             "split keys based on size.");
+TAG_FLAG(tablet_split_min_size_mb, experimental);
+TAG_FLAG(tablet_split_min_size_mb, runtime);
+
+DEFINE_double(tablet_split_min_rows_written_per_sec, 0,
+              "The rate of rows written to a tablet replica, per second, "
+              "starting from which the tablet server suggests a key to split "
+              "the tablet at in the load statistics it sends to the master. "
+              "Set to 0 to not suggest split keys based on load.");
+TAG_FLAG(tablet_split_min_rows_written_per_sec, experimental);
+TAG_FLAG(tablet_split_min_rows_written_per_sec, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
 METRIC_DEFINE_gauge_int32(server, tablets_num_not_initialized,
@@ -161,6 +220,13 @@ METRIC_DEFINE_gauge_int32(server, tablets_num_shutdown,
                           kudu::MetricUnit::kTablets,
                           "Number of tablets currently shut down");
 
+METRIC_DEFINE_gauge_int64(server, startup_wal_bytes_remaining,
+                          "Startup WAL Bytes Remaining",
+                          kudu::MetricUnit::kBytes,
+                          "Total size of the WALs of the tablets found on startup "
+                          "which have not finished opening yet. Drops to zero once "
+                          "every tablet has been bootstrapped.");
+
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -204,7 +270,8 @@ TSTabletManager::TSTabletManager(TabletServer* server)
     server_(server),
     metric_registry_(server->metric_registry()),
     tablet_copy_metrics_(server->metric_entity()),
-    state_(MANAGER_INITIALIZING) {
+    state_(MANAGER_INITIALIZING),
+    draining_(false) {
   METRIC_tablets_num_not_initialized.InstantiateFunctionGauge(
           server->metric_entity(),
           Bind(&TSTabletManager::RefreshTabletStateCacheAndReturnCount,
@@ -245,19 +312,30 @@ TSTabletManager::TSTabletManager(TabletServer* server)
           Bind(&TSTabletManager::RefreshTabletStateCacheAndReturnCount,
                Unretained(this), tablet::SHUTDOWN))
       ->AutoDetach(&metric_detacher_);
+  startup_wal_bytes_remaining_ =
+      METRIC_startup_wal_bytes_remaining.Instantiate(server->metric_entity(), 0);
 }
 
 TSTabletManager::~TSTabletManager() {
 }
 
+struct TSTabletManager::StartupTablet {
+  scoped_refptr<TabletMetadata> meta;
+
+  // Tablets with a higher priority are opened first.
+  int priority;
+
+  // The size of the tablet's WAL, which approximates the bootstrap cost.
+  uint64_t wal_bytes;
+};
+
 Status TSTabletManager::Init() {
   CHECK_EQ(state(), MANAGER_INITIALIZING);
 
-  // Start the tablet copy thread pool. We set a max queue size of 0 so that if
-  // the number of requests exceeds the number of threads, a
-  // SERVICE_UNAVAILABLE error may be returned to the remote caller.
+  // Start the tablet copy thread pool. The queue of the pool is unbounded,
+  // but the copies waiting for its threads are bounded by StartTabletCopy(),
+  // which returns SERVICE_UNAVAILABLE to the remote caller beyond that.
   RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy")
-                .set_max_queue_size(0)
                 .set_max_threads(FLAGS_num_tablets_to_copy_simultaneously)
                 .Build(&tablet_copy_pool_));
 
@@ -300,8 +378,16 @@ Status TSTabletManager::Init() {
   }
   LOG(INFO) << Substitute("Loaded tablet metadata ($0 live tablets)", metas.size());
 
-  // Now submit the "Open" task for each.
-  for (const scoped_refptr<TabletMetadata>& meta : metas) {
+  vector<StartupTablet> to_open;
+  to_open.reserve(metas.size());
+  for (auto& meta : metas) {
+    to_open.push_back({ std::move(meta), 0, 0 });
+  }
+  OrderTabletsForStartup(&to_open);
+
+  // Now submit the "Open" task for each. The pool runs them in submission order.
+  for (const StartupTablet& t : to_open) {
+    const scoped_refptr<TabletMetadata>& meta = t.meta;
     scoped_refptr<TransitionInProgressDeleter> deleter;
     {
       std::lock_guard<RWMutex> lock(lock_);
@@ -310,8 +396,11 @@ Status TSTabletManager::Init() {
 
     scoped_refptr<TabletReplica> replica;
     RETURN_NOT_OK(CreateAndRegisterTabletReplica(meta, NEW_REPLICA, &replica));
-    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
-                                                            this, replica, deleter)));
+    int64_t wal_bytes = t.wal_bytes;
+    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc([this, replica, deleter, wal_bytes]() {
+      OpenTablet(replica, deleter);
+      startup_wal_bytes_remaining_->DecrementBy(wal_bytes);
+    }));
   }
 
   {
@@ -322,6 +411,52 @@ Status TSTabletManager::Init() {
   return Status::OK();
 }
 
+void TSTabletManager::OrderTabletsForStartup(vector<StartupTablet>* tablets) {
+  const bool prioritize = FLAGS_prioritize_tablet_bootstrap_order;
+  const set<string> priority_tables = strings::Split(FLAGS_tablet_bootstrap_priority_tables,
+                                                     ",", strings::SkipEmpty());
+  int64_t total_wal_bytes = 0;
+  for (StartupTablet& t : *tablets) {
+    const string& tablet_id = t.meta->tablet_id();
+    Status s = fs_manager_->env()->GetFileSizeOnDiskRecursively(
+        fs_manager_->GetTabletWalDir(tablet_id), &t.wal_bytes);
+    if (!s.ok()) {
+      // Any real problem with the WAL is reported by the bootstrap itself.
+      VLOG(1) << LogPrefix(tablet_id) << "Unable to determine WAL size: " << s.ToString();
+      t.wal_bytes = 0;
+    }
+    total_wal_bytes += t.wal_bytes;
+    if (!prioritize) {
+      continue;
+    }
+
+    if (ContainsKey(priority_tables, t.meta->table_name())) {
+      t.priority += 2;
+    }
+    // A replica which voted for itself in its last term was a candidate and
+    // quite likely the leader; the tablet is unavailable to writers until it,
+    // or another replica, is leader again.
+    scoped_refptr<ConsensusMetadata> cmeta;
+    if (cmeta_manager_->Load(tablet_id, &cmeta).ok() &&
+        cmeta->has_voted_for() && cmeta->voted_for() == fs_manager_->uuid()) {
+      t.priority += 1;
+    }
+  }
+  startup_wal_bytes_remaining_->IncrementBy(total_wal_bytes);
+
+  if (prioritize) {
+    std::stable_sort(tablets->begin(), tablets->end(),
+                     [](const StartupTablet& a, const StartupTablet& b) {
+                       if (a.priority != b.priority) {
+                         return a.priority > b.priority;
+                       }
+                       return a.wal_bytes < b.wal_bytes;
+                     });
+  }
+  LOG(INFO) << Substitute("Opening $0 tablets with $1 of WAL to replay",
+                          tablets->size(), HumanReadableNumBytes::ToString(total_wal_bytes));
+}
+
 Status TSTabletManager::WaitForAllBootstrapsToFinish() {
   CHECK_EQ(state(), MANAGER_RUNNING);
 
@@ -416,65 +551,23 @@ Status TSTabletManager::CheckLeaderTermNotLower(const string& tablet_id,
   return Status::OK();
 }
 
-// Tablet Copy runnable that will run on a ThreadPool.
-class TabletCopyRunnable : public Runnable {
- public:
-  TabletCopyRunnable(TSTabletManager* ts_tablet_manager,
-                     const StartTabletCopyRequestPB* req,
-                     std::function<void(const Status&, TabletServerErrorPB::Code)> cb)
-      : ts_tablet_manager_(ts_tablet_manager),
-        req_(req),
-        cb_(std::move(cb)) {
-  }
-
-  virtual ~TabletCopyRunnable() {
-    // If the Runnable is destroyed without the Run() method being invoked, we
-    // must invoke the user callback ourselves in order to free request
-    // resources. This may happen when the ThreadPool is shut down while the
-    // Runnable is enqueued.
-    if (!cb_invoked_) {
-      cb_(Status::ServiceUnavailable("Tablet server shutting down"),
-          TabletServerErrorPB::THROTTLED);
-    }
-  }
-
-  virtual void Run() override {
-    ts_tablet_manager_->RunTabletCopy(req_, cb_);
-    cb_invoked_ = true;
-  }
+namespace {
 
-  // Disable automatic invocation of the callback by the destructor.
-  void DisableCallback() {
-    cb_invoked_ = true;
-  }
-
- private:
-  TSTabletManager* const ts_tablet_manager_;
-  const StartTabletCopyRequestPB* const req_;
-  const std::function<void(const Status&, TabletServerErrorPB::Code)> cb_;
-  bool cb_invoked_ = false;
+// Returns the key ordering the queued tablet copies by urgency, the most
+// urgent first: the fewer healthy voters a tablet has, the closer it is to
+// becoming unavailable. Copies with no such hint, e.g. those requested by an
+// administrator, come last.
+int TabletCopyUrgencyKey(const TSTabletManager::TabletCopyStatus& status) {
+  return status.num_healthy_voters < 0 ? std::numeric_limits<int>::max()
+                                       : status.num_healthy_voters;
+}
 
-  DISALLOW_COPY_AND_ASSIGN(TabletCopyRunnable);
-};
+} // anonymous namespace
 
 void TSTabletManager::StartTabletCopy(
     const StartTabletCopyRequestPB* req,
     std::function<void(const Status&, TabletServerErrorPB::Code)> cb) {
-  // Attempt to submit the tablet copy task to the threadpool. The threadpool
-  // is configured with 0 queue slots, so if there is not a thread immediately
-  // available the submit will fail. When successful, the table copy task will
-  // immediately check whether the tablet is already being copied, and if so,
-  // return ALREADY_INPROGRESS.
-  string tablet_id = req->tablet_id();
-  shared_ptr<TabletCopyRunnable> runnable(new TabletCopyRunnable(this, req, cb));
-  Status s = tablet_copy_pool_->Submit(runnable);
-  if (PREDICT_TRUE(s.ok())) {
-    return;
-  }
-
-  // We were unable to submit the tablet copy task to the thread pool. We will
-  // invoke the callback ourselves, so disable the automatic callback mechanism.
-  runnable->DisableCallback();
+  const string& tablet_id = req->tablet_id();
 
   // Check if the tablet is already in transition (i.e. being copied).
   boost::optional<string> transition;
@@ -494,13 +587,123 @@ void TSTabletManager::StartTabletCopy(
     return;
   }
 
-  // The tablet is not already being copied, but there are no remaining slots in
-  // the threadpool.
+  // Queue the copy, and then reject the least urgent copies which don't fit
+  // in the idle threads of the pool and the queue. Their callers retry later.
+  vector<QueuedTabletCopy> rejected;
+  bool accepted = false;
+  int64_t seqno;
+  {
+    std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+    // A copy requested again, e.g. by a new leader, replaces the queued one.
+    for (auto it = queued_tablet_copies_.begin(); it != queued_tablet_copies_.end();) {
+      if (it->second.status.tablet_id == tablet_id) {
+        rejected.emplace_back(std::move(it->second));
+        it = queued_tablet_copies_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    seqno = next_tablet_copy_seqno_++;
+    QueuedTabletCopy copy;
+    copy.req = req;
+    copy.cb = std::move(cb);
+    copy.status.tablet_id = tablet_id;
+    copy.status.source_uuid = req->copy_peer_uuid();
+    copy.status.num_healthy_voters =
+        req->has_num_healthy_voters() ? req->num_healthy_voters() : -1;
+    copy.status.queued_time = MonoTime::Now();
+    InsertOrDie(&queued_tablet_copies_, seqno, std::move(copy));
+
+    const int num_idle_threads = FLAGS_num_tablets_to_copy_simultaneously -
+        static_cast<int>(running_tablet_copies_.size());
+    const int max_queued = std::max(num_idle_threads, 0) + FLAGS_tablet_copy_queue_length;
+    while (static_cast<int>(queued_tablet_copies_.size()) > max_queued) {
+      auto least_urgent = queued_tablet_copies_.begin();
+      for (auto it = queued_tablet_copies_.begin(); it != queued_tablet_copies_.end(); ++it) {
+        if (TabletCopyUrgencyKey(it->second.status) >=
+            TabletCopyUrgencyKey(least_urgent->second.status)) {
+          least_urgent = it;
+        }
+      }
+      rejected.emplace_back(std::move(least_urgent->second));
+      queued_tablet_copies_.erase(least_urgent);
+    }
+    accepted = ContainsKey(queued_tablet_copies_, seqno);
+  }
+  for (auto& copy : rejected) {
+    copy.cb(Status::ServiceUnavailable("tablet copy queue is full"),
+            TabletServerErrorPB::THROTTLED);
+  }
+  if (!accepted) {
+    return;
+  }
+
+  Status s = tablet_copy_pool_->SubmitFunc([this]() { this->RunNextTabletCopy(); });
+  if (PREDICT_TRUE(s.ok())) {
+    return;
+  }
+
+  // The pool is shutting down. Fail the copy, unless a running task already
+  // picked it up.
+  QueuedTabletCopy copy;
+  {
+    std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+    auto it = queued_tablet_copies_.find(seqno);
+    if (it == queued_tablet_copies_.end()) {
+      return;
+    }
+    copy = std::move(it->second);
+    queued_tablet_copies_.erase(it);
+  }
   if (s.IsServiceUnavailable()) {
-    cb(s, TabletServerErrorPB::THROTTLED);
+    copy.cb(s, TabletServerErrorPB::THROTTLED);
     return;
   }
-  cb(s, TabletServerErrorPB::UNKNOWN_ERROR);
+  copy.cb(s, TabletServerErrorPB::UNKNOWN_ERROR);
+}
+
+void TSTabletManager::RunNextTabletCopy() {
+  QueuedTabletCopy copy;
+  int64_t seqno;
+  {
+    std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+    if (queued_tablet_copies_.empty()) {
+      return;
+    }
+    // Among equally urgent copies, the oldest comes first.
+    auto next = queued_tablet_copies_.begin();
+    for (auto it = queued_tablet_copies_.begin(); it != queued_tablet_copies_.end(); ++it) {
+      if (TabletCopyUrgencyKey(it->second.status) < TabletCopyUrgencyKey(next->second.status)) {
+        next = it;
+      }
+    }
+    seqno = next->first;
+    copy = std::move(next->second);
+    queued_tablet_copies_.erase(next);
+    copy.status.start_time = MonoTime::Now();
+    InsertOrDie(&running_tablet_copies_, seqno, copy.status);
+  }
+
+  RunTabletCopy(copy.req, std::move(copy.cb));
+
+  std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+  running_tablet_copies_.erase(seqno);
+}
+
+void TSTabletManager::ListTabletCopies(vector<TabletCopyStatus>* queued,
+                                       vector<TabletCopyStatus>* running) const {
+  std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+  for (const auto& entry : queued_tablet_copies_) {
+    queued->push_back(entry.second.status);
+  }
+  std::stable_sort(queued->begin(), queued->end(),
+                   [](const TabletCopyStatus& a, const TabletCopyStatus& b) {
+                     return TabletCopyUrgencyKey(a) < TabletCopyUrgencyKey(b);
+                   });
+  for (const auto& entry : running_tablet_copies_) {
+    running->push_back(entry.second);
+  }
 }
 
 #define CALLBACK_AND_RETURN(status) \
@@ -602,6 +805,13 @@ void TSTabletManager::RunTabletCopy(
         // tablet_id. This is okay because the tablet_copy_client should
         // generate a new disk group during the call to Start().
 
+        // Keep the blocks of the replica on disk until the copy is done, so
+        // that those identical to the source's may be reused. They are listed
+        // as orphaned, so that they're deleted upon restart if we crash first.
+        if (FLAGS_tablet_copy_reuse_local_blocks) {
+          meta->set_retain_orphaned_blocks(true);
+        }
+
         // Tombstone the tablet and store the last-logged OpId.
         // TODO(mpercy): Because we begin shutdown of the tablet after we check our
         // last-logged term against the leader's term, there may be operations
@@ -614,6 +824,7 @@ void TSTabletManager::RunTabletCopy(
         Status s = DeleteTabletData(meta, cmeta_manager_, TABLET_DATA_TOMBSTONED,
                                     opt_last_logged_opid);
         if (PREDICT_FALSE(!s.ok())) {
+          meta->set_retain_orphaned_blocks(false);
           CALLBACK_AND_RETURN(
               s.CloneAndPrepend(Substitute("Unable to delete on-disk data from tablet $0",
                                            tablet_id)));
@@ -628,6 +839,17 @@ void TSTabletManager::RunTabletCopy(
     }
   }
 
+  // Delete the retained blocks of the replaced replica if the copy fails
+  // before taking them over. Declared ahead of the tablet copy client, so
+  // that it's run after the client aborts the copy.
+  auto delete_retained_blocks = MakeScopedCleanup([&, meta]() {
+    if (meta && meta->retain_orphaned_blocks()) {
+      meta->set_retain_orphaned_blocks(false);
+      WARN_NOT_OK(DeleteTabletData(meta, cmeta_manager_, TABLET_DATA_TOMBSTONED, boost::none),
+                  LogPrefix(tablet_id) + "Unable to delete the blocks of the replaced replica");
+    }
+  });
+
   const string kSrcPeerInfo = Substitute("$0 ($1)", copy_source_uuid, copy_source_addr.ToString());
   string init_msg = LogPrefix(tablet_id) +
                     Substitute("Initiating tablet copy from peer $0", kSrcPeerInfo);
@@ -1041,6 +1263,17 @@ void TSTabletManager::Shutdown() {
   // TODO(mpercy): Cancel all outstanding tablet copy tasks (KUDU-1795).
   tablet_copy_pool_->Shutdown();
 
+  // Reject the copies which were still queued.
+  std::map<int64_t, QueuedTabletCopy> queued_copies;
+  {
+    std::lock_guard<simple_spinlock> l(tablet_copies_lock_);
+    queued_copies.swap(queued_tablet_copies_);
+  }
+  for (auto& entry : queued_copies) {
+    entry.second.cb(Status::ServiceUnavailable("Tablet server shutting down"),
+                    TabletServerErrorPB::THROTTLED);
+  }
+
   // Shut down the bootstrap pool, so no new tablets are registered after this point.
   open_tablet_pool_->Shutdown();
 
@@ -1116,6 +1349,92 @@ void TSTabletManager::GetTabletReplicas(vector<scoped_refptr<TabletReplica> >* r
   AppendValuesFromMap(tablet_map_, replicas);
 }
 
+void TSTabletManager::SetDraining(bool draining) {
+  if (draining_.Load() != draining) {
+    LOG(INFO) << (draining ? "Starting" : "Stopping") << " draining leaders from this server";
+  }
+  draining_.Store(draining);
+  vector<scoped_refptr<TabletReplica>> replicas;
+  GetTabletReplicas(&replicas);
+  for (const auto& replica : replicas) {
+    shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+    if (consensus) {
+      consensus->SetWithholdCandidacy(draining);
+    }
+  }
+}
+
+namespace {
+
+// A RunLeaderElection() call to the peer the leadership of a tablet is
+// transferred to. Deletes itself once the call completes.
+struct LeadershipTransferCall {
+  void Done() {
+    if (!controller.status().ok() || resp.has_error()) {
+      Status s = controller.status().ok() ? StatusFromPB(resp.error().status())
+                                          : controller.status();
+      LOG(WARNING) << Substitute("T $0: unable to transfer the leadership to $1: $2",
+                                 req.tablet_id(), req.dest_uuid(), s.ToString());
+    }
+    delete this;
+  }
+
+  gscoped_ptr<consensus::ConsensusServiceProxy> proxy;
+  consensus::RunLeaderElectionRequestPB req;
+  consensus::RunLeaderElectionResponsePB resp;
+  rpc::RpcController controller;
+};
+
+} // anonymous namespace
+
+int TSTabletManager::TransferLeaderships() {
+  vector<scoped_refptr<TabletReplica>> replicas;
+  GetTabletReplicas(&replicas);
+  const bool draining = draining_.Load();
+  int num_leaders = 0;
+  for (const auto& replica : replicas) {
+    shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+    if (!consensus) {
+      continue;
+    }
+    // The replicas opened since SetDraining() must withhold their candidacy too.
+    consensus->SetWithholdCandidacy(draining);
+    if (consensus->role() != consensus::RaftPeerPB::LEADER) {
+      continue;
+    }
+    num_leaders++;
+
+    consensus::RaftPeerPB target;
+    Status s = consensus->GetLeadershipTransferTarget(&target);
+    HostPort hostport;
+    vector<Sockaddr> addrs;
+    if (s.ok()) {
+      s = HostPortFromPB(target.last_known_addr(), &hostport);
+    }
+    if (s.ok()) {
+      s = hostport.ResolveAddresses(&addrs);
+    }
+    if (!s.ok()) {
+      // The transfer is retried by the next call, once a peer caught up.
+      VLOG(1) << LogPrefix(replica->tablet_id())
+              << "Not transferring the leadership: " << s.ToString();
+      continue;
+    }
+
+    auto* call = new LeadershipTransferCall;
+    call->proxy.reset(new consensus::ConsensusServiceProxy(
+        server_->messenger(), addrs[0], hostport.host()));
+    call->req.set_dest_uuid(target.permanent_uuid());
+    call->req.set_tablet_id(replica->tablet_id());
+    call->controller.set_timeout(MonoDelta::FromSeconds(10));
+    LOG(INFO) << LogPrefix(replica->tablet_id())
+              << "Transferring the leadership to " << target.permanent_uuid();
+    call->proxy->RunLeaderElectionAsync(call->req, &call->resp, &call->controller,
+                                        [call]() { call->Done(); });
+  }
+  return num_leaders;
+}
+
 void TSTabletManager::MarkTabletDirty(const std::string& tablet_id, const std::string& reason) {
   VLOG(2) << Substitute("$0 Marking dirty. Reason: $1. Will report this "
       "tablet to the Master in the next heartbeat",
@@ -1137,6 +1456,82 @@ int TSTabletManager::GetNumLiveTablets() const {
   return count;
 }
 
+void TSTabletManager::GetTabletLoadStats(vector<master::TabletLoadStatsPB>* stats) {
+  vector<scoped_refptr<TabletReplica>> replicas;
+  GetTabletReplicas(&replicas);
+
+  const size_t first_stats_idx = stats->size();
+  vector<shared_ptr<Tablet>> tablets;
+  {
+    std::lock_guard<simple_spinlock> l(load_counters_lock_);
+    std::unordered_map<string, TabletLoadCounters> counters;
+    for (const auto& replica : replicas) {
+      if (replica->state() != tablet::RUNNING) {
+        continue;
+      }
+      shared_ptr<Tablet> tablet = replica->shared_tablet();
+      if (!tablet || !tablet->metrics()) {
+        continue;
+      }
+      const tablet::TabletMetrics* metrics = tablet->metrics();
+      TabletLoadCounters current;
+      current.rows_written = metrics->rows_inserted->value() +
+          metrics->rows_upserted->value() +
+          metrics->rows_updated->value() +
+          metrics->rows_deleted->value();
+      current.rows_scanned = metrics->scanner_rows_scanned->value();
+      current.bytes_scanned = metrics->scanner_bytes_scanned_from_disk->value();
+      current.time = MonoTime::Now();
+
+      master::TabletLoadStatsPB tablet_stats;
+      tablet_stats.set_tablet_id(replica->tablet_id());
+      tablet_stats.set_on_disk_size(replica->OnDiskSize());
+      const TabletLoadCounters* last = FindOrNull(last_load_counters_, replica->tablet_id());
+      if (last) {
+        const double secs = (current.time - last->time).ToSeconds();
+        if (secs > 0) {
+          tablet_stats.set_rows_written_per_sec(
+              (current.rows_written - last->rows_written) / secs);
+          tablet_stats.set_rows_scanned_per_sec(
+              (current.rows_scanned - last->rows_scanned) / secs);
+          tablet_stats.set_bytes_scanned_per_sec(
+              (current.bytes_scanned - last->bytes_scanned) / secs);
+        }
+      }
+      stats->emplace_back(std::move(tablet_stats));
+      tablets.emplace_back(std::move(tablet));
+      EmplaceOrDie(&counters, replica->tablet_id(), current);
+    }
+    // Forget about the replicas which are gone.
+    last_load_counters_.swap(counters);
+  }
+
+  // Suggest split keys for the replicas which are large or busy enough.
+  // Choosing a key reads from disk, so it's done without holding the lock.
+  const int64_t split_min_size = FLAGS_tablet_split_min_size_mb * 1024 * 1024;
+  const double split_min_rows_written_per_sec = FLAGS_tablet_split_min_rows_written_per_sec;
+  for (size_t i = 0; i < tablets.size(); i++) {
+    master::TabletLoadStatsPB* tablet_stats = &(*stats)[first_stats_idx + i];
+    const bool large = split_min_size > 0 &&
+        tablet_stats->on_disk_size() >= split_min_size;
+    const bool busy = split_min_rows_written_per_sec > 0 &&
+        tablet_stats->rows_written_per_sec() >= split_min_rows_written_per_sec;
+    if (!large && !busy) {
+      continue;
+    }
+    string split_key;
+    Status s = tablets[i]->ChooseSplitKey(&split_key);
+    if (!s.ok()) {
+      VLOG(1) << Substitute("Unable to choose a key to split tablet $0 at: $1",
+                            tablet_stats->tablet_id(), s.ToString());
+      continue;
+    }
+    tablet_stats->set_split_key_debug_string(
+        tablets[i]->schema()->DebugEncodedRowKey(split_key, Schema::START_KEY));
+    tablet_stats->set_split_key(std::move(split_key));
+  }
+}
+
 void TSTabletManager::InitLocalRaftPeerPB() {
   DCHECK_EQ(state(), MANAGER_INITIALIZING);
   local_peer_pb_.set_permanent_uuid(fs_manager_->uuid());
@@ -36,6 +36,7 @@
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -64,6 +65,7 @@ class StartTabletCopyRequestPB;
 
 namespace master {
 class ReportedTabletPB;
+class TabletLoadStatsPB;
 class TabletReportPB;
 } // namespace master
 
@@ -153,6 +155,11 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Initiate tablet copy of the specified tablet on the tablet_copy_pool_.
   // See the StartTabletCopy() RPC declaration in consensus.proto for details.
   // 'cb' is guaranteed to be invoked as a callback.
+  //
+  // If all the threads of the pool are busy, the copy waits in a queue of at
+  // most --tablet_copy_queue_length copies, where the copies of the tablets
+  // with the fewest healthy voters come first. The least urgent copy is
+  // rejected with THROTTLED when the queue is full.
   virtual void StartTabletCopy(
       const consensus::StartTabletCopyRequestPB* req,
       std::function<void(const Status&, TabletServerErrorPB::Code)> cb) override;
@@ -162,6 +169,25 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
       const consensus::StartTabletCopyRequestPB* req,
       std::function<void(const Status&, TabletServerErrorPB::Code)> cb);
 
+  // A tablet copy queued or running on this server.
+  struct TabletCopyStatus {
+    std::string tablet_id;
+    std::string source_uuid;
+
+    // The number of healthy voters of the tablet reported by the caller, or
+    // -1 if unknown.
+    int num_healthy_voters;
+
+    MonoTime queued_time;
+
+    // Uninitialized while the copy is queued.
+    MonoTime start_time;
+  };
+
+  // Lists the queued tablet copies, most urgent first, and the running ones.
+  void ListTabletCopies(std::vector<TabletCopyStatus>* queued,
+                        std::vector<TabletCopyStatus>* running) const;
+
   // Adds updated tablet information to 'report'.
   void PopulateFullTabletReport(master::TabletReportPB* report) const;
 
@@ -184,8 +210,33 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Return the number of tablets in RUNNING or BOOTSTRAPPING state.
   int GetNumLiveTablets() const;
 
+  // Fills 'stats' with the load statistics of the RUNNING tablet replicas.
+  // Request rates are computed over the time since the previous call, and
+  // are left unset for the replicas which weren't running back then.
+  // Replicas exceeding the --tablet_split_min_* thresholds also carry a
+  // suggested key to split their tablet at.
+  void GetTabletLoadStats(std::vector<master::TabletLoadStatsPB>* stats);
+
   Status RunAllLogGC();
 
+  // Sets whether this server is being drained of its leaders, e.g. before
+  // being restarted. While it is, its replicas withhold their candidacy, so
+  // that the leaderships moved away by TransferLeaderships() aren't taken
+  // back when the new leaders are slow to heartbeat.
+  void SetDraining(bool draining);
+
+  bool draining() const {
+    return draining_.Load();
+  }
+
+  // Moves the leadership of the tablets led by this server to their peers.
+  // For each of them, a voter which is caught up with this replica is asked
+  // to start an election, which it wins without waiting for a leader failure
+  // to be detected. The elections of all the tablets run in parallel and
+  // aren't waited for. Returns the number of tablets this server led when
+  // called, so that the server is safe to stop once it returns 0.
+  int TransferLeaderships();
+
   // Delete the tablet using the specified delete_type as the final metadata
   // state. Deletes the on-disk data, metadata, as well as all WAL segments.
   //
@@ -225,6 +276,17 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
     return LogPrefix(tablet_id, fs_manager_);
   }
 
+  // A StartTabletCopy() request waiting for a thread of tablet_copy_pool_.
+  struct QueuedTabletCopy {
+    const consensus::StartTabletCopyRequestPB* req;
+    std::function<void(const Status&, TabletServerErrorPB::Code)> cb;
+    TabletCopyStatus status;
+  };
+
+  // Runs the most urgent queued tablet copy, if any. Each copy added to the
+  // queue submits one call of this to tablet_copy_pool_.
+  void RunNextTabletCopy();
+
   // Returns Status::OK() iff state_ == MANAGER_RUNNING.
   Status CheckRunningUnlocked(TabletServerErrorPB::Code* error_code) const;
 
@@ -267,6 +329,14 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   void OpenTablet(const scoped_refptr<tablet::TabletReplica>& replica,
                   const scoped_refptr<TransitionInProgressDeleter>& deleter);
 
+  // A tablet to open on startup, and what determines its place in line.
+  struct StartupTablet;
+
+  // Estimate the bootstrap cost of each tablet in 'tablets' and, if
+  // --prioritize_tablet_bootstrap_order is set, sort them in the order in
+  // which they should be opened.
+  void OrderTabletsForStartup(std::vector<StartupTablet>* tablets);
+
   // Open a tablet whose metadata has already been loaded.
   void BootstrapAndInitTablet(const scoped_refptr<tablet::TabletMetadata>& meta,
                               scoped_refptr<tablet::TabletReplica>* replica);
@@ -358,11 +428,44 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Thread pool used to run tablet copy operations.
   gscoped_ptr<ThreadPool> tablet_copy_pool_;
 
+  // Protects the queued and running tablet copies. Never held while invoking
+  // the callbacks of the copies.
+  mutable simple_spinlock tablet_copies_lock_;
+
+  // The queued and running tablet copies, keyed by the order in which they
+  // were requested.
+  std::map<int64_t, QueuedTabletCopy> queued_tablet_copies_;
+  std::map<int64_t, TabletCopyStatus> running_tablet_copies_;
+  int64_t next_tablet_copy_seqno_ = 0;
+
   // Thread pool used to open the tablets async, whether bootstrap is required or not.
   gscoped_ptr<ThreadPool> open_tablet_pool_;
 
+  // The total size of the WALs of the tablets which were found on startup
+  // and haven't finished opening yet.
+  scoped_refptr<AtomicGauge<int64_t>> startup_wal_bytes_remaining_;
+
+  // Cumulative request counters of a tablet replica as of the time they were
+  // last collected by GetTabletLoadStats().
+  struct TabletLoadCounters {
+    int64_t rows_written;
+    int64_t rows_scanned;
+    int64_t bytes_scanned;
+    MonoTime time;
+  };
+
+  // Protects 'last_load_counters_'.
+  simple_spinlock load_counters_lock_;
+
+  // The counters collected by the last call to GetTabletLoadStats(), keyed by
+  // tablet ID.
+  std::unordered_map<std::string, TabletLoadCounters> last_load_counters_;
+
   FunctionGaugeDetacher metric_detacher_;
 
+  // See SetDraining().
+  AtomicBool draining_;
+
   DISALLOW_COPY_AND_ASSIGN(TSTabletManager);
 };
 
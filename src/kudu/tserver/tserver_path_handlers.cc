@@ -29,6 +29,7 @@
 #include <vector>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/common/common.pb.h"
@@ -53,6 +54,7 @@
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tserver/scanners.h"
@@ -62,11 +64,17 @@
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/maintenance_manager.pb.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/web_callback_registry.h"
 
+DECLARE_int32(num_tablets_to_copy_simultaneously);
+DECLARE_int32(tablet_copy_queue_length);
+DECLARE_int64(tablet_copy_dest_bytes_per_sec);
+DECLARE_int64(tablet_copy_source_bytes_per_sec);
+
 using kudu::MaintenanceManagerStatusPB;
 using kudu::consensus::ConsensusStatePB;
 using kudu::consensus::GetConsensusRole;
@@ -82,6 +90,7 @@ using kudu::tablet::Transaction;
 using std::endl;
 using std::map;
 using std::ostringstream;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::vector;
@@ -133,6 +142,10 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     "/maintenance-manager", "",
     boost::bind(&TabletServerPathHandlers::HandleMaintenanceManagerPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/tablet-copies", "",
+    boost::bind(&TabletServerPathHandlers::HandleTabletCopiesPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
 
   return Status::OK();
 }
@@ -211,6 +224,65 @@ bool IsTombstoned(const scoped_refptr<TabletReplica>& replica) {
   return replica->data_state() == tablet::TABLET_DATA_TOMBSTONED;
 }
 
+// The number of tablets listed as the hottest on the tablets page.
+const int kNumHotTablets = 10;
+
+// Outputs a table of the running tablets among 'replicas' which consumed the
+// most CPU time scanning and applying writes since they were opened.
+void OutputHotTablets(const vector<scoped_refptr<TabletReplica>>& replicas,
+                      std::ostream* output) {
+  vector<pair<int64_t, shared_ptr<Tablet>>> tablets;
+  for (const auto& replica : replicas) {
+    shared_ptr<Tablet> tablet = replica->shared_tablet();
+    if (!tablet || !tablet->metrics()) {
+      continue;
+    }
+    const int64_t cpu_time_us = tablet->metrics()->scanner_cpu_time_us->value() +
+        tablet->metrics()->write_apply_cpu_time_us->value();
+    if (cpu_time_us > 0) {
+      tablets.emplace_back(cpu_time_us, std::move(tablet));
+    }
+  }
+  if (tablets.empty()) {
+    return;
+  }
+  const int num_hot = std::min<int>(kNumHotTablets, tablets.size());
+  std::partial_sort(tablets.begin(), tablets.begin() + num_hot, tablets.end(),
+                    [](const pair<int64_t, shared_ptr<Tablet>>& a,
+                       const pair<int64_t, shared_ptr<Tablet>>& b) {
+                      return a.first > b.first;
+                    });
+
+  *output << "<h4>Hottest Tablets</h4>\n";
+  *output << "<p><small>Resources consumed since each tablet was opened.</small></p>\n";
+  *output << "<table class='table table-striped table-hover'>\n";
+  *output << "<thead><tr><th>Table name</th><th>Tablet ID</th>"
+      "<th>Scan CPU time</th><th>Write CPU time</th><th>Bytes read from disk</th>"
+      "<th>Cache miss bytes</th><th>Rows scanned</th><th>Rows written</th></tr></thead>\n";
+  *output << "<tbody>\n";
+  for (int i = 0; i < num_hot; i++) {
+    Tablet* tablet = tablets[i].second.get();
+    tablet::TabletMetrics* metrics = tablet->metrics();
+    const int64_t rows_written = metrics->rows_inserted->value() +
+        metrics->rows_upserted->value() + metrics->rows_updated->value() +
+        metrics->rows_deleted->value();
+    *output << Substitute(
+        "<tr><td>$0</td><td>$1</td><td>$2</td><td>$3</td><td>$4</td><td>$5</td>"
+        "<td>$6</td><td>$7</td></tr>\n",
+        EscapeForHtmlToString(tablet->metadata()->table_name()),
+        TabletLink(tablet->tablet_id()),
+        HumanReadableElapsedTime::ToShortString(
+            metrics->scanner_cpu_time_us->value() / 1e6),
+        HumanReadableElapsedTime::ToShortString(
+            metrics->write_apply_cpu_time_us->value() / 1e6),
+        HumanReadableNumBytes::ToString(metrics->scanner_bytes_scanned_from_disk->value()),
+        HumanReadableNumBytes::ToString(metrics->scanner_cfile_cache_miss_bytes->value()),
+        HumanReadableInt::ToString(metrics->scanner_rows_scanned->value()),
+        HumanReadableInt::ToString(rows_written));
+  }
+  *output << "</tbody></table>\n";
+}
+
 } // anonymous namespace
 
 void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& /*req*/,
@@ -324,6 +396,7 @@ void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& /*
   if (!live_replicas.empty()) {
     *output << "<h3>Live Tablets</h3>\n";
     generate_table(live_replicas, output);
+    OutputHotTablets(live_replicas, output);
   }
   if (!tombstoned_replicas.empty()) {
     *output << "<h3>Tombstoned Tablets</h3>\n";
@@ -600,6 +673,12 @@ void ScanToJson(const ScanDescriptor& scan, EasyJson* json) {
   json->Set("duration_title", duration.ToSeconds());
   json->Set("time_since_start_title", time_since_start.ToSeconds());
 
+  json->Set("cpu_time",
+            HumanReadableElapsedTime::ToShortString(scan.cpu_time_us / 1e6));
+  json->Set("cpu_time_title", scan.cpu_time_us / 1e6);
+  json->Set("cache_miss_bytes", HumanReadableNumBytes::ToString(scan.cfile_cache_miss_bytes));
+  json->Set("cache_miss_bytes_title", scan.cfile_cache_miss_bytes);
+
   EasyJson stats_json = json->Set("stats", EasyJson::kArray);
   IteratorStatsToJson(scan, &stats_json);
 }
@@ -630,6 +709,9 @@ void TabletServerPathHandlers::HandleDashboardsPage(const Webserver::WebRequest&
   *output << GetDashboardLine("maintenance-manager", "Maintenance Manager",
                               "List of operations that are currently running and those "
                               "that are registered.");
+  *output << GetDashboardLine("tablet-copies", "Tablet Copies",
+                              "List of tablet copies to this server that are currently "
+                              "running and queued, and the tablet copy bandwidth budgets.");
   *output << "</tbody></table>\n";
 }
 
@@ -680,6 +762,70 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
     registered_op["ram_anchored"] = HumanReadableNumBytes::ToString(op_pb.ram_anchored_bytes());
     registered_op["logs_retained"] = HumanReadableNumBytes::ToString(op_pb.logs_retained_bytes());
     registered_op["perf"] = op_pb.perf_improvement();
+    registered_op["io_cost"] = HumanReadableNumBytes::ToString(op_pb.io_bytes());
+  }
+
+  EasyJson decisions = output->Set("recent_decisions", EasyJson::kArray);
+  for (const auto& decision_pb : pb.recent_decisions()) {
+    EasyJson decision = decisions.PushBack(EasyJson::kObject);
+    decision["name"] = decision_pb.name();
+    decision["reason"] = decision_pb.reason();
+    decision["devices"] = JoinStrings(decision_pb.devices(), ", ");
+    decision["time_since_decision"] =
+      HumanReadableElapsedTime::ToShortString(decision_pb.millis_since_decision() / 1000.0);
+  }
+}
+
+namespace {
+
+string BandwidthToString(int64_t bytes_per_sec) {
+  if (bytes_per_sec <= 0) {
+    return "unlimited";
+  }
+  return HumanReadableNumBytes::ToString(bytes_per_sec) + "/s";
+}
+
+void TabletCopyToJson(const TSTabletManager::TabletCopyStatus& copy, MonoTime now,
+                      EasyJson* json) {
+  (*json)["tablet_id"] = copy.tablet_id;
+  (*json)["source_uuid"] = copy.source_uuid;
+  if (copy.num_healthy_voters >= 0) {
+    (*json)["num_healthy_voters"] = copy.num_healthy_voters;
+  }
+  if (copy.start_time.Initialized()) {
+    (*json)["time_queued"] = HumanReadableElapsedTime::ToShortString(
+        (copy.start_time - copy.queued_time).ToSeconds());
+    (*json)["time_running"] = HumanReadableElapsedTime::ToShortString(
+        (now - copy.start_time).ToSeconds());
+  } else {
+    (*json)["time_queued"] = HumanReadableElapsedTime::ToShortString(
+        (now - copy.queued_time).ToSeconds());
+  }
+}
+
+} // anonymous namespace
+
+void TabletServerPathHandlers::HandleTabletCopiesPage(const Webserver::WebRequest& /*req*/,
+                                                      Webserver::WebResponse* resp) {
+  EasyJson* output = resp->output;
+  (*output)["max_running"] = FLAGS_num_tablets_to_copy_simultaneously;
+  (*output)["max_queued"] = FLAGS_tablet_copy_queue_length;
+  (*output)["source_bandwidth"] = BandwidthToString(FLAGS_tablet_copy_source_bytes_per_sec);
+  (*output)["dest_bandwidth"] = BandwidthToString(FLAGS_tablet_copy_dest_bytes_per_sec);
+
+  vector<TSTabletManager::TabletCopyStatus> queued;
+  vector<TSTabletManager::TabletCopyStatus> running;
+  tserver_->tablet_manager()->ListTabletCopies(&queued, &running);
+  const MonoTime now = MonoTime::Now();
+  EasyJson running_json = output->Set("running", EasyJson::kArray);
+  for (const auto& copy : running) {
+    EasyJson copy_json = running_json.PushBack(EasyJson::kObject);
+    TabletCopyToJson(copy, now, &copy_json);
+  }
+  EasyJson queued_json = output->Set("queued", EasyJson::kArray);
+  for (const auto& copy : queued) {
+    EasyJson copy_json = queued_json.PushBack(EasyJson::kObject);
+    TabletCopyToJson(copy, now, &copy_json);
   }
 }
 
@@ -0,0 +1,93 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/write_quota_manager.h"
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int64(tserver_table_write_quota_bytes_per_sec);
+DECLARE_int64(tserver_user_write_quota_bytes_per_sec);
+DECLARE_int32(write_quota_max_wait_ms);
+
+METRIC_DECLARE_counter(writes_delayed_by_quota);
+METRIC_DECLARE_counter(writes_rejected_by_quota);
+METRIC_DECLARE_entity(server);
+
+namespace kudu {
+namespace tserver {
+
+class WriteQuotaManagerTest : public KuduTest {
+ protected:
+  WriteQuotaManagerTest()
+      : metric_entity_(METRIC_ENTITY_server.Instantiate(&registry_, "test")) {
+  }
+
+  int64_t CounterValue(CounterPrototype* proto) {
+    return proto->Instantiate(metric_entity_)->value();
+  }
+
+  MetricRegistry registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
+};
+
+TEST_F(WriteQuotaManagerTest, TestUnlimited) {
+  WriteQuotaManager mgr(metric_entity_);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(mgr.AdmitWrite("table", "user", 1024 * 1024, MonoTime::Now()));
+  }
+}
+
+TEST_F(WriteQuotaManagerTest, TestTableQuota) {
+  FLAGS_tserver_table_write_quota_bytes_per_sec = 1000;
+  FLAGS_write_quota_max_wait_ms = 0;
+  WriteQuotaManager mgr(metric_entity_);
+
+  // The quota is replenished every 100ms: once a table used it up, it's over
+  // quota, but other tables aren't.
+  ASSERT_OK(mgr.AdmitWrite("table", "user", 100, MonoTime::Now()));
+  Status s = mgr.AdmitWrite("table", "user", 100, MonoTime::Now());
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  ASSERT_EQ(1, CounterValue(&METRIC_writes_rejected_by_quota));
+  ASSERT_OK(mgr.AdmitWrite("other-table", "user", 100, MonoTime::Now()));
+
+  // Given time, a write over quota is held back rather than rejected.
+  FLAGS_write_quota_max_wait_ms = 5000;
+  ASSERT_OK(mgr.AdmitWrite("table", "user", 100, MonoTime::Now() + MonoDelta::FromSeconds(5)));
+  ASSERT_EQ(1, CounterValue(&METRIC_writes_delayed_by_quota));
+}
+
+TEST_F(WriteQuotaManagerTest, TestUserQuota) {
+  FLAGS_tserver_user_write_quota_bytes_per_sec = 1000;
+  FLAGS_write_quota_max_wait_ms = 0;
+  WriteQuotaManager mgr(metric_entity_);
+
+  // The quota of a user covers all the tables.
+  ASSERT_OK(mgr.AdmitWrite("table", "user", 100, MonoTime::Now()));
+  Status s = mgr.AdmitWrite("other-table", "user", 100, MonoTime::Now());
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  ASSERT_OK(mgr.AdmitWrite("table", "other-user", 100, MonoTime::Now()));
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/write_quota_manager.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/status.h"
+#include "kudu/util/throttler.h"
+
+DEFINE_int64(tserver_table_write_quota_bytes_per_sec, 0,
+             "The maximum number of bytes per second each table may write to the "
+             "tablet replicas of a tablet server. Set to 0 to not limit tables.");
+TAG_FLAG(tserver_table_write_quota_bytes_per_sec, experimental);
+
+DEFINE_int64(tserver_user_write_quota_bytes_per_sec, 0,
+             "The maximum number of bytes per second each user may write to the "
+             "tablet replicas of a tablet server. Set to 0 to not limit users.");
+TAG_FLAG(tserver_user_write_quota_bytes_per_sec, experimental);
+
+DEFINE_int32(write_quota_max_wait_ms, 200,
+             "The maximum amount of time (in milliseconds) a write over quota is "
+             "held back for the quota to allow it, before it's rejected so that "
+             "the client retries it later.");
+TAG_FLAG(write_quota_max_wait_ms, experimental);
+TAG_FLAG(write_quota_max_wait_ms, runtime);
+
+METRIC_DEFINE_counter(server, writes_delayed_by_quota,
+                      "Writes Delayed By Quota",
+                      kudu::MetricUnit::kRequests,
+                      "Number of write requests held back until the write quotas "
+                      "of their table and user allowed them");
+
+METRIC_DEFINE_counter(server, writes_rejected_by_quota,
+                      "Writes Rejected By Quota",
+                      kudu::MetricUnit::kRequests,
+                      "Number of write requests rejected for exceeding the write "
+                      "quotas of their table or user");
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+WriteQuotaManager::WriteQuotaManager(const scoped_refptr<MetricEntity>& metric_entity) {
+  if (metric_entity) {
+    writes_delayed_ = METRIC_writes_delayed_by_quota.Instantiate(metric_entity);
+    writes_rejected_ = METRIC_writes_rejected_by_quota.Instantiate(metric_entity);
+  }
+}
+
+WriteQuotaManager::~WriteQuotaManager() {
+}
+
+bool WriteQuotaManager::TakeUnlocked(ThrottlerMap* throttlers, const string& key,
+                                     int64_t bytes_per_sec, int64_t bytes, MonoTime now) {
+  if (bytes_per_sec <= 0) {
+    return true;
+  }
+  std::unique_ptr<Throttler>* throttler = FindOrNull(*throttlers, key);
+  if (!throttler) {
+    // Allow bursts of up to a second's worth of writes.
+    const double burst_factor = MonoTime::kMicrosecondsPerSecond / Throttler::kRefillPeriodMicros;
+    throttler = &InsertOrDie(throttlers, key, std::unique_ptr<Throttler>(
+        new Throttler(now, 0, bytes_per_sec, burst_factor)));
+  }
+  // A write larger than a second's worth of quota is admitted once a full
+  // second's worth of tokens is available.
+  return (*throttler)->Take(now, 0, std::min(bytes, bytes_per_sec));
+}
+
+Status WriteQuotaManager::AdmitWrite(const string& table_id, const string& user,
+                                     int64_t bytes, const MonoTime& deadline) {
+  const int64_t table_bytes_per_sec = FLAGS_tserver_table_write_quota_bytes_per_sec;
+  const int64_t user_bytes_per_sec = FLAGS_tserver_user_write_quota_bytes_per_sec;
+  if (table_bytes_per_sec <= 0 && user_bytes_per_sec <= 0) {
+    return Status::OK();
+  }
+
+  const MonoDelta refill_period = MonoDelta::FromMicroseconds(Throttler::kRefillPeriodMicros);
+  const MonoTime wait_deadline = std::min(
+      deadline, MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_write_quota_max_wait_ms));
+  bool delayed = false;
+  while (true) {
+    const MonoTime now = MonoTime::Now();
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (TakeUnlocked(&user_throttlers_, user, user_bytes_per_sec, bytes, now) &&
+          TakeUnlocked(&table_throttlers_, table_id, table_bytes_per_sec, bytes, now)) {
+        if (delayed && writes_delayed_) {
+          writes_delayed_->Increment();
+        }
+        return Status::OK();
+      }
+    }
+    // Wait for the quotas to be replenished, if the deadline allows.
+    if (now + refill_period > wait_deadline) {
+      break;
+    }
+    delayed = true;
+    SleepFor(refill_period);
+  }
+
+  if (writes_rejected_) {
+    writes_rejected_->Increment();
+  }
+  return Status::ServiceUnavailable(Substitute(
+      "Rejecting Write request: over the write quota of table $0 or user $1",
+      table_id, user));
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_WRITE_QUOTA_MANAGER_H
+#define KUDU_TSERVER_WRITE_QUOTA_MANAGER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+class Status;
+class Throttler;
+
+namespace tserver {
+
+// Enforces the write quotas of the tables and the users of a tablet server.
+//
+// Each table and each user may write up to --tserver_table_write_quota_bytes_per_sec
+// and --tserver_user_write_quota_bytes_per_sec bytes per second respectively,
+// across all the tablet replicas on the server. Rather than rejecting writes
+// over quota right away, the manager holds them back until the quota allows
+// them, as long as the client's deadline and --write_quota_max_wait_ms allow.
+//
+// This class is thread-safe.
+class WriteQuotaManager {
+ public:
+  explicit WriteQuotaManager(const scoped_refptr<MetricEntity>& metric_entity);
+  ~WriteQuotaManager();
+
+  // Admits a write of 'bytes' by 'user' to 'table_id', waiting for the quotas
+  // to allow it until 'deadline' at the latest. Returns ServiceUnavailable,
+  // so that the client retries with backoff, if the write is still over
+  // quota by then.
+  Status AdmitWrite(const std::string& table_id, const std::string& user,
+                    int64_t bytes, const MonoTime& deadline);
+
+ private:
+  typedef std::unordered_map<std::string, std::unique_ptr<Throttler>> ThrottlerMap;
+
+  // Takes the tokens for a write of 'bytes' from the throttler of 'key' in
+  // 'throttlers', creating it with a rate of 'bytes_per_sec' if needed.
+  // Returns false if the write is over quota. Requires 'lock_'.
+  static bool TakeUnlocked(ThrottlerMap* throttlers, const std::string& key,
+                           int64_t bytes_per_sec, int64_t bytes, MonoTime now);
+
+  simple_spinlock lock_;
+  ThrottlerMap table_throttlers_;
+  ThrottlerMap user_throttlers_;
+
+  scoped_refptr<Counter> writes_delayed_;
+  scoped_refptr<Counter> writes_rejected_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteQuotaManager);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
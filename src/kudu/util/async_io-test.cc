@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/async_io.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class AsyncIOTest : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    ASSERT_OK(AsyncIOExecutor::Create("async-io-test", 4, &executor_));
+  }
+
+ protected:
+  unique_ptr<AsyncIOExecutor> executor_;
+};
+
+// Writes chunks of a file concurrently, then reads them back concurrently.
+TEST_F(AsyncIOTest, TestWriteThenRead) {
+  const int kNumChunks = 64;
+  const int kChunkSize = 4096;
+  const string path = GetTestPath("file");
+
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(path, &rw_file));
+  vector<string> chunks;
+  for (int i = 0; i < kNumChunks; i++) {
+    chunks.emplace_back(kChunkSize, 'a' + i % 26);
+  }
+
+  // Each chunk is written as two slices to exercise vectored writes.
+  vector<Slice> slices;
+  for (const auto& c : chunks) {
+    slices.emplace_back(c.data(), kChunkSize / 2);
+    slices.emplace_back(c.data() + kChunkSize / 2, kChunkSize / 2);
+  }
+  std::atomic<int> num_failed(0);
+  CountDownLatch written(kNumChunks);
+  for (int i = 0; i < kNumChunks; i++) {
+    ASSERT_OK(executor_->WriteVAsync(
+        rw_file.get(), i * kChunkSize,
+        ArrayView<const Slice>(&slices[i * 2], 2),
+        [&](const Status& s) {
+          if (!s.ok()) num_failed++;
+          written.CountDown();
+        }));
+  }
+  written.Wait();
+  ASSERT_EQ(0, num_failed.load());
+  ASSERT_OK(rw_file->Close());
+
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(path, &file));
+  vector<string> results(kNumChunks, string(kChunkSize, '\0'));
+  for (int i = 0; i < kNumChunks; i++) {
+    ASSERT_OK(executor_->ReadAsync(
+        file.get(), i * kChunkSize, Slice(&results[i][0], kChunkSize),
+        [&](const Status& s) {
+          if (!s.ok()) num_failed++;
+        }));
+  }
+  executor_->Wait();
+  ASSERT_EQ(0, num_failed.load());
+  for (int i = 0; i < kNumChunks; i++) {
+    ASSERT_EQ(chunks[i], results[i]) << Substitute("chunk $0 differs", i);
+  }
+}
+
+// Reads past the end of a file must report the error through the callback.
+TEST_F(AsyncIOTest, TestReadError) {
+  const string path = GetTestPath("file");
+  ASSERT_OK(WriteStringToFile(env_, "abc", path));
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(path, &file));
+
+  string buf(2, '\0');
+  string buf2(10, '\0');
+  Slice results[] = { Slice(&buf[0], buf.size()), Slice(&buf2[0], buf2.size()) };
+  Status read_status;
+  ASSERT_OK(executor_->ReadVAsync(file.get(), 0, ArrayView<Slice>(results, 2),
+                                  [&](const Status& s) { read_status = s; }));
+  executor_->Wait();
+  ASSERT_FALSE(read_status.ok());
+}
+
+// Destroying the executor must still invoke the callbacks of queued operations.
+TEST_F(AsyncIOTest, TestDestroyWithOutstandingOps) {
+  const string path = GetTestPath("file");
+  ASSERT_OK(WriteStringToFile(env_, string(1024, 'x'), path));
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env_->NewRandomAccessFile(path, &file));
+
+  const int kNumReads = 100;
+  vector<string> results(kNumReads, string(1024, '\0'));
+  std::atomic<int> num_done(0);
+  for (int i = 0; i < kNumReads; i++) {
+    ASSERT_OK(executor_->ReadAsync(file.get(), 0, Slice(&results[i][0], 1024),
+                                   [&](const Status& s) {
+                                     CHECK_OK(s);
+                                     num_done++;
+                                   }));
+  }
+  executor_.reset();
+  ASSERT_EQ(kNumReads, num_done.load());
+}
+
+} // namespace kudu
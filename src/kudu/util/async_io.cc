@@ -0,0 +1,80 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/async_io.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/util/env.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+
+Status AsyncIOExecutor::Create(const string& name, int max_concurrent_ops,
+                               unique_ptr<AsyncIOExecutor>* executor) {
+  DCHECK_GT(max_concurrent_ops, 0);
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder(name)
+                .set_max_threads(max_concurrent_ops)
+                .Build(&pool));
+  executor->reset(new AsyncIOExecutor(std::move(pool)));
+  return Status::OK();
+}
+
+AsyncIOExecutor::AsyncIOExecutor(gscoped_ptr<ThreadPool> pool)
+    : pool_(std::move(pool)) {
+}
+
+AsyncIOExecutor::~AsyncIOExecutor() {
+  // Shutting down drops queued tasks, so drain them first to ensure that
+  // every submitted operation's callback is invoked.
+  pool_->Wait();
+  pool_->Shutdown();
+}
+
+Status AsyncIOExecutor::ReadAsync(const RandomAccessFile* file, uint64_t offset,
+                                  Slice result, StdStatusCallback cb) {
+  return pool_->SubmitFunc([file, offset, result, cb]() {
+    cb(file->Read(offset, result));
+  });
+}
+
+Status AsyncIOExecutor::ReadVAsync(const RandomAccessFile* file, uint64_t offset,
+                                   ArrayView<Slice> results, StdStatusCallback cb) {
+  return pool_->SubmitFunc([file, offset, results, cb]() {
+    cb(file->ReadV(offset, results));
+  });
+}
+
+Status AsyncIOExecutor::WriteVAsync(RWFile* file, uint64_t offset,
+                                    ArrayView<const Slice> data, StdStatusCallback cb) {
+  return pool_->SubmitFunc([file, offset, data, cb]() {
+    cb(file->WriteV(offset, data));
+  });
+}
+
+void AsyncIOExecutor::Wait() {
+  pool_->Wait();
+}
+
+} // namespace kudu
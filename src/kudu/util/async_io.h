@@ -0,0 +1,93 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
+
+namespace kudu {
+
+class RWFile;
+class RandomAccessFile;
+class Slice;
+class ThreadPool;
+
+// Issues file reads and writes without blocking the calling thread.
+//
+// Each operation is submitted along with a callback that is invoked with the
+// operation's result once it completes. Callbacks may run on any thread and
+// should not block for long.
+//
+// The current implementation issues blocking I/O from a pool of worker
+// threads, so the number of operations in flight at once is bounded by the
+// size of that pool rather than by the number of callers. A kernel-native
+// backend (e.g. io_uring) may be substituted without changing callers.
+//
+// This class is thread-safe.
+class AsyncIOExecutor {
+ public:
+  // Creates an executor named 'name' that keeps at most 'max_concurrent_ops'
+  // operations in flight at once.
+  static Status Create(const std::string& name, int max_concurrent_ops,
+                       std::unique_ptr<AsyncIOExecutor>* executor);
+
+  // Waits for all outstanding operations to complete.
+  ~AsyncIOExecutor();
+
+  // Reads 'result.size()' bytes from 'file' at 'offset' into 'result'.
+  //
+  // 'file' and the memory backing 'result' must remain valid until 'cb' is
+  // invoked. If submission fails, an error is returned and 'cb' is not
+  // invoked.
+  Status ReadAsync(const RandomAccessFile* file, uint64_t offset, Slice result,
+                   StdStatusCallback cb) WARN_UNUSED_RESULT;
+
+  // Like ReadAsync(), but reads into each slice of 'results' in turn. The
+  // array viewed by 'results' must also remain valid until 'cb' is invoked.
+  Status ReadVAsync(const RandomAccessFile* file, uint64_t offset,
+                    ArrayView<Slice> results,
+                    StdStatusCallback cb) WARN_UNUSED_RESULT;
+
+  // Writes each slice of 'data' to 'file', beginning at 'offset'.
+  //
+  // Writes are positional, so concurrently outstanding writes to the same file
+  // may complete in any order. 'file', the array viewed by 'data' and the
+  // memory backing it must remain valid until 'cb' is invoked. If submission
+  // fails, an error is returned and 'cb' is not invoked.
+  Status WriteVAsync(RWFile* file, uint64_t offset, ArrayView<const Slice> data,
+                     StdStatusCallback cb) WARN_UNUSED_RESULT;
+
+  // Blocks until all operations submitted so far have completed and their
+  // callbacks have returned.
+  void Wait();
+
+ private:
+  explicit AsyncIOExecutor(gscoped_ptr<ThreadPool> pool);
+
+  gscoped_ptr<ThreadPool> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncIOExecutor);
+};
+
+} // namespace kudu
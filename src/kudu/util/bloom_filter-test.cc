@@ -89,4 +89,46 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+TEST(TestBloomFilter, TestSplitBlockInsertAndProbe) {
+  BloomFilterBuilder bfb(BloomFilterSizing::BySizeAndFPRate(4096, 0.01),
+                         BloomFilterFormat::SPLIT_BLOCK);
+  ASSERT_EQ(BloomFilterFormat::SPLIT_BLOCK, bfb.format());
+  ASSERT_EQ(8, bfb.n_hashes());
+  ASSERT_EQ(0, bfb.n_bits() % (BloomFilter::kSplitBlockBucketBytes * 8));
+
+  // The filter holds fewer keys than a classic one of the same size, so as
+  // to achieve the same false positive rate.
+  double expected_fp_rate = bfb.false_positive_rate();
+  ASSERT_LE(expected_fp_rate, 0.01);
+  ASSERT_GT(expected_fp_rate, 0.009);
+  ASSERT_LT(bfb.expected_count(),
+            BloomFilterSizing::BySizeAndFPRate(4096, 0.01).expected_count());
+
+  int n_keys = bfb.expected_count();
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+  BloomFilter bf(bfb.slice(), bfb.n_hashes(), BloomFilterFormat::SPLIT_BLOCK);
+  CheckRandomKeys(kRandomSeed, n_keys, bf);
+
+  uint32_t num_queries = 100000;
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    BloomKeyProbe probe(key_slice);
+    if (bf.MayContainKey(probe)) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  LOG(INFO) << "Expected FP rate: " << expected_fp_rate;
+  ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
+
+  // Readers unaware of the format are given no hash functions, and so treat
+  // every key as possibly present.
+  BloomFilter classic_bf(bfb.slice(), 0);
+  CheckRandomKeys(kRandomSeed + 1, 1000, classic_bf);
+}
+
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/util/bloom_filter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <ostream>
@@ -33,6 +34,44 @@ static int ComputeOptimalHashCount(size_t n_bits, size_t elems) {
   return n_hashes;
 }
 
+static const size_t kSplitBlockBucketBits = BloomFilter::kSplitBlockBucketBytes * 8;
+
+// Returns the false positive rate of a split-block filter of 'n_bits' bits
+// holding 'count' keys: the number of keys in a bucket follows a Poisson
+// distribution, and each key sets one bit of each of its 32-bit words.
+static double ComputeSplitBlockFalsePositiveRate(size_t n_bits, size_t count) {
+  const double lambda = static_cast<double>(count) * kSplitBlockBucketBits / n_bits;
+  double fp_rate = 0;
+  double p_keys = exp(-lambda);
+  for (int keys = 0; keys < lambda + 10 * sqrt(lambda) + 10; keys++) {
+    if (keys > 0) {
+      p_keys *= lambda / keys;
+    }
+    fp_rate += p_keys * pow(1 - pow(1 - 1.0 / 32, keys), 8);
+  }
+  return fp_rate;
+}
+
+// Returns the greatest number of keys for which a split-block filter of
+// 'n_bits' bits has at most the false positive rate of a classic filter of
+// 'classic_bits' bits sized for 'classic_count' keys.
+static size_t ComputeSplitBlockExpectedCount(size_t n_bits, size_t classic_bits,
+                                             size_t classic_count) {
+  const double fp_rate = exp(-static_cast<double>(classic_bits) / classic_count *
+                             kNaturalLog2 * kNaturalLog2);
+  size_t lo = 1;
+  size_t hi = std::max<size_t>(classic_count, 1);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (ComputeSplitBlockFalsePositiveRate(n_bits, mid) <= fp_rate) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
 BloomFilterSizing BloomFilterSizing::ByCountAndFPRate(
   size_t expected_count, double fp_rate) {
   CHECK_GT(fp_rate, 0);
@@ -56,11 +95,20 @@ BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_r
 }
 
 
-BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing)
-  : n_bits_(sizing.n_bytes() * 8),
-    bitmap_(new uint8_t[sizing.n_bytes()]),
-    n_hashes_(ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
-    expected_count_(sizing.expected_count()),
+BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing,
+                                       BloomFilterFormat format)
+  : format_(format),
+    n_bits_(format == BloomFilterFormat::SPLIT_BLOCK ?
+            std::max(sizing.n_bytes() * 8 / kSplitBlockBucketBits, static_cast<size_t>(1)) *
+                kSplitBlockBucketBits :
+            sizing.n_bytes() * 8),
+    bitmap_(new uint8_t[n_bits_ / 8]),
+    n_hashes_(format == BloomFilterFormat::SPLIT_BLOCK ? 8 :
+              ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
+    expected_count_(format == BloomFilterFormat::SPLIT_BLOCK ?
+                    ComputeSplitBlockExpectedCount(n_bits_, sizing.n_bytes() * 8,
+                                                   sizing.expected_count()) :
+                    sizing.expected_count()),
     n_inserted_(0) {
   Clear();
 }
@@ -75,14 +123,20 @@ double BloomFilterBuilder::false_positive_rate() const {
     << "expected_count_ not initialized: can't call this function on "
     << "a BloomFilter initialized from external data";
 
+  if (format_ == BloomFilterFormat::SPLIT_BLOCK) {
+    return ComputeSplitBlockFalsePositiveRate(n_bits_, expected_count_);
+  }
   return pow(1 - exp(-static_cast<double>(n_hashes_) * expected_count_ / n_bits_), n_hashes_);
 }
 
-BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
-  : n_bits_(data.size() * 8),
+BloomFilter::BloomFilter(const Slice &data, size_t n_hashes, BloomFilterFormat format)
+  : format_(format),
+    n_bits_(data.size() * 8),
     bitmap_(reinterpret_cast<const uint8_t *>(data.data())),
-    n_hashes_(n_hashes)
-{}
+    n_hashes_(n_hashes) {
+  DCHECK(format != BloomFilterFormat::SPLIT_BLOCK ||
+         (n_bits_ > 0 && n_bits_ % kSplitBlockBucketBits == 0)) << n_bits_;
+}
 
 
 
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/hash/city.h"
@@ -29,6 +30,20 @@
 
 namespace kudu {
 
+// The layout of the bitmap of a bloom filter.
+enum class BloomFilterFormat {
+  // Each key sets n_hashes bits scattered across the whole bitmap, so
+  // checking a key may take up to n_hashes cache misses.
+  CLASSIC,
+
+  // The bitmap is split into 32-byte buckets of eight 32-bit words. Each key
+  // sets one bit in each word of a single bucket, so checking it reads a
+  // single cache line, with a few independent operations which the compiler
+  // vectorizes. For the same size, the false positive rate is a bit higher
+  // than that of a classic filter.
+  SPLIT_BLOCK,
+};
+
 // Probe calculated from a given key. This caches the calculated
 // hash values which are necessary for probing into a Bloom Filter,
 // so that when many bloom filters have to be consulted for a given
@@ -70,6 +85,12 @@ class BloomKeyProbe {
     return h_1_;
   }
 
+  // The hash which picks the bucket of a split-block filter, independent
+  // of initial_hash(), which picks the bits set within the bucket.
+  uint32_t bucket_hash() const {
+    return h_2_;
+  }
+
   // Mix the given hash function with the second calculated hash
   // value. A sequence of independent hashes can be calculated
   // by repeatedly calling MixHash() on its previous result.
@@ -120,7 +141,12 @@ class BloomFilterBuilder {
  public:
   // Create a bloom filter.
   // See BloomFilterSizing static methods to specify this argument.
-  explicit BloomFilterBuilder(const BloomFilterSizing &sizing);
+  //
+  // The size of a SPLIT_BLOCK filter is rounded down to a whole number of
+  // buckets, and the number of keys it expects is lowered so that its false
+  // positive rate matches that of a classic filter with the same sizing.
+  explicit BloomFilterBuilder(const BloomFilterSizing &sizing,
+                              BloomFilterFormat format = BloomFilterFormat::CLASSIC);
 
   // Clear all entries, reset insertion count.
   void Clear();
@@ -149,6 +175,8 @@ class BloomFilterBuilder {
   // in the bloom filter.
   size_t n_hashes() const { return n_hashes_; }
 
+  BloomFilterFormat format() const { return format_; }
+
   size_t expected_count() const { return expected_count_; }
 
   // Return the number of keys inserted.
@@ -157,6 +185,8 @@ class BloomFilterBuilder {
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomFilterBuilder);
 
+  BloomFilterFormat format_;
+
   size_t n_bits_;
   gscoped_array<uint8_t> bitmap_;
 
@@ -174,16 +204,50 @@ class BloomFilterBuilder {
 // Wrapper around a byte array for reading it as a bloom filter.
 class BloomFilter {
  public:
-  BloomFilter() : bitmap_(nullptr) {}
-  BloomFilter(const Slice &data, size_t n_hashes);
+  BloomFilter() : format_(BloomFilterFormat::CLASSIC), bitmap_(nullptr) {}
+
+  // Wraps 'data' as a filter of the given format. 'n_hashes' is ignored for
+  // SPLIT_BLOCK filters, whose size must be a whole number of buckets.
+  BloomFilter(const Slice &data, size_t n_hashes,
+              BloomFilterFormat format = BloomFilterFormat::CLASSIC);
 
   // Return true if the filter may contain the given key.
   bool MayContainKey(const BloomKeyProbe &probe) const;
 
+  // Prefetch the parts of the bitmap which MayContainKey() reads first for
+  // the given key. Prefetching for a batch of keys before checking them
+  // overlaps the cache misses of their lookups.
+  void PrefetchKey(const BloomKeyProbe &probe) const;
+
+  // Return a slice view into the filter's bitmap.
+  Slice slice() const {
+    return Slice(bitmap_, n_bits_ / 8);
+  }
+
+  // Return the number of hashes that are calculated for each key.
+  size_t n_hashes() const { return n_hashes_; }
+
+  BloomFilterFormat format() const { return format_; }
+
+  // The size of a bucket of a SPLIT_BLOCK filter.
+  static const size_t kSplitBlockBucketBytes = 32;
+
  private:
   friend class BloomFilterBuilder;
   static uint32_t PickBit(uint32_t hash, size_t n_bits);
 
+  // Returns the offset of the bucket of a SPLIT_BLOCK filter of 'n_bits'
+  // bits which 'probe' maps to.
+  static size_t PickBucket(const BloomKeyProbe &probe, size_t n_bits);
+
+  // Fills 'masks' with the bit of each word of its bucket set for 'probe'
+  // in a SPLIT_BLOCK filter.
+  static void SplitBlockMasks(const BloomKeyProbe &probe, uint32_t* masks);
+
+  bool SplitBlockMayContainKey(const BloomKeyProbe &probe) const;
+
+  BloomFilterFormat format_;
+
   size_t n_bits_;
   const uint8_t *bitmap_;
 
@@ -207,7 +271,53 @@ inline uint32_t BloomFilter::PickBit(uint32_t hash, size_t n_bits) {
   }
 }
 
+inline size_t BloomFilter::PickBucket(const BloomKeyProbe &probe, size_t n_bits) {
+  const uint64_t n_buckets = n_bits / (kSplitBlockBucketBytes * 8);
+  return ((static_cast<uint64_t>(probe.bucket_hash()) * n_buckets) >> 32) *
+      kSplitBlockBucketBytes;
+}
+
+inline void BloomFilter::SplitBlockMasks(const BloomKeyProbe &probe, uint32_t* masks) {
+  // The salts of the split-block filters of Parquet and Impala, which are
+  // odd and spread the bits well.
+  static const uint32_t kSalts[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+  };
+  const uint32_t h = probe.initial_hash();
+  for (int i = 0; i < 8; i++) {
+    masks[i] = 1U << ((h * kSalts[i]) >> 27);
+  }
+}
+
+inline bool BloomFilter::SplitBlockMayContainKey(const BloomKeyProbe &probe) const {
+  uint32_t masks[8];
+  SplitBlockMasks(probe, masks);
+  // The bucket may not be aligned within its block.
+  uint32_t bucket[8];
+  memcpy(bucket, &bitmap_[PickBucket(probe, n_bits_)], sizeof(bucket));
+  uint32_t missing = 0;
+  for (int i = 0; i < 8; i++) {
+    missing |= masks[i] & ~bucket[i];
+  }
+  return missing == 0;
+}
+
 inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
+  if (format_ == BloomFilterFormat::SPLIT_BLOCK) {
+    uint32_t masks[8];
+    BloomFilter::SplitBlockMasks(probe, masks);
+    uint32_t bucket[8];
+    uint8_t* dst = &bitmap_[BloomFilter::PickBucket(probe, n_bits_)];
+    memcpy(bucket, dst, sizeof(bucket));
+    for (int i = 0; i < 8; i++) {
+      bucket[i] |= masks[i];
+    }
+    memcpy(dst, bucket, sizeof(bucket));
+    n_inserted_++;
+    return;
+  }
+
   uint32_t h = probe.initial_hash();
   for (size_t i = 0; i < n_hashes_; i++) {
     uint32_t bitpos = BloomFilter::PickBit(h, n_bits_);
@@ -217,7 +327,25 @@ inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
   n_inserted_++;
 }
 
+inline void BloomFilter::PrefetchKey(const BloomKeyProbe &probe) const {
+  if (format_ == BloomFilterFormat::SPLIT_BLOCK) {
+    prefetch(reinterpret_cast<const char *>(&bitmap_[PickBucket(probe, n_bits_)]),
+             PREFETCH_HINT_T0);
+    return;
+  }
+  // MayContainKey() reads the first two bit positions together.
+  uint32_t h = probe.initial_hash();
+  for (size_t i = 0; i < n_hashes_ && i < 2; i++) {
+    uint32_t bitpos = PickBit(h, n_bits_);
+    prefetch(reinterpret_cast<const char *>(&bitmap_[bitpos >> 3]), PREFETCH_HINT_T0);
+    h = probe.MixHash(h);
+  }
+}
+
 inline bool BloomFilter::MayContainKey(const BloomKeyProbe &probe) const {
+  if (format_ == BloomFilterFormat::SPLIT_BLOCK) {
+    return SplitBlockMayContainKey(probe);
+  }
   uint32_t h = probe.initial_hash();
 
   // Basic unrolling by 2s gives a small benefit here since the two bit positions
@@ -3,9 +3,14 @@
 // found in the LICENSE file.
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <memory>
+#include <ostream>
+#include <random>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -23,6 +28,7 @@
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
@@ -30,6 +36,14 @@
 DECLARE_string(nvm_cache_path);
 #endif // defined(__linux__)
 
+DEFINE_int32(cache_trace_accesses, 200000,
+             "Number of accesses replayed by the scan/lookup trace benchmark");
+DEFINE_int32(cache_lookup_threads, 8,
+             "Number of threads used by the multi-threaded lookup benchmark");
+DEFINE_int32(cache_lookups_per_thread, 200000,
+             "Number of lookups done by each thread of the multi-threaded "
+             "lookup benchmark");
+
 namespace kudu {
 
 // Conversions between numeric keys/values and the types expected by Cache.
@@ -44,7 +58,8 @@ static int DecodeInt(const Slice& k) {
 }
 
 class CacheTest : public KuduTest,
-                  public ::testing::WithParamInterface<CacheType>,
+                  public ::testing::WithParamInterface<
+                      std::pair<CacheType, CacheEvictionPolicy>>,
                   public Cache::EvictionCallback {
  public:
 
@@ -70,12 +85,12 @@ class CacheTest : public KuduTest,
     }
 #endif // defined(__linux__)
 
-    cache_.reset(NewLRUCache(GetParam(), kCacheSize, "cache_test"));
+    cache_.reset(NewCache(GetParam().first, GetParam().second, kCacheSize, "cache_test"));
 
     MemTracker::FindTracker("cache_test-sharded_lru_cache", &mem_tracker_);
     // Since nvm cache does not have memtracker due to the use of
     // tcmalloc for this we only check for it in the DRAM case.
-    if (GetParam() == DRAM_CACHE) {
+    if (GetParam().first == DRAM_CACHE) {
       ASSERT_TRUE(mem_tracker_.get());
     }
 
@@ -108,9 +123,16 @@ class CacheTest : public KuduTest,
 };
 
 #if defined(__linux__)
-INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(DRAM_CACHE, NVM_CACHE));
+INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::LRU),
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::SLRU_TINYLFU),
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::CLOCK),
+    std::make_pair(NVM_CACHE, CacheEvictionPolicy::LRU)));
 #else
-INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(DRAM_CACHE));
+INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::LRU),
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::SLRU_TINYLFU),
+    std::make_pair(DRAM_CACHE, CacheEvictionPolicy::CLOCK)));
 #endif // defined(__linux__)
 
 TEST_P(CacheTest, TrackMemory) {
@@ -237,4 +259,65 @@ TEST_P(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+// Replays a trace which interleaves lookups of a hot set of keys, which fits
+// in the cache, with a scan of keys which are each accessed once. Entries are
+// inserted on a miss, as the block cache does.
+TEST_P(CacheTest, ScanLookupTraceBenchmark) {
+  const int kNumEntries = 10000;
+  const int kNumHotKeys = kNumEntries / 2;
+  const int kCharge = kCacheSize / kNumEntries;
+  std::mt19937 rng(SeedRandom());
+  int scan_key = kNumEntries;
+  int64_t hot_lookups = 0;
+  int64_t hot_hits = 0;
+  LOG_TIMING(INFO, "replaying the scan/lookup trace") {
+    for (int i = 0; i < FLAGS_cache_trace_accesses; i++) {
+      bool hot = rng() % 2 == 0;
+      int key = hot ? rng() % kNumHotKeys : scan_key++;
+      bool hit = Lookup(key) != -1;
+      if (!hit) {
+        Insert(key, key, kCharge);
+      }
+      // Only count once the hot set has had the chance to be cached.
+      if (hot && i >= FLAGS_cache_trace_accesses / 4) {
+        hot_lookups++;
+        hot_hits += hit ? 1 : 0;
+      }
+    }
+  }
+  double hit_ratio = static_cast<double>(hot_hits) / hot_lookups;
+  LOG(INFO) << "Hot set hit ratio: " << hit_ratio;
+  if (GetParam().second == CacheEvictionPolicy::SLRU_TINYLFU) {
+    ASSERT_GT(hit_ratio, 0.8);
+  }
+}
+
+// Looks up a small set of hot keys from many threads at once, as concurrent
+// scans do with the index and bloom blocks of a tablet.
+TEST_P(CacheTest, MultiThreadedLookupBenchmark) {
+  const int kNumHotKeys = 64;
+  for (int i = 0; i < kNumHotKeys; i++) {
+    Insert(i, i);
+  }
+  std::vector<std::thread> threads;
+  Stopwatch sw;
+  sw.start();
+  for (int t = 0; t < FLAGS_cache_lookup_threads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < FLAGS_cache_lookups_per_thread; i++) {
+        int key = (i + t) % kNumHotKeys;
+        CHECK_EQ(key, Lookup(key));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  int64_t total_lookups = static_cast<int64_t>(FLAGS_cache_lookup_threads) *
+      FLAGS_cache_lookups_per_thread;
+  LOG(INFO) << "Lookups per second with " << FLAGS_cache_lookup_threads << " threads: "
+            << total_lookups / sw.elapsed().wall_seconds();
+}
+
 }  // namespace kudu
@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <memory>
@@ -72,6 +73,8 @@ struct LRUHandle {
   uint32_t val_length;
   Atomic32 refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  uint8_t segment;    // The list holding the entry; only used by SLRUCache
+  Atomic32 clock_count;  // Bumped by lookups; only used by ClockCache
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -387,6 +390,629 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
+// A count-min sketch of 4-bit counters which estimates how often each key has
+// been accessed recently. Every counter is halved once the sketch has counted
+// ten accesses per counter, so that old popularity fades away.
+class FrequencySketch {
+ public:
+  FrequencySketch() {
+    Resize(kMinCounters);
+  }
+
+  // Makes sure the sketch has at least 'n' counters. Growing the sketch
+  // forgets all of the counts so far.
+  void EnsureCapacity(size_t n) {
+    if (n > num_counters_) {
+      Resize(std::max<size_t>(num_counters_ * 2, 1ULL << Bits::Log2Ceiling64(n)));
+    }
+  }
+
+  void Increment(uint32_t hash) {
+    for (int i = 0; i < kDepth; i++) {
+      size_t idx = Index(hash, i);
+      uint64_t& word = table_[idx / kCountersPerWord];
+      int shift = (idx % kCountersPerWord) * 4;
+      if (((word >> shift) & 0xf) != 0xf) {
+        word += 1ULL << shift;
+      }
+    }
+    if (++additions_ >= 10 * num_counters_) {
+      Age();
+    }
+  }
+
+  int Estimate(uint32_t hash) const {
+    int ret = 0xf;
+    for (int i = 0; i < kDepth; i++) {
+      size_t idx = Index(hash, i);
+      int count = (table_[idx / kCountersPerWord] >> ((idx % kCountersPerWord) * 4)) & 0xf;
+      ret = std::min(ret, count);
+    }
+    return ret;
+  }
+
+ private:
+  static constexpr int kDepth = 4;
+  static constexpr size_t kCountersPerWord = 16;
+  static constexpr size_t kMinCounters = 64;
+
+  void Resize(size_t num_counters) {
+    DCHECK_EQ(0, num_counters & (num_counters - 1));
+    num_counters_ = num_counters;
+    table_.assign(num_counters / kCountersPerWord, 0);
+    additions_ = 0;
+  }
+
+  void Age() {
+    for (uint64_t& word : table_) {
+      word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions_ /= 2;
+  }
+
+  size_t Index(uint32_t hash, int i) const {
+    // The shards are picked with the top bits of the hash, so remix it for
+    // each row of the sketch.
+    uint64_t h = (static_cast<uint64_t>(hash) + i + 1) * 0x9E3779B97F4A7C15ULL;
+    return (h >> 32) & (num_counters_ - 1);
+  }
+
+  vector<uint64_t> table_;
+  size_t num_counters_;
+  size_t additions_;
+};
+
+// A single shard of a cache which uses W-TinyLFU eviction.
+//
+// New entries are inserted into a small LRU "window". Entries evicted from
+// the window are only admitted into the main cache if they have been accessed
+// more often than the entry they would displace, according to a frequency
+// sketch. The main cache is a segmented LRU: admitted entries start on the
+// probationary segment, and are promoted to the protected segment when they
+// are accessed again.
+class SLRUCache {
+ public:
+  explicit SLRUCache(MemTracker* tracker);
+  ~SLRUCache();
+
+  void SetCapacity(size_t capacity);
+
+  void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
+
+  Cache::Handle* Insert(LRUHandle* handle, Cache::EvictionCallback* eviction_callback);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+
+ private:
+  enum Segment {
+    kWindow,
+    kProbation,
+    kProtected,
+    kNumSegments
+  };
+
+  // Removes 'e' from the list of its segment.
+  void List_Remove(LRUHandle* e);
+  // Makes 'e' the newest entry of 'segment'.
+  void List_Append(LRUHandle* e, Segment segment);
+
+  // Returns the oldest entry of 'segment', or null if it's empty.
+  LRUHandle* Oldest(Segment segment) {
+    LRUHandle* e = lists_[segment].next;
+    return e == &lists_[segment] ? nullptr : e;
+  }
+
+  // Removes 'e' from the cache, adding it to 'to_remove_head' if this was the
+  // cache's last reference.
+  void Evict(LRUHandle* e, LRUHandle** to_remove_head);
+
+  // Moves entries out of the window and the protected segment until they fit
+  // in their capacities, and evicts entries until the cache fits in its own.
+  void Rebalance(LRUHandle** to_remove_head);
+
+  bool Unref(LRUHandle* e);
+  void FreeEntry(LRUHandle* e);
+
+  // Initialized before use.
+  size_t capacity_;
+  size_t window_capacity_;
+  size_t protected_capacity_;
+
+  // mutex_ protects the following state.
+  MutexType mutex_;
+  size_t usage_[kNumSegments];
+
+  // Dummy heads of the segments' lists. The 'prev' of each is its newest
+  // entry, and the 'next' its oldest.
+  LRUHandle lists_[kNumSegments];
+
+  HandleTable table_;
+  size_t num_entries_;
+  FrequencySketch sketch_;
+
+  MemTracker* mem_tracker_;
+
+  CacheMetrics* metrics_;
+};
+
+SLRUCache::SLRUCache(MemTracker* tracker)
+    : capacity_(0),
+      window_capacity_(0),
+      protected_capacity_(0),
+      num_entries_(0),
+      mem_tracker_(tracker),
+      metrics_(nullptr) {
+  for (int i = 0; i < kNumSegments; i++) {
+    usage_[i] = 0;
+    lists_[i].next = &lists_[i];
+    lists_[i].prev = &lists_[i];
+  }
+}
+
+SLRUCache::~SLRUCache() {
+  for (LRUHandle& list : lists_) {
+    for (LRUHandle* e = list.next; e != &list; ) {
+      LRUHandle* next = e->next;
+      DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
+    }
+  }
+}
+
+void SLRUCache::SetCapacity(size_t capacity) {
+  // The proportions recommended by the W-TinyLFU paper: a window of 1% of the
+  // cache, and a protected segment of 80% of the rest.
+  capacity_ = capacity;
+  window_capacity_ = std::max<size_t>(capacity / 100, 1);
+  protected_capacity_ = (capacity - window_capacity_) * 4 / 5;
+}
+
+bool SLRUCache::Unref(LRUHandle* e) {
+  DCHECK_GT(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  return !base::RefCountDec(&e->refs);
+}
+
+void SLRUCache::FreeEntry(LRUHandle* e) {
+  DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  if (e->eviction_callback) {
+    e->eviction_callback->EvictedEntry(e->key(), e->value());
+  }
+  mem_tracker_->Release(e->charge);
+  if (PREDICT_TRUE(metrics_)) {
+    metrics_->cache_usage->DecrementBy(e->charge);
+    metrics_->evictions->Increment();
+  }
+  delete [] e;
+}
+
+void SLRUCache::List_Remove(LRUHandle* e) {
+  e->next->prev = e->prev;
+  e->prev->next = e->next;
+  usage_[e->segment] -= e->charge;
+}
+
+void SLRUCache::List_Append(LRUHandle* e, Segment segment) {
+  LRUHandle* list = &lists_[segment];
+  e->segment = segment;
+  e->next = list;
+  e->prev = list->prev;
+  e->prev->next = e;
+  e->next->prev = e;
+  usage_[segment] += e->charge;
+}
+
+void SLRUCache::Evict(LRUHandle* e, LRUHandle** to_remove_head) {
+  List_Remove(e);
+  table_.Remove(e->key(), e->hash);
+  num_entries_--;
+  if (Unref(e)) {
+    e->next = *to_remove_head;
+    *to_remove_head = e;
+  }
+}
+
+void SLRUCache::Rebalance(LRUHandle** to_remove_head) {
+  // Demote the oldest protected entries to probation.
+  while (usage_[kProtected] > protected_capacity_) {
+    LRUHandle* e = Oldest(kProtected);
+    List_Remove(e);
+    List_Append(e, kProbation);
+  }
+
+  // The newest entry always stays in the window, however large it is, so
+  // that it gets a chance to be accessed again.
+  const size_t main_capacity = capacity_ - window_capacity_;
+  while (usage_[kWindow] > window_capacity_ &&
+         Oldest(kWindow) != lists_[kWindow].prev) {
+    // The oldest entry of the window is a candidate for the main cache. If
+    // there's no room for it, it has to be accessed more often than the
+    // entry it would replace.
+    LRUHandle* candidate = Oldest(kWindow);
+    LRUHandle* victim = Oldest(kProbation);
+    if (victim == nullptr) {
+      victim = Oldest(kProtected);
+    }
+    if (victim != nullptr &&
+        usage_[kProbation] + usage_[kProtected] + candidate->charge > main_capacity &&
+        sketch_.Estimate(candidate->hash) <= sketch_.Estimate(victim->hash)) {
+      Evict(candidate, to_remove_head);
+      continue;
+    }
+    List_Remove(candidate);
+    List_Append(candidate, kProbation);
+  }
+
+  // Make room for whatever was admitted, oldest entries first.
+  while (usage_[kProbation] + usage_[kProtected] > main_capacity) {
+    LRUHandle* e = Oldest(kProbation);
+    if (e == nullptr) {
+      e = Oldest(kProtected);
+    }
+    Evict(e, to_remove_head);
+  }
+}
+
+Cache::Handle* SLRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
+  LRUHandle* e;
+  LRUHandle* to_remove_head = nullptr;
+  {
+    std::lock_guard<MutexType> l(mutex_);
+    // Misses count too: they're likely to be followed by an insert.
+    sketch_.Increment(hash);
+    e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      base::RefCountInc(&e->refs);
+      Segment segment = static_cast<Segment>(e->segment);
+      List_Remove(e);
+      if (segment == kWindow) {
+        List_Append(e, kWindow);
+      } else {
+        List_Append(e, kProtected);
+        Rebalance(&to_remove_head);
+      }
+    }
+  }
+  while (to_remove_head != nullptr) {
+    LRUHandle* next = to_remove_head->next;
+    FreeEntry(to_remove_head);
+    to_remove_head = next;
+  }
+
+  // Do the metrics outside of the lock.
+  if (metrics_) {
+    metrics_->lookups->Increment();
+    bool was_hit = (e != nullptr);
+    if (was_hit) {
+      if (caching) {
+        metrics_->cache_hits_caching->Increment();
+      } else {
+        metrics_->cache_hits->Increment();
+      }
+    } else {
+      if (caching) {
+        metrics_->cache_misses_caching->Increment();
+      } else {
+        metrics_->cache_misses->Increment();
+      }
+    }
+  }
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void SLRUCache::Release(Cache::Handle* handle) {
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  bool last_reference = Unref(e);
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
+Cache::Handle* SLRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_callback) {
+  e->eviction_callback = eviction_callback;
+  e->refs = 2;  // One from SLRUCache, one for the returned handle
+  mem_tracker_->Consume(e->charge);
+  if (PREDICT_TRUE(metrics_)) {
+    metrics_->cache_usage->IncrementBy(e->charge);
+    metrics_->inserts->Increment();
+  }
+
+  LRUHandle* to_remove_head = nullptr;
+  {
+    std::lock_guard<MutexType> l(mutex_);
+
+    List_Append(e, kWindow);
+    LRUHandle* old = table_.Insert(e);
+    if (old != nullptr) {
+      List_Remove(old);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    } else {
+      // A few counters per entry keep the collisions between keys rare.
+      sketch_.EnsureCapacity(4 * ++num_entries_);
+    }
+    sketch_.Increment(e->hash);
+    Rebalance(&to_remove_head);
+  }
+
+  // we free the entries here outside of mutex for
+  // performance reasons
+  while (to_remove_head != nullptr) {
+    LRUHandle* next = to_remove_head->next;
+    FreeEntry(to_remove_head);
+    to_remove_head = next;
+  }
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void SLRUCache::Erase(const Slice& key, uint32_t hash) {
+  LRUHandle* e;
+  bool last_reference = false;
+  {
+    std::lock_guard<MutexType> l(mutex_);
+    e = table_.Remove(key, hash);
+    if (e != nullptr) {
+      List_Remove(e);
+      num_entries_--;
+      last_reference = Unref(e);
+    }
+  }
+  // mutex not held here
+  // last_reference will only be true if e != NULL
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
+// A single shard of a cache which approximates LRU eviction with the CLOCK
+// algorithm.
+//
+// Lookups don't reorder any list: they only take a reference on the entry
+// and bump its clock count, which saturates at kMaxClockCount. So they take
+// the shard's lock in shared mode, and because that's a per-CPU lock,
+// concurrent lookups of the same hot entries don't contend on it. Inserts and
+// erases take the lock exclusively. To make room, the clock hand sweeps the
+// entries in insertion order, decrementing the clock counts and evicting the
+// entries whose count is already zero. Counting rather than using a single
+// reference bit keeps a frequently read entry cached when every other entry
+// has been read once since the last sweep.
+class ClockCache {
+ public:
+  explicit ClockCache(MemTracker* tracker);
+  ~ClockCache();
+
+  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+
+  void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
+
+  Cache::Handle* Insert(LRUHandle* handle, Cache::EvictionCallback* eviction_callback);
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+
+ private:
+  // Removes 'e' from the clock, moving the hand past it if needed.
+  void Clock_Remove(LRUHandle* e);
+  // Adds 'e' just behind the hand, so that it's the last entry to be swept.
+  void Clock_Insert(LRUHandle* e);
+
+  bool Unref(LRUHandle* e);
+  void FreeEntry(LRUHandle* e);
+
+  static constexpr Atomic32 kMaxClockCount = 3;
+
+  // Initialized before use.
+  size_t capacity_;
+
+  // Taken in shared mode by lookups, and exclusively to modify the following
+  // state.
+  percpu_rwlock lock_;
+  size_t usage_;
+
+  // Dummy head of the circular list of entries, in insertion order.
+  LRUHandle clock_;
+
+  // The next entry to be swept. When it reaches &clock_, the sweep wraps
+  // around to the oldest entry.
+  LRUHandle* hand_;
+
+  HandleTable table_;
+
+  MemTracker* mem_tracker_;
+
+  CacheMetrics* metrics_;
+};
+
+ClockCache::ClockCache(MemTracker* tracker)
+    : capacity_(0),
+      usage_(0),
+      hand_(&clock_),
+      mem_tracker_(tracker),
+      metrics_(nullptr) {
+  clock_.next = &clock_;
+  clock_.prev = &clock_;
+}
+
+ClockCache::~ClockCache() {
+  for (LRUHandle* e = clock_.next; e != &clock_; ) {
+    LRUHandle* next = e->next;
+    DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+    if (Unref(e)) {
+      FreeEntry(e);
+    }
+    e = next;
+  }
+}
+
+bool ClockCache::Unref(LRUHandle* e) {
+  DCHECK_GT(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  return !base::RefCountDec(&e->refs);
+}
+
+void ClockCache::FreeEntry(LRUHandle* e) {
+  DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  if (e->eviction_callback) {
+    e->eviction_callback->EvictedEntry(e->key(), e->value());
+  }
+  mem_tracker_->Release(e->charge);
+  if (PREDICT_TRUE(metrics_)) {
+    metrics_->cache_usage->DecrementBy(e->charge);
+    metrics_->evictions->Increment();
+  }
+  delete [] e;
+}
+
+void ClockCache::Clock_Remove(LRUHandle* e) {
+  if (hand_ == e) {
+    hand_ = e->next;
+  }
+  e->next->prev = e->prev;
+  e->prev->next = e->next;
+  usage_ -= e->charge;
+}
+
+void ClockCache::Clock_Insert(LRUHandle* e) {
+  LRUHandle* next = hand_;
+  e->next = next;
+  e->prev = next->prev;
+  e->prev->next = e;
+  e->next->prev = e;
+  usage_ += e->charge;
+}
+
+Cache::Handle* ClockCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
+  LRUHandle* e;
+  {
+    shared_lock<rw_spinlock> l(lock_.get_lock());
+    e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      base::RefCountInc(&e->refs);
+      // Concurrent lookups may race to bump the count, in which case some of
+      // the bumps are lost: that's fine, since it's only an approximation.
+      // Once it's saturated, avoid dirtying the cache line.
+      Atomic32 count = base::subtle::NoBarrier_Load(&e->clock_count);
+      if (count < kMaxClockCount) {
+        base::subtle::NoBarrier_Store(&e->clock_count, count + 1);
+      }
+    }
+  }
+
+  // Do the metrics outside of the lock.
+  if (metrics_) {
+    metrics_->lookups->Increment();
+    bool was_hit = (e != nullptr);
+    if (was_hit) {
+      if (caching) {
+        metrics_->cache_hits_caching->Increment();
+      } else {
+        metrics_->cache_hits->Increment();
+      }
+    } else {
+      if (caching) {
+        metrics_->cache_misses_caching->Increment();
+      } else {
+        metrics_->cache_misses->Increment();
+      }
+    }
+  }
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCache::Release(Cache::Handle* handle) {
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  bool last_reference = Unref(e);
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
+Cache::Handle* ClockCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_callback) {
+  e->eviction_callback = eviction_callback;
+  e->refs = 2;  // One from ClockCache, one for the returned handle
+  e->clock_count = 0;
+  mem_tracker_->Consume(e->charge);
+  if (PREDICT_TRUE(metrics_)) {
+    metrics_->cache_usage->IncrementBy(e->charge);
+    metrics_->inserts->Increment();
+  }
+
+  LRUHandle* to_remove_head = nullptr;
+  {
+    std::lock_guard<percpu_rwlock> l(lock_);
+
+    LRUHandle* old = table_.Insert(e);
+    if (old != nullptr) {
+      Clock_Remove(old);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
+    Clock_Insert(e);
+
+    // Lookups can't bump any clock counts while the lock is held, so this
+    // takes at most kMaxClockCount + 1 turns of the clock.
+    while (usage_ > capacity_ && clock_.next != &clock_) {
+      if (hand_ == &clock_) {
+        hand_ = clock_.next;
+      }
+      LRUHandle* victim = hand_;
+      // The new entry is only evicted if there's nothing else left to evict.
+      if (victim == e && e->next != e->prev) {
+        hand_ = e->next;
+        continue;
+      }
+      if (victim->clock_count > 0) {
+        victim->clock_count--;
+        hand_ = victim->next;
+        continue;
+      }
+      Clock_Remove(victim);
+      table_.Remove(victim->key(), victim->hash);
+      if (Unref(victim)) {
+        victim->next = to_remove_head;
+        to_remove_head = victim;
+      }
+    }
+  }
+
+  // we free the entries here outside of mutex for
+  // performance reasons
+  while (to_remove_head != nullptr) {
+    LRUHandle* next = to_remove_head->next;
+    FreeEntry(to_remove_head);
+    to_remove_head = next;
+  }
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCache::Erase(const Slice& key, uint32_t hash) {
+  LRUHandle* e;
+  bool last_reference = false;
+  {
+    std::lock_guard<percpu_rwlock> l(lock_);
+    e = table_.Remove(key, hash);
+    if (e != nullptr) {
+      Clock_Remove(e);
+      last_reference = Unref(e);
+    }
+  }
+  // mutex not held here
+  // last_reference will only be true if e != NULL
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
 // Determine the number of bits of the hash that should be used to determine
 // the cache shard. This, in turn, determines the number of shards.
 int DetermineShardBits() {
@@ -396,11 +1022,14 @@ int DetermineShardBits() {
   return bits;
 }
 
+// A cache which is split into shards of type 'CacheShard' (LRUCache, SLRUCache
+// or ClockCache) by the hashes of the keys.
+template <class CacheShard>
 class ShardedLRUCache : public Cache {
  private:
   shared_ptr<MemTracker> mem_tracker_;
   gscoped_ptr<CacheMetrics> metrics_;
-  vector<LRUCache*> shards_;
+  vector<CacheShard*> shards_;
 
   // Number of bits of hash used to determine the shard.
   const int shard_bits_;
@@ -432,7 +1061,7 @@ class ShardedLRUCache : public Cache {
     int num_shards = 1 << shard_bits_;
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
     for (int s = 0; s < num_shards; s++) {
-      gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get()));
+      gscoped_ptr<CacheShard> shard(new CacheShard(mem_tracker_.get()));
       shard->SetCapacity(per_shard);
       shards_.push_back(shard.release());
     }
@@ -473,7 +1102,7 @@ class ShardedLRUCache : public Cache {
       return;
     }
     metrics_.reset(new CacheMetrics(entity));
-    for (LRUCache* cache : shards_) {
+    for (CacheShard* cache : shards_) {
       cache->SetMetrics(metrics_.get());
     }
   }
@@ -511,11 +1140,25 @@ class ShardedLRUCache : public Cache {
 }  // end anonymous namespace
 
 Cache* NewLRUCache(CacheType type, size_t capacity, const string& id) {
+  return NewCache(type, CacheEvictionPolicy::LRU, capacity, id);
+}
+
+Cache* NewCache(CacheType type, CacheEvictionPolicy policy, size_t capacity,
+                const string& id) {
   switch (type) {
     case DRAM_CACHE:
-      return new ShardedLRUCache(capacity, id);
+      switch (policy) {
+        case CacheEvictionPolicy::SLRU_TINYLFU:
+          return new ShardedLRUCache<SLRUCache>(capacity, id);
+        case CacheEvictionPolicy::CLOCK:
+          return new ShardedLRUCache<ClockCache>(capacity, id);
+        default:
+          return new ShardedLRUCache<LRUCache>(capacity, id);
+      }
 #if !defined(__APPLE__)
     case NVM_CACHE:
+      CHECK(policy == CacheEvictionPolicy::LRU)
+          << "NVM caches only support LRU eviction";
       return NewLRUNvmCache(capacity, id);
 #endif
     default:
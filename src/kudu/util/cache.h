@@ -37,10 +37,30 @@ enum CacheType {
   NVM_CACHE
 };
 
+enum class CacheEvictionPolicy {
+  // Evict the least-recently-used entry.
+  LRU,
+
+  // Segmented LRU with a TinyLFU admission filter. New entries only displace
+  // entries which have been accessed less often recently, so a scan of
+  // entries which are each used once can't flush the frequently used ones.
+  // Only supported by DRAM_CACHE.
+  SLRU_TINYLFU,
+
+  // Approximately LRU, using the CLOCK algorithm. Lookups don't contend with
+  // each other, at the cost of more expensive inserts and erases. Only
+  // supported by DRAM_CACHE.
+  CLOCK,
+};
+
 // Create a new cache with a fixed size capacity.  This implementation
 // of Cache uses a least-recently-used eviction policy.
 Cache* NewLRUCache(CacheType type, size_t capacity, const std::string& id);
 
+// Create a new cache with a fixed size capacity and the given eviction policy.
+Cache* NewCache(CacheType type, CacheEvictionPolicy policy, size_t capacity,
+                const std::string& id);
+
 class Cache {
  public:
   // Callback interface which is called when an entry is evicted from the
@@ -45,6 +45,68 @@ METRIC_DEFINE_counter(server, block_cache_hits_caching,
                       "Use this number instead of cache_hits when trying to determine how "
                       "efficient the cache is");
 
+METRIC_DEFINE_counter(server, block_cache_data_hits,
+                      "Block Cache Data Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of CFile data blocks that found the block");
+METRIC_DEFINE_counter(server, block_cache_data_misses,
+                      "Block Cache Data Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of CFile data blocks that didn't find the block");
+METRIC_DEFINE_counter(server, block_cache_index_hits,
+                      "Block Cache Index Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of CFile index and zone map blocks that found "
+                      "the block");
+METRIC_DEFINE_counter(server, block_cache_index_misses,
+                      "Block Cache Index Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of CFile index and zone map blocks that didn't "
+                      "find the block");
+METRIC_DEFINE_counter(server, block_cache_bloom_hits,
+                      "Block Cache Bloom Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of bloom filter blocks that found the block");
+METRIC_DEFINE_counter(server, block_cache_bloom_misses,
+                      "Block Cache Bloom Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of bloom filter blocks that didn't find the block");
+METRIC_DEFINE_counter(server, block_cache_dictionary_hits,
+                      "Block Cache Dictionary Block Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of dictionary blocks that found the block");
+METRIC_DEFINE_counter(server, block_cache_dictionary_misses,
+                      "Block Cache Dictionary Block Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of dictionary blocks that didn't find the block");
+
+METRIC_DEFINE_counter(server, block_cache_decompressions,
+                      "Block Cache Decompressions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks which were kept compressed in the cache and "
+                      "decompressed when read");
+METRIC_DEFINE_counter(server, block_cache_decompressed_bytes,
+                      "Block Cache Decompressed Bytes", kudu::MetricUnit::kBytes,
+                      "Uncompressed size of the blocks which were kept compressed in "
+                      "the cache and decompressed when read. Compared with the cache "
+                      "usage, this shows how much more data the cache serves than it holds");
+METRIC_DEFINE_counter(server, block_cache_decompression_time_us,
+                      "Block Cache Decompression Time", kudu::MetricUnit::kMicroseconds,
+                      "Time spent decompressing the blocks which were kept compressed "
+                      "in the cache");
+
+METRIC_DEFINE_counter(server, block_cache_ssd_hits,
+                      "Block Cache SSD Hits", kudu::MetricUnit::kBlocks,
+                      "Number of blocks missing from the in-memory block cache which "
+                      "were found in its SSD tier");
+METRIC_DEFINE_counter(server, block_cache_ssd_misses,
+                      "Block Cache SSD Misses", kudu::MetricUnit::kBlocks,
+                      "Number of blocks missing from the in-memory block cache which "
+                      "weren't found in its SSD tier either");
+METRIC_DEFINE_counter(server, block_cache_ssd_inserts,
+                      "Block Cache SSD Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from memory which were written to the "
+                      "SSD tier of the block cache");
+METRIC_DEFINE_counter(server, block_cache_ssd_inserted_bytes,
+                      "Block Cache SSD Inserted Bytes", kudu::MetricUnit::kBytes,
+                      "Size of the blocks written to the SSD tier of the block cache");
+METRIC_DEFINE_counter(server, block_cache_ssd_rejections,
+                      "Block Cache SSD Rejections", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from memory which weren't written to the "
+                      "SSD tier of the block cache, because they were evicted for the "
+                      "first time, were too large, or the writes were falling behind");
+
 METRIC_DEFINE_gauge_uint64(server, block_cache_usage, "Block Cache Memory Usage",
                            kudu::MetricUnit::kBytes,
                            "Memory consumed by the block cache");
@@ -63,6 +125,31 @@ CacheMetrics::CacheMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(cache_misses_caching, block_cache_misses_caching),
     GINIT(cache_usage, block_cache_usage) {
 }
+
+BlockCacheTypeMetrics::BlockCacheTypeMetrics(const scoped_refptr<MetricEntity>& entity)
+  : MINIT(data_hits, block_cache_data_hits),
+    MINIT(data_misses, block_cache_data_misses),
+    MINIT(index_hits, block_cache_index_hits),
+    MINIT(index_misses, block_cache_index_misses),
+    MINIT(bloom_hits, block_cache_bloom_hits),
+    MINIT(bloom_misses, block_cache_bloom_misses),
+    MINIT(dictionary_hits, block_cache_dictionary_hits),
+    MINIT(dictionary_misses, block_cache_dictionary_misses) {
+}
+
+BlockCacheDecompressionMetrics::BlockCacheDecompressionMetrics(
+    const scoped_refptr<MetricEntity>& entity)
+  : MINIT(decompressions, block_cache_decompressions),
+    MINIT(decompressed_bytes, block_cache_decompressed_bytes),
+    MINIT(decompression_time_us, block_cache_decompression_time_us) {
+}
+SsdCacheMetrics::SsdCacheMetrics(const scoped_refptr<MetricEntity>& entity)
+  : MINIT(hits, block_cache_ssd_hits),
+    MINIT(misses, block_cache_ssd_misses),
+    MINIT(inserts, block_cache_ssd_inserts),
+    MINIT(inserted_bytes, block_cache_ssd_inserted_bytes),
+    MINIT(rejections, block_cache_ssd_rejections) {
+}
 #undef MINIT
 #undef GINIT
 
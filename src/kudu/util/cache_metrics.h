@@ -38,5 +38,39 @@ struct CacheMetrics {
   scoped_refptr<AtomicGauge<uint64_t> > cache_usage;
 };
 
+// Hits and misses of the block cache broken down by the type of the block.
+struct BlockCacheTypeMetrics {
+  explicit BlockCacheTypeMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  scoped_refptr<Counter> data_hits;
+  scoped_refptr<Counter> data_misses;
+  scoped_refptr<Counter> index_hits;
+  scoped_refptr<Counter> index_misses;
+  scoped_refptr<Counter> bloom_hits;
+  scoped_refptr<Counter> bloom_misses;
+  scoped_refptr<Counter> dictionary_hits;
+  scoped_refptr<Counter> dictionary_misses;
+};
+
+// Work done to decompress blocks which the block cache keeps compressed.
+struct BlockCacheDecompressionMetrics {
+  explicit BlockCacheDecompressionMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  scoped_refptr<Counter> decompressions;
+  scoped_refptr<Counter> decompressed_bytes;
+  scoped_refptr<Counter> decompression_time_us;
+};
+
+// Activity of the SSD tier of the block cache.
+struct SsdCacheMetrics {
+  explicit SsdCacheMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  scoped_refptr<Counter> hits;
+  scoped_refptr<Counter> misses;
+  scoped_refptr<Counter> inserts;
+  scoped_refptr<Counter> inserted_bytes;
+  scoped_refptr<Counter> rejections;
+};
+
 } // namespace kudu
 #endif /* KUDU_UTIL_CACHE_METRICS_H */
@@ -18,6 +18,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -87,4 +88,46 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+TEST_F(TestCompression, TestZstdCompressionCodec) {
+  TestCompressionCodec(ZSTD);
+}
+
+// Test that data compressed at any level is uncompressed by the default
+// codec, and that out-of-range levels are rejected.
+TEST_F(TestCompression, TestCompressionLevels) {
+  const int kInputSize = 4096;
+  uint8_t ibuffer[kInputSize];
+  uint8_t ubuffer[kInputSize];
+  for (int i = 0; i < kInputSize; i++) {
+    ibuffer[i] = (i * 7) % 61;
+  }
+
+  for (const auto& codec_and_max_level : { std::make_pair(ZLIB, 9), std::make_pair(ZSTD, 22) }) {
+    CompressionType type = codec_and_max_level.first;
+    int max_level = codec_and_max_level.second;
+    const CompressionCodec* default_codec;
+    ASSERT_OK(GetCompressionCodec(type, &default_codec));
+    for (int level : { 0, 1, max_level }) {
+      SCOPED_TRACE(level);
+      const CompressionCodec* codec;
+      ASSERT_OK(GetCompressionCodec(type, level, &codec));
+      ASSERT_EQ(type, codec->type());
+      gscoped_array<uint8_t> cbuffer(new uint8_t[codec->MaxCompressedLength(kInputSize)]);
+      size_t compressed;
+      ASSERT_OK(codec->Compress(Slice(ibuffer, kInputSize), cbuffer.get(), &compressed));
+      ASSERT_OK(default_codec->Uncompress(Slice(cbuffer.get(), compressed),
+                                          ubuffer, kInputSize));
+      ASSERT_EQ(0, memcmp(ibuffer, ubuffer, kInputSize));
+    }
+    const CompressionCodec* codec;
+    ASSERT_TRUE(GetCompressionCodec(type, -1, &codec).IsInvalidArgument());
+    ASSERT_TRUE(GetCompressionCodec(type, max_level + 1, &codec).IsInvalidArgument());
+  }
+
+  // Levels are ignored by codecs which don't support them.
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(LZ4, 100, &codec));
+  ASSERT_EQ(LZ4, codec->type());
+}
+
 } // namespace kudu
@@ -27,17 +27,22 @@
 #include <snappy-sinksource.h>
 #include <snappy.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/string_case.h"
+#include "kudu/util/threadlocal.h"
 
 namespace kudu {
 
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 CompressionCodec::CompressionCodec() {
 }
@@ -203,14 +208,31 @@ class Lz4Codec : public CompressionCodec {
  */
 class ZlibCodec : public CompressionCodec {
  public:
+  static const int kMaxLevel = Z_BEST_COMPRESSION;
+
   static ZlibCodec *GetSingleton() {
     return Singleton<ZlibCodec>::get();
   }
 
+  // Returns the codec compressing at 'level', between 1 and kMaxLevel.
+  static const ZlibCodec* GetInstance(int level) {
+    static const vector<unique_ptr<ZlibCodec>>* const codecs = [] {
+      auto* codecs = new vector<unique_ptr<ZlibCodec>>();
+      for (int l = 1; l <= kMaxLevel; l++) {
+        codecs->emplace_back(new ZlibCodec(l));
+      }
+      return codecs;
+    }();
+    return (*codecs)[level - 1].get();
+  }
+
+  ZlibCodec() : level_(Z_DEFAULT_COMPRESSION) {}
+  explicit ZlibCodec(int level) : level_(level) {}
+
   Status Compress(const Slice& input,
                   uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
     *compressed_length = MaxCompressedLength(input.size());
-    int err = ::compress(compressed, compressed_length, input.data(), input.size());
+    int err = ::compress2(compressed, compressed_length, input.data(), input.size(), level_);
     return err == Z_OK ? Status::OK() : Status::IOError("unable to compress the buffer");
   }
 
@@ -242,6 +264,102 @@ class ZlibCodec : public CompressionCodec {
   CompressionType type() const override {
     return ZLIB;
   }
+
+ private:
+  const int level_;
+};
+
+class ZstdCodec : public CompressionCodec {
+ public:
+  // zstd's own default level.
+  static const int kDefaultLevel = 3;
+
+  static int MaxLevel() {
+    return ZSTD_maxCLevel();
+  }
+
+  // Returns the codec compressing at 'level', between 1 and MaxLevel().
+  static const ZstdCodec* GetInstance(int level) {
+    static const vector<unique_ptr<ZstdCodec>>* const codecs = [] {
+      auto* codecs = new vector<unique_ptr<ZstdCodec>>();
+      for (int l = 1; l <= MaxLevel(); l++) {
+        codecs->emplace_back(new ZstdCodec(l));
+      }
+      return codecs;
+    }();
+    return (*codecs)[level - 1].get();
+  }
+
+  explicit ZstdCodec(int level) : level_(level) {}
+
+  Status Compress(const Slice& input,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    size_t n = ZSTD_compressCCtx(GetContexts()->cctx, compressed,
+                                 MaxCompressedLength(input.size()),
+                                 input.data(), input.size(), level_);
+    if (ZSTD_isError(n)) {
+      return Status::IOError("unable to compress the buffer", ZSTD_getErrorName(n));
+    }
+    *compressed_length = n;
+    return Status::OK();
+  }
+
+  Status Compress(const vector<Slice>& input_slices,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    if (input_slices.size() == 1) {
+      return Compress(input_slices[0], compressed, compressed_length);
+    }
+
+    SlicesSource source(input_slices);
+    faststring buffer;
+    source.Dump(&buffer);
+    return Compress(Slice(buffer.data(), buffer.size()), compressed, compressed_length);
+  }
+
+  Status Uncompress(const Slice& compressed,
+                    uint8_t *uncompressed, size_t uncompressed_length) const OVERRIDE {
+    size_t n = ZSTD_decompressDCtx(GetContexts()->dctx, uncompressed, uncompressed_length,
+                                   compressed.data(), compressed.size());
+    if (ZSTD_isError(n)) {
+      return Status::Corruption("unable to uncompress the buffer", ZSTD_getErrorName(n));
+    }
+    if (n != uncompressed_length) {
+      return Status::Corruption(Substitute("uncompressed $0 bytes, expected $1",
+                                           n, uncompressed_length));
+    }
+    return Status::OK();
+  }
+
+  size_t MaxCompressedLength(size_t source_bytes) const OVERRIDE {
+    return ZSTD_compressBound(source_bytes);
+  }
+
+  CompressionType type() const override {
+    return ZSTD;
+  }
+
+ private:
+  // Per-thread compression and decompression contexts, which zstd would
+  // otherwise allocate and free on every call.
+  struct Contexts {
+    Contexts()
+        : cctx(CHECK_NOTNULL(ZSTD_createCCtx())),
+          dctx(CHECK_NOTNULL(ZSTD_createDCtx())) {
+    }
+    ~Contexts() {
+      ZSTD_freeCCtx(cctx);
+      ZSTD_freeDCtx(dctx);
+    }
+    ZSTD_CCtx* const cctx;
+    ZSTD_DCtx* const dctx;
+  };
+
+  static Contexts* GetContexts() {
+    BLOCK_STATIC_THREAD_LOCAL(Contexts, contexts);
+    return contexts;
+  }
+
+  const int level_;
 };
 
 Status GetCompressionCodec(CompressionType compression,
@@ -259,12 +377,44 @@ Status GetCompressionCodec(CompressionType compression,
     case ZLIB:
       *codec = ZlibCodec::GetSingleton();
       break;
+    case ZSTD:
+      *codec = ZstdCodec::GetInstance(ZstdCodec::kDefaultLevel);
+      break;
     default:
       return Status::NotFound("bad compression type");
   }
   return Status::OK();
 }
 
+Status GetCompressionCodec(CompressionType compression, int level,
+                           const CompressionCodec** codec) {
+  if (level == 0) {
+    return GetCompressionCodec(compression, codec);
+  }
+  int max_level;
+  switch (compression) {
+    case ZLIB:
+      max_level = ZlibCodec::kMaxLevel;
+      break;
+    case ZSTD:
+      max_level = ZstdCodec::MaxLevel();
+      break;
+    default:
+      return GetCompressionCodec(compression, codec);
+  }
+  if (level < 1 || level > max_level) {
+    return Status::InvalidArgument(
+        Substitute("compression level $0 is out of range for $1: must be between 1 and $2",
+                   level, CompressionType_Name(compression), max_level));
+  }
+  if (compression == ZLIB) {
+    *codec = ZlibCodec::GetInstance(level);
+  } else {
+    *codec = ZstdCodec::GetInstance(level);
+  }
+  return Status::OK();
+}
+
 CompressionType GetCompressionCodecType(const std::string& name) {
   std::string uname;
   ToUpperCase(name, &uname);
@@ -275,6 +425,8 @@ CompressionType GetCompressionCodecType(const std::string& name) {
     return LZ4;
   if (uname == "ZLIB")
     return ZLIB;
+  if (uname == "ZSTD")
+    return ZSTD;
   if (uname == "NONE")
     return NO_COMPRESSION;
 
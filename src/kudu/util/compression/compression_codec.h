@@ -71,6 +71,16 @@ class CompressionCodec {
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec);
 
+// Like the above, but the returned codec compresses at 'level'. Only ZLIB
+// (levels 1 to 9) and ZSTD (levels 1 to 22) support levels; the level is
+// ignored for the other codecs. If 'level' is 0, uses the codec's default
+// level. Returns InvalidArgument if 'level' is out of range for the codec.
+//
+// Data compressed at any level can be uncompressed by any of the codecs of
+// the same type.
+Status GetCompressionCodec(CompressionType compression, int level,
+                           const CompressionCodec** codec);
+
 // Returns the compression codec type given the name
 CompressionType GetCompressionCodecType(const std::string& name);
 
@@ -367,6 +367,25 @@ TEST_F(TestEnv, TestHolePunch) {
   ASSERT_EQ(size_on_disk - punch_amount, new_size_on_disk);
 }
 
+// Dropping a file's cached pages must not change what's read back.
+TEST_F(TestEnv, TestDropCache) {
+  string test_path = GetTestPath("test_env_drop_cache");
+  unique_ptr<RWFile> file;
+  ASSERT_OK(env_->NewRWFile(test_path, &file));
+  string data(kOneMb, 'x');
+  ASSERT_OK(file->Write(0, data));
+
+  // Dirty pages aren't dropped, so this must be safe before a sync too.
+  ASSERT_OK(file->DropCache(0, kOneMb));
+  ASSERT_OK(file->Sync());
+  ASSERT_OK(file->DropCache(0, kOneMb));
+  ASSERT_OK(file->DropCache(kOneMb / 2, kOneMb));
+
+  string result(kOneMb, '\0');
+  ASSERT_OK(file->Read(0, Slice(&result[0], result.size())));
+  ASSERT_EQ(data, result);
+}
+
 TEST_F(TestEnv, TestHolePunchBenchmark) {
   const int kFileSize = 1 * 1024 * 1024 * 1024;
   const int kHoleSize = 10 * kOneMb;
@@ -30,6 +30,9 @@ WritableFile::~WritableFile() {
 RWFile::~RWFile() {
 }
 
+FileMapping::~FileMapping() {
+}
+
 FileLock::~FileLock() {
 }
 
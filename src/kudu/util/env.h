@@ -28,6 +28,7 @@ namespace kudu {
 
 class faststring;
 class FileLock;
+class FileMapping;
 class RandomAccessFile;
 class RWFile;
 class SequentialFile;
@@ -434,6 +435,13 @@ class RandomAccessFile {
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
+  // Maps the 'length' bytes of the file starting at 'offset' into memory,
+  // read-only. See FileMapping for the caveats.
+  //
+  // Returns NotSupported if the file can't be mapped.
+  virtual Status Map(uint64_t offset, size_t length,
+                     std::shared_ptr<FileMapping>* mapping) const = 0;
+
   // Returns the filename provided when the RandomAccessFile was constructed.
   virtual const std::string& filename() const = 0;
 
@@ -572,6 +580,13 @@ class RWFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Maps the 'length' bytes of the file starting at 'offset' into memory,
+  // read-only. See FileMapping for the caveats.
+  //
+  // Returns NotSupported if the file can't be mapped.
+  virtual Status Map(uint64_t offset, size_t length,
+                     std::shared_ptr<FileMapping>* mapping) const = 0;
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
@@ -613,6 +628,13 @@ class RWFile {
   // Filesystems that don't implement this will return an error.
   virtual Status PunchHole(uint64_t offset, size_t length) = 0;
 
+  // Advises the operating system that the range given by 'offset' and
+  // 'length' won't be accessed again soon, allowing any clean pages that
+  // cache it to be evicted. Dirty pages are unaffected until written back.
+  //
+  // This is only a hint; it is a no-op on platforms that don't support it.
+  virtual Status DropCache(uint64_t offset, size_t length) = 0;
+
   // Flushes the range of dirty data (not metadata) given by 'offset' and
   // 'length' to disk. If length is 0, all bytes from 'offset' to the end
   // of the file are flushed.
@@ -655,6 +677,25 @@ class RWFile {
   DISALLOW_COPY_AND_ASSIGN(RWFile);
 };
 
+// A read-only memory mapping of a range of a file.
+//
+// The mapping remains valid after the file it was created from is closed or
+// deleted. However, reading a range which was hole punched yields zeroes, and
+// reading a range which was truncated away, or which can't be read from the
+// disk, raises SIGBUS. Callers must therefore ensure that the mapped range is
+// neither modified nor truncated while the mapping is in use.
+class FileMapping {
+ public:
+  FileMapping() { }
+  virtual ~FileMapping();
+
+  // Returns the mapped bytes.
+  virtual Slice data() const = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FileMapping);
+};
+
 // Identifies a locked file.
 class FileLock {
  public:
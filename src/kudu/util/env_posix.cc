@@ -8,6 +8,7 @@
 #include <fts.h>
 #include <glob.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -85,6 +86,7 @@
 using base::subtle::Atomic64;
 using base::subtle::Barrier_AtomicIncrement;
 using std::accumulate;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -428,6 +430,67 @@ Status DoReadV(int fd, const string& filename, uint64_t offset,
   return Status::OK();
 }
 
+// A mapping created by mmap(), unmapped when destroyed.
+class PosixFileMapping : public FileMapping {
+ public:
+  PosixFileMapping(void* base, size_t mapped_length, Slice data)
+      : base_(base),
+        mapped_length_(mapped_length),
+        data_(data) {}
+
+  ~PosixFileMapping() {
+    if (base_ != nullptr && munmap(base_, mapped_length_) != 0) {
+      PLOG(WARNING) << "failed to unmap file region";
+    }
+  }
+
+  Slice data() const override { return data_; }
+
+ private:
+  // The page-aligned address and length of the mapping.
+  void* const base_;
+  const size_t mapped_length_;
+
+  // The bytes which were asked for, within the mapping.
+  const Slice data_;
+};
+
+Status DoMap(int fd, const string& filename, uint64_t offset, size_t length,
+             shared_ptr<FileMapping>* mapping) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  TRACE_EVENT1("io", "DoMap", "path", filename);
+  ThreadRestrictions::AssertIOAllowed();
+
+  // Pages past the end of the file can't be read, so the range must lie
+  // within the file.
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    return IOError(filename, errno);
+  }
+  if (offset + length > static_cast<uint64_t>(st.st_size)) {
+    return Status::InvalidArgument(
+        Substitute("cannot map bytes [$0-$1) of $2: file is $3 bytes long",
+                   offset, offset + length, filename, st.st_size));
+  }
+  if (length == 0) {
+    *mapping = std::make_shared<PosixFileMapping>(nullptr, 0, Slice());
+    return Status::OK();
+  }
+
+  // The offset of a mapping must be aligned to the page size.
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  const uint64_t aligned_offset = offset & ~(kPageSize - 1);
+  const size_t mapped_length = length + (offset - aligned_offset);
+  void* base = mmap(nullptr, mapped_length, PROT_READ, MAP_SHARED, fd, aligned_offset);
+  if (base == MAP_FAILED) {
+    return IOError(filename, errno);
+  }
+  *mapping = std::make_shared<PosixFileMapping>(
+      base, mapped_length,
+      Slice(static_cast<uint8_t*>(base) + (offset - aligned_offset), length));
+  return Status::OK();
+}
+
 Status DoWriteV(int fd, const string& filename, uint64_t offset, ArrayView<const Slice> data) {
   MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
   ThreadRestrictions::AssertIOAllowed();
@@ -611,6 +674,11 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return Status::OK();
   }
 
+  virtual Status Map(uint64_t offset, size_t length,
+                     shared_ptr<FileMapping>* mapping) const OVERRIDE {
+    return DoMap(fd_, filename_, offset, length, mapping);
+  }
+
   virtual const string& filename() const OVERRIDE { return filename_; }
 
   virtual size_t memory_footprint() const OVERRIDE {
@@ -782,6 +850,11 @@ class PosixRWFile : public RWFile {
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual Status Map(uint64_t offset, size_t length,
+                     shared_ptr<FileMapping>* mapping) const OVERRIDE {
+    return DoMap(fd_, filename_, offset, length, mapping);
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     return WriteV(offset, ArrayView<const Slice>(&data, 1));
   }
@@ -863,6 +936,19 @@ class PosixRWFile : public RWFile {
 #endif
   }
 
+  virtual Status DropCache(uint64_t offset, size_t length) OVERRIDE {
+#if defined(__linux__)
+    TRACE_EVENT1("io", "PosixRWFile::DropCache", "path", filename_);
+    ThreadRestrictions::AssertIOAllowed();
+    // posix_fadvise() returns the error number rather than setting errno.
+    int err = posix_fadvise(fd_, offset, length, POSIX_FADV_DONTNEED);
+    if (err != 0) {
+      return IOError(filename_, err);
+    }
+#endif
+    return Status::OK();
+  }
+
   virtual Status Flush(FlushMode mode, uint64_t offset, size_t length) OVERRIDE {
     TRACE_EVENT1("io", "PosixRWFile::Flush", "path", filename_);
     MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
@@ -19,6 +19,7 @@
 
 #include <unistd.h>
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -39,6 +40,7 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
@@ -336,6 +338,57 @@ TYPED_TEST(FileCacheTest, TestNoRecursiveDeadlock) {
   }
 }
 
+// Stresses the cache with many threads opening and reading more files than it
+// can keep open, reporting the throughput and the number of reopens.
+TYPED_TEST(FileCacheTest, TestConcurrentOpenStress) {
+  const int kNumFiles = AllowSlowTests() ? 1000 : 100;
+  const int kCacheCapacity = kNumFiles / 4;
+  const int kNumThreads = 8;
+  const int kOpsPerThread = AllowSlowTests() ? 100000 : 5000;
+  ASSERT_OK(this->ReinitCache(kCacheCapacity));
+
+  vector<string> filenames;
+  for (int i = 0; i < kNumFiles; i++) {
+    filenames.push_back(this->GetTestPath(Substitute("$0", i)));
+    ASSERT_OK(this->WriteTestFile(filenames.back(), "data"));
+  }
+
+  // Most operations go to a small set of hot files; the rest go to any file.
+  const int kNumHotFiles = kCacheCapacity / 2;
+  std::atomic<int> num_errors(0);
+  vector<std::thread> threads;
+  Stopwatch sw;
+  sw.start();
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      Random rand(t);
+      uint8_t buf[4];
+      for (int i = 0; i < kOpsPerThread; i++) {
+        int idx = rand.OneIn(10) ? rand.Uniform(kNumFiles) : rand.Uniform(kNumHotFiles);
+        shared_ptr<TypeParam> f;
+        Status s = this->cache_->OpenExistingFile(filenames[idx], &f);
+        if (s.ok()) {
+          s = f->Read(0, Slice(buf, sizeof(buf)));
+        }
+        if (!s.ok()) {
+          LOG(ERROR) << s.ToString();
+          num_errors++;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  sw.stop();
+  ASSERT_EQ(0, num_errors.load());
+  LOG(INFO) << Substitute("$0 threads performed $1 opens and reads in $2: $3 ops/s",
+                          kNumThreads, kNumThreads * kOpsPerThread,
+                          sw.elapsed().ToString(),
+                          kNumThreads * kOpsPerThread / sw.elapsed().wall_seconds());
+  ASSERT_LE(CountOpenFds(this->env_), this->initial_open_fds_ + kCacheCapacity);
+}
+
 class RandomAccessFileCacheTest : public FileCacheTest<RandomAccessFile> {
 };
 
@@ -20,6 +20,7 @@
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -100,9 +101,9 @@ class BaseDescriptor {
   ~BaseDescriptor() {
     VLOG(2) << "Out of scope descriptor with file name: " << filename();
 
-    // The (now expired) weak_ptr remains in 'descriptors_', to be removed by
-    // the next call to RunDescriptorExpiry(). Removing it here would risk a
-    // deadlock on recursive acquisition of 'lock_'.
+    // The (now expired) weak_ptr remains in the descriptor map, to be removed
+    // by the next call to RunDescriptorExpiry(). Removing it here would risk a
+    // deadlock on recursive acquisition of the map shard's lock.
 
     if (deleted()) {
       cache()->Erase(filename());
@@ -245,6 +246,13 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  Status Map(uint64_t offset, size_t length,
+             shared_ptr<FileMapping>* mapping) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Map(offset, length, mapping);
+  }
+
   Status Write(uint64_t offset, const Slice& data) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -275,6 +283,12 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->PunchHole(offset, length);
   }
 
+  Status DropCache(uint64_t offset, size_t length) override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->DropCache(offset, length);
+  }
+
   Status Flush(FlushMode mode, uint64_t offset, size_t length) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -382,6 +396,13 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->Size(size);
   }
 
+  Status Map(uint64_t offset, size_t length,
+             shared_ptr<FileMapping>* mapping) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Map(offset, length, mapping);
+  }
+
   const string& filename() const override {
     return base_.filename();
   }
@@ -492,13 +513,14 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
     if (desc) {
       VLOG(2) << "Found existing descriptor: " << desc->filename();
     } else {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      InsertOrDie(&descriptors_, file_name, desc);
+      InsertOrDie(&shard->descriptors, file_name, desc);
       VLOG(2) << "Created new descriptor: " << desc->filename();
     }
   }
@@ -513,9 +535,10 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
 template <class FileType>
 Status FileCache<FileType>::DeleteFile(const string& file_name) {
   {
-    std::lock_guard<simple_spinlock> l(lock_);
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
     shared_ptr<internal::Descriptor<FileType>> desc;
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
 
     if (desc) {
       VLOG(2) << "Marking file for deletion: " << file_name;
@@ -539,16 +562,17 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   // This ensures that any concurrent OpenExistingFile() during this method wil
   // see the invalidation and issue a CHECK failure.
   shared_ptr<internal::Descriptor<FileType>> desc;
+  DescriptorShard* shard = GetShard(file_name);
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    auto it = descriptors_.find(file_name);
-    if (it != descriptors_.end()) {
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    auto it = shard->descriptors.find(file_name);
+    if (it != shard->descriptors.end()) {
       desc = it->second.lock();
     }
     if (!desc) {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      descriptors_.emplace(file_name, desc);
+      shard->descriptors.emplace(file_name, desc);
     }
 
     desc->base_.MarkInvalidated();
@@ -563,55 +587,74 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   // the duration of this method, and no other methods erase strong
   // references from the map.
   {
-    std::lock_guard<simple_spinlock> l(lock_);
-    CHECK_EQ(1, descriptors_.erase(file_name));
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    CHECK_EQ(1, shard->descriptors.erase(file_name));
   }
 }
 
 template <class FileType>
 int FileCache<FileType>::NumDescriptorsForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return descriptors_.size();
+  int num_descriptors = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    num_descriptors += shard.descriptors.size();
+  }
+  return num_descriptors;
 }
 
 template <class FileType>
 string FileCache<FileType>::ToDebugString() const {
-  std::lock_guard<simple_spinlock> l(lock_);
   string ret;
-  for (const auto& e : descriptors_) {
-    bool strong = false;
-    bool deleted = false;
-    bool opened = false;
-    shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
-    if (desc) {
-      strong = true;
-      if (desc->base_.deleted()) {
-        deleted = true;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    for (const auto& e : shard.descriptors) {
+      bool strong = false;
+      bool deleted = false;
+      bool opened = false;
+      shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
+      if (desc) {
+        strong = true;
+        if (desc->base_.deleted()) {
+          deleted = true;
+        }
+        internal::ScopedOpenedDescriptor<FileType> o(
+            desc->base_.LookupFromCache());
+        if (o.opened()) {
+          opened = true;
+        }
       }
-      internal::ScopedOpenedDescriptor<FileType> o(
-          desc->base_.LookupFromCache());
-      if (o.opened()) {
-        opened = true;
+      if (strong) {
+        ret += Substitute("$0 (S$1$2)\n", e.first,
+                          deleted ? "D" : "", opened ? "O" : "");
+      } else {
+        ret += Substitute("$0\n", e.first);
       }
     }
-    if (strong) {
-      ret += Substitute("$0 (S$1$2)\n", e.first,
-                        deleted ? "D" : "", opened ? "O" : "");
-    } else {
-      ret += Substitute("$0\n", e.first);
-    }
   }
   return ret;
 }
 
+template <class FileType>
+typename FileCache<FileType>::DescriptorShard* FileCache<FileType>::GetShard(
+    const string& file_name) {
+  return &shards_[std::hash<string>()(file_name) & (kNumDescriptorShards - 1)];
+}
+
+template <class FileType>
+const typename FileCache<FileType>::DescriptorShard* FileCache<FileType>::GetShard(
+    const string& file_name) const {
+  return &shards_[std::hash<string>()(file_name) & (kNumDescriptorShards - 1)];
+}
+
 template <class FileType>
 Status FileCache<FileType>::FindDescriptorUnlocked(
+    DescriptorShard* shard,
     const string& file_name,
     shared_ptr<internal::Descriptor<FileType>>* file) {
-  DCHECK(lock_.is_locked());
+  DCHECK(shard->lock.is_locked());
 
-  auto it = descriptors_.find(file_name);
-  if (it != descriptors_.end()) {
+  auto it = shard->descriptors.find(file_name);
+  if (it != shard->descriptors.end()) {
     // Found the descriptor. Has it expired?
     shared_ptr<internal::Descriptor<FileType>> desc = it->second.lock();
     if (desc) {
@@ -627,7 +670,7 @@ Status FileCache<FileType>::FindDescriptorUnlocked(
       return Status::OK();
     }
     // Descriptor has expired; erase it and pretend we found nothing.
-    descriptors_.erase(it);
+    shard->descriptors.erase(it);
   }
   return Status::OK();
 }
@@ -636,12 +679,14 @@ template <class FileType>
 void FileCache<FileType>::RunDescriptorExpiry() {
   while (!running_.WaitFor(MonoDelta::FromMilliseconds(
       FLAGS_file_cache_expiry_period_ms))) {
-    std::lock_guard<simple_spinlock> l(lock_);
-    for (auto it = descriptors_.begin(); it != descriptors_.end();) {
-      if (it->second.expired()) {
-        it = descriptors_.erase(it);
-      } else {
-        it++;
+    for (auto& shard : shards_) {
+      std::lock_guard<simple_spinlock> l(shard.lock);
+      for (auto it = shard.descriptors.begin(); it != shard.descriptors.end();) {
+        if (it->second.expired()) {
+          it = shard.descriptors.erase(it);
+        } else {
+          it++;
+        }
       }
     }
   }
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -24,6 +25,7 @@
 #include <gtest/gtest_prod.h>
 
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/countdown_latch.h"
@@ -167,14 +169,33 @@ class FileCache {
   template<class FileType2>
   FRIEND_TEST(FileCacheTest, TestBasicOperations);
 
-  // Looks up a descriptor by file name.
+  // A partition of the descriptor map. File names are spread across several
+  // shards so that concurrent opens of different files rarely contend.
+  struct DescriptorShard {
+    // Protects 'descriptors'.
+    mutable simple_spinlock lock;
+
+    // Maps filenames to descriptors.
+    std::unordered_map<std::string,
+                       std::weak_ptr<internal::Descriptor<FileType>>> descriptors;
+  } CACHELINE_ALIGNED;
+
+  // Must be a power of 2.
+  static constexpr int kNumDescriptorShards = 16;
+
+  // Returns the descriptor map shard responsible for 'file_name'.
+  DescriptorShard* GetShard(const std::string& file_name);
+  const DescriptorShard* GetShard(const std::string& file_name) const;
+
+  // Looks up a descriptor by file name in 'shard'.
   //
-  // Must be called with 'lock_' held.
-  Status FindDescriptorUnlocked(
+  // Must be called with the shard's lock held.
+  static Status FindDescriptorUnlocked(
+      DescriptorShard* shard,
       const std::string& file_name,
       std::shared_ptr<internal::Descriptor<FileType>>* file);
 
-  // Periodically removes expired descriptors from 'descriptors_'.
+  // Periodically removes expired descriptors from the descriptor map.
   void RunDescriptorExpiry();
 
   // Interface to the underlying filesystem.
@@ -190,12 +211,8 @@ class FileCache {
   // Underlying cache instance. Caches opened files.
   std::unique_ptr<Cache> cache_;
 
-  // Protects the descriptor map.
-  mutable simple_spinlock lock_;
-
-  // Maps filenames to descriptors.
-  std::unordered_map<std::string,
-                     std::weak_ptr<internal::Descriptor<FileType>>> descriptors_;
+  // The descriptor map, partitioned by file name.
+  std::array<DescriptorShard, kNumDescriptorShards> shards_;
 
   // Calls RunDescriptorExpiry() in a loop until 'running_' isn't set.
   scoped_refptr<Thread> descriptor_expiry_thread_;
@@ -16,6 +16,8 @@
 // under the License.
 
 #include <cstdint>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -52,6 +54,33 @@ TEST_F(HdrHistogramTest, SimpleTest) {
             hist.TotalSum());
 }
 
+// Test that concurrent increments from many threads are all accounted for.
+TEST_F(HdrHistogramTest, TestConcurrentIncrements) {
+  const int kNumThreads = 8;
+  const int kIncrementsPerThread = 10000;
+  HdrHistogram hist(1000000LU, kSigDigits);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&hist, t]() {
+      for (int i = 0; i < kIncrementsPerThread; i++) {
+        hist.Increment(t + 1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(kNumThreads * kIncrementsPerThread, hist.TotalCount());
+  ASSERT_EQ(kIncrementsPerThread * kNumThreads * (kNumThreads + 1) / 2, hist.TotalSum());
+  ASSERT_EQ(1, hist.MinValue());
+  ASSERT_EQ(kNumThreads, hist.MaxValue());
+
+  // A copy has the same totals.
+  HdrHistogram copy(hist);
+  ASSERT_EQ(hist.TotalCount(), copy.TotalCount());
+  ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
+}
+
 TEST_F(HdrHistogramTest, TestCoordinatedOmission) {
   uint64_t interval = 1000;
   int loop_iters = 100;
@@ -54,8 +54,6 @@ HdrHistogram::HdrHistogram(uint64_t highest_trackable_value, int num_significant
     sub_bucket_half_count_magnitude_(0),
     sub_bucket_half_count_(0),
     sub_bucket_mask_(0),
-    total_count_(0),
-    total_sum_(0),
     min_value_(std::numeric_limits<Atomic64>::max()),
     max_value_(0),
     counts_(nullptr) {
@@ -71,8 +69,6 @@ HdrHistogram::HdrHistogram(const HdrHistogram& other)
     sub_bucket_half_count_magnitude_(0),
     sub_bucket_half_count_(0),
     sub_bucket_mask_(0),
-    total_count_(0),
-    total_sum_(0),
     min_value_(std::numeric_limits<Atomic64>::max()),
     max_value_(0),
     counts_(nullptr) {
@@ -80,7 +76,7 @@ HdrHistogram::HdrHistogram(const HdrHistogram& other)
 
   // Not a consistent snapshot but we try to roughly keep it close.
   // Copy the sum and min first.
-  NoBarrier_Store(&total_sum_, NoBarrier_Load(&other.total_sum_));
+  total_sum_.IncrementBy(other.total_sum_.Value());
   NoBarrier_Store(&min_value_, NoBarrier_Load(&other.min_value_));
 
   uint64_t total_copied_count = 0;
@@ -93,7 +89,7 @@ HdrHistogram::HdrHistogram(const HdrHistogram& other)
   // Copy the max observed value last.
   NoBarrier_Store(&max_value_, NoBarrier_Load(&other.max_value_));
   // We must ensure the total is consistent with the copied counts.
-  NoBarrier_Store(&total_count_, total_copied_count);
+  total_count_.IncrementBy(total_copied_count);
 }
 
 bool HdrHistogram::IsValidHighestTrackableValue(uint64_t highest_trackable_value) {
@@ -166,8 +162,8 @@ void HdrHistogram::IncrementBy(int64_t value, int64_t count) {
 
   // Increment bucket, total, and sum.
   NoBarrier_AtomicIncrement(&counts_[counts_index], count);
-  NoBarrier_AtomicIncrement(&total_count_, count);
-  NoBarrier_AtomicIncrement(&total_sum_, value * count);
+  total_count_.IncrementBy(count);
+  total_sum_.IncrementBy(value * count);
 
   // Update min, if needed.
   {
@@ -54,6 +54,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/striped64.h"
 
 namespace kudu {
 
@@ -104,10 +105,10 @@ class HdrHistogram {
   int SubBucketIndex(uint64_t value, int bucket_index) const;
 
   // Count of all events recorded.
-  uint64_t TotalCount() const { return base::subtle::NoBarrier_Load(&total_count_); }
+  uint64_t TotalCount() const { return total_count_.Value(); }
 
   // Sum of all events recorded.
-  uint64_t TotalSum() const { return base::subtle::NoBarrier_Load(&total_sum_); }
+  uint64_t TotalSum() const { return total_sum_.Value(); }
 
   // Return number of items at index.
   uint64_t CountAt(int bucket_index, int sub_bucket_index) const;
@@ -188,9 +189,11 @@ class HdrHistogram {
   int sub_bucket_half_count_;
   uint32_t sub_bucket_mask_;
 
-  // Also hot.
-  base::subtle::Atomic64 total_count_;
-  base::subtle::Atomic64 total_sum_;
+  // Also hot. Every increment updates the total count and sum, so they're
+  // striped to avoid bouncing a single cache line between the cores recording
+  // into the histogram. The buckets, on the other hand, are spread out by value.
+  LongAdder total_count_;
+  LongAdder total_sum_;
   base::subtle::Atomic64 min_value_;
   base::subtle::Atomic64 max_value_;
   gscoped_array<base::subtle::Atomic64> counts_;
@@ -110,6 +110,21 @@ TEST(JsonReaderTest, LessBasic) {
   ASSERT_TRUE(r.ExtractObjectArray(r.root(), "empty", nullptr).IsInvalidArgument());
 }
 
+TEST(JsonReaderTest, Doubles) {
+  JsonReader r("{ \"int\" : 3, \"double\" : 1.5, \"str\" : \"1.5\" }");
+  ASSERT_OK(r.Init());
+  double d;
+  ASSERT_OK(r.ExtractDouble(r.root(), "int", &d));
+  ASSERT_EQ(3.0, d);
+  ASSERT_OK(r.ExtractDouble(r.root(), "double", &d));
+  ASSERT_EQ(1.5, d);
+
+  // Bad types.
+  ASSERT_TRUE(r.ExtractDouble(r.root(), "str", nullptr).IsInvalidArgument());
+  ASSERT_TRUE(r.ExtractInt64(r.root(), "double", nullptr).IsInvalidArgument());
+  ASSERT_TRUE(r.ExtractDouble(r.root(), "missing", nullptr).IsNotFound());
+}
+
 TEST(JsonReaderTest, Objects) {
   JsonReader r("{ \"foo\" : { \"1\" : 1 } }");
   ASSERT_OK(r.Init());
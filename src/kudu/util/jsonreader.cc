@@ -69,6 +69,20 @@ Status JsonReader::ExtractInt64(const Value* object,
   return Status::OK();
 }
 
+Status JsonReader::ExtractDouble(const Value* object,
+                                 const char* field,
+                                 double* result) const {
+  const Value* val;
+  RETURN_NOT_OK(ExtractField(object, field, &val));
+  if (PREDICT_FALSE(!val->IsNumber())) {
+    return Status::InvalidArgument(Substitute(
+        "Wrong type during field extraction: expected double but got $0",
+        val->GetType()));
+  }
+  *result = val->GetDouble();
+  return Status::OK();
+}
+
 Status JsonReader::ExtractString(const Value* object,
                                  const char* field,
                                  string* result) const {
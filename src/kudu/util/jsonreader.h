@@ -56,6 +56,11 @@ class JsonReader {
                       const char* field,
                       int64_t* result) const;
 
+  // Integral values are converted to double.
+  Status ExtractDouble(const rapidjson::Value* object,
+                       const char* field,
+                       double* result) const;
+
   Status ExtractString(const rapidjson::Value* object,
                        const char* field,
                        std::string* result) const;
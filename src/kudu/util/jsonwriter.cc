@@ -18,6 +18,7 @@
 #include "kudu/util/jsonwriter.h"
 
 #include <new>
+#include <ostream>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -45,11 +46,11 @@ using std::vector;
 
 namespace kudu {
 
-// Adapter to allow RapidJSON to write directly to a stringstream.
+// Adapter to allow RapidJSON to write directly to an output stream.
 // Since Squeasel exposes a stringstream as its interface, this is needed to avoid overcopying.
 class UTF8StringStreamBuffer {
  public:
-  explicit UTF8StringStreamBuffer(std::ostringstream* out);
+  explicit UTF8StringStreamBuffer(std::ostream* out);
   ~UTF8StringStreamBuffer();
   void Put(rapidjson::UTF8<>::Ch c);
 
@@ -57,7 +58,7 @@ class UTF8StringStreamBuffer {
 
  private:
   faststring buf_;
-  std::ostringstream* out_;
+  std::ostream* out_;
 };
 
 // rapidjson doesn't provide any common interface between the PrettyWriter and
@@ -90,7 +91,7 @@ class JsonWriterIf {
 template<class T>
 class JsonWriterImpl : public JsonWriterIf {
  public:
-  explicit JsonWriterImpl(ostringstream* out);
+  explicit JsonWriterImpl(std::ostream* out);
 
   virtual void Null() OVERRIDE;
   virtual void Bool(bool b) OVERRIDE;
@@ -121,7 +122,7 @@ class JsonWriterImpl : public JsonWriterIf {
 typedef rapidjson::PrettyWriter<UTF8StringStreamBuffer> PrettyWriterClass;
 typedef rapidjson::Writer<UTF8StringStreamBuffer> CompactWriterClass;
 
-JsonWriter::JsonWriter(ostringstream* out, Mode m) {
+JsonWriter::JsonWriter(std::ostream* out, Mode m) {
   switch (m) {
     case PRETTY:
       impl_.reset(new JsonWriterImpl<PrettyWriterClass>(DCHECK_NOTNULL(out)));
@@ -289,7 +290,7 @@ string JsonWriter::ToJson(const Message& pb, Mode mode) {
 // UTF8StringStreamBuffer
 //
 
-UTF8StringStreamBuffer::UTF8StringStreamBuffer(std::ostringstream* out)
+UTF8StringStreamBuffer::UTF8StringStreamBuffer(std::ostream* out)
   : out_(DCHECK_NOTNULL(out)) {
 }
 UTF8StringStreamBuffer::~UTF8StringStreamBuffer() {
@@ -310,7 +311,7 @@ void UTF8StringStreamBuffer::Flush() {
 //
 
 template<class T>
-JsonWriterImpl<T>::JsonWriterImpl(ostringstream* out)
+JsonWriterImpl<T>::JsonWriterImpl(std::ostream* out)
   : stream_(DCHECK_NOTNULL(out)),
     writer_(stream_) {
 }
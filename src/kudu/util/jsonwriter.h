@@ -43,8 +43,10 @@ class JsonWriterIf;
 // This class implements all the methods of rapidjson::JsonWriter, plus an
 // additional convenience method for String(std::string).
 //
-// We take an instance of std::stringstream in the constructor because Mongoose / Squeasel
-// uses std::stringstream for output buffering.
+// The JSON is written to the std::ostream passed to the constructor, which may
+// be a std::ostringstream buffering it, or a stream sending it as it goes (for
+// example to a webserver response). The writer flushes its own buffer into the
+// stream at the end of every object and array.
 class JsonWriter {
  public:
   enum Mode {
@@ -54,7 +56,7 @@ class JsonWriter {
     COMPACT
   };
 
-  JsonWriter(std::ostringstream* out, Mode mode);
+  JsonWriter(std::ostream* out, Mode mode);
   ~JsonWriter();
 
   void Null();
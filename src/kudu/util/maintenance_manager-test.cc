@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <memory>
@@ -56,6 +57,7 @@ METRIC_DEFINE_histogram(test, maintenance_op_duration,
                         "Maintenance Operation Duration",
                         kudu::MetricUnit::kSeconds, "", 60000000LU, 2);
 
+DECLARE_int32(maintenance_manager_max_high_io_ops_per_device);
 DECLARE_int64(log_target_replay_size_mb);
 
 namespace kudu {
@@ -168,6 +170,16 @@ class TestMaintenanceOp : public MaintenanceOp {
     perf_improvement_ = perf_improvement;
   }
 
+  virtual void GetIODevices(vector<string>* devices) const OVERRIDE {
+    std::lock_guard<Mutex> guard(lock_);
+    devices->insert(devices->end(), io_devices_.begin(), io_devices_.end());
+  }
+
+  void set_io_devices(vector<string> io_devices) {
+    std::lock_guard<Mutex> guard(lock_);
+    io_devices_ = std::move(io_devices);
+  }
+
   virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE {
     return maintenance_op_duration_;
   }
@@ -177,7 +189,7 @@ class TestMaintenanceOp : public MaintenanceOp {
   }
 
  private:
-  Mutex lock_;
+  mutable Mutex lock_;
 
   uint64_t ram_anchored_;
   uint64_t logs_retained_bytes_;
@@ -195,6 +207,9 @@ class TestMaintenanceOp : public MaintenanceOp {
 
   // The amount of time each op invocation will sleep.
   MonoDelta sleep_time_;
+
+  // The devices reported by GetIODevices().
+  vector<string> io_devices_;
 };
 
 // Create an op and wait for it to start running.  Unregister it while it is
@@ -313,6 +328,99 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that a flush is started early when the anchored memory is forecast to
+// reach the memory pressure threshold.
+TEST_F(MaintenanceManagerTest, TestMemoryPressureForecast) {
+  const int64_t kMB = 1024 * 1024;
+
+  manager_->Shutdown();
+  std::atomic<int64_t> headroom(kMB);
+  manager_->set_memory_headroom_func_for_tests([&]() { return headroom.load(); });
+
+  TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
+  op.set_ram_anchored(kMB);
+  manager_->RegisterOp(&op);
+
+  // The first sample doesn't give a growth rate yet.
+  auto op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(nullptr, op_and_why.first);
+  EXPECT_EQ(op_and_why.second, "no ops with positive improvement");
+
+  // Once the anchored memory grows, the op is chosen even though it has no
+  // perf improvement and there's no memory pressure yet.
+  op.set_ram_anchored(2 * kMB);
+  SleepFor(MonoDelta::FromMilliseconds(1100));
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op, op_and_why.first);
+  ASSERT_STR_CONTAINS(op_and_why.second, "memory pressure forecast in");
+
+  MaintenanceManagerStatusPB status_pb;
+  manager_->GetMaintenanceManagerStatusDump(&status_pb);
+  ASSERT_TRUE(status_pb.has_memory_forecast());
+  ASSERT_EQ(kMB, status_pb.memory_forecast().headroom_bytes());
+  ASSERT_GT(status_pb.memory_forecast().growth_bytes_per_sec(), 0);
+  ASSERT_TRUE(status_pb.memory_forecast().has_secs_until_pressure());
+  ASSERT_EQ(1, status_pb.registered_operations_size());
+  ASSERT_GT(status_pb.registered_operations(0).ram_anchored_growth_bytes_per_sec(), 0);
+
+  // With enough headroom, there's nothing to do.
+  headroom = 1024 * kMB;
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(nullptr, op_and_why.first);
+
+  manager_->UnregisterOp(&op);
+}
+
+// Test that an op waits while its device runs as many high-IO ops as allowed,
+// leaving the free thread to an op on another device.
+TEST_F(MaintenanceManagerTest, TestDeviceContention) {
+  FLAGS_maintenance_manager_max_high_io_ops_per_device = 1;
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  TestMaintenanceOp op3("op3", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_perf_improvement(10);
+  op2.set_perf_improvement(9);
+  op3.set_perf_improvement(1);
+  op1.set_io_devices({ "d0" });
+  op2.set_io_devices({ "d0" });
+  op3.set_io_devices({ "d1" });
+  for (auto* op : { &op1, &op2, &op3 }) {
+    op->set_sleep_time(MonoDelta::FromSeconds(1));
+  }
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+  manager_->RegisterOp(&op3);
+
+  // op1 and op3 run together, and op2 only runs once op1 is done.
+  ASSERT_EVENTUALLY([&]() {
+      MaintenanceManagerStatusPB status_pb;
+      manager_->GetMaintenanceManagerStatusDump(&status_pb);
+      ASSERT_EQ(2, status_pb.running_operations_size());
+      vector<string> running;
+      for (const auto& instance : status_pb.running_operations()) {
+        running.push_back(instance.name());
+      }
+      std::sort(running.begin(), running.end());
+      ASSERT_EQ(vector<string>({ "op1", "op3" }), running);
+    });
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(1, op2.DurationHistogram()->TotalCount());
+    });
+
+  // The decisions are recorded, most recent first.
+  MaintenanceManagerStatusPB status_pb;
+  manager_->GetMaintenanceManagerStatusDump(&status_pb);
+  ASSERT_EQ(3, status_pb.recent_decisions_size());
+  ASSERT_EQ("op2", status_pb.recent_decisions(0).name());
+  ASSERT_EQ(1, status_pb.recent_decisions(0).devices_size());
+  ASSERT_EQ("d0", status_pb.recent_decisions(0).devices(0));
+  ASSERT_STR_CONTAINS(status_pb.recent_decisions(0).reason(), "perf score");
+
+  manager_->UnregisterOp(&op1);
+  manager_->UnregisterOp(&op2);
+  manager_->UnregisterOp(&op3);
+}
+
 // Test retrieving a list of an op's running instances
 TEST_F(MaintenanceManagerTest, TestRunningInstances) {
   TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
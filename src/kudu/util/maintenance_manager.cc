@@ -17,6 +17,7 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdint>
@@ -26,6 +27,7 @@
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <gflags/gflags.h>
@@ -50,6 +52,7 @@
 
 using std::pair;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_int32(maintenance_manager_num_threads, 1,
@@ -90,8 +93,48 @@ DEFINE_double(data_gc_prioritization_prob, 0.5,
              "such as delta compaction.");
 TAG_FLAG(data_gc_prioritization_prob, experimental);
 
+DEFINE_int32(maintenance_manager_memory_forecast_secs, 30,
+             "If the memory anchored by the maintenance operations keeps growing "
+             "at its recent rate and would bring the server under memory pressure "
+             "within this many seconds, the operation which anchors the most memory "
+             "is started early. If 0, the memory pressure isn't forecast.");
+TAG_FLAG(maintenance_manager_memory_forecast_secs, experimental);
+
+DEFINE_int32(maintenance_manager_max_forecast_flushes, 2,
+             "Operations are only started early for a forecast memory pressure while "
+             "fewer than this many high-IO operations, such as flushes, are running. "
+             "This bounds the IO spent on early flushes.");
+TAG_FLAG(maintenance_manager_max_forecast_flushes, experimental);
+
+DEFINE_int32(maintenance_manager_max_high_io_ops_per_device, 0,
+             "The maximum number of high-IO operations, such as compactions, which "
+             "may run at once on the same device (e.g. data directory) when they are "
+             "scheduled to improve performance or free disk space. Operations held "
+             "back leave the threads to operations on the other devices. Urgent "
+             "operations which free memory or WAL are never held back. If 0, the "
+             "devices aren't considered.");
+TAG_FLAG(maintenance_manager_max_high_io_ops_per_device, experimental);
+
+DEFINE_int64(maintenance_manager_perf_io_cost_mb, 0,
+             "If positive, the performance improvement of an operation is divided "
+             "by 1 plus the estimated IO of the operation in units of this many MB, "
+             "so that the cheaper of two equally beneficial operations runs first. "
+             "If 0, the IO cost of the operations is ignored.");
+TAG_FLAG(maintenance_manager_perf_io_cost_mb, experimental);
+
 namespace kudu {
 
+namespace {
+
+// The minimum interval between two samples of the memory anchored by an op.
+const int64_t kRamGrowthSampleIntervalMs = 1000;
+
+// The weight of the latest sample in the growth rate of the memory anchored
+// by an op.
+const double kRamGrowthSampleWeight = 0.5;
+
+} // anonymous namespace
+
 MaintenanceOpStats::MaintenanceOpStats() {
   Clear();
 }
@@ -103,6 +146,7 @@ void MaintenanceOpStats::Clear() {
   logs_retained_bytes_ = 0;
   data_retained_bytes_ = 0;
   perf_improvement_ = 0;
+  io_bytes_ = 0;
   last_modified_ = MonoTime();
 }
 
@@ -152,7 +196,15 @@ MaintenanceManager::MaintenanceManager(const Options& options)
     running_ops_(0),
     completed_ops_count_(0),
     rand_(GetRandomSeed32()),
-    memory_pressure_func_(&process_memory::UnderMemoryPressure) {
+    memory_pressure_func_(&process_memory::UnderMemoryPressure),
+    memory_headroom_func_([]() {
+        return process_memory::PressureThreshold() - process_memory::CurrentConsumption();
+      }),
+    decisions_history_size_(options.history_size == 0 ?
+                            FLAGS_maintenance_manager_history_size :
+                            options.history_size),
+    forecast_headroom_bytes_(0),
+    forecast_growth_bytes_per_sec_(0) {
   CHECK_OK(ThreadPoolBuilder("MaintenanceMgr").set_min_threads(num_threads_)
                .set_max_threads(num_threads_).Build(&thread_pool_));
   uint32_t history_size = options.history_size == 0 ?
@@ -231,6 +283,7 @@ void MaintenanceManager::UnregisterOp(MaintenanceOp* op) {
           << "waiting for it to complete";
     }
     ops_.erase(iter);
+    ram_growth_.erase(op);
   }
   LOG_WITH_PREFIX(INFO) << "Unregistered op " << op->name();
   op->cond_.reset();
@@ -301,9 +354,21 @@ void MaintenanceManager::RunSchedulerThread() {
 
     LOG_AND_TRACE("maintenance", INFO) << LogPrefix() << "Scheduling "
                                        << op->name() << ": " << note;
+    vector<string> devices;
+    if (op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+      op->GetIODevices(&devices);
+      for (const string& device : devices) {
+        high_io_ops_by_device_[device]++;
+      }
+    }
+    decisions_.push_back({ op->name(), note, devices, MonoTime::Now() });
+    while (decisions_.size() > decisions_history_size_) {
+      decisions_.pop_front();
+    }
+
     // Run the maintenance operation.
     Status s = thread_pool_->SubmitFunc(boost::bind(
-        &MaintenanceManager::LaunchOp, this, op));
+        &MaintenanceManager::LaunchOp, this, op, std::move(devices)));
     CHECK(s.ok());
   }
 }
@@ -351,6 +416,13 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
 
   double best_perf_improvement = 0;
   MaintenanceOp* best_perf_improvement_op = nullptr;
+
+  const int32_t forecast_secs = FLAGS_maintenance_manager_memory_forecast_secs;
+  double total_ram_growth = 0;
+  uint32_t high_io_running = 0;
+  double most_mem_anchored_forecast = 0;
+  MaintenanceOp* most_mem_anchored_forecast_op = nullptr;
+  int num_held_back = 0;
   for (OpMapTy::value_type &val : ops_) {
     MaintenanceOp* op(val.first);
     MaintenanceOpStats& stats(val.second);
@@ -358,9 +430,20 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     // Update op stats.
     stats.Clear();
     op->UpdateStats(&stats);
+    double ram_growth = UpdateRamGrowth(op, stats.valid() ? stats.ram_anchored() : 0);
+    total_ram_growth += ram_growth;
+    if (op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+      high_io_running += op->running();
+    }
     if (op->cancelled() || !stats.valid() || !stats.runnable()) {
       continue;
     }
+
+    double mem_anchored_forecast = stats.ram_anchored() + ram_growth * forecast_secs;
+    if (stats.ram_anchored() > 0 && mem_anchored_forecast > most_mem_anchored_forecast) {
+      most_mem_anchored_forecast_op = op;
+      most_mem_anchored_forecast = mem_anchored_forecast;
+    }
     if (stats.logs_retained_bytes() > low_io_most_logs_retained_bytes &&
         op->io_usage() == MaintenanceOp::LOW_IO_USAGE) {
       low_io_most_logs_retained_bytes_op = op;
@@ -384,6 +467,20 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
       most_logs_retained_bytes_ram_anchored = stats.ram_anchored();
     }
 
+    // The ops which aren't urgent wait while their devices are busy with
+    // other high-IO ops, so that the free threads go to the idle devices.
+    if (FLAGS_maintenance_manager_max_high_io_ops_per_device > 0 &&
+        op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+      vector<string> devices;
+      op->GetIODevices(&devices);
+      if (AnyDeviceSaturated(devices)) {
+        VLOG_AND_TRACE("maintenance", 2) << LogPrefix() << "Op " << op->name()
+                                         << " held back by device contention";
+        num_held_back++;
+        continue;
+      }
+    }
+
     if (stats.data_retained_bytes() > most_data_retained_bytes) {
       most_data_retained_bytes_op = op;
       most_data_retained_bytes = stats.data_retained_bytes();
@@ -391,13 +488,22 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
                                        << stats.data_retained_bytes() << " bytes of data";
     }
 
+    // Weigh the improvement against the IO it costs, if configured to.
+    double perf_improvement = stats.perf_improvement();
+    if (FLAGS_maintenance_manager_perf_io_cost_mb > 0 && stats.io_bytes() > 0) {
+      perf_improvement /= 1 + static_cast<double>(stats.io_bytes()) /
+          (FLAGS_maintenance_manager_perf_io_cost_mb * 1024 * 1024);
+    }
     if ((!best_perf_improvement_op) ||
-        (stats.perf_improvement() > best_perf_improvement)) {
+        (perf_improvement > best_perf_improvement)) {
       best_perf_improvement_op = op;
-      best_perf_improvement = stats.perf_improvement();
+      best_perf_improvement = perf_improvement;
     }
   }
 
+  forecast_headroom_bytes_ = memory_headroom_func_();
+  forecast_growth_bytes_per_sec_ = total_ram_growth;
+
   // Look at ops that we can run quickly that free up log retention.
   if (low_io_most_logs_retained_bytes_op) {
     if (low_io_most_logs_retained_bytes > 0) {
@@ -423,6 +529,21 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     return {most_mem_anchored_op, std::move(note)};
   }
 
+  // Look at the memory forecast. If the anchored memory keeps growing at its
+  // recent rate, and would bring the server under memory pressure soon, start
+  // freeing the op which will anchor the most memory by then, unless enough
+  // high-IO ops are already running. This gives the flushes of bursty
+  // tablets a head start, rather than waiting for the pressure to build up.
+  if (forecast_secs > 0 && most_mem_anchored_forecast_op && total_ram_growth > 0 &&
+      total_ram_growth * forecast_secs >= forecast_headroom_bytes_ &&
+      high_io_running < FLAGS_maintenance_manager_max_forecast_flushes) {
+    string note = StringPrintf("memory pressure forecast in %.1fs "
+                               "(growing %.0f bytes/sec, will anchor %.0f bytes)",
+                               std::max<double>(forecast_headroom_bytes_, 0) / total_ram_growth,
+                               total_ram_growth, most_mem_anchored_forecast);
+    return {most_mem_anchored_forecast_op, std::move(note)};
+  }
+
   if (most_logs_retained_bytes_op &&
       most_logs_retained_bytes / 1024 / 1024 >= FLAGS_log_target_replay_size_mb) {
     string note = Substitute("$0 bytes log retention", most_logs_retained_bytes);
@@ -444,10 +565,52 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     string note = StringPrintf("perf score=%.6f", best_perf_improvement);
     return {best_perf_improvement_op, std::move(note)};
   }
+  if (num_held_back > 0) {
+    return {nullptr, Substitute("no ops with positive improvement, $0 held back by "
+                                "device contention", num_held_back)};
+  }
   return {nullptr, "no ops with positive improvement"};
 }
 
-void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
+bool MaintenanceManager::AnyDeviceSaturated(const vector<string>& devices) const {
+  const int32_t max_ops = FLAGS_maintenance_manager_max_high_io_ops_per_device;
+  if (max_ops <= 0) {
+    return false;
+  }
+  for (const string& device : devices) {
+    if (FindWithDefault(high_io_ops_by_device_, device, 0) >= max_ops) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double MaintenanceManager::UpdateRamGrowth(MaintenanceOp* op, uint64_t ram_anchored) {
+  RamGrowth& growth = ram_growth_[op];
+  MonoTime now = MonoTime::Now();
+  if (!growth.last_sample_time.Initialized()) {
+    growth.last_ram_anchored = ram_anchored;
+    growth.last_sample_time = now;
+    return 0;
+  }
+  MonoDelta elapsed = now - growth.last_sample_time;
+  if (elapsed.ToMilliseconds() < kRamGrowthSampleIntervalMs) {
+    return growth.bytes_per_sec;
+  }
+  // A drop means that the op ran and freed memory, and says nothing of how
+  // fast the memory grows.
+  double sample = 0;
+  if (ram_anchored > growth.last_ram_anchored) {
+    sample = (ram_anchored - growth.last_ram_anchored) / elapsed.ToSeconds();
+  }
+  growth.bytes_per_sec = kRamGrowthSampleWeight * sample +
+      (1 - kRamGrowthSampleWeight) * growth.bytes_per_sec;
+  growth.last_ram_anchored = ram_anchored;
+  growth.last_sample_time = now;
+  return growth.bytes_per_sec;
+}
+
+void MaintenanceManager::LaunchOp(MaintenanceOp* op, const vector<string>& devices) {
   int64_t thread_id = Thread::CurrentThreadId();
   OpInstance op_instance;
   op_instance.thread_id = thread_id;
@@ -473,6 +636,13 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
 
     op->DurationHistogram()->Increment(op_instance.duration.ToMilliseconds());
 
+    for (const string& device : devices) {
+      auto it = high_io_ops_by_device_.find(device);
+      DCHECK(it != high_io_ops_by_device_.end());
+      if (--it->second == 0) {
+        high_io_ops_by_device_.erase(it);
+      }
+    }
     running_ops_--;
     op->running_--;
     op->cond_->Signal();
@@ -511,6 +681,7 @@ void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatu
       op_pb->set_ram_anchored_bytes(stat.ram_anchored());
       op_pb->set_logs_retained_bytes(stat.logs_retained_bytes());
       op_pb->set_perf_improvement(stat.perf_improvement());
+      op_pb->set_io_bytes(stat.io_bytes());
     } else {
       op_pb->set_runnable(false);
       op_pb->set_ram_anchored_bytes(0);
@@ -518,11 +689,35 @@ void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatu
       op_pb->set_perf_improvement(0.0);
     }
 
+    const RamGrowth* growth = FindOrNull(ram_growth_, op);
+    if (growth) {
+      op_pb->set_ram_anchored_growth_bytes_per_sec(growth->bytes_per_sec);
+    }
+
     if (best_op == op) {
       out_pb->mutable_best_op()->CopyFrom(*op_pb);
     }
   }
 
+  auto* forecast_pb = out_pb->mutable_memory_forecast();
+  forecast_pb->set_headroom_bytes(forecast_headroom_bytes_);
+  forecast_pb->set_growth_bytes_per_sec(forecast_growth_bytes_per_sec_);
+  if (forecast_growth_bytes_per_sec_ > 0) {
+    forecast_pb->set_secs_until_pressure(
+        std::max<double>(forecast_headroom_bytes_, 0) / forecast_growth_bytes_per_sec_);
+  }
+
+  MonoTime now = MonoTime::Now();
+  for (auto it = decisions_.rbegin(); it != decisions_.rend(); ++it) {
+    auto* decision_pb = out_pb->add_recent_decisions();
+    decision_pb->set_name(it->op_name);
+    decision_pb->set_reason(it->reason);
+    for (const string& device : it->devices) {
+      decision_pb->add_devices(device);
+    }
+    decision_pb->set_millis_since_decision((now - it->time).ToMilliseconds());
+  }
+
   {
     std::lock_guard<Mutex> lock(running_instances_lock_);
     for (const auto& running_instance : running_instances_) {
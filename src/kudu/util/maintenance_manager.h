@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -108,6 +109,16 @@ class MaintenanceOpStats {
     perf_improvement_ = perf_improvement;
   }
 
+  int64_t io_bytes() const {
+    DCHECK(valid_);
+    return io_bytes_;
+  }
+
+  void set_io_bytes(int64_t io_bytes) {
+    UpdateLastModified();
+    io_bytes_ = io_bytes;
+  }
+
   const MonoTime& last_modified() const {
     DCHECK(valid_);
     return last_modified_;
@@ -148,6 +159,10 @@ class MaintenanceOpStats {
   // absolute scale (yet TBD).
   double perf_improvement_;
 
+  // The approximate number of bytes this operation would read and write.
+  // May be 0 if unknown.
+  int64_t io_bytes_;
+
   // The last time that the stats were modified.
   MonoTime last_modified_;
 };
@@ -209,6 +224,13 @@ class MaintenanceOp {
   // Returns the gauge for this op that tracks when this op is running. Cannot be NULL.
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const = 0;
 
+  // Appends the identifiers of the devices (e.g. data directories) whose IO
+  // this op uses to 'devices', so that the scheduler may spread concurrent
+  // HIGH_IO_USAGE ops over different devices. This will be run under the
+  // MaintenanceManager lock. By default, no devices are reported, and the op
+  // is never held back for device contention.
+  virtual void GetIODevices(std::vector<std::string>* /*devices*/) const {}
+
   uint32_t running() { return running_; }
 
   std::string name() const { return name_; }
@@ -295,26 +317,61 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
     memory_pressure_func_ = std::move(f);
   }
 
+  void set_memory_headroom_func_for_tests(std::function<int64_t()> f) {
+    std::lock_guard<Mutex> guard(lock_);
+    memory_headroom_func_ = std::move(f);
+  }
+
   static const Options kDefaultOptions;
 
  private:
   FRIEND_TEST(MaintenanceManagerTest, TestLogRetentionPrioritization);
+  FRIEND_TEST(MaintenanceManagerTest, TestMemoryPressureForecast);
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapTy;
 
+  // The estimated growth rate of the memory anchored by an op.
+  struct RamGrowth {
+    RamGrowth() : last_ram_anchored(0), bytes_per_sec(0) {}
+
+    // The memory anchored by the op, and when it was sampled.
+    uint64_t last_ram_anchored;
+    MonoTime last_sample_time;
+
+    // An exponentially weighted moving average of the growth rate.
+    double bytes_per_sec;
+  };
+
   // Return true if tests have currently disabled the maintenance
   // manager by way of changing the gflags at runtime.
   bool disabled_for_tests() const;
 
   void RunSchedulerThread();
 
+  // A past decision of the scheduler to run an op.
+  struct SchedulingDecision {
+    std::string op_name;
+    std::string reason;
+    std::vector<std::string> devices;
+    MonoTime time;
+  };
+
   // Find the best op, or null if there is nothing we want to run.
   //
   // Returns the op, as well as a string explanation of why that op was chosen,
   // suitable for logging.
   std::pair<MaintenanceOp*, std::string> FindBestOp();
 
-  void LaunchOp(MaintenanceOp* op);
+  // Returns true if one of 'devices' already runs as many HIGH_IO_USAGE ops
+  // as --maintenance_manager_max_high_io_ops_per_device allows.
+  bool AnyDeviceSaturated(const std::vector<std::string>& devices) const;
+
+  // Runs 'op', which uses the IO of 'devices'.
+  void LaunchOp(MaintenanceOp* op, const std::vector<std::string>& devices);
+
+  // Updates the growth rate of the memory anchored by 'op' with the memory
+  // it currently anchors, and returns it.
+  double UpdateRamGrowth(MaintenanceOp* op, uint64_t ram_anchored);
 
   std::string LogPrefix() const;
 
@@ -338,6 +395,26 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // This is indirected for testing purposes.
   std::function<bool(double*)> memory_pressure_func_;
 
+  // Function which should return how many more bytes the server may consume
+  // before it is under global memory pressure. This is indirected for testing
+  // purposes.
+  std::function<int64_t()> memory_headroom_func_;
+
+  // The growth rates of the memory anchored by the registered ops.
+  std::unordered_map<MaintenanceOp*, RamGrowth> ram_growth_;
+
+  // The number of running HIGH_IO_USAGE ops which use each device, as
+  // reported by MaintenanceOp::GetIODevices().
+  std::unordered_map<std::string, int> high_io_ops_by_device_;
+
+  // The most recent decisions of the scheduler, oldest first.
+  std::deque<SchedulingDecision> decisions_;
+  const size_t decisions_history_size_;
+
+  // The memory forecast computed by the last call to FindBestOp().
+  int64_t forecast_headroom_bytes_;
+  double forecast_growth_bytes_per_sec_;
+
   // Running instances lock.
   //
   // This is separate of lock_ so that worker threads don't need to take the
@@ -27,13 +27,17 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int64(mem_tracker_update_batch_bytes);
+
 namespace kudu {
 
 using std::equal_to;
@@ -117,6 +121,73 @@ TEST(MemTrackerTest, TrackerHierarchy) {
   c2->Release(60);
 }
 
+TEST(MemTrackerTest, BatchedAncestorUpdates) {
+  google::FlagSaver saver;
+  FLAGS_mem_tracker_update_batch_bytes = 100;
+
+  shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "p");
+  shared_ptr<MemTracker> c = MemTracker::CreateTracker(50, "c", p);
+
+  // The child's own limit is still enforced exactly.
+  ASSERT_TRUE(c->TryConsume(40));
+  ASSERT_FALSE(c->TryConsume(20));
+  EXPECT_EQ(c->consumption(), 40);
+
+  // The parent lags behind until the batch size is reached.
+  EXPECT_EQ(p->consumption(), 0);
+  c->Consume(70);
+  EXPECT_EQ(c->consumption(), 110);
+  EXPECT_EQ(p->consumption(), 110);
+  c->Release(100);
+  EXPECT_EQ(c->consumption(), 10);
+  EXPECT_EQ(p->consumption(), 10);
+  c->Release(10);
+  EXPECT_EQ(c->consumption(), 0);
+  EXPECT_EQ(p->consumption(), 10);
+
+  // Destroying the child flushes whatever it hasn't propagated yet.
+  c.reset();
+  EXPECT_EQ(p->consumption(), 0);
+
+  // Updates of trackers with limits on their ancestors aren't batched.
+  shared_ptr<MemTracker> lp = MemTracker::CreateTracker(1000, "lp");
+  shared_ptr<MemTracker> lc = MemTracker::CreateTracker(-1, "lc", lp);
+  lc->Consume(10);
+  EXPECT_EQ(lp->consumption(), 10);
+  lc->Release(10);
+  EXPECT_EQ(lp->consumption(), 0);
+}
+
+// Measures the cost of updating sibling trackers concurrently, all of which
+// propagate their consumption to a shared parent.
+TEST(MemTrackerTest, ConcurrentConsumeBenchmark) {
+  const int kNumThreads = 8;
+  const int kNumIters = AllowSlowTests() ? 10000000 : 100000;
+  for (int64_t batch_bytes : { 0, 1024 * 1024 }) {
+    google::FlagSaver saver;
+    FLAGS_mem_tracker_update_batch_bytes = batch_bytes;
+    shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "p");
+    vector<std::thread> threads;
+    LOG_TIMING(INFO, Substitute("$0 iterations on $1 threads with batches of $2 bytes",
+                                kNumIters, kNumThreads, batch_bytes)) {
+      for (int i = 0; i < kNumThreads; i++) {
+        threads.emplace_back([&, i]{
+          shared_ptr<MemTracker> c =
+              MemTracker::CreateTracker(-1, Substitute("c-$0", i), p);
+          for (int j = 0; j < kNumIters; j++) {
+            c->Consume(128);
+            c->Release(128);
+          }
+        });
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+    }
+    ASSERT_EQ(p->consumption(), 0);
+  }
+}
+
 class GcFunctionHelper {
  public:
   static const int kNumReleaseBytes = 1;
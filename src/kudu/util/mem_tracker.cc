@@ -19,18 +19,33 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdlib>
 #include <deque>
 #include <limits>
 #include <list>
 #include <memory>
 #include <ostream>
 
+#include <gflags/gflags.h>
+
 #include "kudu/gutil/once.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/process_memory.h"
 
+DEFINE_int64(mem_tracker_update_batch_bytes, 0,
+             "If positive, memory trackers without limits on their ancestors "
+             "propagate changes in their consumption to their ancestors in "
+             "batches of this many bytes rather than on every update. This "
+             "reduces contention on the ancestors' counters, most notably the "
+             "root tracker's, at the cost of the ancestors' consumption lagging "
+             "behind. Trackers with limits on their ancestors are always "
+             "updated right away.");
+TAG_FLAG(mem_tracker_update_batch_bytes, advanced);
+TAG_FLAG(mem_tracker_update_batch_bytes, experimental);
+
 namespace kudu {
 
 // NOTE: this class has been adapted from Impala, so the code style varies
@@ -70,13 +85,16 @@ MemTracker::MemTracker(int64_t byte_limit, const string& id, shared_ptr<MemTrack
       id_(id),
       descr_(Substitute("memory consumption for $0", id)),
       parent_(std::move(parent)),
-      consumption_(0) {
+      consumption_(0),
+      ancestor_update_batch_bytes_(0),
+      pending_ancestor_delta_(0) {
   VLOG(1) << "Creating tracker " << ToString();
 }
 
 MemTracker::~MemTracker() {
   VLOG(1) << "Destroying tracker " << ToString();
   if (parent_) {
+    FlushAncestorUpdates();
     DCHECK(consumption() == 0) << "Memory tracker " << ToString()
         << " has unreleased consumption " << consumption();
     parent_->Release(consumption());
@@ -192,9 +210,8 @@ void MemTracker::Consume(int64_t bytes) {
   if (bytes == 0) {
     return;
   }
-  for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
-  }
+  consumption_.IncrementBy(bytes);
+  UpdateAncestors(bytes);
 }
 
 bool MemTracker::TryConsume(int64_t bytes) {
@@ -203,6 +220,17 @@ bool MemTracker::TryConsume(int64_t bytes) {
     return true;
   }
 
+  if (ancestor_update_batch_bytes_ > 0) {
+    // None of the ancestors has a limit, so only this tracker's matters.
+    if (limit_ < 0) {
+      consumption_.IncrementBy(bytes);
+    } else if (!consumption_.TryIncrementBy(bytes, limit_)) {
+      return false;
+    }
+    UpdateAncestors(bytes);
+    return true;
+  }
+
   int i = 0;
   // Walk the tracker tree top-down, consuming memory from each in turn.
   for (i = all_trackers_.size() - 1; i >= 0; --i) {
@@ -241,12 +269,33 @@ void MemTracker::Release(int64_t bytes) {
     return;
   }
 
-  for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
-  }
+  consumption_.IncrementBy(-bytes);
+  UpdateAncestors(-bytes);
   process_memory::MaybeGCAfterRelease(bytes);
 }
 
+void MemTracker::UpdateAncestors(int64_t delta) {
+  if (ancestor_update_batch_bytes_ > 0) {
+    int64_t pending = pending_ancestor_delta_.IncrementBy(delta);
+    if (PREDICT_TRUE(std::abs(pending) < ancestor_update_batch_bytes_)) {
+      return;
+    }
+    // Claim the whole pending delta; concurrent updates either were included
+    // or start a new batch.
+    delta = pending_ancestor_delta_.Exchange(0);
+  }
+  for (int i = 1; i < all_trackers_.size(); i++) {
+    all_trackers_[i]->consumption_.IncrementBy(delta);
+  }
+}
+
+void MemTracker::FlushAncestorUpdates() {
+  int64_t delta = pending_ancestor_delta_.Exchange(0);
+  for (int i = 1; i < all_trackers_.size(); i++) {
+    all_trackers_[i]->consumption_.IncrementBy(delta);
+  }
+}
+
 bool MemTracker::AnyLimitExceeded() {
   for (const auto& tracker : limit_trackers_) {
     if (tracker->LimitExceeded()) {
@@ -276,6 +325,15 @@ void MemTracker::Init() {
   }
   DCHECK_GT(all_trackers_.size(), 0);
   DCHECK_EQ(all_trackers_[0], this);
+
+  // Batch the updates of the ancestors only if none of them has a limit.
+  bool ancestor_has_limit = false;
+  for (int i = 1; i < all_trackers_.size(); i++) {
+    ancestor_has_limit |= all_trackers_[i]->has_limit();
+  }
+  if (all_trackers_.size() > 1 && !ancestor_has_limit) {
+    ancestor_update_batch_bytes_ = std::max<int64_t>(FLAGS_mem_tracker_update_batch_bytes, 0);
+  }
 }
 
 void MemTracker::AddChildTracker(const shared_ptr<MemTracker>& tracker) {
@@ -26,6 +26,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/util/atomic.h"
 #include "kudu/util/high_water_mark.h"
 #include "kudu/util/mutex.h"
 
@@ -136,6 +137,10 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   const std::string& id() const { return id_; }
 
   // Returns the memory consumed in bytes.
+  //
+  // If --mem_tracker_update_batch_bytes is set, the consumption of a tracker
+  // without a limit may lag behind that of its descendants, by up to the batch
+  // size per descendant.
   int64_t consumption() const {
     return consumption_.current_value();
   }
@@ -157,6 +162,14 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // Further initializes the tracker.
   void Init();
 
+  // Adds 'delta' to the consumption of the ancestors of this tracker, either
+  // right away or, if this tracker batches the updates of its ancestors, once
+  // the accumulated delta reaches the batch size.
+  void UpdateAncestors(int64_t delta);
+
+  // Adds the delta accumulated for the ancestors to their consumption.
+  void FlushAncestorUpdates();
+
   // Adds tracker to child_trackers_.
   void AddChildTracker(const std::shared_ptr<MemTracker>& tracker);
 
@@ -176,6 +189,16 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   HighWaterMark consumption_;
 
+  // The size of the batches in which the consumption of this tracker is
+  // propagated to its ancestors, or 0 if it's propagated right away. Only
+  // trackers without limits on their ancestors batch their updates, so that
+  // the limit checks remain accurate.
+  int64_t ancestor_update_batch_bytes_;
+
+  // The change in consumption of this tracker which hasn't been propagated
+  // to its ancestors yet.
+  AtomicInt<int64_t> pending_ancestor_delta_;
+
   // this tracker plus all of its ancestors
   std::vector<MemTracker*> all_trackers_;
   // all_trackers_ with valid limits
@@ -40,6 +40,7 @@ namespace kudu {
 using std::shared_ptr;
 using std::string;
 using std::thread;
+using std::unique_ptr;
 using std::vector;
 
 template<class ArenaType>
@@ -202,4 +203,87 @@ TEST(TestArena, TestSTLAllocator) {
   }
 }
 
+TEST(TestArena, TestHugePageBufferAllocator) {
+  const size_t kPage = HugePageBufferAllocator::kHugePageSize;
+  HugePageBufferAllocator* allocator = HugePageBufferAllocator::Get();
+  uint64_t initial_bytes = allocator->huge_page_bytes();
+
+  // Small buffers come from the heap.
+  unique_ptr<Buffer> small(allocator->Allocate(1024));
+  ASSERT_TRUE(small != nullptr);
+  ASSERT_EQ(1024, small->size());
+  ASSERT_EQ(initial_bytes, allocator->huge_page_bytes());
+
+  // Larger ones are mapped as whole, aligned huge pages.
+  unique_ptr<Buffer> page(allocator->Allocate(kPage));
+  ASSERT_TRUE(page != nullptr);
+  ASSERT_EQ(kPage, page->size());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(page->data()) % kPage);
+  memset(page->data(), 0xff, kPage);
+  ASSERT_EQ(initial_bytes + kPage, allocator->huge_page_bytes());
+
+  unique_ptr<Buffer> pages(allocator->Allocate(2 * kPage + 1));
+  ASSERT_TRUE(pages != nullptr);
+  ASSERT_EQ(2 * kPage + 1, pages->size());
+  ASSERT_EQ(initial_bytes + 4 * kPage, allocator->huge_page_bytes());
+  pages.reset();
+
+  // A freed page is reused by the next allocation.
+  void* data = page->data();
+  uint64_t num_reused = allocator->num_reused_pages();
+  page.reset();
+  ASSERT_EQ(initial_bytes, allocator->huge_page_bytes());
+  ASSERT_GE(allocator->freelist_bytes(), kPage);
+  page.reset(allocator->Allocate(kPage));
+  ASSERT_EQ(data, page->data());
+  ASSERT_EQ(num_reused + 1, allocator->num_reused_pages());
+
+  // Reallocation preserves the content, across the heap and the pages.
+  memset(small->data(), 0xab, small->size());
+  ASSERT_TRUE(allocator->Reallocate(kPage, small.get()));
+  ASSERT_EQ(kPage, small->size());
+  ASSERT_EQ(0xab, reinterpret_cast<uint8_t*>(small->data())[1023]);
+}
+
+TEST(TestArena, TestHugePageArena) {
+  const size_t kPage = HugePageBufferAllocator::kHugePageSize;
+  HugePageBufferAllocator* allocator = HugePageBufferAllocator::Get();
+  uint64_t initial_bytes = allocator->huge_page_bytes();
+  shared_ptr<MemTracker> mem_tracker = MemTracker::CreateTracker(-1, "arena-test-tracker");
+  {
+    shared_ptr<MemoryTrackingBufferAllocator> tracking_allocator(
+        new MemoryTrackingBufferAllocator(allocator, mem_tracker));
+    ThreadSafeMemoryTrackingArena arena(16, tracking_allocator);
+    arena.SetMaxBufferSize(kPage);
+    for (int i = 0; i < 10 * 1024; i++) {
+      ASSERT_TRUE(arena.AllocateBytes(1024) != nullptr);
+    }
+    // Once the arena has grown past a page, it grows in whole pages.
+    ASSERT_GE(allocator->huge_page_bytes(), initial_bytes + 4 * kPage);
+    ASSERT_LE(arena.memory_footprint(), 7 * kPage);
+    ASSERT_EQ(arena.memory_footprint(), mem_tracker->consumption());
+  }
+  ASSERT_EQ(0, mem_tracker->consumption());
+  ASSERT_EQ(initial_bytes, allocator->huge_page_bytes());
+}
+
+TEST(TestArena, TestRetainReference) {
+  Arena arena(16);
+  shared_ptr<string> data = std::make_shared<string>("external");
+  arena.RetainReference(data);
+  arena.RetainReference(data);
+  ASSERT_EQ(2, data.use_count());
+
+  // Resetting the arena releases the references.
+  arena.Reset();
+  ASSERT_EQ(1, data.use_count());
+
+  {
+    Arena other(16);
+    other.RetainReference(data);
+    ASSERT_EQ(2, data.use_count());
+  }
+  ASSERT_EQ(1, data.use_count());
+}
+
 } // namespace kudu
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <memory>
 #include <mutex>
+#include <utility>
 
 using std::min;
 using std::unique_ptr;
@@ -59,7 +60,9 @@ ArenaBase<THREADSAFE>::ArenaBase(size_t initial_buffer_size)
 
 template <bool THREADSAFE>
 void ArenaBase<THREADSAFE>::SetMaxBufferSize(size_t size) {
-  DCHECK_LE(size, kMaxTcmallocFastAllocation);
+  // Buffers larger than kMaxTcmallocFastAllocation only make sense when the
+  // allocator is backed by huge pages rather than by tcmalloc.
+  DCHECK_LE(size, HugePageBufferAllocator::kHugePageSize);
   max_buffer_size_ = size;
 }
 
@@ -142,6 +145,7 @@ void ArenaBase<THREADSAFE>::Reset() {
   }
   arena_.back()->Reset();
   arena_footprint_ = arena_.back()->size();
+  retained_refs_.clear();
 
 #ifndef NDEBUG
   // In debug mode release the last component too for (hopefully) better
@@ -153,6 +157,15 @@ void ArenaBase<THREADSAFE>::Reset() {
 #endif
 }
 
+template <bool THREADSAFE>
+void ArenaBase<THREADSAFE>::RetainReference(std::shared_ptr<const void> ref) {
+  std::lock_guard<mutex_type> lock(component_lock_);
+  // Callers typically retain the same reference for several batches in a row.
+  if (retained_refs_.empty() || retained_refs_.back() != ref) {
+    retained_refs_.emplace_back(std::move(ref));
+  }
+}
+
 template <bool THREADSAFE>
 size_t ArenaBase<THREADSAFE>::memory_footprint() const {
   std::lock_guard<mutex_type> lock(component_lock_);
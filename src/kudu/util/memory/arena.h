@@ -99,7 +99,9 @@ class ArenaBase {
   explicit ArenaBase(size_t initial_buffer_size);
 
   // Set the maximum buffer size allocated for this arena.
-  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes).
+  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes),
+  // unless the buffers come from a HugePageBufferAllocator, which allocates
+  // them in huge pages rather than from tcmalloc.
   //
   // Consider the following pros/cons of large buffer sizes:
   //
@@ -175,6 +177,11 @@ class ArenaBase {
   // buffer allocations, as the arena keeps reusing a single, large buffer.
   void Reset();
 
+  // Keeps 'ref' alive until the arena is reset or destroyed, so that slices
+  // pointing into memory owned by 'ref' (e.g. a pinned block cache entry)
+  // may be handed out as if their data had been allocated from the arena.
+  void RetainReference(std::shared_ptr<const void> ref);
+
   // Returns the memory footprint of this arena, in bytes, defined as a sum of
   // all buffer sizes. Always greater or equal to the total number of
   // bytes allocated out of the arena.
@@ -222,9 +229,13 @@ class ArenaBase {
   size_t max_buffer_size_;
   size_t arena_footprint_;
 
+  // References kept alive by RetainReference() until the next Reset().
+  std::vector<std::shared_ptr<const void>> retained_refs_;
+
   // Lock covering 'slow path' allocation, when new components are
   // allocated and added to the arena's list. Also covers any other
-  // mutation of the component data structure (eg Reset).
+  // mutation of the component data structure (eg Reset) and of
+  // 'retained_refs_'.
   mutable mutex_type component_lock_;
 
   DISALLOW_COPY_AND_ASSIGN(ArenaBase);
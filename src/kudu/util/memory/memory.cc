@@ -21,17 +21,22 @@
 #include "kudu/util/memory/memory.h"
 
 #include <mm_malloc.h>
+#include <sys/mman.h>
 
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 
 #include <gflags/gflags.h>
 
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/bind_helpers.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/metrics.h"
 
 using std::copy;
 using std::min;
@@ -44,6 +49,31 @@ DEFINE_bool(allocator_aligned_mode, false,
             "unless explicitly specified otherwise - to boost SIMD");
 TAG_FLAG(allocator_aligned_mode, hidden);
 
+DEFINE_bool(arena_use_hugetlb, false,
+            "Whether arenas backed by huge pages first try to map them from the "
+            "hugetlbfs pool, which must have been reserved, before falling back "
+            "to transparent huge pages.");
+TAG_FLAG(arena_use_hugetlb, experimental);
+
+DEFINE_int32(arena_huge_page_freelist_mb, 64,
+             "Maximum number of megabytes of freed huge pages kept by arenas backed "
+             "by huge pages, to be reused by the next allocations.");
+TAG_FLAG(arena_huge_page_freelist_mb, experimental);
+
+METRIC_DEFINE_gauge_uint64(server, arena_huge_page_bytes,
+                           "Arena Huge Page Memory", kudu::MetricUnit::kBytes,
+                           "Number of bytes of huge pages allocated by in-memory stores "
+                           "to hold their data, which is cheaper to traverse than memory "
+                           "mapped with regular pages.");
+METRIC_DEFINE_gauge_uint64(server, arena_huge_page_freelist_bytes,
+                           "Arena Huge Page Free List Size", kudu::MetricUnit::kBytes,
+                           "Number of bytes of freed huge pages kept for reuse.");
+METRIC_DEFINE_gauge_uint64(server, arena_huge_pages_reused,
+                           "Arena Huge Pages Reused", kudu::MetricUnit::kUnits,
+                           "Number of huge pages which were reused from the free list "
+                           "rather than mapped again.",
+                           kudu::EXPOSE_AS_COUNTER);
+
 namespace kudu {
 
 namespace {
@@ -168,6 +198,167 @@ void* HeapBufferAllocator::Realloc(void* previous_data, size_t previous_size,
   }
 }
 
+HugePageBufferAllocator::HugePageBufferAllocator()
+    : huge_page_bytes_(0),
+      num_reused_pages_(0),
+      hugetlb_unavailable_(false) {
+}
+
+void HugePageBufferAllocator::RegisterMetrics(const scoped_refptr<MetricEntity>& entity) {
+  entity->NeverRetire(
+      METRIC_arena_huge_page_bytes.InstantiateFunctionGauge(
+          entity, Bind(&HugePageBufferAllocator::huge_page_bytes, Unretained(this))));
+  entity->NeverRetire(
+      METRIC_arena_huge_page_freelist_bytes.InstantiateFunctionGauge(
+          entity, Bind(&HugePageBufferAllocator::freelist_bytes, Unretained(this))));
+  entity->NeverRetire(
+      METRIC_arena_huge_pages_reused.InstantiateFunctionGauge(
+          entity, Bind(&HugePageBufferAllocator::num_reused_pages, Unretained(this))));
+}
+
+uint64_t HugePageBufferAllocator::huge_page_bytes() const {
+  return huge_page_bytes_.Load();
+}
+
+uint64_t HugePageBufferAllocator::freelist_bytes() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return freelist_.size() * kHugePageSize;
+}
+
+uint64_t HugePageBufferAllocator::num_reused_pages() const {
+  return num_reused_pages_.Load();
+}
+
+Buffer* HugePageBufferAllocator::AllocateInternal(const size_t requested,
+                                                  const size_t minimal,
+                                                  BufferAllocator* const originator) {
+  DCHECK_LE(minimal, requested);
+  size_t size;
+  void* data = AllocateBytes(requested, minimal, &size);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  return CreateBuffer(data, size, originator);
+}
+
+bool HugePageBufferAllocator::ReallocateInternal(const size_t requested,
+                                                 const size_t minimal,
+                                                 Buffer* const buffer,
+                                                 BufferAllocator* const originator) {
+  DCHECK_LE(minimal, requested);
+  size_t size;
+  void* data = AllocateBytes(requested, minimal, &size);
+  if (data == nullptr) {
+    return false;
+  }
+  memcpy(data, buffer->data(), min(size, buffer->size()));
+  FreeBytes(buffer->data(), buffer->size());
+  UpdateBuffer(data, size, buffer);
+  return true;
+}
+
+void HugePageBufferAllocator::FreeInternal(Buffer* buffer) {
+  FreeBytes(buffer->data(), buffer->size());
+}
+
+void* HugePageBufferAllocator::AllocateBytes(size_t requested, size_t minimal, size_t* size) {
+  for (size_t attempted : { requested, minimal }) {
+    void* data;
+    if (attempted == 0) {
+      data = &dummy_buffer[0];
+    } else if (attempted < kHugePageSize) {
+      data = malloc(attempted);
+    } else {
+      // Sizes which aren't a multiple of the page size waste the end of
+      // their last page.
+      data = MapPages(KUDU_ALIGN_UP(attempted, kHugePageSize));
+    }
+    if (data != nullptr) {
+      *size = attempted;
+      return data;
+    }
+  }
+  return nullptr;
+}
+
+void HugePageBufferAllocator::FreeBytes(void* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (size < kHugePageSize) {
+    free(data);
+    return;
+  }
+  UnmapPages(data, KUDU_ALIGN_UP(size, kHugePageSize));
+}
+
+void* HugePageBufferAllocator::MapPages(size_t len) {
+  if (len == kHugePageSize) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!freelist_.empty()) {
+      void* data = freelist_.back();
+      freelist_.pop_back();
+      num_reused_pages_.Increment();
+      huge_page_bytes_.IncrementBy(len);
+      return data;
+    }
+  }
+
+  void* data = nullptr;
+#ifdef MAP_HUGETLB
+  if (FLAGS_arena_use_hugetlb && !hugetlb_unavailable_.Load()) {
+    data = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED) {
+      // The pool isn't configured, or is exhausted: don't try it again.
+      PLOG(WARNING) << "Could not map huge pages from the hugetlbfs pool, "
+                    << "falling back to transparent huge pages";
+      hugetlb_unavailable_.Store(true);
+      data = nullptr;
+    }
+  }
+#endif
+  if (data == nullptr) {
+    // Map an extra page, so that the mapping can be trimmed down to a huge
+    // page boundary: only aligned ranges can be backed by huge pages.
+    size_t mapped_len = len + kHugePageSize;
+    void* mapped = mmap(nullptr, mapped_len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+      return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+    uintptr_t aligned = KUDU_ALIGN_UP(start, kHugePageSize);
+    if (aligned > start) {
+      munmap(mapped, aligned - start);
+    }
+    uintptr_t end = start + mapped_len;
+    if (end > aligned + len) {
+      munmap(reinterpret_cast<void*>(aligned + len), end - aligned - len);
+    }
+    data = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    // Best effort: transparent huge pages may be disabled.
+    madvise(data, len, MADV_HUGEPAGE);
+#endif
+  }
+  huge_page_bytes_.IncrementBy(len);
+  return data;
+}
+
+void HugePageBufferAllocator::UnmapPages(void* data, size_t len) {
+  huge_page_bytes_.IncrementBy(-static_cast<int64_t>(len));
+  if (len == kHugePageSize) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (freelist_.size() * kHugePageSize <
+        static_cast<size_t>(FLAGS_arena_huge_page_freelist_mb) * 1024 * 1024) {
+      freelist_.push_back(data);
+      return;
+    }
+  }
+  PCHECK(munmap(data, len) == 0);
+}
+
 Buffer* ClearingBufferAllocator::AllocateInternal(size_t requested,
                                                   size_t minimal,
                                                   BufferAllocator* originator) {
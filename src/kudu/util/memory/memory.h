@@ -42,7 +42,9 @@
 
 #include <glog/logging.h>
 
+#include "kudu/util/atomic.h"
 #include "kudu/util/boost_mutex_utils.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mutex.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -50,10 +52,13 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/singleton.h"
 
+template <class T> class scoped_refptr;
+
 namespace kudu {
 
 class BufferAllocator;
 class MemTracker;
+class MetricEntity;
 
 // Wrapper for a block of data allocated by a BufferAllocator. Owns the block.
 // (To release the block, destroy the buffer - it will then return it via the
@@ -285,6 +290,80 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocates buffers of whole 2MB huge pages, mapped directly from the kernel
+// and aligned so that they can be backed by transparent huge pages. This cuts
+// down the TLB misses of lookups and scans over large in-memory structures,
+// such as the trees of big MemRowSets.
+//
+// Requests smaller than a huge page are served from the heap, so that small
+// arenas don't pay for a whole page. Freed single pages are kept on a
+// process-wide free list, up to --arena_huge_page_freelist_mb, and handed out
+// again by the next allocations: this saves mapping and faulting in the pages
+// again, e.g. when a flushed MemRowSet is replaced by a new one.
+//
+// If --arena_use_hugetlb is set, the pages are first taken from the reserved
+// hugetlbfs pool (MAP_HUGETLB), which guarantees huge pages but requires them
+// to be reserved by the administrator.
+//
+// This class is thread-safe.
+class HugePageBufferAllocator : public BufferAllocator {
+ public:
+  static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+  // Returns a singleton instance of the huge page allocator.
+  static HugePageBufferAllocator* Get() {
+    return Singleton<HugePageBufferAllocator>::get();
+  }
+
+  // Registers gauges for the huge pages mapped by this allocator.
+  void RegisterMetrics(const scoped_refptr<MetricEntity>& entity);
+
+  // Returns the number of bytes of huge pages handed out and not freed.
+  uint64_t huge_page_bytes() const;
+
+  // Returns the number of bytes of huge pages on the free list.
+  uint64_t freelist_bytes() const;
+
+  // Returns the number of pages which were handed out from the free list.
+  uint64_t num_reused_pages() const;
+
+ private:
+  friend class Singleton<HugePageBufferAllocator>;
+
+  HugePageBufferAllocator();
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  // Allocates 'size' bytes, in the range [minimal, requested] if the first
+  // attempt fails. Sizes of at least a huge page are mapped as whole pages,
+  // smaller ones come from the heap. Returns NULL on failure.
+  void* AllocateBytes(size_t requested, size_t minimal, size_t* size);
+  void FreeBytes(void* data, size_t size);
+
+  // Maps 'len' bytes of huge pages, a multiple of kHugePageSize.
+  void* MapPages(size_t len);
+  void UnmapPages(void* data, size_t len);
+
+  AtomicInt<int64_t> huge_page_bytes_;
+  AtomicInt<int64_t> num_reused_pages_;
+  AtomicBool hugetlb_unavailable_;
+
+  mutable simple_spinlock lock_;
+  // Single pages which were freed, protected by 'lock_'.
+  std::vector<void*> freelist_;
+
+  DISALLOW_COPY_AND_ASSIGN(HugePageBufferAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
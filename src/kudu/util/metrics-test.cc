@@ -385,4 +385,42 @@ TEST_F(MetricsTest, TestDontDumpUntouched) {
   ASSERT_STR_CONTAINS(out.str(), "test_gauge");
 }
 
+METRIC_DEFINE_entity(other_entity);
+
+// Test the Prometheus output, and the filtering of the entities by type.
+TEST_F(MetricsTest, TestWriteAsPrometheus) {
+  scoped_refptr<Counter> test_counter = METRIC_test_counter.Instantiate(entity_);
+  test_counter->IncrementBy(3);
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  hist->Increment(2);
+  hist->Increment(4);
+  entity_->SetAttribute("test_attr", "a \"quoted\" value");
+  scoped_refptr<MetricEntity> other_entity =
+      METRIC_ENTITY_other_entity.Instantiate(&registry_, "other");
+
+  std::ostringstream out;
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, MetricJsonOptions()));
+  const string labels = "id=\"my-test\",test_attr=\"a \\\"quoted\\\" value\"";
+  ASSERT_STR_CONTAINS(out.str(),
+                      "# HELP kudu_test_entity_test_counter Description of test counter\n"
+                      "# TYPE kudu_test_entity_test_counter counter\n"
+                      "kudu_test_entity_test_counter{" + labels + "} 3\n");
+  ASSERT_STR_CONTAINS(out.str(), "# TYPE kudu_test_entity_test_hist summary\n");
+  ASSERT_STR_CONTAINS(out.str(),
+                      "kudu_test_entity_test_hist{" + labels + ",quantile=\"0.99\"} 4\n");
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_entity_test_hist_sum{" + labels + "} 6\n");
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_entity_test_hist_count{" + labels + "} 2\n");
+
+  // Only the entities of the requested types are written, in both formats.
+  MetricJsonOptions opts;
+  opts.entity_types = { "other_entity" };
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, opts));
+  ASSERT_EQ("", out.str());
+  JsonWriter writer(&out, JsonWriter::COMPACT);
+  ASSERT_OK(registry_.WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_STR_NOT_CONTAINS(out.str(), "my-test");
+  ASSERT_STR_CONTAINS(out.str(), "other");
+}
+
 } // namespace kudu
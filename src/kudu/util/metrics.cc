@@ -16,7 +16,9 @@
 // under the License.
 #include "kudu/util/metrics.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <utility>
@@ -26,12 +28,12 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/gutil/strings/ascii_ctype.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
 #include "kudu/util/histogram.pb.h"
 #include "kudu/util/status.h"
-#include "kudu/util/string_case.h"
 
 DEFINE_int32(metrics_retirement_age_ms, 120 * 1000,
              "The minimum number of milliseconds a metric will be kept for after it is "
@@ -186,53 +188,100 @@ scoped_refptr<Metric> MetricEntity::FindOrNull(const MetricPrototype& prototype)
 
 namespace {
 
+// This is called for every metric of every entity when the metrics are
+// dumped, so it avoids allocating.
 bool MatchMetricInList(const string& metric_name,
                        const vector<string>& match_params) {
-  string metric_name_uc;
-  ToUpperCase(metric_name, &metric_name_uc);
-
   for (const string& param : match_params) {
     // Handle wildcard.
     if (param == "*") return true;
     // The parameter is a case-insensitive substring match of the metric name.
-    string param_uc;
-    ToUpperCase(param, &param_uc);
-    if (metric_name_uc.find(param_uc) != std::string::npos) {
+    if (param.empty() ||
+        std::search(metric_name.begin(), metric_name.end(), param.begin(), param.end(),
+                    [](char a, char b) { return ascii_toupper(a) == ascii_toupper(b); }) !=
+        metric_name.end()) {
       return true;
     }
   }
   return false;
 }
 
-} // anonymous namespace
+// Returns whether the metric should be written given the epoch and the
+// untouched metrics options.
+bool ShouldWriteMetric(Metric* metric, const MetricJsonOptions& opts) {
+  return metric->ModifiedInOrAfterEpoch(opts.only_modified_in_or_after_epoch) &&
+      (opts.include_untouched_metrics || !metric->IsUntouched());
+}
+
+// Escapes 'value' for use in a Prometheus label value, or in the text of a
+// HELP line if 'is_help' is true.
+string EscapePrometheus(const string& value, bool is_help) {
+  string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    switch (c) {
+      case '\\':
+        escaped.append("\\\\");
+        break;
+      case '\n':
+        escaped.append("\\n");
+        break;
+      case '"':
+        escaped.append(is_help ? "\"" : "\\\"");
+        break;
+      default:
+        escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
 
+} // anonymous namespace
 
-Status MetricEntity::WriteAsJson(JsonWriter* writer,
-                                 const vector<string>& requested_metrics,
-                                 const MetricJsonOptions& opts) const {
+bool MetricEntity::SelectMetrics(const vector<string>& requested_metrics,
+                                 const MetricJsonOptions& opts,
+                                 vector<scoped_refptr<Metric>>* metrics,
+                                 AttributeMap* attrs) const {
+  if (!opts.entity_types.empty() &&
+      std::find(opts.entity_types.begin(), opts.entity_types.end(), prototype_->name()) ==
+      opts.entity_types.end()) {
+    return false;
+  }
   bool select_all = MatchMetricInList(id(), requested_metrics);
-
-  // We want the keys to be in alphabetical order when printing, so we use an ordered map here.
-  typedef std::map<const char*, scoped_refptr<Metric> > OrderedMetricMap;
-  OrderedMetricMap metrics;
-  AttributeMap attrs;
   {
     // Snapshot the metrics in this registry (not guaranteed to be a consistent snapshot)
     std::lock_guard<simple_spinlock> l(lock_);
-    attrs = attributes_;
+    *attrs = attributes_;
     for (const MetricMap::value_type& val : metric_map_) {
       const MetricPrototype* prototype = val.first;
       const scoped_refptr<Metric>& metric = val.second;
 
       if (select_all || MatchMetricInList(prototype->name(), requested_metrics)) {
-        InsertOrDie(&metrics, prototype->name(), metric);
+        metrics->push_back(metric);
       }
     }
   }
 
   // If we had a filter, and we didn't either match this entity or any metrics inside
   // it, don't print the entity at all.
-  if (!requested_metrics.empty() && !select_all && metrics.empty()) {
+  if (!requested_metrics.empty() && !select_all && metrics->empty()) {
+    return false;
+  }
+
+  // We want the metrics to be in alphabetical order when printing.
+  std::sort(metrics->begin(), metrics->end(),
+            [](const scoped_refptr<Metric>& a, const scoped_refptr<Metric>& b) {
+              return strcmp(a->prototype()->name(), b->prototype()->name()) < 0;
+            });
+  return true;
+}
+
+Status MetricEntity::WriteAsJson(JsonWriter* writer,
+                                 const vector<string>& requested_metrics,
+                                 const MetricJsonOptions& opts) const {
+  vector<scoped_refptr<Metric>> metrics;
+  AttributeMap attrs;
+  if (!SelectMetrics(requested_metrics, opts, &metrics, &attrs)) {
     return Status::OK();
   }
 
@@ -256,14 +305,10 @@ Status MetricEntity::WriteAsJson(JsonWriter* writer,
 
   writer->String("metrics");
   writer->StartArray();
-  for (OrderedMetricMap::value_type& val : metrics) {
-    const auto& m = val.second;
-    if (m->ModifiedInOrAfterEpoch(opts.only_modified_in_or_after_epoch)) {
-      if (!opts.include_untouched_metrics && m->IsUntouched()) {
-        continue;
-      }
+  for (const auto& m : metrics) {
+    if (ShouldWriteMetric(m.get(), opts)) {
       WARN_NOT_OK(m->WriteAsJson(writer, opts),
-                  strings::Substitute("Failed to write $0 as JSON", val.first));
+                  strings::Substitute("Failed to write $0 as JSON", m->prototype()->name()));
     }
   }
   writer->EndArray();
@@ -369,6 +414,66 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+Status MetricRegistry::WriteAsPrometheus(std::ostream* out,
+                                         const vector<string>& requested_metrics,
+                                         const MetricJsonOptions& opts) const {
+  EntityMap entities;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    entities = entities_;
+  }
+
+  // All the samples of a metric family must be written together, so the
+  // selected metrics of all entities are grouped by family first, along with
+  // the labels of their entity.
+  struct Family {
+    const MetricPrototype* prototype;
+    vector<std::pair<string, scoped_refptr<Metric>>> metrics;
+  };
+  std::map<string, Family> families;
+  for (const EntityMap::value_type& e : entities) {
+    vector<scoped_refptr<Metric>> metrics;
+    MetricEntity::AttributeMap attrs;
+    if (!e.second->SelectMetrics(requested_metrics, opts, &metrics, &attrs)) {
+      continue;
+    }
+    string labels = Substitute("id=\"$0\"", EscapePrometheus(e.second->id(), false));
+    if (opts.include_entity_attributes) {
+      std::map<string, string> ordered_attrs(attrs.begin(), attrs.end());
+      for (const auto& attr : ordered_attrs) {
+        labels += Substitute(",$0=\"$1\"", attr.first, EscapePrometheus(attr.second, false));
+      }
+    }
+    for (auto& m : metrics) {
+      if (!ShouldWriteMetric(m.get(), opts)) {
+        continue;
+      }
+      const MetricPrototype* prototype = m->prototype();
+      Family& family = families[Substitute("kudu_$0_$1",
+                                           prototype->entity_type(), prototype->name())];
+      family.prototype = prototype;
+      family.metrics.emplace_back(labels, std::move(m));
+    }
+  }
+
+  for (const auto& f : families) {
+    const string& name = f.first;
+    const Family& family = f.second;
+    *out << "# HELP " << name << ' '
+         << EscapePrometheus(family.prototype->description(), true) << '\n';
+    *out << "# TYPE " << name << ' ' << family.metrics.front().second->PrometheusType() << '\n';
+    for (const auto& m : family.metrics) {
+      m.second->WriteAsPrometheus(out, name, m.first);
+    }
+  }
+
+  // See WriteAsJson().
+  families.clear();
+  entities.clear();
+  const_cast<MetricRegistry*>(this)->RetireOldMetrics();
+  return Status::OK();
+}
+
 void MetricRegistry::RetireOldMetrics() {
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = entities_.begin(); it != entities_.end();) {
@@ -610,6 +715,11 @@ Status Counter::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+void Counter::WriteAsPrometheus(std::ostream* out, const string& name,
+                                const string& labels) const {
+  *out << name << '{' << labels << "} " << value() << '\n';
+}
+
 /////////////////////////////////////////////////
 // HistogramPrototype
 /////////////////////////////////////////////////
@@ -661,6 +771,20 @@ Status Histogram::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+void Histogram::WriteAsPrometheus(std::ostream* out, const string& name,
+                                  const string& labels) const {
+  static const char* const kQuantiles[] = { "0.5", "0.75", "0.95", "0.99", "0.999" };
+  static const double kPercentiles[] = { 50, 75, 95, 99, 99.9 };
+  HdrHistogram snapshot(*histogram_);
+  bool empty = snapshot.TotalCount() == 0;
+  for (size_t i = 0; i < arraysize(kQuantiles); i++) {
+    *out << name << '{' << labels << ",quantile=\"" << kQuantiles[i] << "\"} "
+         << (empty ? 0 : snapshot.ValueAtPercentile(kPercentiles[i])) << '\n';
+  }
+  *out << name << "_sum{" << labels << "} " << snapshot.TotalSum() << '\n';
+  *out << name << "_count{" << labels << "} " << snapshot.TotalCount() << '\n';
+}
+
 Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                          const MetricJsonOptions& opts) const {
   snapshot_pb->set_name(prototype_->name());
@@ -228,6 +228,7 @@
 #include <cstdint>
 #include <limits>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -438,6 +439,10 @@ struct MetricJsonOptions {
 
   // Whether to include the attributes of each entity.
   bool include_entity_attributes = true;
+
+  // If not empty, only the entities of these types (e.g. "server", "tablet")
+  // are included.
+  std::vector<std::string> entity_types;
 };
 
 class MetricEntityPrototype {
@@ -545,6 +550,15 @@ class MetricEntity : public RefCountedThreadSafe<MetricEntity> {
   // type defined within the metric prototype.
   void CheckInstantiation(const MetricPrototype* proto) const;
 
+  // Snapshots the attributes of this entity and those of its metrics which
+  // are selected by 'requested_metrics', ordered by name. Returns false if
+  // the entity should not be written at all, either because of its type or
+  // because neither it nor any of its metrics matched 'requested_metrics'.
+  bool SelectMetrics(const std::vector<std::string>& requested_metrics,
+                     const MetricJsonOptions& opts,
+                     std::vector<scoped_refptr<Metric>>* metrics,
+                     AttributeMap* attrs) const;
+
   const MetricEntityPrototype* const prototype_;
   const std::string id_;
 
@@ -571,6 +585,15 @@ class Metric : public RefCountedThreadSafe<Metric> {
   virtual Status WriteAsJson(JsonWriter* writer,
                              const MetricJsonOptions& opts) const = 0;
 
+  // Writes the samples of this metric in the Prometheus text format, under
+  // the metric family 'name' and with the already-formatted 'labels'.
+  // Metrics without a numeric value write nothing.
+  virtual void WriteAsPrometheus(std::ostream* out, const std::string& name,
+                                 const std::string& labels) const = 0;
+
+  // Returns the Prometheus type of the samples written by WriteAsPrometheus().
+  virtual const char* PrometheusType() const = 0;
+
   const MetricPrototype* prototype() const { return prototype_; }
 
   // Return true if this metric has never been touched.
@@ -659,6 +682,17 @@ class MetricRegistry {
                      const std::vector<std::string>& requested_metrics,
                      const MetricJsonOptions& opts) const;
 
+  // Writes metrics in this registry to 'out' in the Prometheus text
+  // exposition format, selected in the same way as by WriteAsJson().
+  //
+  // Every metric makes up the family "kudu_<entity type>_<metric name>", with
+  // the ID and the attributes of its entity as labels. Histograms are written
+  // as summaries. The options regarding the schema and the raw histograms are
+  // ignored.
+  Status WriteAsPrometheus(std::ostream* out,
+                           const std::vector<std::string>& requested_metrics,
+                           const MetricJsonOptions& opts) const;
+
   // For each registered entity, retires orphaned metrics. If an entity has no more
   // metrics and there are no external references, entities are removed as well.
   //
@@ -818,6 +852,7 @@ class Gauge : public Metric {
   virtual ~Gauge() {}
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
+  virtual const char* PrometheusType() const OVERRIDE { return "gauge"; }
 
  protected:
   virtual void WriteValue(JsonWriter* writer) const = 0;
@@ -835,6 +870,9 @@ class StringGauge : public Gauge {
   virtual bool IsUntouched() const override {
     return false;
   }
+  virtual void WriteAsPrometheus(std::ostream* /*out*/, const std::string& /*name*/,
+                                 const std::string& /*labels*/) const OVERRIDE {
+  }
 
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE;
@@ -875,6 +913,10 @@ class AtomicGauge : public Gauge {
   virtual bool IsUntouched() const override {
     return false;
   }
+  virtual void WriteAsPrometheus(std::ostream* out, const std::string& name,
+                                 const std::string& labels) const OVERRIDE {
+    *out << name << '{' << labels << "} " << value() << '\n';
+  }
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -954,6 +996,11 @@ class FunctionGauge : public Gauge {
     writer->Value(value());
   }
 
+  virtual void WriteAsPrometheus(std::ostream* out, const std::string& name,
+                                 const std::string& labels) const OVERRIDE {
+    *out << name << '{' << labels << "} " << value() << '\n';
+  }
+
   // Reset this FunctionGauge to return a specific value.
   // This should be used during destruction. If you want a settable
   // Gauge, use a normal Gauge instead of a FunctionGauge.
@@ -1045,6 +1092,10 @@ class Counter : public Metric {
     return value() == 0;
   }
 
+  virtual void WriteAsPrometheus(std::ostream* out, const std::string& name,
+                                 const std::string& labels) const OVERRIDE;
+  virtual const char* PrometheusType() const OVERRIDE { return "counter"; }
+
  private:
   FRIEND_TEST(MetricsTest, SimpleCounterTest);
   FRIEND_TEST(MultiThreadedMetricsTest, CounterIncrementTest);
@@ -1089,6 +1140,11 @@ class Histogram : public Metric {
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
 
+  // Writes the histogram as a Prometheus summary with a few quantiles.
+  virtual void WriteAsPrometheus(std::ostream* out, const std::string& name,
+                                 const std::string& labels) const OVERRIDE;
+  virtual const char* PrometheusType() const OVERRIDE { return "summary"; }
+
   // Returns a snapshot of this histogram including the bucketed values and counts.
   Status GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                 const MetricJsonOptions& opts) const;
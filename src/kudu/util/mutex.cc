@@ -28,12 +28,14 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/gutil/cycleclock-inl.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/trace.h"
 
 using std::string;
@@ -101,6 +103,7 @@ void Mutex::Acquire() {
 
   // If we weren't able to acquire the mutex immediately, then it's
   // worth gathering timing information about the mutex acquisition.
+  int64_t start_cycles = CycleClock::Now();
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   int rv = pthread_mutex_lock(&native_handle_);
   DCHECK_EQ(0, rv) << ". " << strerror(rv)
@@ -114,6 +117,7 @@ void Mutex::Acquire() {
   if (wait_time > 0) {
     TRACE_COUNTER_INCREMENT("mutex_wait_us", wait_time);
   }
+  SubmitLockContention(this, CycleClock::Now() - start_cycles);
 
 #ifndef NDEBUG
   CheckUnheldAndMark();
@@ -15,6 +15,9 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <cstdint>
 #include <ostream>
@@ -25,6 +28,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/socket.h"
@@ -63,6 +67,31 @@ TEST(SockaddrTest, Test) {
   ASSERT_EQ("1.1.1.1", addr.host());
 }
 
+TEST(SockaddrTest, TestUnixDomainPath) {
+  Sockaddr addr;
+  ASSERT_OK(addr.ParseUnixDomainPath("/tmp/kudu.sock"));
+  ASSERT_EQ(AF_UNIX, addr.family());
+  ASSERT_EQ("/tmp/kudu.sock", addr.UnixDomainPath());
+  ASSERT_EQ("unix:/tmp/kudu.sock", addr.ToString());
+
+  const string abstract_path = strings::Substitute("@kudu-net_util-test-$0", getpid());
+  Sockaddr abstract_addr;
+  ASSERT_OK(abstract_addr.ParseUnixDomainPath(abstract_path));
+  ASSERT_EQ(abstract_path, abstract_addr.UnixDomainPath());
+  ASSERT_FALSE(addr == abstract_addr);
+
+  ASSERT_TRUE(addr.ParseUnixDomainPath("").IsInvalidArgument());
+  ASSERT_TRUE(addr.ParseUnixDomainPath(string(200, 'x')).IsInvalidArgument());
+
+  // A listening abstract socket reports the address it was bound to.
+  Socket sock;
+  ASSERT_OK(sock.Init(AF_UNIX, 0));
+  ASSERT_OK(sock.BindAndListen(abstract_addr, 1));
+  Sockaddr bound_addr;
+  ASSERT_OK(sock.GetSocketAddress(&bound_addr));
+  ASSERT_EQ(abstract_addr, bound_addr);
+}
+
 TEST_F(NetUtilTest, TestParseAddresses) {
   string ret;
   ASSERT_OK(DoParseBindAddresses("0.0.0.0:12345", &ret));
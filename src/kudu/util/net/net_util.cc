@@ -209,6 +209,9 @@ Network::Network(uint32_t addr, uint32_t netmask)
   : addr_(addr), netmask_(netmask) {}
 
 bool Network::WithinNetwork(const Sockaddr& addr) const {
+  if (!addr.is_ip()) {
+    return false;
+  }
   return ((addr.addr().sin_addr.s_addr & netmask_) ==
           (addr_ & netmask_));
 }
@@ -22,9 +22,12 @@
 #include <sys/socket.h>
 
 #include <cerrno>
+#include <cstddef>
 #include <cstring>
 #include <string>
 
+#include <glog/logging.h>
+
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/hash/builtin_type_hash.h"
 #include "kudu/gutil/port.h"
@@ -41,83 +44,153 @@ namespace kudu {
 /// Sockaddr
 ///
 Sockaddr::Sockaddr() {
-  memset(&addr_, 0, sizeof(addr_));
-  addr_.sin_family = AF_INET;
-  addr_.sin_addr.s_addr = INADDR_ANY;
+  memset(&storage_, 0, sizeof(storage_));
+  in_.sin_family = AF_INET;
+  in_.sin_addr.s_addr = INADDR_ANY;
+  len_ = sizeof(struct sockaddr_in);
 }
 
 Sockaddr::Sockaddr(const struct sockaddr_in& addr) {
-  memcpy(&addr_, &addr, sizeof(struct sockaddr_in));
+  *this = addr;
 }
 
 Status Sockaddr::ParseString(const std::string& s, uint16_t default_port) {
   HostPort hp;
   RETURN_NOT_OK(hp.ParseString(s, default_port));
 
-  if (inet_pton(AF_INET, hp.host().c_str(), &addr_.sin_addr) != 1) {
+  struct in_addr ip;
+  if (inet_pton(AF_INET, hp.host().c_str(), &ip) != 1) {
     return Status::InvalidArgument("Invalid IP address", hp.host());
   }
+  *this = Sockaddr();
+  in_.sin_addr = ip;
   set_port(hp.port());
   return Status::OK();
 }
 
+Status Sockaddr::ParseUnixDomainPath(const std::string& s) {
+  // The path of a non-abstract socket must leave room for its NUL terminator.
+  constexpr size_t kMaxPathLen = sizeof(un_.sun_path) - 1;
+  if (s.empty()) {
+    return Status::InvalidArgument("empty UNIX domain socket path");
+  }
+  if (s.size() > kMaxPathLen) {
+    return Status::InvalidArgument(
+        Substitute("UNIX domain socket path longer than $0 bytes", kMaxPathLen), s);
+  }
+  memset(&storage_, 0, sizeof(storage_));
+  un_.sun_family = AF_UNIX;
+  memcpy(un_.sun_path, s.data(), s.size());
+  len_ = offsetof(struct sockaddr_un, sun_path) + s.size();
+  if (s[0] == '@') {
+    // Abstract names are matched on all of their bytes, so no terminator is
+    // counted in the length.
+    un_.sun_path[0] = '\0';
+  } else {
+    len_ += 1;
+  }
+  return Status::OK();
+}
+
 Sockaddr& Sockaddr::operator=(const struct sockaddr_in &addr) {
-  memcpy(&addr_, &addr, sizeof(struct sockaddr_in));
+  memset(&storage_, 0, sizeof(storage_));
+  memcpy(&in_, &addr, sizeof(struct sockaddr_in));
+  len_ = sizeof(struct sockaddr_in);
   return *this;
 }
 
+void Sockaddr::Set(const struct sockaddr* addr, socklen_t len) {
+  DCHECK_LE(len, sizeof(storage_));
+  DCHECK(addr->sa_family == AF_INET || addr->sa_family == AF_UNIX) << addr->sa_family;
+  memset(&storage_, 0, sizeof(storage_));
+  memcpy(&storage_, addr, len);
+  len_ = len;
+}
+
 bool Sockaddr::operator==(const Sockaddr& other) const {
-  return memcmp(&other.addr_, &addr_, sizeof(addr_)) == 0;
+  return len_ == other.len_ && memcmp(&other.storage_, &storage_, len_) == 0;
 }
 
 bool Sockaddr::operator<(const Sockaddr &rhs) const {
-  return addr_.sin_addr.s_addr < rhs.addr_.sin_addr.s_addr;
+  if (family() != rhs.family()) {
+    return family() < rhs.family();
+  }
+  if (!is_ip()) {
+    return UnixDomainPath() < rhs.UnixDomainPath();
+  }
+  return in_.sin_addr.s_addr < rhs.in_.sin_addr.s_addr;
 }
 
 uint32_t Sockaddr::HashCode() const {
-  uint32_t hash = Hash32NumWithSeed(addr_.sin_addr.s_addr, 0);
-  hash = Hash32NumWithSeed(addr_.sin_port, hash);
+  if (!is_ip()) {
+    return std::hash<string>()(UnixDomainPath());
+  }
+  uint32_t hash = Hash32NumWithSeed(in_.sin_addr.s_addr, 0);
+  hash = Hash32NumWithSeed(in_.sin_port, hash);
   return hash;
 }
 
 void Sockaddr::set_port(int port) {
-  addr_.sin_port = htons(port);
+  DCHECK(is_ip());
+  in_.sin_port = htons(port);
 }
 
 int Sockaddr::port() const {
-  return ntohs(addr_.sin_port);
+  DCHECK(is_ip());
+  return ntohs(in_.sin_port);
 }
 
 std::string Sockaddr::host() const {
+  DCHECK(is_ip());
   char str[INET_ADDRSTRLEN];
-  ::inet_ntop(AF_INET, &addr_.sin_addr, str, INET_ADDRSTRLEN);
+  ::inet_ntop(AF_INET, &in_.sin_addr, str, INET_ADDRSTRLEN);
   return str;
 }
 
 const struct sockaddr_in& Sockaddr::addr() const {
-  return addr_;
+  DCHECK(is_ip());
+  return in_;
+}
+
+std::string Sockaddr::UnixDomainPath() const {
+  DCHECK_EQ(AF_UNIX, family());
+  size_t path_len = len_ - offsetof(struct sockaddr_un, sun_path);
+  if (path_len == 0) {
+    return "";
+  }
+  if (un_.sun_path[0] == '\0') {
+    return "@" + string(un_.sun_path + 1, path_len - 1);
+  }
+  return string(un_.sun_path, strnlen(un_.sun_path, path_len));
 }
 
 std::string Sockaddr::ToString() const {
+  if (!is_ip()) {
+    string path = UnixDomainPath();
+    return Substitute("unix:$0", path.empty() ? "<unnamed>" : path);
+  }
   return Substitute("$0:$1", host(), port());
 }
 
 bool Sockaddr::IsWildcard() const {
-  return addr_.sin_addr.s_addr == 0;
+  return is_ip() && in_.sin_addr.s_addr == 0;
 }
 
 bool Sockaddr::IsAnyLocalAddress() const {
-  return (NetworkByteOrder::FromHost32(addr_.sin_addr.s_addr) >> 24) == 127;
+  return is_ip() && (NetworkByteOrder::FromHost32(in_.sin_addr.s_addr) >> 24) == 127;
 }
 
 Status Sockaddr::LookupHostname(string* hostname) const {
   char host[NI_MAXHOST];
   int flags = 0;
 
+  if (!is_ip()) {
+    return Status::NotSupported("cannot look up the hostname of", ToString());
+  }
   int rc;
   LOG_SLOW_EXECUTION(WARNING, 200,
                      Substitute("DNS reverse-lookup for $0", ToString())) {
-    rc = getnameinfo((struct sockaddr *) &addr_, sizeof(sockaddr_in),
+    rc = getnameinfo(raw_addr(), len_,
                      host, NI_MAXHOST,
                      nullptr, 0, flags);
   }
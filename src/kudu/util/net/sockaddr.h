@@ -18,6 +18,8 @@
 #define KUDU_UTIL_NET_SOCKADDR_H
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <cstdint>
 #include <functional>
@@ -30,9 +32,9 @@ namespace kudu {
 ///
 /// Represents a sockaddr.
 ///
-/// Currently only IPv4 is implemented.  When IPv6 and UNIX domain are
-/// implemented, this should become an abstract base class and those should be
-/// multiple implementations.
+/// IPv4 and UNIX domain socket addresses are implemented. Unless noted
+/// otherwise, the accessors of the IP host and port may only be used on IPv4
+/// addresses.
 ///
 class Sockaddr {
  public:
@@ -46,8 +48,19 @@ class Sockaddr {
   // Returns a bad Status if the input is malformed.
   Status ParseString(const std::string& s, uint16_t default_port);
 
+  // Parse the path of a UNIX domain socket, storing the result in this
+  // Sockaddr object. A path starting with '@' names a socket in the Linux
+  // abstract namespace, which has no presence in the filesystem.
+  //
+  // Returns a bad Status if the path is empty or too long.
+  Status ParseUnixDomainPath(const std::string& s);
+
   Sockaddr& operator=(const struct sockaddr_in &addr);
 
+  // Sets this Sockaddr from the 'len' bytes of 'addr', as filled in by
+  // accept(2), getsockname(2) and the like.
+  void Set(const struct sockaddr* addr, socklen_t len);
+
   bool operator==(const Sockaddr& other) const;
 
   // Compare the endpoints of two sockaddrs.
@@ -56,6 +69,10 @@ class Sockaddr {
 
   uint32_t HashCode() const;
 
+  // Returns the address family, AF_INET or AF_UNIX.
+  int family() const { return storage_.ss_family; }
+  bool is_ip() const { return family() == AF_INET; }
+
   // Returns the dotted-decimal string '1.2.3.4' of the host component of this address.
   std::string host() const;
 
@@ -63,7 +80,20 @@ class Sockaddr {
   int port() const;
   const struct sockaddr_in& addr() const;
 
-  // Returns the stringified address in '1.2.3.4:<port>' format.
+  // Returns the address as passed to bind(2) and connect(2), along with its
+  // length.
+  const struct sockaddr* raw_addr() const {
+    return reinterpret_cast<const struct sockaddr*>(&storage_);
+  }
+  socklen_t addrlen() const { return len_; }
+
+  // Returns the path of a UNIX domain socket address, with a leading '@' for
+  // an abstract one. Returns an empty string for an unnamed socket, such as
+  // the client end of an accepted connection.
+  std::string UnixDomainPath() const;
+
+  // Returns the stringified address in '1.2.3.4:<port>' format, or
+  // 'unix:<path>' for a UNIX domain socket.
   std::string ToString() const;
 
   // Returns true if the address is 0.0.0.0
@@ -77,7 +107,12 @@ class Sockaddr {
 
   // the default auto-generated copy constructor is fine here
  private:
-  struct sockaddr_in addr_;
+  union {
+    struct sockaddr_storage storage_;
+    struct sockaddr_in in_;
+    struct sockaddr_un un_;
+  };
+  socklen_t len_;
 };
 
 } // namespace kudu
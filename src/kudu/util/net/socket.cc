@@ -18,6 +18,9 @@
 #include "kudu/util/net/socket.h"
 
 #include <fcntl.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
@@ -61,6 +64,23 @@ DEFINE_bool(socket_inject_short_recvs, false,
 TAG_FLAG(socket_inject_short_recvs, hidden);
 TAG_FLAG(socket_inject_short_recvs, unsafe);
 
+// Older kernel headers don't define the MSG_ZEROCOPY interface (Linux 4.14).
+// The kernel rejects these with an error if it doesn't support them.
+#if defined(__linux__)
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#endif // defined(__linux__)
+
 namespace kudu {
 
 Socket::Socket()
@@ -128,9 +148,9 @@ bool Socket::IsTemporarySocketError(int err) {
 
 #if defined(__linux__)
 
-Status Socket::Init(int flags) {
+Status Socket::Init(int family, int flags) {
   int nonblocking_flag = (flags & FLAG_NONBLOCKING) ? SOCK_NONBLOCK : 0;
-  Reset(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | nonblocking_flag, 0));
+  Reset(::socket(family, SOCK_STREAM | SOCK_CLOEXEC | nonblocking_flag, 0));
   if (fd_ < 0) {
     int err = errno;
     return Status::NetworkError(std::string("error opening socket: ") +
@@ -142,8 +162,8 @@ Status Socket::Init(int flags) {
 
 #else
 
-Status Socket::Init(int flags) {
-  Reset(::socket(AF_INET, SOCK_STREAM, 0));
+Status Socket::Init(int family, int flags) {
+  Reset(::socket(family, SOCK_STREAM, 0));
   if (fd_ < 0) {
     int err = errno;
     return Status::NetworkError(std::string("error opening socket: ") +
@@ -165,10 +185,18 @@ Status Socket::Init(int flags) {
 
 #endif // defined(__linux__)
 
+Status Socket::Init(int flags) {
+  return Init(AF_INET, flags);
+}
+
 Status Socket::SetNoDelay(bool enabled) {
   int flag = enabled ? 1 : 0;
   if (setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) == -1) {
     int err = errno;
+    if (err == EOPNOTSUPP) {
+      // Not a TCP socket.
+      return Status::OK();
+    }
     return Status::NetworkError(std::string("failed to set TCP_NODELAY: ") +
                                 ErrnoToString(err), Slice(), err);
   }
@@ -180,6 +208,10 @@ Status Socket::SetTcpCork(bool enabled) {
   int flag = enabled ? 1 : 0;
   if (setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag)) == -1) {
     int err = errno;
+    if (err == EOPNOTSUPP) {
+      // Not a TCP socket.
+      return Status::OK();
+    }
     return Status::NetworkError(std::string("failed to set TCP_CORK: ") +
                                 ErrnoToString(err), Slice(), err);
   }
@@ -188,6 +220,32 @@ Status Socket::SetTcpCork(bool enabled) {
   return Status::OK();
 }
 
+Status Socket::EnableZeroCopySend() {
+#if defined(__linux__)
+  int flag = 1;
+  if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof(flag)) == -1) {
+    int err = errno;
+    return Status::NotSupported(std::string("failed to set SO_ZEROCOPY: ") +
+                                ErrnoToString(err), Slice(), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("zero-copy send is only supported on Linux");
+#endif // defined(__linux__)
+}
+
+Status Socket::SetResetOnClose() {
+  struct linger l;
+  l.l_onoff = 1;
+  l.l_linger = 0;
+  if (setsockopt(fd_, SOL_SOCKET, SO_LINGER, &l, sizeof(l)) == -1) {
+    int err = errno;
+    return Status::NetworkError(std::string("failed to set SO_LINGER: ") +
+                                ErrnoToString(err), Slice(), err);
+  }
+  return Status::OK();
+}
+
 Status Socket::SetNonBlocking(bool enabled) {
   int curflags = ::fcntl(fd_, F_GETFL, 0);
   if (curflags == -1) {
@@ -277,34 +335,36 @@ Status Socket::Listen(int listen_queue_size) {
 }
 
 Status Socket::GetSocketAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getsockname(fd_, (struct sockaddr *)&sin, &len) == -1) {
+  if (::getsockname(fd_, (struct sockaddr *)&ss, &len) == -1) {
     int err = errno;
     return Status::NetworkError(std::string("getsockname error: ") +
                                 ErrnoToString(err), Slice(), err);
   }
-  *cur_addr = sin;
+  cur_addr->Set((struct sockaddr *)&ss, len);
   return Status::OK();
 }
 
 Status Socket::GetPeerAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getpeername(fd_, (struct sockaddr *)&sin, &len) == -1) {
+  if (::getpeername(fd_, (struct sockaddr *)&ss, &len) == -1) {
     int err = errno;
     return Status::NetworkError(std::string("getpeername error: ") +
                                 ErrnoToString(err), Slice(), err);
   }
-  *cur_addr = sin;
+  cur_addr->Set((struct sockaddr *)&ss, len);
   return Status::OK();
 }
 
 bool Socket::IsLoopbackConnection() const {
   Sockaddr local, remote;
   if (!GetSocketAddress(&local).ok()) return false;
+  // Both ends of a UNIX domain socket are always on the same host.
+  if (local.family() == AF_UNIX) return true;
   if (!GetPeerAddress(&remote).ok()) return false;
 
   // Compare without comparing ports.
@@ -314,17 +374,16 @@ bool Socket::IsLoopbackConnection() const {
 }
 
 Status Socket::Bind(const Sockaddr& bind_addr) {
-  struct sockaddr_in addr = bind_addr.addr();
-
   DCHECK_GE(fd_, 0);
-  if (PREDICT_FALSE(::bind(fd_, (struct sockaddr*) &addr, sizeof(addr)))) {
+  if (PREDICT_FALSE(::bind(fd_, bind_addr.raw_addr(), bind_addr.addrlen()))) {
     int err = errno;
     Status s = Status::NetworkError(
         strings::Substitute("error binding socket to $0: $1",
                             bind_addr.ToString(), ErrnoToString(err)),
         Slice(), err);
 
-    if (s.IsNetworkError() && s.posix_code() == EADDRINUSE && bind_addr.port() != 0) {
+    if (s.IsNetworkError() && s.posix_code() == EADDRINUSE &&
+        bind_addr.is_ip() && bind_addr.port() != 0) {
       TryRunLsof(bind_addr);
     }
     return s;
@@ -335,7 +394,7 @@ Status Socket::Bind(const Sockaddr& bind_addr) {
 
 Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   TRACE_EVENT0("net", "Socket::Accept");
-  struct sockaddr_in addr;
+  struct sockaddr_storage addr;
   socklen_t olen = sizeof(addr);
   DCHECK_GE(fd_, 0);
 #if defined(__linux__)
@@ -366,7 +425,7 @@ Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   RETURN_NOT_OK(new_conn->SetCloseOnExec());
 #endif // defined(__linux__)
 
-  *remote = addr;
+  remote->Set((struct sockaddr*)&addr, olen);
   TRACE_EVENT_INSTANT1("net", "Accepted", TRACE_EVENT_SCOPE_THREAD,
                        "remote", remote->ToString());
   return Status::OK();
@@ -386,14 +445,12 @@ Status Socket::BindForOutgoingConnection() {
 Status Socket::Connect(const Sockaddr &remote) {
   TRACE_EVENT1("net", "Socket::Connect",
                "remote", remote.ToString());
-  if (PREDICT_FALSE(!FLAGS_local_ip_for_outbound_sockets.empty())) {
+  if (PREDICT_FALSE(!FLAGS_local_ip_for_outbound_sockets.empty() && remote.is_ip())) {
     RETURN_NOT_OK(BindForOutgoingConnection());
   }
 
-  struct sockaddr_in addr;
-  memcpy(&addr, &remote.addr(), sizeof(sockaddr_in));
   DCHECK_GE(fd_, 0);
-  if (::connect(fd_, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
+  if (::connect(fd_, remote.raw_addr(), remote.addrlen()) < 0) {
     int err = errno;
     return Status::NetworkError(std::string("connect(2) error: ") +
                                 ErrnoToString(err), Slice(), err);
@@ -436,6 +493,20 @@ Status Socket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
 
 Status Socket::Writev(const struct ::iovec *iov, int iov_len,
                       int64_t *nwritten) {
+  return SendMsg(iov, iov_len, 0, nwritten);
+}
+
+Status Socket::WritevZeroCopy(const struct ::iovec *iov, int iov_len,
+                              int64_t *nwritten) {
+#if defined(__linux__)
+  return SendMsg(iov, iov_len, MSG_ZEROCOPY, nwritten);
+#else
+  return Status::NotSupported("zero-copy send is only supported on Linux");
+#endif // defined(__linux__)
+}
+
+Status Socket::SendMsg(const struct ::iovec *iov, int iov_len, int flags,
+                       int64_t *nwritten) {
   if (PREDICT_FALSE(iov_len <= 0)) {
     return Status::NetworkError(
                 StringPrintf("writev: invalid io vector length of %d",
@@ -448,7 +519,7 @@ Status Socket::Writev(const struct ::iovec *iov, int iov_len,
   memset(&msg, 0, sizeof(struct msghdr));
   msg.msg_iov = const_cast<iovec *>(iov);
   msg.msg_iovlen = iov_len;
-  ssize_t res = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+  ssize_t res = ::sendmsg(fd_, &msg, MSG_NOSIGNAL | flags);
   if (PREDICT_FALSE(res < 0)) {
     int err = errno;
     return Status::NetworkError(std::string("sendmsg error: ") +
@@ -459,6 +530,47 @@ Status Socket::Writev(const struct ::iovec *iov, int iov_len,
   return Status::OK();
 }
 
+Status Socket::ReadZeroCopyCompletions(uint64_t* num_completed, bool* copied) {
+#if defined(__linux__)
+  DCHECK_GE(fd_, 0);
+  while (true) {
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      int err = errno;
+      if (err == EAGAIN || err == EWOULDBLOCK) {
+        // The error queue has been drained.
+        return Status::OK();
+      }
+      return Status::NetworkError(std::string("recvmsg error: ") +
+                                  ErrnoToString(err), Slice(), err);
+    }
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+            (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+        continue;
+      }
+      const auto* serr = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      // The notification covers the inclusive range of send sequence
+      // numbers [ee_info, ee_data]. The arithmetic is modulo 2^32, like the
+      // kernel's counter.
+      *num_completed += static_cast<uint32_t>(serr->ee_data - serr->ee_info) + 1;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        *copied = true;
+      }
+    }
+  }
+#else
+  return Status::NotSupported("zero-copy send is only supported on Linux");
+#endif // defined(__linux__)
+}
+
 // Mostly follows writen() from Stevens (2004) or Kerrisk (2010).
 Status Socket::BlockingWrite(const uint8_t *buf, size_t buflen, size_t *nwritten,
     const MonoTime& deadline) {
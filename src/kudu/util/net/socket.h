@@ -67,12 +67,24 @@ class Socket {
 
   Status Init(int flags); // See FLAG_NONBLOCKING
 
-  // Set or clear TCP_NODELAY
+  // Like Init(), but opens a socket of the given address family, e.g. AF_UNIX.
+  Status Init(int family, int flags);
+
+  // Set or clear TCP_NODELAY. A no-op on a UNIX domain socket.
   Status SetNoDelay(bool enabled);
 
-  // Set or clear TCP_CORK
+  // Set or clear TCP_CORK. A no-op on a UNIX domain socket.
   Status SetTcpCork(bool enabled);
 
+  // Set SO_ZEROCOPY, allowing WritevZeroCopy() to be used on this socket.
+  // Returns NotSupported if the platform or the socket type can't send
+  // without copying (e.g. before Linux 4.14, or for TLS sockets).
+  virtual Status EnableZeroCopySend();
+
+  // Set SO_LINGER with a zero timeout, so that closing the socket resets
+  // the connection and discards any unsent data instead of flushing it.
+  Status SetResetOnClose();
+
   // Set or clear O_NONBLOCK
   Status SetNonBlocking(bool enabled);
   Status IsNonBlocking(bool* is_nonblock) const;
@@ -134,6 +146,22 @@ class Socket {
   // bytes must be retried. See writev(2) for more information.
   virtual Status Writev(const struct ::iovec *iov, int iov_len, int64_t *nwritten);
 
+  // Like Writev(), but passes MSG_ZEROCOPY so that the kernel sends straight
+  // from the caller's buffers. Every call that returns OK and writes at least
+  // one byte counts as one zero-copy send; the buffers it covered must stay
+  // valid and unmodified until ReadZeroCopyCompletions() reports the send
+  // as completed.
+  //
+  // REQUIRES: EnableZeroCopySend() succeeded.
+  Status WritevZeroCopy(const struct ::iovec *iov, int iov_len, int64_t *nwritten);
+
+  // Drains zero-copy completion notifications from the socket's error queue.
+  // Adds the number of zero-copy sends the kernel is done with to
+  // 'num_completed'. Sets 'copied' if the kernel fell back to copying the
+  // data for any of them, in which case zero-copy is just overhead on this
+  // socket. Completions of a TCP socket are reported in send order.
+  Status ReadZeroCopyCompletions(uint64_t* num_completed, bool* copied);
+
   // Blocking Write call, returns IOError unless full buffer is sent.
   // Underlying Socket expected to be in blocking mode. Fails if any Write() sends 0 bytes.
   // Returns OK if buflen bytes were sent, otherwise IOError.
@@ -152,6 +180,9 @@ class Socket {
   Status BlockingRecv(uint8_t *buf, size_t amt, size_t *nread, const MonoTime& deadline);
 
  private:
+  // Calls sendmsg(2) for the given iovec, with MSG_NOSIGNAL and 'flags'.
+  Status SendMsg(const struct ::iovec *iov, int iov_len, int flags, int64_t *nwritten);
+
   // Called internally from SetSend/RecvTimeout().
   Status SetTimeout(int opt, std::string optname, const MonoDelta& timeout);
 
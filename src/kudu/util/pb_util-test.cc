@@ -455,6 +455,51 @@ TEST_P(TestPBContainerVersions, TestMultipleMessages) {
   ASSERT_OK(pb_reader.Close());
 }
 
+// Test that a batch of messages is readable as individual records, and that
+// it interleaves correctly with single appends.
+TEST_P(TestPBContainerVersions, TestAppendBatch) {
+  ProtoContainerTestPB pb;
+  pb.set_name("foo");
+
+  unique_ptr<WritablePBContainerFile> pb_writer;
+  ASSERT_OK(NewPBCWriter(version_, RWFileOptions(), &pb_writer));
+  ASSERT_OK(pb_writer->CreateNew(pb));
+
+  pb.set_value(0);
+  ASSERT_OK(pb_writer->Append(pb));
+  const int kBatchSize = 5;
+  vector<ProtoContainerTestPB> batch(kBatchSize, pb);
+  vector<const google::protobuf::Message*> batch_ptrs;
+  for (int i = 0; i < kBatchSize; i++) {
+    batch[i].set_value(i + 1);
+    batch_ptrs.push_back(&batch[i]);
+  }
+  ASSERT_OK(pb_writer->AppendBatch(batch_ptrs));
+  ASSERT_OK(pb_writer->AppendBatch({}));
+  pb.set_value(kBatchSize + 1);
+  ASSERT_OK(pb_writer->Append(pb));
+  ASSERT_OK(pb_writer->Close());
+
+  unique_ptr<RandomAccessFile> reader;
+  ASSERT_OK(env_->NewRandomAccessFile(path_, &reader));
+  ReadablePBContainerFile pb_reader(std::move(reader));
+  ASSERT_OK(pb_reader.Open());
+  int pbs_read = 0;
+  for (int i = 0;; i++) {
+    ProtoContainerTestPB read_pb;
+    Status s = pb_reader.ReadNextPB(&read_pb);
+    if (s.IsEndOfFile()) {
+      break;
+    }
+    ASSERT_OK(s);
+    ASSERT_EQ(pb.name(), read_pb.name());
+    ASSERT_EQ(i, read_pb.value());
+    pbs_read++;
+  }
+  ASSERT_EQ(kBatchSize + 2, pbs_read);
+  ASSERT_OK(pb_reader.Close());
+}
+
 TEST_P(TestPBContainerVersions, TestInterleavedReadWrite) {
   ProtoContainerTestPB pb;
   pb.set_name("foo");
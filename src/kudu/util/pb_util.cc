@@ -487,7 +487,7 @@ Status WritePBToPath(Env* env, const std::string& path,
     return Status::IOError("Unable to serialize PB to file");
   }
 
-  if (sync == pb_util::SYNC) {
+  if (sync != pb_util::NO_SYNC) {
     RETURN_NOT_OK_PREPEND(file->Sync(), "Failed to Sync() " + tmp_path);
   }
   RETURN_NOT_OK_PREPEND(file->Close(), "Failed to Close() " + tmp_path);
@@ -702,6 +702,22 @@ Status WritablePBContainerFile::Append(const Message& msg) {
   return Status::OK();
 }
 
+Status WritablePBContainerFile::AppendBatch(const vector<const Message*>& msgs) {
+  DCHECK_EQ(FileState::OPEN, state_);
+  if (msgs.empty()) {
+    return Status::OK();
+  }
+
+  faststring buf;
+  for (const Message* msg : msgs) {
+    RETURN_NOT_OK_PREPEND(AppendMsgToBuffer(*msg, &buf),
+                          "Failed to prepare buffer for writing");
+  }
+  RETURN_NOT_OK_PREPEND(AppendBytes(buf), "Failed to append data to file");
+
+  return Status::OK();
+}
+
 Status WritablePBContainerFile::Flush() {
   DCHECK_EQ(FileState::OPEN, state_);
 
@@ -988,7 +1004,7 @@ Status WritePBContainerToPath(Env* env, const std::string& path,
   WritablePBContainerFile pb_file(std::move(file));
   RETURN_NOT_OK(pb_file.CreateNew(msg));
   RETURN_NOT_OK(pb_file.Append(msg));
-  if (sync == pb_util::SYNC) {
+  if (sync != pb_util::NO_SYNC) {
     RETURN_NOT_OK(pb_file.Sync());
   }
   RETURN_NOT_OK(pb_file.Close());
@@ -25,6 +25,7 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <google/protobuf/message.h>
@@ -58,7 +59,10 @@ namespace pb_util {
 
 enum SyncMode {
   SYNC,
-  NO_SYNC
+  NO_SYNC,
+  // Like SYNC, but the parent directory of the file isn't fsynced. The caller
+  // must sync it before relying on the new file being durable.
+  SYNC_FILE_ONLY
 };
 
 enum CreateMode {
@@ -302,6 +306,10 @@ class WritablePBContainerFile {
   // must be called prior to calling Append(), i.e. the file must be open.
   Status Append(const google::protobuf::Message& msg);
 
+  // Like Append(), but writes all of 'msgs' to the container with a single
+  // write to the underlying file. The messages are written in order.
+  Status AppendBatch(const std::vector<const google::protobuf::Message*>& msgs);
+
   // Asynchronously flushes all dirty container data to the filesystem.
   // The file must be open.
   Status Flush();
@@ -468,6 +476,7 @@ Status ReadPBContainerFromPath(Env* env, const std::string& path,
 //
 // If create == NO_OVERWRITE and 'path' already exists, the function will fail.
 // If sync == SYNC, the newly created file will be fsynced before returning.
+// If sync == SYNC_FILE_ONLY, it is fsynced but its parent directory isn't.
 Status WritePBContainerToPath(Env* env, const std::string& path,
                               const google::protobuf::Message& msg,
                               CreateMode create,
@@ -21,11 +21,17 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
+#include "kudu/util/test_util.h"
+
+#ifdef TCMALLOC_ENABLED
+DECLARE_int32(tcmalloc_max_free_bytes_percentage);
+#endif
 
 using std::atomic;
 using std::thread;
@@ -72,4 +78,28 @@ TEST(ProcessMemory, BenchmarkConsumptionTracking) {
   LOG(INFO) << "Performed " << total_count / secs << " iters/sec";
 }
 
+#ifdef TCMALLOC_ENABLED
+// Test that the background thread releases free memory after a large
+// allocation is freed.
+TEST(ProcessMemory, TestBackgroundRelease) {
+  FLAGS_tcmalloc_max_free_bytes_percentage = 0;
+  process_memory::StartBackgroundMemoryRelease();
+  int64_t released_before = process_memory::BackgroundReleasedBytes();
+
+  const int kNumChunks = 64;
+  vector<char*> chunks;
+  for (int i = 0; i < kNumChunks; i++) {
+    chunks.push_back(new char[1024 * 1024]);
+  }
+  for (char* c : chunks) {
+    delete[] c;
+  }
+
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_GT(process_memory::BackgroundReleasedBytes(), released_before);
+  });
+  ASSERT_GT(process_memory::BackgroundReleaseCount(), 0);
+}
+#endif
+
 } // namespace kudu
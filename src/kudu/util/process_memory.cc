@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <cstddef>
 #include <ostream>
 #include <string>
@@ -29,6 +30,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/once.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"          // IWYU pragma: keep
@@ -37,9 +39,11 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"        // IWYU pragma: keep
+#include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
+#include "kudu/util/thread.h"
 
 DEFINE_int64(memory_limit_hard_bytes, 0,
              "Maximum amount of memory this daemon should use, in bytes. "
@@ -70,6 +74,28 @@ DEFINE_int32(tcmalloc_max_free_bytes_percentage, 10,
              "Maximum percentage of the RSS that tcmalloc is allowed to use for "
              "reserved but unallocated memory.");
 TAG_FLAG(tcmalloc_max_free_bytes_percentage, advanced);
+
+DEFINE_int32(tcmalloc_release_interval_ms, 100,
+             "Interval at which a background thread releases reserved but "
+             "unallocated tcmalloc memory in excess of "
+             "--tcmalloc_max_free_bytes_percentage back to the OS, a little at "
+             "a time. If 0, the excess is instead released all at once by "
+             "whichever thread happens to free a large amount of memory.");
+TAG_FLAG(tcmalloc_release_interval_ms, advanced);
+
+DEFINE_int64(tcmalloc_release_min_bytes_per_sec, 16 * 1024 * 1024,
+             "Rate at which the background thread releases excess tcmalloc "
+             "memory while the process is below its memory pressure threshold.");
+TAG_FLAG(tcmalloc_release_min_bytes_per_sec, advanced);
+TAG_FLAG(tcmalloc_release_min_bytes_per_sec, runtime);
+
+DEFINE_int64(tcmalloc_release_max_bytes_per_sec, 512 * 1024 * 1024,
+             "Rate at which the background thread releases excess tcmalloc "
+             "memory once the process reaches its hard memory limit. Between "
+             "the memory pressure threshold and the hard limit, the rate rises "
+             "linearly from --tcmalloc_release_min_bytes_per_sec to this value.");
+TAG_FLAG(tcmalloc_release_max_bytes_per_sec, advanced);
+TAG_FLAG(tcmalloc_release_max_bytes_per_sec, runtime);
 #endif
 
 using strings::Substitute;
@@ -96,6 +122,19 @@ Atomic64 g_released_memory_since_gc;
 // TODO(todd): this is a stopgap.
 const int64_t kGcReleaseSize = 128 * 1024L * 1024L;
 
+// Amount of memory released to the OS per call into tcmalloc. Small enough that
+// tcmalloc's page heap lock is only held briefly.
+const int64_t kReleaseChunkSize = 1024 * 1024;
+
+// Set once the background release thread is running, at which point freeing
+// memory no longer triggers a synchronous GC.
+Atomic32 g_background_release_running = 0;
+
+// Total number of bytes released to the OS by the background thread, and the
+// number of times it released any.
+Atomic64 g_background_released_bytes = 0;
+Atomic64 g_background_release_count = 0;
+
 #endif // TCMALLOC_ENABLED
 
 } // anonymous namespace
@@ -137,25 +176,32 @@ int64_t GetTCMallocCurrentAllocatedBytes() {
   return GetTCMallocProperty("generic.current_allocated_bytes");
 }
 
-void GcTcmalloc() {
-  TRACE_EVENT0("process", "GcTcmalloc");
-
+// Returns the number of bytes reserved but unallocated by tcmalloc in excess
+// of --tcmalloc_max_free_bytes_percentage, or 0 if there is no excess.
+//
+// Also sets 'bytes_used' to the number of bytes allocated by the application.
+static int64_t ExcessFreeBytes(int64_t* bytes_used) {
   // Number of bytes in the 'NORMAL' free list (i.e reserved by tcmalloc but
   // not in use).
   int64_t bytes_overhead = GetTCMallocProperty("tcmalloc.pageheap_free_bytes");
   // Bytes allocated by the application.
-  int64_t bytes_used = GetTCMallocCurrentAllocatedBytes();
-
-  int64_t max_overhead = bytes_used * FLAGS_tcmalloc_max_free_bytes_percentage / 100.0;
-  if (bytes_overhead > max_overhead) {
-    int64_t extra = bytes_overhead - max_overhead;
-    while (extra > 0) {
-      // Release 1MB at a time, so that tcmalloc releases its page heap lock
-      // allowing other threads to make progress. This still disrupts the current
-      // thread, but is better than disrupting all.
-      MallocExtension::instance()->ReleaseToSystem(1024 * 1024);
-      extra -= 1024 * 1024;
-    }
+  *bytes_used = GetTCMallocCurrentAllocatedBytes();
+
+  int64_t max_overhead = *bytes_used * FLAGS_tcmalloc_max_free_bytes_percentage / 100.0;
+  return std::max<int64_t>(bytes_overhead - max_overhead, 0);
+}
+
+void GcTcmalloc() {
+  TRACE_EVENT0("process", "GcTcmalloc");
+
+  int64_t bytes_used;
+  int64_t extra = ExcessFreeBytes(&bytes_used);
+  while (extra > 0) {
+    // Release 1MB at a time, so that tcmalloc releases its page heap lock
+    // allowing other threads to make progress. This still disrupts the current
+    // thread, but is better than disrupting all.
+    MallocExtension::instance()->ReleaseToSystem(kReleaseChunkSize);
+    extra -= kReleaseChunkSize;
   }
 }
 #endif // TCMALLOC_ENABLED
@@ -228,6 +274,11 @@ int64_t HardLimit() {
   return g_hard_limit;
 }
 
+int64_t PressureThreshold() {
+  InitLimits();
+  return g_pressure_threshold;
+}
+
 bool UnderMemoryPressure(double* current_capacity_pct) {
   InitLimits();
   int64_t consumption = CurrentConsumption();
@@ -273,6 +324,10 @@ bool SoftLimitExceeded(double* current_capacity_pct) {
 
 void MaybeGCAfterRelease(int64_t released_bytes) {
 #ifdef TCMALLOC_ENABLED
+  // The background thread, if running, takes care of releasing the memory.
+  if (base::subtle::NoBarrier_Load(&g_background_release_running)) {
+    return;
+  }
   int64_t now_released = base::subtle::NoBarrier_AtomicIncrement(
       &g_released_memory_since_gc, -released_bytes);
   if (PREDICT_FALSE(now_released > kGcReleaseSize)) {
@@ -282,5 +337,87 @@ void MaybeGCAfterRelease(int64_t released_bytes) {
 #endif
 }
 
+#ifdef TCMALLOC_ENABLED
+namespace {
+
+// Releases up to 'elapsed' worth of excess free memory back to the OS, at a
+// rate which depends on how close the process is to its hard memory limit.
+void ReleaseExcessFreeMemory(MonoDelta elapsed) {
+  int64_t bytes_used;
+  int64_t extra = ExcessFreeBytes(&bytes_used);
+  if (extra == 0) {
+    return;
+  }
+
+  double rate = FLAGS_tcmalloc_release_min_bytes_per_sec;
+  if (g_hard_limit > g_pressure_threshold && bytes_used > g_pressure_threshold) {
+    double pressure = std::min(
+        1.0, static_cast<double>(bytes_used - g_pressure_threshold) /
+             (g_hard_limit - g_pressure_threshold));
+    rate += (FLAGS_tcmalloc_release_max_bytes_per_sec -
+             FLAGS_tcmalloc_release_min_bytes_per_sec) * pressure;
+  }
+  int64_t to_release = std::min<int64_t>(extra, rate * elapsed.ToSeconds());
+
+  TRACE_EVENT1("process", "ReleaseExcessFreeMemory", "bytes", to_release);
+  int64_t released = 0;
+  while (released < to_release) {
+    MallocExtension::instance()->ReleaseToSystem(kReleaseChunkSize);
+    released += kReleaseChunkSize;
+  }
+  base::subtle::NoBarrier_AtomicIncrement(&g_background_released_bytes, released);
+  base::subtle::NoBarrier_AtomicIncrement(&g_background_release_count, 1);
+}
+
+void BackgroundReleaseThread() {
+  MonoTime last = MonoTime::Now();
+  while (true) {
+    SleepFor(MonoDelta::FromMilliseconds(FLAGS_tcmalloc_release_interval_ms));
+    MonoTime now = MonoTime::Now();
+    ReleaseExcessFreeMemory(now - last);
+    last = now;
+  }
+}
+
+void DoStartBackgroundRelease() {
+  if (FLAGS_tcmalloc_release_interval_ms <= 0) {
+    return;
+  }
+  InitLimits();
+  scoped_refptr<Thread> thread;
+  Status s = Thread::Create("server", "tcmalloc-release", &BackgroundReleaseThread, &thread);
+  if (!s.ok()) {
+    LOG(WARNING) << "Unable to start tcmalloc memory release thread: " << s.ToString();
+    return;
+  }
+  base::subtle::NoBarrier_Store(&g_background_release_running, 1);
+}
+
+} // anonymous namespace
+#endif // TCMALLOC_ENABLED
+
+void StartBackgroundMemoryRelease() {
+#ifdef TCMALLOC_ENABLED
+  static GoogleOnceType once;
+  GoogleOnceInit(&once, &DoStartBackgroundRelease);
+#endif
+}
+
+int64_t BackgroundReleasedBytes() {
+#ifdef TCMALLOC_ENABLED
+  return base::subtle::NoBarrier_Load(&g_background_released_bytes);
+#else
+  return 0;
+#endif
+}
+
+int64_t BackgroundReleaseCount() {
+#ifdef TCMALLOC_ENABLED
+  return base::subtle::NoBarrier_Load(&g_background_release_count);
+#else
+  return 0;
+#endif
+}
+
 } // namespace process_memory
 } // namespace kudu
@@ -36,14 +36,33 @@ bool UnderMemoryPressure(double* current_capacity_pct);
 
 // Potentially trigger a call to release tcmalloc memory back to the
 // OS, after the given amount of memory was released.
+//
+// Does nothing once StartBackgroundMemoryRelease() has started its thread.
 void MaybeGCAfterRelease(int64_t released_bytes);
 
+// Start a process-wide background thread which releases excess free tcmalloc
+// memory back to the OS in small increments, at a rate which rises with
+// memory pressure (see --tcmalloc_release_interval_ms). This avoids stalling
+// whichever thread frees a large amount of memory with one big release.
+//
+// Does nothing if the thread is already running, if the interval is 0, or if
+// tcmalloc is not in use.
+void StartBackgroundMemoryRelease();
+
+// Return the total number of bytes the background thread has released to the
+// OS, and the number of times it has released memory.
+int64_t BackgroundReleasedBytes();
+int64_t BackgroundReleaseCount();
+
 // Return the total current memory consumption of the process.
 int64_t CurrentConsumption();
 
 // Return the configured hard limit for the process.
 int64_t HardLimit();
 
+// Return the consumption at which the process is under memory pressure.
+int64_t PressureThreshold();
+
 #ifdef TCMALLOC_ENABLED
 // Get the current amount of allocated memory, according to tcmalloc.
 //
@@ -0,0 +1,147 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/roaring_bitmap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::set;
+using std::vector;
+
+namespace kudu {
+
+class RoaringBitmapTest : public KuduTest {
+ protected:
+  RoaringBitmapTest() : rng_(SeedRandom()) {}
+
+  // Returns a random set of values below 'max_value'. Some ranges of 64K
+  // values are dense, so that both kinds of containers are exercised.
+  set<uint32_t> RandomSet(uint32_t max_value) {
+    set<uint32_t> values;
+    for (uint32_t base = 0; base < max_value; base += 1 << 16) {
+      int density = rng_.Uniform(4);
+      int num_values = density == 0 ? 0 : density == 1 ? 10 : density == 2 ? 3000 : 30000;
+      for (int i = 0; i < num_values; i++) {
+        values.insert(std::min(max_value - 1, base + rng_.Uniform(1 << 16)));
+      }
+    }
+    return values;
+  }
+
+  static RoaringBitmap ToBitmap(const set<uint32_t>& values) {
+    RoaringBitmap bitmap;
+    for (uint32_t v : values) {
+      bitmap.AddSorted(v);
+    }
+    return bitmap;
+  }
+
+  static void AssertEqual(const set<uint32_t>& expected, const RoaringBitmap& bitmap,
+                          uint32_t max_value) {
+    ASSERT_EQ(expected.size(), bitmap.cardinality());
+    ASSERT_EQ(expected.empty(), bitmap.empty());
+    for (uint32_t v = 0; v < max_value; v++) {
+      ASSERT_EQ(expected.count(v) == 1, bitmap.Contains(v)) << v;
+    }
+  }
+
+  Random rng_;
+};
+
+TEST_F(RoaringBitmapTest, TestSetOperations) {
+  const uint32_t kMaxValue = 8 << 16;
+  for (int trial = 0; trial < 5; trial++) {
+    set<uint32_t> a = RandomSet(kMaxValue);
+    set<uint32_t> b = RandomSet(kMaxValue);
+    NO_FATALS(AssertEqual(a, ToBitmap(a), kMaxValue));
+
+    set<uint32_t> intersection;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::inserter(intersection, intersection.end()));
+    RoaringBitmap bitmap = ToBitmap(a);
+    bitmap.IntersectWith(ToBitmap(b));
+    NO_FATALS(AssertEqual(intersection, bitmap, kMaxValue));
+
+    set<uint32_t> union_set;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                   std::inserter(union_set, union_set.end()));
+    bitmap = ToBitmap(a);
+    bitmap.UnionWith(ToBitmap(b));
+    NO_FATALS(AssertEqual(union_set, bitmap, kMaxValue));
+  }
+}
+
+TEST_F(RoaringBitmapTest, TestSerialization) {
+  const uint32_t kMaxValue = 8 << 16;
+  set<uint32_t> values = RandomSet(kMaxValue);
+  RoaringBitmap bitmap = ToBitmap(values);
+
+  faststring buf;
+  bitmap.Serialize(&buf);
+  buf.append("trailer");
+  Slice src(buf);
+  RoaringBitmap decoded;
+  ASSERT_OK(decoded.Deserialize(&src));
+  ASSERT_EQ("trailer", src.ToString());
+  NO_FATALS(AssertEqual(values, decoded, kMaxValue));
+
+  // Truncated input is detected.
+  if (!values.empty()) {
+    Slice truncated(buf.data(), (buf.size() - strlen("trailer")) / 2);
+    Status s = decoded.Deserialize(&truncated);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+}
+
+TEST_F(RoaringBitmapTest, TestIntersectDenseBitmap) {
+  const uint32_t kMaxValue = 4 << 16;
+  set<uint32_t> values = RandomSet(kMaxValue);
+  RoaringBitmap bitmap = ToBitmap(values);
+
+  // Windows of various sizes and alignments, some spanning containers.
+  for (int trial = 0; trial < 100; trial++) {
+    uint32_t start = rng_.Uniform(kMaxValue);
+    size_t num_bits = 1 + rng_.Uniform(std::min<uint32_t>(kMaxValue - start, 5000));
+    vector<uint8_t> dense(BitmapSize(num_bits));
+    // Start with every other bit set.
+    for (size_t i = 0; i < num_bits; i++) {
+      BitmapChange(dense.data(), i, i % 2 == 0);
+    }
+    bitmap.IntersectDenseBitmap(start, num_bits, dense.data());
+    for (size_t i = 0; i < num_bits; i++) {
+      ASSERT_EQ(i % 2 == 0 && values.count(start + i) == 1, BitmapTest(dense.data(), i))
+          << "start " << start << " bit " << i;
+    }
+  }
+}
+
+} // namespace kudu
@@ -0,0 +1,347 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/roaring_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// Containers with more values than this are stored as bitmaps.
+const uint32_t kMaxArrayCardinality = 4096;
+
+// The number of 64-bit words of a bitmap container.
+const size_t kNumWords = 1024;
+
+const size_t kBitmapContainerBytes = kNumWords * sizeof(uint64_t);
+
+inline uint32_t CountBits(const vector<uint64_t>& words) {
+  uint32_t count = 0;
+  for (uint64_t w : words) {
+    count += Bits::CountOnes64withPopcount(w);
+  }
+  return count;
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// Container
+////////////////////////////////////////////////////////////
+
+bool RoaringBitmap::Container::Contains(uint16_t low) const {
+  if (is_bitmap()) {
+    return (words[low >> 6] >> (low & 63)) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::ToBitmap() {
+  if (is_bitmap()) {
+    return;
+  }
+  words.assign(kNumWords, 0);
+  for (uint16_t low : array) {
+    words[low >> 6] |= 1ULL << (low & 63);
+  }
+  array.clear();
+  array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::ToArrayIfSparse() {
+  if (!is_bitmap() || cardinality > kMaxArrayCardinality) {
+    return;
+  }
+  array.clear();
+  array.reserve(cardinality);
+  for (size_t i = 0; i < kNumWords; i++) {
+    uint64_t w = words[i];
+    while (w != 0) {
+      array.push_back(i * 64 + Bits::FindLSBSetNonZero64(w));
+      w &= w - 1;
+    }
+  }
+  words.clear();
+  words.shrink_to_fit();
+}
+
+void RoaringBitmap::IntersectContainers(const Container& a, Container* b) {
+  if (a.is_bitmap() && b->is_bitmap()) {
+    for (size_t i = 0; i < kNumWords; i++) {
+      b->words[i] &= a.words[i];
+    }
+    b->cardinality = CountBits(b->words);
+    b->ToArrayIfSparse();
+    return;
+  }
+
+  vector<uint16_t> result;
+  if (!a.is_bitmap() && !b->is_bitmap()) {
+    std::set_intersection(a.array.begin(), a.array.end(),
+                          b->array.begin(), b->array.end(),
+                          std::back_inserter(result));
+  } else {
+    // Filter the array container through the bitmap container.
+    const Container& bitmap = a.is_bitmap() ? a : *b;
+    const vector<uint16_t>& array = a.is_bitmap() ? b->array : a.array;
+    for (uint16_t low : array) {
+      if (bitmap.Contains(low)) {
+        result.push_back(low);
+      }
+    }
+    b->words.clear();
+    b->words.shrink_to_fit();
+  }
+  b->array.swap(result);
+  b->cardinality = b->array.size();
+}
+
+void RoaringBitmap::UnionContainers(const Container& a, Container* b) {
+  if (!a.is_bitmap() && !b->is_bitmap()) {
+    vector<uint16_t> result;
+    std::set_union(a.array.begin(), a.array.end(),
+                   b->array.begin(), b->array.end(),
+                   std::back_inserter(result));
+    b->array.swap(result);
+    b->cardinality = b->array.size();
+    if (b->cardinality > kMaxArrayCardinality) {
+      b->ToBitmap();
+    }
+    return;
+  }
+
+  b->ToBitmap();
+  if (a.is_bitmap()) {
+    for (size_t i = 0; i < kNumWords; i++) {
+      b->words[i] |= a.words[i];
+    }
+  } else {
+    for (uint16_t low : a.array) {
+      b->words[low >> 6] |= 1ULL << (low & 63);
+    }
+  }
+  b->cardinality = CountBits(b->words);
+}
+
+////////////////////////////////////////////////////////////
+// RoaringBitmap
+////////////////////////////////////////////////////////////
+
+void RoaringBitmap::AddSorted(uint32_t value) {
+  const uint16_t key = value >> 16;
+  const uint16_t low = value & 0xffff;
+  if (containers_.empty() || containers_.back().key != key) {
+    DCHECK(containers_.empty() || containers_.back().key < key);
+    containers_.emplace_back();
+    containers_.back().key = key;
+    containers_.back().cardinality = 0;
+  }
+  Container* c = &containers_.back();
+  if (c->is_bitmap()) {
+    DCHECK(!c->Contains(low));
+    c->words[low >> 6] |= 1ULL << (low & 63);
+  } else {
+    DCHECK(c->array.empty() || c->array.back() < low);
+    c->array.push_back(low);
+  }
+  c->cardinality++;
+  if (c->cardinality > kMaxArrayCardinality) {
+    c->ToBitmap();
+  }
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+  const uint16_t key = value >> 16;
+  auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                             [](const Container& c, uint16_t k) { return c.key < k; });
+  return it != containers_.end() && it->key == key && it->Contains(value & 0xffff);
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+  uint64_t count = 0;
+  for (const auto& c : containers_) {
+    count += c.cardinality;
+  }
+  return count;
+}
+
+void RoaringBitmap::IntersectWith(const RoaringBitmap& other) {
+  vector<Container> result;
+  auto mine = containers_.begin();
+  auto theirs = other.containers_.begin();
+  while (mine != containers_.end() && theirs != other.containers_.end()) {
+    if (mine->key < theirs->key) {
+      ++mine;
+    } else if (theirs->key < mine->key) {
+      ++theirs;
+    } else {
+      IntersectContainers(*theirs, &*mine);
+      if (mine->cardinality > 0) {
+        result.emplace_back(std::move(*mine));
+      }
+      ++mine;
+      ++theirs;
+    }
+  }
+  containers_.swap(result);
+}
+
+void RoaringBitmap::UnionWith(const RoaringBitmap& other) {
+  vector<Container> result;
+  result.reserve(containers_.size() + other.containers_.size());
+  auto mine = containers_.begin();
+  auto theirs = other.containers_.begin();
+  while (mine != containers_.end() || theirs != other.containers_.end()) {
+    if (theirs == other.containers_.end() ||
+        (mine != containers_.end() && mine->key < theirs->key)) {
+      result.emplace_back(std::move(*mine++));
+    } else if (mine == containers_.end() || theirs->key < mine->key) {
+      result.push_back(*theirs++);
+    } else {
+      UnionContainers(*theirs++, &*mine);
+      result.emplace_back(std::move(*mine++));
+    }
+  }
+  containers_.swap(result);
+}
+
+void RoaringBitmap::IntersectDenseBitmap(uint32_t start, size_t num_bits,
+                                         uint8_t* bitmap) const {
+  const uint64_t end = static_cast<uint64_t>(start) + num_bits;
+  // The offset of the first bit which hasn't been kept or cleared yet.
+  size_t next = 0;
+  auto keep = [&](uint64_t value) {
+    size_t offset = value - start;
+    if (offset > next) {
+      BitmapChangeBits(bitmap, next, offset - next, false);
+    }
+    next = offset + 1;
+  };
+
+  auto it = std::lower_bound(containers_.begin(), containers_.end(), start >> 16,
+                             [](const Container& c, uint32_t k) { return c.key < k; });
+  for (; it != containers_.end() && (static_cast<uint64_t>(it->key) << 16) < end; ++it) {
+    const uint64_t base = static_cast<uint64_t>(it->key) << 16;
+    const uint64_t lo = std::max<uint64_t>(start, base) - base;
+    const uint64_t hi = std::min<uint64_t>(end - base, 1 << 16);
+    if (it->is_bitmap()) {
+      for (size_t i = lo >> 6; i < kNumWords && i * 64 < hi; i++) {
+        uint64_t w = it->words[i];
+        while (w != 0) {
+          uint64_t low = i * 64 + Bits::FindLSBSetNonZero64(w);
+          w &= w - 1;
+          if (low < lo) continue;
+          if (low >= hi) break;
+          keep(base + low);
+        }
+      }
+    } else {
+      for (auto low = std::lower_bound(it->array.begin(), it->array.end(), lo);
+           low != it->array.end() && *low < hi; ++low) {
+        keep(base + *low);
+      }
+    }
+  }
+  if (next < num_bits) {
+    BitmapChangeBits(bitmap, next, num_bits - next, false);
+  }
+}
+
+void RoaringBitmap::Serialize(faststring* dst) const {
+  PutVarint32(dst, containers_.size());
+  for (const auto& c : containers_) {
+    PutVarint32(dst, c.key);
+    PutVarint32(dst, c.cardinality);
+    if (c.is_bitmap()) {
+      for (uint64_t w : c.words) {
+        PutFixed64(dst, w);
+      }
+    } else {
+      // Arrays are stored as varint deltas, which are mostly single bytes
+      // for the containers dense enough to matter.
+      uint32_t prev = 0;
+      for (uint16_t low : c.array) {
+        PutVarint32(dst, low - prev);
+        prev = low;
+      }
+    }
+  }
+}
+
+Status RoaringBitmap::Deserialize(Slice* src) {
+  containers_.clear();
+  uint32_t num_containers;
+  if (!GetVarint32(src, &num_containers) || num_containers > (1 << 16)) {
+    return Status::Corruption("invalid roaring bitmap header");
+  }
+  containers_.resize(num_containers);
+  for (uint32_t i = 0; i < num_containers; i++) {
+    Container* c = &containers_[i];
+    uint32_t key;
+    uint32_t cardinality;
+    if (!GetVarint32(src, &key) || key > 0xffff ||
+        (i > 0 && key <= containers_[i - 1].key) ||
+        !GetVarint32(src, &cardinality) || cardinality == 0 || cardinality > (1 << 16)) {
+      return Status::Corruption(Substitute("invalid roaring bitmap container $0", i));
+    }
+    c->key = key;
+    c->cardinality = cardinality;
+    if (cardinality > kMaxArrayCardinality) {
+      if (src->size() < kBitmapContainerBytes) {
+        return Status::Corruption("truncated roaring bitmap container");
+      }
+      c->words.resize(kNumWords);
+      for (size_t w = 0; w < kNumWords; w++) {
+        c->words[w] = DecodeFixed64(src->data() + w * sizeof(uint64_t));
+      }
+      src->remove_prefix(kBitmapContainerBytes);
+      if (CountBits(c->words) != cardinality) {
+        return Status::Corruption("roaring bitmap container cardinality mismatch");
+      }
+    } else {
+      c->array.reserve(cardinality);
+      uint32_t value = 0;
+      for (uint32_t j = 0; j < cardinality; j++) {
+        uint32_t delta;
+        if (!GetVarint32(src, &delta) || (j > 0 && delta == 0) || delta > 0xffff - value) {
+          return Status::Corruption("invalid roaring bitmap array container");
+        }
+        value += delta;
+        c->array.push_back(value);
+      }
+    }
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_ROARING_BITMAP_H
+#define KUDU_UTIL_ROARING_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class faststring;
+class Slice;
+
+// A compressed set of 32-bit integers, laid out like a roaring bitmap.
+//
+// The values are partitioned by their upper 16 bits into containers. A
+// container holding at most 4096 values stores them as a sorted array of
+// their lower 16 bits, and a denser container stores a 65536-bit bitmap, so
+// that a container never takes more than 8KB. Intersections and unions are
+// computed container by container.
+//
+// See "Better bitmap performance with Roaring bitmaps", Chambi et al., 2016.
+class RoaringBitmap {
+ public:
+  RoaringBitmap() {}
+
+  // Adds 'value', which must be greater than any value added before.
+  void AddSorted(uint32_t value);
+
+  bool Contains(uint32_t value) const;
+
+  // Returns the number of values in the bitmap.
+  uint64_t cardinality() const;
+
+  bool empty() const { return containers_.empty(); }
+
+  // Sets this bitmap to its intersection with 'other'.
+  void IntersectWith(const RoaringBitmap& other);
+
+  // Sets this bitmap to its union with 'other'.
+  void UnionWith(const RoaringBitmap& other);
+
+  // Clears the bits of the dense 'bitmap' (see util/bitmap.h) for which the
+  // corresponding value is not in this set: bit i of 'bitmap' corresponds to
+  // the value 'start + i', for i in [0, num_bits).
+  void IntersectDenseBitmap(uint32_t start, size_t num_bits, uint8_t* bitmap) const;
+
+  // Appends the serialized bitmap to 'dst'.
+  void Serialize(faststring* dst) const;
+
+  // Replaces the contents of this bitmap with the one serialized at the
+  // front of 'src', advancing 'src' past it.
+  Status Deserialize(Slice* src);
+
+ private:
+  struct Container {
+    // The upper 16 bits of the values in the container.
+    uint16_t key;
+    // The number of values in the container.
+    uint32_t cardinality;
+    // The lower 16 bits of the values, if the container is sparse.
+    std::vector<uint16_t> array;
+    // The bitmap of the lower 16 bits of the values, if the container is
+    // dense, or empty otherwise.
+    std::vector<uint64_t> words;
+
+    bool is_bitmap() const { return !words.empty(); }
+    bool Contains(uint16_t low) const;
+
+    // Switches the representation of the container to match its cardinality.
+    void ToBitmap();
+    void ToArrayIfSparse();
+  };
+
+  static void IntersectContainers(const Container& a, Container* b);
+  static void UnionContainers(const Container& a, Container* b);
+
+  // Sorted by key, with no empty containers.
+  std::vector<Container> containers_;
+};
+
+} // namespace kudu
+#endif
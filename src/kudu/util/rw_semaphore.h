@@ -24,11 +24,13 @@
 #include <glog/logging.h>
 
 #include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/cycleclock-inl.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #ifdef RW_SEMAPHORE_TRACK_HOLDER
 #include "kudu/util/debug-util.h"
 #endif
+#include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/thread.h"
 
 namespace kudu {
@@ -60,6 +62,9 @@ namespace kudu {
 // uncomment the definition of RW_SEMAPHORE_TRACK_HOLDER at the top of this
 // file. Then, in gdb, print the contents of the semaphore, and you should see
 // the collected stack trace.
+//
+// Acquisitions which have to spin are timed and reported through
+// SubmitLockContention(), so they show up in contention profiles.
 class rw_semaphore {
  public:
   rw_semaphore() : state_(0) {
@@ -68,6 +73,7 @@ class rw_semaphore {
 
   void lock_shared() {
     int loop_count = 0;
+    int64_t wait_start = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect no write lock
@@ -76,8 +82,10 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      StartWaiting(&wait_start);
       boost::detail::yield(loop_count++);
     }
+    FinishWaiting(wait_start);
   }
 
   void unlock_shared() {
@@ -122,6 +130,7 @@ class rw_semaphore {
 
   void lock() {
     int loop_count = 0;
+    int64_t wait_start = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect some 0+ readers
@@ -132,10 +141,12 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      StartWaiting(&wait_start);
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    WaitPendingReaders(&wait_start);
+    FinishWaiting(wait_start);
 
 #ifndef NDEBUG
     writer_tid_ = Thread::CurrentThreadId();
@@ -188,13 +199,33 @@ class rw_semaphore {
   }
 #endif
 
-  void WaitPendingReaders() {
+  // Waits for the readers holding the lock to release it. If any do, and
+  // 'wait_start' is non-NULL, starts the wait timer in it.
+  void WaitPendingReaders(int64_t* wait_start = nullptr) {
     int loop_count = 0;
     while ((base::subtle::Acquire_Load(&state_) & kNumReadersMask) > 0) {
+      if (wait_start) {
+        StartWaiting(wait_start);
+      }
       boost::detail::yield(loop_count++);
     }
   }
 
+  // Starts timing a contended acquisition, unless already started.
+  static void StartWaiting(int64_t* wait_start) {
+    if (*wait_start == 0) {
+      *wait_start = CycleClock::Now();
+    }
+  }
+
+  // Reports the time since 'wait_start' as lock contention, if the
+  // acquisition had to wait at all.
+  void FinishWaiting(int64_t wait_start) {
+    if (PREDICT_FALSE(wait_start != 0)) {
+      SubmitLockContention(this, CycleClock::Now() - wait_start);
+    }
+  }
+
  private:
   volatile Atomic32 state_;
 #ifndef NDEBUG
@@ -19,6 +19,10 @@
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/cycleclock-inl.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/spinlock_profiling.h"
+
 #ifndef NDEBUG
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/debug-util.h"
@@ -87,8 +91,12 @@ bool RWCLock::HasWriteLockUnlocked() const {
 void RWCLock::WriteLock() {
   MutexLock l(lock_);
   // Wait for any other mutations to finish.
-  while (write_locked_) {
-    no_mutators_.Wait();
+  if (PREDICT_FALSE(write_locked_)) {
+    int64_t start_cycles = CycleClock::Now();
+    while (write_locked_) {
+      no_mutators_.Wait();
+    }
+    SubmitLockContention(this, CycleClock::Now() - start_cycles);
   }
 #ifndef NDEBUG
   last_writelock_acquire_time_ = GetCurrentTimeMicros();
@@ -112,8 +120,12 @@ void RWCLock::WriteUnlock() {
 void RWCLock::UpgradeToCommitLock() {
   lock_.lock();
   DCHECK(HasWriteLockUnlocked());
-  while (reader_count_ > 0) {
-    no_readers_.Wait();
+  if (reader_count_ > 0) {
+    int64_t start_cycles = CycleClock::Now();
+    while (reader_count_ > 0) {
+      no_readers_.Wait();
+    }
+    SubmitLockContention(this, CycleClock::Now() - start_cycles);
   }
   DCHECK(HasWriteLockUnlocked());
 
@@ -18,6 +18,8 @@
 #include <cstdint>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <glog/logging.h>
@@ -25,6 +27,8 @@
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/spinlock.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -78,4 +82,31 @@ TEST_F(SpinLockProfilingTest, TestStackCollection) {
   ASSERT_EQ(0, dropped);
 }
 
+// Test that contention on Kudu's own lock types is profiled and counted.
+TEST_F(SpinLockProfilingTest, TestMutexContention) {
+  uint64_t micros_before = GetLockContentionMicros();
+  StartSynchronizationProfiling();
+  Mutex m;
+  m.Acquire();
+  std::thread waiter([&]() {
+    m.Acquire();
+    m.Release();
+  });
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  m.Release();
+  waiter.join();
+  StopSynchronizationProfiling();
+
+  std::vector<ContentionSample> samples;
+  int64_t dropped = 0;
+  FlushSynchronizationProfile(&samples, &dropped);
+  ASSERT_EQ(0, dropped);
+  // Other threads in the process may have hit contention too, so just look
+  // for at least one sample.
+  ASSERT_FALSE(samples.empty());
+  ASSERT_GT(samples[0].count, 0);
+  ASSERT_GT(samples[0].cycles, 0);
+  ASSERT_GT(GetLockContentionMicros(), micros_before);
+}
+
 } // namespace kudu
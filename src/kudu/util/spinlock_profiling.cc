@@ -19,6 +19,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gflags/gflags.h>
@@ -53,6 +54,12 @@ METRIC_DEFINE_gauge_uint64(server, spinlock_contention_time,
     "internals triggered by a particular workload and warrant investigation.",
     kudu::EXPOSE_AS_COUNTER);
 
+METRIC_DEFINE_gauge_uint64(server, lock_contention_time,
+    "Lock Contention Time", kudu::MetricUnit::kMicroseconds,
+    "Amount of time threads spent waiting to acquire contended internal mutexes "
+    "and reader-writer locks since the server started. The acquiring stacks can "
+    "be listed with the /lock-contention web page.",
+    kudu::EXPOSE_AS_COUNTER);
 
 using base::SpinLock;
 using base::SpinLockHolder;
@@ -62,6 +69,7 @@ namespace kudu {
 static const double kMicrosPerSecond = 1000000.0;
 
 static LongAdder* g_contended_cycles = nullptr;
+static LongAdder* g_lock_contended_cycles = nullptr;
 
 namespace {
 
@@ -91,6 +99,9 @@ class ContentionStacks {
   // the call have been flushed. However, new stacks can be added concurrently with this call.
   void Flush(std::ostringstream* out, int64_t* dropped);
 
+  // Like the above, but appends the stacks to 'samples'.
+  void Flush(std::vector<ContentionSample>* samples, int64_t* dropped);
+
  private:
 
   // Collect the next sample from the underlying buffer, and set it back to 0 count
@@ -191,6 +202,16 @@ void ContentionStacks::Flush(std::ostringstream* out, int64_t* dropped) {
   *dropped += dropped_samples_.Exchange(0);
 }
 
+void ContentionStacks::Flush(std::vector<ContentionSample>* samples, int64_t* dropped) {
+  uint64_t iterator = 0;
+  ContentionSample sample;
+  while (CollectSample(&iterator, &sample.stack, &sample.count, &sample.cycles)) {
+    samples->push_back(sample);
+  }
+
+  *dropped += dropped_samples_.Exchange(0);
+}
+
 bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t* trip_count,
                                      int64_t* cycles) {
   while (*iterator < kNumEntries) {
@@ -212,8 +233,11 @@ bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t*
 }
 
 
-void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
-  TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+// Records contention of 'wait_cycles' on 'contendedlock' in the profile and
+// the current trace. If 'contended_cycles' is non-NULL, also adds the wait to
+// the counter it points to.
+void RecordContention(const void* contendedlock, int64_t wait_cycles,
+                      LongAdder** contended_cycles) {
   bool profiling_enabled = base::subtle::Acquire_Load(&g_profiling_enabled);
   bool long_wait_time = wait_cycles > FLAGS_lock_contention_trace_threshold_cycles;
   // Short circuit this function quickly in the common case.
@@ -244,20 +268,29 @@ void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
     }
   }
 
-  LongAdder* la = reinterpret_cast<LongAdder*>(
-      base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&g_contended_cycles)));
-  if (la) {
-    la->IncrementBy(wait_cycles);
+  if (contended_cycles) {
+    LongAdder* la = reinterpret_cast<LongAdder*>(
+        base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(contended_cycles)));
+    if (la) {
+      la->IncrementBy(wait_cycles);
+    }
   }
 
   in_func = false;
 }
 
+void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
+  TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+  RecordContention(contendedlock, wait_cycles, &g_contended_cycles);
+}
+
 void DoInit() {
   base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&g_contention_stacks),
                               reinterpret_cast<uintptr_t>(new ContentionStacks()));
   base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&g_contended_cycles),
                               reinterpret_cast<uintptr_t>(new LongAdder()));
+  base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&g_lock_contended_cycles),
+                              reinterpret_cast<uintptr_t>(new LongAdder()));
 }
 
 } // anonymous namespace
@@ -273,6 +306,20 @@ void RegisterSpinLockContentionMetrics(const scoped_refptr<MetricEntity>& entity
   entity->NeverRetire(
       METRIC_spinlock_contention_time.InstantiateFunctionGauge(
           entity, Bind(&GetSpinLockContentionMicros)));
+  entity->NeverRetire(
+      METRIC_lock_contention_time.InstantiateFunctionGauge(
+          entity, Bind(&GetLockContentionMicros)));
+}
+
+void SubmitLockContention(const void* lock, int64_t wait_cycles) {
+  // Every contended acquisition counts towards the metric, not only those
+  // which end up profiled or traced.
+  LongAdder* la = reinterpret_cast<LongAdder*>(
+      base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&g_lock_contended_cycles)));
+  if (la) {
+    la->IncrementBy(wait_cycles);
+  }
+  RecordContention(lock, wait_cycles, nullptr);
 }
 
 uint64_t GetSpinLockContentionMicros() {
@@ -282,6 +329,13 @@ uint64_t GetSpinLockContentionMicros() {
   return implicit_cast<int64_t>(micros);
 }
 
+uint64_t GetLockContentionMicros() {
+  int64_t wait_cycles = DCHECK_NOTNULL(g_lock_contended_cycles)->Value();
+  double micros = static_cast<double>(wait_cycles) / base::CyclesPerSecond()
+    * kMicrosPerSecond;
+  return implicit_cast<int64_t>(micros);
+}
+
 void StartSynchronizationProfiling() {
   InitSpinLockContentionProfiling();
   base::subtle::Barrier_AtomicIncrement(&g_profiling_enabled, 1);
@@ -292,6 +346,11 @@ void FlushSynchronizationProfile(std::ostringstream* out,
   CHECK_NOTNULL(g_contention_stacks)->Flush(out, drop_count);
 }
 
+void FlushSynchronizationProfile(std::vector<ContentionSample>* samples,
+                                 int64_t* drop_count) {
+  CHECK_NOTNULL(g_contention_stacks)->Flush(samples, drop_count);
+}
+
 void StopSynchronizationProfiling() {
   InitSpinLockContentionProfiling();
   CHECK_GE(base::subtle::Barrier_AtomicIncrement(&g_profiling_enabled, -1), 0);
@@ -19,8 +19,10 @@
 
 #include <cstdint>
 #include <iosfwd>
+#include <vector>
 
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/debug-util.h"
 
 namespace kudu {
 
@@ -38,10 +40,32 @@ void InitSpinLockContentionProfiling();
 // since the server started.
 uint64_t GetSpinLockContentionMicros();
 
+// Return the total number of microseconds spent waiting to acquire Kudu's own
+// lock types (see SubmitLockContention()) since the server started.
+uint64_t GetLockContentionMicros();
+
 // Register metrics in the given server entity which measure the amount of
-// spinlock contention.
+// spinlock and lock contention.
 void RegisterSpinLockContentionMetrics(const scoped_refptr<MetricEntity>& entity);
 
+// Record that acquiring 'lock' took 'wait_cycles' cycles of waiting.
+//
+// This is called by Kudu's own lock types (Mutex, rw_semaphore and so
+// rw_spinlock and percpu_rwlock, RWCLock) when an acquisition is contended.
+// The wait is handled like gutil spinlock contention: it is attributed to the
+// acquiring stack in the synchronization profile, logged to the current Trace
+// if it exceeds --lock_contention_trace_threshold_cycles, and counted in the
+// lock contention metric.
+void SubmitLockContention(const void* lock, int64_t wait_cycles);
+
+// A stack trace which waited on a contended lock, along with the total number
+// of cycles it waited and the number of contended acquisitions.
+struct ContentionSample {
+  StackTrace stack;
+  int64_t cycles;
+  int64_t count;
+};
+
 // Enable process-wide synchronization profiling.
 //
 // While profiling is enabled, spinlock contention will be recorded in a buffer.
@@ -65,6 +89,11 @@ void StartSynchronizationProfiling();
 // returned samples.
 void FlushSynchronizationProfile(std::ostringstream* out, int64_t* drop_count);
 
+// Like the above, but appends the samples to 'samples' rather than formatting
+// them. The same stack may appear in more than one sample.
+void FlushSynchronizationProfile(std::vector<ContentionSample>* samples,
+                                 int64_t* drop_count);
+
 // Stop collecting contention profiles.
 void StopSynchronizationProfiling();
 
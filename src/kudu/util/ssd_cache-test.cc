@@ -0,0 +1,183 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/ssd_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+
+class SsdCacheTest : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    path_ = GetTestPath("ssd_cache");
+    opts_.capacity_bytes = 4 * 64 * 1024;
+    opts_.region_size_bytes = 64 * 1024;
+    opts_.admit_all = true;
+    ASSERT_OK(Reopen());
+  }
+
+ protected:
+  Status Reopen() {
+    cache_.reset();
+    RETURN_NOT_OK(SsdCache::Open(env_, path_, opts_, &cache_));
+    cache_->WaitForPendingWrites();
+    return Status::OK();
+  }
+
+  static string Value(int i) {
+    return Substitute("value-$0-$1", i, string(1000, 'x'));
+  }
+
+  void PutAndWait(const string& key, const string& value) {
+    cache_->Put(key, value);
+    cache_->WaitForPendingWrites();
+  }
+
+  Status Get(const string& key, string* value) {
+    return cache_->Lookup(key, [&](size_t size) {
+        value->resize(size);
+        return reinterpret_cast<uint8_t*>(&(*value)[0]);
+      });
+  }
+
+  string path_;
+  SsdCache::Options opts_;
+  unique_ptr<SsdCache> cache_;
+};
+
+TEST_F(SsdCacheTest, TestPutAndLookup) {
+  string value;
+  ASSERT_TRUE(Get("a", &value).IsNotFound());
+  PutAndWait("a", Value(1));
+  PutAndWait("b", Value(2));
+  ASSERT_OK(Get("a", &value));
+  ASSERT_EQ(Value(1), value);
+  ASSERT_OK(Get("b", &value));
+  ASSERT_EQ(Value(2), value);
+  ASSERT_EQ(2, cache_->num_entries());
+
+  // A failed allocation is a miss.
+  ASSERT_TRUE(cache_->Lookup("a", [](size_t /* size */) -> uint8_t* {
+        return nullptr;
+      }).IsNotFound());
+
+  // Values larger than a region aren't cached.
+  PutAndWait("big", string(opts_.region_size_bytes, 'y'));
+  ASSERT_TRUE(Get("big", &value).IsNotFound());
+}
+
+TEST_F(SsdCacheTest, TestAdmission) {
+  opts_.admit_all = false;
+  ASSERT_OK(Reopen());
+  string value;
+  PutAndWait("a", Value(1));
+  ASSERT_TRUE(Get("a", &value).IsNotFound());
+  // The second time a key is offered, it's admitted.
+  PutAndWait("a", Value(1));
+  ASSERT_OK(Get("a", &value));
+  ASSERT_EQ(Value(1), value);
+}
+
+TEST_F(SsdCacheTest, TestRegionsAreEvictedInOrder) {
+  // Write more than the capacity: the entries of the oldest regions are
+  // evicted, the most recent ones are kept.
+  const int kNumValues = 4 * opts_.capacity_bytes / Value(0).size();
+  for (int i = 0; i < kNumValues; i++) {
+    cache_->Put(Substitute("key-$0", i), Value(i));
+  }
+  cache_->WaitForPendingWrites();
+  string value;
+  ASSERT_TRUE(Get("key-0", &value).IsNotFound());
+  ASSERT_OK(Get(Substitute("key-$0", kNumValues - 1), &value));
+  ASSERT_EQ(Value(kNumValues - 1), value);
+  ASSERT_GT(cache_->num_entries(), 0);
+  ASSERT_LT(cache_->num_entries(), opts_.capacity_bytes / Value(0).size());
+}
+
+TEST_F(SsdCacheTest, TestContentSurvivesReopen) {
+  const int kNumValues = 2 * opts_.capacity_bytes / Value(0).size();
+  for (int i = 0; i < kNumValues; i++) {
+    cache_->Put(Substitute("key-$0", i), Value(i));
+  }
+  cache_->WaitForPendingWrites();
+  size_t num_entries = cache_->num_entries();
+  ASSERT_OK(Reopen());
+  ASSERT_EQ(num_entries, cache_->num_entries());
+  string value;
+  ASSERT_OK(Get(Substitute("key-$0", kNumValues - 1), &value));
+  ASSERT_EQ(Value(kNumValues - 1), value);
+
+  // New values are appended after the recovered ones.
+  PutAndWait("new", Value(-1));
+  ASSERT_OK(Reopen());
+  ASSERT_OK(Get("new", &value));
+  ASSERT_EQ(Value(-1), value);
+  ASSERT_OK(Get(Substitute("key-$0", kNumValues - 1), &value));
+
+  // Changing the capacity discards the content.
+  opts_.capacity_bytes *= 2;
+  ASSERT_OK(Reopen());
+  ASSERT_EQ(0, cache_->num_entries());
+}
+
+TEST_F(SsdCacheTest, TestCorruptRecordIsAMiss) {
+  PutAndWait("a", Value(1));
+  cache_.reset();
+
+  // Flip a byte of the value, which follows the region header, the record
+  // header and the key.
+  unique_ptr<RWFile> file;
+  RWFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING;
+  ASSERT_OK(env_->NewRWFile(opts, path_, &file));
+  uint8_t byte;
+  const uint64_t kValueOffset = 16 + 20 + 1 + 100;
+  ASSERT_OK(file->Read(kValueOffset, Slice(&byte, 1)));
+  byte ^= 0xff;
+  ASSERT_OK(file->Write(kValueOffset, Slice(&byte, 1)));
+  ASSERT_OK(file->Close());
+
+  ASSERT_OK(Reopen());
+  ASSERT_EQ(1, cache_->num_entries());
+  string value;
+  ASSERT_TRUE(Get("a", &value).IsNotFound());
+  ASSERT_EQ(0, cache_->num_entries());
+}
+
+TEST_F(SsdCacheTest, TestInvalidCapacity) {
+  opts_.capacity_bytes = opts_.region_size_bytes;
+  ASSERT_TRUE(Reopen().IsInvalidArgument());
+}
+
+} // namespace kudu
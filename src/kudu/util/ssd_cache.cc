@@ -0,0 +1,379 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/ssd_cache.h"
+
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/cache_metrics.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// Each region starts with a header:
+//   magic (32 bits)
+//   reserved (32 bits)
+//   sequence number (64 bits)
+//
+// The sequence number increases every time the writer starts a region, so
+// the most recent region has the highest one.
+const uint32_t kRegionMagic = 0x4b535344;
+const size_t kRegionHeaderSize = 16;
+
+// The header is followed by records, one per value:
+//   magic (32 bits)
+//   low 32 bits of the region's sequence number
+//   key length (32 bits)
+//   value length (32 bits)
+//   CRC32C of the key and the value (32 bits)
+//   key
+//   value
+//
+// Records left over from the region's previous use carry a different
+// sequence number, which ends the region when it's scanned.
+const uint32_t kRecordMagic = 0x4b524543;
+const size_t kRecordHeaderSize = 20;
+
+// The number of key hashes remembered by the admission filter.
+const size_t kAdmissionWindowSize = 1 << 16;
+
+uint32_t RecordChecksum(const Slice& key, const Slice& value) {
+  return crc::Crc32c(value.data(), value.size(),
+                     crc::Crc32c(key.data(), key.size()));
+}
+
+} // anonymous namespace
+
+SsdCache::Options::Options()
+    : capacity_bytes(0),
+      region_size_bytes(16 * 1024 * 1024),
+      max_pending_bytes(64 * 1024 * 1024),
+      admit_all(false) {
+}
+
+Status SsdCache::Open(Env* env, const string& path, const Options& options,
+                      unique_ptr<SsdCache>* cache) {
+  if (options.region_size_bytes <= kRegionHeaderSize + kRecordHeaderSize ||
+      options.capacity_bytes < 2 * options.region_size_bytes) {
+    return Status::InvalidArgument(
+        Substitute("SSD cache capacity of $0 bytes must hold at least two regions of $1 bytes",
+                   options.capacity_bytes, options.region_size_bytes));
+  }
+  int num_regions = options.capacity_bytes / options.region_size_bytes;
+  uint64_t file_size = static_cast<uint64_t>(num_regions) * options.region_size_bytes;
+
+  RWFileOptions opts;
+  bool exists = env->FileExists(path);
+  opts.mode = exists ? Env::OPEN_EXISTING : Env::CREATE_NON_EXISTING;
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK_PREPEND(env->NewRWFile(opts, path, &file),
+                        Substitute("could not open SSD cache file $0", path));
+  uint64_t size = 0;
+  if (exists) {
+    RETURN_NOT_OK(file->Size(&size));
+    if (size != file_size) {
+      // The capacity changed: the regions don't line up with the old ones,
+      // so start over.
+      LOG(INFO) << "SSD cache " << path << " has size " << size << ", expected "
+                << file_size << ": discarding its content";
+      RETURN_NOT_OK(file->Truncate(0));
+      size = 0;
+    }
+  }
+  if (size != file_size) {
+    RETURN_NOT_OK(file->Truncate(file_size));
+  }
+
+  unique_ptr<SsdCache> c(new SsdCache(path, options, std::move(file)));
+  RETURN_NOT_OK(ThreadPoolBuilder("ssd-cache")
+                .set_min_threads(0)
+                .set_max_threads(1)
+                .Build(&c->writer_pool_));
+  SsdCache* raw = c.get();
+  RETURN_NOT_OK(c->writer_pool_->SubmitFunc([raw]() { raw->Recover(); }));
+  *cache = std::move(c);
+  return Status::OK();
+}
+
+SsdCache::SsdCache(string path, const Options& options, unique_ptr<RWFile> file)
+    : path_(std::move(path)),
+      options_(options),
+      num_regions_(options.capacity_bytes / options.region_size_bytes),
+      file_(std::move(file)),
+      cur_region_(-1),
+      cur_offset_(0),
+      cur_seqno_(0),
+      region_keys_(num_regions_),
+      pending_bytes_(0),
+      admission_window_(kAdmissionWindowSize, 0) {
+}
+
+SsdCache::~SsdCache() {
+  // Values which are still waiting to be written are dropped.
+  if (writer_pool_) {
+    writer_pool_->Shutdown();
+  }
+}
+
+void SsdCache::SetMetrics(const scoped_refptr<MetricEntity>& metric_entity) {
+  metrics_.reset(new SsdCacheMetrics(metric_entity));
+}
+
+size_t SsdCache::num_entries() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return index_.size();
+}
+
+void SsdCache::WaitForPendingWrites() {
+  writer_pool_->Wait();
+}
+
+void SsdCache::Recover() {
+  // Find the regions in use, in the order they were written.
+  vector<std::pair<uint64_t, int>> regions;
+  uint64_t max_seqno = 0;
+  uint8_t header[kRegionHeaderSize];
+  for (int r = 0; r < num_regions_; r++) {
+    Status s = file_->Read(region_offset(r), Slice(header, sizeof(header)));
+    if (!s.ok()) {
+      LOG(WARNING) << "Could not read region " << r << " of SSD cache " << path_
+                   << ": " << s.ToString();
+      continue;
+    }
+    if (DecodeFixed32(header) != kRegionMagic) {
+      continue;
+    }
+    uint64_t seqno = DecodeFixed64(header + 8);
+    regions.emplace_back(seqno, r);
+    max_seqno = std::max(max_seqno, seqno);
+  }
+  std::sort(regions.begin(), regions.end());
+
+  uint64_t end_offset = 0;
+  for (const auto& region : regions) {
+    end_offset = RecoverRegion(region.second, region.first);
+  }
+  if (!regions.empty()) {
+    // Keep appending to the most recent region.
+    cur_region_ = regions.back().second;
+    cur_offset_ = end_offset;
+  }
+  cur_seqno_ = max_seqno;
+  LOG(INFO) << "Recovered " << num_entries() << " entries from SSD cache " << path_;
+}
+
+uint64_t SsdCache::RecoverRegion(int region, uint64_t seqno) {
+  uint64_t offset = kRegionHeaderSize;
+  uint8_t header[kRecordHeaderSize];
+  string key;
+  while (offset + kRecordHeaderSize <= options_.region_size_bytes) {
+    uint64_t file_offset = region_offset(region) + offset;
+    if (!file_->Read(file_offset, Slice(header, sizeof(header))).ok() ||
+        DecodeFixed32(header) != kRecordMagic ||
+        DecodeFixed32(header + 4) != static_cast<uint32_t>(seqno)) {
+      break;
+    }
+    uint32_t key_len = DecodeFixed32(header + 8);
+    uint32_t value_len = DecodeFixed32(header + 12);
+    uint64_t record_size = kRecordHeaderSize + key_len + value_len;
+    if (key_len == 0 || offset + record_size > options_.region_size_bytes) {
+      break;
+    }
+    key.resize(key_len);
+    if (!file_->Read(file_offset + kRecordHeaderSize,
+                     Slice(reinterpret_cast<uint8_t*>(&key[0]), key_len)).ok()) {
+      break;
+    }
+    // The value is only verified when it's looked up.
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      index_[key] = { region, file_offset, value_len };
+      region_keys_[region].push_back(key);
+    }
+    offset += record_size;
+  }
+  return offset;
+}
+
+bool SsdCache::Admit(const Slice& key) {
+  if (options_.admit_all) {
+    return true;
+  }
+  uint64_t hash = HashUtil::MurmurHash2_64(key.data(), key.size(), 0);
+  uint64_t* slot = &admission_window_[hash % kAdmissionWindowSize];
+  if (*slot == hash) {
+    *slot = 0;
+    return true;
+  }
+  *slot = hash;
+  return false;
+}
+
+void SsdCache::Put(const Slice& key, const Slice& value) {
+  if (key.empty() ||
+      kRegionHeaderSize + kRecordHeaderSize + key.size() + value.size() >
+      options_.region_size_bytes) {
+    if (metrics_) metrics_->rejections->Increment();
+    return;
+  }
+  string key_str = key.ToString();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (ContainsKey(index_, key_str) || ContainsKey(pending_keys_, key_str)) {
+      return;
+    }
+    if (!Admit(key) || pending_bytes_ + value.size() > options_.max_pending_bytes) {
+      if (metrics_) metrics_->rejections->Increment();
+      return;
+    }
+    pending_keys_.insert(key_str);
+    pending_bytes_ += value.size();
+  }
+  string value_str = value.ToString();
+  Status s = writer_pool_->SubmitFunc([this, key_str, value_str]() {
+      this->WriteRecord(key_str, value_str);
+    });
+  if (!s.ok()) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_keys_.erase(key_str);
+    pending_bytes_ -= value.size();
+  }
+}
+
+Status SsdCache::StartNextRegion() {
+  int next = (cur_region_ + 1) % num_regions_;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (const string& key : region_keys_[next]) {
+      auto it = index_.find(key);
+      if (it != index_.end() && it->second.region == next) {
+        index_.erase(it);
+      }
+    }
+    region_keys_[next].clear();
+  }
+  cur_seqno_++;
+  uint8_t header[kRegionHeaderSize];
+  InlineEncodeFixed32(header, kRegionMagic);
+  InlineEncodeFixed32(header + 4, 0);
+  InlineEncodeFixed64(header + 8, cur_seqno_);
+  RETURN_NOT_OK(file_->Write(region_offset(next), Slice(header, sizeof(header))));
+  cur_region_ = next;
+  cur_offset_ = kRegionHeaderSize;
+  return Status::OK();
+}
+
+void SsdCache::WriteRecord(const string& key, const string& value) {
+  uint64_t record_size = kRecordHeaderSize + key.size() + value.size();
+  Status s;
+  if (cur_region_ < 0 || cur_offset_ + record_size > options_.region_size_bytes) {
+    s = StartNextRegion();
+  }
+  uint64_t file_offset = 0;
+  if (s.ok()) {
+    file_offset = region_offset(cur_region_) + cur_offset_;
+    uint8_t header[kRecordHeaderSize];
+    InlineEncodeFixed32(header, kRecordMagic);
+    InlineEncodeFixed32(header + 4, static_cast<uint32_t>(cur_seqno_));
+    InlineEncodeFixed32(header + 8, key.size());
+    InlineEncodeFixed32(header + 12, value.size());
+    InlineEncodeFixed32(header + 16, RecordChecksum(key, value));
+    const Slice data[] = { Slice(header, sizeof(header)), key, value };
+    s = file_->WriteV(file_offset, data);
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  pending_keys_.erase(key);
+  pending_bytes_ -= value.size();
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not write to SSD cache " << path_ << ": " << s.ToString();
+    return;
+  }
+  cur_offset_ += record_size;
+  index_[key] = { cur_region_, file_offset, static_cast<uint32_t>(value.size()) };
+  region_keys_[cur_region_].push_back(key);
+  if (metrics_) {
+    metrics_->inserts->Increment();
+    metrics_->inserted_bytes->IncrementBy(value.size());
+  }
+}
+
+Status SsdCache::Lookup(const Slice& key, const std::function<uint8_t*(size_t)>& allocate) {
+  string key_str = key.ToString();
+  Entry entry;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    const Entry* e = FindOrNull(index_, key_str);
+    if (!e) {
+      if (metrics_) metrics_->misses->Increment();
+      return Status::NotFound("key not in SSD cache");
+    }
+    entry = *e;
+  }
+  uint8_t* buf = allocate(entry.value_len);
+  if (!buf) {
+    return Status::NotFound("could not allocate space for the value");
+  }
+
+  // The record may have been overwritten since it was looked up in the
+  // index, so the key and the checksum are verified.
+  string header(kRecordHeaderSize + key.size(), '\0');
+  Slice results[] = { Slice(reinterpret_cast<uint8_t*>(&header[0]), header.size()),
+                      Slice(buf, entry.value_len) };
+  Status s = file_->ReadV(entry.offset, results);
+  const uint8_t* h = results[0].data();
+  if (!s.ok() ||
+      DecodeFixed32(h) != kRecordMagic ||
+      DecodeFixed32(h + 8) != key.size() ||
+      DecodeFixed32(h + 12) != entry.value_len ||
+      Slice(h + kRecordHeaderSize, key.size()) != key ||
+      DecodeFixed32(h + 16) != RecordChecksum(key, results[1])) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = index_.find(key_str);
+    if (it != index_.end() && it->second.offset == entry.offset) {
+      index_.erase(it);
+    }
+    if (metrics_) metrics_->misses->Increment();
+    return s.ok() ? Status::NotFound("stale or corrupt SSD cache record") : s;
+  }
+  if (metrics_) metrics_->hits->Increment();
+  return Status::OK();
+}
+
+} // namespace kudu
@@ -0,0 +1,179 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_SSD_CACHE_H
+#define KUDU_UTIL_SSD_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+template <class T> class scoped_refptr;
+
+namespace kudu {
+
+class Env;
+class MetricEntity;
+class RWFile;
+class ThreadPool;
+struct SsdCacheMetrics;
+
+// A second tier for an in-memory cache, which keeps key/value pairs in a
+// file on a local SSD. Values evicted from memory are offered with Put() and
+// written to the file in the background; a lookup which misses in memory may
+// then find the value with Lookup() and promote it back.
+//
+// The file is split into fixed-size regions which are filled one after the
+// other as a ring: moving the writer to the next region evicts all of its
+// entries at once. Every record is self-describing and checksummed, so the
+// in-memory index is rebuilt by scanning the file when it's reopened, and the
+// cached values survive restarts. Records which fail the checksum are treated
+// as misses.
+//
+// So that values read only once (e.g. by a large scan) don't wash out the
+// others, a value is only admitted the second time it's offered within a
+// window of recently offered keys.
+//
+// This class is thread-safe.
+class SsdCache {
+ public:
+  struct Options {
+    Options();
+
+    // The size of the cache file, in bytes.
+    int64_t capacity_bytes;
+
+    // The size of the unit of eviction, in bytes. The capacity must hold at
+    // least two regions, and no value larger than a region is cached.
+    int64_t region_size_bytes;
+
+    // The maximum number of bytes of values waiting to be written. Values
+    // offered while the writer is this far behind are dropped.
+    int64_t max_pending_bytes;
+
+    // If true, every offered value is admitted.
+    bool admit_all;
+  };
+
+  // Opens the cache file at 'path', creating it if it doesn't exist. The
+  // entries of an existing file are recovered in the background; lookups
+  // may miss until the recovery is done.
+  static Status Open(Env* env, const std::string& path, const Options& options,
+                     std::unique_ptr<SsdCache>* cache);
+
+  ~SsdCache();
+
+  // Offers 'value' for caching under 'key'. If it's admitted, the value is
+  // copied and written to the file in the background.
+  void Put(const Slice& key, const Slice& value);
+
+  // Looks up 'key' in the cache. On a hit, calls 'allocate' with the size of
+  // the value and reads the value into the returned buffer.
+  //
+  // Returns NotFound if the key isn't cached, or if 'allocate' returns null.
+  Status Lookup(const Slice& key, const std::function<uint8_t*(size_t)>& allocate);
+
+  // Waits until the recovery and all the writes submitted so far are done.
+  void WaitForPendingWrites();
+
+  // Starts recording metrics in 'metric_entity'.
+  void SetMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  // Returns the number of entries in the cache.
+  size_t num_entries() const;
+
+ private:
+  // The location of a cached value.
+  struct Entry {
+    // The region holding the record.
+    int region;
+    // The offset of the record in the file.
+    uint64_t offset;
+    uint32_t value_len;
+  };
+
+  SsdCache(std::string path, const Options& options, std::unique_ptr<RWFile> file);
+
+  // Rebuilds the index from the records in the file, and positions the
+  // writer after the last record of the most recent region.
+  void Recover();
+
+  // Scans the records of region 'region', written with sequence number
+  // 'seqno', adding them to the index. Returns the offset in the region
+  // past the last valid record.
+  uint64_t RecoverRegion(int region, uint64_t seqno);
+
+  // Writes the record for 'key' and 'value' at the writer's position.
+  void WriteRecord(const std::string& key, const std::string& value);
+
+  // Moves the writer to the next region, evicting the region's entries.
+  Status StartNextRegion();
+
+  // Returns true if 'key' should be admitted. Must be called with 'lock_' held.
+  bool Admit(const Slice& key);
+
+  uint64_t region_offset(int region) const {
+    return static_cast<uint64_t>(region) * options_.region_size_bytes;
+  }
+
+  const std::string path_;
+  const Options options_;
+  const int num_regions_;
+  std::unique_ptr<RWFile> file_;
+
+  // Runs the recovery, then all the writes, in order.
+  gscoped_ptr<ThreadPool> writer_pool_;
+
+  // The state of the writer, only accessed by the writer thread.
+  int cur_region_;
+  uint64_t cur_offset_;
+  uint64_t cur_seqno_;
+
+  // Protects the fields below.
+  mutable simple_spinlock lock_;
+
+  std::unordered_map<std::string, Entry> index_;
+
+  // The keys written to each region, in order to evict them with it. A key
+  // may also be listed by an older region which it was rewritten after.
+  std::vector<std::vector<std::string>> region_keys_;
+
+  // The keys whose values are waiting to be written, and their total size.
+  std::unordered_set<std::string> pending_keys_;
+  int64_t pending_bytes_;
+
+  // Hashes of recently offered keys which weren't admitted.
+  std::vector<uint64_t> admission_window_;
+
+  std::unique_ptr<SsdCacheMetrics> metrics_;
+
+  DISALLOW_COPY_AND_ASSIGN(SsdCache);
+};
+
+} // namespace kudu
+
+#endif
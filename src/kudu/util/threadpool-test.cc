@@ -17,6 +17,7 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <iterator>
@@ -52,6 +53,7 @@
 #include "kudu/util/random.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/threadpool.h"
@@ -938,4 +940,113 @@ TEST_F(ThreadPoolTest, TestLIFOThreadWakeUps) {
   NO_PENDING_FATALS();
 }
 
+TEST_F(ThreadPoolTest, TestWorkStealingTasks) {
+  const int kNumThreads = 4;
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(kNumThreads)
+                                   .set_work_stealing(true)));
+  ASSERT_EQ(kNumThreads, pool_->num_threads());
+
+  // Tasks submitted from outside the pool, some of which submit more tasks
+  // from within the pool.
+  const int kNumTasks = 1000;
+  atomic<int> counter(0);
+  ThreadPool* pool = pool_.get();
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_OK(pool_->SubmitFunc([&counter, pool, i]() {
+      counter++;
+      if (i % 10 == 0) {
+        CHECK_OK(pool->SubmitFunc([&counter]() { counter++; }));
+      }
+    }));
+  }
+  pool_->Wait();
+  ASSERT_EQ(kNumTasks + kNumTasks / 10, counter.load());
+
+  // Tokens keep working as usual, including serial execution.
+  unique_ptr<ThreadPoolToken> t = pool_->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  string result;
+  for (char c = 'a'; c < 'f'; c++) {
+    ASSERT_OK(t->SubmitFunc([&result, c]() {
+      SleepFor(MonoDelta::FromMilliseconds(1));
+      result += c;
+    }));
+    ASSERT_OK(pool_->SubmitFunc([&counter]() { counter++; }));
+  }
+  t->Wait();
+  pool_->Wait();
+  ASSERT_EQ("abcde", result);
+  ASSERT_EQ(kNumTasks + kNumTasks / 10 + 5, counter.load());
+}
+
+TEST_F(ThreadPoolTest, TestWorkStealingShutdown) {
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(1)
+                                   .set_work_stealing(true)));
+  // Queue some tasks behind a slow one; they're dropped by the shutdown.
+  atomic<int> counter(0);
+  ASSERT_OK(pool_->SubmitFunc([]() { SleepFor(MonoDelta::FromMilliseconds(500)); }));
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(pool_->SubmitFunc([&counter]() { counter++; }));
+  }
+  pool_->Shutdown();
+  ASSERT_EQ(0, counter.load());
+  Status s = pool_->SubmitFunc([&counter]() { counter++; });
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+}
+
+TEST_F(ThreadPoolTest, TestWorkStealingMaxQueueSize) {
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(1)
+                                   .set_max_queue_size(1)
+                                   .set_work_stealing(true)));
+  CountDownLatch latch(1);
+  SCOPED_CLEANUP({
+    latch.CountDown();
+  });
+  // One task may run and one may be queued.
+  ASSERT_OK(pool_->Submit(SlowTask::NewSlowTask(&latch)));
+  ASSERT_OK(pool_->Submit(SlowTask::NewSlowTask(&latch)));
+  Status s = pool_->Submit(SlowTask::NewSlowTask(&latch));
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  latch.CountDown();
+  pool_->Wait();
+  ASSERT_OK(pool_->Submit(SlowTask::NewSlowTask(&latch)));
+}
+
+// Measures how long it takes to dispatch many tiny tasks submitted from
+// several threads, with and without work stealing.
+class ThreadPoolDispatchBenchmark : public ThreadPoolTest,
+                                    public testing::WithParamInterface<bool> {};
+
+INSTANTIATE_TEST_CASE_P(WorkStealing, ThreadPoolDispatchBenchmark, ::testing::Bool());
+
+TEST_P(ThreadPoolDispatchBenchmark, TestTinyTasks) {
+  const bool work_stealing = GetParam();
+  const int kNumThreads = std::max(4, base::NumCPUs());
+  const int kNumSubmitters = kNumThreads;
+  const int kTasksPerSubmitter = AllowSlowTests() ? 200000 : 10000;
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(kNumThreads)
+                                   .set_work_stealing(work_stealing)));
+  atomic<int64_t> counter(0);
+  LOG_TIMING(INFO, Substitute("running $0 tiny tasks from $1 threads (work stealing: $2)",
+                              kNumSubmitters * kTasksPerSubmitter, kNumSubmitters,
+                              work_stealing)) {
+    vector<thread> submitters;
+    for (int i = 0; i < kNumSubmitters; i++) {
+      submitters.emplace_back([&]() {
+        for (int j = 0; j < kTasksPerSubmitter; j++) {
+          CHECK_OK(pool_->SubmitFunc([&counter]() { counter++; }));
+        }
+      });
+    }
+    for (auto& t : submitters) {
+      t.join();
+    }
+    pool_->Wait();
+  }
+  ASSERT_EQ(kNumSubmitters * kTasksPerSubmitter, counter.load());
+}
+
 } // namespace kudu
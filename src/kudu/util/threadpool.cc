@@ -21,6 +21,7 @@
 #include <deque>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -48,6 +49,15 @@ using std::string;
 using std::unique_ptr;
 using strings::Substitute;
 
+namespace {
+
+// The work-stealing pool which the current thread is a worker of, if any, and
+// the index of its worker queue.
+__thread ThreadPool* tls_work_stealing_pool = nullptr;
+__thread int tls_worker_idx = -1;
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////
 // FunctionRunnable
 ////////////////////////////////////////////////////////
@@ -89,7 +99,8 @@ ThreadPoolBuilder::ThreadPoolBuilder(string name)
       min_threads_(0),
       max_threads_(base::NumCPUs()),
       max_queue_size_(std::numeric_limits<int>::max()),
-      idle_timeout_(MonoDelta::FromMilliseconds(500)) {}
+      idle_timeout_(MonoDelta::FromMilliseconds(500)),
+      work_stealing_(false) {}
 
 ThreadPoolBuilder& ThreadPoolBuilder::set_trace_metric_prefix(const string& prefix) {
   trace_metric_prefix_ = prefix;
@@ -123,6 +134,11 @@ ThreadPoolBuilder& ThreadPoolBuilder::set_metrics(ThreadPoolMetrics metrics) {
   return *this;
 }
 
+ThreadPoolBuilder& ThreadPoolBuilder::set_work_stealing(bool work_stealing) {
+  work_stealing_ = work_stealing;
+  return *this;
+}
+
 Status ThreadPoolBuilder::Build(gscoped_ptr<ThreadPool>* pool) const {
   pool->reset(new ThreadPool(*this));
   RETURN_NOT_OK((*pool)->Init());
@@ -309,7 +325,7 @@ const char* ThreadPoolToken::StateToString(State s) {
 
 ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
   : name_(builder.name_),
-    min_threads_(builder.min_threads_),
+    min_threads_(builder.work_stealing_ ? builder.max_threads_ : builder.min_threads_),
     max_threads_(builder.max_threads_),
     max_queue_size_(builder.max_queue_size_),
     idle_timeout_(builder.idle_timeout_),
@@ -321,7 +337,17 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     active_threads_(0),
     total_queued_tasks_(0),
     tokenless_(NewToken(ExecutionMode::CONCURRENT)),
+    work_stealing_(builder.work_stealing_),
+    next_worker_queue_(0),
+    num_worker_queue_tasks_(0),
+    num_idle_work_stealing_threads_(0),
+    shut_down_(false),
     metrics_(builder.metrics_) {
+  if (work_stealing_) {
+    for (int i = 0; i < max_threads_; i++) {
+      worker_queues_.emplace_back(new WorkerQueue());
+    }
+  }
   string prefix = !builder.trace_metric_prefix_.empty() ?
       builder.trace_metric_prefix_ : builder.name_;
 
@@ -348,7 +374,7 @@ Status ThreadPool::Init() {
   pool_status_ = Status::OK();
   num_threads_pending_start_ = min_threads_;
   for (int i = 0; i < min_threads_; i++) {
-    Status status = CreateThread();
+    Status status = work_stealing_ ? CreateWorkStealingThread(i) : CreateThread();
     if (!status.ok()) {
       Shutdown();
       return status;
@@ -366,6 +392,7 @@ void ThreadPool::Shutdown() {
   // concern though because shutting down a pool typically requires clients to
   // be quiesced first, so there's no danger of a client getting confused.
   pool_status_ = Status::ServiceUnavailable("The pool has been shut down.");
+  shut_down_ = true;
 
   // Clear the various queues under the lock, but defer the releasing
   // of the tasks outside the lock, in case there are concurrent threads
@@ -373,6 +400,8 @@ void ThreadPool::Shutdown() {
   // locks, etc, so this also prevents lock inversions.
   queue_.clear();
   std::deque<std::deque<Task>> to_release;
+  std::deque<Task> worker_queue_tasks;
+  DrainWorkerQueues(&worker_queue_tasks);
   for (auto* t : tokens_) {
     if (!t->entries_.empty()) {
       to_release.emplace_back(std::move(t->entries_));
@@ -408,6 +437,10 @@ void ThreadPool::Shutdown() {
     no_threads_cond_.Wait();
   }
 
+  // Tasks may have been submitted to the worker queues concurrently with
+  // the shutdown; they'll never run.
+  DrainWorkerQueues(&worker_queue_tasks);
+
   // All the threads have exited. Check the state of each token.
   for (auto* t : tokens_) {
     DCHECK(t->state() == ThreadPoolToken::State::IDLE ||
@@ -416,6 +449,7 @@ void ThreadPool::Shutdown() {
 
   // Finally release the queued tasks, outside the lock.
   unique_lock.Unlock();
+  to_release.emplace_back(std::move(worker_queue_tasks));
   for (auto& token : to_release) {
     for (auto& t : token) {
       if (t.trace) {
@@ -455,6 +489,9 @@ Status ThreadPool::SubmitFunc(boost::function<void()> f) {
 }
 
 Status ThreadPool::Submit(shared_ptr<Runnable> r) {
+  if (work_stealing_) {
+    return DoSubmitWorkStealing(std::move(r));
+  }
   return DoSubmit(std::move(r), tokenless_.get());
 }
 
@@ -572,10 +609,110 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
   return Status::OK();
 }
 
+Status ThreadPool::DoSubmitWorkStealing(shared_ptr<Runnable> r) {
+  MonoTime submit_time = MonoTime::Now();
+  if (PREDICT_FALSE(shut_down_)) {
+    return Status::ServiceUnavailable("The pool has been shut down.");
+  }
+
+  // Size limit check. The running tasks count towards the limit along with
+  // the queued ones, as every worker is always available to run a task.
+  int64_t capacity = static_cast<int64_t>(max_threads_) + max_queue_size_;
+  int64_t length_at_submit = num_worker_queue_tasks_++;
+  if (length_at_submit >= capacity) {
+    FinishWorkerQueueTask();
+    return Status::ServiceUnavailable(
+        Substitute("Thread pool is at capacity ($0/$1 tasks queued or running)",
+                   length_at_submit, capacity));
+  }
+
+  Task task;
+  task.runnable = std::move(r);
+  task.trace = Trace::CurrentTrace();
+  if (task.trace) {
+    task.trace->AddRef();
+  }
+  task.submit_time = submit_time;
+
+  // Workers submit to their own queue; other threads spread their tasks
+  // across the queues.
+  int worker_idx = tls_work_stealing_pool == this ?
+      tls_worker_idx : next_worker_queue_++ % worker_queues_.size();
+  WorkerQueue* queue = worker_queues_[worker_idx].get();
+  {
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    queue->tasks.emplace_back(std::move(task));
+  }
+
+  // Wake up an idle worker, if any. Workers count themselves as idle before
+  // rechecking the worker queues, so either the worker finds this task or
+  // this thread finds the worker.
+  if (num_idle_work_stealing_threads_ > 0) {
+    MutexLock guard(lock_);
+    if (!idle_threads_.empty()) {
+      idle_threads_.front().not_empty.Signal();
+      idle_threads_.pop_front();
+    }
+  }
+
+  if (metrics_.queue_length_histogram) {
+    metrics_.queue_length_histogram->Increment(length_at_submit);
+  }
+  return Status::OK();
+}
+
+bool ThreadPool::PopOrStealTask(int worker_idx, Task* task) {
+  // Tasks are taken from the front of the queues so that they run roughly in
+  // the order they were submitted.
+  const int num_queues = worker_queues_.size();
+  for (int i = 0; i < num_queues; i++) {
+    WorkerQueue* queue = worker_queues_[(worker_idx + i) % num_queues].get();
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::HasWorkerQueueTasks() {
+  for (const auto& queue : worker_queues_) {
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    if (!queue->tasks.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::DrainWorkerQueues(std::deque<Task>* tasks) {
+  lock_.AssertAcquired();
+  for (const auto& queue : worker_queues_) {
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    num_worker_queue_tasks_ -= queue->tasks.size();
+    for (auto& t : queue->tasks) {
+      tasks->emplace_back(std::move(t));
+    }
+    queue->tasks.clear();
+  }
+  if (num_worker_queue_tasks_ == 0) {
+    idle_cond_.Broadcast();
+  }
+}
+
+void ThreadPool::FinishWorkerQueueTask() {
+  if (--num_worker_queue_tasks_ == 0) {
+    MutexLock guard(lock_);
+    idle_cond_.Broadcast();
+  }
+}
+
 void ThreadPool::Wait() {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while (total_queued_tasks_ > 0 || active_threads_ > 0) {
+  while (total_queued_tasks_ > 0 || active_threads_ > 0 || num_worker_queue_tasks_ > 0) {
     idle_cond_.Wait();
   }
 }
@@ -583,7 +720,7 @@ void ThreadPool::Wait() {
 bool ThreadPool::WaitUntil(const MonoTime& until) {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while (total_queued_tasks_ > 0 || active_threads_ > 0) {
+  while (total_queued_tasks_ > 0 || active_threads_ > 0 || num_worker_queue_tasks_ > 0) {
     if (!idle_cond_.WaitUntil(until)) {
       return false;
     }
@@ -649,90 +786,172 @@ void ThreadPool::DispatchThread() {
     }
 
     // Get the next token and task to execute.
-    ThreadPoolToken* token = queue_.front();
-    queue_.pop_front();
-    DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
-    DCHECK(!token->entries_.empty());
-    Task task = std::move(token->entries_.front());
-    token->entries_.pop_front();
-    token->active_threads_++;
-    --total_queued_tasks_;
-    ++active_threads_;
-
+    Task task;
+    ThreadPoolToken* token = DequeueTokenTask(&task);
     unique_lock.Unlock();
 
-    // Release the reference which was held by the queued item.
-    ADOPT_TRACE(task.trace);
-    if (task.trace) {
-      task.trace->Release();
-    }
+    RunTask(&task, token);
+
+    unique_lock.Lock();
+    FinishTokenTask(token);
+  }
 
-    // Update metrics
-    MonoTime now(MonoTime::Now());
-    int64_t queue_time_us = (now - task.submit_time).ToMicroseconds();
-    TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
-    if (metrics_.queue_time_us_histogram) {
-      metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  // It's important that we hold the lock between exiting the loop and dropping
+  // num_threads_. Otherwise it's possible someone else could come along here
+  // and add a new task just as the last running thread is about to exit.
+  CHECK(unique_lock.OwnsLock());
+  ExitDispatchThread();
+}
+
+void ThreadPool::WorkStealingDispatchThread(int worker_idx) {
+  tls_work_stealing_pool = this;
+  tls_worker_idx = worker_idx;
+
+  MutexLock unique_lock(lock_);
+  InsertOrDie(&threads_, Thread::current_thread());
+  DCHECK_GT(num_threads_pending_start_, 0);
+  num_threads_++;
+  num_threads_pending_start_--;
+
+  // Owned by this worker thread and added/removed from idle_threads_ as needed.
+  IdleThread me(&lock_);
+
+  while (true) {
+    if (!pool_status_.ok()) {
+      VLOG(2) << "WorkStealingDispatchThread exiting: " << pool_status_.ToString();
+      break;
     }
-    if (token->metrics_.queue_time_us_histogram) {
-      token->metrics_.queue_time_us_histogram->Increment(queue_time_us);
+
+    // Run the tasks of the worker queues first, without holding the lock.
+    unique_lock.Unlock();
+    Task task;
+    while (PopOrStealTask(worker_idx, &task)) {
+      RunTask(&task, tokenless_.get());
+      FinishWorkerQueueTask();
     }
+    unique_lock.Lock();
 
-    // Execute the task
-    {
-      MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
-      MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+    if (!pool_status_.ok()) {
+      continue;
+    }
 
-      task.runnable->Run();
+    if (!queue_.empty()) {
+      ThreadPoolToken* token = DequeueTokenTask(&task);
+      unique_lock.Unlock();
 
-      int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
-      int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+      RunTask(&task, token);
 
-      if (metrics_.run_time_us_histogram) {
-        metrics_.run_time_us_histogram->Increment(wall_us);
-      }
-      if (token->metrics_.run_time_us_histogram) {
-        token->metrics_.run_time_us_histogram->Increment(wall_us);
-      }
-      TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
-      TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+      unique_lock.Lock();
+      FinishTokenTask(token);
+      continue;
     }
-    // Destruct the task while we do not hold the lock.
-    //
-    // The task's destructor may be expensive if it has a lot of bound
-    // objects, and we don't want to block submission of the threadpool.
-    // In the worst case, the destructor might even try to do something
-    // with this threadpool, and produce a deadlock.
-    task.runnable.reset();
-    unique_lock.Lock();
 
-    // Possible states:
-    // 1. The token was shut down while we ran its task. Transition to QUIESCED.
-    // 2. The token has no more queued tasks. Transition back to IDLE.
-    // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
-    ThreadPoolToken::State state = token->state();
-    DCHECK(state == ThreadPoolToken::State::RUNNING ||
-           state == ThreadPoolToken::State::QUIESCING);
-    if (--token->active_threads_ == 0) {
-      if (state == ThreadPoolToken::State::QUIESCING) {
-        DCHECK(token->entries_.empty());
-        token->Transition(ThreadPoolToken::State::QUIESCED);
-      } else if (token->entries_.empty()) {
-        token->Transition(ThreadPoolToken::State::IDLE);
-      } else if (token->mode() == ExecutionMode::SERIAL) {
-        queue_.emplace_back(token);
-      }
+    // There's no work to do, let's go idle. Counting this thread as idle
+    // before rechecking the worker queues ensures that a concurrent
+    // submission to a worker queue either is seen here or wakes this thread.
+    idle_threads_.push_front(me);
+    num_idle_work_stealing_threads_++;
+    if (!HasWorkerQueueTasks()) {
+      me.not_empty.Wait();
     }
-    if (--active_threads_ == 0) {
-      idle_cond_.Broadcast();
+    num_idle_work_stealing_threads_--;
+    if (me.is_linked()) {
+      idle_threads_.erase(idle_threads_.iterator_to(me));
     }
   }
 
-  // It's important that we hold the lock between exiting the loop and dropping
-  // num_threads_. Otherwise it's possible someone else could come along here
-  // and add a new task just as the last running thread is about to exit.
   CHECK(unique_lock.OwnsLock());
+  ExitDispatchThread();
+}
+
+ThreadPoolToken* ThreadPool::DequeueTokenTask(Task* task) {
+  lock_.AssertAcquired();
+  DCHECK(!queue_.empty());
+  ThreadPoolToken* token = queue_.front();
+  queue_.pop_front();
+  DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
+  DCHECK(!token->entries_.empty());
+  *task = std::move(token->entries_.front());
+  token->entries_.pop_front();
+  token->active_threads_++;
+  --total_queued_tasks_;
+  ++active_threads_;
+  return token;
+}
+
+void ThreadPool::RunTask(Task* task, ThreadPoolToken* token) {
+  // Release the reference which was held by the queued item.
+  ADOPT_TRACE(task->trace);
+  if (task->trace) {
+    task->trace->Release();
+  }
+
+  // Update metrics
+  MonoTime now(MonoTime::Now());
+  int64_t queue_time_us = (now - task->submit_time).ToMicroseconds();
+  TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
+  if (metrics_.queue_time_us_histogram) {
+    metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  }
+  if (token->metrics_.queue_time_us_histogram) {
+    token->metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  }
+
+  // Execute the task
+  {
+    MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
+    MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+
+    task->runnable->Run();
+
+    int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
+    int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+
+    if (metrics_.run_time_us_histogram) {
+      metrics_.run_time_us_histogram->Increment(wall_us);
+    }
+    if (token->metrics_.run_time_us_histogram) {
+      token->metrics_.run_time_us_histogram->Increment(wall_us);
+    }
+    TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
+    TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+  }
+  // Destruct the task while we do not hold the lock.
+  //
+  // The task's destructor may be expensive if it has a lot of bound
+  // objects, and we don't want to block submission of the threadpool.
+  // In the worst case, the destructor might even try to do something
+  // with this threadpool, and produce a deadlock.
+  task->runnable.reset();
+}
+
+void ThreadPool::FinishTokenTask(ThreadPoolToken* token) {
+  lock_.AssertAcquired();
+
+  // Possible states:
+  // 1. The token was shut down while we ran its task. Transition to QUIESCED.
+  // 2. The token has no more queued tasks. Transition back to IDLE.
+  // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
+  ThreadPoolToken::State state = token->state();
+  DCHECK(state == ThreadPoolToken::State::RUNNING ||
+         state == ThreadPoolToken::State::QUIESCING);
+  if (--token->active_threads_ == 0) {
+    if (state == ThreadPoolToken::State::QUIESCING) {
+      DCHECK(token->entries_.empty());
+      token->Transition(ThreadPoolToken::State::QUIESCED);
+    } else if (token->entries_.empty()) {
+      token->Transition(ThreadPoolToken::State::IDLE);
+    } else if (token->mode() == ExecutionMode::SERIAL) {
+      queue_.emplace_back(token);
+    }
+  }
+  if (--active_threads_ == 0) {
+    idle_cond_.Broadcast();
+  }
+}
 
+void ThreadPool::ExitDispatchThread() {
+  lock_.AssertAcquired();
   CHECK_EQ(threads_.erase(Thread::current_thread()), 1);
   num_threads_--;
   if (num_threads_ + num_threads_pending_start_ == 0) {
@@ -750,6 +969,12 @@ Status ThreadPool::CreateThread() {
                               &ThreadPool::DispatchThread, this, nullptr);
 }
 
+Status ThreadPool::CreateWorkStealingThread(int worker_idx) {
+  return kudu::Thread::Create("thread pool", strings::Substitute("$0 [worker]", name_),
+                              &ThreadPool::WorkStealingDispatchThread, this, worker_idx,
+                              nullptr);
+}
+
 void ThreadPool::CheckNotPoolThreadUnlocked() {
   Thread* current = Thread::current_thread();
   if (ContainsKey(threads_, current)) {
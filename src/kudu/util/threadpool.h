@@ -17,11 +17,14 @@
 #ifndef KUDU_UTIL_THREAD_POOL_H
 #define KUDU_UTIL_THREAD_POOL_H
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <iosfwd>
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive/list_hook.hpp>
@@ -33,6 +36,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
@@ -127,6 +131,12 @@ class ThreadPoolBuilder {
   ThreadPoolBuilder& set_idle_timeout(const MonoDelta& idle_timeout);
   ThreadPoolBuilder& set_metrics(ThreadPoolMetrics metrics);
 
+  // Whether tokenless submissions are distributed across per-worker queues
+  // which idle workers steal from, rather than going through the pool-wide
+  // queue. A work-stealing pool starts all of its max_threads workers
+  // upfront and never retires them. Submissions via tokens are unaffected.
+  ThreadPoolBuilder& set_work_stealing(bool work_stealing);
+
   // Instantiate a new ThreadPool with the existing builder arguments.
   Status Build(gscoped_ptr<ThreadPool>* pool) const;
 
@@ -139,6 +149,7 @@ class ThreadPoolBuilder {
   int max_queue_size_;
   MonoDelta idle_timeout_;
   ThreadPoolMetrics metrics_;
+  bool work_stealing_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolBuilder);
 };
@@ -258,21 +269,76 @@ class ThreadPool {
   // Initializes the thread pool by starting the minimum number of threads.
   Status Init();
 
+  // A queue of tokenless tasks owned by a worker of a work-stealing pool.
+  struct WorkerQueue {
+    simple_spinlock lock;
+    std::deque<Task> tasks;
+  };
+
   // Dispatcher responsible for dequeueing and executing the tasks
   void DispatchThread();
 
+  // Dispatcher of a work-stealing pool: executes the tasks from the queue of
+  // worker 'worker_idx', then those stolen from other workers' queues, and
+  // then those queued via tokens.
+  void WorkStealingDispatchThread(int worker_idx);
+
   // Create new thread.
   //
   // REQUIRES: caller has incremented 'num_threads_pending_start_' ahead of this call.
   // NOTE: For performance reasons, lock_ should not be held.
   Status CreateThread();
 
+  // Like CreateThread(), but creates worker 'worker_idx' of a work-stealing pool.
+  Status CreateWorkStealingThread(int worker_idx);
+
   // Aborts if the current thread is a member of this thread pool.
   void CheckNotPoolThreadUnlocked();
 
   // Submits a task to be run via token.
   Status DoSubmit(std::shared_ptr<Runnable> r, ThreadPoolToken* token);
 
+  // Submits a tokenless task to a worker queue of a work-stealing pool.
+  Status DoSubmitWorkStealing(std::shared_ptr<Runnable> r);
+
+  // Pops the next task from the queue of worker 'worker_idx' into 'task', or
+  // steals one from another worker's queue if that queue is empty. Returns
+  // false if all the queues are empty.
+  bool PopOrStealTask(int worker_idx, Task* task);
+
+  // Returns true if any of the worker queues has a task.
+  bool HasWorkerQueueTasks();
+
+  // Moves the tasks queued in the worker queues to 'tasks'.
+  //
+  // REQUIRES: lock_ is held.
+  void DrainWorkerQueues(std::deque<Task>* tasks);
+
+  // Accounts for the completion of a task submitted to the worker queues.
+  // Must be called without holding lock_.
+  void FinishWorkerQueueTask();
+
+  // Dequeues the next task from the token at the front of queue_ into 'task',
+  // marking it as running, and returns the token.
+  //
+  // REQUIRES: lock_ is held and queue_ isn't empty.
+  ThreadPoolToken* DequeueTokenTask(Task* task);
+
+  // Runs 'task', which was submitted via 'token', updating the metrics.
+  // Must be called without holding lock_.
+  void RunTask(Task* task, ThreadPoolToken* token);
+
+  // Updates the state of 'token' after a worker finished running one of its
+  // tasks.
+  //
+  // REQUIRES: lock_ is held.
+  void FinishTokenTask(ThreadPoolToken* token);
+
+  // Unregisters the current worker thread from the pool.
+  //
+  // REQUIRES: lock_ is held.
+  void ExitDispatchThread();
+
   // Releases token 't' and invalidates it.
   void ReleaseToken(ThreadPoolToken* t);
 
@@ -362,6 +428,29 @@ class ThreadPool {
   // ExecutionMode::CONCURRENT token used by the pool for tokenless submission.
   std::unique_ptr<ThreadPoolToken> tokenless_;
 
+  // Whether tokenless submissions go through 'worker_queues_'.
+  const bool work_stealing_;
+
+  // The queues of tokenless tasks of the workers of a work-stealing pool,
+  // indexed by worker. Empty if the pool isn't work-stealing.
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+
+  // The worker queue which receives the next tokenless task submitted from
+  // outside the pool.
+  std::atomic<uint32_t> next_worker_queue_;
+
+  // Number of tasks submitted to the worker queues which are queued or
+  // running. Waiters on idle_cond_ are woken up when it reaches zero.
+  std::atomic<int64_t> num_worker_queue_tasks_;
+
+  // Number of work-stealing workers in 'idle_threads_'. Lets submissions
+  // to the worker queues skip acquiring lock_ when no worker is idle.
+  std::atomic<int> num_idle_work_stealing_threads_;
+
+  // Set when the pool is shut down, checked by work-stealing submissions
+  // which don't acquire lock_.
+  std::atomic<bool> shut_down_;
+
   // Metrics for the entire thread pool.
   const ThreadPoolMetrics metrics_;
 
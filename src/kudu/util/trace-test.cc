@@ -88,6 +88,26 @@ TEST_F(TraceTest, TestBasic) {
             result);
 }
 
+TEST_F(TraceTest, TestBinary) {
+  scoped_refptr<Trace> t(new Trace);
+  {
+    string temp = "transient";
+    TRACE_BINARY_TO(t, "hello $0, $1", "world", 12345);
+    TRACE_BINARY_TO(t, "$0 $1 $2 $3 $4 $$", temp, -1, 2.5, true, 'c');
+    temp.assign("overwritten");
+  }
+  TRACE_BINARY_TO(t, "no arguments");
+  TRACE_TO(t, "goodbye $0", "formatted world");
+
+  // The binary messages are formatted on demand, and may be interleaved with
+  // formatted ones.
+  ASSERT_EQ("XXXX XX:XX:XX.XXXXXX trace-test.cc:XXX] hello world, XXXXX\n"
+            "XXXX XX:XX:XX.XXXXXX trace-test.cc:XXX] transient -X X.X true c $\n"
+            "XXXX XX:XX:XX.XXXXXX trace-test.cc:XXX] no arguments\n"
+            "XXXX XX:XX:XX.XXXXXX trace-test.cc:XXX] goodbye formatted world\n",
+            XOutDigits(t->DumpToString(Trace::NO_FLAGS)));
+}
+
 TEST_F(TraceTest, TestAttach) {
   scoped_refptr<Trace> traceA(new Trace);
   scoped_refptr<Trace> traceB(new Trace);
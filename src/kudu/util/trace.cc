@@ -65,15 +65,67 @@ struct TraceEntry {
   const char* file_path;
   int line_number;
 
+  // The format of a binary message, or nullptr if the message was formatted
+  // when it was traced.
+  const char* format;
+  // The number of arguments of a binary message.
+  uint32_t num_args;
+
+  // The length of the payload following the entry header.
   uint32_t message_len;
   TraceEntry* next;
 
-  // The actual trace message follows the entry header.
+  // The payload follows the entry header: either the actual trace message or,
+  // for binary messages, the arguments followed by the contents of their
+  // strings.
   char* message() {
     return reinterpret_cast<char*>(this) + sizeof(*this);
   }
+  const char* message() const {
+    return reinterpret_cast<const char*>(this) + sizeof(*this);
+  }
+  TraceArg* args() {
+    return reinterpret_cast<TraceArg*>(message());
+  }
+  const TraceArg* args() const {
+    return reinterpret_cast<const TraceArg*>(message());
+  }
 };
 
+// The maximum number of arguments of a binary trace message.
+static const int kMaxTraceArgs = 10;
+
+string TraceArg::ToString() const {
+  switch (type_) {
+    case INT: {
+      SubstituteArg s(static_cast<long long>(value_.i));
+      return string(s.data(), s.size());
+    }
+    case UINT: {
+      SubstituteArg s(static_cast<unsigned long long>(value_.u));
+      return string(s.data(), s.size());
+    }
+    case DOUBLE: {
+      SubstituteArg s(value_.d);
+      return string(s.data(), s.size());
+    }
+    case POINTER: {
+      SubstituteArg s(value_.p);
+      return string(s.data(), s.size());
+    }
+    case BOOL:
+      return value_.b ? "true" : "false";
+    case CHAR:
+      return string(1, value_.c);
+    case STRING:
+      return string(value_.s, size_);
+    case NONE:
+      break;
+  }
+  LOG(FATAL) << "unexpected trace argument type: " << type_;
+  return "";
+}
+
 // Get the part of filepath after the last path separator.
 // (Doesn't modify filepath, contrary to basename() in libgen.h.)
 // Borrowed from glog.
@@ -105,11 +157,82 @@ void Trace::SubstituteAndTrace(const char* file_path,
   AddEntry(entry);
 }
 
+void Trace::TraceBinary(const char* file_path,
+                        int line_number,
+                        const char* format,
+                        const TraceArg& arg0, const TraceArg& arg1,
+                        const TraceArg& arg2, const TraceArg& arg3,
+                        const TraceArg& arg4, const TraceArg& arg5,
+                        const TraceArg& arg6, const TraceArg& arg7,
+                        const TraceArg& arg8, const TraceArg& arg9) {
+  const TraceArg* const args_array[kMaxTraceArgs] = {
+    &arg0, &arg1, &arg2, &arg3, &arg4, &arg5, &arg6, &arg7, &arg8, &arg9
+  };
+
+  int num_args = 0;
+  int strings_len = 0;
+  for (const TraceArg* arg : args_array) {
+    if (arg->type_ == TraceArg::NONE) {
+      break;
+    }
+    strings_len += arg->size_;
+    num_args++;
+  }
+
+  TraceEntry* entry = NewEntry(num_args * sizeof(TraceArg) + strings_len,
+                               file_path, line_number);
+  entry->format = format;
+  entry->num_args = num_args;
+  TraceArg* args = entry->args();
+  char* strings = reinterpret_cast<char*>(args + num_args);
+  for (int i = 0; i < num_args; i++) {
+    args[i] = *args_array[i];
+    if (args[i].type_ == TraceArg::STRING) {
+      memcpy(strings, args[i].value_.s, args[i].size_);
+      args[i].value_.s = strings;
+      strings += args[i].size_;
+    }
+  }
+  AddEntry(entry);
+}
+
+void Trace::AppendMessage(const TraceEntry* entry, std::ostream* out) {
+  if (entry->format == nullptr) {
+    out->write(entry->message(), entry->message_len);
+    return;
+  }
+
+  // Format each of the arguments, then substitute them into the format.
+  // Since the resulting SubstituteArgs point to 'formatted' rather than into
+  // their own scratch space, they may safely be copied around.
+  const TraceArg* args = entry->args();
+  string formatted[kMaxTraceArgs];
+  vector<SubstituteArg> substitute_args;
+  substitute_args.reserve(entry->num_args);
+  for (int i = 0; i < entry->num_args; i++) {
+    formatted[i] = args[i].ToString();
+    substitute_args.emplace_back(formatted[i]);
+  }
+  const SubstituteArg* args_array[kMaxTraceArgs + 1];
+  for (int i = 0; i < kMaxTraceArgs; i++) {
+    args_array[i] = i < entry->num_args ? &substitute_args[i] : &SubstituteArg::kNoArg;
+  }
+  args_array[kMaxTraceArgs] = nullptr;
+
+  string msg;
+  msg.resize(strings::internal::SubstitutedSize(entry->format, args_array));
+  SubstituteToBuffer(entry->format, args_array, &msg[0]);
+  *out << msg;
+}
+
 TraceEntry* Trace::NewEntry(int msg_len, const char* file_path, int line_number) {
   int size = sizeof(TraceEntry) + msg_len;
-  uint8_t* dst = reinterpret_cast<uint8_t*>(arena_->AllocateBytes(size));
+  uint8_t* dst = reinterpret_cast<uint8_t*>(
+      arena_->AllocateBytesAligned(size, alignof(TraceEntry)));
   TraceEntry* entry = reinterpret_cast<TraceEntry*>(dst);
   entry->timestamp_micros = GetCurrentTimeMicros();
+  entry->format = nullptr;
+  entry->num_args = 0;
   entry->message_len = msg_len;
   entry->file_path = file_path;
   entry->line_number = line_number;
@@ -168,8 +291,7 @@ void Trace::Dump(std::ostream* out, int flags) const {
     }
     *out << const_basename(e->file_path) << ':' << e->line_number
          << "] ";
-    out->write(reinterpret_cast<char*>(e) + sizeof(TraceEntry),
-               e->message_len);
+    AppendMessage(e, out);
     *out << std::endl;
   }
 
@@ -17,6 +17,8 @@
 #ifndef KUDU_UTIL_TRACE_H
 #define KUDU_UTIL_TRACE_H
 
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 #include <string>
 #include <utility>
@@ -59,6 +61,26 @@ class Trace;
 #define TRACE_TO(trace, format, substitutions...) \
   (trace)->SubstituteAndTrace(__FILE__, __LINE__, (format), ##substitutions)
 
+// Like TRACE(), but records the format string and the raw arguments, deferring
+// the formatting of the message until the trace is dumped. This makes tracing
+// cheap enough to be left on in hot paths, most notably for every RPC.
+//
+// The format must be a string literal, since only a pointer to it is kept.
+// See kudu::TraceArg for the supported types of arguments.
+// Example:
+//  TRACE_BINARY("Acquired locks for $0 operations", num_ops);
+#define TRACE_BINARY(format, args...) \
+  do { \
+    kudu::Trace* _trace = Trace::CurrentTrace(); \
+    if (_trace) { \
+      _trace->TraceBinary(__FILE__, __LINE__, "" format "", ##args); \
+    } \
+  } while (0);
+
+// Like the above, but takes the trace pointer as an explicit argument.
+#define TRACE_BINARY_TO(trace, format, args...) \
+  (trace)->TraceBinary(__FILE__, __LINE__, "" format "", ##args)
+
 // Increment a counter associated with the current trace.
 //
 // Each trace contains a map of counters which can be used to keep
@@ -118,6 +140,65 @@ class JsonWriter;
 class ThreadSafeArena;
 struct TraceEntry;
 
+// An argument of a binary trace message (see TRACE_BINARY()). Integers,
+// floating point numbers, booleans and pointers are stored as is; strings are
+// copied into the trace, since they may not outlive the call.
+class TraceArg {
+ public:
+  enum Type : uint8_t {
+    NONE,
+    INT,
+    UINT,
+    DOUBLE,
+    BOOL,
+    POINTER,
+    CHAR,
+    STRING,
+  };
+
+  TraceArg() : type_(NONE), size_(0) { value_.i = 0; }
+
+  TraceArg(const char* value)  // NOLINT(runtime/explicit)
+      : type_(STRING), size_(value == nullptr ? 0 : strlen(value)) { value_.s = value; }
+  TraceArg(const std::string& value)  // NOLINT(runtime/explicit)
+      : type_(STRING), size_(value.size()) { value_.s = value.data(); }
+  TraceArg(const StringPiece& value)  // NOLINT(runtime/explicit)
+      : type_(STRING), size_(value.size()) { value_.s = value.data(); }
+  TraceArg(char value) : type_(CHAR), size_(0) { value_.c = value; }  // NOLINT
+
+  TraceArg(short value) : type_(INT), size_(0) { value_.i = value; }  // NOLINT
+  TraceArg(int value) : type_(INT), size_(0) { value_.i = value; }  // NOLINT
+  TraceArg(long value) : type_(INT), size_(0) { value_.i = value; }  // NOLINT
+  TraceArg(long long value) : type_(INT), size_(0) { value_.i = value; }  // NOLINT
+  TraceArg(unsigned short value) : type_(UINT), size_(0) { value_.u = value; }  // NOLINT
+  TraceArg(unsigned int value) : type_(UINT), size_(0) { value_.u = value; }  // NOLINT
+  TraceArg(unsigned long value) : type_(UINT), size_(0) { value_.u = value; }  // NOLINT
+  TraceArg(unsigned long long value) : type_(UINT), size_(0) { value_.u = value; }  // NOLINT
+  TraceArg(float value) : type_(DOUBLE), size_(0) { value_.d = value; }  // NOLINT
+  TraceArg(double value) : type_(DOUBLE), size_(0) { value_.d = value; }  // NOLINT
+  TraceArg(bool value) : type_(BOOL), size_(0) { value_.b = value; }  // NOLINT
+  TraceArg(const void* value) : type_(POINTER), size_(0) { value_.p = value; }  // NOLINT
+
+  // Formats the argument the way strings::Substitute() would.
+  std::string ToString() const;
+
+ private:
+  friend class Trace;
+
+  Type type_;
+  // The length of a STRING argument.
+  uint32_t size_;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    bool b;
+    const void* p;
+    char c;
+    const char* s;
+  } value_;
+};
+
 // A trace for a request or other process. This supports collecting trace entries
 // from a number of threads, and later dumping the results to a stream.
 //
@@ -159,6 +240,19 @@ class Trace : public RefCountedThreadSafe<Trace> {
                           const strings::internal::SubstituteArg& arg9 =
                             strings::internal::SubstituteArg::kNoArg);
 
+  // Logs a binary message into the trace buffer: the arguments are stored
+  // along with a pointer to the format, and the message is only formatted
+  // with strings::Substitute when the trace is dumped.
+  //
+  // N.B.: neither the file path nor the format is copied, so both should be
+  // static constants (eg __FILE__ and a string literal).
+  void TraceBinary(const char* filepath, int line_number, const char* format,
+                   const TraceArg& arg0 = TraceArg(), const TraceArg& arg1 = TraceArg(),
+                   const TraceArg& arg2 = TraceArg(), const TraceArg& arg3 = TraceArg(),
+                   const TraceArg& arg4 = TraceArg(), const TraceArg& arg5 = TraceArg(),
+                   const TraceArg& arg6 = TraceArg(), const TraceArg& arg7 = TraceArg(),
+                   const TraceArg& arg8 = TraceArg(), const TraceArg& arg9 = TraceArg());
+
   // Dump the trace buffer to the given output stream.
   //
   enum {
@@ -219,6 +313,9 @@ class Trace : public RefCountedThreadSafe<Trace> {
   // message of length 'len'.
   TraceEntry* NewEntry(int len, const char* file_path, int line_number);
 
+  // Appends the message of 'entry' to 'out', formatting it if it's binary.
+  static void AppendMessage(const TraceEntry* entry, std::ostream* out);
+
   // Add the entry to the linked list of entries.
   void AddEntry(TraceEntry* entry);
 
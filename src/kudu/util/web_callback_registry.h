@@ -99,6 +99,11 @@ class WebCallbackRegistry {
   typedef boost::function<void (const WebRequest& args, PrerenderedWebResponse* resp)>
       PrerenderedPathHandlerCallback;
 
+  // A function that handles an HTTP request by writing the response body to
+  // 'output' as it is produced, rather than building it in memory first.
+  typedef boost::function<void (const WebRequest& args, std::ostream* output)>
+      StreamingPathHandlerCallback;
+
   virtual ~WebCallbackRegistry() {}
 
   // Register a callback for a URL path. Path should not include the
@@ -122,6 +127,15 @@ class WebCallbackRegistry {
                                               const PrerenderedPathHandlerCallback& callback,
                                               bool is_styled,
                                               bool is_on_nav_bar) = 0;
+
+  // Same as RegisterPrerenderedPathHandler(), except that the response body is
+  // sent to the client while 'callback' writes it, and is never styled. The
+  // response always has status 200 and the given 'content_type'. Meant for
+  // large pages scraped by machines, such as the metrics.
+  virtual void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                            const StreamingPathHandlerCallback& callback,
+                                            const std::string& content_type,
+                                            bool is_on_nav_bar) = 0;
 };
 
 } // namespace kudu
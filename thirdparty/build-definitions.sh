@@ -418,6 +418,19 @@ build_lz4() {
   popd
 }
 
+build_zstd() {
+  ZSTD_BDIR=$TP_BUILD_DIR/$ZSTD_NAME$MODE_SUFFIX
+  mkdir -p $ZSTD_BDIR
+  pushd $ZSTD_BDIR
+  # zstd doesn't support out-of-tree builds, so copy the sources into the
+  # build directory.
+  rsync -av --delete $ZSTD_SOURCE/ .
+  CFLAGS="$EXTRA_CFLAGS -fPIC" \
+    make -C lib -j$PARALLEL $EXTRA_MAKEFLAGS libzstd.a
+  make -C lib PREFIX=$PREFIX install-static install-includes
+  popd
+}
+
 build_bitshuffle() {
   BITSHUFFLE_BDIR=$TP_BUILD_DIR/$BITSHUFFLE_NAME$MODE_SUFFIX
   mkdir -p $BITSHUFFLE_BDIR